@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/AdaptivePipeline.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+namespace detail {
+
+namespace {
+// How often idle workers check whether they're retired
+constexpr std::chrono::milliseconds kPollInterval{20};
+} // namespace
+
+AdaptivePipelineStageBase::AdaptivePipelineStageBase(
+    AdaptivePipelineStageOptions options)
+    : options_(std::move(options)) {
+  CHECK_GE(options_.minWorkers, 1);
+  CHECK_LE(options_.minWorkers, options_.maxWorkers);
+}
+
+AdaptivePipelineStageBase::~AdaptivePipelineStageBase() {
+  DCHECK(workers_.empty()) << "Derived classes must call stop()";
+}
+
+void AdaptivePipelineStageBase::setNumWorkers(size_t n) {
+  n = std::min(std::max(n, options_.minWorkers), options_.maxWorkers);
+  std::lock_guard<std::mutex> g(mutex_);
+  target_.store(n);
+  while (workers_.size() < n) {
+    size_t id = workers_.size();
+    workers_.emplace_back([this, id] { workerLoop(id); });
+  }
+  while (workers_.size() > n) {
+    workers_.back().join();
+    workers_.pop_back();
+  }
+}
+
+size_t AdaptivePipelineStageBase::numWorkers() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return workers_.size();
+}
+
+void AdaptivePipelineStageBase::stop() {
+  std::lock_guard<std::mutex> g(mutex_);
+  target_.store(0);
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+}
+
+void AdaptivePipelineStageBase::workerLoop(size_t id) {
+  while (id < target_.load()) {
+    runOnce(std::chrono::steady_clock::now() + kPollInterval);
+  }
+}
+
+AdaptivePipelineBase::AdaptivePipelineBase(AdaptivePipelineOptions options)
+    : options_(std::move(options)) {
+  CHECK_GE(options_.maxInFlight, 1);
+}
+
+AdaptivePipelineBase::~AdaptivePipelineBase() {
+  stop();
+}
+
+void AdaptivePipelineBase::start(
+    std::vector<std::unique_ptr<AdaptivePipelineStageBase>> stages) {
+  stages_ = std::move(stages);
+  for (auto& stage : stages_) {
+    stage->setNumWorkers(stage->options().initialWorkers);
+  }
+  if (options_.tuneInterval.count() > 0 && !stages_.empty()) {
+    tuner_ = std::thread([this] { tuneLoop(); });
+  }
+}
+
+void AdaptivePipelineBase::stop() {
+  {
+    std::lock_guard<std::mutex> g(tunerMutex_);
+    stopping_ = true;
+  }
+  tunerCv_.notify_all();
+  if (tuner_.joinable()) {
+    tuner_.join();
+  }
+  for (auto& stage : stages_) {
+    stage->stop();
+  }
+}
+
+void AdaptivePipelineBase::tuneLoop() {
+  std::unique_lock<std::mutex> lock(tunerMutex_);
+  while (!tunerCv_.wait_for(
+      lock, options_.tuneInterval, [&] { return stopping_; })) {
+    tune();
+  }
+}
+
+bool AdaptivePipelineBase::tune() {
+  // The stage with the most batches waiting which may grow, and the one
+  // with the fewest which may shrink
+  AdaptivePipelineStageBase* busiest = nullptr;
+  AdaptivePipelineStageBase* idlest = nullptr;
+  size_t busiestQueue = 0;
+  size_t idlestQueue = 0;
+  size_t total = 0;
+  for (auto& stage : stages_) {
+    size_t workers = stage->numWorkers();
+    size_t queue = stage->queueSize();
+    total += workers;
+    if (workers < stage->options().maxWorkers &&
+        (!busiest || queue > busiestQueue)) {
+      busiest = stage.get();
+      busiestQueue = queue;
+    }
+    if (workers > stage->options().minWorkers &&
+        (!idlest || queue < idlestQueue)) {
+      idlest = stage.get();
+      idlestQueue = queue;
+    }
+  }
+  if (!busiest || busiestQueue == 0) {
+    return false;
+  }
+  if (total < options_.maxTotalWorkers) {
+    busiest->setNumWorkers(busiest->numWorkers() + 1);
+    return true;
+  }
+  // Hysteresis, so that a worker doesn't go back and forth between two
+  // stages which keep up about as well
+  if (!idlest || idlest == busiest || busiestQueue <= idlestQueue + 1) {
+    return false;
+  }
+  idlest->setNumWorkers(idlest->numWorkers() - 1);
+  busiest->setNumWorkers(busiest->numWorkers() + 1);
+  return true;
+}
+
+} // namespace detail
+} // namespace folly
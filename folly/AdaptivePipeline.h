@@ -0,0 +1,451 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
+#include <folly/MPMCQueue.h>
+#include <folly/portability/SysTypes.h>
+
+namespace folly {
+
+struct AdaptivePipelineStageOptions {
+  // For numWorkers() and logging
+  std::string name;
+  size_t initialWorkers{1};
+  // The range within which the pipeline tunes the number of workers
+  size_t minWorkers{1};
+  size_t maxWorkers{64};
+};
+
+struct AdaptivePipelineOptions {
+  // Batches written but not read yet; blockingWrite() waits for room.
+  // Every queue between stages holds that many, so that a stage never
+  // waits on the next one.
+  size_t maxInFlight{1024};
+  // How often workers are moved between stages, towards the stage with
+  // the most batches waiting; zero disables tuning
+  std::chrono::milliseconds tuneInterval{100};
+  // Workers of all the stages together
+  size_t maxTotalWorkers{64};
+};
+
+namespace detail {
+
+template <class T>
+struct AdaptivePipelineBatch {
+  uint64_t seq{0};
+  std::vector<T> items;
+  exception_wrapper error;
+};
+
+template <class T>
+class AdaptivePipelineSink {
+ public:
+  virtual ~AdaptivePipelineSink() = default;
+  virtual void push(AdaptivePipelineBatch<T>&& batch) = 0;
+};
+
+// The part of a stage which doesn't depend on its types: its workers
+class AdaptivePipelineStageBase {
+ public:
+  explicit AdaptivePipelineStageBase(AdaptivePipelineStageOptions options);
+  virtual ~AdaptivePipelineStageBase();
+
+  // Starts workers, or retires workers and waits for them to finish their
+  // batch, to get n (clamped to [minWorkers, maxWorkers])
+  void setNumWorkers(size_t n);
+  size_t numWorkers() const;
+  // Retires all workers
+  void stop();
+
+  const AdaptivePipelineStageOptions& options() const {
+    return options_;
+  }
+
+  // Batches waiting for a worker
+  virtual size_t queueSize() const = 0;
+
+ protected:
+  // Processes the next batch, if one comes before deadline
+  virtual bool runOnce(std::chrono::steady_clock::time_point deadline) = 0;
+
+ private:
+  void workerLoop(size_t id);
+
+  const AdaptivePipelineStageOptions options_;
+  mutable std::mutex mutex_;
+  std::vector<std::thread> workers_;
+  // Workers with an id at least that retire
+  std::atomic<size_t> target_{0};
+};
+
+template <class In, class Out>
+class AdaptivePipelineStage : public AdaptivePipelineStageBase,
+                              public AdaptivePipelineSink<In> {
+ public:
+  using Fn = Function<std::vector<Out>(std::vector<In>&&) const>;
+
+  AdaptivePipelineStage(
+      Fn fn,
+      AdaptivePipelineStageOptions options,
+      size_t capacity,
+      AdaptivePipelineSink<Out>* next)
+      : AdaptivePipelineStageBase(std::move(options)),
+        fn_(std::move(fn)),
+        queue_(capacity),
+        next_(next) {}
+
+  ~AdaptivePipelineStage() override {
+    stop();
+  }
+
+  void push(AdaptivePipelineBatch<In>&& batch) override {
+    queue_.blockingWrite(std::move(batch));
+  }
+
+  size_t queueSize() const override {
+    return size_t(std::max<ssize_t>(0, queue_.sizeGuess()));
+  }
+
+ protected:
+  bool runOnce(std::chrono::steady_clock::time_point deadline) override {
+    AdaptivePipelineBatch<In> in;
+    if (!queue_.tryReadUntil(deadline, in)) {
+      return false;
+    }
+    AdaptivePipelineBatch<Out> out;
+    out.seq = in.seq;
+    out.error = std::move(in.error);
+    if (!out.error) {
+      try {
+        out.items = fn_(std::move(in.items));
+      } catch (const std::exception& e) {
+        out.error = exception_wrapper(std::current_exception(), e);
+      } catch (...) {
+        out.error = exception_wrapper(std::current_exception());
+      }
+    }
+    next_->push(std::move(out));
+    return true;
+  }
+
+ private:
+  Fn fn_;
+  MPMCQueue<AdaptivePipelineBatch<In>> queue_;
+  AdaptivePipelineSink<Out>* next_;
+};
+
+// The part of the pipeline which doesn't depend on its types: its stages,
+// and the thread tuning them
+class AdaptivePipelineBase {
+ public:
+  size_t numStages() const {
+    return stages_.size();
+  }
+  const std::string& stageName(size_t stage) const {
+    return stages_.at(stage)->options().name;
+  }
+  size_t numWorkers(size_t stage) const {
+    return stages_.at(stage)->numWorkers();
+  }
+  // Overridden by tuning, unless it's disabled
+  void setNumWorkers(size_t stage, size_t n) {
+    stages_.at(stage)->setNumWorkers(n);
+  }
+  // Batches waiting for a worker of the stage
+  size_t queueSize(size_t stage) const {
+    return stages_.at(stage)->queueSize();
+  }
+
+  // Moves a worker towards the stage with the most batches waiting, as
+  // the tuning thread does every tuneInterval.  Returns whether any moved.
+  bool tune();
+
+ protected:
+  explicit AdaptivePipelineBase(AdaptivePipelineOptions options);
+  ~AdaptivePipelineBase();
+
+  // Starts the workers and the tuning thread
+  void start(std::vector<std::unique_ptr<AdaptivePipelineStageBase>> stages);
+  // Stops them, before the sinks they write to are destroyed
+  void stop();
+
+  const AdaptivePipelineOptions options_;
+
+ private:
+  void tuneLoop();
+
+  std::vector<std::unique_ptr<AdaptivePipelineStageBase>> stages_;
+  std::thread tuner_;
+  std::mutex tunerMutex_;
+  std::condition_variable tunerCv_;
+  bool stopping_{false};
+};
+
+} // namespace detail
+
+template <class In, class Out>
+class AdaptivePipelineBuilder;
+
+/**
+ * A pipeline of stages, each run by its own pool of worker threads.
+ * Batches of items go through the stages in any order, but come out of
+ * the pipeline in the order they went in.
+ *
+ * Unlike MPMCPipeline, where the caller's threads run the stages one item
+ * at a time, the pipeline owns its workers, and sizes each stage's pool at
+ * run time: every tuneInterval, a worker moves from the stage with the
+ * fewest batches waiting to the one with the most, within each stage's
+ * [minWorkers, maxWorkers], or joins it while there are fewer than
+ * maxTotalWorkers.  So the slowest stage gets the threads, wherever it is
+ * and however it changes with the input.  Batches cost one queue
+ * operation per stage, whatever their size.
+ *
+ *   auto pipeline = AdaptivePipelineBuilder<std::string>()
+ *       .addStage<Record>([](std::string&& line) { return parse(line); })
+ *       .addBatchStage<Record>(
+ *           [](std::vector<Record>&& records) {
+ *             return filter(std::move(records));
+ *           })
+ *       .build();
+ *   pipeline->blockingWrite(readLines(1000));
+ *   std::vector<Record> records = pipeline->blockingRead();
+ *
+ * A stage which throws fails its batch: blockingRead() rethrows the
+ * exception, when it gets to that batch.  The stage functions are called
+ * concurrently from the workers of their stage.  Destroying the pipeline
+ * drops the batches which weren't read.
+ */
+template <class In, class Out>
+class AdaptivePipeline : public detail::AdaptivePipelineBase,
+                         private detail::AdaptivePipelineSink<Out> {
+ public:
+  ~AdaptivePipeline() {
+    stop();
+  }
+
+  /**
+   * Pushes a batch into the pipeline, once fewer than maxInFlight batches
+   * are in it.  Thread-safe; batches written concurrently are read in the
+   * order they got their place in.
+   */
+  void blockingWrite(std::vector<In> items) {
+    uint64_t seq;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      writerCv_.wait(lock, [&] { return inFlight_ < options_.maxInFlight; });
+      seq = writeSeq_++;
+      ++inFlight_;
+    }
+    head_->push(detail::AdaptivePipelineBatch<In>{seq, std::move(items), {}});
+  }
+
+  /**
+   * Pops the next batch out of the pipeline, in the order written, once
+   * it has been through every stage.  Rethrows the exception of a stage
+   * which failed it.
+   */
+  std::vector<Out> blockingRead() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    readerCv_.wait(lock, [&] { return isNextReady(); });
+    return popNext(lock);
+  }
+
+  /**
+   * Same as blockingRead(), but returns false if the next batch isn't out
+   * of the pipeline yet.
+   */
+  bool read(std::vector<Out>& items) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!isNextReady()) {
+      return false;
+    }
+    items = popNext(lock);
+    return true;
+  }
+
+  /**
+   * Batches written but not read yet.
+   */
+  size_t sizeGuess() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    return inFlight_;
+  }
+
+ private:
+  template <class, class>
+  friend class AdaptivePipelineBuilder;
+
+  using Connect = Function<detail::AdaptivePipelineSink<In>*(
+      detail::AdaptivePipelineSink<Out>*,
+      size_t,
+      std::vector<std::unique_ptr<detail::AdaptivePipelineStageBase>>&)>;
+
+  AdaptivePipeline(Connect& connect, AdaptivePipelineOptions options)
+      : detail::AdaptivePipelineBase(std::move(options)) {
+    std::vector<std::unique_ptr<detail::AdaptivePipelineStageBase>> stages;
+    head_ = connect(this, options_.maxInFlight, stages);
+    start(std::move(stages));
+  }
+
+  void push(detail::AdaptivePipelineBatch<Out>&& batch) override {
+    std::lock_guard<std::mutex> g(mutex_);
+    bool next = batch.seq == readSeq_;
+    done_.emplace(batch.seq, std::move(batch));
+    if (next) {
+      readerCv_.notify_all();
+    }
+  }
+
+  bool isNextReady() const {
+    return !done_.empty() && done_.begin()->first == readSeq_;
+  }
+
+  std::vector<Out> popNext(std::unique_lock<std::mutex>& lock) {
+    auto batch = std::move(done_.begin()->second);
+    done_.erase(done_.begin());
+    ++readSeq_;
+    --inFlight_;
+    bool nextReady = isNextReady();
+    lock.unlock();
+    writerCv_.notify_one();
+    if (nextReady) {
+      readerCv_.notify_all();
+    }
+    if (batch.error) {
+      batch.error.throw_exception();
+    }
+    return std::move(batch.items);
+  }
+
+  detail::AdaptivePipelineSink<In>* head_{nullptr};
+
+  mutable std::mutex mutex_;
+  std::condition_variable writerCv_;
+  std::condition_variable readerCv_;
+  uint64_t writeSeq_{0};
+  uint64_t readSeq_{0};
+  size_t inFlight_{0};
+  // Batches out of the last stage, waiting for the ones before them
+  std::map<uint64_t, detail::AdaptivePipelineBatch<Out>> done_;
+};
+
+/**
+ * Builds an AdaptivePipeline taking batches of In, with stages added in
+ * order; Out is the output of the last one.
+ */
+template <class In, class Out = In>
+class AdaptivePipelineBuilder {
+ public:
+  AdaptivePipelineBuilder()
+      : connect_([](detail::AdaptivePipelineSink<Out>* last,
+                    size_t,
+                    std::vector<std::unique_ptr<
+                        detail::AdaptivePipelineStageBase>>&) {
+          return last;
+        }) {
+    static_assert(
+        std::is_same<In, Out>::value,
+        "Start with AdaptivePipelineBuilder<In>");
+  }
+
+  /**
+   * Adds a stage which maps each item with fn, a Next(Out&&).
+   */
+  template <class Next, class F>
+  AdaptivePipelineBuilder<In, Next> addStage(
+      F fn,
+      AdaptivePipelineStageOptions options = {}) && {
+    return std::move(*this).template addBatchStage<Next>(
+        [fn = std::move(fn)](std::vector<Out>&& items) {
+          std::vector<Next> result;
+          result.reserve(items.size());
+          for (auto& item : items) {
+            result.push_back(fn(std::move(item)));
+          }
+          return result;
+        },
+        std::move(options));
+  }
+
+  /**
+   * Adds a stage which maps each batch with fn, a
+   * std::vector<Next>(std::vector<Out>&&), which may return any number of
+   * items.
+   */
+  template <class Next, class F>
+  AdaptivePipelineBuilder<In, Next> addBatchStage(
+      F fn,
+      AdaptivePipelineStageOptions options = {}) && {
+    if (options.name.empty()) {
+      options.name = to<std::string>("stage", numStages_);
+    }
+    using Stage = detail::AdaptivePipelineStage<Out, Next>;
+    return AdaptivePipelineBuilder<In, Next>(
+        [prev = std::move(connect_),
+         fn = typename Stage::Fn(std::move(fn)),
+         options = std::move(options)](
+            detail::AdaptivePipelineSink<Next>* last,
+            size_t capacity,
+            std::vector<std::unique_ptr<detail::AdaptivePipelineStageBase>>&
+                stages) mutable {
+          auto stage = std::make_unique<Stage>(
+              std::move(fn), std::move(options), capacity, last);
+          detail::AdaptivePipelineSink<Out>* head = stage.get();
+          auto result = prev(head, capacity, stages);
+          stages.push_back(std::move(stage));
+          return result;
+        },
+        numStages_ + 1);
+  }
+
+  std::unique_ptr<AdaptivePipeline<In, Out>> build(
+      AdaptivePipelineOptions options = {}) && {
+    return std::unique_ptr<AdaptivePipeline<In, Out>>(
+        new AdaptivePipeline<In, Out>(connect_, std::move(options)));
+  }
+
+ private:
+  template <class, class>
+  friend class AdaptivePipelineBuilder;
+
+  using Connect = typename AdaptivePipeline<In, Out>::Connect;
+
+  AdaptivePipelineBuilder(Connect connect, size_t numStages)
+      : connect_(std::move(connect)), numStages_(numStages) {}
+
+  // Creates the stages, last first, given the sink of the last one, and
+  // returns the sink of the first one
+  Connect connect_;
+  size_t numStages_{0};
+};
+
+} // namespace folly
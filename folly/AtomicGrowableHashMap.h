@@ -0,0 +1,496 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AtomicGrowableHashMap --
+ *
+ * A concurrent hash map with int32 or int64 keys, like AtomicHashMap, but
+ * which always keeps its entries in a single AtomicHashArray: when that
+ * fills up, the entries are migrated to a new array, instead of chaining
+ * further sub-maps.  find() therefore costs the same however much the map
+ * has grown, where AtomicHashMap probes each sub-map in turn, and the map
+ * has no maximum size.
+ *
+ * Erased entries (tombstones) are dropped by the migration: when an array
+ * fills up mostly with tombstones, the entries are migrated to a new array
+ * of the same size, so that erase-heavy maps reuse their slots instead of
+ * running out of them.
+ *
+ * Migration is cooperative and incremental: the writer which finds the
+ * array full freezes it, and every writer which arrives meanwhile copies
+ * chunks of kMigrationChunk cells to the new array, rather than wait for one
+ * thread to copy everything.  Writers block until the migration is done.
+ * Readers never do: find() is wait-free, as in AtomicHashArray, and keeps
+ * reading the old array, which is complete and no longer changes, until the
+ * new one replaces it.
+ *
+ * Differences from AtomicHashMap:
+ *    - ValueT must be copy constructible, as values are copied to the new
+ *      array.  Changes made through iterators into an old array after it
+ *      was migrated (e.g. to values holding atomic counters) are lost, so
+ *      update values in place only if the map never grows.
+ *    - No findAt() or iterator::getIndex(), as entries move.
+ *    - The old arrays are kept until the map is destroyed, cleared, or
+ *      reclaimRetired() is called, so that iterators and references stay
+ *      valid (if possibly stale).  Each migration doubles the array, so
+ *      those are at most the size of the current one, unless erases keep
+ *      triggering migrations to arrays of the same size.
+ *    - Config::growthFactor is the ratio of the size of the new array to
+ *      the old one, 2 by default.
+ */
+
+#pragma once
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include <folly/AtomicHashArray.h>
+#include <folly/Likely.h>
+#include <folly/ThreadCachedInt.h>
+#include <folly/detail/AtomicHashUtils.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+template <
+    class KeyT,
+    class ValueT,
+    class HashFcn = std::hash<KeyT>,
+    class EqualFcn = std::equal_to<KeyT>,
+    class Allocator = std::allocator<char>,
+    class ProbeFcn = AtomicHashArrayLinearProbeFcn,
+    class KeyConvertFcn = Identity>
+class AtomicGrowableHashMap : boost::noncopyable {
+  typedef AtomicHashArray<
+      KeyT,
+      ValueT,
+      HashFcn,
+      EqualFcn,
+      Allocator,
+      ProbeFcn,
+      KeyConvertFcn>
+      SubMap;
+
+  static_assert(
+      std::is_copy_constructible<ValueT>::value,
+      "AtomicGrowableHashMap copies values when it grows");
+
+ public:
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef std::pair<const KeyT, ValueT> value_type;
+  typedef HashFcn hasher;
+  typedef EqualFcn key_equal;
+  typedef KeyConvertFcn key_convert;
+  typedef value_type* pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef std::ptrdiff_t difference_type;
+  typedef std::size_t size_type;
+  typedef typename SubMap::Config Config;
+
+  // Cells copied at a time by each writer helping with a migration
+  static constexpr size_t kMigrationChunk = 1024;
+
+  template <class ContT, class IterVal, class SubIt>
+  struct agm_iterator;
+
+  typedef agm_iterator<
+      const AtomicGrowableHashMap,
+      const value_type,
+      typename SubMap::const_iterator>
+      const_iterator;
+  typedef agm_iterator<
+      AtomicGrowableHashMap,
+      value_type,
+      typename SubMap::iterator>
+      iterator;
+
+  // The map starts out with room for initialSizeEst entries.  See
+  // AtomicHashArray::Config for the other options.
+  explicit AtomicGrowableHashMap(
+      size_t initialSizeEst,
+      const Config& config = Config())
+      : config_(config),
+        growthFactor_(config.growthFactor < 0 ? 2.0 : config.growthFactor) {
+    CHECK(config.maxLoadFactor > 0.0 && config.maxLoadFactor < 1.0);
+    CHECK_GT(growthFactor_, 1.0);
+    current_.store(
+        new Table(SubMap::create(initialSizeEst, config_), nullptr),
+        std::memory_order_relaxed);
+  }
+
+  ~AtomicGrowableHashMap() {
+    destroyTables(current_.load(std::memory_order_relaxed));
+  }
+
+  /*
+   * insert --
+   *
+   *   Returns a pair with an iterator to the entry with the key, and
+   *   whether it was inserted (false if the key was already there).  Never
+   *   fails for lack of room: if the array is full, the map grows first.
+   */
+  std::pair<iterator, bool> insert(const value_type& r) {
+    return emplace(r.first, r.second);
+  }
+  std::pair<iterator, bool> insert(key_type k, const mapped_type& v) {
+    return emplace(k, v);
+  }
+  std::pair<iterator, bool> insert(value_type&& r) {
+    return emplace(r.first, std::move(r.second));
+  }
+  std::pair<iterator, bool> insert(key_type k, mapped_type&& v) {
+    return emplace(k, std::move(v));
+  }
+
+  /*
+   * emplace --
+   *
+   *   Same as insert(), but constructs the value in place from vCtorArgs,
+   *   and accepts a key of another type, as AtomicHashArray::emplace().
+   *   vCtorArgs are only consumed if the entry is inserted.
+   */
+  template <
+      typename LookupKeyT = key_type,
+      typename LookupHashFcn = hasher,
+      typename LookupEqualFcn = key_equal,
+      typename LookupKeyToKeyFcn = key_convert,
+      typename... ArgTs>
+  std::pair<iterator, bool> emplace(LookupKeyT k, ArgTs&&... vCtorArgs) {
+    for (;;) {
+      Table* table = current_.load(std::memory_order_acquire);
+      if (enterWriter(table)) {
+        auto ret = table->array->template emplace<
+            LookupKeyT,
+            LookupHashFcn,
+            LookupEqualFcn,
+            LookupKeyToKeyFcn>(k, std::forward<ArgTs>(vCtorArgs)...);
+        leaveWriter(table);
+        if (ret.second || ret.first != table->array->end()) {
+          return std::make_pair(
+              iterator(ret.first, table->array->end()), ret.second);
+        }
+        // The array is full (counting tombstones), and nothing was
+        // constructed from vCtorArgs
+      }
+      migrate(table);
+    }
+  }
+
+  /*
+   * find --
+   *
+   *   Returns the iterator to the element if found, otherwise end().
+   *   Wait-free, even while the map grows.  See AtomicHashArray::find()
+   *   for LookupKeyT.
+   */
+  template <
+      typename LookupKeyT = key_type,
+      typename LookupHashFcn = hasher,
+      typename LookupEqualFcn = key_equal>
+  iterator find(LookupKeyT k) {
+    SubMap* array = current_.load(std::memory_order_acquire)->array.get();
+    return iterator(
+        array->template find<LookupKeyT, LookupHashFcn, LookupEqualFcn>(k),
+        array->end());
+  }
+
+  template <
+      typename LookupKeyT = key_type,
+      typename LookupHashFcn = hasher,
+      typename LookupEqualFcn = key_equal>
+  const_iterator find(LookupKeyT k) const {
+    const SubMap* array =
+        current_.load(std::memory_order_acquire)->array.get();
+    return const_iterator(
+        array->template find<LookupKeyT, LookupHashFcn, LookupEqualFcn>(k),
+        array->end());
+  }
+
+  size_type count(key_type k) const {
+    return find(k) == end() ? 0 : 1;
+  }
+
+  /*
+   * erase --
+   *
+   *   Returns 1 iff the key was found and erased.  The slot is reused once
+   *   the map migrates to a new array.
+   */
+  size_type erase(key_type k) {
+    for (;;) {
+      Table* table = current_.load(std::memory_order_acquire);
+      if (enterWriter(table)) {
+        size_type ret = table->array->erase(k);
+        leaveWriter(table);
+        return ret;
+      }
+      migrate(table);
+    }
+  }
+
+  /*
+   * clear --
+   *
+   *   Erases everything, keeping the current array.  Not thread safe.
+   */
+  void clear() {
+    reclaimRetired();
+    current_.load(std::memory_order_relaxed)->array->clear();
+  }
+
+  /*
+   * reclaimRetired --
+   *
+   *   Frees the arrays the map migrated from.  Not thread safe, and
+   *   invalidates iterators and references obtained before the last
+   *   migration.
+   */
+  void reclaimRetired() {
+    Table* table = current_.load(std::memory_order_relaxed);
+    destroyTables(table->prev);
+    table->prev = nullptr;
+  }
+
+  // Exact number of elements in the map.  Acquires a mutex, see
+  // AtomicHashArray::size().
+  size_t size() const {
+    return current_.load(std::memory_order_acquire)->array->size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // The number of cells in the current array
+  size_t capacity() const {
+    return current_.load(std::memory_order_acquire)->array->capacity_;
+  }
+
+  // The number of migrations so far, to a larger array or not
+  size_t numMigrations() const {
+    return numMigrations_.load(std::memory_order_relaxed);
+  }
+
+  // Iterates over the array which is current when begin() is called.
+  // Entries inserted after the map migrated from it aren't seen.
+  iterator begin() {
+    SubMap* array = current_.load(std::memory_order_acquire)->array.get();
+    return iterator(array->begin(), array->end());
+  }
+  const_iterator begin() const {
+    const SubMap* array =
+        current_.load(std::memory_order_acquire)->array.get();
+    return const_iterator(array->begin(), array->end());
+  }
+
+  iterator end() {
+    return iterator();
+  }
+  const_iterator end() const {
+    return const_iterator();
+  }
+
+ private:
+  struct Table {
+    Table(typename SubMap::SmartPtr a, Table* p)
+        : array(std::move(a)),
+          prev(p),
+          writers(0, array->getEntryCountThreadCacheSize()) {}
+
+    typename SubMap::SmartPtr array;
+    // The table this one replaced, if not reclaimed yet
+    Table* prev;
+    // Writers in the array.  Thread-cached, as it changes on every write
+    // but is only read to migrate.
+    ThreadCachedInt<int64_t> writers;
+    // Set once the array is full, after which no writer enters it
+    std::atomic<bool> frozen{false};
+    std::atomic<bool> migrating{false};
+    // The table the entries are migrated to, set once no writer is left
+    std::atomic<Table*> next{nullptr};
+    // Cells claimed and copied by the writers helping with the migration
+    std::atomic<size_t> claimed{0};
+    std::atomic<size_t> copied{0};
+  };
+
+  // Same protocol as AtomicHashArray's isFull_ and numPendingEntries_: a
+  // writer either sees the table frozen, or is waited for by migrate()
+  bool enterWriter(Table* table) {
+    ++table->writers;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (UNLIKELY(table->frozen.load(std::memory_order_relaxed))) {
+      --table->writers;
+      return false;
+    }
+    return true;
+  }
+
+  void leaveWriter(Table* table) {
+    --table->writers;
+  }
+
+  // Moves the entries of table to a new table, and makes it current.
+  // Returns once it is.
+  void migrate(Table* table) {
+    Table* next = table->next.load(std::memory_order_acquire);
+    if (!next) {
+      bool expected = false;
+      if (table->migrating.compare_exchange_strong(expected, true)) {
+        table->frozen.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        detail::atomic_hash_spin_wait(
+            [&] { return table->writers.readFull() != 0; });
+        next = new Table(
+            SubMap::create(nextMaxSize(*table->array), config_), table);
+        table->next.store(next, std::memory_order_release);
+      } else {
+        detail::atomic_hash_spin_wait([&] {
+          next = table->next.load(std::memory_order_acquire);
+          return next == nullptr;
+        });
+      }
+    }
+
+    SubMap* from = table->array.get();
+    SubMap* to = next->array.get();
+    for (;;) {
+      size_t begin =
+          table->claimed.fetch_add(kMigrationChunk, std::memory_order_relaxed);
+      if (begin >= from->capacity_) {
+        break;
+      }
+      size_t end = std::min(begin + kMigrationChunk, from->capacity_);
+      for (size_t i = begin; i < end; ++i) {
+        const value_type& cell = *from->makeIter(i);
+        // No writer is left, so plain reads of the keys are fine
+        if (cell.first != from->kEmptyKey_ &&
+            cell.first != from->kErasedKey_) {
+          DCHECK(cell.first != from->kLockedKey_);
+          auto ret = to->emplace(cell.first, cell.second);
+          CHECK(ret.second);
+        }
+      }
+      table->copied.fetch_add(end - begin, std::memory_order_release);
+    }
+    detail::atomic_hash_spin_wait([&] {
+      return table->copied.load(std::memory_order_acquire) <
+          from->capacity_;
+    });
+
+    Table* expected = table;
+    if (current_.compare_exchange_strong(expected, next)) {
+      numMigrations_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Grows the array, unless at least half of it is tombstones, in which
+  // case dropping them leaves enough room
+  size_t nextMaxSize(const SubMap& array) const {
+    size_t live = array.size();
+    if (live * 2 < array.maxEntries_) {
+      return array.maxEntries_;
+    }
+    return size_t(double(array.maxEntries_) * growthFactor_);
+  }
+
+  static void destroyTables(Table* table) {
+    while (table) {
+      Table* prev = table->prev;
+      delete table;
+      table = prev;
+    }
+  }
+
+  const Config config_;
+  const double growthFactor_;
+  std::atomic<Table*> current_;
+  std::atomic<size_t> numMigrations_{0};
+};
+
+template <
+    class KeyT,
+    class ValueT,
+    class HashFcn,
+    class EqualFcn,
+    class Allocator,
+    class ProbeFcn,
+    class KeyConvertFcn>
+template <class ContT, class IterVal, class SubIt>
+struct AtomicGrowableHashMap<
+    KeyT,
+    ValueT,
+    HashFcn,
+    EqualFcn,
+    Allocator,
+    ProbeFcn,
+    KeyConvertFcn>::agm_iterator
+    : boost::iterator_facade<
+          agm_iterator<ContT, IterVal, SubIt>,
+          IterVal,
+          boost::forward_traversal_tag> {
+  // The end iterator
+  agm_iterator() : isEnd_(true) {}
+
+  // Conversion ctor for interoperability between const_iterator and
+  // iterator, as in AtomicHashMap.
+  template <class OtherContT, class OtherVal, class OtherSubIt>
+  agm_iterator(
+      const agm_iterator<OtherContT, OtherVal, OtherSubIt>& o,
+      typename std::enable_if<
+          std::is_convertible<OtherSubIt, SubIt>::value>::type* = nullptr)
+      : subIt_(o.subIt_), subEnd_(o.subEnd_), isEnd_(o.isEnd_) {}
+
+ private:
+  friend class AtomicGrowableHashMap;
+  template <class, class, class>
+  friend struct agm_iterator;
+  friend class boost::iterator_core_access;
+
+  agm_iterator(const SubIt& subIt, const SubIt& subEnd)
+      : subIt_(subIt), subEnd_(subEnd), isEnd_(subIt == subEnd) {}
+
+  void increment() {
+    DCHECK(!isEnd_);
+    ++subIt_;
+    isEnd_ = subIt_ == subEnd_;
+  }
+
+  bool equal(const agm_iterator& other) const {
+    if (isEnd_ || other.isEnd_) {
+      return isEnd_ == other.isEnd_;
+    }
+    return subIt_ == other.subIt_;
+  }
+
+  IterVal& dereference() const {
+    return *subIt_;
+  }
+
+  SubIt subIt_;
+  SubIt subEnd_;
+  bool isEnd_;
+};
+
+} // namespace folly
@@ -20,8 +20,10 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
+#include <cstring>
 #include <stdexcept>
 #include <system_error>
+#include <thread>
 #include <type_traits>
 
 #include <boost/type_traits/has_trivial_destructor.hpp>
@@ -30,8 +32,10 @@
 #include <folly/Conv.h>
 #include <folly/Likely.h>
 #include <folly/Random.h>
+#include <folly/Range.h>
 #include <folly/detail/AtomicUnorderedMapUtils.h>
 #include <folly/portability/SysMman.h>
+#include <folly/portability/TypeTraits.h>
 #include <folly/portability/Unistd.h>
 
 namespace folly {
@@ -129,6 +133,28 @@ namespace folly {
 /// which is much faster than destructing all of the keys and values.
 /// Feel free to override if std::is_trivial_destructor isn't recognizing
 /// the triviality of your destructors.
+///
+/// SHARED MEMORY
+///
+/// Links between slots are indexes rather than pointers, so the table can
+/// also live in memory shared by several processes, which then share one
+/// map, and in a file, which keeps the map across restarts: pass the
+/// memory of a shared, writable MemoryMapping instead of a maxSize.
+///
+///   MemoryMapping mapping(
+///       "/dev/shm/cache",  // or a file on disk, to survive reboots
+///       0,
+///       Map::sharedMemorySize(maxSize),
+///       MemoryMapping::writable().setShared(true));
+///   Map map(mapping.writableRange(), maxSize);
+///
+/// The first process to construct a map in the memory initializes it; the
+/// others, and later runs, attach to it.  Keys and values must then be
+/// trivially copyable and contain no pointers, Hash must give the same
+/// results in every process (no per-process seed), and Atom must be
+/// std::atomic.  A process which dies in the middle of findOrConstruct
+/// may leak a slot, but doesn't corrupt the map; one which dies while
+/// initializing it leaves the others waiting, so remove the file then.
 template <
     typename Key,
     typename Value,
@@ -213,18 +239,7 @@ struct AtomicUnorderedInsertMap {
       const Allocator& alloc = Allocator())
     : allocator_(alloc)
   {
-    size_t capacity = size_t(maxSize / std::min(1.0f, maxLoadFactor) + 128);
-    size_t avail = size_t{1} << (8 * sizeof(IndexType) - 2);
-    if (capacity > avail && maxSize < avail) {
-      // we'll do our best
-      capacity = avail;
-    }
-    if (capacity < maxSize || capacity > avail) {
-      throw std::invalid_argument(
-          "AtomicUnorderedInsertMap capacity must fit in IndexType with 2 bits "
-          "left over");
-    }
-
+    size_t capacity = computeCapacity(maxSize, maxLoadFactor);
     numSlots_ = capacity;
     slotMask_ = folly::nextPowTwo(capacity * 4) - 1;
     mmapRequested_ = sizeof(Slot) * capacity;
@@ -235,7 +250,73 @@ struct AtomicUnorderedInsertMap {
     slots_[0].stateUpdate(EMPTY, CONSTRUCTING);
   }
 
+  /// Constructs a map for maxSize key-value pairs in memory, which may be
+  /// shared with other processes (see SHARED MEMORY above), or attaches to
+  /// the map already there.  memory must hold sharedMemorySize(maxSize,
+  /// maxLoadFactor) bytes, be aligned to a page, and be zero-filled the
+  /// first time, as a new file or shm segment is.  Throws
+  /// invalid_argument if it's too small, or holds a map built for another
+  /// maxSize, maxLoadFactor, or key and value types.  The memory must
+  /// outlive the map, and isn't freed by it.
+  AtomicUnorderedInsertMap(
+      MutableByteRange memory,
+      size_t maxSize,
+      float maxLoadFactor = 0.8f)
+    : shared_(true)
+  {
+    static_assert(
+        FOLLY_IS_TRIVIALLY_COPYABLE(Key) &&
+            FOLLY_IS_TRIVIALLY_COPYABLE(Value),
+        "Keys and values in shared memory must be trivially copyable");
+    static_assert(
+        std::is_same<Atom<IndexType>, std::atomic<IndexType>>::value,
+        "Maps in shared memory need std::atomic");
+    static_assert(
+        sizeof(SharedHeader) <= kSharedHeaderSize &&
+            alignof(Slot) <= kSharedHeaderSize,
+        "Slots would overlap the header");
+
+    size_t capacity = computeCapacity(maxSize, maxLoadFactor);
+    if (memory.size() < sharedMemorySize(maxSize, maxLoadFactor)) {
+      throw std::invalid_argument(
+          "AtomicUnorderedInsertMap shared memory is too small");
+    }
+    numSlots_ = capacity;
+    slotMask_ = folly::nextPowTwo(capacity * 4) - 1;
+    mmapRequested_ = sizeof(Slot) * capacity;
+    slots_ = reinterpret_cast<Slot*>(memory.begin() + kSharedHeaderSize);
+
+    auto header = reinterpret_cast<SharedHeader*>(memory.begin());
+    uint32_t state = kSharedEmpty;
+    if (header->state.compare_exchange_strong(state, kSharedInitializing)) {
+      header->magic = kSharedMagic;
+      header->slotSize = sizeof(Slot);
+      header->numSlots = numSlots_;
+      slots_[0].stateUpdate(EMPTY, CONSTRUCTING);
+      header->state.store(kSharedReady, std::memory_order_release);
+    } else {
+      while (header->state.load(std::memory_order_acquire) != kSharedReady) {
+        std::this_thread::yield();
+      }
+    }
+    if (header->magic != kSharedMagic || header->slotSize != sizeof(Slot) ||
+        header->numSlots != numSlots_) {
+      throw std::invalid_argument(
+          "AtomicUnorderedInsertMap shared memory holds an incompatible map");
+    }
+  }
+
+  /// The number of bytes of shared memory needed for a map for maxSize
+  /// key-value pairs.
+  static size_t sharedMemorySize(size_t maxSize, float maxLoadFactor = 0.8f) {
+    return kSharedHeaderSize +
+        sizeof(Slot) * computeCapacity(maxSize, maxLoadFactor);
+  }
+
   ~AtomicUnorderedInsertMap() {
+    if (shared_) {
+      return;
+    }
     if (!SkipKeyValueDeletion) {
       for (size_t i = 1; i < numSlots_; ++i) {
         slots_[i].~Slot();
@@ -401,9 +482,44 @@ struct AtomicUnorderedInsertMap {
 
   };
 
+  /// Starts memory shared between processes.  Zero-filled memory is
+  /// kSharedEmpty.
+  struct SharedHeader {
+    std::atomic<uint32_t> state;
+    uint32_t slotSize;
+    uint64_t magic;
+    uint64_t numSlots;
+  };
+
+  enum : uint32_t {
+    kSharedEmpty = 0,
+    kSharedInitializing = 1,
+    kSharedReady = 2,
+  };
+
+  // Bump when the layout of SharedHeader or Slot changes
+  static constexpr uint64_t kSharedMagic = 0x41554d5348310001; // AUMSH1
+  static constexpr size_t kSharedHeaderSize = 64;
+
+  static size_t computeCapacity(size_t maxSize, float maxLoadFactor) {
+    size_t capacity = size_t(maxSize / std::min(1.0f, maxLoadFactor) + 128);
+    size_t avail = size_t{1} << (8 * sizeof(IndexType) - 2);
+    if (capacity > avail && maxSize < avail) {
+      // we'll do our best
+      capacity = avail;
+    }
+    if (capacity < maxSize || capacity > avail) {
+      throw std::invalid_argument(
+          "AtomicUnorderedInsertMap capacity must fit in IndexType with 2 bits "
+          "left over");
+    }
+    return capacity;
+  }
+
   // We manually manage the slot memory so we can bypass initialization
   // (by getting a zero-filled mmap chunk) and optionally destruction of
-  // the slots
+  // the slots.  Shared memory is neither allocated nor freed by the map.
+  bool shared_{false};
 
   size_t mmapRequested_;
   size_t numSlots_;
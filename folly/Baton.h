@@ -200,16 +200,27 @@ struct Baton {
   /// but by making this condition very restrictive we can provide better
   /// checking in debug builds.
   void wait() {
-    if (spinWaitForEarlyDelivery()) {
+    waitWithSpins(PreBlockAttempts);
+  }
+
+  /// Same as wait(), but spins at most maxSpins times (instead of
+  /// PreBlockAttempts) waiting for an early delivery before blocking.
+  /// Returns the number of spins after which the post was seen, or
+  /// maxSpins if it wasn't seen while spinning.  Callers that know more
+  /// about the expected handoff latency (e.g. LifoSem, which measures
+  /// it) can use this to tune spinning.
+  uint32_t waitWithSpins(uint32_t maxSpins) {
+    auto spins = spinWaitForEarlyDelivery(maxSpins);
+    if (spins < maxSpins) {
       assert(state_.load(std::memory_order_acquire) == EARLY_DELIVERY);
-      return;
+      return spins;
     }
 
     if (!Blocking) {
       while (!try_wait()) {
         std::this_thread::yield();
       }
-      return;
+      return maxSpins;
     }
 
     // guess we have to block :(
@@ -217,7 +228,7 @@ struct Baton {
     if (!state_.compare_exchange_strong(expected, WAITING)) {
       // CAS failed, last minute reprieve
       assert(expected == EARLY_DELIVERY);
-      return;
+      return maxSpins;
     }
 
     while (true) {
@@ -244,7 +255,7 @@ struct Baton {
       assert(s == WAITING || s == LATE_DELIVERY);
 
       if (s == LATE_DELIVERY) {
-        return;
+        return maxSpins;
       }
       // retry
     }
@@ -264,7 +275,7 @@ struct Baton {
   bool timed_wait(const std::chrono::time_point<Clock,Duration>& deadline) {
     static_assert(Blocking, "Non-blocking Baton does not support timed wait.");
 
-    if (spinWaitForEarlyDelivery()) {
+    if (spinWaitForEarlyDelivery(PreBlockAttempts) < PreBlockAttempts) {
       assert(state_.load(std::memory_order_acquire) == EARLY_DELIVERY);
       return true;
     }
@@ -345,17 +356,18 @@ struct Baton {
   // Spin for "some time" (see discussion on PreBlockAttempts) waiting
   // for a post.
   //
-  // @return       true if we received an early delivery during the wait,
-  //               false otherwise. If the function returns true then
-  //               state_ is guaranteed to be EARLY_DELIVERY
-  bool spinWaitForEarlyDelivery() {
+  // @return       the number of spins after which we received an early
+  //               delivery, maxSpins if we didn't.  If the function returns
+  //               less than maxSpins then state_ is guaranteed to be
+  //               EARLY_DELIVERY
+  uint32_t spinWaitForEarlyDelivery(uint32_t maxSpins) {
 
     static_assert(PreBlockAttempts > 0,
         "isn't this assert clearer than an uninitialized variable warning?");
-    for (int i = 0; i < PreBlockAttempts; ++i) {
+    for (uint32_t i = 0; i < maxSpins; ++i) {
       if (try_wait()) {
         // hooray!
-        return true;
+        return i;
       }
       // The pause instruction is the polite way to spin, but it doesn't
       // actually affect correctness to omit it if we don't have it.
@@ -364,7 +376,7 @@ struct Baton {
       asm_volatile_pause();
     }
 
-    return false;
+    return maxSpins;
   }
 
   detail::Futex<Atom> state_;
@@ -19,22 +19,33 @@
 #include <folly/Benchmark.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <memory>
+#include <numeric>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <boost/regex.hpp>
 
 #include <folly/MapUtil.h>
+#include <folly/Optional.h>
 #include <folly/String.h>
 #include <folly/container/Foreach.h>
 #include <folly/json.h>
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 DEFINE_bool(benchmark, false, "Run benchmarks.");
@@ -66,6 +77,20 @@ DEFINE_int32(
     1,
     "Maximum # of seconds we'll spend on each benchmark.");
 
+DEFINE_string(
+    bm_counters,
+    "",
+    "Comma-separated performance counters to report per iteration (Linux "
+    "only): cycles, instructions, ipc, branches, branch-misses, l1d-misses, "
+    "llc-misses, page-faults, context-switches.");
+
+DEFINE_int32(
+    bm_repetitions,
+    1,
+    "Number of times to measure each benchmark. With more than 1, the time "
+    "is the mean of the measurements, less the outliers, and the 95% "
+    "confidence interval and the number of measurements kept are reported.");
+
 namespace folly {
 
 std::chrono::high_resolution_clock::duration BenchmarkSuspender::timeSpent;
@@ -109,6 +134,260 @@ void detail::addBenchmarkImpl(const char* file, const char* name,
   benchmarks().push_back({file, name, std::move(fun)});
 }
 
+/**
+ * Runs body on the given number of threads, splitting the iterations
+ * between them, from the time they're all started until the last is done.
+ */
+static detail::TimeIterPair runOnThreads(
+    const std::function<unsigned int(unsigned int)>& body,
+    unsigned int threads,
+    unsigned int times) {
+  using Clock = std::chrono::high_resolution_clock;
+  std::atomic<unsigned int> ready{0};
+  std::atomic<bool> go{false};
+  vector<Clock::time_point> ends(threads);
+  vector<unsigned int> niters(threads);
+
+  vector<std::thread> workers;
+  workers.reserve(threads);
+  for (unsigned int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      unsigned int n = times / threads + (t < times % threads ? 1 : 0);
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      niters[t] = body(n);
+      ends[t] = Clock::now();
+    });
+  }
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+
+  // CORE MEASUREMENT STARTS
+  auto start = Clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  // CORE MEASUREMENT ENDS
+
+  auto end = *std::max_element(ends.begin(), ends.end());
+  unsigned int niter = 0;
+  for (auto n : niters) {
+    niter += n;
+  }
+  return detail::TimeIterPair(end - start, niter);
+}
+
+void detail::addThreadedBenchmarkImpl(
+    const char* file,
+    const char* name,
+    unsigned int maxThreads,
+    std::function<unsigned int(unsigned int)> body) {
+  CHECK_GT(maxThreads, 0u);
+  // 1 thread is the baseline of the others
+  for (unsigned int threads = 1;; threads *= 2) {
+    threads = std::min(threads, maxThreads);
+    auto threadsName = to<string>(
+        threads == 1 ? "" : "%",
+        name,
+        "(",
+        threads,
+        threads == 1 ? " thread)" : " threads)");
+    benchmarks().push_back(
+        {file,
+         threadsName,
+         [body, threads](unsigned int times) {
+           return runOnThreads(body, threads, times);
+         },
+         threads});
+    if (threads == maxThreads) {
+      break;
+    }
+  }
+}
+
+namespace {
+
+/**
+ * A group of perf_event_open(2) counters of this thread, in user space.
+ * Events that can't be counted (unknown to the kernel, no PMU, not
+ * permitted...) are left out with a warning.
+ */
+class PerfCounters {
+ public:
+  explicit PerfCounters(const vector<string>& events);
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // The events counted
+  const vector<string>& events() const {
+    return events_;
+  }
+
+  // Resets the counts to 0, and starts counting
+  void start();
+  void stop();
+  // Since the last start(), scaled if the kernel multiplexed the counters
+  vector<double> read() const;
+
+  void pause();
+  void resume();
+
+ private:
+  vector<string> events_;
+  vector<int> fds_;
+  unsigned int pauses_{0};
+};
+
+#ifdef __linux__
+struct EventInfo {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t cacheReadMisses(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+const EventInfo kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"l1d-misses",
+     PERF_TYPE_HW_CACHE,
+     cacheReadMisses(PERF_COUNT_HW_CACHE_L1D)},
+    {"llc-misses", PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_LL)},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+PerfCounters::PerfCounters(const vector<string>& events) {
+  for (auto& event : events) {
+    auto info = std::find_if(
+        std::begin(kEvents), std::end(kEvents), [&](const EventInfo& e) {
+          return event == e.name;
+        });
+    CHECK(info != std::end(kEvents)) << "Unknown counter: " << event;
+
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = info->type;
+    attr.config = info->config;
+    attr.disabled = fds_.empty();
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+    int leader = fds_.empty() ? -1 : fds_.front();
+    int fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+    if (fd < 0) {
+      LOG(WARNING) << "Cannot count " << event << ": " << errnoStr(errno);
+      continue;
+    }
+    events_.push_back(event);
+    fds_.push_back(fd);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : fds_) {
+    close(fd);
+  }
+}
+
+void PerfCounters::start() {
+  if (!fds_.empty()) {
+    pauses_ = 0;
+    ioctl(fds_.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::stop() {
+  if (!fds_.empty()) {
+    ioctl(fds_.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::pause() {
+  if (!fds_.empty() && pauses_++ == 0) {
+    ioctl(fds_.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::resume() {
+  if (!fds_.empty() && pauses_ > 0 && --pauses_ == 0) {
+    ioctl(fds_.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+vector<double> PerfCounters::read() const {
+  vector<double> result(fds_.size(), 0.0);
+  if (fds_.empty()) {
+    return result;
+  }
+  // nr, time_enabled, time_running, then the values
+  vector<uint64_t> buffer(3 + fds_.size());
+  auto bytes = ::read(
+      fds_.front(), buffer.data(), buffer.size() * sizeof(buffer.front()));
+  if (bytes < ssize_t(buffer.size() * sizeof(buffer.front())) ||
+      buffer[2] == 0) {
+    return result;
+  }
+  double scale = double(buffer[1]) / double(buffer[2]);
+  for (size_t i = 0; i < fds_.size(); ++i) {
+    result[i] = double(buffer[3 + i]) * scale;
+  }
+  return result;
+}
+#else
+PerfCounters::PerfCounters(const vector<string>& events) {
+  if (!events.empty()) {
+    LOG(WARNING) << "--bm_counters is only supported on Linux";
+  }
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+void PerfCounters::pause() {}
+
+void PerfCounters::resume() {}
+
+vector<double> PerfCounters::read() const {
+  return vector<double>();
+}
+#endif
+
+// The counters of the benchmark being measured, if any
+PerfCounters* activeCounters = nullptr;
+
+} // namespace
+
+void detail::pauseBenchmarkCounters() {
+  if (activeCounters) {
+    activeCounters->pause();
+  }
+}
+
+void detail::resumeBenchmarkCounters() {
+  if (activeCounters) {
+    activeCounters->resume();
+  }
+}
+
 /**
  * Given a bunch of benchmark samples, estimate the actual run time.
  */
@@ -120,8 +399,17 @@ static double estimateTime(double * begin, double * end) {
   return *min_element(begin, end);
 }
 
-static double runBenchmarkGetNSPerIteration(const BenchmarkFun& fun,
-                                            const double globalBaseline) {
+/**
+ * Returns the time per iteration, less that of the baseline.  With
+ * counters, also sets *counts to the counts per iteration, less those of
+ * the baseline, in the epoch of that time.
+ */
+static double runBenchmarkGetNSPerIteration(
+    const BenchmarkFun& fun,
+    const double globalBaseline,
+    PerfCounters* counters = nullptr,
+    const vector<double>& baselineCounts = {},
+    vector<double>* counts = nullptr) {
   using std::chrono::duration_cast;
   using std::chrono::high_resolution_clock;
   using std::chrono::microseconds;
@@ -150,11 +438,23 @@ static double runBenchmarkGetNSPerIteration(const BenchmarkFun& fun,
 
   double epochResults[epochs] = { 0 };
   size_t actualEpochs = 0;
+  double bestEpochResult = numeric_limits<double>::max();
+
+  activeCounters = counters;
+  SCOPE_EXIT {
+    activeCounters = nullptr;
+  };
 
   for (; actualEpochs < epochs; ++actualEpochs) {
     const auto maxIters = uint32_t(FLAGS_bm_max_iters);
     for (auto n = uint32_t(FLAGS_bm_min_iters); n < maxIters; n *= 2) {
+      if (counters) {
+        counters->start();
+      }
       auto const nsecsAndIter = fun(static_cast<unsigned int>(n));
+      if (counters) {
+        counters->stop();
+      }
       if (nsecsAndIter.first < minNanoseconds) {
         continue;
       }
@@ -163,6 +463,15 @@ static double runBenchmarkGetNSPerIteration(const BenchmarkFun& fun,
       auto nsecs = duration_cast<nanoseconds>(nsecsAndIter.first).count();
       epochResults[actualEpochs] =
           max(0.0, double(nsecs) / nsecsAndIter.second - globalBaseline);
+      if (counters && epochResults[actualEpochs] < bestEpochResult) {
+        bestEpochResult = epochResults[actualEpochs];
+        *counts = counters->read();
+        for (size_t i = 0; i < counts->size(); ++i) {
+          double baseline = i < baselineCounts.size() ? baselineCounts[i] : 0;
+          (*counts)[i] =
+              max(0.0, (*counts)[i] / nsecsAndIter.second - baseline);
+        }
+      }
       // Done with the current epoch, we got a meaningful timing.
       break;
     }
@@ -179,6 +488,84 @@ static double runBenchmarkGetNSPerIteration(const BenchmarkFun& fun,
   return max(0.0, estimateTime(epochResults, epochResults + actualEpochs));
 }
 
+/**
+ * The critical value of Student's t distribution for a two-sided 95%
+ * confidence interval with the given degrees of freedom.
+ */
+static double studentT95(double degreesOfFreedom) {
+  static const double kTable[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+  constexpr size_t kTableSize = sizeof(kTable) / sizeof(kTable[0]);
+  if (degreesOfFreedom < 1) {
+    return kTable[0];
+  }
+  // Rounding down errs on the wide side
+  auto df = size_t(degreesOfFreedom);
+  return df <= kTableSize ? kTable[df - 1] : 1.96;
+}
+
+namespace {
+
+struct TimeSummary {
+  double mean;
+  // The half width of the 95% confidence interval of the mean
+  double ci95;
+  size_t samples;
+};
+
+} // namespace
+
+/**
+ * Summarizes repeated measurements of a benchmark, leaving out those more
+ * than 3 (normal-equivalent) median absolute deviations from the median:
+ * interference makes measurements slower than they should be, never
+ * faster.
+ */
+static TimeSummary summarizeTimes(vector<double> times) {
+  assert(!times.empty());
+  auto median = [](vector<double> v) {
+    auto mid = v.begin() + v.size() / 2;
+    std::nth_element(v.begin(), mid, v.end());
+    if (v.size() % 2 == 1) {
+      return *mid;
+    }
+    return (*mid + *std::max_element(v.begin(), mid)) / 2;
+  };
+  double center = median(times);
+  vector<double> deviations;
+  for (auto time : times) {
+    deviations.push_back(std::abs(time - center));
+  }
+  double mad = 1.4826 * median(deviations);
+  if (mad > 0) {
+    times.erase(
+        std::remove_if(
+            times.begin(),
+            times.end(),
+            [&](double time) { return std::abs(time - center) > 3 * mad; }),
+        times.end());
+  }
+
+  TimeSummary summary;
+  summary.samples = times.size();
+  summary.mean =
+      std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+  summary.ci95 = 0.0;
+  if (times.size() > 1) {
+    double squares = 0.0;
+    for (auto time : times) {
+      squares += (time - summary.mean) * (time - summary.mean);
+    }
+    double stddev = std::sqrt(squares / (times.size() - 1));
+    summary.ci95 =
+        studentT95(times.size() - 1) * stddev / std::sqrt(times.size());
+  }
+  return summary;
+}
+
 struct ScaleInfo {
   double boundary;
   const char* suffix;
@@ -255,16 +642,57 @@ static void printBenchmarkResultsAsTable(
     longestName = max(longestName, bm.name.size());
   }
 
+  // The columns of the counters of all benchmarks, as wide as their names
+  vector<string> counterNames;
+  for (auto& datum : data) {
+    for (auto& counter : datum.counters) {
+      if (std::find(counterNames.begin(), counterNames.end(), counter.first) ==
+          counterNames.end()) {
+        counterNames.push_back(counter.first);
+      }
+    }
+  }
+  size_t counterColumns = 0;
+  for (auto& name : counterNames) {
+    counterColumns += 2 + max<size_t>(name.size(), 7);
+  }
+  auto printCounters = [&](const detail::BenchmarkResult& datum) {
+    for (auto& name : counterNames) {
+      int width = int(max<size_t>(name.size(), 7));
+      auto counter = std::find_if(
+          datum.counters.begin(),
+          datum.counters.end(),
+          [&](const pair<string, double>& c) { return c.first == name; });
+      if (counter == datum.counters.end()) {
+        printf("  %*s", width, "-");
+      } else if (name == "efficiency" || name == "ci95") {
+        printf("  %*.1f%%", width - 1, counter->second * 100.0);
+      } else if (name == "samples") {
+        printf("  %*.0f", width, counter->second);
+      } else if (counter->second == 0) {
+        printf("  %*s", width, "0");
+      } else if (name == "ipc") {
+        printf("  %*.2f", width, counter->second);
+      } else {
+        printf("  %*s", width, metricReadable(counter->second, 2).c_str());
+      }
+    }
+    printf("\n");
+  };
+
   // Print a horizontal rule
   auto separator = [&](char pad) {
-    puts(string(columns, pad).c_str());
+    puts(string(columns + counterColumns, pad).c_str());
   };
 
   // Print header for a file
   auto header = [&](const string& file) {
     separator('=');
-    printf("%-*srelative  time/iter  iters/s\n",
-           columns - 28, file.c_str());
+    printf("%-*srelative  time/iter  iters/s", columns - 28, file.c_str());
+    for (auto& name : counterNames) {
+      printf("  %*s", int(max<size_t>(name.size(), 7)), name.c_str());
+    }
+    printf("\n");
     separator('=');
   };
 
@@ -300,19 +728,20 @@ static void printBenchmarkResultsAsTable(
                            : (1 / secPerIter);
     if (!useBaseline) {
       // Print without baseline
-      printf("%*s           %9s  %7s\n",
+      printf("%*s           %9s  %7s",
              static_cast<int>(s.size()), s.c_str(),
              readableTime(secPerIter, 2).c_str(),
              metricReadable(itersPerSec, 2).c_str());
     } else {
       // Print with baseline
       auto rel = baselineNsPerIter / nsPerIter * 100.0;
-      printf("%*s %7.2f%%  %9s  %7s\n",
+      printf("%*s %7.2f%%  %9s  %7s",
              static_cast<int>(s.size()), s.c_str(),
              rel,
              readableTime(secPerIter, 2).c_str(),
              metricReadable(itersPerSec, 2).c_str());
     }
+    printCounters(datum);
   }
   separator('=');
 }
@@ -321,7 +750,16 @@ static void printBenchmarkResultsAsJson(
     const vector<detail::BenchmarkResult>& data) {
   dynamic d = dynamic::object;
   for (auto& datum: data) {
-    d[datum.name] = datum.timeInNs * 1000.;
+    if (datum.counters.empty()) {
+      d[datum.name] = datum.timeInNs * 1000.;
+    } else {
+      // With --bm_counters, the time and the counters of each benchmark
+      dynamic counters = dynamic::object("time", datum.timeInNs * 1000.);
+      for (auto& counter : datum.counters) {
+        counters[counter.first] = counter.second;
+      }
+      d[datum.name] = std::move(counters);
+    }
   }
 
   printf("%s\n", toPrettyJson(d).c_str());
@@ -350,6 +788,14 @@ void benchmarkResultsToDynamic(
   out = dynamic::array;
   for (auto& datum : data) {
     out.push_back(dynamic::array(datum.file, datum.name, datum.timeInNs));
+    if (!datum.counters.empty()) {
+      // An array of pairs, to keep the order of --bm_counters
+      dynamic counters = dynamic::array;
+      for (auto& counter : datum.counters) {
+        counters.push_back(dynamic::array(counter.first, counter.second));
+      }
+      out[out.size() - 1].push_back(std::move(counters));
+    }
   }
 }
 
@@ -358,7 +804,13 @@ void benchmarkResultsFromDynamic(
     vector<detail::BenchmarkResult>& results) {
   for (auto& datum : d) {
     results.push_back(
-        {datum[0].asString(), datum[1].asString(), datum[2].asDouble()});
+        {datum[0].asString(), datum[1].asString(), datum[2].asDouble(), {}});
+    if (datum.size() > 3) {
+      for (auto& counter : datum[3]) {
+        results.back().counters.emplace_back(
+            counter[0].asString(), counter[1].asDouble());
+      }
+    }
   }
 }
 
@@ -367,14 +819,67 @@ static pair<StringPiece, StringPiece> resultKey(
   return pair<StringPiece, StringPiece>(result.file, result.name);
 }
 
-void printResultComparison(
+static Optional<double> findCounter(
+    const detail::BenchmarkResult& result,
+    StringPiece name) {
+  for (auto& counter : result.counters) {
+    if (counter.first == name) {
+      return counter.second;
+    }
+  }
+  return none;
+}
+
+/**
+ * Compares the times of two results measured with --bm_repetitions with
+ * Welch's t-test: 1 if test is significantly slower than base, at the 95%
+ * level, -1 if it is significantly faster, and 0 otherwise (or if they
+ * weren't measured repeatedly).
+ */
+static int compareSignificance(
+    const detail::BenchmarkResult& base,
+    const detail::BenchmarkResult& test) {
+  auto baseCi = findCounter(base, "ci95");
+  auto baseSamples = findCounter(base, "samples");
+  auto testCi = findCounter(test, "ci95");
+  auto testSamples = findCounter(test, "samples");
+  if (!baseCi || !baseSamples || !testCi || !testSamples ||
+      *baseSamples < 2 || *testSamples < 2) {
+    return 0;
+  }
+  // The variances of the means, from the confidence intervals
+  auto meanVariance = [](double time, double ci, double samples) {
+    double halfWidth = ci * time / studentT95(samples - 1);
+    return halfWidth * halfWidth;
+  };
+  double baseVariance = meanVariance(base.timeInNs, *baseCi, *baseSamples);
+  double testVariance = meanVariance(test.timeInNs, *testCi, *testSamples);
+  double difference = test.timeInNs - base.timeInNs;
+  double variance = baseVariance + testVariance;
+  if (variance == 0) {
+    return difference > 0 ? 1 : difference < 0 ? -1 : 0;
+  }
+  // Welch-Satterthwaite
+  double degreesOfFreedom = variance * variance /
+      (baseVariance * baseVariance / (*baseSamples - 1) +
+       testVariance * testVariance / (*testSamples - 1));
+  if (std::abs(difference) / std::sqrt(variance) <=
+      studentT95(degreesOfFreedom)) {
+    return 0;
+  }
+  return difference > 0 ? 1 : -1;
+}
+
+size_t printResultComparison(
     const vector<detail::BenchmarkResult>& base,
     const vector<detail::BenchmarkResult>& test) {
-  map<pair<StringPiece, StringPiece>, double> baselines;
+  map<pair<StringPiece, StringPiece>, const detail::BenchmarkResult*>
+      baselines;
 
   for (auto& baseResult : base) {
-    baselines[resultKey(baseResult)] = baseResult.timeInNs;
+    baselines[resultKey(baseResult)] = &baseResult;
   }
+  size_t regressions = 0;
   //
   // Width available
   static const unsigned int columns = 76;
@@ -398,8 +903,7 @@ void printResultComparison(
   string lastFile;
 
   for (auto& datum : test) {
-    folly::Optional<double> baseline =
-        folly::get_optional(baselines, resultKey(datum));
+    auto baseline = folly::get_default(baselines, resultKey(datum));
     auto file = datum.file;
     if (file != lastFile) {
       // New file starting
@@ -430,18 +934,25 @@ void printResultComparison(
           readableTime(secPerIter, 2).c_str(),
           metricReadable(itersPerSec, 2).c_str());
     } else {
-      // Print with baseline
-      auto rel = *baseline / nsPerIter * 100.0;
+      // Print with baseline, and whether the difference is significant
+      auto rel = baseline->timeInNs / nsPerIter * 100.0;
+      auto significance = compareSignificance(*baseline, datum);
+      if (significance > 0) {
+        ++regressions;
+      }
       printf(
-          "%*s %7.2f%%  %9s  %7s\n",
+          "%*s %7.2f%%  %9s  %7s%s\n",
           static_cast<int>(s.size()),
           s.c_str(),
           rel,
           readableTime(secPerIter, 2).c_str(),
-          metricReadable(itersPerSec, 2).c_str());
+          metricReadable(itersPerSec, 2).c_str(),
+          significance > 0 ? "  REGRESSION"
+                           : significance < 0 ? "  improvement" : "");
     }
   }
   separator('=');
+  return regressions;
 }
 
 void runBenchmarks() {
@@ -457,23 +968,102 @@ void runBenchmarks() {
 
   // PLEASE KEEP QUIET. MEASUREMENTS IN PROGRESS.
 
+  // ipc is computed from the cycles and instructions
+  vector<string> counterNames;
+  split(',', FLAGS_bm_counters, counterNames, true);
+  vector<string> events;
+  for (auto& name : counterNames) {
+    if (name == "ipc") {
+      events.push_back("cycles");
+      events.push_back("instructions");
+    } else {
+      events.push_back(name);
+    }
+  }
+  std::sort(events.begin(), events.end());
+  events.erase(std::unique(events.begin(), events.end()), events.end());
+  std::unique_ptr<PerfCounters> counters;
+  if (!events.empty()) {
+    counters = std::make_unique<PerfCounters>(events);
+  }
+  auto toCounters = [&](const vector<double>& counts) {
+    auto count = [&](StringPiece event) -> Optional<double> {
+      auto& counted = counters->events();
+      auto it = std::find(counted.begin(), counted.end(), event);
+      if (it == counted.end()) {
+        return none;
+      }
+      return counts[size_t(it - counted.begin())];
+    };
+    vector<pair<string, double>> result;
+    for (auto& name : counterNames) {
+      if (name == "ipc") {
+        auto cycles = count("cycles");
+        auto instructions = count("instructions");
+        if (cycles && instructions) {
+          result.emplace_back(
+              name, *cycles == 0 ? 0.0 : *instructions / *cycles);
+        }
+      } else if (auto value = count(name)) {
+        result.emplace_back(name, *value);
+      }
+    }
+    return result;
+  };
+
   size_t baselineIndex = getGlobalBenchmarkBaselineIndex();
 
-  auto const globalBaseline =
-      runBenchmarkGetNSPerIteration(benchmarks()[baselineIndex].func, 0);
+  vector<double> baselineCounts;
+  auto const globalBaseline = runBenchmarkGetNSPerIteration(
+      benchmarks()[baselineIndex].func,
+      0,
+      counters.get(),
+      {},
+      &baselineCounts);
+  // The time of the last BENCHMARK_THREADS on 1 thread
+  double singleThreadElapsed = 0.0;
   FOR_EACH_RANGE (i, 0, benchmarks().size()) {
     if (i == baselineIndex) {
       continue;
     }
     double elapsed = 0.0;
+    vector<double> counts;
+    Optional<TimeSummary> summary;
     auto& bm = benchmarks()[i];
     if (bm.name != "-") { // skip separators
       if (bmRegex && !boost::regex_search(bm.name, *bmRegex)) {
         continue;
       }
-      elapsed = runBenchmarkGetNSPerIteration(bm.func, globalBaseline);
+      // The counters would only count the thread waiting for the others
+      auto bmCounters = bm.threads == 0 ? counters.get() : nullptr;
+      elapsed = runBenchmarkGetNSPerIteration(
+          bm.func, globalBaseline, bmCounters, baselineCounts, &counts);
+      if (FLAGS_bm_repetitions > 1) {
+        vector<double> times{elapsed};
+        for (int32_t r = 1; r < FLAGS_bm_repetitions; ++r) {
+          times.push_back(
+              runBenchmarkGetNSPerIteration(bm.func, globalBaseline));
+        }
+        summary = summarizeTimes(std::move(times));
+        elapsed = summary->mean;
+      }
+    }
+    results.push_back({bm.file, bm.name, elapsed, {}});
+    if (counters && bm.name != "-" && bm.threads == 0) {
+      results.back().counters = toCounters(counts);
+    }
+    if (summary) {
+      results.back().counters.emplace_back(
+          "ci95", elapsed == 0 ? 0.0 : summary->ci95 / elapsed);
+      results.back().counters.emplace_back("samples", summary->samples);
+    }
+    if (bm.threads == 1) {
+      singleThreadElapsed = elapsed;
+    }
+    if (bm.threads > 0 && singleThreadElapsed > 0 && elapsed > 0) {
+      results.back().counters.emplace_back(
+          "efficiency", singleThreadElapsed / elapsed / bm.threads);
     }
-    results.push_back({bm.file, bm.name, elapsed});
   }
 
   // PLEASE MAKE NOISE. MEASUREMENTS DONE.
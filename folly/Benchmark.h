@@ -26,7 +26,10 @@
 #include <chrono>
 #include <functional>
 #include <limits>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/function_types/function_arity.hpp>
 #include <glog/logging.h>
@@ -61,12 +64,19 @@ struct BenchmarkRegistration {
   std::string file;
   std::string name;
   BenchmarkFun func;
+  // For BENCHMARK_THREADS, the number of threads; 0 otherwise
+  unsigned int threads = 0;
 };
 
 struct BenchmarkResult {
   std::string file;
   std::string name;
   double timeInNs;
+  // The counters selected with --bm_counters, per iteration, the scaling
+  // "efficiency" of BENCHMARK_THREADS, and with --bm_repetitions the 95%
+  // confidence interval of the time ("ci95", relative to it) and the
+  // number of measurements it is the mean of ("samples")
+  std::vector<std::pair<std::string, double>> counters;
 };
 
 /**
@@ -77,6 +87,23 @@ void addBenchmarkImpl(const char* file,
                       const char* name,
                       std::function<TimeIterPair(unsigned int)>);
 
+/**
+ * Adds the benchmarks of BENCHMARK_THREADS: body(n) runs n iterations on
+ * one thread, and returns the number it ran.
+ */
+void addThreadedBenchmarkImpl(
+    const char* file,
+    const char* name,
+    unsigned int maxThreads,
+    std::function<unsigned int(unsigned int)> body);
+
+/**
+ * Stop and restart counting the --bm_counters events, for the time a
+ * BenchmarkSuspender suspends the measurement.  No-ops without counters.
+ */
+void pauseBenchmarkCounters();
+void resumeBenchmarkCounters();
+
 } // namespace detail
 
 /**
@@ -88,6 +115,7 @@ struct BenchmarkSuspender {
   using Duration = Clock::duration;
 
   BenchmarkSuspender() {
+    detail::pauseBenchmarkCounters();
     start = Clock::now();
   }
 
@@ -101,6 +129,7 @@ struct BenchmarkSuspender {
   BenchmarkSuspender& operator=(BenchmarkSuspender && rhs) {
     if (start != TimePoint{}) {
       tally();
+      detail::resumeBenchmarkCounters();
     }
     start = rhs.start;
     rhs.start = {};
@@ -110,6 +139,7 @@ struct BenchmarkSuspender {
   ~BenchmarkSuspender() {
     if (start != TimePoint{}) {
       tally();
+      detail::resumeBenchmarkCounters();
     }
   }
 
@@ -117,10 +147,12 @@ struct BenchmarkSuspender {
     assert(start != TimePoint{});
     tally();
     start = {};
+    detail::resumeBenchmarkCounters();
   }
 
   void rehire() {
     assert(start == TimePoint{});
+    detail::pauseBenchmarkCounters();
     start = Clock::now();
   }
 
@@ -206,6 +238,50 @@ addBenchmark(const char* file, const char* name, Lambda&& lambda) {
     });
 }
 
+/**
+ * Adds the benchmarks of BENCHMARK_THREADS.  Usually not called directly.
+ * The lambda runs the given number of iterations on the calling thread,
+ * and returns the number of iterations it ran.
+ */
+template <typename Lambda>
+typename std::enable_if<
+  boost::function_types::function_arity<decltype(&Lambda::operator())>::value
+  == 2
+>::type
+addThreadedBenchmark(
+    const char* file,
+    const char* name,
+    unsigned int maxThreads,
+    Lambda&& lambda) {
+  detail::addThreadedBenchmarkImpl(
+      file,
+      name,
+      maxThreads,
+      std::function<unsigned int(unsigned int)>(std::forward<Lambda>(lambda)));
+}
+
+/**
+ * Same as above, for a lambda that runs one iteration.
+ */
+template <typename Lambda>
+typename std::enable_if<
+  boost::function_types::function_arity<decltype(&Lambda::operator())>::value
+  == 1
+>::type
+addThreadedBenchmark(
+    const char* file,
+    const char* name,
+    unsigned int maxThreads,
+    Lambda&& lambda) {
+  addThreadedBenchmark(file, name, maxThreads, [=](unsigned int times) {
+    unsigned int niter = 0;
+    while (times-- > 0) {
+      niter += lambda();
+    }
+    return niter;
+  });
+}
+
 /**
  * Call doNotOptimizeAway(var) to ensure that var will be computed even
  * post-optimization.  Use it for variables that are computed during
@@ -303,7 +379,13 @@ void benchmarkResultsFromDynamic(
     const dynamic&,
     std::vector<detail::BenchmarkResult>&);
 
-void printResultComparison(
+/**
+ * Prints the results of test relative to those of base. Results measured
+ * with --bm_repetitions on both sides are flagged when their difference is
+ * statistically significant; returns the number of significant
+ * regressions.
+ */
+size_t printResultComparison(
     const std::vector<detail::BenchmarkResult>& base,
     const std::vector<detail::BenchmarkResult>& test);
 
@@ -322,6 +404,20 @@ void printResultComparison(
     true);                                                              \
   static void funName(paramType paramName)
 
+/**
+ * Introduces a multi-threaded benchmark function. Used internally, see
+ * BENCHMARK_THREADS below.
+ */
+#define BENCHMARK_THREADS_IMPL(                                         \
+    funName, stringName, maxThreads, rv, paramType, paramName)          \
+  static void funName(paramType);                                       \
+  static bool FB_ANONYMOUS_VARIABLE(follyBenchmarkUnused) = (           \
+    ::folly::addThreadedBenchmark(__FILE__, stringName, maxThreads,     \
+      [](paramType paramName) -> unsigned { funName(paramName);         \
+                                            return rv; }),              \
+    true);                                                              \
+  static void funName(paramType paramName)
+
 /**
  * Introduces a benchmark function with support for returning the actual
  * number of iterations. Used internally, see BENCHMARK_MULTI and friends
@@ -544,6 +640,34 @@ void printResultComparison(
     return name(iters, ## __VA_ARGS__);                                 \
   }
 
+/**
+ * Runs a benchmark on several threads at once, to measure how it scales
+ * under contention.  The body runs on 1, 2, 4... and maxThreads threads,
+ * which all start at the same time and split the iterations between them;
+ * the time is that until the last thread is done.  So the time/iter and
+ * iters/s columns are those of all threads together, the relative column
+ * is the speedup over 1 thread, and the efficiency column is the speedup
+ * divided by the number of threads.  Example:
+ *
+ * BENCHMARK_THREADS(atomicIncrement, 8, n) {
+ *   static std::atomic<uint64_t> counter;
+ *   FOR_EACH_RANGE (i, 0, n) {
+ *     counter.fetch_add(1);
+ *   }
+ * }
+ *
+ * As with BENCHMARK, the iteration count may be left out.  The body must
+ * not use BenchmarkSuspender, and --bm_counters doesn't count its threads.
+ */
+#define BENCHMARK_THREADS(name, maxThreads, ...)                \
+  BENCHMARK_THREADS_IMPL(                                       \
+    name,                                                       \
+    FB_STRINGIZE(name),                                         \
+    maxThreads,                                                 \
+    FB_ARG_2_OR_1(1, ## __VA_ARGS__),                           \
+    FB_ONE_OR_NONE(unsigned, ## __VA_ARGS__),                   \
+    __VA_ARGS__)
+
 /**
  * Draws a line of dashes.
  */
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace folly {
+
+namespace detail {
+
+// State shared by a CancellationSource, its copies, and every token and
+// callback derived from them.
+//
+// refs_ counts sources and tokens (a registered callback holds a token
+// reference); sourceRefs_ counts sources only. The state is freed when
+// refs_ drops to zero.
+class CancellationState {
+ public:
+  static CancellationState* create() {
+    return new CancellationState();
+  }
+
+  void addTokenReference() noexcept {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void removeTokenReference() noexcept {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  void addSourceReference() noexcept {
+    sourceRefs_.fetch_add(1, std::memory_order_relaxed);
+    addTokenReference();
+  }
+
+  void removeSourceReference() noexcept {
+    sourceRefs_.fetch_sub(1, std::memory_order_release);
+    removeTokenReference();
+  }
+
+  bool isCancellationRequested() const noexcept {
+    return cancellationRequested_.load(std::memory_order_acquire);
+  }
+
+  bool canBeCancelled() const noexcept {
+    return isCancellationRequested() ||
+        sourceRefs_.load(std::memory_order_acquire) > 0;
+  }
+
+  bool requestCancellation() noexcept;
+
+  // Links the callback into the list. Returns false, without linking, if
+  // cancellation has already been requested.
+  bool tryAddCallback(CancellationCallback* callback) noexcept;
+
+  // Unlinks the callback, or waits for it to finish running if it has
+  // already been picked up by requestCancellation() on another thread.
+  void removeCallback(CancellationCallback* callback) noexcept;
+
+ private:
+  CancellationState() = default;
+  ~CancellationState() = default;
+
+  std::atomic<std::size_t> refs_{1};
+  std::atomic<std::size_t> sourceRefs_{1};
+  std::atomic<bool> cancellationRequested_{false};
+
+  std::mutex mutex_;
+  CancellationCallback* head_{nullptr};
+  // The callback currently being run by requestCancellation(), and the
+  // thread running it. Both guarded by mutex_.
+  CancellationCallback* currentCallback_{nullptr};
+  std::thread::id signallingThreadId_;
+};
+
+} // namespace detail
+
+inline CancellationToken::CancellationToken(
+    const CancellationToken& other) noexcept
+    : state_(other.state_) {
+  if (state_ != nullptr) {
+    state_->addTokenReference();
+  }
+}
+
+inline CancellationToken::CancellationToken(CancellationToken&& other) noexcept
+    : state_(other.state_) {
+  other.state_ = nullptr;
+}
+
+inline CancellationToken& CancellationToken::operator=(
+    const CancellationToken& other) noexcept {
+  if (state_ != other.state_) {
+    CancellationToken temp{other};
+    swap(temp);
+  }
+  return *this;
+}
+
+inline CancellationToken& CancellationToken::operator=(
+    CancellationToken&& other) noexcept {
+  CancellationToken temp{std::move(other)};
+  swap(temp);
+  return *this;
+}
+
+inline CancellationToken::~CancellationToken() {
+  if (state_ != nullptr) {
+    state_->removeTokenReference();
+  }
+}
+
+inline bool CancellationToken::isCancellationRequested() const noexcept {
+  return state_ != nullptr && state_->isCancellationRequested();
+}
+
+inline bool CancellationToken::canBeCancelled() const noexcept {
+  return state_ != nullptr && state_->canBeCancelled();
+}
+
+inline CancellationSource::CancellationSource()
+    : state_(detail::CancellationState::create()) {}
+
+inline CancellationSource::CancellationSource(
+    const CancellationSource& other) noexcept
+    : state_(other.state_) {
+  if (state_ != nullptr) {
+    state_->addSourceReference();
+  }
+}
+
+inline CancellationSource::CancellationSource(
+    CancellationSource&& other) noexcept
+    : state_(other.state_) {
+  other.state_ = nullptr;
+}
+
+inline CancellationSource& CancellationSource::operator=(
+    const CancellationSource& other) noexcept {
+  if (state_ != other.state_) {
+    CancellationSource temp{other};
+    swap(temp);
+  }
+  return *this;
+}
+
+inline CancellationSource& CancellationSource::operator=(
+    CancellationSource&& other) noexcept {
+  CancellationSource temp{std::move(other)};
+  swap(temp);
+  return *this;
+}
+
+inline CancellationSource::~CancellationSource() {
+  if (state_ != nullptr) {
+    state_->removeSourceReference();
+  }
+}
+
+inline bool CancellationSource::isCancellationRequested() const noexcept {
+  return state_ != nullptr && state_->isCancellationRequested();
+}
+
+inline CancellationToken CancellationSource::getToken() const noexcept {
+  if (state_ != nullptr) {
+    state_->addTokenReference();
+  }
+  return CancellationToken(state_);
+}
+
+inline bool CancellationSource::requestCancellation() const noexcept {
+  if (state_ != nullptr) {
+    return state_->requestCancellation();
+  }
+  return false;
+}
+
+} // namespace folly
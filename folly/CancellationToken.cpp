@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/CancellationToken.h>
+
+namespace folly {
+
+namespace detail {
+
+bool CancellationState::requestCancellation() noexcept {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (cancellationRequested_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  cancellationRequested_.store(true, std::memory_order_release);
+  signallingThreadId_ = std::this_thread::get_id();
+
+  while (head_ != nullptr) {
+    CancellationCallback* callback = head_;
+    head_ = callback->next_;
+    if (head_ != nullptr) {
+      head_->prevNext_ = &head_;
+    }
+    callback->next_ = nullptr;
+    callback->prevNext_ = nullptr;
+
+    currentCallback_ = callback;
+    bool destructorHasRunInsideCallback = false;
+    callback->destructorHasRunInsideCallback_ = &destructorHasRunInsideCallback;
+    lock.unlock();
+
+    callback->invokeCallback();
+
+    // If the callback destroyed itself, it must not be touched again.
+    if (!destructorHasRunInsideCallback) {
+      callback->destructorHasRunInsideCallback_ = nullptr;
+      callback->callbackCompleted_.store(true, std::memory_order_release);
+    }
+    lock.lock();
+  }
+  currentCallback_ = nullptr;
+  return false;
+}
+
+bool CancellationState::tryAddCallback(
+    CancellationCallback* callback) noexcept {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cancellationRequested_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  callback->next_ = head_;
+  if (head_ != nullptr) {
+    head_->prevNext_ = &callback->next_;
+  }
+  callback->prevNext_ = &head_;
+  head_ = callback;
+  return true;
+}
+
+void CancellationState::removeCallback(
+    CancellationCallback* callback) noexcept {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (callback->prevNext_ != nullptr) {
+    // Still registered; cancellation has not reached it.
+    *callback->prevNext_ = callback->next_;
+    if (callback->next_ != nullptr) {
+      callback->next_->prevNext_ = callback->prevNext_;
+    }
+    callback->prevNext_ = nullptr;
+    callback->next_ = nullptr;
+    return;
+  }
+
+  if (currentCallback_ != callback) {
+    // Already ran to completion.
+    return;
+  }
+
+  if (signallingThreadId_ == std::this_thread::get_id()) {
+    // Destroyed from inside its own callback (or something it called).
+    if (callback->destructorHasRunInsideCallback_ != nullptr) {
+      *callback->destructorHasRunInsideCallback_ = true;
+    }
+    return;
+  }
+
+  // Running on another thread: wait for it so that the caller can safely
+  // destroy anything the callback references.
+  lock.unlock();
+  while (!callback->callbackCompleted_.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+} // namespace detail
+
+void CancellationCallback::registerCallback(const CancellationToken& token) {
+  if (!token.state_->canBeCancelled()) {
+    return;
+  }
+  token.state_->addTokenReference();
+  state_ = token.state_;
+  if (!state_->tryAddCallback(this)) {
+    // Already cancelled: run now, and hold no reference to the state.
+    auto* state = std::exchange(state_, nullptr);
+    state->removeTokenReference();
+    invokeCallback();
+  }
+}
+
+CancellationCallback::~CancellationCallback() {
+  if (state_ != nullptr) {
+    state_->removeCallback(this);
+    state_->removeTokenReference();
+  }
+}
+
+void CancellationCallback::invokeCallback() noexcept {
+  callback_();
+}
+
+} // namespace folly
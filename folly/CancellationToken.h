@@ -0,0 +1,228 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Function.h>
+
+namespace folly {
+
+namespace detail {
+class CancellationState;
+} // namespace detail
+
+/**
+ * A CancellationToken is an object that can be passed into an operation that
+ * supports cancellation, letting the caller request that the operation stop
+ * early.
+ *
+ * Tokens are obtained from a CancellationSource with getToken(). They are
+ * cheap to copy (one atomic increment) and can be polled with
+ * isCancellationRequested(), or observed by registering a
+ * CancellationCallback.
+ *
+ * A default-constructed token is never cancelled and makes every check and
+ * callback registration a no-op.
+ */
+class CancellationToken {
+ public:
+  // Constructs a token that can never be cancelled.
+  CancellationToken() noexcept : state_(nullptr) {}
+
+  CancellationToken(const CancellationToken& other) noexcept;
+  CancellationToken(CancellationToken&& other) noexcept;
+
+  CancellationToken& operator=(const CancellationToken& other) noexcept;
+  CancellationToken& operator=(CancellationToken&& other) noexcept;
+
+  ~CancellationToken();
+
+  /**
+   * True once requestCancellation() has been called on an associated
+   * CancellationSource.
+   */
+  bool isCancellationRequested() const noexcept;
+
+  /**
+   * False if cancellation can never be requested on this token, either
+   * because it is default-constructed or because every associated
+   * CancellationSource has been destroyed without requesting cancellation.
+   * Operations may use this to skip registering callbacks at all.
+   */
+  bool canBeCancelled() const noexcept;
+
+  void swap(CancellationToken& other) noexcept {
+    std::swap(state_, other.state_);
+  }
+
+  // Two tokens compare equal if they refer to the same source, or if both
+  // are default-constructed.
+  friend bool operator==(
+      const CancellationToken& a,
+      const CancellationToken& b) noexcept {
+    return a.state_ == b.state_;
+  }
+
+  friend bool operator!=(
+      const CancellationToken& a,
+      const CancellationToken& b) noexcept {
+    return !(a == b);
+  }
+
+ private:
+  friend class CancellationCallback;
+  friend class CancellationSource;
+
+  // Takes over an existing token reference.
+  explicit CancellationToken(detail::CancellationState* state) noexcept
+      : state_(state) {}
+
+  detail::CancellationState* state_;
+};
+
+inline void swap(CancellationToken& a, CancellationToken& b) noexcept {
+  a.swap(b);
+}
+
+/**
+ * A CancellationSource is the producer side of cancellation. Every token
+ * handed out by getToken() observes a call to requestCancellation().
+ *
+ * Copies of a source share the same state, so any copy can request
+ * cancellation. Once every copy has been destroyed without requesting
+ * cancellation, the associated tokens report canBeCancelled() == false.
+ */
+class CancellationSource {
+ public:
+  // Creates a new, independent source.
+  CancellationSource();
+
+  CancellationSource(const CancellationSource& other) noexcept;
+  CancellationSource(CancellationSource&& other) noexcept;
+
+  CancellationSource& operator=(const CancellationSource& other) noexcept;
+  CancellationSource& operator=(CancellationSource&& other) noexcept;
+
+  ~CancellationSource();
+
+  // Returns a source with no state. Its tokens can never be cancelled, and
+  // requestCancellation() on it does nothing.
+  static CancellationSource invalid() noexcept {
+    return CancellationSource(nullptr);
+  }
+
+  bool isCancellationRequested() const noexcept;
+
+  // False only for a source returned by invalid() (or moved from).
+  bool canBeCancelled() const noexcept {
+    return state_ != nullptr;
+  }
+
+  CancellationToken getToken() const noexcept;
+
+  /**
+   * Request cancellation of all operations holding a token from this source.
+   *
+   * The first call runs every registered CancellationCallback on the calling
+   * thread, in reverse registration order, before returning. Later calls do
+   * nothing.
+   *
+   * Returns true if cancellation had already been requested.
+   */
+  bool requestCancellation() const noexcept;
+
+  void swap(CancellationSource& other) noexcept {
+    std::swap(state_, other.state_);
+  }
+
+ private:
+  explicit CancellationSource(detail::CancellationState* state) noexcept
+      : state_(state) {}
+
+  detail::CancellationState* state_;
+};
+
+inline void swap(CancellationSource& a, CancellationSource& b) noexcept {
+  a.swap(b);
+}
+
+/**
+ * A CancellationCallback runs a function when cancellation is requested on
+ * the token it was constructed with, for as long as it is alive.
+ *
+ * Registration is a lock, a list insert and an unlock; a default-constructed
+ * or no-longer-cancellable token skips even that.
+ *
+ * - If cancellation has already been requested, the constructor runs the
+ *   function inline before returning.
+ * - Otherwise the function runs at most once, on the thread that calls
+ *   requestCancellation().
+ * - The destructor deregisters the function. If the function is running on
+ *   another thread at that moment, the destructor blocks until it returns,
+ *   so anything the function captures may be destroyed right after the
+ *   callback. Destroying the callback from inside its own function is
+ *   allowed.
+ *
+ * The function must not throw.
+ */
+class CancellationCallback {
+ public:
+  template <
+      typename Callable,
+      typename = typename std::enable_if<
+          std::is_constructible<folly::Function<void()>, Callable>::value>::
+          type>
+  CancellationCallback(const CancellationToken& token, Callable&& callback)
+      : callback_(std::forward<Callable>(callback)) {
+    if (token.state_ != nullptr) {
+      registerCallback(token);
+    }
+  }
+
+  ~CancellationCallback();
+
+  CancellationCallback(const CancellationCallback&) = delete;
+  CancellationCallback(CancellationCallback&&) = delete;
+  CancellationCallback& operator=(const CancellationCallback&) = delete;
+  CancellationCallback& operator=(CancellationCallback&&) = delete;
+
+ private:
+  friend class detail::CancellationState;
+
+  void registerCallback(const CancellationToken& token);
+  void invokeCallback() noexcept;
+
+  folly::Function<void()> callback_;
+  detail::CancellationState* state_{nullptr};
+
+  // Intrusive doubly linked list of callbacks registered with state_.
+  // prevNext_ is null once the callback has been removed from the list.
+  CancellationCallback* next_{nullptr};
+  CancellationCallback** prevNext_{nullptr};
+
+  // Points at a flag on the signalling thread's stack while callback_ runs,
+  // so that a destructor running inside the callback can report itself.
+  bool* destructorHasRunInsideCallback_{nullptr};
+  std::atomic<bool> callbackCompleted_{false};
+};
+
+} // namespace folly
+
+#include <folly/CancellationToken-inl.h>
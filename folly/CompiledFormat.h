@@ -0,0 +1,739 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * format() and sformat() with format strings that are parsed at compile
+ * time.
+ *
+ *   std::string s = sformat(FOLLY_FORMAT_STRING("{} has {:>8.2f}"), x, y);
+ *   format(FOLLY_FORMAT_STRING("{:08x}"), n).appendTo(out);
+ *
+ * FOLLY_FORMAT_STRING wraps the literal in a FixedString, which a constexpr
+ * parser turns into a sequence of steps: runs of literal text, and
+ * arguments with their FormatArg fields already filled in.  The formatter
+ * walks the steps with their argument indexes known at compile time, so
+ * nothing is parsed at runtime and each argument is formatted without
+ * searching the argument list for it.
+ *
+ * Errors that format() would throw on, like an unmatched brace, an argument
+ * index out of range or a format spec that the argument's type doesn't
+ * accept (precision on an integer, 's' on a double, ...), fail to compile
+ * instead.  Format specs of user-defined FormatValue types are still only
+ * checked when formatting.
+ *
+ * The syntax is the same as format()'s, see Format.h; vformat()'s container
+ * mode isn't supported.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include <folly/FixedString.h>
+#include <folly/Format.h>
+#include <folly/FormatArg.h>
+#include <folly/Range.h>
+#include <folly/Utility.h>
+
+/**
+ * A format string for the format() and sformat() overloads below; s must
+ * be a string literal.
+ */
+#define FOLLY_FORMAT_STRING(s)                                           \
+  [] {                                                                   \
+    struct FollyFormatString : ::folly::detail::FormatStringTag {        \
+      static constexpr decltype(::folly::makeFixedString(s)) value() {   \
+        return ::folly::makeFixedString(s);                              \
+      }                                                                  \
+    };                                                                   \
+    return FollyFormatString{};                                          \
+  }()
+
+namespace folly {
+
+namespace detail {
+
+// Base of the types created by FOLLY_FORMAT_STRING
+struct FormatStringTag {};
+
+template <class Fmt, class Result>
+using EnableIfFormatString =
+    std::enable_if<std::is_base_of<FormatStringTag, Fmt>::value, Result>;
+
+// One step of a compiled format string
+struct CompiledFormatStep {
+  // Literal text, or an argument; either way [begin, end) of the format
+  // string, without the braces for arguments
+  bool isArg{false};
+  std::size_t begin{0};
+  std::size_t end{0};
+
+  // What remains of the key after the argument index
+  std::size_t keyBegin{0};
+  std::size_t keyEnd{0};
+
+  std::size_t argIndex{0};
+  // Resolved from '*' and widthIndex, kNoIndex for static widths
+  int widthArgIndex{FormatArg::kNoIndex};
+
+  // As parsed by FormatArg
+  char fill{FormatArg::kDefaultFill};
+  FormatArg::Align align{FormatArg::Align::DEFAULT};
+  FormatArg::Sign sign{FormatArg::Sign::DEFAULT};
+  bool basePrefix{false};
+  bool thousandsSeparator{false};
+  bool trailingDot{false};
+  int width{FormatArg::kDefaultWidth};
+  int precision{FormatArg::kDefaultPrecision};
+  char presentation{FormatArg::kDefaultPresentation};
+};
+
+template <std::size_t N>
+struct CompiledFormat {
+  // There can't be more steps than characters, plus one
+  CompiledFormatStep steps[N + 1]{};
+  std::size_t size{0};
+};
+
+constexpr std::size_t
+formatFind(const char* s, std::size_t p, std::size_t end, char c) {
+  while (p != end && s[p] != c) {
+    ++p;
+  }
+  return p;
+}
+
+constexpr bool isFormatDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+constexpr int formatParseInt(const char* s, std::size_t& p, std::size_t end) {
+  int v = 0;
+  do {
+    if (v > (std::numeric_limits<int>::max() - 9) / 10) {
+      throwBadFormatArg("folly::format: integer overflow in format string");
+    }
+    v = v * 10 + (s[p] - '0');
+    ++p;
+  } while (p != end && isFormatDigit(s[p]));
+  return v;
+}
+
+constexpr FormatArg::Align formatAlign(char c) {
+  return c == '<'
+      ? FormatArg::Align::LEFT
+      : c == '>'
+          ? FormatArg::Align::RIGHT
+          : c == '='
+              ? FormatArg::Align::PAD_AFTER_SIGN
+              : c == '^' ? FormatArg::Align::CENTER
+                         : FormatArg::Align::INVALID;
+}
+
+constexpr FormatArg::Sign formatSign(char c) {
+  return c == '+'
+      ? FormatArg::Sign::PLUS_OR_MINUS
+      : c == '-' ? FormatArg::Sign::MINUS
+                 : c == ' ' ? FormatArg::Sign::SPACE_OR_MINUS
+                            : FormatArg::Sign::INVALID;
+}
+
+// FormatArg::initSlow(), for the spec in [p, end) (after the ':')
+constexpr void formatParseSpec(
+    CompiledFormatStep& step,
+    int& widthIndex,
+    const char* s,
+    std::size_t p,
+    std::size_t end) {
+  if (p == end) {
+    return;
+  }
+
+  if (p + 1 != end && formatAlign(s[p + 1]) != FormatArg::Align::INVALID) {
+    step.fill = s[p];
+    step.align = formatAlign(s[p + 1]);
+    if ((p += 2) == end) {
+      return;
+    }
+  } else if (formatAlign(s[p]) != FormatArg::Align::INVALID) {
+    step.align = formatAlign(s[p]);
+    if (++p == end) {
+      return;
+    }
+  }
+
+  if (formatSign(s[p]) != FormatArg::Sign::INVALID) {
+    step.sign = formatSign(s[p]);
+    if (++p == end) {
+      return;
+    }
+  }
+
+  if (s[p] == '#') {
+    step.basePrefix = true;
+    if (++p == end) {
+      return;
+    }
+  }
+
+  if (s[p] == '0') {
+    if (step.align != FormatArg::Align::DEFAULT) {
+      throwBadFormatArg("folly::format: alignment specified twice");
+    }
+    step.fill = '0';
+    step.align = FormatArg::Align::PAD_AFTER_SIGN;
+    if (++p == end) {
+      return;
+    }
+  }
+
+  if (s[p] == '*') {
+    step.width = FormatArg::kDynamicWidth;
+    if (++p == end) {
+      return;
+    }
+    if (isFormatDigit(s[p])) {
+      widthIndex = formatParseInt(s, p, end);
+      if (p == end) {
+        return;
+      }
+    }
+  } else if (isFormatDigit(s[p])) {
+    step.width = formatParseInt(s, p, end);
+    if (p == end) {
+      return;
+    }
+  }
+
+  if (s[p] == ',') {
+    step.thousandsSeparator = true;
+    if (++p == end) {
+      return;
+    }
+  }
+
+  if (s[p] == '.') {
+    if (++p != end && isFormatDigit(s[p])) {
+      step.precision = formatParseInt(s, p, end);
+      if (p != end && s[p] == '.') {
+        step.trailingDot = true;
+        ++p;
+      }
+    } else {
+      step.trailingDot = true;
+    }
+    if (p == end) {
+      return;
+    }
+  }
+
+  step.presentation = s[p];
+  if (++p != end) {
+    throwBadFormatArg("folly::format: extra characters in format string");
+  }
+}
+
+// The argument in [b, e), as BaseFormatter::operator() and FormatArg see it
+constexpr CompiledFormatStep formatParseArg(
+    const char* s,
+    std::size_t b,
+    std::size_t e,
+    int& nextArg,
+    bool& hasDefaultArgIndex,
+    bool& hasExplicitArgIndex) {
+  CompiledFormatStep step;
+  step.isArg = true;
+  step.begin = b;
+  step.end = e;
+
+  auto keyEnd = formatFind(s, b, e, ':');
+  int widthIndex = FormatArg::kNoIndex;
+  if (keyEnd != e) {
+    formatParseSpec(step, widthIndex, s, keyEnd + 1, e);
+  }
+
+  // FormatArg::splitKey<true>()
+  auto pieceEnd = keyEnd;
+  if (b != keyEnd) {
+    auto restEnd = keyEnd;
+    if (s[keyEnd - 1] == ']') {
+      --restEnd;
+      pieceEnd = formatFind(s, b, restEnd, '[');
+      if (pieceEnd == restEnd) {
+        throwBadFormatArg("folly::format: unmatched ']'");
+      }
+    } else {
+      pieceEnd = formatFind(s, b, restEnd, '.');
+    }
+    if (pieceEnd != restEnd) {
+      step.keyBegin = pieceEnd + 1;
+      step.keyEnd = restEnd;
+    }
+  }
+
+  if (b == pieceEnd) {
+    if (step.width == FormatArg::kDynamicWidth) {
+      if (widthIndex != FormatArg::kNoIndex) {
+        throwBadFormatArg(
+            "folly::format: "
+            "cannot provide width arg index without value arg index");
+      }
+      step.widthArgIndex = nextArg++;
+    }
+    step.argIndex = std::size_t(nextArg++);
+    hasDefaultArgIndex = true;
+  } else {
+    if (step.width == FormatArg::kDynamicWidth) {
+      if (widthIndex == FormatArg::kNoIndex) {
+        throwBadFormatArg(
+            "folly::format: "
+            "cannot provide value arg index without width arg index");
+      }
+      step.widthArgIndex = widthIndex;
+    }
+    std::size_t p = b;
+    if (!isFormatDigit(s[p])) {
+      throwBadFormatArg("folly::format: argument index must be integer");
+    }
+    step.argIndex = std::size_t(formatParseInt(s, p, pieceEnd));
+    if (p != pieceEnd) {
+      throwBadFormatArg("folly::format: argument index must be integer");
+    }
+    hasExplicitArgIndex = true;
+  }
+
+  if (hasDefaultArgIndex && hasExplicitArgIndex) {
+    throwBadFormatArg(
+        "folly::format: may not have both default and explicit arg indexes");
+  }
+  return step;
+}
+
+// Literal text in [b, e), where "}}" stands for '}'
+constexpr void formatAddText(
+    CompiledFormatStep* steps,
+    std::size_t& size,
+    const char* s,
+    std::size_t b,
+    std::size_t e) {
+  while (b != e) {
+    auto q = formatFind(s, b, e, '}');
+    if (q != e) {
+      if (++q == e || s[q] != '}') {
+        throwBadFormatArg("folly::format: single '}' in format string");
+      }
+    }
+    steps[size].begin = b;
+    steps[size].end = q;
+    ++size;
+    b = q == e ? e : q + 1;
+  }
+}
+
+// BaseFormatter::operator(), at compile time
+template <std::size_t N>
+constexpr CompiledFormat<N> compileFormat(const FixedString<N>& fmt) {
+  CompiledFormat<N> result;
+  const char* s = fmt.data();
+  std::size_t p = 0;
+  int nextArg = 0;
+  bool hasDefaultArgIndex = false;
+  bool hasExplicitArgIndex = false;
+  while (p != N) {
+    auto q = formatFind(s, p, N, '{');
+    formatAddText(result.steps, result.size, s, p, q);
+    if (q == N) {
+      break;
+    }
+    p = q + 1;
+
+    if (p == N) {
+      throwBadFormatArg("folly::format: '}' at end of format string");
+    }
+
+    // "{{" -> "{"
+    if (s[p] == '{') {
+      result.steps[result.size].begin = p;
+      result.steps[result.size].end = p + 1;
+      ++result.size;
+      ++p;
+      continue;
+    }
+
+    q = formatFind(s, p, N, '}');
+    if (q == N) {
+      throwBadFormatArg("folly::format: missing ending '}'");
+    }
+    result.steps[result.size++] = formatParseArg(
+        s, p, q, nextArg, hasDefaultArgIndex, hasExplicitArgIndex);
+    p = q + 1;
+  }
+  return result;
+}
+
+template <class Fmt>
+struct CompiledFormatProgram {
+  static constexpr decltype(Fmt::value()) string = Fmt::value();
+  static constexpr decltype(compileFormat(Fmt::value())) program =
+      compileFormat(Fmt::value());
+};
+
+template <class Fmt>
+constexpr decltype(Fmt::value()) CompiledFormatProgram<Fmt>::string;
+template <class Fmt>
+constexpr decltype(compileFormat(Fmt::value()))
+    CompiledFormatProgram<Fmt>::program;
+
+// FormatArg::validate(), at compile time
+constexpr bool checkFormatArg(
+    const CompiledFormatStep& step,
+    FormatArg::Type type) {
+  if (step.keyBegin != step.keyEnd) {
+    throwBadFormatArg("folly::format: index not allowed");
+  }
+  switch (type) {
+    case FormatArg::Type::INTEGER:
+      if (step.precision != FormatArg::kDefaultPrecision) {
+        throwBadFormatArg("folly::format: precision not allowed on integers");
+      }
+      break;
+    case FormatArg::Type::FLOAT:
+      if (step.basePrefix) {
+        throwBadFormatArg(
+            "folly::format: "
+            "base prefix ('#') specifier only allowed on integers");
+      }
+      if (step.thousandsSeparator) {
+        throwBadFormatArg(
+            "folly::format: "
+            "thousands separator (',') only allowed on integers");
+      }
+      break;
+    case FormatArg::Type::OTHER:
+      if (step.align == FormatArg::Align::PAD_AFTER_SIGN) {
+        throwBadFormatArg(
+            "folly::format: '='alignment only allowed on numbers");
+      }
+      if (step.sign != FormatArg::Sign::DEFAULT) {
+        throwBadFormatArg(
+            "folly::format: sign specifier only allowed on numbers");
+      }
+      return checkFormatArg(step, FormatArg::Type::FLOAT);
+  }
+  return true;
+}
+
+// What FormatValue<T>::format() would reject for the built-in types
+template <class T>
+constexpr typename std::enable_if<
+    std::is_integral<T>::value && !std::is_same<T, bool>::value,
+    bool>::type
+checkFormatValue(const CompiledFormatStep& step) {
+  checkFormatArg(step, FormatArg::Type::INTEGER);
+  if (!std::is_signed<T>::value && step.sign != FormatArg::Sign::DEFAULT) {
+    throwBadFormatArg(
+        "folly::format: sign specifications not allowed for unsigned values");
+  }
+  char presentation = step.presentation;
+  if (presentation == FormatArg::kDefaultPresentation) {
+    presentation = std::is_same<T, char>::value ? 'c' : 'd';
+  }
+  switch (presentation) {
+    case 'n':
+    case 'd':
+    case 'c':
+      if (step.basePrefix) {
+        throwBadFormatArg(
+            "folly::format: base prefix not allowed with this specifier");
+      }
+      if (presentation != 'd' && step.thousandsSeparator) {
+        throwBadFormatArg(
+            "folly::format: "
+            "thousands separator (',') not allowed with this specifier");
+      }
+      break;
+    case 'o':
+    case 'O':
+    case 'x':
+    case 'X':
+    case 'b':
+    case 'B':
+      if (step.thousandsSeparator) {
+        throwBadFormatArg(
+            "folly::format: "
+            "thousands separator (',') not allowed with this specifier");
+      }
+      break;
+    default:
+      throwBadFormatArg("folly::format: invalid specifier for an integer");
+  }
+  return true;
+}
+
+template <class T>
+constexpr typename std::enable_if<std::is_same<T, bool>::value, bool>::type
+checkFormatValue(const CompiledFormatStep& step) {
+  return step.presentation == FormatArg::kDefaultPresentation
+      ? checkFormatArg(step, FormatArg::Type::OTHER)
+      : checkFormatValue<int>(step);
+}
+
+template <class T>
+constexpr typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+checkFormatValue(const CompiledFormatStep& step) {
+  checkFormatArg(step, FormatArg::Type::FLOAT);
+  switch (step.presentation) {
+    case FormatArg::kDefaultPresentation:
+    case '%':
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'n':
+    case 'g':
+    case 'G':
+      break;
+    default:
+      throwBadFormatArg("folly::format: invalid specifier for a float");
+  }
+  return true;
+}
+
+// Strings; indexing them gives a char, which is checked when formatting
+template <class T>
+constexpr typename std::enable_if<
+    (!std::is_pointer<T>::value ||
+     std::is_same<char, typename std::decay<
+                            typename std::remove_pointer<T>::type>::type>::
+         value) &&
+        std::is_convertible<T, StringPiece>::value,
+    bool>::type
+checkFormatValue(const CompiledFormatStep& step) {
+  if (step.keyBegin == step.keyEnd) {
+    checkFormatArg(step, FormatArg::Type::OTHER);
+    if (step.presentation != FormatArg::kDefaultPresentation &&
+        step.presentation != 's') {
+      throwBadFormatArg("folly::format: invalid specifier for a string");
+    }
+  }
+  return true;
+}
+
+// Everything else is checked by its FormatValue
+template <class T>
+constexpr typename std::enable_if<
+    !std::is_arithmetic<T>::value &&
+        !((!std::is_pointer<T>::value ||
+           std::is_same<char, typename std::decay<typename std::remove_pointer<
+                                  T>::type>::type>::value) &&
+          std::is_convertible<T, StringPiece>::value),
+    bool>::type
+checkFormatValue(const CompiledFormatStep&) {
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * The formatter returned by format() for compiled format strings.  Like
+ * Formatter, it keeps references to its lvalue arguments.
+ */
+template <class Fmt, class... Args>
+class CompiledFormatter {
+ public:
+  /**
+   * Append to output.  out(StringPiece sp) may be called (more than once)
+   */
+  template <class Output>
+  void operator()(Output& out) const {
+    doFormat(out, make_index_sequence<Program::program.size>());
+  }
+
+  /**
+   * Append to a string.
+   */
+  template <class Str>
+  typename std::enable_if<IsSomeString<Str>::value>::type appendTo(
+      Str& str) const {
+    auto appender = [&str](StringPiece s) { str.append(s.data(), s.size()); };
+    (*this)(appender);
+  }
+
+  /**
+   * Conversion to string
+   */
+  std::string str() const {
+    std::string s;
+    appendTo(s);
+    return s;
+  }
+
+  /**
+   * Conversion to fbstring
+   */
+  fbstring fbstr() const {
+    fbstring s;
+    appendTo(s);
+    return s;
+  }
+
+  CompiledFormatter(CompiledFormatter&&) = default;
+  CompiledFormatter& operator=(CompiledFormatter&&) = default;
+
+ private:
+  using Program = detail::CompiledFormatProgram<Fmt>;
+  using ValueTuple = std::tuple<Args...>;
+
+  template <class F, class... A>
+  friend typename detail::
+      EnableIfFormatString<F, CompiledFormatter<F, A...>>::type
+      format(F, A&&...);
+
+  explicit CompiledFormatter(Args&&... args)
+      : values_(std::forward<Args>(args)...) {}
+
+  // Not copyable
+  CompiledFormatter(const CompiledFormatter&) = delete;
+  CompiledFormatter& operator=(const CompiledFormatter&) = delete;
+
+  template <size_t K>
+  using ArgType = typename std::decay<
+      typename std::tuple_element<K, ValueTuple>::type>::type;
+
+  template <size_t K>
+  FormatValue<ArgType<K>> getFormatValue() const {
+    return FormatValue<ArgType<K>>(std::get<K>(values_));
+  }
+
+  template <class Output, size_t... I>
+  void doFormat(Output& out, index_sequence<I...>) const {
+    (void)std::initializer_list<int>{
+        (doStep<I>(out, std::integral_constant<bool, isArg(I)>()), 0)...};
+  }
+
+  static constexpr bool isArg(size_t i) {
+    return Program::program.steps[i].isArg;
+  }
+
+  // Literal text
+  template <size_t I, class Output>
+  void doStep(Output& out, std::false_type) const {
+    constexpr auto step = Program::program.steps[I];
+    out(StringPiece(
+        Program::string.data() + step.begin, step.end - step.begin));
+  }
+
+  template <size_t I, class Output>
+  void doStep(Output& out, std::true_type) const {
+    constexpr auto step = Program::program.steps[I];
+    static_assert(
+        step.argIndex < sizeof...(Args), "argument index out of range");
+    static_assert(
+        detail::checkFormatValue<ArgType<step.argIndex>>(step),
+        "format spec doesn't match the argument type");
+
+    const char* s = Program::string.data();
+    FormatArg arg(
+        StringPiece(s + step.begin, s + step.end),
+        StringPiece(s + step.keyBegin, s + step.keyEnd));
+    arg.fill = step.fill;
+    arg.align = step.align;
+    arg.sign = step.sign;
+    arg.basePrefix = step.basePrefix;
+    arg.thousandsSeparator = step.thousandsSeparator;
+    arg.trailingDot = step.trailingDot;
+    arg.width = step.width;
+    arg.precision = step.precision;
+    arg.presentation = step.presentation;
+    setSizeArg<step.widthArgIndex>(
+        arg,
+        std::integral_constant<
+            bool,
+            step.widthArgIndex != FormatArg::kNoIndex>());
+    getFormatValue<step.argIndex>().format(arg, out);
+  }
+
+  template <int K>
+  void setSizeArg(FormatArg&, std::false_type) const {}
+
+  template <int K>
+  void setSizeArg(FormatArg& arg, std::true_type) const {
+    static_assert(
+        size_t(K) < sizeof...(Args), "width argument index out of range");
+    static_assert(
+        std::is_integral<ArgType<K>>::value &&
+            !std::is_same<ArgType<K>, bool>::value,
+        "dynamic field width argument must be integral");
+    arg.width = static_cast<int>(std::get<K>(values_));
+  }
+
+  ValueTuple values_;
+};
+
+/**
+ * CompiledFormatter objects can be written to streams.
+ */
+template <class Fmt, class... Args>
+std::ostream& operator<<(
+    std::ostream& out,
+    const CompiledFormatter<Fmt, Args...>& formatter) {
+  auto writer = [&out](StringPiece sp) {
+    out.write(sp.data(), std::streamsize(sp.size()));
+  };
+  formatter(writer);
+  return out;
+}
+
+/**
+ * Create a formatter object from a compiled format string.
+ *
+ * std::string formatted = format(FOLLY_FORMAT_STRING("{} {}"), 23, 42).str();
+ */
+template <class Fmt, class... Args>
+typename detail::EnableIfFormatString<Fmt, CompiledFormatter<Fmt, Args...>>::
+    type
+    format(Fmt, Args&&... args) {
+  return CompiledFormatter<Fmt, Args...>(std::forward<Args>(args)...);
+}
+
+/**
+ * Like format(), but immediately returns the formatted string.
+ */
+template <class Fmt, class... Args>
+inline typename detail::EnableIfFormatString<Fmt, std::string>::type sformat(
+    Fmt fmt,
+    Args&&... args) {
+  return format(fmt, std::forward<Args>(args)...).str();
+}
+
+/**
+ * Append formatted output to a string.
+ */
+template <class Str, class Fmt, class... Args>
+typename std::enable_if<
+    IsSomeString<Str>::value && std::is_base_of<detail::FormatStringTag, Fmt>::
+                                    value>::type
+format(Str* out, Fmt fmt, Args&&... args) {
+  format(fmt, std::forward<Args>(args)...).appendTo(*out);
+}
+
+} // namespace folly
@@ -16,6 +16,12 @@
 #include <folly/Conv.h>
 #include <array>
 
+#include <folly/Bits.h>
+
+#if FOLLY_SSE_PREREQ(4, 1)
+#include <smmintrin.h>
+#endif
+
 namespace folly {
 namespace detail {
 
@@ -35,6 +41,19 @@ namespace {
  *  improvements of 20%.
  */
 inline const char* findFirstNonDigit(const char* b, const char* e) {
+  if (kIsLittleEndian) {
+    // 8 at a time.  Each byte of t + 6 is less than 16 if it is a digit;
+    // the first byte that isn't may carry into the next ones, but those
+    // come after it.
+    for (; e - b >= 8; b += 8) {
+      auto const t = loadUnaligned<uint64_t>(b) ^ 0x3030303030303030;
+      auto const nonDigits =
+          (t | (t + 0x0606060606060606)) & 0xf0f0f0f0f0f0f0f0;
+      if (nonDigits != 0) {
+        return b + (findFirstSet(nonDigits) - 1) / 8;
+      }
+    }
+  }
   for (; b < e; ++b) {
     auto const c = static_cast<unsigned>(*b) - '0';
     if (c >= 10) {
@@ -44,6 +63,52 @@ inline const char* findFirstNonDigit(const char* b, const char* e) {
   return b;
 }
 
+/**
+ * SWAR digit parsing: 8 ASCII digits in the bytes of a little-endian
+ * uint64_t, first digit in the lowest byte.
+ */
+inline bool isEightDigits(uint64_t chunk) {
+  return ((chunk & 0xf0f0f0f0f0f0f0f0) |
+          (((chunk + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) ==
+      0x3333333333333333;
+}
+
+inline uint32_t parseEightDigits(uint64_t chunk) {
+  chunk -= 0x3030303030303030;
+  // Pairs of digits in every other byte, then groups of 4 in 32-bit halves
+  chunk = chunk * 10 + (chunk >> 8);
+  chunk = ((chunk & 0x000000ff000000ff) * (100 + (1000000ULL << 32)) +
+           ((chunk >> 16) & 0x000000ff000000ff) * (1 + (10000ULL << 32))) >>
+      32;
+  return uint32_t(chunk);
+}
+
+#if FOLLY_SSE_PREREQ(4, 1)
+// 16 digits at b, if they are all digits
+inline bool parseSixteenDigits(const char* b, uint64_t& value) {
+  auto const chunk = _mm_sub_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)),
+      _mm_set1_epi8('0'));
+  auto const nine = _mm_set1_epi8(9);
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, nine), nine)) !=
+      0xffff) {
+    return false;
+  }
+  // 8 x 2 digits, 4 x 4 digits, 2 x 8 digits
+  auto const pairs = _mm_maddubs_epi16(
+      chunk,
+      _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+  auto const quads =
+      _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  auto const eights = _mm_madd_epi16(
+      _mm_packus_epi32(quads, quads),
+      _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+  value = uint64_t(uint32_t(_mm_cvtsi128_si32(eights))) * 100000000 +
+      uint32_t(_mm_extract_epi32(eights, 1));
+  return true;
+}
+#endif
+
 // Maximum value of number when represented as a string
 template <class T>
 struct MaxString {
@@ -549,6 +614,30 @@ inline Expected<Tgt, ConversionCode> digits_to(
 
   UT result = 0;
 
+  // Only types with more than 8 digits can have 8 digits left here
+  if (sizeof(UT) >= sizeof(uint32_t)) {
+#if FOLLY_SSE_PREREQ(4, 1)
+    if (sizeof(UT) >= sizeof(uint64_t)) {
+      for (uint64_t chunk; e - b >= 16; b += 16) {
+        if (!parseSixteenDigits(b, chunk)) {
+          goto outOfRange;
+        }
+        result = UT(result * static_cast<UT>(10000000000000000ULL) + chunk);
+      }
+    }
+#endif
+    if (kIsLittleEndian) {
+      for (; e - b >= 8; b += 8) {
+        auto const chunk = loadUnaligned<uint64_t>(b);
+        if (!isEightDigits(chunk)) {
+          goto outOfRange;
+        }
+        result = UT(
+            result * static_cast<UT>(100000000) + parseEightDigits(chunk));
+      }
+    }
+  }
+
   for (; e - b >= 4; b += 4) {
     result *= static_cast<UT>(10000);
     const int32_t r0 = shift1000[static_cast<size_t>(b[0])];
@@ -736,6 +825,112 @@ template Expected<unsigned __int128, ConversionCode>
 str_to_integral<unsigned __int128>(StringPiece* src) noexcept;
 #endif
 
+/**
+ * Delimited integers, each parsed as str_to_integral() does, with
+ * whitespace allowed after them.
+ */
+template <class Tgt>
+Expected<size_t, ConversionCode> str_to_integers(
+    StringPiece* src,
+    char delim,
+    Tgt* out,
+    size_t n) noexcept {
+  size_t count = 0;
+  while (count < n && !src->empty()) {
+    auto rest = *src;
+    auto value = str_to_integral<Tgt>(&rest);
+    if (UNLIKELY(!value.hasValue())) {
+      return makeUnexpected(value.error());
+    }
+    auto b = rest.begin(), e = rest.end();
+    while (b < e && *b != delim && std::isspace(*b)) {
+      ++b;
+    }
+    if (b < e) {
+      if (UNLIKELY(*b != delim)) {
+        return makeUnexpected(ConversionCode::NON_WHITESPACE_AFTER_END);
+      }
+      ++b;
+    }
+    out[count++] = value.value();
+    src->assign(b, e);
+  }
+  return count;
+}
+
+template Expected<size_t, ConversionCode> str_to_integers<char>(
+    StringPiece* src,
+    char delim,
+    char* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<signed char>(
+    StringPiece* src,
+    char delim,
+    signed char* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned char>(
+    StringPiece* src,
+    char delim,
+    unsigned char* out,
+    size_t n) noexcept;
+
+template Expected<size_t, ConversionCode> str_to_integers<short>(
+    StringPiece* src,
+    char delim,
+    short* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned short>(
+    StringPiece* src,
+    char delim,
+    unsigned short* out,
+    size_t n) noexcept;
+
+template Expected<size_t, ConversionCode> str_to_integers<int>(
+    StringPiece* src,
+    char delim,
+    int* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned int>(
+    StringPiece* src,
+    char delim,
+    unsigned int* out,
+    size_t n) noexcept;
+
+template Expected<size_t, ConversionCode> str_to_integers<long>(
+    StringPiece* src,
+    char delim,
+    long* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned long>(
+    StringPiece* src,
+    char delim,
+    unsigned long* out,
+    size_t n) noexcept;
+
+template Expected<size_t, ConversionCode> str_to_integers<long long>(
+    StringPiece* src,
+    char delim,
+    long long* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned long long>(
+    StringPiece* src,
+    char delim,
+    unsigned long long* out,
+    size_t n) noexcept;
+
+#if FOLLY_HAVE_INT128_T
+template Expected<size_t, ConversionCode> str_to_integers<__int128>(
+    StringPiece* src,
+    char delim,
+    __int128* out,
+    size_t n) noexcept;
+template Expected<size_t, ConversionCode> str_to_integers<unsigned __int128>(
+    StringPiece* src,
+    char delim,
+    unsigned __int128* out,
+    size_t n) noexcept;
+#endif
+
 } // namespace detail
 
 ConversionError makeConversionError(ConversionCode code, StringPiece input) {
@@ -27,6 +27,7 @@
 #include <cctype>
 #include <climits>
 #include <cstddef>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -34,6 +35,7 @@
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
+#include <vector>
 
 #include <boost/implicit_cast.hpp>
 #include <double-conversion/double-conversion.h> // V8 JavaScript implementation
@@ -45,6 +47,7 @@
 #include <folly/Range.h>
 #include <folly/Traits.h>
 #include <folly/Unit.h>
+#include <folly/detail/Dtoa.h>
 #include <folly/portability/Math.h>
 
 namespace folly {
@@ -360,6 +363,27 @@ inline uint32_t digits10(uint64_t v) {
 #endif
 }
 
+namespace detail {
+
+/**
+ * The 8 decimal digits of v < 10^8, leading zeros included, as ASCII in the
+ * bytes of a little-endian uint64_t: splits v into 2 halves of 4 digits,
+ * then 4 quarters of 2 digits, then digits, with all the parts of a step
+ * done at once in the lanes of a 64-bit integer.
+ */
+inline uint64_t eightDigitsToAscii(uint32_t v) {
+  uint64_t x = (v / 10000) | (uint64_t(v % 10000) << 32);
+  // x * 10486 >> 20 == x / 100 for x < 10000, and x * 103 >> 10 == x / 10
+  // for x < 100
+  auto const hundreds = ((x * 10486) >> 20) & 0x0000007f0000007f;
+  x = hundreds | ((x - 100 * hundreds) << 16);
+  auto const tens = ((x * 103) >> 10) & 0x000f000f000f000f;
+  x = tens | ((x - 10 * tens) << 8);
+  return x + 0x3030303030303030;
+}
+
+} // namespace detail
+
 /**
  * Copies the ASCII base 10 representation of v into buffer and
  * returns the number of bytes written. Does NOT append a \0. Assumes
@@ -375,6 +399,23 @@ inline uint32_t digits10(uint64_t v) {
 
 inline uint32_t uint64ToBufferUnsafe(uint64_t v, char *const buffer) {
   auto const result = digits10(v);
+  if (kIsLittleEndian) {
+    // 8 digits at a time, from the right
+    auto pos = result;
+    while (pos > 8) {
+      auto const q = v / 100000000;
+      auto const digits =
+          detail::eightDigitsToAscii(uint32_t(v - q * 100000000));
+      pos -= 8;
+      std::memcpy(buffer + pos, &digits, 8);
+      v = q;
+    }
+    // The first 1 to 8, without the leading zeros
+    auto const digits =
+        detail::eightDigitsToAscii(uint32_t(v)) >> (64 - 8 * pos);
+    std::memcpy(buffer, &digits, pos);
+    return result;
+  }
   // WARNING: using size_t or pointer arithmetic for pos slows down
   // the loop below 20x. This is because several 32-bit ops can be
   // done in parallel, but only fewer 64-bit ones.
@@ -669,7 +710,11 @@ constexpr int kConvMaxDecimalInShortestLow = -6;
 constexpr int kConvMaxDecimalInShortestHigh = 21;
 } // namespace detail
 
-/** Wrapper around DoubleToStringConverter **/
+/**
+ * Wrapper around DoubleToStringConverter.  The SHORTEST, SHORTEST_SINGLE and
+ * (mostly) FIXED modes are done by folly/detail/Dtoa.h instead, with the
+ * same output.
+ **/
 template <class Tgt, class Src>
 typename std::enable_if<
   std::is_floating_point<Src>::value
@@ -680,29 +725,46 @@ toAppend(
   double_conversion::DoubleToStringConverter::DtoaMode mode,
   unsigned int numDigits) {
   using namespace double_conversion;
-  DoubleToStringConverter
-    conv(DoubleToStringConverter::NO_FLAGS,
-         "Infinity", "NaN", 'E',
-         detail::kConvMaxDecimalInShortestLow,
-         detail::kConvMaxDecimalInShortestHigh,
-         6,   // max leading padding zeros
-         1);  // max trailing padding zeros
+  constexpr detail::DtoaFormat format{DoubleToStringConverter::NO_FLAGS,
+                                      "Infinity",
+                                      "NaN",
+                                      'E',
+                                      detail::kConvMaxDecimalInShortestLow,
+                                      detail::kConvMaxDecimalInShortestHigh};
   char buffer[256];
-  StringBuilder builder(buffer, sizeof(buffer));
+  size_t length = 0;
   switch (mode) {
     case DoubleToStringConverter::SHORTEST:
-      conv.ToShortest(value, &builder);
+      length = detail::dtoaShortest(value, format, buffer);
+      break;
+    case DoubleToStringConverter::SHORTEST_SINGLE:
+      length = detail::dtoaShortestSingle(static_cast<float>(value), format,
+                                          buffer);
       break;
     case DoubleToStringConverter::FIXED:
-      conv.ToFixed(value, int(numDigits), &builder);
+      length = detail::dtoaFixed(value, int(numDigits), format, buffer);
       break;
     default:
       CHECK(mode == DoubleToStringConverter::PRECISION);
-      conv.ToPrecision(value, int(numDigits), &builder);
       break;
   }
-  const size_t length = size_t(builder.position());
-  builder.Finalize();
+  if (length == 0) {
+    DoubleToStringConverter
+      conv(format.flags,
+           format.infinitySymbol, format.nanSymbol, format.exponentCharacter,
+           format.decimalInShortestLow,
+           format.decimalInShortestHigh,
+           6,   // max leading padding zeros
+           1);  // max trailing padding zeros
+    StringBuilder builder(buffer, sizeof(buffer));
+    if (mode == DoubleToStringConverter::FIXED) {
+      conv.ToFixed(value, int(numDigits), &builder);
+    } else {
+      conv.ToPrecision(value, int(numDigits), &builder);
+    }
+    length = size_t(builder.position());
+    builder.Finalize();
+  }
   result->append(buffer, length);
 }
 
@@ -1119,6 +1181,86 @@ extern template Expected<unsigned __int128, ConversionCode>
 str_to_integral<unsigned __int128>(StringPiece* src) noexcept;
 #endif
 
+template <typename T>
+Expected<size_t, ConversionCode>
+str_to_integers(StringPiece* src, char delim, T* out, size_t n) noexcept;
+
+extern template Expected<size_t, ConversionCode> str_to_integers<char>(
+    StringPiece* src,
+    char delim,
+    char* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode> str_to_integers<signed char>(
+    StringPiece* src,
+    char delim,
+    signed char* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode> str_to_integers<unsigned char>(
+    StringPiece* src,
+    char delim,
+    unsigned char* out,
+    size_t n) noexcept;
+
+extern template Expected<size_t, ConversionCode> str_to_integers<short>(
+    StringPiece* src,
+    char delim,
+    short* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode>
+str_to_integers<unsigned short>(
+    StringPiece* src,
+    char delim,
+    unsigned short* out,
+    size_t n) noexcept;
+
+extern template Expected<size_t, ConversionCode> str_to_integers<int>(
+    StringPiece* src,
+    char delim,
+    int* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode> str_to_integers<unsigned int>(
+    StringPiece* src,
+    char delim,
+    unsigned int* out,
+    size_t n) noexcept;
+
+extern template Expected<size_t, ConversionCode> str_to_integers<long>(
+    StringPiece* src,
+    char delim,
+    long* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode> str_to_integers<unsigned long>(
+    StringPiece* src,
+    char delim,
+    unsigned long* out,
+    size_t n) noexcept;
+
+extern template Expected<size_t, ConversionCode> str_to_integers<long long>(
+    StringPiece* src,
+    char delim,
+    long long* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode>
+str_to_integers<unsigned long long>(
+    StringPiece* src,
+    char delim,
+    unsigned long long* out,
+    size_t n) noexcept;
+
+#if FOLLY_HAVE_INT128_T
+extern template Expected<size_t, ConversionCode> str_to_integers<__int128>(
+    StringPiece* src,
+    char delim,
+    __int128* out,
+    size_t n) noexcept;
+extern template Expected<size_t, ConversionCode>
+str_to_integers<unsigned __int128>(
+    StringPiece* src,
+    char delim,
+    unsigned __int128* out,
+    size_t n) noexcept;
+#endif
+
 template <typename T>
 typename std::
     enable_if<std::is_same<T, bool>::value, Expected<T, ConversionCode>>::type
@@ -1168,6 +1310,53 @@ to(const char* b, const char* e) {
       });
 }
 
+/**
+ * Parses up to n integers separated by delim from the beginning of *src
+ * into out, each as to<Tgt>() would, and returns how many were parsed: n,
+ * or fewer if *src ran out.  *src is advanced past them and their
+ * delimiters.  On error, *src starts at the integer that couldn't be
+ * parsed, and the ones before it are in out.
+ *
+ * This avoids the overhead of splitting first, and of a call per integer,
+ * when parsing many of them, e.g. a line of a CSV file:
+ *
+ *   StringPiece line = "1,2,3";
+ *   int values[3];
+ *   auto n = tryToIntegers(&line, ',', values, 3); // 3, line is empty
+ */
+template <typename Tgt>
+typename std::enable_if<
+    std::is_integral<Tgt>::value && !std::is_same<Tgt, bool>::value,
+    Expected<size_t, ConversionCode>>::type
+tryToIntegers(StringPiece* src, char delim, Tgt* out, size_t n) noexcept {
+  return detail::str_to_integers<Tgt>(src, delim, out, n);
+}
+
+/**
+ * All the integers separated by delim in src.  Throws a ConversionError if
+ * one of them can't be parsed.
+ */
+template <typename Tgt>
+typename std::enable_if<
+    std::is_integral<Tgt>::value && !std::is_same<Tgt, bool>::value,
+    std::vector<Tgt>>::type
+toIntegers(StringPiece src, char delim) {
+  constexpr size_t kBatchSize = 64;
+  std::vector<Tgt> result;
+  while (!src.empty()) {
+    auto size = result.size();
+    result.resize(size + kBatchSize);
+    auto count =
+        tryToIntegers<Tgt>(&src, delim, result.data() + size, kBatchSize);
+    if (UNLIKELY(!count.hasValue())) {
+      throw makeConversionError(
+          count.error(), src.subpiece(0, src.find(delim)));
+    }
+    result.resize(size + count.value());
+  }
+  return result;
+}
+
 /*******************************************************************************
  * Conversions from string types to arithmetic types.
  ******************************************************************************/
@@ -203,6 +203,8 @@ class CpuId {
 #define C(name, bit) X(name, f7c_, bit)
   C(prefetchwt1, 0)
   C(avx512vbmi, 1)
+  C(vpclmulqdq, 10)
+  C(avx512vpopcntdq, 14)
 #undef C
 
 #undef X
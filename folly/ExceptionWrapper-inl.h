@@ -100,6 +100,24 @@ static_assert(
     "exception_wrapper is untested and possibly broken on your version of "
     "MSVC");
 
+template <class Ex>
+inline exception_wrapper exception_wrapper::copy_to_exception_ptr_(
+    Ex const& ex) {
+#if defined(__GLIBCXX__)
+  // make_exception_ptr constructs the copy in place, and an exception_ptr
+  // is nothing but a pointer to the thrown object
+  auto ptr = std::make_exception_ptr(ex);
+  auto object = reinterpret_cast<void* const&>(ptr);
+  return exception_wrapper{std::move(ptr), *static_cast<Ex*>(object)};
+#else
+  try {
+    throw ex; // @nolint
+  } catch (Ex& e) {
+    return exception_wrapper{std::current_exception(), e};
+  }
+#endif
+}
+
 inline std::uintptr_t exception_wrapper::ExceptionPtr::as_int_(
     std::exception_ptr const& ptr,
     std::exception const& e) {
@@ -220,11 +238,7 @@ inline std::exception const* exception_wrapper::InPlace<Ex>::get_exception_(
 template <class Ex>
 inline exception_wrapper exception_wrapper::InPlace<Ex>::get_exception_ptr_(
     exception_wrapper const* that) {
-  try {
-    throw_(that);
-  } catch (Ex const& ex) {
-    return exception_wrapper{std::current_exception(), ex};
-  }
+  return copy_to_exception_ptr_(that->buff_.as<Ex>());
 }
 
 template <class Ex>
@@ -240,11 +254,7 @@ exception_wrapper::SharedPtr::Impl<Ex>::get_exception_() const noexcept {
 template <class Ex>
 inline exception_wrapper
 exception_wrapper::SharedPtr::Impl<Ex>::get_exception_ptr_() const noexcept {
-  try {
-    throw_();
-  } catch (Ex& ex) {
-    return exception_wrapper{std::current_exception(), ex};
-  }
+  return copy_to_exception_ptr_(ex_);
 }
 inline void exception_wrapper::SharedPtr::copy_(
     exception_wrapper const* from, exception_wrapper* to) {
@@ -569,6 +579,14 @@ struct exception_wrapper::HandleStdExceptReduce {
 template <class This, class... CatchFns>
 inline void exception_wrapper::handle_(
     std::false_type, This& this_, CatchFns&... fns) {
+  // dynamic_cast can still match a std::exception against handlers for
+  // classes that don't derive from it, so only non-class handlers, or an
+  // exception that isn't a std::exception, need a throw.
+  using AllClasses = exception_wrapper_detail::
+      AllOf<IsClassException, arg_type<CatchFns>...>;
+  if (AllClasses::value && this_.vptr_->get_exception_(&this_)) {
+    return handle_(AllClasses{}, this_, fns...);
+  }
   bool handled = false;
   auto impl = exception_wrapper_detail::fold(
       HandleReduce<std::is_const<This>::value>{&handled},
@@ -594,8 +612,8 @@ inline void exception_wrapper::handle_(
   // This continuation gets evaluated if CatchFns... does not include a
   // catch-all handler. It is a no-op.
   auto continuation = [](StdEx* ex) { return ex; };
-  if (StdEx* e = impl(continuation)) {
-    throw *e; // Not handled. Throw.
+  if (impl(continuation)) {
+    this_.throw_exception(); // Not handled. Throw.
   }
 }
 
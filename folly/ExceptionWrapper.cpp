@@ -16,6 +16,7 @@
 #include <folly/ExceptionWrapper.h>
 
 #include <iostream>
+#include <typeinfo>
 
 #include <folly/Logging.h>
 
@@ -48,36 +49,42 @@ exception_wrapper::VTable const exception_wrapper::SharedPtr::ops_{
     get_exception_,
     get_exception_ptr_};
 
-namespace {
-std::exception const* get_std_exception_(std::exception_ptr eptr) noexcept {
+std::exception* exception_wrapper::exception_ptr_get_std_exception_(
+    std::exception_ptr const& ptr) noexcept {
+#if defined(__GLIBCXX__)
+  // The exception_ptr points at the thrown object, and its type_info can
+  // do the conversion a catch clause would do, without the unwinder
+  auto object = reinterpret_cast<void* const&>(ptr);
+  auto type = ptr.__cxa_exception_type();
+  return type && typeid(std::exception).__do_catch(type, &object, 1)
+      ? static_cast<std::exception*>(object)
+      : nullptr;
+#else
   try {
-    std::rethrow_exception(eptr);
-  } catch (const std::exception& ex) {
+    std::rethrow_exception(ptr);
+  } catch (std::exception& ex) {
     return &ex;
   } catch (...) {
     return nullptr;
   }
+#endif
 }
-} // namespace
 
 exception_wrapper exception_wrapper::from_exception_ptr(
     std::exception_ptr const& ptr) noexcept {
   if (!ptr) {
     return exception_wrapper();
   }
-  try {
-    std::rethrow_exception(ptr);
-  } catch (std::exception& e) {
-    return exception_wrapper(std::current_exception(), e);
-  } catch (...) {
-    return exception_wrapper(std::current_exception());
+  if (auto e = exception_ptr_get_std_exception_(ptr)) {
+    return exception_wrapper(ptr, *e);
   }
+  return exception_wrapper(ptr);
 }
 
 exception_wrapper::exception_wrapper(std::exception_ptr ptr) noexcept
     : exception_wrapper{} {
   if (ptr) {
-    if (auto e = get_std_exception_(ptr)) {
+    if (auto e = exception_ptr_get_std_exception_(ptr)) {
       LOG(DFATAL)
           << "Performance error: Please construct exception_wrapper with a "
              "reference to the std::exception along with the "
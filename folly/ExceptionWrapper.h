@@ -206,8 +206,19 @@ class exception_wrapper final {
 
   static VTable const uninit_;
 
+  // The std::exception thrown into ptr, or nullptr if it isn't one. With
+  // libstdc++ this reads the exception_ptr rather than rethrowing it.
+  static std::exception* exception_ptr_get_std_exception_(
+      std::exception_ptr const& ptr) noexcept;
+
+  // A copy of ex in a new exception_ptr. With libstdc++ it is never thrown.
+  template <class Ex>
+  static exception_wrapper copy_to_exception_ptr_(Ex const& ex);
+
   template <class Ex>
   using IsStdException = std::is_base_of<std::exception, _t<std::decay<Ex>>>;
+  template <class Ex>
+  using IsClassException = std::is_class<_t<std::decay<Ex>>>;
   template <bool B, class T>
   using AddConstIf = exception_wrapper_detail::AddConstIf<B, T>;
   template <class CatchFn>
@@ -475,8 +486,10 @@ class exception_wrapper final {
   //!     whose type `From` permits `std::is_convertible<From*, Ex*>`;
   //!     otherwise, returns `nullptr`.
   //! \note This function does not mutate the `exception_wrapper` object.
-  //! \note This function may cause an exception to be thrown and immediately
-  //!     caught internally, affecting runtime performance.
+  //! \note If the wrapped exception doesn't derive from `std::exception`,
+  //!     or `Ex` isn't a class type, this function may cause an exception to
+  //!     be thrown and immediately caught internally, affecting runtime
+  //!     performance. Otherwise it uses `dynamic_cast`.
   template <typename Ex>
   Ex* get_exception() noexcept;
   //! \overload
@@ -485,7 +498,8 @@ class exception_wrapper final {
 
   //! \return A `std::exception_ptr` that references either the exception held
   //!     by `*this`, or a copy of same.
-  //! \note This function may need to throw an exception to complete the action.
+  //! \note This function may need to throw an exception to complete the
+  //!     action, though not with libstdc++.
   //! \note The non-const overload of this function mutates `*this` to cache the
   //!     computed `std::exception_ptr`; that is, this function may cause
   //!     `has_exception_ptr()` to change from `false` to `true`.
@@ -198,6 +198,33 @@ inline void podMove(const Pod* b, const Pod* e, Pod* d) {
 # define FBSTRING_ALWAYS_INLINE inline
 #endif
 
+/*
+ * Drop-in for std::atomic<size_t> used by strings that are never shared
+ * across threads
+ */
+class NonAtomicRefCount {
+ public:
+  size_t load(std::memory_order) const {
+    return count_;
+  }
+  void store(size_t count, std::memory_order) {
+    count_ = count;
+  }
+  size_t fetch_add(size_t delta, std::memory_order) {
+    auto const old = count_;
+    count_ += delta;
+    return old;
+  }
+  size_t fetch_sub(size_t delta, std::memory_order) {
+    auto const old = count_;
+    count_ -= delta;
+    return old;
+  }
+
+ private:
+  size_t count_;
+};
+
 [[noreturn]] FBSTRING_ALWAYS_INLINE void assume_unreachable() {
 #if defined(__GNUC__) // Clang also defines __GNUC__
   __builtin_unreachable();
@@ -219,6 +246,56 @@ inline void podMove(const Pod* b, const Pod* e, Pod* d) {
  */
 enum class AcquireMallocatedString {};
 
+/**
+ * Allocates the heap blocks of medium and large strings. The hooks are
+ * static so that fbstring_core stays three words wide; an allocator that
+ * draws from an Arena has to reach it through a static or thread-local
+ * pointer (and can make deallocate() a no-op). reallocate() receives the
+ * number of bytes in use, the current block size and the requested block
+ * size, like smartRealloc().
+ */
+struct fbstring_malloc_allocator {
+  static void* allocate(size_t size) {
+    return checkedMalloc(size);
+  }
+  static void* reallocate(
+      void* p,
+      size_t currentSize,
+      size_t currentCapacity,
+      size_t newCapacity) {
+    return smartRealloc(p, currentSize, currentCapacity, newCapacity);
+  }
+  static void deallocate(void* p) {
+    free(p);
+  }
+};
+
+/**
+ * Compile-time knobs for fbstring_core:
+ *
+ * ThreadSafeRefCount: large strings are shared with an atomic reference
+ * count. Turning this off makes copies of large strings cheaper, but such
+ * strings (and their copies) must then stay on a single thread.
+ *
+ * CopyOnWrite: if false there are no large strings at all; anything that
+ * doesn't fit in situ is a medium string and copied eagerly.
+ *
+ * Allocator: see fbstring_malloc_allocator.
+ */
+template <
+    bool ThreadSafeRefCount = true,
+    bool CopyOnWrite = true,
+    class Allocator = fbstring_malloc_allocator>
+struct fbstring_policy {
+  static constexpr bool kThreadSafeRefCount = ThreadSafeRefCount;
+  static constexpr bool kCopyOnWrite = CopyOnWrite;
+  typedef Allocator allocator;
+};
+
+typedef fbstring_policy<> fbstring_default_policy;
+typedef fbstring_policy<false> fbstring_nonatomic_policy;
+typedef fbstring_policy<true, false> fbstring_nocow_policy;
+
 /*
  * fbstring_core_model is a mock-up type that defines all required
  * signatures of a fbstring core. The fbstring class itself uses such
@@ -311,8 +388,13 @@ class fbstring_core_model {
  * big-endian, these 2 bits are the 2 LSbs. This keeps both little-endian
  * and big-endian fbstring_core equivalent with merely different ops used
  * to extract capacity/category.
+ *
+ * The Policy parameter (see fbstring_policy) selects a non-atomic
+ * reference count for large strings, disables copy-on-write by never
+ * creating large strings, or supplies the allocator of the heap blocks.
  */
-template <class Char> class fbstring_core {
+template <class Char, class Policy = fbstring_default_policy>
+class fbstring_core {
  protected:
 // It's MSVC, so we just have to guess ... and allow an override
 #ifdef _MSC_VER
@@ -326,6 +408,8 @@ template <class Char> class fbstring_core {
       __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
 #endif
  public:
+  typedef typename Policy::allocator Allocator;
+
   fbstring_core() noexcept { reset(); }
 
   fbstring_core(const fbstring_core & rhs) {
@@ -387,7 +471,7 @@ template <class Char> class fbstring_core {
                 const size_t size,
                 const size_t allocatedSize,
                 AcquireMallocatedString) {
-    if (size > 0) {
+    if (size > 0 && kMallocAllocator) {
       FBSTRING_ASSERT(allocatedSize >= size + 1);
       FBSTRING_ASSERT(data[size] == '\0');
       // Use the medium string storage
@@ -396,9 +480,13 @@ template <class Char> class fbstring_core {
       // Don't forget about null terminator
       ml_.setCapacity(allocatedSize - 1, Category::isMedium);
     } else {
+      reset();
+      if (size > 0) {
+        // The block can't be handed to a custom allocator, so copy it
+        fbstring_core(data, size).swap(*this);
+      }
       // No need for the memory
       free(data);
-      reset();
     }
   }
 
@@ -524,14 +612,19 @@ template <class Char> class fbstring_core {
     auto const c = category();
     FBSTRING_ASSERT(c != Category::isSmall);
     if (c == Category::isMedium) {
-      free(ml_.data_);
+      Allocator::deallocate(ml_.data_);
     } else {
       RefCounted::decrementRefs(ml_.data_);
     }
   }
 
+  typedef typename std::conditional<
+      Policy::kThreadSafeRefCount,
+      std::atomic<size_t>,
+      fbstring_detail::NonAtomicRefCount>::type RefCount;
+
   struct RefCounted {
-    std::atomic<size_t> refCount_;
+    RefCount refCount_;
     Char data_[1];
 
     constexpr static size_t getDataOffset() {
@@ -557,14 +650,14 @@ template <class Char> class fbstring_core {
       size_t oldcnt = dis->refCount_.fetch_sub(1, std::memory_order_acq_rel);
       FBSTRING_ASSERT(oldcnt > 0);
       if (oldcnt == 1) {
-        free(dis);
+        Allocator::deallocate(dis);
       }
     }
 
     static RefCounted * create(size_t * size) {
       const size_t allocSize =
           goodMallocSize(getDataOffset() + (*size + 1) * sizeof(Char));
-      auto result = static_cast<RefCounted*>(checkedMalloc(allocSize));
+      auto result = static_cast<RefCounted*>(Allocator::allocate(allocSize));
       result->refCount_.store(1, std::memory_order_release);
       *size = (allocSize - getDataOffset()) / sizeof(Char) - 1;
       return result;
@@ -588,7 +681,7 @@ template <class Char> class fbstring_core {
           goodMallocSize(getDataOffset() + (*newCapacity + 1) * sizeof(Char));
       auto const dis = fromData(data);
       FBSTRING_ASSERT(dis->refCount_.load(std::memory_order_acquire) == 1);
-      auto result = static_cast<RefCounted*>(smartRealloc(
+      auto result = static_cast<RefCounted*>(Allocator::reallocate(
           dis,
           getDataOffset() + (currentSize + 1) * sizeof(Char),
           getDataOffset() + (currentCapacity + 1) * sizeof(Char),
@@ -638,7 +731,12 @@ template <class Char> class fbstring_core {
 
   constexpr static size_t lastChar = sizeof(MediumLarge) - 1;
   constexpr static size_t maxSmallSize = lastChar / sizeof(Char);
-  constexpr static size_t maxMediumSize = 254 / sizeof(Char);
+  // Without copy-on-write every heap-allocated string is medium
+  constexpr static size_t maxMediumSize = Policy::kCopyOnWrite
+      ? 254 / sizeof(Char)
+      : std::numeric_limits<size_t>::max();
+  constexpr static bool kMallocAllocator =
+      std::is_same<Allocator, fbstring_malloc_allocator>::value;
   constexpr static uint8_t categoryExtractMask = kIsLittleEndian ? 0xC0 : 0x3;
   constexpr static size_t kCategoryShift = (sizeof(size_t) - 1) * 8;
   constexpr static size_t capacityExtractMask = kIsLittleEndian
@@ -687,8 +785,8 @@ template <class Char> class fbstring_core {
   Char* mutableDataLarge();
 };
 
-template <class Char>
-inline void fbstring_core<Char>::copySmall(const fbstring_core& rhs) {
+template <class Char, class Policy>
+inline void fbstring_core<Char, Policy>::copySmall(const fbstring_core& rhs) {
   static_assert(offsetof(MediumLarge, data_) == 0, "fbstring layout failure");
   static_assert(
       offsetof(MediumLarge, size_) == sizeof(ml_.data_),
@@ -706,13 +804,13 @@ inline void fbstring_core<Char>::copySmall(const fbstring_core& rhs) {
       category() == Category::isSmall && this->size() == rhs.size());
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::copyMedium(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::copyMedium(
     const fbstring_core& rhs) {
   // Medium strings are copied eagerly. Don't forget to allocate
   // one extra Char for the null terminator.
   auto const allocSize = goodMallocSize((1 + rhs.ml_.size_) * sizeof(Char));
-  ml_.data_ = static_cast<Char*>(checkedMalloc(allocSize));
+  ml_.data_ = static_cast<Char*>(Allocator::allocate(allocSize));
   // Also copies terminator.
   fbstring_detail::podCopy(
       rhs.ml_.data_, rhs.ml_.data_ + rhs.ml_.size_ + 1, ml_.data_);
@@ -721,8 +819,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::copyMedium(
   FBSTRING_ASSERT(category() == Category::isMedium);
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::copyLarge(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::copyLarge(
     const fbstring_core& rhs) {
   // Large strings are just refcounted
   ml_ = rhs.ml_;
@@ -731,8 +829,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::copyLarge(
 }
 
 // Small strings are bitblitted
-template <class Char>
-inline void fbstring_core<Char>::initSmall(
+template <class Char, class Policy>
+inline void fbstring_core<Char, Policy>::initSmall(
     const Char* const data, const size_t size) {
   // Layout is: Char* data_, size_t size_, size_t capacity_
   static_assert(
@@ -777,13 +875,13 @@ inline void fbstring_core<Char>::initSmall(
   setSmallSize(size);
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::initMedium(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::initMedium(
     const Char* const data, const size_t size) {
   // Medium strings are allocated normally. Don't forget to
   // allocate one extra Char for the terminating null.
   auto const allocSize = goodMallocSize((1 + size) * sizeof(Char));
-  ml_.data_ = static_cast<Char*>(checkedMalloc(allocSize));
+  ml_.data_ = static_cast<Char*>(Allocator::allocate(allocSize));
   if (FBSTRING_LIKELY(size > 0)) {
     fbstring_detail::podCopy(data, data + size, ml_.data_);
   }
@@ -792,8 +890,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::initMedium(
   ml_.data_[size] = '\0';
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::initLarge(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::initLarge(
     const Char* const data, const size_t size) {
   // Large strings are allocated differently
   size_t effectiveCapacity = size;
@@ -804,8 +902,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::initLarge(
   ml_.data_[size] = '\0';
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::unshare(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::unshare(
     size_t minCapacity) {
   FBSTRING_ASSERT(category() == Category::isLarge);
   size_t effectiveCapacity = std::max(minCapacity, ml_.capacity());
@@ -821,8 +919,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::unshare(
   // size_ remains unchanged.
 }
 
-template <class Char>
-inline Char* fbstring_core<Char>::mutableDataLarge() {
+template <class Char, class Policy>
+inline Char* fbstring_core<Char, Policy>::mutableDataLarge() {
   FBSTRING_ASSERT(category() == Category::isLarge);
   if (RefCounted::refs(ml_.data_) > 1) { // Ensure unique.
     unshare();
@@ -830,8 +928,8 @@ inline Char* fbstring_core<Char>::mutableDataLarge() {
   return ml_.data_;
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveLarge(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::reserveLarge(
     size_t minCapacity) {
   FBSTRING_ASSERT(category() == Category::isLarge);
   if (RefCounted::refs(ml_.data_) > 1) { // Ensure unique
@@ -854,8 +952,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveLarge(
   }
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveMedium(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::reserveMedium(
     const size_t minCapacity) {
   FBSTRING_ASSERT(category() == Category::isMedium);
   // String is not shared
@@ -867,7 +965,7 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveMedium(
     // one extra Char for the terminating null.
     size_t capacityBytes = goodMallocSize((1 + minCapacity) * sizeof(Char));
     // Also copies terminator.
-    ml_.data_ = static_cast<Char*>(smartRealloc(
+    ml_.data_ = static_cast<Char*>(Allocator::reallocate(
         ml_.data_,
         (ml_.size_ + 1) * sizeof(Char),
         (ml_.capacity() + 1) * sizeof(Char),
@@ -887,8 +985,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveMedium(
   }
 }
 
-template <class Char>
-FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveSmall(
+template <class Char, class Policy>
+FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char, Policy>::reserveSmall(
     size_t minCapacity, const bool disableSSO) {
   FBSTRING_ASSERT(category() == Category::isSmall);
   if (!disableSSO && minCapacity <= maxSmallSize) {
@@ -899,7 +997,7 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveSmall(
     // Don't forget to allocate one extra Char for the terminating null
     auto const allocSizeBytes =
         goodMallocSize((1 + minCapacity) * sizeof(Char));
-    auto const pData = static_cast<Char*>(checkedMalloc(allocSizeBytes));
+    auto const pData = static_cast<Char*>(Allocator::allocate(allocSizeBytes));
     auto const size = smallSize();
     // Also copies terminator.
     fbstring_detail::podCopy(small_, small_ + size + 1, pData);
@@ -919,8 +1017,8 @@ FOLLY_MALLOC_NOINLINE inline void fbstring_core<Char>::reserveSmall(
   }
 }
 
-template <class Char>
-inline Char* fbstring_core<Char>::expandNoinit(
+template <class Char, class Policy>
+inline Char* fbstring_core<Char, Policy>::expandNoinit(
     const size_t delta,
     bool expGrowth, /* = false */
     bool disableSSO /* = FBSTRING_DISABLE_SSO */) {
@@ -954,15 +1052,15 @@ inline Char* fbstring_core<Char>::expandNoinit(
   return ml_.data_ + sz;
 }
 
-template <class Char>
-inline void fbstring_core<Char>::shrinkSmall(const size_t delta) {
+template <class Char, class Policy>
+inline void fbstring_core<Char, Policy>::shrinkSmall(const size_t delta) {
   // Check for underflow
   FBSTRING_ASSERT(delta <= smallSize());
   setSmallSize(smallSize() - delta);
 }
 
-template <class Char>
-inline void fbstring_core<Char>::shrinkMedium(const size_t delta) {
+template <class Char, class Policy>
+inline void fbstring_core<Char, Policy>::shrinkMedium(const size_t delta) {
   // Medium strings and unique large strings need no special
   // handling.
   FBSTRING_ASSERT(ml_.size_ >= delta);
@@ -970,8 +1068,8 @@ inline void fbstring_core<Char>::shrinkMedium(const size_t delta) {
   ml_.data_[ml_.size_] = '\0';
 }
 
-template <class Char>
-inline void fbstring_core<Char>::shrinkLarge(const size_t delta) {
+template <class Char, class Policy>
+inline void fbstring_core<Char, Policy>::shrinkLarge(const size_t delta) {
   FBSTRING_ASSERT(ml_.size_ >= delta);
   // Shared large string, must make unique. This is because of the
   // durn terminator must be written, which may trample the shared
@@ -39,6 +39,7 @@
 #include <folly/Likely.h>
 #include <folly/Traits.h>
 #include <folly/memory/Malloc.h>
+#include <folly/memory/Relocate.h>
 #include <folly/portability/BitsFunctexcept.h>
 
 //=============================================================================
@@ -635,9 +636,7 @@ class fbvector {
   }
 
   // dispatch type trait
-  typedef std::integral_constant<bool,
-      folly::IsRelocatable<T>::value && usingStdAllocator::value
-    > relocate_use_memcpy;
+  typedef folly::IsRelocatableWith<T, Allocator> relocate_use_memcpy;
 
   typedef std::integral_constant<bool,
       (std::is_nothrow_move_constructible<T>::value
@@ -651,9 +650,7 @@ class fbvector {
   }
 
   void relocate_move_or_memcpy(T* dest, T* first, T* last, std::true_type) {
-    if (first != nullptr) {
-      std::memcpy((void*)dest, (void*)first, (last - first) * sizeof(T));
-    }
+    folly::uninitialized_relocate(first, last, dest);
   }
 
   void relocate_move_or_memcpy(T* dest, T* first, T* last, std::false_type) {
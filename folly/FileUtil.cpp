@@ -16,7 +16,9 @@
 
 #include <folly/FileUtil.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <memory>
 
 #include <folly/Exception.h>
 #include <folly/detail/FileUtilDetail.h>
@@ -25,6 +27,7 @@
 #include <folly/portability/Stdlib.h>
 #include <folly/portability/SysFile.h>
 #include <folly/portability/SysStat.h>
+#include <folly/portability/SysSyscall.h>
 
 namespace folly {
 
@@ -145,6 +148,62 @@ ssize_t pwritevFull(int fd, iovec* iov, int count, off_t offset) {
   return wrapvFull(pwritev, fd, iov, count, offset);
 }
 
+ssize_t pcopyFull(
+    int inFd,
+    off_t inOffset,
+    int outFd,
+    off_t outOffset,
+    size_t n) {
+  size_t copied = 0;
+#if defined(__linux__) && defined(SYS_copy_file_range)
+  while (copied < n) {
+    loff_t in = inOffset + off_t(copied);
+    loff_t out = outOffset + off_t(copied);
+    auto r = wrapNoInt([&] {
+      return syscall(
+          SYS_copy_file_range, inFd, &in, outFd, &out, n - copied, 0);
+    });
+    if (r == -1) {
+      // Unsupported by the kernel or the filesystems, or across them
+      if (errno != ENOSYS && errno != EXDEV && errno != EINVAL &&
+          errno != EOPNOTSUPP) {
+        return -1;
+      }
+      break;
+    }
+    if (r == 0) {
+      // Some special files report no data to copy_file_range() even though
+      // read() has some, so only trust the end of the input from read()
+      break;
+    }
+    copied += size_t(r);
+  }
+#endif
+
+  constexpr size_t kBufferSize = size_t(1) << 20;
+  std::unique_ptr<char[]> buf;
+  while (copied < n) {
+    if (!buf) {
+      buf.reset(new char[std::min(n - copied, kBufferSize)]);
+    }
+    auto const len = std::min(n - copied, kBufferSize);
+    auto r = preadFull(inFd, buf.get(), len, inOffset + off_t(copied));
+    if (r == -1) {
+      return -1;
+    }
+    if (r > 0 &&
+        pwriteFull(outFd, buf.get(), size_t(r), outOffset + off_t(copied)) ==
+            -1) {
+      return -1;
+    }
+    copied += size_t(r);
+    if (size_t(r) < len) {
+      break; // End of the input
+    }
+  }
+  return ssize_t(copied);
+}
+
 int writeFileAtomicNoThrow(
     StringPiece filename,
     iovec* iov,
@@ -105,6 +105,23 @@ ssize_t pwriteFull(int fd, const void* buf, size_t n, off_t offset);
 ssize_t writevFull(int fd, iovec* iov, int count);
 ssize_t pwritevFull(int fd, iovec* iov, int count, off_t offset);
 
+/**
+ * Copy n bytes from inFd at inOffset to outFd at outOffset, without
+ * changing either file offset.  On Linux, the data is copied in the kernel
+ * with copy_file_range() when the files allow it; otherwise, it goes
+ * through a buffer with pread() and pwrite().  Loops until n bytes are
+ * copied, or the end of the input.
+ *
+ * Returns -1 on error, or the number of bytes copied, which is less than n
+ * only at the end of the input.
+ */
+ssize_t pcopyFull(
+    int inFd,
+    off_t inOffset,
+    int outFd,
+    off_t outOffset,
+    size_t n);
+
 /**
  * Read entire file (if num_bytes is defaulted) or no more than
  * num_bytes (otherwise) into container *out. The container is assumed
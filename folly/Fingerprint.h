@@ -45,8 +45,11 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
+#include <folly/Bits.h>
 #include <folly/Range.h>
+#include <folly/detail/FingerprintClmul.h>
 
 namespace folly {
 
@@ -132,7 +135,11 @@ class Fingerprint {
   }
 
   Fingerprint& update(StringPiece str) {
-    // TODO(tudorb): We could be smart and do update64 or update32 if aligned
+    updateBlocks(str, std::integral_constant<bool, BITS == 64>());
+    while (str.size() >= 8) {
+      update64(Endian::big(loadUnaligned<uint64_t>(str.data())));
+      str.advance(8);
+    }
     for (auto c : str) {
       update8(uint8_t(c));
     }
@@ -161,6 +168,17 @@ class Fingerprint {
   }
 
  private:
+  // Fingerprint<64> folds long strings 16 bytes at a time with carry-less
+  // multiplication, where the CPU has it; str is advanced past the bytes
+  // that were folded.
+  void updateBlocks(StringPiece& str, std::true_type) {
+    if (str.size() >= detail::kFingerprintClmulMinSize) {
+      str.advance(detail::fingerprint64Clmul(
+          fp_, reinterpret_cast<const uint8_t*>(str.data()), str.size()));
+    }
+  }
+  void updateBlocks(StringPiece&, std::false_type) {}
+
   // XOR the fingerprint with a value from one of the tables.
   void xortab(const uint64_t* tab) {
     for (int i = 0; i < size(); i++) {
@@ -18,6 +18,7 @@
 
 #include <folly/ConstexprMath.h>
 #include <folly/CppAttributes.h>
+#include <folly/detail/Dtoa.h>
 
 #include <double-conversion/double-conversion.h>
 
@@ -79,6 +80,8 @@ void FormatValue<double>::formatHelper(
                        : 0);
 
   double val = val_;
+  // Set by the conversions that don't go through builder
+  size_t length = 0;
   switch (arg.presentation) {
   case '%':
     val *= 100;
@@ -90,6 +93,14 @@ void FormatValue<double>::formatHelper(
           DoubleToStringConverter::kMaxFixedDigitsAfterPoint) {
         arg.precision = DoubleToStringConverter::kMaxFixedDigitsAfterPoint;
       }
+      length = dtoaFixed(
+          val,
+          arg.precision,
+          DtoaFormat{flags, infinitySymbol, nanSymbol, exponentSymbol, -4, 0},
+          buf + 1);
+      if (length != 0) {
+        break;
+      }
       DoubleToStringConverter conv(flags,
                                    infinitySymbol,
                                    nanSymbol,
@@ -130,23 +141,26 @@ void FormatValue<double>::formatHelper(
                  DoubleToStringConverter::kMaxPrecisionDigits) {
         arg.precision = DoubleToStringConverter::kMaxPrecisionDigits;
       }
-      DoubleToStringConverter conv(flags,
-                                   infinitySymbol,
-                                   nanSymbol,
-                                   exponentSymbol,
-                                   -4,
-                                   arg.precision,
-                                   0,
-                                   0);
-      arg.enforce(conv.ToShortest(val, &builder));
+      length = dtoaShortest(
+          val,
+          DtoaFormat{flags,
+                     infinitySymbol,
+                     nanSymbol,
+                     exponentSymbol,
+                     -4,
+                     arg.precision},
+          buf + 1);
     }
     break;
   default:
     arg.error("invalid specifier '", arg.presentation, "'");
   }
 
-  int len = builder.position();
-  builder.Finalize();
+  int len = int(length);
+  if (length == 0) {
+    len = builder.position();
+    builder.Finalize();
+  }
   DCHECK_GT(len, 0);
 
   // Add '+' or ' ' sign if needed
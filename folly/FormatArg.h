@@ -58,6 +58,26 @@ struct FormatArg {
     }
   }
 
+  /**
+   * An argument that was parsed at compile time (see CompiledFormat.h):
+   * key is what remains of the key after the argument index, and the
+   * caller fills in the format spec.  Nothing is parsed here.
+   */
+  FormatArg(StringPiece sp, StringPiece key)
+    : fullArgString(sp),
+      fill(kDefaultFill),
+      align(Align::DEFAULT),
+      sign(Sign::DEFAULT),
+      basePrefix(false),
+      thousandsSeparator(false),
+      trailingDot(false),
+      width(kDefaultWidth),
+      widthIndex(kNoIndex),
+      precision(kDefaultPrecision),
+      presentation(kDefaultPresentation),
+      key_(key),
+      nextKeyMode_(NextKeyMode::NONE) {}
+
   enum class Type {
     INTEGER,
     FLOAT,
@@ -213,10 +213,31 @@
  * However, in that case what you do is potentially dangerous and requires
  * the equivalent of a `const_cast`, hence you need to call
  * `constCastFunction`.
+ *
+ * Inline capacity and allocation:
+ *
+ * A `folly::Function` stores callables of up to `InlineSize` bytes (6
+ * pointers by default) that are nothrow-move-constructible in itself, and
+ * larger ones on the heap. Lambdas that capture a little more than that
+ * (e.g. tasks handed to executors) can use a larger buffer instead:
+ *
+ *     folly::Function<void(), 96> task = [a, b, c, d, e, f, g]() { ... };
+ *
+ * A `Function` is movable into a `Function` of the same or other-constness
+ * signature with a different `InlineSize` without allocating, unless the
+ * callable is stored inline in the source and does not fit in the
+ * destination, in which case the source is moved to the heap as a whole.
+ *
+ * Callables that don't fit can be allocated with an allocator, such as a
+ * `SlabPoolAllocator` (folly/memory/SlabPool.h), which caches memory per
+ * thread:
+ *
+ *     folly::Function<void()> task{std::allocator_arg, alloc, lambda};
  */
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <new>
@@ -230,40 +251,54 @@
 
 namespace folly {
 
-template <typename FunctionType>
+template <typename FunctionType, std::size_t InlineSize = 6 * sizeof(void*)>
 class Function;
 
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const> constCastFunction(
-    Function<ReturnType(Args...)>&&) noexcept;
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const, InlineSize> constCastFunction(
+    Function<ReturnType(Args...), InlineSize>&&) noexcept;
 
 #if FOLLY_HAVE_NOEXCEPT_FUNCTION_TYPE
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const noexcept> constCastFunction(
-    Function<ReturnType(Args...) noexcept>&&) noexcept;
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const noexcept, InlineSize> constCastFunction(
+    Function<ReturnType(Args...) noexcept, InlineSize>&&) noexcept;
 #endif
 
 namespace detail {
 namespace function {
 
-enum class Op { MOVE, NUKE, FULL, HEAP };
+enum class Op { MOVE, NUKE, FULL, HEAP, SIZE };
 
+// What the call and exec functions see of a Function's storage, whatever
+// its size: `tiny` is the start of the inline buffer, which extends to the
+// end of the enclosing Storage.
 union Data {
   void* big;
-  std::aligned_storage<6 * sizeof(void*)>::type tiny;
+  std::aligned_storage<sizeof(void*)>::type tiny;
 };
 
-template <typename Fun, typename = Fun*>
+// The inline buffer is aligned for any scalar type whatever its size, so
+// that callables fitting one Storage fit any other as large
+template <std::size_t Size>
+union Storage {
+  Data data;
+  typename std::aligned_storage<Size, alignof(std::max_align_t)>::type tiny;
+};
+
+template <typename Fun, std::size_t Size, typename = Fun*>
 using IsSmall = Conjunction<
-    std::integral_constant<bool, (sizeof(Fun) <= sizeof(Data::tiny))>,
+    std::integral_constant<
+        bool,
+        (sizeof(Fun) <= sizeof(Storage<Size>) &&
+         alignof(Fun) <= alignof(Storage<Size>))>,
     std::is_nothrow_move_constructible<Fun>>;
 using SmallTag = std::true_type;
 using HeapTag = std::false_type;
 
 template <typename T>
 struct NotFunction : std::true_type {};
-template <typename T>
-struct NotFunction<Function<T>> : std::false_type {};
+template <typename T, std::size_t Size>
+struct NotFunction<Function<T, Size>> : std::false_type {};
 
 template <typename T>
 using EnableIfNotFunction =
@@ -280,15 +315,15 @@ std::false_type isNullPtrFn(T&&) {
   return {};
 }
 
-inline bool uninitNoop(Op, Data*, Data*) {
-  return false;
+inline std::size_t uninitNoop(Op, Data*, Data*) {
+  return 0;
 }
 
-template <typename FunctionType>
+template <typename FunctionType, std::size_t InlineSize>
 struct FunctionTraits;
 
-template <typename ReturnType, typename... Args>
-struct FunctionTraits<ReturnType(Args...)> {
+template <std::size_t InlineSize, typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...), InlineSize> {
   using Call = ReturnType (*)(Data&, Args&&...);
   using IsConst = std::false_type;
   using ConstSignature = ReturnType(Args...) const;
@@ -316,24 +351,25 @@ struct FunctionTraits<ReturnType(Args...)> {
   }
 
   ReturnType operator()(Args... args) {
-    auto& fn = *static_cast<Function<NonConstSignature>*>(this);
-    return fn.call_(fn.data_, static_cast<Args&&>(args)...);
+    auto& fn = *static_cast<Function<NonConstSignature, InlineSize>*>(this);
+    return fn.call_(fn.storage_.data, static_cast<Args&&>(args)...);
   }
 
   class SharedProxy {
-    std::shared_ptr<Function<NonConstSignature>> sp_;
+    std::shared_ptr<Function<NonConstSignature, InlineSize>> sp_;
 
    public:
-    explicit SharedProxy(Function<NonConstSignature>&& func)
-        : sp_(std::make_shared<Function<NonConstSignature>>(std::move(func))) {}
+    explicit SharedProxy(Function<NonConstSignature, InlineSize>&& func)
+        : sp_(std::make_shared<Function<NonConstSignature, InlineSize>>(
+              std::move(func))) {}
     ReturnType operator()(Args&&... args) const {
       return (*sp_)(static_cast<Args&&>(args)...);
     }
   };
 };
 
-template <typename ReturnType, typename... Args>
-struct FunctionTraits<ReturnType(Args...) const> {
+template <std::size_t InlineSize, typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...) const, InlineSize> {
   using Call = ReturnType (*)(Data&, Args&&...);
   using IsConst = std::true_type;
   using ConstSignature = ReturnType(Args...) const;
@@ -361,16 +397,17 @@ struct FunctionTraits<ReturnType(Args...) const> {
   }
 
   ReturnType operator()(Args... args) const {
-    auto& fn = *static_cast<const Function<ConstSignature>*>(this);
-    return fn.call_(fn.data_, static_cast<Args&&>(args)...);
+    auto& fn = *static_cast<const Function<ConstSignature, InlineSize>*>(this);
+    return fn.call_(fn.storage_.data, static_cast<Args&&>(args)...);
   }
 
   class SharedProxy {
-    std::shared_ptr<Function<ConstSignature>> sp_;
+    std::shared_ptr<Function<ConstSignature, InlineSize>> sp_;
 
    public:
-    explicit SharedProxy(Function<ConstSignature>&& func)
-        : sp_(std::make_shared<Function<ConstSignature>>(std::move(func))) {}
+    explicit SharedProxy(Function<ConstSignature, InlineSize>&& func)
+        : sp_(std::make_shared<Function<ConstSignature, InlineSize>>(
+              std::move(func))) {}
     ReturnType operator()(Args&&... args) const {
       return (*sp_)(static_cast<Args&&>(args)...);
     }
@@ -378,8 +415,8 @@ struct FunctionTraits<ReturnType(Args...) const> {
 };
 
 #if FOLLY_HAVE_NOEXCEPT_FUNCTION_TYPE
-template <typename ReturnType, typename... Args>
-struct FunctionTraits<ReturnType(Args...) noexcept> {
+template <std::size_t InlineSize, typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...) noexcept, InlineSize> {
   using Call = ReturnType (*)(Data&, Args&&...) noexcept;
   using IsConst = std::false_type;
   using ConstSignature = ReturnType(Args...) const noexcept;
@@ -407,24 +444,25 @@ struct FunctionTraits<ReturnType(Args...) noexcept> {
   }
 
   ReturnType operator()(Args... args) noexcept {
-    auto& fn = *static_cast<Function<NonConstSignature>*>(this);
-    return fn.call_(fn.data_, static_cast<Args&&>(args)...);
+    auto& fn = *static_cast<Function<NonConstSignature, InlineSize>*>(this);
+    return fn.call_(fn.storage_.data, static_cast<Args&&>(args)...);
   }
 
   class SharedProxy {
-    std::shared_ptr<Function<NonConstSignature>> sp_;
+    std::shared_ptr<Function<NonConstSignature, InlineSize>> sp_;
 
    public:
-    explicit SharedProxy(Function<NonConstSignature>&& func)
-        : sp_(std::make_shared<Function<NonConstSignature>>(std::move(func))) {}
+    explicit SharedProxy(Function<NonConstSignature, InlineSize>&& func)
+        : sp_(std::make_shared<Function<NonConstSignature, InlineSize>>(
+              std::move(func))) {}
     ReturnType operator()(Args&&... args) const {
       return (*sp_)(static_cast<Args&&>(args)...);
     }
   };
 };
 
-template <typename ReturnType, typename... Args>
-struct FunctionTraits<ReturnType(Args...) const noexcept> {
+template <std::size_t InlineSize, typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...) const noexcept, InlineSize> {
   using Call = ReturnType (*)(Data&, Args&&...) noexcept;
   using IsConst = std::true_type;
   using ConstSignature = ReturnType(Args...) const noexcept;
@@ -452,16 +490,17 @@ struct FunctionTraits<ReturnType(Args...) const noexcept> {
   }
 
   ReturnType operator()(Args... args) const noexcept {
-    auto& fn = *static_cast<const Function<ConstSignature>*>(this);
-    return fn.call_(fn.data_, static_cast<Args&&>(args)...);
+    auto& fn = *static_cast<const Function<ConstSignature, InlineSize>*>(this);
+    return fn.call_(fn.storage_.data, static_cast<Args&&>(args)...);
   }
 
   class SharedProxy {
-    std::shared_ptr<Function<ConstSignature>> sp_;
+    std::shared_ptr<Function<ConstSignature, InlineSize>> sp_;
 
    public:
-    explicit SharedProxy(Function<ConstSignature>&& func)
-        : sp_(std::make_shared<Function<ConstSignature>>(std::move(func))) {}
+    explicit SharedProxy(Function<ConstSignature, InlineSize>&& func)
+        : sp_(std::make_shared<Function<ConstSignature, InlineSize>>(
+              std::move(func))) {}
     ReturnType operator()(Args&&... args) const {
       return (*sp_)(static_cast<Args&&>(args)...);
     }
@@ -470,7 +509,7 @@ struct FunctionTraits<ReturnType(Args...) const noexcept> {
 #endif
 
 template <typename Fun>
-bool execSmall(Op o, Data* src, Data* dst) {
+std::size_t execSmall(Op o, Data* src, Data* dst) {
   switch (o) {
     case Op::MOVE:
       ::new (static_cast<void*>(&dst->tiny))
@@ -483,12 +522,14 @@ bool execSmall(Op o, Data* src, Data* dst) {
       return true;
     case Op::HEAP:
       break;
+    case Op::SIZE:
+      return sizeof(Fun);
   }
   return false;
 }
 
 template <typename Fun>
-bool execBig(Op o, Data* src, Data* dst) {
+std::size_t execBig(Op o, Data* src, Data* dst) {
   switch (o) {
     case Op::MOVE:
       dst->big = src->big;
@@ -500,6 +541,68 @@ bool execBig(Op o, Data* src, Data* dst) {
     case Op::FULL:
     case Op::HEAP:
       break;
+    case Op::SIZE:
+      return 0;
+  }
+  return true;
+}
+
+// A callable allocated with an allocator: the callable, followed by the
+// copy of the allocator that frees it, in a single block.
+template <typename Fun, typename Alloc>
+struct Allocated {
+  static constexpr std::size_t kAllocOffset =
+      (sizeof(Fun) + alignof(Alloc) - 1) / alignof(Alloc) * alignof(Alloc);
+  using Block = typename std::aligned_storage<
+      kAllocOffset + sizeof(Alloc),
+      (alignof(Fun) > alignof(Alloc) ? alignof(Fun) : alignof(Alloc))>::type;
+  using BlockAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+  using BlockTraits = std::allocator_traits<BlockAlloc>;
+
+  static Alloc* allocator(void* p) {
+    return static_cast<Alloc*>(
+        static_cast<void*>(static_cast<char*>(p) + kAllocOffset));
+  }
+
+  template <typename F>
+  static void* create(F&& fun, const Alloc& alloc) {
+    BlockAlloc blockAlloc(alloc);
+    void* p = BlockTraits::allocate(blockAlloc, 1);
+    try {
+      ::new (p) Fun(static_cast<F&&>(fun));
+    } catch (...) {
+      BlockTraits::deallocate(blockAlloc, static_cast<Block*>(p), 1);
+      throw;
+    }
+    ::new (static_cast<void*>(allocator(p))) Alloc(alloc);
+    return p;
+  }
+
+  static void destroy(void* p) noexcept {
+    Alloc* alloc = allocator(p);
+    BlockAlloc blockAlloc(*alloc);
+    alloc->~Alloc();
+    static_cast<Fun*>(p)->~Fun();
+    BlockTraits::deallocate(blockAlloc, static_cast<Block*>(p), 1);
+  }
+};
+
+template <typename Fun, typename Alloc>
+std::size_t execAllocated(Op o, Data* src, Data* dst) {
+  switch (o) {
+    case Op::MOVE:
+      dst->big = src->big;
+      src->big = nullptr;
+      break;
+    case Op::NUKE:
+      Allocated<Fun, Alloc>::destroy(src->big);
+      break;
+    case Op::FULL:
+    case Op::HEAP:
+      break;
+    case Op::SIZE:
+      return 0;
   }
   return true;
 }
@@ -507,42 +610,47 @@ bool execBig(Op o, Data* src, Data* dst) {
 } // namespace function
 } // namespace detail
 
-template <typename FunctionType>
-class Function final : private detail::function::FunctionTraits<FunctionType> {
+template <typename FunctionType, std::size_t InlineSize>
+class Function final
+    : private detail::function::FunctionTraits<FunctionType, InlineSize> {
   // These utility types are defined outside of the template to reduce
   // the number of instantiations, and then imported in the class
   // namespace for convenience.
   using Data = detail::function::Data;
+  using Storage = detail::function::Storage<InlineSize>;
   using Op = detail::function::Op;
   using SmallTag = detail::function::SmallTag;
   using HeapTag = detail::function::HeapTag;
   using CoerceTag = detail::function::CoerceTag;
 
-  using Traits = detail::function::FunctionTraits<FunctionType>;
+  using Traits = detail::function::FunctionTraits<FunctionType, InlineSize>;
   using Call = typename Traits::Call;
-  using Exec = bool (*)(Op, Data*, Data*);
+  using Exec = std::size_t (*)(Op, Data*, Data*);
 
   template <typename Fun>
-  using IsSmall = detail::function::IsSmall<Fun>;
+  using IsSmall = detail::function::IsSmall<Fun, InlineSize>;
 
-  // The `data_` member is mutable to allow `constCastFunction` to work without
-  // invoking undefined behavior. Const-correctness is only violated when
-  // `FunctionType` is a const function type (e.g., `int() const`) and `*this`
-  // is the result of calling `constCastFunction`.
-  mutable Data data_{};
+  // The `storage_` member is mutable to allow `constCastFunction` to work
+  // without invoking undefined behavior. Const-correctness is only violated
+  // when `FunctionType` is a const function type (e.g., `int() const`) and
+  // `*this` is the result of calling `constCastFunction`.
+  mutable Storage storage_{Data{}};
   Call call_{&Traits::uninitCall};
   Exec exec_{&detail::function::uninitNoop};
 
   friend Traits;
-  friend Function<typename Traits::ConstSignature> folly::constCastFunction<>(
-      Function<typename Traits::NonConstSignature>&&) noexcept;
-  friend class Function<typename Traits::OtherSignature>;
+  friend Function<typename Traits::ConstSignature, InlineSize>
+  folly::constCastFunction<>(
+      Function<typename Traits::NonConstSignature, InlineSize>&&) noexcept;
+  template <typename, std::size_t>
+  friend class Function;
 
   template <typename Fun>
   Function(Fun&& fun, SmallTag) noexcept {
     using FunT = typename std::decay<Fun>::type;
     if (!detail::function::isNullPtrFn(fun)) {
-      ::new (static_cast<void*>(&data_.tiny)) FunT(static_cast<Fun&&>(fun));
+      ::new (static_cast<void*>(&storage_.tiny))
+          FunT(static_cast<Fun&&>(fun));
       call_ = &Traits::template callSmall<FunT>;
       exec_ = &detail::function::execSmall<FunT>;
     }
@@ -551,21 +659,58 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
   template <typename Fun>
   Function(Fun&& fun, HeapTag) {
     using FunT = typename std::decay<Fun>::type;
-    data_.big = new FunT(static_cast<Fun&&>(fun));
+    storage_.data.big = new FunT(static_cast<Fun&&>(fun));
     call_ = &Traits::template callBig<FunT>;
     exec_ = &detail::function::execBig<FunT>;
   }
 
-  template <typename Signature>
-  Function(Function<Signature>&& that, CoerceTag)
-      : Function(static_cast<Function<Signature>&&>(that), HeapTag{}) {}
+  template <typename Fun, typename Alloc>
+  Function(Fun&& fun, const Alloc&, SmallTag) noexcept
+      : Function(static_cast<Fun&&>(fun), SmallTag{}) {}
+
+  template <typename Fun, typename Alloc>
+  Function(Fun&& fun, const Alloc& alloc, HeapTag) {
+    using FunT = typename std::decay<Fun>::type;
+    using Allocated = detail::function::Allocated<FunT, Alloc>;
+    storage_.data.big = Allocated::create(static_cast<Fun&&>(fun), alloc);
+    call_ = &Traits::template callBig<FunT>;
+    exec_ = &detail::function::execAllocated<FunT, Alloc>;
+  }
+
+  template <typename Signature, std::size_t Size>
+  Function(Function<Signature, Size>&& that, CoerceTag)
+      : Function(static_cast<Function<Signature, Size>&&>(that), HeapTag{}) {}
 
+  template <std::size_t Size>
+  Function(Function<FunctionType, Size>&& that, CoerceTag) noexcept(
+      Size <= InlineSize) {
+    relocateFrom(that);
+  }
+
+  template <std::size_t Size>
   Function(
-      Function<typename Traits::OtherSignature>&& that,
-      CoerceTag) noexcept {
-    that.exec_(Op::MOVE, &that.data_, &data_);
-    std::swap(call_, that.call_);
-    std::swap(exec_, that.exec_);
+      Function<typename Traits::OtherSignature, Size>&& that,
+      CoerceTag) noexcept(Size <= InlineSize) {
+    relocateFrom(that);
+  }
+
+  // Takes over the callable of a Function with the same call operator:
+  // its heap pointer, or the callable itself if it fits in our buffer. If
+  // it doesn't, `that` goes to the heap as a whole (as a Function of our
+  // signature, for constCastFunction).
+  template <typename Signature, std::size_t Size>
+  void relocateFrom(Function<Signature, Size>& that) {
+    if (Size <= InlineSize ||
+        that.exec_(Op::SIZE, nullptr, nullptr) <= sizeof(Storage)) {
+      that.exec_(Op::MOVE, &that.storage_.data, &storage_.data);
+      std::swap(call_, that.call_);
+      std::swap(exec_, that.exec_);
+    } else {
+      using Other = Function<FunctionType, Size>;
+      storage_.data.big = new Other(std::move(that), CoerceTag{});
+      call_ = &Traits::template callBig<Other>;
+      exec_ = &detail::function::execBig<Other>;
+    }
   }
 
  public:
@@ -589,7 +734,7 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
    * Move constructor
    */
   Function(Function&& that) noexcept {
-    that.exec_(Op::MOVE, &that.data_, &data_);
+    that.exec_(Op::MOVE, &that.storage_.data, &storage_.data);
     std::swap(call_, that.call_);
     std::swap(exec_, that.exec_);
   }
@@ -627,18 +772,40 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
       : Function(static_cast<Fun&&>(fun), IsSmall<Fun>{}) {}
 
   /**
-   * For move-constructing from a `folly::Function<X(Ys...) [const?]>`.
+   * Like the above, but allocates the callable with `alloc` rather than
+   * `new` if it doesn't fit in the `Function` itself. Only the memory comes
+   * from `alloc`: the callable is constructed and destroyed in place, as
+   * with `new`, and `alloc` must use plain pointers. The `Function` keeps
+   * a copy of `alloc` with the callable to free it.
+   */
+  template <
+      typename Alloc,
+      typename Fun,
+      typename = detail::function::EnableIfNotFunction<Fun>,
+      typename = typename Traits::template ResultOf<Fun>>
+  Function(std::allocator_arg_t, const Alloc& alloc, Fun fun) noexcept(
+      IsSmall<Fun>::value && noexcept(Fun(std::declval<Fun>())))
+      : Function(static_cast<Fun&&>(fun), alloc, IsSmall<Fun>{}) {}
+
+  /**
+   * For move-constructing from a `folly::Function<X(Ys...) [const?], N>`.
    * For a `Function` with a `const` function type, the object must be
    * callable from a `const`-reference, i.e. implement `operator() const`.
    * For a `Function` with a non-`const` function type, the object will
    * be called from a non-const reference, which means that it will execute
    * a non-const `operator()` if it is defined, and falls back to
    * `operator() const` otherwise.
+   *
+   * From a `Function` of the same signature, or the same but for `const`,
+   * this takes over the callable without allocating, unless `that` holds
+   * it inline and it doesn't fit in this `Function`'s buffer.
    */
   template <
       typename Signature,
-      typename = typename Traits::template ResultOf<Function<Signature>>>
-  Function(Function<Signature>&& that) noexcept(
+      std::size_t Size,
+      typename =
+          typename Traits::template ResultOf<Function<Signature, Size>>>
+  Function(Function<Signature, Size>&& that) noexcept(
       noexcept(Function(std::move(that), CoerceTag{})))
       : Function(std::move(that), CoerceTag{}) {}
 
@@ -659,7 +826,7 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
   }
 
   ~Function() {
-    exec_(Op::NUKE, &data_, nullptr);
+    exec_(Op::NUKE, &storage_.data, nullptr);
   }
 
   Function& operator=(const Function&) = delete;
@@ -720,12 +887,14 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
   }
 
   /**
-   * For assigning from a `Function<X(Ys..) [const?]>`.
+   * For assigning from a `Function<X(Ys..) [const?], N>`.
    */
   template <
       typename Signature,
-      typename = typename Traits::template ResultOf<Function<Signature>>>
-  Function& operator=(Function<Signature>&& that) noexcept(
+      std::size_t Size,
+      typename =
+          typename Traits::template ResultOf<Function<Signature, Size>>>
+  Function& operator=(Function<Signature, Size>&& that) noexcept(
       noexcept(Function(std::move(that)))) {
     return (*this = Function(std::move(that)));
   }
@@ -766,7 +935,7 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
    * non-empty.
    */
   explicit operator bool() const noexcept {
-    return exec_(Op::FULL, nullptr, nullptr);
+    return exec_(Op::FULL, nullptr, nullptr) != 0;
   }
 
   /**
@@ -776,7 +945,7 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
    * object itself.
    */
   bool hasAllocatedMemory() const noexcept {
-    return exec_(Op::HEAP, nullptr, nullptr);
+    return exec_(Op::HEAP, nullptr, nullptr) != 0;
   }
 
   using typename Traits::SharedProxy;
@@ -799,28 +968,30 @@ class Function final : private detail::function::FunctionTraits<FunctionType> {
   }
 };
 
-template <typename FunctionType>
-void swap(Function<FunctionType>& lhs, Function<FunctionType>& rhs) noexcept {
+template <typename FunctionType, std::size_t InlineSize>
+void swap(
+    Function<FunctionType, InlineSize>& lhs,
+    Function<FunctionType, InlineSize>& rhs) noexcept {
   lhs.swap(rhs);
 }
 
-template <typename FunctionType>
-bool operator==(const Function<FunctionType>& fn, std::nullptr_t) {
+template <typename FunctionType, std::size_t InlineSize>
+bool operator==(const Function<FunctionType, InlineSize>& fn, std::nullptr_t) {
   return !fn;
 }
 
-template <typename FunctionType>
-bool operator==(std::nullptr_t, const Function<FunctionType>& fn) {
+template <typename FunctionType, std::size_t InlineSize>
+bool operator==(std::nullptr_t, const Function<FunctionType, InlineSize>& fn) {
   return !fn;
 }
 
-template <typename FunctionType>
-bool operator!=(const Function<FunctionType>& fn, std::nullptr_t) {
+template <typename FunctionType, std::size_t InlineSize>
+bool operator!=(const Function<FunctionType, InlineSize>& fn, std::nullptr_t) {
   return !(fn == nullptr);
 }
 
-template <typename FunctionType>
-bool operator!=(std::nullptr_t, const Function<FunctionType>& fn) {
+template <typename FunctionType, std::size_t InlineSize>
+bool operator!=(std::nullptr_t, const Function<FunctionType, InlineSize>& fn) {
   return !(nullptr == fn);
 }
 
@@ -828,30 +999,30 @@ bool operator!=(std::nullptr_t, const Function<FunctionType>& fn) {
  * NOTE: See detailed note about `constCastFunction` at the top of the file.
  * This is potentially dangerous and requires the equivalent of a `const_cast`.
  */
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const> constCastFunction(
-    Function<ReturnType(Args...)>&& that) noexcept {
-  return Function<ReturnType(Args...) const>{std::move(that),
-                                             detail::function::CoerceTag{}};
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const, InlineSize> constCastFunction(
+    Function<ReturnType(Args...), InlineSize>&& that) noexcept {
+  return Function<ReturnType(Args...) const, InlineSize>{
+      std::move(that), detail::function::CoerceTag{}};
 }
 
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const> constCastFunction(
-    Function<ReturnType(Args...) const>&& that) noexcept {
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const, InlineSize> constCastFunction(
+    Function<ReturnType(Args...) const, InlineSize>&& that) noexcept {
   return std::move(that);
 }
 
 #if FOLLY_HAVE_NOEXCEPT_FUNCTION_TYPE
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const noexcept> constCastFunction(
-    Function<ReturnType(Args...) noexcept>&& that) noexcept {
-  return Function<ReturnType(Args...) const noexcept>{
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const noexcept, InlineSize> constCastFunction(
+    Function<ReturnType(Args...) noexcept, InlineSize>&& that) noexcept {
+  return Function<ReturnType(Args...) const noexcept, InlineSize>{
       std::move(that), detail::function::CoerceTag{}};
 }
 
-template <typename ReturnType, typename... Args>
-Function<ReturnType(Args...) const noexcept> constCastFunction(
-    Function<ReturnType(Args...) const noexcept>&& that) noexcept {
+template <typename ReturnType, typename... Args, std::size_t InlineSize>
+Function<ReturnType(Args...) const noexcept, InlineSize> constCastFunction(
+    Function<ReturnType(Args...) const noexcept, InlineSize>&& that) noexcept {
   return std::move(that);
 }
 #endif
@@ -450,6 +450,43 @@ class GroupVarint<uint64_t> : public detail::GroupVarintBase<uint64_t> {
 typedef GroupVarint<uint32_t> GroupVarint32;
 typedef GroupVarint<uint64_t> GroupVarint64;
 
+/**
+ * Read groups of GroupVarint<T>::kGroupSize values from an io::Cursor (or
+ * other folly::io::detail::CursorBase) into out, which must have room for
+ * groups * kGroupSize values.  Groups are decoded in place while at least
+ * kMaxSize bytes are left in the current buffer; only groups that cross
+ * buffers (or end the chain) are copied out first.
+ *
+ * Throws std::out_of_range on underflow.
+ */
+template <class T, class Cursor>
+void readGroupVarints(Cursor& cursor, T* out, size_t groups) {
+  typedef GroupVarint<T> Base;
+  constexpr size_t kHeaderSize =
+      Base::kMaxSize - sizeof(T) * Base::kGroupSize;
+  while (groups > 0) {
+    auto const bytes = cursor.peekBytes();
+    auto const begin = reinterpret_cast<const char*>(bytes.data());
+    auto const end = begin + bytes.size();
+    auto p = begin;
+    while (groups > 0 && size_t(end - p) >= Base::kMaxSize) {
+      p = Base::decode(p, out);
+      out += Base::kGroupSize;
+      --groups;
+    }
+    cursor.skip(size_t(p - begin));
+    if (groups > 0) {
+      // Zero padded, as decode() may read up to kMaxSize bytes
+      char tmp[Base::kMaxSize] = {};
+      cursor.pull(tmp, kHeaderSize);
+      cursor.pull(tmp + kHeaderSize, Base::encodedSize(tmp) - kHeaderSize);
+      Base::decode(tmp, out);
+      out += Base::kGroupSize;
+      --groups;
+    }
+  }
+}
+
 /**
  * Simplify use of GroupVarint* for the case where data is available one
  * entry at a time (instead of one group at a time).  Handles buffering
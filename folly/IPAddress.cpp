@@ -19,7 +19,6 @@
 #include <limits>
 #include <ostream>
 #include <string>
-#include <vector>
 
 #include <folly/Format.h>
 #include <folly/String.h>
@@ -27,7 +26,6 @@
 
 using std::ostream;
 using std::string;
-using std::vector;
 
 namespace folly {
 
@@ -73,36 +71,75 @@ CIDRNetwork IPAddress::createNetwork(
     StringPiece ipSlashCidr,
     int defaultCidr, /* = -1 */
     bool applyMask /* = true */) {
+  auto ret = tryCreateNetwork(ipSlashCidr, defaultCidr, applyMask);
+  if (ret.hasValue()) {
+    return std::move(ret.value());
+  }
+
+  // Only pay for the message once we know the input is bad
+  auto slash = ipSlashCidr.find('/');
+  auto ipPart = ipSlashCidr.subpiece(0, slash);
+  switch (ret.error()) {
+    case CIDRNetworkError::INVALID_DEFAULT_CIDR:
+      throw std::range_error("defaultCidr must be <= UINT8_MAX");
+    case CIDRNetworkError::INVALID_IP_SLASH_CIDR:
+      throw IPAddressFormatException(sformat(
+          "Invalid ipSlashCidr specified. Expected IP/CIDR format, got '{}'",
+          ipSlashCidr));
+    case CIDRNetworkError::INVALID_IP:
+      throw IPAddressFormatException(
+          to<std::string>("Invalid IP address '", ipPart, "'"));
+    case CIDRNetworkError::INVALID_CIDR:
+      throw IPAddressFormatException(sformat(
+          "Mask value '{}' not a valid mask",
+          ipSlashCidr.subpiece(slash + 1)));
+    case CIDRNetworkError::CIDR_MISMATCH: {
+      IPAddress subnet(ipPart);
+      auto cidr = slash == StringPiece::npos
+          ? defaultCidr
+          : to<int>(ipSlashCidr.subpiece(slash + 1));
+      throw IPAddressFormatException(sformat(
+          "CIDR value '{}' is > network bit count '{}'",
+          cidr,
+          subnet.bitCount()));
+    }
+  }
+  throw IPAddressFormatException(
+      sformat("Invalid ipSlashCidr '{}'", ipSlashCidr));
+}
+
+// public static
+Expected<CIDRNetwork, CIDRNetworkError> IPAddress::tryCreateNetwork(
+    StringPiece ipSlashCidr,
+    int defaultCidr,
+    bool applyMask) noexcept {
   if (defaultCidr > std::numeric_limits<uint8_t>::max()) {
-    throw std::range_error("defaultCidr must be <= UINT8_MAX");
+    return makeUnexpected(CIDRNetworkError::INVALID_DEFAULT_CIDR);
   }
-  vector<string> vec;
-  split("/", ipSlashCidr, vec);
-  vector<string>::size_type elemCount = vec.size();
-
-  if (elemCount == 0 || // weird invalid string
-      elemCount > 2) { // invalid string (IP/CIDR/extras)
-    throw IPAddressFormatException(sformat(
-        "Invalid ipSlashCidr specified. Expected IP/CIDR format, got '{}'",
-        ipSlashCidr));
+  auto slash = ipSlashCidr.find('/');
+  auto ipPart = ipSlashCidr.subpiece(0, slash);
+  if (slash != StringPiece::npos &&
+      ipSlashCidr.find('/', slash + 1) != StringPiece::npos) {
+    // IP/CIDR/extras
+    return makeUnexpected(CIDRNetworkError::INVALID_IP_SLASH_CIDR);
   }
-  IPAddress subnet(vec.at(0));
+  auto maybeSubnet = tryFromString(ipPart);
+  if (maybeSubnet.hasError()) {
+    return makeUnexpected(CIDRNetworkError::INVALID_IP);
+  }
+  auto& subnet = maybeSubnet.value();
   auto cidr =
       uint8_t((defaultCidr > -1) ? defaultCidr : (subnet.isV4() ? 32 : 128));
 
-  if (elemCount == 2) {
-    try {
-      cidr = to<uint8_t>(vec.at(1));
-    } catch (...) {
-      throw IPAddressFormatException(
-          sformat("Mask value '{}' not a valid mask", vec.at(1)));
+  if (slash != StringPiece::npos) {
+    auto maybeCidr = tryTo<uint8_t>(ipSlashCidr.subpiece(slash + 1));
+    if (maybeCidr.hasError()) {
+      return makeUnexpected(CIDRNetworkError::INVALID_CIDR);
     }
+    cidr = maybeCidr.value();
   }
   if (cidr > subnet.bitCount()) {
-    throw IPAddressFormatException(sformat(
-        "CIDR value '{}' is > network bit count '{}'",
-        cidr,
-        subnet.bitCount()));
+    return makeUnexpected(CIDRNetworkError::CIDR_MISMATCH);
   }
   return std::make_pair(applyMask ? subnet.mask(cidr) : subnet, cidr);
 }
@@ -137,6 +174,15 @@ Expected<IPAddress, IPAddressFormatError> IPAddress::tryFromBinary(
   }
 }
 
+void IPAddress::tryFromString(
+    Range<const StringPiece*> strs,
+    Range<Expected<IPAddress, IPAddressFormatError>*> results) noexcept {
+  DCHECK_GE(results.size(), strs.size());
+  for (size_t i = 0; i < strs.size(); ++i) {
+    results[i] = tryFromString(strs[i]);
+  }
+}
+
 // public static
 IPAddress IPAddress::fromLong(uint32_t src) {
   return IPAddress(IPAddressV4::fromLong(src));
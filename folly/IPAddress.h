@@ -99,6 +99,14 @@ class IPAddress {
       int defaultCidr = -1,
       bool mask = true);
 
+  /**
+   * Non-throwing version of createNetwork().
+   */
+  static Expected<CIDRNetwork, CIDRNetworkError> tryCreateNetwork(
+      StringPiece ipSlashCidr,
+      int defaultCidr = -1,
+      bool mask = true) noexcept;
+
   /**
    * Return a string representation of a CIDR block created with createNetwork.
    * @param [in] network, pair of address and cidr
@@ -128,6 +136,14 @@ class IPAddress {
   static Expected<IPAddress, IPAddressFormatError> tryFromString(
       StringPiece str) noexcept;
 
+  /**
+   * Parses each of strs into the result with the same index, as
+   * tryFromString() does; results must be at least as large as strs.
+   */
+  static void tryFromString(
+      Range<const StringPiece*> strs,
+      Range<Expected<IPAddress, IPAddressFormatError>*> results) noexcept;
+
   /**
    * Create an IPAddress from a 32bit long (network byte order).
    * @throws IPAddressFormatException
@@ -398,6 +414,17 @@ class IPAddress {
     return pick([&](auto& _) { return _.str(); });
   }
 
+  // Max size of the string returned by str().
+  static constexpr size_t kMaxStrSize = IPAddressV6::kMaxStrSize;
+
+  /**
+   * Writes str() to out, which must have room for kMaxStrSize chars, without
+   * allocating; returns its length.  out is not NUL-terminated.
+   */
+  size_t str(char* out) const {
+    return pick([&](auto& _) { return _.str(out); });
+  }
+
   /**
    * Return the fully qualified string representation of the address.
    * For V4 addresses this is the same as calling str(). For V6 addresses
@@ -29,6 +29,17 @@ namespace folly {
  */
 enum class IPAddressFormatError { INVALID_IP, UNSUPPORTED_ADDR_FAMILY };
 
+/**
+ * Error codes for IPAddress::tryCreateNetwork().
+ */
+enum class CIDRNetworkError {
+  INVALID_DEFAULT_CIDR,
+  INVALID_IP_SLASH_CIDR,
+  INVALID_IP,
+  INVALID_CIDR,
+  CIDR_MISMATCH,
+};
+
 /**
  * Exception for invalid IP addresses.
  */
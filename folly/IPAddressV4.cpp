@@ -63,9 +63,8 @@ IPAddressV4 IPAddressV4::fromLongHBO(uint32_t src) {
 
 // static public
 uint32_t IPAddressV4::toLong(StringPiece ip) {
-  auto str = ip.str();
   in_addr addr;
-  if (inet_pton(AF_INET, str.c_str(), &addr) != 1) {
+  if (!detail::parseIPv4(ip, reinterpret_cast<uint8_t*>(&addr.s_addr))) {
     throw IPAddressFormatException(
         sformat("Can't convert invalid IP '{}' to long", ip));
   }
@@ -95,11 +94,20 @@ IPAddressV4::IPAddressV4(StringPiece addr) : addr_() {
 
 Expected<IPAddressV4, IPAddressFormatError> IPAddressV4::tryFromString(
     StringPiece str) noexcept {
-  struct in_addr inAddr;
-  if (inet_pton(AF_INET, str.str().c_str(), &inAddr) != 1) {
+  ByteArray4 bytes;
+  if (!detail::parseIPv4(str, bytes.data())) {
     return makeUnexpected(IPAddressFormatError::INVALID_IP);
   }
-  return IPAddressV4(inAddr);
+  return IPAddressV4(bytes);
+}
+
+void IPAddressV4::tryFromString(
+    Range<const StringPiece*> strs,
+    Range<Expected<IPAddressV4, IPAddressFormatError>*> results) noexcept {
+  DCHECK_GE(results.size(), strs.size());
+  for (size_t i = 0; i < strs.size(); ++i) {
+    results[i] = tryFromString(strs[i]);
+  }
 }
 
 // in_addr constructor
@@ -252,6 +260,11 @@ string IPAddressV4::str() const {
   return detail::fastIpv4ToString(addr_.inAddr_);
 }
 
+// public
+size_t IPAddressV4::str(char* out) const {
+  return detail::fastIpV4ToBufferUnsafe(addr_.inAddr_, out);
+}
+
 // public
 void IPAddressV4::toFullyQualifiedAppend(std::string& out) const {
   detail::fastIpv4AppendToString(addr_.inAddr_, out);
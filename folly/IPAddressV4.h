@@ -61,6 +61,9 @@ class IPAddressV4 {
   static constexpr size_t kMaxToFullyQualifiedSize =
       4 /*words*/ * 3 /*max chars per word*/ + 3 /*separators*/;
 
+  // Max size of the string returned by str().
+  static constexpr size_t kMaxStrSize = kMaxToFullyQualifiedSize;
+
   // returns true iff the input string can be parsed as an ipv4-address
   static bool validate(StringPiece ip) noexcept;
 
@@ -89,6 +92,14 @@ class IPAddressV4 {
   static Expected<IPAddressV4, IPAddressFormatError> tryFromString(
       StringPiece str) noexcept;
 
+  /**
+   * Parses each of strs into the result with the same index, as
+   * tryFromString() does; results must be at least as large as strs.
+   */
+  static void tryFromString(
+      Range<const StringPiece*> strs,
+      Range<Expected<IPAddressV4, IPAddressFormatError>*> results) noexcept;
+
   /**
    * Returns the address as a Range.
    */
@@ -208,6 +219,7 @@ class IPAddressV4 {
 
   // @see IPAddress#str
   std::string str() const;
+  size_t str(char* out) const;
 
   std::string toInverseArpaName() const;
 
@@ -24,6 +24,7 @@
 #include <folly/IPAddressV4.h>
 #include <folly/MacAddress.h>
 #include <folly/detail/IPAddressSource.h>
+#include <folly/hash/SpookyHashV2.h>
 
 #if !_WIN32
 #include <net/if.h>
@@ -81,16 +82,25 @@ IPAddressV6::IPAddressV6(StringPiece addr) {
 
 Expected<IPAddressV6, IPAddressFormatError> IPAddressV6::tryFromString(
     StringPiece str) noexcept {
-  auto ip = str.str();
-
   // Allow addresses surrounded in brackets
-  if (ip.size() < 2) {
+  if (str.size() < 2) {
     return makeUnexpected(IPAddressFormatError::INVALID_IP);
   }
-  if (ip.front() == '[' && ip.back() == ']') {
-    ip = ip.substr(1, ip.size() - 2);
+  if (str.front() == '[' && str.back() == ']') {
+    str = str.subpiece(1, str.size() - 2);
+  }
+
+  // Only addresses with a scope ("fe80::1%eth0") need getaddrinfo(), which
+  // maps interface names to indexes
+  if (str.find('%') == StringPiece::npos) {
+    ByteArray16 bytes;
+    if (!detail::parseIPv6(str, bytes.data())) {
+      return makeUnexpected(IPAddressFormatError::INVALID_IP);
+    }
+    return IPAddressV6(bytes);
   }
 
+  auto ip = str.str();
   struct addrinfo* result;
   struct addrinfo hints;
   memset(&hints, 0, sizeof(hints));
@@ -108,6 +118,15 @@ Expected<IPAddressV6, IPAddressFormatError> IPAddressV6::tryFromString(
   return makeUnexpected(IPAddressFormatError::INVALID_IP);
 }
 
+void IPAddressV6::tryFromString(
+    Range<const StringPiece*> strs,
+    Range<Expected<IPAddressV6, IPAddressFormatError>*> results) noexcept {
+  DCHECK_GE(results.size(), strs.size());
+  for (size_t i = 0; i < strs.size(); ++i) {
+    results[i] = tryFromString(strs[i]);
+  }
+}
+
 // in6_addr constructor
 IPAddressV6::IPAddressV6(const in6_addr& src) noexcept : addr_(src) {}
 
@@ -436,30 +455,30 @@ IPAddressV6 IPAddressV6::mask(size_t numBits) const {
 
 // public
 string IPAddressV6::str() const {
-  char buffer[INET6_ADDRSTRLEN + IFNAMSIZ + 1];
+  char buffer[kMaxStrSize];
+  return string(buffer, str(buffer));
+}
 
-  if (!inet_ntop(AF_INET6, toAddr().s6_addr, buffer, INET6_ADDRSTRLEN)) {
-    throw IPAddressFormatException(sformat(
-        "Invalid address with hex '{}' with error {}",
-        detail::Bytes::toHex(bytes(), 16),
-        strerror(errno)));
-  }
+// public
+size_t IPAddressV6::str(char* out) const {
+  size_t len = detail::formatIPv6(bytes(), out);
 
   auto scopeId = getScopeId();
   if (scopeId != 0) {
-    auto len = strlen(buffer);
-    buffer[len] = '%';
-
+    char name[IFNAMSIZ];
     auto errsv = errno;
-    if (!if_indextoname(scopeId, buffer + len + 1)) {
+    if (!if_indextoname(scopeId, name)) {
       // if we can't map the if because eg. it no longer exists,
       // append the if index instead
-      snprintf(buffer + len + 1, IFNAMSIZ, "%u", scopeId);
+      snprintf(name, sizeof(name), "%u", scopeId);
     }
     errno = errsv;
+    size_t nameLen = strnlen(name, sizeof(name) - 1);
+    out[len++] = '%';
+    memcpy(out + len, name, nameLen);
+    len += nameLen;
   }
-
-  return string(buffer);
+  return len;
 }
 
 // public
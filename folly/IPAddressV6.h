@@ -93,6 +93,10 @@ class IPAddressV6 {
   static constexpr size_t kToFullyQualifiedSize =
       8 /*words*/ * 4 /*hex chars per word*/ + 7 /*separators*/;
 
+  // Max size of the string returned by str(): the longest address
+  // (INET6_ADDRSTRLEN - 1), '%', and an interface name (IFNAMSIZ - 1).
+  static constexpr size_t kMaxStrSize = 45 + 1 + 15;
+
   // returns true iff the input string can be parsed as an ipv6-address
   static bool validate(StringPiece ip) noexcept;
 
@@ -116,6 +120,14 @@ class IPAddressV6 {
   static Expected<IPAddressV6, IPAddressFormatError> tryFromString(
       StringPiece str) noexcept;
 
+  /**
+   * Parses each of strs into the result with the same index, as
+   * tryFromString() does; results must be at least as large as strs.
+   */
+  static void tryFromString(
+      Range<const StringPiece*> strs,
+      Range<Expected<IPAddressV6, IPAddressFormatError>*> results) noexcept;
+
   /**
    * Create a new IPAddress instance from the ip6.arpa representation.
    * @throws IPAddressFormatException if the input is not a valid ip6.arpa
@@ -319,6 +331,7 @@ class IPAddressV6 {
 
   // @see IPAddress#str
   std::string str() const;
+  size_t str(char* out) const;
 
   // @see IPAddress#version
   uint8_t version() const {
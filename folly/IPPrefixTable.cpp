@@ -0,0 +1,246 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/IPPrefixTable.h>
+
+#include <algorithm>
+#include <tuple>
+
+#include <folly/Bits.h>
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+// The 64 bits of key starting at bit `depth` (from the most significant),
+// padded with 0s past the end
+inline uint64_t bitsFrom(Poptrie::Key key, unsigned depth) {
+  if (depth == 0) {
+    return key.hi;
+  } else if (depth < 64) {
+    return (key.hi << depth) | (key.lo >> (64 - depth));
+  } else if (depth < 128) {
+    return key.lo << (depth - 64);
+  }
+  return 0;
+}
+
+inline unsigned chunk(Poptrie::Key key, unsigned depth, unsigned bits) {
+  return unsigned(bitsFrom(key, depth) >> (64 - bits));
+}
+
+// The mask of the bits of a word of a key with `bits` bits of a prefix
+inline uint64_t prefixMask(int bits) {
+  if (bits <= 0) {
+    return 0;
+  }
+  return bits >= 64 ? ~uint64_t(0) : ~uint64_t(0) << (64 - bits);
+}
+
+inline void prefetch(const void* addr) {
+#ifdef __GNUC__
+  __builtin_prefetch(addr);
+#else
+  (void)addr;
+#endif
+}
+
+} // namespace
+
+constexpr uint32_t Poptrie::kNoValue;
+constexpr unsigned Poptrie::kDirectBits;
+constexpr unsigned Poptrie::kStride;
+constexpr uint32_t Poptrie::kNodeBit;
+
+Poptrie::Poptrie() {}
+
+Poptrie::Poptrie(std::vector<Prefix> prefixes) {
+  if (prefixes.empty()) {
+    return;
+  }
+  for (auto& p : prefixes) {
+    p.key.hi &= prefixMask(p.length);
+    p.key.lo &= prefixMask(p.length - 64);
+  }
+  // In this order, a prefix comes after all the prefixes that contain it,
+  // and after its duplicates that came before it
+  std::stable_sort(
+      prefixes.begin(), prefixes.end(), [](const Prefix& a, const Prefix& b) {
+        return std::tie(a.key.hi, a.key.lo, a.length) <
+            std::tie(b.key.hi, b.key.lo, b.length);
+      });
+
+  direct_.assign(size_t(1) << kDirectBits, kNoValue);
+  const Prefix* p = prefixes.data();
+  const Prefix* end = p + prefixes.size();
+  while (p != end) {
+    unsigned first = chunk(p->key, 0, kDirectBits);
+    if (p->length <= kDirectBits) {
+      size_t count = size_t(1) << (kDirectBits - p->length);
+      std::fill_n(direct_.begin() + first, count, p->value);
+      ++p;
+      continue;
+    }
+    // The longer prefixes under this entry, which all the shorter prefixes
+    // that contain them came before
+    const Prefix* q = p;
+    while (q != end && chunk(q->key, 0, kDirectBits) == first) {
+      ++q;
+    }
+    auto index = uint32_t(nodes_.size());
+    nodes_.emplace_back();
+    build(index, kDirectBits, p, q, direct_[first]);
+    direct_[first] = kNodeBit | index;
+    p = q;
+  }
+}
+
+void Poptrie::build(
+    uint32_t index,
+    unsigned depth,
+    const Prefix* begin,
+    const Prefix* end,
+    uint32_t inherited) {
+  constexpr unsigned kChildren = 1 << kStride;
+  uint32_t values[kChildren];
+  std::fill_n(values, kChildren, inherited);
+  const Prefix* childBegin[kChildren];
+  const Prefix* childEnd[kChildren];
+  uint64_t nodes = 0;
+
+  // Prefixes that end at this node cover runs of children, and come before
+  // the ones they contain; longer ones go to the child nodes, with the
+  // shorter ones under them, which they skip
+  for (const Prefix* p = begin; p != end; ++p) {
+    if (p->length <= depth) {
+      continue;
+    }
+    unsigned c = chunk(p->key, depth, kStride);
+    if (p->length <= depth + kStride) {
+      std::fill_n(values + c, 1 << (depth + kStride - p->length), p->value);
+    } else {
+      if (!(nodes & (uint64_t(1) << c))) {
+        nodes |= uint64_t(1) << c;
+        childBegin[c] = p;
+      }
+      childEnd[c] = p + 1;
+    }
+  }
+
+  Node node;
+  node.nodes = nodes;
+  node.leaves = 0;
+  node.leafBase = uint32_t(leaves_.size());
+  node.nodeBase = uint32_t(nodes_.size());
+  for (unsigned c = 0; c < kChildren; ++c) {
+    if (nodes & (uint64_t(1) << c)) {
+      continue;
+    }
+    if (node.leaves == 0 || leaves_.back() != values[c]) {
+      node.leaves |= uint64_t(1) << c;
+      leaves_.push_back(values[c]);
+    }
+  }
+  nodes_.resize(nodes_.size() + popcount(nodes));
+  nodes_[index] = node;
+
+  uint32_t child = node.nodeBase;
+  for (unsigned c = 0; c < kChildren; ++c) {
+    if (nodes & (uint64_t(1) << c)) {
+      build(child++, depth + kStride, childBegin[c], childEnd[c], values[c]);
+    }
+  }
+}
+
+uint32_t Poptrie::lookup(Key key) const {
+  if (direct_.empty()) {
+    return kNoValue;
+  }
+  uint32_t entry = direct_[key.hi >> (64 - kDirectBits)];
+  unsigned depth = kDirectBits;
+  while (entry & kNodeBit) {
+    const Node& node = nodes_[entry & ~kNodeBit];
+    unsigned c = chunk(key, depth, kStride);
+    // The children up to and including c
+    uint64_t upTo = (uint64_t(2) << c) - 1;
+    if (node.nodes & (uint64_t(1) << c)) {
+      entry = kNodeBit | (node.nodeBase + popcount(node.nodes & upTo) - 1);
+      depth += kStride;
+    } else {
+      return leaves_[node.leafBase + popcount(node.leaves & upTo) - 1];
+    }
+  }
+  return entry;
+}
+
+void Poptrie::lookup(const Key* keys, size_t count, uint32_t* results)
+    const {
+  if (direct_.empty()) {
+    std::fill_n(results, count, kNoValue);
+    return;
+  }
+  // The keys of a group go down the trie together, one level per round,
+  // with the nodes of the next round prefetched while the others of this
+  // round are visited
+  constexpr size_t kGroup = 16;
+  for (size_t i = 0; i < count; i += kGroup) {
+    size_t n = std::min(kGroup, count - i);
+    const Key* k = keys + i;
+    uint32_t* r = results + i;
+    for (size_t j = 0; j < n; ++j) {
+      prefetch(&direct_[k[j].hi >> (64 - kDirectBits)]);
+    }
+    uint32_t nodeIndex[kGroup];
+    uint8_t pending[kGroup];
+    size_t active = 0;
+    for (size_t j = 0; j < n; ++j) {
+      uint32_t entry = direct_[k[j].hi >> (64 - kDirectBits)];
+      if (entry & kNodeBit) {
+        nodeIndex[j] = entry & ~kNodeBit;
+        prefetch(&nodes_[nodeIndex[j]]);
+        pending[active++] = uint8_t(j);
+      } else {
+        r[j] = entry;
+      }
+    }
+    for (unsigned depth = kDirectBits; active > 0; depth += kStride) {
+      size_t next = 0;
+      for (size_t a = 0; a < active; ++a) {
+        size_t j = pending[a];
+        const Node& node = nodes_[nodeIndex[j]];
+        unsigned c = chunk(k[j], depth, kStride);
+        uint64_t upTo = (uint64_t(2) << c) - 1;
+        if (node.nodes & (uint64_t(1) << c)) {
+          nodeIndex[j] = node.nodeBase + popcount(node.nodes & upTo) - 1;
+          prefetch(&nodes_[nodeIndex[j]]);
+          pending[next++] = uint8_t(j);
+        } else {
+          r[j] = leaves_[node.leafBase + popcount(node.leaves & upTo) - 1];
+        }
+      }
+      active = next;
+    }
+  }
+}
+
+size_t Poptrie::memoryUsage() const {
+  return direct_.capacity() * sizeof(uint32_t) +
+      nodes_.capacity() * sizeof(Node) + leaves_.capacity() * sizeof(uint32_t);
+}
+
+} // namespace detail
+} // namespace folly
@@ -27,6 +27,8 @@
 #include <chrono>
 #include <type_traits>
 
+#include <folly/tracing/LockProfiler.h>
+
 // Android, OSX, and Cygwin don't have timed mutexes
 #if defined(ANDROID) || defined(__ANDROID__) || defined(__APPLE__) || \
     defined(__CYGWIN__)
@@ -459,22 +461,68 @@ unlock_shared_or_unique(Mutex& mutex) {
  * selection over the type of lock operation to perform.
  */
 
+namespace detail {
+
+/*
+ * The lock policies profile the lock operations of the mutexes that don't
+ * profile them themselves (see LockProfiler.h).  acquire() returns whether
+ * it acquired the lock.
+ */
+template <class Mutex, class Acquire>
+typename std::enable_if<LockProfiledByMutex<Mutex>::value, bool>::type
+profileAcquire(Mutex&, LockProfileKind, Acquire&& acquire) {
+  return acquire();
+}
+template <class Mutex, class Acquire>
+typename std::enable_if<!LockProfiledByMutex<Mutex>::value, bool>::type
+profileAcquire(Mutex& mutex, LockProfileKind kind, Acquire&& acquire) {
+  LockProfileWait profile;
+  if (!acquire()) {
+    return false;
+  }
+  profile.acquired(&mutex, kind);
+  return true;
+}
+
+template <class Mutex>
+typename std::enable_if<LockProfiledByMutex<Mutex>::value>::type
+profileRelease(Mutex&) {}
+template <class Mutex>
+typename std::enable_if<!LockProfiledByMutex<Mutex>::value>::type
+profileRelease(Mutex& mutex) {
+  lockProfileReleased(&mutex);
+}
+
+template <class Mutex>
+constexpr LockProfileKind shareableProfileKind() {
+  return LockTraits<Mutex>::is_shared ? LockProfileKind::SHARED
+                                      : LockProfileKind::EXCLUSIVE;
+}
+
+} // namespace detail
+
 /**
  * A lock policy that performs exclusive lock operations.
  */
 struct LockPolicyExclusive {
   template <class Mutex>
   static void lock(Mutex& mutex) {
-    LockTraits<Mutex>::lock(mutex);
+    detail::profileAcquire(mutex, LockProfileKind::EXCLUSIVE, [&] {
+      LockTraits<Mutex>::lock(mutex);
+      return true;
+    });
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>& timeout) {
-    return LockTraits<Mutex>::try_lock_for(mutex, timeout);
+    return detail::profileAcquire(mutex, LockProfileKind::EXCLUSIVE, [&] {
+      return LockTraits<Mutex>::try_lock_for(mutex, timeout);
+    });
   }
   template <class Mutex>
   static void unlock(Mutex& mutex) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock(mutex);
   }
 };
@@ -486,16 +534,22 @@ struct LockPolicyExclusive {
 struct LockPolicyShared {
   template <class Mutex>
   static void lock(Mutex& mutex) {
-    LockTraits<Mutex>::lock_shared(mutex);
+    detail::profileAcquire(mutex, LockProfileKind::SHARED, [&] {
+      LockTraits<Mutex>::lock_shared(mutex);
+      return true;
+    });
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>& timeout) {
-    return LockTraits<Mutex>::try_lock_shared_for(mutex, timeout);
+    return detail::profileAcquire(mutex, LockProfileKind::SHARED, [&] {
+      return LockTraits<Mutex>::try_lock_shared_for(mutex, timeout);
+    });
   }
   template <class Mutex>
   static void unlock(Mutex& mutex) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_shared(mutex);
   }
 };
@@ -507,16 +561,23 @@ struct LockPolicyShared {
 struct LockPolicyShareable {
   template <class Mutex>
   static void lock(Mutex& mutex) {
-    lock_shared_or_unique(mutex);
+    detail::profileAcquire(mutex, detail::shareableProfileKind<Mutex>(), [&] {
+      lock_shared_or_unique(mutex);
+      return true;
+    });
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>& timeout) {
-    return try_lock_shared_or_unique_for(mutex, timeout);
+    return detail::profileAcquire(
+        mutex, detail::shareableProfileKind<Mutex>(), [&] {
+          return try_lock_shared_or_unique_for(mutex, timeout);
+        });
   }
   template <class Mutex>
   static void unlock(Mutex& mutex) {
+    detail::profileRelease(mutex);
     unlock_shared_or_unique(mutex);
   }
 };
@@ -531,16 +592,22 @@ struct LockPolicyShareable {
 struct LockPolicyUpgrade {
   template <class Mutex>
   static void lock(Mutex& mutex) {
-    LockTraits<Mutex>::lock_upgrade(mutex);
+    detail::profileAcquire(mutex, LockProfileKind::UPGRADE, [&] {
+      LockTraits<Mutex>::lock_upgrade(mutex);
+      return true;
+    });
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>& timeout) {
-    return LockTraits<Mutex>::try_lock_upgrade_for(mutex, timeout);
+    return detail::profileAcquire(mutex, LockProfileKind::UPGRADE, [&] {
+      return LockTraits<Mutex>::try_lock_upgrade_for(mutex, timeout);
+    });
   }
   template <class Mutex>
   static void unlock(Mutex& mutex) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_upgrade(mutex);
   }
 };
@@ -558,13 +625,21 @@ struct LockPolicyUpgrade {
 struct LockPolicyFromUpgradeToExclusive : public LockPolicyExclusive {
   template <class Mutex>
   static void lock(Mutex& mutex) {
-    LockTraits<Mutex>::unlock_upgrade_and_lock(mutex);
+    detail::profileRelease(mutex);
+    detail::profileAcquire(mutex, LockProfileKind::EXCLUSIVE, [&] {
+      LockTraits<Mutex>::unlock_upgrade_and_lock(mutex);
+      return true;
+    });
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>& timeout) {
-    return LockTraits<Mutex>::try_unlock_upgrade_and_lock_for(mutex, timeout);
+    detail::profileRelease(mutex);
+    return detail::profileAcquire(mutex, LockProfileKind::EXCLUSIVE, [&] {
+      return LockTraits<Mutex>::try_unlock_upgrade_and_lock_for(
+          mutex, timeout);
+    });
   }
 };
 
@@ -578,12 +653,15 @@ struct LockPolicyFromUpgradeToExclusive : public LockPolicyExclusive {
 struct LockPolicyFromExclusiveToUpgrade : public LockPolicyUpgrade {
   template <class Mutex>
   static void lock(Mutex& mutex) {
+    // Downgrades don't wait, and aren't sampled
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_and_lock_upgrade(mutex);
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>&) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_and_lock_upgrade(mutex);
 
     // downgrade should be non blocking and should succeed
@@ -601,12 +679,15 @@ struct LockPolicyFromExclusiveToUpgrade : public LockPolicyUpgrade {
 struct LockPolicyFromUpgradeToShared : public LockPolicyShared {
   template <class Mutex>
   static void lock(Mutex& mutex) {
+    // Downgrades don't wait, and aren't sampled
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_upgrade_and_lock_shared(mutex);
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>&) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_upgrade_and_lock_shared(mutex);
 
     // downgrade should be non blocking and should succeed
@@ -624,12 +705,15 @@ struct LockPolicyFromUpgradeToShared : public LockPolicyShared {
 struct LockPolicyFromExclusiveToShared : public LockPolicyShared {
   template <class Mutex>
   static void lock(Mutex& mutex) {
+    // Downgrades don't wait, and aren't sampled
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_and_lock_shared(mutex);
   }
   template <class Mutex, class Rep, class Period>
   static bool try_lock_for(
       Mutex& mutex,
       const std::chrono::duration<Rep, Period>&) {
+    detail::profileRelease(mutex);
     LockTraits<Mutex>::unlock_and_lock_shared(mutex);
 
     // downgrade should be non blocking and should succeed
@@ -22,6 +22,7 @@
 
 #include <folly/Portability.h>
 #include <folly/detail/Futex.h>
+#include <folly/tracing/LockProfiler.h>
 
 #if defined(__clang__)
 #define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
@@ -145,6 +146,7 @@ inline uint32_t MicroLockCore::waitBit(unsigned slot) const {
 }
 
 void MicroLockCore::unlock(unsigned slot) {
+  detail::lockProfileReleased(this);
   detail::Futex<>* wordPtr = word();
   uint32_t oldWord;
   uint32_t newWord;
@@ -184,6 +186,7 @@ bool MicroLockBase<MaxSpins, MaxYields>::try_lock(unsigned slot) {
   // else has the lock (by looking at heldBit) or see our CAS succeed.
   // A failed CAS by itself does not indicate lock-acquire failure.
 
+  detail::LockProfileWait profile;
   detail::Futex<>* wordPtr = word();
   uint32_t oldWord = wordPtr->load(std::memory_order_relaxed);
   do {
@@ -195,6 +198,7 @@ bool MicroLockBase<MaxSpins, MaxYields>::try_lock(unsigned slot) {
                                            std::memory_order_acquire,
                                            std::memory_order_relaxed));
 
+  profile.acquired(this, LockProfileKind::EXCLUSIVE);
   return true;
 }
 
@@ -203,6 +207,7 @@ void MicroLockBase<MaxSpins, MaxYields>::lock(unsigned slot) {
 
   static_assert(MaxSpins + MaxYields < (unsigned)-1, "overflow");
 
+  detail::LockProfileWait profile;
   detail::Futex<>* wordPtr = word();
   uint32_t oldWord;
   oldWord = wordPtr->load(std::memory_order_relaxed);
@@ -220,7 +225,15 @@ void MicroLockBase<MaxSpins, MaxYields>::lock(unsigned slot) {
     // lockSlowPath emits its own memory barrier
     lockSlowPath(oldWord, wordPtr, heldBit(slot), MaxSpins, MaxYields);
   }
+  // The slots of a MicroLock are profiled as one lock
+  profile.acquired(this, LockProfileKind::EXCLUSIVE);
 }
 
 typedef MicroLockBase<> MicroLock;
+
+namespace detail {
+template <unsigned MaxSpins, unsigned MaxYields>
+struct LockProfiledByMutex<MicroLockBase<MaxSpins, MaxYields>>
+    : std::true_type {};
+} // namespace detail
 } // namespace folly
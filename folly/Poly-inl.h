@@ -55,12 +55,12 @@ inline PolyVal<I>::PolyVal(T&& t) {
   assert(typeid(t) == typeid(_t<std::decay<T>>) ||
        !"Dynamic and static exception types don't match. Object would "
         "be sliced when storing in Poly.");
-  if (inSitu<U>()) {
+  if (inSitu<U, InlineSize::value>()) {
     ::new (static_cast<void*>(&_data_()->buff_)) U(static_cast<T&&>(t));
   } else {
     _data_()->pobj_ = new U(static_cast<T&&>(t));
   }
-  vptr_ = vtableFor<I, U>();
+  vptr_ = vtableFor<I, U, InlineSize::value>();
 }
 
 template <class I>
@@ -70,6 +70,10 @@ inline PolyVal<I>::PolyVal(Poly<I2> that) {
       !Copyable::value || std::is_copy_constructible<Poly<I2>>::value,
       "This Poly<> requires copyability, and the source object is not "
       "copyable");
+  static_assert(
+      InlineSizeOf<I2>::value <= InlineSize::value,
+      "The objects that the source Poly<> stores in situ may not fit in "
+      "this one; give the interface an InlineSize at least as large");
   auto* that_vptr = PolyAccess::vtable(that);
   if (that_vptr->state_ != State::eEmpty) {
     that_vptr->ops_(Op::eMove, PolyAccess::data(that), _data_());
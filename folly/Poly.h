@@ -487,6 +487,7 @@ struct PolyVal : PolyImpl<I> {
   struct NoneSuch {};
   using Copyable = std::is_copy_constructible<PolyImpl<I>>;
   using PolyOrNonesuch = If<Copyable::value, PolyVal, NoneSuch>;
+  using InlineSize = InlineSizeOf<I>;
 
   using PolyRoot<I>::vptr_;
 
@@ -1125,8 +1126,22 @@ using PolyValOrRef = If<std::is_reference<I>::value, PolyRef<I>, PolyVal<I>>;
  * \par Implementation notes
  * \par
  * `Poly` will store "small" objects in an internal buffer, avoiding the cost of
- * of dynamic allocations. At present, this size is not configurable; it is
- * pegged at the size of two `double`s.
+ * of dynamic allocations. By default, the buffer is the size of two
+ * `double`s. An interface can ask for a larger one with an `InlineSize`
+ * member, which the interfaces that extend it inherit:
+ *
+ *     struct IHandler {
+ *       static constexpr std::size_t InlineSize = 64;
+ *       // Interface, Members...
+ *     };
+ *
+ * \par
+ * A `Poly<I>` can only be converted to a `Poly<J>` of a base interface `J`
+ * whose `InlineSize` is at least that of `I`.
+ *
+ * \par
+ * For a closed set of types, `PolySealed` (folly/poly/Sealed.h) stores the
+ * object in situ and dispatches without indirect calls.
  *
  * \par
  * `Poly` objects are always nothrow movable. If you store an object in one that
@@ -430,6 +430,13 @@ constexpr auto kMscVer = 0;
 #define FOLLY_HAS_COROUTINES 1
 #endif
 
+// C++20 coroutines, e.g. -fcoroutines on GCC.  Only folly::coro
+// (folly/experimental/coro) supports them, Optional and Expected need the
+// Coroutines TS.
+#if __cpp_impl_coroutine >= 201902L
+#define FOLLY_HAS_STD_COROUTINES 1
+#endif
+
 // MSVC 2017.5
 #if __cpp_noexcept_function_type >= 201510 || _MSC_FULL_VER >= 191225816
 #define FOLLY_HAVE_NOEXCEPT_FUNCTION_TYPE 1
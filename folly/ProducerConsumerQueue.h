@@ -33,7 +33,8 @@ namespace folly {
 
 /*
  * ProducerConsumerQueue is a one producer and one consumer queue
- * without locks.
+ * without locks.  See folly/concurrency/SPSCRingBuffer.h for batches and
+ * for queues shared between processes.
  */
 template <class T>
 struct ProducerConsumerQueue {
@@ -54,6 +54,12 @@ struct StateSize<std::subtract_with_carry_engine<UIntType, w, s, r>> {
   using type = std::integral_constant<size_t, r*((w + 31) / 32)>;
 };
 
+template <>
+struct StateSize<XoshiroPRNG> {
+  // XoshiroPRNG::seed() takes 256 bits
+  using type = std::integral_constant<size_t, 8>;
+};
+
 template <typename RNG>
 using StateSizeT = _t<StateSize<RNG>>;
 
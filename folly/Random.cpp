@@ -21,6 +21,7 @@
 #include <mutex>
 #include <random>
 
+#include <folly/CpuId.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/SingletonThreadLocal.h>
@@ -34,6 +35,10 @@
 #include <wincrypt.h> // @manual
 #endif
 
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
 namespace folly {
 
 namespace {
@@ -150,4 +155,173 @@ ThreadLocalPRNG::ThreadLocalPRNG() {
 uint32_t ThreadLocalPRNG::getImpl(LocalInstancePRNG* local) {
   return local->rng();
 }
+
+namespace {
+
+#if FOLLY_X64
+
+template <int K>
+FOLLY_TARGET_ATTRIBUTE("avx2")
+inline __m256i rotl(__m256i x) {
+  return _mm256_or_si256(_mm256_slli_epi64(x, K), _mm256_srli_epi64(x, 64 - K));
+}
+
+// One step of xoshiro256++ on 4 streams at once, returning their results
+FOLLY_TARGET_ATTRIBUTE("avx2")
+inline __m256i xoshiroStep(__m256i (&s)[4]) {
+  __m256i result =
+      _mm256_add_epi64(rotl<23>(_mm256_add_epi64(s[0], s[3])), s[0]);
+  __m256i t = _mm256_slli_epi64(s[1], 17);
+  s[2] = _mm256_xor_si256(s[2], s[0]);
+  s[3] = _mm256_xor_si256(s[3], s[1]);
+  s[1] = _mm256_xor_si256(s[1], s[2]);
+  s[0] = _mm256_xor_si256(s[0], s[3]);
+  s[2] = _mm256_xor_si256(s[2], t);
+  s[3] = rotl<45>(s[3]);
+  return result;
+}
+
+// Steps the 8 streams of s n / 8 times, writing their results to out;
+// returns how many it wrote.  The two halves of the streams make two
+// independent dependency chains.
+FOLLY_TARGET_ATTRIBUTE("avx2")
+size_t xoshiroFillAvx2(uint64_t (&s)[4][8], uint8_t* out, size_t n) {
+  __m256i a[4];
+  __m256i b[4];
+  for (int j = 0; j < 4; ++j) {
+    a[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&s[j][0]));
+    b[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&s[j][4]));
+  }
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i ra = xoshiroStep(a);
+    __m256i rb = xoshiroStep(b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * i), ra);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * i + 32), rb);
+  }
+  for (int j = 0; j < 4; ++j) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&s[j][0]), a[j]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&s[j][4]), b[j]);
+  }
+  return i;
+}
+
+bool hasAvx2() {
+  static const bool avx2 = CpuId().avx2();
+  return avx2;
+}
+
+#endif
+
+uint64_t splitmix64(uint64_t& state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+} // namespace
+
+void XoshiroPRNG::seed(uint64_t seed) {
+  uint64_t state[4];
+  for (auto& word : state) {
+    word = splitmix64(seed);
+  }
+  seedState(state);
+}
+
+void XoshiroPRNG::seedState(uint64_t state[4]) {
+  static constexpr uint64_t kJump[] = {
+      0x180ec6d33cfd0abaULL,
+      0xd5a61266f0c9392cULL,
+      0xa9582618e03fc9aaULL,
+      0x39abdc4529b1661cULL,
+  };
+  // The all-zero state is the one state xoshiro never leaves
+  if ((state[0] | state[1] | state[2] | state[3]) == 0) {
+    state[0] = 1;
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    s_[i][0] = state[i];
+  }
+  // Jumping stream 0 by 2^128 steps (in place), as in the reference
+  // implementation, gives stream 1, and so on
+  for (next_ = 1; next_ < kStreams; ++next_) {
+    uint64_t jumped[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < 4; ++i) {
+      s_[i][next_] = s_[i][next_ - 1];
+    }
+    for (uint64_t jump : kJump) {
+      for (int b = 0; b < 64; ++b) {
+        if (jump & (uint64_t(1) << b)) {
+          for (size_t i = 0; i < 4; ++i) {
+            jumped[i] ^= s_[i][next_];
+          }
+        }
+        (*this)();
+        next_ = (next_ + kStreams - 1) % kStreams;
+      }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+      s_[i][next_] = jumped[i];
+    }
+  }
+  next_ = 0;
+}
+
+void XoshiroPRNG::fillWords(void* out, size_t n) {
+  auto p = static_cast<uint8_t*>(out);
+  size_t i = 0;
+  for (; i < n && next_ != 0; ++i) {
+    uint64_t v = (*this)();
+    std::memcpy(p + 8 * i, &v, 8);
+  }
+#if FOLLY_X64
+  if (hasAvx2()) {
+    i += xoshiroFillAvx2(s_, p + 8 * i, n - i);
+  }
+#endif
+  for (; i < n; ++i) {
+    uint64_t v = (*this)();
+    std::memcpy(p + 8 * i, &v, 8);
+  }
+}
+
+void XoshiroPRNG::fill(Range<uint64_t*> out) {
+  fillWords(out.data(), out.size());
+}
+
+void XoshiroPRNG::fill(Range<uint32_t*> out) {
+  fillWords(out.data(), out.size() / 2);
+  if (out.size() % 2) {
+    out.back() = uint32_t((*this)());
+  }
+}
+
+namespace {
+
+struct LocalXoshiroPRNG {
+  LocalXoshiroPRNG() : rng(Random::create<XoshiroPRNG>()) {}
+
+  XoshiroPRNG rng;
+};
+
+XoshiroPRNG& localXoshiroPRNG() {
+  static SingletonThreadLocal<LocalXoshiroPRNG, RandomTag> local;
+  return local.get().rng;
+}
+
+} // namespace
+
+void Random::fill(Range<uint32_t*> out) {
+  localXoshiroPRNG().fill(out);
+}
+
+void Random::fill(Range<uint64_t*> out) {
+  localXoshiroPRNG().fill(out);
+}
+
+void Random::fill(Range<uint32_t*> out, uint32_t max) {
+  fill(out, max, localXoshiroPRNG());
+}
 } // namespace folly
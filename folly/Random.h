@@ -19,10 +19,13 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <random>
 #include <type_traits>
 
+#include <folly/Likely.h>
 #include <folly/Portability.h>
+#include <folly/Range.h>
 #include <folly/Traits.h>
 
 #if FOLLY_HAVE_EXTRANDOM_SFMT19937
@@ -75,6 +78,114 @@ class ThreadLocalPRNG {
   LocalInstancePRNG* local_;
 };
 
+/**
+ * A fast PRNG: xoshiro256++, as described in
+ * David Blackman and Sebastiano Vigna (2021)
+ *   Scrambled Linear Pseudorandom Number Generators
+ *   ACM Transactions on Mathematical Software
+ *
+ * run as kStreams interleaved streams, each 2^128 steps ahead of the
+ * previous one, so that fill() can step them all at once with AVX2;
+ * operator() returns their outputs round robin, and fill() returns the same
+ * values as calling operator() in a loop.  Like ThreadLocalPRNG, it's for
+ * statistical randomness only, not for anything which requires security.
+ *
+ * Much faster than the Mersenne twister, with 256 bits of state per stream
+ * rather than 20000, and 64-bit results:
+ *
+ *   auto rng = folly::Random::create<folly::XoshiroPRNG>();
+ *   std::vector<uint32_t> samples(n);
+ *   folly::Random::fill(range(samples), 100, rng);  // in [0, 100)
+ */
+class XoshiroPRNG {
+ public:
+  using result_type = uint64_t;
+  static constexpr size_t kStreams = 8;
+
+  explicit XoshiroPRNG(uint64_t seed = 0x853c49e6748fea9bULL) {
+    this->seed(seed);
+  }
+
+  template <
+      class SeedSeq,
+      class = _t<std::enable_if<
+          !std::is_integral<SeedSeq>::value &&
+          !std::is_same<SeedSeq, XoshiroPRNG>::value>>>
+  explicit XoshiroPRNG(SeedSeq& seq) {
+    seed(seq);
+  }
+
+  /**
+   * Seed from a single value, expanded to the 256 bits of state with
+   * splitmix64.
+   */
+  void seed(uint64_t seed);
+
+  /**
+   * Seed from a std::seed_seq, or any other SeedSequence.
+   */
+  template <
+      class SeedSeq,
+      class = _t<std::enable_if<!std::is_integral<SeedSeq>::value>>>
+  void seed(SeedSeq& seq) {
+    uint32_t words[8];
+    seq.generate(std::begin(words), std::end(words));
+    uint64_t state[4];
+    std::memcpy(state, words, sizeof(state));
+    seedState(state);
+  }
+
+  result_type operator()() {
+    uint64_t* s0 = &s_[0][next_];
+    uint64_t* s1 = &s_[1][next_];
+    uint64_t* s2 = &s_[2][next_];
+    uint64_t* s3 = &s_[3][next_];
+    uint64_t result = rotl(*s0 + *s3, 23) + *s0;
+    uint64_t t = *s1 << 17;
+    *s2 ^= *s0;
+    *s3 ^= *s1;
+    *s1 ^= *s2;
+    *s0 ^= *s3;
+    *s2 ^= t;
+    *s3 = rotl(*s3, 45);
+    next_ = (next_ + 1) % kStreams;
+    return result;
+  }
+
+  /**
+   * Fill out with the next out.size() values, as by operator().
+   */
+  void fill(Range<uint64_t*> out);
+
+  /**
+   * Fill out with random values: the next (out.size() + 1) / 2 values as by
+   * operator(), split in two.
+   */
+  void fill(Range<uint32_t*> out);
+
+  static constexpr result_type min() {
+    return std::numeric_limits<result_type>::min();
+  }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  // Seed stream 0 with state, and each other stream with the state of the
+  // previous one, jumped by 2^128 steps
+  void seedState(uint64_t state[4]);
+
+  // Fill n * 8 bytes at out
+  void fillWords(void* out, size_t n);
+
+  // s_[i][k] is the i-th word of the state of stream k
+  uint64_t s_[4][kStreams];
+  size_t next_;
+};
 
 class Random {
 
@@ -84,6 +195,16 @@ class Random {
       std::is_unsigned<typename std::result_of<RNG&()>::type>::value,
       RNG>::type;
 
+  // Generators with 64-bit results return 64 random bits at once
+  template <class RNG>
+  static uint64_t rand64(RNG& rng, std::true_type) {
+    return rng();
+  }
+  template <class RNG>
+  static uint64_t rand64(RNG& rng, std::false_type) {
+    return ((uint64_t)rng() << 32) | rng();
+  }
+
  public:
   // Default generator type.
 #if FOLLY_HAVE_EXTRANDOM_SFMT19937
@@ -194,7 +315,12 @@ class Random {
    */
   template <class RNG = ThreadLocalPRNG, class /* EnableIf */ = ValidRNG<RNG>>
   static uint64_t rand64(RNG&& rng) {
-    return ((uint64_t)rng() << 32) | rng();
+    return rand64(
+        rng,
+        std::integral_constant<
+            bool,
+            (sizeof(typename std::result_of<RNG&()>::type) >=
+             sizeof(uint64_t))>());
   }
 
   /**
@@ -282,6 +408,73 @@ class Random {
     return std::uniform_real_distribution<double>(min, max)(rng);
   }
 
+  /**
+   * Fills out with random values, from a per-thread XoshiroPRNG, which is
+   * much faster than calling rand32() or rand64() in a loop.
+   */
+  static void fill(Range<uint32_t*> out);
+  static void fill(Range<uint64_t*> out);
+
+  /**
+   * Fills out with random values given a specific RNG.
+   */
+  template <class RNG, class /* EnableIf */ = ValidRNG<RNG>>
+  static void fill(Range<uint32_t*> out, RNG&& rng) {
+    for (auto& v : out) {
+      v = rand32(rng);
+    }
+  }
+  template <class RNG, class /* EnableIf */ = ValidRNG<RNG>>
+  static void fill(Range<uint64_t*> out, RNG&& rng) {
+    for (auto& v : out) {
+      v = rand64(rng);
+    }
+  }
+  static void fill(Range<uint32_t*> out, XoshiroPRNG& rng) {
+    rng.fill(out);
+  }
+  static void fill(Range<uint64_t*> out, XoshiroPRNG& rng) {
+    rng.fill(out);
+  }
+
+  /**
+   * Fills out with random values in [0, max), from a per-thread
+   * XoshiroPRNG. If max == 0, fills it with 0.
+   *
+   * Uses Lemire's method, without division but for the rare values that
+   * would bias the results, which are drawn again:
+   *   Daniel Lemire (2019)
+   *   Fast Random Integer Generation in an Interval
+   *   ACM Transactions on Modeling and Computer Simulation
+   */
+  static void fill(Range<uint32_t*> out, uint32_t max);
+
+  /**
+   * Fills out with random values in [0, max) given a specific RNG.
+   * If max == 0, fills it with 0.
+   */
+  template <class RNG, class /* EnableIf */ = ValidRNG<RNG>>
+  static void fill(Range<uint32_t*> out, uint32_t max, RNG&& rng) {
+    fill(out, rng);
+    bound(out, max, [&] { return rand32(rng); });
+  }
+
+ private:
+  // Maps the random values of out to [0, max) in place
+  template <class Gen>
+  static void bound(Range<uint32_t*> out, uint32_t max, Gen gen) {
+    for (auto& v : out) {
+      uint64_t m = uint64_t(v) * max;
+      if (UNLIKELY(uint32_t(m) < max)) {
+        // Values of m mod 2^32 below 2^32 mod max are one too many
+        uint32_t threshold = (0u - max) % max;
+        while (uint32_t(m) < threshold) {
+          m = uint64_t(gen()) * max;
+        }
+      }
+      v = uint32_t(m >> 32);
+    }
+  }
 };
 
 /*
@@ -20,7 +20,7 @@
 #pragma once
 
 #include <folly/Portability.h>
-#include <folly/hash/SpookyHashV2.h>
+#include <folly/hash/Xxh3.h>
 #include <folly/portability/BitsFunctexcept.h>
 #include <folly/portability/Constexpr.h>
 #include <folly/portability/String.h>
@@ -41,6 +41,7 @@
 #include <folly/CpuId.h>
 #include <folly/Likely.h>
 #include <folly/Traits.h>
+#include <folly/detail/RangeCaseInsensitive.h>
 #include <folly/detail/RangeCommon.h>
 #include <folly/detail/RangeSse42.h>
 
@@ -1256,6 +1257,93 @@ struct AsciiCaseInsensitive {
   }
 };
 
+/**
+ * ASCII case-insensitive comparison and search of StringPieces.  These
+ * compare 16 or 32 bytes at a time where SIMD is available, where
+ * equals(other, AsciiCaseInsensitive()) and qfind() with a comparator go
+ * one byte at a time.
+ */
+inline bool caseInsensitiveEqual(StringPiece a, StringPiece b) {
+  return a.size() == b.size() &&
+      detail::asciiCaseInsensitiveEqual(a.data(), b.data(), a.size());
+}
+
+inline bool caseInsensitiveStartsWith(StringPiece s, StringPiece prefix) {
+  return s.size() >= prefix.size() &&
+      detail::asciiCaseInsensitiveEqual(s.data(), prefix.data(), prefix.size());
+}
+
+inline bool caseInsensitiveEndsWith(StringPiece s, StringPiece suffix) {
+  return s.size() >= suffix.size() &&
+      detail::asciiCaseInsensitiveEqual(
+             s.end() - suffix.size(), suffix.data(), suffix.size());
+}
+
+/**
+ * Finds the first occurrence of needle in haystack, ignoring ASCII case.
+ * Returns the offset from the beginning of haystack, or string::npos.
+ */
+inline size_t ifind(StringPiece haystack, StringPiece needle) {
+  return detail::asciiCaseInsensitiveFind(haystack, needle);
+}
+
+inline size_t qfind(
+    const Range<const char*>& haystack,
+    const Range<const char*>& needle,
+    AsciiCaseInsensitive) {
+  return ifind(haystack, needle);
+}
+
+/**
+ * A string to be searched for or compared with many times, ignoring ASCII
+ * case, such as an HTTP header name.  Keeps a lowercase copy of the
+ * needle, so only the other side has to be converted.
+ *
+ *   static const CaseInsensitiveNeedle kHost("Host");
+ *   if (kHost.matches(name)) { ... }
+ *   auto pos = kHost.find(buffer);
+ */
+class CaseInsensitiveNeedle {
+ public:
+  explicit CaseInsensitiveNeedle(StringPiece needle)
+      : lower_(needle.begin(), needle.end()) {
+    for (auto& c : lower_) {
+      if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+      }
+    }
+  }
+
+  // The needle, lowercase
+  StringPiece str() const {
+    return lower_;
+  }
+
+  size_t size() const {
+    return lower_.size();
+  }
+
+  bool matches(StringPiece s) const {
+    return s.size() == lower_.size() &&
+        detail::asciiCaseInsensitiveEqualLower(
+               s.data(), lower_.data(), lower_.size());
+  }
+
+  bool isPrefixOf(StringPiece s) const {
+    return s.size() >= lower_.size() &&
+        detail::asciiCaseInsensitiveEqualLower(
+               s.data(), lower_.data(), lower_.size());
+  }
+
+  // Offset of the first occurrence in haystack, or string::npos
+  size_t find(StringPiece haystack) const {
+    return detail::asciiCaseInsensitiveFindLower(haystack, lower_);
+  }
+
+ private:
+  std::string lower_;
+};
+
 template <class Iter>
 size_t qfind(
     const Range<Iter>& haystack,
@@ -1356,7 +1444,7 @@ struct hasher<
     folly::Range<T*>,
     typename std::enable_if<std::is_pod<T>::value, void>::type> {
   size_t operator()(folly::Range<T*> r) const {
-    return hash::SpookyHashV2::Hash64(r.begin(), r.size() * sizeof(T), 0);
+    return hash::xxh3_64(r.begin(), r.size() * sizeof(T));
   }
 };
 
@@ -29,6 +29,7 @@
 #include <folly/detail/Futex.h>
 #include <folly/portability/Asm.h>
 #include <folly/portability/SysResource.h>
+#include <folly/tracing/LockProfiler.h>
 
 // SharedMutex is a reader-writer lock.  It is small, very fast, scalable
 // on multi-core, and suitable for use when readers or writers may block.
@@ -288,29 +289,47 @@ class SharedMutexImpl {
   }
 
   void lock() {
+    detail::LockProfileWait profile;
     WaitForever ctx;
     (void)lockExclusiveImpl(kHasSolo, ctx);
+    profile.acquired(this, LockProfileKind::EXCLUSIVE);
   }
 
   bool try_lock() {
+    detail::LockProfileWait profile;
     WaitNever ctx;
-    return lockExclusiveImpl(kHasSolo, ctx);
+    if (!lockExclusiveImpl(kHasSolo, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::EXCLUSIVE);
+    return true;
   }
 
   template <class Rep, class Period>
   bool try_lock_for(const std::chrono::duration<Rep, Period>& duration) {
+    detail::LockProfileWait profile;
     WaitForDuration<Rep, Period> ctx(duration);
-    return lockExclusiveImpl(kHasSolo, ctx);
+    if (!lockExclusiveImpl(kHasSolo, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::EXCLUSIVE);
+    return true;
   }
 
   template <class Clock, class Duration>
   bool try_lock_until(
       const std::chrono::time_point<Clock, Duration>& absDeadline) {
+    detail::LockProfileWait profile;
     WaitUntilDeadline<Clock, Duration> ctx{absDeadline};
-    return lockExclusiveImpl(kHasSolo, ctx);
+    if (!lockExclusiveImpl(kHasSolo, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::EXCLUSIVE);
+    return true;
   }
 
   void unlock() {
+    detail::lockProfileReleased(this);
     // It is possible that we have a left-over kWaitingNotS if the last
     // unlock_shared() that let our matching lock() complete finished
     // releasing before lock()'s futexWait went to sleep.  Clean it up now
@@ -322,54 +341,89 @@ class SharedMutexImpl {
   // Managing the token yourself makes unlock_shared a bit faster
 
   void lock_shared() {
+    detail::LockProfileWait profile;
     WaitForever ctx;
     (void)lockSharedImpl(nullptr, ctx);
+    profile.acquired(this, LockProfileKind::SHARED);
   }
 
   void lock_shared(Token& token) {
+    detail::LockProfileWait profile;
     WaitForever ctx;
     (void)lockSharedImpl(&token, ctx);
+    profile.acquired(this, LockProfileKind::SHARED);
   }
 
   bool try_lock_shared() {
+    detail::LockProfileWait profile;
     WaitNever ctx;
-    return lockSharedImpl(nullptr, ctx);
+    if (!lockSharedImpl(nullptr, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   bool try_lock_shared(Token& token) {
+    detail::LockProfileWait profile;
     WaitNever ctx;
-    return lockSharedImpl(&token, ctx);
+    if (!lockSharedImpl(&token, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   template <class Rep, class Period>
   bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& duration) {
+    detail::LockProfileWait profile;
     WaitForDuration<Rep, Period> ctx(duration);
-    return lockSharedImpl(nullptr, ctx);
+    if (!lockSharedImpl(nullptr, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   template <class Rep, class Period>
   bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& duration,
                            Token& token) {
+    detail::LockProfileWait profile;
     WaitForDuration<Rep, Period> ctx(duration);
-    return lockSharedImpl(&token, ctx);
+    if (!lockSharedImpl(&token, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   template <class Clock, class Duration>
   bool try_lock_shared_until(
       const std::chrono::time_point<Clock, Duration>& absDeadline) {
+    detail::LockProfileWait profile;
     WaitUntilDeadline<Clock, Duration> ctx{absDeadline};
-    return lockSharedImpl(nullptr, ctx);
+    if (!lockSharedImpl(nullptr, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   template <class Clock, class Duration>
   bool try_lock_shared_until(
       const std::chrono::time_point<Clock, Duration>& absDeadline,
       Token& token) {
+    detail::LockProfileWait profile;
     WaitUntilDeadline<Clock, Duration> ctx{absDeadline};
-    return lockSharedImpl(&token, ctx);
+    if (!lockSharedImpl(&token, ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::SHARED);
+    return true;
   }
 
   void unlock_shared() {
+    detail::lockProfileReleased(this);
     auto state = state_.load(std::memory_order_acquire);
 
     // kPrevDefer can only be set if HasE or BegunE is set
@@ -387,6 +441,7 @@ class SharedMutexImpl {
   }
 
   void unlock_shared(Token& token) {
+    detail::lockProfileReleased(this);
     assert(token.type_ == Token::Type::INLINE_SHARED ||
            token.type_ == Token::Type::DEFERRED_SHARED);
 
@@ -400,6 +455,7 @@ class SharedMutexImpl {
   }
 
   void unlock_and_lock_shared() {
+    detail::lockProfileReleased(this);
     // We can't use state_ -=, because we need to clear 2 bits (1 of which
     // has an uncertain initial state) and set 1 other.  We might as well
     // clear the relevant wake bits at the same time.  Note that since S
@@ -422,42 +478,64 @@ class SharedMutexImpl {
   }
 
   void lock_upgrade() {
+    detail::LockProfileWait profile;
     WaitForever ctx;
     (void)lockUpgradeImpl(ctx);
+    profile.acquired(this, LockProfileKind::UPGRADE);
   }
 
   bool try_lock_upgrade() {
+    detail::LockProfileWait profile;
     WaitNever ctx;
-    return lockUpgradeImpl(ctx);
+    if (!lockUpgradeImpl(ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::UPGRADE);
+    return true;
   }
 
   template <class Rep, class Period>
   bool try_lock_upgrade_for(
       const std::chrono::duration<Rep, Period>& duration) {
+    detail::LockProfileWait profile;
     WaitForDuration<Rep, Period> ctx(duration);
-    return lockUpgradeImpl(ctx);
+    if (!lockUpgradeImpl(ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::UPGRADE);
+    return true;
   }
 
   template <class Clock, class Duration>
   bool try_lock_upgrade_until(
       const std::chrono::time_point<Clock, Duration>& absDeadline) {
+    detail::LockProfileWait profile;
     WaitUntilDeadline<Clock, Duration> ctx{absDeadline};
-    return lockUpgradeImpl(ctx);
+    if (!lockUpgradeImpl(ctx)) {
+      return false;
+    }
+    profile.acquired(this, LockProfileKind::UPGRADE);
+    return true;
   }
 
   void unlock_upgrade() {
+    detail::lockProfileReleased(this);
     auto state = (state_ -= kHasU);
     assert((state & (kWaitingNotS | kHasSolo)) == 0);
     wakeRegisteredWaiters(state, kWaitingE | kWaitingU);
   }
 
   void unlock_upgrade_and_lock() {
+    detail::lockProfileReleased(this);
+    detail::LockProfileWait profile;
     // no waiting necessary, so waitMask is empty
     WaitForever ctx;
     (void)lockExclusiveImpl(0, ctx);
+    profile.acquired(this, LockProfileKind::EXCLUSIVE);
   }
 
   void unlock_upgrade_and_lock_shared() {
+    detail::lockProfileReleased(this);
     auto state = (state_ -= kHasU - kIncrHasS);
     assert((state & (kWaitingNotS | kHasSolo)) == 0);
     wakeRegisteredWaiters(state, kWaitingE | kWaitingU);
@@ -469,6 +547,7 @@ class SharedMutexImpl {
   }
 
   void unlock_and_lock_upgrade() {
+    detail::lockProfileReleased(this);
     // We can't use state_ -=, because we need to clear 2 bits (1 of
     // which has an uncertain initial state) and set 1 other.  We might
     // as well clear the relevant wake bits at the same time.
@@ -1340,6 +1419,17 @@ typedef SharedMutexImpl<true> SharedMutexReadPriority;
 typedef SharedMutexImpl<false> SharedMutexWritePriority;
 typedef SharedMutexWritePriority SharedMutex;
 
+namespace detail {
+template <
+    bool ReaderPriority,
+    typename Tag_,
+    template <typename> class Atom,
+    bool BlockImmediately>
+struct LockProfiledByMutex<
+    SharedMutexImpl<ReaderPriority, Tag_, Atom, BlockImmediately>>
+    : std::true_type {};
+} // namespace detail
+
 // Prevent the compiler from instantiating these in other translation units.
 // They are instantiated once in SharedMutex.cpp
 extern template class SharedMutexImpl<true>;
@@ -32,6 +32,10 @@ SingletonHolder<T>& SingletonHolder<T>::singleton() {
 [[noreturn]] void singletonWarnDoubleRegistrationAndAbort(
     const TypeDescriptor& type);
 
+// Time this thread spent creating singletons within the create function
+// that it's running, so that each singleton's own time can be reported
+std::chrono::nanoseconds& singletonNestedCreationTime();
+
 template <typename T>
 void SingletonHolder<T>::registerSingleton(CreateFunc c, TeardownFunc t) {
   std::lock_guard<std::mutex> entry_lock(mutex_);
@@ -136,6 +140,19 @@ folly::ReadMostlySharedPtr<T> SingletonHolder<T>::try_get_fast() {
   return instance_weak_fast_.lock();
 }
 
+template <typename T>
+template <typename Func>
+auto SingletonHolder<T>::apply(Func&& f) -> decltype(f(std::declval<T*>())) {
+  if (UNLIKELY(state_.load(std::memory_order_acquire) !=
+               SingletonHolderState::Living)) {
+    createInstance();
+  }
+
+  hazptr::hazptr_holder hptr;
+  auto instance = hptr.get_protected(protected_instance_);
+  return std::forward<Func>(f)(instance ? instance->ptr : nullptr);
+}
+
 template <typename T>
 bool SingletonHolder<T>::hasLiveInstance() {
   return !instance_weak_.expired();
@@ -150,6 +167,11 @@ void SingletonHolder<T>::preDestroyInstance(
 
 template <typename T>
 void SingletonHolder<T>::destroyInstance() {
+  if (auto instance = protected_instance_.exchange(nullptr)) {
+    // Wait for the apply() calls that are using the instance
+    hazptr::hazptr_obj_cohort cohort;
+    instance->retire(cohort);
+  }
   state_ = SingletonHolderState::Dead;
   instance_.reset();
   instance_copy_.reset();
@@ -253,9 +275,29 @@ void SingletonHolder<T>::createInstance() {
   auto print_destructor_stack_trace =
     std::make_shared<std::atomic<bool>>(false);
 
+  auto& nestedTime = detail::singletonNestedCreationTime();
+  auto const outerNestedTime = nestedTime;
+  nestedTime = std::chrono::nanoseconds::zero();
+  auto const start = std::chrono::steady_clock::now();
+  auto creationTime = [&] {
+    auto const total = std::chrono::steady_clock::now() - start;
+    auto const self = total - nestedTime;
+    nestedTime = outerNestedTime + total;
+    return SingletonVault::CreationTime{
+        type().name(), total, self, start, getOSThreadID()};
+  };
+  T* created;
+  try {
+    created = create_();
+  } catch (...) {
+    creationTime();
+    throw;
+  }
+  auto const time = creationTime();
+
   // Can't use make_shared -- no support for a custom deleter, sadly.
   std::shared_ptr<T> instance(
-      create_(),
+      created,
       [ destroy_baton, print_destructor_stack_trace, type = type() ](
           T*) mutable {
         destroy_baton->post();
@@ -285,6 +327,8 @@ void SingletonHolder<T>::createInstance() {
   instance_ptr_ = instance.get();
   instance_.reset(std::move(instance));
   instance_weak_fast_ = instance_;
+  protected_instance_.store(
+      new ProtectedInstance(instance_ptr_), std::memory_order_release);
 
   destroy_baton_ = std::move(destroy_baton);
   print_destructor_stack_trace_ = std::move(print_destructor_stack_trace);
@@ -294,6 +338,14 @@ void SingletonHolder<T>::createInstance() {
   state_.store(SingletonHolderState::Living, std::memory_order_release);
 
   vault_.creationOrder_.wlock()->push_back(type());
+  vault_.creationTimes_.wlock()->push_back(time);
+  VLOG(2) << "Created singleton " << time.name << " in "
+          << std::chrono::duration_cast<std::chrono::microseconds>(time.self)
+                 .count()
+          << "us (" << std::chrono::duration_cast<std::chrono::microseconds>(
+                           time.total)
+                           .count()
+          << "us with the singletons it created)";
 }
 
 } // namespace detail
@@ -50,6 +50,11 @@ SingletonVault::Type SingletonVault::defaultVaultType() {
 
 namespace detail {
 
+std::chrono::nanoseconds& singletonNestedCreationTime() {
+  static thread_local std::chrono::nanoseconds time{};
+  return time;
+}
+
 [[noreturn]] void singletonWarnDoubleRegistrationAndAbort(
     const TypeDescriptor& type) {
   // Ensure the availability of std::cerr
@@ -237,6 +242,7 @@ void SingletonVault::destroyInstances() {
     auto creationOrder = creationOrder_.wlock();
     creationOrder->clear();
   }
+  creationTimes_.wlock()->clear();
 }
 
 void SingletonVault::reenableInstances() {
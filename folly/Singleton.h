@@ -119,6 +119,11 @@
 // Singletons won't be recreated after destroyInstances call. If you
 // want to re-enable singleton creation (say after fork was called) you
 // should call reenableInstances.
+//
+// Hot paths that only need the instance for the duration of a call can
+// use Singleton<T>::apply(func), which doesn't touch reference counts: the
+// instance is protected by a hazard pointer while func runs, and
+// destroyInstances() waits for it.
 
 #pragma once
 #include <folly/Baton.h>
@@ -130,10 +135,13 @@
 #include <folly/Synchronized.h>
 #include <folly/detail/StaticSingletonManager.h>
 #include <folly/experimental/ReadMostlySharedPtr.h>
+#include <folly/experimental/hazptr/hazptr.h>
 #include <folly/hash/Hash.h>
+#include <folly/system/ThreadId.h>
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -270,6 +278,8 @@ struct SingletonHolder : public SingletonHolderBase {
   inline std::weak_ptr<T> get_weak();
   inline std::shared_ptr<T> try_get();
   inline folly::ReadMostlySharedPtr<T> try_get_fast();
+  template <typename Func>
+  inline auto apply(Func&& f) -> decltype(f(std::declval<T*>()));
 
   void registerSingleton(CreateFunc c, TeardownFunc t);
   void registerSingletonMock(CreateFunc c, TeardownFunc t);
@@ -314,6 +324,15 @@ struct SingletonHolder : public SingletonHolderBase {
   std::weak_ptr<T> instance_weak_;
   // Fast equivalent of instance_weak_
   folly::ReadMostlyWeakPtr<T> instance_weak_fast_;
+  // The instance, for apply(), which protects it with a hazard pointer.
+  // Set before state is changed to Living, and retired before the
+  // instance is torn down.
+  struct ProtectedInstance
+      : hazptr::hazptr_obj_base<ProtectedInstance> {
+    explicit ProtectedInstance(T* p) : ptr(p) {}
+    T* const ptr;
+  };
+  std::atomic<ProtectedInstance*> protected_instance_{nullptr};
   // Time we wait on destroy_baton after releasing Singleton shared_ptr.
   std::shared_ptr<folly::Baton<>> destroy_baton_;
   T* instance_ptr_ = nullptr;
@@ -398,6 +417,12 @@ class SingletonVault {
    * If baton ptr is not null, its `post` method is called after all
    * early initialization has completed.
    *
+   * Each singleton is a task of its own, so with a multi-threaded executor,
+   * independent singletons are created in parallel.  A singleton that
+   * needs one that's being created by another task waits for it; one that
+   * needs one that isn't started yet creates it itself, and that one's
+   * task is then skipped.  creationTimes() shows where the time went.
+   *
    * If exceptions are thrown during initialization, this method will still
    * `post` the baton to indicate completion.  The exception will not propagate
    * and future attempts to `try_get` or `get_weak` the failed singleton will
@@ -420,6 +445,27 @@ class SingletonVault {
   // Enable re-creating singletons after destroyInstances() was called.
   void reenableInstances();
 
+  struct CreationTime {
+    std::string name;
+    // Time in the create function, including creating the singletons that
+    // it requested
+    std::chrono::nanoseconds total;
+    // Excluding them: the time of this singleton's own construction, which
+    // still includes waiting for singletons that other threads were creating
+    std::chrono::nanoseconds self;
+    // When the create function was called, and on which thread
+    std::chrono::steady_clock::time_point start;
+    uint64_t threadId;
+  };
+
+  /**
+   * Creation times of the living singletons, in creation order.  Failed
+   * creations aren't included.
+   */
+  std::vector<CreationTime> creationTimes() const {
+    return *creationTimes_.rlock();
+  }
+
   // For testing; how many registered and living singletons we have.
   size_t registeredSingletonCount() const {
     return singletons_.rlock()->size();
@@ -518,6 +564,7 @@ class SingletonVault {
   folly::Synchronized<std::unordered_set<detail::SingletonHolderBase*>>
       eagerInitSingletons_;
   folly::Synchronized<std::vector<detail::TypeDescriptor>> creationOrder_;
+  folly::Synchronized<std::vector<CreationTime>> creationTimes_;
 
   // Using SharedMutexReadPriority is important here, because we want to make
   // sure we don't block nested singleton creation happening concurrently with
@@ -569,6 +616,16 @@ class Singleton {
     return getEntry().try_get_fast();
   }
 
+  // Calls func(T*) with the instance, or with nullptr if the singleton was
+  // destroyed, and returns its result.  Unlike try_get() and try_get_fast(),
+  // no reference count is touched: the instance is protected by a hazard
+  // pointer, and destroyInstances() waits for func to return before tearing
+  // it down.  Don't keep the pointer past func.
+  template <typename Func>
+  static auto apply(Func&& func) -> decltype(func(std::declval<T*>())) {
+    return getEntry().apply(std::forward<Func>(func));
+  }
+
   explicit Singleton(std::nullptr_t /* _ */ = nullptr,
                      typename Singleton::TeardownFunc t = nullptr)
       : Singleton([]() { return new T; }, std::move(t)) {}
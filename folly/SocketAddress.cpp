@@ -27,12 +27,11 @@
 #include <string>
 #include <system_error>
 
-#include <boost/functional/hash.hpp>
-
 #include <folly/CppAttributes.h>
 #include <folly/Exception.h>
 #include <folly/Format.h>
 #include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
 
 namespace {
 
@@ -175,6 +174,36 @@ void SocketAddress::setFromIpPort(const char* addressAndPort) {
   setFromAddrInfo(results.info);
 }
 
+Expected<SocketAddress, SocketAddressFormatError> SocketAddress::tryFromIpPort(
+    StringPiece ip,
+    uint16_t port) noexcept {
+  if (ip.size() >= 2 && ip.front() == '[' && ip.back() == ']') {
+    ip.advance(1);
+    ip.subtract(1);
+  }
+  auto ipAddr = IPAddress::tryFromString(ip);
+  if (ipAddr.hasError()) {
+    return makeUnexpected(SocketAddressFormatError::INVALID_IP);
+  }
+  SocketAddress addr;
+  addr.setFromIpAddrPort(ipAddr.value(), port);
+  return addr;
+}
+
+Expected<SocketAddress, SocketAddressFormatError> SocketAddress::tryFromIpPort(
+    StringPiece addressAndPort) noexcept {
+  // Split at the last colon, as HostAndPort does
+  auto colon = addressAndPort.rfind(':');
+  if (colon == StringPiece::npos) {
+    return makeUnexpected(SocketAddressFormatError::MISSING_PORT);
+  }
+  auto port = tryTo<uint16_t>(addressAndPort.subpiece(colon + 1));
+  if (port.hasError()) {
+    return makeUnexpected(SocketAddressFormatError::INVALID_PORT);
+  }
+  return tryFromIpPort(addressAndPort.subpiece(0, colon), port.value());
+}
+
 void SocketAddress::setFromHostPort(const char* hostAndPort) {
   HostAndPort hp(hostAndPort, true);
   ScopedAddrInfo results(getAddrInfo(hp.host, hp.port, 0));
@@ -377,7 +406,8 @@ std::string SocketAddress::getAddressStr() const {
   if (!isFamilyInet()) {
     throw std::invalid_argument("Can't get address str for non ip address");
   }
-  return storage_.addr.str();
+  char str[IPAddress::kMaxStrSize];
+  return std::string(str, storage_.addr.str(str));
 }
 
 bool SocketAddress::isFamilyInet() const {
@@ -386,9 +416,15 @@ bool SocketAddress::isFamilyInet() const {
 }
 
 void SocketAddress::getAddressStr(char* buf, size_t buflen) const {
-  auto ret = getAddressStr();
-  size_t len = std::min(buflen - 1, ret.size());
-  memcpy(buf, ret.data(), len);
+  if (!isFamilyInet()) {
+    throw std::invalid_argument("Can't get address str for non ip address");
+  }
+  if (buflen == 0) {
+    return;
+  }
+  char str[IPAddress::kMaxStrSize];
+  size_t len = std::min(buflen - 1, storage_.addr.str(str));
+  memcpy(buf, str, len);
   buf[len] = '\0';
 }
 
@@ -510,7 +546,7 @@ std::string SocketAddress::describe() const {
   }
 }
 
-bool SocketAddress::operator==(const SocketAddress& other) const {
+bool SocketAddress::equalsSlow(const SocketAddress& other) const {
   if (external_ != other.external_ || other.getFamily() != getFamily()) {
     return false;
   }
@@ -562,37 +598,51 @@ bool SocketAddress::prefixMatch(
   }
 }
 
-size_t SocketAddress::hash() const {
-  size_t seed = folly::hash::twang_mix64(getFamily());
-
-  if (external_) {
-    enum { kUnixPathMax = sizeof(storage_.un.addr->sun_path) };
-    const char* path = storage_.un.addr->sun_path;
-    auto pathLength = storage_.un.pathLength();
-    // TODO: this probably could be made more efficient
-    for (off_t n = 0; n < pathLength; ++n) {
-      boost::hash_combine(seed, folly::hash::twang_mix64(uint64_t(path[n])));
-    }
-  }
-
+size_t SocketAddress::hashSlow() const {
   switch (getFamily()) {
     case AF_INET:
-    case AF_INET6: {
-      boost::hash_combine(seed, port_);
-      boost::hash_combine(seed, storage_.addr.hash());
-      break;
-    }
-    case AF_UNIX:
+    case AF_INET6:
+      return pack().hash();
+    case AF_UNIX: {
       DCHECK(external_);
-      break;
+      return size_t(hash::SpookyHashV2::Hash64(
+          storage_.un.addr->sun_path,
+          size_t(storage_.un.pathLength()),
+          AF_UNIX));
+    }
     case AF_UNSPEC:
     default:
       throw std::invalid_argument(
           "SocketAddress: unsupported address family "
           "for hashing");
   }
+}
+
+void SocketAddress::packThrow() {
+  throw std::invalid_argument(
+      "SocketAddress::pack() called on non-IP address");
+}
 
-  return seed;
+void SocketAddress::setFromPacked(const PackedSocketAddress& packed) {
+  switch (packed.family()) {
+    case AF_INET: {
+      in_addr addr;
+      memcpy(&addr, packed.addr, sizeof(addr));
+      setFromIpAddrPort(IPAddress(IPAddressV4(addr)), packed.port());
+      return;
+    }
+    case AF_INET6: {
+      in6_addr addr;
+      memcpy(&addr, packed.addr, sizeof(addr));
+      IPAddressV6 v6(addr);
+      v6.setScopeId(packed.scopeId());
+      setFromIpAddrPort(IPAddress(v6), packed.port());
+      return;
+    }
+    default:
+      throw std::invalid_argument(
+          "SocketAddress::setFromPacked() called on non-IP address");
+  }
 }
 
 struct addrinfo*
@@ -18,16 +18,74 @@
 
 #include <sys/types.h>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 #include <string>
 
+#include <folly/Expected.h>
 #include <folly/IPAddress.h>
 #include <folly/Portability.h>
 #include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/hash/Hash.h>
 #include <folly/portability/Sockets.h>
 
 namespace folly {
 
+/**
+ * Error codes for the non-throwing SocketAddress::tryFromIpPort().
+ */
+enum class SocketAddressFormatError { INVALID_IP, INVALID_PORT, MISSING_PORT };
+
+/**
+ * An IPv4 or IPv6 SocketAddress in 24 trivially copyable bytes, for keys of
+ * connection tables and the like: comparing or hashing one takes a few word
+ * operations, without SocketAddress's family dispatch.  Two of them are equal
+ * iff the SocketAddresses they were packed from are; in particular an IPv4
+ * address and its IPv4-mapped IPv6 address are different.
+ */
+struct PackedSocketAddress {
+  // The address in network byte order; IPv4 addresses in the first 4 bytes,
+  // the rest zero.
+  uint64_t addr[2];
+  // port | scope id << 16 | family << 32
+  uint64_t meta;
+
+  sa_family_t family() const {
+    return sa_family_t(meta >> 32);
+  }
+  uint16_t port() const {
+    return uint16_t(meta);
+  }
+  uint16_t scopeId() const {
+    return uint16_t(meta >> 16);
+  }
+
+  size_t hash() const {
+    return size_t(hash::hash_128_to_64(
+        hash::hash_128_to_64(addr[0], addr[1]), meta));
+  }
+
+  friend bool operator==(
+      const PackedSocketAddress& a,
+      const PackedSocketAddress& b) {
+    // No branches: equal keys have to be compared all the way anyway
+    return ((a.addr[0] ^ b.addr[0]) | (a.addr[1] ^ b.addr[1]) |
+            (a.meta ^ b.meta)) == 0;
+  }
+  friend bool operator!=(
+      const PackedSocketAddress& a,
+      const PackedSocketAddress& b) {
+    return !(a == b);
+  }
+};
+
+static_assert(
+    IsTriviallyCopyable<PackedSocketAddress>::value &&
+        sizeof(PackedSocketAddress) == 24,
+    "PackedSocketAddress must be 24 trivially copyable bytes");
+
 class SocketAddress {
  public:
   SocketAddress() = default;
@@ -76,6 +134,10 @@ class SocketAddress {
     setFromIpAddrPort(ipAddr, port);
   }
 
+  explicit SocketAddress(const PackedSocketAddress& packed) {
+    setFromPacked(packed);
+  }
+
   SocketAddress(const SocketAddress& addr) {
     port_ = addr.port_;
     if (addr.getFamily() == AF_UNIX) {
@@ -205,6 +267,13 @@ class SocketAddress {
    */
   void setFromIpAddrPort(const IPAddress& ip, uint16_t port);
 
+  /**
+   * Initialize this SocketAddress from what pack() returned.
+   *
+   * Raises std::invalid_argument if packed is not an IPv4 or IPv6 address.
+   */
+  void setFromPacked(const PackedSocketAddress& packed);
+
   /**
    * Initialize this SocketAddress from a local port number.
    *
@@ -261,6 +330,17 @@ class SocketAddress {
     return setFromIpPort(addressAndPort.c_str());
   }
 
+  /**
+   * Non-throwing versions of setFromIpPort().  The address is parsed with
+   * IPAddress rather than getaddrinfo(), so they take neither a lock nor a
+   * system call; IPv6 addresses may be in brackets ("[::1]:80").
+   */
+  static Expected<SocketAddress, SocketAddressFormatError> tryFromIpPort(
+      StringPiece ip,
+      uint16_t port) noexcept;
+  static Expected<SocketAddress, SocketAddressFormatError> tryFromIpPort(
+      StringPiece addressAndPort) noexcept;
+
   /**
    * Initialize this SocketAddress from a host name and port number.
    *
@@ -419,7 +499,9 @@ class SocketAddress {
   std::string getAddressStr() const;
 
   /**
-   * Get a string representation of the IPv4 or IPv6 address.
+   * Get a string representation of the IPv4 or IPv6 address, NUL-terminated
+   * and truncated to fit in buflen bytes, without allocating.  A buffer of
+   * IPAddress::kMaxStrSize + 1 bytes is always large enough.
    *
    * Raises std::invalid_argument if an error occurs (for example, if
    * the address is not an IPv4 or IPv6 address).
@@ -515,7 +597,22 @@ class SocketAddress {
    */
   std::string describe() const;
 
-  bool operator==(const SocketAddress& other) const;
+  bool operator==(const SocketAddress& other) const {
+    if (!external_ && !other.external_ &&
+        storage_.addr.family() == other.storage_.addr.family()) {
+      switch (storage_.addr.family()) {
+        case AF_INET:
+          return port_ == other.port_ &&
+              storage_.addr.asV4() == other.storage_.addr.asV4();
+        case AF_INET6:
+          return port_ == other.port_ &&
+              storage_.addr.asV6() == other.storage_.addr.asV6();
+        default:
+          break;
+      }
+    }
+    return equalsSlow(other);
+  }
   bool operator!=(const SocketAddress& other) const {
     return !(*this == other);
   }
@@ -536,7 +633,44 @@ class SocketAddress {
   /**
    * Compuate a hash of a SocketAddress.
    */
-  size_t hash() const;
+  size_t hash() const {
+    if (!external_) {
+      auto family = storage_.addr.family();
+      if (family == AF_INET || family == AF_INET6) {
+        return pack().hash();
+      }
+    }
+    return hashSlow();
+  }
+
+  /**
+   * This IPv4 or IPv6 address and port as a PackedSocketAddress; hash()
+   * returns the same as pack().hash().
+   *
+   * Raises std::invalid_argument if this is not an IPv4 or IPv6 address.
+   */
+  PackedSocketAddress pack() const {
+    PackedSocketAddress packed{};
+    uint64_t scope = 0;
+    auto family = getFamily();
+    switch (family) {
+      case AF_INET: {
+        auto addr = storage_.addr.asV4().toAddr();
+        std::memcpy(packed.addr, &addr, sizeof(addr));
+        break;
+      }
+      case AF_INET6: {
+        const auto& v6 = storage_.addr.asV6();
+        std::memcpy(packed.addr, v6.bytes(), sizeof(packed.addr));
+        scope = v6.getScopeId();
+        break;
+      }
+      default:
+        packThrow();
+    }
+    packed.meta = port_ | scope << 16 | uint64_t(family) << 32;
+    return packed;
+  }
 
  private:
   /**
@@ -584,6 +718,10 @@ class SocketAddress {
   std::string getIpString(int flags) const;
   void getIpString(char* buf, size_t buflen, int flags) const;
 
+  bool equalsSlow(const SocketAddress& other) const;
+  size_t hashSlow() const;
+  [[noreturn]] static void packThrow();
+
   void updateUnixAddressLength(socklen_t addrlen);
 
   /*
@@ -624,4 +762,11 @@ struct hash<folly::SocketAddress> {
     return addr.hash();
   }
 };
+
+template <>
+struct hash<folly::PackedSocketAddress> {
+  size_t operator()(const folly::PackedSocketAddress& addr) const {
+    return addr.hash();
+  }
+};
 } // namespace std
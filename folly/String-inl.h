@@ -232,8 +232,15 @@ void uriUnescape(StringPiece str, String& out, UriEscapeMode mode) {
       // else fallthrough
       FOLLY_FALLTHROUGH;
     default:
-      ++p;
-      break;
+      {
+        // Skip to the next character to decode; find() is memchr() and
+        // find_first_of() qfind_first_byte_of(), which use SIMD.
+        StringPiece rest(p + 1, str.end());
+        auto next = mode == UriEscapeMode::QUERY ? rest.find_first_of("%+")
+                                                 : rest.find('%');
+        p = next == StringPiece::npos ? str.end() : rest.begin() + next;
+        break;
+      }
     }
   }
   out.append(&*last, size_t(p - last));
@@ -247,14 +254,8 @@ namespace detail {
  */
 inline size_t delimSize(char)          { return 1; }
 inline size_t delimSize(StringPiece s) { return s.size(); }
-inline bool atDelim(const char* s, char c) {
- return *s == c;
-}
-inline bool atDelim(const char* s, StringPiece sp) {
-  return !std::memcmp(s, sp.start(), sp.size());
-}
 
-// These are used to short-circuit internalSplit() in the case of
+// These are used to short-circuit internalJoinAppend() in the case of
 // 1-character strings.
 inline char delimFront(char c) {
   // This one exists only for compile-time; it should never be called.
@@ -266,12 +267,14 @@ inline char delimFront(StringPiece s) {
   return *s.start();
 }
 
+// Pieces found per call to splitDelimited()
+constexpr size_t kSplitBatchSize = 32;
+
 /*
  * Shared implementation for all the split() overloads.
  *
- * This uses some external helpers that are overloaded to let this
- * algorithm be more performant if the deliminator is a single
- * character instead of a whole string.
+ * Pieces are found a batch at a time by splitDelimited(), which searches
+ * for the delimiter several bytes at a time.
  *
  * @param ignoreEmpty iff true, don't copy empty segments to output
  */
@@ -280,40 +283,18 @@ void internalSplit(DelimT delim, StringPiece sp, OutputIterator out,
     bool ignoreEmpty) {
   assert(sp.empty() || sp.start() != nullptr);
 
-  const char* s = sp.start();
-  const size_t strSize = sp.size();
-  const size_t dSize = delimSize(delim);
-
-  if (dSize > strSize || dSize == 0) {
-    if (!ignoreEmpty || strSize > 0) {
-      *out++ = to<OutStringT>(sp);
-    }
-    return;
-  }
-  if (boost::is_same<DelimT,StringPiece>::value && dSize == 1) {
-    // Call the char version because it is significantly faster.
-    return internalSplit<OutStringT>(delimFront(delim), sp, out,
-      ignoreEmpty);
-  }
-
-  size_t tokenStartPos = 0;
-  size_t tokenSize = 0;
-  for (size_t i = 0; i <= strSize - dSize; ++i) {
-    if (atDelim(&s[i], delim)) {
-      if (!ignoreEmpty || tokenSize > 0) {
-        *out++ = to<OutStringT>(sp.subpiece(tokenStartPos, tokenSize));
+  StringPiece pieces[kSplitBatchSize];
+  size_t n;
+  do {
+    n = splitDelimited(delim, &sp, pieces, kSplitBatchSize);
+    for (size_t i = 0; i < n; ++i) {
+      if (!ignoreEmpty || !pieces[i].empty()) {
+        *out++ = to<OutStringT>(pieces[i]);
       }
-
-      tokenStartPos = i + dSize;
-      tokenSize = 0;
-      i += dSize - 1;
-    } else {
-      ++tokenSize;
     }
-  }
-  tokenSize = strSize - tokenStartPos;
-  if (!ignoreEmpty || tokenSize > 0) {
-    *out++ = to<OutStringT>(sp.subpiece(tokenStartPos, tokenSize));
+  } while (n == kSplitBatchSize);
+  if (!ignoreEmpty || !sp.empty()) {
+    *out++ = to<OutStringT>(sp);
   }
 }
 
@@ -408,6 +389,27 @@ split(const Delim& delimiter, StringPiece input, OutputTypes&... outputs) {
       detail::prepareDelim(delimiter), input, outputs...);
 }
 
+template <class Delim>
+size_t splitInto(const Delim& delimiter,
+                 StringPiece input,
+                 StringPiece* out,
+                 size_t n) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t count = detail::splitDelimited(
+      detail::prepareDelim(delimiter), &input, out, n - 1);
+  out[count++] = input;
+  return count;
+}
+
+template <class Delim>
+LazySplit splitLazy(const Delim& delimiter,
+                    StringPiece input,
+                    bool ignoreEmpty) {
+  return LazySplit(detail::prepareDelim(delimiter), input, ignoreEmpty);
+}
+
 namespace detail {
 
 /*
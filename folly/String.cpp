@@ -16,6 +16,7 @@
 
 #include <folly/String.h>
 
+#include <algorithm>
 #include <cctype>
 #include <cerrno>
 #include <cstdarg>
@@ -25,8 +26,18 @@
 
 #include <glog/logging.h>
 
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
 #include <folly/ScopeGuard.h>
 
+#if FOLLY_X64
+#include <immintrin.h>
+#elif FOLLY_AARCH64 && defined(__ARM_NEON) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define FOLLY_SPLIT_NEON 1
+#endif
+
 namespace folly {
 
 static inline bool is_oddspace(char c) {
@@ -519,6 +530,21 @@ void toLowerAscii(char* str, size_t length) {
     offset += 4;
   }
 
+#if FOLLY_X64 && FOLLY_SSE_PREREQ(2, 0)
+  // Convert 16 characters at a time.  The comparisons are signed, so bytes
+  // above 0x7f are never taken for uppercase letters.
+  while (offset + 16 <= length) {
+    auto p = reinterpret_cast<__m128i*>(str + offset);
+    auto v = _mm_loadu_si128(p);
+    auto upper = _mm_and_si128(
+        _mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+        _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    _mm_storeu_si128(
+        p, _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+    offset += 16;
+  }
+#endif
+
   // Convert 8 characters at a time
   while (offset + 8 <= length) {
     toLowerAscii64(*(uint64_t*)(str + offset));
@@ -638,6 +664,223 @@ std::string stripLeftMargin(std::string s) {
   return join("\n", piecer);
 }
 
+namespace {
+
+// Delimiter search for splitDelimited(): match(p, c) returns a mask of the
+// 64 bytes from p, with bit i set iff p[i] == c.
+
+#if FOLLY_X64
+
+struct Sse2Matcher {
+  static uint64_t match(const char* p, char c) {
+    const __m128i v = _mm_set1_epi8(c);
+    auto in = reinterpret_cast<const __m128i*>(p);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(in + i), v);
+      mask |= uint64_t(uint16_t(_mm_movemask_epi8(eq))) << (16 * i);
+    }
+    return mask;
+  }
+};
+
+struct Avx2Matcher {
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static uint64_t match(const char* p, char c) {
+    const __m256i v = _mm256_set1_epi8(c);
+    auto in = reinterpret_cast<const __m256i*>(p);
+    auto lo = _mm256_cmpeq_epi8(_mm256_loadu_si256(in), v);
+    auto hi = _mm256_cmpeq_epi8(_mm256_loadu_si256(in + 1), v);
+    return uint64_t(uint32_t(_mm256_movemask_epi8(lo))) |
+        (uint64_t(uint32_t(_mm256_movemask_epi8(hi))) << 32);
+  }
+};
+
+bool hasAvx2() {
+  static const bool avx2 = CpuId().avx2();
+  return avx2;
+}
+
+#elif FOLLY_SPLIT_NEON
+
+struct NeonMatcher {
+  static uint64_t match(const char* p, char c) {
+    const uint8x16_t v = vdupq_n_u8(uint8_t(c));
+    const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128,
+                             1, 2, 4, 8, 16, 32, 64, 128};
+    auto in = reinterpret_cast<const uint8_t*>(p);
+    uint8x16_t m[4];
+    for (int i = 0; i < 4; ++i) {
+      m[i] = vandq_u8(vceqq_u8(vld1q_u8(in + 16 * i), v), bits);
+    }
+    // Pairwise sums gather the bits of each group of 8 bytes into a byte
+    uint8x16_t sum =
+        vpaddq_u8(vpaddq_u8(m[0], m[1]), vpaddq_u8(m[2], m[3]));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+  }
+};
+
+#endif
+
+// Finds the pieces ending with delim in *input that start at or after
+// *input's beginning, searching from p, until there are n in out.
+size_t splitCharTail(
+    char delim,
+    StringPiece* input,
+    const char* p,
+    StringPiece* out,
+    size_t count,
+    size_t n) {
+  const char* start = input->begin();
+  const char* end = input->end();
+  while (count < n && p != end) {
+    auto q = static_cast<const char*>(memchr(p, delim, size_t(end - p)));
+    if (!q) {
+      break;
+    }
+    out[count++] = StringPiece(start, q);
+    start = p = q + 1;
+  }
+  input->assign(start, end);
+  return count;
+}
+
+template <class Matcher>
+size_t splitChar(char delim, StringPiece* input, StringPiece* out, size_t n) {
+  const char* start = input->begin();
+  const char* p = start;
+  const char* end = input->end();
+  size_t count = 0;
+  for (; n != 0 && end - p >= 64; p += 64) {
+    for (auto mask = Matcher::match(p, delim); mask != 0; mask &= mask - 1) {
+      const char* q = p + findFirstSet(mask) - 1;
+      out[count++] = StringPiece(start, q);
+      start = q + 1;
+      if (count == n) {
+        input->assign(start, end);
+        return count;
+      }
+    }
+  }
+  input->assign(start, end);
+  return splitCharTail(delim, input, p, out, count, n);
+}
+
+// As splitCharTail(), for delimiters of at least two characters
+size_t splitStringTail(
+    StringPiece delim,
+    StringPiece* input,
+    const char* p,
+    StringPiece* out,
+    size_t count,
+    size_t n) {
+  const char* start = input->begin();
+  const char* end = input->end();
+  p = std::max(p, start);
+  while (count < n) {
+    auto pos = qfind(StringPiece(p, end), delim);
+    if (pos == std::string::npos) {
+      break;
+    }
+    out[count++] = StringPiece(start, p + pos);
+    start = p = p + pos + delim.size();
+  }
+  input->assign(start, end);
+  return count;
+}
+
+// Candidates are where both the first and the last characters of delim
+// match, and are compared in full
+template <class Matcher>
+size_t splitString(
+    StringPiece delim,
+    StringPiece* input,
+    StringPiece* out,
+    size_t n) {
+  const char* start = input->begin();
+  const char* p = start;
+  const char* end = input->end();
+  const size_t last = delim.size() - 1;
+  size_t count = 0;
+  for (; n != 0 && end - p >= ptrdiff_t(64 + last); p += 64) {
+    auto mask = Matcher::match(p, delim.front()) &
+        Matcher::match(p + last, delim.back());
+    for (; mask != 0; mask &= mask - 1) {
+      const char* q = p + findFirstSet(mask) - 1;
+      if (q < start || memcmp(q + 1, delim.data() + 1, last - 1) != 0) {
+        continue;
+      }
+      out[count++] = StringPiece(start, q);
+      start = q + delim.size();
+      if (count == n) {
+        input->assign(start, end);
+        return count;
+      }
+    }
+  }
+  input->assign(start, end);
+  return splitStringTail(delim, input, p, out, count, n);
+}
+
+} // namespace
+
+namespace detail {
+
+size_t splitDelimited(char delim, StringPiece* input, StringPiece* out,
+                      size_t n) {
+#if FOLLY_X64
+  return hasAvx2() ? splitChar<Avx2Matcher>(delim, input, out, n)
+                   : splitChar<Sse2Matcher>(delim, input, out, n);
+#elif FOLLY_SPLIT_NEON
+  return splitChar<NeonMatcher>(delim, input, out, n);
+#else
+  return splitCharTail(delim, input, input->begin(), out, 0, n);
+#endif
+}
+
+size_t splitDelimited(StringPiece delim, StringPiece* input,
+                      StringPiece* out, size_t n) {
+  if (delim.size() <= 1) {
+    return delim.empty() ? 0 : splitDelimited(delim.front(), input, out, n);
+  }
+#if FOLLY_X64
+  return hasAvx2() ? splitString<Avx2Matcher>(delim, input, out, n)
+                   : splitString<Sse2Matcher>(delim, input, out, n);
+#elif FOLLY_SPLIT_NEON
+  return splitString<NeonMatcher>(delim, input, out, n);
+#else
+  return splitStringTail(delim, input, input->begin(), out, 0, n);
+#endif
+}
+
+} // namespace detail
+
+constexpr size_t LazySplit::kBatchSize;
+
+void LazySplit::refill() {
+  pos_ = 0;
+  size_ = 0;
+  while (size_ == 0 && !done_) {
+    size_ = isChar_
+        ? detail::splitDelimited(delimChar_, &input_, pieces_, kBatchSize)
+        : detail::splitDelimited(delim_, &input_, pieces_, kBatchSize);
+    if (size_ < kBatchSize) {
+      pieces_[size_++] = input_;
+      done_ = true;
+    }
+    if (ignoreEmpty_) {
+      size_ = size_t(
+          std::remove_if(
+              pieces_,
+              pieces_ + size_,
+              [](StringPiece piece) { return piece.empty(); }) -
+          pieces_);
+    }
+  }
+}
+
+
 } // namespace folly
 
 #ifdef FOLLY_DEFINED_DMGL
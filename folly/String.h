@@ -18,7 +18,9 @@
 #define FOLLY_STRING_H_
 
 #include <cstdarg>
+#include <cstddef>
 #include <exception>
+#include <iterator>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -434,6 +436,140 @@ void splitTo(const Delim& delimiter,
              OutputIterator out,
              const bool ignoreEmpty = false);
 
+namespace detail {
+
+/*
+ * Splits the pieces that end with a delimiter off the front of *input, up
+ * to n of them, writes them to out, and returns how many there were.
+ * *input is left with what follows the last delimiter found, which is the
+ * last piece if fewer than n were found.  Delimiters are searched for 64
+ * bytes at a time with SSE2, AVX2 or NEON.  An empty delimiter is never
+ * found.
+ */
+size_t splitDelimited(char delim, StringPiece* input, StringPiece* out,
+                      size_t n);
+size_t splitDelimited(StringPiece delim, StringPiece* input,
+                      StringPiece* out, size_t n);
+
+} // namespace detail
+
+/*
+ * Split a string into at most n pieces, written to a preallocated array,
+ * without allocating.  Returns the number of pieces; if there are more than
+ * n, the last one holds the rest of the input, unsplit, as with
+ * split<false>().  Splitting each line of a TSV file:
+ *
+ *   StringPiece fields[kMaxColumns];
+ *   size_t n = folly::splitInto('\t', line, fields, kMaxColumns);
+ */
+template <class Delim>
+size_t splitInto(const Delim& delimiter,
+                 StringPiece input,
+                 StringPiece* out,
+                 size_t n);
+
+/*
+ * The pieces of a string split by a delimiter, as split() would produce
+ * them, found as they are iterated over rather than stored in a vector.
+ * This is an input range: it can be iterated over once.  It refers to the
+ * input (and to the delimiter, for string delimiters), which must outlive
+ * it.  Use splitLazy() to create one:
+ *
+ *   for (StringPiece field : folly::splitLazy('\t', line)) {
+ *     ...
+ *   }
+ */
+class LazySplit {
+ public:
+  LazySplit(char delim, StringPiece input, bool ignoreEmpty = false)
+      : delimChar_(delim),
+        isChar_(true),
+        input_(input),
+        ignoreEmpty_(ignoreEmpty) {
+    refill();
+  }
+  LazySplit(StringPiece delim, StringPiece input, bool ignoreEmpty = false)
+      : delim_(delim),
+        isChar_(delim.size() == 1),
+        input_(input),
+        ignoreEmpty_(ignoreEmpty) {
+    if (isChar_) {
+      delimChar_ = delim.front();
+    }
+    refill();
+  }
+
+  class iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef StringPiece value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const StringPiece* pointer;
+    typedef const StringPiece& reference;
+
+    iterator() = default;
+
+    const StringPiece& operator*() const {
+      return split_->pieces_[split_->pos_];
+    }
+    const StringPiece* operator->() const {
+      return &**this;
+    }
+
+    iterator& operator++() {
+      if (++split_->pos_ == split_->size_) {
+        split_->refill();
+        if (split_->size_ == 0) {
+          split_ = nullptr;
+        }
+      }
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const {
+      return split_ == other.split_;
+    }
+    bool operator!=(const iterator& other) const {
+      return split_ != other.split_;
+    }
+
+   private:
+    friend class LazySplit;
+    explicit iterator(LazySplit* split) : split_(split) {}
+
+    LazySplit* split_{nullptr};
+  };
+
+  iterator begin() {
+    return iterator(size_ != 0 ? this : nullptr);
+  }
+  iterator end() {
+    return iterator();
+  }
+
+ private:
+  // Pieces found per call to detail::splitDelimited()
+  static constexpr size_t kBatchSize = 16;
+
+  void refill();
+
+  char delimChar_{'\0'};
+  StringPiece delim_;
+  bool isChar_;
+  // What remains to be split
+  StringPiece input_;
+  bool ignoreEmpty_;
+  bool done_{false};
+  StringPiece pieces_[kBatchSize];
+  size_t pos_{0};
+  size_t size_{0};
+};
+
+template <class Delim>
+LazySplit splitLazy(const Delim& delimiter,
+                    StringPiece input,
+                    bool ignoreEmpty = false);
+
 /*
  * Split a string into a fixed number of string pieces and/or numeric types
  * by delimiter. Conversions are supported for any type which folly:to<> can
@@ -232,6 +232,51 @@ struct ChildErrorInfo {
   _exit(errCode);
 }
 
+#if __linux__
+// Close the file descriptors above stderr for which keep(fd) is false,
+// listing /proc/self/fd rather than trying every descriptor up to the limit:
+// with a large RLIMIT_NOFILE that's a million system calls, all made while
+// the parent is suspended in vfork().  Runs in the child, so it doesn't
+// allocate.  Returns false if /proc/self/fd can't be read.
+template <class Keep>
+bool closeFdsFromProc(Keep keep) {
+  int dirFd = ::open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd == -1) {
+    return false;
+  }
+  struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+  };
+  alignas(LinuxDirent64) char buf[4096];
+  for (;;) {
+    long n = syscall(SYS_getdents64, dirFd, buf, sizeof(buf));
+    if (n <= 0) {
+      ::close(dirFd);
+      return n == 0;
+    }
+    for (long pos = 0; pos < n;) {
+      auto entry = reinterpret_cast<LinuxDirent64*>(buf + pos);
+      pos += entry->d_reclen;
+      int fd = 0;
+      const char* p = entry->d_name;
+      if (*p < '0' || *p > '9') {
+        continue;  // "." and ".."
+      }
+      for (; *p >= '0' && *p <= '9'; ++p) {
+        fd = fd * 10 + (*p - '0');
+      }
+      if (fd >= 3 && fd != dirFd && !keep(fd)) {
+        ::close(fd);
+      }
+    }
+  }
+}
+#endif
+
 } // namespace
 
 void Subprocess::setAllNonBlocking() {
@@ -492,9 +537,15 @@ int Subprocess::prepareChild(const Options& options,
   // any fds in options.fdActions_, and don't touch stdin, stdout, stderr.
   // Ignore errors.
   if (options.closeOtherFds_) {
-    for (int fd = getdtablesize() - 1; fd >= 3; --fd) {
-      if (options.fdActions_.count(fd) == 0) {
-        ::close(fd);
+    auto keep = [&](int fd) { return options.fdActions_.count(fd) != 0; };
+#if __linux__
+    if (!closeFdsFromProc(keep))
+#endif
+    {
+      for (int fd = getdtablesize() - 1; fd >= 3; --fd) {
+        if (!keep(fd)) {
+          ::close(fd);
+        }
       }
     }
   }
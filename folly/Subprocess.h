@@ -330,9 +330,11 @@ class Subprocess {
      * Close all other fds (other than standard input, output, error,
      * and file descriptors explicitly specified with fd()).
      *
-     * This is potentially slow; it's generally a better idea to
-     * set the close-on-exec flag on all file descriptors that shouldn't
-     * be inherited by the child.
+     * On Linux, the open descriptors are listed from /proc/self/fd;
+     * elsewhere (or without /proc), every descriptor up to the limit is
+     * closed, which is slow with a large RLIMIT_NOFILE.  Either way, it's
+     * generally a better idea to set the close-on-exec flag on all file
+     * descriptors that shouldn't be inherited by the child.
      *
      * Even with this option set, standard input, output, and error are
      * not closed; use stdin(CLOSE), stdout(CLOSE), stderr(CLOSE) if you
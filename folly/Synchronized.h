@@ -879,7 +879,10 @@ class LockedPtrBase<SynchronizedType, std::mutex, LockPolicy> {
    */
   ~LockedPtrBase() {
     // The std::unique_lock will automatically release the lock when it is
-    // destroyed, so we don't need to do anything extra here.
+    // destroyed, so we only need to end its profile.
+    if (lock_.owns_lock()) {
+      detail::profileRelease(*lock_.mutex());
+    }
   }
 
   LockedPtrBase(LockedPtrBase&& rhs) noexcept
@@ -887,6 +890,9 @@ class LockedPtrBase<SynchronizedType, std::mutex, LockPolicy> {
     rhs.parent_ = nullptr;
   }
   LockedPtrBase& operator=(LockedPtrBase&& rhs) noexcept {
+    if (lock_.owns_lock()) {
+      detail::profileRelease(*lock_.mutex());
+    }
     lock_ = std::move(rhs.lock_);
     parent_ = rhs.parent_;
     rhs.parent_ = nullptr;
@@ -917,14 +923,19 @@ class LockedPtrBase<SynchronizedType, std::mutex, LockPolicy> {
    */
   void unlock() {
     DCHECK(parent_ != nullptr);
+    detail::profileRelease(parent_->mutex_);
     lock_.unlock();
     parent_ = nullptr;
   }
 
  protected:
   LockedPtrBase() {}
-  explicit LockedPtrBase(SynchronizedType* parent)
-      : lock_(parent->mutex_), parent_(parent) {}
+  explicit LockedPtrBase(SynchronizedType* parent) : parent_(parent) {
+    detail::profileAcquire(parent->mutex_, LockProfileKind::EXCLUSIVE, [&] {
+      lock_ = std::unique_lock<std::mutex>(parent->mutex_);
+      return true;
+    });
+  }
 
   using UnlockerData =
       std::pair<std::unique_lock<std::mutex>, SynchronizedType*>;
@@ -937,12 +948,16 @@ class LockedPtrBase<SynchronizedType, std::mutex, LockPolicy> {
     DCHECK(parent_ != nullptr);
     UnlockerData data(std::move(lock_), parent_);
     parent_ = nullptr;
+    detail::profileRelease(*data.first.mutex());
     data.first.unlock();
     return data;
   }
   void reacquireLock(UnlockerData&& data) {
     lock_ = std::move(data.first);
-    lock_.lock();
+    detail::profileAcquire(*lock_.mutex(), LockProfileKind::EXCLUSIVE, [&] {
+      lock_.lock();
+      return true;
+    });
     parent_ = data.second;
   }
 
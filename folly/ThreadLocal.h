@@ -20,10 +20,12 @@
  * than boost::thread_specific_ptr).
  *
  * Also includes an accessor interface to walk all the thread local child
- * objects of a parent.  accessAllThreads() initializes an accessor which holds
- * a global lock *that blocks all creation and destruction of ThreadLocal
- * objects with the same Tag* and can be used as an iterable container.
- * accessAllThreads() can race with destruction of thread-local elements. We
+ * objects of a parent.  accessAllThreads() initializes an accessor which
+ * collects the objects of all threads and can be used as an iterable
+ * container.  It holds a global lock *that makes exiting threads using
+ * ThreadLocal objects with the same Tag wait before destroying theirs*;
+ * threads can still create objects meanwhile.  accessAllThreads() can race
+ * with destruction of thread-local elements (e.g. by reset()). We
  * provide a strict mode which is dangerous because it requires the access lock
  * to be held while destroying thread-local elements which could cause
  * deadlocks. We gate this mode behind the AccessModeStrict template parameter.
@@ -48,6 +50,7 @@
 #include <folly/detail/ThreadLocalDetail.h>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace folly {
 
@@ -244,12 +247,17 @@ class ThreadLocalPtr {
   // Holds a global lock for iteration through all thread local child objects.
   // Can be used as an iterable container.
   // Use accessAllThreads() to obtain one.
+  //
+  // The objects are collected when the Accessor is created, so threads can
+  // keep creating their objects while it is alive (they aren't visited).
+  // Threads that exit meanwhile wait for it to be released before
+  // destroying theirs.
   class Accessor {
     friend class ThreadLocalPtr<T, Tag, AccessMode>;
 
     threadlocal_detail::StaticMetaBase& meta_;
     SharedMutex* accessAllThreadsLock_;
-    std::mutex* lock_;
+    std::vector<void*> ptrs_;
     uint32_t id_;
 
    public:
@@ -263,46 +271,25 @@ class ThreadLocalPtr {
           boost::bidirectional_traversal_tag> {   // traversal
       friend class Accessor;
       friend class boost::iterator_core_access;
-      const Accessor* accessor_;
-      threadlocal_detail::ThreadEntry* e_;
+      void* const* p_;
 
       void increment() {
-        e_ = e_->next;
-        incrementToValid();
+        ++p_;
       }
 
       void decrement() {
-        e_ = e_->prev;
-        decrementToValid();
+        --p_;
       }
 
       T& dereference() const {
-        return *static_cast<T*>(e_->elements[accessor_->id_].ptr);
+        return *static_cast<T*>(*p_);
       }
 
       bool equal(const Iterator& other) const {
-        return (accessor_->id_ == other.accessor_->id_ &&
-                e_ == other.e_);
+        return p_ == other.p_;
       }
 
-      explicit Iterator(const Accessor* accessor)
-        : accessor_(accessor),
-          e_(&accessor_->meta_.head_) {
-      }
-
-      bool valid() const {
-        return (e_->elements &&
-                accessor_->id_ < e_->elementsCapacity &&
-                e_->elements[accessor_->id_].ptr);
-      }
-
-      void incrementToValid() {
-        for (; e_ != &accessor_->meta_.head_ && !valid(); e_ = e_->next) { }
-      }
-
-      void decrementToValid() {
-        for (; e_ != &accessor_->meta_.head_ && !valid(); e_ = e_->prev) { }
-      }
+      explicit Iterator(void* const* p) : p_(p) {}
     };
 
     ~Accessor() {
@@ -310,11 +297,11 @@ class ThreadLocalPtr {
     }
 
     Iterator begin() const {
-      return ++Iterator(this);
+      return Iterator(ptrs_.data());
     }
 
     Iterator end() const {
-      return Iterator(this);
+      return Iterator(ptrs_.data() + ptrs_.size());
     }
 
     Accessor(const Accessor&) = delete;
@@ -323,11 +310,11 @@ class ThreadLocalPtr {
     Accessor(Accessor&& other) noexcept
         : meta_(other.meta_),
           accessAllThreadsLock_(other.accessAllThreadsLock_),
-          lock_(other.lock_),
+          ptrs_(std::move(other.ptrs_)),
           id_(other.id_) {
       other.id_ = 0;
       other.accessAllThreadsLock_ = nullptr;
-      other.lock_ = nullptr;
+      other.ptrs_.clear();
     }
 
     Accessor& operator=(Accessor&& other) noexcept {
@@ -338,36 +325,35 @@ class ThreadLocalPtr {
       // which is impossible, which leaves only one possible scenario --
       // *this is empty.  Assert it.
       assert(&meta_ == &other.meta_);
-      assert(lock_ == nullptr);
+      assert(accessAllThreadsLock_ == nullptr);
       using std::swap;
       swap(accessAllThreadsLock_, other.accessAllThreadsLock_);
-      swap(lock_, other.lock_);
+      swap(ptrs_, other.ptrs_);
       swap(id_, other.id_);
+      return *this;
     }
 
     Accessor()
         : meta_(threadlocal_detail::StaticMeta<Tag, AccessMode>::instance()),
           accessAllThreadsLock_(nullptr),
-          lock_(nullptr),
           id_(0) {}
 
    private:
     explicit Accessor(uint32_t id)
         : meta_(threadlocal_detail::StaticMeta<Tag, AccessMode>::instance()),
-          accessAllThreadsLock_(&meta_.accessAllThreadsLock_),
-          lock_(&meta_.lock_) {
+          accessAllThreadsLock_(&meta_.accessAllThreadsLock_) {
       accessAllThreadsLock_->lock();
-      lock_->lock();
+      auto guard = makeGuard([&] { accessAllThreadsLock_->unlock(); });
+      ptrs_ = meta_.collect(id);
+      guard.dismiss();
       id_ = id;
     }
 
     void release() {
-      if (lock_) {
-        lock_->unlock();
-        DCHECK(accessAllThreadsLock_ != nullptr);
+      if (accessAllThreadsLock_) {
         accessAllThreadsLock_->unlock();
         id_ = 0;
-        lock_ = nullptr;
+        ptrs_.clear();
         accessAllThreadsLock_ = nullptr;
       }
     }
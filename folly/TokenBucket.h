@@ -18,8 +18,11 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <chrono>
+#include <memory>
 
+#include <folly/CachelinePadded.h>
 #include <folly/Likely.h>
 #include <folly/concurrency/CacheLocality.h>
 
@@ -383,6 +386,228 @@ class ParameterizedTokenBucket {
   double burstSize_;
 };
 
+/**
+ * A token bucket for many threads consuming from it at once, which a
+ * single ParameterizedTokenBucket, with one atomic they all update, would
+ * make contend for its cache line.
+ *
+ * Instead, each CPU (per AccessSpreader) has a shard, which leases tokens
+ * from the bucket in batches of leaseSize, and consumes them locally; only
+ * the threads of a CPU share a shard, and they only touch the bucket once
+ * every leaseSize tokens.  When the bucket runs dry, a shard takes the
+ * tokens it needs from the others, so that leased tokens don't go unused
+ * while there is demand for them.
+ *
+ * Tokens leased to shards have been taken from the bucket, so over any
+ * period of time it never lets through more than a TokenBucket with the
+ * same rate and a burst size of burstSize + maxLeased() would; but as
+ * leased tokens don't expire, it may let through a burst up to maxLeased()
+ * larger than burstSize after a quiet period.  Tokens are never lost: a
+ * consume() only fails if the bucket and all the shards together have too
+ * few tokens.
+ *
+ * Buckets can have a parent, e.g. one per tenant under a global one:
+ * tokens a child leases are also leased from the parent, so the children
+ * together are limited by the parent too.
+ *
+ * @tparam ClockT Clock type, must be steady i.e. monotonic.
+ */
+template <typename ClockT = DefaultTokenBucketClock>
+class ParameterizedShardedTokenBucket {
+ public:
+  /**
+   * @param genRate Number of tokens to generate per second.
+   * @param burstSize Maximum burst size. Must be greater than 0.
+   * @param leaseSize Number of tokens a shard leases at a time, in addition
+   *                  to what it needs for the consume() that leases them.
+   * @param parent Bucket which leases are also taken from, or nullptr. Must
+   *               outlive this one.
+   * @param zeroTime Initial time at which to consider the token bucket
+   *                 starting to fill. Defaults to 0, so by default token
+   *                 bucket is "full" after construction.
+   */
+  ParameterizedShardedTokenBucket(
+      double genRate,
+      double burstSize,
+      double leaseSize,
+      ParameterizedShardedTokenBucket* parent = nullptr,
+      double zeroTime = 0)
+      : bucket_(zeroTime),
+        rate_(genRate),
+        burstSize_(burstSize),
+        leaseSize_(leaseSize),
+        parent_(parent),
+        numShards_(CacheLocality::system().numCpus),
+        shards_(new CachelinePadded<std::atomic<double>>[numShards_]) {
+    assert(rate_ > 0);
+    assert(burstSize_ > 0);
+    assert(leaseSize_ >= 0);
+    for (size_t i = 0; i < numShards_; ++i) {
+      shards_[i]->store(0);
+    }
+  }
+
+  ParameterizedShardedTokenBucket(const ParameterizedShardedTokenBucket&) =
+      delete;
+  ParameterizedShardedTokenBucket& operator=(
+      const ParameterizedShardedTokenBucket&) = delete;
+
+  /**
+   * Returns the current time in seconds since Epoch.
+   */
+  static double defaultClockNow() noexcept(
+      noexcept(ParameterizedDynamicTokenBucket<ClockT>::defaultClockNow())) {
+    return ParameterizedDynamicTokenBucket<ClockT>::defaultClockNow();
+  }
+
+  /**
+   * Attempts to consume some number of tokens, from the shard of the
+   * current CPU if it has enough, otherwise by leasing more for it.
+   *
+   * Thread-safe.
+   *
+   * @param toConsume The number of tokens to consume.
+   * @param nowInSeconds Current time in seconds. Should be monotonically
+   *                     increasing from the nowInSeconds specified in
+   *                     this token bucket's constructor.
+   * @return True if the rate limit check passed, false otherwise.
+   */
+  bool consume(double toConsume, double nowInSeconds = defaultClockNow()) {
+    auto& shard = *shards_[AccessSpreader<>::current(numShards_)];
+    double tokens = shard.load(std::memory_order_relaxed);
+    while (tokens >= toConsume) {
+      if (LIKELY(shard.compare_exchange_weak(tokens, tokens - toConsume))) {
+        return true;
+      }
+    }
+    return consumeSlow(shard, toConsume, nowInSeconds);
+  }
+
+  /**
+   * Returns the number of tokens currently available, in the bucket and in
+   * the shards.
+   *
+   * Thread-safe (but returned value may immediately be outdated).
+   */
+  double available(double nowInSeconds = defaultClockNow()) const {
+    double tokens = bucket_.available(rate_, burstSize_, nowInSeconds);
+    for (size_t i = 0; i < numShards_; ++i) {
+      tokens += shards_[i]->load(std::memory_order_relaxed);
+    }
+    return tokens;
+  }
+
+  /**
+   * The most tokens that can be leased to the shards at once, which bounds
+   * how far this is from a ParameterizedTokenBucket with the same rate and
+   * burst size.
+   */
+  double maxLeased() const noexcept {
+    return numShards_ * leaseSize_;
+  }
+
+  double rate() const noexcept {
+    return rate_;
+  }
+
+  double burst() const noexcept {
+    return burstSize_;
+  }
+
+  double leaseSize() const noexcept {
+    return leaseSize_;
+  }
+
+ private:
+  static void add(std::atomic<double>& tokens, double n) {
+    double old = tokens.load(std::memory_order_relaxed);
+    while (!tokens.compare_exchange_weak(old, old + n)) {
+    }
+  }
+
+  // Takes up to n tokens from a shard, and returns how many it took
+  static double take(std::atomic<double>& tokens, double n) {
+    double old = tokens.load(std::memory_order_relaxed);
+    double taken;
+    do {
+      taken = std::min(old, n);
+      if (taken <= 0) {
+        return 0;
+      }
+    } while (!tokens.compare_exchange_weak(old, old - taken));
+    return taken;
+  }
+
+  // Leases between min and max tokens from the bucket (and the parent), and
+  // returns how many, or 0 if it can't lease min
+  double lease(double min, double max, double nowInSeconds) {
+    // Not consumeOrDrain(), which would add tokens if another thread has
+    // moved the bucket past nowInSeconds
+    double leased =
+        std::min(max, bucket_.available(rate_, burstSize_, nowInSeconds));
+    if (leased < min ||
+        !bucket_.consume(leased, rate_, burstSize_, nowInSeconds)) {
+      leased = min;
+      if (!bucket_.consume(min, rate_, burstSize_, nowInSeconds)) {
+        return 0;
+      }
+    }
+    if (parent_ && !parent_->consume(leased, nowInSeconds)) {
+      if (!parent_->consume(min, nowInSeconds)) {
+        giveBack(leased, nowInSeconds);
+        return 0;
+      }
+      giveBack(leased - min, nowInSeconds);
+      leased = min;
+    }
+    return leased;
+  }
+
+  void giveBack(double tokens, double nowInSeconds) {
+    if (tokens > 0) {
+      // Consuming negative tokens adds them back
+      bucket_.consume(-tokens, rate_, burstSize_, nowInSeconds);
+    }
+  }
+
+  bool consumeSlow(
+      std::atomic<double>& shard,
+      double toConsume,
+      double nowInSeconds) {
+    if (toConsume > burstSize_) {
+      return false;
+    }
+    double have = take(shard, toConsume);
+    double need = toConsume - have;
+    double leased = lease(need, need + leaseSize_, nowInSeconds);
+    if (leased > 0 || need <= 0) {
+      add(shard, have + leased - toConsume);
+      return true;
+    }
+    // The bucket is dry: take what's missing from the other shards
+    for (size_t i = 0; i < numShards_ && have < toConsume; ++i) {
+      if (shards_[i].get() != &shard) {
+        have += take(*shards_[i], toConsume - have);
+      }
+    }
+    if (have >= toConsume) {
+      add(shard, have - toConsume);
+      return true;
+    }
+    add(shard, have);
+    return false;
+  }
+
+  ParameterizedDynamicTokenBucket<ClockT> bucket_;
+  const double rate_;
+  const double burstSize_;
+  const double leaseSize_;
+  ParameterizedShardedTokenBucket* const parent_;
+  const size_t numShards_;
+  std::unique_ptr<CachelinePadded<std::atomic<double>>[]> shards_;
+};
+
 using TokenBucket = ParameterizedTokenBucket<>;
 using DynamicTokenBucket = ParameterizedDynamicTokenBucket<>;
+using ShardedTokenBucket = ParameterizedShardedTokenBucket<>;
 } // namespace folly
@@ -15,7 +15,18 @@
  */
 
 #include <folly/Unicode.h>
+
+#include <cstring>
+
+#include <folly/Bits.h>
 #include <folly/Conv.h>
+#include <folly/Portability.h>
+
+#if FOLLY_SSE_PREREQ(4, 2)
+#include <nmmintrin.h>
+#elif FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#endif
 
 namespace folly {
 
@@ -146,6 +157,494 @@ char32_t utf8ToCodePoint(
   throw std::runtime_error("folly::utf8ToCodePoint encoding length maxed out");
 }
 
+namespace {
+
+constexpr char32_t kReplacementChar = 0xfffd;
+constexpr char32_t kInvalidCodePoint = 0xffffffff;
+
+// Decodes the multibyte sequence at p (*p >= 0x80) and advances p past it,
+// or returns kInvalidCodePoint if it is malformed.
+char32_t decodeUtf8(const unsigned char*& p, const unsigned char* e) {
+  unsigned char c = *p;
+
+  // Number of continuation bytes, and the range of the first one, which
+  // excludes overlong encodings, surrogates and code points > U+10FFFF
+  size_t n;
+  unsigned char lo = 0x80;
+  unsigned char hi = 0xbf;
+  char32_t cp;
+  if (c >= 0xc2 && c <= 0xdf) {
+    n = 1;
+    cp = c & 0x1f;
+  } else if (c >= 0xe0 && c <= 0xef) {
+    n = 2;
+    cp = c & 0x0f;
+    if (c == 0xe0) {
+      lo = 0xa0;
+    } else if (c == 0xed) {
+      hi = 0x9f;
+    }
+  } else if (c >= 0xf0 && c <= 0xf4) {
+    n = 3;
+    cp = c & 0x07;
+    if (c == 0xf0) {
+      lo = 0x90;
+    } else if (c == 0xf4) {
+      hi = 0x8f;
+    }
+  } else {
+    return kInvalidCodePoint;
+  }
+  if (size_t(e - p) <= n || p[1] < lo || p[1] > hi) {
+    return kInvalidCodePoint;
+  }
+  cp = (cp << 6) | (p[1] & 0x3f);
+  for (size_t i = 2; i <= n; ++i) {
+    if ((p[i] & 0xc0) != 0x80) {
+      return kInvalidCodePoint;
+    }
+    cp = (cp << 6) | (p[i] & 0x3f);
+  }
+  p += n + 1;
+  return cp;
+}
+
+// Encodes a valid code point
+unsigned char* encodeUtf8(unsigned char* out, char32_t cp) {
+  if (cp < 0x80) {
+    *out++ = static_cast<unsigned char>(cp);
+  } else if (cp < 0x800) {
+    *out++ = static_cast<unsigned char>(0xc0 | (cp >> 6));
+    *out++ = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    *out++ = static_cast<unsigned char>(0xe0 | (cp >> 12));
+    *out++ = static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3f));
+    *out++ = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+  } else {
+    *out++ = static_cast<unsigned char>(0xf0 | (cp >> 18));
+    *out++ = static_cast<unsigned char>(0x80 | ((cp >> 12) & 0x3f));
+    *out++ = static_cast<unsigned char>(0x80 | ((cp >> 6) & 0x3f));
+    *out++ = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+  }
+  return out;
+}
+
+char16_t* encodeUtfN(char16_t* out, char32_t cp) {
+  if (cp < 0x10000) {
+    *out++ = static_cast<char16_t>(cp);
+  } else {
+    cp -= 0x10000;
+    *out++ = static_cast<char16_t>(0xd800 + (cp >> 10));
+    *out++ = static_cast<char16_t>(0xdc00 + (cp & 0x3ff));
+  }
+  return out;
+}
+
+char32_t* encodeUtfN(char32_t* out, char32_t cp) {
+  *out++ = cp;
+  return out;
+}
+
+bool utf8ValidScalar(
+    const unsigned char* p,
+    const unsigned char* e,
+    bool bmpOnly) {
+  while (p < e) {
+    if (e - p >= 8 && !(loadUnaligned<uint64_t>(p) & 0x8080808080808080ULL)) {
+      p += 8;
+      continue;
+    }
+    if (*p < 0x80) {
+      ++p;
+      continue;
+    }
+    char32_t cp = decodeUtf8(p, e);
+    if (cp == kInvalidCodePoint || (bmpOnly && cp > 0xffff)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if FOLLY_SSE_PREREQ(4, 2)
+
+// The "lookup" algorithm of Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte" (2020): every error in a 2-byte window
+// (the previous byte and the current one) is identified by the high nibble
+// of the previous byte, its low nibble and the high nibble of the current
+// byte, so three table lookups and an AND find them all.  What remains is
+// checking that 3 and 4 byte sequences have enough continuation bytes.
+//
+// Error bits of the lookup tables
+constexpr char kTooShort = 1 << 0; // lead byte not followed by continuation
+constexpr char kTooLong = 1 << 1; // ASCII followed by continuation
+constexpr char kOverlong3 = 1 << 2;
+constexpr char kTooLarge = 1 << 3; // > U+10FFFF
+constexpr char kSurrogate = 1 << 4;
+constexpr char kOverlong2 = 1 << 5;
+constexpr char kTooLarge1000 = 1 << 6;
+constexpr char kOverlong4 = 1 << 6;
+// Two continuation bytes in a row; an error unless in a 3 or 4 byte
+// sequence, which is checked separately
+constexpr char kTwoConts = char(1 << 7);
+constexpr char kCarry = kTooShort | kTooLong | kTwoConts;
+
+inline __m128i highNibbles(__m128i v) {
+  return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+}
+
+bool utf8ValidSse42(
+    const unsigned char* p,
+    const unsigned char* e,
+    bool bmpOnly) {
+  // Indexed by the high nibble of the previous byte
+  const __m128i byte1High = _mm_setr_epi8(
+      // 0___: ASCII
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      // 10__: continuation
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      // 1100, 1101: 2 byte lead
+      kTooShort | kOverlong2,
+      kTooShort,
+      // 1110: 3 byte lead
+      kTooShort | kOverlong3 | kSurrogate,
+      // 1111: 4 byte lead
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4);
+  // Indexed by the low nibble of the previous byte
+  const __m128i byte1Low = _mm_setr_epi8(
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4, // ____0000
+      kCarry | kOverlong2, // ____0001
+      kCarry,
+      kCarry,
+      kCarry | kTooLarge, // ____0100
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate, // ____1101
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000);
+  // Indexed by the high nibble of the current byte
+  const __m128i byte2High = _mm_setr_epi8(
+      // 0___: ASCII
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      // 1000
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |
+          kOverlong4,
+      // 1001
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+      // 101_
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      // 11__: lead
+      kTooShort, kTooShort, kTooShort, kTooShort);
+  // Bytes above this are errors
+  const __m128i maxByte = _mm_set1_epi8(char(bmpOnly ? 0xef : 0xff));
+  // Nonzero where a sequence starting in the last 3 bytes of a block
+  // continues past it
+  const __m128i maxComplete = _mm_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      char(0xf0 - 1), char(0xe0 - 1), char(0xc0 - 1));
+
+  __m128i prev = _mm_setzero_si128();
+  __m128i prevIncomplete = _mm_setzero_si128();
+  __m128i error = _mm_setzero_si128();
+
+  auto check = [&](__m128i input) {
+    if (_mm_movemask_epi8(input) == 0) {
+      // ASCII: only a sequence left open by the previous block is an error
+      error = _mm_or_si128(error, prevIncomplete);
+      prevIncomplete = _mm_setzero_si128();
+    } else {
+      auto prev1 = _mm_alignr_epi8(input, prev, 15);
+      auto special = _mm_and_si128(
+          _mm_and_si128(
+              _mm_shuffle_epi8(byte1High, highNibbles(prev1)),
+              _mm_shuffle_epi8(
+                  byte1Low, _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+          _mm_shuffle_epi8(byte2High, highNibbles(input)));
+
+      // The high bit is set where the byte 2 (resp. 3) positions back is a
+      // 3 (resp. 4) byte lead, so that this one must be a continuation
+      auto prev2 = _mm_alignr_epi8(input, prev, 14);
+      auto prev3 = _mm_alignr_epi8(input, prev, 13);
+      auto mustContinue = _mm_and_si128(
+          _mm_or_si128(
+              _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xe0 - 0x80))),
+              _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xf0 - 0x80)))),
+          _mm_set1_epi8(char(0x80)));
+
+      error = _mm_or_si128(error, _mm_xor_si128(mustContinue, special));
+      error = _mm_or_si128(error, _mm_subs_epu8(input, maxByte));
+      prevIncomplete = _mm_subs_epu8(input, maxComplete);
+    }
+    prev = input;
+  };
+
+  for (; e - p >= 16; p += 16) {
+    check(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  if (p < e) {
+    // Padded with ASCII
+    unsigned char tail[16] = {};
+    memcpy(tail, p, size_t(e - p));
+    check(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)));
+  }
+  error = _mm_or_si128(error, prevIncomplete);
+  return _mm_testz_si128(error, error);
+}
+
+#endif
+
+} // namespace
+
+bool utf8Valid(StringPiece s, bool bmpOnly) {
+  auto p = reinterpret_cast<const unsigned char*>(s.begin());
+  auto e = reinterpret_cast<const unsigned char*>(s.end());
+#if FOLLY_SSE_PREREQ(4, 2)
+  if (e - p >= 16) {
+    return utf8ValidSse42(p, e, bmpOnly);
+  }
+#endif
+  return utf8ValidScalar(p, e, bmpOnly);
+}
+
+bool isAscii(StringPiece s) {
+  auto p = reinterpret_cast<const unsigned char*>(s.begin());
+  auto e = reinterpret_cast<const unsigned char*>(s.end());
+#if FOLLY_SSE_PREREQ(2, 0)
+  for (; e - p >= 64; p += 64) {
+    auto v = reinterpret_cast<const __m128i*>(p);
+    auto any = _mm_or_si128(
+        _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+        _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+    if (_mm_movemask_epi8(any) != 0) {
+      return false;
+    }
+  }
+  for (; e - p >= 16; p += 16) {
+    if (_mm_movemask_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) != 0) {
+      return false;
+    }
+  }
+#endif
+  for (; e - p >= 8; p += 8) {
+    if (loadUnaligned<uint64_t>(p) & 0x8080808080808080ULL) {
+      return false;
+    }
+  }
+  for (; p < e; ++p) {
+    if (*p >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+[[noreturn]] void throwInvalid(const char* fn, size_t offset) {
+  throw std::runtime_error(
+      to<std::string>("folly::", fn, ": invalid input at offset ", offset));
+}
+
+#if FOLLY_SSE_PREREQ(2, 0)
+// Widen 16 ASCII bytes to UTF-16 and UTF-32
+void storeAscii(char16_t* out, __m128i v) {
+  auto zero = _mm_setzero_si128();
+  auto o = reinterpret_cast<__m128i*>(out);
+  _mm_storeu_si128(o, _mm_unpacklo_epi8(v, zero));
+  _mm_storeu_si128(o + 1, _mm_unpackhi_epi8(v, zero));
+}
+
+void storeAscii(char32_t* out, __m128i v) {
+  auto zero = _mm_setzero_si128();
+  auto o = reinterpret_cast<__m128i*>(out);
+  auto lo = _mm_unpacklo_epi8(v, zero);
+  auto hi = _mm_unpackhi_epi8(v, zero);
+  _mm_storeu_si128(o, _mm_unpacklo_epi16(lo, zero));
+  _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo, zero));
+  _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi, zero));
+  _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi, zero));
+}
+#endif
+
+template <class String>
+String utf8ToUtfN(StringPiece s, bool skipOnError, const char* fn) {
+  using Char = typename String::value_type;
+  auto begin = reinterpret_cast<const unsigned char*>(s.begin());
+  auto p = begin;
+  auto e = reinterpret_cast<const unsigned char*>(s.end());
+
+  // Each byte becomes at most one code unit
+  String result(s.size(), Char(0));
+  Char* out = &result[0];
+  while (p < e) {
+#if FOLLY_SSE_PREREQ(2, 0)
+    if (e - p >= 16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      if (_mm_movemask_epi8(v) == 0) {
+        storeAscii(out, v);
+        p += 16;
+        out += 16;
+        continue;
+      }
+    }
+#else
+    if (e - p >= 8 && !(loadUnaligned<uint64_t>(p) & 0x8080808080808080ULL)) {
+      for (size_t i = 0; i < 8; ++i) {
+        out[i] = p[i];
+      }
+      p += 8;
+      out += 8;
+      continue;
+    }
+#endif
+    if (*p < 0x80) {
+      *out++ = *p++;
+      continue;
+    }
+    char32_t cp = decodeUtf8(p, e);
+    if (cp == kInvalidCodePoint) {
+      if (!skipOnError) {
+        throwInvalid(fn, size_t(p - begin));
+      }
+      ++p;
+      cp = kReplacementChar;
+    }
+    out = encodeUtfN(out, cp);
+  }
+  result.resize(size_t(out - result.data()));
+  return result;
+}
+
+// Whether the 8 code units at p are ASCII; if so, stores them at out
+bool copyAscii(const char16_t* p, unsigned char* out) {
+#if FOLLY_SSE_PREREQ(2, 0)
+  auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  auto high = _mm_and_si128(v, _mm_set1_epi16(int16_t(0xff80)));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) !=
+      0xffff) {
+    return false;
+  }
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(v, v));
+  return true;
+#else
+  char16_t any = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    any |= p[i];
+  }
+  if (any >= 0x80) {
+    return false;
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    out[i] = static_cast<unsigned char>(p[i]);
+  }
+  return true;
+#endif
+}
+
+bool copyAscii(const char32_t* p, unsigned char* out) {
+#if FOLLY_SSE_PREREQ(2, 0)
+  auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4));
+  auto high = _mm_and_si128(_mm_or_si128(v0, v1), _mm_set1_epi32(~0x7f));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) !=
+      0xffff) {
+    return false;
+  }
+  auto v = _mm_packs_epi32(v0, v1);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(v, v));
+  return true;
+#else
+  char32_t any = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    any |= p[i];
+  }
+  if (any >= 0x80) {
+    return false;
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    out[i] = static_cast<unsigned char>(p[i]);
+  }
+  return true;
+#endif
+}
+
+// Returns the code point at p, advancing p, or kInvalidCodePoint
+char32_t decodeUtfN(const char16_t*& p, const char16_t* e) {
+  char32_t cp = *p++;
+  if (cp >= 0xd800 && cp <= 0xdfff) {
+    if (cp > 0xdbff || p == e || *p < 0xdc00 || *p > 0xdfff) {
+      return kInvalidCodePoint;
+    }
+    cp = 0x10000 + ((cp - 0xd800) << 10) + (*p++ - 0xdc00);
+  }
+  return cp;
+}
+
+char32_t decodeUtfN(const char32_t*& p, const char32_t*) {
+  char32_t cp = *p++;
+  if ((cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) {
+    return kInvalidCodePoint;
+  }
+  return cp;
+}
+
+template <class Char>
+std::string utfNToUtf8(Range<const Char*> s, bool skipOnError, const char* fn) {
+  auto p = s.begin();
+  auto e = s.end();
+
+  // Each code unit becomes at most 3 (UTF-16) or 4 (UTF-32) bytes
+  std::string result(s.size() * (sizeof(Char) == 2 ? 3 : 4), '\0');
+  auto out = reinterpret_cast<unsigned char*>(&result[0]);
+  while (p < e) {
+    if (e - p >= 8 && copyAscii(p, out)) {
+      p += 8;
+      out += 8;
+      continue;
+    }
+    auto start = p;
+    char32_t cp = decodeUtfN(p, e);
+    if (cp == kInvalidCodePoint) {
+      if (!skipOnError) {
+        throwInvalid(fn, size_t(start - s.begin()));
+      }
+      p = start + 1;
+      cp = kReplacementChar;
+    }
+    out = encodeUtf8(out, cp);
+  }
+  result.resize(size_t(out - reinterpret_cast<unsigned char*>(&result[0])));
+  return result;
+}
+
+} // namespace
+
+std::u16string utf8ToUtf16(StringPiece s, bool skipOnError) {
+  return utf8ToUtfN<std::u16string>(s, skipOnError, "utf8ToUtf16");
+}
+
+std::u32string utf8ToUtf32(StringPiece s, bool skipOnError) {
+  return utf8ToUtfN<std::u32string>(s, skipOnError, "utf8ToUtf32");
+}
+
+std::string utf16ToUtf8(Range<const char16_t*> s, bool skipOnError) {
+  return utfNToUtf8(s, skipOnError, "utf16ToUtf8");
+}
+
+std::string utf32ToUtf8(Range<const char32_t*> s, bool skipOnError) {
+  return utfNToUtf8(s, skipOnError, "utf32ToUtf8");
+}
+
 //////////////////////////////////////////////////////////////////////
 
 } // namespace folly
@@ -20,6 +20,8 @@
 
 #include <string>
 
+#include <folly/Range.h>
+
 namespace folly {
 
 //////////////////////////////////////////////////////////////////////
@@ -39,6 +41,38 @@ char32_t utf8ToCodePoint(
     const unsigned char* const e,
     bool skipOnError);
 
+/*
+ * Check that s is well-formed UTF-8 (RFC 3629): no overlong encodings,
+ * surrogates or code points above U+10FFFF, and no truncated sequences.
+ * With bmpOnly, code points must also be at most U+FFFF (encoded in at most
+ * 3 bytes), as utf8ToCodePoint() requires.
+ *
+ * Runs of ASCII are skipped 8 bytes at a time; with SSE4.2, the whole input
+ * is checked 16 bytes at a time, without branching on the bytes.
+ */
+bool utf8Valid(StringPiece s, bool bmpOnly = false);
+
+/*
+ * Check that s only contains ASCII characters (bytes below 0x80), 16 bytes
+ * at a time with SSE2.
+ */
+bool isAscii(StringPiece s);
+
+/*
+ * Transcode whole strings between UTF-8, UTF-16 and UTF-32.  The input must
+ * be well-formed: UTF-8 as checked by utf8Valid(), UTF-16 without unpaired
+ * surrogates, UTF-32 without surrogates or code points above U+10FFFF.
+ * Otherwise these throw std::runtime_error, or with skipOnError replace
+ * each invalid byte (resp. code unit) with U+FFFD, like utf8ToCodePoint().
+ *
+ * Runs of ASCII are converted 16 (UTF-8) or 8 (UTF-16 and UTF-32) code
+ * units at a time with SSE2, and 8 at a time otherwise.
+ */
+std::u16string utf8ToUtf16(StringPiece s, bool skipOnError = false);
+std::u32string utf8ToUtf32(StringPiece s, bool skipOnError = false);
+std::string utf16ToUtf8(Range<const char16_t*> s, bool skipOnError = false);
+std::string utf32ToUtf8(Range<const char32_t*> s, bool skipOnError = false);
+
 //////////////////////////////////////////////////////////////////////
 
 } // namespace folly
@@ -18,17 +18,10 @@
 
 #include <cctype>
 
-#include <boost/regex.hpp>
-
 namespace folly {
 
 namespace {
 
-std::string submatch(const boost::cmatch& m, int idx) {
-  auto& sub = m[idx];
-  return std::string(sub.first, sub.second);
-}
-
 template <class String>
 void toLower(String& s) {
   for (auto& c : s) {
@@ -38,63 +31,27 @@ void toLower(String& s) {
 
 } // namespace
 
-Uri::Uri(StringPiece str) : hasAuthority_(false), port_(0) {
-  static const boost::regex uriRegex(
-      "([a-zA-Z][a-zA-Z0-9+.-]*):"  // scheme:
-      "([^?#]*)"                    // authority and path
-      "(?:\\?([^#]*))?"             // ?query
-      "(?:#(.*))?");                // #fragment
-  static const boost::regex authorityAndPathRegex("//([^/]*)(/.*)?");
-
-  boost::cmatch match;
-  if (UNLIKELY(!boost::regex_match(str.begin(), str.end(), match, uriRegex))) {
-    throw std::invalid_argument(to<std::string>("invalid URI ", str));
-  }
-
-  scheme_ = submatch(match, 1);
-  toLower(scheme_);
-
-  StringPiece authorityAndPath(match[2].first, match[2].second);
-  boost::cmatch authorityAndPathMatch;
-  if (!boost::regex_match(authorityAndPath.begin(),
-                          authorityAndPath.end(),
-                          authorityAndPathMatch,
-                          authorityAndPathRegex)) {
-    // Does not start with //, doesn't have authority
-    hasAuthority_ = false;
-    path_ = authorityAndPath.str();
-  } else {
-    static const boost::regex authorityRegex(
-        "(?:([^@:]*)(?::([^@]*))?@)?"  // username, password
-        "(\\[[^\\]]*\\]|[^\\[:]*)"     // host (IP-literal (e.g. '['+IPv6+']',
-                                       // dotted-IPv4, or named host)
-        "(?::(\\d*))?");               // port
-
-    auto authority = authorityAndPathMatch[1];
-    boost::cmatch authorityMatch;
-    if (!boost::regex_match(authority.first,
-                            authority.second,
-                            authorityMatch,
-                            authorityRegex)) {
-      throw std::invalid_argument(
-          to<std::string>("invalid URI authority ",
-                          StringPiece(authority.first, authority.second)));
-    }
-
-    StringPiece port(authorityMatch[4].first, authorityMatch[4].second);
-    if (!port.empty()) {
-      port_ = to<uint16_t>(port);
-    }
+Uri::Uri(StringPiece str) : Uri(UriView(str)) {}
 
-    hasAuthority_ = true;
-    username_ = submatch(authorityMatch, 1);
-    password_ = submatch(authorityMatch, 2);
-    host_ = submatch(authorityMatch, 3);
-    path_ = submatch(authorityAndPathMatch, 2);
+Expected<Uri, UriFormatError> Uri::tryParse(StringPiece str) {
+  auto uri = UriView::tryParse(str);
+  if (uri.hasError()) {
+    return makeUnexpected(uri.error());
   }
+  return Uri(uri.value());
+}
 
-  query_ = submatch(match, 3);
-  fragment_ = submatch(match, 4);
+Uri::Uri(const UriView& uri) : hasAuthority_(false), port_(0) {
+  scheme_ = uri.scheme().str();
+  toLower(scheme_);
+  hasAuthority_ = uri.hasAuthority();
+  username_ = uri.username().str();
+  password_ = uri.password().str();
+  host_ = uri.host().str();
+  port_ = uri.port();
+  path_ = uri.path().str();
+  query_ = uri.query().str();
+  fragment_ = uri.fragment().str();
 }
 
 std::string Uri::authority() const {
@@ -135,25 +92,8 @@ std::string Uri::hostname() const {
 
 const std::vector<std::pair<std::string, std::string>>& Uri::getQueryParams() {
   if (!query_.empty() && queryParams_.empty()) {
-    // Parse query string
-    static const boost::regex queryParamRegex(
-        "(^|&)" /*start of query or start of parameter "&"*/
-        "([^=&]*)=?" /*parameter name and "=" if value is expected*/
-        "([^=&]*)" /*parameter value*/
-        "(?=(&|$))" /*forward reference, next should be end of query or
-                      start of next parameter*/);
-    boost::cregex_iterator paramBeginItr(
-        query_.data(), query_.data() + query_.size(), queryParamRegex);
-    boost::cregex_iterator paramEndItr;
-    for (auto itr = paramBeginItr; itr != paramEndItr; itr++) {
-      if (itr->length(2) == 0) {
-        // key is empty, ignore it
-        continue;
-      }
-      queryParams_.emplace_back(
-          std::string((*itr)[2].first, (*itr)[2].second), // parameter name
-          std::string((*itr)[3].first, (*itr)[3].second) // parameter value
-          );
+    for (auto& param : UriQueryParams(query_)) {
+      queryParams_.emplace_back(param.first.str(), param.second.str());
     }
   }
   return queryParams_;
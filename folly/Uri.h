@@ -20,7 +20,9 @@
 #include <string>
 #include <vector>
 
+#include <folly/Expected.h>
 #include <folly/String.h>
+#include <folly/UriView.h>
 
 namespace folly {
 
@@ -47,6 +49,12 @@ class Uri {
    */
   explicit Uri(StringPiece str);
 
+  /**
+   * Parse a Uri from a string, or return why it's invalid, without
+   * throwing.
+   */
+  static Expected<Uri, UriFormatError> tryParse(StringPiece str);
+
   const std::string& scheme() const { return scheme_; }
   const std::string& username() const { return username_; }
   const std::string& password() const { return password_; }
@@ -106,6 +114,8 @@ class Uri {
   const std::vector<std::pair<std::string, std::string>>& getQueryParams();
 
  private:
+  explicit Uri(const UriView& uri);
+
   std::string scheme_;
   std::string username_;
   std::string password_;
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/UriView.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <folly/Conv.h>
+
+namespace folly {
+
+namespace {
+
+inline bool isAlpha(char c) {
+  return uint8_t((c | 0x20) - 'a') < 26;
+}
+
+inline bool isDigit(char c) {
+  return uint8_t(c - '0') < 10;
+}
+
+inline bool isSchemeChar(char c) {
+  return isAlpha(c) || isDigit(c) || c == '+' || c == '.' || c == '-';
+}
+
+// The first of c1 or c2 in s, or s.end()
+inline const char* findFirst(StringPiece s, char c1, char c2) {
+  for (auto p = s.begin(); p != s.end(); ++p) {
+    if (*p == c1 || *p == c2) {
+      return p;
+    }
+  }
+  return s.end();
+}
+
+inline const char* findFirst(StringPiece s, char c) {
+  auto pos = s.find(c);
+  return pos == StringPiece::npos ? s.end() : s.begin() + pos;
+}
+
+} // namespace
+
+void UriQueryParams::Iterator::advance() {
+  while (next_) {
+    StringPiece param(next_, findFirst(StringPiece(next_, end_), '&'));
+    next_ = param.end() == end_ ? nullptr : param.end() + 1;
+    // Skip parameters without a key or with more than one '='
+    auto eq = findFirst(param, '=');
+    if (eq == param.begin() || param.empty()) {
+      continue;
+    }
+    if (eq == param.end()) {
+      param_ = {param, StringPiece(param.end(), param.end())};
+      return;
+    }
+    StringPiece value(eq + 1, param.end());
+    if (findFirst(value, '=') != value.end()) {
+      continue;
+    }
+    param_ = {StringPiece(param.begin(), eq), value};
+    return;
+  }
+  param_ = value_type();
+}
+
+UriView::UriView(StringPiece str) {
+  auto result = parse(str);
+  if (result.hasValue()) {
+    return;
+  }
+  switch (result.error()) {
+    case UriFormatError::INVALID_URI:
+      throw std::invalid_argument(to<std::string>("invalid URI ", str));
+    case UriFormatError::INVALID_AUTHORITY:
+      throw std::invalid_argument(
+          to<std::string>("invalid URI authority ", authority_));
+    case UriFormatError::INVALID_PORT:
+      // Throws the same ConversionError as to<uint16_t>() does
+      port_ = to<uint16_t>(portStr_);
+      break;
+  }
+}
+
+Expected<UriView, UriFormatError> UriView::tryParse(
+    StringPiece str) noexcept {
+  UriView uri;
+  auto result = uri.parse(str);
+  if (result.hasError()) {
+    return makeUnexpected(result.error());
+  }
+  return uri;
+}
+
+StringPiece UriView::hostname() const {
+  if (!host_.empty() && host_.front() == '[') {
+    // If it starts with '[', it ends with ']'
+    return host_.subpiece(1, host_.size() - 2);
+  }
+  return host_;
+}
+
+// The grammar is that of the regular expressions Uri was once parsed with:
+//   uri:       ([a-zA-Z][a-zA-Z0-9+.-]*):([^?#]*)(?:\?([^#]*))?(?:#(.*))?
+//                scheme                   rest     query         fragment
+//   rest:      //([^/]*)(/.*)?  or, if it doesn't start with "//", a path
+//                authority path
+//   authority: (?:([^@:]*)(?::([^@]*))?@)?(\[[^\]]*\]|[^\[:]*)(?::(\d*))?
+//                 username     password     host                 port
+Expected<Unit, UriFormatError> UriView::parse(StringPiece str) noexcept {
+  const char* p = str.begin();
+  const char* end = str.end();
+
+  if (p == end || !isAlpha(*p)) {
+    return makeUnexpected(UriFormatError::INVALID_URI);
+  }
+  while (++p != end && isSchemeChar(*p)) {
+  }
+  if (p == end || *p != ':') {
+    return makeUnexpected(UriFormatError::INVALID_URI);
+  }
+  scheme_ = StringPiece(str.begin(), p);
+  ++p;
+
+  StringPiece rest(p, findFirst(StringPiece(p, end), '?', '#'));
+  p = rest.end();
+  if (p != end && *p == '?') {
+    query_ = StringPiece(p + 1, findFirst(StringPiece(p + 1, end), '#'));
+    p = query_.end();
+  }
+  if (p != end) {
+    fragment_ = StringPiece(p + 1, end);
+  }
+
+  if (!rest.startsWith("//")) {
+    path_ = rest;
+    return unit;
+  }
+  hasAuthority_ = true;
+  authority_ = StringPiece(rest.begin() + 2, findFirst(rest.subpiece(2), '/'));
+  path_ = StringPiece(authority_.end(), rest.end());
+
+  // With userinfo, if the rest of the authority is a valid host and port,
+  // otherwise without
+  auto at = findFirst(authority_, '@', ':');
+  if (at != authority_.end() && *at == ':') {
+    auto colon = at;
+    at = findFirst(StringPiece(colon + 1, authority_.end()), '@');
+    if (at != authority_.end()) {
+      password_ = StringPiece(colon + 1, at);
+    }
+    username_ = StringPiece(authority_.begin(), colon);
+  } else {
+    username_ = StringPiece(authority_.begin(), at);
+  }
+  if (at == authority_.end() ||
+      !parseHostAndPort(StringPiece(at + 1, authority_.end()))) {
+    username_.clear();
+    password_.clear();
+    if (!parseHostAndPort(authority_)) {
+      return makeUnexpected(UriFormatError::INVALID_AUTHORITY);
+    }
+  }
+
+  uint32_t port = 0;
+  for (char c : portStr_) {
+    port = port * 10 + uint32_t(c - '0');
+    if (port > 0xffff) {
+      return makeUnexpected(UriFormatError::INVALID_PORT);
+    }
+  }
+  port_ = uint16_t(port);
+  return unit;
+}
+
+bool UriView::parseHostAndPort(StringPiece hostAndPort) noexcept {
+  const char* p = hostAndPort.begin();
+  const char* end = hostAndPort.end();
+  if (p != end && *p == '[') {
+    // An IP literal
+    p = findFirst(StringPiece(p, end), ']');
+    if (p == end) {
+      return false;
+    }
+    ++p;
+  } else {
+    p = findFirst(hostAndPort, '[', ':');
+    if (p != end && *p == '[') {
+      return false;
+    }
+  }
+  host_ = StringPiece(hostAndPort.begin(), p);
+  portStr_.clear();
+  if (p == end) {
+    return true;
+  }
+  if (*p != ':') {
+    return false;
+  }
+  portStr_ = StringPiece(p + 1, end);
+  for (char c : portStr_) {
+    if (!isDigit(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace folly
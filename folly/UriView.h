@@ -0,0 +1,200 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+#include <folly/Expected.h>
+#include <folly/Range.h>
+#include <folly/Unit.h>
+
+namespace folly {
+
+/**
+ * The parameters of a query string, as key-value pairs, e.g. for
+ * "key1=foo&key2=&key3&=bar&=bar=":
+ *     "key1" => "foo"
+ *     "key2" => ""
+ *     "key3" => ""
+ * Parameters without a key ("=bar") or with more than one '=' ("=bar=")
+ * are skipped.  The keys and values point into the query string, and are
+ * not percent-decoded; use uriUnescape(..., UriEscapeMode::QUERY) for that.
+ *
+ * The parameters are found as they're iterated over, without allocating:
+ *
+ *   for (auto& param : folly::UriQueryParams(query)) {
+ *     // param.first is the key, param.second the value
+ *   }
+ */
+class UriQueryParams {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<StringPiece, StringPiece>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    // The end iterator
+    Iterator() = default;
+
+    explicit Iterator(StringPiece query)
+        : next_(query.begin()), end_(query.end()) {
+      advance();
+    }
+
+    reference operator*() const {
+      return param_;
+    }
+    pointer operator->() const {
+      return &param_;
+    }
+
+    Iterator& operator++() {
+      advance();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator it = *this;
+      advance();
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return param_.first.begin() == other.param_.first.begin();
+    }
+    bool operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    void advance();
+
+    // The start of the next parameter, or nullptr after the last one
+    const char* next_{nullptr};
+    const char* end_{nullptr};
+    value_type param_;
+  };
+
+  explicit UriQueryParams(StringPiece query) : query_(query) {}
+
+  Iterator begin() const {
+    return Iterator(query_);
+  }
+  Iterator end() const {
+    return Iterator();
+  }
+
+ private:
+  StringPiece query_;
+};
+
+/**
+ * Why a URI didn't parse, for UriView::tryParse() and Uri::tryParse().
+ */
+enum class UriFormatError { INVALID_URI, INVALID_AUTHORITY, INVALID_PORT };
+
+/**
+ * A URI, as parsed by Uri, but with its parts pointing into the string it
+ * was parsed from rather than copied out of it: parsing one takes a single
+ * pass over the string, and doesn't allocate.  The string must outlive the
+ * UriView.
+ *
+ * Unlike Uri, the scheme isn't lower-cased, so compare it
+ * case-insensitively.
+ */
+class UriView {
+ public:
+  /**
+   * Parses a URI.  Throws std::invalid_argument on parse error, and
+   * ConversionError if the port is larger than 65535.
+   */
+  explicit UriView(StringPiece str);
+
+  /**
+   * Parses a URI, or returns why it's invalid.
+   */
+  static Expected<UriView, UriFormatError> tryParse(StringPiece str) noexcept;
+
+  StringPiece scheme() const {
+    return scheme_;
+  }
+  StringPiece username() const {
+    return username_;
+  }
+  StringPiece password() const {
+    return password_;
+  }
+  /**
+   * The host, with square brackets if it's an IPv6 address ("[::1]").
+   */
+  StringPiece host() const {
+    return host_;
+  }
+  /**
+   * The host, without square brackets if it's an IPv6 address ("::1").
+   */
+  StringPiece hostname() const;
+  uint16_t port() const {
+    return port_;
+  }
+  /**
+   * Everything between "//" and the path, e.g. "user:pass@host:80".
+   */
+  StringPiece authority() const {
+    return authority_;
+  }
+  bool hasAuthority() const {
+    return hasAuthority_;
+  }
+  StringPiece path() const {
+    return path_;
+  }
+  StringPiece query() const {
+    return query_;
+  }
+  StringPiece fragment() const {
+    return fragment_;
+  }
+
+  UriQueryParams queryParams() const {
+    return UriQueryParams(query_);
+  }
+
+ private:
+  UriView() = default;
+
+  Expected<Unit, UriFormatError> parse(StringPiece str) noexcept;
+  bool parseHostAndPort(StringPiece hostAndPort) noexcept;
+
+  StringPiece scheme_;
+  StringPiece username_;
+  StringPiece password_;
+  StringPiece host_;
+  StringPiece portStr_;
+  StringPiece authority_;
+  StringPiece path_;
+  StringPiece query_;
+  StringPiece fragment_;
+  uint16_t port_{0};
+  bool hasAuthority_{false};
+};
+
+} // namespace folly
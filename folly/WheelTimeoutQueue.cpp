@@ -0,0 +1,272 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/WheelTimeoutQueue.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+
+namespace folly {
+
+constexpr uint32_t WheelTimeoutQueue::kNil;
+constexpr int64_t WheelTimeoutQueue::kNever;
+
+WheelTimeoutQueue::WheelTimeoutQueue(int64_t tickSize, size_t numSlots)
+    : tickSize_(tickSize),
+      mask_(nextPowTwo(std::max<size_t>(numSlots, 64)) - 1),
+      buckets_(mask_ + 1),
+      occupied_((mask_ + 1) / 64) {
+  if (tickSize <= 0) {
+    throw std::invalid_argument("WheelTimeoutQueue: tickSize must be > 0");
+  }
+}
+
+int64_t WheelTimeoutQueue::tickOf(int64_t time) const {
+  // Round towards -infinity
+  return time >= 0 ? time / tickSize_ : -1 - (-(time + 1)) / tickSize_;
+}
+
+WheelTimeoutQueue::Id WheelTimeoutQueue::add(
+    int64_t now,
+    int64_t delay,
+    Callback callback) {
+  if (size_ == 0) {
+    // Nothing to miss, so catch up with the caller's clock
+    curTick_ = std::max(curTick_, tickOf(now));
+  }
+  return insert(now + delay, -1, std::move(callback));
+}
+
+WheelTimeoutQueue::Id WheelTimeoutQueue::addRepeating(
+    int64_t now,
+    int64_t interval,
+    Callback callback) {
+  if (size_ == 0) {
+    curTick_ = std::max(curTick_, tickOf(now));
+  }
+  return insert(now + interval, interval, std::move(callback));
+}
+
+WheelTimeoutQueue::Id WheelTimeoutQueue::insert(
+    int64_t expiration,
+    int64_t repeatInterval,
+    Callback callback) {
+  uint32_t index;
+  if (freeList_ != kNil) {
+    index = freeList_;
+    freeList_ = events_[index].next;
+  } else {
+    if (events_.size() >= kNil) {
+      throw std::length_error("WheelTimeoutQueue: too many events");
+    }
+    index = uint32_t(events_.size());
+    events_.emplace_back();
+  }
+  auto& event = events_[index];
+  event.id = (nextSeq_++ << 32) | index;
+  event.expiration = expiration;
+  event.repeatInterval = repeatInterval;
+  event.tick = std::max(tickOf(expiration), curTick_);
+  event.callback = std::move(callback);
+  link(index);
+  ++size_;
+  if (!nextExpirationDirty_) {
+    nextExpiration_ = std::min(nextExpiration_, expiration);
+  }
+  return event.id;
+}
+
+void WheelTimeoutQueue::link(uint32_t index) {
+  auto& event = events_[index];
+  auto b = size_t(event.tick) & mask_;
+  auto& bucket = buckets_[b];
+  event.prev = bucket.tail;
+  event.next = kNil;
+  if (bucket.tail != kNil) {
+    events_[bucket.tail].next = index;
+  } else {
+    bucket.head = index;
+    occupied_[b / 64] |= uint64_t(1) << (b % 64);
+  }
+  bucket.tail = index;
+}
+
+void WheelTimeoutQueue::unlink(uint32_t index) {
+  auto& event = events_[index];
+  auto b = size_t(event.tick) & mask_;
+  auto& bucket = buckets_[b];
+  if (event.prev != kNil) {
+    events_[event.prev].next = event.next;
+  } else {
+    bucket.head = event.next;
+  }
+  if (event.next != kNil) {
+    events_[event.next].prev = event.prev;
+  } else {
+    bucket.tail = event.prev;
+  }
+  if (bucket.head == kNil) {
+    occupied_[b / 64] &= ~(uint64_t(1) << (b % 64));
+  }
+}
+
+void WheelTimeoutQueue::release(uint32_t index) {
+  auto& event = events_[index];
+  event.id = 0;
+  event.callback = nullptr;
+  event.next = freeList_;
+  freeList_ = index;
+  --size_;
+}
+
+bool WheelTimeoutQueue::erase(Id id) {
+  auto index = uint32_t(id);
+  if (id <= 0 || index >= events_.size() || events_[index].id != id) {
+    return false;
+  }
+  unlink(index);
+  if (events_[index].expiration == nextExpiration_) {
+    nextExpirationDirty_ = true;
+  }
+  release(index);
+  return true;
+}
+
+int64_t WheelTimeoutQueue::nextExpiration() const {
+  if (nextExpirationDirty_) {
+    nextExpiration_ = findNextExpiration();
+    nextExpirationDirty_ = false;
+  }
+  return nextExpiration_;
+}
+
+int64_t WheelTimeoutQueue::findNextExpiration() const {
+  if (size_ == 0) {
+    return kNever;
+  }
+  // The events of the next numSlots ticks are each in their own bucket,
+  // so the first bucket with an event for its tick has the earliest one
+  const size_t n = mask_ + 1;
+  const size_t start = size_t(curTick_) & mask_;
+  for (size_t k = 0; k < n;) {
+    auto b = (start + k) & mask_;
+    auto word = occupied_[b / 64] >> (b % 64);
+    if (word == 0) {
+      k += 64 - b % 64;
+      continue;
+    }
+    k += findFirstSet(word) - 1;
+    if (k >= n) {
+      break;
+    }
+    b = (start + k) & mask_;
+    auto tick = int64_t(uint64_t(curTick_) + k);
+    auto next = kNever;
+    for (auto i = buckets_[b].head; i != kNil; i = events_[i].next) {
+      if (events_[i].tick == tick) {
+        next = std::min(next, events_[i].expiration);
+      }
+    }
+    if (next != kNever) {
+      return next;
+    }
+    ++k;
+  }
+  // Everything is at least a revolution away
+  auto next = kNever;
+  for (auto& event : events_) {
+    if (event.id != 0) {
+      next = std::min(next, event.expiration);
+    }
+  }
+  return next;
+}
+
+void WheelTimeoutQueue::collect(size_t bucket, int64_t now) {
+  auto i = buckets_[bucket].head;
+  while (i != kNil) {
+    auto next = events_[i].next;
+    if (events_[i].expiration <= now) {
+      unlink(i);
+      due_.emplace_back(events_[i].expiration, i);
+    }
+    i = next;
+  }
+}
+
+int64_t WheelTimeoutQueue::runInternal(int64_t now, bool onceOnly) {
+  int64_t nextExp;
+  do {
+    due_.clear();
+    auto nowTick = tickOf(now);
+    if (nowTick <= curTick_) {
+      collect(size_t(curTick_) & mask_, now);
+    } else {
+      auto span = uint64_t(nowTick) - uint64_t(curTick_);
+      if (span > mask_) {
+        for (size_t b = 0; b <= mask_; ++b) {
+          collect(b, now);
+        }
+      } else {
+        for (uint64_t t = 0; t <= span; ++t) {
+          collect(size_t(uint64_t(curTick_) + t) & mask_, now);
+        }
+      }
+      curTick_ = nowTick;
+    }
+    // Buckets were visited in tick order (or all of them), and events
+    // with the same expiration are in the same bucket, in the order they
+    // were added
+    std::stable_sort(
+        due_.begin(),
+        due_.end(),
+        [](const std::pair<int64_t, uint32_t>& a,
+           const std::pair<int64_t, uint32_t>& b) {
+          return a.first < b.first;
+        });
+
+    std::vector<std::pair<Id, Callback>> calls;
+    calls.swap(calls_);
+    for (auto& d : due_) {
+      auto& event = events_[d.second];
+      if (event.repeatInterval >= 0) {
+        // Reschedule before executing callbacks so the callbacks have a
+        // chance to call erase
+        calls.emplace_back(event.id, event.callback);
+        event.expiration = now + event.repeatInterval;
+        event.tick = std::max(tickOf(event.expiration), curTick_);
+        link(d.second);
+      } else {
+        calls.emplace_back(event.id, std::move(event.callback));
+        release(d.second);
+      }
+    }
+    nextExpirationDirty_ = true;
+
+    // Call callbacks
+    for (auto& call : calls) {
+      call.second(call.first, now);
+    }
+    calls.clear();
+    calls.swap(calls_);
+    nextExp = nextExpiration();
+  } while (!onceOnly && nextExp <= now);
+  return nextExp;
+}
+
+} // namespace folly
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Timeout queue on a hashed timing wheel, with the same interface and
+ * semantics as TimeoutQueue, for when there are many timeouts.
+ *
+ * Events are kept in a slab of slots, linked into one of numSlots buckets
+ * by expiration / tickSize.  add() and erase() are O(1) and don't allocate
+ * (other than to grow the slab, or what the Callback needs), and run*()
+ * only looks at the buckets for the ticks that passed since the last run.
+ *
+ * The price is that an event more than numSlots ticks away is looked at
+ * (and skipped) once every numSlots ticks, and that finding the next
+ * expiration scans the buckets ahead of the current tick.  Pick tickSize
+ * close to the resolution that the caller needs, and numSlots so that most
+ * events expire within numSlots * tickSize.
+ *
+ * Ids are increasing, as with TimeoutQueue, but not consecutive.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace folly {
+
+class WheelTimeoutQueue {
+ public:
+  typedef int64_t Id;
+  typedef std::function<void(Id, int64_t)> Callback;
+
+  /**
+   * tickSize is in the same time units as the times passed to the other
+   * functions; numSlots is rounded up to a power of two.
+   */
+  explicit WheelTimeoutQueue(int64_t tickSize = 1, size_t numSlots = 4096);
+
+  /**
+   * Add a one-time timeout event that will fire "delay" time units from "now"
+   * (that is, the first time that run*() is called with a time value >= now
+   * + delay).
+   */
+  Id add(int64_t now, int64_t delay, Callback callback);
+
+  /**
+   * Add a repeating timeout event that will fire every "interval" time units
+   * (it will first fire when run*() is called with a time value >=
+   * now + interval).
+   *
+   * run*() will always invoke each repeating event at most once, even if
+   * more than one "interval" period has passed.
+   */
+  Id addRepeating(int64_t now, int64_t interval, Callback callback);
+
+  /**
+   * Erase a given timeout event, returns true if the event was actually
+   * erased and false if it didn't exist in our queue.
+   */
+  bool erase(Id id);
+
+  /**
+   * Process all events that are due at times <= "now" by calling their
+   * callbacks, in order of expiration; see TimeoutQueue::runOnce() and
+   * runLoop().
+   *
+   * Return the time that the next event will be due (same as
+   * nextExpiration(), below)
+   */
+  int64_t runOnce(int64_t now) { return runInternal(now, true); }
+  int64_t runLoop(int64_t now) { return runInternal(now, false); }
+
+  /**
+   * Return the time that the next event will be due.
+   */
+  int64_t nextExpiration() const;
+
+  /**
+   * Number of events in the queue.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  // noncopyable
+  WheelTimeoutQueue(const WheelTimeoutQueue&) = delete;
+  WheelTimeoutQueue& operator=(const WheelTimeoutQueue&) = delete;
+
+  static constexpr uint32_t kNil = ~uint32_t(0);
+  static constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+  struct Event {
+    Id id{0}; // 0 if the slot is free
+    int64_t expiration;
+    int64_t repeatInterval;
+    // The tick of the bucket that the event is in: that of its expiration,
+    // or the current tick if it was already due when added
+    int64_t tick;
+    Callback callback;
+    uint32_t prev;
+    uint32_t next; // also links free slots
+  };
+
+  struct Bucket {
+    uint32_t head{kNil};
+    uint32_t tail{kNil};
+  };
+
+  Id insert(int64_t expiration, int64_t repeatInterval, Callback callback);
+  void link(uint32_t index);
+  void unlink(uint32_t index);
+  void release(uint32_t index);
+  int64_t tickOf(int64_t time) const;
+  int64_t runInternal(int64_t now, bool runOnce);
+  void collect(size_t bucket, int64_t now);
+  int64_t findNextExpiration() const;
+
+  const int64_t tickSize_;
+  const size_t mask_;
+  std::vector<Bucket> buckets_;
+  // One bit per bucket, set if the bucket isn't empty
+  std::vector<uint64_t> occupied_;
+  std::vector<Event> events_;
+  uint32_t freeList_{kNil};
+  size_t size_{0};
+  int64_t curTick_{std::numeric_limits<int64_t>::min()};
+  int64_t nextSeq_{1};
+  // Cached nextExpiration(), valid unless dirty
+  mutable int64_t nextExpiration_{kNever};
+  mutable bool nextExpirationDirty_{false};
+  // Events that run*() is about to call, reused between runs
+  std::vector<std::pair<int64_t, uint32_t>> due_;
+  std::vector<std::pair<Id, Callback>> calls_;
+};
+
+} // namespace folly
@@ -41,6 +41,7 @@
 
 #if FOLLY_HAVE_LIBZSTD
 #define ZSTD_STATIC_LINKING_ONLY
+#include <zdict.h>
 #include <zstd.h>
 #endif
 
@@ -54,11 +55,14 @@
 #include <folly/Portability.h>
 #include <folly/ScopeGuard.h>
 #include <folly/Varint.h>
+#include <folly/compression/CompressionContextPool.h>
 #include <folly/compression/Utils.h>
 #include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
 #include <algorithm>
 #include <unordered_set>
 
+using folly::io::compression::detail::CompressionContextPool;
 using folly::io::compression::detail::dataStartsWithLE;
 using folly::io::compression::detail::prefixToStringLE;
 
@@ -435,6 +439,65 @@ std::unique_ptr<IOBuf> StreamCodec::doUncompress(
   return buffer;
 }
 
+uint64_t StreamCodec::uncompress(
+    io::Cursor& input,
+    IOBufQueue& output,
+    Optional<uint64_t> uncompressedLength) {
+  auto constexpr kMaxSingleStepLength = uint64_t(64) << 20; // 64 MB
+  auto constexpr kBlockSize = uint64_t(128) << 10;
+  // Appends to the tailroom already in output when there is that much
+  auto constexpr kMinTailroom = uint64_t(4) << 10;
+
+  if (!uncompressedLength) {
+    if (needsUncompressedLength()) {
+      throw std::invalid_argument("Codec: uncompressed length required");
+    }
+  } else if (*uncompressedLength > maxUncompressedLength()) {
+    throw std::runtime_error("Codec: uncompressed length too large");
+  }
+
+  uint64_t remaining = input.totalLength();
+  ByteRange in = input.peekBytes();
+  if (!in.empty()) {
+    // Codecs only read the frame header, at the start of the first buffer
+    auto const first = IOBuf::wrapBufferAsValue(in);
+    uncompressedLength = getUncompressedLength(&first, uncompressedLength);
+  }
+  auto const defaultBufferLength = computeBufferLength(remaining, kBlockSize);
+  resetStream(uncompressedLength);
+
+  uint64_t written = 0;
+  bool done = false;
+  while (!done) {
+    in = input.peekBytes();
+    // Tell the uncompressor there is no more input (it may optimize)
+    auto const flushOp = in.size() == remaining ? StreamCodec::FlushOp::END
+                                                : StreamCodec::FlushOp::NONE;
+    uint64_t wanted = defaultBufferLength;
+    if (uncompressedLength && *uncompressedLength <= kMaxSingleStepLength) {
+      wanted = std::max<uint64_t>(*uncompressedLength - written, 1);
+    }
+    auto const space =
+        output.preallocate(std::min(wanted, kMinTailroom), wanted);
+    MutableByteRange out{static_cast<uint8_t*>(space.first), space.second};
+    auto const inputSize = in.size();
+    SCOPE_EXIT {
+      auto const consumed = inputSize - in.size();
+      input.skip(consumed);
+      remaining -= consumed;
+      auto const produced = space.second - out.size();
+      output.postallocate(produced);
+      written += produced;
+    };
+    done = uncompressStream(in, out, flushOp);
+  }
+
+  if (uncompressedLength && *uncompressedLength != written) {
+    throw std::runtime_error("Codec: invalid uncompressed length");
+  }
+  return written;
+}
+
 namespace {
 
 /**
@@ -524,13 +587,92 @@ inline uint64_t decodeVarintFromCursor(folly::io::Cursor& cursor) {
 
 #if FOLLY_HAVE_LIBLZ4
 
+namespace {
+int lz4ConvertLevel(int level) {
+  switch (level) {
+    case COMPRESSION_LEVEL_FASTEST:
+    case COMPRESSION_LEVEL_DEFAULT:
+      level = 1;
+      break;
+    case COMPRESSION_LEVEL_BEST:
+      level = 2;
+      break;
+  }
+  if (level < 1 || level > 2) {
+    throw std::invalid_argument(to<std::string>(
+        "LZ4Codec: invalid level: ", level));
+  }
+  return level;
+}
+
+#if LZ4_VERSION_NUMBER >= 10700
+void lz4FreeStreamHC(LZ4_streamHC_t* stream) {
+  LZ4_freeStreamHC(stream);
+}
+#endif
+} // namespace
+
+/**
+ * LZ4 dictionary
+ */
+class LZ4Dictionary final : public CompressionDictionary {
+ public:
+  LZ4Dictionary(CodecType type, int level, ByteRange data);
+
+  // The part of the dictionary that LZ4 uses
+  ByteRange window() const {
+    return window_;
+  }
+
+#if LZ4_VERSION_NUMBER >= 10700
+  // A stream with the dictionary loaded, which compression copies rather
+  // than hashing the dictionary again each time.  Only for level 1.
+  const LZ4_stream_t& stream() const {
+    return stream_;
+  }
+#endif
+
+ private:
+  static constexpr size_t kMaxWindowSize = 64 * 1024;
+
+  ByteRange window_;
+#if LZ4_VERSION_NUMBER >= 10700
+  LZ4_stream_t stream_;
+#endif
+};
+
+constexpr size_t LZ4Dictionary::kMaxWindowSize;
+
+LZ4Dictionary::LZ4Dictionary(CodecType type, int level, ByteRange data)
+    : CompressionDictionary(
+          type,
+          lz4ConvertLevel(level),
+          StringPiece(data).str()) {
+  DCHECK(type == CodecType::LZ4 || type == CodecType::LZ4_VARINT_SIZE);
+#if LZ4_VERSION_NUMBER < 10700
+  throw std::invalid_argument(
+      "LZ4Codec: dictionaries require lz4 1.7.0 or later");
+#else
+  window_ = this->data();
+  if (window_.size() > kMaxWindowSize) {
+    window_.advance(window_.size() - kMaxWindowSize);
+  }
+  LZ4_resetStream(&stream_);
+  LZ4_loadDict(
+      &stream_, reinterpret_cast<const char*>(window_.data()), window_.size());
+#endif
+}
+
 /**
  * LZ4 compression
  */
 class LZ4Codec final : public Codec {
  public:
   static std::unique_ptr<Codec> create(int level, CodecType type);
-  explicit LZ4Codec(int level, CodecType type);
+  explicit LZ4Codec(
+      int level,
+      CodecType type,
+      std::shared_ptr<const LZ4Dictionary> dictionary = nullptr);
 
  private:
   bool doNeedsUncompressedLength() const override;
@@ -545,29 +687,35 @@ class LZ4Codec final : public Codec {
       Optional<uint64_t> uncompressedLength) override;
 
   bool highCompression_;
+  // Only ever set with lz4 1.7.0 or later
+  std::shared_ptr<const LZ4Dictionary> dictionary_;
+#if LZ4_VERSION_NUMBER >= 10700
+  int compressWithDictionary(
+      const char* input,
+      char* output,
+      int inputLength,
+      int outputLength);
+
+  // Scratch state for compressing with dictionary_
+  std::unique_ptr<LZ4_stream_t> stream_;
+  std::unique_ptr<
+      LZ4_streamHC_t,
+      folly::static_function_deleter<LZ4_streamHC_t, &lz4FreeStreamHC>>
+      streamHC_;
+#endif
 };
 
 std::unique_ptr<Codec> LZ4Codec::create(int level, CodecType type) {
   return std::make_unique<LZ4Codec>(level, type);
 }
 
-LZ4Codec::LZ4Codec(int level, CodecType type) : Codec(type) {
+LZ4Codec::LZ4Codec(
+    int level,
+    CodecType type,
+    std::shared_ptr<const LZ4Dictionary> dictionary)
+    : Codec(type), dictionary_(std::move(dictionary)) {
   DCHECK(type == CodecType::LZ4 || type == CodecType::LZ4_VARINT_SIZE);
-
-  switch (level) {
-    case COMPRESSION_LEVEL_FASTEST:
-    case COMPRESSION_LEVEL_DEFAULT:
-      level = 1;
-      break;
-    case COMPRESSION_LEVEL_BEST:
-      level = 2;
-      break;
-  }
-  if (level < 1 || level > 2) {
-    throw std::invalid_argument(to<std::string>(
-        "LZ4Codec: invalid level: ", level));
-  }
-  highCompression_ = (level > 1);
+  highCompression_ = (lz4ConvertLevel(level) > 1);
 }
 
 bool LZ4Codec::doNeedsUncompressedLength() const {
@@ -608,7 +756,9 @@ std::unique_ptr<IOBuf> LZ4Codec::doCompress(const IOBuf* data) {
   auto output = reinterpret_cast<char*>(out->writableTail());
   const auto inputLength = data->length();
 #if LZ4_VERSION_NUMBER >= 10700
-  if (highCompression_) {
+  if (dictionary_) {
+    n = compressWithDictionary(input, output, inputLength, out->tailroom());
+  } else if (highCompression_) {
     n = LZ4_compress_HC(input, output, inputLength, out->tailroom(), 0);
   } else {
     n = LZ4_compress_default(input, output, inputLength, out->tailroom());
@@ -628,6 +778,39 @@ std::unique_ptr<IOBuf> LZ4Codec::doCompress(const IOBuf* data) {
   return out;
 }
 
+#if LZ4_VERSION_NUMBER >= 10700
+int LZ4Codec::compressWithDictionary(
+    const char* input,
+    char* output,
+    int inputLength,
+    int outputLength) {
+  if (highCompression_) {
+    if (!streamHC_) {
+      streamHC_.reset(LZ4_createStreamHC());
+      if (!streamHC_) {
+        throw std::bad_alloc{};
+      }
+    }
+    // The HC tables are large, and the chain table is indexed by position,
+    // so loading the dictionary is about as cheap as copying them.
+    auto window = dictionary_->window();
+    LZ4_resetStreamHC(streamHC_.get(), 0);
+    LZ4_loadDictHC(
+        streamHC_.get(),
+        reinterpret_cast<const char*>(window.data()),
+        window.size());
+    return LZ4_compress_HC_continue(
+        streamHC_.get(), input, output, inputLength, outputLength);
+  }
+  if (!stream_) {
+    stream_ = std::make_unique<LZ4_stream_t>();
+  }
+  *stream_ = dictionary_->stream();
+  return LZ4_compress_fast_continue(
+      stream_.get(), input, output, inputLength, outputLength, 1);
+}
+#endif
+
 std::unique_ptr<IOBuf> LZ4Codec::doUncompress(
     const IOBuf* data,
     Optional<uint64_t> uncompressedLength) {
@@ -654,11 +837,23 @@ std::unique_ptr<IOBuf> LZ4Codec::doUncompress(
 
   auto sp = StringPiece{cursor.peekBytes()};
   auto out = IOBuf::create(actualUncompressedLength);
-  int n = LZ4_decompress_safe(
-      sp.data(),
-      reinterpret_cast<char*>(out->writableTail()),
-      sp.size(),
-      actualUncompressedLength);
+  int n;
+  if (dictionary_) {
+    auto window = dictionary_->window();
+    n = LZ4_decompress_safe_usingDict(
+        sp.data(),
+        reinterpret_cast<char*>(out->writableTail()),
+        sp.size(),
+        actualUncompressedLength,
+        reinterpret_cast<const char*>(window.data()),
+        window.size());
+  } else {
+    n = LZ4_decompress_safe(
+        sp.data(),
+        reinterpret_cast<char*>(out->writableTail()),
+        sp.size(),
+        actualUncompressedLength);
+  }
 
   if (n < 0 || uint64_t(n) != actualUncompressedLength) {
     throw std::runtime_error(to<std::string>(
@@ -1322,8 +1517,128 @@ void zstdFreeCStream(ZSTD_CStream* zcs) {
 void zstdFreeDStream(ZSTD_DStream* zds) {
   ZSTD_freeDStream(zds);
 }
+
+void zstdFreeCCtx(ZSTD_CCtx* cctx) {
+  ZSTD_freeCCtx(cctx);
+}
+
+void zstdFreeDCtx(ZSTD_DCtx* dctx) {
+  ZSTD_freeDCtx(dctx);
+}
+
+void zstdFreeCDict(ZSTD_CDict* cdict) {
+  ZSTD_freeCDict(cdict);
+}
+
+void zstdFreeDDict(ZSTD_DDict* ddict) {
+  ZSTD_freeDDict(ddict);
+}
+
+int zstdConvertLevel(int level) {
+  switch (level) {
+    case COMPRESSION_LEVEL_FASTEST:
+      level = 1;
+      break;
+    case COMPRESSION_LEVEL_DEFAULT:
+      level = 1;
+      break;
+    case COMPRESSION_LEVEL_BEST:
+      level = 19;
+      break;
+  }
+  if (level < 1 || level > ZSTD_maxCLevel()) {
+    throw std::invalid_argument(
+        to<std::string>("ZSTD: invalid level: ", level));
+  }
+  return level;
+}
+
+using ZSTDCStreamPtr = std::unique_ptr<
+    ZSTD_CStream,
+    folly::static_function_deleter<ZSTD_CStream, &zstdFreeCStream>>;
+using ZSTDDStreamPtr = std::unique_ptr<
+    ZSTD_DStream,
+    folly::static_function_deleter<ZSTD_DStream, &zstdFreeDStream>>;
+using ZSTDCCtxPtr = std::unique_ptr<
+    ZSTD_CCtx,
+    folly::static_function_deleter<ZSTD_CCtx, &zstdFreeCCtx>>;
+using ZSTDDCtxPtr = std::unique_ptr<
+    ZSTD_DCtx,
+    folly::static_function_deleter<ZSTD_DCtx, &zstdFreeDCtx>>;
+
+template <typename Ptr>
+CompressionContextPool<typename Ptr::element_type, typename Ptr::deleter_type>&
+zstdContextPool() {
+  // Leaked, so that codecs destroyed during static destruction can still
+  // give contexts back
+  static auto* pool = new CompressionContextPool<
+      typename Ptr::element_type,
+      typename Ptr::deleter_type>();
+  return *pool;
+}
+
+// Every context is reinitialized before each frame, so a context from the
+// pool is as good as a new one, whatever the codec it came from did with it
+template <typename Ptr, typename Create>
+void zstdAcquireContext(Ptr& context, Create create) {
+  if (context) {
+    return;
+  }
+  context = zstdContextPool<Ptr>().get();
+  if (!context) {
+    context.reset(create());
+    if (!context) {
+      throw std::bad_alloc{};
+    }
+  }
+}
+
+template <typename Ptr>
+void zstdReleaseContext(Ptr& context) {
+  zstdContextPool<Ptr>().put(std::move(context));
+}
 } // namespace
 
+/**
+ * ZSTD dictionary, digested into the compression tables for its level and
+ * the decompression tables, which ZSTD only reads from.
+ */
+class ZSTDDictionary final : public CompressionDictionary {
+ public:
+  ZSTDDictionary(int level, ByteRange data);
+
+  const ZSTD_CDict* cdict() const {
+    return cdict_.get();
+  }
+
+  const ZSTD_DDict* ddict() const {
+    return ddict_.get();
+  }
+
+ private:
+  std::unique_ptr<
+      ZSTD_CDict,
+      folly::static_function_deleter<ZSTD_CDict, &zstdFreeCDict>>
+      cdict_;
+  std::unique_ptr<
+      ZSTD_DDict,
+      folly::static_function_deleter<ZSTD_DDict, &zstdFreeDDict>>
+      ddict_;
+};
+
+ZSTDDictionary::ZSTDDictionary(int level, ByteRange data)
+    : CompressionDictionary(
+          CodecType::ZSTD,
+          zstdConvertLevel(level),
+          StringPiece(data).str()) {
+  auto const dict = this->data();
+  cdict_.reset(ZSTD_createCDict(dict.data(), dict.size(), this->level()));
+  ddict_.reset(ZSTD_createDDict(dict.data(), dict.size()));
+  if (!cdict_ || !ddict_) {
+    throw std::runtime_error("ZSTD: failed to create dictionary");
+  }
+}
+
 /**
  * ZSTD compression
  */
@@ -1331,7 +1646,11 @@ class ZSTDStreamCodec final : public StreamCodec {
  public:
   static std::unique_ptr<Codec> createCodec(int level, CodecType);
   static std::unique_ptr<StreamCodec> createStream(int level, CodecType);
-  explicit ZSTDStreamCodec(int level, CodecType type);
+  explicit ZSTDStreamCodec(
+      int level,
+      CodecType type,
+      std::shared_ptr<const ZSTDDictionary> dictionary = nullptr);
+  ~ZSTDStreamCodec() override;
 
   std::vector<std::string> validPrefixes() const override;
   bool canUncompress(const IOBuf* data, Optional<uint64_t> uncompressedLength)
@@ -1357,19 +1676,19 @@ class ZSTDStreamCodec final : public StreamCodec {
   void resetCStream();
   void resetDStream();
 
-  bool tryBlockCompress(ByteRange& input, MutableByteRange& output) const;
-  bool tryBlockUncompress(ByteRange& input, MutableByteRange& output) const;
+  bool tryBlockCompress(ByteRange& input, MutableByteRange& output);
+  bool tryBlockUncompress(ByteRange& input, MutableByteRange& output);
 
   int level_;
   bool needReset_{true};
-  std::unique_ptr<
-      ZSTD_CStream,
-      folly::static_function_deleter<ZSTD_CStream, &zstdFreeCStream>>
-      cstream_{nullptr};
-  std::unique_ptr<
-      ZSTD_DStream,
-      folly::static_function_deleter<ZSTD_DStream, &zstdFreeDStream>>
-      dstream_{nullptr};
+  std::shared_ptr<const ZSTDDictionary> dictionary_;
+  // Taken from the pools when first needed, and given back when the codec
+  // is destroyed.  The contexts are for block (un)compression, the streams
+  // for streaming.
+  ZSTDCCtxPtr cctx_{nullptr};
+  ZSTDDCtxPtr dctx_{nullptr};
+  ZSTDCStreamPtr cstream_{nullptr};
+  ZSTDDStreamPtr dstream_{nullptr};
 };
 
 static constexpr uint32_t kZSTDMagicLE = 0xFD2FB528;
@@ -1393,25 +1712,21 @@ std::unique_ptr<StreamCodec> ZSTDStreamCodec::createStream(
   return make_unique<ZSTDStreamCodec>(level, type);
 }
 
-ZSTDStreamCodec::ZSTDStreamCodec(int level, CodecType type)
-    : StreamCodec(type) {
+ZSTDStreamCodec::ZSTDStreamCodec(
+    int level,
+    CodecType type,
+    std::shared_ptr<const ZSTDDictionary> dictionary)
+    : StreamCodec(type),
+      level_(zstdConvertLevel(level)),
+      dictionary_(std::move(dictionary)) {
   DCHECK(type == CodecType::ZSTD);
-  switch (level) {
-    case COMPRESSION_LEVEL_FASTEST:
-      level = 1;
-      break;
-    case COMPRESSION_LEVEL_DEFAULT:
-      level = 1;
-      break;
-    case COMPRESSION_LEVEL_BEST:
-      level = 19;
-      break;
-  }
-  if (level < 1 || level > ZSTD_maxCLevel()) {
-    throw std::invalid_argument(
-        to<std::string>("ZSTD: invalid level: ", level));
-  }
-  level_ = level;
+}
+
+ZSTDStreamCodec::~ZSTDStreamCodec() {
+  zstdReleaseContext(cctx_);
+  zstdReleaseContext(dctx_);
+  zstdReleaseContext(cstream_);
+  zstdReleaseContext(dstream_);
 }
 
 bool ZSTDStreamCodec::doNeedsUncompressedLength() const {
@@ -1452,14 +1767,32 @@ void ZSTDStreamCodec::doResetStream() {
 
 bool ZSTDStreamCodec::tryBlockCompress(
     ByteRange& input,
-    MutableByteRange& output) const {
+    MutableByteRange& output) {
   DCHECK(needReset_);
   // We need to know that we have enough output space to use block compression
   if (output.size() < ZSTD_compressBound(input.size())) {
     return false;
   }
-  size_t const length = ZSTD_compress(
-      output.data(), output.size(), input.data(), input.size(), level_);
+  // ZSTD_compress() would create and free a context on each call
+  zstdAcquireContext(cctx_, ZSTD_createCCtx);
+  size_t length;
+  if (dictionary_) {
+    length = ZSTD_compress_usingCDict(
+        cctx_.get(),
+        output.data(),
+        output.size(),
+        input.data(),
+        input.size(),
+        dictionary_->cdict());
+  } else {
+    length = ZSTD_compressCCtx(
+        cctx_.get(),
+        output.data(),
+        output.size(),
+        input.data(),
+        input.size(),
+        level_);
+  }
   zstdThrowIfError(length);
   input.uncheckedAdvance(input.size());
   output.uncheckedAdvance(length);
@@ -1467,11 +1800,21 @@ bool ZSTDStreamCodec::tryBlockCompress(
 }
 
 void ZSTDStreamCodec::resetCStream() {
-  if (!cstream_) {
-    cstream_.reset(ZSTD_createCStream());
-    if (!cstream_) {
-      throw std::bad_alloc{};
-    }
+  zstdAcquireContext(cstream_, ZSTD_createCStream);
+  if (dictionary_) {
+#if ZSTD_VERSION_NUMBER >= 10300
+    ZSTD_frameParameters fParams{};
+    fParams.contentSizeFlag = uncompressedLength().hasValue();
+    zstdThrowIfError(ZSTD_initCStream_usingCDict_advanced(
+        cstream_.get(),
+        dictionary_->cdict(),
+        fParams,
+        uncompressedLength().value_or(ZSTD_CONTENTSIZE_UNKNOWN)));
+#else
+    zstdThrowIfError(
+        ZSTD_initCStream_usingCDict(cstream_.get(), dictionary_->cdict()));
+#endif
+    return;
   }
   // Advanced API usage works for all supported versions of zstd.
   // Required to set contentSizeFlag.
@@ -1525,7 +1868,7 @@ bool ZSTDStreamCodec::doCompressStream(
 
 bool ZSTDStreamCodec::tryBlockUncompress(
     ByteRange& input,
-    MutableByteRange& output) const {
+    MutableByteRange& output) {
   DCHECK(needReset_);
 #if ZSTD_VERSION_NUMBER < 10104
   // We require ZSTD_findFrameCompressedSize() to perform this optimization.
@@ -1538,8 +1881,24 @@ bool ZSTDStreamCodec::tryBlockUncompress(
   size_t const compressedLength =
       ZSTD_findFrameCompressedSize(input.data(), input.size());
   zstdThrowIfError(compressedLength);
-  size_t const length = ZSTD_decompress(
-      output.data(), *uncompressedLength(), input.data(), compressedLength);
+  zstdAcquireContext(dctx_, ZSTD_createDCtx);
+  size_t length;
+  if (dictionary_) {
+    length = ZSTD_decompress_usingDDict(
+        dctx_.get(),
+        output.data(),
+        *uncompressedLength(),
+        input.data(),
+        compressedLength,
+        dictionary_->ddict());
+  } else {
+    length = ZSTD_decompressDCtx(
+        dctx_.get(),
+        output.data(),
+        *uncompressedLength(),
+        input.data(),
+        compressedLength);
+  }
   zstdThrowIfError(length);
   if (length != *uncompressedLength()) {
     throw std::runtime_error("ZSTDStreamCodec: Incorrect uncompressed length");
@@ -1551,13 +1910,13 @@ bool ZSTDStreamCodec::tryBlockUncompress(
 }
 
 void ZSTDStreamCodec::resetDStream() {
-  if (!dstream_) {
-    dstream_.reset(ZSTD_createDStream());
-    if (!dstream_) {
-      throw std::bad_alloc{};
-    }
+  zstdAcquireContext(dstream_, ZSTD_createDStream);
+  if (dictionary_) {
+    zstdThrowIfError(
+        ZSTD_initDStream_usingDDict(dstream_.get(), dictionary_->ddict()));
+  } else {
+    zstdThrowIfError(ZSTD_initDStream(dstream_.get()));
   }
-  zstdThrowIfError(ZSTD_initDStream(dstream_.get()));
 }
 
 bool ZSTDStreamCodec::doUncompressStream(
@@ -2142,5 +2501,116 @@ std::unique_ptr<Codec> getAutoUncompressionCodec(
   return AutomaticCodec::create(
       std::move(customCodecs), std::move(terminalCodec));
 }
+
+bool hasDictionaryCodec(CodecType type) {
+  switch (type) {
+#if FOLLY_HAVE_LIBLZ4 && LZ4_VERSION_NUMBER >= 10700
+    case CodecType::LZ4:
+    case CodecType::LZ4_VARINT_SIZE:
+      return true;
+#endif
+#if FOLLY_HAVE_LIBZSTD
+    case CodecType::ZSTD:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+std::shared_ptr<const CompressionDictionary>
+createDictionary(CodecType type, ByteRange data, int level) {
+  if (!hasDictionaryCodec(type)) {
+    throw std::invalid_argument(to<std::string>(
+        "Compression type ", type, " does not support dictionaries"));
+  }
+  switch (type) {
+#if FOLLY_HAVE_LIBLZ4
+    case CodecType::LZ4:
+    case CodecType::LZ4_VARINT_SIZE:
+      return std::make_shared<LZ4Dictionary>(type, level, data);
+#endif
+#if FOLLY_HAVE_LIBZSTD
+    case CodecType::ZSTD:
+      return std::make_shared<ZSTDDictionary>(level, data);
+#endif
+    default:
+      break;
+  }
+  throw std::logic_error("unreachable");
+}
+
+std::string trainDictionary(
+    const std::vector<ByteRange>& samples,
+    size_t maxSize) {
+#if FOLLY_HAVE_LIBZSTD
+  std::string buffer;
+  std::vector<size_t> sizes;
+  sizes.reserve(samples.size());
+  for (auto sample : samples) {
+    buffer.append(reinterpret_cast<const char*>(sample.data()), sample.size());
+    sizes.push_back(sample.size());
+  }
+  std::string dictionary(maxSize, '\0');
+  size_t const size = ZDICT_trainFromBuffer(
+      &dictionary[0],
+      dictionary.size(),
+      buffer.data(),
+      sizes.data(),
+      sizes.size());
+  if (ZDICT_isError(size)) {
+    throw std::runtime_error(to<std::string>(
+        "ZSTD: failed to train dictionary: ", ZDICT_getErrorName(size)));
+  }
+  dictionary.resize(size);
+  return dictionary;
+#else
+  (void)samples;
+  (void)maxSize;
+  throw std::invalid_argument("trainDictionary() requires zstd");
+#endif
+}
+
+std::unique_ptr<Codec> getCodec(
+    std::shared_ptr<const CompressionDictionary> dictionary) {
+  CHECK(dictionary);
+  auto const type = dictionary->type();
+  switch (type) {
+#if FOLLY_HAVE_LIBLZ4 && LZ4_VERSION_NUMBER >= 10700
+    case CodecType::LZ4:
+    case CodecType::LZ4_VARINT_SIZE: {
+      auto const level = dictionary->level();
+      return std::make_unique<LZ4Codec>(
+          level,
+          type,
+          std::static_pointer_cast<const LZ4Dictionary>(std::move(dictionary)));
+    }
+#endif
+#if FOLLY_HAVE_LIBZSTD
+    case CodecType::ZSTD:
+      return getStreamCodec(std::move(dictionary));
+#endif
+    default:
+      throw std::invalid_argument(to<std::string>(
+          "Compression type ", type, " does not support dictionaries"));
+  }
+}
+
+std::unique_ptr<StreamCodec> getStreamCodec(
+    std::shared_ptr<const CompressionDictionary> dictionary) {
+  CHECK(dictionary);
+  auto const type = dictionary->type();
+#if FOLLY_HAVE_LIBZSTD
+  if (type == CodecType::ZSTD) {
+    auto const level = dictionary->level();
+    return std::make_unique<ZSTDStreamCodec>(
+        level,
+        type,
+        std::static_pointer_cast<const ZSTDDictionary>(std::move(dictionary)));
+  }
+#endif
+  throw std::invalid_argument(to<std::string>(
+      "Compression type ", type, " does not support streaming dictionaries"));
+}
 } // namespace io
 } // namespace folly
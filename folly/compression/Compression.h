@@ -31,8 +31,13 @@
  */
 
 namespace folly {
+
+class IOBufQueue;
+
 namespace io {
 
+class Cursor;
+
 enum class CodecType {
   /**
    * This codec type is not defined; getCodec() will throw an exception
@@ -350,6 +355,25 @@ class StreamCodec : public Codec {
       folly::MutableByteRange& output,
       FlushOp flushOp = StreamCodec::FlushOp::NONE);
 
+  using Codec::uncompress;
+
+  /**
+   * Uncompresses one frame from the input cursor, reading each buffer of a
+   * chained input in place rather than coalescing it, and appends the
+   * uncompressed data to output, uncompressing directly into its tailroom
+   * (with preallocate() and postallocate()) rather than into new IOBufs.
+   * The cursor is advanced past the frame, so data after it (another frame,
+   * say) is left to read.  Returns the number of bytes appended.
+   *
+   * Like compress() and uncompress(), this interrupts any ongoing streaming
+   * operation.  Throws on error like uncompress(); output may then hold
+   * part of the uncompressed data.
+   */
+  uint64_t uncompress(
+      io::Cursor& input,
+      IOBufQueue& output,
+      folly::Optional<uint64_t> uncompressedLength = folly::none);
+
  protected:
   explicit StreamCodec(CodecType type) : Codec(type) {}
 
@@ -489,5 +513,96 @@ bool hasCodec(CodecType type);
  * Check if a specified codec is supported and supports streaming.
  */
 bool hasStreamCodec(CodecType type);
+
+/**
+ * A dictionary that ZSTD or LZ4 (and LZ4_VARINT_SIZE) codecs compress and
+ * uncompress against, for inputs too small to compress well on their own
+ * (single records, small RPC messages, ...) that have much in common with
+ * each other.  Data compressed with a dictionary can only be uncompressed
+ * with the same dictionary.
+ *
+ * The dictionary is digested once, when it is created (for ZSTD, into the
+ * compression tables for its level and the decompression tables), and is
+ * immutable from then on, so one dictionary can be shared by any number of
+ * codecs, in any number of threads:
+ *
+ *   auto dict = createDictionary(CodecType::ZSTD, trainDictionary(samples));
+ *   auto codec = getCodec(dict);
+ *
+ * LZ4 only uses the last 64KB of a dictionary.
+ */
+class CompressionDictionary {
+ public:
+  virtual ~CompressionDictionary() = default;
+
+  CompressionDictionary(const CompressionDictionary&) = delete;
+  CompressionDictionary& operator=(const CompressionDictionary&) = delete;
+
+  CodecType type() const {
+    return type_;
+  }
+
+  /**
+   * The level codecs compress at with this dictionary, as a codec-dependent
+   * integer (never one of the COMPRESSION_LEVEL_* constants).
+   */
+  int level() const {
+    return level_;
+  }
+
+  ByteRange data() const {
+    return ByteRange(StringPiece(data_));
+  }
+
+ protected:
+  CompressionDictionary(CodecType type, int level, std::string data)
+      : type_(type), level_(level), data_(std::move(data)) {}
+
+ private:
+  const CodecType type_;
+  const int level_;
+  const std::string data_;
+};
+
+/**
+ * Builds a dictionary for the given codec type, which must be ZSTD, LZ4 or
+ * LZ4_VARINT_SIZE, from the dictionary content, e.g. what trainDictionary()
+ * returns.  The level (as for getCodec()) is the level codecs compress at
+ * with the dictionary.  Throws on error.
+ */
+std::shared_ptr<const CompressionDictionary> createDictionary(
+    CodecType type,
+    ByteRange data,
+    int level = COMPRESSION_LEVEL_DEFAULT);
+
+/**
+ * Trains a dictionary of at most maxSize bytes on samples of the data that
+ * is to be compressed with it (ideally thousands of them, and 100 times as
+ * much data as maxSize in all).  Requires zstd.  Throws on error, e.g. when
+ * there are too few samples.
+ */
+std::string trainDictionary(
+    const std::vector<ByteRange>& samples,
+    size_t maxSize = 110 * 1024);
+
+/**
+ * Return a codec of dictionary->type() that compresses at
+ * dictionary->level() and uncompresses with the dictionary.  Throws on
+ * error.
+ */
+std::unique_ptr<Codec> getCodec(
+    std::shared_ptr<const CompressionDictionary> dictionary);
+
+/**
+ * As getCodec(dictionary), for stream codecs.  Only ZSTD supports
+ * streaming with a dictionary.
+ */
+std::unique_ptr<StreamCodec> getStreamCodec(
+    std::shared_ptr<const CompressionDictionary> dictionary);
+
+/**
+ * Check if a specified codec type supports dictionaries.
+ */
+bool hasDictionaryCodec(CodecType type);
 } // namespace io
 } // namespace folly
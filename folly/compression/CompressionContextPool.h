@@ -0,0 +1,91 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <folly/ThreadLocal.h>
+
+namespace folly {
+namespace io {
+namespace compression {
+namespace detail {
+
+/**
+ * A per-thread cache of the native contexts of a compression library
+ * (ZSTD_CStream, z_stream, ...), which are expensive to create and free
+ * compared to compressing a small message.  Codecs take a context from the
+ * cache of the thread that first needs one, instead of creating it, and
+ * give it back to the cache of the thread that destroys them, instead of
+ * freeing it; so codecs obtained with getCodec() for each message reuse
+ * warm contexts.
+ *
+ * Contexts that can only be reused with the same parameters (say, zlib's
+ * window size) are cached under a Key of those parameters.  Contexts given
+ * back must be reset (or resettable) by the next codec, and each thread
+ * caches at most kMaxCached of them; the rest are freed.  The caches free
+ * their contexts when their thread exits.
+ */
+template <typename T, typename Deleter, typename Key = int>
+class CompressionContextPool {
+ public:
+  using Ptr = std::unique_ptr<T, Deleter>;
+
+  static constexpr size_t kMaxCached = 4;
+
+  /**
+   * Returns a cached context for the key, or nullptr if there is none.
+   */
+  Ptr get(const Key& key = Key()) {
+    auto& contexts = *cache_;
+    for (auto it = contexts.rbegin(); it != contexts.rend(); ++it) {
+      if (it->first == key) {
+        auto context = std::move(it->second);
+        contexts.erase(std::next(it).base());
+        return context;
+      }
+    }
+    return nullptr;
+  }
+
+  void put(Ptr context, const Key& key = Key()) {
+    if (!context) {
+      return;
+    }
+    auto& contexts = *cache_;
+    if (contexts.size() == kMaxCached) {
+      // The least recently given back goes
+      contexts.erase(contexts.begin());
+    }
+    contexts.emplace_back(key, std::move(context));
+  }
+
+ private:
+  struct Tag {};
+  ThreadLocal<std::vector<std::pair<Key, Ptr>>, Tag> cache_;
+};
+
+template <typename T, typename Deleter, typename Key>
+constexpr size_t CompressionContextPool<T, Deleter, Key>::kMaxCached;
+
+} // namespace detail
+} // namespace compression
+} // namespace io
+} // namespace folly
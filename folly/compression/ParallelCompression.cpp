@@ -0,0 +1,261 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/compression/ParallelCompression.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+
+namespace folly {
+namespace io {
+
+namespace {
+// The seek table: a skippable frame header, an entry per frame, and a
+// footer, all little endian
+constexpr uint32_t kSkippableFrameMagic = 0x184D2A5E;
+constexpr uint32_t kSeekableMagic = 0x8F92EAB1;
+constexpr size_t kSkippableHeaderSize = 8;
+constexpr size_t kEntrySize = 8;
+constexpr size_t kChecksumEntrySize = 12;
+constexpr size_t kFooterSize = 9;
+constexpr uint8_t kChecksumFlag = 0x80;
+constexpr uint8_t kReservedBits = 0x7C;
+
+std::unique_ptr<IOBuf> writeSeekTable(
+    const std::vector<std::unique_ptr<IOBuf>>& frames,
+    const std::vector<uint32_t>& uncompressedSizes) {
+  auto const frameSize = frames.size() * kEntrySize + kFooterSize;
+  auto table = IOBuf::create(kSkippableHeaderSize + frameSize);
+  Appender appender(table.get(), 0);
+  appender.writeLE<uint32_t>(kSkippableFrameMagic);
+  appender.writeLE<uint32_t>(frameSize);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    auto const compressedSize = frames[i]->computeChainDataLength();
+    if (compressedSize > std::numeric_limits<uint32_t>::max()) {
+      throw std::invalid_argument(to<std::string>(
+          "parallelCompress: compressed frame too large: ", compressedSize));
+    }
+    appender.writeLE<uint32_t>(compressedSize);
+    appender.writeLE<uint32_t>(uncompressedSizes[i]);
+  }
+  appender.writeLE<uint32_t>(frames.size());
+  appender.writeLE<uint8_t>(0); // no checksums
+  appender.writeLE<uint32_t>(kSeekableMagic);
+  return table;
+}
+
+std::unique_ptr<IOBuf> uncompressOneFrame(
+    CodecType type,
+    const SeekableFrames::Frame& frame,
+    const IOBuf* compressed) {
+  auto result = getCodec(type)->uncompress(compressed, frame.uncompressedSize);
+  if (result->computeChainDataLength() != frame.uncompressedSize) {
+    throw std::runtime_error("SeekableFrames: invalid uncompressed length");
+  }
+  return result;
+}
+} // namespace
+
+std::unique_ptr<IOBuf> parallelCompress(
+    const IOBuf* data,
+    Executor* executor,
+    CodecType type,
+    int level,
+    size_t frameSize) {
+  if (frameSize == 0 || frameSize > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(
+        to<std::string>("parallelCompress: invalid frame size: ", frameSize));
+  }
+  // Throws for invalid types and levels here rather than in the tasks
+  auto const maxLength = getCodec(type, level)->maxUncompressedLength();
+  if (frameSize > maxLength) {
+    throw std::invalid_argument(to<std::string>(
+        "parallelCompress: frame size ", frameSize, " exceeds ", maxLength));
+  }
+
+  auto const length = data->computeChainDataLength();
+  std::vector<Future<std::unique_ptr<IOBuf>>> futures;
+  std::vector<uint32_t> uncompressedSizes;
+  Cursor cursor(data);
+  for (uint64_t offset = 0; offset < length; offset += frameSize) {
+    auto const size = std::min<uint64_t>(frameSize, length - offset);
+    // Shares the buffers of data, which outlives the tasks
+    std::unique_ptr<IOBuf> frame;
+    cursor.clone(frame, size);
+    uncompressedSizes.push_back(size);
+    // Codecs aren't thread-safe, so each task gets its own
+    futures.push_back(via(executor, [ frame = std::move(frame), type, level ] {
+      return getCodec(type, level)->compress(frame.get());
+    }));
+  }
+
+  auto tries = collectAll(futures).get();
+  std::vector<std::unique_ptr<IOBuf>> frames;
+  frames.reserve(tries.size());
+  for (auto& t : tries) {
+    frames.push_back(std::move(t.value()));
+  }
+
+  auto table = writeSeekTable(frames, uncompressedSizes);
+  std::unique_ptr<IOBuf> result;
+  for (auto& frame : frames) {
+    if (result) {
+      result->prependChain(std::move(frame));
+    } else {
+      result = std::move(frame);
+    }
+  }
+  if (result) {
+    result->prependChain(std::move(table));
+  } else {
+    result = std::move(table);
+  }
+  return result;
+}
+
+std::unique_ptr<IOBuf> parallelUncompress(
+    const IOBuf* data,
+    Executor* executor,
+    CodecType type) {
+  SeekableFrames seekable(data, type);
+  auto const& frames = seekable.frames();
+  if (frames.empty()) {
+    return IOBuf::create(0);
+  }
+
+  // One pass over data for all the frames, rather than one per frame
+  std::vector<Future<std::unique_ptr<IOBuf>>> futures;
+  Cursor cursor(data);
+  for (auto const& frame : frames) {
+    std::unique_ptr<IOBuf> compressed;
+    cursor.clone(compressed, frame.compressedSize);
+    futures.push_back(
+        via(executor, [ compressed = std::move(compressed), frame, type ] {
+          return uncompressOneFrame(type, frame, compressed.get());
+        }));
+  }
+
+  IOBufQueue queue;
+  for (auto& t : collectAll(futures).get()) {
+    queue.append(std::move(t.value()));
+  }
+  return queue.move();
+}
+
+SeekableFrames::SeekableFrames(const IOBuf* data, CodecType type)
+    : data_(data), type_(type) {
+  auto const length = data->computeChainDataLength();
+  if (length < kSkippableHeaderSize + kFooterSize) {
+    throw std::invalid_argument("SeekableFrames: no seek table");
+  }
+  Cursor footer(data);
+  footer.skip(length - kFooterSize);
+  auto const numFrames = footer.readLE<uint32_t>();
+  auto const descriptor = footer.read<uint8_t>();
+  if (footer.readLE<uint32_t>() != kSeekableMagic ||
+      (descriptor & kReservedBits) != 0) {
+    throw std::invalid_argument("SeekableFrames: no seek table");
+  }
+  // Tables with checksums, as zstd writes them, are fine too; the checksums
+  // just aren't verified
+  auto const entrySize =
+      (descriptor & kChecksumFlag) ? kChecksumEntrySize : kEntrySize;
+  uint64_t const tableSize =
+      kSkippableHeaderSize + uint64_t(numFrames) * entrySize + kFooterSize;
+  if (tableSize > length) {
+    throw std::invalid_argument("SeekableFrames: truncated seek table");
+  }
+
+  Cursor table(data);
+  table.skip(length - tableSize);
+  if (table.readLE<uint32_t>() != kSkippableFrameMagic ||
+      table.readLE<uint32_t>() != tableSize - kSkippableHeaderSize) {
+    throw std::invalid_argument("SeekableFrames: invalid seek table header");
+  }
+  frames_.reserve(numFrames);
+  uint64_t compressedOffset = 0;
+  for (uint32_t i = 0; i < numFrames; ++i) {
+    Frame frame;
+    frame.compressedOffset = compressedOffset;
+    frame.uncompressedOffset = uncompressedLength_;
+    frame.compressedSize = table.readLE<uint32_t>();
+    frame.uncompressedSize = table.readLE<uint32_t>();
+    if (entrySize == kChecksumEntrySize) {
+      table.skip(entrySize - kEntrySize);
+    }
+    compressedOffset += frame.compressedSize;
+    uncompressedLength_ += frame.uncompressedSize;
+    frames_.push_back(frame);
+  }
+  if (compressedOffset != length - tableSize) {
+    throw std::invalid_argument(
+        "SeekableFrames: seek table doesn't match the data");
+  }
+}
+
+size_t SeekableFrames::frameAt(uint64_t uncompressedOffset) const {
+  CHECK_LT(uncompressedOffset, uncompressedLength_);
+  auto it = std::upper_bound(
+      frames_.begin(),
+      frames_.end(),
+      uncompressedOffset,
+      [](uint64_t offset, const Frame& frame) {
+        return offset < frame.uncompressedOffset;
+      });
+  return (it - frames_.begin()) - 1;
+}
+
+std::unique_ptr<IOBuf> SeekableFrames::uncompressFrame(size_t i) const {
+  CHECK_LT(i, frames_.size());
+  auto const& frame = frames_[i];
+  Cursor cursor(data_);
+  cursor.skip(frame.compressedOffset);
+  std::unique_ptr<IOBuf> compressed;
+  cursor.clone(compressed, frame.compressedSize);
+  return uncompressOneFrame(type_, frame, compressed.get());
+}
+
+std::unique_ptr<IOBuf> SeekableFrames::uncompress(
+    uint64_t offset,
+    uint64_t length) const {
+  CHECK_LE(offset, uncompressedLength_);
+  CHECK_LE(length, uncompressedLength_ - offset);
+  if (length == 0) {
+    return IOBuf::create(0);
+  }
+  auto const first = frameAt(offset);
+  auto const last = frameAt(offset + length - 1);
+  IOBufQueue queue;
+  for (auto i = first; i <= last; ++i) {
+    queue.append(uncompressFrame(i));
+  }
+  auto const& lastFrame = frames_[last];
+  queue.trimStart(offset - frames_[first].uncompressedOffset);
+  queue.trimEnd(
+      lastFrame.uncompressedOffset + lastFrame.uncompressedSize -
+      (offset + length));
+  return queue.move();
+}
+
+} // namespace io
+} // namespace folly
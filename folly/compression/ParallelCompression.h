@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/compression/Compression.h>
+#include <folly/io/IOBuf.h>
+
+/**
+ * Parallel, seekable compression.
+ *
+ * The data is split into frames of a fixed uncompressed size, which are
+ * compressed independently of each other, in parallel on an executor, and
+ * written one after the other, followed by a seek table of the compressed
+ * and uncompressed size of each frame.  So the frames can be uncompressed
+ * in parallel too, or only the frames covering a range of the uncompressed
+ * data can be.
+ *
+ * The seek table is in a zstd skippable frame, as in zstd's seekable format
+ * (https://github.com/facebook/zstd/tree/dev/contrib/seekable_format),
+ * without checksums.  With CodecType::ZSTD the output is in exactly that
+ * format, which zstd uncompresses like any other zstd data; with any other
+ * codec the frames are that codec's output, and only readable with these
+ * functions.
+ *
+ * The functions block until all the frames are done, so they mustn't be
+ * called from the threads of the executor they use.
+ */
+namespace folly {
+namespace io {
+
+constexpr size_t kDefaultParallelFrameSize = 4 << 20;
+
+/**
+ * Compresses data in frames of frameSize bytes (the last one may be
+ * shorter) with codecs for the given type and level, on the executor.
+ * Throws on error, or if frameSize or a compressed frame exceeds 4GB.
+ */
+std::unique_ptr<IOBuf> parallelCompress(
+    const IOBuf* data,
+    Executor* executor,
+    CodecType type = CodecType::ZSTD,
+    int level = COMPRESSION_LEVEL_DEFAULT,
+    size_t frameSize = kDefaultParallelFrameSize);
+
+/**
+ * Uncompresses what parallelCompress() returned, with codecs of the type it
+ * was compressed with, on the executor.  Throws on error.
+ */
+std::unique_ptr<IOBuf> parallelUncompress(
+    const IOBuf* data,
+    Executor* executor,
+    CodecType type = CodecType::ZSTD);
+
+/**
+ * The seek table of what parallelCompress() returned, for uncompressing
+ * parts of it.  data must outlive the SeekableFrames.
+ */
+class SeekableFrames {
+ public:
+  struct Frame {
+    uint64_t compressedOffset;
+    uint64_t uncompressedOffset;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+  };
+
+  /**
+   * Reads the seek table at the end of data.  Throws std::invalid_argument
+   * if there is none, or it doesn't match the data.
+   */
+  explicit SeekableFrames(
+      const IOBuf* data,
+      CodecType type = CodecType::ZSTD);
+
+  const std::vector<Frame>& frames() const {
+    return frames_;
+  }
+
+  uint64_t uncompressedLength() const {
+    return uncompressedLength_;
+  }
+
+  /**
+   * The index of the frame holding the given uncompressed offset, which
+   * must be less than uncompressedLength().
+   */
+  size_t frameAt(uint64_t uncompressedOffset) const;
+
+  /**
+   * Uncompresses frame i.  Safe to call from several threads at once.
+   */
+  std::unique_ptr<IOBuf> uncompressFrame(size_t i) const;
+
+  /**
+   * Uncompresses length bytes from the given uncompressed offset, only
+   * uncompressing the frames that cover them (on the calling thread).
+   */
+  std::unique_ptr<IOBuf> uncompress(uint64_t offset, uint64_t length) const;
+
+ private:
+  const IOBuf* data_;
+  const CodecType type_;
+  std::vector<Frame> frames_;
+  uint64_t uncompressedLength_{0};
+};
+
+} // namespace io
+} // namespace folly
@@ -18,14 +18,19 @@
 
 #if FOLLY_HAVE_LIBZ
 
+#include <tuple>
+
 #include <folly/Conv.h>
+#include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/Range.h>
 #include <folly/ScopeGuard.h>
 #include <folly/compression/Compression.h>
+#include <folly/compression/CompressionContextPool.h>
 #include <folly/compression/Utils.h>
 #include <folly/io/Cursor.h>
 
+using folly::io::compression::detail::CompressionContextPool;
 using folly::io::compression::detail::dataStartsWithLE;
 using folly::io::compression::detail::prefixToStringLE;
 
@@ -63,6 +68,46 @@ int getWindowBits(Options::Format format, int windowSize) {
   }
 }
 
+void zlibFreeDeflateStream(z_stream* stream) {
+  deflateEnd(stream);
+  delete stream;
+}
+
+void zlibFreeInflateStream(z_stream* stream) {
+  inflateEnd(stream);
+  delete stream;
+}
+
+// The streams are heap allocated since zlib's state points back to them
+using DeflateStreamPtr = std::unique_ptr<
+    z_stream,
+    folly::static_function_deleter<z_stream, &zlibFreeDeflateStream>>;
+using InflateStreamPtr = std::unique_ptr<
+    z_stream,
+    folly::static_function_deleter<z_stream, &zlibFreeInflateStream>>;
+
+// deflateReset() keeps all of the parameters of a deflate stream, and
+// inflateReset() keeps the window bits of an inflate stream
+using DeflateKey = std::tuple<int, int, int, int>;
+using DeflatePool = CompressionContextPool<
+    z_stream,
+    DeflateStreamPtr::deleter_type,
+    DeflateKey>;
+using InflatePool =
+    CompressionContextPool<z_stream, InflateStreamPtr::deleter_type>;
+
+// Leaked, so that codecs destroyed during static destruction can still
+// give streams back
+DeflatePool& deflatePool() {
+  static auto* pool = new DeflatePool();
+  return *pool;
+}
+
+InflatePool& inflatePool() {
+  static auto* pool = new InflatePool();
+  return *pool;
+}
+
 CodecType getCodecType(Options options) {
   if (options.windowSize == 15 && options.format == Options::Format::ZLIB) {
     return CodecType::ZLIB;
@@ -102,10 +147,15 @@ class ZlibStreamCodec final : public StreamCodec {
   void resetDeflateStream();
   void resetInflateStream();
 
+  DeflateKey deflateKey() const;
+  int deflateWindowBits() const;
+
   Options options_;
 
-  Optional<z_stream> deflateStream_{};
-  Optional<z_stream> inflateStream_{};
+  // Taken from the pools when first needed, and given back when the codec
+  // is destroyed
+  DeflateStreamPtr deflateStream_{};
+  InflateStreamPtr inflateStream_{};
   int level_;
   bool needReset_{true};
 };
@@ -239,71 +289,84 @@ ZlibStreamCodec::ZlibStreamCodec(Options options, int level)
 
 ZlibStreamCodec::~ZlibStreamCodec() {
   if (deflateStream_) {
-    deflateEnd(deflateStream_.get_pointer());
-    deflateStream_.clear();
+    deflatePool().put(std::move(deflateStream_), deflateKey());
   }
   if (inflateStream_) {
-    inflateEnd(inflateStream_.get_pointer());
-    inflateStream_.clear();
+    inflatePool().put(
+        std::move(inflateStream_),
+        getWindowBits(options_.format, options_.windowSize));
   }
 }
 
+int ZlibStreamCodec::deflateWindowBits() const {
+  // The automatic header detection format is only for inflation.
+  // Use zlib for deflation if the format is auto.
+  return getWindowBits(
+      options_.format == Options::Format::AUTO ? Options::Format::ZLIB
+                                               : options_.format,
+      options_.windowSize);
+}
+
+DeflateKey ZlibStreamCodec::deflateKey() const {
+  return DeflateKey{
+      level_, deflateWindowBits(), options_.memLevel, options_.strategy};
+}
+
 void ZlibStreamCodec::doResetStream() {
   needReset_ = true;
 }
 
 void ZlibStreamCodec::resetDeflateStream() {
+  if (!deflateStream_) {
+    deflateStream_ = deflatePool().get(deflateKey());
+  }
   if (deflateStream_) {
-    int const rc = deflateReset(deflateStream_.get_pointer());
+    int const rc = deflateReset(deflateStream_.get());
     if (rc != Z_OK) {
-      deflateStream_.clear();
+      deflateStream_.reset();
       throw std::runtime_error(
           to<std::string>("ZlibStreamCodec: deflateReset error: ", rc));
     }
     return;
   }
-  deflateStream_ = z_stream{};
-
-  // The automatic header detection format is only for inflation.
-  // Use zlib for deflation if the format is auto.
-  int const windowBits = getWindowBits(
-      options_.format == Options::Format::AUTO ? Options::Format::ZLIB
-                                               : options_.format,
-      options_.windowSize);
 
+  auto stream = std::make_unique<z_stream>();
   int const rc = deflateInit2(
-      deflateStream_.get_pointer(),
+      stream.get(),
       level_,
       Z_DEFLATED,
-      windowBits,
+      deflateWindowBits(),
       options_.memLevel,
       options_.strategy);
   if (rc != Z_OK) {
-    deflateStream_.clear();
     throw std::runtime_error(
         to<std::string>("ZlibStreamCodec: deflateInit error: ", rc));
   }
+  deflateStream_.reset(stream.release());
 }
 
 void ZlibStreamCodec::resetInflateStream() {
+  int const windowBits = getWindowBits(options_.format, options_.windowSize);
+  if (!inflateStream_) {
+    inflateStream_ = inflatePool().get(windowBits);
+  }
   if (inflateStream_) {
-    int const rc = inflateReset(inflateStream_.get_pointer());
+    int const rc = inflateReset(inflateStream_.get());
     if (rc != Z_OK) {
-      inflateStream_.clear();
+      inflateStream_.reset();
       throw std::runtime_error(
           to<std::string>("ZlibStreamCodec: inflateReset error: ", rc));
     }
     return;
   }
-  inflateStream_ = z_stream{};
-  int const rc = inflateInit2(
-      inflateStream_.get_pointer(),
-      getWindowBits(options_.format, options_.windowSize));
+
+  auto stream = std::make_unique<z_stream>();
+  int const rc = inflateInit2(stream.get(), windowBits);
   if (rc != Z_OK) {
-    inflateStream_.clear();
     throw std::runtime_error(
         to<std::string>("ZlibStreamCodec: inflateInit error: ", rc));
   }
+  inflateStream_.reset(stream.release());
 }
 
 static int zlibTranslateFlush(StreamCodec::FlushOp flush) {
@@ -338,7 +401,7 @@ bool ZlibStreamCodec::doCompressStream(
     resetDeflateStream();
     needReset_ = false;
   }
-  DCHECK(deflateStream_.hasValue());
+  DCHECK(deflateStream_);
   // zlib will return Z_STREAM_ERROR if output.data() is null.
   if (output.data() == nullptr) {
     return false;
@@ -352,7 +415,7 @@ bool ZlibStreamCodec::doCompressStream(
     output.uncheckedAdvance(output.size() - deflateStream_->avail_out);
   };
   int const rc = zlibThrowOnError(
-      deflate(deflateStream_.get_pointer(), zlibTranslateFlush(flush)));
+      deflate(deflateStream_.get(), zlibTranslateFlush(flush)));
   switch (flush) {
     case StreamCodec::FlushOp::NONE:
       return false;
@@ -373,7 +436,7 @@ bool ZlibStreamCodec::doUncompressStream(
     resetInflateStream();
     needReset_ = false;
   }
-  DCHECK(inflateStream_.hasValue());
+  DCHECK(inflateStream_);
   // zlib will return Z_STREAM_ERROR if output.data() is null.
   if (output.data() == nullptr) {
     return false;
@@ -387,7 +450,7 @@ bool ZlibStreamCodec::doUncompressStream(
     output.advance(output.size() - inflateStream_->avail_out);
   };
   int const rc = zlibThrowOnError(
-      inflate(inflateStream_.get_pointer(), zlibTranslateFlush(flush)));
+      inflate(inflateStream_.get(), zlibTranslateFlush(flush)));
   return rc == Z_STREAM_END;
 }
 
@@ -30,7 +30,9 @@
 #include <folly/Memory.h>
 #include <folly/Random.h>
 #include <folly/Varint.h>
+#include <folly/compression/CompressionContextPool.h>
 #include <folly/hash/Hash.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/portability/GTest.h>
 
@@ -764,6 +766,7 @@ class StreamingCompressionTest
   void runCompressStreamTest(DataHolder const& dh);
   void runUncompressStreamTest(DataHolder const& dh);
   void runFlushTest(DataHolder const& dh);
+  void runUncompressCursorTest(DataHolder const& dh);
 
  private:
   std::vector<ByteRange> split(ByteRange data) const;
@@ -950,6 +953,45 @@ TEST_P(StreamingCompressionTest, testFlush) {
   runFlushTest(randomDataHolder);
 }
 
+void StreamingCompressionTest::runUncompressCursorTest(DataHolder const& dh) {
+  auto const data = dh.data(uncompressedLength_);
+  auto const compressed = StringPiece(
+      codec_->compress(IOBuf::wrapBuffer(data).get())->coalesce()).str();
+  for (bool withLength : {true, false}) {
+    if (!withLength && codec_->needsUncompressedLength()) {
+      continue;
+    }
+    // The frame in chunkSize_ pieces, followed by more data
+    std::unique_ptr<IOBuf> input = IOBuf::create(0);
+    for (auto piece : split(ByteRange(StringPiece(compressed)))) {
+      input->prependChain(IOBuf::wrapBuffer(piece));
+    }
+    input->prependChain(IOBuf::copyBuffer("trailer"));
+
+    IOBufQueue output(IOBufQueue::cacheChainLength());
+    output.append(IOBuf::copyBuffer("prefix"));
+    io::Cursor cursor(input.get());
+    auto const length = codec_->uncompress(
+        cursor,
+        output,
+        withLength ? Optional<uint64_t>(uncompressedLength_) : none);
+    EXPECT_EQ(uncompressedLength_, length);
+    EXPECT_EQ(7, cursor.totalLength());
+    EXPECT_EQ("trailer", cursor.readFixedString(7));
+
+    ASSERT_EQ(6 + uncompressedLength_, output.chainLength());
+    auto result = output.move();
+    result->trimStart(6);
+    auto const expected = IOBuf::wrapBuffer(data);
+    EXPECT_EQ(hashIOBuf(expected.get()), hashIOBuf(result.get()));
+  }
+}
+
+TEST_P(StreamingCompressionTest, uncompressCursor) {
+  runUncompressCursorTest(constantDataHolder);
+  runUncompressCursorTest(randomDataHolder);
+}
+
 INSTANTIATE_TEST_CASE_P(
     StreamingCompressionTest,
     StreamingCompressionTest,
@@ -1486,6 +1528,199 @@ INSTANTIATE_TEST_CASE_P(
 
 #endif // FOLLY_HAVE_LIBZ
 
+TEST(CompressionContextPoolTest, Simple) {
+  struct Deleter {
+    void operator()(int* p) const {
+      delete p;
+    }
+  };
+  compression::detail::CompressionContextPool<int, Deleter> pool;
+  EXPECT_EQ(nullptr, pool.get(1));
+  std::unique_ptr<int, Deleter> context(new int(1));
+  auto const raw = context.get();
+  pool.put(std::move(context), 1);
+  EXPECT_EQ(nullptr, pool.get(2));
+  auto reused = pool.get(1);
+  EXPECT_EQ(raw, reused.get());
+  EXPECT_EQ(nullptr, pool.get(1));
+
+  // Only kMaxCached are kept
+  for (int i = 0; i < 10; ++i) {
+    pool.put(std::unique_ptr<int, Deleter>(new int(i)), 3);
+  }
+  size_t cached = 0;
+  while (pool.get(3)) {
+    ++cached;
+  }
+  EXPECT_EQ(pool.kMaxCached, cached);
+
+  // Per thread
+  pool.put(std::move(reused), 1);
+  std::thread([&] { EXPECT_EQ(nullptr, pool.get(1)); }).join();
+  EXPECT_NE(nullptr, pool.get(1));
+}
+
+TEST(CompressionContextPoolTest, ReusedAcrossCodecs) {
+  // Codecs created for each message, at alternating levels, reuse each
+  // other's contexts and must still compress exactly like fresh ones
+  auto const data = IOBuf::wrapBuffer(randomDataHolder.data(100000));
+  for (auto type : availableCodecs()) {
+    std::unordered_map<int, std::string> compressed;
+    for (auto level : {COMPRESSION_LEVEL_FASTEST,
+                       COMPRESSION_LEVEL_BEST,
+                       COMPRESSION_LEVEL_FASTEST,
+                       COMPRESSION_LEVEL_BEST}) {
+      auto const output = getCodec(type, level)->compress(data.get());
+      auto const str = output->cloneCoalescedAsValue().moveToFbString();
+      auto it = compressed.emplace(level, str.toStdString()).first;
+      EXPECT_EQ(it->second, str.toStdString()) << static_cast<int>(type);
+      auto const uncompressed =
+          getCodec(type)->uncompress(output.get(), data->length());
+      EXPECT_EQ(
+          data->cloneCoalescedAsValue().moveToFbString(),
+          uncompressed->cloneCoalescedAsValue().moveToFbString());
+    }
+  }
+}
+
+namespace {
+// Small records with much in common, which compress poorly on their own
+std::vector<std::string> makeRecords(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  static const char* const kNames[] = {"alpha", "bravo", "charlie", "delta"};
+  std::vector<std::string> records;
+  for (size_t i = 0; i < count; ++i) {
+    records.push_back(to<std::string>(
+        "{\"id\":",
+        rng() % 1000000,
+        ",\"name\":\"",
+        kNames[rng() % 4],
+        "\",\"enabled\":",
+        rng() % 2 ? "true" : "false",
+        ",\"weight\":",
+        rng() % 1000,
+        ",\"description\":\"a record of the dictionary compression test\"}"));
+  }
+  return records;
+}
+
+std::vector<ByteRange> toRanges(const std::vector<std::string>& records) {
+  std::vector<ByteRange> ranges;
+  for (const auto& record : records) {
+    ranges.push_back(ByteRange(StringPiece(record)));
+  }
+  return ranges;
+}
+
+std::vector<CodecType> availableDictionaryCodecs() {
+  std::vector<CodecType> codecs;
+  for (auto type :
+       {CodecType::LZ4, CodecType::LZ4_VARINT_SIZE, CodecType::ZSTD}) {
+    if (hasDictionaryCodec(type)) {
+      codecs.push_back(type);
+    }
+  }
+  return codecs;
+}
+} // namespace
+
+class DictionaryTest
+    : public testing::TestWithParam<std::tr1::tuple<int, CodecType>> {
+ protected:
+  void SetUp() override {
+    auto tup = GetParam();
+    level_ = std::tr1::get<0>(tup);
+    type_ = std::tr1::get<1>(tup);
+  }
+
+  int level_;
+  CodecType type_;
+};
+
+TEST_P(DictionaryTest, RoundTrip) {
+  if (!hasDictionaryCodec(CodecType::ZSTD)) {
+    return; // Training requires zstd
+  }
+  auto const dictionary = createDictionary(
+      type_,
+      ByteRange(StringPiece(trainDictionary(
+          toRanges(makeRecords(5000, 1)), 4096))),
+      level_);
+  EXPECT_EQ(type_, dictionary->type());
+  auto const codec = getCodec(dictionary);
+  auto const plainCodec = getCodec(type_, level_);
+  // Another codec sharing the dictionary
+  auto const otherCodec = getCodec(dictionary);
+
+  size_t compressedSize = 0;
+  size_t plainCompressedSize = 0;
+  for (const auto& record : makeRecords(100, 2)) {
+    auto const original = IOBuf::wrapBuffer(record.data(), record.size());
+    auto const compressed = codec->compress(original.get());
+    compressedSize += compressed->computeChainDataLength();
+    plainCompressedSize +=
+        plainCodec->compress(original.get())->computeChainDataLength();
+    auto const uncompressed =
+        otherCodec->uncompress(compressed.get(), record.size());
+    EXPECT_EQ(record, uncompressed->moveToFbString().toStdString());
+  }
+  EXPECT_LT(compressedSize, plainCompressedSize);
+}
+
+TEST_P(DictionaryTest, Stream) {
+  if (!hasDictionaryCodec(CodecType::ZSTD) || type_ != CodecType::ZSTD) {
+    return;
+  }
+  auto const dictionary = createDictionary(
+      type_,
+      ByteRange(StringPiece(trainDictionary(
+          toRanges(makeRecords(5000, 1)), 4096))),
+      level_);
+  auto const streamCodec = getStreamCodec(dictionary);
+  auto const codec = getCodec(dictionary);
+  auto const records = makeRecords(100, 3);
+  std::string original;
+  for (const auto& record : records) {
+    original += record;
+  }
+
+  // In small steps, so that the stream isn't compressed as a block
+  auto const input = ByteRange(StringPiece(original));
+  std::string compressed(streamCodec->maxCompressedLength(input.size()), '\0');
+  auto output = MutableByteRange(
+      reinterpret_cast<uint8_t*>(&compressed[0]), compressed.size());
+  for (const auto& record : records) {
+    auto in = ByteRange(StringPiece(record));
+    while (!in.empty()) {
+      streamCodec->compressStream(in, output);
+    }
+  }
+  ByteRange empty;
+  while (!streamCodec->compressStream(
+      empty, output, StreamCodec::FlushOp::END)) {
+  }
+  compressed.resize(compressed.size() - output.size());
+
+  EXPECT_EQ(original, codec->uncompress(StringPiece(compressed)));
+  EXPECT_THROW(
+      getCodec(type_)->uncompress(StringPiece(compressed)),
+      std::runtime_error);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    DictionaryTest,
+    DictionaryTest,
+    testing::Combine(
+        testing::Values(COMPRESSION_LEVEL_FASTEST, COMPRESSION_LEVEL_BEST),
+        testing::ValuesIn(availableDictionaryCodecs())));
+
+TEST(DictionaryTest, Unsupported) {
+  EXPECT_FALSE(hasDictionaryCodec(CodecType::NO_COMPRESSION));
+  EXPECT_THROW(
+      createDictionary(CodecType::NO_COMPRESSION, ByteRange()),
+      std::invalid_argument);
+}
+
 } // namespace test
 } // namespace io
 } // namespace folly
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/compression/ParallelCompression.h>
+
+#include <random>
+#include <string>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/io/Cursor.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace folly::io;
+
+namespace {
+std::string makeData(size_t size) {
+  std::mt19937 rng(42);
+  std::string data;
+  while (data.size() < size) {
+    data += to<std::string>("line ", rng() % 1000, ": some text\n");
+  }
+  data.resize(size);
+  return data;
+}
+
+// As several buffers, which frames cross
+std::unique_ptr<IOBuf> toChain(const std::string& data, size_t pieces) {
+  std::unique_ptr<IOBuf> chain;
+  auto const pieceSize = data.size() / pieces + 1;
+  for (size_t offset = 0; offset < data.size(); offset += pieceSize) {
+    auto piece = IOBuf::copyBuffer(
+        data.data() + offset, std::min(pieceSize, data.size() - offset));
+    if (chain) {
+      chain->prependChain(std::move(piece));
+    } else {
+      chain = std::move(piece);
+    }
+  }
+  return chain;
+}
+
+std::vector<CodecType> parallelCodecs() {
+  std::vector<CodecType> codecs;
+  for (auto type : {CodecType::ZSTD,
+                    CodecType::LZ4_FRAME,
+                    CodecType::SNAPPY,
+                    CodecType::ZLIB,
+                    CodecType::NO_COMPRESSION}) {
+    if (hasCodec(type)) {
+      codecs.push_back(type);
+    }
+  }
+  return codecs;
+}
+} // namespace
+
+class ParallelCompressionTest : public testing::TestWithParam<CodecType> {
+ protected:
+  CPUThreadPoolExecutor executor_{4};
+};
+
+TEST_P(ParallelCompressionTest, RoundTrip) {
+  auto const type = GetParam();
+  auto const data = makeData(1000000);
+  auto const input = toChain(data, 7);
+  auto const compressed =
+      parallelCompress(input.get(), &executor_, type, -1, 64 * 1024);
+
+  SeekableFrames seekable(compressed.get(), type);
+  EXPECT_EQ(16, seekable.frames().size());
+  EXPECT_EQ(data.size(), seekable.uncompressedLength());
+
+  auto const uncompressed =
+      parallelUncompress(compressed.get(), &executor_, type);
+  EXPECT_EQ(data, uncompressed->moveToFbString().toStdString());
+}
+
+TEST_P(ParallelCompressionTest, RandomAccess) {
+  auto const type = GetParam();
+  auto const data = makeData(100000);
+  auto const input = IOBuf::copyBuffer(data);
+  auto const compressed =
+      parallelCompress(input.get(), &executor_, type, -1, 10000);
+  SeekableFrames seekable(compressed.get(), type);
+  ASSERT_EQ(10, seekable.frames().size());
+
+  EXPECT_EQ(0, seekable.frameAt(0));
+  EXPECT_EQ(0, seekable.frameAt(9999));
+  EXPECT_EQ(1, seekable.frameAt(10000));
+  EXPECT_EQ(9, seekable.frameAt(99999));
+  EXPECT_EQ(
+      data.substr(30000, 10000),
+      seekable.uncompressFrame(3)->moveToFbString().toStdString());
+
+  for (auto range : {std::make_pair(0, 100000),
+                     std::make_pair(0, 0),
+                     std::make_pair(12345, 1),
+                     std::make_pair(9999, 2),
+                     std::make_pair(25000, 50000),
+                     std::make_pair(99000, 1000)}) {
+    auto const buf = seekable.uncompress(range.first, range.second);
+    EXPECT_EQ(
+        data.substr(range.first, range.second),
+        buf->moveToFbString().toStdString());
+  }
+}
+
+TEST_P(ParallelCompressionTest, Empty) {
+  auto const type = GetParam();
+  auto const compressed =
+      parallelCompress(IOBuf::create(0).get(), &executor_, type);
+  EXPECT_TRUE(SeekableFrames(compressed.get(), type).frames().empty());
+  EXPECT_EQ(
+      0,
+      parallelUncompress(compressed.get(), &executor_, type)
+          ->computeChainDataLength());
+}
+
+TEST_P(ParallelCompressionTest, Corrupt) {
+  auto const type = GetParam();
+  auto const compressed = parallelCompress(
+      IOBuf::copyBuffer(makeData(10000)).get(), &executor_, type, -1, 1000);
+  auto const data = compressed->cloneCoalescedAsValue();
+
+  auto truncated = data.clone();
+  truncated->trimEnd(1);
+  EXPECT_THROW(SeekableFrames(truncated.get(), type), std::invalid_argument);
+
+  auto prefixed = IOBuf::copyBuffer("prefix");
+  prefixed->prependChain(data.clone());
+  EXPECT_THROW(SeekableFrames(prefixed.get(), type), std::invalid_argument);
+
+  EXPECT_THROW(
+      parallelCompress(data.clone().get(), &executor_, type, -1, 0),
+      std::invalid_argument);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    ParallelCompressionTest,
+    ParallelCompressionTest,
+    testing::ValuesIn(parallelCodecs()));
@@ -22,6 +22,15 @@
 #endif
 #include <fstream>
 
+#if defined(__linux__) && defined(__GLIBC__) &&                  \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35)) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define FOLLY_HAVE_RSEQ 1
+#include <sys/rseq.h>
+#else
+#define FOLLY_HAVE_RSEQ 0
+#endif
+
 #include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/FileUtil.h>
@@ -227,6 +236,59 @@ Getcpu::Func Getcpu::resolveVdsoFunc() {
 #endif
 }
 
+#if FOLLY_HAVE_RSEQ
+namespace {
+
+Getcpu::Func rseqFallback;
+
+const volatile struct rseq* threadRseq() {
+  return reinterpret_cast<const volatile struct rseq*>(
+      Getcpu::threadPointer() + __rseq_offset);
+}
+
+int rseqGetcpu(unsigned* cpu, unsigned* node, void* unused) {
+  // Negative values mean the thread has no rseq area
+  auto id = int32_t(threadRseq()->cpu_id);
+  if (UNLIKELY(node != nullptr || id < 0)) {
+    return rseqFallback(cpu, node, unused);
+  }
+  if (cpu != nullptr) {
+    *cpu = unsigned(id);
+  }
+  return 0;
+}
+
+} // namespace
+#endif
+
+Getcpu::Func Getcpu::resolveRseqFunc() {
+#if !FOLLY_HAVE_RSEQ
+  return nullptr;
+#else
+  // glibc leaves __rseq_size at 0 if it did not register rseq, e.g.
+  // because the kernel lacks it or the glibc.pthread.rseq tunable is off
+  if (__rseq_size == 0 || int32_t(threadRseq()->cpu_id) < 0) {
+    return nullptr;
+  }
+  rseqFallback = resolveVdsoFunc();
+  if (rseqFallback == nullptr) {
+    rseqFallback = &FallbackGetcpuType::getcpu;
+  }
+  return &rseqGetcpu;
+#endif
+}
+
+std::ptrdiff_t Getcpu::rseqCpuIdOffset() {
+#if !FOLLY_HAVE_RSEQ
+  return 0;
+#else
+  if (resolveRseqFunc() == nullptr) {
+    return 0;
+  }
+  return __rseq_offset + std::ptrdiff_t(offsetof(struct rseq, cpu_id));
+#endif
+}
+
 #ifdef FOLLY_TLS
 /////////////// SequentialThreadId
 template struct SequentialThreadId<std::atomic>;
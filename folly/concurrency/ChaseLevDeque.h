@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <folly/CachelinePadded.h>
+
+namespace folly {
+
+/**
+ * A single-owner, multi-thief work-stealing deque of pointers (Chase and
+ * Lev, "Dynamic Circular Work-Stealing Deque", SPAA 2005, with the memory
+ * orderings of Le et al., "Correct and Efficient Work-Stealing for Weak
+ * Memory Models", PPoPP 2013).
+ *
+ * The owner thread pushes and pops at the bottom, LIFO, without any
+ * read-modify-write operation except when racing a thief for the last
+ * element.  Any thread may steal from the top, FIFO, with a single CAS.
+ *
+ * The deque grows without bound.  Arrays outgrown by the owner are kept
+ * until the deque is destroyed, since a thief may still be reading from
+ * one, so memory use is at most twice the peak size.
+ *
+ * Ownership may be handed to another thread, as long as the hand-off
+ * synchronizes (e.g. through a mutex).  The deque doesn't own the pointed-to
+ * objects.
+ */
+template <typename T>
+class ChaseLevDeque {
+ public:
+  explicit ChaseLevDeque(size_t initialCapacity = 256)
+      : array_(newArray(initialCapacity)) {}
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  ~ChaseLevDeque() {
+    delete array_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Push an element at the bottom.  Owner only.
+   */
+  void push(T* item) {
+    auto b = bottom_->load(std::memory_order_relaxed);
+    auto t = top_->load(std::memory_order_acquire);
+    auto a = array_.load(std::memory_order_relaxed);
+    if (b - t > int64_t(a->mask)) {
+      a = grow(a, t, b);
+    }
+    a->at(b).store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_->store(b + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Pop the most recently pushed element, or return nullptr if the deque is
+   * empty.  Owner only.
+   */
+  T* pop() {
+    auto b = bottom_->load(std::memory_order_relaxed) - 1;
+    auto a = array_.load(std::memory_order_relaxed);
+    bottom_->store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_->load(std::memory_order_relaxed);
+    if (t > b) {
+      // empty
+      bottom_->store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = a->at(b).load(std::memory_order_relaxed);
+    if (t == b) {
+      // last element, race thieves for it
+      if (!top_->compare_exchange_strong(
+              t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_->store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  enum class StealResult {
+    SUCCESS,
+    EMPTY,
+    // lost a race with the owner or another thief, the deque may not be
+    // empty
+    ABORT,
+  };
+
+  /**
+   * Take the least recently pushed element into `item`.  Any thread.
+   */
+  StealResult steal(T*& item) {
+    auto t = top_->load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_->load(std::memory_order_acquire);
+    if (t >= b) {
+      return StealResult::EMPTY;
+    }
+    // Loaded after bottom_, so it's at least as new as the array the
+    // element at t was stored into
+    auto a = array_.load(std::memory_order_acquire);
+    item = a->at(t).load(std::memory_order_relaxed);
+    if (!top_->compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return StealResult::ABORT;
+    }
+    return StealResult::SUCCESS;
+  }
+
+  /**
+   * Number of elements, only a snapshot if other threads are active.
+   */
+  size_t size() const {
+    auto b = bottom_->load(std::memory_order_relaxed);
+    auto t = top_->load(std::memory_order_relaxed);
+    return b > t ? size_t(b - t) : 0;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+ private:
+  struct Array {
+    explicit Array(size_t capacity)
+        : mask(capacity - 1), items(new std::atomic<T*>[capacity]) {}
+
+    std::atomic<T*>& at(int64_t i) {
+      return items[size_t(i) & mask];
+    }
+
+    size_t mask;
+    std::unique_ptr<std::atomic<T*>[]> items;
+    // the array this one replaced, freed with it
+    std::unique_ptr<Array> previous;
+  };
+
+  static Array* newArray(size_t capacity) {
+    size_t c = 1;
+    while (c < capacity) {
+      c <<= 1;
+    }
+    return new Array(c);
+  }
+
+  Array* grow(Array* a, int64_t t, int64_t b) {
+    auto bigger = newArray((a->mask + 1) * 2);
+    for (auto i = t; i < b; ++i) {
+      bigger->at(i).store(
+          a->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    bigger->previous.reset(a);
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  CachelinePadded<std::atomic<int64_t>> top_{0};
+  CachelinePadded<std::atomic<int64_t>> bottom_{0};
+  std::atomic<Array*> array_;
+};
+
+} // namespace folly
@@ -0,0 +1,485 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include <folly/Bits.h>
+#include <folly/Optional.h>
+#include <folly/SharedMutex.h>
+#include <folly/container/F14Map.h>
+#include <folly/hash/Hash.h>
+
+namespace folly {
+
+enum class ConcurrentEvictingCachePolicy {
+  // Approximate LRU: evict the first entry not read since the clock hand
+  // last passed it
+  Clock,
+  // Clock, but a new key only displaces the victim if it was requested more
+  // often recently, as estimated by a count-min sketch (TinyLFU).  Protects
+  // the cache from scans and one-hit wonders.
+  TinyLfu,
+};
+
+/**
+ * A thread-safe evicting cache, the concurrent counterpart of
+ * EvictingCacheMap for caches shared by many threads.
+ *
+ * Keys are spread over 1 << ShardBits shards, each with its own lock and
+ * an equal part of the capacity.  Lookups only take their shard's lock in
+ * shared mode: instead of moving the entry to the front of an LRU list,
+ * they set its reference bit, and eviction runs the CLOCK algorithm over
+ * the shard.  With SharedMutex as the lock, concurrent readers of a shard
+ * don't contend on a cache line, so reads scale with the number of cores.
+ * Only set() and erase() lock a shard exclusively.
+ *
+ * Capacity is in units of weight: each entry weighs what was passed to
+ * set() (1 by default), and a shard evicts until the new entry fits.
+ *
+ * Differences from EvictingCacheMap:
+ *  - get() returns a copy of the value, there are no iterators.
+ *  - Eviction order is approximately LRU, and per shard.
+ *  - The prune hook runs after the shard is unlocked, so it may use the
+ *    cache.  If it throws, the exception propagates from set(), and the
+ *    rest of that batch of evicted entries is destroyed without the hook.
+ *  - setPruneHook() is not thread-safe; call it before sharing the cache.
+ */
+template <
+    typename TKey,
+    typename TValue,
+    typename THash = std::hash<TKey>,
+    typename TKeyEqual = std::equal_to<TKey>,
+    uint8_t ShardBits = 6,
+    class Mutex = SharedMutex>
+class ConcurrentEvictingCache {
+  static_assert(ShardBits <= 16, "too many shards");
+
+ public:
+  typedef std::function<void(TKey, TValue&&)> PruneHookCall;
+
+  static constexpr size_t kNumShards = size_t(1) << ShardBits;
+
+  /**
+   * Construct a ConcurrentEvictingCache
+   * @param maxWeight the total weight of the entries the cache holds,
+   *     split evenly across the shards.  0 means unlimited.
+   * @param policy the eviction policy.
+   */
+  explicit ConcurrentEvictingCache(
+      size_t maxWeight,
+      ConcurrentEvictingCachePolicy policy =
+          ConcurrentEvictingCachePolicy::Clock)
+      : maxWeight_(maxWeight) {
+    size_t shardWeight = (maxWeight + kNumShards - 1) / kNumShards;
+    for (auto& shard : shards_) {
+      shard = std::make_unique<Shard>(shardWeight, policy);
+    }
+  }
+
+  ConcurrentEvictingCache(const ConcurrentEvictingCache&) = delete;
+  ConcurrentEvictingCache& operator=(const ConcurrentEvictingCache&) = delete;
+
+  ~ConcurrentEvictingCache() {
+    // Like EvictingCacheMap, entries destroyed with the cache aren't pruned
+    setPruneHook(nullptr);
+  }
+
+  size_t getMaxWeight() const {
+    return maxWeight_;
+  }
+
+  /**
+   * Check for existence of a specific key.  This has no effect on eviction
+   *     order.
+   */
+  bool exists(const TKey& key) const {
+    auto hash = THash()(key);
+    return shardFor(hash).exists(key);
+  }
+
+  /**
+   * Get a copy of the value associated with a specific key, marking it as
+   *     recently used.
+   * @return the value, or none if the key is not in the cache
+   */
+  Optional<TValue> get(const TKey& key) {
+    auto hash = THash()(key);
+    return shardFor(hash).get(key, hash);
+  }
+
+  /**
+   * Set a key-value pair, evicting entries of its shard as needed to make
+   *     room for it.
+   * @param weight the weight of the entry against the capacity
+   * @param pruneHook callback to use on eviction (if it occurs), instead
+   *     of the one set with setPruneHook
+   * @return false if the entry wasn't stored: it weighs more than a shard
+   *     holds, or the TinyLfu policy found it less popular than the entry
+   *     it would evict
+   */
+  bool set(
+      const TKey& key,
+      TValue value,
+      size_t weight = 1,
+      PruneHookCall pruneHook = nullptr) {
+    auto hash = THash()(key);
+    std::vector<std::pair<TKey, TValue>> evicted;
+    bool stored = shardFor(hash).set(key, std::move(value), weight, hash,
+                                     evicted);
+    runPruneHook(pruneHook, evicted);
+    return stored;
+  }
+
+  /**
+   * Erase the key-value pair associated with key if it exists.  The prune
+   *     hook is not called.
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key) {
+    auto hash = THash()(key);
+    return shardFor(hash).erase(key);
+  }
+
+  /**
+   * Remove all the entries, calling the prune hook on each.
+   */
+  void clear(PruneHookCall pruneHook = nullptr) {
+    for (auto& shard : shards_) {
+      std::vector<std::pair<TKey, TValue>> evicted;
+      shard->clear(evicted);
+      runPruneHook(pruneHook, evicted);
+    }
+  }
+
+  /**
+   * The number of entries.  Shards are counted one at a time, so this is
+   *     only a snapshot while other threads modify the cache.
+   */
+  size_t size() const {
+    size_t n = 0;
+    for (auto& shard : shards_) {
+      n += shard->size();
+    }
+    return n;
+  }
+
+  /**
+   * The total weight of the entries, with the same caveat as size().
+   */
+  size_t weight() const {
+    size_t w = 0;
+    for (auto& shard : shards_) {
+      w += shard->weight();
+    }
+    return w;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /**
+   * Set the prune hook, invoked on the key and value of each entry evicted
+   *     to make room for another or removed by clear().
+   */
+  void setPruneHook(PruneHookCall pruneHook) {
+    pruneHook_ = std::move(pruneHook);
+  }
+
+ private:
+  class Shard {
+   public:
+    Shard(size_t maxWeight, ConcurrentEvictingCachePolicy policy)
+        : maxWeight_(maxWeight) {
+      if (policy == ConcurrentEvictingCachePolicy::TinyLfu) {
+        sketch_ = std::make_unique<FrequencySketch>(
+            std::max<size_t>(maxWeight, 64));
+      }
+    }
+
+    bool exists(const TKey& key) const {
+      std::shared_lock<Mutex> guard(lock_);
+      return index_.find(key) != index_.end();
+    }
+
+    Optional<TValue> get(const TKey& key, size_t hash) {
+      std::shared_lock<Mutex> guard(lock_);
+      if (sketch_) {
+        sketch_->record(hash);
+      }
+      auto it = index_.find(key);
+      if (it == index_.end()) {
+        return none;
+      }
+      Slot& slot = slots_[it->second];
+      // Don't write the cache line of a hot entry on every read
+      if (!slot.referenced.load(std::memory_order_relaxed)) {
+        slot.referenced.store(true, std::memory_order_relaxed);
+      }
+      return slot.entry->second;
+    }
+
+    bool set(
+        const TKey& key,
+        TValue&& value,
+        size_t weight,
+        size_t hash,
+        std::vector<std::pair<TKey, TValue>>& evicted) {
+      if (maxWeight_ > 0 && weight > maxWeight_) {
+        return false;
+      }
+      std::lock_guard<Mutex> guard(lock_);
+      auto it = index_.find(key);
+      if (it != index_.end()) {
+        Slot& slot = slots_[it->second];
+        slot.entry->second = std::move(value);
+        weight_ += weight;
+        weight_ -= slot.weight;
+        slot.weight = weight;
+        slot.referenced.store(true, std::memory_order_relaxed);
+        // A heavier value may push other entries out
+        evict(0, it->second, evicted);
+        return true;
+      }
+
+      if (sketch_) {
+        sketch_->record(hash);
+        sketch_->maybeAge();
+      }
+      if (!evict(weight, slots_.size(), evicted, hash)) {
+        return false;
+      }
+      uint32_t pos;
+      if (free_.empty()) {
+        pos = uint32_t(slots_.size());
+        slots_.emplace_back();
+      } else {
+        pos = free_.back();
+        free_.pop_back();
+      }
+      Slot& slot = slots_[pos];
+      slot.entry.emplace(key, std::move(value));
+      slot.weight = weight;
+      // New entries must survive one pass of the hand, like a reference
+      slot.referenced.store(false, std::memory_order_relaxed);
+      index_.emplace(key, pos);
+      weight_ += weight;
+      return true;
+    }
+
+    bool erase(const TKey& key) {
+      std::lock_guard<Mutex> guard(lock_);
+      auto it = index_.find(key);
+      if (it == index_.end()) {
+        return false;
+      }
+      uint32_t pos = it->second;
+      index_.erase(it);
+      release(pos);
+      return true;
+    }
+
+    void clear(std::vector<std::pair<TKey, TValue>>& evicted) {
+      std::lock_guard<Mutex> guard(lock_);
+      evicted.reserve(index_.size());
+      for (auto& slot : slots_) {
+        if (slot.entry) {
+          evicted.emplace_back(std::move(*slot.entry));
+        }
+      }
+      index_.clear();
+      slots_.clear();
+      free_.clear();
+      hand_ = 0;
+      weight_ = 0;
+    }
+
+    size_t size() const {
+      std::shared_lock<Mutex> guard(lock_);
+      return index_.size();
+    }
+
+    size_t weight() const {
+      std::shared_lock<Mutex> guard(lock_);
+      return weight_;
+    }
+
+   private:
+    struct Slot {
+      Optional<std::pair<TKey, TValue>> entry;
+      size_t weight{0};
+      std::atomic<bool> referenced{false};
+    };
+
+    /**
+     * Count-min sketch of 4-bit saturating counters estimating how often
+     * each hash was seen recently: 16 counters per entry, 4 bumped for
+     * each access, halved every 10 accesses per entry.  Readers update it
+     * under the shared lock, so racing updates may lose increments, which
+     * only makes the estimate more approximate.
+     */
+    class FrequencySketch {
+     public:
+      explicit FrequencySketch(size_t entries)
+          : mask_(nextPowTwo(16 * entries) - 1),
+            counters_(mask_ + 1),
+            sampleLimit_(10 * entries) {}
+
+      void record(size_t hash) {
+        forEachCounter(hash, [](std::atomic<uint8_t>& counter) {
+          uint8_t n = counter.load(std::memory_order_relaxed);
+          if (n < 15) {
+            counter.store(n + 1, std::memory_order_relaxed);
+          }
+        });
+        samples_.store(
+            samples_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+      }
+
+      uint8_t estimate(size_t hash) {
+        uint8_t n = 15;
+        forEachCounter(hash, [&](std::atomic<uint8_t>& counter) {
+          n = std::min(n, counter.load(std::memory_order_relaxed));
+        });
+        return n;
+      }
+
+      // Called with the shard locked exclusively, so no record() races
+      void maybeAge() {
+        if (samples_.load(std::memory_order_relaxed) < sampleLimit_) {
+          return;
+        }
+        for (auto& counter : counters_) {
+          counter.store(
+              counter.load(std::memory_order_relaxed) / 2,
+              std::memory_order_relaxed);
+        }
+        samples_.store(0, std::memory_order_relaxed);
+      }
+
+     private:
+      template <class F>
+      void forEachCounter(size_t hash, F f) {
+        for (uint64_t i = 0; i < 4; ++i) {
+          f(counters_[hash::hash_128_to_64(hash, i) & mask_]);
+        }
+      }
+
+      size_t mask_;
+      std::vector<std::atomic<uint8_t>> counters_;
+      const size_t sampleLimit_;
+      std::atomic<size_t> samples_{0};
+    };
+
+    /**
+     * Advance the clock hand, evicting entries until weight more fits,
+     * never evicting the entry at keep.  With TinyLfu, a new key (whose
+     * hash is given) only evicts a less frequently requested victim.
+     */
+    bool evict(
+        size_t weight,
+        size_t keep,
+        std::vector<std::pair<TKey, TValue>>& evicted,
+        Optional<size_t> hash = none) {
+      if (maxWeight_ == 0) {
+        return true;
+      }
+      bool admitted = !sketch_ || !hash;
+      while (weight_ + weight > maxWeight_ && index_.size() > 0) {
+        if (hand_ >= slots_.size()) {
+          hand_ = 0;
+        }
+        size_t pos = hand_++;
+        Slot& slot = slots_[pos];
+        if (!slot.entry || pos == keep) {
+          if (pos == keep && index_.size() == 1) {
+            break;
+          }
+          continue;
+        }
+        if (slot.referenced.load(std::memory_order_relaxed)) {
+          slot.referenced.store(false, std::memory_order_relaxed);
+          continue;
+        }
+        if (!admitted) {
+          auto victimHash = THash()(slot.entry->first);
+          if (sketch_->estimate(*hash) <= sketch_->estimate(victimHash)) {
+            return false;
+          }
+          admitted = true;
+        }
+        index_.erase(slot.entry->first);
+        evicted.emplace_back(std::move(*slot.entry));
+        release(uint32_t(pos));
+      }
+      return true;
+    }
+
+    void release(uint32_t pos) {
+      Slot& slot = slots_[pos];
+      slot.entry.clear();
+      weight_ -= slot.weight;
+      slot.weight = 0;
+      free_.push_back(pos);
+    }
+
+    mutable Mutex lock_;
+    const size_t maxWeight_;
+    size_t weight_{0};
+    size_t hand_{0};
+    F14ValueMap<TKey, uint32_t, THash, TKeyEqual> index_;
+    // A deque keeps slots in place as it grows, readers hold references
+    std::deque<Slot> slots_;
+    std::vector<uint32_t> free_;
+    std::unique_ptr<FrequencySketch> sketch_;
+  };
+
+  Shard& shardFor(size_t hash) const {
+    // The high bits, the shard's F14 index consumes the low ones.  Two
+    // shifts, as shifting by 64 is undefined when there is a single shard.
+    return *shards_[(hash::twang_mix64(hash) >> 1) >> (63 - ShardBits)];
+  }
+
+  void runPruneHook(
+      const PruneHookCall& pruneHook,
+      std::vector<std::pair<TKey, TValue>>& evicted) {
+    auto& ph = (nullptr == pruneHook) ? pruneHook_ : pruneHook;
+    if (!ph) {
+      return;
+    }
+    for (auto& entry : evicted) {
+      ph(std::move(entry.first), std::move(entry.second));
+    }
+  }
+
+  const size_t maxWeight_;
+  PruneHookCall pruneHook_;
+  std::unique_ptr<Shard> shards_[kNumShards];
+};
+
+} // namespace folly
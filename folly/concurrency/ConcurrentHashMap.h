@@ -19,7 +19,11 @@
 #include <folly/concurrency/detail/ConcurrentHashMap-detail.h>
 #include <folly/experimental/hazptr/hazptr.h>
 #include <atomic>
+#include <exception>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace folly {
 
@@ -53,7 +57,13 @@ namespace folly {
  *   std::unordered_map which iterates over a linked list of elements.
  *   If the table is sparse, this may be more expensive.
  *
- * * rehash policy is a power of two, using supplied factor.
+ * * rehash policy is a power of two, using supplied factor.  Growing
+ *   is incremental: writes to a segment each move a few buckets to the
+ *   doubled table, instead of one write rehashing the whole segment.
+ *
+ * * The number of shards is fixed at construction, 1 << ShardBits by
+ *   default.  More shards let more writers run in parallel, fewer save
+ *   memory and iteration time for small maps.
  *
  * * Allocator must be stateless.
  *
@@ -84,13 +94,11 @@ class ConcurrentHashMap {
   using SegmentT = detail::ConcurrentHashMapSegment<
       KeyType,
       ValueType,
-      ShardBits,
       HashFn,
       KeyEqual,
       Allocator,
       Atom,
       Mutex>;
-  static constexpr uint64_t NumShards = (1 << ShardBits);
   // Slightly higher than 1.0, in case hashing to shards isn't
   // perfectly balanced, reserve(size) will still work without
   // rehashing.
@@ -108,60 +116,58 @@ class ConcurrentHashMap {
   typedef ConstIterator const_iterator;
 
   /*
-   * Construct a ConcurrentHashMap with 1 << ShardBits shards, size
+   * Construct a ConcurrentHashMap with 1 << shard_bits shards, size
    * and max_size given.  Both size and max_size will be rounded up to
    * the next power of two, if they are not already a power of two, so
    * that we can index in to Shards efficiently.
    *
    * Insertion functions will throw bad_alloc if max_size is exceeded.
    */
-  explicit ConcurrentHashMap(size_t size = 8, size_t max_size = 0) {
+  explicit ConcurrentHashMap(
+      size_t size = 8,
+      size_t max_size = 0,
+      uint8_t shard_bits = ShardBits)
+      : shard_bits_(shard_bits), num_shards_(uint64_t(1) << shard_bits) {
+    CHECK_LE(shard_bits, 16);
     size_ = folly::nextPowTwo(size);
     if (max_size != 0) {
       max_size_ = folly::nextPowTwo(max_size);
     }
     CHECK(max_size_ == 0 || max_size_ >= size_);
-    for (uint64_t i = 0; i < NumShards; i++) {
+    segments_.reset(new Atom<SegmentT*>[num_shards_]);
+    for (uint64_t i = 0; i < num_shards_; i++) {
       segments_[i].store(nullptr, std::memory_order_relaxed);
     }
   }
 
-  ConcurrentHashMap(ConcurrentHashMap&& o) noexcept {
-    for (uint64_t i = 0; i < NumShards; i++) {
-      segments_[i].store(
-          o.segments_[i].load(std::memory_order_relaxed),
-          std::memory_order_relaxed);
-      o.segments_[i].store(nullptr, std::memory_order_relaxed);
-    }
-  }
+  // The moved-from map may only be destroyed or assigned to.
+  ConcurrentHashMap(ConcurrentHashMap&& o) noexcept
+      : segments_(std::move(o.segments_)),
+        size_(o.size_),
+        max_size_(o.max_size_),
+        shard_bits_(o.shard_bits_),
+        num_shards_(o.num_shards_) {}
 
   ConcurrentHashMap& operator=(ConcurrentHashMap&& o) {
-    for (uint64_t i = 0; i < NumShards; i++) {
-      auto seg = segments_[i].load(std::memory_order_relaxed);
-      if (seg) {
-        seg->~SegmentT();
-        Allocator().deallocate((uint8_t*)seg, sizeof(SegmentT));
-      }
-      segments_[i].store(
-          o.segments_[i].load(std::memory_order_relaxed),
-          std::memory_order_relaxed);
-      o.segments_[i].store(nullptr, std::memory_order_relaxed);
-    }
+    destroySegments();
+    segments_ = std::move(o.segments_);
+    size_ = o.size_;
+    max_size_ = o.max_size_;
+    shard_bits_ = o.shard_bits_;
+    num_shards_ = o.num_shards_;
     return *this;
   }
 
   ~ConcurrentHashMap() {
-    for (uint64_t i = 0; i < NumShards; i++) {
-      auto seg = segments_[i].load(std::memory_order_relaxed);
-      if (seg) {
-        seg->~SegmentT();
-        Allocator().deallocate((uint8_t*)seg, sizeof(SegmentT));
-      }
-    }
+    destroySegments();
+  }
+
+  uint64_t shard_count() const noexcept {
+    return num_shards_;
   }
 
   bool empty() const noexcept {
-    for (uint64_t i = 0; i < NumShards; i++) {
+    for (uint64_t i = 0; i < num_shards_; i++) {
       auto seg = segments_[i].load(std::memory_order_acquire);
       if (seg) {
         if (!seg->empty()) {
@@ -177,13 +183,13 @@ class ConcurrentHashMap {
     ConstIterator res(this, segment);
     auto seg = segments_[segment].load(std::memory_order_acquire);
     if (!seg || !seg->find(res.it_, k)) {
-      res.segment_ = NumShards;
+      res.segment_ = num_shards_;
     }
     return res;
   }
 
   ConstIterator cend() const noexcept {
-    return ConstIterator(NumShards);
+    return ConstIterator(num_shards_);
   }
 
   ConstIterator cbegin() const noexcept {
@@ -334,7 +340,7 @@ class ConcurrentHashMap {
 
   // NOT noexcept, initializes new shard segments vs.
   void clear() {
-    for (uint64_t i = 0; i < NumShards; i++) {
+    for (uint64_t i = 0; i < num_shards_; i++) {
       auto seg = segments_[i].load(std::memory_order_acquire);
       if (seg) {
         seg->clear();
@@ -342,20 +348,155 @@ class ConcurrentHashMap {
     }
   }
 
+  // Grows every segment to hold its share of count elements.
   void reserve(size_t count) {
-    count = count >> ShardBits;
-    for (uint64_t i = 0; i < NumShards; i++) {
+    count = count >> shard_bits_;
+    for (uint64_t i = 0; i < num_shards_; i++) {
+      ensureSegment(i)->reserve(count);
+    }
+  }
+
+  /*
+   * Looks up the keys in [first, last), calling fn(key, value) with a
+   * pointer to each key's value, or nullptr if it isn't in the map.  The
+   * value is only protected until fn returns.
+   *
+   * Cheaper than find() in a loop: the keys are grouped by segment, each
+   * segment's buckets are protected once for the whole group, and the
+   * buckets and nodes of upcoming keys are prefetched while earlier keys
+   * are looked up.  fn is called in segment order, not in key order.
+   */
+  template <typename ForwardIt, typename Fn>
+  void find_batch(ForwardIt first, ForwardIt last, Fn&& fn) const {
+    std::vector<std::pair<size_t, const KeyType*>> items;
+    for (; first != last; ++first) {
+      const KeyType& k = *first;
+      items.emplace_back(HashFn()(k), &k);
+    }
+    auto offsets = groupBySegment(items);
+    for (uint64_t i = 0; i < num_shards_; i++) {
+      auto n = offsets[i + 1] - offsets[i];
+      if (n == 0) {
+        continue;
+      }
       auto seg = segments_[i].load(std::memory_order_acquire);
       if (seg) {
-        seg->rehash(count);
+        seg->find_batch(&items[offsets[i]], n, fn);
+      } else {
+        for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
+          fn(*items[j].second, static_cast<const ValueType*>(nullptr));
+        }
       }
     }
   }
 
+  /*
+   * Inserts the key-value pairs in [first, last) whose key isn't in the
+   * map yet, like insert() on each, and returns how many were inserted.
+   * Use move iterators to move the pairs in.
+   *
+   * Cheaper than insert() in a loop: the nodes are built before taking
+   * any lock, then each segment is locked once for its group of pairs,
+   * and grown up front to fit them all.  Throws bad_alloc, with part of
+   * the batch inserted, if it would exceed max_size.
+   */
+  template <typename ForwardIt>
+  size_t insert_batch(ForwardIt first, ForwardIt last) {
+    using Node = typename SegmentT::Node;
+    std::vector<std::pair<size_t, Node*>> items;
+    auto freeNodes = [&](size_t from) {
+      for (size_t j = from; j < items.size(); j++) {
+        items[j].second->~Node();
+        Allocator().deallocate((uint8_t*)items[j].second, sizeof(Node));
+      }
+    };
+    try {
+      for (; first != last; ++first) {
+        auto&& kv = *first;
+        auto node = (Node*)Allocator().allocate(sizeof(Node));
+        try {
+          new (node) Node(
+              std::get<0>(std::forward<decltype(kv)>(kv)),
+              std::get<1>(std::forward<decltype(kv)>(kv)));
+        } catch (...) {
+          Allocator().deallocate((uint8_t*)node, sizeof(Node));
+          throw;
+        }
+        items.emplace_back(0, node);
+        items.back().first = HashFn()(node->getItem().first);
+      }
+    } catch (...) {
+      freeNodes(0);
+      throw;
+    }
+
+    auto offsets = groupBySegment(items);
+    size_t inserted = 0;
+    for (uint64_t i = 0; i < num_shards_; i++) {
+      auto n = offsets[i + 1] - offsets[i];
+      if (n == 0) {
+        continue;
+      }
+      try {
+        inserted += ensureSegment(i)->insert_batch(&items[offsets[i]], n);
+      } catch (...) {
+        // The segment freed its own group
+        freeNodes(offsets[i + 1]);
+        throw;
+      }
+    }
+    return inserted;
+  }
+
+  /*
+   * Calls fn(item) on every element from up to concurrency threads: the
+   * caller and concurrency - 1 new ones, each visiting whole segments, so
+   * fn must be thread-safe.  Concurrent updates may or may not be seen,
+   * as with iterators.  If fn throws, the remaining segments are skipped
+   * and the first exception is rethrown once all threads are done.
+   */
+  template <typename Fn>
+  void parallel_for_each(size_t concurrency, Fn fn) const {
+    std::atomic<uint64_t> next{0};
+    std::mutex errorLock;
+    std::exception_ptr error;
+    auto work = [&] {
+      try {
+        for (uint64_t i; (i = next.fetch_add(1)) < num_shards_;) {
+          auto seg = segments_[i].load(std::memory_order_acquire);
+          if (!seg) {
+            continue;
+          }
+          for (auto it = seg->cbegin(); it != seg->cend(); ++it) {
+            fn(*it);
+          }
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> g(errorLock);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next.store(num_shards_);
+      }
+    };
+    std::vector<std::thread> threads;
+    auto numThreads = std::min<size_t>(concurrency, num_shards_);
+    for (size_t i = 1; i < numThreads; i++) {
+      threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
   // This is a rolling size, and is not exact at any moment in time.
   size_t size() const noexcept {
     size_t res = 0;
-    for (uint64_t i = 0; i < NumShards; i++) {
+    for (uint64_t i = 0; i < num_shards_; i++) {
       auto seg = segments_[i].load(std::memory_order_acquire);
       if (seg) {
         res += seg->size();
@@ -369,7 +510,7 @@ class ConcurrentHashMap {
   }
 
   void max_load_factor(float factor) {
-    for (uint64_t i = 0; i < NumShards; i++) {
+    for (uint64_t i = 0; i < num_shards_; i++) {
       auto seg = segments_[i].load(std::memory_order_acquire);
       if (seg) {
         seg->max_load_factor(factor);
@@ -437,11 +578,12 @@ class ConcurrentHashMap {
     explicit ConstIterator(uint64_t shards) : it_(nullptr), segment_(shards) {}
 
     void next() {
-      while (it_ == parent_->ensureSegment(segment_)->cend() &&
-             segment_ < parent_->NumShards) {
+      while (segment_ < parent_->num_shards_ &&
+             it_ == parent_->ensureSegment(segment_)->cend()) {
         segment_++;
-        auto seg = parent_->segments_[segment_].load(std::memory_order_acquire);
-        if (segment_ < parent_->NumShards) {
+        if (segment_ < parent_->num_shards_) {
+          auto seg =
+              parent_->segments_[segment_].load(std::memory_order_acquire);
           if (!seg) {
             continue;
           }
@@ -457,7 +599,10 @@ class ConcurrentHashMap {
 
  private:
   uint64_t pickSegment(const KeyType& k) const {
-    auto h = HashFn()(k);
+    return pickSegmentForHash(HashFn()(k));
+  }
+
+  uint64_t pickSegmentForHash(size_t h) const {
     // Use the lowest bits for our shard bits.
     //
     // This works well even if the hash function is biased towards the
@@ -467,15 +612,39 @@ class ConcurrentHashMap {
     //
     // Low-bit bias happens often for std::hash using small numbers,
     // since the integer hash function is the identity function.
-    return h & (NumShards - 1);
+    return h & (num_shards_ - 1);
+  }
+
+  // Stable counting sort of (hash, item) pairs by segment.  Returns the
+  // offset in items of each segment's group, and the end.
+  template <typename T>
+  std::vector<size_t> groupBySegment(
+      std::vector<std::pair<size_t, T>>& items) const {
+    std::vector<size_t> offsets(num_shards_ + 1);
+    for (auto& item : items) {
+      offsets[pickSegmentForHash(item.first) + 1]++;
+    }
+    for (uint64_t i = 0; i < num_shards_; i++) {
+      offsets[i + 1] += offsets[i];
+    }
+    std::vector<std::pair<size_t, T>> sorted(items.size());
+    auto next = offsets;
+    for (auto& item : items) {
+      sorted[next[pickSegmentForHash(item.first)]++] = item;
+    }
+    items.swap(sorted);
+    return offsets;
   }
 
   SegmentT* ensureSegment(uint64_t i) const {
     SegmentT* seg = segments_[i].load(std::memory_order_acquire);
     if (!seg) {
       SegmentT* newseg = (SegmentT*)Allocator().allocate(sizeof(SegmentT));
-      newseg = new (newseg)
-          SegmentT(size_ >> ShardBits, load_factor_, max_size_ >> ShardBits);
+      newseg = new (newseg) SegmentT(
+          size_ >> shard_bits_,
+          load_factor_,
+          max_size_ >> shard_bits_,
+          shard_bits_);
       if (!segments_[i].compare_exchange_strong(seg, newseg)) {
         // seg is updated with new value, delete ours.
         newseg->~SegmentT();
@@ -487,9 +656,24 @@ class ConcurrentHashMap {
     return seg;
   }
 
-  mutable Atom<SegmentT*> segments_[NumShards];
+  void destroySegments() {
+    if (!segments_) {
+      return;
+    }
+    for (uint64_t i = 0; i < num_shards_; i++) {
+      auto seg = segments_[i].load(std::memory_order_relaxed);
+      if (seg) {
+        seg->~SegmentT();
+        Allocator().deallocate((uint8_t*)seg, sizeof(SegmentT));
+      }
+    }
+  }
+
+  std::unique_ptr<Atom<SegmentT*>[]> segments_;
   size_t size_{0};
   size_t max_size_{0};
+  uint8_t shard_bits_;
+  uint64_t num_shards_;
 };
 
 } // namespace folly
@@ -17,11 +17,20 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <utility>
 
+#include <folly/CachelinePadded.h>
+#include <folly/Likely.h>
 #include <folly/concurrency/AtomicSharedPtr.h>
 #include <folly/concurrency/CacheLocality.h>
 #include <folly/container/Enumerate.h>
+#include <folly/experimental/StampedPtr.h>
 #include <folly/experimental/hazptr/hazptr.h>
 
 namespace folly {
@@ -146,4 +155,207 @@ class AtomicCoreCachedSharedPtr {
   std::atomic<Slots*> slots_{nullptr};
 };
 
+/**
+ * A pointer that many threads take references to, and that is
+ * occasionally replaced, like AtomicCoreCachedSharedPtr.  But instead of
+ * copying core-local shared_ptrs (one control block per core, behind a
+ * hazard pointer), references are counted in per-core slots, so taking
+ * and dropping one is a single uncontended atomic operation and nothing
+ * else.  get() returns a Ref, a move-only handle that keeps the object
+ * alive; Ref::toSharedPtr() turns it into a std::shared_ptr for code
+ * that needs one, without touching the object's own control block.
+ *
+ * Each slot holds the current object's record and the number of Refs
+ * taken through the slot, packed into one word with StampedPtr.  reset()
+ * installs the new record in every slot and, with the same exchange,
+ * takes the slot's count for the old one, so the handover is exact
+ * without any collection pass or barrier.  From then on the old record is
+ * counted in a single atomic, which Refs released later decrement, and
+ * which frees it as it reaches zero.
+ *
+ * All methods are threadsafe, and Refs may outlive the pointer they came
+ * from.  At most 65535 Refs can be taken through one slot at a time;
+ * beyond that get() takes a slower path through a mutex.
+ */
+template <class T, size_t kNumSlots = 64>
+class CoreRefCountedSharedPtr {
+  struct Record;
+
+ public:
+  class Ref {
+   public:
+    Ref() = default;
+
+    Ref(Ref&& other) noexcept
+        : record_(std::exchange(other.record_, nullptr)), slot_(other.slot_) {}
+
+    Ref& operator=(Ref&& other) noexcept {
+      if (this != &other) {
+        reset();
+        record_ = std::exchange(other.record_, nullptr);
+        slot_ = other.slot_;
+      }
+      return *this;
+    }
+
+    ~Ref() {
+      reset();
+    }
+
+    void reset() noexcept {
+      if (!record_) {
+        return;
+      }
+      if (slot_ != kSharedCount) {
+        // Still counted in the slot if the slot still holds our record
+        auto& slot = *record_->slots->slots[slot_];
+        auto raw = slot.load(std::memory_order_acquire);
+        while (StampedPtr<Record>::unpackPtr(raw) == record_) {
+          auto count = StampedPtr<Record>::unpackStamp(raw);
+          assert(count > 0);
+          if (slot.compare_exchange_weak(
+                  raw,
+                  StampedPtr<Record>::pack(record_, count - 1),
+                  std::memory_order_acq_rel)) {
+            record_ = nullptr;
+            return;
+          }
+        }
+      }
+      record_->release(1);
+      record_ = nullptr;
+    }
+
+    T* get() const {
+      return record_ ? record_->ptr.get() : nullptr;
+    }
+
+    T& operator*() const {
+      return *get();
+    }
+
+    T* operator->() const {
+      return get();
+    }
+
+    explicit operator bool() const {
+      return get() != nullptr;
+    }
+
+    /* Moves the reference into a std::shared_ptr, at the cost of an
+     * allocation */
+    std::shared_ptr<T> toSharedPtr() && {
+      T* ptr = get();
+      if (!ptr) {
+        reset();
+        return nullptr;
+      }
+      auto holder = std::make_shared<Ref>(std::move(*this));
+      return std::shared_ptr<T>(holder, ptr);
+    }
+
+   private:
+    friend class CoreRefCountedSharedPtr;
+
+    Ref(Record* record, uint32_t slot) : record_(record), slot_(slot) {}
+
+    Record* record_{nullptr};
+    uint32_t slot_{0};
+  };
+
+  explicit CoreRefCountedSharedPtr(std::shared_ptr<T> p = nullptr)
+      : slots_(std::make_shared<Slots>()) {
+    current_ = new Record(std::move(p), slots_);
+    for (auto& slot : slots_->slots) {
+      slot->store(
+          StampedPtr<Record>::pack(current_, 0), std::memory_order_release);
+    }
+  }
+
+  CoreRefCountedSharedPtr(const CoreRefCountedSharedPtr&) = delete;
+  CoreRefCountedSharedPtr& operator=(const CoreRefCountedSharedPtr&) = delete;
+
+  ~CoreRefCountedSharedPtr() {
+    std::lock_guard<std::mutex> g(mutex_);
+    install(nullptr);
+  }
+
+  void reset(std::shared_ptr<T> p = nullptr) {
+    auto record = new Record(std::move(p), slots_);
+    std::lock_guard<std::mutex> g(mutex_);
+    install(record);
+  }
+
+  Ref get() const {
+    auto index = AccessSpreader<>::current(kNumSlots);
+    auto& slot = *slots_->slots[index];
+    auto raw = slot.load(std::memory_order_acquire);
+    while (true) {
+      auto count = StampedPtr<Record>::unpackStamp(raw);
+      if (UNLIKELY(count == std::numeric_limits<uint16_t>::max())) {
+        return getSlow();
+      }
+      auto record = StampedPtr<Record>::unpackPtr(raw);
+      if (slot.compare_exchange_weak(
+              raw,
+              StampedPtr<Record>::pack(record, count + 1),
+              std::memory_order_acq_rel)) {
+        return Ref(record, uint32_t(index));
+      }
+    }
+  }
+
+ private:
+  using Slot = std::atomic<uint64_t>;
+
+  struct Slots {
+    std::array<CachelinePadded<Slot>, kNumSlots> slots;
+  };
+
+  // Refs not counted in a slot have this instead of a slot index
+  static constexpr uint32_t kSharedCount = std::numeric_limits<uint32_t>::max();
+
+  // Keeps a record's shared count from reaching zero while its Refs are
+  // still counted in the slots
+  static constexpr int64_t kBias = int64_t(1) << 62;
+
+  struct Record {
+    Record(std::shared_ptr<T> p, std::shared_ptr<Slots> s)
+        : ptr(std::move(p)), slots(std::move(s)) {}
+
+    void release(int64_t n) {
+      if (count.fetch_sub(n, std::memory_order_acq_rel) == n) {
+        delete this;
+      }
+    }
+
+    const std::shared_ptr<T> ptr;
+    const std::shared_ptr<Slots> slots;
+    std::atomic<int64_t> count{kBias};
+  };
+
+  Ref getSlow() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    current_->count.fetch_add(1, std::memory_order_relaxed);
+    return Ref(current_, kSharedCount);
+  }
+
+  // Called with mutex_ held
+  void install(Record* record) {
+    int64_t taken = 0;
+    for (auto& slot : slots_->slots) {
+      auto raw = slot->exchange(
+          StampedPtr<Record>::pack(record, 0), std::memory_order_acq_rel);
+      assert(StampedPtr<Record>::unpackPtr(raw) == current_);
+      taken += StampedPtr<Record>::unpackStamp(raw);
+    }
+    auto old = std::exchange(current_, record);
+    old->release(kBias - taken);
+  }
+
+  const std::shared_ptr<Slots> slots_;
+  mutable std::mutex mutex_;
+  Record* current_; // guarded by mutex_
+};
+
 } // namespace folly
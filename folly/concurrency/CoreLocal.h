@@ -0,0 +1,262 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Per-CPU sharding.  Unlike ThreadLocal-based structures, whose memory,
+ * read cost and teardown grow with the number of threads that ever
+ * touched them, these have a fixed number of slots, and threads use the
+ * slot of the CPU they run on (through AccessSpreader, which reads the
+ * CPU number from the thread's rseq area when the kernel and glibc
+ * provide one).
+ *
+ * A thread can be preempted or migrate right after picking its slot, so
+ * two threads may occasionally use the same slot at once: slots must be
+ * updated with atomics or under a lock, which then are almost never
+ * contended.
+ *
+ *   CoreLocalCounter<int64_t> requests;
+ *   ++requests;                       // hot path
+ *   int64_t total = requests.readFull();  // sums kNumSlots slots
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include <folly/CachelinePadded.h>
+#include <folly/SpinLock.h>
+#include <folly/concurrency/CacheLocality.h>
+
+namespace folly {
+
+/**
+ * kNumSlots instances of T, each on its own cache lines.  local()
+ * returns the one for the current CPU; with at least as many slots as
+ * CPUs, each CPU has its own.
+ */
+template <typename T, size_t kNumSlots = 64>
+class CoreLocal {
+  static_assert(kNumSlots > 0, "kNumSlots must be positive");
+
+ public:
+  CoreLocal() = default;
+
+  CoreLocal(const CoreLocal&) = delete;
+  CoreLocal& operator=(const CoreLocal&) = delete;
+
+  T& local() {
+    return *slots_[AccessSpreader<>::current(kNumSlots)];
+  }
+
+  const T& local() const {
+    return *slots_[AccessSpreader<>::current(kNumSlots)];
+  }
+
+  T& operator[](size_t i) {
+    return *slots_[i];
+  }
+
+  const T& operator[](size_t i) const {
+    return *slots_[i];
+  }
+
+  static constexpr size_t size() {
+    return kNumSlots;
+  }
+
+  /* Calls f on every slot, e.g. to aggregate them */
+  template <typename F>
+  void forEach(F&& f) {
+    for (auto& slot : slots_) {
+      f(*slot);
+    }
+  }
+
+  template <typename F>
+  void forEach(F&& f) const {
+    for (auto& slot : slots_) {
+      f(*slot);
+    }
+  }
+
+ private:
+  std::array<CachelinePadded<T>, kNumSlots> slots_;
+};
+
+/**
+ * A counter sharded by CPU, a replacement for ThreadCachedInt when there
+ * are many more threads than cores.  increment() is a relaxed atomic add
+ * to the current CPU's slot; reads sum all slots, so their cost does not
+ * depend on how many threads there are.  All reads are exact with respect
+ * to increments that happen before them.
+ */
+template <typename IntT, size_t kNumSlots = 64>
+class CoreLocalCounter {
+ public:
+  explicit CoreLocalCounter(IntT initialVal = 0) {
+    set(initialVal);
+  }
+
+  CoreLocalCounter(const CoreLocalCounter&) = delete;
+  CoreLocalCounter& operator=(const CoreLocalCounter&) = delete;
+
+  void increment(IntT inc) {
+    counts_.local().fetch_add(inc, std::memory_order_relaxed);
+  }
+
+  IntT readFull() const {
+    IntT sum = 0;
+    counts_.forEach([&](const std::atomic<IntT>& count) {
+      sum += count.load(std::memory_order_relaxed);
+    });
+    return sum;
+  }
+
+  // There is no cache to flush, so both reads are the same
+  IntT readFast() const {
+    return readFull();
+  }
+
+  /* Increments that race with the reset go either to the result or to the
+   * new count, never to both or neither */
+  IntT readFullAndReset() {
+    IntT sum = 0;
+    counts_.forEach([&](std::atomic<IntT>& count) {
+      sum += count.exchange(0, std::memory_order_relaxed);
+    });
+    return sum;
+  }
+
+  IntT readFastAndReset() {
+    return readFullAndReset();
+  }
+
+  /* Not atomic with respect to concurrent increments */
+  void set(IntT newVal) {
+    counts_.forEach([](std::atomic<IntT>& count) {
+      count.store(0, std::memory_order_relaxed);
+    });
+    counts_[0].store(newVal, std::memory_order_relaxed);
+  }
+
+  CoreLocalCounter& operator+=(IntT inc) {
+    increment(inc);
+    return *this;
+  }
+  CoreLocalCounter& operator-=(IntT inc) {
+    increment(-inc);
+    return *this;
+  }
+  CoreLocalCounter& operator++() {
+    increment(1);
+    return *this;
+  }
+  CoreLocalCounter& operator--() {
+    increment(-1);
+    return *this;
+  }
+
+ private:
+  CoreLocal<std::atomic<IntT>, kNumSlots> counts_;
+};
+
+/**
+ * A cache of free T objects sharded by CPU, to put in front of an
+ * allocator or object pool.  Each slot holds up to kSlotCapacity
+ * objects under its own spin lock.  push() returns false when the
+ * current CPU's slot is full, and pop() looks at the other slots only
+ * when the current one is empty.  Objects left at destruction are
+ * released with Deleter.
+ */
+template <
+    typename T,
+    typename Deleter = std::default_delete<T>,
+    size_t kSlotCapacity = 64,
+    size_t kNumSlots = 64>
+class CoreLocalFreeList {
+ public:
+  CoreLocalFreeList() = default;
+
+  ~CoreLocalFreeList() {
+    Deleter deleter;
+    slots_.forEach([&](Slot& slot) {
+      for (size_t i = 0; i < slot.count.load(std::memory_order_relaxed); ++i) {
+        deleter(slot.items[i]);
+      }
+    });
+  }
+
+  CoreLocalFreeList(const CoreLocalFreeList&) = delete;
+  CoreLocalFreeList& operator=(const CoreLocalFreeList&) = delete;
+
+  /* Adds p to the current CPU's slot, unless that is full */
+  bool push(T* p) {
+    auto& slot = slots_.local();
+    std::lock_guard<SpinLock> g(slot.lock);
+    auto count = slot.count.load(std::memory_order_relaxed);
+    if (count == kSlotCapacity) {
+      return false;
+    }
+    slot.items[count] = p;
+    slot.count.store(count + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /* Takes an object, preferably from the current CPU's slot, or returns
+   * nullptr if there are none */
+  T* pop() {
+    size_t start = AccessSpreader<>::current(kNumSlots);
+    for (size_t i = 0; i < kNumSlots; ++i) {
+      auto& slot = slots_[(start + i) % kNumSlots];
+      // Racy peek, so that empty slots are skipped without locking
+      if (slot.count.load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      std::lock_guard<SpinLock> g(slot.lock);
+      auto count = slot.count.load(std::memory_order_relaxed);
+      if (count > 0) {
+        slot.count.store(count - 1, std::memory_order_relaxed);
+        return slot.items[count - 1];
+      }
+    }
+    return nullptr;
+  }
+
+  /* Approximate while other threads push and pop */
+  size_t size() const {
+    size_t sum = 0;
+    slots_.forEach([&](const Slot& slot) {
+      sum += slot.count.load(std::memory_order_relaxed);
+    });
+    return sum;
+  }
+
+ private:
+  struct Slot {
+    SpinLock lock;
+    std::atomic<size_t> count{0};
+    std::array<T*, kSlotCapacity> items;
+  };
+
+  CoreLocal<Slot, kNumSlots> slots_;
+};
+
+} // namespace folly
@@ -0,0 +1,455 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#include <folly/Likely.h>
+#include <folly/ThreadLocal.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/detail/Futex.h>
+
+namespace folly {
+
+/** Every element weighs 1, so the capacity is an element count */
+template <typename T>
+struct DefaultWeightFn {
+  uint64_t operator()(const T&) const noexcept {
+    return 1;
+  }
+};
+
+/**
+ * DynamicBoundedQueue is an UnboundedQueue with a bound on the total weight
+ * of its elements, rather than on their number.  The bound can be changed
+ * at any time with reset_capacity(), nothing is allocated up front.
+ *
+ * Template parameters are those of UnboundedQueue, plus:
+ * - WeightFn: function object returning the uint64_t weight of an element,
+ *   e.g. its size in bytes.  It must return the same weight for an element
+ *   when it is enqueued and when it is dequeued.  The default is 1.
+ *
+ * Producers take credit for the weight of their elements from the shared
+ * capacity and consumers give it back.  To keep producers off the shared
+ * counter, each producer thread takes a batch of credit at a time (1/64 of
+ * the capacity), which its later enqueues use up first.  A producer that
+ * can't get enough credit collects what other threads have cached before
+ * it fails or waits.  So the total weight in the queue never exceeds the
+ * capacity, and credit cached by idle threads doesn't make enqueues fail.
+ * Shrinking the capacity below the current weight is allowed; producers
+ * then fail until consumers bring the weight under the new capacity.  An
+ * element that weighs more than the capacity can never be enqueued.
+ *
+ * Producers can wait for credit in enqueue() and try_enqueue_until/for().
+ * If MayBlock they (and consumers, as in UnboundedQueue) sleep on a futex,
+ * otherwise they spin and yield.
+ *
+ * Aliases: DSPSCQueue, DMPSCQueue, DSPMCQueue and DMPMCQueue, templated on
+ * <T, MayBlock, LgSegmentSize = 8, WeightFn = DefaultWeightFn<T>>.
+ *
+ * Usage:
+ *   struct BufWeight {
+ *     uint64_t operator()(const std::unique_ptr<IOBuf>& b) const noexcept {
+ *       return b->computeChainDataLength();
+ *     }
+ *   };
+ *   DMPMCQueue<std::unique_ptr<IOBuf>, true, 8, BufWeight> q(1 << 20);
+ *   if (!q.try_enqueue(std::move(buf))) { ... push back ... }
+ *   q.reset_capacity(1 << 22);
+ */
+template <
+    typename T,
+    bool SingleProducer,
+    bool SingleConsumer,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    typename WeightFn = DefaultWeightFn<T>,
+    template <typename> class Atom = std::atomic>
+class DynamicBoundedQueue {
+  using Weight = uint64_t;
+  struct Credit;
+  struct CreditTag {};
+
+  // Producers take capacity >> kLgCreditBatch credit at a time
+  static constexpr size_t kLgCreditBatch = 6;
+
+ public:
+  explicit DynamicBoundedQueue(Weight capacity, WeightFn weightFn = WeightFn())
+      : weightFn_(std::move(weightFn)),
+        capacity_(capacity),
+        available_(int64_t(capacity)) {}
+
+  DynamicBoundedQueue(const DynamicBoundedQueue&) = delete;
+  DynamicBoundedQueue& operator=(const DynamicBoundedQueue&) = delete;
+
+  /** Wait until there is room for v, and enqueue it */
+  void enqueue(const T& v) {
+    enqueueImpl(v, std::chrono::steady_clock::time_point::max());
+  }
+
+  void enqueue(T&& v) {
+    enqueueImpl(std::move(v), std::chrono::steady_clock::time_point::max());
+  }
+
+  /** Enqueue v if there is room for it, without waiting */
+  bool try_enqueue(const T& v) {
+    return tryEnqueueImpl(v);
+  }
+
+  bool try_enqueue(T&& v) {
+    return tryEnqueueImpl(std::move(v));
+  }
+
+  template <typename Clock, typename Duration>
+  bool try_enqueue_until(
+      const T& v,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    return enqueueImpl(v, deadline);
+  }
+
+  template <typename Clock, typename Duration>
+  bool try_enqueue_until(
+      T&& v,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    return enqueueImpl(std::move(v), deadline);
+  }
+
+  template <typename Rep, typename Period>
+  bool try_enqueue_for(
+      const T& v,
+      const std::chrono::duration<Rep, Period>& duration) {
+    return tryEnqueueImpl(v) ||
+        enqueueImpl(v, std::chrono::steady_clock::now() + duration);
+  }
+
+  template <typename Rep, typename Period>
+  bool try_enqueue_for(
+      T&& v,
+      const std::chrono::duration<Rep, Period>& duration) {
+    // v is only moved from if it's enqueued
+    return tryEnqueueImpl(std::move(v)) ||
+        enqueueImpl(std::move(v), std::chrono::steady_clock::now() + duration);
+  }
+
+  /** Wait until there is an element, and dequeue it */
+  void dequeue(T& item) {
+    q_.dequeue(item);
+    returnCredit(weightFn_(item));
+  }
+
+  T dequeue() {
+    T item = q_.dequeue();
+    returnCredit(weightFn_(item));
+    return item;
+  }
+
+  bool try_dequeue(T& item) {
+    if (!q_.try_dequeue(item)) {
+      return false;
+    }
+    returnCredit(weightFn_(item));
+    return true;
+  }
+
+  template <typename Clock, typename Duration>
+  bool try_dequeue_until(
+      T& item,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    if (!q_.try_dequeue_until(item, deadline)) {
+      return false;
+    }
+    returnCredit(weightFn_(item));
+    return true;
+  }
+
+  template <typename Rep, typename Period>
+  bool try_dequeue_for(
+      T& item,
+      const std::chrono::duration<Rep, Period>& duration) {
+    if (!q_.try_dequeue_for(item, duration)) {
+      return false;
+    }
+    returnCredit(weightFn_(item));
+    return true;
+  }
+
+  /**
+   * Change the bound on the total weight.  Elements already in the queue
+   * stay there even if they now weigh more than the capacity.
+   */
+  void reset_capacity(Weight capacity) {
+    auto old = capacity_.exchange(capacity, std::memory_order_acq_rel);
+    if (capacity > old) {
+      returnCredit(capacity - old);
+    } else if (capacity < old) {
+      available_.fetch_sub(int64_t(old - capacity), std::memory_order_acq_rel);
+      // Don't let producers keep enqueuing from what they have cached
+      collectCachedCredit();
+    }
+  }
+
+  Weight capacity() const noexcept {
+    return capacity_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Total weight of the elements, a snapshot if other threads are active.
+   * Includes the credit cached by producer threads, so it's an upper bound.
+   */
+  Weight weight() const noexcept {
+    auto c = int64_t(capacity());
+    auto a = available_.load(std::memory_order_acquire);
+    return c > a ? Weight(c - a) : 0;
+  }
+
+  size_t size() const noexcept {
+    return q_.size();
+  }
+
+  bool empty() const noexcept {
+    return q_.empty();
+  }
+
+ private:
+  // Credit cached by one producer thread, given back when the thread exits
+  struct Credit {
+    explicit Credit(DynamicBoundedQueue& parent) : parent_(&parent) {}
+
+    ~Credit() {
+      auto c = amount.exchange(0, std::memory_order_acq_rel);
+      if (c > 0) {
+        parent_->returnCredit(c);
+      }
+    }
+
+    DynamicBoundedQueue* parent_;
+    // Only taken from by its thread, but collected by any
+    Atom<Weight> amount{0};
+  };
+
+  template <typename Arg>
+  bool tryEnqueueImpl(Arg&& v) {
+    if (!tryReserve(weightFn_(v))) {
+      return false;
+    }
+    q_.enqueue(std::forward<Arg>(v));
+    return true;
+  }
+
+  template <typename Arg, typename Clock, typename Duration>
+  bool enqueueImpl(
+      Arg&& v,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    auto w = weightFn_(v);
+    if (!tryReserve(w) && !waitForCredit(w, deadline)) {
+      return false;
+    }
+    q_.enqueue(std::forward<Arg>(v));
+    return true;
+  }
+
+  Credit* getCredit() {
+    auto credit = credits_.get();
+    if (UNLIKELY(credit == nullptr)) {
+      credit = new Credit(*this);
+      credits_.reset(credit);
+    }
+    return credit;
+  }
+
+  bool tryReserve(Weight w) {
+    auto credit = getCredit();
+    auto c = credit->amount.load(std::memory_order_relaxed);
+    while (c >= w) {
+      if (credit->amount.compare_exchange_weak(
+              c, c - w, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return reserveSlow(credit, w);
+  }
+
+  bool reserveSlow(Credit* credit, Weight w) {
+    auto batch = capacity_.load(std::memory_order_relaxed) >> kLgCreditBatch;
+    if (tryTakeShared(credit, w, batch)) {
+      return true;
+    }
+    // The rest may be cached by other threads, including ones that haven't
+    // enqueued for a while
+    collectCachedCredit();
+    return tryTakeShared(credit, w, 0);
+  }
+
+  // Take w, and cache up to batch more, from the shared credit
+  bool tryTakeShared(Credit* credit, Weight w, Weight batch) {
+    auto a = available_.load(std::memory_order_acquire);
+    while (a >= 0 && Weight(a) >= w) {
+      auto take = std::min(Weight(a), w + batch);
+      if (available_.compare_exchange_weak(
+              a,
+              a - int64_t(take),
+              std::memory_order_acq_rel,
+              std::memory_order_acquire)) {
+        if (take > w) {
+          credit->amount.fetch_add(take - w, std::memory_order_acq_rel);
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void collectCachedCredit() {
+    Weight collected = 0;
+    for (auto& credit : credits_.accessAllThreads()) {
+      collected += credit.amount.exchange(0, std::memory_order_acq_rel);
+    }
+    if (collected > 0) {
+      available_.fetch_add(int64_t(collected), std::memory_order_acq_rel);
+    }
+  }
+
+  void returnCredit(Weight w) {
+    available_.fetch_add(int64_t(w), std::memory_order_acq_rel);
+    if (MayBlock) {
+      // Pairs with the fence in waitForCredit(): either we see the waiter,
+      // or it sees the credit
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (waiters_.load(std::memory_order_relaxed) > 0) {
+        wakeups_.fetch_add(1, std::memory_order_acq_rel);
+        wakeups_.futexWake(INT_MAX);
+      }
+    }
+  }
+
+  template <typename Clock, typename Duration>
+  bool waitForCredit(
+      Weight w,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    const bool untimed =
+        deadline == std::chrono::time_point<Clock, Duration>::max();
+    while (true) {
+      if (!MayBlock) {
+        if (!untimed && Clock::now() >= deadline) {
+          return false;
+        }
+        std::this_thread::yield();
+        if (tryReserve(w)) {
+          return true;
+        }
+        continue;
+      }
+      auto wakeups = wakeups_.load(std::memory_order_acquire);
+      waiters_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (tryReserve(w)) {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+      auto timedOut = false;
+      if (untimed) {
+        wakeups_.futexWait(wakeups);
+      } else {
+        timedOut = wakeups_.futexWaitUntil(wakeups, deadline) ==
+            detail::FutexResult::TIMEDOUT;
+      }
+      waiters_.fetch_sub(1, std::memory_order_relaxed);
+      if (timedOut) {
+        return tryReserve(w);
+      }
+    }
+  }
+
+  UnboundedQueue<T, SingleProducer, SingleConsumer, MayBlock, LgSegmentSize, Atom>
+      q_;
+  WeightFn weightFn_;
+  Atom<Weight> capacity_;
+  // Capacity not in the queue nor cached by producers, negative after the
+  // capacity shrank below the weight of the queue
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING Atom<int64_t> available_;
+  Atom<uint32_t> waiters_{0};
+  detail::Futex<Atom> wakeups_{0};
+  ThreadLocalPtr<Credit, CreditTag, AccessModeStrict>
+      credits_; // Must be last for dtor ordering
+};
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    typename WeightFn = DefaultWeightFn<T>,
+    template <typename> class Atom = std::atomic>
+using DSPSCQueue = DynamicBoundedQueue<
+    T,
+    true,
+    true,
+    MayBlock,
+    LgSegmentSize,
+    WeightFn,
+    Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    typename WeightFn = DefaultWeightFn<T>,
+    template <typename> class Atom = std::atomic>
+using DMPSCQueue = DynamicBoundedQueue<
+    T,
+    false,
+    true,
+    MayBlock,
+    LgSegmentSize,
+    WeightFn,
+    Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    typename WeightFn = DefaultWeightFn<T>,
+    template <typename> class Atom = std::atomic>
+using DSPMCQueue = DynamicBoundedQueue<
+    T,
+    true,
+    false,
+    MayBlock,
+    LgSegmentSize,
+    WeightFn,
+    Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    typename WeightFn = DefaultWeightFn<T>,
+    template <typename> class Atom = std::atomic>
+using DMPMCQueue = DynamicBoundedQueue<
+    T,
+    false,
+    false,
+    MayBlock,
+    LgSegmentSize,
+    WeightFn,
+    Atom>;
+
+} // namespace folly
@@ -0,0 +1,690 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/Random.h>
+#include <folly/experimental/hazptr/hazptr.h>
+#include <folly/memory/Malloc.h>
+#include <folly/small_vector.h>
+
+namespace folly {
+
+/**
+ * A sorted set of unique elements, like std::set, that any number of
+ * threads may read and write concurrently without locks.
+ *
+ * It is a skip list whose levels are singly linked lists updated with
+ * CAS (Herlihy and Shavit, "The Art of Multiprocessor Programming",
+ * ch. 14).  An erased node is first marked, by setting the low bit of
+ * each of its next pointers, and then unlinked by whichever thread
+ * passes it next.  Unlinked nodes are reclaimed with hazard pointers,
+ * so unlike ConcurrentSkipList there is no Accessor: memory held by
+ * erased elements is bounded no matter how long readers run, and each
+ * iterator pins only the element it points to.
+ *
+ *   LockFreeSkipList<int64_t> index;
+ *   index.insert(42);
+ *   index.insertSorted(run.begin(), run.end());
+ *   for (auto it = index.lower_bound(lo); it != index.end() && *it < hi;
+ *        ++it) {
+ *     ...
+ *   }
+ *   index.erase(42);
+ *
+ * Differences from std::set:
+ *
+ * * Elements can only be accessed through iterators, which hold a hazard
+ *   pointer to their element.  Iterators are costlier to copy than to
+ *   move.
+ *
+ * * Iterators are bidirectional, but operator-- searches from the head
+ *   again (O(log n)), since the levels are singly linked.  Incrementing
+ *   an iterator whose element was erased continues from the next larger
+ *   element still in the list.
+ *
+ * * insertSorted() inserts a run of elements, reusing the position of
+ *   each one as the starting point for the next.  It is much faster than
+ *   inserting them one by one when the run is sorted, and still correct
+ *   when it is not.
+ *
+ * * size() is approximate while writers are active.
+ *
+ * * The destructor must not run concurrently with any other operation,
+ *   and no iterators may outlive the list.
+ *
+ * MaxHeight bounds the number of levels; each one holds about half the
+ * elements of the level below, so the default suits up to 2^24 elements.
+ */
+template <typename T, typename Comp = std::less<T>, int MaxHeight = 24>
+class LockFreeSkipList {
+  static_assert(
+      MaxHeight > 1 && MaxHeight <= 32,
+      "MaxHeight must be between 2 and 32");
+
+  class Node;
+
+  struct NodeDeleter {
+    void operator()(Node* node) const {
+      Node::destroy(node);
+    }
+  };
+
+  class Node : public hazptr::hazptr_obj_base<Node, NodeDeleter> {
+   public:
+    template <typename... Args>
+    static Node* create(int height, Args&&... args) {
+      size_t size = sizeof(Node) + height * sizeof(std::atomic<Node*>);
+      void* storage = checkedMalloc(size);
+      try {
+        return new (storage) Node(height, std::forward<Args>(args)...);
+      } catch (...) {
+        free(storage);
+        throw;
+      }
+    }
+
+    static void destroy(Node* node) {
+      node->~Node();
+      free(node);
+    }
+
+    const T& data() const {
+      return data_;
+    }
+
+    int height() const {
+      return height_;
+    }
+
+    std::atomic<Node*>& next(int level) {
+      DCHECK_LT(level, height_);
+      return next_[level];
+    }
+
+    // Nodes count the levels they are linked into, plus one while their
+    // inserter is still linking them.  The last one out retires the node.
+    void setLinks(uint32_t links) {
+      links_.store(links, std::memory_order_relaxed);
+    }
+
+    void addLink() {
+      links_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool dropLink() {
+      return links_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+   private:
+    template <typename... Args>
+    explicit Node(int height, Args&&... args)
+        : data_(std::forward<Args>(args)...), height_(uint8_t(height)) {
+      for (int i = 0; i < height; ++i) {
+        new (&next_[i]) std::atomic<Node*>(nullptr);
+      }
+    }
+
+    ~Node() = default;
+
+    T data_;
+    std::atomic<uint32_t> links_{0};
+    uint8_t height_;
+    std::atomic<Node*> next_[0];
+  };
+
+ public:
+  class Iterator;
+
+  typedef T value_type;
+  typedef T key_type;
+  typedef Comp key_compare;
+  typedef size_t size_type;
+  typedef Iterator iterator;
+  typedef Iterator const_iterator;
+
+  explicit LockFreeSkipList(const Comp& comp = Comp()) : less_(comp) {
+    for (auto& head : head_) {
+      head.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~LockFreeSkipList() {
+    // Free the nodes still linked anywhere; those already unlinked
+    // everywhere have been retired to cohort_.
+    for (int i = MaxHeight - 1; i >= 0; --i) {
+      Node* node = unmarked(head_[i].load(std::memory_order_relaxed));
+      while (node) {
+        Node* next = unmarked(node->next(i).load(std::memory_order_relaxed));
+        if (node->dropLink()) {
+          Node::destroy(node);
+        }
+        node = next;
+      }
+    }
+  }
+
+  LockFreeSkipList(const LockFreeSkipList&) = delete;
+  LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+  /**
+   * Inserts data unless an equivalent element is present.  Returns an
+   * iterator to the element in the list, and whether it is the new one.
+   */
+  std::pair<Iterator, bool> insert(const T& data) {
+    return emplace(data);
+  }
+
+  std::pair<Iterator, bool> insert(T&& data) {
+    return emplace(std::move(data));
+  }
+
+  template <typename... Args>
+  std::pair<Iterator, bool> emplace(Args&&... args) {
+    Node* node = Node::create(randomHeight(), std::forward<Args>(args)...);
+    int height = node->height();
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    // One holder per level for preds, then one per level for succs
+    small_vector<hazptr::hazptr_holder, 4> hazptrs(2 * height);
+    Iterator result;
+    bool inserted = insertNode(
+        node,
+        preds,
+        succs,
+        hazptrs.data(),
+        hazptrs.data() + height,
+        height,
+        nullptr,
+        &result);
+    return std::make_pair(std::move(result), inserted);
+  }
+
+  /**
+   * Inserts the elements of [first, last) that are not already present,
+   * and returns how many were inserted.  Each insertion starts searching
+   * from the position of the previous one, so sorted runs take amortized
+   * constant time per element instead of O(log n).
+   */
+  template <typename InputIt>
+  size_t insertSorted(InputIt first, InputIt last) {
+    Node* preds[MaxHeight] = {};
+    Node* succs[MaxHeight];
+    // preds, succs, and the three a search walks with
+    std::vector<hazptr::hazptr_holder> hazptrs(2 * MaxHeight + 3);
+    size_t count = 0;
+    for (; first != last; ++first) {
+      if (insertNode(
+              Node::create(randomHeight(), *first),
+              preds,
+              succs,
+              hazptrs.data(),
+              hazptrs.data() + MaxHeight,
+              MaxHeight,
+              hazptrs.data() + 2 * MaxHeight,
+              nullptr)) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  /**
+   * Erases the element equivalent to key, if any.  Returns the number of
+   * elements erased.
+   */
+  size_t erase(const T& key) {
+    auto before = [&](Node* node) { return less_(node->data(), key); };
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    hazptr::hazptr_holder hazptr;
+    search(before, preds, succs, nullptr, &hazptr, 1);
+    Node* node = succs[0];
+    if (!node || less_(key, node->data())) {
+      return 0;
+    }
+    // Mark the upper levels first, so that inserters stop linking the
+    // node; marking level 0 decides which eraser wins.
+    for (int i = node->height() - 1; i > 0; --i) {
+      Node* next = node->next(i).load(std::memory_order_acquire);
+      while (!isMarked(next) &&
+             !node->next(i).compare_exchange_weak(next, marked(next))) {
+      }
+    }
+    Node* next = node->next(0).load(std::memory_order_acquire);
+    do {
+      if (isMarked(next)) {
+        return 0;
+      }
+    } while (!node->next(0).compare_exchange_weak(next, marked(next)));
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    // Pairs with the fence in insertNode: either it sees the mark, or
+    // this search sees every level it linked.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    search(before, preds, succs, nullptr, nullptr, 0);
+    return 1;
+  }
+
+  Iterator find(const T& key) const {
+    auto it = lower_bound(key);
+    if (it.node_ && less_(key, it.node_->data())) {
+      return end();
+    }
+    return it;
+  }
+
+  bool contains(const T& key) const {
+    return find(key) != end();
+  }
+
+  size_t count(const T& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  /* First element not less than key */
+  Iterator lower_bound(const T& key) const {
+    return locate([&](Node* node) { return less_(node->data(), key); });
+  }
+
+  /* First element greater than key */
+  Iterator upper_bound(const T& key) const {
+    return locate([&](Node* node) { return !less_(key, node->data()); });
+  }
+
+  Iterator begin() const {
+    return locate([](Node*) { return false; });
+  }
+
+  Iterator end() const {
+    return Iterator(self(), nullptr, hazptr::hazptr_holder(nullptr));
+  }
+
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  class Iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    Iterator() : list_(nullptr), node_(nullptr), hazptr_(nullptr) {}
+
+    Iterator(const Iterator& other)
+        : list_(other.list_), node_(other.node_), hazptr_(nullptr) {
+      if (node_) {
+        // other's hazard pointer keeps node_ alive while we take ours
+        hazptr_ = hazptr::hazptr_holder();
+        hazptr_.reset(node_);
+      }
+    }
+
+    Iterator(Iterator&& other) noexcept
+        : list_(other.list_),
+          node_(other.node_),
+          hazptr_(std::move(other.hazptr_)) {
+      other.node_ = nullptr;
+    }
+
+    Iterator& operator=(const Iterator& other) {
+      Iterator copy(other);
+      return *this = std::move(copy);
+    }
+
+    Iterator& operator=(Iterator&& other) noexcept {
+      list_ = other.list_;
+      node_ = other.node_;
+      hazptr_ = std::move(other.hazptr_);
+      other.node_ = nullptr;
+      return *this;
+    }
+
+    const T& operator*() const {
+      DCHECK(node_);
+      return node_->data();
+    }
+
+    const T* operator->() const {
+      return &**this;
+    }
+
+    Iterator& operator++() {
+      DCHECK(node_);
+      Node* next = node_->next(0).load(std::memory_order_acquire);
+      if (!isMarked(next)) {
+        hazptr::hazptr_holder hazptr;
+        while (!hazptr.try_protect(next, node_->next(0), &unmarked)) {
+        }
+        // Unmarked, so node_ was still linked, and so was next
+        if (!isMarked(next)) {
+          node_ = next;
+          hazptr_.swap(hazptr);
+          return *this;
+        }
+      }
+      // node_ was erased, so next may have been too
+      *this = list_->upper_bound(node_->data());
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator copy(*this);
+      ++*this;
+      return copy;
+    }
+
+    /* Decrementing begin() is undefined, as for std::set */
+    Iterator& operator--() {
+      DCHECK(list_);
+      Node* preds[MaxHeight];
+      Node* succs[MaxHeight];
+      hazptr::hazptr_holder hazptr;
+      if (node_) {
+        const T& key = node_->data();
+        list_->search(
+            [&](Node* node) { return list_->less_(node->data(), key); },
+            preds,
+            succs,
+            &hazptr,
+            nullptr,
+            1);
+      } else {
+        list_->search(
+            [](Node*) { return true; }, preds, succs, &hazptr, nullptr, 1);
+      }
+      DCHECK(preds[0]) << "decrementing begin()";
+      node_ = preds[0];
+      hazptr_.swap(hazptr);
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator copy(*this);
+      --*this;
+      return copy;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return node_ == other.node_;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class LockFreeSkipList;
+
+    Iterator(LockFreeSkipList* list, Node* node, hazptr::hazptr_holder&& hp)
+        : list_(list), node_(node), hazptr_(std::move(hp)) {}
+
+    LockFreeSkipList* list_;
+    Node* node_;
+    hazptr::hazptr_holder hazptr_;
+  };
+
+ private:
+  static bool isMarked(Node* node) {
+    return reinterpret_cast<uintptr_t>(node) & 1;
+  }
+
+  static Node* marked(Node* node) {
+    return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(node) | 1);
+  }
+
+  static Node* unmarked(Node* node) {
+    return reinterpret_cast<Node*>(
+        reinterpret_cast<uintptr_t>(node) & ~uintptr_t(1));
+  }
+
+  static int randomHeight() {
+    uint32_t bits = Random::rand32() | (uint32_t(1) << (MaxHeight - 1));
+    return findFirstSet(bits);
+  }
+
+  LockFreeSkipList* self() const {
+    return const_cast<LockFreeSkipList*>(this);
+  }
+
+  // The head of the list acts as the predecessor nullptr
+  std::atomic<Node*>& nextOf(Node* pred, int level) {
+    return pred ? pred->next(level) : head_[level];
+  }
+
+  template <typename Before>
+  Iterator locate(Before before) const {
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    hazptr::hazptr_holder hazptr;
+    self()->search(before, preds, succs, nullptr, &hazptr, 1);
+    return Iterator(self(), succs[0], std::move(hazptr));
+  }
+
+  /**
+   * Finds, at each level i, the last node preds[i] for which before()
+   * holds (nullptr for the head) and the node succs[i] after it,
+   * unlinking erased nodes on the way.  For levels below protect,
+   * preds[i] and succs[i] are left protected by hpPreds[i] and
+   * hpSuccs[i], either of which may be null.
+   *
+   * Bulk insertion passes finger, three holders for the search to walk
+   * with: then the search at levels below protect may start from
+   * preds[i] as left by the previous search with the same holders.
+   */
+  template <typename Before>
+  void search(
+      Before before,
+      Node** preds,
+      Node** succs,
+      hazptr::hazptr_holder* hpPreds,
+      hazptr::hazptr_holder* hpSuccs,
+      int protect,
+      hazptr::hazptr_holder* finger = nullptr) {
+    if (finger) {
+      while (!trySearch(
+          before, preds, succs, hpPreds, hpSuccs, protect, finger, true)) {
+      }
+      return;
+    }
+    hazptr::hazptr_array<3> hazptrs;
+    while (!trySearch(
+        before, preds, succs, hpPreds, hpSuccs, protect, &hazptrs[0], false)) {
+    }
+  }
+
+  template <typename Before>
+  bool trySearch(
+      Before before,
+      Node** preds,
+      Node** succs,
+      hazptr::hazptr_holder* hpPreds,
+      hazptr::hazptr_holder* hpSuccs,
+      int protect,
+      hazptr::hazptr_holder* hazptrs, // pred, curr, succ
+      bool finger) {
+    Node* pred = nullptr;
+    for (int i = MaxHeight - 1; i >= 0; --i) {
+      if (finger && i < protect) {
+        // Still linked at this level, since it is unmarked
+        Node* start = preds[i];
+        if (start && (!pred || less_(pred->data(), start->data())) &&
+            before(start) &&
+            !isMarked(start->next(i).load(std::memory_order_acquire))) {
+          hazptrs[0].reset(start);
+          pred = start;
+        }
+      }
+      std::atomic<Node*>* link = &nextOf(pred, i);
+      Node* curr = link->load(std::memory_order_acquire);
+      while (true) {
+        if (!hazptrs[1].try_protect(curr, *link, &unmarked)) {
+          continue;
+        }
+        if (isMarked(curr)) {
+          return false; // pred was erased
+        }
+        if (!curr) {
+          break;
+        }
+        Node* succ = curr->next(i).load(std::memory_order_acquire);
+        while (!hazptrs[2].try_protect(succ, curr->next(i), &unmarked)) {
+        }
+        if (isMarked(succ)) {
+          // curr was erased.  succ may only be used if curr was still
+          // linked, which the CAS establishes.
+          succ = unmarked(succ);
+          Node* expected = curr;
+          if (!link->compare_exchange_strong(expected, succ)) {
+            return false;
+          }
+          if (curr->dropLink()) {
+            curr->retire(cohort_, NodeDeleter());
+          }
+          curr = succ;
+          continue;
+        }
+        if (!before(curr)) {
+          break;
+        }
+        pred = curr;
+        hazptrs[0].swap(hazptrs[1]);
+        link = &curr->next(i);
+        curr = succ;
+        hazptrs[1].swap(hazptrs[2]);
+      }
+      preds[i] = pred;
+      succs[i] = curr;
+      if (i < protect) {
+        if (hpPreds) {
+          hpPreds[i].reset(pred);
+        }
+        if (hpSuccs) {
+          hpSuccs[i].reset(curr);
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Links node into the list unless an equivalent element is present,
+   * in which case node is destroyed.  If result is not null, it is set
+   * to the element in the list.  The holders must cover protect >= height
+   * levels; with finger, preds is the previous search's result.
+   */
+  bool insertNode(
+      Node* node,
+      Node** preds,
+      Node** succs,
+      hazptr::hazptr_holder* hpPreds,
+      hazptr::hazptr_holder* hpSuccs,
+      int protect,
+      hazptr::hazptr_holder* finger,
+      Iterator* result) {
+    const T& key = node->data();
+    auto before = [&](Node* n) { return less_(n->data(), key); };
+    int height = node->height();
+    DCHECK_LE(height, protect);
+    while (true) {
+      search(before, preds, succs, hpPreds, hpSuccs, protect, finger);
+      Node* found = succs[0];
+      if (found && !less_(key, found->data())) {
+        Node::destroy(node);
+        if (result) {
+          hazptr::hazptr_holder hazptr;
+          hazptr.reset(found);
+          *result = Iterator(this, found, std::move(hazptr));
+        }
+        return false;
+      }
+      for (int i = 0; i < height; ++i) {
+        node->next(i).store(succs[i], std::memory_order_relaxed);
+      }
+      node->setLinks(2);
+      Node* expected = succs[0];
+      if (nextOf(preds[0], 0).compare_exchange_strong(expected, node)) {
+        break;
+      }
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    if (result) {
+      hazptr::hazptr_holder hazptr;
+      hazptr.reset(node);
+      *result = Iterator(this, node, std::move(hazptr));
+    }
+
+    for (int i = 1; i < height; ++i) {
+      while (true) {
+        Node* next = node->next(i).load(std::memory_order_acquire);
+        if (isMarked(next) ||
+            (next != succs[i] &&
+             !node->next(i).compare_exchange_strong(next, succs[i]))) {
+          // Erased already: stop building it up
+          i = height;
+          break;
+        }
+        node->addLink();
+        Node* expected = succs[i];
+        if (nextOf(preds[i], i).compare_exchange_strong(expected, node)) {
+          break;
+        }
+        node->dropLink();
+        search(before, preds, succs, hpPreds, hpSuccs, protect, finger);
+      }
+    }
+    // Pairs with the fence in erase(): if node was erased while we were
+    // linking it, one of us unlinks the levels we added.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (isMarked(node->next(0).load(std::memory_order_relaxed))) {
+      Node* cleanPreds[MaxHeight];
+      Node* cleanSuccs[MaxHeight];
+      search(before, cleanPreds, cleanSuccs, nullptr, nullptr, 0);
+    }
+    if (node->dropLink()) {
+      node->retire(cohort_, NodeDeleter());
+    }
+    return true;
+  }
+
+  // Retired nodes; they are all reclaimed by the time the list is gone
+  hazptr::hazptr_obj_cohort cohort_;
+  Comp less_;
+  std::atomic<size_t> size_{0};
+  std::atomic<Node*> head_[MaxHeight];
+};
+
+} // namespace folly
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/CachelinePadded.h>
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/Random.h>
+#include <folly/SpinLock.h>
+
+namespace folly {
+
+/**
+ * MultiQueue is an unbounded concurrent priority queue with relaxed
+ * ordering: it scales with the number of threads, at the cost of not
+ * always popping the element with the highest priority.
+ *
+ * Elements are spread over many small sequential heaps (shards), each
+ * protected by a spin lock that is only ever try-locked on the fast
+ * path.  push() adds to a random shard.  tryPop() looks at the cached
+ * top priorities of two random shards and pops from the better one
+ * ("power of two choices"), so it returns, with high probability, an
+ * element among the top O(numShards) ones.  Elements of the same
+ * priority that land in the same shard come out in FIFO order.
+ *
+ *   MultiQueue<Task> queue;
+ *   queue.push(std::move(task), priority);  // higher pops first
+ *   Task t;
+ *   if (queue.tryPop(t)) { ... }
+ *
+ * tryPop() returns false only if it saw every shard empty, so an
+ * element whose push() happens before the tryPop() starts is never
+ * missed (but concurrent pushes may be).
+ *
+ * Priority must be trivially copyable (it is cached in a std::atomic);
+ * Compare orders priorities like std::priority_queue (the greatest
+ * priority pops first).  See PriorityMPMCQueue for a bounded queue with
+ * a few strictly ordered priority levels, and FlatCombiningPriorityQueue
+ * for a strictly ordered one.
+ */
+template <
+    typename T,
+    typename Priority = int64_t,
+    typename Compare = std::less<Priority>>
+class MultiQueue {
+  struct Entry {
+    Priority priority;
+    uint64_t seq;
+    T value;
+  };
+
+  // For std::push_heap & co: the greatest entry has the greatest priority
+  // and, among equals, the smallest sequence number
+  struct EntryLess {
+    bool operator()(const Entry& a, const Entry& b) const {
+      Compare less;
+      if (less(a.priority, b.priority)) {
+        return true;
+      }
+      if (less(b.priority, a.priority)) {
+        return false;
+      }
+      return a.seq > b.seq;
+    }
+  };
+
+  struct Shard {
+    SpinLock lock;
+    // Written under lock; read without it to choose shards
+    std::atomic<size_t> size{0};
+    std::atomic<Priority> top{Priority()};
+    // Protected by lock
+    uint64_t seq{0};
+    std::vector<Entry> heap;
+  };
+
+ public:
+  /**
+   * More shards means less contention but more relaxed ordering; a few
+   * per thread that uses the queue is a good tradeoff.
+   */
+  explicit MultiQueue(
+      size_t numShards = 4 * std::max(1u, std::thread::hardware_concurrency()))
+      : numShards_(std::max<size_t>(numShards, 2)),
+        shards_(new CachelinePadded<Shard>[numShards_]) {}
+
+  MultiQueue(const MultiQueue&) = delete;
+  MultiQueue& operator=(const MultiQueue&) = delete;
+
+  void push(T value, Priority priority = Priority()) {
+    while (true) {
+      auto& shard = *shards_[random() % numShards_];
+      std::unique_lock<SpinLock> g(shard.lock, std::try_to_lock);
+      if (!g.owns_lock()) {
+        continue; // busy, pick another one
+      }
+      shard.heap.push_back(Entry{priority, shard.seq++, std::move(value)});
+      std::push_heap(shard.heap.begin(), shard.heap.end(), EntryLess());
+      publishTop(shard);
+      return;
+    }
+  }
+
+  bool tryPop(T& value) {
+    Priority priority;
+    return tryPop(value, priority);
+  }
+
+  /* Also returns the priority of the popped element */
+  bool tryPop(T& value, Priority& priority) {
+    // Two random choices while the shards we sample have elements
+    for (size_t attempt = 0; attempt < numShards_; ++attempt) {
+      auto& a = *shards_[random() % numShards_];
+      auto& b = *shards_[random() % numShards_];
+      auto aSize = a.size.load(std::memory_order_acquire);
+      auto bSize = b.size.load(std::memory_order_acquire);
+      if (aSize == 0 && bSize == 0) {
+        break;
+      }
+      Shard* best = &a;
+      if (aSize == 0 ||
+          (bSize != 0 &&
+           Compare()(
+               a.top.load(std::memory_order_relaxed),
+               b.top.load(std::memory_order_relaxed)))) {
+        best = &b;
+      }
+      std::unique_lock<SpinLock> g(best->lock, std::try_to_lock);
+      if (g.owns_lock() && popLocked(*best, value, priority)) {
+        return true;
+      }
+    }
+    // Mostly empty: look at every shard, from a random one
+    auto start = random() % numShards_;
+    for (size_t i = 0; i < numShards_; ++i) {
+      auto& shard = *shards_[(start + i) % numShards_];
+      if (shard.size.load(std::memory_order_acquire) == 0) {
+        continue;
+      }
+      std::lock_guard<SpinLock> g(shard.lock);
+      if (popLocked(shard, value, priority)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Exact if there are no concurrent pushes and pops */
+  size_t size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < numShards_; ++i) {
+      total += shards_[i]->size.load(std::memory_order_acquire);
+    }
+    return total;
+  }
+
+  bool empty() const {
+    for (size_t i = 0; i < numShards_; ++i) {
+      if (shards_[i]->size.load(std::memory_order_acquire) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t numShards() const {
+    return numShards_;
+  }
+
+ private:
+  // shard.lock must be held
+  static void publishTop(Shard& shard) {
+    if (!shard.heap.empty()) {
+      shard.top.store(shard.heap.front().priority, std::memory_order_relaxed);
+    }
+    shard.size.store(shard.heap.size(), std::memory_order_release);
+  }
+
+  // shard.lock must be held
+  static bool popLocked(Shard& shard, T& value, Priority& priority) {
+    if (shard.heap.empty()) {
+      return false;
+    }
+    std::pop_heap(shard.heap.begin(), shard.heap.end(), EntryLess());
+    auto& entry = shard.heap.back();
+    value = std::move(entry.value);
+    priority = entry.priority;
+    shard.heap.pop_back();
+    publishTop(shard);
+    return true;
+  }
+
+  // A cheap per-thread generator, only used to spread the load
+  static uint32_t random() {
+#ifdef FOLLY_TLS
+    static FOLLY_TLS uint32_t state = 0;
+    if (UNLIKELY(state == 0)) {
+      state = folly::Random::rand32() | 1;
+    }
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+#else
+    return folly::Random::rand32();
+#endif
+  }
+
+  const size_t numShards_;
+  std::unique_ptr<CachelinePadded<Shard>[]> shards_;
+};
+
+} // namespace folly
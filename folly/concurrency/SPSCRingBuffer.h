@@ -0,0 +1,309 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <folly/Bits.h>
+#include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/system/MemoryMapping.h>
+
+namespace folly {
+
+/**
+ * SPSCRingBuffer is a bounded wait-free queue for exactly one producer
+ * and one consumer, which may live in different processes.
+ *
+ * Compared to ProducerConsumerQueue:
+ *  - Each side keeps a private copy of the other side's index and only
+ *    reloads it (a cache miss on a line the other side writes) when the
+ *    copy says the ring is full, or empty.
+ *  - Elements can be written and read in batches, either copied from /
+ *    to an array or in place: writableSpan() returns free slots to fill,
+ *    and commitWrite(n) publishes the first n of them with a single
+ *    store; readableSpan() and commitRead(n) do the same for the
+ *    consumer.  Spans never wrap around, so a batch that does may take
+ *    two spans.
+ *  - The ring (indices and elements) lives in a MemoryMapping, which can
+ *    be shared between processes for zero-copy transfer:
+ *
+ *      // Before fork(), or on a file both processes map
+ *      MemoryMapping mapping(MemoryMapping::kAnonymous,
+ *                            SPSCRingBuffer<Msg>::mappingSize(4096),
+ *                            MemoryMapping::Options().setWritable(true));
+ *      auto ring = SPSCRingBuffer<Msg>::create(std::move(mapping), 4096);
+ *      // In another process that maps the same file:
+ *      auto ring = SPSCRingBuffer<Msg>::attach(std::move(mapping));
+ *
+ *    Shared mappings need T to be position independent (no pointers)
+ *    and both processes to agree on its layout; attach() checks the
+ *    element size and capacity recorded by create().
+ *
+ * T must be trivially copyable: elements are never constructed or
+ * destroyed in the ring, only copied in and out.
+ *
+ * Indices are 64-bit and never wrap, so all slots are usable (unlike
+ * ProducerConsumerQueue, which keeps one free) and the capacity is
+ * rounded up to a power of two.
+ */
+template <typename T>
+class SPSCRingBuffer {
+  static_assert(
+      IsTriviallyCopyable<T>::value,
+      "SPSCRingBuffer only holds trivially copyable types");
+  static_assert(
+      ATOMIC_LLONG_LOCK_FREE == 2,
+      "shared mappings need address-free 64-bit atomics");
+
+  // At the start of the mapping.  The indices are only ever incremented,
+  // by the producer (writeIndex) and the consumer (readIndex).
+  struct Header {
+    uint64_t magic;
+    uint64_t elementSize;
+    uint64_t capacity;
+    FOLLY_ALIGN_TO_AVOID_FALSE_SHARING std::atomic<uint64_t> writeIndex;
+    FOLLY_ALIGN_TO_AVOID_FALSE_SHARING std::atomic<uint64_t> readIndex;
+  };
+
+  static constexpr uint64_t kMagic = 0x5350534352696e67; // "SPSCRing"
+
+ public:
+  typedef T value_type;
+
+  /**
+   * Bytes of mapping needed for a ring of at least the given capacity.
+   */
+  static size_t mappingSize(size_t capacity) {
+    return slotsOffset() + sizeof(T) * roundCapacity(capacity);
+  }
+
+  /**
+   * Initializes an empty ring in mapping, which must be writable and at
+   * least mappingSize(capacity) bytes.
+   */
+  static SPSCRingBuffer create(MemoryMapping mapping, size_t capacity) {
+    auto range = mapping.writableRange();
+    capacity = roundCapacity(capacity);
+    if (range.size() < mappingSize(capacity)) {
+      throw std::invalid_argument("SPSCRingBuffer: mapping too small");
+    }
+    auto header = new (range.data()) Header();
+    header->magic = kMagic;
+    header->elementSize = sizeof(T);
+    header->capacity = capacity;
+    header->writeIndex.store(0, std::memory_order_relaxed);
+    header->readIndex.store(0, std::memory_order_relaxed);
+    return SPSCRingBuffer(
+        std::make_unique<MemoryMapping>(std::move(mapping)), header);
+  }
+
+  /**
+   * Uses the ring that create() initialized in mapping, with its current
+   * contents: a process that restarts can attach again.
+   */
+  static SPSCRingBuffer attach(MemoryMapping mapping) {
+    auto range = mapping.writableRange();
+    auto header = reinterpret_cast<Header*>(range.data());
+    if (range.size() < slotsOffset() || header->magic != kMagic ||
+        header->elementSize != sizeof(T) ||
+        range.size() < mappingSize(header->capacity)) {
+      throw std::invalid_argument("SPSCRingBuffer: not a matching ring");
+    }
+    return SPSCRingBuffer(
+        std::make_unique<MemoryMapping>(std::move(mapping)), header);
+  }
+
+  /**
+   * A ring private to this process.
+   */
+  explicit SPSCRingBuffer(size_t capacity)
+      : SPSCRingBuffer(create(
+            MemoryMapping(
+                MemoryMapping::kAnonymous,
+                mappingSize(capacity),
+                MemoryMapping::Options().setWritable(true).setShared(false)),
+            capacity)) {}
+
+  SPSCRingBuffer(SPSCRingBuffer&&) = default;
+  SPSCRingBuffer& operator=(SPSCRingBuffer&&) = default;
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  // Producer
+
+  /**
+   * Up to max free slots, contiguous in memory; empty if the ring is
+   * full.  Fill a prefix of them and publish it with commitWrite().
+   */
+  Range<T*> writableSpan(size_t max = size_t(-1)) {
+    size_t free = capacity() - (writeIndex_ - cachedReadIndex_);
+    if (free < std::min(max, capacity())) {
+      cachedReadIndex_ = header_->readIndex.load(std::memory_order_acquire);
+      free = capacity() - (writeIndex_ - cachedReadIndex_);
+    }
+    size_t offset = writeIndex_ & mask_;
+    size_t n = std::min({max, free, capacity() - offset});
+    return Range<T*>(slots_ + offset, n);
+  }
+
+  /**
+   * Makes the first n slots of the last writableSpan() visible to the
+   * consumer.
+   */
+  void commitWrite(size_t n) {
+    writeIndex_ += n;
+    header_->writeIndex.store(writeIndex_, std::memory_order_release);
+  }
+
+  /**
+   * Copies up to n items in; returns how many fit.
+   */
+  size_t write(const T* items, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      auto span = writableSpan(n - done);
+      if (span.empty()) {
+        break;
+      }
+      std::copy(items + done, items + done + span.size(), span.begin());
+      done += span.size();
+      writeIndex_ += span.size(); // publish once, below
+    }
+    if (done != 0) {
+      header_->writeIndex.store(writeIndex_, std::memory_order_release);
+    }
+    return done;
+  }
+
+  bool write(const T& item) {
+    return write(&item, 1) == 1;
+  }
+
+  // Consumer
+
+  /**
+   * Up to max readable elements, contiguous in memory; empty if the ring
+   * is empty.  Release a prefix of them with commitRead().
+   */
+  Range<const T*> readableSpan(size_t max = size_t(-1)) {
+    size_t available = cachedWriteIndex_ - readIndex_;
+    if (available < std::min(max, capacity())) {
+      cachedWriteIndex_ = header_->writeIndex.load(std::memory_order_acquire);
+      available = cachedWriteIndex_ - readIndex_;
+    }
+    size_t offset = readIndex_ & mask_;
+    size_t n = std::min({max, available, capacity() - offset});
+    return Range<const T*>(slots_ + offset, n);
+  }
+
+  /**
+   * Gives the first n elements of the last readableSpan() back to the
+   * producer.
+   */
+  void commitRead(size_t n) {
+    readIndex_ += n;
+    header_->readIndex.store(readIndex_, std::memory_order_release);
+  }
+
+  /**
+   * Copies up to n items out; returns how many there were.
+   */
+  size_t read(T* items, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      auto span = readableSpan(n - done);
+      if (span.empty()) {
+        break;
+      }
+      std::copy(span.begin(), span.end(), items + done);
+      done += span.size();
+      readIndex_ += span.size(); // publish once, below
+    }
+    if (done != 0) {
+      header_->readIndex.store(readIndex_, std::memory_order_release);
+    }
+    return done;
+  }
+
+  bool read(T& item) {
+    return read(&item, 1) == 1;
+  }
+
+  // Either side; exact only if the other side is idle
+  size_t sizeGuess() const {
+    auto r = header_->readIndex.load(std::memory_order_acquire);
+    auto w = header_->writeIndex.load(std::memory_order_acquire);
+    return w - r;
+  }
+
+  bool isEmpty() const {
+    return sizeGuess() == 0;
+  }
+
+ private:
+  static constexpr size_t slotsOffset() {
+    return sizeof(Header);
+  }
+
+  static size_t roundCapacity(size_t capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("SPSCRingBuffer: capacity must be > 0");
+    }
+    return nextPowTwo(capacity);
+  }
+
+  SPSCRingBuffer(std::unique_ptr<MemoryMapping> mapping, Header* header)
+      : mapping_(std::move(mapping)),
+        header_(header),
+        slots_(reinterpret_cast<T*>(
+            reinterpret_cast<char*>(header) + slotsOffset())),
+        mask_(header->capacity - 1),
+        writeIndex_(header->writeIndex.load(std::memory_order_acquire)),
+        cachedReadIndex_(header->readIndex.load(std::memory_order_acquire)),
+        readIndex_(cachedReadIndex_),
+        cachedWriteIndex_(writeIndex_) {}
+
+  std::unique_ptr<MemoryMapping> mapping_;
+  Header* header_;
+  T* slots_;
+  size_t mask_;
+
+  // Owned by the producer
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING uint64_t writeIndex_;
+  uint64_t cachedReadIndex_;
+
+  // Owned by the consumer
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING uint64_t readIndex_;
+  uint64_t cachedWriteIndex_;
+};
+
+template <typename T>
+constexpr uint64_t SPSCRingBuffer<T>::kMagic;
+
+} // namespace folly
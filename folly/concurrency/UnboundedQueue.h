@@ -0,0 +1,557 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include <glog/logging.h>
+
+#include <folly/Likely.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/detail/Futex.h>
+#include <folly/experimental/hazptr/hazptr.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+/**
+ * UnboundedQueue is a family of unbounded, lock-free queues, specialized at
+ * compile time for single or multiple producers and consumers, and for
+ * consumers that may block or only spin.
+ *
+ * Template parameters:
+ * - T: element type, must be move constructible, it is never copied or
+ *   moved inside the queue.
+ * - SingleProducer: true if at most one thread ever enqueues at a time.
+ * - SingleConsumer: true if at most one thread ever dequeues at a time.
+ * - MayBlock: true if consumers may sleep on a futex while waiting for an
+ *   element.  Otherwise they spin (yielding after a while), which saves
+ *   producers an atomic read-modify-write per element.
+ * - LgSegmentSize: log2 of the number of elements per segment.
+ * - Atom: atomic template, for DeterministicSchedule based testing.
+ *
+ * The queue is a list of segments of 2^LgSegmentSize entries.  Producers
+ * and consumers take consecutive tickets (with a fetch_add, or a plain
+ * store for the single side of an SP/SC queue) and each ticket names one
+ * entry, so producers and consumers only ever touch each other's entries,
+ * never each other's counters.  Within a segment, consecutive tickets are
+ * spread over different cache lines unless the queue is SPSC.
+ *
+ * The thread that takes the last ticket of a segment moves the tail (for
+ * producers) or the head (for consumers) to the next segment, allocating it
+ * if nobody has yet.  Segments are retired once every consumer is past
+ * them and freed through hazard pointers.  Each segment holds a reference
+ * count on the next one, so protecting a segment with a hazard pointer
+ * protects the rest of the list after it as well.  The sides that are
+ * single don't need hazard pointers on the fast path.
+ *
+ * dequeue() waits until there is an element.  try_dequeue() never waits,
+ * try_dequeue_until() and try_dequeue_for() wait until the deadline.
+ *
+ * size() and empty() are snapshots if other threads are active.  Note that
+ * every consumer waiting in dequeue() counts as a negative element until
+ * a producer puts one for it.
+ *
+ * Aliases: USPSCQueue, UMPSCQueue, USPMCQueue and UMPMCQueue, templated on
+ * <T, MayBlock, LgSegmentSize = 8>.
+ *
+ * Usage:
+ *   UMPMCQueue<int, true> q;
+ *   q.enqueue(42);
+ *   int v = q.dequeue();
+ *   if (q.try_dequeue_for(v, std::chrono::milliseconds(10))) { ... }
+ */
+template <
+    typename T,
+    bool SingleProducer,
+    bool SingleConsumer,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    template <typename> class Atom = std::atomic>
+class UnboundedQueue {
+  using Ticket = uint64_t;
+  class Entry;
+  class Segment;
+
+  static constexpr bool SPSC = SingleProducer && SingleConsumer;
+  static constexpr size_t SegmentSize = size_t(1) << LgSegmentSize;
+  static constexpr size_t Mask = SegmentSize - 1;
+  // Coprime with SegmentSize, and 27 entries apart are on different cache
+  // lines for any element type
+  static constexpr size_t Stride = SPSC || LgSegmentSize <= 1 ? 1 : 27;
+
+  static_assert(LgSegmentSize < 32, "LgSegmentSize must be < 32");
+  static_assert(
+      std::is_nothrow_destructible<T>::value,
+      "T must be nothrow destructible");
+
+ public:
+  UnboundedQueue() {
+    auto s = new Segment(0);
+    c_.head.store(s, std::memory_order_relaxed);
+    p_.tail.store(s, std::memory_order_relaxed);
+  }
+
+  UnboundedQueue(const UnboundedQueue&) = delete;
+  UnboundedQueue& operator=(const UnboundedQueue&) = delete;
+
+  ~UnboundedQueue() {
+    // Destroy the elements nobody dequeued
+    Segment* s = c_.head.load(std::memory_order_relaxed);
+    Ticket end = p_.ticket.load(std::memory_order_relaxed);
+    for (Ticket t = c_.ticket.load(std::memory_order_relaxed); t < end; ++t) {
+      if (t >= s->minTicket() + SegmentSize) {
+        s = s->nextSegment();
+      }
+      s->entry(index(t)).destroyItem();
+    }
+    // Free the segments, including any that consumers allocated ahead of
+    // producers
+    s = c_.head.load(std::memory_order_relaxed);
+    while (s) {
+      auto next = s->nextSegment();
+      reclaimSegment(s);
+      s = next;
+    }
+  }
+
+  void enqueue(const T& arg) {
+    enqueueImpl(arg);
+  }
+
+  void enqueue(T&& arg) {
+    enqueueImpl(std::move(arg));
+  }
+
+  /** Wait until there is an element, and dequeue it */
+  void dequeue(T& item) {
+    item = dequeue();
+  }
+
+  T dequeue() {
+    if (SingleConsumer) {
+      Segment* s = c_.head.load(std::memory_order_relaxed);
+      Ticket t = c_.ticket.load(std::memory_order_relaxed);
+      T item = takeFrom(s, t, [](Entry& e) {
+        e.wait();
+        return true;
+      });
+      c_.ticket.store(t + 1, std::memory_order_release);
+      return item;
+    } else {
+      hazptr::hazptr_holder hptr;
+      Segment* s = hptr.get_protected(c_.head);
+      Ticket t = c_.ticket.fetch_add(1, std::memory_order_acq_rel);
+      s = findSegment(s, t);
+      return takeFrom(s, t, [](Entry& e) {
+        e.wait();
+        return true;
+      });
+    }
+  }
+
+  /** Dequeue an element if there is one, without waiting */
+  bool try_dequeue(T& item) {
+    return tryDequeueImpl(item, [](Entry& e) { return e.isFull(); });
+  }
+
+  /** Wait until there is an element or the deadline has passed */
+  template <typename Clock, typename Duration>
+  bool try_dequeue_until(
+      T& item,
+      const std::chrono::time_point<Clock, Duration>& deadline) {
+    return tryDequeueImpl(
+        item, [&](Entry& e) { return e.tryWaitUntil(deadline); });
+  }
+
+  template <typename Rep, typename Period>
+  bool try_dequeue_for(
+      T& item,
+      const std::chrono::duration<Rep, Period>& duration) {
+    if (try_dequeue(item)) {
+      return true;
+    }
+    return try_dequeue_until(item, std::chrono::steady_clock::now() + duration);
+  }
+
+  size_t size() const noexcept {
+    // Load the consumer ticket first, so the result isn't negative unless
+    // consumers are waiting
+    auto c = c_.ticket.load(std::memory_order_acquire);
+    auto p = p_.ticket.load(std::memory_order_acquire);
+    return p > c ? size_t(p - c) : 0;
+  }
+
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+ private:
+  /**
+   * An entry is used once: EMPTY -> FULL, or EMPTY -> WAITING -> FULL if a
+   * consumer slept on it
+   */
+  class Entry {
+    enum : uint32_t { EMPTY = 0, WAITING = 1, FULL = 2 };
+
+   public:
+    Entry() {}
+
+    template <typename Arg>
+    void putItem(Arg&& arg) {
+      new (&item_) T(std::forward<Arg>(arg));
+      if (MayBlock) {
+        if (flag_.exchange(FULL, std::memory_order_acq_rel) == WAITING) {
+          flag_.futexWake();
+        }
+      } else {
+        flag_.store(FULL, std::memory_order_release);
+      }
+    }
+
+    T takeItem() {
+      DCHECK(isFull());
+      T item(std::move(*itemPtr()));
+      destroyItem();
+      return item;
+    }
+
+    void destroyItem() noexcept {
+      itemPtr()->~T();
+    }
+
+    bool isFull() const noexcept {
+      return flag_.load(std::memory_order_acquire) == FULL;
+    }
+
+    void wait() {
+      if (spin()) {
+        return;
+      }
+      if (!MayBlock) {
+        while (!isFull()) {
+          std::this_thread::yield();
+        }
+        return;
+      }
+      while (true) {
+        uint32_t f = flag_.load(std::memory_order_acquire);
+        if (f == FULL) {
+          return;
+        }
+        if (f == EMPTY &&
+            !flag_.compare_exchange_strong(
+                f, WAITING, std::memory_order_acq_rel)) {
+          continue;
+        }
+        flag_.futexWait(WAITING);
+      }
+    }
+
+    template <typename Clock, typename Duration>
+    bool tryWaitUntil(const std::chrono::time_point<Clock, Duration>& deadline) {
+      if (spin()) {
+        return true;
+      }
+      if (!MayBlock) {
+        while (!isFull()) {
+          if (Clock::now() >= deadline) {
+            return false;
+          }
+          std::this_thread::yield();
+        }
+        return true;
+      }
+      while (true) {
+        uint32_t f = flag_.load(std::memory_order_acquire);
+        if (f == FULL) {
+          return true;
+        }
+        if (f == EMPTY &&
+            !flag_.compare_exchange_strong(
+                f, WAITING, std::memory_order_acq_rel)) {
+          continue;
+        }
+        if (flag_.futexWaitUntil(WAITING, deadline) ==
+            detail::FutexResult::TIMEDOUT) {
+          return isFull();
+        }
+      }
+    }
+
+   private:
+    bool spin() const {
+      for (size_t i = 0; i < kSpins; ++i) {
+        if (isFull()) {
+          return true;
+        }
+        asm_volatile_pause();
+      }
+      return isFull();
+    }
+
+    T* itemPtr() noexcept {
+      return reinterpret_cast<T*>(&item_);
+    }
+
+    detail::Futex<Atom> flag_{EMPTY};
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type item_;
+  };
+
+  class Segment : public hazptr::hazptr_obj_base_refcounted<Segment> {
+   public:
+    explicit Segment(Ticket t) : min_(t) {}
+
+    ~Segment() {
+      // Drop our reference to the rest of the list, and free the segments
+      // that were only waiting for it, without recursing
+      auto next = next_.load(std::memory_order_acquire);
+      while (next && next->release_ref()) {
+        auto after = next->next_.exchange(nullptr, std::memory_order_acq_rel);
+        delete next;
+        next = after;
+      }
+    }
+
+    Segment* nextSegment() const noexcept {
+      return next_.load(std::memory_order_acquire);
+    }
+
+    bool casNextSegment(Segment* next) noexcept {
+      Segment* expected = nullptr;
+      return next_.compare_exchange_strong(
+          expected, next, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    Ticket minTicket() const noexcept {
+      return min_;
+    }
+
+    Entry& entry(size_t index) noexcept {
+      return b_[index];
+    }
+
+   private:
+    Atom<Segment*> next_{nullptr};
+    const Ticket min_;
+    Entry b_[SegmentSize];
+  };
+
+  // Spins before a waiting thread sleeps, or yields when it may not block
+  static constexpr size_t kSpins = 1000;
+
+  static void backoff(size_t& spins) {
+    if (spins < kSpins) {
+      ++spins;
+      asm_volatile_pause();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  static size_t index(Ticket t) noexcept {
+    return ((t & Mask) * Stride) & Mask;
+  }
+
+  static bool isLastInSegment(Ticket t) noexcept {
+    return (t & Mask) == Mask;
+  }
+
+  template <typename Arg>
+  void enqueueImpl(Arg&& arg) {
+    if (SingleProducer) {
+      Segment* s = p_.tail.load(std::memory_order_relaxed);
+      Ticket t = p_.ticket.load(std::memory_order_relaxed);
+      putInto(s, t, std::forward<Arg>(arg));
+      p_.ticket.store(t + 1, std::memory_order_release);
+    } else {
+      hazptr::hazptr_holder hptr;
+      Segment* s = hptr.get_protected(p_.tail);
+      Ticket t = p_.ticket.fetch_add(1, std::memory_order_acq_rel);
+      putInto(findSegment(s, t), t, std::forward<Arg>(arg));
+    }
+  }
+
+  template <typename Arg>
+  void putInto(Segment* s, Ticket t, Arg&& arg) {
+    if (UNLIKELY(isLastInSegment(t))) {
+      // Before the element is published, so that the consumer that takes it
+      // finds the next segment in place and the tail past this one
+      advanceTail(s);
+      if (SingleProducer && MayBlock) {
+        // Once the element is there the consumer may retire s, while
+        // putItem() is still waking it up
+        hazptr::hazptr_holder hptr;
+        hptr.reset(s);
+        s->entry(index(t)).putItem(std::forward<Arg>(arg));
+        return;
+      }
+    }
+    s->entry(index(t)).putItem(std::forward<Arg>(arg));
+  }
+
+  template <typename Wait>
+  bool tryDequeueImpl(T& item, Wait wait) {
+    if (SingleConsumer) {
+      Segment* s = c_.head.load(std::memory_order_relaxed);
+      Ticket t = c_.ticket.load(std::memory_order_relaxed);
+      if (!wait(s->entry(index(t)))) {
+        return false;
+      }
+      item = takeFrom(s, t, [](Entry&) { return true; });
+      c_.ticket.store(t + 1, std::memory_order_release);
+      return true;
+    } else {
+      hazptr::hazptr_holder hptr;
+      Segment* s = hptr.get_protected(c_.head);
+      Ticket t = c_.ticket.load(std::memory_order_acquire);
+      while (true) {
+        s = findSegment(s, t);
+        if (!wait(s->entry(index(t)))) {
+          return false;
+        }
+        // Claim the ticket only once its element is there
+        if (c_.ticket.compare_exchange_weak(
+                t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+          item = takeFrom(s, t, [](Entry&) { return true; });
+          return true;
+        }
+      }
+    }
+  }
+
+  template <typename Wait>
+  T takeFrom(Segment* s, Ticket t, Wait wait) {
+    auto& e = s->entry(index(t));
+    wait(e);
+    T item = e.takeItem();
+    if (UNLIKELY(isLastInSegment(t))) {
+      advanceHead(s);
+    }
+    return item;
+  }
+
+  // Walk from s, which is protected (or can't be freed concurrently), to the
+  // segment of ticket t, allocating segments that are missing.  s can't be
+  // past the segment of t, since tickets are taken after loading s.
+  Segment* findSegment(Segment* s, Ticket t) {
+    while (t >= s->minTicket() + SegmentSize) {
+      auto next = s->nextSegment();
+      if (!next) {
+        next = allocNextSegment(s);
+      }
+      s = next;
+    }
+    return s;
+  }
+
+  Segment* allocNextSegment(Segment* s) {
+    auto next = new Segment(s->minTicket() + SegmentSize);
+    // The reference of s, taken before next is shared
+    next->acquire_ref_safe();
+    if (!s->casNextSegment(next)) {
+      delete next;
+      next = s->nextSegment();
+    }
+    DCHECK(next);
+    return next;
+  }
+
+  void advanceTail(Segment* s) {
+    auto next = s->nextSegment();
+    if (!next) {
+      next = allocNextSegment(s);
+    }
+    if (!SingleProducer) {
+      // The producer of the previous segment's last element may be late
+      size_t spins = 0;
+      while (p_.tail.load(std::memory_order_acquire) != s) {
+        backoff(spins);
+      }
+    }
+    p_.tail.store(next, std::memory_order_release);
+  }
+
+  void advanceHead(Segment* s) {
+    if (!SingleConsumer) {
+      size_t spins = 0;
+      while (c_.head.load(std::memory_order_acquire) != s) {
+        backoff(spins);
+      }
+    }
+    auto next = s->nextSegment();
+    DCHECK(next);
+    c_.head.store(next, std::memory_order_release);
+    // Every producer is past s too, since the tail moved before the last
+    // element was put
+    reclaimSegment(s);
+  }
+
+  void reclaimSegment(Segment* s) {
+    s->retire();
+  }
+
+  struct Consumer {
+    Atom<Segment*> head{nullptr};
+    Atom<Ticket> ticket{0};
+  };
+  struct Producer {
+    Atom<Segment*> tail{nullptr};
+    Atom<Ticket> ticket{0};
+  };
+
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING Consumer c_;
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING Producer p_;
+};
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    template <typename> class Atom = std::atomic>
+using USPSCQueue = UnboundedQueue<T, true, true, MayBlock, LgSegmentSize, Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    template <typename> class Atom = std::atomic>
+using UMPSCQueue =
+    UnboundedQueue<T, false, true, MayBlock, LgSegmentSize, Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    template <typename> class Atom = std::atomic>
+using USPMCQueue =
+    UnboundedQueue<T, true, false, MayBlock, LgSegmentSize, Atom>;
+
+template <
+    typename T,
+    bool MayBlock,
+    size_t LgSegmentSize = 8,
+    template <typename> class Atom = std::atomic>
+using UMPMCQueue =
+    UnboundedQueue<T, false, false, MayBlock, LgSegmentSize, Atom>;
+
+} // namespace folly
@@ -159,12 +159,31 @@ class NodeT : public folly::hazptr::hazptr_obj_base<
   Atom<uint8_t> refcount_{1};
 };
 
+FOLLY_ALWAYS_INLINE void prefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(addr);
+#else
+  (void)addr;
+#endif
+}
+
+// How far ahead of the lookup a batch prefetches bucket heads.  Nodes are
+// prefetched half as far ahead, once their bucket head has arrived.
+constexpr size_t kBatchPrefetchDistance = 16;
+
 } // namespace concurrenthashmap
 
 /* A Segment is a single shard of the ConcurrentHashMap.
  * All writes take the lock, while readers are all wait-free.
  * Readers always proceed in parallel with the single writer.
  *
+ * Growing the buckets is incremental: a new table twice the size is
+ * allocated, and each write moves the next few buckets of the old
+ * table over before doing its own work, so no single write pays for
+ * rehashing the whole segment.  Until the last bucket has moved both
+ * tables are live; readers look in the new one for buckets already
+ * moved, and in the old one, whose chains are left intact, otherwise.
+ *
  *
  * Possible additional optimizations:
  *
@@ -178,6 +197,10 @@ class NodeT : public folly::hazptr::hazptr_obj_base<
  * * I tried using trylock() and find() to warm the cache for insert()
  *   and erase() similar to Java 7, but didn't have much luck.
  *
+ * * Readers could help migrate buckets during a resize, as writers do.
+ *   They would need to take the lock, or the migration to be lock
+ *   free, which costs every reader for the sake of a rare event.
+ *
  * * We could order elements using split ordering, for faster rehash,
  *   and no need to ever copy nodes.  Note that a full split ordering
  *   including dummy nodes increases the memory usage by 2x, but we
@@ -191,7 +214,6 @@ class NodeT : public folly::hazptr::hazptr_obj_base<
 template <
     typename KeyType,
     typename ValueType,
-    uint8_t ShardBits = 0,
     typename HashFn = std::hash<KeyType>,
     typename KeyEqual = std::equal_to<KeyType>,
     typename Allocator = std::allocator<uint8_t>,
@@ -215,18 +237,22 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
 
   using Node = concurrenthashmap::NodeT<KeyType, ValueType, Allocator, Atom>;
   class Iterator;
+  class Buckets;
 
   ConcurrentHashMapSegment(
       size_t initial_buckets,
       float load_factor,
-      size_t max_size)
-      : load_factor_(load_factor), max_size_(max_size) {
+      size_t max_size,
+      uint8_t shard_bits = 0)
+      : load_factor_(load_factor),
+        max_size_(max_size),
+        shard_bits_(shard_bits) {
     auto buckets = (Buckets*)Allocator().allocate(sizeof(Buckets));
     initial_buckets = folly::nextPowTwo(initial_buckets);
     DCHECK(
         max_size_ == 0 ||
         (isPowTwo(max_size_) &&
-         (folly::popcount(max_size_ - 1) + ShardBits <= 32)));
+         (folly::popcount(max_size_ - 1) + shard_bits_ <= 32)));
     new (buckets) Buckets(initial_buckets);
     buckets_.store(buckets, std::memory_order_release);
     load_factor_nodes_ = initial_buckets * load_factor_;
@@ -236,6 +262,11 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
     auto buckets = buckets_.load(std::memory_order_relaxed);
     // We can delete and not retire() here, since users must have
     // their own synchronization around destruction.
+    if (auto newbuckets = buckets->next_.load(std::memory_order_relaxed)) {
+      // Abandon the migration; the nodes it shares are refcounted.
+      newbuckets->~Buckets();
+      Allocator().deallocate((uint8_t*)newbuckets, sizeof(Buckets));
+    }
     buckets->~Buckets();
     Allocator().deallocate((uint8_t*)buckets, sizeof(Buckets));
   }
@@ -363,19 +394,19 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
       Args&&... args) {
     auto h = HashFn()(k);
     std::unique_lock<Mutex> g(m_);
+    migrateStep();
 
-    auto buckets = buckets_.load(std::memory_order_relaxed);
     // Check for rehash needed for DOES_NOT_EXIST
     if (size_ >= load_factor_nodes_ && type == InsertType::DOES_NOT_EXIST) {
       if (max_size_ && size_ << 1 > max_size_) {
         // Would exceed max size.
         throw std::bad_alloc();
       }
-      rehash(buckets->bucket_count_ << 1);
-      buckets = buckets_.load(std::memory_order_relaxed);
+      grow();
     }
 
-    auto idx = getIdx(buckets, h);
+    uint64_t idx;
+    auto buckets = bucketsFor(h, idx);
     auto head = &buckets->buckets_[idx];
     auto node = head->load(std::memory_order_relaxed);
     auto headnode = node;
@@ -425,12 +456,11 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
         // Would exceed max size.
         throw std::bad_alloc();
       }
-      rehash(buckets->bucket_count_ << 1);
+      grow();
 
       // Reload correct bucket.
-      buckets = buckets_.load(std::memory_order_relaxed);
+      buckets = bucketsFor(h, idx);
       it.buckets_hazptr_.reset(buckets);
-      idx = getIdx(buckets, h);
       head = &buckets->buckets_[idx];
       headnode = head->load(std::memory_order_relaxed);
     }
@@ -450,67 +480,155 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
     return true;
   }
 
-  // Must hold lock.
+  // Must hold lock.  Resizes the buckets all at once, for the callers
+  // that are about to fill them anyway.
   void rehash(size_t bucket_count) {
+    finishMigration();
+    startMigration(bucket_count);
+    finishMigration();
+  }
+
+  // Must hold lock.  Starts doubling the buckets, first finishing a
+  // migration still in progress if writes outpaced it.
+  void grow() {
+    finishMigration();
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    startMigration(buckets->bucket_count_ << 1);
+    migrateStep();
+  }
+
+  // Must hold lock.
+  void startMigration(size_t bucket_count) {
     auto buckets = buckets_.load(std::memory_order_relaxed);
     auto newbuckets = (Buckets*)Allocator().allocate(sizeof(Buckets));
     new (newbuckets) Buckets(bucket_count);
-
+    newbuckets->filling_.store(this, std::memory_order_relaxed);
     load_factor_nodes_ = bucket_count * load_factor_;
+    buckets->next_.store(newbuckets, std::memory_order_release);
+  }
 
-    for (size_t i = 0; i < buckets->bucket_count_; i++) {
-      auto bucket = &buckets->buckets_[i];
-      auto node = bucket->load(std::memory_order_relaxed);
-      if (!node) {
-        continue;
+  // Must hold lock.  Moves the next kMigrateStride buckets, if a
+  // migration is in progress.
+  void migrateStep() {
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    if (buckets->next_.load(std::memory_order_relaxed)) {
+      migrate(buckets, kMigrateStride);
+    }
+  }
+
+  // Must hold lock.
+  void finishMigration() {
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    if (buckets->next_.load(std::memory_order_relaxed)) {
+      migrate(buckets, buckets->bucket_count_);
+    }
+  }
+
+  // Must hold lock.  Moves up to n buckets to the new table, and once
+  // the last one has moved, makes it the current one.
+  void migrate(Buckets* buckets, size_t n) {
+    auto newbuckets = buckets->next_.load(std::memory_order_relaxed);
+    auto i = buckets->migrated_.load(std::memory_order_relaxed);
+    auto end = std::min(buckets->bucket_count_, i + n);
+    for (; i < end; i++) {
+      migrateBucket(buckets, newbuckets, i);
+      // Readers switch to the new table for this bucket from here on.
+      buckets->migrated_.store(i + 1, std::memory_order_release);
+    }
+    if (i < buckets->bucket_count_) {
+      return;
+    }
+    newbuckets->filling_.store(nullptr, std::memory_order_relaxed);
+    buckets_.store(newbuckets, std::memory_order_release);
+    buckets->retire(cohort_, concurrenthashmap::HazptrDeleter<Allocator>());
+  }
+
+  // Must hold lock.  Since both tables are powers of two indexed by the
+  // same hash bits, the nodes of one old bucket only land in new buckets
+  // no other old bucket feeds.  The old chain is left as it was, for
+  // readers and iterators still using the old table.
+  void migrateBucket(Buckets* buckets, Buckets* newbuckets, size_t i) {
+    auto bucket = &buckets->buckets_[i];
+    auto node = bucket->load(std::memory_order_relaxed);
+    if (!node) {
+      return;
+    }
+    auto h = HashFn()(node->getItem().first);
+    auto idx = getIdx(newbuckets, h);
+    // Reuse as long a chain as possible from the end.  Since the
+    // nodes don't have previous pointers, the longest last chain
+    // will be the same for both the previous hashmap and the new one,
+    // assuming all the nodes hash to the same bucket.
+    auto lastrun = node;
+    auto lastidx = idx;
+    auto count = 0;
+    auto last = node->next_.load(std::memory_order_relaxed);
+    for (; last != nullptr;
+         last = last->next_.load(std::memory_order_relaxed)) {
+      auto k = getIdx(newbuckets, HashFn()(last->getItem().first));
+      if (k != lastidx) {
+        lastidx = k;
+        lastrun = last;
+        count = 0;
       }
-      auto h = HashFn()(node->getItem().first);
-      auto idx = getIdx(newbuckets, h);
-      // Reuse as long a chain as possible from the end.  Since the
-      // nodes don't have previous pointers, the longest last chain
-      // will be the same for both the previous hashmap and the new one,
-      // assuming all the nodes hash to the same bucket.
-      auto lastrun = node;
-      auto lastidx = idx;
-      auto count = 0;
-      auto last = node->next_.load(std::memory_order_relaxed);
-      for (; last != nullptr;
-           last = last->next_.load(std::memory_order_relaxed)) {
-        auto k = getIdx(newbuckets, HashFn()(last->getItem().first));
-        if (k != lastidx) {
-          lastidx = k;
-          lastrun = last;
-          count = 0;
-        }
-        count++;
+      count++;
+    }
+    // Set longest last run in new bucket, incrementing the refcount.
+    lastrun->acquire();
+    newbuckets->buckets_[lastidx].store(lastrun, std::memory_order_relaxed);
+    // Clone remaining nodes
+    for (; node != lastrun;
+         node = node->next_.load(std::memory_order_relaxed)) {
+      auto newnode = (Node*)Allocator().allocate(sizeof(Node));
+      new (newnode) Node(node);
+      auto k = getIdx(newbuckets, HashFn()(node->getItem().first));
+      auto prevhead = &newbuckets->buckets_[k];
+      newnode->next_.store(prevhead->load(std::memory_order_relaxed));
+      prevhead->store(newnode, std::memory_order_relaxed);
+    }
+  }
+
+  // Must hold lock.  Returns the table writes to hash h go to, and the
+  // bucket in it.
+  Buckets* bucketsFor(size_t h, uint64_t& idx) {
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    idx = getIdx(buckets, h);
+    if (idx < buckets->migrated_.load(std::memory_order_relaxed)) {
+      buckets = buckets->next_.load(std::memory_order_relaxed);
+      idx = getIdx(buckets, h);
+    }
+    return buckets;
+  }
+
+  // Protects and returns the table readers of hash h look in, and the
+  // bucket in it.  hazbuckets is left protecting it; haznext is clobbered.
+  Buckets* protectBuckets(
+      size_t h,
+      uint64_t& idx,
+      folly::hazptr::hazptr_holder& hazbuckets,
+      folly::hazptr::hazptr_holder& haznext) {
+    while (true) {
+      auto buckets = hazbuckets.get_protected(buckets_);
+      idx = getIdx(buckets, h);
+      if (idx >= buckets->migrated_.load(std::memory_order_acquire)) {
+        return buckets;
       }
-      // Set longest last run in new bucket, incrementing the refcount.
-      lastrun->acquire();
-      newbuckets->buckets_[lastidx].store(lastrun, std::memory_order_relaxed);
-      // Clone remaining nodes
-      for (; node != lastrun;
-           node = node->next_.load(std::memory_order_relaxed)) {
-        auto newnode = (Node*)Allocator().allocate(sizeof(Node));
-        new (newnode) Node(node);
-        auto k = getIdx(newbuckets, HashFn()(node->getItem().first));
-        auto prevhead = &newbuckets->buckets_[k];
-        newnode->next_.store(prevhead->load(std::memory_order_relaxed));
-        prevhead->store(newnode, std::memory_order_relaxed);
+      auto newbuckets = haznext.get_protected(buckets->next_);
+      // The new table can't have been retired yet if the old one is
+      // still current; if it isn't, start over from the current one.
+      if (buckets_.load(std::memory_order_acquire) == buckets) {
+        hazbuckets.swap(haznext);
+        idx = getIdx(newbuckets, h);
+        return newbuckets;
       }
     }
-
-    auto oldbuckets = buckets_.load(std::memory_order_relaxed);
-    buckets_.store(newbuckets, std::memory_order_release);
-    oldbuckets->retire(
-        folly::hazptr::default_hazptr_domain(),
-        concurrenthashmap::HazptrDeleter<Allocator>());
   }
 
   bool find(Iterator& res, const KeyType& k) {
     folly::hazptr::hazptr_holder haznext;
     auto h = HashFn()(k);
-    auto buckets = res.buckets_hazptr_.get_protected(buckets_);
-    auto idx = getIdx(buckets, h);
+    uint64_t idx;
+    auto buckets = protectBuckets(h, idx, res.buckets_hazptr_, haznext);
     auto prev = &buckets->buckets_[idx];
     auto node = res.node_hazptr_.get_protected(*prev);
     while (node) {
@@ -524,6 +642,131 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
     return false;
   }
 
+  // Looks up n keys with precomputed hashes, calling fn(key, value) with
+  // a pointer to each value, or nullptr if missing, while it is protected.
+  template <typename Fn>
+  void find_batch(
+      const std::pair<size_t, const KeyType*>* items,
+      size_t n,
+      Fn& fn) {
+    using concurrenthashmap::kBatchPrefetchDistance;
+    using concurrenthashmap::prefetch;
+    folly::hazptr::hazptr_holder hazbuckets;
+    folly::hazptr::hazptr_holder haznode;
+    folly::hazptr::hazptr_holder haznext;
+    auto buckets = hazbuckets.get_protected(buckets_);
+    if (buckets->next_.load(std::memory_order_acquire)) {
+      // Mid-migration each key may live in either table.
+      for (size_t i = 0; i < n; i++) {
+        const KeyType& k = *items[i].second;
+        uint64_t idx;
+        auto b = protectBuckets(items[i].first, idx, hazbuckets, haznext);
+        auto node = haznode.get_protected(b->buckets_[idx]);
+        while (node && !KeyEqual()(k, node->getItem().first)) {
+          node = haznext.get_protected(node->next_);
+          haznext.swap(haznode);
+        }
+        fn(k, node ? &node->getItem().second : nullptr);
+      }
+      return;
+    }
+    for (size_t i = 0; i < n && i < kBatchPrefetchDistance; i++) {
+      prefetch(&buckets->buckets_[getIdx(buckets, items[i].first)]);
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (i + kBatchPrefetchDistance < n) {
+        prefetch(&buckets->buckets_[getIdx(
+            buckets, items[i + kBatchPrefetchDistance].first)]);
+      }
+      if (i + kBatchPrefetchDistance / 2 < n) {
+        // Unprotected, but prefetching a freed node is harmless
+        prefetch(buckets
+                     ->buckets_[getIdx(
+                         buckets, items[i + kBatchPrefetchDistance / 2].first)]
+                     .load(std::memory_order_relaxed));
+      }
+      const KeyType& k = *items[i].second;
+      auto idx = getIdx(buckets, items[i].first);
+      auto node = haznode.get_protected(buckets->buckets_[idx]);
+      while (node && !KeyEqual()(k, node->getItem().first)) {
+        node = haznext.get_protected(node->next_);
+        haznext.swap(haznode);
+      }
+      fn(k, node ? &node->getItem().second : nullptr);
+    }
+  }
+
+  // Links n unpublished nodes with precomputed hashes, under one lock.
+  // Nodes whose key is already present are freed.  Returns the number
+  // inserted; throws bad_alloc, after inserting what fit, if the batch
+  // would exceed max_size.
+  size_t insert_batch(std::pair<size_t, Node*>* items, size_t n) {
+    size_t inserted = 0;
+    bool full = false;
+    {
+      std::lock_guard<Mutex> g(m_);
+      finishMigration();
+      auto buckets = buckets_.load(std::memory_order_relaxed);
+      // Grow once for the whole batch rather than doubling repeatedly
+      if (size_ + n > load_factor_nodes_) {
+        auto wanted =
+            folly::nextPowTwo(size_t((size_ + n) / load_factor_) + 1);
+        if (wanted > buckets->bucket_count_ &&
+            (!max_size_ || wanted <= max_size_)) {
+          rehash(wanted);
+          buckets = buckets_.load(std::memory_order_relaxed);
+        }
+      }
+      for (size_t i = 0; i < n; i++) {
+        auto cur = items[i].second;
+        if (size_ >= load_factor_nodes_) {
+          if (max_size_ && size_ << 1 > max_size_) {
+            full = true;
+            break;
+          }
+          rehash(buckets->bucket_count_ << 1);
+          buckets = buckets_.load(std::memory_order_relaxed);
+        }
+        auto head = &buckets->buckets_[getIdx(buckets, items[i].first)];
+        auto headnode = head->load(std::memory_order_relaxed);
+        auto node = headnode;
+        while (node &&
+               !KeyEqual()(cur->getItem().first, node->getItem().first)) {
+          node = node->next_.load(std::memory_order_relaxed);
+        }
+        if (node) {
+          continue;
+        }
+        cur->next_.store(headnode, std::memory_order_relaxed);
+        head->store(cur, std::memory_order_release);
+        items[i].second = nullptr;
+        size_++;
+        inserted++;
+      }
+    }
+    // Free the rejected nodes while not under the lock.
+    for (size_t j = 0; j < n; j++) {
+      if (auto node = items[j].second) {
+        node->~Node();
+        Allocator().deallocate((uint8_t*)node, sizeof(Node));
+      }
+    }
+    if (full) {
+      throw std::bad_alloc();
+    }
+    return inserted;
+  }
+
+  // Grows the buckets to hold count elements without rehashing.
+  void reserve(size_t count) {
+    std::lock_guard<Mutex> g(m_);
+    finishMigration();
+    auto wanted = folly::nextPowTwo(size_t(count / load_factor_) + 1);
+    if (wanted > buckets_.load(std::memory_order_relaxed)->bucket_count_) {
+      rehash(wanted);
+    }
+  }
+
   // Listed separately because we need a prev pointer.
   size_type erase(const key_type& key) {
     return erase_internal(key, nullptr);
@@ -534,9 +777,10 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
     auto h = HashFn()(key);
     {
       std::lock_guard<Mutex> g(m_);
+      migrateStep();
 
-      auto buckets = buckets_.load(std::memory_order_relaxed);
-      auto idx = getIdx(buckets, h);
+      uint64_t idx;
+      auto buckets = bucketsFor(h, idx);
       auto head = &buckets->buckets_[idx];
       node = head->load(std::memory_order_relaxed);
       Node* prev = nullptr;
@@ -585,29 +829,39 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
   }
 
   void clear() {
-    auto buckets = buckets_.load(std::memory_order_relaxed);
-    auto newbuckets = (Buckets*)Allocator().allocate(sizeof(Buckets));
-    new (newbuckets) Buckets(buckets->bucket_count_);
+    Buckets* buckets;
     {
       std::lock_guard<Mutex> g(m_);
+      // Readers may be looking at both tables; only the current one can
+      // be retired safely.
+      finishMigration();
+      buckets = buckets_.load(std::memory_order_relaxed);
+      auto newbuckets = (Buckets*)Allocator().allocate(sizeof(Buckets));
+      new (newbuckets) Buckets(buckets->bucket_count_);
       buckets_.store(newbuckets, std::memory_order_release);
       size_ = 0;
     }
-    buckets->retire(
-        folly::hazptr::default_hazptr_domain(),
-        concurrenthashmap::HazptrDeleter<Allocator>());
+    buckets->retire(cohort_, concurrenthashmap::HazptrDeleter<Allocator>());
   }
 
   void max_load_factor(float factor) {
     std::lock_guard<Mutex> g(m_);
     load_factor_ = factor;
     auto buckets = buckets_.load(std::memory_order_relaxed);
+    if (auto newbuckets = buckets->next_.load(std::memory_order_relaxed)) {
+      buckets = newbuckets;
+    }
     load_factor_nodes_ = buckets->bucket_count_ * load_factor_;
   }
 
   Iterator cbegin() {
     Iterator res;
     auto buckets = res.buckets_hazptr_.get_protected(buckets_);
+    if (buckets->next_.load(std::memory_order_acquire)) {
+      // Iterate over a single complete table.
+      completeMigration();
+      buckets = res.buckets_hazptr_.get_protected(buckets_);
+    }
     res.setNode(nullptr, buckets, 0);
     res.next();
     return res;
@@ -644,6 +898,12 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
 
     size_t bucket_count_;
     Atom<Node*>* buckets_{nullptr};
+    // While this table is being migrated: the table it is migrating to,
+    // and how many of its buckets have moved there.
+    Atom<Buckets*> next_{nullptr};
+    Atom<size_t> migrated_{0};
+    // The segment filling this table, until its migration completes.
+    Atom<ConcurrentHashMapSegment*> filling_{nullptr};
   };
 
  public:
@@ -681,6 +941,12 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
     }
 
     void next() {
+      if (!node_) {
+        if (auto segment = buckets_->filling_.load(std::memory_order_acquire)) {
+          // Found mid-migration, and the buckets not moved yet are empty.
+          segment->completeMigration();
+        }
+      }
       while (!node_) {
         if (idx_ >= buckets_->bucket_count_) {
           break;
@@ -745,18 +1011,32 @@ class FOLLY_ALIGNED(64) ConcurrentHashMapSegment {
   };
 
  private:
-  // Shards have already used low ShardBits of the hash.
+  // How many buckets each write moves while a migration is in progress.
+  // A migration starts when the old table is at its load factor, so it
+  // is done well before the new one fills up.
+  static constexpr size_t kMigrateStride = 16;
+
+  void completeMigration() {
+    std::lock_guard<Mutex> g(m_);
+    finishMigration();
+  }
+
+  // Shards have already used low shard_bits_ of the hash.
   // Shift it over to use fresh bits.
   uint64_t getIdx(Buckets* buckets, size_t hash) {
-    return (hash >> ShardBits) & (buckets->bucket_count_ - 1);
+    return (hash >> shard_bits_) & (buckets->bucket_count_ - 1);
   }
 
   float load_factor_;
   size_t load_factor_nodes_;
   size_t size_{0};
   size_t const max_size_;
+  uint8_t const shard_bits_;
   Atom<Buckets*> buckets_{nullptr};
   Mutex m_;
+  // Replaced tables are retired here rather than to the default domain,
+  // so they are scanned as a batch and all freed with the segment.
+  folly::hazptr::hazptr_obj_cohort cohort_;
 };
 } // namespace detail
 } // namespace folly
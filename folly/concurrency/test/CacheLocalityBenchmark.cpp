@@ -51,21 +51,49 @@ DECLARE_SPREADER_TAG(
     PthreadSelfTag,
     CacheLocality::system<>(),
     folly::FallbackGetcpu<HashingThreadId>::getcpu)
+DECLARE_SPREADER_TAG(
+    VdsoTag,
+    CacheLocality::system<>(),
+    Getcpu::resolveVdsoFunc()
+        ? Getcpu::resolveVdsoFunc()
+        : folly::FallbackGetcpu<SequentialThreadId<std::atomic>>::getcpu)
 
-BENCHMARK(AccessSpreaderUse, iters) {
-  for (unsigned long i = 0; i < iters; ++i) {
-    auto x = AccessSpreader<>::current(16);
+template <template <typename> class Tag>
+static void accessSpreaderUse(size_t iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    auto x = AccessSpreader<Tag>::current(16);
     folly::doNotOptimizeAway(x);
   }
 }
 
+// AccessSpreaderUse is the default: a load from the rseq area of the
+// thread where glibc registers one, else the vdso getcpu.  The others
+// force a mode.
+BENCHMARK(AccessSpreaderUse, iters) {
+  accessSpreaderUse<std::atomic>(iters);
+}
+
+BENCHMARK_RELATIVE(AccessSpreaderUseVdso, iters) {
+  accessSpreaderUse<VdsoTag>(iters);
+}
+
+BENCHMARK_RELATIVE(AccessSpreaderUseThreadLocal, iters) {
+  accessSpreaderUse<ThreadLocalTag>(iters);
+}
+
+BENCHMARK_RELATIVE(AccessSpreaderUsePthreadSelf, iters) {
+  accessSpreaderUse<PthreadSelfTag>(iters);
+}
+
 // Benchmark scores here reflect the time for 32 threads to perform an
 // atomic increment on a dual-socket E5-2660 @ 2.2Ghz.  Surprisingly,
 // if we don't separate the counters onto unique 128 byte stripes the
 // 1_stripe and 2_stripe results are identical, even though the L3 is
 // claimed to have 64 byte cache lines.
 //
-// Getcpu refers to the vdso getcpu implementation.  ThreadLocal refers
+// Getcpu refers to the default, which loads the cpu from the rseq area
+// of the thread when glibc registers one, and calls the vdso getcpu
+// otherwise.  Vdso always calls the vdso getcpu.  ThreadLocal refers
 // to execution using SequentialThreadId, the fallback if the vdso
 // getcpu isn't available.  PthreadSelf hashes the value returned from
 // pthread_self() as a fallback-fallback for systems that don't have
@@ -232,6 +260,10 @@ static void contentionAtWidthGetcpu(size_t iters, size_t stripes, size_t work) {
   contentionAtWidth<std::atomic>(iters, stripes, work);
 }
 
+static void contentionAtWidthVdso(size_t iters, size_t stripes, size_t work) {
+  contentionAtWidth<VdsoTag>(iters, stripes, work);
+}
+
 static void
 contentionAtWidthThreadLocal(size_t iters, size_t stripes, size_t work) {
   contentionAtWidth<ThreadLocalTag>(iters, stripes, work);
@@ -250,6 +282,13 @@ BENCHMARK_NAMED_PARAM(contentionAtWidthGetcpu, 8_stripe_0_work, 8, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthGetcpu, 16_stripe_0_work, 16, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthGetcpu, 32_stripe_0_work, 32, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthGetcpu, 64_stripe_0_work, 64, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 1_stripe_0_work, 1, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 2_stripe_0_work, 2, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 4_stripe_0_work, 4, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 8_stripe_0_work, 8, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 16_stripe_0_work, 16, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 32_stripe_0_work, 32, 0)
+BENCHMARK_NAMED_PARAM(contentionAtWidthVdso, 64_stripe_0_work, 64, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthThreadLocal, 2_stripe_0_work, 2, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthThreadLocal, 4_stripe_0_work, 4, 0)
 BENCHMARK_NAMED_PARAM(contentionAtWidthThreadLocal, 8_stripe_0_work, 8, 0)
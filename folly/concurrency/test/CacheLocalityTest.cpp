@@ -331,6 +331,40 @@ TEST(Getcpu, VdsoGetcpu) {
 }
 #endif
 
+TEST(Getcpu, RseqGetcpu) {
+  auto func = Getcpu::resolveRseqFunc();
+  if (!func) {
+    return; // no rseq registration on this kernel / libc
+  }
+  unsigned cpu;
+  unsigned node;
+  EXPECT_EQ(0, func(&cpu, nullptr, nullptr));
+  EXPECT_TRUE(cpu < CPU_SETSIZE);
+  // Asking for the node goes through the fallback
+  EXPECT_EQ(0, func(&cpu, &node, nullptr));
+  EXPECT_TRUE(cpu < CPU_SETSIZE);
+}
+
+TEST(Getcpu, RseqCpuIdOffset) {
+  auto offset = Getcpu::rseqCpuIdOffset();
+  if (Getcpu::resolveRseqFunc() == nullptr) {
+    EXPECT_EQ(0, offset);
+    return;
+  }
+  ASSERT_NE(0, offset);
+  // Both read the same field, so they agree unless we migrate in between
+  for (int i = 0; i < 100; ++i) {
+    unsigned cpu;
+    Getcpu::resolveRseqFunc()(&cpu, nullptr, nullptr);
+    auto id = *reinterpret_cast<const volatile int32_t*>(
+        Getcpu::threadPointer() + offset);
+    if (unsigned(id) == cpu) {
+      return;
+    }
+  }
+  ADD_FAILURE() << "the cpu_id at rseqCpuIdOffset() never matched";
+}
+
 #ifdef FOLLY_TLS
 TEST(ThreadId, SimpleTls) {
   unsigned cpu = 0;
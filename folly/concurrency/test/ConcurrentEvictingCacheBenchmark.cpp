@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/ConcurrentEvictingCache.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/container/EvictingCacheMap.h>
+
+using namespace folly;
+
+namespace {
+
+constexpr size_t kEntries = 100000;
+
+// Each thread looks up iters keys, 1 in 16 of them a miss it then sets
+template <class Get, class Set>
+void runThreads(
+    BenchmarkSuspender& braces,
+    size_t iters,
+    size_t numThreads,
+    Get get,
+    Set set) {
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      uint64_t key = t * 7919;
+      for (size_t i = 0; i < iters; ++i) {
+        key = (key * 6364136223846793005ULL + 1442695040888963407ULL);
+        uint64_t k = (key >> 33) % (kEntries + kEntries / 16);
+        if (!get(k)) {
+          set(k);
+        }
+      }
+    });
+  }
+  braces.dismiss();
+  go = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void mutexEvictingCacheMap(size_t iters, size_t numThreads) {
+  BenchmarkSuspender braces;
+  std::mutex lock;
+  EvictingCacheMap<uint64_t, uint64_t> map(kEntries);
+  for (uint64_t i = 0; i < kEntries; ++i) {
+    map.set(i, i);
+  }
+  runThreads(
+      braces,
+      iters,
+      numThreads,
+      [&](uint64_t k) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = map.find(k);
+        return it != map.end() && it->second == k;
+      },
+      [&](uint64_t k) {
+        std::lock_guard<std::mutex> guard(lock);
+        map.set(k, k);
+      });
+}
+
+void concurrentEvictingCache(
+    size_t iters,
+    size_t numThreads,
+    ConcurrentEvictingCachePolicy policy) {
+  BenchmarkSuspender braces;
+  ConcurrentEvictingCache<uint64_t, uint64_t> cache(kEntries, policy);
+  for (uint64_t i = 0; i < kEntries; ++i) {
+    cache.set(i, i);
+  }
+  runThreads(
+      braces,
+      iters,
+      numThreads,
+      [&](uint64_t k) { return cache.get(k).hasValue(); },
+      [&](uint64_t k) { cache.set(k, k); });
+}
+
+void clock(size_t iters, size_t numThreads) {
+  concurrentEvictingCache(
+      iters, numThreads, ConcurrentEvictingCachePolicy::Clock);
+}
+
+void tinyLfu(size_t iters, size_t numThreads) {
+  concurrentEvictingCache(
+      iters, numThreads, ConcurrentEvictingCachePolicy::TinyLfu);
+}
+
+} // namespace
+
+BENCHMARK_PARAM(mutexEvictingCacheMap, 1)
+BENCHMARK_RELATIVE_PARAM(clock, 1)
+BENCHMARK_RELATIVE_PARAM(tinyLfu, 1)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(mutexEvictingCacheMap, 8)
+BENCHMARK_RELATIVE_PARAM(clock, 8)
+BENCHMARK_RELATIVE_PARAM(tinyLfu, 8)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(mutexEvictingCacheMap, 48)
+BENCHMARK_RELATIVE_PARAM(clock, 48)
+BENCHMARK_RELATIVE_PARAM(tinyLfu, 48)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/concurrency/ConcurrentEvictingCache.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+// A single shard makes the eviction order deterministic
+template <class K, class V>
+using SingleShardCache =
+    ConcurrentEvictingCache<K, V, std::hash<K>, std::equal_to<K>, 0>;
+} // namespace
+
+TEST(ConcurrentEvictingCache, SanityTest) {
+  ConcurrentEvictingCache<int, std::string> cache(0);
+
+  EXPECT_TRUE(cache.empty());
+  EXPECT_FALSE(cache.exists(1));
+  EXPECT_FALSE(cache.get(1).hasValue());
+  EXPECT_TRUE(cache.set(1, "one"));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_TRUE(cache.exists(1));
+  EXPECT_EQ("one", cache.get(1).value());
+  EXPECT_TRUE(cache.set(1, "uno"));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ("uno", cache.get(1).value());
+  EXPECT_TRUE(cache.erase(1));
+  EXPECT_FALSE(cache.erase(1));
+  EXPECT_TRUE(cache.empty());
+
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(cache.set(i, std::to_string(i)));
+  }
+  EXPECT_EQ(1000, cache.size());
+  EXPECT_EQ(1000, cache.weight());
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(std::to_string(i), cache.get(i).value());
+  }
+  cache.clear();
+  EXPECT_TRUE(cache.empty());
+  EXPECT_EQ(0, cache.weight());
+}
+
+TEST(ConcurrentEvictingCache, Capacity) {
+  ConcurrentEvictingCache<int, int> cache(1000);
+  size_t pruned = 0;
+  cache.setPruneHook([&](int, int&&) { pruned++; });
+  for (int i = 0; i < 10000; i++) {
+    cache.set(i, i);
+  }
+  // Each shard holds its part of the capacity
+  EXPECT_LE(cache.size(), cache.kNumShards * ((1000 + 63) / 64));
+  EXPECT_GT(cache.size(), 500);
+  EXPECT_EQ(10000, cache.size() + pruned);
+}
+
+TEST(ConcurrentEvictingCache, ClockKeepsReferencedEntries) {
+  SingleShardCache<int, int> cache(10);
+  std::vector<int> pruned;
+  cache.setPruneHook([&](int key, int&&) { pruned.push_back(key); });
+  for (int i = 0; i < 10; i++) {
+    cache.set(i, i);
+  }
+  EXPECT_EQ(10, cache.size());
+  EXPECT_TRUE(pruned.empty());
+
+  // Read the even keys, the odd ones go first
+  for (int i = 0; i < 10; i += 2) {
+    EXPECT_EQ(i, cache.get(i).value());
+  }
+  for (int i = 10; i < 15; i++) {
+    cache.set(i, i);
+  }
+  EXPECT_EQ((std::vector<int>{1, 3, 5, 7, 9}), pruned);
+  for (int i = 0; i < 10; i += 2) {
+    EXPECT_TRUE(cache.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCache, Weights) {
+  SingleShardCache<int, std::string> cache(100);
+  std::vector<int> pruned;
+  cache.setPruneHook([&](int key, std::string&&) { pruned.push_back(key); });
+
+  EXPECT_TRUE(cache.set(1, "a", 40));
+  EXPECT_TRUE(cache.set(2, "b", 40));
+  EXPECT_EQ(80, cache.weight());
+  EXPECT_FALSE(cache.set(3, "too heavy", 101));
+  EXPECT_FALSE(cache.exists(3));
+
+  // Evicts as many entries as it takes to fit
+  EXPECT_TRUE(cache.set(3, "c", 90));
+  EXPECT_EQ((std::vector<int>{1, 2}), pruned);
+  EXPECT_EQ(90, cache.weight());
+  EXPECT_EQ(1, cache.size());
+
+  // Growing an entry in place evicts others, but never itself
+  EXPECT_TRUE(cache.set(4, "d", 10));
+  EXPECT_TRUE(cache.set(4, "dd", 20));
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), pruned);
+  EXPECT_EQ(20, cache.weight());
+  EXPECT_EQ("dd", cache.get(4).value());
+}
+
+TEST(ConcurrentEvictingCache, TinyLfuResistsScans) {
+  SingleShardCache<int, int> cache(100, ConcurrentEvictingCachePolicy::TinyLfu);
+  for (int i = 0; i < 100; i++) {
+    cache.set(i, i);
+    for (int j = 0; j < 3; j++) {
+      cache.get(i);
+    }
+  }
+  // A scan of keys seen once doesn't displace the popular ones
+  size_t admitted = 0;
+  for (int i = 1000; i < 2000; i++) {
+    admitted += cache.set(i, i);
+  }
+  EXPECT_LT(admitted, 10);
+  size_t kept = 0;
+  for (int i = 0; i < 100; i++) {
+    kept += cache.exists(i);
+  }
+  EXPECT_GT(kept, 90);
+
+  // Plain CLOCK lets the scan flush the cache
+  SingleShardCache<int, int> clock(100);
+  for (int i = 0; i < 100; i++) {
+    clock.set(i, i);
+    clock.get(i);
+  }
+  for (int i = 1000; i < 2000; i++) {
+    EXPECT_TRUE(clock.set(i, i));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_FALSE(clock.exists(i));
+  }
+}
+
+TEST(ConcurrentEvictingCache, PruneHookMayUseCache) {
+  SingleShardCache<int, int> cache(1);
+  std::vector<int> pruned;
+  cache.set(1, 1);
+  cache.set(2, 2, 1, [&](int key, int&&) {
+    pruned.push_back(key);
+    EXPECT_TRUE(cache.exists(2));
+    EXPECT_FALSE(cache.exists(key));
+  });
+  EXPECT_EQ(std::vector<int>{1}, pruned);
+
+  cache.clear([&](int key, int&&) { pruned.push_back(key); });
+  EXPECT_EQ((std::vector<int>{1, 2}), pruned);
+}
+
+TEST(ConcurrentEvictingCache, MultiThreaded) {
+  ConcurrentEvictingCache<int, int> cache(1024);
+  std::atomic<size_t> pruned{0};
+  cache.setPruneHook([&](int key, int&& value) {
+    EXPECT_EQ(key * 2, value);
+    pruned++;
+  });
+  std::atomic<size_t> stored{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20000; i++) {
+        int key = (i * 7 + t * 13) % 4096;
+        auto value = cache.get(key);
+        if (value) {
+          EXPECT_EQ(key * 2, *value);
+        } else if (cache.set(key, key * 2)) {
+          stored++;
+        }
+        if (i % 100 == 0) {
+          cache.erase(key + 1);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(cache.size(), cache.kNumShards * 16);
+  EXPECT_LE(cache.size() + pruned, stored);
+}
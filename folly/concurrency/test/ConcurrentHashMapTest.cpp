@@ -14,9 +14,14 @@
  * limitations under the License.
  */
 #include <atomic>
+#include <iterator>
 #include <memory>
+#include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
+#include <folly/Conv.h>
 #include <folly/concurrency/ConcurrentHashMap.h>
 #include <folly/hash/Hash.h>
 #include <folly/portability/GTest.h>
@@ -257,6 +262,207 @@ TEST(ConcurrentHashMap, EraseTest) {
   foomap.erase(f1);
 }
 
+TEST(ConcurrentHashMap, FindBatchTest) {
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(3);
+  for (uint64_t i = 0; i < 1000; i += 2) {
+    foomap.insert(i, i * 10);
+  }
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 1000; i++) {
+    keys.push_back(i);
+  }
+  std::vector<int> seen(1000);
+  foomap.find_batch(
+      keys.begin(), keys.end(), [&](uint64_t k, const uint64_t* v) {
+        seen[k]++;
+        if (k % 2 == 0) {
+          ASSERT_NE(nullptr, v);
+          EXPECT_EQ(k * 10, *v);
+        } else {
+          EXPECT_EQ(nullptr, v);
+        }
+      });
+  EXPECT_EQ(std::vector<int>(1000, 1), seen);
+
+  // Keys of segments that were never created
+  ConcurrentHashMap<uint64_t, uint64_t> empty;
+  size_t calls = 0;
+  empty.find_batch(keys.begin(), keys.end(), [&](uint64_t, const uint64_t* v) {
+    EXPECT_EQ(nullptr, v);
+    calls++;
+  });
+  EXPECT_EQ(1000, calls);
+}
+
+TEST(ConcurrentHashMap, InsertBatchTest) {
+  ConcurrentHashMap<uint64_t, std::string> foomap(2);
+  foomap.insert(3, "three");
+  std::vector<std::pair<uint64_t, std::string>> kvs;
+  for (uint64_t i = 0; i < 5000; i++) {
+    kvs.emplace_back(i, folly::to<std::string>(i));
+  }
+  // Duplicates within the batch keep the first
+  kvs.emplace_back(7, "seven");
+  EXPECT_EQ(4999, foomap.insert_batch(kvs.begin(), kvs.end()));
+  EXPECT_EQ(5000, foomap.size());
+  EXPECT_EQ("three", foomap.find(3)->second);
+  EXPECT_EQ("7", foomap.find(7)->second);
+  for (uint64_t i = 0; i < 5000; i++) {
+    auto it = foomap.find(i);
+    ASSERT_NE(foomap.cend(), it);
+    if (i != 3) {
+      EXPECT_EQ(folly::to<std::string>(i), it->second);
+    }
+  }
+  EXPECT_EQ(0, foomap.insert_batch(kvs.begin(), kvs.end()));
+
+  // Moving the pairs in
+  std::vector<std::pair<uint64_t, std::string>> more;
+  more.emplace_back(10000, std::string(100, 'x'));
+  EXPECT_EQ(
+      1,
+      foomap.insert_batch(
+          std::make_move_iterator(more.begin()),
+          std::make_move_iterator(more.end())));
+  EXPECT_TRUE(more[0].second.empty());
+  EXPECT_EQ(std::string(100, 'x'), foomap.find(10000)->second);
+}
+
+TEST(ConcurrentHashMap, InsertBatchMaxSizeTest) {
+  // At most 16 elements per segment
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(512, 4096);
+  std::vector<std::pair<uint64_t, uint64_t>> kvs;
+  for (uint64_t i = 0; i < 100000; i++) {
+    kvs.emplace_back(i, i);
+  }
+  EXPECT_THROW(foomap.insert_batch(kvs.begin(), kvs.end()), std::bad_alloc);
+  EXPECT_LT(foomap.size(), 100000);
+}
+
+TEST(ConcurrentHashMap, ParallelForEachTest) {
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(3);
+  for (uint64_t i = 0; i < 10000; i++) {
+    foomap.insert(i, i);
+  }
+  std::atomic<uint64_t> sum{0};
+  std::atomic<size_t> count{0};
+  using value_type = ConcurrentHashMap<uint64_t, uint64_t>::value_type;
+  foomap.parallel_for_each(4, [&](const value_type& kv) {
+    EXPECT_EQ(kv.first, kv.second);
+    sum += kv.second;
+    count++;
+  });
+  EXPECT_EQ(10000, count.load());
+  EXPECT_EQ(10000 * 9999 / 2, sum.load());
+
+  EXPECT_THROW(
+      foomap.parallel_for_each(
+          3,
+          [](const value_type&) { throw std::runtime_error("stop"); }),
+      std::runtime_error);
+}
+
+TEST(ConcurrentHashMap, ReserveTest) {
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(2);
+  foomap.insert(1, 1);
+  foomap.reserve(100000);
+  for (uint64_t i = 0; i < 100000; i++) {
+    foomap.insert(i, i);
+  }
+  EXPECT_EQ(100000, foomap.size());
+  // Reserving less than the current size keeps the buckets
+  foomap.reserve(10);
+  EXPECT_EQ(1, foomap.find(1)->second);
+  EXPECT_EQ(100000, foomap.size());
+}
+
+TEST(ConcurrentHashMap, ShardCountTest) {
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(8, 0, 2);
+  EXPECT_EQ(4, foomap.shard_count());
+  for (uint64_t i = 0; i < 1000; i++) {
+    EXPECT_TRUE(foomap.insert(i, i).second);
+  }
+  for (uint64_t i = 0; i < 1000; i++) {
+    EXPECT_EQ(i, foomap.find(i)->second);
+  }
+  size_t count = 0;
+  for (auto it = foomap.cbegin(); it != foomap.cend(); ++it) {
+    count++;
+  }
+  EXPECT_EQ(1000, count);
+  auto other = std::move(foomap);
+  EXPECT_EQ(4, other.shard_count());
+  EXPECT_EQ(1000, other.size());
+  EXPECT_EQ(1, other.erase(0));
+  EXPECT_EQ(999, other.size());
+}
+
+TEST(ConcurrentHashMap, IncrementalResizeTest) {
+  // One shard, so every write helps the same migration along.
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(2, 0, 0);
+  for (uint64_t i = 0; i < 10000; i++) {
+    foomap.insert(i, i);
+    // Whichever table each key is in, it is found.
+    for (uint64_t j = i & 7; j <= i; j += 97) {
+      auto it = foomap.find(j);
+      ASSERT_NE(foomap.cend(), it);
+      EXPECT_EQ(j, it->second);
+    }
+    if (i % 1000 == 999) {
+      size_t count = 0;
+      for (auto it = foomap.cbegin(); it != foomap.cend(); ++it) {
+        count++;
+      }
+      EXPECT_EQ(i + 1, count);
+    }
+    if (i < 2000) {
+      // Iterating on from a key found mid-migration doesn't repeat keys.
+      std::set<uint64_t> seen;
+      for (auto it = foomap.find(i); it != foomap.cend(); ++it) {
+        EXPECT_TRUE(seen.insert(it->first).second);
+      }
+    }
+  }
+  for (uint64_t i = 0; i < 10000; i += 2) {
+    EXPECT_EQ(1, foomap.erase(i));
+  }
+  EXPECT_EQ(5000, foomap.size());
+  for (uint64_t i = 0; i < 10000; i++) {
+    EXPECT_EQ(i % 2 == 1, foomap.find(i) != foomap.cend());
+  }
+}
+
+TEST(ConcurrentHashMap, IncrementalResizeReadersTest) {
+  ConcurrentHashMap<uint64_t, uint64_t> foomap(2, 0, 0);
+  constexpr uint64_t kPresent = 1000;
+  for (uint64_t i = 0; i < kPresent; i++) {
+    foomap.insert(i, i);
+  }
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        for (uint64_t i = 0; i < kPresent; i++) {
+          auto it = foomap.find(i);
+          ASSERT_NE(foomap.cend(), it);
+          EXPECT_EQ(i, it->second);
+        }
+      }
+    });
+  }
+  for (uint64_t i = kPresent; i < 100000; i++) {
+    foomap.insert(i, i);
+    if (i % 3 == 0) {
+      foomap.erase(i - 1);
+    }
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+}
+
 // TODO: hazptrs must support DeterministicSchedule
 
 #define Atom std::atomic // DeterministicAtomic
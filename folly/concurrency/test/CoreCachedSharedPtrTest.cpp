@@ -48,6 +48,105 @@ TEST(CoreCachedSharedPtr, Basic) {
   ASSERT_TRUE(wp2.expired());
 }
 
+TEST(CoreRefCountedSharedPtr, Basic) {
+  auto p = std::make_shared<int>(1);
+  std::weak_ptr<int> wp(p);
+
+  folly::CoreRefCountedSharedPtr<int> counted(std::move(p));
+  auto ref = counted.get();
+  ASSERT_TRUE(ref);
+  ASSERT_EQ(1, *ref);
+
+  auto ref2 = counted.get();
+  std::shared_ptr<int> sp = std::move(ref2).toSharedPtr();
+  ASSERT_FALSE(ref2);
+  ASSERT_EQ(ref.get(), sp.get());
+
+  // Both references keep the object alive after a reset()
+  counted.reset(std::make_shared<int>(2));
+  ASSERT_EQ(2, *counted.get());
+  ASSERT_FALSE(wp.expired());
+  ref.reset();
+  ASSERT_FALSE(wp.expired());
+  sp.reset();
+  ASSERT_TRUE(wp.expired());
+
+  counted.reset();
+  ASSERT_FALSE(counted.get());
+}
+
+TEST(CoreRefCountedSharedPtr, OutlivesPointer) {
+  auto p = std::make_shared<int>(1);
+  std::weak_ptr<int> wp(p);
+  folly::CoreRefCountedSharedPtr<int>::Ref ref;
+  {
+    folly::CoreRefCountedSharedPtr<int> counted(std::move(p));
+    ref = counted.get();
+  }
+  ASSERT_FALSE(wp.expired());
+  ASSERT_EQ(1, *ref);
+  ref.reset();
+  ASSERT_TRUE(wp.expired());
+}
+
+TEST(CoreRefCountedSharedPtr, SlotOverflow) {
+  auto p = std::make_shared<int>(1);
+  std::weak_ptr<int> wp(p);
+  folly::CoreRefCountedSharedPtr<int, 1> counted(std::move(p));
+
+  // Past 65535 references per slot, get() falls back to the shared count
+  std::vector<folly::CoreRefCountedSharedPtr<int, 1>::Ref> refs;
+  for (int i = 0; i < 70000; ++i) {
+    refs.push_back(counted.get());
+  }
+  counted.reset();
+  while (!refs.empty()) {
+    ASSERT_FALSE(wp.expired());
+    refs.pop_back();
+  }
+  ASSERT_TRUE(wp.expired());
+}
+
+TEST(CoreRefCountedSharedPtr, ConcurrentReset) {
+  struct Tracked {
+    explicit Tracked(std::atomic<int>& l) : live(l) {
+      ++live;
+    }
+    ~Tracked() {
+      --live;
+    }
+    std::atomic<int>& live;
+  };
+  std::atomic<int> live{0};
+  {
+    folly::CoreRefCountedSharedPtr<Tracked, 4> counted(
+        std::make_shared<Tracked>(live));
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+      threads.emplace_back([&] {
+        std::vector<folly::CoreRefCountedSharedPtr<Tracked, 4>::Ref> refs;
+        while (!done) {
+          refs.push_back(counted.get());
+          ASSERT_LT(0, refs.back()->live.load());
+          if (refs.size() == 16) {
+            refs.clear();
+          }
+        }
+      });
+    }
+    for (int i = 0; i < 1000; ++i) {
+      counted.reset(std::make_shared<Tracked>(live));
+    }
+    done = true;
+    for (auto& t : threads) {
+      t.join();
+    }
+    ASSERT_EQ(1, live.load());
+  }
+  ASSERT_EQ(0, live.load());
+}
+
 namespace {
 
 template <class Operation>
@@ -104,6 +203,11 @@ void benchmarkAtomicCoreCachedSharedPtrGet(size_t numThreads, size_t iters) {
   parallelRun([&] { return p.get(); }, numThreads, iters);
 }
 
+void benchmarkCoreRefCountedSharedPtrGet(size_t numThreads, size_t iters) {
+  folly::CoreRefCountedSharedPtr<int> p(std::make_shared<int>(1));
+  parallelRun([&] { return p.get(); }, numThreads, iters);
+}
+
 } // namespace
 
 BENCHMARK(SharedPtrSingleThread, n) {
@@ -124,6 +228,9 @@ BENCHMARK(CoreCachedWeakPtrSingleThread, n) {
 BENCHMARK(AtomicCoreCachedSharedPtrSingleThread, n) {
   benchmarkAtomicCoreCachedSharedPtrGet(1, n);
 }
+BENCHMARK(CoreRefCountedSharedPtrSingleThread, n) {
+  benchmarkCoreRefCountedSharedPtrGet(1, n);
+}
 
 BENCHMARK_DRAW_LINE();
 
@@ -145,6 +252,9 @@ BENCHMARK(CoreCachedWeakPtr4Threads, n) {
 BENCHMARK(AtomicCoreCachedSharedPtr4Threads, n) {
   benchmarkAtomicCoreCachedSharedPtrGet(4, n);
 }
+BENCHMARK(CoreRefCountedSharedPtr4Threads, n) {
+  benchmarkCoreRefCountedSharedPtrGet(4, n);
+}
 
 BENCHMARK_DRAW_LINE();
 
@@ -166,6 +276,9 @@ BENCHMARK(CoreCachedWeakPtr16Threads, n) {
 BENCHMARK(AtomicCoreCachedSharedPtr16Threads, n) {
   benchmarkAtomicCoreCachedSharedPtrGet(16, n);
 }
+BENCHMARK(CoreRefCountedSharedPtr16Threads, n) {
+  benchmarkCoreRefCountedSharedPtrGet(16, n);
+}
 
 BENCHMARK_DRAW_LINE();
 
@@ -187,6 +300,10 @@ BENCHMARK(AtomicCoreCachedSharedPtrSingleThreadReset, n) {
   folly::AtomicCoreCachedSharedPtr<int> p(std::make_shared<int>(1));
   parallelRun([&] { p.reset(std::make_shared<int>(1)); }, 1, n);
 }
+BENCHMARK(CoreRefCountedSharedPtrSingleThreadReset, n) {
+  folly::CoreRefCountedSharedPtr<int> p(std::make_shared<int>(1));
+  parallelRun([&] { p.reset(std::make_shared<int>(1)); }, 1, n);
+}
 
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
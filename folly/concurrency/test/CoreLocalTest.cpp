@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/concurrency/CoreLocal.h>
+
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(CoreLocal, Slots) {
+  CoreLocal<int, 8> c;
+  EXPECT_EQ(8, c.size());
+  c.forEach([](int& v) { v = 1; });
+  c.local() += 1;
+  int sum = 0;
+  c.forEach([&](int v) { sum += v; });
+  EXPECT_EQ(9, sum);
+  EXPECT_NE(
+      reinterpret_cast<uintptr_t>(&c[0]) / 64,
+      reinterpret_cast<uintptr_t>(&c[1]) / 64);
+}
+
+TEST(CoreLocalCounter, Basic) {
+  CoreLocalCounter<int64_t> c(10);
+  EXPECT_EQ(10, c.readFull());
+  ++c;
+  c += 5;
+  c -= 2;
+  --c;
+  EXPECT_EQ(13, c.readFast());
+  EXPECT_EQ(13, c.readFullAndReset());
+  EXPECT_EQ(0, c.readFull());
+  c.set(7);
+  EXPECT_EQ(7, c.readFull());
+}
+
+TEST(CoreLocalCounter, Concurrent) {
+  constexpr int kThreads = 16;
+  constexpr int kIters = 100000;
+  CoreLocalCounter<int64_t> c;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIters; ++i) {
+        ++c;
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(int64_t(kThreads) * kIters, c.readFull());
+}
+
+namespace {
+struct Counted {
+  static std::atomic<int> live;
+  Counted() {
+    ++live;
+  }
+  ~Counted() {
+    --live;
+  }
+};
+std::atomic<int> Counted::live{0};
+} // namespace
+
+TEST(CoreLocalFreeList, PushPop) {
+  {
+    CoreLocalFreeList<Counted, std::default_delete<Counted>, 4, 2> list;
+    EXPECT_EQ(nullptr, list.pop());
+    std::vector<Counted*> items;
+    for (int i = 0; i < 4; ++i) {
+      items.push_back(new Counted);
+      EXPECT_TRUE(list.push(items.back()));
+    }
+    auto extra = new Counted;
+    EXPECT_FALSE(list.push(extra));
+    delete extra;
+    EXPECT_EQ(4, list.size());
+    // LIFO within a slot
+    EXPECT_EQ(items.back(), list.pop());
+    delete items.back();
+    EXPECT_EQ(3, list.size());
+    EXPECT_EQ(4, Counted::live.load() + 1);
+  }
+  // Leftovers are deleted
+  EXPECT_EQ(0, Counted::live.load());
+}
+
+TEST(CoreLocalFreeList, Concurrent) {
+  constexpr int kThreads = 8;
+  constexpr int kIters = 20000;
+  CoreLocalFreeList<Counted> list;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIters; ++i) {
+        auto p = list.pop();
+        if (!p) {
+          p = new Counted;
+        }
+        if (!list.push(p)) {
+          delete p;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(size_t(Counted::live.load()), list.size());
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/DynamicBoundedQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+struct StringWeight {
+  uint64_t operator()(const std::string& s) const noexcept {
+    return s.size();
+  }
+};
+
+template <bool SP, bool SC, bool MayBlock>
+using Queue = DynamicBoundedQueue<int, SP, SC, MayBlock, 2>;
+
+template <bool SP, bool SC, bool MayBlock>
+void basicTest() {
+  Queue<SP, SC, MayBlock> q(10);
+  EXPECT_EQ(10, q.capacity());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(q.try_enqueue(i));
+  }
+  EXPECT_FALSE(q.try_enqueue(10));
+  EXPECT_EQ(10, q.size());
+  EXPECT_EQ(10, q.weight());
+
+  int v;
+  EXPECT_TRUE(q.try_dequeue(v));
+  EXPECT_EQ(0, v);
+  EXPECT_TRUE(q.try_enqueue(10));
+  EXPECT_FALSE(q.try_enqueue(11));
+  for (int i = 1; i <= 10; ++i) {
+    EXPECT_EQ(i, q.dequeue());
+  }
+  EXPECT_TRUE(q.empty());
+  EXPECT_FALSE(q.try_dequeue(v));
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void timeoutTest() {
+  Queue<SP, SC, MayBlock> q(1);
+  q.enqueue(1);
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(q.try_enqueue_for(2, std::chrono::milliseconds(20)));
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+  // A producer waiting for room is woken by the consumer
+  std::thread consumer([&] {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(1, q.dequeue());
+  });
+  EXPECT_TRUE(q.try_enqueue_for(3, std::chrono::seconds(10)));
+  consumer.join();
+  EXPECT_EQ(3, q.dequeue());
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void concurrentTest() {
+  const int numProducers = SP ? 1 : 4;
+  const int numConsumers = SC ? 1 : 4;
+  const int numOps = 10000;
+  Queue<SP, SC, MayBlock> q(100);
+  std::atomic<int64_t> sum{0};
+  std::atomic<bool> overweight{false};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < numProducers; ++p) {
+    threads.emplace_back([&] {
+      for (int i = 1; i <= numOps; ++i) {
+        if (i % 2 == 0) {
+          q.enqueue(i);
+        } else {
+          while (!q.try_enqueue_for(i, std::chrono::milliseconds(1))) {
+          }
+        }
+        if (q.size() > 100) {
+          overweight = true;
+        }
+      }
+    });
+  }
+  const int perConsumer = numOps * numProducers / numConsumers;
+  for (int c = 0; c < numConsumers; ++c) {
+    threads.emplace_back([&] {
+      int64_t local = 0;
+      for (int i = 0; i < perConsumer; ++i) {
+        local += q.dequeue();
+      }
+      sum += local;
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_FALSE(overweight);
+  EXPECT_EQ(int64_t(numProducers) * numOps * (numOps + 1) / 2, sum.load());
+  EXPECT_TRUE(q.empty());
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void runTests() {
+  basicTest<SP, SC, MayBlock>();
+  timeoutTest<SP, SC, MayBlock>();
+  concurrentTest<SP, SC, MayBlock>();
+}
+
+} // namespace
+
+TEST(DynamicBoundedQueue, spsc) {
+  runTests<true, true, false>();
+  runTests<true, true, true>();
+}
+
+TEST(DynamicBoundedQueue, mpsc) {
+  runTests<false, true, false>();
+  runTests<false, true, true>();
+}
+
+TEST(DynamicBoundedQueue, spmc) {
+  runTests<true, false, false>();
+  runTests<true, false, true>();
+}
+
+TEST(DynamicBoundedQueue, mpmc) {
+  runTests<false, false, false>();
+  runTests<false, false, true>();
+}
+
+TEST(DynamicBoundedQueue, weights) {
+  DMPMCQueue<std::string, false, 8, StringWeight> q(10);
+  EXPECT_TRUE(q.try_enqueue(std::string("abcdef")));
+  EXPECT_FALSE(q.try_enqueue(std::string("abcde")));
+  EXPECT_TRUE(q.try_enqueue(std::string("abcd")));
+  EXPECT_EQ(10, q.weight());
+  EXPECT_EQ(2, q.size());
+  EXPECT_FALSE(q.try_enqueue(std::string("a")));
+  // Weightless elements always fit
+  EXPECT_TRUE(q.try_enqueue(std::string()));
+
+  std::string s;
+  EXPECT_TRUE(q.try_dequeue(s));
+  EXPECT_EQ("abcdef", s);
+  EXPECT_EQ(4, q.weight());
+  EXPECT_TRUE(q.try_enqueue(std::string("123456")));
+  // Too heavy for the capacity
+  EXPECT_FALSE(q.try_enqueue(std::string(11, 'x')));
+}
+
+TEST(DynamicBoundedQueue, resetCapacity) {
+  DMPMCQueue<int, true> q(2);
+  EXPECT_TRUE(q.try_enqueue(1));
+  EXPECT_TRUE(q.try_enqueue(2));
+  EXPECT_FALSE(q.try_enqueue(3));
+
+  q.reset_capacity(4);
+  EXPECT_EQ(4, q.capacity());
+  EXPECT_TRUE(q.try_enqueue(3));
+  EXPECT_TRUE(q.try_enqueue(4));
+  EXPECT_FALSE(q.try_enqueue(5));
+
+  // Shrinking below the current weight keeps the elements, and the queue
+  // stays full until they're dequeued
+  q.reset_capacity(1);
+  EXPECT_EQ(4, q.size());
+  EXPECT_FALSE(q.try_enqueue(5));
+  for (int i = 1; i <= 3; ++i) {
+    EXPECT_EQ(i, q.dequeue());
+    EXPECT_FALSE(q.try_enqueue(5));
+  }
+  EXPECT_EQ(4, q.dequeue());
+  EXPECT_TRUE(q.try_enqueue(5));
+  EXPECT_FALSE(q.try_enqueue(6));
+
+  // Growing wakes up waiting producers
+  std::thread producer([&] { q.enqueue(6); });
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  q.reset_capacity(2);
+  producer.join();
+  EXPECT_EQ(5, q.dequeue());
+  EXPECT_EQ(6, q.dequeue());
+}
+
+TEST(DynamicBoundedQueue, cachedCredit) {
+  // The capacity is large enough for producers to cache credit
+  const int capacity = 1000;
+  DMPMCQueue<int, true> q(capacity);
+
+  // A thread that enqueued once, and is now idle, has credit cached
+  Baton<> enqueued, done;
+  std::thread idle([&] {
+    EXPECT_TRUE(q.try_enqueue(0));
+    enqueued.post();
+    done.wait();
+  });
+  enqueued.wait();
+
+  // All of it is still available to other threads
+  for (int i = 1; i < capacity; ++i) {
+    EXPECT_TRUE(q.try_enqueue(i));
+  }
+  EXPECT_FALSE(q.try_enqueue(capacity));
+  EXPECT_EQ(capacity, q.weight());
+  done.post();
+  idle.join();
+
+  for (int i = 0; i < capacity; ++i) {
+    EXPECT_EQ(i, q.dequeue());
+  }
+  EXPECT_EQ(0, q.weight());
+}
+
+TEST(DynamicBoundedQueue, threadExitReturnsCredit) {
+  DMPMCQueue<int, false> q(1000);
+  std::thread([&] { EXPECT_TRUE(q.try_enqueue(1)); }).join();
+  EXPECT_EQ(1, q.weight());
+  EXPECT_EQ(1, q.dequeue());
+  EXPECT_EQ(0, q.weight());
+}
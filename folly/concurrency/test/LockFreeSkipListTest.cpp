@@ -0,0 +1,236 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Random.h>
+#include <folly/concurrency/LockFreeSkipList.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(LockFreeSkipList, Basic) {
+  LockFreeSkipList<int> list;
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.begin(), list.end());
+  EXPECT_EQ(list.find(1), list.end());
+
+  auto r = list.insert(3);
+  EXPECT_TRUE(r.second);
+  EXPECT_EQ(3, *r.first);
+  auto r2 = list.insert(3);
+  EXPECT_FALSE(r2.second);
+  EXPECT_EQ(r.first, r2.first);
+  EXPECT_TRUE(list.emplace(1).second);
+  EXPECT_TRUE(list.insert(2).second);
+  EXPECT_EQ(3, list.size());
+
+  EXPECT_TRUE(list.contains(2));
+  EXPECT_FALSE(list.contains(4));
+  EXPECT_EQ(1, list.count(1));
+  EXPECT_EQ(2, *list.find(2));
+
+  EXPECT_EQ(1, list.erase(2));
+  EXPECT_EQ(0, list.erase(2));
+  EXPECT_FALSE(list.contains(2));
+  EXPECT_EQ(2, list.size());
+
+  std::vector<int> elems(list.begin(), list.end());
+  EXPECT_EQ((std::vector<int>{1, 3}), elems);
+}
+
+TEST(LockFreeSkipList, Bounds) {
+  LockFreeSkipList<int> list;
+  for (int i = 0; i < 100; i += 10) {
+    list.insert(i);
+  }
+  EXPECT_EQ(20, *list.lower_bound(20));
+  EXPECT_EQ(30, *list.upper_bound(20));
+  EXPECT_EQ(30, *list.lower_bound(21));
+  EXPECT_EQ(0, *list.lower_bound(-5));
+  EXPECT_EQ(list.end(), list.lower_bound(91));
+  EXPECT_EQ(list.end(), list.upper_bound(90));
+
+  // Range scan of [25, 65)
+  std::vector<int> range;
+  for (auto it = list.lower_bound(25); it != list.end() && *it < 65; ++it) {
+    range.push_back(*it);
+  }
+  EXPECT_EQ((std::vector<int>{30, 40, 50, 60}), range);
+}
+
+TEST(LockFreeSkipList, Reverse) {
+  LockFreeSkipList<int> list;
+  for (int i = 0; i < 1000; ++i) {
+    list.insert(i);
+  }
+  auto it = list.end();
+  for (int i = 999; i >= 0; --i) {
+    --it;
+    EXPECT_EQ(i, *it);
+  }
+  EXPECT_EQ(list.begin(), it);
+
+  it = list.find(500);
+  auto prev = it--;
+  EXPECT_EQ(500, *prev);
+  EXPECT_EQ(499, *it);
+  ++it;
+  EXPECT_EQ(prev, it);
+}
+
+TEST(LockFreeSkipList, IteratorOutlivesErase) {
+  LockFreeSkipList<std::string> list;
+  list.insert("a");
+  list.insert("b");
+  list.insert("c");
+  auto it = list.find("b");
+  list.erase("b");
+  list.erase("c");
+  // The erased element stays readable while the iterator points to it
+  EXPECT_EQ("b", *it);
+  ++it;
+  EXPECT_EQ(list.end(), it);
+  it = list.find("a");
+  auto copy = it;
+  list.erase("a");
+  EXPECT_EQ("a", *copy);
+  EXPECT_EQ(list.end(), ++copy);
+}
+
+TEST(LockFreeSkipList, InsertSorted) {
+  LockFreeSkipList<int> list;
+  list.insert(5);
+  list.insert(500);
+  std::vector<int> run;
+  for (int i = 0; i < 1000; ++i) {
+    run.push_back(i);
+  }
+  EXPECT_EQ(998, list.insertSorted(run.begin(), run.end()));
+  EXPECT_EQ(1000, list.size());
+  std::vector<int> elems(list.begin(), list.end());
+  EXPECT_EQ(run, elems);
+
+  // Unsorted input is slower but still correct
+  std::vector<int> shuffled;
+  for (int i = 2000; i > 1000; --i) {
+    shuffled.push_back(i);
+  }
+  EXPECT_EQ(1000, list.insertSorted(shuffled.begin(), shuffled.end()));
+  EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+  EXPECT_EQ(2000, std::distance(list.begin(), list.end()));
+}
+
+namespace {
+
+std::atomic<int> constructed;
+std::atomic<int> destroyed;
+
+struct Counted {
+  explicit Counted(int v) : value(v) {
+    ++constructed;
+  }
+  Counted(const Counted& other) : value(other.value) {
+    ++constructed;
+  }
+  ~Counted() {
+    ++destroyed;
+  }
+  bool operator<(const Counted& other) const {
+    return value < other.value;
+  }
+  int value;
+};
+
+} // namespace
+
+TEST(LockFreeSkipList, ReclaimsWhileIterating) {
+  constructed = 0;
+  destroyed = 0;
+  {
+    LockFreeSkipList<Counted> list;
+    list.insert(Counted(0));
+    // A long-lived iterator only holds back its own element
+    auto it = list.begin();
+    for (int i = 1; i < 100000; ++i) {
+      list.insert(Counted(i));
+      list.erase(Counted(i));
+    }
+    EXPECT_EQ(0, it->value);
+    EXPECT_LT(constructed - destroyed, 10000);
+  }
+  EXPECT_EQ(constructed, destroyed);
+}
+
+TEST(LockFreeSkipList, Concurrent) {
+  LockFreeSkipList<int> list;
+  constexpr int kThreads = 4;
+  constexpr int kKeys = 2000;
+  std::atomic<int> done(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20000; ++i) {
+        int key = folly::Random::rand32(kKeys);
+        switch (folly::Random::rand32(4)) {
+          case 0:
+          case 1:
+            list.insert(key);
+            break;
+          case 2:
+            list.erase(key);
+            break;
+          default: {
+            int last = -1;
+            int n = 0;
+            for (auto it = list.lower_bound(key); it != list.end() && n < 20;
+                 ++it, ++n) {
+              EXPECT_LT(last, *it);
+              last = *it;
+            }
+          }
+        }
+      }
+      // Then each thread settles its own keys: even ones in, odd ones out
+      ++done;
+      while (done.load() < kThreads) {
+        std::this_thread::yield();
+      }
+      for (int key = t; key < kKeys; key += kThreads) {
+        if (key % 2 == 0) {
+          list.insert(key);
+        } else {
+          list.erase(key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::vector<int> expected;
+  for (int key = 0; key < kKeys; key += 2) {
+    expected.push_back(key);
+  }
+  std::vector<int> elems(list.begin(), list.end());
+  EXPECT_EQ(expected, elems);
+  EXPECT_EQ(expected.size(), list.size());
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/concurrency/MultiQueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(MultiQueue, Empty) {
+  MultiQueue<int> q(4);
+  int v;
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(0, q.size());
+  EXPECT_FALSE(q.tryPop(v));
+}
+
+TEST(MultiQueue, PopsEverything) {
+  MultiQueue<int, int> q(4);
+  for (int i = 0; i < 1000; ++i) {
+    q.push(i, (i * 37) % 100);
+  }
+  EXPECT_EQ(1000, q.size());
+  std::vector<int> out;
+  int v;
+  int priority;
+  while (q.tryPop(v, priority)) {
+    EXPECT_EQ((v * 37) % 100, priority);
+    out.push_back(v);
+  }
+  ASSERT_EQ(1000, out.size());
+  std::sort(out.begin(), out.end());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i, out[i]);
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MultiQueue, RoughlyOrdered) {
+  const size_t kShards = 8;
+  const int kN = 10000;
+  MultiQueue<int, int> q(kShards);
+  for (int i = 0; i < kN; ++i) {
+    q.push(i, i);
+  }
+  // The first pops must come from the top few percent
+  int v;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(q.tryPop(v));
+    EXPECT_GT(v, kN - 1000);
+  }
+}
+
+TEST(MultiQueue, Compare) {
+  // A min-queue
+  MultiQueue<int, int, std::greater<int>> q(2);
+  q.push(3, 3);
+  q.push(1, 1);
+  q.push(2, 2);
+  int v;
+  int sum = 0;
+  while (q.tryPop(v)) {
+    sum += v;
+  }
+  EXPECT_EQ(6, sum);
+}
+
+TEST(MultiQueue, MoveOnly) {
+  MultiQueue<std::unique_ptr<int>> q(4);
+  q.push(std::make_unique<int>(42));
+  std::unique_ptr<int> p;
+  ASSERT_TRUE(q.tryPop(p));
+  EXPECT_EQ(42, *p);
+}
+
+TEST(MultiQueue, PushedBeforePopIsFound) {
+  MultiQueue<int> q(64);
+  int v;
+  for (int i = 0; i < 1000; ++i) {
+    q.push(i);
+    ASSERT_TRUE(q.tryPop(v));
+    EXPECT_EQ(i, v);
+    EXPECT_FALSE(q.tryPop(v));
+  }
+}
+
+TEST(MultiQueue, Concurrent) {
+  const int kProducers = 4;
+  const int kConsumers = 4;
+  const int kPerProducer = 20000;
+  MultiQueue<int> q;
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kProducers; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 1; i <= kPerProducer; ++i) {
+        q.push(i, (i + t) % 7);
+      }
+    });
+  }
+  for (int t = 0; t < kConsumers; ++t) {
+    threads.emplace_back([&] {
+      int v;
+      while (popped.load() < kProducers * kPerProducer) {
+        if (q.tryPop(v)) {
+          sum += v;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(kProducers * kPerProducer, popped.load());
+  EXPECT_EQ(
+      int64_t(kProducers) * kPerProducer * (kPerProducer + 1) / 2, sum.load());
+  EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/concurrency/SPSCRingBuffer.h>
+
+#include <sched.h>
+#include <sys/wait.h>
+
+#include <thread>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Unistd.h>
+
+using namespace folly;
+
+TEST(SPSCRingBuffer, Basic) {
+  SPSCRingBuffer<int> ring(5);
+  EXPECT_EQ(8, ring.capacity());
+  EXPECT_TRUE(ring.isEmpty());
+
+  int v;
+  EXPECT_FALSE(ring.read(v));
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(ring.write(i));
+  }
+  EXPECT_FALSE(ring.write(8));
+  EXPECT_EQ(8, ring.sizeGuess());
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(ring.read(v));
+    EXPECT_EQ(i, v);
+  }
+  EXPECT_FALSE(ring.read(v));
+  EXPECT_THROW(SPSCRingBuffer<int>(0), std::invalid_argument);
+}
+
+TEST(SPSCRingBuffer, Batches) {
+  SPSCRingBuffer<int> ring(8);
+  std::vector<int> in = {0, 1, 2, 3, 4, 5};
+  std::vector<int> out(8);
+  EXPECT_EQ(6, ring.write(in.data(), in.size()));
+  EXPECT_EQ(4, ring.read(out.data(), 4));
+  // Wraps around
+  EXPECT_EQ(6, ring.write(in.data(), in.size()));
+  EXPECT_EQ(0, ring.write(in.data(), in.size()));
+  EXPECT_EQ(8, ring.read(out.data(), out.size()));
+  EXPECT_EQ((std::vector<int>{4, 5, 0, 1, 2, 3, 4, 5}), out);
+  EXPECT_EQ(0, ring.read(out.data(), out.size()));
+}
+
+TEST(SPSCRingBuffer, Spans) {
+  SPSCRingBuffer<int> ring(8);
+  auto w = ring.writableSpan(6);
+  ASSERT_EQ(6, w.size());
+  for (int i = 0; i < 6; ++i) {
+    w[i] = i;
+  }
+  // Nothing is visible until committed
+  EXPECT_TRUE(ring.readableSpan().empty());
+  ring.commitWrite(6);
+
+  auto r = ring.readableSpan();
+  ASSERT_EQ(6, r.size());
+  EXPECT_EQ(5, r[5]);
+  ring.commitRead(5);
+
+  // The free slots wrap: the first span stops at the end of the ring
+  EXPECT_EQ(2, ring.writableSpan().size());
+  ring.commitWrite(2);
+  EXPECT_EQ(5, ring.writableSpan().size());
+  EXPECT_EQ(3, ring.readableSpan().size());
+}
+
+TEST(SPSCRingBuffer, Threads) {
+  const uint64_t kN = 100000;
+  SPSCRingBuffer<uint64_t> ring(1000);
+  std::thread producer([&] {
+    uint64_t next = 0;
+    while (next < kN) {
+      auto span = ring.writableSpan(kN - next);
+      if (span.empty()) {
+        std::this_thread::yield();
+      }
+      for (auto& slot : span) {
+        slot = next++;
+      }
+      ring.commitWrite(span.size());
+    }
+  });
+  uint64_t expected = 0;
+  uint64_t buf[37];
+  while (expected < kN) {
+    auto n = ring.read(buf, 37);
+    if (n == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(expected++, buf[i]);
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ring.isEmpty());
+}
+
+TEST(SPSCRingBuffer, Attach) {
+  File f = File::temporary();
+  auto size = SPSCRingBuffer<int>::mappingSize(16);
+  auto producer = SPSCRingBuffer<int>::create(
+      MemoryMapping(File(f.fd()), 0, size, MemoryMapping::writable()), 16);
+  EXPECT_TRUE(producer.write(42));
+
+  auto consumer = SPSCRingBuffer<int>::attach(
+      MemoryMapping(File(f.fd()), 0, size, MemoryMapping::writable()));
+  EXPECT_EQ(16, consumer.capacity());
+  int v;
+  ASSERT_TRUE(consumer.read(v));
+  EXPECT_EQ(42, v);
+  EXPECT_TRUE(producer.isEmpty());
+
+  EXPECT_THROW(
+      SPSCRingBuffer<int64_t>::attach(
+          MemoryMapping(File(f.fd()), 0, size, MemoryMapping::writable())),
+      std::invalid_argument);
+  EXPECT_THROW(
+      SPSCRingBuffer<int>::create(
+          MemoryMapping(File(f.fd()), 0, size, MemoryMapping::writable()),
+          32),
+      std::invalid_argument);
+}
+
+TEST(SPSCRingBuffer, AcrossFork) {
+  const uint64_t kN = 10000;
+  auto ring = SPSCRingBuffer<uint64_t>::create(
+      MemoryMapping(
+          MemoryMapping::kAnonymous,
+          SPSCRingBuffer<uint64_t>::mappingSize(256),
+          MemoryMapping::Options().setWritable(true)),
+      256);
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    for (uint64_t i = 0; i < kN;) {
+      if (ring.write(i)) {
+        ++i;
+      } else {
+        sched_yield();
+      }
+    }
+    _exit(0);
+  }
+  uint64_t v;
+  for (uint64_t expected = 0; expected < kN;) {
+    if (ring.read(v)) {
+      ASSERT_EQ(expected++, v);
+    } else {
+      sched_yield();
+    }
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
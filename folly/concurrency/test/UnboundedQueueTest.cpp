@@ -0,0 +1,214 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/UnboundedQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+// Small segments, so that the tests cross many segment boundaries
+template <typename T, bool SP, bool SC, bool MayBlock>
+using Queue = UnboundedQueue<T, SP, SC, MayBlock, 2>;
+
+template <bool SP, bool SC, bool MayBlock>
+void basicTest() {
+  Queue<int, SP, SC, MayBlock> q;
+  EXPECT_TRUE(q.empty());
+  int v = -1;
+  EXPECT_FALSE(q.try_dequeue(v));
+  EXPECT_EQ(-1, v);
+
+  for (int i = 0; i < 100; ++i) {
+    q.enqueue(i);
+    EXPECT_EQ(size_t(i + 1), q.size());
+  }
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 == 0) {
+      EXPECT_EQ(i, q.dequeue());
+    } else if (i % 3 == 1) {
+      q.dequeue(v);
+      EXPECT_EQ(i, v);
+    } else {
+      EXPECT_TRUE(q.try_dequeue(v));
+      EXPECT_EQ(i, v);
+    }
+  }
+  EXPECT_TRUE(q.empty());
+  EXPECT_FALSE(q.try_dequeue(v));
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void timeoutTest() {
+  Queue<int, SP, SC, MayBlock> q;
+  int v = -1;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(q.try_dequeue_for(v, std::chrono::milliseconds(20)));
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  EXPECT_FALSE(q.try_dequeue_until(
+      v, std::chrono::system_clock::now() + std::chrono::milliseconds(1)));
+  EXPECT_EQ(-1, v);
+
+  // A consumer waiting in try_dequeue_for() is woken by the producer
+  std::thread producer([&] {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.enqueue(7);
+  });
+  EXPECT_TRUE(q.try_dequeue_for(v, std::chrono::seconds(10)));
+  EXPECT_EQ(7, v);
+  producer.join();
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void concurrentTest() {
+  const int numProducers = SP ? 1 : 4;
+  const int numConsumers = SC ? 1 : 4;
+  const int numOps = 10000;
+  Queue<int, SP, SC, MayBlock> q;
+  std::atomic<int64_t> sum{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < numProducers; ++p) {
+    threads.emplace_back([&] {
+      for (int i = 1; i <= numOps; ++i) {
+        q.enqueue(i);
+      }
+    });
+  }
+  const int perConsumer = numOps * numProducers / numConsumers;
+  for (int c = 0; c < numConsumers; ++c) {
+    threads.emplace_back([&, c] {
+      int64_t local = 0;
+      for (int i = 0; i < perConsumer; ++i) {
+        int v;
+        // Mix the blocking and the non-blocking ways of dequeuing
+        if ((i + c) % 2 == 0) {
+          v = q.dequeue();
+        } else {
+          while (!q.try_dequeue_for(v, std::chrono::milliseconds(1))) {
+          }
+        }
+        local += v;
+      }
+      sum += local;
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(int64_t(numProducers) * numOps * (numOps + 1) / 2, sum.load());
+  EXPECT_TRUE(q.empty());
+}
+
+template <bool SP, bool SC, bool MayBlock>
+void runTests() {
+  basicTest<SP, SC, MayBlock>();
+  timeoutTest<SP, SC, MayBlock>();
+  concurrentTest<SP, SC, MayBlock>();
+}
+
+} // namespace
+
+TEST(UnboundedQueue, spsc) {
+  runTests<true, true, false>();
+  runTests<true, true, true>();
+}
+
+TEST(UnboundedQueue, mpsc) {
+  runTests<false, true, false>();
+  runTests<false, true, true>();
+}
+
+TEST(UnboundedQueue, spmc) {
+  runTests<true, false, false>();
+  runTests<true, false, true>();
+}
+
+TEST(UnboundedQueue, mpmc) {
+  runTests<false, false, false>();
+  runTests<false, false, true>();
+}
+
+TEST(UnboundedQueue, aliases) {
+  USPSCQueue<int, false> spsc;
+  UMPSCQueue<int, true> mpsc;
+  USPMCQueue<int, false, 4> spmc;
+  UMPMCQueue<int, true, 4> mpmc;
+  spsc.enqueue(1);
+  mpsc.enqueue(2);
+  spmc.enqueue(3);
+  mpmc.enqueue(4);
+  EXPECT_EQ(1, spsc.dequeue());
+  EXPECT_EQ(2, mpsc.dequeue());
+  EXPECT_EQ(3, spmc.dequeue());
+  EXPECT_EQ(4, mpmc.dequeue());
+}
+
+TEST(UnboundedQueue, moveOnly) {
+  UMPMCQueue<std::unique_ptr<int>, true, 2> q;
+  for (int i = 0; i < 10; ++i) {
+    q.enqueue(std::make_unique<int>(i));
+  }
+  for (int i = 0; i < 10; ++i) {
+    std::unique_ptr<int> p;
+    EXPECT_TRUE(q.try_dequeue(p));
+    EXPECT_EQ(i, *p);
+  }
+}
+
+TEST(UnboundedQueue, destructorFreesElements) {
+  auto p = std::make_shared<int>(0);
+  {
+    UMPMCQueue<std::shared_ptr<int>, false, 2> q;
+    for (int i = 0; i < 10; ++i) {
+      q.enqueue(p);
+    }
+    q.dequeue();
+    EXPECT_EQ(10, p.use_count());
+  }
+  EXPECT_EQ(1, p.use_count());
+}
+
+TEST(UnboundedQueue, consumersAhead) {
+  // Consumers waiting on tickets several segments ahead of the producer
+  UMPMCQueue<int, true, 2> q;
+  const int numConsumers = 20;
+  std::atomic<int> sum{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < numConsumers; ++i) {
+    consumers.emplace_back([&] { sum += q.dequeue(); });
+  }
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  for (int i = 1; i <= numConsumers; ++i) {
+    q.enqueue(i);
+  }
+  for (auto& t : consumers) {
+    t.join();
+  }
+  EXPECT_EQ(numConsumers * (numConsumers + 1) / 2, sum.load());
+  EXPECT_TRUE(q.empty());
+}
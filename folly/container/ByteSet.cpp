@@ -0,0 +1,200 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ByteSet.h>
+
+#include <string>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+namespace folly {
+
+size_t ByteSet::size() const {
+  size_t n = 0;
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 16; ++j) {
+      n += size_t(popcount(tables_[i][j]));
+    }
+  }
+  return n;
+}
+
+namespace detail {
+
+namespace {
+
+inline bool tableContains(const uint8_t* tables, uint8_t b) {
+  return (tables[(b >> 7) * 16 + (b & 15)] >> ((b >> 4) & 7)) & 1;
+}
+
+size_t
+findScalar(const uint8_t* tables, const char* data, size_t size, bool in) {
+  for (size_t i = 0; i < size; ++i) {
+    if (tableContains(tables, uint8_t(data[i])) == in) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+#if FOLLY_X64
+
+// match(p) returns a mask of the kWidth bytes from p, with bit i set iff
+// p[i] is in the set.
+
+struct Ssse3Matcher {
+  static constexpr size_t kWidth = 16;
+
+  FOLLY_TARGET_ATTRIBUTE("ssse3")
+  explicit Ssse3Matcher(const uint8_t* tables)
+      : lo_(_mm_load_si128(reinterpret_cast<const __m128i*>(tables))),
+        hi_(_mm_load_si128(reinterpret_cast<const __m128i*>(tables + 16))) {}
+
+  FOLLY_TARGET_ATTRIBUTE("ssse3")
+  uint32_t match(const char* p) const {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // PSHUFB zeroes the bytes whose index has bit 7 set, so each table
+    // only answers for its half of the bytes
+    __m128i idx = _mm_and_si128(v, _mm_set1_epi8(char(0x8f)));
+    __m128i cols = _mm_or_si128(
+        _mm_shuffle_epi8(lo_, idx),
+        _mm_shuffle_epi8(
+            hi_, _mm_xor_si128(idx, _mm_set1_epi8(char(0x80)))));
+    __m128i row = _mm_shuffle_epi8(
+        _mm_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128),
+        _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f)));
+    __m128i eq = _mm_cmpeq_epi8(_mm_and_si128(cols, row), row);
+    return uint32_t(_mm_movemask_epi8(eq));
+  }
+
+  __m128i lo_;
+  __m128i hi_;
+};
+
+struct Avx2Matcher {
+  static constexpr size_t kWidth = 32;
+
+  // VPSHUFB shuffles each 128-bit lane separately, so the tables are in
+  // both lanes
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  explicit Avx2Matcher(const uint8_t* tables)
+      : lo_(_mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(tables)))),
+        hi_(_mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(tables + 16)))) {}
+
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  uint32_t match(const char* p) const {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i idx = _mm256_and_si256(v, _mm256_set1_epi8(char(0x8f)));
+    __m256i cols = _mm256_or_si256(
+        _mm256_shuffle_epi8(lo_, idx),
+        _mm256_shuffle_epi8(
+            hi_, _mm256_xor_si256(idx, _mm256_set1_epi8(char(0x80)))));
+    __m256i row = _mm256_shuffle_epi8(
+        _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128),
+        _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f)));
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_and_si256(cols, row), row);
+    return uint32_t(_mm256_movemask_epi8(eq));
+  }
+
+  __m256i lo_;
+  __m256i hi_;
+};
+
+constexpr size_t Ssse3Matcher::kWidth;
+constexpr size_t Avx2Matcher::kWidth;
+
+template <class Matcher>
+FOLLY_ALWAYS_INLINE size_t
+findImpl(const Matcher& m, const char* data, size_t size, bool in) {
+  constexpr size_t kWidth = Matcher::kWidth;
+  const uint32_t flip = in ? 0 : uint32_t((uint64_t(1) << kWidth) - 1);
+  size_t i = 0;
+  for (; i + kWidth <= size; i += kWidth) {
+    uint32_t mask = m.match(data + i) ^ flip;
+    if (mask != 0) {
+      return i + findFirstSet(mask) - 1;
+    }
+  }
+  if (i < size) {
+    // The last kWidth bytes, ignoring those already searched
+    size_t last = size - kWidth;
+    uint32_t mask = (m.match(data + last) ^ flip) >> (i - last);
+    if (mask != 0) {
+      return i + findFirstSet(mask) - 1;
+    }
+  }
+  return std::string::npos;
+}
+
+FOLLY_TARGET_ATTRIBUTE("ssse3")
+size_t
+findSsse3(const uint8_t* tables, const char* data, size_t size, bool in) {
+  if (size < Ssse3Matcher::kWidth) {
+    return findScalar(tables, data, size, in);
+  }
+  return findImpl(Ssse3Matcher(tables), data, size, in);
+}
+
+FOLLY_TARGET_ATTRIBUTE("avx2")
+size_t
+findAvx2(const uint8_t* tables, const char* data, size_t size, bool in) {
+  if (size < Avx2Matcher::kWidth) {
+    return findSsse3(tables, data, size, in);
+  }
+  return findImpl(Avx2Matcher(tables), data, size, in);
+}
+
+#endif
+
+using FindFn = size_t (*)(const uint8_t*, const char*, size_t, bool);
+
+FindFn chooseFind() {
+#if FOLLY_X64
+  CpuId cpu;
+  if (cpu.avx2()) {
+    return findAvx2;
+  }
+  if (cpu.ssse3()) {
+    return findSsse3;
+  }
+#endif
+  return findScalar;
+}
+
+} // namespace
+
+size_t byteSetFindFirst(
+    const uint8_t* tables,
+    const char* data,
+    size_t size,
+    bool in) {
+  static const FindFn find = chooseFind();
+  return find(tables, data, size, in);
+}
+
+} // namespace detail
+} // namespace folly
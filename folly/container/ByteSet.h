@@ -0,0 +1,180 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+namespace detail {
+
+// The search loops of ByteSet, 16 (SSSE3) or 32 (AVX2) bytes at a time
+// where the CPU has them.
+size_t byteSetFindFirst(
+    const uint8_t* tables,
+    const char* data,
+    size_t size,
+    bool in);
+
+} // namespace detail
+
+/***
+ *  ByteSet
+ *
+ *  A set of bytes, compiled into lookup tables for finding the first byte
+ *  of a buffer that is (or isn't) in the set, 16 or 32 bytes at a time: the
+ *  delimiters of a tokenizer, the bytes that must be escaped, the bytes of
+ *  a character class.
+ *
+ *  The tables are the 256 bits of the set, arranged for PSHUFB: entry j of
+ *  the first table has bit h set iff byte (h << 4 | j) is in the set, for
+ *  h < 8, and the second table has the bytes with h >= 8. For 16 bytes of
+ *  input, two shuffles by their low nibbles find the bits of their columns,
+ *  and a third one by their high nibbles picks each byte's row.
+ *
+ *  Unlike SparseByteSet, construction touches all 32 bytes, so build a
+ *  ByteSet once (they are cheap to copy) and search with it many times.
+ *
+ *  Operations:
+ *  - add(byte), add(bytes), addRange(first, last), contains(byte)
+ *  - find_first_in(haystack), find_first_not_in(haystack)
+ *  - ~, |, & on sets
+ */
+class ByteSet {
+ public:
+  ByteSet() {
+    std::memset(tables_, 0, sizeof(tables_));
+  }
+
+  explicit ByteSet(StringPiece bytes) : ByteSet() {
+    add(bytes);
+  }
+
+  /// The bytes from first to last, inclusive.
+  static ByteSet range(uint8_t first, uint8_t last) {
+    ByteSet s;
+    s.addRange(first, last);
+    return s;
+  }
+
+  /// The bytes for which pred(char) is true, e.g. a character class:
+  /// ByteSet::fromPredicate([](char c) { return std::isalnum(c); })
+  template <class Pred>
+  static ByteSet fromPredicate(Pred pred) {
+    ByteSet s;
+    for (unsigned b = 0; b < 256; ++b) {
+      if (pred(char(b))) {
+        s.add(uint8_t(b));
+      }
+    }
+    return s;
+  }
+
+  void add(uint8_t b) {
+    tables_[b >> 7][b & 15] |= uint8_t(1u << ((b >> 4) & 7));
+  }
+
+  void add(StringPiece bytes) {
+    for (auto c : bytes) {
+      add(uint8_t(c));
+    }
+  }
+
+  void addRange(uint8_t first, uint8_t last) {
+    for (unsigned b = first; b <= last; ++b) {
+      add(uint8_t(b));
+    }
+  }
+
+  bool contains(uint8_t b) const {
+    return (tables_[b >> 7][b & 15] >> ((b >> 4) & 7)) & 1;
+  }
+
+  /// The number of bytes in the set.
+  size_t size() const;
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /// The index of the first byte of haystack that is in the set, or
+  /// StringPiece::npos.
+  size_t find_first_in(StringPiece haystack) const {
+    return detail::byteSetFindFirst(
+        &tables_[0][0], haystack.data(), haystack.size(), true);
+  }
+
+  /// The index of the first byte of haystack that isn't in the set, or
+  /// StringPiece::npos.
+  size_t find_first_not_in(StringPiece haystack) const {
+    return detail::byteSetFindFirst(
+        &tables_[0][0], haystack.data(), haystack.size(), false);
+  }
+
+  ByteSet operator~() const {
+    ByteSet s;
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t j = 0; j < 16; ++j) {
+        s.tables_[i][j] = uint8_t(~tables_[i][j]);
+      }
+    }
+    return s;
+  }
+
+  ByteSet& operator|=(const ByteSet& other) {
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t j = 0; j < 16; ++j) {
+        tables_[i][j] |= other.tables_[i][j];
+      }
+    }
+    return *this;
+  }
+
+  ByteSet& operator&=(const ByteSet& other) {
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t j = 0; j < 16; ++j) {
+        tables_[i][j] &= other.tables_[i][j];
+      }
+    }
+    return *this;
+  }
+
+  friend ByteSet operator|(ByteSet a, const ByteSet& b) {
+    return a |= b;
+  }
+
+  friend ByteSet operator&(ByteSet a, const ByteSet& b) {
+    return a &= b;
+  }
+
+  friend bool operator==(const ByteSet& a, const ByteSet& b) {
+    return std::memcmp(a.tables_, b.tables_, sizeof(a.tables_)) == 0;
+  }
+
+  friend bool operator!=(const ByteSet& a, const ByteSet& b) {
+    return !(a == b);
+  }
+
+ private:
+  alignas(16) uint8_t tables_[2][16];
+};
+
+} // namespace folly
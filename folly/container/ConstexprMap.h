@@ -0,0 +1,299 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <folly/Portability.h>
+#include <folly/Range.h>
+#include <folly/Utility.h>
+
+namespace folly {
+
+namespace detail {
+namespace constexpr_map {
+
+// FNV-1a, as it is simple enough to run in constant expressions
+FOLLY_CPP14_CONSTEXPR uint64_t hashKey(StringPiece key) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (std::size_t i = 0; i < key.size(); ++i) {
+    h = (h ^ uint8_t(key.data()[i])) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// The hash of a key with seed (by the MurmurHash3 finalizer)
+FOLLY_CPP14_CONSTEXPR uint64_t mix(uint64_t h, uint32_t seed) {
+  h ^= uint64_t(seed) * 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+  h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+  return h ^ (h >> 33);
+}
+
+// At most half of the slots are used, so that the seed of a bucket is found
+// in a few tries
+constexpr std::size_t slotCount(std::size_t n, std::size_t s = 1) {
+  return s >= 2 * n ? s : slotCount(n, 2 * s);
+}
+
+template <std::size_t N>
+struct Hashes {
+  uint64_t values[N];
+};
+
+template <std::size_t... Is>
+constexpr Hashes<sizeof...(Is)> hashKeys(
+    const StringPiece* keys,
+    index_sequence<Is...>) {
+  return {{hashKey(keys[Is])...}};
+}
+
+/**
+ * A perfect hash of N keys, by hash and displace: a key is in bucket
+ * mix(h, 0) % N, and the keys of bucket b are in slots mix(h, seeds[b]),
+ * with seeds chosen, the largest buckets first, so that no two keys share a
+ * slot.
+ */
+template <std::size_t N>
+struct Table {
+  static constexpr std::size_t kSlots = slotCount(N);
+  static constexpr uint32_t kMaxSeed = 1u << 16;
+
+  uint32_t seeds[N];
+  // The index of the key in each slot, or N
+  uint32_t slots[kSlots];
+
+  FOLLY_CPP14_CONSTEXPR std::size_t slotOf(uint64_t h) const {
+    return mix(h, seeds[mix(h, 0) % N]) & (kSlots - 1);
+  }
+};
+
+template <std::size_t N>
+FOLLY_CPP14_CONSTEXPR Table<N> buildTable(const Hashes<N>& hashes) {
+  constexpr std::size_t kSlots = Table<N>::kSlots;
+  const uint64_t* h = hashes.values;
+  Table<N> table{};
+  for (std::size_t s = 0; s < kSlots; ++s) {
+    table.slots[s] = uint32_t(N);
+  }
+
+  // The keys of each bucket, together in members
+  std::size_t bucket[N] = {};
+  std::size_t count[N] = {};
+  std::size_t begin[N + 1] = {};
+  std::size_t members[N] = {};
+  std::size_t maxCount = 0;
+  for (std::size_t i = 0; i < N; ++i) {
+    bucket[i] = mix(h[i], 0) % N;
+    ++count[bucket[i]];
+  }
+  for (std::size_t b = 0; b < N; ++b) {
+    begin[b + 1] = begin[b] + count[b];
+    maxCount = count[b] > maxCount ? count[b] : maxCount;
+  }
+  std::size_t end[N + 1] = {};
+  for (std::size_t b = 0; b <= N; ++b) {
+    end[b] = begin[b];
+  }
+  for (std::size_t i = 0; i < N; ++i) {
+    members[end[bucket[i]]++] = i;
+  }
+
+  std::size_t slot[N] = {};
+  for (std::size_t c = maxCount; c > 0; --c) {
+    for (std::size_t b = 0; b < N; ++b) {
+      if (count[b] != c) {
+        continue;
+      }
+      bool placed = false;
+      for (uint32_t seed = 1; !placed && seed < Table<N>::kMaxSeed; ++seed) {
+        placed = true;
+        for (std::size_t j = begin[b]; placed && j < begin[b + 1]; ++j) {
+          slot[j] = mix(h[members[j]], seed) & (kSlots - 1);
+          placed = table.slots[slot[j]] == N;
+          for (std::size_t k = begin[b]; placed && k < j; ++k) {
+            if (h[members[k]] == h[members[j]]) {
+              throw std::logic_error("ConstexprMap: duplicate key");
+            }
+            placed = slot[k] != slot[j];
+          }
+        }
+        if (placed) {
+          table.seeds[b] = seed;
+          for (std::size_t j = begin[b]; j < begin[b + 1]; ++j) {
+            table.slots[slot[j]] = uint32_t(members[j]);
+          }
+        }
+      }
+      if (!placed) {
+        throw std::logic_error("ConstexprMap: no perfect hash found");
+      }
+    }
+  }
+  return table;
+}
+
+template <std::size_t N>
+constexpr std::size_t Table<N>::kSlots;
+template <std::size_t N>
+constexpr uint32_t Table<N>::kMaxSeed;
+
+} // namespace constexpr_map
+} // namespace detail
+
+/**
+ *  ConstexprSet
+ *
+ *  A set of N strings known at compile time, e.g. the names of the headers
+ *  or of the commands that some code handles specially, built into a
+ *  perfect hash table by the compiler:
+ *
+ *    constexpr auto kCommands = makeConstexprSet({"get", "set", "delete"});
+ *    switch (kCommands.find(command)) {
+ *      case 0: // get
+ *      ...
+ *    }
+ *
+ *  A lookup hashes the key once, looks at a single slot and compares the
+ *  key with the one in it, so it doesn't get slower with N, unlike an
+ *  if-chain, and doesn't chase pointers like a runtime hash map.
+ *
+ *  The keys are kept as StringPieces, so they must outlive the set: string
+ *  literals, or FixedStrings with static storage duration. Duplicate keys
+ *  fail the construction (at compile time for a constexpr set).
+ */
+template <std::size_t N>
+class ConstexprSet {
+  static_assert(N > 0, "ConstexprSet: at least one key is needed");
+
+ public:
+  static constexpr std::size_t npos = std::size_t(-1);
+
+  explicit constexpr ConstexprSet(const StringPiece (&keys)[N])
+      : ConstexprSet(keys, make_index_sequence<N>{}) {}
+
+  constexpr std::size_t size() const {
+    return N;
+  }
+
+  /// The i-th key, in the order the set was built from.
+  constexpr StringPiece operator[](std::size_t i) const {
+    return keys_[i];
+  }
+
+  /// The index of key in the order the set was built from, or npos.
+  std::size_t find(StringPiece key) const {
+    auto h = detail::constexpr_map::hashKey(key);
+    auto i = table_.slots[table_.slotOf(h)];
+    if (i == N || keys_[i].size() != key.size() ||
+        (!key.empty() &&
+         std::memcmp(keys_[i].data(), key.data(), key.size()) != 0)) {
+      return npos;
+    }
+    return i;
+  }
+
+  bool contains(StringPiece key) const {
+    return find(key) != npos;
+  }
+
+ private:
+  template <std::size_t... Is>
+  constexpr ConstexprSet(const StringPiece (&keys)[N], index_sequence<Is...>)
+      : keys_{keys[Is]...},
+        table_(detail::constexpr_map::buildTable<N>(
+            detail::constexpr_map::hashKeys(keys, index_sequence<Is...>{}))) {
+  }
+
+  StringPiece keys_[N];
+  detail::constexpr_map::Table<N> table_;
+};
+
+template <std::size_t N>
+constexpr std::size_t ConstexprSet<N>::npos;
+
+/**
+ *  ConstexprMap
+ *
+ *  A map from N strings known at compile time to values, over a
+ *  ConstexprSet of the keys:
+ *
+ *    constexpr auto kHeaders = makeConstexprMap<HeaderCode>({
+ *        {"content-length", HeaderCode::CONTENT_LENGTH},
+ *        {"host", HeaderCode::HOST},
+ *    });
+ *    auto code = kHeaders.get_default(name, HeaderCode::OTHER);
+ *
+ *  Value must be a literal type for the map to be constexpr.
+ */
+template <class Value, std::size_t N>
+class ConstexprMap {
+ public:
+  using value_type = std::pair<StringPiece, Value>;
+
+  explicit constexpr ConstexprMap(const value_type (&entries)[N])
+      : ConstexprMap(entries, make_index_sequence<N>{}) {}
+
+  constexpr std::size_t size() const {
+    return N;
+  }
+
+  /// The value of key, or nullptr.
+  const Value* get_ptr(StringPiece key) const {
+    auto i = keys_.find(key);
+    return i == keys_.npos ? nullptr : &values_[i];
+  }
+
+  Value get_default(StringPiece key, Value dflt) const {
+    auto i = keys_.find(key);
+    return i == keys_.npos ? dflt : values_[i];
+  }
+
+  bool contains(StringPiece key) const {
+    return keys_.contains(key);
+  }
+
+  /// The set of the keys, in the order the map was built from.
+  constexpr const ConstexprSet<N>& keys() const {
+    return keys_;
+  }
+
+ private:
+  template <std::size_t... Is>
+  constexpr ConstexprMap(const value_type (&entries)[N], index_sequence<Is...>)
+      : keys_({entries[Is].first...}), values_{entries[Is].second...} {}
+
+  ConstexprSet<N> keys_;
+  Value values_[N];
+};
+
+template <std::size_t N>
+constexpr ConstexprSet<N> makeConstexprSet(const StringPiece (&keys)[N]) {
+  return ConstexprSet<N>(keys);
+}
+
+template <class Value, std::size_t N>
+constexpr ConstexprMap<Value, N> makeConstexprMap(
+    const std::pair<StringPiece, Value> (&entries)[N]) {
+  return ConstexprMap<Value, N>(entries);
+}
+
+} // namespace folly
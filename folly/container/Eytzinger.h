@@ -0,0 +1,673 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * eytzinger_set and eytzinger_map are read-only variants of
+ * sorted_vector_set and sorted_vector_map (see sorted_vector_types.h) for
+ * large sets of keys, built once and then only searched.
+ *
+ * A binary search over a sorted vector of millions of elements misses the
+ * cache on nearly every probe, and each probe depends on the previous
+ * one, so lookups wait on memory one miss at a time.  These store the
+ * elements in Eytzinger (BFS) order instead: the root, then the two
+ * elements at the quartiles, then the four at the eighths, and so on, as
+ * in an implicit binary heap.  The elements that a search may visit next
+ * are then next to each other, so the search prefetches the cache line
+ * holding all of the descendants of the current element a few levels
+ * down, and the next few probes hit the cache.  The search has no
+ * branches other than the loop, so it doesn't mispredict either.
+ *
+ * bulk_lower_bound() searches for several keys at once, interleaving the
+ * searches so that their cache misses overlap.
+ *
+ * Iteration is still in sorted order, but iterators are only
+ * bidirectional, and each step costs a few index computations.
+ *
+ * Important differences from sorted_vector_set and sorted_vector_map:
+ *   - there is no insert() or erase(); build a new one instead
+ *   - iterators are bidirectional, not random access
+ *   - the elements are only readable, except for the mapped values of
+ *     eytzinger_map
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include <folly/Bits.h>
+#include <folly/Portability.h>
+#include <folly/portability/BitsFunctexcept.h>
+#include <folly/sorted_vector_types.h>
+
+namespace folly {
+
+namespace detail {
+
+struct eytzinger_set_key {
+  template <class T>
+  const T& operator()(const T& value) const {
+    return value;
+  }
+};
+
+struct eytzinger_map_key {
+  template <class Pair>
+  const typename Pair::first_type& operator()(const Pair& value) const {
+    return value.first;
+  }
+};
+
+FOLLY_ALWAYS_INLINE void eytzingerPrefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(addr);
+#else
+  (void)addr;
+#endif
+}
+
+// The node i of the tree (1-based) is element i - 1.  Its descendants d
+// levels down are the 2^d nodes starting at i * 2^d: how many levels of
+// them fit in a cache line.
+constexpr unsigned eytzingerPrefetchLevels(std::size_t valueSize) {
+  return valueSize * 2 <= 64 ? 1 + eytzingerPrefetchLevels(valueSize * 2) : 0;
+}
+
+// The node a search that ended at node i stopped at: the last one at
+// which it went left, or 0 if it never did.
+inline std::size_t eytzingerResult(std::size_t i) {
+  return i >> findFirstSet(~i);
+}
+
+// The first node in sorted order of the subtree rooted at i; the last
+// one, with Right.
+template <bool Right>
+inline std::size_t eytzingerDescend(std::size_t i, std::size_t n) {
+  while (2 * i + Right <= n) {
+    i = 2 * i + Right;
+  }
+  return i;
+}
+
+/*
+ * The storage and lookup shared by eytzinger_set and eytzinger_map.
+ */
+template <
+    class Value,
+    class Key,
+    class KeyOfValue,
+    class Compare,
+    class Allocator,
+    bool ConstIterators>
+class eytzinger_table {
+  using Container = std::vector<Value, Allocator>;
+
+  // How far down the search prefetches; at least the children, even if
+  // they take more than a cache line
+  static constexpr unsigned kPrefetchLevels =
+      std::max(1u, eytzingerPrefetchLevels(sizeof(Value)));
+  // Searches that bulk_lower_bound() interleaves
+  static constexpr std::size_t kBulkWidth = 8;
+
+  template <class K, class V>
+  using if_is_transparent =
+      _t<sorted_vector_enable_if_is_transparent<void, Compare, K, V>>;
+
+  template <bool Const>
+  class Iterator : public boost::iterator_facade<
+                       Iterator<Const>,
+                       _t<std::conditional<Const, const Value, Value>>,
+                       std::bidirectional_iterator_tag> {
+   public:
+    Iterator() = default;
+    // Conversion from iterator to const_iterator
+    template <bool OtherConst, class = _t<std::enable_if<Const || !OtherConst>>>
+    /* implicit */ Iterator(const Iterator<OtherConst>& other)
+        : data_(other.data_), size_(other.size_), node_(other.node_) {}
+
+   private:
+    friend class eytzinger_table;
+    friend class boost::iterator_core_access;
+    template <bool>
+    friend class Iterator;
+
+    using Pointer = _t<std::conditional<Const, const Value*, Value*>>;
+
+    Iterator(Pointer data, std::size_t size, std::size_t node)
+        : data_(data), size_(size), node_(node) {}
+
+    auto& dereference() const {
+      return data_[node_ - 1];
+    }
+
+    template <bool OtherConst>
+    bool equal(const Iterator<OtherConst>& other) const {
+      return node_ == other.node_;
+    }
+
+    void increment() {
+      if (2 * node_ + 1 <= size_) {
+        node_ = eytzingerDescend<false>(2 * node_ + 1, size_);
+      } else {
+        // Up past the ancestors of which this is in the right subtree
+        node_ = eytzingerResult(node_);
+      }
+    }
+
+    void decrement() {
+      if (node_ == 0) {
+        node_ = eytzingerDescend<true>(1, size_);
+      } else if (2 * node_ <= size_) {
+        node_ = eytzingerDescend<true>(2 * node_, size_);
+      } else {
+        node_ >>= findFirstSet(node_);
+      }
+    }
+
+    Pointer data_{nullptr};
+    std::size_t size_{0};
+    // 1-based; 0 for end()
+    std::size_t node_{0};
+  };
+
+ public:
+  typedef Value value_type;
+  typedef Key key_type;
+  typedef Compare key_compare;
+  typedef Allocator allocator_type;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef Iterator<ConstIterators> iterator;
+  typedef Iterator<true> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  explicit eytzinger_table(
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : m_(comp, alloc) {}
+
+  template <class InputIterator>
+  eytzinger_table(
+      InputIterator first,
+      InputIterator last,
+      const Compare& comp,
+      const Allocator& alloc)
+      : m_(comp, alloc) {
+    Container sorted(first, last, alloc);
+    build(sorted);
+  }
+
+  eytzinger_table(Container&& container, const Compare& comp)
+      : m_(comp, container.get_allocator()) {
+    build(container);
+  }
+
+  key_compare key_comp() const {
+    return m_;
+  }
+
+  iterator begin() {
+    return makeIterator(empty() ? 0 : eytzingerDescend<false>(1, size()));
+  }
+  iterator end() {
+    return makeIterator(0);
+  }
+  const_iterator begin() const {
+    return makeIterator(empty() ? 0 : eytzingerDescend<false>(1, size()));
+  }
+  const_iterator end() const {
+    return makeIterator(0);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_type size() const {
+    return m_.cont_.size();
+  }
+  size_type max_size() const {
+    return m_.cont_.max_size();
+  }
+  bool empty() const {
+    return m_.cont_.empty();
+  }
+  void clear() {
+    m_.cont_.clear();
+  }
+
+  iterator find(const key_type& key) {
+    return makeIterator(findNode(key));
+  }
+
+  const_iterator find(const key_type& key) const {
+    return makeIterator(findNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, iterator> find(const K& key) {
+    return makeIterator(findNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, const_iterator> find(const K& key) const {
+    return makeIterator(findNode(key));
+  }
+
+  size_type count(const key_type& key) const {
+    return findNode(key) == 0 ? 0 : 1;
+  }
+
+  template <class K>
+  if_is_transparent<K, size_type> count(const K& key) const {
+    return findNode(key) == 0 ? 0 : 1;
+  }
+
+  iterator lower_bound(const key_type& key) {
+    return makeIterator(lowerBoundNode(key));
+  }
+
+  const_iterator lower_bound(const key_type& key) const {
+    return makeIterator(lowerBoundNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, iterator> lower_bound(const K& key) {
+    return makeIterator(lowerBoundNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, const_iterator> lower_bound(const K& key) const {
+    return makeIterator(lowerBoundNode(key));
+  }
+
+  iterator upper_bound(const key_type& key) {
+    return makeIterator(upperBoundNode(key));
+  }
+
+  const_iterator upper_bound(const key_type& key) const {
+    return makeIterator(upperBoundNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, iterator> upper_bound(const K& key) {
+    return makeIterator(upperBoundNode(key));
+  }
+
+  template <class K>
+  if_is_transparent<K, const_iterator> upper_bound(const K& key) const {
+    return makeIterator(upperBoundNode(key));
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key) {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  template <class K>
+  if_is_transparent<K, std::pair<iterator, iterator>> equal_range(const K& key) {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  template <class K>
+  if_is_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  /**
+   * Write lower_bound(key) for each key of [first, last), in order, to
+   * out.  The searches for several keys run interleaved, so that their
+   * cache misses overlap.  The keys need not be sorted.
+   */
+  template <class ForwardIterator, class OutputIterator>
+  OutputIterator bulk_lower_bound(
+      ForwardIterator first,
+      ForwardIterator last,
+      OutputIterator out) const {
+    using Query = _t<std::remove_reference<decltype(*first)>>;
+    auto const n = size();
+    auto const data = m_.cont_.data();
+    auto const& comp = key_comp();
+    while (first != last) {
+      Query* queries[kBulkWidth];
+      std::size_t nodes[kBulkWidth];
+      std::size_t width = 0;
+      for (; width < kBulkWidth && first != last; ++width, ++first) {
+        queries[width] = std::addressof(*first);
+        nodes[width] = 1;
+      }
+      // All searches are at the same level, but some end a level early
+      for (bool active = true; active;) {
+        active = false;
+        for (std::size_t j = 0; j < width; ++j) {
+          auto node = nodes[j];
+          if (node <= n) {
+            prefetchDescendants(data, node);
+            nodes[j] =
+                2 * node + std::size_t(comp(key(data[node - 1]), *queries[j]));
+            active = true;
+          }
+        }
+      }
+      for (std::size_t j = 0; j < width; ++j) {
+        *out++ = makeIterator(eytzingerResult(nodes[j]));
+      }
+    }
+    return out;
+  }
+
+  // Nothrow as long as swap() on the Compare type is nothrow.
+  void swap(eytzinger_table& o) {
+    using std::swap; // Allow ADL for swap(); fall back to std::swap().
+    Compare& a = m_;
+    Compare& b = o.m_;
+    swap(a, b);
+    m_.cont_.swap(o.m_.cont_);
+  }
+
+  // The same elements are always in the same order.
+  bool operator==(const eytzinger_table& other) const {
+    return m_.cont_ == other.m_.cont_;
+  }
+
+  bool operator!=(const eytzinger_table& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  static const Key& key(const Value& value) {
+    return KeyOfValue()(value);
+  }
+
+  iterator makeIterator(std::size_t node) {
+    return iterator(m_.cont_.data(), size(), node);
+  }
+
+  const_iterator makeIterator(std::size_t node) const {
+    return const_iterator(m_.cont_.data(), size(), node);
+  }
+
+  static void prefetchDescendants(const Value* data, std::size_t node) {
+    // May be past the end; prefetches don't fault
+    eytzingerPrefetch(
+        reinterpret_cast<const char*>(data) +
+        ((node << kPrefetchLevels) - 1) * sizeof(Value));
+  }
+
+  // The search for the first element for which goLeft is true
+  template <class GoLeft>
+  std::size_t search(GoLeft goLeft) const {
+    auto const n = size();
+    auto const data = m_.cont_.data();
+    std::size_t node = 1;
+    while (node <= n) {
+      prefetchDescendants(data, node);
+      node = 2 * node + std::size_t(!goLeft(data[node - 1]));
+    }
+    return eytzingerResult(node);
+  }
+
+  template <class K>
+  std::size_t lowerBoundNode(const K& k) const {
+    auto const& comp = key_comp();
+    return search([&](const Value& v) { return !comp(key(v), k); });
+  }
+
+  template <class K>
+  std::size_t upperBoundNode(const K& k) const {
+    auto const& comp = key_comp();
+    return search([&](const Value& v) { return comp(k, key(v)); });
+  }
+
+  template <class K>
+  std::size_t findNode(const K& k) const {
+    auto node = lowerBoundNode(k);
+    if (node != 0 && key_comp()(k, key(m_.cont_[node - 1]))) {
+      return 0;
+    }
+    return node;
+  }
+
+  // Sorts and dedups sorted (keeping the first of equal elements), and
+  // moves its elements to our storage, in BFS order.
+  void build(Container& sorted) {
+    auto const& comp = key_comp();
+    auto less = [&](const Value& a, const Value& b) {
+      return comp(key(a), key(b));
+    };
+    if (!std::is_sorted(sorted.begin(), sorted.end(), less)) {
+      std::stable_sort(sorted.begin(), sorted.end(), less);
+    }
+    sorted.erase(
+        std::unique(
+            sorted.begin(),
+            sorted.end(),
+            [&](const Value& a, const Value& b) { return !less(a, b); }),
+        sorted.end());
+
+    // Visit the nodes in sorted order, as iterators do, to give each its
+    // element
+    auto const n = sorted.size();
+    std::vector<std::size_t> order(n);
+    std::size_t i = 0;
+    for (const_iterator it(nullptr, n, n ? eytzingerDescend<false>(1, n) : 0);
+         it.node_ != 0;
+         ++it) {
+      order[it.node_ - 1] = i++;
+    }
+    Container cont(m_.cont_.get_allocator());
+    cont.reserve(n);
+    for (auto index : order) {
+      cont.push_back(std::move(sorted[index]));
+    }
+    m_.cont_.swap(cont);
+  }
+
+  struct EBO : Compare {
+    explicit EBO(const Compare& c, const Allocator& alloc)
+        : Compare(c), cont_(alloc) {}
+    Container cont_;
+  } m_;
+};
+
+} // namespace detail
+
+/**
+ * A read-only sorted set, laid out for fast lookups in large sets.  The
+ * elements may not be modified, so both iterators are const.
+ *
+ * @param class T          Data type to store
+ * @param class Compare    Comparison function that imposes a
+ *                         strict weak ordering over instances of T
+ * @param class Allocator  allocation policy
+ */
+template <
+    class T,
+    class Compare = std::less<T>,
+    class Allocator = std::allocator<T>>
+class eytzinger_set : public detail::eytzinger_table<
+                          T,
+                          T,
+                          detail::eytzinger_set_key,
+                          Compare,
+                          Allocator,
+                          true> {
+  using Base = detail::eytzinger_table<
+      T,
+      T,
+      detail::eytzinger_set_key,
+      Compare,
+      Allocator,
+      true>;
+
+ public:
+  typedef Compare value_compare;
+
+  explicit eytzinger_set(
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(comp, alloc) {}
+
+  // Linear if [first, last) is already sorted, and O(n log n) otherwise.
+  // Of equal elements, the first is kept.
+  template <class InputIterator>
+  eytzinger_set(
+      InputIterator first,
+      InputIterator last,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(first, last, comp, alloc) {}
+
+  /* implicit */ eytzinger_set(
+      std::initializer_list<T> list,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(list.begin(), list.end(), comp, alloc) {}
+
+  // Construct from the elements of a prefilled vector, which need not be
+  // sorted already.
+  explicit eytzinger_set(
+      std::vector<T, Allocator>&& container,
+      const Compare& comp = Compare())
+      : Base(std::move(container), comp) {}
+
+  value_compare value_comp() const {
+    return this->key_comp();
+  }
+};
+
+// Swap function that can be found using ADL.
+template <class T, class C, class A>
+inline void swap(eytzinger_set<T, C, A>& a, eytzinger_set<T, C, A>& b) {
+  return a.swap(b);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * An eytzinger_map is similar to an eytzinger_set but stores <key,value>
+ * pairs instead of single elements.  Values may be modified in place.
+ *
+ * @param class Key        Key type
+ * @param class Value      Value type
+ * @param class Compare    Function that can compare key types and impose
+ *                         a strict weak ordering over them.
+ * @param class Allocator  allocation policy
+ */
+template <
+    class Key,
+    class Value,
+    class Compare = std::less<Key>,
+    class Allocator = std::allocator<std::pair<Key, Value>>>
+class eytzinger_map : public detail::eytzinger_table<
+                          std::pair<Key, Value>,
+                          Key,
+                          detail::eytzinger_map_key,
+                          Compare,
+                          Allocator,
+                          false> {
+  using Base = detail::eytzinger_table<
+      std::pair<Key, Value>,
+      Key,
+      detail::eytzinger_map_key,
+      Compare,
+      Allocator,
+      false>;
+
+ public:
+  typedef Value mapped_type;
+  using typename Base::key_type;
+  using typename Base::value_type;
+
+  explicit eytzinger_map(
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(comp, alloc) {}
+
+  // Linear if [first, last) is already sorted by key, and O(n log n)
+  // otherwise.  Of pairs with equal keys, the first is kept.
+  template <class InputIterator>
+  eytzinger_map(
+      InputIterator first,
+      InputIterator last,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(first, last, comp, alloc) {}
+
+  /* implicit */ eytzinger_map(
+      std::initializer_list<value_type> list,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : Base(list.begin(), list.end(), comp, alloc) {}
+
+  explicit eytzinger_map(
+      std::vector<value_type, Allocator>&& container,
+      const Compare& comp = Compare())
+      : Base(std::move(container), comp) {}
+
+  mapped_type& at(const key_type& key) {
+    auto it = this->find(key);
+    if (it != this->end()) {
+      return it->second;
+    }
+    std::__throw_out_of_range("eytzinger_map::at");
+  }
+
+  const mapped_type& at(const key_type& key) const {
+    auto it = this->find(key);
+    if (it != this->end()) {
+      return it->second;
+    }
+    std::__throw_out_of_range("eytzinger_map::at");
+  }
+};
+
+// Swap function that can be found using ADL.
+template <class K, class V, class C, class A>
+inline void swap(eytzinger_map<K, V, C, A>& a, eytzinger_map<K, V, C, A>& b) {
+  return a.swap(b);
+}
+
+} // namespace folly
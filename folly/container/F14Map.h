@@ -0,0 +1,594 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * F14ValueMap and F14NodeMap are drop-in replacements for
+ * std::unordered_map built on the chunked, SIMD-probed open addressing
+ * table described in folly/container/detail/F14Table.h.
+ *
+ * F14ValueMap stores the pairs inline in the table.  It uses the least
+ * memory and has the best locality, but values are moved when the table
+ * grows, so references and pointers to elements are invalidated by any
+ * insert that triggers a rehash (like iterators of std::unordered_map).
+ *
+ * F14NodeMap allocates each pair separately and stores a pointer in the
+ * table, so references to elements are stable until the element is erased,
+ * exactly as with std::unordered_map.  Use it for large values or when
+ * reference stability is required.
+ *
+ * Differences from std::unordered_map:
+ *  - There is no bucket interface (bucket(), begin(n), bucket_size(n)...);
+ *    bucket_count() reports the number of slots.
+ *  - max_load_factor() is fixed, the setter is a no-op.
+ *  - Iteration order is unspecified and changes on rehash.
+ *  - Insert hints are accepted but ignored.
+ */
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include <folly/container/detail/F14Table.h>
+#include <folly/portability/BitsFunctexcept.h>
+
+namespace folly {
+namespace f14 {
+namespace detail {
+
+template <typename Policy>
+class F14BasicMap {
+  using Table = F14Table<Policy>;
+
+ public:
+  using key_type = typename Policy::Key;
+  using mapped_type = typename Policy::Mapped;
+  using value_type = typename Policy::Value;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = typename Policy::Hasher;
+  using key_equal = typename Policy::KeyEqual;
+  using allocator_type = typename Policy::Alloc;
+  using reference = value_type&;
+  using const_reference = value_type const&;
+  using pointer = typename std::allocator_traits<allocator_type>::pointer;
+  using const_pointer =
+      typename std::allocator_traits<allocator_type>::const_pointer;
+  using iterator = F14Iterator<value_type, Table>;
+  using const_iterator = F14Iterator<value_type const, Table>;
+
+  //// PUBLIC - Member functions
+
+  F14BasicMap() : F14BasicMap(0) {}
+
+  explicit F14BasicMap(
+      std::size_t initialCapacity,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {}
+
+  F14BasicMap(std::size_t initialCapacity, allocator_type const& alloc)
+      : F14BasicMap(initialCapacity, hasher{}, key_equal{}, alloc) {}
+
+  F14BasicMap(
+      std::size_t initialCapacity,
+      hasher const& hash,
+      allocator_type const& alloc)
+      : F14BasicMap(initialCapacity, hash, key_equal{}, alloc) {}
+
+  explicit F14BasicMap(allocator_type const& alloc)
+      : F14BasicMap(0, hasher{}, key_equal{}, alloc) {}
+
+  template <typename InputIt>
+  F14BasicMap(
+      InputIt first,
+      InputIt last,
+      std::size_t initialCapacity = 0,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {
+    initialInsert(first, last, initialCapacity);
+  }
+
+  template <typename InputIt>
+  F14BasicMap(
+      InputIt first,
+      InputIt last,
+      std::size_t initialCapacity,
+      allocator_type const& alloc)
+      : table_{initialCapacity, hasher{}, key_equal{}, alloc} {
+    initialInsert(first, last, initialCapacity);
+  }
+
+  F14BasicMap(
+      std::initializer_list<value_type> init,
+      std::size_t initialCapacity = 0,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {
+    initialInsert(init.begin(), init.end(), initialCapacity);
+  }
+
+  F14BasicMap(
+      std::initializer_list<value_type> init,
+      std::size_t initialCapacity,
+      allocator_type const& alloc)
+      : table_{initialCapacity, hasher{}, key_equal{}, alloc} {
+    initialInsert(init.begin(), init.end(), initialCapacity);
+  }
+
+  F14BasicMap(F14BasicMap const& rhs) = default;
+
+  F14BasicMap(F14BasicMap const& rhs, allocator_type const& alloc)
+      : table_{rhs.table_, alloc} {}
+
+  F14BasicMap(F14BasicMap&& rhs) = default;
+
+  F14BasicMap(F14BasicMap&& rhs, allocator_type const& alloc)
+      : table_{std::move(rhs.table_), alloc} {}
+
+  F14BasicMap& operator=(F14BasicMap const&) = default;
+
+  F14BasicMap& operator=(F14BasicMap&&) = default;
+
+  F14BasicMap& operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    bulkInsert(ilist.begin(), ilist.end());
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return table_.alloc();
+  }
+
+  //// PUBLIC - Iterators
+
+  iterator begin() noexcept {
+    return iterator{table_.begin()};
+  }
+
+  const_iterator begin() const noexcept {
+    return cbegin();
+  }
+
+  const_iterator cbegin() const noexcept {
+    return const_iterator{table_.begin()};
+  }
+
+  iterator end() noexcept {
+    return iterator{table_.end()};
+  }
+
+  const_iterator end() const noexcept {
+    return cend();
+  }
+
+  const_iterator cend() const noexcept {
+    return const_iterator{table_.end()};
+  }
+
+  //// PUBLIC - Capacity
+
+  bool empty() const noexcept {
+    return table_.empty();
+  }
+
+  std::size_t size() const noexcept {
+    return table_.size();
+  }
+
+  std::size_t max_size() const noexcept {
+    return table_.max_size();
+  }
+
+  //// PUBLIC - Modifiers
+
+  void clear() noexcept {
+    table_.clear();
+  }
+
+  std::pair<iterator, bool> insert(value_type const& value) {
+    return emplaceResult(table_.tryEmplaceValue(value.first, value));
+  }
+
+  template <
+      typename P,
+      typename = typename std::enable_if<
+          std::is_constructible<value_type, P&&>::value>::type>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplaceResult(table_.tryEmplaceValue(value.first, std::move(value)));
+  }
+
+  // The hint is ignored, hashing is cheaper than checking it.
+  iterator insert(const_iterator /*hint*/, value_type const& value) {
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator /*hint*/, value_type&& value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <
+      typename P,
+      typename = typename std::enable_if<
+          std::is_constructible<value_type, P&&>::value>::type>
+  iterator insert(const_iterator /*hint*/, P&& value) {
+    return insert(std::forward<P>(value)).first;
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    bulkInsert(first, last);
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    bulkInsert(ilist.begin(), ilist.end());
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type const& key, M&& obj) {
+    auto rv = try_emplace(key, std::forward<M>(obj));
+    if (!rv.second) {
+      rv.first->second = std::forward<M>(obj);
+    }
+    return rv;
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+    auto rv = try_emplace(std::move(key), std::forward<M>(obj));
+    if (!rv.second) {
+      rv.first->second = std::forward<M>(obj);
+    }
+    return rv;
+  }
+
+  template <typename M>
+  iterator
+  insert_or_assign(const_iterator /*hint*/, key_type const& key, M&& obj) {
+    return insert_or_assign(key, std::forward<M>(obj)).first;
+  }
+
+  template <typename M>
+  iterator insert_or_assign(const_iterator /*hint*/, key_type&& key, M&& obj) {
+    return insert_or_assign(std::move(key), std::forward<M>(obj)).first;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return emplaceImpl(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator /*hint*/, Args&&... args) {
+    return emplace(std::forward<Args>(args)...).first;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type const& key, Args&&... args) {
+    return emplaceResult(table_.tryEmplaceValue(
+        key,
+        std::piecewise_construct,
+        std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...)));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+    // key is only moved from if an insertion takes place, after the lookup
+    return emplaceResult(table_.tryEmplaceValue(
+        key,
+        std::piecewise_construct,
+        std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...)));
+  }
+
+  template <typename... Args>
+  iterator
+  try_emplace(const_iterator /*hint*/, key_type const& key, Args&&... args) {
+    return try_emplace(key, std::forward<Args>(args)...).first;
+  }
+
+  template <typename... Args>
+  iterator try_emplace(const_iterator /*hint*/, key_type&& key, Args&&... args) {
+    return try_emplace(std::move(key), std::forward<Args>(args)...).first;
+  }
+
+  iterator erase(const_iterator pos) {
+    return iterator{table_.eraseIterAndAdvance(pos.underlying())};
+  }
+
+  iterator erase(iterator pos) {
+    return iterator{table_.eraseIterAndAdvance(pos.underlying())};
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator{first.underlying()};
+  }
+
+  std::size_t erase(key_type const& key) {
+    return table_.eraseKey(key);
+  }
+
+  void swap(F14BasicMap& rhs) noexcept {
+    table_.swap(rhs.table_);
+  }
+
+  //// PUBLIC - Lookup
+
+  mapped_type& at(key_type const& key) {
+    return atImpl(*this, key);
+  }
+
+  mapped_type const& at(key_type const& key) const {
+    return atImpl(*this, key);
+  }
+
+  mapped_type& operator[](key_type const& key) {
+    return try_emplace(key).first->second;
+  }
+
+  mapped_type& operator[](key_type&& key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  std::size_t count(key_type const& key) const {
+    return table_.find(key).atEnd() ? 0 : 1;
+  }
+
+  iterator find(key_type const& key) {
+    return iterator{table_.find(key)};
+  }
+
+  const_iterator find(key_type const& key) const {
+    return const_iterator{table_.find(key)};
+  }
+
+  std::pair<iterator, iterator> equal_range(key_type const& key) {
+    return equalRangeImpl(*this, key);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      key_type const& key) const {
+    return equalRangeImpl(*this, key);
+  }
+
+  //// PUBLIC - Bucket interface
+
+  std::size_t bucket_count() const noexcept {
+    return table_.bucket_count();
+  }
+
+  std::size_t max_bucket_count() const noexcept {
+    return max_size();
+  }
+
+  //// PUBLIC - Hash policy
+
+  float load_factor() const noexcept {
+    return table_.load_factor();
+  }
+
+  float max_load_factor() const noexcept {
+    return static_cast<float>(kDesiredCapacityPerChunk) / kChunkCapacity;
+  }
+
+  void max_load_factor(float) noexcept {
+    // not configurable
+  }
+
+  void rehash(std::size_t bucketCount) {
+    table_.rehash(bucketCount);
+  }
+
+  void reserve(std::size_t capacity) {
+    table_.reserve(capacity);
+  }
+
+  //// PUBLIC - Observers
+
+  hasher hash_function() const {
+    return table_.hasher();
+  }
+
+  key_equal key_eq() const {
+    return table_.keyEqual();
+  }
+
+ private:
+  template <typename Self>
+  static auto& atImpl(Self& self, key_type const& key) {
+    auto iter = self.find(key);
+    if (iter == self.end()) {
+      std::__throw_out_of_range("at() did not find key");
+    }
+    return iter->second;
+  }
+
+  template <typename Self>
+  static auto equalRangeImpl(Self& self, key_type const& key) {
+    auto first = self.find(key);
+    auto last = first;
+    if (last != self.end()) {
+      ++last;
+    }
+    return std::make_pair(first, last);
+  }
+
+  std::pair<iterator, bool> emplaceResult(
+      std::pair<typename Table::ItemIter, bool> rv) {
+    return std::make_pair(iterator{rv.first}, rv.second);
+  }
+
+  // emplace() has to find the key before it can decide whether to
+  // construct anything.  The common forms (key, mapped) and (pair) are
+  // forwarded without materializing a temporary value_type.
+  template <typename K, typename M>
+  typename std::enable_if<
+      std::is_same<typename std::decay<K>::type, key_type>::value,
+      std::pair<iterator, bool>>::type
+  emplaceImpl(K&& key, M&& mapped) {
+    return emplaceResult(table_.tryEmplaceValue(
+        key, std::forward<K>(key), std::forward<M>(mapped)));
+  }
+
+  template <typename K, typename M>
+  typename std::enable_if<
+      std::is_same<typename std::decay<K>::type, key_type>::value,
+      std::pair<iterator, bool>>::type
+  emplaceImpl(std::pair<K, M> const& value) {
+    return emplaceResult(table_.tryEmplaceValue(value.first, value));
+  }
+
+  template <typename K, typename M>
+  typename std::enable_if<
+      std::is_same<typename std::decay<K>::type, key_type>::value,
+      std::pair<iterator, bool>>::type
+  emplaceImpl(std::pair<K, M>&& value) {
+    return emplaceResult(table_.tryEmplaceValue(value.first, std::move(value)));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplaceImpl(Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    return emplaceResult(table_.tryEmplaceValue(value.first, std::move(value)));
+  }
+
+  template <typename InputIt>
+  void initialInsert(InputIt first, InputIt last, std::size_t initialCapacity) {
+    if (initialCapacity == 0) {
+      bulkInsert(first, last);
+    } else {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+    }
+  }
+
+  template <typename InputIt>
+  void bulkInsert(InputIt first, InputIt last) {
+    reserveForRange(
+        first,
+        last,
+        typename std::iterator_traits<InputIt>::iterator_category{});
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  template <typename InputIt>
+  void reserveForRange(InputIt, InputIt, std::input_iterator_tag) {}
+
+  template <typename InputIt>
+  void reserveForRange(InputIt first, InputIt last, std::forward_iterator_tag) {
+    // Assuming few duplicates, which is the common case.
+    reserve(size() + static_cast<std::size_t>(std::distance(first, last)));
+  }
+
+  Table table_;
+};
+
+template <typename Policy>
+bool operator==(F14BasicMap<Policy> const& lhs, F14BasicMap<Policy> const& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (auto& kv : lhs) {
+    auto iter = rhs.find(kv.first);
+    if (iter == rhs.end() || !(iter->second == kv.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Policy>
+bool operator!=(F14BasicMap<Policy> const& lhs, F14BasicMap<Policy> const& rhs) {
+  return !(lhs == rhs);
+}
+
+} // namespace detail
+} // namespace f14
+
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher = f14::DefaultHasher<Key>,
+    typename KeyEqual = f14::DefaultKeyEqual<Key>,
+    typename Alloc = f14::DefaultAlloc<std::pair<Key const, Mapped>>>
+class F14ValueMap
+    : public f14::detail::F14BasicMap<f14::detail::ValueContainerPolicy<
+          Key,
+          Mapped,
+          Hasher,
+          KeyEqual,
+          Alloc>> {
+  using Super = f14::detail::F14BasicMap<
+      f14::detail::ValueContainerPolicy<Key, Mapped, Hasher, KeyEqual, Alloc>>;
+
+ public:
+  using Super::Super;
+  using Super::operator=;
+
+  F14ValueMap() = default;
+};
+
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher = f14::DefaultHasher<Key>,
+    typename KeyEqual = f14::DefaultKeyEqual<Key>,
+    typename Alloc = f14::DefaultAlloc<std::pair<Key const, Mapped>>>
+class F14NodeMap
+    : public f14::detail::F14BasicMap<f14::detail::NodeContainerPolicy<
+          Key,
+          Mapped,
+          Hasher,
+          KeyEqual,
+          Alloc>> {
+  using Super = f14::detail::F14BasicMap<
+      f14::detail::NodeContainerPolicy<Key, Mapped, Hasher, KeyEqual, Alloc>>;
+
+ public:
+  using Super::Super;
+  using Super::operator=;
+
+  F14NodeMap() = default;
+};
+
+template <typename K, typename M, typename H, typename E, typename A>
+void swap(F14ValueMap<K, M, H, E, A>& lhs, F14ValueMap<K, M, H, E, A>& rhs) {
+  lhs.swap(rhs);
+}
+
+template <typename K, typename M, typename H, typename E, typename A>
+void swap(F14NodeMap<K, M, H, E, A>& lhs, F14NodeMap<K, M, H, E, A>& rhs) {
+  lhs.swap(rhs);
+}
+
+} // namespace folly
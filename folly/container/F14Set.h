@@ -0,0 +1,414 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * F14ValueSet and F14NodeSet are drop-in replacements for
+ * std::unordered_set.  See F14Map.h for a discussion of the two storage
+ * strategies and of the differences from the standard containers.
+ */
+
+#include <initializer_list>
+#include <utility>
+
+#include <folly/container/detail/F14Table.h>
+
+namespace folly {
+namespace f14 {
+namespace detail {
+
+template <typename Policy>
+class F14BasicSet {
+  using Table = F14Table<Policy>;
+
+ public:
+  using key_type = typename Policy::Key;
+  using value_type = key_type;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = typename Policy::Hasher;
+  using key_equal = typename Policy::KeyEqual;
+  using allocator_type = typename Policy::Alloc;
+  using reference = value_type&;
+  using const_reference = value_type const&;
+  using pointer = typename std::allocator_traits<allocator_type>::pointer;
+  using const_pointer =
+      typename std::allocator_traits<allocator_type>::const_pointer;
+  // set elements may not be modified, so both iterators are const
+  using iterator = F14Iterator<value_type const, Table>;
+  using const_iterator = iterator;
+
+  //// PUBLIC - Member functions
+
+  F14BasicSet() : F14BasicSet(0) {}
+
+  explicit F14BasicSet(
+      std::size_t initialCapacity,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {}
+
+  F14BasicSet(std::size_t initialCapacity, allocator_type const& alloc)
+      : F14BasicSet(initialCapacity, hasher{}, key_equal{}, alloc) {}
+
+  F14BasicSet(
+      std::size_t initialCapacity,
+      hasher const& hash,
+      allocator_type const& alloc)
+      : F14BasicSet(initialCapacity, hash, key_equal{}, alloc) {}
+
+  explicit F14BasicSet(allocator_type const& alloc)
+      : F14BasicSet(0, hasher{}, key_equal{}, alloc) {}
+
+  template <typename InputIt>
+  F14BasicSet(
+      InputIt first,
+      InputIt last,
+      std::size_t initialCapacity = 0,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {
+    bulkInsert(first, last);
+  }
+
+  template <typename InputIt>
+  F14BasicSet(
+      InputIt first,
+      InputIt last,
+      std::size_t initialCapacity,
+      allocator_type const& alloc)
+      : table_{initialCapacity, hasher{}, key_equal{}, alloc} {
+    bulkInsert(first, last);
+  }
+
+  F14BasicSet(
+      std::initializer_list<value_type> init,
+      std::size_t initialCapacity = 0,
+      hasher const& hash = hasher{},
+      key_equal const& eq = key_equal{},
+      allocator_type const& alloc = allocator_type{})
+      : table_{initialCapacity, hash, eq, alloc} {
+    bulkInsert(init.begin(), init.end());
+  }
+
+  F14BasicSet(
+      std::initializer_list<value_type> init,
+      std::size_t initialCapacity,
+      allocator_type const& alloc)
+      : table_{initialCapacity, hasher{}, key_equal{}, alloc} {
+    bulkInsert(init.begin(), init.end());
+  }
+
+  F14BasicSet(F14BasicSet const& rhs) = default;
+
+  F14BasicSet(F14BasicSet const& rhs, allocator_type const& alloc)
+      : table_{rhs.table_, alloc} {}
+
+  F14BasicSet(F14BasicSet&& rhs) = default;
+
+  F14BasicSet(F14BasicSet&& rhs, allocator_type const& alloc)
+      : table_{std::move(rhs.table_), alloc} {}
+
+  F14BasicSet& operator=(F14BasicSet const&) = default;
+
+  F14BasicSet& operator=(F14BasicSet&&) = default;
+
+  F14BasicSet& operator=(std::initializer_list<value_type> ilist) {
+    clear();
+    bulkInsert(ilist.begin(), ilist.end());
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return table_.alloc();
+  }
+
+  //// PUBLIC - Iterators
+
+  iterator begin() const noexcept {
+    return iterator{table_.begin()};
+  }
+
+  iterator cbegin() const noexcept {
+    return begin();
+  }
+
+  iterator end() const noexcept {
+    return iterator{table_.end()};
+  }
+
+  iterator cend() const noexcept {
+    return end();
+  }
+
+  //// PUBLIC - Capacity
+
+  bool empty() const noexcept {
+    return table_.empty();
+  }
+
+  std::size_t size() const noexcept {
+    return table_.size();
+  }
+
+  std::size_t max_size() const noexcept {
+    return table_.max_size();
+  }
+
+  //// PUBLIC - Modifiers
+
+  void clear() noexcept {
+    table_.clear();
+  }
+
+  std::pair<iterator, bool> insert(value_type const& value) {
+    return emplaceResult(table_.tryEmplaceValue(value, value));
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplaceResult(table_.tryEmplaceValue(value, std::move(value)));
+  }
+
+  // The hint is ignored, hashing is cheaper than checking it.
+  iterator insert(const_iterator /*hint*/, value_type const& value) {
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator /*hint*/, value_type&& value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    bulkInsert(first, last);
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    bulkInsert(ilist.begin(), ilist.end());
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return emplaceImpl(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator /*hint*/, Args&&... args) {
+    return emplace(std::forward<Args>(args)...).first;
+  }
+
+  iterator erase(const_iterator pos) {
+    return iterator{table_.eraseIterAndAdvance(pos.underlying())};
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return first;
+  }
+
+  std::size_t erase(key_type const& key) {
+    return table_.eraseKey(key);
+  }
+
+  void swap(F14BasicSet& rhs) noexcept {
+    table_.swap(rhs.table_);
+  }
+
+  //// PUBLIC - Lookup
+
+  std::size_t count(key_type const& key) const {
+    return table_.find(key).atEnd() ? 0 : 1;
+  }
+
+  iterator find(key_type const& key) const {
+    return iterator{table_.find(key)};
+  }
+
+  std::pair<iterator, iterator> equal_range(key_type const& key) const {
+    auto first = find(key);
+    auto last = first;
+    if (last != end()) {
+      ++last;
+    }
+    return std::make_pair(first, last);
+  }
+
+  //// PUBLIC - Bucket interface
+
+  std::size_t bucket_count() const noexcept {
+    return table_.bucket_count();
+  }
+
+  std::size_t max_bucket_count() const noexcept {
+    return max_size();
+  }
+
+  //// PUBLIC - Hash policy
+
+  float load_factor() const noexcept {
+    return table_.load_factor();
+  }
+
+  float max_load_factor() const noexcept {
+    return static_cast<float>(kDesiredCapacityPerChunk) / kChunkCapacity;
+  }
+
+  void max_load_factor(float) noexcept {
+    // not configurable
+  }
+
+  void rehash(std::size_t bucketCount) {
+    table_.rehash(bucketCount);
+  }
+
+  void reserve(std::size_t capacity) {
+    table_.reserve(capacity);
+  }
+
+  //// PUBLIC - Observers
+
+  hasher hash_function() const {
+    return table_.hasher();
+  }
+
+  key_equal key_eq() const {
+    return table_.keyEqual();
+  }
+
+ private:
+  std::pair<iterator, bool> emplaceResult(
+      std::pair<typename Table::ItemIter, bool> rv) {
+    return std::make_pair(iterator{rv.first}, rv.second);
+  }
+
+  template <typename K>
+  typename std::enable_if<
+      std::is_same<typename std::decay<K>::type, key_type>::value,
+      std::pair<iterator, bool>>::type
+  emplaceImpl(K&& key) {
+    return emplaceResult(table_.tryEmplaceValue(key, std::forward<K>(key)));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplaceImpl(Args&&... args) {
+    key_type key(std::forward<Args>(args)...);
+    return emplaceResult(table_.tryEmplaceValue(key, std::move(key)));
+  }
+
+  template <typename InputIt>
+  void bulkInsert(InputIt first, InputIt last) {
+    reserveForRange(
+        first,
+        last,
+        typename std::iterator_traits<InputIt>::iterator_category{});
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  template <typename InputIt>
+  void reserveForRange(InputIt, InputIt, std::input_iterator_tag) {}
+
+  template <typename InputIt>
+  void reserveForRange(InputIt first, InputIt last, std::forward_iterator_tag) {
+    // Assuming few duplicates, which is the common case.
+    reserve(size() + static_cast<std::size_t>(std::distance(first, last)));
+  }
+
+  Table table_;
+};
+
+template <typename Policy>
+bool operator==(F14BasicSet<Policy> const& lhs, F14BasicSet<Policy> const& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (auto& k : lhs) {
+    if (rhs.find(k) == rhs.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Policy>
+bool operator!=(F14BasicSet<Policy> const& lhs, F14BasicSet<Policy> const& rhs) {
+  return !(lhs == rhs);
+}
+
+} // namespace detail
+} // namespace f14
+
+template <
+    typename Key,
+    typename Hasher = f14::DefaultHasher<Key>,
+    typename KeyEqual = f14::DefaultKeyEqual<Key>,
+    typename Alloc = f14::DefaultAlloc<Key>>
+class F14ValueSet
+    : public f14::detail::F14BasicSet<f14::detail::ValueContainerPolicy<
+          Key,
+          void,
+          Hasher,
+          KeyEqual,
+          Alloc>> {
+  using Super = f14::detail::F14BasicSet<
+      f14::detail::ValueContainerPolicy<Key, void, Hasher, KeyEqual, Alloc>>;
+
+ public:
+  using Super::Super;
+  using Super::operator=;
+
+  F14ValueSet() = default;
+};
+
+template <
+    typename Key,
+    typename Hasher = f14::DefaultHasher<Key>,
+    typename KeyEqual = f14::DefaultKeyEqual<Key>,
+    typename Alloc = f14::DefaultAlloc<Key>>
+class F14NodeSet
+    : public f14::detail::F14BasicSet<f14::detail::NodeContainerPolicy<
+          Key,
+          void,
+          Hasher,
+          KeyEqual,
+          Alloc>> {
+  using Super = f14::detail::F14BasicSet<
+      f14::detail::NodeContainerPolicy<Key, void, Hasher, KeyEqual, Alloc>>;
+
+ public:
+  using Super::Super;
+  using Super::operator=;
+
+  F14NodeSet() = default;
+};
+
+template <typename K, typename H, typename E, typename A>
+void swap(F14ValueSet<K, H, E, A>& lhs, F14ValueSet<K, H, E, A>& rhs) {
+  lhs.swap(rhs);
+}
+
+template <typename K, typename H, typename E, typename A>
+void swap(F14NodeSet<K, H, E, A>& lhs, F14NodeSet<K, H, E, A>& rhs) {
+  lhs.swap(rhs);
+}
+
+} // namespace folly
@@ -34,11 +34,21 @@
  * guaranteed to produce {{1, 1}, {1, 2}, {2, 2}, {2, 3}, {3, 3}}. That is,
  * if comp(it_a, it_b) == comp(it_b, it_a) == false, we first insert the element
  * from a.
+ *
+ * folly::multiwayMerge() merges any number of sorted ranges with a loser
+ * tree, in about log2(k) comparisons per element for k ranges, with the
+ * same guarantee: equivalent values appear in the order of their ranges.
  */
 
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
 
 namespace folly {
 
@@ -80,4 +90,123 @@ OutputIt merge(InputIt1 first1, InputIt1 last1,
   return std::copy(first2, last2, d_first);
 }
 
+namespace detail {
+
+/**
+ * A tournament between the fronts of k ranges, in which each internal node
+ * of the tree (1 to k - 1; the ranges are the leaves k to 2k - 1) remembers
+ * the loser of the match played there. Once the winner is taken, only the
+ * matches on the path from its leaf to the root are replayed, against these
+ * losers.
+ */
+template <class Iter, class Compare>
+class LoserTree {
+ public:
+  LoserTree(std::vector<Range<Iter>> runs, Compare& comp)
+      : runs_(std::move(runs)), comp_(comp), losers_(runs_.size()) {
+    winner_ = runs_.empty() ? 0 : play(1);
+  }
+
+  bool empty() const {
+    return runs_.empty() || runs_[winner_].empty();
+  }
+
+  /// The front of the range that comes first.
+  typename Range<Iter>::reference top() {
+    return runs_[winner_].front();
+  }
+
+  void pop() {
+    size_t w = winner_;
+    runs_[w].pop_front();
+    for (size_t n = (w + runs_.size()) / 2; n > 0; n /= 2) {
+      if (beats(losers_[n], w)) {
+        std::swap(losers_[n], w);
+      }
+    }
+    winner_ = w;
+  }
+
+ private:
+  // Whether the front of range a comes before that of range b: an empty
+  // range never does, and ties go to the first range
+  bool beats(size_t a, size_t b) const {
+    if (runs_[a].empty()) {
+      return false;
+    }
+    if (runs_[b].empty()) {
+      return true;
+    }
+    if (comp_(runs_[b].front(), runs_[a].front())) {
+      return false;
+    }
+    return a < b || comp_(runs_[a].front(), runs_[b].front());
+  }
+
+  size_t play(size_t n) {
+    if (n >= runs_.size()) {
+      return n - runs_.size();
+    }
+    size_t a = play(2 * n);
+    size_t b = play(2 * n + 1);
+    if (beats(a, b)) {
+      losers_[n] = b;
+      return a;
+    }
+    losers_[n] = a;
+    return b;
+  }
+
+  std::vector<Range<Iter>> runs_;
+  Compare& comp_;
+  std::vector<size_t> losers_;
+  size_t winner_;
+};
+
+// multiwayMerge(), moving the values out of the ranges if Move
+template <bool Move, class Iter, class OutputIt, class Compare>
+OutputIt multiwayMerge(
+    std::vector<Range<Iter>> runs,
+    OutputIt d_first,
+    Compare& comp) {
+  using Ref = typename std::conditional<
+      Move,
+      typename std::iterator_traits<Iter>::value_type&&,
+      typename Range<Iter>::reference>::type;
+  runs.erase(
+      std::remove_if(
+          runs.begin(),
+          runs.end(),
+          [](const Range<Iter>& r) { return r.empty(); }),
+      runs.end());
+  if (runs.size() == 1) {
+    for (auto& v : runs[0]) {
+      *d_first = static_cast<Ref>(v);
+      ++d_first;
+    }
+    return d_first;
+  }
+  LoserTree<Iter, Compare> tree(std::move(runs), comp);
+  for (; !tree.empty(); tree.pop(), ++d_first) {
+    *d_first = static_cast<Ref>(tree.top());
+  }
+  return d_first;
+}
+
+} // namespace detail
+
+template <class Iter, class OutputIt, class Compare>
+OutputIt multiwayMerge(
+    std::vector<Range<Iter>> runs,
+    OutputIt d_first,
+    Compare comp) {
+  return detail::multiwayMerge<false>(std::move(runs), d_first, comp);
+}
+
+template <class Iter, class OutputIt>
+OutputIt multiwayMerge(std::vector<Range<Iter>> runs, OutputIt d_first) {
+  std::less<typename std::iterator_traits<Iter>::value_type> comp;
+  return detail::multiwayMerge<false>(std::move(runs), d_first, comp);
+}
+
 } // namespace folly
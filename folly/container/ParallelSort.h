@@ -0,0 +1,401 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sorting and merging of large random-access ranges on an Executor.
+ *
+ * parallelSort() sorts parallelism pieces of the range with std::sort, and
+ * merges them with parallelMultiwayMerge(), through a buffer as large as the
+ * range.
+ *
+ * parallelMultiwayMerge() (and parallelMerge(), for two ranges) picks
+ * splitters from a sample of the input, which cut every range into pieces
+ * that together make up a piece of the output, and merges the pieces with
+ * multiwayMerge() (see Merge.h) independently. Equivalent values appear in
+ * the order of their ranges, as with folly::merge().
+ *
+ * Like gen::preduce(), these run up to parallelism tasks at once (by
+ * default, as many as there are CPUs), the calling thread being one of them,
+ * and block until all the work is done, so they mustn't be called from a
+ * task of a saturated executor. comp is called from all of them at once.
+ * The first exception thrown by a task is rethrown, once the other tasks
+ * are done; if comp throws in parallelSort(), the values in the range are
+ * unspecified.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/Executor.h>
+#include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/container/Merge.h>
+
+namespace folly {
+
+namespace detail {
+namespace parallel_sort {
+
+// Below this size, a piece of work isn't worth a task
+constexpr size_t kMinPieceSize = 1 << 14;
+// Samples taken from each range per piece of the output
+constexpr size_t kOversampling = 16;
+
+/**
+ * Shared by runTasks() and the tasks it adds to the executor, which may
+ * outlive it.
+ */
+struct TasksState {
+  explicit TasksState(size_t count) : count(count), remaining(count) {}
+
+  template <class Task>
+  void work(const Task& task) {
+    size_t i;
+    while ((i = next.fetch_add(1)) < count) {
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (remaining.fetch_sub(1) == 1) {
+        done.post();
+      }
+    }
+  }
+
+  const size_t count;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> remaining;
+  std::mutex mutex;
+  std::exception_ptr error;
+  Baton<> done;
+};
+
+// Calls task(0), ..., task(count - 1) on up to parallelism threads
+template <class Task>
+void runTasks(
+    Executor& executor,
+    size_t count,
+    size_t parallelism,
+    const Task& task) {
+  if (count == 0) {
+    return;
+  }
+  auto state = std::make_shared<TasksState>(count);
+  // This thread is one of the workers
+  for (size_t i = 1; i < std::min(parallelism, count); ++i) {
+    executor.add([state, task] { state->work(task); });
+  }
+  state->work(task);
+  state->done.wait();
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+inline size_t resolveParallelism(size_t parallelism) {
+  return parallelism != 0
+      ? parallelism
+      : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+/**
+ * Cuts runs into parts pieces each, such that merging the i-th pieces of
+ * all the runs gives the i-th piece of their merge: splits[p][r] is where
+ * piece p starts in run r.
+ *
+ * The values are ordered as multiwayMerge() outputs them: by comp, then by
+ * run, then by position, so that the splitters, taken from a sorted sample,
+ * cut runs of equivalent values too.
+ */
+template <class Iter, class Compare>
+std::vector<std::vector<size_t>> split(
+    const std::vector<Range<Iter>>& runs,
+    size_t parts,
+    Compare& comp) {
+  using Position = std::pair<size_t, size_t>; // run, index in the run
+  const size_t k = runs.size();
+  std::vector<std::vector<size_t>> splits(
+      parts + 1, std::vector<size_t>(k, 0));
+  std::vector<Position> samples;
+  for (size_t r = 0; r < k; ++r) {
+    splits[parts][r] = runs[r].size();
+    const size_t m = runs[r].size();
+    const size_t count = std::min(m, kOversampling * parts);
+    for (size_t j = 0; j < count; ++j) {
+      samples.emplace_back(r, (2 * j + 1) * m / (2 * count));
+    }
+  }
+  if (samples.empty()) {
+    return splits;
+  }
+  auto before = [&](const Position& a, const Position& b) {
+    const auto& x = runs[a.first][a.second];
+    const auto& y = runs[b.first][b.second];
+    if (comp(x, y)) {
+      return true;
+    }
+    if (comp(y, x)) {
+      return false;
+    }
+    return a < b;
+  };
+  std::sort(samples.begin(), samples.end(), before);
+  for (size_t p = 1; p < parts; ++p) {
+    const auto& splitter = samples[p * samples.size() / parts];
+    const auto& value = runs[splitter.first][splitter.second];
+    for (size_t r = 0; r < k; ++r) {
+      if (r < splitter.first) {
+        splits[p][r] = size_t(
+            std::upper_bound(runs[r].begin(), runs[r].end(), value, comp) -
+            runs[r].begin());
+      } else if (r > splitter.first) {
+        splits[p][r] = size_t(
+            std::lower_bound(runs[r].begin(), runs[r].end(), value, comp) -
+            runs[r].begin());
+      } else {
+        splits[p][r] = splitter.second;
+      }
+    }
+  }
+  return splits;
+}
+
+template <class Iter>
+std::vector<Range<Iter>> pieces(
+    const std::vector<Range<Iter>>& runs,
+    const std::vector<std::vector<size_t>>& splits,
+    size_t p) {
+  std::vector<Range<Iter>> result;
+  for (size_t r = 0; r < runs.size(); ++r) {
+    result.emplace_back(
+        runs[r].begin() + splits[p][r], runs[r].begin() + splits[p + 1][r]);
+  }
+  return result;
+}
+
+inline size_t offset(const std::vector<size_t>& split) {
+  size_t n = 0;
+  for (auto i : split) {
+    n += i;
+  }
+  return n;
+}
+
+// An output iterator that move-constructs the values into raw storage,
+// counting them
+template <class T>
+class UninitializedOutput {
+ public:
+  UninitializedOutput(T* p, size_t* constructed)
+      : p_(p), constructed_(constructed) {}
+
+  UninitializedOutput& operator*() {
+    return *this;
+  }
+  UninitializedOutput& operator++() {
+    return *this;
+  }
+  UninitializedOutput& operator=(T&& value) {
+    new (p_ + *constructed_) T(std::move(value));
+    ++*constructed_;
+    return *this;
+  }
+
+ private:
+  T* p_;
+  size_t* constructed_;
+};
+
+} // namespace parallel_sort
+} // namespace detail
+
+/**
+ * Merges runs, each sorted by comp, into the range starting at d_first,
+ * which mustn't overlap them; returns the end of that range.
+ */
+template <class Iter, class RandomIt, class Compare>
+RandomIt parallelMultiwayMerge(
+    Executor& executor,
+    const std::vector<Range<Iter>>& runs,
+    RandomIt d_first,
+    Compare comp,
+    size_t parallelism = 0) {
+  namespace ps = detail::parallel_sort;
+  parallelism = ps::resolveParallelism(parallelism);
+  size_t size = 0;
+  for (auto& run : runs) {
+    size += run.size();
+  }
+  const size_t parts =
+      std::min(4 * parallelism, std::max<size_t>(size / ps::kMinPieceSize, 1));
+  if (parallelism == 1 || parts == 1) {
+    return detail::multiwayMerge<false>(runs, d_first, comp);
+  }
+  auto splits = ps::split(runs, parts, comp);
+  ps::runTasks(executor, parts, parallelism, [&](size_t p) {
+    detail::multiwayMerge<false>(
+        ps::pieces(runs, splits, p), d_first + ps::offset(splits[p]), comp);
+  });
+  return d_first + size;
+}
+
+template <class Iter, class RandomIt>
+RandomIt parallelMultiwayMerge(
+    Executor& executor,
+    const std::vector<Range<Iter>>& runs,
+    RandomIt d_first) {
+  return parallelMultiwayMerge(
+      executor,
+      runs,
+      d_first,
+      std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+template <class Iter, class RandomIt, class Compare>
+RandomIt parallelMerge(
+    Executor& executor,
+    Iter first1,
+    Iter last1,
+    Iter first2,
+    Iter last2,
+    RandomIt d_first,
+    Compare comp,
+    size_t parallelism = 0) {
+  return parallelMultiwayMerge(
+      executor,
+      std::vector<Range<Iter>>{Range<Iter>(first1, last1),
+                               Range<Iter>(first2, last2)},
+      d_first,
+      comp,
+      parallelism);
+}
+
+template <class Iter, class RandomIt>
+RandomIt parallelMerge(
+    Executor& executor,
+    Iter first1,
+    Iter last1,
+    Iter first2,
+    Iter last2,
+    RandomIt d_first) {
+  return parallelMerge(
+      executor,
+      first1,
+      last1,
+      first2,
+      last2,
+      d_first,
+      std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+/**
+ * Sorts [first, last) by comp, like std::sort (so not stably).
+ */
+template <class RandomIt, class Compare>
+void parallelSort(
+    Executor& executor,
+    RandomIt first,
+    RandomIt last,
+    Compare comp,
+    size_t parallelism = 0) {
+  namespace ps = detail::parallel_sort;
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  parallelism = ps::resolveParallelism(parallelism);
+  const size_t size = size_t(last - first);
+  const size_t runCount = std::min(parallelism, size / ps::kMinPieceSize);
+  if (runCount <= 1) {
+    std::sort(first, last, comp);
+    return;
+  }
+
+  std::vector<Range<RandomIt>> runs;
+  for (size_t i = 0; i < runCount; ++i) {
+    runs.emplace_back(
+        first + i * size / runCount, first + (i + 1) * size / runCount);
+  }
+  ps::runTasks(executor, runCount, parallelism, [&](size_t i) {
+    std::sort(runs[i].begin(), runs[i].end(), comp);
+  });
+
+  // Merged into the buffer, then moved back
+  const size_t parts = std::min(4 * parallelism, size / ps::kMinPieceSize);
+  auto splits = ps::split(runs, parts, comp);
+  std::allocator<T> alloc;
+  T* buffer = alloc.allocate(size);
+  SCOPE_EXIT {
+    alloc.deallocate(buffer, size);
+  };
+  std::vector<size_t> constructed(parts, 0);
+  auto destroy = [&](size_t p) {
+    T* begin = buffer + ps::offset(splits[p]);
+    for (size_t i = 0; i < constructed[p]; ++i) {
+      begin[i].~T();
+    }
+    constructed[p] = 0;
+  };
+  try {
+    ps::runTasks(executor, parts, parallelism, [&](size_t p) {
+      detail::multiwayMerge<true>(
+          ps::pieces(runs, splits, p),
+          ps::UninitializedOutput<T>(
+              buffer + ps::offset(splits[p]), &constructed[p]),
+          comp);
+    });
+  } catch (...) {
+    for (size_t p = 0; p < parts; ++p) {
+      destroy(p);
+    }
+    throw;
+  }
+  ps::runTasks(executor, parts, parallelism, [&](size_t p) {
+    auto offset = ps::offset(splits[p]);
+    std::move(
+        buffer + offset,
+        buffer + offset + constructed[p],
+        first + offset);
+    destroy(p);
+  });
+}
+
+template <class RandomIt>
+void parallelSort(
+    Executor& executor,
+    RandomIt first,
+    RandomIt last) {
+  parallelSort(
+      executor,
+      first,
+      last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+} // namespace folly
@@ -0,0 +1,735 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * small_flat_set and small_flat_map are hash containers for a few dozen
+ * elements, with room for N of them inline, so that the common case
+ * allocates nothing.  They are meant for the per-request sets of ids
+ * now kept in a small_vector with a linear search or in a
+ * sorted_vector_set, and follow the interface of sorted_vector_types.h
+ * where it doesn't depend on ordering.
+ *
+ * Elements are stored densely, in insertion order, next to an array of
+ * one-byte tags taken from their hashes.  A lookup compares 16 tags at a
+ * time with SSE2 or NEON, and only calls key_equal on the elements whose
+ * tag matches, which is 1 in 128 of the others.  This stays fast well
+ * past the point where comparing every key, or binary searching, does.
+ *
+ * Past N elements the storage spills to the heap, doubling as it grows.
+ * Lookups are linear in the size, so past a few hundred elements a real
+ * hash table such as F14 is the better choice.
+ *
+ * Important differences from std::unordered_set and std::unordered_map:
+ *   - insert() may invalidate iterators and references, as for
+ *     std::vector; erase() invalidates those to the erased element and
+ *     to the last one, which is moved into the erased element's place
+ *   - our iterators model RandomAccessIterator
+ *   - small_flat_map::value_type is pair<K,V>, not pair<const K,V>, so
+ *     that elements can be moved around
+ *   - Hash and KeyEqual are default constructed when used, not stored
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Bits.h>
+#include <folly/Portability.h>
+#include <folly/Traits.h>
+#include <folly/memory/Malloc.h>
+#include <folly/memory/Relocate.h>
+#include <folly/portability/BitsFunctexcept.h>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace folly {
+
+namespace detail {
+
+// Tags have the top bit set, so unused (zero) tags never match.
+inline uint8_t smallFlatTag(std::size_t hash) {
+  // Fibonacci hashing spreads hashes that only differ in their low bits,
+  // the usual case for std::hash of small integers.
+  return uint8_t(0x80 | (uint64_t(hash) * 0x9E3779B97F4A7C15ULL) >> 57);
+}
+
+// Bit i of the result is set if tags[i] == needle, for 16 tags.
+inline unsigned smallFlatTagMatch(const uint8_t* tags, uint8_t needle) {
+#if FOLLY_SSE >= 2
+  auto tagV = _mm_loadu_si128(reinterpret_cast<__m128i const*>(tags));
+  auto eqV = _mm_cmpeq_epi8(tagV, _mm_set1_epi8(static_cast<char>(needle)));
+  return static_cast<unsigned>(_mm_movemask_epi8(eqV));
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+  static constexpr uint8_t kBits[16] = {
+      1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  auto eqV = vceqq_u8(vld1q_u8(tags), vdupq_n_u8(needle));
+  auto masked = vandq_u8(eqV, vld1q_u8(kBits));
+  return unsigned(vaddv_u8(vget_low_u8(masked))) |
+      (unsigned(vaddv_u8(vget_high_u8(masked))) << 8);
+#else
+  unsigned mask = 0;
+  for (std::size_t i = 0; i < 16; ++i) {
+    mask |= unsigned(tags[i] == needle) << i;
+  }
+  return mask;
+#endif
+}
+
+struct small_flat_set_key {
+  template <class T>
+  const T& operator()(const T& value) const {
+    return value;
+  }
+};
+
+struct small_flat_map_key {
+  template <class Pair>
+  const typename Pair::first_type& operator()(const Pair& value) const {
+    return value.first;
+  }
+};
+
+/*
+ * The storage and lookup shared by small_flat_set and small_flat_map.
+ *
+ * Both inline and on the heap, the tags are followed by the elements.
+ * The tag array is a multiple of 16 long and zero past size(), so a
+ * lookup can load whole vectors of tags without checking the size.
+ */
+template <
+    class Value,
+    class Key,
+    class KeyOfValue,
+    std::size_t N,
+    class Hash,
+    class KeyEqual,
+    bool ConstIterators>
+class small_flat_table {
+  static_assert(N > 0, "small_flat containers need inline capacity");
+  static_assert(N <= (uint32_t(1) << 31), "inline capacity too large");
+  static_assert(
+      alignof(Value) <= alignof(std::max_align_t),
+      "over-aligned elements are not supported");
+
+  static constexpr std::size_t kInlineTags = (N + 15) & ~std::size_t(15);
+
+ public:
+  typedef Value value_type;
+  typedef Key key_type;
+  typedef Hash hasher;
+  typedef KeyEqual key_equal;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef value_type* pointer;
+  typedef const value_type* const_pointer;
+  typedef const value_type* const_iterator;
+  typedef _t<std::conditional<ConstIterators, const_iterator, value_type*>>
+      iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  small_flat_table() noexcept {
+    std::memset(inline_.tags, 0, kInlineTags);
+  }
+
+  small_flat_table(const small_flat_table& o) : small_flat_table() {
+    reserve(o.size_);
+    for (size_type i = 0; i < o.size_; i++) {
+      new (&values()[i]) value_type(o.values()[i]);
+      tags()[i] = o.tags()[i];
+      size_++;
+    }
+  }
+
+  small_flat_table(small_flat_table&& o) noexcept(
+      std::is_nothrow_move_constructible<value_type>::value)
+      : small_flat_table() {
+    steal(o);
+  }
+
+  ~small_flat_table() {
+    destroyAll();
+    if (!isInline()) {
+      std::free(heap_.tags);
+    }
+  }
+
+  small_flat_table& operator=(const small_flat_table& o) {
+    if (this != &o) {
+      small_flat_table copy(o);
+      clear();
+      steal(copy);
+    }
+    return *this;
+  }
+
+  small_flat_table& operator=(small_flat_table&& o) noexcept(
+      std::is_nothrow_move_constructible<value_type>::value) {
+    if (this != &o) {
+      clear();
+      steal(o);
+    }
+    return *this;
+  }
+
+  iterator begin() {
+    return values();
+  }
+
+  iterator end() {
+    return values() + size_;
+  }
+
+  const_iterator begin() const {
+    return values();
+  }
+
+  const_iterator end() const {
+    return values() + size_;
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_type size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_type capacity() const {
+    return capacity_;
+  }
+
+  size_type max_size() const {
+    return std::numeric_limits<uint32_t>::max();
+  }
+
+  // Whether the elements are in the inline storage.
+  bool isInline() const {
+    return capacity_ == N;
+  }
+
+  void clear() {
+    destroyAll();
+    std::memset(tags(), 0, size_);
+    size_ = 0;
+  }
+
+  void reserve(size_type n) {
+    if (n > capacity_) {
+      relocate(std::max(n, size_type(capacity_) * 2));
+    }
+  }
+
+  // Moves the elements back inline if they fit, and otherwise drops the
+  // unused heap capacity.
+  void shrink_to_fit() {
+    if (!isInline() && size_ < capacity_) {
+      relocate(size_);
+    }
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplaceKey(KeyOfValue()(value), value);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplaceKey(KeyOfValue()(value), std::move(value));
+  }
+
+  iterator insert(const_iterator /* hint */, const value_type& value) {
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator /* hint */, value_type&& value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> list) {
+    insert(list.begin(), list.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    return insert(std::move(value));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator /* hint */, Args&&... args) {
+    return emplace(std::forward<Args>(args)...).first;
+  }
+
+  size_type erase(const key_type& key) {
+    auto i = findIndex(key, smallFlatTag(Hash()(key)));
+    if (i == size_) {
+      return 0;
+    }
+    eraseIndex(i);
+    return 1;
+  }
+
+  // Returns an iterator to the element moved into pos, or end().
+  iterator erase(const_iterator pos) {
+    auto i = size_type(pos - values());
+    eraseIndex(i);
+    return begin() + i;
+  }
+
+  // Keeps the order of the elements after last.
+  iterator erase(const_iterator first, const_iterator last) {
+    auto from = size_type(first - values());
+    auto to = size_type(last - values());
+    if (from == to) {
+      return begin() + from;
+    }
+    auto vals = values();
+    std::move(vals + to, vals + size_, vals + from);
+    for (size_type i = size_ - (to - from); i < size_; i++) {
+      vals[i].~value_type();
+    }
+    std::memmove(tags() + from, tags() + to, size_ - to);
+    std::memset(tags() + size_ - (to - from), 0, to - from);
+    size_ -= uint32_t(to - from);
+    return begin() + from;
+  }
+
+  iterator find(const key_type& key) {
+    return begin() + findIndex(key, smallFlatTag(Hash()(key)));
+  }
+
+  const_iterator find(const key_type& key) const {
+    return begin() + findIndex(key, smallFlatTag(Hash()(key)));
+  }
+
+  size_type count(const key_type& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key) {
+    auto it = find(key);
+    return std::make_pair(it, it == end() ? it : it + 1);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type& key) const {
+    auto it = find(key);
+    return std::make_pair(it, it == end() ? it : it + 1);
+  }
+
+  void swap(small_flat_table& o) {
+    small_flat_table tmp(std::move(o));
+    o = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Equal if they hold the same elements, in any order.
+  bool operator==(const small_flat_table& o) const {
+    if (size_ != o.size_) {
+      return false;
+    }
+    for (const auto& value : *this) {
+      auto it = o.find(KeyOfValue()(value));
+      if (it == o.end() || !(*it == value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const small_flat_table& o) const {
+    return !(*this == o);
+  }
+
+ protected:
+  // Index of key's element, or size() if there is none.
+  size_type findIndex(const key_type& key, uint8_t tag) const {
+    auto tagsp = tags();
+    auto vals = values();
+    for (size_type group = 0; group < size_; group += 16) {
+      auto mask = smallFlatTagMatch(tagsp + group, tag);
+      while (mask) {
+        auto i = group + findFirstSet(mask) - 1;
+        if (KeyEqual()(key, KeyOfValue()(vals[i]))) {
+          return i;
+        }
+        mask &= mask - 1;
+      }
+    }
+    return size_;
+  }
+
+  // Inserts value_type(args...) unless key is already present.
+  template <class... Args>
+  std::pair<iterator, bool> emplaceKey(const key_type& key, Args&&... args) {
+    auto tag = smallFlatTag(Hash()(key));
+    auto i = findIndex(key, tag);
+    if (i < size_) {
+      return std::make_pair(begin() + i, false);
+    }
+    if (size_ == capacity_) {
+      relocate(size_type(capacity_) * 2);
+    }
+    new (&values()[size_]) value_type(std::forward<Args>(args)...);
+    tags()[size_] = tag;
+    size_++;
+    return std::make_pair(begin() + i, true);
+  }
+
+ private:
+  uint8_t* tags() {
+    return isInline() ? inline_.tags : heap_.tags;
+  }
+
+  const uint8_t* tags() const {
+    return isInline() ? inline_.tags : heap_.tags;
+  }
+
+  value_type* values() {
+    return isInline() ? reinterpret_cast<value_type*>(inline_.values)
+                      : heap_.values;
+  }
+
+  const value_type* values() const {
+    return isInline() ? reinterpret_cast<const value_type*>(inline_.values)
+                      : heap_.values;
+  }
+
+  void destroyAll() {
+    auto vals = values();
+    for (size_type i = 0; i < size_; i++) {
+      vals[i].~value_type();
+    }
+  }
+
+  void eraseIndex(size_type i) {
+    auto vals = values();
+    auto last = size_ - 1;
+    if (i != last) {
+      vals[i] = std::move(vals[last]);
+      tags()[i] = tags()[last];
+    }
+    vals[last].~value_type();
+    tags()[last] = 0;
+    size_--;
+  }
+
+  // Moves the elements to inline storage, if n fits, or else to a heap
+  // block for n rounded up to a multiple of 16.
+  void relocate(size_type n) {
+    size_type newcapacity = n <= N ? N : (n + 15) & ~size_type(15);
+    if (newcapacity == capacity_) {
+      return;
+    }
+    uint8_t* newblock = nullptr;
+    value_type* newvalues;
+    if (newcapacity == N) {
+      // The heap pointers only overlap the inline tags, which are
+      // written last.
+      newvalues = reinterpret_cast<value_type*>(inline_.values);
+    } else {
+      newblock = static_cast<uint8_t*>(
+          checkedMalloc(newcapacity * (1 + sizeof(value_type))));
+      newvalues = reinterpret_cast<value_type*>(newblock + newcapacity);
+    }
+
+    auto vals = values();
+    try {
+      uninitialized_relocate(vals, vals + size_, newvalues);
+    } catch (...) {
+      std::free(newblock);
+      throw;
+    }
+
+    auto oldtags = tags();
+    auto oldblock = isInline() ? nullptr : heap_.tags;
+    if (newblock) {
+      std::memcpy(newblock, oldtags, size_);
+      std::memset(newblock + size_, 0, newcapacity - size_);
+      heap_.tags = newblock;
+      heap_.values = newvalues;
+    } else {
+      std::memcpy(inline_.tags, oldtags, size_);
+      std::memset(inline_.tags + size_, 0, kInlineTags - size_);
+    }
+    std::free(oldblock);
+    capacity_ = uint32_t(newcapacity);
+  }
+
+  // Takes o's elements, leaving it empty.  *this must be empty.
+  void steal(small_flat_table& o) {
+    if (!isInline()) {
+      std::free(heap_.tags);
+      capacity_ = N;
+      std::memset(inline_.tags, 0, kInlineTags);
+    }
+    if (o.isInline()) {
+      auto vals = values();
+      auto ovals = o.values();
+      for (size_type i = 0; i < o.size_; i++) {
+        new (&vals[i]) value_type(std::move(ovals[i]));
+        inline_.tags[i] = o.inline_.tags[i];
+        size_++;
+      }
+      o.clear();
+      return;
+    }
+    heap_ = o.heap_;
+    capacity_ = o.capacity_;
+    size_ = o.size_;
+    o.capacity_ = N;
+    o.size_ = 0;
+    std::memset(o.inline_.tags, 0, kInlineTags);
+  }
+
+  struct InlineStorage {
+    uint8_t tags[kInlineTags];
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::
+        type values[N];
+  };
+
+  struct HeapStorage {
+    uint8_t* tags;
+    value_type* values;
+  };
+
+  uint32_t size_{0};
+  uint32_t capacity_{N};
+  union {
+    InlineStorage inline_;
+    HeapStorage heap_;
+  };
+};
+
+} // namespace detail
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * A small_flat_set is a set of up to N elements stored inline, and more
+ * on the heap, found by comparing their hash tags with SIMD.  Elements
+ * may not be modified, so both iterators are const.
+ *
+ * @param class T         Data type to store
+ * @param size_t N        Number of elements stored inline
+ * @param class Hash      Hash function
+ * @param class KeyEqual  Equality of T
+ */
+template <
+    class T,
+    std::size_t N = 16,
+    class Hash = std::hash<T>,
+    class KeyEqual = std::equal_to<T>>
+class small_flat_set : public detail::small_flat_table<
+                           T,
+                           T,
+                           detail::small_flat_set_key,
+                           N,
+                           Hash,
+                           KeyEqual,
+                           true> {
+  using Base = detail::small_flat_table<
+      T,
+      T,
+      detail::small_flat_set_key,
+      N,
+      Hash,
+      KeyEqual,
+      true>;
+
+ public:
+  small_flat_set() = default;
+
+  template <class InputIterator>
+  small_flat_set(InputIterator first, InputIterator last) {
+    this->insert(first, last);
+  }
+
+  /* implicit */ small_flat_set(std::initializer_list<T> list) {
+    this->insert(list.begin(), list.end());
+  }
+
+  small_flat_set& operator=(std::initializer_list<T> list) {
+    this->clear();
+    this->insert(list.begin(), list.end());
+    return *this;
+  }
+};
+
+// Swap function that can be found using ADL.
+template <class T, std::size_t N, class H, class E>
+inline void swap(small_flat_set<T, N, H, E>& a, small_flat_set<T, N, H, E>& b) {
+  return a.swap(b);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * A small_flat_map is similar to a small_flat_set but stores
+ * <key,value> pairs instead of single elements.
+ *
+ * @param class Key       Key type
+ * @param class Value     Value type
+ * @param size_t N        Number of pairs stored inline
+ * @param class Hash      Hash function for keys
+ * @param class KeyEqual  Equality of keys
+ */
+template <
+    class Key,
+    class Value,
+    std::size_t N = 16,
+    class Hash = std::hash<Key>,
+    class KeyEqual = std::equal_to<Key>>
+class small_flat_map : public detail::small_flat_table<
+                           std::pair<Key, Value>,
+                           Key,
+                           detail::small_flat_map_key,
+                           N,
+                           Hash,
+                           KeyEqual,
+                           false> {
+  using Base = detail::small_flat_table<
+      std::pair<Key, Value>,
+      Key,
+      detail::small_flat_map_key,
+      N,
+      Hash,
+      KeyEqual,
+      false>;
+
+ public:
+  typedef Value mapped_type;
+  using typename Base::const_iterator;
+  using typename Base::iterator;
+  using typename Base::key_type;
+  using typename Base::value_type;
+
+  small_flat_map() = default;
+
+  template <class InputIterator>
+  small_flat_map(InputIterator first, InputIterator last) {
+    this->insert(first, last);
+  }
+
+  /* implicit */ small_flat_map(std::initializer_list<value_type> list) {
+    this->insert(list.begin(), list.end());
+  }
+
+  small_flat_map& operator=(std::initializer_list<value_type> list) {
+    this->clear();
+    this->insert(list.begin(), list.end());
+    return *this;
+  }
+
+  // Unlike emplace(), constructs nothing if key is already present.
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    return this->emplaceKey(
+        key,
+        std::piecewise_construct,
+        std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+    auto res = try_emplace(key, std::forward<M>(obj));
+    if (!res.second) {
+      res.first->second = std::forward<M>(obj);
+    }
+    return res;
+  }
+
+  mapped_type& at(const key_type& key) {
+    auto it = this->find(key);
+    if (it != this->end()) {
+      return it->second;
+    }
+    std::__throw_out_of_range("small_flat_map::at");
+  }
+
+  const mapped_type& at(const key_type& key) const {
+    auto it = this->find(key);
+    if (it != this->end()) {
+      return it->second;
+    }
+    std::__throw_out_of_range("small_flat_map::at");
+  }
+
+  mapped_type& operator[](const key_type& key) {
+    return try_emplace(key).first->second;
+  }
+};
+
+// Swap function that can be found using ADL.
+template <class K, class V, std::size_t N, class H, class E>
+inline void swap(
+    small_flat_map<K, V, N, H, E>& a,
+    small_flat_map<K, V, N, H, E>& b) {
+  return a.swap(b);
+}
+
+} // namespace folly
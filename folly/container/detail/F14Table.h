@@ -0,0 +1,1121 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/Traits.h>
+#include <folly/hash/Hash.h>
+#include <folly/memory/Relocate.h>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Internals shared by F14Map.h and F14Set.h.
+ *
+ * An F14 table is an open-addressed hash table whose slots are grouped into
+ * chunks of kChunkCapacity (14) items.  Each chunk starts with a 16-byte
+ * header holding one tag byte per slot, a control byte and an overflow
+ * counter.  A tag is 8 bits of (secondary) hash with the top bit forced on,
+ * so an empty slot is simply a zero tag.  A lookup computes the tag once,
+ * loads the 16-byte header into a vector register (SSE2 or NEON) and
+ * compares all 14 tags in parallel; only the slots whose tag matches are
+ * passed to the key equality predicate, which makes false-positive key
+ * comparisons rare (about 1 in 128 per slot).
+ *
+ * Chunks are probed with a double-hashing sequence whose stride is derived
+ * from the tag.  The overflow counter of a chunk records how many keys that
+ * hashed to it (or passed through it) were displaced to a later chunk, so
+ * an unsuccessful lookup usually terminates after a single chunk.
+ */
+
+namespace folly {
+namespace f14 {
+namespace detail {
+
+template <typename T, typename = void>
+struct HasFollyHasher : std::false_type {};
+
+template <typename T>
+struct HasFollyHasher<T, void_t<decltype(sizeof(folly::hasher<T>))>>
+    : std::true_type {};
+
+template <typename T>
+using DefaultHasherImpl = typename std::conditional<
+    HasFollyHasher<T>::value,
+    folly::hasher<T>,
+    std::hash<T>>::type;
+
+} // namespace detail
+
+/**
+ * The default hasher uses folly::hasher<T> when it is specialized for T
+ * (integers, enums, std::string, pairs and tuples), and std::hash<T>
+ * otherwise.  Hash values are always post-mixed by the table, so weak
+ * hashers (such as identity std::hash<int>) are fine.
+ */
+template <typename T>
+using DefaultHasher = detail::DefaultHasherImpl<T>;
+
+template <typename T>
+using DefaultKeyEqual = std::equal_to<T>;
+
+template <typename T>
+using DefaultAlloc = std::allocator<T>;
+
+namespace detail {
+
+constexpr std::size_t kChunkCapacity = 14;
+constexpr unsigned kFullMask = (1u << kChunkCapacity) - 1;
+
+// Keep the load factor at or below 12/14 once we have more than one chunk.
+constexpr std::size_t kDesiredCapacityPerChunk = 12;
+
+// Chunk 0 is marked so that iteration (which proceeds from the last chunk
+// down to the first) knows where to stop without consulting the table.
+constexpr uint8_t kEofMarker = 0x1;
+
+template <typename ItemType>
+struct alignas(16) F14Chunk {
+  using Item = ItemType;
+
+  static_assert(
+      alignof(Item) <= 16,
+      "F14 value containers don't support over-aligned types; "
+      "use a node container instead");
+
+  std::array<uint8_t, kChunkCapacity> tags_;
+  uint8_t control_;
+  uint8_t outboundOverflowCount_;
+  std::array<
+      typename std::aligned_storage<sizeof(Item), alignof(Item)>::type,
+      kChunkCapacity>
+      rawItems_;
+
+  // A never-written chunk that empty tables point at, so that lookups in
+  // an empty table don't need a special case.  Zero-initialized because of
+  // static storage duration.
+  static F14Chunk* emptyInstance() {
+    static F14Chunk instance;
+    return &instance;
+  }
+
+  void clearHeader() {
+    std::memset(&tags_[0], 0, 16);
+  }
+
+  void markEof() {
+    control_ |= kEofMarker;
+  }
+
+  bool eof() const {
+    return (control_ & kEofMarker) != 0;
+  }
+
+  unsigned outboundOverflowCount() const {
+    return outboundOverflowCount_;
+  }
+
+  void incrOutboundOverflowCount() {
+    if (outboundOverflowCount_ != 255) {
+      ++outboundOverflowCount_;
+    }
+  }
+
+  void decrOutboundOverflowCount() {
+    // once saturated the count is sticky, which is conservative but safe
+    if (outboundOverflowCount_ != 255) {
+      --outboundOverflowCount_;
+    }
+  }
+
+  uint8_t tag(std::size_t index) const {
+    return tags_[index];
+  }
+
+  void setTag(std::size_t index, uint8_t tag) {
+    tags_[index] = tag;
+  }
+
+  void clearTag(std::size_t index) {
+    tags_[index] = 0;
+  }
+
+  bool occupied(std::size_t index) const {
+    return tags_[index] != 0;
+  }
+
+#if FOLLY_SSE >= 2
+  __m128i tagVector() const {
+    return _mm_load_si128(reinterpret_cast<__m128i const*>(&tags_[0]));
+  }
+
+  unsigned tagMatchMask(uint8_t needle) const {
+    auto needleV = _mm_set1_epi8(static_cast<char>(needle));
+    auto eqV = _mm_cmpeq_epi8(tagVector(), needleV);
+    return static_cast<unsigned>(_mm_movemask_epi8(eqV)) & kFullMask;
+  }
+
+  unsigned occupiedMask() const {
+    // tags have their top bit set, the movemask collects exactly those bits
+    return static_cast<unsigned>(_mm_movemask_epi8(tagVector())) & kFullMask;
+  }
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+  static unsigned movemask(uint8x16_t v) {
+    static constexpr uint8_t kBits[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    auto masked = vandq_u8(v, vld1q_u8(kBits));
+    return unsigned(vaddv_u8(vget_low_u8(masked))) |
+        (unsigned(vaddv_u8(vget_high_u8(masked))) << 8);
+  }
+
+  unsigned tagMatchMask(uint8_t needle) const {
+    auto eqV = vceqq_u8(vld1q_u8(&tags_[0]), vdupq_n_u8(needle));
+    return movemask(eqV) & kFullMask;
+  }
+
+  unsigned occupiedMask() const {
+    auto topBits = vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(&tags_[0])),
+                            vdupq_n_s8(0));
+    return movemask(topBits) & kFullMask;
+  }
+#else
+  unsigned tagMatchMask(uint8_t needle) const {
+    unsigned mask = 0;
+    for (std::size_t i = 0; i < kChunkCapacity; ++i) {
+      mask |= unsigned(tags_[i] == needle) << i;
+    }
+    return mask;
+  }
+
+  unsigned occupiedMask() const {
+    unsigned mask = 0;
+    for (std::size_t i = 0; i < kChunkCapacity; ++i) {
+      mask |= unsigned(tags_[i] >> 7) << i;
+    }
+    return mask;
+  }
+#endif
+
+  unsigned emptyMask() const {
+    return occupiedMask() ^ kFullMask;
+  }
+
+  Item* itemAddr(std::size_t index) {
+    return static_cast<Item*>(static_cast<void*>(&rawItems_[index]));
+  }
+
+  Item const* itemAddr(std::size_t index) const {
+    return static_cast<Item const*>(static_cast<void const*>(&rawItems_[index]));
+  }
+
+  Item& item(std::size_t index) {
+    return *itemAddr(index);
+  }
+
+  Item const& item(std::size_t index) const {
+    return *itemAddr(index);
+  }
+};
+
+/**
+ * Position of an item within a table.  A default-constructed F14ItemIter
+ * is the end-of-table sentinel.  Iteration visits chunks from the highest
+ * index to chunk 0, and slots within a chunk from high to low.
+ */
+template <typename ChunkPtr>
+class F14ItemIter {
+ public:
+  using Chunk = typename std::remove_pointer<ChunkPtr>::type;
+  using Item = typename Chunk::Item;
+
+  F14ItemIter() noexcept : chunk_(nullptr), index_(0) {}
+
+  F14ItemIter(ChunkPtr chunk, std::size_t index)
+      : chunk_(chunk), index_(index) {}
+
+  // Returns the first item at or below (chunk, index).
+  static F14ItemIter atOrBelow(ChunkPtr chunk, std::size_t index) {
+    unsigned mask = chunk->occupiedMask() & ((2u << index) - 1);
+    while (mask == 0) {
+      if (chunk->eof()) {
+        return F14ItemIter{};
+      }
+      --chunk;
+      mask = chunk->occupiedMask();
+    }
+    return F14ItemIter{chunk, static_cast<std::size_t>(findLastSet(mask) - 1)};
+  }
+
+  void advance() {
+    if (index_ > 0) {
+      *this = atOrBelow(chunk_, index_ - 1);
+    } else if (chunk_->eof()) {
+      *this = F14ItemIter{};
+    } else {
+      *this = atOrBelow(chunk_ - 1, kChunkCapacity - 1);
+    }
+  }
+
+  bool atEnd() const {
+    return chunk_ == nullptr;
+  }
+
+  ChunkPtr chunk() const {
+    return chunk_;
+  }
+
+  std::size_t index() const {
+    return index_;
+  }
+
+  Item& item() const {
+    return chunk_->item(index_);
+  }
+
+  bool operator==(F14ItemIter const& rhs) const {
+    return chunk_ == rhs.chunk_ && index_ == rhs.index_;
+  }
+
+  bool operator!=(F14ItemIter const& rhs) const {
+    return !(*this == rhs);
+  }
+
+ private:
+  ChunkPtr chunk_;
+  std::size_t index_;
+};
+
+// Value types of maps are pairs with a const key, which can't be moved
+// from.  When a table is rehashed the source is destroyed immediately after
+// it is transferred, so it is safe to cast the constness away.
+template <typename Alloc, typename K, typename M>
+void constructTransferredValue(
+    Alloc& alloc,
+    std::pair<K const, M>* dst,
+    std::pair<K const, M>& src) {
+  constexpr bool kNothrow = std::is_nothrow_move_constructible<K>::value &&
+      std::is_nothrow_move_constructible<M>::value;
+  using KeyRef = typename std::conditional<kNothrow, K&&, K const&>::type;
+  using MappedRef = typename std::conditional<kNothrow, M&&, M const&>::type;
+  std::allocator_traits<Alloc>::construct(
+      alloc,
+      dst,
+      std::piecewise_construct,
+      std::forward_as_tuple(static_cast<KeyRef>(const_cast<K&>(src.first))),
+      std::forward_as_tuple(static_cast<MappedRef>(src.second)));
+}
+
+template <typename Alloc, typename T>
+void constructTransferredValue(Alloc& alloc, T* dst, T& src) {
+  std::allocator_traits<Alloc>::construct(alloc, dst, std::move_if_noexcept(src));
+}
+
+template <typename Key, typename Mapped>
+struct ValueTypeTraits {
+  using Value = std::pair<Key const, Mapped>;
+
+  static Key const& keyForValue(Value const& value) {
+    return value.first;
+  }
+};
+
+template <typename Key>
+struct ValueTypeTraits<Key, void> {
+  using Value = Key;
+
+  static Key const& keyForValue(Value const& value) {
+    return value;
+  }
+};
+
+template <
+    typename KeyType,
+    typename MappedType,
+    typename HasherType,
+    typename KeyEqualType,
+    typename AllocType>
+class BasePolicy : public ValueTypeTraits<KeyType, MappedType> {
+ public:
+  using Key = KeyType;
+  using Mapped = MappedType;
+  using Value = typename ValueTypeTraits<Key, Mapped>::Value;
+  using Hasher = HasherType;
+  using KeyEqual = KeyEqualType;
+  using Alloc = typename std::allocator_traits<
+      AllocType>::template rebind_alloc<Value>;
+  using AllocTraits = std::allocator_traits<Alloc>;
+
+  static_assert(
+      std::is_same<typename AllocType::value_type, Value>::value,
+      "wrong allocator value_type");
+
+  BasePolicy(Hasher const& hasher, KeyEqual const& keyEqual, Alloc const& alloc)
+      : hasher_(hasher), keyEqual_(keyEqual), alloc_(alloc) {}
+
+  Hasher const& hasher() const {
+    return hasher_;
+  }
+
+  KeyEqual const& keyEqual() const {
+    return keyEqual_;
+  }
+
+  Alloc& alloc() {
+    return alloc_;
+  }
+
+  Alloc const& alloc() const {
+    return alloc_;
+  }
+
+  // Computes the (unmixed) hash of a key.
+  std::size_t computeKeyHash(Key const& key) const {
+    return hasher_(key);
+  }
+
+  bool keyMatches(Key const& needle, Key const& stored) const {
+    return keyEqual_(needle, stored);
+  }
+
+  void swapPolicy(BasePolicy& rhs) {
+    using std::swap;
+    swap(hasher_, rhs.hasher_);
+    swap(keyEqual_, rhs.keyEqual_);
+    if (AllocTraits::propagate_on_container_swap::value) {
+      swap(alloc_, rhs.alloc_);
+    }
+  }
+
+  void moveAssignPolicy(BasePolicy&& rhs) {
+    hasher_ = std::move(rhs.hasher_);
+    keyEqual_ = std::move(rhs.keyEqual_);
+    if (AllocTraits::propagate_on_container_move_assignment::value) {
+      alloc_ = std::move(rhs.alloc_);
+    }
+  }
+
+ private:
+  Hasher hasher_;
+  KeyEqual keyEqual_;
+  Alloc alloc_;
+};
+
+/**
+ * Values are stored directly in the chunks.  Most memory efficient and
+ * fastest for small values, but references and iterators are invalidated
+ * by rehash.
+ */
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher,
+    typename KeyEqual,
+    typename Alloc>
+class ValueContainerPolicy
+    : public BasePolicy<Key, Mapped, Hasher, KeyEqual, Alloc> {
+ public:
+  using Super = BasePolicy<Key, Mapped, Hasher, KeyEqual, Alloc>;
+  using typename Super::Value;
+  using typename Super::AllocTraits;
+  using Item = Value;
+
+  static constexpr bool kStableReferences = false;
+  // Relocatable values are transferred with memcpy, after which the old
+  // copy is just forgotten
+  static constexpr bool kTransferRelocates =
+      IsRelocatableWith<Value, Alloc>::value;
+
+  using Super::Super;
+
+  static Value& valueAtItem(Item& item) {
+    return item;
+  }
+
+  static Value const& valueAtItem(Item const& item) {
+    return item;
+  }
+
+  template <typename... Args>
+  void constructValueAtItem(Item* itemAddr, Args&&... args) {
+    AllocTraits::construct(
+        this->alloc(), itemAddr, std::forward<Args>(args)...);
+  }
+
+  void transferItem(Item* dst, Item& src) {
+    if (kTransferRelocates) {
+      std::memcpy(
+          static_cast<void*>(dst),
+          static_cast<const void*>(std::addressof(src)),
+          sizeof(Item));
+    } else {
+      constructTransferredValue(this->alloc(), dst, src);
+    }
+  }
+
+  void destroyTransferredItem(Item& src) {
+    if (!kTransferRelocates) {
+      destroyItem(src);
+    }
+  }
+
+  void destroyItem(Item& item) {
+    AllocTraits::destroy(this->alloc(), std::addressof(item));
+  }
+};
+
+/**
+ * Values are allocated individually and the chunks store pointers, so
+ * references to values (but not iterators) stay valid across rehash.
+ */
+template <
+    typename Key,
+    typename Mapped,
+    typename Hasher,
+    typename KeyEqual,
+    typename Alloc>
+class NodeContainerPolicy
+    : public BasePolicy<Key, Mapped, Hasher, KeyEqual, Alloc> {
+ public:
+  using Super = BasePolicy<Key, Mapped, Hasher, KeyEqual, Alloc>;
+  using typename Super::Value;
+  using typename Super::AllocTraits;
+  using Item = typename AllocTraits::pointer;
+
+  static constexpr bool kStableReferences = true;
+  // Only the pointers move
+  static constexpr bool kTransferRelocates = true;
+
+  using Super::Super;
+
+  static Value& valueAtItem(Item& item) {
+    return *item;
+  }
+
+  static Value const& valueAtItem(Item const& item) {
+    return *item;
+  }
+
+  template <typename... Args>
+  void constructValueAtItem(Item* itemAddr, Args&&... args) {
+    Item node = AllocTraits::allocate(this->alloc(), 1);
+    try {
+      AllocTraits::construct(
+          this->alloc(), std::addressof(*node), std::forward<Args>(args)...);
+    } catch (...) {
+      AllocTraits::deallocate(this->alloc(), node, 1);
+      throw;
+    }
+    new (itemAddr) Item(node);
+  }
+
+  void transferItem(Item* dst, Item& src) {
+    new (dst) Item(src);
+  }
+
+  void destroyTransferredItem(Item& src) {
+    // ownership of the node moved to the new slot
+    src.~Item();
+  }
+
+  void destroyItem(Item& item) {
+    AllocTraits::destroy(this->alloc(), std::addressof(*item));
+    AllocTraits::deallocate(this->alloc(), item, 1);
+    item.~Item();
+  }
+};
+
+/**
+ * The table proper.  Policy supplies the Item type stored in the chunks,
+ * how to construct/destroy/transfer them, and the hasher, equality
+ * predicate and allocator.
+ */
+template <typename Policy>
+class F14Table : public Policy {
+ public:
+  using Key = typename Policy::Key;
+  using Value = typename Policy::Value;
+  using Item = typename Policy::Item;
+  using Hasher = typename Policy::Hasher;
+  using KeyEqual = typename Policy::KeyEqual;
+  using Alloc = typename Policy::Alloc;
+  using Chunk = F14Chunk<Item>;
+  using ChunkAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Chunk>;
+  using ChunkAllocTraits = std::allocator_traits<ChunkAlloc>;
+  using ItemIter = F14ItemIter<Chunk*>;
+  using HashPair = std::pair<std::size_t, uint8_t>;
+
+  F14Table(
+      std::size_t initialCapacity,
+      Hasher const& hasher,
+      KeyEqual const& keyEqual,
+      Alloc const& alloc)
+      : Policy(hasher, keyEqual, alloc) {
+    if (initialCapacity > 0) {
+      reserve(initialCapacity);
+    }
+  }
+
+  F14Table(F14Table const& rhs)
+      : Policy(
+            rhs.hasher(),
+            rhs.keyEqual(),
+            std::allocator_traits<Alloc>::
+                select_on_container_copy_construction(rhs.alloc())) {
+    copyFrom(rhs);
+  }
+
+  F14Table(F14Table const& rhs, Alloc const& alloc)
+      : Policy(rhs.hasher(), rhs.keyEqual(), alloc) {
+    copyFrom(rhs);
+  }
+
+  F14Table(F14Table&& rhs) noexcept
+      : Policy(rhs.hasher(), rhs.keyEqual(), std::move(rhs.alloc())) {
+    stealFrom(rhs);
+  }
+
+  F14Table(F14Table&& rhs, Alloc const& alloc)
+      : Policy(rhs.hasher(), rhs.keyEqual(), alloc) {
+    if (alloc == rhs.alloc()) {
+      stealFrom(rhs);
+    } else {
+      reserve(rhs.size());
+      for (auto iter = rhs.begin(); !iter.atEnd(); iter.advance()) {
+        insertUnique(
+            rhs.splitHash(rhs.computeKeyHash(rhs.keyForItem(iter.item()))),
+            std::move(Policy::valueAtItem(iter.item())));
+      }
+      rhs.clear();
+    }
+  }
+
+  F14Table& operator=(F14Table const& rhs) {
+    if (this != &rhs) {
+      F14Table tmp(rhs);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  F14Table& operator=(F14Table&& rhs) noexcept(
+      std::allocator_traits<
+          Alloc>::propagate_on_container_move_assignment::value) {
+    if (this != &rhs) {
+      reset();
+      this->moveAssignPolicy(std::move(rhs));
+      if (std::allocator_traits<
+              Alloc>::propagate_on_container_move_assignment::value ||
+          this->alloc() == rhs.alloc()) {
+        stealFrom(rhs);
+      } else {
+        // Our allocator stays, so rhs's chunks and nodes can't be taken
+        reserve(rhs.size());
+        for (auto iter = rhs.begin(); !iter.atEnd(); iter.advance()) {
+          insertUnique(
+              computeHashPair(rhs.keyForItem(iter.item())),
+              std::move(Policy::valueAtItem(iter.item())));
+        }
+        rhs.clear();
+      }
+    }
+    return *this;
+  }
+
+  ~F14Table() {
+    reset();
+  }
+
+  void swap(F14Table& rhs) noexcept {
+    this->swapPolicy(rhs);
+    std::swap(chunks_, rhs.chunks_);
+    std::swap(chunkMask_, rhs.chunkMask_);
+    std::swap(size_, rhs.size_);
+  }
+
+  //////// capacity
+
+  std::size_t size() const noexcept {
+    return size_;
+  }
+
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  std::size_t max_size() const noexcept {
+    return std::numeric_limits<std::size_t>::max() / 2 / sizeof(Chunk) *
+        kDesiredCapacityPerChunk;
+  }
+
+  std::size_t chunkCount() const noexcept {
+    return allocated() ? chunkMask_ + 1 : 0;
+  }
+
+  std::size_t bucket_count() const noexcept {
+    return chunkCount() * kChunkCapacity;
+  }
+
+  float load_factor() const noexcept {
+    auto buckets = bucket_count();
+    return buckets == 0 ? 0.0f : static_cast<float>(size_) / buckets;
+  }
+
+  // Number of items that fit before the next rehash.
+  std::size_t capacity() const noexcept {
+    return capacityForChunkCount(chunkCount());
+  }
+
+  void reserve(std::size_t capacity) {
+    if (capacity > this->capacity()) {
+      rehashImpl(chunkCountForCapacity(capacity));
+    }
+  }
+
+  void rehash(std::size_t bucketCount) {
+    auto desired = std::max(
+        size_,
+        (bucketCount + kChunkCapacity - 1) / kChunkCapacity *
+            kDesiredCapacityPerChunk);
+    auto chunkCount = desired == 0 ? 0 : chunkCountForCapacity(desired);
+    if (chunkCount != this->chunkCount()) {
+      if (chunkCount == 0) {
+        reset();
+      } else {
+        rehashImpl(chunkCount);
+      }
+    }
+  }
+
+  //////// lookup
+
+  Key const& keyForItem(Item const& item) const {
+    return Policy::keyForValue(Policy::valueAtItem(item));
+  }
+
+  // Mixes the user-supplied hash and splits it into a starting chunk index
+  // and a tag.  The hasher might put all of its entropy in the low bits
+  // (folly::hasher<int> produces 32 bits, std::hash<int> is the identity),
+  // so we fold a 64x64->128 bit multiply to spread it over the whole word.
+  static HashPair splitHash(std::size_t hash) {
+#if FOLLY_HAVE_INT128_T
+    auto product =
+        static_cast<unsigned __int128>(hash) * 0xc4ceb9fe1a85ec53ULL;
+    auto mixed = static_cast<uint64_t>(product >> 64) ^
+        static_cast<uint64_t>(product);
+#else
+    auto mixed = hash::twang_mix64(hash);
+#endif
+    auto tag = static_cast<uint8_t>((mixed >> 56) | 0x80);
+    return HashPair(static_cast<std::size_t>(mixed), tag);
+  }
+
+  HashPair computeHashPair(Key const& key) const {
+    return splitHash(this->computeKeyHash(key));
+  }
+
+  ItemIter find(Key const& key) const {
+    return findImpl(computeHashPair(key), key);
+  }
+
+  ItemIter findImpl(HashPair hp, Key const& key) const {
+    std::size_t index = hp.first;
+    std::size_t step = probeDelta(hp);
+    for (std::size_t tries = 0; tries <= chunkMask_; ++tries) {
+      Chunk* chunk = chunks_ + (index & chunkMask_);
+      unsigned hits = chunk->tagMatchMask(hp.second);
+      while (hits != 0) {
+        auto i = static_cast<std::size_t>(findFirstSet(hits) - 1);
+        hits &= hits - 1;
+        if (LIKELY(this->keyMatches(key, keyForItem(chunk->item(i))))) {
+          return ItemIter{chunk, i};
+        }
+      }
+      if (LIKELY(chunk->outboundOverflowCount() == 0)) {
+        break;
+      }
+      index += step;
+    }
+    return ItemIter{};
+  }
+
+  //////// iteration
+
+  ItemIter begin() const noexcept {
+    if (size_ == 0) {
+      return ItemIter{};
+    }
+    return ItemIter::atOrBelow(chunks_ + chunkMask_, kChunkCapacity - 1);
+  }
+
+  ItemIter end() const noexcept {
+    return ItemIter{};
+  }
+
+  //////// modifiers
+
+  // Inserts a value constructed from args if key is not already present.
+  // Returns the position of the (new or existing) item and whether an
+  // insertion took place.
+  template <typename... Args>
+  std::pair<ItemIter, bool> tryEmplaceValue(Key const& key, Args&&... args) {
+    auto hp = computeHashPair(key);
+    auto existing = findImpl(hp, key);
+    if (!existing.atEnd()) {
+      return std::make_pair(existing, false);
+    }
+    reserveForInsert();
+    return std::make_pair(
+        insertUnique(hp, std::forward<Args>(args)...), true);
+  }
+
+  void eraseIter(ItemIter pos) {
+    DCHECK(!pos.atEnd());
+    auto hp = computeHashPair(keyForItem(pos.item()));
+    this->destroyItem(pos.item());
+    eraseBlank(pos, hp);
+  }
+
+  // Returns the position following pos in iteration order.
+  ItemIter eraseIterAndAdvance(ItemIter pos) {
+    auto next = pos;
+    next.advance();
+    eraseIter(pos);
+    return next;
+  }
+
+  std::size_t eraseKey(Key const& key) {
+    auto hp = computeHashPair(key);
+    auto pos = findImpl(hp, key);
+    if (pos.atEnd()) {
+      return 0;
+    }
+    this->destroyItem(pos.item());
+    eraseBlank(pos, hp);
+    return 1;
+  }
+
+  void clear() noexcept {
+    if (size_ > 0) {
+      destroyItems();
+      for (std::size_t i = 0; i <= chunkMask_; ++i) {
+        chunks_[i].clearHeader();
+      }
+      chunks_[0].markEof();
+      size_ = 0;
+    }
+  }
+
+  // Frees all of the memory, leaving the table in the same state as a
+  // default constructed one.
+  void reset() noexcept {
+    if (allocated()) {
+      destroyItems();
+      deallocateChunks(chunks_, chunkMask_ + 1);
+      chunks_ = Chunk::emptyInstance();
+      chunkMask_ = 0;
+      size_ = 0;
+    }
+  }
+
+ private:
+  bool allocated() const noexcept {
+    return chunks_ != Chunk::emptyInstance();
+  }
+
+  static std::size_t probeDelta(HashPair hp) {
+    // odd, so the probe sequence visits every chunk of a power-of-two table
+    return 2 * static_cast<std::size_t>(hp.second) + 1;
+  }
+
+  static std::size_t capacityForChunkCount(std::size_t chunkCount) {
+    // a lone chunk may be filled completely, there is nowhere to overflow to
+    return chunkCount <= 1 ? chunkCount * kChunkCapacity
+                           : chunkCount * kDesiredCapacityPerChunk;
+  }
+
+  static std::size_t chunkCountForCapacity(std::size_t capacity) {
+    if (capacity <= kChunkCapacity) {
+      return 1;
+    }
+    return nextPowTwo(
+        (capacity + kDesiredCapacityPerChunk - 1) / kDesiredCapacityPerChunk);
+  }
+
+  void reserveForInsert() {
+    if (UNLIKELY(size_ >= capacity())) {
+      rehashImpl(chunkCountForCapacity(std::max<std::size_t>(size_ * 2, 1)));
+    }
+  }
+
+  // Places a new item without checking for duplicates.  The caller must
+  // have made room for it.
+  template <typename... Args>
+  ItemIter insertUnique(HashPair hp, Args&&... args) {
+    DCHECK_LT(size_, capacity());
+    ItemIter pos = allocateSlot(hp);
+    try {
+      this->constructValueAtItem(
+          pos.chunk()->itemAddr(pos.index()), std::forward<Args>(args)...);
+    } catch (...) {
+      eraseBlank(pos, hp);
+      throw;
+    }
+    return pos;
+  }
+
+  // Claims an empty slot for hp, updating the overflow counts along the
+  // way.  The slot's tag is set, but its item is left unconstructed.
+  ItemIter allocateSlot(HashPair hp) {
+    std::size_t index = hp.first;
+    std::size_t step = probeDelta(hp);
+    Chunk* chunk = chunks_ + (index & chunkMask_);
+    unsigned empty = chunk->emptyMask();
+    while (empty == 0) {
+      chunk->incrOutboundOverflowCount();
+      index += step;
+      chunk = chunks_ + (index & chunkMask_);
+      empty = chunk->emptyMask();
+    }
+    auto i = static_cast<std::size_t>(findFirstSet(empty) - 1);
+    chunk->setTag(i, hp.second);
+    ++size_;
+    return ItemIter{chunk, i};
+  }
+
+  // Undoes allocateSlot.  The item must already have been destroyed.
+  void eraseBlank(ItemIter pos, HashPair hp) {
+    pos.chunk()->clearTag(pos.index());
+    std::size_t index = hp.first;
+    std::size_t step = probeDelta(hp);
+    Chunk* chunk = chunks_ + (index & chunkMask_);
+    while (chunk != pos.chunk()) {
+      chunk->decrOutboundOverflowCount();
+      index += step;
+      chunk = chunks_ + (index & chunkMask_);
+    }
+    --size_;
+  }
+
+  Chunk* allocateChunks(std::size_t chunkCount) {
+    ChunkAlloc chunkAlloc(this->alloc());
+    Chunk* chunks = std::addressof(
+        *ChunkAllocTraits::allocate(chunkAlloc, chunkCount));
+    for (std::size_t i = 0; i < chunkCount; ++i) {
+      chunks[i].clearHeader();
+    }
+    chunks[0].markEof();
+    return chunks;
+  }
+
+  void deallocateChunks(Chunk* chunks, std::size_t chunkCount) {
+    ChunkAlloc chunkAlloc(this->alloc());
+    ChunkAllocTraits::deallocate(chunkAlloc, chunks, chunkCount);
+  }
+
+  void destroyItems() noexcept {
+    for (std::size_t ci = 0; ci <= chunkMask_ && size_ > 0; ++ci) {
+      Chunk& chunk = chunks_[ci];
+      unsigned mask = chunk.occupiedMask();
+      while (mask != 0) {
+        auto i = static_cast<std::size_t>(findFirstSet(mask) - 1);
+        mask &= mask - 1;
+        this->destroyItem(chunk.item(i));
+      }
+    }
+  }
+
+  void rehashImpl(std::size_t newChunkCount) {
+    DCHECK_GE(capacityForChunkCount(newChunkCount), size_);
+    Chunk* oldChunks = chunks_;
+    std::size_t oldChunkCount = chunkCount();
+    std::size_t oldSize = size_;
+
+    Chunk* newChunks = allocateChunks(newChunkCount);
+    chunks_ = newChunks;
+    chunkMask_ = newChunkCount - 1;
+    size_ = 0;
+
+    // Every item is constructed in the new chunks before any of the old
+    // ones are destroyed.  Items are relocated, or moved if that can't
+    // throw and copied otherwise, so on failure the old table is still
+    // intact.
+    try {
+      for (std::size_t ci = 0; ci < oldChunkCount; ++ci) {
+        Chunk& chunk = oldChunks[ci];
+        unsigned mask = chunk.occupiedMask();
+        while (mask != 0) {
+          auto i = static_cast<std::size_t>(findFirstSet(mask) - 1);
+          mask &= mask - 1;
+          Item& src = chunk.item(i);
+          auto hp = computeHashPair(keyForItem(src));
+          auto pos = allocateSlot(hp);
+          try {
+            this->transferItem(pos.chunk()->itemAddr(pos.index()), src);
+          } catch (...) {
+            eraseBlank(pos, hp);
+            throw;
+          }
+        }
+      }
+    } catch (...) {
+      // Relocated items are still owned by the old chunks
+      if (!Policy::kTransferRelocates) {
+        destroyItems();
+      }
+      deallocateChunks(newChunks, newChunkCount);
+      chunks_ = oldChunks;
+      chunkMask_ = oldChunkCount == 0 ? 0 : oldChunkCount - 1;
+      size_ = oldSize;
+      throw;
+    }
+    DCHECK_EQ(size_, oldSize);
+
+    for (std::size_t ci = 0; ci < oldChunkCount; ++ci) {
+      Chunk& chunk = oldChunks[ci];
+      unsigned mask = chunk.occupiedMask();
+      while (mask != 0) {
+        auto i = static_cast<std::size_t>(findFirstSet(mask) - 1);
+        mask &= mask - 1;
+        this->destroyTransferredItem(chunk.item(i));
+      }
+    }
+    if (oldChunkCount > 0) {
+      deallocateChunks(oldChunks, oldChunkCount);
+    }
+  }
+
+  void copyFrom(F14Table const& rhs) {
+    if (rhs.empty()) {
+      return;
+    }
+    reserve(rhs.size());
+    try {
+      for (auto iter = rhs.begin(); !iter.atEnd(); iter.advance()) {
+        insertUnique(
+            computeHashPair(rhs.keyForItem(iter.item())),
+            Policy::valueAtItem(iter.item()));
+      }
+    } catch (...) {
+      reset();
+      throw;
+    }
+  }
+
+  void stealFrom(F14Table& rhs) noexcept {
+    chunks_ = rhs.chunks_;
+    chunkMask_ = rhs.chunkMask_;
+    size_ = rhs.size_;
+    rhs.chunks_ = Chunk::emptyInstance();
+    rhs.chunkMask_ = 0;
+    rhs.size_ = 0;
+  }
+
+  Chunk* chunks_{Chunk::emptyInstance()};
+  std::size_t chunkMask_{0};
+  std::size_t size_{0};
+};
+
+/**
+ * Iterator exposed by the containers.  Reference is either Value& or
+ * Value const&; the mutable iterator converts to the const one.
+ */
+template <typename ValueType, typename Table>
+class F14Iterator {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename std::remove_const<ValueType>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = ValueType*;
+  using reference = ValueType&;
+
+  F14Iterator() noexcept = default;
+
+  template <
+      typename OtherValueType,
+      typename = typename std::enable_if<
+          std::is_const<ValueType>::value &&
+          std::is_same<OtherValueType, value_type>::value>::type>
+  /* implicit */ F14Iterator(
+      F14Iterator<OtherValueType, Table> const& rhs) noexcept
+      : underlying_(rhs.underlying_) {}
+
+  explicit F14Iterator(typename Table::ItemIter underlying) noexcept
+      : underlying_(underlying) {}
+
+  reference operator*() const {
+    return Table::valueAtItem(underlying_.item());
+  }
+
+  pointer operator->() const {
+    return std::addressof(**this);
+  }
+
+  F14Iterator& operator++() {
+    underlying_.advance();
+    return *this;
+  }
+
+  F14Iterator operator++(int) {
+    auto cur = *this;
+    ++*this;
+    return cur;
+  }
+
+  bool operator==(F14Iterator const& rhs) const {
+    return underlying_ == rhs.underlying_;
+  }
+
+  bool operator!=(F14Iterator const& rhs) const {
+    return !(*this == rhs);
+  }
+
+  typename Table::ItemIter underlying() const {
+    return underlying_;
+  }
+
+ private:
+  template <typename, typename>
+  friend class F14Iterator;
+
+  typename Table::ItemIter underlying_;
+};
+
+} // namespace detail
+} // namespace f14
+} // namespace folly
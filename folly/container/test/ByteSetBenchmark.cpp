@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***
+ *  A benchmark of finding the first delimiter of a buffer with ByteSet,
+ *  SparseByteSet and qfind_first_of.
+ */
+
+#include <folly/container/ByteSet.h>
+
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/Range.h>
+#include <folly/container/SparseByteSet.h>
+#include <folly/portability/GFlags.h>
+
+using namespace std;
+using namespace folly;
+
+namespace {
+
+// Typical delimiters of a tokenizer: whitespace and punctuation
+const StringPiece kDelims = " \t\r\n,;:=&?#[]{}()<>\"'";
+
+string makeHaystack(size_t n) {
+  // No delimiter until the very end
+  string s(n, 'a');
+  for (size_t i = 0; i < n; ++i) {
+    s[i] = char('a' + i % 26);
+  }
+  s.back() = ';';
+  return s;
+}
+
+void byteSetFind(size_t iters, size_t n) {
+  string haystack;
+  ByteSet delims;
+  BENCHMARK_SUSPEND {
+    haystack = makeHaystack(n);
+    delims = ByteSet(kDelims);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(delims.find_first_in(haystack));
+  }
+}
+
+void sparseByteSetFind(size_t iters, size_t n) {
+  string haystack;
+  SparseByteSet delims;
+  BENCHMARK_SUSPEND {
+    haystack = makeHaystack(n);
+    for (auto c : kDelims) {
+      delims.add(uint8_t(c));
+    }
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    size_t j = 0;
+    while (j < haystack.size() && !delims.contains(uint8_t(haystack[j]))) {
+      ++j;
+    }
+    doNotOptimizeAway(j);
+  }
+}
+
+void qfindFirstOf(size_t iters, size_t n) {
+  string haystack;
+  BENCHMARK_SUSPEND {
+    haystack = makeHaystack(n);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(qfind_first_of(StringPiece(haystack), kDelims));
+  }
+}
+
+} // namespace
+
+BENCHMARK_PARAM(sparseByteSetFind, 16)
+BENCHMARK_RELATIVE_PARAM(byteSetFind, 16)
+BENCHMARK_RELATIVE_PARAM(qfindFirstOf, 16)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sparseByteSetFind, 64)
+BENCHMARK_RELATIVE_PARAM(byteSetFind, 64)
+BENCHMARK_RELATIVE_PARAM(qfindFirstOf, 64)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sparseByteSetFind, 1024)
+BENCHMARK_RELATIVE_PARAM(byteSetFind, 1024)
+BENCHMARK_RELATIVE_PARAM(qfindFirstOf, 1024)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sparseByteSetFind, 16384)
+BENCHMARK_RELATIVE_PARAM(byteSetFind, 16384)
+BENCHMARK_RELATIVE_PARAM(qfindFirstOf, 16384)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ByteSet.h>
+
+#include <bitset>
+#include <cctype>
+#include <random>
+#include <string>
+
+#include <folly/portability/GTest.h>
+
+using namespace std;
+using namespace folly;
+
+namespace {
+
+size_t referenceFind(const bitset<256>& set, StringPiece s, bool in) {
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (set[uint8_t(s[i])] == in) {
+      return i;
+    }
+  }
+  return StringPiece::npos;
+}
+
+} // namespace
+
+TEST(ByteSet, empty) {
+  ByteSet s;
+  EXPECT_TRUE(s.empty());
+  for (unsigned c = 0; c < 256; ++c) {
+    EXPECT_FALSE(s.contains(uint8_t(c)));
+  }
+  EXPECT_EQ(StringPiece::npos, s.find_first_in("hello world"));
+  EXPECT_EQ(0, s.find_first_not_in("hello world"));
+  EXPECT_EQ(StringPiece::npos, s.find_first_in(""));
+}
+
+TEST(ByteSet, each) {
+  for (unsigned c = 0; c < 256; ++c) {
+    ByteSet s;
+    s.add(uint8_t(c));
+    EXPECT_EQ(1, s.size());
+    for (unsigned d = 0; d < 256; ++d) {
+      EXPECT_EQ(c == d, s.contains(uint8_t(d)));
+    }
+    // Found at every position of a buffer of every other byte, whatever
+    // the width of the last block
+    for (size_t n = 1; n <= 100; n += 7) {
+      string buf(n, char(c + 1));
+      for (size_t i = 0; i < n; ++i) {
+        buf[i] = char(c);
+        EXPECT_EQ(i, s.find_first_in(buf));
+        buf[i] = char(c + 1);
+      }
+      EXPECT_EQ(StringPiece::npos, s.find_first_in(buf));
+      EXPECT_EQ(0, s.find_first_not_in(buf));
+    }
+  }
+}
+
+TEST(ByteSet, setOperations) {
+  auto digits = ByteSet::range('0', '9');
+  auto alpha = ByteSet::fromPredicate([](char c) { return isalpha(c); });
+  auto alnum = ByteSet::fromPredicate([](char c) { return isalnum(c); });
+  EXPECT_EQ(10, digits.size());
+  EXPECT_EQ(52, alpha.size());
+  EXPECT_EQ(alnum, digits | alpha);
+  EXPECT_TRUE((digits & alpha).empty());
+  EXPECT_EQ(256 - 62, (~alnum).size());
+  EXPECT_NE(digits, alpha);
+  EXPECT_EQ(ByteSet("0123456789"), digits);
+}
+
+TEST(ByteSet, tokenize) {
+  ByteSet delims(" \t\r\n,;");
+  StringPiece input = "GET /index.html HTTP/1.1\r\nHost: example.com;x=1";
+  vector<string> tokens;
+  while (!input.empty()) {
+    input.advance(std::min(input.size(), delims.find_first_not_in(input)));
+    auto end = std::min(input.size(), delims.find_first_in(input));
+    if (end > 0) {
+      tokens.push_back(input.subpiece(0, end).str());
+    }
+    input.advance(end);
+  }
+  EXPECT_EQ(
+      (vector<string>{
+          "GET", "/index.html", "HTTP/1.1", "Host:", "example.com", "x=1"}),
+      tokens);
+}
+
+TEST(ByteSet, random) {
+  mt19937 rng(1234);
+  for (int round = 0; round < 200; ++round) {
+    bitset<256> ref;
+    ByteSet s;
+    auto members = rng() % 64;
+    for (size_t i = 0; i < members; ++i) {
+      auto c = uint8_t(rng());
+      ref[c] = true;
+      s.add(c);
+    }
+    EXPECT_EQ(ref.count(), s.size());
+    // Mostly non-members, at every alignment
+    string buf(rng() % 300, '\0');
+    for (auto& c : buf) {
+      do {
+        c = char(rng());
+      } while (ref[uint8_t(c)] && rng() % 8 != 0);
+    }
+    for (size_t offset = 0; offset < 32 && offset <= buf.size(); ++offset) {
+      StringPiece sp(buf.data() + offset, buf.size() - offset);
+      EXPECT_EQ(referenceFind(ref, sp, true), s.find_first_in(sp));
+      EXPECT_EQ(referenceFind(ref, sp, false), s.find_first_not_in(sp));
+      EXPECT_EQ(referenceFind(ref, sp, false), (~s).find_first_in(sp));
+    }
+  }
+}
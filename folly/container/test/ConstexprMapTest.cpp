@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ConstexprMap.h>
+
+#include <string>
+#include <vector>
+
+#include <folly/FixedString.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+enum class Header { CONTENT_LENGTH, CONTENT_TYPE, HOST, USER_AGENT, OTHER };
+
+#if FOLLY_USE_CPP14_CONSTEXPR
+constexpr
+#endif
+    auto kHeaders = makeConstexprMap<Header>({
+        {"content-length", Header::CONTENT_LENGTH},
+        {"content-type", Header::CONTENT_TYPE},
+        {"host", Header::HOST},
+        {"user-agent", Header::USER_AGENT},
+    });
+
+constexpr auto kGreeting = makeFixedString("hello");
+
+} // namespace
+
+TEST(ConstexprSet, find) {
+  auto set = makeConstexprSet({"get", "set", "delete", "", "incr"});
+  EXPECT_EQ(5, set.size());
+  EXPECT_EQ(0, set.find("get"));
+  EXPECT_EQ(1, set.find("set"));
+  EXPECT_EQ(2, set.find("delete"));
+  EXPECT_EQ(3, set.find(""));
+  EXPECT_EQ(4, set.find("incr"));
+  EXPECT_EQ("delete", set[2]);
+  EXPECT_EQ(set.npos, set.find("decr"));
+  EXPECT_EQ(set.npos, set.find("ge"));
+  EXPECT_EQ(set.npos, set.find("gets"));
+  EXPECT_FALSE(set.contains("GET"));
+  EXPECT_TRUE(set.contains(std::string("incr")));
+}
+
+TEST(ConstexprSet, fixedStringKeys) {
+  auto set = makeConstexprSet({kGreeting, "world"});
+  EXPECT_EQ(0, set.find("hello"));
+  EXPECT_EQ(1, set.find("world"));
+}
+
+TEST(ConstexprSet, many) {
+  // Keys that differ in one character, and built at runtime: the table is
+  // the same either way
+  std::vector<std::string> strings;
+  for (int i = 0; i < 200; ++i) {
+    strings.push_back("key" + std::to_string(i));
+  }
+  StringPiece keys[200];
+  for (size_t i = 0; i < strings.size(); ++i) {
+    keys[i] = strings[i];
+  }
+  ConstexprSet<200> set(keys);
+  for (size_t i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(i, set.find(strings[i]));
+    EXPECT_FALSE(set.contains(strings[i] + "x"));
+  }
+  EXPECT_FALSE(set.contains("key200"));
+}
+
+TEST(ConstexprSet, duplicate) {
+  EXPECT_THROW(makeConstexprSet({"a", "b", "a"}), std::logic_error);
+}
+
+TEST(ConstexprMap, get) {
+  EXPECT_EQ(4, kHeaders.size());
+  ASSERT_NE(nullptr, kHeaders.get_ptr("host"));
+  EXPECT_EQ(Header::HOST, *kHeaders.get_ptr("host"));
+  EXPECT_EQ(nullptr, kHeaders.get_ptr("accept"));
+  EXPECT_EQ(
+      Header::CONTENT_TYPE,
+      kHeaders.get_default("content-type", Header::OTHER));
+  EXPECT_EQ(Header::OTHER, kHeaders.get_default("content", Header::OTHER));
+  EXPECT_TRUE(kHeaders.contains("user-agent"));
+  EXPECT_FALSE(kHeaders.contains("User-Agent"));
+  EXPECT_EQ(0, kHeaders.keys().find("content-length"));
+}
+
+#if FOLLY_USE_CPP14_CONSTEXPR
+TEST(ConstexprMap, constexpr) {
+  constexpr auto map = makeConstexprMap<int>({{"one", 1}, {"two", 2}});
+  static_assert(map.size() == 2, "");
+  static_assert(map.keys()[1].size() == 3, "");
+  EXPECT_EQ(2, map.get_default("two", 0));
+}
+#endif
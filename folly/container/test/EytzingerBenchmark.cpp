@@ -0,0 +1,145 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/Eytzinger.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/sorted_vector_types.h>
+
+using namespace folly;
+
+namespace {
+
+constexpr size_t kQueries = 1 << 16;
+
+// Sorted, spread out keys
+std::vector<uint64_t> makeKeys(size_t n) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < n; i++) {
+    keys.push_back(i * 64 + (i * 0x9E3779B97F4A7C15ULL >> 58));
+  }
+  return keys;
+}
+
+// Random keys in the range of makeKeys(n), half of them present
+std::vector<uint64_t> makeQueries(size_t n, bool sorted) {
+  std::vector<uint64_t> queries;
+  uint64_t x = 12345;
+  for (size_t i = 0; i < kQueries; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    auto const j = (x >> 20) % n;
+    queries.push_back(
+        i % 2 ? j * 64 + (j * 0x9E3779B97F4A7C15ULL >> 58) : j * 64 + 1);
+  }
+  if (sorted) {
+    std::sort(queries.begin(), queries.end());
+  }
+  return queries;
+}
+
+// Built once per size: building takes much longer than the benchmarks
+template <class Set>
+const Set& getSet(size_t n) {
+  static std::map<size_t, Set> sets;
+  auto it = sets.find(n);
+  if (it == sets.end()) {
+    auto keys = makeKeys(n);
+    it = sets.emplace(n, Set(keys.begin(), keys.end())).first;
+  }
+  return it->second;
+}
+
+template <class Set>
+void lookups(size_t iters, size_t n, bool sortedQueries) {
+  const Set* s;
+  std::vector<uint64_t> queries;
+  BENCHMARK_SUSPEND {
+    s = &getSet<Set>(n);
+    queries = makeQueries(n, sortedQueries);
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < iters; i++) {
+    found += s->count(queries[i % kQueries]);
+  }
+  doNotOptimizeAway(found);
+}
+
+// In batches of kBatch queries; time per query
+template <class Set>
+void bulkLookups(size_t iters, size_t n, bool sortedQueries) {
+  constexpr size_t kBatch = 64;
+  const Set* s;
+  std::vector<uint64_t> queries;
+  std::vector<typename Set::const_iterator> results(kBatch);
+  BENCHMARK_SUSPEND {
+    s = &getSet<Set>(n);
+    queries = makeQueries(n, sortedQueries);
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < iters; i += kBatch) {
+    auto const batch = queries.begin() + i % kQueries;
+    s->bulk_lower_bound(batch, batch + kBatch, results.begin());
+    found += results[0] != s->end();
+  }
+  doNotOptimizeAway(found);
+}
+
+void sortedVectorSet(size_t iters, size_t n) {
+  lookups<sorted_vector_set<uint64_t>>(iters, n, false);
+}
+
+void eytzingerSet(size_t iters, size_t n) {
+  lookups<eytzinger_set<uint64_t>>(iters, n, false);
+}
+
+void eytzingerSetBulk(size_t iters, size_t n) {
+  bulkLookups<eytzinger_set<uint64_t>>(iters, n, false);
+}
+
+void sortedVectorSetSortedQueries(size_t iters, size_t n) {
+  lookups<sorted_vector_set<uint64_t>>(iters, n, true);
+}
+
+void sortedVectorSetBulkSortedQueries(size_t iters, size_t n) {
+  bulkLookups<sorted_vector_set<uint64_t>>(iters, n, true);
+}
+
+} // namespace
+
+BENCHMARK_PARAM(sortedVectorSet, 1000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSet, 1000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSetBulk, 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sortedVectorSet, 1000000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSet, 1000000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSetBulk, 1000000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sortedVectorSet, 10000000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSet, 10000000)
+BENCHMARK_RELATIVE_PARAM(eytzingerSetBulk, 10000000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(sortedVectorSetSortedQueries, 10000000)
+BENCHMARK_RELATIVE_PARAM(sortedVectorSetBulkSortedQueries, 10000000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/Eytzinger.h>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(Eytzinger, SetSizes) {
+  // Complete trees and all shapes of last levels
+  for (int n = 0; n < 70; ++n) {
+    std::vector<int> sorted;
+    for (int i = 0; i < n; ++i) {
+      sorted.push_back(2 * i);
+    }
+    // Shuffled, with duplicates
+    std::vector<int> input = sorted;
+    input.insert(input.end(), sorted.rbegin(), sorted.rend());
+    eytzinger_set<int> s(input.begin(), input.end());
+    ASSERT_EQ(n, s.size());
+    EXPECT_EQ(sorted, std::vector<int>(s.begin(), s.end()));
+    EXPECT_EQ(
+        std::vector<int>(sorted.rbegin(), sorted.rend()),
+        std::vector<int>(s.rbegin(), s.rend()));
+
+    for (int k = -1; k <= 2 * n; ++k) {
+      auto expected = std::lower_bound(sorted.begin(), sorted.end(), k);
+      auto lb = s.lower_bound(k);
+      ASSERT_EQ(expected - sorted.begin(), std::distance(s.begin(), lb)) << k;
+      auto ub = s.upper_bound(k);
+      EXPECT_EQ(
+          std::upper_bound(sorted.begin(), sorted.end(), k) - sorted.begin(),
+          std::distance(s.begin(), ub));
+      EXPECT_EQ(k >= 0 && k % 2 == 0 && k < 2 * n ? 1 : 0, s.count(k));
+      EXPECT_EQ(s.count(k) ? lb : s.end(), s.find(k));
+      EXPECT_EQ(std::make_pair(lb, ub), s.equal_range(k));
+    }
+
+    std::vector<int> queries;
+    for (int k = 2 * n; k >= -1; --k) {
+      queries.push_back(k);
+    }
+    std::vector<eytzinger_set<int>::const_iterator> results;
+    s.bulk_lower_bound(
+        queries.begin(), queries.end(), std::back_inserter(results));
+    ASSERT_EQ(queries.size(), results.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+      EXPECT_EQ(s.lower_bound(queries[i]), results[i]);
+    }
+  }
+}
+
+TEST(Eytzinger, SetCompare) {
+  eytzinger_set<std::string, std::greater<std::string>> s{"b", "a", "c", "b"};
+  EXPECT_THAT(s, testing::ElementsAre("c", "b", "a"));
+  EXPECT_EQ("b", *s.lower_bound("bb"));
+  EXPECT_EQ(s.end(), s.find("d"));
+
+  eytzinger_set<int> v(std::vector<int>{3, 1, 2});
+  EXPECT_THAT(v, testing::ElementsAre(1, 2, 3));
+  eytzinger_set<int> w{1, 2, 3};
+  EXPECT_TRUE(v == w);
+  eytzinger_set<int> empty;
+  swap(w, empty);
+  EXPECT_TRUE(w.empty());
+  EXPECT_TRUE(v == empty);
+}
+
+TEST(Eytzinger, Map) {
+  std::vector<std::pair<int, std::string>> input;
+  for (int i = 100; i > 0; --i) {
+    input.emplace_back(i * 10, std::to_string(i));
+  }
+  input.emplace_back(50, "duplicate");
+  eytzinger_map<int, std::string> m(input.begin(), input.end());
+  ASSERT_EQ(100, m.size());
+  EXPECT_EQ("5", m.at(50));
+  EXPECT_THROW(m.at(55), std::out_of_range);
+  EXPECT_EQ(60, m.lower_bound(55)->first);
+  EXPECT_EQ(m.end(), m.lower_bound(1001));
+
+  // Values can be modified in place
+  m.find(50)->second = "fifty";
+  EXPECT_EQ("fifty", m.at(50));
+  int prev = 0;
+  for (auto& kv : m) {
+    EXPECT_LT(prev, kv.first);
+    prev = kv.first;
+  }
+
+  std::vector<int> queries = {5, 10, 11, 500, 1000, 1001, 0};
+  std::vector<eytzinger_map<int, std::string>::const_iterator> results;
+  m.bulk_lower_bound(
+      queries.begin(), queries.end(), std::back_inserter(results));
+  ASSERT_EQ(queries.size(), results.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    EXPECT_EQ(m.lower_bound(queries[i]), results[i]);
+  }
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***
+ *  A benchmark comparing F14ValueMap and F14NodeMap to std::unordered_map
+ *  and sorted_vector_map, for successful and unsuccessful lookups and for
+ *  building a map from scratch.
+ */
+
+#include <folly/container/F14Map.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/portability/GFlags.h>
+#include <folly/sorted_vector_types.h>
+
+using namespace std;
+using namespace folly;
+
+namespace {
+
+vector<uint64_t> makeKeys(size_t n, uint64_t seed) {
+  mt19937_64 gen(seed);
+  vector<uint64_t> keys(n);
+  for (auto& k : keys) {
+    k = gen();
+  }
+  return keys;
+}
+
+template <typename M>
+void insertSorted(M& m, vector<uint64_t> const& keys) {
+  for (auto k : keys) {
+    m[k] = k;
+  }
+}
+
+template <typename K, typename V>
+void insertSorted(sorted_vector_map<K, V>& m, vector<uint64_t> const& keys) {
+  // building a sorted_vector_map one key at a time is quadratic
+  vector<pair<K, V>> pairs;
+  for (auto k : keys) {
+    pairs.emplace_back(k, k);
+  }
+  m = sorted_vector_map<K, V>(pairs.begin(), pairs.end());
+}
+
+template <typename M>
+void findBench(int iters, size_t size, bool hit) {
+  M m;
+  vector<uint64_t> keys;
+  BENCHMARK_SUSPEND {
+    keys = makeKeys(size, 1);
+    insertSorted(m, keys);
+    if (!hit) {
+      keys = makeKeys(size, 2);
+    }
+  }
+  uint64_t sum = 0;
+  for (int i = 0; i < iters; ++i) {
+    auto iter = m.find(keys[i % size]);
+    if (iter != m.end()) {
+      sum += iter->second;
+    }
+  }
+  doNotOptimizeAway(sum);
+}
+
+template <typename M>
+void insertBench(int iters, size_t size) {
+  vector<uint64_t> keys;
+  BENCHMARK_SUSPEND {
+    keys = makeKeys(size, 1);
+  }
+  for (int i = 0; i < iters; i += size) {
+    M m;
+    insertSorted(m, keys);
+    doNotOptimizeAway(m.size());
+  }
+}
+
+template <typename M>
+void addFindBenchmarks(string const& name, size_t size) {
+  addBenchmark(
+      __FILE__,
+      sformat("{}_find_hit({})", name, size).c_str(),
+      [=](int iters) {
+        findBench<M>(iters, size, true);
+        return iters;
+      });
+  addBenchmark(
+      __FILE__,
+      sformat("%{}_find_miss({})", name, size).c_str(),
+      [=](int iters) {
+        findBench<M>(iters, size, false);
+        return iters;
+      });
+}
+
+void setupBenchmarks() {
+  using F14V = F14ValueMap<uint64_t, uint64_t>;
+  using F14N = F14NodeMap<uint64_t, uint64_t>;
+  using Std = unordered_map<uint64_t, uint64_t>;
+  using Sorted = sorted_vector_map<uint64_t, uint64_t>;
+
+  for (size_t size : {10, 1000, 100000, 1000000}) {
+    addFindBenchmarks<Std>("std_unordered_map", size);
+    addFindBenchmarks<Sorted>("sorted_vector_map", size);
+    addFindBenchmarks<F14N>("f14_node_map", size);
+    addFindBenchmarks<F14V>("f14_value_map", size);
+    addBenchmark(__FILE__, "-", [](int) { return 0; });
+  }
+
+  for (size_t size : {10, 1000, 100000}) {
+    addBenchmark(
+        __FILE__,
+        sformat("std_unordered_map_insert({})", size).c_str(),
+        [=](int iters) {
+          insertBench<Std>(iters, size);
+          return iters;
+        });
+    addBenchmark(
+        __FILE__,
+        sformat("%f14_node_map_insert({})", size).c_str(),
+        [=](int iters) {
+          insertBench<F14N>(iters, size);
+          return iters;
+        });
+    addBenchmark(
+        __FILE__,
+        sformat("%f14_value_map_insert({})", size).c_str(),
+        [=](int iters) {
+          insertBench<F14V>(iters, size);
+          return iters;
+        });
+    addBenchmark(__FILE__, "-", [](int) { return 0; });
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  setupBenchmarks();
+  runBenchmarks();
+  return 0;
+}
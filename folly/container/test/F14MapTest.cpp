@@ -0,0 +1,311 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/F14Map.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+// Forces every key into the same chunk, to exercise overflow handling.
+struct BadHasher {
+  std::size_t operator()(int) const {
+    return 0;
+  }
+};
+
+// A stateful allocator that doesn't propagate on move assignment and
+// counts the blocks outstanding from each arena.
+template <typename T>
+struct ArenaAlloc {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+
+  explicit ArenaAlloc(std::shared_ptr<int> live) : live_(std::move(live)) {}
+  template <typename U>
+  ArenaAlloc(ArenaAlloc<U> const& rhs) : live_(rhs.live_) {}
+
+  T* allocate(std::size_t n) {
+    ++*live_;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) {
+    --*live_;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(ArenaAlloc<U> const& rhs) const {
+    return live_ == rhs.live_;
+  }
+  template <typename U>
+  bool operator!=(ArenaAlloc<U> const& rhs) const {
+    return live_ != rhs.live_;
+  }
+
+  std::shared_ptr<int> live_;
+};
+
+template <typename M>
+void runMoveAssignUnequalAlloc() {
+  using A = typename M::allocator_type;
+  auto live1 = std::make_shared<int>(0);
+  auto live2 = std::make_shared<int>(0);
+  {
+    M m1(A{live1});
+    M m2(A{live2});
+    for (int i = 0; i < 100; ++i) {
+      m1[i] = std::to_string(i);
+    }
+    m2[-1] = "gone";
+    m2 = std::move(m1);
+
+    EXPECT_TRUE(m2.get_allocator() == A(live2));
+    EXPECT_EQ(m2.size(), 100);
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(m2.at(i), std::to_string(i));
+    }
+    EXPECT_EQ(m2.count(-1), 0);
+    EXPECT_TRUE(m1.empty());
+    m1.clear();
+    m1.rehash(0);
+    EXPECT_EQ(*live1, 0);
+    EXPECT_GT(*live2, 0);
+  }
+  EXPECT_EQ(*live1, 0);
+  EXPECT_EQ(*live2, 0);
+}
+
+template <typename M>
+void runSimple() {
+  M m;
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.size(), 0);
+  EXPECT_TRUE(m.begin() == m.end());
+  EXPECT_TRUE(m.find(10) == m.end());
+  EXPECT_EQ(m.count(10), 0);
+
+  auto rv = m.insert(std::make_pair(10, std::string("ten")));
+  EXPECT_TRUE(rv.second);
+  EXPECT_EQ(rv.first->first, 10);
+  EXPECT_EQ(rv.first->second, "ten");
+  rv = m.insert(std::make_pair(10, std::string("TEN")));
+  EXPECT_FALSE(rv.second);
+  EXPECT_EQ(rv.first->second, "ten");
+
+  m[20] = "twenty";
+  EXPECT_EQ(m.at(20), "twenty");
+  EXPECT_THROW(m.at(30), std::out_of_range);
+  EXPECT_EQ(m.size(), 2);
+
+  EXPECT_TRUE(m.emplace(30, "thirty").second);
+  EXPECT_FALSE(m.emplace(30, "THIRTY").second);
+  EXPECT_TRUE(m.try_emplace(40, 3, 'x').second);
+  EXPECT_EQ(m[40], "xxx");
+  EXPECT_FALSE(m.insert_or_assign(40, "forty").second);
+  EXPECT_EQ(m[40], "forty");
+  EXPECT_EQ(m.size(), 4);
+
+  EXPECT_EQ(m.erase(20), 1);
+  EXPECT_EQ(m.erase(20), 0);
+  EXPECT_TRUE(m.find(20) == m.end());
+  EXPECT_EQ(m.size(), 3);
+
+  auto const& cm = m;
+  EXPECT_EQ(cm.find(30)->second, "thirty");
+  auto range = cm.equal_range(30);
+  EXPECT_EQ(std::distance(range.first, range.second), 1);
+
+  M m2{{1, "one"}, {2, "two"}};
+  EXPECT_EQ(m2.size(), 2);
+  m2.swap(m);
+  EXPECT_EQ(m.size(), 2);
+  EXPECT_EQ(m2.size(), 3);
+
+  M m3 = m2;
+  EXPECT_TRUE(m3 == m2);
+  m3[30] = "changed";
+  EXPECT_TRUE(m3 != m2);
+
+  M m4 = std::move(m3);
+  EXPECT_TRUE(m3.empty());
+  EXPECT_EQ(m4.size(), 3);
+
+  m4.clear();
+  EXPECT_TRUE(m4.empty());
+  EXPECT_TRUE(m4.begin() == m4.end());
+  m4[5] = "five";
+  EXPECT_EQ(m4.size(), 1);
+}
+
+template <typename M>
+void runRandom() {
+  std::unordered_map<int, int> ref;
+  M m;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> keyDist(0, 5000);
+  std::uniform_int_distribution<int> opDist(0, 9);
+  for (int i = 0; i < 100000; ++i) {
+    int k = keyDist(gen);
+    int op = opDist(gen);
+    if (op < 5) {
+      EXPECT_EQ(ref.emplace(k, i).second, m.emplace(k, i).second);
+    } else if (op < 8) {
+      EXPECT_EQ(ref.erase(k), m.erase(k));
+    } else {
+      auto iter = m.find(k);
+      auto refIter = ref.find(k);
+      EXPECT_EQ(refIter == ref.end(), iter == m.end());
+      if (iter != m.end()) {
+        EXPECT_EQ(refIter->second, iter->second);
+      }
+    }
+    ASSERT_EQ(ref.size(), m.size());
+  }
+
+  std::size_t visited = 0;
+  for (auto& kv : m) {
+    EXPECT_EQ(ref.at(kv.first), kv.second);
+    ++visited;
+  }
+  EXPECT_EQ(visited, ref.size());
+
+  // erase everything through iterators
+  for (auto iter = m.begin(); iter != m.end();) {
+    iter = m.erase(iter);
+  }
+  EXPECT_TRUE(m.empty());
+}
+
+} // namespace
+
+TEST(F14ValueMap, simple) {
+  runSimple<F14ValueMap<int, std::string>>();
+}
+
+TEST(F14NodeMap, simple) {
+  runSimple<F14NodeMap<int, std::string>>();
+}
+
+TEST(F14ValueMap, random) {
+  runRandom<F14ValueMap<int, int>>();
+}
+
+TEST(F14NodeMap, random) {
+  runRandom<F14NodeMap<int, int>>();
+}
+
+TEST(F14ValueMap, badHasher) {
+  runRandom<F14ValueMap<int, int, BadHasher>>();
+}
+
+TEST(F14ValueMap, rehashAndReserve) {
+  F14ValueMap<int, int> m;
+  EXPECT_EQ(m.bucket_count(), 0);
+  m.reserve(5000);
+  auto buckets = m.bucket_count();
+  EXPECT_GE(buckets, 5000);
+  for (int i = 0; i < 1000; ++i) {
+    m[i] = i;
+  }
+  EXPECT_EQ(m.bucket_count(), buckets);
+  EXPECT_LE(m.load_factor(), m.max_load_factor());
+
+  m.rehash(0);
+  EXPECT_LT(m.bucket_count(), buckets);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(m.at(i), i);
+  }
+
+  m.clear();
+  m.rehash(0);
+  EXPECT_EQ(m.bucket_count(), 0);
+}
+
+TEST(F14NodeMap, stableReferences) {
+  F14NodeMap<int, std::string> m;
+  auto& first = m[0];
+  first = "zero";
+  for (int i = 1; i < 1000; ++i) {
+    m[i] = std::to_string(i);
+  }
+  EXPECT_EQ(&first, &m[0]);
+  EXPECT_EQ(first, "zero");
+}
+
+TEST(F14ValueMap, moveOnly) {
+  F14ValueMap<int, std::unique_ptr<int>> m;
+  for (int i = 0; i < 100; ++i) {
+    m.emplace(i, std::make_unique<int>(i));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(*m.at(i), i);
+  }
+  auto m2 = std::move(m);
+  EXPECT_EQ(m2.size(), 100);
+}
+
+TEST(F14ValueMap, stringKeys) {
+  F14ValueMap<std::string, int> m;
+  for (int i = 0; i < 1000; ++i) {
+    m[std::to_string(i)] = i;
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(m.at(std::to_string(i)), i);
+  }
+  EXPECT_EQ(m.count("nope"), 0);
+}
+
+TEST(F14ValueMap, destructorCalls) {
+  auto counter = std::make_shared<int>(0);
+  {
+    F14ValueMap<int, std::shared_ptr<int>> m;
+    for (int i = 0; i < 500; ++i) {
+      m[i] = counter;
+    }
+    EXPECT_EQ(counter.use_count(), 501);
+    for (int i = 0; i < 250; ++i) {
+      m.erase(i);
+    }
+    EXPECT_EQ(counter.use_count(), 251);
+  }
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(F14ValueMap, moveAssignUnequalAlloc) {
+  runMoveAssignUnequalAlloc<F14ValueMap<
+      int,
+      std::string,
+      std::hash<int>,
+      std::equal_to<int>,
+      ArenaAlloc<std::pair<int const, std::string>>>>();
+}
+
+TEST(F14NodeMap, moveAssignUnequalAlloc) {
+  runMoveAssignUnequalAlloc<F14NodeMap<
+      int,
+      std::string,
+      std::hash<int>,
+      std::equal_to<int>,
+      ArenaAlloc<std::pair<int const, std::string>>>>();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/F14Set.h>
+
+#include <random>
+#include <string>
+#include <unordered_set>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+template <typename S>
+void runSimple() {
+  S s;
+  EXPECT_TRUE(s.empty());
+  EXPECT_TRUE(s.insert("abc").second);
+  EXPECT_FALSE(s.insert("abc").second);
+  EXPECT_TRUE(s.emplace(3, 'x').second);
+  EXPECT_EQ(s.count("xxx"), 1);
+  EXPECT_EQ(s.size(), 2);
+  EXPECT_EQ(s.erase("abc"), 1);
+  EXPECT_EQ(s.count("abc"), 0);
+
+  S s2{"a", "b", "c"};
+  EXPECT_EQ(s2.size(), 3);
+  S s3 = s2;
+  EXPECT_TRUE(s3 == s2);
+  s3.erase(s3.begin());
+  EXPECT_TRUE(s3 != s2);
+}
+
+template <typename S>
+void runRandom() {
+  std::unordered_set<uint64_t> ref;
+  S s;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<uint64_t> keyDist(0, 2000);
+  for (int i = 0; i < 50000; ++i) {
+    auto k = keyDist(gen);
+    if (i % 3 == 0) {
+      EXPECT_EQ(ref.erase(k), s.erase(k));
+    } else {
+      EXPECT_EQ(ref.insert(k).second, s.insert(k).second);
+    }
+    ASSERT_EQ(ref.size(), s.size());
+  }
+  for (auto k : s) {
+    EXPECT_EQ(ref.count(k), 1);
+  }
+  for (auto k : ref) {
+    EXPECT_EQ(s.count(k), 1);
+  }
+}
+
+} // namespace
+
+TEST(F14ValueSet, simple) {
+  runSimple<F14ValueSet<std::string>>();
+}
+
+TEST(F14NodeSet, simple) {
+  runSimple<F14NodeSet<std::string>>();
+}
+
+TEST(F14ValueSet, random) {
+  runRandom<F14ValueSet<uint64_t>>();
+}
+
+TEST(F14NodeSet, random) {
+  runRandom<F14NodeSet<uint64_t>>();
+}
+
+TEST(F14ValueSet, rangeConstructor) {
+  std::vector<int> v{1, 2, 3, 3, 2, 1};
+  F14ValueSet<int> s(v.begin(), v.end());
+  EXPECT_EQ(s.size(), 3);
+  s.insert(v.begin(), v.end());
+  EXPECT_EQ(s.size(), 3);
+}
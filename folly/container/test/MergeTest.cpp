@@ -68,3 +68,61 @@ TEST(MergeTest, OverlappingInDifferentInputRange) {
   EXPECT_EQ(c[1], 1);
   EXPECT_EQ(c[3], 3);
 }
+
+TEST(MergeTest, Multiway) {
+  std::vector<int> a = {0, 3, 6, 9};
+  std::vector<int> b = {1, 4, 7};
+  std::vector<int> c;
+  std::vector<int> d = {2, 5, 8, 10, 11};
+  using Run = folly::Range<std::vector<int>::iterator>;
+  std::vector<int> out;
+
+  folly::multiwayMerge(
+      std::vector<Run>{Run(a.begin(), a.end()),
+                       Run(b.begin(), b.end()),
+                       Run(c.begin(), c.end()),
+                       Run(d.begin(), d.end())},
+      std::back_inserter(out));
+  ASSERT_EQ(12, out.size());
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_EQ(i, out[i]);
+  }
+
+  out.clear();
+  folly::multiwayMerge(std::vector<Run>{}, std::back_inserter(out));
+  EXPECT_TRUE(out.empty());
+  folly::multiwayMerge(
+      std::vector<Run>{Run(c.begin(), c.end()), Run(a.begin(), a.end())},
+      std::back_inserter(out));
+  EXPECT_EQ(a, out);
+}
+
+TEST(MergeTest, MultiwayOverlapping) {
+  // Equivalent values come in the order of their ranges
+  using Pairs = std::vector<std::pair<int, int>>;
+  Pairs a = {{0, 0}, {1, 0}, {1, 0}, {4, 0}};
+  Pairs b = {{1, 1}, {2, 1}, {4, 1}};
+  Pairs c = {{0, 2}, {1, 2}, {4, 2}};
+  using Run = folly::Range<Pairs::const_iterator>;
+  Pairs out;
+
+  folly::multiwayMerge(
+      std::vector<Run>{Run(a.cbegin(), a.cend()),
+                       Run(b.cbegin(), b.cend()),
+                       Run(c.cbegin(), c.cend())},
+      std::back_inserter(out),
+      [](const std::pair<int, int>& x, const std::pair<int, int>& y) {
+        return x.first < y.first;
+      });
+  Pairs expected = {{0, 0},
+                    {0, 2},
+                    {1, 0},
+                    {1, 0},
+                    {1, 1},
+                    {1, 2},
+                    {2, 1},
+                    {4, 0},
+                    {4, 1},
+                    {4, 2}};
+  EXPECT_EQ(expected, out);
+}
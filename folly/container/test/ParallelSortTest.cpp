@@ -0,0 +1,144 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/ParallelSort.h>
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+std::vector<uint32_t> randomValues(size_t n, uint32_t max, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> dist(0, max);
+  std::vector<uint32_t> values(n);
+  for (auto& v : values) {
+    v = dist(rng);
+  }
+  return values;
+}
+
+} // namespace
+
+TEST(ParallelSort, sort) {
+  CPUThreadPoolExecutor executor(4);
+  for (size_t n : {0, 1, 1000, 100000, 1000003}) {
+    auto values = randomValues(n, 1000000000, uint32_t(n));
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+    parallelSort(executor, values.begin(), values.end());
+    EXPECT_EQ(expected, values) << n;
+  }
+}
+
+TEST(ParallelSort, sortDuplicates) {
+  CPUThreadPoolExecutor executor(4);
+  for (uint32_t max : {0, 1, 7}) {
+    auto values = randomValues(500000, max, max);
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+    parallelSort(
+        executor, values.begin(), values.end(), std::less<uint32_t>(), 8);
+    EXPECT_EQ(expected, values) << max;
+  }
+}
+
+TEST(ParallelSort, sortMoveOnly) {
+  CPUThreadPoolExecutor executor(4);
+  auto keys = randomValues(200000, 1000, 1);
+  std::vector<std::unique_ptr<std::string>> values;
+  for (auto k : keys) {
+    values.push_back(std::make_unique<std::string>(std::to_string(k)));
+  }
+  parallelSort(
+      executor,
+      values.begin(),
+      values.end(),
+      [](const std::unique_ptr<std::string>& a,
+         const std::unique_ptr<std::string>& b) { return *a < *b; });
+  ASSERT_EQ(keys.size(), values.size());
+  for (size_t i = 1; i < values.size(); ++i) {
+    ASSERT_TRUE(values[i - 1]);
+    ASSERT_LE(*values[i - 1], *values[i]);
+  }
+}
+
+TEST(ParallelSort, sortThrows) {
+  CPUThreadPoolExecutor executor(4);
+  auto values = randomValues(200000, 1000000, 2);
+  EXPECT_THROW(
+      parallelSort(
+          executor,
+          values.begin(),
+          values.end(),
+          [](uint32_t a, uint32_t b) {
+            if (a == 12345 || b == 12345) {
+              throw std::runtime_error("12345");
+            }
+            return a < b;
+          }),
+      std::runtime_error);
+}
+
+TEST(ParallelSort, merge) {
+  CPUThreadPoolExecutor executor(4);
+  auto a = randomValues(300000, 1000, 3);
+  auto b = randomValues(100000, 2000, 4);
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  std::vector<uint32_t> expected;
+  std::merge(
+      a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+  std::vector<uint32_t> out(a.size() + b.size());
+  auto end = parallelMerge(
+      executor, a.cbegin(), a.cend(), b.cbegin(), b.cend(), out.begin());
+  EXPECT_EQ(out.end(), end);
+  EXPECT_EQ(expected, out);
+}
+
+TEST(ParallelSort, multiwayMergeIsStable) {
+  // Values of the same key come in the order of their runs
+  CPUThreadPoolExecutor executor(4);
+  using Value = std::pair<uint32_t, uint32_t>;
+  std::vector<std::vector<Value>> inputs(5);
+  std::vector<Range<std::vector<Value>::const_iterator>> runs;
+  std::vector<Value> expected;
+  for (uint32_t r = 0; r < inputs.size(); ++r) {
+    for (auto k : randomValues(100000 * (r + 1), 100, r)) {
+      inputs[r].emplace_back(k, r);
+    }
+    std::sort(inputs[r].begin(), inputs[r].end());
+    runs.emplace_back(inputs[r].cbegin(), inputs[r].cend());
+    expected.insert(expected.end(), inputs[r].begin(), inputs[r].end());
+  }
+  std::sort(expected.begin(), expected.end());
+  std::vector<Value> out(expected.size());
+  parallelMultiwayMerge(
+      executor,
+      runs,
+      out.begin(),
+      [](const Value& a, const Value& b) { return a.first < b.first; },
+      16);
+  EXPECT_EQ(expected, out);
+}
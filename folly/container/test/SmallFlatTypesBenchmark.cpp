@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/SmallFlatTypes.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/small_vector.h>
+#include <folly/sorted_vector_types.h>
+
+using namespace folly;
+
+namespace {
+
+// Keys that look like ids: spread out, not dense
+std::vector<uint64_t> makeKeys(size_t n) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < n; i++) {
+    keys.push_back((i + 1) * 0x9E3779B97F4A7C15ULL >> 20);
+  }
+  return keys;
+}
+
+// Builds a set of n keys and looks up a mix of hits and misses, the way a
+// request handler builds and queries a set of ids.
+template <class Set, class Insert, class Find>
+void buildAndFind(size_t iters, size_t n, Insert insert, Find find) {
+  std::vector<uint64_t> keys;
+  BENCHMARK_SUSPEND {
+    keys = makeKeys(2 * n);
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < iters; i++) {
+    Set s;
+    for (size_t j = 0; j < n; j++) {
+      insert(s, keys[j]);
+    }
+    for (auto k : keys) {
+      found += find(s, k);
+    }
+  }
+  doNotOptimizeAway(found);
+}
+
+void smallVector(size_t iters, size_t n) {
+  using Set = small_vector<uint64_t, 32>;
+  buildAndFind<Set>(
+      iters,
+      n,
+      [](Set& v, uint64_t k) {
+        if (std::find(v.begin(), v.end(), k) == v.end()) {
+          v.push_back(k);
+        }
+      },
+      [](Set& v, uint64_t k) {
+        return std::find(v.begin(), v.end(), k) != v.end();
+      });
+}
+
+void sortedVectorSet(size_t iters, size_t n) {
+  using Set = sorted_vector_set<uint64_t>;
+  buildAndFind<Set>(
+      iters,
+      n,
+      [](Set& s, uint64_t k) { s.insert(k); },
+      [](Set& s, uint64_t k) { return s.count(k); });
+}
+
+void smallFlatSet(size_t iters, size_t n) {
+  using Set = small_flat_set<uint64_t, 32>;
+  buildAndFind<Set>(
+      iters,
+      n,
+      [](Set& s, uint64_t k) { s.insert(k); },
+      [](Set& s, uint64_t k) { return s.count(k); });
+}
+
+} // namespace
+
+BENCHMARK_PARAM(smallVector, 8)
+BENCHMARK_RELATIVE_PARAM(sortedVectorSet, 8)
+BENCHMARK_RELATIVE_PARAM(smallFlatSet, 8)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(smallVector, 16)
+BENCHMARK_RELATIVE_PARAM(sortedVectorSet, 16)
+BENCHMARK_RELATIVE_PARAM(smallFlatSet, 16)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(smallVector, 32)
+BENCHMARK_RELATIVE_PARAM(sortedVectorSet, 32)
+BENCHMARK_RELATIVE_PARAM(smallFlatSet, 32)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
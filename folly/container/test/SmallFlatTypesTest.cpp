@@ -0,0 +1,231 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/container/SmallFlatTypes.h>
+
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+// Every key collides, so lookups rely on key_equal alone
+struct ConstantHash {
+  size_t operator()(int) const {
+    return 0;
+  }
+};
+} // namespace
+
+TEST(SmallFlatSet, Basic) {
+  small_flat_set<int, 8> s;
+  EXPECT_TRUE(s.empty());
+  EXPECT_TRUE(s.isInline());
+  EXPECT_EQ(8, s.capacity());
+  EXPECT_TRUE(s.insert(3).second);
+  EXPECT_FALSE(s.insert(3).second);
+  EXPECT_TRUE(s.emplace(4).second);
+  EXPECT_EQ(2, s.size());
+  EXPECT_EQ(1, s.count(3));
+  EXPECT_EQ(0, s.count(5));
+  EXPECT_EQ(3, *s.find(3));
+  EXPECT_EQ(s.end(), s.find(5));
+  auto range = s.equal_range(4);
+  EXPECT_EQ(1, range.second - range.first);
+  EXPECT_EQ(1, s.erase(3));
+  EXPECT_EQ(0, s.erase(3));
+  EXPECT_EQ(1, s.size());
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_EQ(s.end(), s.find(4));
+}
+
+TEST(SmallFlatSet, SpillsToHeap) {
+  small_flat_set<int, 8> s;
+  std::set<int> expected;
+  for (int i = 0; i < 8; i++) {
+    s.insert(i * 31);
+    expected.insert(i * 31);
+  }
+  EXPECT_TRUE(s.isInline());
+  // A duplicate doesn't spill a full set
+  EXPECT_FALSE(s.insert(0).second);
+  EXPECT_TRUE(s.isInline());
+  for (int i = 8; i < 1000; i++) {
+    s.insert(i * 31);
+    expected.insert(i * 31);
+  }
+  EXPECT_FALSE(s.isInline());
+  EXPECT_EQ(expected.size(), s.size());
+  for (int i = 0; i < 31000; i++) {
+    EXPECT_EQ(expected.count(i), s.count(i));
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    s.erase(i * 31);
+  }
+  s.shrink_to_fit();
+  EXPECT_FALSE(s.isInline());
+  EXPECT_EQ(512, s.capacity());
+  while (s.size() > 4) {
+    s.erase(s.begin());
+  }
+  s.shrink_to_fit();
+  EXPECT_TRUE(s.isInline());
+  EXPECT_EQ(4, s.size());
+  for (auto v : s) {
+    EXPECT_EQ(1, s.count(v));
+  }
+}
+
+TEST(SmallFlatSet, Collisions) {
+  small_flat_set<int, 4, ConstantHash> s;
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(s.insert(i).second);
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(i, *s.find(i));
+  }
+  EXPECT_EQ(s.end(), s.find(100));
+}
+
+TEST(SmallFlatSet, Erase) {
+  small_flat_set<int> s{1, 2, 3, 4, 5, 6};
+  // erase(iterator) moves the last element into the gap
+  auto it = s.erase(s.find(2));
+  EXPECT_EQ(6, *it);
+  EXPECT_EQ(5, s.size());
+  // Ranges keep the order of what follows
+  it = s.erase(s.begin(), s.begin() + 2);
+  EXPECT_EQ(3, s.size());
+  EXPECT_EQ(3, *it);
+  EXPECT_EQ((small_flat_set<int>{3, 4, 5}), s);
+  for (auto i = s.begin(); i != s.end();) {
+    i = s.erase(i);
+  }
+  EXPECT_TRUE(s.empty());
+}
+
+TEST(SmallFlatSet, CopyMoveSwap) {
+  small_flat_set<std::string, 4> inl{"a", "b"};
+  small_flat_set<std::string, 4> heap;
+  for (int i = 0; i < 20; i++) {
+    heap.insert(std::to_string(i));
+  }
+
+  auto inlCopy = inl;
+  auto heapCopy = heap;
+  EXPECT_EQ(inl, inlCopy);
+  EXPECT_EQ(heap, heapCopy);
+  EXPECT_NE(inl, heap);
+
+  auto moved = std::move(heapCopy);
+  EXPECT_EQ(heap, moved);
+  EXPECT_TRUE(heapCopy.empty());
+  EXPECT_TRUE(heapCopy.isInline());
+
+  swap(inlCopy, moved);
+  EXPECT_EQ(heap, inlCopy);
+  EXPECT_EQ(inl, moved);
+
+  inlCopy = inl;
+  EXPECT_EQ(inl, inlCopy);
+  EXPECT_TRUE(inlCopy.isInline());
+  moved = heap;
+  EXPECT_EQ(heap, moved);
+  moved = {"x"};
+  EXPECT_EQ(1, moved.size());
+  EXPECT_EQ(1, moved.count("x"));
+}
+
+TEST(SmallFlatSet, MoveOnly) {
+  small_flat_set<std::unique_ptr<int>, 2> s;
+  for (int i = 0; i < 10; i++) {
+    s.insert(std::make_unique<int>(i));
+  }
+  EXPECT_EQ(10, s.size());
+  auto moved = std::move(s);
+  EXPECT_EQ(10, moved.size());
+  int sum = 0;
+  for (auto& p : moved) {
+    sum += *p;
+  }
+  EXPECT_EQ(45, sum);
+}
+
+TEST(SmallFlatMap, Basic) {
+  small_flat_map<int, std::string, 4> m;
+  EXPECT_TRUE(m.insert(std::make_pair(1, "one")).second);
+  EXPECT_TRUE(m.emplace(2, "two").second);
+  EXPECT_FALSE(m.emplace(2, "deux").second);
+  EXPECT_EQ("two", m.at(2));
+  EXPECT_THROW(m.at(3), std::out_of_range);
+  m[3] = "three";
+  EXPECT_EQ("three", m[3]);
+  EXPECT_EQ("", m[4]);
+  EXPECT_EQ(4, m.size());
+  EXPECT_FALSE(m.insert_or_assign(1, "uno").second);
+  EXPECT_EQ("uno", m.find(1)->second);
+  EXPECT_TRUE(m.try_emplace(5, 3, 'x').second);
+  EXPECT_EQ("xxx", m.at(5));
+  EXPECT_FALSE(m.isInline());
+  m.find(5)->second = "five";
+  EXPECT_EQ("five", m.at(5));
+  EXPECT_EQ(1, m.erase(5));
+  EXPECT_EQ(m.end(), m.find(5));
+
+  const auto& cm = m;
+  EXPECT_EQ("uno", cm.at(1));
+  EXPECT_EQ(cm.end(), cm.find(5));
+}
+
+TEST(SmallFlatMap, TryEmplaceDoesNotMove) {
+  small_flat_map<int, std::unique_ptr<int>> m;
+  auto p = std::make_unique<int>(1);
+  EXPECT_TRUE(m.try_emplace(1, std::move(p)).second);
+  auto q = std::make_unique<int>(2);
+  EXPECT_FALSE(m.try_emplace(1, std::move(q)).second);
+  EXPECT_TRUE(q);
+  EXPECT_EQ(1, *m.at(1));
+}
+
+TEST(SmallFlatMap, Random) {
+  std::mt19937 rng(5);
+  small_flat_map<uint32_t, uint32_t, 16> m;
+  std::unordered_map<uint32_t, uint32_t> expected;
+  for (int i = 0; i < 20000; i++) {
+    auto k = rng() % 64;
+    switch (rng() % 3) {
+      case 0:
+        m[k] = i;
+        expected[k] = i;
+        break;
+      case 1:
+        EXPECT_EQ(expected.erase(k), m.erase(k));
+        break;
+      default:
+        EXPECT_EQ(expected.count(k), m.count(k));
+        if (expected.count(k)) {
+          EXPECT_EQ(expected[k], m.at(k));
+        }
+    }
+    ASSERT_EQ(expected.size(), m.size());
+  }
+}
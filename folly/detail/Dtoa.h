@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Floating point to string conversions used by Conv.h and Format.h, as
+ * drop-in replacements for the common modes of double-conversion's
+ * DoubleToStringConverter: the output is byte for byte the same.
+ *
+ * Shortest round-trip digits are found with Ryu (Ulf Adams, "Ryu: Fast
+ * Float-to-String Conversion", PLDI 2018), which needs a couple of 128-bit
+ * multiplications per number where double-conversion's Grisu3 loops over
+ * digits and falls back to bignums for a fraction of inputs.  Fixed-point
+ * output with up to 20 digits after the point is computed exactly with
+ * 128-bit integers when the compiler has them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace folly {
+namespace detail {
+
+// The parameters of DoubleToStringConverter that apply to these modes
+struct DtoaFormat {
+  // Of DoubleToStringConverter::Flags
+  int flags;
+  const char* infinitySymbol;
+  const char* nanSymbol;
+  char exponentCharacter;
+  // Shortest output uses decimal notation for decimal exponents in
+  // [decimalInShortestLow, decimalInShortestHigh), exponential otherwise
+  int decimalInShortestLow;
+  int decimalInShortestHigh;
+};
+
+// value == mantissa * 10^exponent, with as few digits as possible
+struct DecimalFloat {
+  uint64_t mantissa;
+  int32_t exponent;
+};
+
+/**
+ * The shortest decimal that rounds to value (finite and > 0) when parsed,
+ * closest to value if there are several.  No trailing zeros.
+ */
+DecimalFloat shortestDecimal(double value);
+DecimalFloat shortestDecimal(float value);
+
+/**
+ * Writes value to out as DoubleToStringConverter::ToShortest() (resp.
+ * ToShortestSingle()) would, and returns the length.  out must have room for
+ * max(decimalInShortestHigh, 20 - decimalInShortestLow) + 8 bytes, and for
+ * the symbols.
+ */
+size_t dtoaShortest(double value, const DtoaFormat& format, char* out);
+size_t dtoaShortestSingle(float value, const DtoaFormat& format, char* out);
+
+/**
+ * Writes value to out with digits digits after the decimal point, as
+ * DoubleToStringConverter::ToFixed() would, and returns the length, if
+ * value isn't too large or too precise to be done here; returns 0
+ * otherwise.  out must have room for 48 bytes, and for the symbols.
+ */
+size_t dtoaFixed(double value, int digits, const DtoaFormat& format, char* out);
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/FingerprintClmul.h>
+
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+// The fingerprint of a message M, as a polynomial over GF(2) with the first
+// bit as the highest coefficient, is M mod P, for the irreducible P of
+// degree 64 from GenerateFingerprintTables.cpp.  Appending 16 bytes D to a
+// message whose fingerprint is f gives f * X^128 + D mod P; with a 128-bit
+// accumulator A = H * X^64 + L congruent to the message so far, that's
+//
+//   A * X^128 + D = H * (X^192 mod P) + L * (X^128 mod P) + D   (mod P)
+//
+// two carry-less multiplications of 64-bit halves by constants, whose
+// 127-bit products fit the accumulator again.  Four accumulators fold 64
+// bytes per step (by X^512), which hides the latency of the multiplier,
+// then fold into one at the end, which is reduced to 64 bits with a Barrett
+// reduction.
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+// P, without its X^64 term.  DO NOT CHANGE: see GenerateFingerprintTables.
+constexpr uint64_t kPoly = 0xbf3736b51869e9b7ULL;
+
+// X^n mod P
+constexpr uint64_t xPowMod(unsigned n) {
+  uint64_t r = 1;
+  for (unsigned i = 0; i < n; ++i) {
+    r = (r << 1) ^ ((r >> 63) ? kPoly : 0);
+  }
+  return r;
+}
+
+// floor(X^128 / P), without its X^64 term
+constexpr uint64_t barrettMu() {
+  uint64_t t = kPoly;
+  uint64_t mu = 0;
+  for (int k = 63; k >= 0; --k) {
+    uint64_t top = t >> 63;
+    mu |= top << k;
+    t = (t << 1) ^ (top ? kPoly : 0);
+  }
+  return mu;
+}
+
+constexpr uint64_t kX128 = xPowMod(128);
+constexpr uint64_t kX192 = xPowMod(192);
+constexpr uint64_t kX512 = xPowMod(512);
+constexpr uint64_t kX576 = xPowMod(576);
+constexpr uint64_t kMu = barrettMu();
+
+#if FOLLY_X64
+
+FOLLY_TARGET_ATTRIBUTE("pclmul,ssse3")
+inline __m128i loadBlock(const uint8_t* p, __m128i reverse) {
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), reverse);
+}
+
+// a * X^d mod P, in 128 bits, where k holds X^d mod P in its low half and
+// X^(d+64) mod P in its high half
+FOLLY_TARGET_ATTRIBUTE("pclmul,ssse3")
+inline __m128i fold(__m128i a, __m128i k) {
+  return _mm_xor_si128(
+      _mm_clmulepi64_si128(a, k, 0x00), _mm_clmulepi64_si128(a, k, 0x11));
+}
+
+FOLLY_TARGET_ATTRIBUTE("pclmul,ssse3")
+size_t clmulUpdate(uint64_t* fp, const uint8_t* data, size_t len) {
+  const __m128i reverse =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i k128 = _mm_set_epi64x(int64_t(kX192), int64_t(kX128));
+  const __m128i k512 = _mm_set_epi64x(int64_t(kX576), int64_t(kX512));
+
+  const uint8_t* p = data;
+  const uint8_t* end = data + (len & ~size_t(15));
+  __m128i a = _mm_set_epi64x(0, int64_t(*fp));
+
+  if (end - p >= 64) {
+    __m128i a0 = _mm_xor_si128(fold(a, k128), loadBlock(p, reverse));
+    __m128i a1 = loadBlock(p + 16, reverse);
+    __m128i a2 = loadBlock(p + 32, reverse);
+    __m128i a3 = loadBlock(p + 48, reverse);
+    for (p += 64; end - p >= 64; p += 64) {
+      a0 = _mm_xor_si128(fold(a0, k512), loadBlock(p, reverse));
+      a1 = _mm_xor_si128(fold(a1, k512), loadBlock(p + 16, reverse));
+      a2 = _mm_xor_si128(fold(a2, k512), loadBlock(p + 32, reverse));
+      a3 = _mm_xor_si128(fold(a3, k512), loadBlock(p + 48, reverse));
+    }
+    a1 = _mm_xor_si128(a1, fold(a0, k128));
+    a2 = _mm_xor_si128(a2, fold(a1, k128));
+    a = _mm_xor_si128(a3, fold(a2, k128));
+  } else {
+    a = _mm_xor_si128(fold(a, k128), loadBlock(p, reverse));
+    p += 16;
+  }
+  for (; p != end; p += 16) {
+    a = _mm_xor_si128(fold(a, k128), loadBlock(p, reverse));
+  }
+
+  // Barrett: q = floor(A / P) = floor(H * (X^64 + mu) / X^64), and
+  // A mod P = L + q * P mod X^64, the X^64 terms cancelling out
+  const __m128i consts = _mm_set_epi64x(int64_t(kPoly), int64_t(kMu));
+  __m128i hi = _mm_unpackhi_epi64(a, a);
+  __m128i q = _mm_xor_si128(
+      _mm_unpackhi_epi64(
+          _mm_clmulepi64_si128(hi, consts, 0x00), _mm_setzero_si128()),
+      hi);
+  __m128i r = _mm_xor_si128(a, _mm_clmulepi64_si128(q, consts, 0x10));
+  *fp = uint64_t(_mm_cvtsi128_si64(r));
+  return size_t(end - data);
+}
+
+bool hasClmul() {
+  static const bool clmul = [] {
+    CpuId cpu;
+    return cpu.pclmuldq() && cpu.ssse3();
+  }();
+  return clmul;
+}
+
+#endif
+
+} // namespace
+
+size_t fingerprint64Clmul(uint64_t* fp, const uint8_t* data, size_t len) {
+#if FOLLY_X64
+  if (len >= 16 && hasClmul()) {
+    return clmulUpdate(fp, data, len);
+  }
+#else
+  (void)fp;
+  (void)data;
+  (void)len;
+#endif
+  return 0;
+}
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace folly {
+namespace detail {
+
+// Fingerprint<64> updates shorter than this go through the tables
+constexpr size_t kFingerprintClmulMinSize = 64;
+
+/**
+ * Update the 64-bit fingerprint *fp with a prefix of data, a multiple of 16
+ * bytes, using carry-less multiplication (PCLMULQDQ) to fold 64 or 16 bytes
+ * per step rather than looking up one byte at a time.  Returns the length
+ * of the prefix; 0 if the CPU has no carry-less multiplication, in which
+ * case *fp is unchanged.
+ */
+size_t fingerprint64Clmul(uint64_t* fp, const uint8_t* data, size_t len);
+
+} // namespace detail
+} // namespace folly
@@ -16,8 +16,15 @@
 
 #include <folly/detail/IPAddress.h>
 
+#include <cstring>
+
+#include <folly/Bits.h>
 #include <folly/Format.h>
 
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#endif
+
 namespace folly {
 namespace detail {
 
@@ -31,5 +38,230 @@ std::string familyNameStrDefault(sa_family_t family) {
       bitCount,
       familyNameStr(family)));
 }
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+inline uint8_t hexValue(char c) {
+  if (uint8_t(c - '0') < 10) {
+    return uint8_t(c - '0');
+  }
+  uint8_t lower = uint8_t((c | 0x20) - 'a');
+  return lower < 6 ? uint8_t(lower + 10) : 0xff;
+}
+
+inline char* writeOctet(uint8_t octet, char* out) {
+  if (octet >= 100) {
+    *out++ = char('0' + octet / 100);
+    *out++ = char('0' + octet / 10 % 10);
+  } else if (octet >= 10) {
+    *out++ = char('0' + octet / 10);
+  }
+  *out++ = char('0' + octet % 10);
+  return out;
+}
+
+// The 32 hex digits of 16 bytes
+inline void toHex(const uint8_t* bytes, char* out) {
+#if FOLLY_SSE >= 2
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  __m128i nibble = _mm_set1_epi8(0x0f);
+  __m128i lo = _mm_and_si128(v, nibble);
+  __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+  auto digits = [](__m128i x) {
+    // '0' + x, and 'a' - '0' - 10 more where x > 9
+    __m128i letters = _mm_and_si128(
+        _mm_cmpgt_epi8(x, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(x, _mm_set1_epi8('0')), letters);
+  };
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out), digits(_mm_unpacklo_epi8(hi, lo)));
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(out + 16), digits(_mm_unpackhi_epi8(hi, lo)));
+#else
+  for (size_t i = 0; i < 16; ++i) {
+    out[2 * i] = kHexDigits[bytes[i] >> 4];
+    out[2 * i + 1] = kHexDigits[bytes[i] & 0xf];
+  }
+#endif
+}
+
+} // namespace
+
+bool parseIPv4(StringPiece str, uint8_t* out) noexcept {
+  const char* p = str.begin();
+  const char* end = str.end();
+  uint8_t octets[4];
+  for (size_t i = 0; i < 4; ++i) {
+    if (i > 0) {
+      if (p == end || *p != '.') {
+        return false;
+      }
+      ++p;
+    }
+    const char* begin = p;
+    unsigned value = 0;
+    for (; p != end && uint8_t(*p - '0') < 10; ++p) {
+      if (p != begin && value == 0) {
+        return false; // leading zero
+      }
+      value = value * 10 + unsigned(*p - '0');
+      if (value > 255) {
+        return false;
+      }
+    }
+    if (p == begin) {
+      return false;
+    }
+    octets[i] = uint8_t(value);
+  }
+  if (p != end) {
+    return false;
+  }
+  std::memcpy(out, octets, 4);
+  return true;
+}
+
+bool parseIPv6(StringPiece str, uint8_t* out) noexcept {
+  uint8_t bytes[16];
+  size_t size = 0;
+  // Where "::" is, if any
+  size_t gap = 16;
+  const char* p = str.begin();
+  const char* end = str.end();
+  if (p == end) {
+    return false;
+  }
+  // Only a leading "::" may start with ':'
+  if (*p == ':' && (++p == end || *p != ':')) {
+    return false;
+  }
+  const char* token = p;
+  unsigned value = 0;
+  size_t digits = 0;
+  while (p != end) {
+    char c = *p++;
+    uint8_t v = hexValue(c);
+    if (v != 0xff) {
+      if (++digits > 4) {
+        return false;
+      }
+      value = (value << 4) | v;
+    } else if (c == ':') {
+      token = p;
+      if (digits == 0) {
+        if (gap != 16) {
+          return false;
+        }
+        gap = size;
+        continue;
+      } else if (p == end || size + 2 > 16) {
+        return false;
+      }
+      bytes[size++] = uint8_t(value >> 8);
+      bytes[size++] = uint8_t(value);
+      value = 0;
+      digits = 0;
+    } else if (c == '.') {
+      // The rest is an IPv4 address, starting at this token
+      if (size + 4 > 16 || !parseIPv4(StringPiece(token, end), bytes + size)) {
+        return false;
+      }
+      size += 4;
+      digits = 0;
+      break;
+    } else {
+      return false;
+    }
+  }
+  if (digits > 0) {
+    if (size + 2 > 16) {
+      return false;
+    }
+    bytes[size++] = uint8_t(value >> 8);
+    bytes[size++] = uint8_t(value);
+  }
+  if (gap != 16) {
+    // "::" stands for at least one group of 0s
+    if (size == 16) {
+      return false;
+    }
+    size_t tail = size - gap;
+    std::memmove(bytes + 16 - tail, bytes + gap, tail);
+    std::memset(bytes + gap, 0, 16 - size);
+    size = 16;
+  }
+  if (size != 16) {
+    return false;
+  }
+  std::memcpy(out, bytes, 16);
+  return true;
+}
+
+size_t formatIPv6(const uint8_t* bytes, char* out) noexcept {
+  uint16_t words[8];
+  for (size_t i = 0; i < 8; ++i) {
+    words[i] = uint16_t((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+  }
+  // The first longest run of at least 2 groups of 0s becomes "::"
+  size_t bestBase = 8;
+  size_t bestLen = 1;
+  for (size_t i = 0; i < 8;) {
+    size_t j = i;
+    while (j < 8 && words[j] == 0) {
+      ++j;
+    }
+    if (j - i > bestLen) {
+      bestBase = i;
+      bestLen = j - i;
+    }
+    i = j == i ? i + 1 : j;
+  }
+
+  char* p = out;
+  for (size_t i = 0; i < 8; ++i) {
+    if (i >= bestBase && i < bestBase + bestLen) {
+      if (i == bestBase) {
+        *p++ = ':';
+      }
+      continue;
+    }
+    if (i != 0) {
+      *p++ = ':';
+    }
+    // IPv4-compatible and IPv4-mapped addresses end in dotted-quad notation
+    if (i == 6 && bestBase == 0 &&
+        (bestLen == 6 || (bestLen == 5 && words[5] == 0xffff))) {
+      for (size_t j = 12; j < 16; ++j) {
+        if (j != 12) {
+          *p++ = '.';
+        }
+        p = writeOctet(bytes[j], p);
+      }
+      return size_t(p - out);
+    }
+    uint16_t w = words[i];
+    int shift = w == 0 ? 0 : (findLastSet(w) - 1) / 4 * 4;
+    for (; shift >= 0; shift -= 4) {
+      *p++ = kHexDigits[(w >> shift) & 0xf];
+    }
+  }
+  if (bestBase + bestLen == 8) {
+    *p++ = ':';
+  }
+  return size_t(p - out);
+}
+
+void formatIPv6FullyQualified(const uint8_t* bytes, char* out) noexcept {
+  char hex[32];
+  toHex(bytes, hex);
+  for (size_t i = 0; i < 8; ++i) {
+    std::memcpy(out + 5 * i, hex + 4 * i, 4);
+    if (i != 7) {
+      out[5 * i + 4] = ':';
+    }
+  }
+}
 } // namespace detail
 } // namespace folly
@@ -18,8 +18,11 @@
 
 #include <sys/types.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
+#include <folly/Range.h>
 #include <folly/portability/Sockets.h>
 
 namespace folly {
@@ -53,5 +56,33 @@ getNthMSBitImpl(const IPAddrType& ip, size_t bitIndex, sa_family_t family) {
   // Underlying bytes are in n/w byte order
   return (ip.getNthMSByte(bitIndex / 8) & (0x80 >> (bitIndex % 8))) != 0;
 }
+
+/**
+ * Parses a dotted-quad IPv4 address into its 4 bytes in network order, as
+ * inet_pton(AF_INET) does: 4 decimal octets, each at most 255 and without
+ * leading zeros.
+ */
+bool parseIPv4(StringPiece str, uint8_t* out) noexcept;
+
+/**
+ * Parses an IPv6 address into its 16 bytes, as inet_pton(AF_INET6) does:
+ * groups of 1 to 4 hex digits, at most one "::", and optionally a
+ * dotted-quad IPv4 address for the last 4 bytes.
+ */
+bool parseIPv6(StringPiece str, uint8_t* out) noexcept;
+
+/**
+ * Writes the canonical text of an IPv6 address, as inet_ntop(AF_INET6)
+ * does (RFC 5952, with IPv4-mapped and -compatible addresses in dotted-quad
+ * notation), to out, which must have room for INET6_ADDRSTRLEN chars, and
+ * returns its length.
+ */
+size_t formatIPv6(const uint8_t* bytes, char* out) noexcept;
+
+/**
+ * Writes the fully qualified text of an IPv6 address, 8 groups of 4 hex
+ * digits (39 chars), to out.
+ */
+void formatIPv6FullyQualified(const uint8_t* bytes, char* out) noexcept;
 } // namespace detail
 } // namespace folly
@@ -266,12 +266,14 @@ inline size_t fastIpv6ToBufferUnsafe(const in6_addr& in6Addr, char* str) {
 
 inline std::string fastIpv6ToString(const in6_addr& in6Addr) {
   char str[sizeof("2001:0db8:0000:0000:0000:ff00:0042:8329")];
-  return std::string(str, fastIpv6ToBufferUnsafe(in6Addr, str));
+  formatIPv6FullyQualified(in6Addr.s6_addr, str);
+  return std::string(str, sizeof(str) - 1);
 }
 
 inline void fastIpv6AppendToString(const in6_addr& in6Addr, std::string& out) {
   char str[sizeof("2001:0db8:0000:0000:0000:ff00:0042:8329")];
-  out.append(str, fastIpv6ToBufferUnsafe(in6Addr, str));
+  formatIPv6FullyQualified(in6Addr.s6_addr, str);
+  out.append(str, sizeof(str) - 1);
 }
 } // namespace detail
 } // namespace folly
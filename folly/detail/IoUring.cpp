@@ -0,0 +1,162 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/IoUring.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <folly/Exception.h>
+#include <folly/ScopeGuard.h>
+#include <folly/portability/Unistd.h>
+
+#if FOLLY_HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// The syscall numbers are the same on all architectures, but older libc
+// headers don't define them.
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+#endif
+
+namespace folly {
+namespace detail {
+
+#if FOLLY_HAVE_IO_URING
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+  return int(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(
+    int fd,
+    unsigned toSubmit,
+    unsigned minComplete,
+    unsigned flags) {
+  return int(::syscall(
+      __NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned n) {
+  return int(::syscall(__NR_io_uring_register, fd, opcode, arg, n));
+}
+
+bool ioUringSupported() {
+  static const bool supported = [] {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = ioUringSetup(1, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    return true;
+  }();
+  return supported;
+}
+
+IoUringRings::IoUringRings(
+    unsigned entries,
+    unsigned flags,
+    unsigned sqThreadIdle) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = flags;
+  params.sq_thread_idle = sqThreadIdle;
+  fd = ioUringSetup(entries, &params);
+  checkUnixError(fd, "io_uring_setup failed");
+  // The destructor doesn't run if the constructor throws
+  SCOPE_FAIL {
+    release();
+  };
+  sqEntries = params.sq_entries;
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqRing = mmapRing(sqRingSize, IORING_OFF_SQ_RING);
+  cqRing = singleMmap ? sqRing : mmapRing(cqRingSize, IORING_OFF_CQ_RING);
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = static_cast<io_uring_sqe*>(mmapRing(sqesSize, IORING_OFF_SQES));
+
+  auto sq = static_cast<char*>(sqRing);
+  sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+  sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  auto cq = static_cast<char*>(cqRing);
+  cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUringRings::~IoUringRings() {
+  release();
+}
+
+void* IoUringRings::mmapRing(size_t size, off_t offset) {
+  void* p = ::mmap(
+      nullptr,
+      size,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      fd,
+      offset);
+  if (p == MAP_FAILED) {
+    throwSystemError("io_uring mmap failed");
+  }
+  return p;
+}
+
+void IoUringRings::release() {
+  if (sqes) {
+    ::munmap(sqes, sqesSize);
+  }
+  if (cqRing && cqRing != sqRing) {
+    ::munmap(cqRing, cqRingSize);
+  }
+  if (sqRing) {
+    ::munmap(sqRing, sqRingSize);
+  }
+  if (fd != -1) {
+    ::close(fd);
+  }
+}
+
+#else
+
+bool ioUringSupported() {
+  return false;
+}
+
+#endif
+
+} // namespace detail
+} // namespace folly
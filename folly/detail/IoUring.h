@@ -0,0 +1,100 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <sys/types.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define FOLLY_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifndef FOLLY_HAVE_IO_URING
+#define FOLLY_HAVE_IO_URING 0
+#endif
+
+namespace folly {
+namespace detail {
+
+/**
+ * Return true if the running kernel supports io_uring.
+ */
+bool ioUringSupported();
+
+#if FOLLY_HAVE_IO_URING
+
+// The raw io_uring syscalls: they return -1 and set errno on failure.
+int ioUringSetup(unsigned entries, io_uring_params* params);
+int ioUringEnter(
+    int fd,
+    unsigned toSubmit,
+    unsigned minComplete,
+    unsigned flags);
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned n);
+
+/**
+ * An io_uring instance: the ring fd and the kernel-shared submission and
+ * completion rings, unmapped and closed on destruction.  Head and tail
+ * indexes are free-running and masked on access; the kernel updates the
+ * SQ head and the CQ tail, the owner updates the SQ tail and the CQ head.
+ */
+struct IoUringRings {
+  // Sets up a ring with room for at least `entries` SQEs, with the given
+  // IORING_SETUP_* flags (and SQ thread idle time, in milliseconds, for
+  // IORING_SETUP_SQPOLL).  Throws std::system_error.
+  explicit IoUringRings(
+      unsigned entries,
+      unsigned flags = 0,
+      unsigned sqThreadIdle = 0);
+  ~IoUringRings();
+
+  IoUringRings(const IoUringRings&) = delete;
+  IoUringRings& operator=(const IoUringRings&) = delete;
+
+  int fd{-1};
+  unsigned sqEntries{0};
+
+  void* sqRing{nullptr};
+  size_t sqRingSize{0};
+  void* cqRing{nullptr};
+  size_t cqRingSize{0};
+  io_uring_sqe* sqes{nullptr};
+  size_t sqesSize{0};
+
+  unsigned* sqHead{nullptr};
+  unsigned* sqTail{nullptr};
+  unsigned sqMask{0};
+  unsigned* sqFlags{nullptr};
+  unsigned* sqArray{nullptr};
+  unsigned* cqHead{nullptr};
+  unsigned* cqTail{nullptr};
+  unsigned cqMask{0};
+  io_uring_cqe* cqes{nullptr};
+
+ private:
+  void* mmapRing(size_t size, off_t offset);
+  void release();
+};
+
+#endif
+
+} // namespace detail
+} // namespace folly
@@ -20,6 +20,7 @@
 #include <folly/Portability.h>
 #include <folly/ScopeGuard.h>
 #include <folly/concurrency/CacheLocality.h>
+#include <folly/memory/JemallocArena.h>
 #include <folly/memory/MallctlHelper.h>
 #include <folly/memory/Malloc.h>
 #include <folly/portability/PThread.h>
@@ -29,13 +30,36 @@
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 namespace folly { namespace detail {
 
 AtomicStruct<std::chrono::steady_clock::duration>
 MemoryIdler::defaultIdleTimeout(std::chrono::seconds(5));
 
+std::atomic<bool> MemoryIdler::disableMallocCacheWhileIdle{false};
+
+struct IdleCallbackList {
+  std::mutex mutex;
+  uint64_t nextId{1};
+  std::vector<std::pair<uint64_t, Function<size_t()>>> callbacks;
+};
+
+namespace {
+
+std::atomic<uint64_t> bytesReleasedTotal{0};
+
+// Shared with the IdleCallbacks, which may outlive the thread
+std::shared_ptr<IdleCallbackList>& threadIdleCallbacks() {
+  static thread_local std::shared_ptr<IdleCallbackList> list;
+  return list;
+}
+
+} // namespace
+
 void MemoryIdler::flushLocalMallocCaches() {
   if (!usingJEMalloc()) {
     return;
@@ -46,8 +70,7 @@ void MemoryIdler::flushLocalMallocCaches() {
   }
 
   try {
-    // Not using mallctlCall as this will fail if tcache is disabled.
-    mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+    flushThreadMallocCache();
 
     // By default jemalloc has 4 arenas per cpu, and then assigns each
     // thread to one of those arenas.  This means that in any service
@@ -76,6 +99,126 @@ void MemoryIdler::flushLocalMallocCaches() {
   }
 }
 
+bool MemoryIdler::setLocalMallocCacheEnabled(bool enabled) {
+  return setThreadMallocCacheEnabled(enabled);
+}
+
+MemoryIdler::IdleCallback::IdleCallback(IdleCallback&& other) noexcept
+    : list_(std::move(other.list_)), id_(std::exchange(other.id_, 0)) {}
+
+MemoryIdler::IdleCallback& MemoryIdler::IdleCallback::operator=(
+    IdleCallback&& other) noexcept {
+  if (this != &other) {
+    reset();
+    list_ = std::move(other.list_);
+    id_ = std::exchange(other.id_, 0);
+  }
+  return *this;
+}
+
+MemoryIdler::IdleCallback::~IdleCallback() {
+  reset();
+}
+
+void MemoryIdler::IdleCallback::reset() {
+  if (auto list = list_.lock()) {
+    std::lock_guard<std::mutex> g(list->mutex);
+    auto& callbacks = list->callbacks;
+    callbacks.erase(
+        std::remove_if(
+            callbacks.begin(),
+            callbacks.end(),
+            [&](const std::pair<uint64_t, Function<size_t()>>& callback) {
+              return callback.first == id_;
+            }),
+        callbacks.end());
+  }
+  list_.reset();
+  id_ = 0;
+}
+
+MemoryIdler::IdleCallback MemoryIdler::addIdleCallback(
+    Function<size_t()> callback) {
+  auto& list = threadIdleCallbacks();
+  if (!list) {
+    list = std::make_shared<IdleCallbackList>();
+  }
+  IdleCallback handle;
+  std::lock_guard<std::mutex> g(list->mutex);
+  handle.list_ = list;
+  handle.id_ = list->nextId++;
+  list->callbacks.emplace_back(handle.id_, std::move(callback));
+  return handle;
+}
+
+size_t MemoryIdler::releaseIdleMemory(size_t stackToRetain) {
+  flushLocalMallocCaches();
+  size_t released = 0;
+  if (auto& list = threadIdleCallbacks()) {
+    std::lock_guard<std::mutex> g(list->mutex);
+    for (auto& callback : list->callbacks) {
+      released += callback.second();
+    }
+  }
+  // Last, as the callbacks may have grown the stack
+  released += unmapUnusedStack(stackToRetain);
+  bytesReleasedTotal.fetch_add(released, std::memory_order_relaxed);
+  return released;
+}
+
+uint64_t MemoryIdler::bytesReleased() {
+  return bytesReleasedTotal.load(std::memory_order_relaxed);
+}
+
+#ifdef __linux__
+
+static size_t pageSize() {
+  static const size_t s_pageSize = sysconf(_SC_PAGESIZE);
+  return s_pageSize;
+}
+
+size_t MemoryIdler::releasePages(void* begin, size_t size) {
+  auto mask = ~(pageSize() - 1);
+  auto b = (reinterpret_cast<uintptr_t>(begin) + pageSize() - 1) & mask;
+  auto e = (reinterpret_cast<uintptr_t>(begin) + size) & mask;
+  if (b >= e) {
+    return 0;
+  }
+
+  // Count the resident pages first, as only those are released.  One byte
+  // per page, a chunk at a time to keep the vector on the stack.
+  unsigned char resident[256];
+  size_t count = 0;
+  for (auto p = b; p < e;) {
+    size_t len = std::min(e - p, sizeof(resident) * pageSize());
+    // ENOMEM means some of it isn't mapped, which doesn't count anyway
+    if (mincore(reinterpret_cast<void*>(p), len, resident) == 0) {
+      for (size_t i = 0; i < len / pageSize(); ++i) {
+        count += resident[i] & 1;
+      }
+    }
+    p += len;
+  }
+
+  if (madvise(reinterpret_cast<void*>(b), e - b, MADV_DONTNEED) != 0) {
+    // It is likely that part of the range isn't mapped, e.g. a stack vma
+    // that hasn't been fully grown.  In this case madvise will apply
+    // dontneed to the present vmas, then return errno of ENOMEM.  We can
+    // also get an EAGAIN, theoretically.
+    // EINVAL means either an invalid alignment or length, or that some
+    // of the pages are locked or shared.  Neither should occur.
+    assert(errno == EAGAIN || errno == ENOMEM);
+  }
+  return count * pageSize();
+}
+
+#else
+
+size_t MemoryIdler::releasePages(void* /* begin */, size_t /* size */) {
+  return 0;
+}
+
+#endif
 
 // Stack madvise isn't Linux or glibc specific, but the system calls
 // and arithmetic (and bug compatibility) are not portable.  The set of
@@ -86,11 +229,6 @@ void MemoryIdler::flushLocalMallocCaches() {
 static FOLLY_TLS uintptr_t tls_stackLimit;
 static FOLLY_TLS size_t tls_stackSize;
 
-static size_t pageSize() {
-  static const size_t s_pageSize = sysconf(_SC_PAGESIZE);
-  return s_pageSize;
-}
-
 static void fetchStackLimits() {
   pthread_attr_t attr;
   pthread_getattr_np(pthread_self(), &attr);
@@ -130,13 +268,13 @@ FOLLY_NOINLINE static uintptr_t getStackPtr() {
   return rv;
 }
 
-void MemoryIdler::unmapUnusedStack(size_t retain) {
+size_t MemoryIdler::unmapUnusedStack(size_t retain) {
   if (tls_stackSize == 0) {
     fetchStackLimits();
   }
   if (tls_stackSize <= std::max(static_cast<size_t>(1), retain)) {
     // covers both missing stack info, and impossibly large retain
-    return;
+    return 0;
   }
 
   auto sp = getStackPtr();
@@ -146,24 +284,19 @@ void MemoryIdler::unmapUnusedStack(size_t retain) {
   auto end = (sp - retain) & ~(pageSize() - 1);
   if (end <= tls_stackLimit) {
     // no pages are eligible for unmapping
-    return;
+    return 0;
   }
 
   size_t len = end - tls_stackLimit;
   assert((len & (pageSize() - 1)) == 0);
-  if (madvise((void*)tls_stackLimit, len, MADV_DONTNEED) != 0) {
-    // It is likely that the stack vma hasn't been fully grown.  In this
-    // case madvise will apply dontneed to the present vmas, then return
-    // errno of ENOMEM.  We can also get an EAGAIN, theoretically.
-    // EINVAL means either an invalid alignment or length, or that some
-    // of the pages are locked or shared.  Neither should occur.
-    assert(errno == EAGAIN || errno == ENOMEM);
-  }
+  return releasePages(reinterpret_cast<void*>(tls_stackLimit), len);
 }
 
 #else
 
-void MemoryIdler::unmapUnusedStack(size_t /* retain */) {}
+size_t MemoryIdler::unmapUnusedStack(size_t /* retain */) {
+  return 0;
+}
 
 #endif
 
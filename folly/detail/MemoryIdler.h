@@ -18,8 +18,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <memory>
 
 #include <folly/AtomicStruct.h>
+#include <folly/Function.h>
 #include <folly/Traits.h>
 #include <folly/detail/Futex.h>
 #include <folly/hash/Hash.h>
@@ -37,6 +39,8 @@ struct IsTriviallyCopyable<std::chrono::steady_clock::duration>
 
 namespace folly { namespace detail {
 
+struct IdleCallbackList;
+
 /// MemoryIdler provides helper routines that allow routines to return
 /// some assigned memory resources back to the system.  The intended
 /// use is that when a thread is waiting for a long time (perhaps it
@@ -51,6 +55,16 @@ struct MemoryIdler {
   /// jemalloc is supported.
   static void flushLocalMallocCaches();
 
+  /// Enables or disables the thread-local malloc cache, returning whether
+  /// it was enabled.  jemalloc is supported; with others this does nothing
+  /// and returns false.
+  static bool setLocalMallocCacheEnabled(bool enabled);
+
+  /// If true, futexWait() doesn't just flush the thread-local malloc
+  /// cache once idleTimeout has passed, but disables it until the thread
+  /// wakes up, returning the memory of the cache itself.  False by default,
+  /// as it costs two more mallctl() calls per idle period.
+  static std::atomic<bool> disableMallocCacheWhileIdle;
 
   enum {
     /// This value is a tradeoff between reclaiming memory and triggering
@@ -64,8 +78,48 @@ struct MemoryIdler {
 
   /// Uses madvise to discard the portion of the thread's stack that
   /// currently doesn't hold any data, trying to ensure that no page
-  /// faults will occur during the next retain bytes of stack allocation
-  static void unmapUnusedStack(size_t retain = kDefaultStackToRetain);
+  /// faults will occur during the next retain bytes of stack allocation.
+  /// Returns the number of bytes released, as releasePages() does.
+  static size_t unmapUnusedStack(size_t retain = kDefaultStackToRetain);
+
+  /// Gives the whole pages in [begin, begin + size) back to the system
+  /// with madvise(MADV_DONTNEED); they read as zeroes when next touched.
+  /// Returns how many bytes of them were resident, or 0 where this isn't
+  /// supported.
+  static size_t releasePages(void* begin, size_t size);
+
+  /// The registration of a callback with addIdleCallback(); unregisters
+  /// it on destruction, which may happen on any thread.
+  class IdleCallback {
+   public:
+    IdleCallback() = default;
+    IdleCallback(IdleCallback&& other) noexcept;
+    IdleCallback& operator=(IdleCallback&& other) noexcept;
+    ~IdleCallback();
+
+    void reset();
+
+   private:
+    friend struct MemoryIdler;
+
+    std::weak_ptr<IdleCallbackList> list_;
+    uint64_t id_{0};
+  };
+
+  /// Registers a callback that releases memory the calling thread only
+  /// needs while busy (a per-thread cache, say), and returns the number
+  /// of bytes released.  releaseIdleMemory() runs it, on this thread, when
+  /// the thread goes idle; it must not add or remove idle callbacks.
+  static IdleCallback addIdleCallback(Function<size_t()> callback);
+
+  /// What a thread does after idling for a while: flushes its malloc
+  /// cache, runs its idle callbacks and unmaps its unused stack.  Returns
+  /// the number of bytes released, not counting the malloc cache, of
+  /// which jemalloc doesn't tell the size.
+  static size_t releaseIdleMemory(size_t stackToRetain = kDefaultStackToRetain);
+
+  /// The total returned by releaseIdleMemory(), across all threads
+  static uint64_t bytesReleased();
 
 
   /// The system-wide default for the amount of time a blocking
@@ -102,8 +156,8 @@ struct MemoryIdler {
   }
 
   /// Equivalent to fut.futexWait(expected, waitMask), but calls
-  /// flushLocalMallocCaches() and unmapUnusedStack(stackToRetain)
-  /// after idleTimeout has passed (if it has passed).  Internally uses
+  /// releaseIdleMemory(stackToRetain) after idleTimeout has passed (if
+  /// it has passed).  Internally uses
   /// fut.futexWait and fut.futexWaitUntil.  Like futexWait, returns
   /// false if interrupted with a signal.  The actual timeout will be
   /// pseudo-randomly chosen to be between idleTimeout and idleTimeout *
@@ -144,9 +198,16 @@ struct MemoryIdler {
     }
 
     // flush, then wait with no timeout
-    flushLocalMallocCaches();
-    unmapUnusedStack(stackToRetain);
-    return fut.futexWait(expected, waitMask);
+    releaseIdleMemory(stackToRetain);
+    if (!disableMallocCacheWhileIdle.load(std::memory_order_relaxed)) {
+      return fut.futexWait(expected, waitMask);
+    }
+    bool wasEnabled = setLocalMallocCacheEnabled(false);
+    auto rv = fut.futexWait(expected, waitMask);
+    if (wasEnabled) {
+      setLocalMallocCacheEnabled(true);
+    }
+    return rv;
   }
 };
 
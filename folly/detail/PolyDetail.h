@@ -373,6 +373,33 @@ struct Data {
   };
 };
 
+// Data with room for objects of up to N bytes in situ: buff_ runs on into
+// tail_. The thunks and ops only ever see the Data.
+template <std::size_t N, bool = (N > sizeof(Data))>
+struct Storage : Data {};
+
+template <std::size_t N>
+struct Storage<N, true> : Data {
+  Storage() = default;
+  // Like Data, copy nothing:
+  Storage(Storage const&) : Data() {}
+  Storage& operator=(Storage const&) {
+    return *this;
+  }
+  unsigned char tail_[N - sizeof(Data)];
+};
+
+// The in-situ capacity of Poly<I>: I::InlineSize if the interface (or one
+// that it extends) declares it, and the size of Data otherwise.
+template <class I, class = void>
+struct InlineSizeOf : std::integral_constant<std::size_t, sizeof(Data)> {};
+
+template <class I>
+struct InlineSizeOf<I, void_t<decltype(I::InlineSize)>>
+    : std::integral_constant<
+          std::size_t,
+          (I::InlineSize > sizeof(Data) ? I::InlineSize : sizeof(Data))> {};
+
 template <class U, class I>
 using Arg =
     If<std::is_same<Uncvref<U>, Archetype<I>>::value,
@@ -441,25 +468,24 @@ inline constexpr ThrowThunk throw_() noexcept {
   return ThrowThunk{};
 }
 
-template <class T>
+template <class T, std::size_t N = sizeof(Data)>
 inline constexpr bool inSitu() noexcept {
-  return !std::is_reference<T>::value &&
-      sizeof(std::decay_t<T>) <= sizeof(Data) &&
+  return !std::is_reference<T>::value && sizeof(std::decay_t<T>) <= N &&
       std::is_nothrow_move_constructible<std::decay_t<T>>::value;
 }
 
-template <class T>
+template <class T, std::size_t N = sizeof(Data)>
 T& get(Data& d) noexcept {
-  if (inSitu<T>()) {
+  if (inSitu<T, N>()) {
     return *(std::add_pointer_t<T>)static_cast<void*>(&d.buff_);
   } else {
     return *static_cast<std::add_pointer_t<T>>(d.pobj_);
   }
 }
 
-template <class T>
+template <class T, std::size_t N = sizeof(Data)>
 T const& get(Data const& d) noexcept {
-  if (inSitu<T>()) {
+  if (inSitu<T, N>()) {
     return *(std::add_pointer_t<T const>)static_cast<void const*>(&d.buff_);
   } else {
     return *static_cast<std::add_pointer_t<T const>>(d.pobj_);
@@ -491,6 +517,7 @@ template <
     class T,
     FOLLY_AUTO User,
     class I,
+    std::size_t N,
     class = ArgTypes<User, I>,
     class = Bool<true>>
 struct ThunkFn {
@@ -500,11 +527,12 @@ struct ThunkFn {
   }
 };
 
-template <class T, FOLLY_AUTO User, class I, class... Args>
+template <class T, FOLLY_AUTO User, class I, std::size_t N, class... Args>
 struct ThunkFn<
     T,
     User,
     I,
+    N,
     TypeList<Args...>,
     Bool<
         !std::is_const<std::remove_reference_t<T>>::value ||
@@ -515,7 +543,7 @@ struct ThunkFn<
       static R call(D& d, As... as) {
         return folly::invoke(
             memberValue<User>(),
-            get<T>(d),
+            get<T, N>(d),
             convert<Args>(static_cast<As&&>(as))...);
       }
     };
@@ -529,9 +557,9 @@ template <
     class = SubsumptionsOf<I>>
 struct VTable;
 
-template <class T, FOLLY_AUTO User, class I>
-inline constexpr ThunkFn<T, User, I> thunk() noexcept {
-  return ThunkFn<T, User, I>{};
+template <class T, FOLLY_AUTO User, class I, std::size_t N>
+inline constexpr ThunkFn<T, User, I, N> thunk() noexcept {
+  return ThunkFn<T, User, I, N>{};
 }
 
 template <class I>
@@ -539,14 +567,17 @@ constexpr VTable<I> const* vtable() noexcept {
   return &StaticConst<VTable<I>>::value;
 }
 
-template <class I, class T>
+// The vtable of interface I for objects of type T in a Poly whose in-situ
+// capacity is N
+template <class I, class T, std::size_t N = sizeof(Data)>
 struct VTableFor : VTable<I> {
-  constexpr VTableFor() noexcept : VTable<I>{Type<T>{}} {}
+  constexpr VTableFor() noexcept
+      : VTable<I>{Type<T>{}, std::integral_constant<std::size_t, N>{}} {}
 };
 
-template <class I, class T>
+template <class I, class T, std::size_t N = sizeof(Data)>
 constexpr VTable<I> const* vtableFor() noexcept {
-  return &StaticConst<VTableFor<I, T>>::value;
+  return &StaticConst<VTableFor<I, T, N>>::value;
 }
 
 template <class I, class T>
@@ -565,6 +596,7 @@ constexpr void* vtableForRef(RefType ref) {
 template <
     class I,
     class T,
+    std::size_t N,
     std::enable_if_t<std::is_reference<T>::value, int> = 0>
 void* execOnHeap(Op op, Data* from, void* to) {
   switch (op) {
@@ -591,18 +623,19 @@ void* execOnHeap(Op op, Data* from, void* to) {
 template <
     class I,
     class T,
+    std::size_t N,
     std::enable_if_t<Not<std::is_reference<T>>::value, int> = 0>
 void* execOnHeap(Op op, Data* from, void* to) {
   switch (op) {
     case Op::eNuke:
-      delete &get<T>(*from);
+      delete &get<T, N>(*from);
       break;
     case Op::eMove:
       static_cast<Data*>(to)->pobj_ = std::exchange(from->pobj_, nullptr);
       break;
     case Op::eCopy:
       detail::if_constexpr(std::is_copy_constructible<T>(), [&](auto id) {
-        static_cast<Data*>(to)->pobj_ = new T(id(get<T>(*from)));
+        static_cast<Data*>(to)->pobj_ = new T(id(get<T, N>(*from)));
       });
       break;
     case Op::eType:
@@ -619,21 +652,21 @@ void* execOnHeap(Op op, Data* from, void* to) {
   return nullptr;
 }
 
-template <class I, class T>
+template <class I, class T, std::size_t N>
 void* execInSitu(Op op, Data* from, void* to) {
   switch (op) {
     case Op::eNuke:
-      get<T>(*from).~T();
+      get<T, N>(*from).~T();
       break;
     case Op::eMove:
       ::new (static_cast<void*>(&static_cast<Data*>(to)->buff_))
-          T(std::move(get<T>(*from)));
-      get<T>(*from).~T();
+          T(std::move(get<T, N>(*from)));
+      get<T, N>(*from).~T();
       break;
     case Op::eCopy:
       detail::if_constexpr(std::is_copy_constructible<T>(), [&](auto id) {
         ::new (static_cast<void*>(&static_cast<Data*>(to)->buff_))
-            T(id(get<T>(*from)));
+            T(id(get<T, N>(*from)));
       });
       break;
     case Op::eType:
@@ -661,26 +694,37 @@ struct BasePtr {
   VTable<I> const* vptr_;
 };
 
-template <class I, class T, std::enable_if_t<inSitu<T>(), int> = 0>
+template <
+    class I,
+    class T,
+    std::size_t N,
+    std::enable_if_t<inSitu<T, N>(), int> = 0>
 constexpr void* (*getOps() noexcept)(Op, Data*, void*) {
-  return &execInSitu<I, T>;
+  return &execInSitu<I, T, N>;
 }
 
-template <class I, class T, std::enable_if_t<!inSitu<T>(), int> = 0>
+template <
+    class I,
+    class T,
+    std::size_t N,
+    std::enable_if_t<!inSitu<T, N>(), int> = 0>
 constexpr void* (*getOps() noexcept)(Op, Data*, void*) {
-  return &execOnHeap<I, T>;
+  return &execOnHeap<I, T, N>;
 }
 
 template <class I, FOLLY_AUTO... Arch, class... S>
 struct VTable<I, PolyMembers<Arch...>, TypeList<S...>>
     : BasePtr<S>..., std::tuple<SignatureOf<Arch, I>...> {
  private:
-  template <class T, FOLLY_AUTO... User>
-  constexpr VTable(Type<T>, PolyMembers<User...>) noexcept
-      : BasePtr<S>{vtableFor<S, T>()}...,
-        std::tuple<SignatureOf<Arch, I>...>{thunk<T, User, I>()...},
-        state_{inSitu<T>() ? State::eInSitu : State::eOnHeap},
-        ops_{getOps<I, T>()} {}
+  template <class T, std::size_t N, FOLLY_AUTO... User>
+  constexpr VTable(
+      Type<T>,
+      std::integral_constant<std::size_t, N>,
+      PolyMembers<User...>) noexcept
+      : BasePtr<S>{vtableFor<S, T, N>()}...,
+        std::tuple<SignatureOf<Arch, I>...>{thunk<T, User, I, N>()...},
+        state_{inSitu<T, N>() ? State::eInSitu : State::eOnHeap},
+        ops_{getOps<I, T, N>()} {}
 
  public:
   constexpr VTable() noexcept
@@ -690,9 +734,11 @@ struct VTable<I, PolyMembers<Arch...>, TypeList<S...>>
         state_{State::eEmpty},
         ops_{&noopExec} {}
 
-  template <class T>
-  explicit constexpr VTable(Type<T>) noexcept
-      : VTable{Type<T>{}, MembersOf<I, T>{}} {}
+  template <class T, std::size_t N>
+  constexpr VTable(Type<T>, std::integral_constant<std::size_t, N>) noexcept
+      : VTable{Type<T>{},
+               std::integral_constant<std::size_t, N>{},
+               MembersOf<I, T>{}} {}
 
   State state_;
   void* (*ops_)(Op, Data*, void*);
@@ -798,8 +844,15 @@ struct MakePolyNode {
   using apply = InterfaceOf<I, PolyNode<I, State>>;
 };
 
+// References only need Data's pointer
+template <class I>
+using PolyStorage =
+    If<std::is_reference<I>::value,
+       Data,
+       Storage<InlineSizeOf<std::decay_t<I>>::value>>;
+
 template <class I>
-struct PolyRoot : private PolyBase, private Data {
+struct PolyRoot : private PolyBase, private PolyStorage<I> {
   friend PolyAccess;
   friend Poly<I>;
   friend PolyVal<I>;
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/RangeCaseInsensitive.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+inline char lowerAscii(char c) {
+  return char(c + (uint8_t(c - 'A') < 26 ? 0x20 : 0));
+}
+
+// 8 bytes at a time: 0x80 is set in each byte of gtZ (resp. geA) whose low
+// 7 bits are above 'Z' (resp. at least 'A'); no addition carries into the
+// next byte.
+inline uint64_t lowerAscii64(uint64_t x) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  uint64_t low7 = x & (0x7f * ones);
+  uint64_t geA = low7 + (0x80 - 'A') * ones;
+  uint64_t gtZ = low7 + (0x7f - 'Z') * ones;
+  uint64_t upper = (geA ^ gtZ) & ~x & (0x80 * ones);
+  return x | (upper >> 2);
+}
+
+template <bool kLowerB>
+inline uint64_t lowerB64(uint64_t x) {
+  return kLowerB ? x : lowerAscii64(x);
+}
+
+template <bool kLowerB>
+inline bool equalSwar(const char* a, const char* b, size_t n) {
+  if (n >= 8) {
+    size_t i = 0;
+    for (; i + 8 < n; i += 8) {
+      if (lowerAscii64(loadUnaligned<uint64_t>(a + i)) !=
+          lowerB64<kLowerB>(loadUnaligned<uint64_t>(b + i))) {
+        return false;
+      }
+    }
+    // The last 8 bytes, overlapping what was already compared
+    return lowerAscii64(loadUnaligned<uint64_t>(a + n - 8)) ==
+        lowerB64<kLowerB>(loadUnaligned<uint64_t>(b + n - 8));
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (lowerAscii(a[i]) != (kLowerB ? b[i] : lowerAscii(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if FOLLY_X64
+
+// 'A'..'Z' map to the 26 smallest signed bytes after adding 0x3f
+inline __m128i lowerAscii128(__m128i v) {
+  __m128i upper = _mm_cmplt_epi8(
+      _mm_add_epi8(v, _mm_set1_epi8(0x3f)), _mm_set1_epi8(-128 + 26));
+  return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+template <bool kLowerB>
+inline bool equal16(const char* a, const char* b) {
+  __m128i va = lowerAscii128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+  __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+  if (!kLowerB) {
+    vb = lowerAscii128(vb);
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xffff;
+}
+
+template <bool kLowerB>
+bool equalImpl(const char* a, const char* b, size_t n) {
+  if (n < 16) {
+    return equalSwar<kLowerB>(a, b, n);
+  }
+  size_t i = 0;
+  for (; i + 16 < n; i += 16) {
+    if (!equal16<kLowerB>(a + i, b + i)) {
+      return false;
+    }
+  }
+  return equal16<kLowerB>(a + n - 16, b + n - 16);
+}
+
+// Candidate search for find(): match(p, last, first, lastc) returns a mask
+// of the kWidth positions from p, with bit i set iff p[i] matches first and
+// p[i + last] matches lastc (both lowercase).
+
+struct Sse2CaseMatcher {
+  static constexpr size_t kWidth = 16;
+
+  static uint32_t match(const char* p, size_t last, char first, char lastc) {
+    __m128i f = lowerAscii128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    __m128i l = lowerAscii128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + last)));
+    __m128i eq = _mm_and_si128(
+        _mm_cmpeq_epi8(f, _mm_set1_epi8(first)),
+        _mm_cmpeq_epi8(l, _mm_set1_epi8(lastc)));
+    return uint32_t(_mm_movemask_epi8(eq));
+  }
+};
+
+struct Avx2CaseMatcher {
+  static constexpr size_t kWidth = 32;
+
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static __m256i lowerAscii256(__m256i v) {
+    __m256i upper = _mm256_cmpgt_epi8(
+        _mm256_set1_epi8(-128 + 26),
+        _mm256_add_epi8(v, _mm256_set1_epi8(0x3f)));
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static uint32_t match(const char* p, size_t last, char first, char lastc) {
+    __m256i f = lowerAscii256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    __m256i l = lowerAscii256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + last)));
+    __m256i eq = _mm256_and_si256(
+        _mm256_cmpeq_epi8(f, _mm256_set1_epi8(first)),
+        _mm256_cmpeq_epi8(l, _mm256_set1_epi8(lastc)));
+    return uint32_t(_mm256_movemask_epi8(eq));
+  }
+};
+
+constexpr size_t Sse2CaseMatcher::kWidth;
+constexpr size_t Avx2CaseMatcher::kWidth;
+
+bool hasAvx2() {
+  static const bool avx2 = CpuId().avx2();
+  return avx2;
+}
+
+#else
+
+template <bool kLowerB>
+bool equalImpl(const char* a, const char* b, size_t n) {
+  return equalSwar<kLowerB>(a, b, n);
+}
+
+#endif
+
+// Searches one position at a time, from i.
+template <bool kLowerNeedle>
+size_t findTail(const StringPieceLite haystack, const StringPieceLite needle,
+                size_t i) {
+  const char* h = haystack.data();
+  size_t last = needle.size() - 1;
+  char first = lowerAscii(needle[0]);
+  char lastc = lowerAscii(needle[last]);
+  for (; i + last < haystack.size(); ++i) {
+    if (lowerAscii(h[i]) == first && lowerAscii(h[i + last]) == lastc &&
+        equalImpl<kLowerNeedle>(h + i + 1, needle.data() + 1,
+                                last > 0 ? last - 1 : 0)) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+#if FOLLY_X64
+
+// Finds candidates by their first and last characters, kWidth positions at
+// a time, and compares the rest of the needle only for those.
+template <class Matcher, bool kLowerNeedle>
+size_t findImpl(const StringPieceLite haystack, const StringPieceLite needle) {
+  const char* h = haystack.data();
+  size_t last = needle.size() - 1;
+  char first = lowerAscii(needle[0]);
+  char lastc = lowerAscii(needle[last]);
+  size_t i = 0;
+  for (; i + last + Matcher::kWidth <= haystack.size(); i += Matcher::kWidth) {
+    uint32_t mask = Matcher::match(h + i, last, first, lastc);
+    while (mask != 0) {
+      size_t j = i + findFirstSet(mask) - 1;
+      if (last < 2 ||
+          equalImpl<kLowerNeedle>(h + j + 1, needle.data() + 1, last - 1)) {
+        return j;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return findTail<kLowerNeedle>(haystack, needle, i);
+}
+
+#endif
+
+template <bool kLowerNeedle>
+size_t find(const StringPieceLite haystack, const StringPieceLite needle) {
+  if (needle.empty()) {
+    return 0;
+  }
+  if (needle.size() > haystack.size()) {
+    return std::string::npos;
+  }
+#if FOLLY_X64
+  return hasAvx2()
+      ? findImpl<Avx2CaseMatcher, kLowerNeedle>(haystack, needle)
+      : findImpl<Sse2CaseMatcher, kLowerNeedle>(haystack, needle);
+#else
+  return findTail<kLowerNeedle>(haystack, needle, 0);
+#endif
+}
+
+} // namespace
+
+bool asciiCaseInsensitiveEqual(const char* a, const char* b, size_t n) {
+  return equalImpl<false>(a, b, n);
+}
+
+bool asciiCaseInsensitiveEqualLower(const char* a, const char* b, size_t n) {
+  return equalImpl<true>(a, b, n);
+}
+
+size_t asciiCaseInsensitiveFind(
+    const StringPieceLite haystack,
+    const StringPieceLite needle) {
+  return find<false>(haystack, needle);
+}
+
+size_t asciiCaseInsensitiveFindLower(
+    const StringPieceLite haystack,
+    const StringPieceLite needle) {
+  return find<true>(haystack, needle);
+}
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <folly/detail/RangeCommon.h>
+
+namespace folly {
+
+namespace detail {
+
+/**
+ * ASCII case-insensitive comparison and search, 16 or 32 bytes at a time
+ * where SIMD is available.  Used by caseInsensitiveEqual(), ifind() and
+ * CaseInsensitiveNeedle in Range.h.
+ *
+ * The *Lower variants require b (resp. needle) to be lowercase already,
+ * which saves converting it on every comparison.
+ */
+bool asciiCaseInsensitiveEqual(const char* a, const char* b, size_t n);
+bool asciiCaseInsensitiveEqualLower(const char* a, const char* b, size_t n);
+
+size_t asciiCaseInsensitiveFind(
+    const StringPieceLite haystack,
+    const StringPieceLite needle);
+size_t asciiCaseInsensitiveFindLower(
+    const StringPieceLite haystack,
+    const StringPieceLite needle);
+
+} // namespace detail
+} // namespace folly
@@ -18,6 +18,8 @@
 
 #include <bitset>
 
+#include <folly/Range.h>
+#include <folly/container/ByteSet.h>
 #include <folly/container/SparseByteSet.h>
 
 namespace folly {
@@ -53,5 +55,11 @@ size_t qfind_first_byte_of_byteset(
   }
   return std::string::npos;
 }
+
+size_t qfind_first_byte_of_shuffle(
+    const StringPieceLite haystack,
+    const StringPieceLite needles) {
+  return ByteSet(StringPiece(needles)).find_first_in(StringPiece(haystack));
+}
 } // namespace detail
 } // namespace folly
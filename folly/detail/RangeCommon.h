@@ -89,6 +89,12 @@ size_t qfind_first_byte_of_byteset(
     const StringPieceLite haystack,
     const StringPieceLite needles);
 
+// Compiles needles into a ByteSet, and searches 16 or 32 bytes at a time
+// with its PSHUFB lookup where the CPU has SSSE3 (resp. AVX2).
+size_t qfind_first_byte_of_shuffle(
+    const StringPieceLite haystack,
+    const StringPieceLite needles);
+
 inline size_t qfind_first_byte_of_nosse(
     const StringPieceLite haystack,
     const StringPieceLite needles) {
@@ -98,6 +104,9 @@ inline size_t qfind_first_byte_of_nosse(
   // The thresholds below were empirically determined by benchmarking.
   // This is not an exact science since it depends on the CPU, the size of
   // needles, and the size of haystack.
+  if (haystack.size() >= 16) {
+    return qfind_first_byte_of_shuffle(haystack, needles);
+  }
   if ((needles.size() >= 4 && haystack.size() <= 10) ||
       (needles.size() >= 16 && haystack.size() <= 64) || needles.size() >= 32) {
     return qfind_first_byte_of_byteset(haystack, needles);
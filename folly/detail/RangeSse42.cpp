@@ -195,6 +195,12 @@ size_t qfind_first_byte_of_sse42(
     const StringPieceLite needles) {
   if (UNLIKELY(needles.empty() || haystack.empty())) {
     return std::string::npos;
+  } else if (
+      haystack.size() >= 256 ||
+      (needles.size() > 16 && haystack.size() >= 128)) {
+    // Past these sizes, building a ByteSet costs less than the
+    // PCMPESTRI per 16 bytes of haystack and of needles
+    return qfind_first_byte_of_shuffle(haystack, needles);
   } else if (needles.size() <= 16) {
     // we can save some unnecessary load instructions by optimizing for
     // the common case of needles.size() <= 16
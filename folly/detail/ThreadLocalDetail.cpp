@@ -45,16 +45,22 @@ void StaticMetaBase::onThreadExit(void* ptr) {
   };
 
   {
-    SharedMutex::ReadHolder rlock(nullptr);
-    if (meta.strict_) {
-      rlock = SharedMutex::ReadHolder(meta.accessAllThreadsLock_);
-    }
+    // Accessors hand out pointers to this thread's elements without holding
+    // lock_, so we wait for any live one before leaving meta.
+    SharedMutex::ReadHolder rlock(meta.accessAllThreadsLock_);
     {
       std::lock_guard<std::mutex> g(meta.lock_);
       meta.erase(&(*threadEntry));
       // No need to hold the lock any longer; the ThreadEntry is private to this
       // thread now that it's been removed from meta.
     }
+    if (!meta.strict_) {
+      // Accessors created from now on don't see this thread, so its
+      // elements can be disposed without the lock, which lets their
+      // destructors use accessAllThreads().  In strict mode we keep it so
+      // that destroy() waits for us.
+      rlock.unlock();
+    }
     // NOTE: User-provided deleter / object dtor itself may be using ThreadLocal
     // with the same Tag, so dispose() calls below may (re)create some of the
     // elements or even increase elementsCapacity, thus multiple cleanup rounds
@@ -74,24 +80,29 @@ void StaticMetaBase::onThreadExit(void* ptr) {
 }
 
 uint32_t StaticMetaBase::allocate(EntryID* ent) {
-  uint32_t id;
-  auto& meta = *this;
-  std::lock_guard<std::mutex> g(meta.lock_);
-
-  id = ent->value.load();
-  if (id != kEntryIDInvalid) {
-    return id;
+  uint32_t id = kEntryIDInvalid;
+  // Reuse ids when there are some, to keep the elements arrays small, but
+  // don't take the lock otherwise.
+  if (numFreeIds_.load(std::memory_order_relaxed) != 0) {
+    std::lock_guard<std::mutex> g(lock_);
+    if (!freeIds_.empty()) {
+      id = freeIds_.back();
+      freeIds_.pop_back();
+      numFreeIds_.store(freeIds_.size(), std::memory_order_relaxed);
+    }
   }
-
-  if (!meta.freeIds_.empty()) {
-    id = meta.freeIds_.back();
-    meta.freeIds_.pop_back();
-  } else {
-    id = meta.nextId_++;
+  if (id == kEntryIDInvalid) {
+    id = nextId_.fetch_add(1, std::memory_order_relaxed);
   }
 
-  uint32_t old_id = ent->value.exchange(id);
-  DCHECK_EQ(old_id, kEntryIDInvalid);
+  uint32_t expected = kEntryIDInvalid;
+  if (!ent->value.compare_exchange_strong(expected, id)) {
+    // Another thread allocated an id for ent first; give ours back
+    std::lock_guard<std::mutex> g(lock_);
+    freeIds_.push_back(id);
+    numFreeIds_.store(freeIds_.size(), std::memory_order_relaxed);
+    return expected;
+  }
   return id;
 }
 
@@ -143,6 +154,8 @@ void StaticMetaBase::destroy(EntryID* ent) {
           }
         }
         meta.freeIds_.push_back(id);
+        meta.numFreeIds_.store(
+            meta.freeIds_.size(), std::memory_order_relaxed);
       }
     }
     // Delete elements outside the locks.
@@ -154,6 +167,17 @@ void StaticMetaBase::destroy(EntryID* ent) {
   }
 }
 
+std::vector<void*> StaticMetaBase::collect(uint32_t id) {
+  std::vector<void*> ptrs;
+  std::lock_guard<std::mutex> g(lock_);
+  for (ThreadEntry* e = head_.next; e != &head_; e = e->next) {
+    if (id < e->elementsCapacity && e->elements[id].ptr) {
+      ptrs.push_back(e->elements[id].ptr);
+    }
+  }
+  return ptrs;
+}
+
 /**
  * Reserve enough space in the ThreadEntry::elements for the item
  * @id to fit in.
@@ -254,7 +254,7 @@ struct StaticMetaBase {
       if (id != kEntryIDInvalid) {
         return id;
       }
-      // The lock inside allocate ensures that a single value is allocated
+      // allocate() installs its id with a CAS, so a single value wins
       return meta.allocate(this);
     }
   };
@@ -292,13 +292,23 @@ struct StaticMetaBase {
 
   ElementWrapper& get(EntryID* ent);
 
+  /**
+   * The elements with the given id in all threads, in thread registration
+   * order.  Only stays valid while accessAllThreadsLock_ is held
+   * exclusively, which keeps threads from disposing them on exit.
+   */
+  std::vector<void*> collect(uint32_t id);
+
   static void initAtFork();
   static void registerAtFork(
       folly::Function<void()> prepare,
       folly::Function<void()> parent,
       folly::Function<void()> child);
 
-  uint32_t nextId_;
+  // Ids are handed out without locking unless freeIds_ may be non-empty;
+  // numFreeIds_ is freeIds_.size(), written under lock_.
+  std::atomic<uint32_t> nextId_;
+  std::atomic<uint32_t> numFreeIds_{0};
   std::vector<uint32_t> freeIds_;
   std::mutex lock_;
   SharedMutex accessAllThreadsLock_;
@@ -312,9 +322,12 @@ struct StaticMetaBase {
 // We have one of these per "Tag", by default one for the whole system
 // (Tag=void).
 //
-// Creating and destroying ThreadLocalPtr objects, as well as thread exit
-// for threads that use ThreadLocalPtr objects collide on a lock inside
-// StaticMeta; you can specify multiple Tag types to break that lock.
+// Destroying ThreadLocalPtr objects, growing a thread's elements and thread
+// exit for threads that use ThreadLocalPtr objects collide on a lock inside
+// StaticMeta; you can specify multiple Tag types to break that lock.  It is
+// only held for short, bounded sections: allocating ids doesn't take it
+// unless ids can be recycled, and accessAllThreads() takes a snapshot under
+// it rather than holding it while iterating.
 template <class Tag, class AccessMode>
 struct StaticMeta : StaticMetaBase {
   StaticMeta()
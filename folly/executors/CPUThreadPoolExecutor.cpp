@@ -16,6 +16,9 @@
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/task_queue/PriorityLifoSemMPMCQueue.h>
+#include <folly/tracing/StaticTracepoint.h>
+
+FOLLY_SDT_DEFINE_SEMAPHORE(folly, thread_pool_executor_task_enqueue);
 
 namespace folly {
 
@@ -81,8 +84,14 @@ void CPUThreadPoolExecutor::add(
     std::chrono::milliseconds expiration,
     Func expireCallback) {
   // TODO handle enqueue failure, here and in other add() callsites
-  taskQueue_->add(
-      CPUTask(std::move(func), expiration, std::move(expireCallback)));
+  CPUTask task(std::move(func), expiration, std::move(expireCallback));
+  if (hasTaskStatsCallbacks() ||
+      FOLLY_SDT_IS_ENABLED(folly, thread_pool_executor_task_enqueue)) {
+    task.stats_.queueDepth = taskQueue_->size();
+    FOLLY_SDT_WITH_SEMAPHORE(
+        folly, thread_pool_executor_task_enqueue, this, task.stats_.queueDepth);
+  }
+  taskQueue_->add(std::move(task));
 }
 
 void CPUThreadPoolExecutor::addWithPriority(Func func, int8_t priority) {
@@ -95,9 +104,14 @@ void CPUThreadPoolExecutor::add(
     std::chrono::milliseconds expiration,
     Func expireCallback) {
   CHECK(getNumPriorities() > 0);
-  taskQueue_->addWithPriority(
-      CPUTask(std::move(func), expiration, std::move(expireCallback)),
-      priority);
+  CPUTask task(std::move(func), expiration, std::move(expireCallback));
+  if (hasTaskStatsCallbacks() ||
+      FOLLY_SDT_IS_ENABLED(folly, thread_pool_executor_task_enqueue)) {
+    task.stats_.queueDepth = taskQueue_->size();
+    FOLLY_SDT_WITH_SEMAPHORE(
+        folly, thread_pool_executor_task_enqueue, this, task.stats_.queueDepth);
+  }
+  taskQueue_->addWithPriority(std::move(task), priority);
 }
 
 uint8_t CPUThreadPoolExecutor::getNumPriorities() const {
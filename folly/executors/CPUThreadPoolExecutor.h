@@ -59,6 +59,10 @@ namespace folly {
  * themselves don't have priorities set, so a series of long running low
  * priority tasks could still hog all the threads. (at last check pthreads
  * thread priorities didn't work very well).
+ *
+ * @note With many producer and worker threads, RelaxedPriorityBlockingQueue
+ * spreads tasks over many small queues instead, trading strict priority
+ * order for less contention.
  */
 class CPUThreadPoolExecutor : public ThreadPoolExecutor {
  public:
@@ -0,0 +1,284 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/ConcurrencyLimiter.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+namespace {
+
+constexpr size_t kNumBuckets = 60;
+
+MultiLevelTimeSeries<int64_t> makeTimeSeries() {
+  return MultiLevelTimeSeries<int64_t>(
+      kNumBuckets,
+      {std::chrono::seconds(60),
+       std::chrono::seconds(600),
+       std::chrono::seconds(3600),
+       std::chrono::seconds(0)});
+}
+
+std::chrono::seconds now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+}
+
+// Buckets of the limit and in flight histograms
+int64_t countBucket(size_t maxLimit) {
+  return std::max<int64_t>(1, int64_t(maxLimit / 100));
+}
+
+} // namespace
+
+ConcurrencyLimiter::ConcurrencyLimiter(Options options)
+    : options_(options),
+      limit_(options.initialLimit),
+      estimate_(double(options.initialLimit)),
+      latencyMicros_(
+          options.latencyBucket.count(),
+          0,
+          options.maxLatency.count(),
+          makeTimeSeries()),
+      limits_(
+          countBucket(options.maxLimit),
+          0,
+          int64_t(options.maxLimit),
+          makeTimeSeries()),
+      inFlightCounts_(
+          countBucket(options.maxLimit),
+          0,
+          int64_t(options.maxLimit),
+          makeTimeSeries()),
+      dropped_(makeTimeSeries()),
+      rejected_(makeTimeSeries()) {
+  CHECK_GE(options_.minLimit, 1);
+  CHECK_LE(options_.minLimit, options_.initialLimit);
+  CHECK_LE(options_.initialLimit, options_.maxLimit);
+  CHECK(options_.backoffRatio > 0 && options_.backoffRatio <= 1);
+  CHECK(options_.smoothing > 0 && options_.smoothing <= 1);
+  CHECK_GE(options_.longWindow, 1);
+  CHECK_GE(options_.probeInterval, 1);
+}
+
+ConcurrencyLimiter::~ConcurrencyLimiter() {
+  DCHECK_EQ(0, inFlight());
+}
+
+bool ConcurrencyLimiter::tryAcquireSlot() {
+  auto inFlight = inFlight_.load(std::memory_order_relaxed);
+  do {
+    if (inFlight >= limit_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+  } while (!inFlight_.compare_exchange_weak(inFlight, inFlight + 1));
+  return true;
+}
+
+Optional<ConcurrencyLimiter::Token> ConcurrencyLimiter::tryAcquire() {
+  // Don't jump the queue
+  if (numWaiters_.load(std::memory_order_relaxed) == 0 && tryAcquireSlot()) {
+    return Token(this, Clock::now());
+  }
+  std::lock_guard<std::mutex> g(mutex_);
+  rejected_.addValue(now(), 1);
+  return none;
+}
+
+Future<ConcurrencyLimiter::Token> ConcurrencyLimiter::acquire() {
+  if (numWaiters_.load(std::memory_order_relaxed) == 0 && tryAcquireSlot()) {
+    return makeFuture(Token(this, Clock::now()));
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  // A release may have freed a slot since, but only waiters before this
+  // one may take it
+  if (waiters_.empty() && tryAcquireSlot()) {
+    lock.unlock();
+    return makeFuture(Token(this, Clock::now()));
+  }
+  if (waiters_.size() >= options_.maxWaiters) {
+    rejected_.addValue(now(), 1);
+    lock.unlock();
+    return makeFuture<Token>(ConcurrencyLimitExceeded());
+  }
+  waiters_.emplace_back();
+  numWaiters_.fetch_add(1, std::memory_order_relaxed);
+  return waiters_.back().getFuture();
+}
+
+void ConcurrencyLimiter::release(Clock::time_point start, Outcome outcome) {
+  auto end = Clock::now();
+  std::deque<Promise<Token>> ready;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    addSampleLocked(
+        double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   end - start)
+                   .count()),
+        inFlight_.load(std::memory_order_relaxed),
+        outcome);
+    inFlight_.fetch_sub(1);
+    ready = popReadyWaitersLocked();
+  }
+  for (auto& promise : ready) {
+    promise.setValue(Token(this, end));
+  }
+}
+
+void ConcurrencyLimiter::addSample(
+    std::chrono::nanoseconds latency,
+    size_t inFlight,
+    Outcome outcome) {
+  std::deque<Promise<Token>> ready;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    addSampleLocked(double(latency.count()), inFlight, outcome);
+    ready = popReadyWaitersLocked();
+  }
+  auto start = Clock::now();
+  for (auto& promise : ready) {
+    promise.setValue(Token(this, start));
+  }
+}
+
+std::deque<Promise<ConcurrencyLimiter::Token>>
+ConcurrencyLimiter::popReadyWaitersLocked() {
+  std::deque<Promise<Token>> ready;
+  while (!waiters_.empty() && tryAcquireSlot()) {
+    ready.push_back(std::move(waiters_.front()));
+    waiters_.pop_front();
+    numWaiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return ready;
+}
+
+void ConcurrencyLimiter::addSampleLocked(
+    double latencyNs,
+    size_t inFlight,
+    Outcome outcome) {
+  auto time = now();
+  switch (outcome) {
+    case Outcome::IGNORED:
+      return;
+    case Outcome::DROPPED:
+      estimate_ *= options_.backoffRatio;
+      dropped_.addValue(time, 1);
+      break;
+    case Outcome::SUCCESS:
+      latencyMicros_.addValue(time, int64_t(latencyNs / 1000));
+      if (options_.algorithm == Algorithm::GRADIENT) {
+        updateGradient(latencyNs, inFlight);
+      } else {
+        updateVegas(latencyNs, inFlight);
+      }
+      break;
+  }
+  estimate_ = std::min(
+      std::max(estimate_, double(options_.minLimit)),
+      double(options_.maxLimit));
+  limit_.store(size_t(estimate_), std::memory_order_relaxed);
+  limits_.addValue(time, int64_t(limit_.load(std::memory_order_relaxed)));
+  inFlightCounts_.addValue(time, int64_t(inFlight));
+}
+
+void ConcurrencyLimiter::updateGradient(double latencyNs, size_t inFlight) {
+  if (averageLatency_ == 0) {
+    averageLatency_ = latencyNs;
+  } else {
+    averageLatency_ +=
+        (latencyNs - averageLatency_) / double(options_.longWindow);
+  }
+  // After a long overload, the average takes a long time to come back down,
+  // and would let the limit grow too much meanwhile
+  if (averageLatency_ > 2 * latencyNs) {
+    averageLatency_ *= 0.95;
+  }
+  // Latency says little about a limit which isn't reached
+  if (2 * double(inFlight) < estimate_) {
+    return;
+  }
+  double gradient = std::max(
+      0.5,
+      std::min(
+          1.0, options_.tolerance * averageLatency_ / std::max(latencyNs, 1.)));
+  double target = estimate_ * gradient + std::sqrt(estimate_);
+  estimate_ += (target - estimate_) * options_.smoothing;
+}
+
+void ConcurrencyLimiter::updateVegas(double latencyNs, size_t inFlight) {
+  bool probe = ++samples_ % options_.probeInterval == 0;
+  if (minLatency_ == 0 || latencyNs < minLatency_ || probe) {
+    minLatency_ = latencyNs;
+  }
+  if (2 * double(inFlight) < estimate_) {
+    return;
+  }
+  double queued = estimate_ * (1 - minLatency_ / std::max(latencyNs, 1.));
+  double step = std::max(1.0, std::log10(estimate_));
+  if (queued <= step) {
+    // Hardly anything queued: grow quickly
+    estimate_ += 6 * step;
+  } else if (queued < 3 * step) {
+    estimate_ += step;
+  } else if (queued > 6 * step) {
+    estimate_ -= step;
+  }
+}
+
+void ConcurrencyLimiter::updateHistograms() const {
+  auto time = now();
+  latencyMicros_.update(time);
+  limits_.update(time);
+  inFlightCounts_.update(time);
+  dropped_.update(time);
+  rejected_.update(time);
+}
+
+ConcurrencyLimiter::Histogram ConcurrencyLimiter::latencyMicros() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  updateHistograms();
+  return latencyMicros_;
+}
+
+ConcurrencyLimiter::Histogram ConcurrencyLimiter::limits() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  updateHistograms();
+  return limits_;
+}
+
+ConcurrencyLimiter::Histogram ConcurrencyLimiter::inFlightCounts() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  updateHistograms();
+  return inFlightCounts_;
+}
+
+uint64_t ConcurrencyLimiter::droppedCount(size_t level) const {
+  std::lock_guard<std::mutex> g(mutex_);
+  updateHistograms();
+  return uint64_t(dropped_.sum(level));
+}
+
+uint64_t ConcurrencyLimiter::rejectedCount(size_t level) const {
+  std::lock_guard<std::mutex> g(mutex_);
+  updateHistograms();
+  return uint64_t(rejected_.sum(level));
+}
+
+} // namespace folly
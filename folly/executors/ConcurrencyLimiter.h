@@ -0,0 +1,264 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include <folly/CPortability.h>
+#include <folly/Optional.h>
+#include <folly/futures/Future.h>
+#include <folly/stats/TimeseriesHistogram.h>
+
+namespace folly {
+
+class FOLLY_EXPORT ConcurrencyLimitExceeded : public std::runtime_error {
+ public:
+  ConcurrencyLimitExceeded()
+      : std::runtime_error("Too many requests waiting for the limiter") {}
+};
+
+/// Limits the number of requests in flight, adapting the limit to the
+/// latency of the requests, as TCP congestion control adapts its window:
+/// while latency stays near what it is without load, the limit grows; once
+/// requests start queueing somewhere (in our executors, or a backend's), and
+/// latency with them, the limit shrinks.  Where Codel tells whether requests
+/// are already waiting too long, this keeps them from piling up in the first
+/// place, without having to pick a static limit, which is either too low
+/// and wastes capacity, or too high and lets the service melt under load.
+///
+/// The limit is computed by one of two algorithms:
+///
+///  - GRADIENT compares the latency of each request to its long-term
+///    average: the limit is multiplied by
+///    min(1, tolerance * average / latency), clamped to at least 0.5, and
+///    then grows by sqrt(limit) to probe for more capacity.
+///  - VEGAS estimates the requests queued as
+///    limit * (1 - minLatency / latency), where minLatency is the latency
+///    without load, and grows the limit while fewer than 3 * log10(limit)
+///    are, and shrinks it when more than 6 * log10(limit) are.
+///
+/// Both back off by backoffRatio for each request that was DROPPED (e.g.
+/// timed out, or was rejected by the backend), and don't grow the limit
+/// while less than half of it is in use.
+///
+/// Each request in flight holds a Token:
+///
+///   if (auto token = limiter.tryAcquire()) {
+///     handle(request);
+///     token->release(ConcurrencyLimiter::Outcome::SUCCESS);
+///   } else {
+///     reject(request);
+///   }
+///
+/// or waits for one, in FIFO order:
+///
+///   limiter.acquire().then([](ConcurrencyLimiter::Token token) {
+///     return handle(request).ensure(
+///         [token = std::move(token)]() mutable { token.release(); });
+///   });
+///
+/// On a fiber, acquire().get() blocks the fiber rather than the thread.
+///
+/// Latency, limit and number of requests in flight go to
+/// TimeseriesHistograms over the last minute, 10 minutes, hour and all
+/// time, as in ExecutorTaskStatsHistograms.
+///
+/// Thread-safe.  tryAcquire() is lock-free while no one is waiting;
+/// releasing a token takes a lock to update the limit.
+class ConcurrencyLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Histogram = TimeseriesHistogram<int64_t>;
+
+  enum class Algorithm {
+    GRADIENT,
+    VEGAS,
+  };
+
+  enum class Outcome {
+    /// The request completed; its latency is a sample for the limit.
+    SUCCESS,
+    /// The request timed out or was rejected downstream, which means
+    /// overload: the limit backs off.
+    DROPPED,
+    /// The request failed in a way which says nothing about load (e.g. it
+    /// was invalid): the limit doesn't change.
+    IGNORED,
+  };
+
+  struct Options {
+    Algorithm algorithm{Algorithm::GRADIENT};
+    size_t initialLimit{20};
+    size_t minLimit{1};
+    size_t maxLimit{1000};
+    /// Limit *= backoffRatio for each DROPPED request.
+    double backoffRatio{0.9};
+    /// GRADIENT: how much latency may exceed its average before the limit
+    /// shrinks.
+    double tolerance{1.5};
+    /// GRADIENT: the fraction of each change of the limit that is applied,
+    /// to smooth out the noise of single requests.
+    double smoothing{0.2};
+    /// GRADIENT: the number of requests the average latency is over.
+    size_t longWindow{600};
+    /// VEGAS: minLatency is reset every that many requests, so that it
+    /// follows changes in the latency without load.
+    size_t probeInterval{1000};
+    /// acquire() fails with ConcurrencyLimitExceeded when that many
+    /// requests are already waiting.
+    size_t maxWaiters{std::numeric_limits<size_t>::max()};
+    /// Buckets of the latency histogram.
+    std::chrono::microseconds latencyBucket{std::chrono::milliseconds(1)};
+    std::chrono::microseconds maxLatency{std::chrono::seconds(1)};
+  };
+
+  /// A request in flight.  Releasing it, or destroying it without
+  /// releasing it (as Outcome::IGNORED), makes room for another.
+  class Token {
+   public:
+    Token() = default;
+    Token(Token&& other) noexcept
+        : limiter_(other.limiter_), start_(other.start_) {
+      other.limiter_ = nullptr;
+    }
+    Token& operator=(Token&& other) noexcept {
+      if (this != &other) {
+        release(Outcome::IGNORED);
+        limiter_ = other.limiter_;
+        start_ = other.start_;
+        other.limiter_ = nullptr;
+      }
+      return *this;
+    }
+    ~Token() {
+      release(Outcome::IGNORED);
+    }
+
+    /// Does nothing if the token was already released.
+    void release(Outcome outcome = Outcome::SUCCESS) {
+      if (limiter_) {
+        auto limiter = limiter_;
+        limiter_ = nullptr;
+        limiter->release(start_, outcome);
+      }
+    }
+
+    explicit operator bool() const {
+      return limiter_ != nullptr;
+    }
+
+   private:
+    friend class ConcurrencyLimiter;
+
+    Token(ConcurrencyLimiter* limiter, Clock::time_point start)
+        : limiter_(limiter), start_(start) {}
+
+    ConcurrencyLimiter* limiter_{nullptr};
+    Clock::time_point start_;
+  };
+
+  ConcurrencyLimiter() : ConcurrencyLimiter(Options()) {}
+  explicit ConcurrencyLimiter(Options options);
+
+  /// Fails the requests still waiting with BrokenPromise.  Tokens must not
+  /// outlive the limiter.
+  ~ConcurrencyLimiter();
+
+  ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+  ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+  /// A token if fewer than limit() requests are in flight, and none are
+  /// waiting in acquire().
+  Optional<Token> tryAcquire();
+
+  /// A token once fewer than limit() requests are in flight, or
+  /// ConcurrencyLimitExceeded if Options::maxWaiters are already waiting.
+  Future<Token> acquire();
+
+  /// Feeds the latency of a request to the algorithm, for callers that
+  /// limit requests themselves (or replay measurements); tokens do it when
+  /// released.
+  void addSample(
+      std::chrono::nanoseconds latency,
+      size_t inFlight,
+      Outcome outcome);
+
+  size_t limit() const {
+    return limit_.load(std::memory_order_relaxed);
+  }
+
+  size_t inFlight() const {
+    return inFlight_.load(std::memory_order_relaxed);
+  }
+
+  size_t numWaiters() const {
+    return numWaiters_.load(std::memory_order_relaxed);
+  }
+
+  /// Copies of the histograms, as of now: the latency of each SUCCESS
+  /// request, and the limit and number in flight when it was released.
+  Histogram latencyMicros() const;
+  Histogram limits() const;
+  Histogram inFlightCounts() const;
+
+  /// The number of DROPPED requests, and of requests turned away by
+  /// tryAcquire() or acquire().
+  uint64_t droppedCount(size_t level) const;
+  uint64_t rejectedCount(size_t level) const;
+
+ private:
+  bool tryAcquireSlot();
+  void release(Clock::time_point start, Outcome outcome);
+  void addSampleLocked(double latencyNs, size_t inFlight, Outcome outcome);
+  void updateGradient(double latencyNs, size_t inFlight);
+  void updateVegas(double latencyNs, size_t inFlight);
+  void updateHistograms() const;
+
+  // Moves slots freed by releases or a higher limit to waiters, which are
+  // returned so that their futures complete outside the lock
+  std::deque<Promise<Token>> popReadyWaitersLocked();
+
+  const Options options_;
+
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> inFlight_{0};
+  std::atomic<size_t> numWaiters_{0};
+
+  mutable std::mutex mutex_;
+  std::deque<Promise<Token>> waiters_;
+  // The limit, before rounding down to limit_
+  double estimate_;
+  // GRADIENT: the average latency, in ns
+  double averageLatency_{0};
+  // VEGAS: the minimum latency since the last probe, in ns
+  double minLatency_{0};
+  size_t samples_{0};
+  // Mutable as reading them first updates them to the current time
+  mutable Histogram latencyMicros_;
+  mutable Histogram limits_;
+  mutable Histogram inFlightCounts_;
+  mutable MultiLevelTimeSeries<int64_t> dropped_;
+  mutable MultiLevelTimeSeries<int64_t> rejected_;
+};
+
+} // namespace folly
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/EDFThreadPoolExecutor.h>
+
+#include <algorithm>
+
+namespace folly {
+
+namespace {
+
+bool tryDecrement(std::atomic<ssize_t>& counter) {
+  auto n = counter.load();
+  while (n > 0) {
+    if (counter.compare_exchange_weak(n, n - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+EDFThreadPoolExecutor::EDFThreadPoolExecutor(
+    size_t numThreads,
+    std::shared_ptr<ThreadFactory> threadFactory,
+    bool useCodel)
+    : ThreadPoolExecutor(numThreads, std::move(threadFactory)),
+      taskQueue_(0, false),
+      codel_(useCodel ? std::make_unique<Codel>() : nullptr) {
+  setNumThreads(numThreads);
+}
+
+EDFThreadPoolExecutor::~EDFThreadPoolExecutor() {
+  stop();
+  CHECK(threadsToStop_ == 0);
+
+  // Destroy the tasks that never ran
+  QueueEntry entry;
+  while (taskQueue_.tryPop(entry)) {
+    delete entry.task;
+  }
+}
+
+void EDFThreadPoolExecutor::add(Func func) {
+  add(std::move(func), std::chrono::milliseconds(0));
+}
+
+void EDFThreadPoolExecutor::add(
+    Func func,
+    std::chrono::milliseconds expiration,
+    Func expireCallback) {
+  auto task = std::make_unique<EDFTask>(
+      std::move(func), expiration, std::move(expireCallback));
+  auto deadline = expiration > std::chrono::milliseconds(0)
+      ? task->enqueueTime_ + expiration
+      : Clock::time_point::max();
+  enqueue(std::move(task), deadline);
+}
+
+void EDFThreadPoolExecutor::addWithDeadline(
+    Func func,
+    Clock::time_point deadline,
+    Func expireCallback) {
+  auto now = Clock::now();
+  auto timeLeft = deadline - now;
+  if (codel_ && timeLeft < codel_->getMinDelay()) {
+    // Every task queued during this interval waited longer than that
+    if (expireCallback) {
+      expireCallback();
+    }
+    return;
+  }
+  // Task expiration is in whole milliseconds; round up so that the task
+  // isn't expired before its deadline.
+  auto expiration = std::max(
+      std::chrono::milliseconds(1),
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          timeLeft + std::chrono::milliseconds(1) -
+          std::chrono::nanoseconds(1)));
+  auto task = std::make_unique<EDFTask>(
+      std::move(func), expiration, std::move(expireCallback));
+  enqueue(std::move(task), deadline);
+}
+
+void EDFThreadPoolExecutor::enqueue(
+    std::unique_ptr<EDFTask> task,
+    Clock::time_point deadline) {
+  if (hasTaskStatsCallbacks()) {
+    task->stats_.queueDepth = taskQueue_.size();
+  }
+  taskQueue_.push(QueueEntry{deadline, nextSeq_++, task.get()});
+  task.release();
+}
+
+void EDFThreadPoolExecutor::threadRun(ThreadPtr thread) {
+  this->threadPoolHook_.registerThread();
+
+  auto exit = [&] {
+    folly::RWSpinLock::WriteHolder w{&threadListLock_};
+    threadList_.remove(thread);
+    stoppedThreads_.add(thread);
+  };
+
+  thread->startupBaton.post();
+  while (true) {
+    QueueEntry entry;
+    taskQueue_.pop(entry);
+
+    if (UNLIKELY(entry.task == nullptr)) {
+      if (tryDecrement(threadsToStop_)) {
+        for (auto& o : observers_) {
+          o->threadStopped(thread.get());
+        }
+        exit();
+        return;
+      }
+      // left over from a stop(), whose threads didn't wait for their pill
+      continue;
+    }
+
+    std::unique_ptr<EDFTask> task(entry.task);
+    if (codel_) {
+      auto delay = Clock::now() - task->enqueueTime_;
+      if (codel_->overloaded(delay) &&
+          entry.deadline != Clock::time_point::max()) {
+        task->stats_.expired = true;
+      }
+    }
+    runTask(thread, std::move(*task));
+    task.reset();
+
+    if (UNLIKELY(threadsToStop_ > 0 && !isJoin_)) {
+      if (tryDecrement(threadsToStop_)) {
+        exit();
+        return;
+      }
+    }
+  }
+}
+
+void EDFThreadPoolExecutor::stopThreads(size_t n) {
+  threadsToStop_ += n;
+  for (size_t i = 0; i < n; i++) {
+    taskQueue_.push(QueueEntry{Clock::time_point::max(), nextSeq_++, nullptr});
+  }
+}
+
+// threadListLock_ is readlocked
+uint64_t EDFThreadPoolExecutor::getPendingTaskCountImpl(
+    const folly::RWSpinLock::ReadHolder&) {
+  return taskQueue_.size();
+}
+
+} // namespace folly
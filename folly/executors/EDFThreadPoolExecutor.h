@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include <folly/executors/Codel.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/experimental/FlatCombiningPriorityQueue.h>
+
+namespace folly {
+
+/**
+ * A thread pool for CPU bound tasks that runs tasks earliest deadline first
+ * (EDF), rather than in the order they were added.
+ *
+ * @note Tasks are kept in a FlatCombiningPriorityQueue (without a dedicated
+ * combiner thread), ordered by absolute deadline; tasks with the same
+ * deadline run in the order they were added. add(func) gives a task no
+ * deadline, which sorts after all others: such tasks only run when no task
+ * with a deadline is waiting, so they can starve under sustained load.
+ *
+ * @note A task whose deadline has passed by the time a thread takes it does
+ * not run. Its expire callback runs instead, if any, and its stats report it
+ * as expired, as for tasks added with an expiration to the other pools. An
+ * overloaded pool thus spends no CPU time on work nobody waits for anymore.
+ *
+ * @note With useCodel, the pool also feeds the time tasks spend queued to a
+ * Codel (see Codel.h). While Codel reports overload, tasks with a deadline
+ * are expired when they have been queued longer than Codel's slough timeout,
+ * even if their deadline hasn't passed yet. addWithDeadline() also rejects a
+ * task whose deadline is closer than the minimum queueing delay Codel saw in
+ * the current interval, by running its expire callback right away.
+ *
+ * @note stop() is best effort; join() runs all the tasks added before it,
+ * subject to their deadlines.
+ */
+class EDFThreadPoolExecutor : public ThreadPoolExecutor {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit EDFThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("EDFThreadPool"),
+      bool useCodel = false);
+
+  ~EDFThreadPoolExecutor() override;
+
+  // No deadline
+  void add(Func func) override;
+
+  // Deadline in expiration from now; no deadline if expiration is 0
+  void add(
+      Func func,
+      std::chrono::milliseconds expiration,
+      Func expireCallback = nullptr) override;
+
+  void addWithDeadline(
+      Func func,
+      Clock::time_point deadline,
+      Func expireCallback = nullptr);
+
+  // nullptr unless constructed with useCodel
+  Codel* getCodel() {
+    return codel_.get();
+  }
+
+ private:
+  struct EDFTask : public ThreadPoolExecutor::Task {
+    EDFTask(
+        Func&& f,
+        std::chrono::milliseconds expiration,
+        Func&& expireCallback)
+        : Task(std::move(f), expiration, std::move(expireCallback)) {}
+  };
+
+  struct QueueEntry {
+    Clock::time_point deadline;
+    uint64_t seq;
+    EDFTask* task; // nullptr for a poison pill
+  };
+
+  // std::priority_queue keeps the greatest element on top
+  struct LaterDeadline {
+    bool operator()(const QueueEntry& a, const QueueEntry& b) const {
+      return a.deadline != b.deadline ? a.deadline > b.deadline
+                                      : a.seq > b.seq;
+    }
+  };
+
+  using TaskQueue = FlatCombiningPriorityQueue<
+      QueueEntry,
+      std::priority_queue<QueueEntry, std::vector<QueueEntry>, LaterDeadline>>;
+
+  void threadRun(ThreadPtr thread) override;
+  void stopThreads(size_t n) override;
+  uint64_t getPendingTaskCountImpl(const RWSpinLock::ReadHolder&) override;
+
+  void enqueue(std::unique_ptr<EDFTask> task, Clock::time_point deadline);
+
+  TaskQueue taskQueue_;
+  std::atomic<uint64_t> nextSeq_{0};
+  std::unique_ptr<Codel> codel_;
+  std::atomic<ssize_t> threadsToStop_{0};
+};
+
+} // namespace folly
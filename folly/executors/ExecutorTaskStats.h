@@ -0,0 +1,45 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace folly {
+
+/*
+ * What an executor reports of each task it ran, to the callbacks subscribed
+ * with subscribeToTaskStats() (ThreadPoolExecutor and EventBase).
+ *
+ * The callbacks run in the thread that ran the task, right after it, so they
+ * should be quick.  Executors don't measure anything while nothing is
+ * subscribed.
+ */
+struct ExecutorTaskStats {
+  // The task expired before it could start, and didn't run
+  bool expired{false};
+  // From when the task was added to when it started
+  std::chrono::nanoseconds waitTime{0};
+  std::chrono::nanoseconds runTime{0};
+  // The tasks that were pending when this one was added
+  uint64_t queueDepth{0};
+};
+
+using ExecutorTaskStatsCallback = std::function<void(ExecutorTaskStats)>;
+
+} // namespace folly
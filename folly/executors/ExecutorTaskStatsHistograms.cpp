@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/ExecutorTaskStatsHistograms.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace folly {
+
+namespace {
+
+constexpr size_t kNumBuckets = 60;
+
+MultiLevelTimeSeries<int64_t> makeTimeSeries() {
+  return MultiLevelTimeSeries<int64_t>(
+      kNumBuckets,
+      {std::chrono::seconds(60),
+       std::chrono::seconds(600),
+       std::chrono::seconds(3600),
+       std::chrono::seconds(0)});
+}
+
+std::chrono::seconds now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::steady_clock::now().time_since_epoch());
+}
+
+int64_t toMicros(std::chrono::nanoseconds duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+} // namespace
+
+ExecutorTaskStatsHistograms::Histograms::Histograms(
+    std::chrono::microseconds timeBucket,
+    std::chrono::microseconds maxTime,
+    int64_t depthBucket,
+    int64_t maxDepth)
+    : waitTimeMicros(
+          timeBucket.count(),
+          0,
+          maxTime.count(),
+          makeTimeSeries()),
+      runTimeMicros(timeBucket.count(), 0, maxTime.count(), makeTimeSeries()),
+      queueDepth(depthBucket, 0, maxDepth, makeTimeSeries()),
+      expired(makeTimeSeries()) {}
+
+void ExecutorTaskStatsHistograms::Histograms::update() {
+  auto time = now();
+  waitTimeMicros.update(time);
+  runTimeMicros.update(time);
+  queueDepth.update(time);
+  expired.update(time);
+}
+
+ExecutorTaskStatsHistograms::ExecutorTaskStatsHistograms(
+    std::chrono::microseconds timeBucket,
+    std::chrono::microseconds maxTime,
+    int64_t depthBucket,
+    int64_t maxDepth)
+    : histograms_(std::make_shared<Synchronized<Histograms, std::mutex>>(
+          Histograms(timeBucket, maxTime, depthBucket, maxDepth))) {}
+
+void ExecutorTaskStatsHistograms::addTaskStats(const ExecutorTaskStats& stats) {
+  add(*histograms_, stats);
+}
+
+void ExecutorTaskStatsHistograms::add(
+    Synchronized<Histograms, std::mutex>& synchronized,
+    const ExecutorTaskStats& stats) {
+  auto time = now();
+  auto histograms = synchronized.lock();
+  if (stats.expired) {
+    histograms->expired.addValue(time, 1);
+    return;
+  }
+  histograms->waitTimeMicros.addValue(time, toMicros(stats.waitTime));
+  histograms->runTimeMicros.addValue(time, toMicros(stats.runTime));
+  histograms->queueDepth.addValue(
+      time, int64_t(std::min<uint64_t>(stats.queueDepth, INT64_MAX)));
+}
+
+ExecutorTaskStatsCallback ExecutorTaskStatsHistograms::callback() const {
+  auto histograms = histograms_;
+  return [histograms](ExecutorTaskStats stats) {
+    add(*histograms, stats);
+  };
+}
+
+ExecutorTaskStatsHistograms::Histogram
+ExecutorTaskStatsHistograms::waitTimeMicros() const {
+  auto histograms = histograms_->lock();
+  histograms->update();
+  return histograms->waitTimeMicros;
+}
+
+ExecutorTaskStatsHistograms::Histogram
+ExecutorTaskStatsHistograms::runTimeMicros() const {
+  auto histograms = histograms_->lock();
+  histograms->update();
+  return histograms->runTimeMicros;
+}
+
+ExecutorTaskStatsHistograms::Histogram
+ExecutorTaskStatsHistograms::queueDepth() const {
+  auto histograms = histograms_->lock();
+  histograms->update();
+  return histograms->queueDepth;
+}
+
+uint64_t ExecutorTaskStatsHistograms::expiredCount(size_t level) const {
+  auto histograms = histograms_->lock();
+  histograms->update();
+  return histograms->expired.count(level);
+}
+
+} // namespace folly
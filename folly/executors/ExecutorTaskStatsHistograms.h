@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <folly/Synchronized.h>
+#include <folly/executors/ExecutorTaskStats.h>
+#include <folly/stats/TimeseriesHistogram.h>
+
+namespace folly {
+
+/*
+ * Aggregates the task stats of one or more executors into histograms over
+ * the last minute, 10 minutes, hour and all time (levels 0 to 3):
+ *
+ *   ExecutorTaskStatsHistograms histograms;
+ *   pool.subscribeToTaskStats(histograms.callback());
+ *   ...
+ *   auto p99 = histograms.waitTimeMicros().getPercentileEstimate(0.99, 0);
+ *
+ * Values past the last bucket are counted in it.  The callbacks share the
+ * histograms with this object, so they stay valid after it is destroyed.
+ */
+class ExecutorTaskStatsHistograms {
+ public:
+  using Histogram = TimeseriesHistogram<int64_t>;
+
+  enum Level : size_t {
+    MINUTE = 0,
+    TEN_MINUTES = 1,
+    HOUR = 2,
+    ALL_TIME = 3,
+  };
+
+  explicit ExecutorTaskStatsHistograms(
+      std::chrono::microseconds timeBucket = std::chrono::milliseconds(1),
+      std::chrono::microseconds maxTime = std::chrono::seconds(1),
+      int64_t depthBucket = 16,
+      int64_t maxDepth = 4096);
+
+  /* Thread-safe. */
+  void addTaskStats(const ExecutorTaskStats& stats);
+
+  ExecutorTaskStatsCallback callback() const;
+
+  /*
+   * Copies of the histograms, as of now.  Expired tasks are only counted,
+   * in expiredCount(), since they never ran.
+   */
+  Histogram waitTimeMicros() const;
+  Histogram runTimeMicros() const;
+  Histogram queueDepth() const;
+  uint64_t expiredCount(size_t level) const;
+
+ private:
+  struct Histograms {
+    Histograms(
+        std::chrono::microseconds timeBucket,
+        std::chrono::microseconds maxTime,
+        int64_t depthBucket,
+        int64_t maxDepth);
+
+    void update();
+
+    Histogram waitTimeMicros;
+    Histogram runTimeMicros;
+    Histogram queueDepth;
+    MultiLevelTimeSeries<int64_t> expired;
+  };
+
+  static void add(
+      Synchronized<Histograms, std::mutex>& synchronized,
+      const ExecutorTaskStats& stats);
+
+  std::shared_ptr<Synchronized<Histograms, std::mutex>> histograms_;
+};
+
+} // namespace folly
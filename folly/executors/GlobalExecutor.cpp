@@ -18,6 +18,14 @@
 #include <folly/executors/IOExecutor.h>
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/InlineExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_bool(
+    folly_global_cpu_executor_per_core,
+    false,
+    "Make getCPUExecutor() default to a thread pool with a task queue per "
+    "core instead of an InlineExecutor");
 
 using namespace folly;
 
@@ -33,6 +41,17 @@ Singleton<std::shared_ptr<InlineExecutor>> globalInlineExecutor([] {
   return new std::shared_ptr<InlineExecutor>(
       std::make_shared<InlineExecutor>());
 });
+// default global CPU executor with --folly_global_cpu_executor_per_core
+Singleton<std::shared_ptr<WorkStealingThreadPoolExecutor>> globalPerCorePool(
+    [] {
+      auto const numCpus = size_t(sysconf(_SC_NPROCESSORS_ONLN));
+      return new std::shared_ptr<WorkStealingThreadPoolExecutor>(
+          std::make_shared<WorkStealingThreadPoolExecutor>(
+              numCpus,
+              std::make_shared<NamedThreadFactory>("GlobalCPUThreadPool"),
+              WorkStealingThreadPoolExecutor::kDefaultMaxQueueSize,
+              numCpus));
+    });
 
 // lock protecting global IO executor
 struct IOExecutorLock {};
@@ -88,6 +107,10 @@ void setExecutor(
 }
 
 std::shared_ptr<Executor> getCPUExecutor() {
+  if (FLAGS_folly_global_cpu_executor_per_core) {
+    return getExecutor(
+        globalCPUExecutor, globalPerCorePool, globalCPUExecutorLock);
+  }
   return getExecutor(
       globalCPUExecutor, globalInlineExecutor, globalCPUExecutorLock);
 }
@@ -26,6 +26,11 @@ namespace folly {
 // Retrieve the global Executor. If there is none, a default InlineExecutor
 // will be constructed and returned. This is named CPUExecutor to distinguish
 // it from IOExecutor below and to hint that it's intended for CPU-bound tasks.
+//
+// With --folly_global_cpu_executor_per_core the default is instead a
+// WorkStealingThreadPoolExecutor with one thread and one task queue per core:
+// tasks are queued on the submitting core's queue and idle threads take
+// from the others.
 std::shared_ptr<folly::Executor> getCPUExecutor();
 
 // Set an Executor to be the global Executor which will be returned by
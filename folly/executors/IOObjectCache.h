@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include <folly/ThreadLocal.h>
 #include <folly/executors/GlobalExecutor.h>
 #include <folly/io/async/EventBase.h>
@@ -50,12 +53,16 @@ class IOObjectCache {
     CHECK(factory_);
     auto eb = getIOExecutor()->getEventBase();
     CHECK(eb);
-    auto it = cache_->find(eb);
-    if (it == cache_->end()) {
-      auto p = cache_->insert(std::make_pair(eb, factory_(eb)));
-      it = p.first;
+    // There are only as many EventBases as IO threads, so a linear scan of
+    // a flat array beats a tree or a hash table.
+    auto& cache = *cache_;
+    for (const auto& entry : cache) {
+      if (entry.first == eb) {
+        return entry.second;
+      }
     }
-    return it->second;
+    cache.emplace_back(eb, factory_(eb));
+    return cache.back().second;
   };
 
   void setFactory(TFactory factory) {
@@ -63,7 +70,9 @@ class IOObjectCache {
   }
 
  private:
-  folly::ThreadLocal<std::map<folly::EventBase*, std::shared_ptr<T>>> cache_;
+  folly::ThreadLocal<
+      std::vector<std::pair<folly::EventBase*, std::shared_ptr<T>>>>
+      cache_;
   TFactory factory_;
 };
 
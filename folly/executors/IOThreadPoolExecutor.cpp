@@ -18,14 +18,16 @@
 
 #include <glog/logging.h>
 
+#include <folly/Random.h>
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/detail/MemoryIdler.h>
 
 namespace folly {
 
 using folly::detail::MemoryIdler;
 
-/* Class that will free jemalloc caches and madvise the stack away
- * if the event loop is unused for some period of time
+/* Class that will free jemalloc caches, run the thread's idle callbacks and
+ * madvise the stack away if the event loop is unused for some period of time
  */
 class MemoryIdlerTimeout : public AsyncTimeout, public EventBase::LoopCallback {
  public:
@@ -37,8 +39,7 @@ class MemoryIdlerTimeout : public AsyncTimeout, public EventBase::LoopCallback {
 
   void runLoopCallback() noexcept override {
     if (idled) {
-      MemoryIdler::flushLocalMallocCaches();
-      MemoryIdler::unmapUnusedStack(MemoryIdler::kDefaultStackToRetain);
+      MemoryIdler::releaseIdleMemory(MemoryIdler::kDefaultStackToRetain);
 
       idled = false;
     } else {
@@ -91,6 +92,9 @@ void IOThreadPoolExecutor::add(
   auto ioThread = pickThread();
 
   auto task = Task(std::move(func), expiration, std::move(expireCallback));
+  if (hasTaskStatsCallbacks()) {
+    task.stats_.queueDepth = ioThread->pendingTasks.load();
+  }
   auto wrappedFunc = [ ioThread, task = std::move(task) ]() mutable {
     runTask(ioThread, std::move(task));
     ioThread->pendingTasks--;
@@ -119,8 +123,59 @@ IOThreadPoolExecutor::pickThread() {
   if (n == 0) {
     return me;
   }
-  auto thread = ths[nextThread_.fetch_add(1, std::memory_order_relaxed) % n];
-  return std::static_pointer_cast<IOThread>(thread);
+  return std::static_pointer_cast<IOThread>(ths[pickThreadIndex(ths)]);
+}
+
+size_t IOThreadPoolExecutor::pickThreadIndex(
+    const std::vector<ThreadPtr>& ths) {
+  auto const n = ths.size();
+  auto ioThread = [&](size_t i) {
+    return static_cast<IOThread*>(ths[i].get());
+  };
+  switch (getThreadSelection()) {
+    case ThreadSelection::ROUND_ROBIN:
+      break;
+    case ThreadSelection::LEAST_PENDING_TASKS: {
+      // Start the scan at the round robin position so that ties rotate
+      auto const start = nextThread_.fetch_add(1, std::memory_order_relaxed);
+      size_t best = start % n;
+      auto bestPending = ioThread(best)->pendingTasks.load();
+      for (size_t k = 1; k < n && bestPending > 0; ++k) {
+        auto const i = (start + k) % n;
+        auto const pending = ioThread(i)->pendingTasks.load();
+        if (pending < bestPending) {
+          best = i;
+          bestPending = pending;
+        }
+      }
+      return best;
+    }
+    case ThreadSelection::POWER_OF_TWO_BUSY: {
+      if (n == 1) {
+        return 0;
+      }
+      auto const a = Random::rand32(uint32_t(n));
+      auto const b = (a + 1 + Random::rand32(uint32_t(n - 1))) % n;
+      auto const evbA = ioThread(a)->eventBase;
+      auto const evbB = ioThread(b)->eventBase;
+      if (!evbA || !evbB) {
+        break;
+      }
+      // Loops without time measurement report 0, leaving it to pendingTasks
+      auto const busyA = evbA->getBusyRatio();
+      auto const busyB = evbB->getBusyRatio();
+      if (busyA != busyB) {
+        return busyA < busyB ? a : b;
+      }
+      return ioThread(a)->pendingTasks.load() <=
+              ioThread(b)->pendingTasks.load()
+          ? a
+          : b;
+    }
+    case ThreadSelection::CPU_LOCAL:
+      return AccessSpreader<>::current(n);
+  }
+  return nextThread_.fetch_add(1, std::memory_order_relaxed) % n;
 }
 
 EventBase* IOThreadPoolExecutor::getEventBase() {
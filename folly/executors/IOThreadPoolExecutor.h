@@ -33,9 +33,9 @@ namespace folly {
  * we don't make any additional syscalls to wake up the loop,
  * just put the new task in the queue.
  * If any thread has been waiting for more than a few seconds,
- * its stack is madvised away. Currently however tasks are scheduled round
+ * its stack is madvised away. By default tasks are scheduled round
  * robin on the queues, so unless there is no work going on,
- * this isn't very effective.
+ * this isn't very effective; see ThreadSelection for alternatives.
  * Since there is one queue per thread, there is hardly any contention
  * on the queues - so a simple spinlock around an std::deque is used for
  * the tasks. There is no max queue size.
@@ -43,7 +43,7 @@ namespace folly {
  * have more IO threads than this, assuming they don't block.
  *
  * @note ::getEventBase() will return an EventBase you can schedule IO work on
- * directly, chosen round-robin.
+ * directly, chosen like the thread for add().
  *
  * @note N.B. For this thread pool, stop() behaves like join() because
  * outstanding tasks belong to the event base and will be executed upon its
@@ -51,6 +51,23 @@ namespace folly {
  */
 class IOThreadPoolExecutor : public ThreadPoolExecutor, public IOExecutor {
  public:
+  /**
+   * How add() and getEventBase() pick a thread when called from outside
+   * the pool (a pool thread always picks itself).
+   */
+  enum class ThreadSelection {
+    // Cycle through the threads
+    ROUND_ROBIN,
+    // The thread with the fewest tasks added through add() still queued
+    LEAST_PENDING_TASKS,
+    // The less busy one of two random threads, see
+    // EventBase::getBusyRatio(), with ties going to fewer pending tasks
+    POWER_OF_TWO_BUSY,
+    // A thread determined by the caller's CPU, see AccessSpreader, so that
+    // callers on the same CPU share a thread
+    CPU_LOCAL,
+  };
+
   explicit IOThreadPoolExecutor(
       size_t numThreads,
       std::shared_ptr<ThreadFactory> threadFactory =
@@ -72,6 +89,14 @@ class IOThreadPoolExecutor : public ThreadPoolExecutor, public IOExecutor {
 
   folly::EventBaseManager* getEventBaseManager();
 
+  void setThreadSelection(ThreadSelection selection) {
+    threadSelection_.store(selection, std::memory_order_relaxed);
+  }
+
+  ThreadSelection getThreadSelection() const {
+    return threadSelection_.load(std::memory_order_relaxed);
+  }
+
  private:
   struct FOLLY_ALIGN_TO_AVOID_FALSE_SHARING IOThread : public Thread {
     IOThread(IOThreadPoolExecutor* pool)
@@ -84,11 +109,13 @@ class IOThreadPoolExecutor : public ThreadPoolExecutor, public IOExecutor {
 
   ThreadPtr makeThread() override;
   std::shared_ptr<IOThread> pickThread();
+  size_t pickThreadIndex(const std::vector<ThreadPtr>& ths);
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
   uint64_t getPendingTaskCountImpl(const RWSpinLock::ReadHolder&) override;
 
   std::atomic<size_t> nextThread_;
+  std::atomic<ThreadSelection> threadSelection_{ThreadSelection::ROUND_ROBIN};
   folly::ThreadLocal<std::shared_ptr<IOThread>> thisThread_;
   folly::EventBaseManager* eventBaseManager_;
 };
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/NUMAThreadPoolExecutor.h>
+
+#include <algorithm>
+
+#include <folly/Portability.h>
+#include <folly/executors/thread_factory/AffinityThreadFactory.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+namespace {
+
+// The pool and node of the pool thread we're running on, if any
+FOLLY_TLS const void* currentExecutor = nullptr;
+FOLLY_TLS size_t currentExecutorNode = 0;
+
+// How many times an idle worker looks for tasks before going to sleep
+constexpr size_t kMaxSpins = 64;
+
+bool tryDecrement(std::atomic<ssize_t>& counter) {
+  auto n = counter.load();
+  while (n > 0) {
+    if (counter.compare_exchange_weak(n, n - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+const size_t NUMAThreadPoolExecutor::kDefaultMaxQueueSize = 1 << 14;
+
+NUMAThreadPoolExecutor::NUMAThreadPoolExecutor(
+    size_t numThreads,
+    std::shared_ptr<ThreadFactory> threadFactory,
+    size_t maxQueueSize,
+    bool pinThreads,
+    const CacheLocality& locality)
+    : ThreadPoolExecutor(numThreads, std::move(threadFactory)),
+      systemLocality_(&locality == &CacheLocality::system()),
+      pinThreads_(pinThreads) {
+  for (auto& cpus : AffinityThreadFactory::cpusByNode(locality)) {
+    nodes_.push_back(std::make_unique<Node>(std::move(cpus), maxQueueSize));
+  }
+  setNumThreads(numThreads);
+}
+
+NUMAThreadPoolExecutor::~NUMAThreadPoolExecutor() {
+  stop();
+  CHECK(threadsToStop_ == 0);
+
+  // Destroy the tasks that never ran
+  for (auto& node : nodes_) {
+    NUMATask* task;
+    while (node->queue.read(task)) {
+      delete task;
+    }
+  }
+}
+
+void NUMAThreadPoolExecutor::add(Func func) {
+  add(std::move(func), std::chrono::milliseconds(0));
+}
+
+void NUMAThreadPoolExecutor::add(
+    Func func,
+    std::chrono::milliseconds expiration,
+    Func expireCallback) {
+  enqueue(
+      currentNode(),
+      std::make_unique<NUMATask>(
+          std::move(func), expiration, std::move(expireCallback)));
+}
+
+void NUMAThreadPoolExecutor::addToNode(size_t node, Func func) {
+  enqueue(
+      node % nodes_.size(),
+      std::make_unique<NUMATask>(
+          std::move(func), std::chrono::milliseconds(0), nullptr));
+}
+
+size_t NUMAThreadPoolExecutor::currentNode() const {
+  if (currentExecutor == this) {
+    return currentExecutorNode;
+  }
+  if (nodes_.size() == 1 || !systemLocality_) {
+    return 0;
+  }
+  return AccessSpreader<>::current(nodes_.size());
+}
+
+void NUMAThreadPoolExecutor::enqueue(
+    size_t node,
+    std::unique_ptr<NUMATask> task) {
+  auto& queue = nodes_[node]->queue;
+  if (hasTaskStatsCallbacks()) {
+    task->stats_.queueDepth = size_t(std::max<ssize_t>(queue.size(), 0));
+  }
+  if (!queue.write(task.get())) {
+    throw QueueFullException(
+        "NUMAThreadPoolExecutor queue full, can't add item");
+  }
+  task.release();
+  wakeOne(node);
+}
+
+void NUMAThreadPoolExecutor::wakeOne(size_t node) {
+  // Pairs with the fence in waitForTask(): either we see the sleeper, or it
+  // sees the task we just added
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    auto& n = *nodes_[(node + i) % nodes_.size()];
+    auto sleepers = n.sleepers.load(std::memory_order_relaxed);
+    while (sleepers > 0) {
+      if (n.sleepers.compare_exchange_weak(sleepers, sleepers - 1)) {
+        n.sem.post();
+        return;
+      }
+    }
+  }
+}
+
+void NUMAThreadPoolExecutor::wakeAll() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (auto& node : nodes_) {
+    auto sleepers = node->sleepers.exchange(0);
+    if (sleepers > 0) {
+      node->sem.post(uint32_t(sleepers));
+    }
+  }
+}
+
+size_t NUMAThreadPoolExecutor::joinNode() {
+  std::lock_guard<std::mutex> g(nodesMutex_);
+  size_t best = 0;
+  for (size_t i = 1; i < nodes_.size(); ++i) {
+    if (nodes_[i]->numThreads < nodes_[best]->numThreads) {
+      best = i;
+    }
+  }
+  ++nodes_[best]->numThreads;
+  return best;
+}
+
+void NUMAThreadPoolExecutor::leaveNode(size_t node) {
+  std::lock_guard<std::mutex> g(nodesMutex_);
+  --nodes_[node]->numThreads;
+}
+
+NUMAThreadPoolExecutor::NUMATask* NUMAThreadPoolExecutor::takeTask(
+    size_t node) {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    NUMATask* task;
+    if (nodes_[(node + i) % nodes_.size()]->queue.read(task)) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+NUMAThreadPoolExecutor::NUMATask* NUMAThreadPoolExecutor::waitForTask(
+    size_t node) {
+  for (size_t i = 0; i < kMaxSpins; ++i) {
+    asm_volatile_pause();
+    if (auto task = takeTask(node)) {
+      return task;
+    }
+  }
+
+  auto& self = *nodes_[node];
+  self.sleepers.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto task = takeTask(node);
+  if (task || threadsToStop_ > 0) {
+    // Stop sleeping, unless a wakeup has already been claimed for us, in
+    // which case we have to consume it
+    auto n = self.sleepers.load();
+    while (n > 0) {
+      if (self.sleepers.compare_exchange_weak(n, n - 1)) {
+        return task;
+      }
+    }
+  }
+  self.sem.wait();
+  return task ? task : takeTask(node);
+}
+
+void NUMAThreadPoolExecutor::threadRun(ThreadPtr thread) {
+  this->threadPoolHook_.registerThread();
+
+  const size_t node = joinNode();
+  if (pinThreads_) {
+    AffinityThreadFactory::pinCurrentThread(nodes_[node]->cpus);
+  }
+  currentExecutor = this;
+  currentExecutorNode = node;
+  auto exit = [&] {
+    currentExecutor = nullptr;
+    leaveNode(node);
+    folly::RWSpinLock::WriteHolder w{&threadListLock_};
+    threadList_.remove(thread);
+    stoppedThreads_.add(thread);
+  };
+
+  thread->startupBaton.post();
+  while (true) {
+    auto task = takeTask(node);
+    if (!task) {
+      // In join(), threads only stop once there is nothing left to run
+      if (UNLIKELY(threadsToStop_ > 0) && tryDecrement(threadsToStop_)) {
+        for (auto& o : observers_) {
+          o->threadStopped(thread.get());
+        }
+        exit();
+        return;
+      }
+      task = waitForTask(node);
+      if (!task) {
+        continue;
+      }
+    }
+
+    std::unique_ptr<NUMATask> owned(task);
+    runTask(thread, std::move(*owned));
+    owned.reset();
+
+    if (UNLIKELY(threadsToStop_ > 0 && !isJoin_)) {
+      if (tryDecrement(threadsToStop_)) {
+        exit();
+        return;
+      }
+    }
+  }
+}
+
+void NUMAThreadPoolExecutor::stopThreads(size_t n) {
+  threadsToStop_ += n;
+  wakeAll();
+}
+
+// threadListLock_ is readlocked
+uint64_t NUMAThreadPoolExecutor::getPendingTaskCountImpl(
+    const folly::RWSpinLock::ReadHolder&) {
+  uint64_t count = 0;
+  for (auto& node : nodes_) {
+    count += uint64_t(std::max<ssize_t>(0, node->queue.sizeGuess()));
+  }
+  return count;
+}
+
+} // namespace folly
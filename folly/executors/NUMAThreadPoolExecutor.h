@@ -0,0 +1,123 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <folly/MPMCQueue.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/synchronization/LifoSem.h>
+
+namespace folly {
+
+/**
+ * A thread pool for CPU bound tasks with one queue per node, that runs tasks
+ * on the node they were added from when it can, so that the memory they
+ * allocate and touch stays local.
+ *
+ * @note Nodes are as in AffinityThreadFactory: the cpus sharing a last-level
+ * cache.  Threads are spread evenly over the nodes and pinned to the cpus of
+ * theirs (with pinThreads).  add() from a pool thread queues the task on the
+ * thread's node, add() from elsewhere on the node of the cpu the caller runs
+ * on; addToNode() picks the node explicitly.  A thread first takes tasks from
+ * its own node's queue, and only when that is empty from the other nodes', so
+ * tasks run remotely only when their node's threads are all busy.  Sleeping
+ * threads of the task's node are woken before the others.
+ *
+ * @note On a machine with a single node, this behaves like a
+ * CPUThreadPoolExecutor without priorities.
+ *
+ * @note Each node's queue throws when full (QueueFullException).  join()
+ * runs all outstanding tasks; stop() is best effort, as for the other pools,
+ * and tasks that didn't run are destroyed with the executor.
+ */
+class NUMAThreadPoolExecutor : public ThreadPoolExecutor {
+ public:
+  explicit NUMAThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("NUMAThreadPool"),
+      size_t maxQueueSize = kDefaultMaxQueueSize,
+      bool pinThreads = true,
+      const CacheLocality& locality = CacheLocality::system());
+
+  ~NUMAThreadPoolExecutor() override;
+
+  void add(Func func) override;
+  void add(
+      Func func,
+      std::chrono::milliseconds expiration,
+      Func expireCallback = nullptr) override;
+
+  // Queues func on node (modulo numNodes())
+  void addToNode(size_t node, Func func);
+
+  size_t numNodes() const {
+    return nodes_.size();
+  }
+
+  static const size_t kDefaultMaxQueueSize;
+
+ private:
+  struct NUMATask : public ThreadPoolExecutor::Task {
+    NUMATask(Func&& f, std::chrono::milliseconds expiration, Func&& expireCb)
+        : Task(std::move(f), expiration, std::move(expireCb)) {}
+  };
+
+  struct Node {
+    Node(std::vector<size_t> nodeCpus, size_t maxQueueSize)
+        : cpus(std::move(nodeCpus)), queue(maxQueueSize) {}
+
+    const std::vector<size_t> cpus;
+    MPMCQueue<NUMATask*> queue;
+    // Threads waiting on sem that nobody has claimed a wakeup for yet
+    std::atomic<size_t> sleepers{0};
+    LifoSem sem;
+    size_t numThreads{0}; // protected by nodesMutex_
+  };
+
+  void threadRun(ThreadPtr thread) override;
+  void stopThreads(size_t n) override;
+  uint64_t getPendingTaskCountImpl(const RWSpinLock::ReadHolder&) override;
+
+  size_t currentNode() const;
+  void enqueue(size_t node, std::unique_ptr<NUMATask> task);
+
+  size_t joinNode();
+  void leaveNode(size_t node);
+
+  // Own node first, then the others
+  NUMATask* takeTask(size_t node);
+  // Returns nullptr if woken up without a task, to stop
+  NUMATask* waitForTask(size_t node);
+  void wakeOne(size_t node);
+  void wakeAll();
+
+  // Whether nodes_ are the ones AccessSpreader knows about
+  const bool systemLocality_;
+  const bool pinThreads_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::mutex nodesMutex_;
+
+  std::atomic<ssize_t> threadsToStop_{0};
+};
+
+} // namespace folly
@@ -16,74 +16,142 @@
 
 #include "SerialExecutor.h"
 
-#include <mutex>
-#include <queue>
+#include <atomic>
 
 #include <glog/logging.h>
 
 #include <folly/ExceptionString.h>
+#include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
+#include <folly/concurrency/UnboundedQueue.h>
 
 namespace folly {
 
-class SerialExecutor::TaskQueueImpl {
+class SerialExecutor::TaskQueueImpl
+    : public std::enable_shared_from_this<TaskQueueImpl> {
  public:
-  void add(Func&& func) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    queue_.push(std::move(func));
+  explicit TaskQueueImpl(std::shared_ptr<folly::Executor> parent)
+      : parent_(std::move(parent)) {}
+
+  void add(Func&& func, Optional<int8_t> priority) {
+    queue_.enqueue(std::move(func));
+    // Whoever makes the queue non-empty dispatches the drain; until it
+    // empties the queue again, later tasks ride along. If dispatching a
+    // drain failed, the next add() takes over.
+    if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0 ||
+        (stalled_.load(std::memory_order_relaxed) &&
+         stalled_.exchange(false, std::memory_order_acq_rel))) {
+      try {
+        schedule(priority);
+      } catch (...) {
+        stalled_.store(true, std::memory_order_release);
+        throw;
+      }
+    }
   }
 
-  void run() {
-    std::unique_lock<std::mutex> lock(mutex_);
+ private:
+  // Tasks run per dispatch to the parent, before the drain yields to
+  // whatever else the parent has queued
+  static constexpr size_t kMaxBatch = 16;
+
+  struct Drain {
+    TaskQueueImpl* impl{nullptr};
+    bool rescheduled{false};
+  };
+
+  static Drain& currentDrain() {
+    static thread_local Drain drain;
+    return drain;
+  }
 
-    ++scheduled_;
+  void schedule(Optional<int8_t> priority) {
+    auto self = shared_from_this();
+    if (priority) {
+      parent_->addWithPriority(
+          [self, priority] { self->run(priority); }, *priority);
+    } else {
+      parent_->add([self] { self->run(none); });
+    }
+  }
 
-    if (scheduled_ > 1) {
+  void run(Optional<int8_t> priority) {
+    auto& drain = currentDrain();
+    if (drain.impl == this) {
+      // A parent that runs tasks inline calls back in from schedule(); let
+      // the outer run() carry on rather than recursing once per batch
+      drain.rescheduled = true;
       return;
     }
-
-    do {
-      DCHECK(!queue_.empty());
-      Func func = std::move(queue_.front());
-      queue_.pop();
-      lock.unlock();
-
+    auto const outer = drain;
+    drain.impl = this;
+    SCOPE_EXIT {
+      drain = outer;
+    };
+
+    while (true) {
+      for (size_t i = 0; i < kMaxBatch; ++i) {
+        runOne();
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          return;
+        }
+      }
+      drain.rescheduled = false;
       try {
-        func();
+        schedule(priority);
       } catch (std::exception const& ex) {
-        LOG(ERROR) << "SerialExecutor: func threw unhandled exception "
+        LOG(ERROR) << "SerialExecutor: failed to schedule a drain: "
                    << folly::exceptionStr(ex);
+        stalled_.store(true, std::memory_order_release);
+        return;
       } catch (...) {
-        LOG(ERROR) << "SerialExecutor: func threw unhandled non-exception "
-                      "object";
+        LOG(ERROR) << "SerialExecutor: failed to schedule a drain";
+        stalled_.store(true, std::memory_order_release);
+        return;
       }
+      if (!drain.rescheduled) {
+        return;
+      }
+    }
+  }
 
-      // Destroy the function (and the data it captures) before we acquire the
-      // lock again.
-      func = {};
-
-      lock.lock();
-      --scheduled_;
-    } while (scheduled_);
+  void runOne() {
+    Func func;
+    // Spins only if the producer that bumped pending_ hasn't finished
+    // enqueueing yet
+    queue_.dequeue(func);
+
+    try {
+      func();
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "SerialExecutor: func threw unhandled exception "
+                 << folly::exceptionStr(ex);
+    } catch (...) {
+      LOG(ERROR) << "SerialExecutor: func threw unhandled non-exception "
+                    "object";
+    }
   }
 
- private:
-  std::mutex mutex_;
-  std::size_t scheduled_{0};
-  std::queue<Func> queue_;
+  std::shared_ptr<folly::Executor> parent_;
+  // Tasks that were added but haven't finished running
+  std::atomic<size_t> pending_{0};
+  // Tasks are pending but no drain is scheduled, as the parent threw
+  std::atomic<bool> stalled_{false};
+  UMPSCQueue<Func, false, 4> queue_;
 };
 
+constexpr size_t SerialExecutor::TaskQueueImpl::kMaxBatch;
+
 SerialExecutor::SerialExecutor(std::shared_ptr<folly::Executor> parent)
-    : parent_(std::move(parent)),
-      taskQueueImpl_(std::make_shared<TaskQueueImpl>()) {}
+    : parent_(parent),
+      taskQueueImpl_(std::make_shared<TaskQueueImpl>(std::move(parent))) {}
 
 void SerialExecutor::add(Func func) {
-  taskQueueImpl_->add(std::move(func));
-  parent_->add([impl = taskQueueImpl_] { impl->run(); });
+  taskQueueImpl_->add(std::move(func), none);
 }
 
 void SerialExecutor::addWithPriority(Func func, int8_t priority) {
-  taskQueueImpl_->add(std::move(func));
-  parent_->addWithPriority([impl = taskQueueImpl_] { impl->run(); }, priority);
+  taskQueueImpl_->add(std::move(func), priority);
 }
 
 } // namespace folly
@@ -35,11 +35,15 @@ namespace folly {
  * in the parent executor, however strictly non-concurrently and in the order
  * they were added.
  *
- * SerialExecutor tries to schedule its tasks fairly. Every task submitted to
- * it results in one task submitted to the parent executor. Whenever the parent
- * executor executes one of those, one of the tasks submitted to SerialExecutor
- * is marked for execution, which means it will either be executed at once,
- * or if a task is currently being executed already, after that.
+ * Tasks are kept in a lock-free queue. Only a task that arrives while the
+ * SerialExecutor is idle submits a drain task to the parent executor; tasks
+ * added while that one is pending or running are picked up by it. To stay
+ * fair to the parent's other work, a drain runs at most a small batch of
+ * tasks and then submits a new drain for the rest.
+ *
+ * If the parent executor throws from add(), so does the add() of the
+ * SerialExecutor that submitted the drain; its task stays queued, and the
+ * next add() submits the drain instead.
  *
  * The SerialExecutor may be deleted at any time. All tasks that have been
  * submitted will still be executed with the same guarantees, as long as the
@@ -69,8 +73,9 @@ class SerialExecutor : public folly::Executor {
    * Since in-order execution of tasks submitted to SerialExecutor is
    * guaranteed, the priority given here does not necessarily reflect the
    * execution priority of the task submitted with this call to
-   * `addWithPriority`. The given priority is passed on to the parent executor
-   * for the execution of one of the SerialExecutor's tasks.
+   * `addWithPriority`. If this call submits a drain task to the parent
+   * executor, the given priority is used for it (and for the drains that
+   * continue it).
    */
   void addWithPriority(Func func, int8_t priority) override;
   uint8_t getNumPriorities() const override {
@@ -17,6 +17,7 @@
 #include <folly/executors/ThreadPoolExecutor.h>
 
 #include <folly/executors/GlobalThreadPoolList.h>
+#include <folly/tracing/StaticTracepoint.h>
 
 namespace folly {
 
@@ -49,8 +50,17 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   thread->idle = false;
   auto startTime = std::chrono::steady_clock::now();
   task.stats_.waitTime = startTime - task.enqueueTime_;
-  if (task.expiration_ > std::chrono::milliseconds(0) &&
-      task.stats_.waitTime >= task.expiration_) {
+  FOLLY_SDT(
+      folly,
+      thread_pool_executor_task_dequeue,
+      thread.get(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          task.stats_.waitTime)
+          .count());
+  // A pool may also have marked the task expired already, e.g. to shed load
+  if (task.stats_.expired ||
+      (task.expiration_ > std::chrono::milliseconds(0) &&
+       task.stats_.waitTime >= task.expiration_)) {
     task.stats_.expired = true;
     if (task.expireCallback_ != nullptr) {
       task.expireCallback_();
@@ -70,6 +80,10 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   }
   thread->idle = true;
   thread->lastActiveTime = std::chrono::steady_clock::now();
+  if (!thread->taskStatsCallbacks->hasCallbacks.load(
+          std::memory_order_relaxed)) {
+    return;
+  }
   thread->taskStatsCallbacks->callbackList.withRLock([&](auto& callbacks) {
     *thread->taskStatsCallbacks->inCallback = true;
     SCOPE_EXIT {
@@ -204,6 +218,7 @@ void ThreadPoolExecutor::subscribeToTaskStats(TaskStatsCallback cb) {
     throw std::runtime_error("cannot subscribe in task stats callback");
   }
   taskStatsCallbacks_->callbackList.wlock()->push_back(std::move(cb));
+  taskStatsCallbacks_->hasCallbacks.store(true, std::memory_order_relaxed);
 }
 
 void ThreadPoolExecutor::StoppedThreadQueue::add(
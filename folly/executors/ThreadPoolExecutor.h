@@ -19,12 +19,14 @@
 #include <folly/Executor.h>
 #include <folly/Memory.h>
 #include <folly/RWSpinLock.h>
+#include <folly/executors/ExecutorTaskStats.h>
 #include <folly/executors/GlobalThreadPoolList.h>
 #include <folly/executors/task_queue/LifoSemMPMCQueue.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/async/Request.h>
 
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <queue>
 
@@ -80,14 +82,8 @@ class ThreadPoolExecutor : public virtual folly::Executor {
   PoolStats getPoolStats();
   uint64_t getPendingTaskCount();
 
-  struct TaskStats {
-    TaskStats() : expired(false), waitTime(0), runTime(0) {}
-    bool expired;
-    std::chrono::nanoseconds waitTime;
-    std::chrono::nanoseconds runTime;
-  };
-
-  using TaskStatsCallback = std::function<void(TaskStats)>;
+  using TaskStats = ExecutorTaskStats;
+  using TaskStatsCallback = ExecutorTaskStatsCallback;
   void subscribeToTaskStats(TaskStatsCallback cb);
 
   /**
@@ -165,6 +161,12 @@ class ThreadPoolExecutor : public virtual folly::Executor {
 
   static void runTask(const ThreadPtr& thread, Task&& task);
 
+  // Whether anything is subscribed to the task stats, so that add() only
+  // measures the queue depth for them then
+  bool hasTaskStatsCallbacks() const {
+    return taskStatsCallbacks_->hasCallbacks.load(std::memory_order_relaxed);
+  }
+
   // The function that will be bound to pool threads. It must call
   // thread->startupBaton.post() when it's ready to consume work.
   virtual void threadRun(ThreadPtr thread) = 0;
@@ -255,6 +257,8 @@ class ThreadPoolExecutor : public virtual folly::Executor {
   struct TaskStatsCallbackRegistry {
     folly::ThreadLocal<bool> inCallback;
     folly::Synchronized<std::vector<TaskStatsCallback>> callbackList;
+    // Set once the first callback is subscribed
+    std::atomic<bool> hasCallbacks{false};
   };
   std::shared_ptr<TaskStatsCallbackRegistry> taskStatsCallbacks_;
   std::vector<std::shared_ptr<Observer>> observers_;
@@ -0,0 +1,342 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <algorithm>
+
+#include <folly/Portability.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+namespace {
+
+// The WorkerQueue of the pool thread we're running on, if any
+FOLLY_TLS void* currentWorkerQueue = nullptr;
+
+// How many times an idle worker looks for tasks before going to sleep
+constexpr size_t kMaxSpins = 64;
+
+uint32_t nextRandom(uint32_t& state) {
+  // xorshift32
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+bool tryDecrement(std::atomic<ssize_t>& counter) {
+  auto n = counter.load();
+  while (n > 0) {
+    if (counter.compare_exchange_weak(n, n - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+const size_t WorkStealingThreadPoolExecutor::kDefaultMaxQueueSize = 1 << 14;
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(
+    size_t numThreads,
+    std::shared_ptr<ThreadFactory> threadFactory,
+    size_t maxQueueSize,
+    size_t numInjectShards)
+    : ThreadPoolExecutor(numThreads, std::move(threadFactory)) {
+  numInjectShards = std::max<size_t>(numInjectShards, 1);
+  for (size_t i = 0; i < numInjectShards; ++i) {
+    injectQueues_.push_back(std::make_unique<MPMCQueue<WSTask*>>(
+        std::max<size_t>(maxQueueSize / numInjectShards, 1)));
+  }
+  queueLists_.push_back(std::make_unique<std::vector<WorkerQueue*>>());
+  queues_.store(queueLists_.back().get());
+  setNumThreads(numThreads);
+}
+
+WorkStealingThreadPoolExecutor::~WorkStealingThreadPoolExecutor() {
+  stop();
+  CHECK(threadsToStop_ == 0);
+
+  // Destroy the tasks that never ran
+  WSTask* task;
+  for (auto& injectQueue : injectQueues_) {
+    while (injectQueue->read(task)) {
+      if (task != poison()) {
+        delete task;
+      }
+    }
+  }
+  for (auto& queue : ownedQueues_) {
+    while ((task = queue->deque.pop()) != nullptr) {
+      delete task;
+    }
+  }
+}
+
+void WorkStealingThreadPoolExecutor::add(Func func) {
+  add(std::move(func), std::chrono::milliseconds(0));
+}
+
+void WorkStealingThreadPoolExecutor::add(
+    Func func,
+    std::chrono::milliseconds expiration,
+    Func expireCallback) {
+  auto task = std::make_unique<WSTask>(
+      std::move(func), expiration, std::move(expireCallback));
+  auto self = static_cast<WorkerQueue*>(currentWorkerQueue);
+  bool local = self && self->executor == this;
+  if (hasTaskStatsCallbacks()) {
+    // The depth of the queue the task goes to
+    auto& injectQueue =
+        *injectQueues_[AccessSpreader<>::current(injectQueues_.size())];
+    task->stats_.queueDepth = local
+        ? self->deque.size()
+        : size_t(std::max<ssize_t>(injectQueue.size(), 0));
+  }
+  if (local) {
+    self->deque.push(task.release());
+  } else if (inject(task.get())) {
+    task.release();
+  } else {
+    throw QueueFullException(
+        "WorkStealingThreadPoolExecutor queue full, can't add item");
+  }
+  wakeOne();
+}
+
+bool WorkStealingThreadPoolExecutor::inject(WSTask* task) {
+  const size_t n = injectQueues_.size();
+  const size_t start = n == 1 ? 0 : AccessSpreader<>::current(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (injectQueues_[(start + i) % n]->write(task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+WorkStealingThreadPoolExecutor::WSTask*
+WorkStealingThreadPoolExecutor::takeInjected(WorkerQueue* self) {
+  const size_t n = injectQueues_.size();
+  WSTask* task;
+  for (size_t i = 0; i < n; ++i) {
+    if (injectQueues_[(self->homeShard + i) % n]->read(task)) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void WorkStealingThreadPoolExecutor::wakeOne() {
+  // Pairs with the fence in waitForTask(): either we see the sleeper, or it
+  // sees the task we just added
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto n = sleepers_.load(std::memory_order_relaxed);
+  while (n > 0) {
+    if (sleepers_.compare_exchange_weak(n, n - 1)) {
+      sem_.post();
+      return;
+    }
+  }
+}
+
+WorkStealingThreadPoolExecutor::WorkerQueue*
+WorkStealingThreadPoolExecutor::acquireQueue() {
+  std::lock_guard<std::mutex> g(queuesMutex_);
+  for (auto& queue : ownedQueues_) {
+    if (!queue->inUse) {
+      queue->inUse = true;
+      return queue.get();
+    }
+  }
+
+  ownedQueues_.push_back(std::make_unique<WorkerQueue>(this));
+  auto queue = ownedQueues_.back().get();
+  queue->homeShard = (ownedQueues_.size() - 1) % injectQueues_.size();
+  queue->inUse = true;
+  auto list = std::make_unique<std::vector<WorkerQueue*>>(
+      *queues_.load(std::memory_order_relaxed));
+  list->push_back(queue);
+  queues_.store(list.get(), std::memory_order_release);
+  queueLists_.push_back(std::move(list));
+  return queue;
+}
+
+void WorkStealingThreadPoolExecutor::releaseQueue(WorkerQueue* queue) {
+  {
+    std::lock_guard<std::mutex> g(queuesMutex_);
+    queue->inUse = false;
+  }
+  if (!queue->deque.empty()) {
+    // someone has to steal them
+    wakeOne();
+  }
+}
+
+WorkStealingThreadPoolExecutor::WSTask*
+WorkStealingThreadPoolExecutor::takeTask(WorkerQueue* self, uint32_t& rng) {
+  if (auto task = self->deque.pop()) {
+    return task;
+  }
+  if (auto task = takeInjected(self)) {
+    return task;
+  }
+  return stealTask(self, rng);
+}
+
+WorkStealingThreadPoolExecutor::WSTask*
+WorkStealingThreadPoolExecutor::stealTask(WorkerQueue* self, uint32_t& rng) {
+  auto& queues = *queues_.load(std::memory_order_acquire);
+  const size_t n = queues.size();
+  bool retry;
+  do {
+    retry = false;
+    const size_t start = nextRandom(rng) % n;
+    for (size_t i = 0; i < n; ++i) {
+      auto queue = queues[(start + i) % n];
+      if (queue == self) {
+        continue;
+      }
+      WSTask* task;
+      switch (queue->deque.steal(task)) {
+        case ChaseLevDeque<WSTask>::StealResult::SUCCESS:
+          return task;
+        case ChaseLevDeque<WSTask>::StealResult::ABORT:
+          retry = true;
+          break;
+        case ChaseLevDeque<WSTask>::StealResult::EMPTY:
+          break;
+      }
+    }
+  } while (retry);
+  return nullptr;
+}
+
+WorkStealingThreadPoolExecutor::WSTask*
+WorkStealingThreadPoolExecutor::waitForTask(
+    WorkerQueue* self,
+    uint32_t& rng) {
+  for (size_t i = 0; i < kMaxSpins; ++i) {
+    asm_volatile_pause();
+    if (auto task = takeTask(self, rng)) {
+      return task;
+    }
+  }
+
+  while (true) {
+    sleepers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (auto task = takeTask(self, rng)) {
+      // Stop sleeping, unless a wakeup has already been claimed for us, in
+      // which case we have to consume it
+      auto n = sleepers_.load();
+      while (n > 0) {
+        if (sleepers_.compare_exchange_weak(n, n - 1)) {
+          return task;
+        }
+      }
+      sem_.wait();
+      return task;
+    }
+    sem_.wait();
+    if (auto task = takeTask(self, rng)) {
+      return task;
+    }
+  }
+}
+
+void WorkStealingThreadPoolExecutor::threadRun(ThreadPtr thread) {
+  this->threadPoolHook_.registerThread();
+
+  auto self = acquireQueue();
+  currentWorkerQueue = self;
+  auto exit = [&] {
+    currentWorkerQueue = nullptr;
+    releaseQueue(self);
+    folly::RWSpinLock::WriteHolder w{&threadListLock_};
+    threadList_.remove(thread);
+    stoppedThreads_.add(thread);
+  };
+
+  uint32_t rng = uint32_t(thread->id * 2654435761u) | 1;
+  thread->startupBaton.post();
+  while (true) {
+    auto task = takeTask(self, rng);
+    if (!task) {
+      task = waitForTask(self, rng);
+    }
+
+    if (UNLIKELY(task == poison())) {
+      if (threadsToStop_ <= 0) {
+        // left over from a stop(), whose threads didn't wait for their pill
+        continue;
+      }
+      // Other workers' tasks must run before the last thread exits in
+      // join(); keep the pill for later if there are any
+      WSTask* stolen = isJoin_ ? stealTask(self, rng) : nullptr;
+      if (stolen) {
+        injectQueues_[self->homeShard]->blockingWrite(poison());
+        task = stolen;
+      } else if (tryDecrement(threadsToStop_)) {
+        for (auto& o : observers_) {
+          o->threadStopped(thread.get());
+        }
+        exit();
+        return;
+      } else {
+        continue;
+      }
+    }
+
+    std::unique_ptr<WSTask> owned(task);
+    runTask(thread, std::move(*owned));
+    owned.reset();
+
+    if (UNLIKELY(threadsToStop_ > 0 && !isJoin_)) {
+      if (tryDecrement(threadsToStop_)) {
+        exit();
+        return;
+      }
+    }
+  }
+}
+
+void WorkStealingThreadPoolExecutor::stopThreads(size_t n) {
+  threadsToStop_ += n;
+  for (size_t i = 0; i < n; i++) {
+    injectQueues_[i % injectQueues_.size()]->blockingWrite(poison());
+    wakeOne();
+  }
+}
+
+// threadListLock_ is readlocked
+uint64_t WorkStealingThreadPoolExecutor::getPendingTaskCountImpl(
+    const folly::RWSpinLock::ReadHolder&) {
+  uint64_t count = 0;
+  for (auto& injectQueue : injectQueues_) {
+    count += uint64_t(std::max<ssize_t>(0, injectQueue->sizeGuess()));
+  }
+  for (auto queue : *queues_.load(std::memory_order_acquire)) {
+    count += queue->deque.size();
+  }
+  return count;
+}
+
+} // namespace folly
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <folly/MPMCQueue.h>
+#include <folly/concurrency/ChaseLevDeque.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/synchronization/LifoSem.h>
+
+namespace folly {
+
+/**
+ * A thread pool for CPU bound tasks where each worker thread has its own
+ * queue.
+ *
+ * @note Tasks added from one of the pool's own threads go to the bottom of
+ * that thread's ChaseLevDeque, and are run from there LIFO, so fork/join
+ * style workloads (tasks that spawn more tasks) touch no shared state on the
+ * fast path.  Tasks added from other threads go to a shared MPMC queue, like
+ * in CPUThreadPoolExecutor.  A worker that runs out of tasks first takes
+ * from the shared queue, then steals the oldest task from the other workers'
+ * deques, starting at a random one, before going to sleep.
+ *
+ * @note With numInjectShards > 1 the shared queue is split into that many
+ * queues; tasks added from outside go to the one for the submitting CPU
+ * (see AccessSpreader), and every worker has a home shard it takes from
+ * first before trying the others.  This removes the contention on a single
+ * queue when many threads add concurrently.
+ *
+ * @note Compared to CPUThreadPoolExecutor there is no global FIFO order and
+ * no priorities.  Use it when tasks are small and many of them are added
+ * from within the pool.
+ *
+ * @note The shared queue throws when full (QueueFullException), so add()
+ * from outside the pool can fail.  Adding from within the pool never fails.
+ *
+ * @note join() runs all outstanding tasks, including the ones they add.
+ * stop() is best effort, as for the other pools; tasks that didn't run are
+ * destroyed with the executor.
+ */
+class WorkStealingThreadPoolExecutor : public ThreadPoolExecutor {
+ public:
+  explicit WorkStealingThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("WorkStealingPool"),
+      size_t maxQueueSize = kDefaultMaxQueueSize,
+      size_t numInjectShards = 1);
+
+  ~WorkStealingThreadPoolExecutor() override;
+
+  void add(Func func) override;
+  void add(
+      Func func,
+      std::chrono::milliseconds expiration,
+      Func expireCallback = nullptr) override;
+
+  static const size_t kDefaultMaxQueueSize;
+
+ private:
+  struct WSTask : public ThreadPoolExecutor::Task {
+    WSTask(Func&& f, std::chrono::milliseconds expiration, Func&& expireCb)
+        : Task(std::move(f), expiration, std::move(expireCb)) {}
+  };
+
+  // A worker thread's deque.  Deques are never freed before the executor,
+  // since thieves may be using them; a thread that stops releases its deque
+  // (with any remaining tasks, still available to thieves) to the next
+  // thread that starts.
+  struct WorkerQueue {
+    explicit WorkerQueue(WorkStealingThreadPoolExecutor* e) : executor(e) {}
+
+    WorkStealingThreadPoolExecutor* const executor;
+    ChaseLevDeque<WSTask> deque;
+    size_t homeShard{0};
+    bool inUse{false}; // protected by queuesMutex_
+  };
+
+  void threadRun(ThreadPtr thread) override;
+  void stopThreads(size_t n) override;
+  uint64_t getPendingTaskCountImpl(const RWSpinLock::ReadHolder&) override;
+
+  WorkerQueue* acquireQueue();
+  void releaseQueue(WorkerQueue* queue);
+
+  // These return poison() for a poison pill, and nullptr if there was
+  // nothing to take
+  WSTask* takeTask(WorkerQueue* self, uint32_t& rng);
+  WSTask* stealTask(WorkerQueue* self, uint32_t& rng);
+  WSTask* waitForTask(WorkerQueue* self, uint32_t& rng);
+  void wakeOne();
+
+  // Adds to the submitting CPU's shard, or any other one if that is full
+  bool inject(WSTask* task);
+  WSTask* takeInjected(WorkerQueue* self);
+
+  static WSTask* poison() {
+    return reinterpret_cast<WSTask*>(1);
+  }
+
+  // Tasks added from outside the pool, and poison pills, split into
+  // numInjectShards queues of maxQueueSize / numInjectShards entries
+  std::vector<std::unique_ptr<MPMCQueue<WSTask*>>> injectQueues_;
+
+  // Every deque ever created, the published vector is replaced (never
+  // modified) when a deque is added.  Old vectors are kept until
+  // destruction.
+  std::atomic<const std::vector<WorkerQueue*>*> queues_;
+  std::mutex queuesMutex_;
+  std::vector<std::unique_ptr<WorkerQueue>> ownedQueues_;
+  std::vector<std::unique_ptr<const std::vector<WorkerQueue*>>> queueLists_;
+
+  // Threads waiting on sem_ that nobody has claimed a wakeup for yet
+  std::atomic<size_t> sleepers_{0};
+  LifoSem sem_;
+
+  std::atomic<ssize_t> threadsToStop_{0};
+};
+
+} // namespace folly
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/concurrency/DynamicBoundedQueue.h>
+#include <folly/executors/task_queue/BlockingQueue.h>
+#include <folly/synchronization/LifoSem.h>
+
+namespace folly {
+
+// A queue bounded by the total weight of its items (by default their
+// number), with a capacity that can be changed while it's in use, e.g. for
+// a CPUThreadPoolExecutor:
+//
+//   CPUThreadPoolExecutor pool(
+//       numThreads,
+//       std::make_unique<DynamicBoundedBlockingQueue<
+//           CPUThreadPoolExecutor::CPUTask>>(capacity));
+template <
+    class T,
+    QueueBehaviorIfFull kBehavior = QueueBehaviorIfFull::THROW,
+    class WeightFn = DefaultWeightFn<T>>
+class DynamicBoundedBlockingQueue : public BlockingQueue<T> {
+ public:
+  explicit DynamicBoundedBlockingQueue(
+      uint64_t capacity,
+      WeightFn weightFn = WeightFn())
+      : queue_(capacity, std::move(weightFn)) {}
+
+  void add(T item) override {
+    switch (kBehavior) { // static
+      case QueueBehaviorIfFull::THROW:
+        if (!queue_.try_enqueue(std::move(item))) {
+          throw QueueFullException(
+              "DynamicBoundedBlockingQueue full, can't add item");
+        }
+        break;
+      case QueueBehaviorIfFull::BLOCK:
+        queue_.enqueue(std::move(item));
+        break;
+    }
+    sem_.post();
+  }
+
+  T take() override {
+    sem_.wait();
+    return queue_.dequeue();
+  }
+
+  size_t size() override {
+    return queue_.size();
+  }
+
+  uint64_t capacity() {
+    return queue_.capacity();
+  }
+
+  void setCapacity(uint64_t capacity) {
+    queue_.reset_capacity(capacity);
+  }
+
+ private:
+  LifoSem sem_;
+  // May block, for producers waiting for room
+  DMPMCQueue<T, true, 8, WeightFn> queue_;
+};
+
+} // namespace folly
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <folly/Executor.h>
+#include <folly/concurrency/MultiQueue.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/task_queue/BlockingQueue.h>
+#include <folly/synchronization/LifoSem.h>
+
+namespace folly {
+
+// An unbounded priority queue for executors with many threads, where the
+// single set of queues of PriorityLifoSemMPMCQueue becomes a bottleneck.
+// Tasks are kept in a MultiQueue, so take() returns one of the
+// highest-priority tasks, but not always the highest one, and tasks of
+// the same priority are only roughly FIFO.
+//
+// The lowest priority level is the exception: it is strictly FIFO and
+// only taken once all higher levels look empty.  CPUThreadPoolExecutor
+// stops threads by adding LO_PRI tasks, which must not overtake tasks
+// queued before them.
+template <class T>
+class RelaxedPriorityBlockingQueue : public BlockingQueue<T> {
+ public:
+  // As in PriorityLifoSemMPMCQueue, folly::Executor::*_PRI are relative
+  // to the middle level and clamped to [0, numPriorities)
+  explicit RelaxedPriorityBlockingQueue(
+      uint8_t numPriorities = 3,
+      size_t numShards = 4 *
+          std::max(1u, std::thread::hardware_concurrency()))
+      : numPriorities_(numPriorities), queue_(numShards) {
+    CHECK_GT(numPriorities, 0);
+  }
+
+  uint8_t getNumPriorities() override {
+    return numPriorities_;
+  }
+
+  // Add at medium priority by default
+  void add(T item) override {
+    addWithPriority(std::move(item), folly::Executor::MID_PRI);
+  }
+
+  void addWithPriority(T item, int8_t priority) override {
+    int mid = numPriorities_ / 2;
+    int level = priority < 0 ? std::max(0, mid + priority)
+                             : std::min(numPriorities_ - 1, mid + priority);
+    if (level == 0) {
+      lowest_.enqueue(std::move(item));
+    } else {
+      queue_.push(std::move(item), level);
+    }
+    sem_.post();
+  }
+
+  T take() override {
+    sem_.wait();
+    // The semaphore reserved an element for us, it just may not be
+    // visible to the first attempt yet
+    T item;
+    while (!tryTake(item)) {
+    }
+    return item;
+  }
+
+  size_t size() override {
+    return queue_.size() + lowest_.size();
+  }
+
+ private:
+  bool tryTake(T& item) {
+    return queue_.tryPop(item) || lowest_.try_dequeue(item);
+  }
+
+  const int numPriorities_;
+  LifoSem sem_;
+  MultiQueue<T, int> queue_;
+  UMPMCQueue<T, false> lowest_;
+};
+
+} // namespace folly
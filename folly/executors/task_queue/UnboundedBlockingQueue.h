@@ -16,49 +16,36 @@
 
 #pragma once
 
-#include <folly/Synchronized.h>
+#include <folly/concurrency/UnboundedQueue.h>
 #include <folly/executors/task_queue/BlockingQueue.h>
 #include <folly/synchronization/LifoSem.h>
-#include <queue>
 
 namespace folly {
 
-// Warning: this is effectively just a std::deque wrapped in a single mutex
-// We are aiming to add a more performant concurrent unbounded queue in the
-// future, but this class is available if you must have an unbounded queue
-// and can tolerate any contention.
+// An unbounded MPMC queue: each take() first waits on the semaphore for an
+// element to be added, so the queue itself never has to block
 template <class T>
 class UnboundedBlockingQueue : public BlockingQueue<T> {
  public:
   virtual ~UnboundedBlockingQueue() {}
 
   void add(T item) override {
-    queue_.wlock()->push(std::move(item));
+    queue_.enqueue(std::move(item));
     sem_.post();
   }
 
   T take() override {
-    while (true) {
-      {
-        auto ulockedQueue = queue_.ulock();
-        if (!ulockedQueue->empty()) {
-          auto wlockedQueue = ulockedQueue.moveFromUpgradeToWrite();
-          T item = std::move(wlockedQueue->front());
-          wlockedQueue->pop();
-          return item;
-        }
-      }
-      sem_.wait();
-    }
+    sem_.wait();
+    return queue_.dequeue();
   }
 
   size_t size() override {
-    return queue_.rlock()->size();
+    return queue_.size();
   }
 
  private:
   LifoSem sem_;
-  Synchronized<std::queue<T>> queue_;
+  UMPMCQueue<T, false> queue_;
 };
 
 } // namespace folly
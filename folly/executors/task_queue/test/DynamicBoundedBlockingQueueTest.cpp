@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/task_queue/DynamicBoundedBlockingQueue.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+#include <atomic>
+#include <thread>
+
+using namespace folly;
+
+TEST(DynamicBoundedBlockingQueue, push_pop) {
+  DynamicBoundedBlockingQueue<int> q(1);
+  q.add(42);
+  EXPECT_EQ(42, q.take());
+}
+
+TEST(DynamicBoundedBlockingQueue, full) {
+  DynamicBoundedBlockingQueue<int> q(1);
+  q.add(1);
+  EXPECT_THROW(q.add(2), QueueFullException);
+  EXPECT_EQ(1, q.size());
+
+  q.setCapacity(2);
+  EXPECT_EQ(2, q.capacity());
+  q.add(2);
+  EXPECT_EQ(1, q.take());
+  EXPECT_EQ(2, q.take());
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(DynamicBoundedBlockingQueue, block) {
+  DynamicBoundedBlockingQueue<int, QueueBehaviorIfFull::BLOCK> q(1);
+  q.add(1);
+  std::atomic<bool> added{false};
+  std::thread t([&] {
+    q.add(2);
+    added = true;
+  });
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(added);
+  EXPECT_EQ(1, q.take());
+  EXPECT_EQ(2, q.take());
+  t.join();
+  EXPECT_TRUE(added);
+}
+
+TEST(DynamicBoundedBlockingQueue, CPUThreadPoolExecutor) {
+  std::atomic<int> c{0};
+  CPUThreadPoolExecutor pool(
+      2,
+      std::make_unique<DynamicBoundedBlockingQueue<
+          CPUThreadPoolExecutor::CPUTask,
+          QueueBehaviorIfFull::BLOCK>>(16),
+      std::make_shared<NamedThreadFactory>("CPUThreadPool"));
+  for (int i = 0; i < 1000; i++) {
+    pool.add([&] { c++; });
+  }
+  pool.join();
+  EXPECT_EQ(1000, c);
+}
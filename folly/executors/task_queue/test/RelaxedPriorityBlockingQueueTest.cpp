@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/executors/task_queue/RelaxedPriorityBlockingQueue.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(RelaxedPriorityBlockingQueue, Priorities) {
+  RelaxedPriorityBlockingQueue<int> q(3, 2);
+  EXPECT_EQ(3, q.getNumPriorities());
+  q.addWithPriority(0, Executor::LO_PRI);
+  q.addWithPriority(1, Executor::MID_PRI);
+  q.addWithPriority(2, Executor::HI_PRI);
+  EXPECT_EQ(3, q.size());
+  // Two shards, two levels above the lowest: the best of both always wins
+  EXPECT_EQ(2, q.take());
+  EXPECT_EQ(1, q.take());
+  EXPECT_EQ(0, q.take());
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(RelaxedPriorityBlockingQueue, LowestIsFifoAndLast) {
+  RelaxedPriorityBlockingQueue<int> q(2);
+  for (int i = 0; i < 100; ++i) {
+    q.addWithPriority(i, Executor::LO_PRI);
+  }
+  for (int i = 100; i < 200; ++i) {
+    q.add(i);
+  }
+  std::vector<bool> seen(100);
+  for (int i = 0; i < 100; ++i) {
+    auto v = q.take();
+    ASSERT_GE(v, 100);
+    EXPECT_FALSE(seen[v - 100]);
+    seen[v - 100] = true;
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, q.take());
+  }
+}
+
+TEST(RelaxedPriorityBlockingQueue, ExecutorJoinRunsEverything) {
+  std::atomic<int> ran{0};
+  {
+    CPUThreadPoolExecutor executor(
+        4,
+        std::make_unique<RelaxedPriorityBlockingQueue<
+            CPUThreadPoolExecutor::CPUTask>>());
+    for (int i = 0; i < 10000; ++i) {
+      executor.addWithPriority([&] { ++ran; }, int8_t(i % 3 - 1));
+    }
+    executor.join();
+  }
+  EXPECT_EQ(10000, ran.load());
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/ConcurrencyLimiter.h>
+
+#include <vector>
+
+#include <folly/fibers/FiberManager.h>
+#include <folly/fibers/SimpleLoopController.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+using Limiter = ConcurrencyLimiter;
+using Outcome = ConcurrencyLimiter::Outcome;
+
+namespace {
+
+Limiter::Options options(Limiter::Algorithm algorithm) {
+  Limiter::Options opts;
+  opts.algorithm = algorithm;
+  opts.initialLimit = 20;
+  opts.maxLimit = 200;
+  return opts;
+}
+
+// Feeds n samples of the given latency, with the limit in use
+void feed(Limiter& limiter, nanoseconds latency, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    limiter.addSample(latency, limiter.limit(), Outcome::SUCCESS);
+  }
+}
+
+} // namespace
+
+TEST(ConcurrencyLimiter, TryAcquire) {
+  Limiter::Options opts;
+  opts.initialLimit = 3;
+  Limiter limiter(opts);
+  std::vector<Limiter::Token> tokens;
+  for (int i = 0; i < 3; ++i) {
+    auto token = limiter.tryAcquire();
+    ASSERT_TRUE(token.hasValue());
+    tokens.push_back(std::move(*token));
+  }
+  EXPECT_EQ(3, limiter.inFlight());
+  EXPECT_FALSE(limiter.tryAcquire().hasValue());
+  EXPECT_EQ(1, limiter.rejectedCount(3));
+
+  tokens[0].release(Outcome::IGNORED);
+  EXPECT_FALSE(tokens[0]);
+  // Releasing again does nothing
+  tokens[0].release();
+  EXPECT_EQ(2, limiter.inFlight());
+  EXPECT_TRUE(limiter.tryAcquire().hasValue());
+  tokens.clear();
+  EXPECT_EQ(0, limiter.inFlight());
+}
+
+TEST(ConcurrencyLimiter, Acquire) {
+  Limiter::Options opts;
+  opts.initialLimit = 1;
+  opts.maxWaiters = 2;
+  Limiter limiter(opts);
+  auto f1 = limiter.acquire();
+  ASSERT_TRUE(f1.isReady());
+  auto f2 = limiter.acquire();
+  auto f3 = limiter.acquire();
+  EXPECT_FALSE(f2.isReady());
+  EXPECT_FALSE(f3.isReady());
+  EXPECT_EQ(2, limiter.numWaiters());
+  EXPECT_THROW(limiter.acquire().value(), ConcurrencyLimitExceeded);
+  // Waiters go first
+  EXPECT_FALSE(limiter.tryAcquire().hasValue());
+
+  f1.value().release(Outcome::IGNORED);
+  ASSERT_TRUE(f2.isReady());
+  EXPECT_FALSE(f3.isReady());
+  f2.value().release(Outcome::IGNORED);
+  ASSERT_TRUE(f3.isReady());
+  EXPECT_EQ(0, limiter.numWaiters());
+  EXPECT_EQ(1, limiter.inFlight());
+  f3.value().release(Outcome::IGNORED);
+  EXPECT_EQ(0, limiter.inFlight());
+}
+
+TEST(ConcurrencyLimiter, Fibers) {
+  Limiter::Options opts;
+  opts.initialLimit = 1;
+  Limiter limiter(opts);
+  auto held = limiter.tryAcquire();
+
+  fibers::FiberManager manager(
+      std::make_unique<fibers::SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<fibers::SimpleLoopController&>(manager.loopController());
+  bool acquired = false;
+  manager.addTask([&] {
+    auto token = limiter.acquire().get();
+    acquired = true;
+    loopController.stop();
+  });
+  size_t iterations = 0;
+  loopController.loop([&] {
+    if (++iterations == 3) {
+      EXPECT_FALSE(acquired);
+      held->release();
+    }
+  });
+  EXPECT_TRUE(acquired);
+  EXPECT_EQ(0, limiter.inFlight());
+}
+
+TEST(ConcurrencyLimiter, GradientAdapts) {
+  Limiter limiter(options(Limiter::Algorithm::GRADIENT));
+  // Steady latency: the limit grows until the maximum
+  feed(limiter, milliseconds(10), 1000);
+  EXPECT_EQ(200, limiter.limit());
+  // Latency well above its average: the limit shrinks
+  feed(limiter, milliseconds(40), 100);
+  EXPECT_GT(50, limiter.limit());
+  EXPECT_LE(1, limiter.limit());
+  // And grows again once latency is back to normal
+  feed(limiter, milliseconds(10), 2000);
+  EXPECT_EQ(200, limiter.limit());
+}
+
+TEST(ConcurrencyLimiter, VegasAdapts) {
+  Limiter limiter(options(Limiter::Algorithm::VEGAS));
+  feed(limiter, milliseconds(10), 100);
+  EXPECT_EQ(200, limiter.limit());
+  // Latency 4x that without load means 3/4 of the requests are queued
+  feed(limiter, milliseconds(40), 100);
+  EXPECT_GT(50, limiter.limit());
+  size_t limit = limiter.limit();
+  // 10% more than without load is few enough queued to grow again
+  feed(limiter, milliseconds(11), 100);
+  EXPECT_LT(limit, limiter.limit());
+}
+
+TEST(ConcurrencyLimiter, Dropped) {
+  for (auto algorithm : {Limiter::Algorithm::GRADIENT,
+                         Limiter::Algorithm::VEGAS}) {
+    Limiter limiter(options(algorithm));
+    for (int i = 0; i < 10; ++i) {
+      limiter.addSample(milliseconds(1), 20, Outcome::DROPPED);
+    }
+    // 20 * 0.9^10
+    EXPECT_EQ(6, limiter.limit());
+    EXPECT_EQ(10, limiter.droppedCount(3));
+    for (int i = 0; i < 100; ++i) {
+      limiter.addSample(milliseconds(1), 20, Outcome::DROPPED);
+    }
+    EXPECT_EQ(1, limiter.limit());
+  }
+}
+
+TEST(ConcurrencyLimiter, Underused) {
+  for (auto algorithm : {Limiter::Algorithm::GRADIENT,
+                         Limiter::Algorithm::VEGAS}) {
+    Limiter limiter(options(algorithm));
+    // A limit that isn't reached doesn't grow
+    for (int i = 0; i < 100; ++i) {
+      limiter.addSample(milliseconds(1), 5, Outcome::SUCCESS);
+    }
+    EXPECT_EQ(20, limiter.limit());
+  }
+}
+
+TEST(ConcurrencyLimiter, Stats) {
+  Limiter limiter(options(Limiter::Algorithm::GRADIENT));
+  // Too few in flight for the limit to change
+  for (int i = 0; i < 10; ++i) {
+    limiter.addSample(microseconds(2500), 5, Outcome::SUCCESS);
+  }
+  limiter.addSample(milliseconds(1), 5, Outcome::IGNORED);
+  limiter.tryAcquire()->release(Outcome::SUCCESS);
+
+  auto latency = limiter.latencyMicros();
+  EXPECT_EQ(11, latency.count(0));
+  EXPECT_EQ(2000, latency.getPercentileBucketMin(50, 0));
+  auto limits = limiter.limits();
+  EXPECT_EQ(11, limits.count(0));
+  EXPECT_EQ(20, limits.getPercentileBucketMin(50, 0));
+  EXPECT_EQ(11, limiter.inFlightCounts().count(0));
+  EXPECT_EQ(0, limiter.droppedCount(0));
+}
@@ -15,9 +15,14 @@
  */
 
 #include <folly/executors/GlobalExecutor.h>
+#include <folly/Baton.h>
 #include <folly/executors/IOExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
 #include <folly/portability/GTest.h>
 
+DECLARE_bool(folly_global_cpu_executor_per_core);
+
 using namespace folly;
 
 TEST(GlobalExecutorTest, GlobalCPUExecutor) {
@@ -54,6 +59,34 @@ TEST(GlobalExecutorTest, GlobalCPUExecutor) {
   EXPECT_EQ(3, count);
 }
 
+TEST(GlobalExecutorTest, GlobalCPUExecutorPerCore) {
+  FLAGS_folly_global_cpu_executor_per_core = true;
+  // Drop the default that an earlier getCPUExecutor() installed
+  setCPUExecutor(std::weak_ptr<Executor>());
+
+  auto executor = getCPUExecutor();
+  EXPECT_NE(
+      nullptr, dynamic_cast<WorkStealingThreadPoolExecutor*>(executor.get()));
+  EXPECT_EQ(executor, getCPUExecutor());
+
+  std::atomic<int> count(0);
+  folly::Baton<> done;
+  for (int i = 0; i < 100; i++) {
+    executor->add([&] {
+      if (++count == 100) {
+        done.post();
+      }
+    });
+  }
+  done.wait();
+
+  FLAGS_folly_global_cpu_executor_per_core = false;
+  setCPUExecutor(std::weak_ptr<Executor>());
+  EXPECT_EQ(
+      nullptr, dynamic_cast<WorkStealingThreadPoolExecutor*>(
+                   getCPUExecutor().get()));
+}
+
 TEST(GlobalExecutorTest, GlobalIOExecutor) {
   class DummyExecutor : public IOExecutor {
    public:
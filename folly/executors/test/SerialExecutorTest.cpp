@@ -15,10 +15,12 @@
  */
 
 #include <chrono>
+#include <stdexcept>
 
 #include <folly/Baton.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/InlineExecutor.h>
+#include <folly/executors/ManualExecutor.h>
 #include <folly/executors/SerialExecutor.h>
 #include <folly/portability/GTest.h>
 
@@ -29,6 +31,21 @@ namespace {
 void burnMs(uint64_t ms) {
   /* sleep override */ std::this_thread::sleep_for(milliseconds(ms));
 }
+
+// A ManualExecutor whose add() throws the next `failures` times, as a
+// bounded executor does when its queue is full
+class FailingExecutor : public folly::ManualExecutor {
+ public:
+  void add(folly::Func func) override {
+    if (failures > 0) {
+      --failures;
+      throw std::runtime_error("queue full");
+    }
+    ManualExecutor::add(std::move(func));
+  }
+
+  int failures{0};
+};
 } // namespace
 
 void SimpleTest(std::shared_ptr<folly::Executor> const& parent) {
@@ -152,3 +169,73 @@ TEST(SerialExecutor, ExecutionThrows) {
   // but SerialExecutor should catch that exception
   executor.add(folly::Func{});
 }
+
+TEST(SerialExecutor, Batching) {
+  auto parent = std::make_shared<folly::ManualExecutor>();
+  SerialExecutor executor(parent);
+
+  std::vector<int> values;
+  std::vector<int> expected;
+  for (int i = 0; i < 40; ++i) {
+    executor.add([i, &values] { values.push_back(i); });
+    expected.push_back(i);
+  }
+
+  // One drain per batch rather than one per task: each drain runs 16 tasks
+  // and submits the next one
+  EXPECT_EQ(1, parent->run());
+  EXPECT_EQ(16, values.size());
+  EXPECT_EQ(2, parent->drain());
+  EXPECT_EQ(expected, values);
+
+  executor.add([&values] { values.push_back(40); });
+  EXPECT_EQ(1, parent->run());
+  EXPECT_EQ(41, values.size());
+}
+
+TEST(SerialExecutor, ManyTasksInline) {
+  // Tasks added from within a task on an inline parent are batched without
+  // nesting a stack frame per batch
+  SerialExecutor executor(std::make_shared<folly::InlineExecutor>());
+
+  int count = 0;
+  executor.add([&] {
+    for (int i = 0; i < 1000000; ++i) {
+      executor.add([&count] { ++count; });
+    }
+  });
+  EXPECT_EQ(1000000, count);
+}
+
+TEST(SerialExecutor, ParentThrows) {
+  auto parent = std::make_shared<FailingExecutor>();
+  SerialExecutor executor(parent);
+
+  std::vector<int> values;
+  std::vector<int> expected;
+  auto add = [&](int i) {
+    expected.push_back(i);
+    executor.add([i, &values] { values.push_back(i); });
+  };
+
+  // The task whose drain couldn't be submitted stays queued, and the next
+  // add() submits the drain
+  parent->failures = 1;
+  EXPECT_THROW(add(0), std::runtime_error);
+  for (int i = 1; i < 6; ++i) {
+    add(i);
+  }
+  EXPECT_EQ(1, parent->drain());
+  EXPECT_EQ(expected, values);
+
+  // Same for the follow-up drain of a batch
+  for (int i = 6; i < 26; ++i) {
+    add(i);
+  }
+  parent->failures = 1;
+  EXPECT_EQ(1, parent->run());
+  EXPECT_EQ(22, values.size());
+  add(26);
+  EXPECT_EQ(1, parent->drain());
+  EXPECT_EQ(expected, values);
+}
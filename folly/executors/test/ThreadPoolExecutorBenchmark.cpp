@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***
+ *  Fork/join throughput of WorkStealingThreadPoolExecutor against
+ *  CPUThreadPoolExecutor: every task adds two more from within the pool
+ *  until the tree is deep enough, then the leaves count down to the root.
+ *  Also compares adding small independent tasks from outside the pool.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/Optional.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+DEFINE_int32(threads, 0, "pool size, 0 for one per core");
+
+namespace {
+
+size_t numThreads() {
+  return FLAGS_threads > 0 ? size_t(FLAGS_threads)
+                           : std::thread::hardware_concurrency();
+}
+
+// Large enough for the widest tree below, CPUThreadPoolExecutor runs it
+// breadth first
+constexpr size_t kMaxQueueSize = 1 << 18;
+
+template <typename Pool>
+void makePool(folly::Optional<Pool>& pool) {
+  pool.emplace(
+      numThreads(),
+      std::make_shared<NamedThreadFactory>("WorkStealingPool"),
+      kMaxQueueSize);
+}
+
+template <>
+void makePool(folly::Optional<CPUThreadPoolExecutor>& pool) {
+  pool.emplace(numThreads(), 1, kMaxQueueSize);
+}
+
+template <typename Pool>
+struct ForkJoin {
+  Pool& pool;
+  std::atomic<size_t> remaining;
+  Baton<> done;
+
+  ForkJoin(Pool& p, size_t depth)
+      : pool(p), remaining((size_t(1) << (depth + 1)) - 1) {}
+
+  void spawn(size_t depth) {
+    if (depth > 0) {
+      pool.add([this, depth] { spawn(depth - 1); });
+      pool.add([this, depth] { spawn(depth - 1); });
+    }
+    if (--remaining == 0) {
+      done.post();
+    }
+  }
+};
+
+template <typename Pool>
+void forkJoinBench(int iters, size_t depth) {
+  folly::Optional<Pool> pool;
+  BENCHMARK_SUSPEND {
+    makePool(pool);
+  }
+  for (int i = 0; i < iters; ++i) {
+    ForkJoin<Pool> fj(*pool, depth);
+    pool->add([&] { fj.spawn(depth); });
+    fj.done.wait();
+  }
+  BENCHMARK_SUSPEND {
+    pool.clear();
+  }
+}
+
+template <typename Pool>
+void externalAddBench(int iters) {
+  folly::Optional<Pool> pool;
+  BENCHMARK_SUSPEND {
+    makePool(pool);
+  }
+  std::atomic<int> remaining(iters);
+  Baton<> done;
+  for (int i = 0; i < iters; ++i) {
+    while (true) {
+      try {
+        pool->add([&] {
+          if (--remaining == 0) {
+            done.post();
+          }
+        });
+        break;
+      } catch (const QueueFullException&) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  if (iters > 0) {
+    done.wait();
+  }
+  BENCHMARK_SUSPEND {
+    pool.clear();
+  }
+}
+
+// iters tasks added from numThreads() threads at once, to a pool whose
+// external queue has numShards shards
+void concurrentAddBench(int iters, size_t numShards) {
+  folly::Optional<WorkStealingThreadPoolExecutor> pool;
+  BENCHMARK_SUSPEND {
+    pool.emplace(
+        numThreads(),
+        std::make_shared<NamedThreadFactory>("WorkStealingPool"),
+        kMaxQueueSize,
+        numShards);
+  }
+  std::atomic<int> remaining(iters);
+  Baton<> done;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads(); ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = t; i < size_t(iters); i += numThreads()) {
+        while (true) {
+          try {
+            pool->add([&] {
+              if (--remaining == 0) {
+                done.post();
+              }
+            });
+            break;
+          } catch (const QueueFullException&) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (iters > 0) {
+    done.wait();
+  }
+  BENCHMARK_SUSPEND {
+    pool.clear();
+  }
+}
+
+void setupBenchmarks() {
+  for (size_t depth : {8, 12, 16}) {
+    size_t tasks = (size_t(1) << (depth + 1)) - 1;
+    addBenchmark(
+        __FILE__,
+        sformat("cpu_fork_join({})", tasks).c_str(),
+        [=](int iters) {
+          forkJoinBench<CPUThreadPoolExecutor>(iters, depth);
+          return iters;
+        });
+    addBenchmark(
+        __FILE__,
+        sformat("%work_stealing_fork_join({})", tasks).c_str(),
+        [=](int iters) {
+          forkJoinBench<WorkStealingThreadPoolExecutor>(iters, depth);
+          return iters;
+        });
+    addBenchmark(__FILE__, "-", [](int) { return 0; });
+  }
+
+  addBenchmark(__FILE__, "cpu_external_add", [](int iters) {
+    externalAddBench<CPUThreadPoolExecutor>(iters);
+    return iters;
+  });
+  addBenchmark(__FILE__, "%work_stealing_external_add", [](int iters) {
+    externalAddBench<WorkStealingThreadPoolExecutor>(iters);
+    return iters;
+  });
+  addBenchmark(__FILE__, "-", [](int) { return 0; });
+
+  addBenchmark(__FILE__, "work_stealing_concurrent_add", [](int iters) {
+    concurrentAddBench(iters, 1);
+    return iters;
+  });
+  addBenchmark(
+      __FILE__, "%work_stealing_concurrent_add_sharded", [](int iters) {
+        concurrentAddBench(iters, numThreads());
+        return iters;
+      });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  setupBenchmarks();
+  runBenchmarks();
+  return 0;
+}
@@ -14,14 +14,26 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <vector>
 
+#include <folly/Baton.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/EDFThreadPoolExecutor.h>
+#include <folly/executors/ExecutorTaskStatsHistograms.h>
 #include <folly/executors/FutureExecutor.h>
 #include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/executors/NUMAThreadPoolExecutor.h>
 #include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
 #include <folly/executors/task_queue/LifoSemMPMCQueue.h>
+#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/thread_factory/AffinityThreadFactory.h>
 #include <folly/executors/thread_factory/PriorityThreadFactory.h>
 #include <folly/portability/GTest.h>
 
@@ -46,6 +58,18 @@ TEST(IOThreadPoolExecutorTest, IOBasic) {
   basic<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSBasic) {
+  basic<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFBasic) {
+  basic<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMABasic) {
+  basic<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void resize() {
   TPE tpe(100);
@@ -64,6 +88,18 @@ TEST(ThreadPoolExecutorTest, IOResize) {
   resize<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSResize) {
+  resize<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFResize) {
+  resize<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAResize) {
+  resize<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void stop() {
   TPE tpe(1);
@@ -105,6 +141,18 @@ TEST(ThreadPoolExecutorTest, IOStop) {
   stop<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSStop) {
+  stop<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFStop) {
+  stop<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAStop) {
+  stop<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void join() {
   TPE tpe(10);
@@ -128,6 +176,18 @@ TEST(ThreadPoolExecutorTest, IOJoin) {
   join<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSJoin) {
+  join<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFJoin) {
+  join<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAJoin) {
+  join<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void resizeUnderLoad() {
   TPE tpe(10);
@@ -153,6 +213,18 @@ TEST(ThreadPoolExecutorTest, IOResizeUnderLoad) {
   resizeUnderLoad<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSResizeUnderLoad) {
+  resizeUnderLoad<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFResizeUnderLoad) {
+  resizeUnderLoad<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAResizeUnderLoad) {
+  resizeUnderLoad<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void poolStats() {
   folly::Baton<> startBaton, endBaton;
@@ -188,6 +260,18 @@ TEST(ThreadPoolExecutorTest, IOPoolStats) {
   poolStats<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSPoolStats) {
+  poolStats<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFPoolStats) {
+  poolStats<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAPoolStats) {
+  poolStats<NUMAThreadPoolExecutor>();
+}
+
 template <class TPE>
 static void taskStats() {
   TPE tpe(1);
@@ -213,6 +297,86 @@ TEST(ThreadPoolExecutorTest, IOTaskStats) {
   taskStats<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSTaskStats) {
+  taskStats<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFTaskStats) {
+  taskStats<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMATaskStats) {
+  taskStats<NUMAThreadPoolExecutor>();
+}
+
+template <class TPE>
+static void taskStatsQueueDepth() {
+  TPE tpe(1);
+  std::mutex mutex;
+  std::vector<uint64_t> depths;
+  tpe.subscribeToTaskStats([&](ThreadPoolExecutor::TaskStats stats) {
+    std::lock_guard<std::mutex> g(mutex);
+    depths.push_back(stats.queueDepth);
+  });
+  Baton<> started;
+  Baton<> blocked;
+  tpe.add([&] {
+    started.post();
+    blocked.wait();
+  });
+  started.wait();
+  for (int i = 0; i < 3; ++i) {
+    tpe.add([] {});
+  }
+  blocked.post();
+  tpe.join();
+  ASSERT_EQ(4, depths.size());
+  // Each task was added behind the ones before it
+  EXPECT_LE(depths[1] + 2, depths[3]);
+  EXPECT_TRUE(std::is_sorted(depths.begin() + 1, depths.end()));
+}
+
+TEST(ThreadPoolExecutorTest, CPUTaskStatsQueueDepth) {
+  taskStatsQueueDepth<CPUThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, IOTaskStatsQueueDepth) {
+  taskStatsQueueDepth<IOThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, WSTaskStatsQueueDepth) {
+  taskStatsQueueDepth<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFTaskStatsQueueDepth) {
+  taskStatsQueueDepth<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMATaskStatsQueueDepth) {
+  taskStatsQueueDepth<NUMAThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, TaskStatsHistograms) {
+  ExecutorTaskStatsHistograms histograms;
+  {
+    CPUThreadPoolExecutor tpe(1);
+    tpe.subscribeToTaskStats(histograms.callback());
+    for (int i = 0; i < 10; ++i) {
+      tpe.add(burnMs(2));
+    }
+    tpe.add([] {}, milliseconds(1), [] {});
+    tpe.join();
+  }
+  using Level = ExecutorTaskStatsHistograms::Level;
+  auto runTime = histograms.runTimeMicros();
+  EXPECT_EQ(10, runTime.count(Level::MINUTE));
+  EXPECT_EQ(10, runTime.count(Level::ALL_TIME));
+  EXPECT_LE(2000, runTime.getPercentileEstimate(0.5, Level::MINUTE));
+  EXPECT_EQ(10, histograms.waitTimeMicros().count(Level::MINUTE));
+  EXPECT_LE(0, histograms.queueDepth().getPercentileEstimate(1.0, 0));
+  EXPECT_EQ(1, histograms.expiredCount(Level::MINUTE));
+}
+
 template <class TPE>
 static void expiration() {
   TPE tpe(1);
@@ -244,6 +408,46 @@ TEST(ThreadPoolExecutorTest, IOExpiration) {
   expiration<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSExpiration) {
+  expiration<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFExpiration) {
+  // EDF runs the task with the earliest deadline first, so the order that
+  // expiration() relies on doesn't hold: instead, keep the only thread busy
+  // until the deadline of the queued task passes.
+  EDFThreadPoolExecutor tpe(1);
+  std::atomic<int> statCbCount(0);
+  std::atomic<int> expiredCount(0);
+  tpe.subscribeToTaskStats([&](ThreadPoolExecutor::TaskStats stats) {
+    statCbCount++;
+    if (stats.expired) {
+      expiredCount++;
+    }
+  });
+  Baton<> started;
+  Baton<> blocked;
+  tpe.add([&] {
+    started.post();
+    blocked.wait();
+  });
+  started.wait();
+  std::atomic<bool> ran(false);
+  std::atomic<int> expireCbCount(0);
+  tpe.add([&] { ran = true; }, milliseconds(10), [&] { expireCbCount++; });
+  /* sleep override */ std::this_thread::sleep_for(milliseconds(50));
+  blocked.post();
+  tpe.join();
+  EXPECT_FALSE(ran.load());
+  EXPECT_EQ(1, expireCbCount);
+  EXPECT_EQ(2, statCbCount);
+  EXPECT_EQ(1, expiredCount);
+}
+
+TEST(ThreadPoolExecutorTest, NUMAExpiration) {
+  expiration<NUMAThreadPoolExecutor>();
+}
+
 template <typename TPE>
 static void futureExecutor() {
   FutureExecutor<TPE> fe(2);
@@ -298,6 +502,18 @@ TEST(ThreadPoolExecutorTest, IOFuturePool) {
   futureExecutor<IOThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, WSFuturePool) {
+  futureExecutor<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, EDFFuturePool) {
+  futureExecutor<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAFuturePool) {
+  futureExecutor<NUMAThreadPoolExecutor>();
+}
+
 TEST(ThreadPoolExecutorTest, PriorityPreemptionTest) {
   bool tookLopri = false;
   auto completed = 0;
@@ -359,6 +575,92 @@ TEST(ThreadPoolExecutorTest, IOObserver) {
   observer->checkCalls();
 }
 
+TEST(ThreadPoolExecutorTest, IOThreadSelection) {
+  for (auto selection : {IOThreadPoolExecutor::ThreadSelection::ROUND_ROBIN,
+                         IOThreadPoolExecutor::ThreadSelection::
+                             LEAST_PENDING_TASKS,
+                         IOThreadPoolExecutor::ThreadSelection::
+                             POWER_OF_TWO_BUSY,
+                         IOThreadPoolExecutor::ThreadSelection::CPU_LOCAL}) {
+    std::atomic<int> completed(0);
+    {
+      IOThreadPoolExecutor exe(4);
+      exe.setThreadSelection(selection);
+      EXPECT_EQ(selection, exe.getThreadSelection());
+      for (int i = 0; i < 100; i++) {
+        exe.add([&] { ++completed; });
+      }
+      EXPECT_NE(nullptr, exe.getEventBase());
+    }
+    EXPECT_EQ(100, completed);
+  }
+}
+
+TEST(ThreadPoolExecutorTest, IOLeastPendingTasks) {
+  IOThreadPoolExecutor exe(2);
+  auto blocked = exe.getEventBase();
+  auto free = exe.getEventBase();
+  ASSERT_NE(blocked, free);
+
+  Baton<> started;
+  Baton<> unblock;
+  exe.setThreadSelection(
+      IOThreadPoolExecutor::ThreadSelection::LEAST_PENDING_TASKS);
+  // Nothing is pending anywhere yet, so this can land on either thread
+  exe.add([&] {
+    blocked = EventBaseManager::get()->getEventBase();
+    started.post();
+    unblock.wait();
+  });
+  started.wait();
+  free = blocked == free ? exe.getEventBase() : free;
+  for (int i = 0; i < 10; i++) {
+    Baton<> done;
+    EventBase* ran = nullptr;
+    exe.add([&] {
+      ran = EventBaseManager::get()->getEventBase();
+      done.post();
+    });
+    done.wait();
+    EXPECT_NE(blocked, ran);
+  }
+  unblock.post();
+}
+
+TEST(ThreadPoolExecutorTest, IOPowerOfTwoBusy) {
+  IOThreadPoolExecutor exe(2);
+  auto busy = exe.getEventBase();
+  auto idle = exe.getEventBase();
+  ASSERT_NE(busy, idle);
+
+  // Keep one loop spinning through short tasks so that it reports a high
+  // busy ratio
+  std::atomic<bool> stop(false);
+  Baton<> stopped;
+  std::function<void()> spin = [&] {
+    auto const until = steady_clock::now() + milliseconds(1);
+    while (steady_clock::now() < until) {
+    }
+    if (stop) {
+      stopped.post();
+    } else {
+      busy->runInEventBaseThread(spin);
+    }
+  };
+  busy->runInEventBaseThread(spin);
+  while (busy->getBusyRatio() <= idle->getBusyRatio()) {
+    std::this_thread::sleep_for(milliseconds(10));
+  }
+
+  exe.setThreadSelection(
+      IOThreadPoolExecutor::ThreadSelection::POWER_OF_TWO_BUSY);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(idle, exe.getEventBase());
+  }
+  stop = true;
+  stopped.wait();
+}
+
 TEST(ThreadPoolExecutorTest, CPUObserver) {
   auto observer = std::make_shared<TestObserver>();
 
@@ -375,6 +677,54 @@ TEST(ThreadPoolExecutorTest, CPUObserver) {
   observer->checkCalls();
 }
 
+TEST(ThreadPoolExecutorTest, WSObserver) {
+  auto observer = std::make_shared<TestObserver>();
+
+  {
+    WorkStealingThreadPoolExecutor exe(10);
+    exe.addObserver(observer);
+    exe.setNumThreads(3);
+    exe.setNumThreads(0);
+    exe.setNumThreads(7);
+    exe.removeObserver(observer);
+    exe.setNumThreads(10);
+  }
+
+  observer->checkCalls();
+}
+
+TEST(ThreadPoolExecutorTest, EDFObserver) {
+  auto observer = std::make_shared<TestObserver>();
+
+  {
+    EDFThreadPoolExecutor exe(10);
+    exe.addObserver(observer);
+    exe.setNumThreads(3);
+    exe.setNumThreads(0);
+    exe.setNumThreads(7);
+    exe.removeObserver(observer);
+    exe.setNumThreads(10);
+  }
+
+  observer->checkCalls();
+}
+
+TEST(ThreadPoolExecutorTest, NUMAObserver) {
+  auto observer = std::make_shared<TestObserver>();
+
+  {
+    NUMAThreadPoolExecutor exe(10);
+    exe.addObserver(observer);
+    exe.setNumThreads(3);
+    exe.setNumThreads(0);
+    exe.setNumThreads(7);
+    exe.removeObserver(observer);
+    exe.setNumThreads(10);
+  }
+
+  observer->checkCalls();
+}
+
 TEST(ThreadPoolExecutorTest, AddWithPriority) {
   std::atomic_int c{0};
   auto f = [&] { c++; };
@@ -425,6 +775,34 @@ TEST(ThreadPoolExecutorTest, BlockingQueue) {
   EXPECT_EQ(5, c);
 }
 
+TEST(ThreadPoolExecutorTest, UnboundedBlockingQueue) {
+  std::atomic_int c{0};
+  const int kTasks = 1 << 16;
+
+  CPUThreadPoolExecutor cpuExe(
+      4,
+      std::make_unique<
+          UnboundedBlockingQueue<CPUThreadPoolExecutor::CPUTask>>(),
+      std::make_shared<NamedThreadFactory>("CPUThreadPool"));
+
+  // More tasks than the default bounded queue would hold, added from
+  // several threads
+  std::vector<std::thread> adders;
+  for (int i = 0; i < 4; i++) {
+    adders.emplace_back([&] {
+      for (int j = 0; j < kTasks / 4; j++) {
+        EXPECT_NO_THROW(cpuExe.add([&] { c++; }));
+      }
+    });
+  }
+  for (auto& t : adders) {
+    t.join();
+  }
+  cpuExe.join();
+
+  EXPECT_EQ(kTasks, c);
+}
+
 TEST(PriorityThreadFactoryTest, ThreadPriority) {
   PriorityThreadFactory factory(
       std::make_shared<NamedThreadFactory>("stuff"), 1);
@@ -537,6 +915,18 @@ TEST(ThreadPoolExecutorTest, ShutdownTestCPU) {
   ShutdownTest<CPUThreadPoolExecutor, folly::FutureException>();
 }
 
+TEST(ThreadPoolExecutorTest, ShutdownTestWS) {
+  ShutdownTest<WorkStealingThreadPoolExecutor, folly::FutureException>();
+}
+
+TEST(ThreadPoolExecutorTest, ShutdownTestEDF) {
+  ShutdownTest<EDFThreadPoolExecutor, folly::FutureException>();
+}
+
+TEST(ThreadPoolExecutorTest, ShutdownTestNUMA) {
+  ShutdownTest<NUMAThreadPoolExecutor, folly::FutureException>();
+}
+
 template <typename TPE>
 static void removeThreadTest() {
   // test that adding a .then() after we have removed some threads
@@ -571,6 +961,18 @@ TEST(ThreadPoolExecutorTest, RemoveThreadTestCPU) {
   removeThreadTest<CPUThreadPoolExecutor>();
 }
 
+TEST(ThreadPoolExecutorTest, RemoveThreadTestWS) {
+  removeThreadTest<WorkStealingThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, RemoveThreadTestEDF) {
+  removeThreadTest<EDFThreadPoolExecutor>();
+}
+
+TEST(ThreadPoolExecutorTest, RemoveThreadTestNUMA) {
+  removeThreadTest<NUMAThreadPoolExecutor>();
+}
+
 template <typename TPE>
 static void resizeThreadWhileExecutingTest() {
   TPE tpe(10);
@@ -601,3 +1003,293 @@ TEST(ThreadPoolExecutorTest, resizeThreadWhileExecutingTestIO) {
 TEST(ThreadPoolExecutorTest, resizeThreadWhileExecutingTestCPU) {
   resizeThreadWhileExecutingTest<CPUThreadPoolExecutor>();
 }
+
+TEST(ThreadPoolExecutorTest, WSForkJoin) {
+  WorkStealingThreadPoolExecutor tpe(4);
+  std::atomic<int> completed(0);
+  // A binary tree of tasks, each adding its children from a pool thread
+  std::function<void(int)> spawn = [&](int depth) {
+    completed++;
+    if (depth > 0) {
+      tpe.add([&, depth] { spawn(depth - 1); });
+      tpe.add([&, depth] { spawn(depth - 1); });
+    }
+  };
+  for (int i = 0; i < 4; i++) {
+    tpe.add([&] { spawn(10); });
+  }
+  tpe.join();
+  EXPECT_EQ(4 * ((1 << 11) - 1), completed);
+}
+
+TEST(ThreadPoolExecutorTest, WSStealing) {
+  // Tasks added from a pool thread go to its own deque, the other threads
+  // have to steal them
+  WorkStealingThreadPoolExecutor tpe(4);
+  std::mutex mutex;
+  std::set<std::thread::id> ids;
+  folly::Baton<> baton;
+  tpe.add([&] {
+    for (int i = 0; i < 100; i++) {
+      tpe.add([&] {
+        burnMs(1)();
+        std::lock_guard<std::mutex> g(mutex);
+        ids.insert(std::this_thread::get_id());
+      });
+    }
+    baton.wait();
+  });
+  burnMs(200)();
+  baton.post();
+  tpe.join();
+  EXPECT_LT(1, ids.size());
+}
+
+TEST(ThreadPoolExecutorTest, WSQueueFull) {
+  WorkStealingThreadPoolExecutor tpe(
+      1, std::make_shared<NamedThreadFactory>("WorkStealingPool"), 2);
+  folly::Baton<> started, baton;
+  tpe.add([&] {
+    started.post();
+    baton.wait();
+  });
+  started.wait();
+  tpe.add([] {});
+  tpe.add([] {});
+  EXPECT_THROW(tpe.add([] {}), QueueFullException);
+  baton.post();
+  tpe.join();
+}
+
+TEST(ThreadPoolExecutorTest, WSInjectShards) {
+  // Tasks added from many threads land on several shards, every worker
+  // drains the shards of the others too
+  WorkStealingThreadPoolExecutor tpe(
+      2,
+      std::make_shared<NamedThreadFactory>("WorkStealingPool"),
+      WorkStealingThreadPoolExecutor::kDefaultMaxQueueSize,
+      8);
+  std::atomic<int> completed(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; i++) {
+        tpe.add([&] { completed++; });
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  tpe.join();
+  EXPECT_EQ(8000, completed);
+}
+
+TEST(ThreadPoolExecutorTest, WSInjectShardFull) {
+  // A full shard spills over to the others before add() throws
+  WorkStealingThreadPoolExecutor tpe(
+      1, std::make_shared<NamedThreadFactory>("WorkStealingPool"), 4, 2);
+  folly::Baton<> started, baton;
+  tpe.add([&] {
+    started.post();
+    baton.wait();
+  });
+  started.wait();
+  for (int i = 0; i < 4; i++) {
+    tpe.add([] {});
+  }
+  EXPECT_THROW(tpe.add([] {}), QueueFullException);
+  baton.post();
+  tpe.join();
+}
+
+TEST(ThreadPoolExecutorTest, EDFOrder) {
+  EDFThreadPoolExecutor tpe(1);
+  folly::Baton<> started, blocked;
+  tpe.add([&] {
+    started.post();
+    blocked.wait();
+  });
+  started.wait();
+
+  std::vector<int> order;
+  auto now = EDFThreadPoolExecutor::Clock::now();
+  tpe.add([&] { order.push_back(0); });
+  tpe.addWithDeadline([&] { order.push_back(3); }, now + seconds(30));
+  tpe.addWithDeadline([&] { order.push_back(1); }, now + seconds(10));
+  tpe.addWithDeadline([&] { order.push_back(4); }, now + seconds(30));
+  tpe.add([&] { order.push_back(2); }, seconds(20));
+  blocked.post();
+  tpe.join();
+
+  // Earliest deadline first, then in the order added, no deadline last
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 0}), order);
+}
+
+TEST(ThreadPoolExecutorTest, EDFExpiresPastDeadline) {
+  EDFThreadPoolExecutor tpe(1);
+  folly::Baton<> started, blocked;
+  tpe.add([&] {
+    started.post();
+    blocked.wait();
+  });
+  started.wait();
+
+  std::atomic<int> ran{0};
+  std::atomic<int> expired{0};
+  auto now = EDFThreadPoolExecutor::Clock::now();
+  tpe.addWithDeadline([&] { ran++; }, now + milliseconds(10), [&] {
+    expired++;
+  });
+  tpe.addWithDeadline([&] { ran++; }, now + seconds(60), [&] { expired++; });
+  burnMs(20)();
+  blocked.post();
+  tpe.join();
+  EXPECT_EQ(1, ran);
+  EXPECT_EQ(1, expired);
+}
+
+TEST(ThreadPoolExecutorTest, EDFCodel) {
+  EDFThreadPoolExecutor tpe(
+      1, std::make_shared<NamedThreadFactory>("EDFThreadPool"), true);
+  ASSERT_NE(nullptr, tpe.getCodel());
+
+  // Far more work than one thread can do in a few codel intervals: once
+  // codel notices, tasks queued for longer than the slough timeout expire
+  // even though their deadline is far away
+  constexpr int kTasks = 50;
+  std::atomic<int> ran{0};
+  std::atomic<int> expired{0};
+  auto deadline = EDFThreadPoolExecutor::Clock::now() + seconds(60);
+  for (int i = 0; i < kTasks; ++i) {
+    tpe.addWithDeadline(
+        [&] {
+          burnMs(10)();
+          ran++;
+        },
+        deadline,
+        [&] { expired++; });
+  }
+  tpe.join();
+  EXPECT_LT(0, expired);
+  EXPECT_LT(0, ran);
+  EXPECT_EQ(kTasks, ran + expired);
+
+  // A task that would have to wait less than any task did in the current
+  // interval is rejected right away
+  bool rejected = false;
+  tpe.addWithDeadline(
+      [] {},
+      EDFThreadPoolExecutor::Clock::now() - milliseconds(1),
+      [&] { rejected = true; });
+  EXPECT_TRUE(rejected);
+}
+
+namespace {
+
+// Two nodes of four cpus each, with the cpus of each node interleaved
+CacheLocality twoNodeLocality() {
+  CacheLocality locality;
+  locality.numCpus = 8;
+  locality.numCachesByLevel = {4, 2};
+  locality.localityIndexByCpu = {0, 4, 1, 5, 2, 6, 3, 7};
+  return locality;
+}
+
+} // namespace
+
+TEST(AffinityThreadFactoryTest, CpusByNode) {
+  EXPECT_EQ(
+      (std::vector<std::vector<size_t>>{{0, 2, 4, 6}, {1, 3, 5, 7}}),
+      AffinityThreadFactory::cpusByNode(twoNodeLocality()));
+  // No sharing information, no nodes
+  EXPECT_EQ(
+      (std::vector<std::vector<size_t>>{{0, 1, 2}}),
+      AffinityThreadFactory::cpusByNode(CacheLocality::uniform(3)));
+}
+
+#ifdef __linux__
+TEST(AffinityThreadFactoryTest, PinsToCore) {
+  cpu_set_t allowed;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  auto nodes = AffinityThreadFactory::cpusByNode(CacheLocality::system());
+  auto first = nodes[0][0];
+
+  AffinityThreadFactory factory(
+      std::make_shared<NamedThreadFactory>("pinned"),
+      AffinityThreadFactory::Granularity::CORE);
+  int numCpus = 0;
+  bool onFirst = false;
+  factory
+      .newThread([&] {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        sched_getaffinity(0, sizeof(cpuset), &cpuset);
+        numCpus = CPU_COUNT(&cpuset);
+        onFirst = CPU_ISSET(first, &cpuset);
+      })
+      .join();
+  if (CPU_ISSET(first, &allowed)) {
+    EXPECT_EQ(1, numCpus);
+    EXPECT_TRUE(onFirst);
+  } else {
+    // Can't pin there, left alone
+    EXPECT_EQ(CPU_COUNT(&allowed), numCpus);
+  }
+}
+#endif
+
+TEST(ThreadPoolExecutorTest, NUMALocalFirst) {
+  auto locality = twoNodeLocality();
+  // The cpus are made up, so don't pin
+  NUMAThreadPoolExecutor tpe(
+      1,
+      std::make_shared<NamedThreadFactory>("NUMAThreadPool"),
+      NUMAThreadPoolExecutor::kDefaultMaxQueueSize,
+      false,
+      locality);
+  EXPECT_EQ(2, tpe.numNodes());
+
+  // The only thread is on node 0, and takes from node 1 only when node 0
+  // has nothing left
+  folly::Baton<> started, blocked;
+  tpe.addToNode(0, [&] {
+    started.post();
+    blocked.wait();
+  });
+  started.wait();
+  std::vector<int> order;
+  tpe.addToNode(1, [&] { order.push_back(1); });
+  tpe.addToNode(0, [&] {
+    order.push_back(0);
+    // Tasks added from the pool stay on the node of the adding thread
+    tpe.addToNode(1, [&] { order.push_back(3); });
+    tpe.add([&] { order.push_back(2); });
+  });
+  blocked.post();
+  tpe.join();
+  EXPECT_EQ((std::vector<int>{0, 2, 1, 3}), order);
+}
+
+TEST(ThreadPoolExecutorTest, NUMAStealing) {
+  auto locality = twoNodeLocality();
+  NUMAThreadPoolExecutor tpe(
+      4,
+      std::make_shared<NamedThreadFactory>("NUMAThreadPool"),
+      NUMAThreadPoolExecutor::kDefaultMaxQueueSize,
+      false,
+      locality);
+
+  // All tasks on one node still keep the other node's threads busy
+  std::mutex mutex;
+  std::set<std::thread::id> ids;
+  for (int i = 0; i < 40; ++i) {
+    tpe.addToNode(0, [&] {
+      burnMs(10)();
+      std::lock_guard<std::mutex> g(mutex);
+      ids.insert(std::this_thread::get_id());
+    });
+  }
+  tpe.join();
+  EXPECT_LT(2, ids.size());
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/thread_factory/AffinityThreadFactory.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace folly {
+
+AffinityThreadFactory::AffinityThreadFactory(
+    std::shared_ptr<ThreadFactory> factory,
+    Granularity granularity,
+    const CacheLocality& locality)
+    : factory_(std::move(factory)),
+      granularity_(granularity),
+      cpusByNode_(cpusByNode(locality)) {}
+
+std::thread AffinityThreadFactory::newThread(Func&& func) {
+  auto i = next_++;
+  auto& node = cpusByNode_[i % cpusByNode_.size()];
+  std::vector<size_t> cpus;
+  if (granularity_ == Granularity::CORE) {
+    cpus.push_back(node[(i / cpusByNode_.size()) % node.size()]);
+  } else {
+    cpus = node;
+  }
+  return factory_->newThread(
+      [ cpus = std::move(cpus), func = std::move(func) ]() mutable {
+        pinCurrentThread(cpus);
+        func();
+      });
+}
+
+std::vector<std::vector<size_t>> AffinityThreadFactory::cpusByNode(
+    const CacheLocality& locality) {
+  const size_t numCpus = locality.numCpus;
+  size_t numNodes = 1;
+  if (locality.numCachesByLevel.size() > 1) {
+    numNodes = std::max(
+        size_t(1), std::min(numCpus, locality.numCachesByLevel.back()));
+  }
+
+  // Same mapping as AccessSpreader uses for its stripes
+  std::vector<size_t> cpuByIndex(numCpus);
+  for (size_t cpu = 0; cpu < numCpus; ++cpu) {
+    cpuByIndex[locality.localityIndexByCpu[cpu]] = cpu;
+  }
+  std::vector<std::vector<size_t>> nodes(numNodes);
+  for (size_t index = 0; index < numCpus; ++index) {
+    nodes[index * numNodes / numCpus].push_back(cpuByIndex[index]);
+  }
+  return nodes;
+}
+
+bool AffinityThreadFactory::pinCurrentThread(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return false;
+  }
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  bool any = false;
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+      CPU_SET(cpu, &cpuset);
+      any = true;
+    }
+  }
+  if (!any) {
+    return false;
+  }
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (err != 0) {
+    LOG(ERROR) << "pthread_setaffinity_np failed with error " << err;
+    return false;
+  }
+  return true;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+} // namespace folly
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/executors/thread_factory/ThreadFactory.h>
+
+namespace folly {
+
+/**
+ * A ThreadFactory that pins each thread it creates to a single cpu (CORE)
+ * or to all the cpus of a node (NODE), using the topology discovered by
+ * CacheLocality.
+ *
+ * A node is the set of cpus sharing a last-level cache, which is one socket
+ * on the usual multi-socket machines, and so stands in for a NUMA node
+ * without depending on libnuma.  Threads are spread over the nodes round
+ * robin, and, for CORE, over the cpus of each node in locality order, so
+ * hyperthreads of the same core are used last.
+ *
+ * Pinning is only implemented on Linux, and is restricted to the cpus the
+ * process is allowed to run on; threads that can't be pinned run unpinned.
+ */
+class AffinityThreadFactory : public ThreadFactory {
+ public:
+  enum class Granularity {
+    CORE,
+    NODE,
+  };
+
+  explicit AffinityThreadFactory(
+      std::shared_ptr<ThreadFactory> factory,
+      Granularity granularity = Granularity::NODE,
+      const CacheLocality& locality = CacheLocality::system());
+
+  std::thread newThread(Func&& func) override;
+
+  size_t numNodes() const {
+    return cpusByNode_.size();
+  }
+
+  /**
+   * The cpus of each node, each in locality order.  A locality without cache
+   * sharing information (see CacheLocality::uniform()) is a single node.
+   * Nodes are numbered like AccessSpreader stripes, so for the system
+   * locality AccessSpreader<>::current(numNodes) is the node of the calling
+   * thread.
+   */
+  static std::vector<std::vector<size_t>> cpusByNode(
+      const CacheLocality& locality);
+
+  /**
+   * Restricts the calling thread to the given cpus (among those the process
+   * may use).  Returns false, leaving the thread as it was, if that isn't
+   * possible.
+   */
+  static bool pinCurrentThread(const std::vector<size_t>& cpus);
+
+ private:
+  std::shared_ptr<ThreadFactory> factory_;
+  const Granularity granularity_;
+  const std::vector<std::vector<size_t>> cpusByNode_;
+  std::atomic<size_t> next_{0};
+};
+
+} // namespace folly
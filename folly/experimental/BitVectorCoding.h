@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <limits>
 #include <type_traits>
@@ -288,6 +289,41 @@ class BitVectorReader : detail::ForwardPointers<Encoder::forwardQuantum>,
     return setValue(inner);
   }
 
+  /**
+   * Decodes up to n values following the current one into out, and moves
+   * to the last of them.  Returns the number of values decoded, which is
+   * less than n only at the end of the list; 0 leaves the reader done.
+   */
+  SizeType nextBatch(ValueType* out, SizeType n) {
+    const SizeType first = position() + 1; // 0 before the first next().
+    if (!kUnchecked) {
+      if (UNLIKELY(first >= size_)) {
+        setDone();
+        return 0;
+      }
+      n = std::min<SizeType>(n, size_ - first);
+    }
+    if (UNLIKELY(n == 0)) {
+      return 0;
+    }
+    // Local copies of the state stay in registers.
+    auto block = block_;
+    auto outer = outer_;
+    for (SizeType i = 0; i < n; ++i) {
+      while (block == 0) {
+        outer += sizeof(uint64_t);
+        block = folly::loadUnaligned<uint64_t>(bits_ + outer);
+      }
+      out[i] = static_cast<ValueType>(8 * outer + Instructions::ctz(block));
+      block = Instructions::blsr(block);
+    }
+    block_ = block;
+    outer_ = outer;
+    position_ = first + n - 1;
+    value_ = out[n - 1];
+    return n;
+  }
+
   bool skip(SizeType n) {
     CHECK_GT(n, 0);
 
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/Bitmap.h>
+
+#include <atomic>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+namespace folly {
+namespace bitmap {
+
+namespace {
+
+enum class Op { AND, OR, XOR, ANDNOT };
+
+template <Op op>
+inline uint64_t apply(uint64_t a, uint64_t b) {
+  switch (op) {
+    case Op::AND:
+      return a & b;
+    case Op::OR:
+      return a | b;
+    case Op::XOR:
+      return a ^ b;
+    case Op::ANDNOT:
+      return a & ~b;
+  }
+}
+
+// Each Kernel processes whole arrays; findNonzero() returns the index of
+// the first nonzero word, or n.
+
+struct ScalarKernel {
+  template <Op op>
+  static void
+  binary(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      dst[i] = apply<op>(a[i], b[i]);
+    }
+  }
+
+  static size_t popcount(const uint64_t* words, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      count += folly::popcount(words[i]);
+    }
+    return count;
+  }
+
+  static size_t popcountAnd(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      count += folly::popcount(a[i] & b[i]);
+    }
+    return count;
+  }
+
+  static size_t findNonzero(const uint64_t* words, size_t n) {
+    size_t i = 0;
+    while (i < n && words[i] == 0) {
+      ++i;
+    }
+    return i;
+  }
+};
+
+#if FOLLY_X64
+
+struct Avx2Kernel {
+  template <Op op>
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static void
+  binary(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i x = load(a + i);
+      __m256i y = load(b + i);
+      __m256i r;
+      switch (op) {
+        case Op::AND:
+          r = _mm256_and_si256(x, y);
+          break;
+        case Op::OR:
+          r = _mm256_or_si256(x, y);
+          break;
+        case Op::XOR:
+          r = _mm256_xor_si256(x, y);
+          break;
+        case Op::ANDNOT:
+          r = _mm256_andnot_si256(y, x);
+          break;
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+    for (; i < n; ++i) {
+      dst[i] = apply<op>(a[i], b[i]);
+    }
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static size_t popcount(const uint64_t* words, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc = _mm256_add_epi64(acc, popcount256(load(words + i)));
+    }
+    size_t count = sum(acc);
+    for (; i < n; ++i) {
+      count += _mm_popcnt_u64(words[i]);
+    }
+    return count;
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static size_t popcountAnd(const uint64_t* a, const uint64_t* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc = _mm256_add_epi64(
+          acc, popcount256(_mm256_and_si256(load(a + i), load(b + i))));
+    }
+    size_t count = sum(acc);
+    for (; i < n; ++i) {
+      count += _mm_popcnt_u64(a[i] & b[i]);
+    }
+    return count;
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static size_t findNonzero(const uint64_t* words, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i v = load(words + i);
+      if (!_mm256_testz_si256(v, v)) {
+        break;
+      }
+    }
+    while (i < n && words[i] == 0) {
+      ++i;
+    }
+    return i;
+  }
+
+ private:
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static __m256i load(const uint64_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+
+  // The counts of each 64-bit lane: look up the counts of each nibble,
+  // then add up the bytes of each lane with SAD (Mula's method)
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static __m256i popcount256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    __m256i bytes = _mm256_add_epi8(
+        _mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2,popcnt")
+  static size_t sum(__m256i v) {
+    return size_t(
+        _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) +
+        _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3));
+  }
+};
+
+// Tails are handled with masked loads and stores, 8 words at a time
+struct Avx512Kernel {
+  template <Op op>
+  FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vpopcntdq")
+  static void
+  binary(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+      __mmask8 mask = tailMask(n - i);
+      __m512i x = _mm512_maskz_loadu_epi64(mask, a + i);
+      __m512i y = _mm512_maskz_loadu_epi64(mask, b + i);
+      __m512i r;
+      switch (op) {
+        case Op::AND:
+          r = _mm512_and_si512(x, y);
+          break;
+        case Op::OR:
+          r = _mm512_or_si512(x, y);
+          break;
+        case Op::XOR:
+          r = _mm512_xor_si512(x, y);
+          break;
+        case Op::ANDNOT:
+          r = _mm512_andnot_si512(y, x);
+          break;
+      }
+      _mm512_mask_storeu_epi64(dst + i, mask, r);
+    }
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vpopcntdq")
+  static size_t popcount(const uint64_t* words, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 8) {
+      __m512i v = _mm512_maskz_loadu_epi64(tailMask(n - i), words + i);
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return size_t(_mm512_reduce_add_epi64(acc));
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vpopcntdq")
+  static size_t popcountAnd(const uint64_t* a, const uint64_t* b, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 8) {
+      __mmask8 mask = tailMask(n - i);
+      __m512i v = _mm512_and_si512(
+          _mm512_maskz_loadu_epi64(mask, a + i),
+          _mm512_maskz_loadu_epi64(mask, b + i));
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    return size_t(_mm512_reduce_add_epi64(acc));
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vpopcntdq")
+  static size_t findNonzero(const uint64_t* words, size_t n) {
+    for (size_t i = 0; i < n; i += 8) {
+      __m512i v = _mm512_maskz_loadu_epi64(tailMask(n - i), words + i);
+      __mmask8 nonzero = _mm512_test_epi64_mask(v, v);
+      if (nonzero != 0) {
+        return i + __builtin_ctz(nonzero);
+      }
+    }
+    return n;
+  }
+
+ private:
+  static __mmask8 tailMask(size_t remaining) {
+    return remaining >= 8 ? __mmask8(0xff)
+                          : __mmask8((1u << remaining) - 1);
+  }
+};
+
+#endif
+
+struct Ops {
+  detail::Kernel kernel;
+  void (*andWords)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+  void (*orWords)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+  void (*xorWords)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+  void (*andNotWords)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+  size_t (*popcount)(const uint64_t*, size_t);
+  size_t (*popcountAnd)(const uint64_t*, const uint64_t*, size_t);
+  size_t (*findNonzero)(const uint64_t*, size_t);
+};
+
+template <class Kernel>
+constexpr Ops makeOps(detail::Kernel kernel) {
+  return {kernel,
+          &Kernel::template binary<Op::AND>,
+          &Kernel::template binary<Op::OR>,
+          &Kernel::template binary<Op::XOR>,
+          &Kernel::template binary<Op::ANDNOT>,
+          &Kernel::popcount,
+          &Kernel::popcountAnd,
+          &Kernel::findNonzero};
+}
+
+const Ops kScalarOps = makeOps<ScalarKernel>(detail::Kernel::SCALAR);
+#if FOLLY_X64
+const Ops kAvx2Ops = makeOps<Avx2Kernel>(detail::Kernel::AVX2);
+const Ops kAvx512Ops = makeOps<Avx512Kernel>(detail::Kernel::AVX512);
+#endif
+
+const Ops* supportedOps(detail::Kernel kernel) {
+#if FOLLY_X64
+  static const CpuId cpu;
+  switch (kernel) {
+    case detail::Kernel::AVX512:
+      return cpu.avx512f() && cpu.avx512vpopcntdq() ? &kAvx512Ops : nullptr;
+    case detail::Kernel::AVX2:
+      return cpu.avx2() && cpu.popcnt() ? &kAvx2Ops : nullptr;
+    case detail::Kernel::SCALAR:
+      break;
+  }
+#endif
+  return kernel == detail::Kernel::SCALAR ? &kScalarOps : nullptr;
+}
+
+const Ops* bestOps() {
+  for (auto kernel : {detail::Kernel::AVX512, detail::Kernel::AVX2}) {
+    if (auto ops = supportedOps(kernel)) {
+      return ops;
+    }
+  }
+  return &kScalarOps;
+}
+
+std::atomic<const Ops*>& currentOps() {
+  static std::atomic<const Ops*> ops{bestOps()};
+  return ops;
+}
+
+inline const Ops& ops() {
+  return *currentOps().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void andWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+  ops().andWords(dst, a, b, n);
+}
+
+void orWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+  ops().orWords(dst, a, b, n);
+}
+
+void xorWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n) {
+  ops().xorWords(dst, a, b, n);
+}
+
+void andNotWords(
+    uint64_t* dst,
+    const uint64_t* a,
+    const uint64_t* b,
+    size_t n) {
+  ops().andNotWords(dst, a, b, n);
+}
+
+size_t popcount(const uint64_t* words, size_t n) {
+  return ops().popcount(words, n);
+}
+
+size_t popcountAnd(const uint64_t* a, const uint64_t* b, size_t n) {
+  return ops().popcountAnd(a, b, n);
+}
+
+size_t popcountRange(const uint64_t* words, size_t begin, size_t end) {
+  if (begin >= end) {
+    return 0;
+  }
+  size_t first = begin / 64;
+  size_t last = end / 64;
+  uint64_t firstWord = words[first] >> (begin % 64);
+  if (first == last) {
+    return folly::popcount(
+        firstWord & ((uint64_t(1) << (end - begin)) - 1));
+  }
+  size_t count = folly::popcount(firstWord) +
+      ops().popcount(words + first + 1, last - first - 1);
+  if (end % 64 != 0) {
+    count +=
+        folly::popcount(words[last] & ((uint64_t(1) << (end % 64)) - 1));
+  }
+  return count;
+}
+
+size_t findFirstSet(const uint64_t* words, size_t size, size_t from) {
+  if (from >= size) {
+    return size;
+  }
+  size_t index = from / 64;
+  uint64_t word = words[index] & (~uint64_t(0) << (from % 64));
+  if (word == 0) {
+    size_t numWords = (size + 63) / 64;
+    index += 1;
+    index += ops().findNonzero(words + index, numWords - index);
+    if (index == numWords) {
+      return size;
+    }
+    word = words[index];
+  }
+  // Bits set past the end of the last word don't count
+  return std::min(size, index * 64 + folly::findFirstSet(word) - 1);
+}
+
+namespace detail {
+
+Kernel kernel() {
+  return ops().kernel;
+}
+
+bool setKernel(Kernel kernel) {
+  auto ops = supportedOps(kernel);
+  if (!ops) {
+    return false;
+  }
+  currentOps().store(ops, std::memory_order_relaxed);
+  return true;
+}
+
+} // namespace detail
+} // namespace bitmap
+} // namespace folly
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bulk operations on bitmaps stored as arrays of 64-bit words, bit i of
+ * the bitmap being bit i % 64 of word i / 64, as with Bits<uint64_t> and
+ * BitIterator: AND, OR, XOR and AND NOT of whole arrays, population counts
+ * of arrays and bit ranges, and search for the next set bit.
+ *
+ * The kernels use AVX-512 (with VPOPCNTDQ) or AVX2 when the CPU has them,
+ * picked at run time, and plain 64-bit operations otherwise.
+ *
+ * RankSelectIndex adds constant-time rank and select queries to such a
+ * bitmap.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/experimental/Instructions.h>
+#include <folly/experimental/Select64.h>
+
+namespace folly {
+namespace bitmap {
+
+// dst[i] = a[i] & b[i], for i < n.  dst may be a or b.
+void andWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n);
+// dst[i] = a[i] | b[i]
+void orWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n);
+// dst[i] = a[i] ^ b[i]
+void xorWords(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t n);
+// dst[i] = a[i] & ~b[i]
+void andNotWords(
+    uint64_t* dst,
+    const uint64_t* a,
+    const uint64_t* b,
+    size_t n);
+
+// The number of bits set in words[0, n)
+size_t popcount(const uint64_t* words, size_t n);
+// The number of bits set in both a and b, without materializing a & b
+size_t popcountAnd(const uint64_t* a, const uint64_t* b, size_t n);
+// The number of bits set among bits [begin, end)
+size_t popcountRange(const uint64_t* words, size_t begin, size_t end);
+
+// The first bit set among bits [from, size), or size if none is
+size_t findFirstSet(const uint64_t* words, size_t size, size_t from = 0);
+
+namespace detail {
+
+// The kernels used, for tests and benchmarks
+enum class Kernel {
+  SCALAR,
+  AVX2,
+  AVX512,
+};
+
+// The best one the CPU supports, by default
+Kernel kernel();
+// Returns false, and changes nothing, if the CPU doesn't support it
+bool setKernel(Kernel kernel);
+
+} // namespace detail
+} // namespace bitmap
+
+/**
+ * Rank and select over a bitmap of size bits in words, which must outlive
+ * the index and not change:
+ *
+ *   rank(i):   the number of bits set before bit i
+ *   select(k): the position of the k-th bit set (0-based)
+ *
+ * Rank reads one counter and up to 8 words, all in the same 512-bit block.
+ * Select samples the block of every 4096-th set bit, binary searches the
+ * blocks between two samples, and finishes with select64().  The index
+ * takes 64 bits per 512 (12.5%), plus 64 bits per 4096 bits set.
+ *
+ * Instructions is as in EliasFanoReader: Haswell has PDEP for select64().
+ */
+template <class Instructions = compression::instructions::Default>
+class RankSelectIndex {
+ public:
+  static constexpr size_t kBlockWords = 8;
+  static constexpr size_t kBlockBits = kBlockWords * 64;
+  static constexpr size_t kSelectSampleRate = 4096;
+
+  RankSelectIndex() = default;
+
+  RankSelectIndex(const uint64_t* words, size_t size)
+      : words_(words), size_(size) {
+    size_t numWords = (size + 63) / 64;
+    size_t numBlocks = (numWords + kBlockWords - 1) / kBlockWords;
+    blockRanks_.reserve(numBlocks + 1);
+    size_t rank = 0;
+    for (size_t block = 0; block < numBlocks; ++block) {
+      blockRanks_.push_back(rank);
+      size_t end = std::min(numWords, (block + 1) * kBlockWords);
+      for (size_t i = block * kBlockWords; i < end; ++i) {
+        uint64_t word = words[i];
+        if (i == numWords - 1 && size % 64 != 0) {
+          // Bits past the end don't count
+          word &= (uint64_t(1) << (size % 64)) - 1;
+        }
+        size_t ones = Instructions::popcount(word);
+        // Sample the blocks holding set bits number 0, kSelectSampleRate,
+        // 2 * kSelectSampleRate...
+        while (selectSamples_.size() * kSelectSampleRate < rank + ones) {
+          selectSamples_.push_back(block);
+        }
+        rank += ones;
+      }
+    }
+    blockRanks_.push_back(rank);
+    count_ = rank;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // The number of bits set
+  size_t count() const {
+    return count_;
+  }
+
+  size_t rank(size_t pos) const {
+    DCHECK_LE(pos, size_);
+    if (pos == size_) {
+      return count_;
+    }
+    size_t word = pos / 64;
+    size_t block = word / kBlockWords;
+    size_t rank = blockRanks_[block];
+    for (size_t i = block * kBlockWords; i < word; ++i) {
+      rank += Instructions::popcount(words_[i]);
+    }
+    return rank +
+        Instructions::popcount(
+               words_[word] & ((uint64_t(1) << (pos % 64)) - 1));
+  }
+
+  size_t select(size_t k) const {
+    DCHECK_LT(k, count_);
+    size_t sample = k / kSelectSampleRate;
+    // The last block whose rank is at most k, between the samples
+    auto first = blockRanks_.begin() + selectSamples_[sample];
+    auto last = sample + 1 < selectSamples_.size()
+        ? blockRanks_.begin() + selectSamples_[sample + 1] + 1
+        : blockRanks_.end() - 1;
+    size_t block = size_t(std::upper_bound(first, last, k) - 1 -
+                          blockRanks_.begin());
+    k -= blockRanks_[block];
+    for (size_t i = block * kBlockWords;; ++i) {
+      size_t ones = Instructions::popcount(words_[i]);
+      if (k < ones) {
+        return i * 64 + select64<Instructions>(words_[i], k);
+      }
+      k -= ones;
+    }
+  }
+
+  size_t memoryUsage() const {
+    return sizeof(*this) + blockRanks_.capacity() * sizeof(uint64_t) +
+        selectSamples_.capacity() * sizeof(uint64_t);
+  }
+
+ private:
+  const uint64_t* words_{nullptr};
+  size_t size_{0};
+  size_t count_{0};
+  // The number of bits set before each block, and in all
+  std::vector<uint64_t> blockRanks_;
+  // The block of every kSelectSampleRate-th bit set
+  std::vector<uint64_t> selectSamples_;
+};
+
+} // namespace folly
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Intersection of two sorted lists read through EliasFanoReader or
+ * BitVectorReader, in any combination.
+ *
+ * Lists of similar sizes are decoded in batches with nextBatch() and
+ * merged without data-dependent branches.  When one list is much longer
+ * than the other, most of it is never decoded: the longer reader
+ * skipTo()s each value of the shorter one, using its skip pointers.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#include <folly/Likely.h>
+
+namespace folly {
+namespace compression {
+
+namespace detail {
+
+// Longer list size / shorter list size from which skipTo() beats merging.
+constexpr size_t kIntersectSkipRatio = 16;
+constexpr size_t kIntersectBatchSize = 128;
+
+template <class Reader>
+struct IntersectBuffer {
+  explicit IntersectBuffer(Reader& r) : reader(r) {}
+
+  // Returns false at the end of the list.
+  bool fill() {
+    pos = 0;
+    end = size_t(reader.nextBatch(values, kIntersectBatchSize));
+    return end != 0;
+  }
+
+  Reader& reader;
+  typename Reader::ValueType values[kIntersectBatchSize];
+  size_t pos = 0;
+  size_t end = 0;
+};
+
+template <class Value, class ShortReader, class LongReader, class Output>
+Output intersectBySkipping(ShortReader& a, LongReader& b, Output out) {
+  while (a.next()) {
+    auto v = Value(a.value());
+    // b may already be past v, after skipping over earlier values of a;
+    // skipTo() requires a target at least at its current value
+    if (!b.valid() || Value(b.value()) < v) {
+      if (!b.skipTo(v)) {
+        break;
+      }
+    }
+    if (Value(b.value()) == v) {
+      *out++ = v;
+    }
+  }
+  return out;
+}
+
+template <class Value, class ReaderA, class ReaderB, class Output>
+Output intersectByMerging(ReaderA& a, ReaderB& b, Output out) {
+  IntersectBuffer<ReaderA> bufA(a);
+  IntersectBuffer<ReaderB> bufB(b);
+  if (!bufA.fill() || !bufB.fill()) {
+    return out;
+  }
+  while (true) {
+    while (bufA.pos < bufA.end && bufB.pos < bufB.end) {
+      auto va = Value(bufA.values[bufA.pos]);
+      auto vb = Value(bufB.values[bufB.pos]);
+      if (va == vb) {
+        *out++ = va;
+      }
+      bufA.pos += va <= vb;
+      bufB.pos += vb <= va;
+    }
+    if (bufA.pos == bufA.end && !bufA.fill()) {
+      break;
+    }
+    if (bufB.pos == bufB.end && !bufB.fill()) {
+      break;
+    }
+  }
+  return out;
+}
+
+} // namespace detail
+
+/**
+ * Writes the values present in both lists to out, in increasing order,
+ * and returns the output iterator past them.  Both readers must be at
+ * the start of their lists and checked (kUnchecked = false); they are
+ * left at unspecified positions.
+ */
+template <class ReaderA, class ReaderB, class Output>
+Output intersect(ReaderA& a, ReaderB& b, Output out) {
+  using Value = typename std::common_type<
+      typename ReaderA::ValueType,
+      typename ReaderB::ValueType>::type;
+  size_t sizeA = a.size();
+  size_t sizeB = b.size();
+  if (sizeA == 0 || sizeB == 0) {
+    return out;
+  }
+  if (sizeB / sizeA >= detail::kIntersectSkipRatio) {
+    return detail::intersectBySkipping<Value>(a, b, out);
+  }
+  if (sizeA / sizeB >= detail::kIntersectSkipRatio) {
+    return detail::intersectBySkipping<Value>(b, a, out);
+  }
+  return detail::intersectByMerging<Value>(a, b, out);
+}
+
+} // namespace compression
+} // namespace folly
@@ -378,6 +378,29 @@ class UpperBitsReader : ForwardPointers<Encoder::forwardQuantum>,
     return setValue(inner);
   }
 
+  // Equivalent to n calls to next(), storing each value in out.  Working
+  // on local copies of the state keeps it in registers.
+  void nextBatch(ValueType* out, SizeType n) {
+    DCHECK_GT(n, 0);
+    auto block = block_;
+    auto outer = outer_;
+    auto position = position_;
+    for (SizeType i = 0; i < n; ++i) {
+      while (block == 0) {
+        outer += sizeof(block_t);
+        block = folly::loadUnaligned<block_t>(start_ + outer);
+      }
+      ++position;
+      out[i] = static_cast<ValueType>(
+          8 * outer + Instructions::ctz(block) - position);
+      block = Instructions::blsr(block);
+    }
+    block_ = block;
+    outer_ = outer;
+    position_ = position;
+    value_ = out[n - 1];
+  }
+
   ValueType skip(SizeType n) {
     DCHECK_GT(n, 0);
 
@@ -601,6 +624,34 @@ class EliasFanoReader {
     return true;
   }
 
+  /**
+   * Decodes up to n values following the current one into out, and moves
+   * to the last of them.  Returns the number of values decoded, which is
+   * less than n only at the end of the list; 0 leaves the reader done.
+   *
+   * Faster than calling next() in a loop: the upper bits are scanned in
+   * one pass, then the lower bits are merged in a separate loop.
+   */
+  SizeType nextBatch(ValueType* out, SizeType n) {
+    const SizeType first = position() + 1; // 0 before the first next().
+    if (!kUnchecked) {
+      if (UNLIKELY(first >= size_)) {
+        setDone();
+        return 0;
+      }
+      n = std::min<SizeType>(n, size_ - first);
+    }
+    if (UNLIKELY(n == 0)) {
+      return 0;
+    }
+    upper_.nextBatch(out, n);
+    for (SizeType i = 0; i < n; ++i) {
+      out[i] = readLowerPart(first + i) | (out[i] << numLowerBits_);
+    }
+    value_ = out[n - 1];
+    return n;
+  }
+
   bool skip(SizeType n) {
     CHECK_GT(n, 0);
 
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/EventBaseProfiler.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <signal.h>
+
+#include <glog/logging.h>
+
+#include <folly/Demangle.h>
+#include <folly/Format.h>
+#include <folly/Portability.h>
+#include <folly/portability/Config.h>
+
+#ifdef FOLLY_USE_SYMBOLIZER
+#include <folly/experimental/symbolizer/StackTrace.h> // @manual
+#include <folly/experimental/symbolizer/Symbolizer.h> // @manual
+#endif
+
+namespace folly {
+
+namespace {
+
+// How often the EventBase thread adds its numbers to the time series
+constexpr auto kFlushInterval = std::chrono::milliseconds(1);
+
+// The profiler of the callback running in this thread, for the signal
+// handler
+FOLLY_TLS EventBaseProfiler* currentProfiler = nullptr;
+
+const char* phaseName(EventBaseLoopProfiler::Phase phase) {
+  switch (phase) {
+    case EventBaseLoopProfiler::Phase::POLL:
+      return "poll";
+    case EventBaseLoopProfiler::Phase::IO:
+      return "I/O";
+    case EventBaseLoopProfiler::Phase::TIMER:
+      return "timer";
+    case EventBaseLoopProfiler::Phase::LOOP_CALLBACK:
+      return "loop";
+    case EventBaseLoopProfiler::Phase::FUNCTION:
+      return "function";
+  }
+  return "unknown";
+}
+
+int64_t toMicros(EventBaseProfiler::Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+} // namespace
+
+constexpr size_t EventBaseProfiler::kMaxFrames;
+
+std::string EventBaseProfiler::SlowCallback::symbolizeStackTrace() const {
+  if (stackTrace.empty()) {
+    return "";
+  }
+#ifdef FOLLY_USE_SYMBOLIZER
+  std::vector<symbolizer::SymbolizedFrame> frames(stackTrace.size());
+  symbolizer::Symbolizer symbolizer;
+  symbolizer.symbolize(stackTrace.data(), frames.data(), frames.size());
+  symbolizer::StringSymbolizePrinter printer;
+  printer.println(stackTrace.data(), frames.data(), frames.size());
+  return printer.str();
+#else
+  std::string out;
+  for (auto address : stackTrace) {
+    out += sformat("    @ {:016x}\n", address);
+  }
+  return out;
+#endif
+}
+
+EventBaseProfiler::EventBaseProfiler(
+    EventBase* evb,
+    Options options,
+    SlowCallbackFunc func)
+    : evb_(evb),
+      options_(options),
+      slowCallbackFunc_(std::move(func)),
+      iterationSeries_(options.numBuckets, options.window),
+      slowCallbackSeries_(options.numBuckets, options.window) {
+  phaseSeries_.reserve(kNumPhases);
+  for (size_t i = 0; i < kNumPhases; ++i) {
+    phaseSeries_.emplace_back(options.numBuckets, options.window);
+  }
+  lastFlush_ = Clock::now();
+
+  if (options_.stackTraceSignal != 0 &&
+      options_.slowCallbackThreshold.count() > 0) {
+#ifdef FOLLY_USE_SYMBOLIZER
+    installSignalHandler(options_.stackTraceSignal);
+    watchdog_ = std::thread([this] { watch(); });
+#else
+    LOG(WARNING) << "EventBaseProfiler: built without the symbolizer, "
+                 << "no stack traces for slow callbacks";
+#endif
+  }
+
+  evb_->setLoopProfiler(this);
+}
+
+EventBaseProfiler::~EventBaseProfiler() {
+  evb_->setLoopProfiler(nullptr);
+  if (watchdog_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(watchMutex_);
+      stopping_ = true;
+    }
+    watchCond_.notify_one();
+    watchdog_.join();
+  }
+  if (currentProfiler == this) {
+    currentProfiler = nullptr;
+  }
+}
+
+EventBaseProfiler::TimeSeries EventBaseProfiler::getTimeSeries(
+    Phase phase) const {
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+  return phaseSeries_[size_t(phase)];
+}
+
+EventBaseProfiler::TimeSeries EventBaseProfiler::getIterationTimeSeries()
+    const {
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+  return iterationSeries_;
+}
+
+EventBaseProfiler::TimeSeries EventBaseProfiler::getSlowCallbackTimeSeries()
+    const {
+  std::lock_guard<std::mutex> lock(seriesMutex_);
+  return slowCallbackSeries_;
+}
+
+void EventBaseProfiler::iterationStarting() noexcept {
+  iterationStart_ = Clock::now();
+  iterationCallbackTime_ = Clock::duration::zero();
+}
+
+void EventBaseProfiler::iterationDone() noexcept {
+  auto now = Clock::now();
+  auto iterationTime = now - iterationStart_;
+  pendingTime_[size_t(Phase::POLL)] +=
+      toMicros(iterationTime - iterationCallbackTime_);
+  pendingIterationTime_ += toMicros(iterationTime);
+  ++pendingIterations_;
+  if (now - lastFlush_ >= kFlushInterval) {
+    flush(now);
+  }
+}
+
+void EventBaseProfiler::flush(Clock::time_point now) {
+  {
+    std::lock_guard<std::mutex> lock(seriesMutex_);
+    for (size_t i = 0; i < kNumPhases; ++i) {
+      phaseSeries_[i].addValueAggregated(
+          now, pendingTime_[i], pendingIterations_);
+    }
+    iterationSeries_.addValueAggregated(
+        now, pendingIterationTime_, pendingIterations_);
+  }
+  for (auto& time : pendingTime_) {
+    time = 0;
+  }
+  pendingIterationTime_ = 0;
+  pendingIterations_ = 0;
+  lastFlush_ = now;
+}
+
+void EventBaseProfiler::callbackStarting(
+    Phase phase,
+    const std::type_info* type) noexcept {
+  // Callbacks run by callbacks are part of them
+  if (depth_++ > 0) {
+    return;
+  }
+  phase_ = phase;
+  type_ = type;
+  callbackStart_ = Clock::now();
+
+  if (watchdog_.joinable()) {
+    currentProfiler = this;
+    if (!hasLoopThread_.load(std::memory_order_relaxed)) {
+      loopThread_ = pthread_self();
+      hasLoopThread_.store(true, std::memory_order_release);
+    }
+    callbackStartTime_.store(
+        callbackStart_.time_since_epoch().count(), std::memory_order_relaxed);
+    callbackSeq_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void EventBaseProfiler::callbackStopped() noexcept {
+  DCHECK_GT(depth_, 0);
+  if (--depth_ > 0) {
+    return;
+  }
+  auto time = Clock::now() - callbackStart_;
+  iterationCallbackTime_ += time;
+  pendingTime_[size_t(phase_)] += toMicros(time);
+
+  if (options_.slowCallbackThreshold.count() > 0 &&
+      time > options_.slowCallbackThreshold) {
+    reportSlowCallback(
+        std::chrono::duration_cast<std::chrono::microseconds>(time));
+  } else if (watchdog_.joinable()) {
+    callbackSeq_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void EventBaseProfiler::reportSlowCallback(
+    std::chrono::microseconds duration) {
+  SlowCallback slow;
+  slow.phase = phase_;
+  if (type_) {
+    slow.name = demangle(*type_).toStdString();
+  }
+  slow.duration = duration;
+  if (watchdog_.joinable()) {
+    // No stack is captured for this callback from now on
+    auto seq = callbackSeq_.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_signal_fence(std::memory_order_acquire);
+    auto frames = capturedFrames_.load(std::memory_order_relaxed);
+    if (capturedSeq_.load(std::memory_order_relaxed) == seq && frames > 0) {
+      slow.stackTrace.assign(capturedStack_, capturedStack_ + frames);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(seriesMutex_);
+    slowCallbackSeries_.addValue(Clock::now(), duration.count());
+  }
+
+  if (slowCallbackFunc_) {
+    slowCallbackFunc_(slow);
+  } else {
+    LOG(WARNING) << "EventBase " << evb_ << ": " << phaseName(slow.phase)
+                 << " callback " << slow.name << " ran for "
+                 << slow.duration.count() << "us\n"
+                 << slow.symbolizeStackTrace();
+  }
+}
+
+void EventBaseProfiler::watch() {
+  auto interval = std::max<Clock::duration>(
+      options_.slowCallbackThreshold / 2, std::chrono::milliseconds(1));
+  std::unique_lock<std::mutex> lock(watchMutex_);
+  while (!watchCond_.wait_for(lock, interval, [&] { return stopping_; })) {
+    auto seq = callbackSeq_.load(std::memory_order_acquire);
+    if (seq % 2 == 0 || seq == signaledSeq_.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    auto start =
+        Clock::time_point(Clock::duration(callbackStartTime_.load(
+            std::memory_order_relaxed)));
+    if (Clock::now() - start <= options_.slowCallbackThreshold ||
+        callbackSeq_.load(std::memory_order_acquire) != seq ||
+        !hasLoopThread_.load(std::memory_order_acquire)) {
+      continue;
+    }
+    signaledSeq_.store(seq, std::memory_order_release);
+    pthread_kill(loopThread_, options_.stackTraceSignal);
+  }
+}
+
+void EventBaseProfiler::installSignalHandler(int signo) {
+  static std::mutex mutex;
+  static std::vector<int> installed;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (std::find(installed.begin(), installed.end(), signo) !=
+      installed.end()) {
+    return;
+  }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = &EventBaseProfiler::signalHandler;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  PCHECK(sigaction(signo, &sa, nullptr) == 0);
+  installed.push_back(signo);
+}
+
+void EventBaseProfiler::signalHandler(int /* signo */) {
+#ifdef FOLLY_USE_SYMBOLIZER
+  auto profiler = currentProfiler;
+  if (!profiler) {
+    return;
+  }
+  // Only capture the stack of the callback we were asked about
+  auto seq = profiler->callbackSeq_.load(std::memory_order_relaxed);
+  if (seq != profiler->signaledSeq_.load(std::memory_order_acquire)) {
+    return;
+  }
+  int savedErrno = errno;
+  auto frames =
+      symbolizer::getStackTraceSafe(profiler->capturedStack_, kMaxFrames);
+  profiler->capturedFrames_.store(frames, std::memory_order_relaxed);
+  profiler->capturedSeq_.store(seq, std::memory_order_relaxed);
+  std::atomic_signal_fence(std::memory_order_release);
+  errno = savedErrno;
+#endif
+}
+
+} // namespace folly
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Profiles the loop of an EventBase: how long its iterations take and what
+ * they spend that time on (waiting for events, I/O handlers, timers, loop
+ * callbacks and runInEventBaseThread() functions), and which callbacks
+ * block the loop for longer than a threshold.
+ *
+ *   EventBaseProfiler::Options options;
+ *   options.slowCallbackThreshold = std::chrono::milliseconds(10);
+ *   options.stackTraceSignal = SIGPROF;
+ *   EventBaseProfiler profiler(&evb, options);
+ *   ...
+ *   auto io = profiler.getTimeSeries(EventBaseLoopProfiler::Phase::IO);
+ *   io.update(EventBaseProfiler::Clock::now());
+ *   LOG(INFO) << "I/O handlers: " << io.avg() << "us per iteration";
+ *
+ * Slow callbacks are reported once they return.  To also know what they
+ * were doing, give a stackTraceSignal: a thread then watches the loop, and
+ * sends the signal to the EventBase thread when a callback has run for
+ * longer than the threshold, to capture its stack trace.  This requires
+ * the symbolizer, and the EventBase must always loop in the same thread.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include <folly/Function.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/stats/BucketedTimeSeries.h>
+
+namespace folly {
+
+class EventBaseProfiler : public EventBaseLoopProfiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  /**
+   * Values are in microseconds.  Every iteration adds a value to the
+   * series of each phase and to the iteration series; slow callbacks add
+   * their duration to the slow callback series.
+   */
+  using TimeSeries = BucketedTimeSeries<int64_t, Clock>;
+
+  struct Options {
+    Clock::duration window{std::chrono::seconds(60)};
+    size_t numBuckets{60};
+    // Callbacks that run for longer are slow; 0 doesn't look for them
+    std::chrono::microseconds slowCallbackThreshold{0};
+    // Signal that captures the stack of slow callbacks, 0 for none.  Its
+    // handler stays installed, and nothing else may use it.
+    int stackTraceSignal{0};
+  };
+
+  struct SlowCallback {
+    Phase phase;
+    // Demangled type of the callback, empty for functions
+    std::string name;
+    std::chrono::microseconds duration;
+    // Captured while the callback ran, empty if it wasn't
+    std::vector<uintptr_t> stackTrace;
+
+    // Slow, don't call it in the EventBase thread
+    std::string symbolizeStackTrace() const;
+  };
+
+  using SlowCallbackFunc = Function<void(const SlowCallback&)>;
+
+  /**
+   * Starts profiling evb; must be called from its thread, or before its
+   * loop starts.  func runs in the EventBase thread after each slow
+   * callback; they are logged by default.
+   */
+  EventBaseProfiler(
+      EventBase* evb,
+      Options options,
+      SlowCallbackFunc func = nullptr);
+
+  // Same threads as the constructor
+  ~EventBaseProfiler() override;
+
+  EventBaseProfiler(const EventBaseProfiler&) = delete;
+  EventBaseProfiler& operator=(const EventBaseProfiler&) = delete;
+
+  // Any thread; update() the copies before reading them.
+  TimeSeries getTimeSeries(Phase phase) const;
+  TimeSeries getIterationTimeSeries() const;
+  TimeSeries getSlowCallbackTimeSeries() const;
+
+  void iterationStarting() noexcept override;
+  void iterationDone() noexcept override;
+  void callbackStarting(Phase phase, const std::type_info* type) noexcept
+      override;
+  void callbackStopped() noexcept override;
+
+ private:
+  static constexpr size_t kMaxFrames = 64;
+
+  void flush(Clock::time_point now);
+  void reportSlowCallback(std::chrono::microseconds duration);
+
+  void watch();
+  static void installSignalHandler(int signo);
+  static void signalHandler(int signo);
+
+  EventBase* const evb_;
+  const Options options_;
+  SlowCallbackFunc slowCallbackFunc_;
+
+  // Used by the EventBase thread only
+  Clock::time_point iterationStart_;
+  Clock::duration iterationCallbackTime_{0};
+  size_t depth_{0};
+  Phase phase_{Phase::POLL};
+  const std::type_info* type_{nullptr};
+  Clock::time_point callbackStart_;
+  // Not flushed to the time series yet, in microseconds
+  int64_t pendingTime_[kNumPhases]{};
+  int64_t pendingIterationTime_{0};
+  uint64_t pendingIterations_{0};
+  Clock::time_point lastFlush_;
+
+  // Shared with the watchdog thread and the signal handler: the sequence
+  // number of the running callback is odd
+  std::atomic<uint64_t> callbackSeq_{0};
+  std::atomic<Clock::rep> callbackStartTime_{0};
+  std::atomic<uint64_t> signaledSeq_{0};
+  std::atomic<uint64_t> capturedSeq_{0};
+  std::atomic<ssize_t> capturedFrames_{0};
+  uintptr_t capturedStack_[kMaxFrames];
+  std::atomic<bool> hasLoopThread_{false};
+  pthread_t loopThread_;
+
+  mutable std::mutex seriesMutex_;
+  std::vector<TimeSeries> phaseSeries_;
+  TimeSeries iterationSeries_;
+  TimeSeries slowCallbackSeries_;
+
+  std::mutex watchMutex_;
+  std::condition_variable watchCond_;
+  bool stopping_{false};
+  std::thread watchdog_;
+};
+
+} // namespace folly
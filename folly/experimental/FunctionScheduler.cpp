@@ -16,6 +16,7 @@
 
 #include <folly/experimental/FunctionScheduler.h>
 
+#include <algorithm>
 #include <random>
 
 #include <folly/Conv.h>
@@ -30,6 +31,10 @@ namespace folly {
 
 namespace {
 
+// A power of 2, so that finding a slot is cheap.  With 10ms ticks, the wheel
+// turns every 41s.
+constexpr size_t kWheelSlots = 4096;
+
 struct ConstIntervalFunctor {
   const milliseconds constInterval;
 
@@ -92,6 +97,16 @@ FunctionScheduler::~FunctionScheduler() {
   shutdown();
 }
 
+void FunctionScheduler::setTimerWheelTick(milliseconds tick) {
+  if (tick <= milliseconds::zero()) {
+    throw std::invalid_argument(
+        "FunctionScheduler: timer wheel tick must be positive");
+  }
+  std::unique_lock<std::mutex> l(mutex_);
+  wheelTick_ = tick;
+  wheel_.resize(kWheelSlots);
+}
+
 void FunctionScheduler::addFunction(Function<void()>&& cb,
                                     milliseconds interval,
                                     StringPiece nameID,
@@ -249,10 +264,12 @@ bool FunctionScheduler::cancelFunctionAndWait(StringPiece nameID) {
   }
 
   auto it = functionsMap_.find(nameID);
-    if (it != functionsMap_.end() && it->second->isValid()) {
-      cancelFunction(l, it->second);
-      return true;
-    }
+  if (it != functionsMap_.end() && it->second->isValid()) {
+    auto cb = it->second->cb;
+    cancelFunction(l, it->second);
+    dispatchedCondvar_.wait(l, [&]() { return !cb->running; });
+    return true;
+  }
   return false;
 }
 
@@ -269,6 +286,10 @@ bool FunctionScheduler::cancelAllFunctionsWithLock(
     std::unique_lock<std::mutex>& lock) {
   CHECK_EQ(lock.owns_lock(), true);
   functions_.clear();
+  for (auto& slot : wheel_) {
+    slot.clear();
+  }
+  wheelCount_ = 0;
   functionsMap_.clear();
   if (currentFunction_) {
     cancellingCurrentFunction_ = true;
@@ -287,6 +308,7 @@ void FunctionScheduler::cancelAllFunctionsAndWait() {
   if (cancelAllFunctionsWithLock(l)) {
     runningCondvar_.wait(l, [this]() { return !cancellingCurrentFunction_; });
   }
+  dispatchedCondvar_.wait(l, [this]() { return dispatched_ == 0; });
 }
 
 bool FunctionScheduler::resetFunctionTimer(StringPiece nameID) {
@@ -321,6 +343,15 @@ bool FunctionScheduler::start() {
     return false;
   }
 
+  // Functions left in the wheel by shutdown()
+  for (auto& slot : wheel_) {
+    for (auto& f : slot) {
+      functions_.push_back(std::move(f));
+    }
+    slot.clear();
+  }
+  wheelCount_ = 0;
+
   VLOG(1) << "Starting FunctionScheduler with " << functions_.size()
           << " functions.";
   auto now = steady_clock::now();
@@ -332,7 +363,16 @@ bool FunctionScheduler::start() {
             << ", period = " << f->intervalDescr
             << ", delay = " << f->startDelay.count() << "ms";
   }
-  std::make_heap(functions_.begin(), functions_.end(), fnCmp_);
+  if (wheelTick_ > milliseconds::zero()) {
+    wheelEpoch_ = now;
+    wheelCursor_ = 0;
+    for (auto& f : functions_) {
+      addFunctionToWheel(std::move(f));
+    }
+    functions_.clear();
+  } else {
+    std::make_heap(functions_.begin(), functions_.end(), fnCmp_);
+  }
 
   thread_ = std::thread([&] { this->run(); });
   running_ = true;
@@ -351,6 +391,8 @@ bool FunctionScheduler::shutdown() {
     runningCondvar_.notify_one();
   }
   thread_.join();
+  std::unique_lock<std::mutex> l(mutex_);
+  dispatchedCondvar_.wait(l, [this]() { return dispatched_ == 0; });
   return true;
 }
 
@@ -362,6 +404,11 @@ void FunctionScheduler::run() {
   }
 
   while (running_) {
+    if (wheelTick_ > milliseconds::zero()) {
+      runWheel(lock);
+      continue;
+    }
+
     // If we have nothing to run, wait until a function is added or until we
     // are stopped.
     if (functions_.empty()) {
@@ -384,7 +431,9 @@ void FunctionScheduler::run() {
     auto sleepTime = functions_.back()->getNextRunTime() - now;
     if (sleepTime < milliseconds::zero()) {
       // We need to run this function now
-      runOneFunction(lock, now);
+      auto func = std::move(functions_.back());
+      functions_.pop_back();
+      runOneFunction(lock, now, std::move(func));
       runningCondvar_.notify_all();
     } else {
       // Re-add the function to the heap, and wait until we actually
@@ -395,35 +444,96 @@ void FunctionScheduler::run() {
   }
 }
 
-void FunctionScheduler::runOneFunction(std::unique_lock<std::mutex>& lock,
-                                       steady_clock::time_point now) {
-  DCHECK(lock.mutex() == &mutex_);
-  DCHECK(lock.owns_lock());
+void FunctionScheduler::runWheel(std::unique_lock<std::mutex>& lock) {
+  // If we have nothing to run, wait until a function is added or until we
+  // are stopped.
+  if (wheelCount_ == 0) {
+    runningCondvar_.wait(lock);
+    return;
+  }
 
-  // The function to run will be at the end of functions_ already.
-  //
-  // Fully remove it from functions_ now.
-  // We need to release mutex_ while we invoke this function, and we need to
-  // maintain the heap property on functions_ while mutex_ is unlocked.
-  auto func = std::move(functions_.back());
-  functions_.pop_back();
-  if (!func->cb) {
-    VLOG(5) << func->name << "function has been canceled while waiting";
+  auto now = steady_clock::now();
+  if (tickTime(wheelCursor_) > now) {
+    // Wait until the next slot with functions in it (or a turn of the wheel,
+    // if they are all due later), or until a function is added
+    int64_t tick = wheelCursor_;
+    int64_t end = wheelCursor_ + int64_t(wheel_.size());
+    while (tick < end && wheel_[tick & (wheel_.size() - 1)].empty()) {
+      ++tick;
+    }
+    runningCondvar_.wait_until(lock, tickTime(tick));
     return;
   }
-  currentFunction_ = func.get();
-  // Update the function's next run time.
+
+  // Take the functions due in this tick out of its slot (as well as the
+  // cancelled ones, which are dropped)
+  auto& slot = wheel_[wheelCursor_ & (wheel_.size() - 1)];
+  FunctionHeap due;
+  for (size_t i = 0; i < slot.size();) {
+    if (!slot[i]->isValid() ||
+        toTick(slot[i]->getNextRunTime()) <= wheelCursor_) {
+      due.push_back(std::move(slot[i]));
+      slot[i] = std::move(slot.back());
+      slot.pop_back();
+      --wheelCount_;
+    } else {
+      ++i;
+    }
+  }
+  ++wheelCursor_;
+  // The last tick before now, rather than the tick of the slot, which may
+  // be behind if functions took long to run: that's a catch up, which only
+  // setSteady() asks for
+  auto tickNow = tickTime((now - wheelEpoch_) / wheelTick_);
+
+  for (auto& func : due) {
+    if (!running_) {
+      // Stopped while running the functions before it: keep it for start()
+      functions_.push_back(std::move(func));
+      continue;
+    }
+    runOneFunction(lock, tickNow, std::move(func));
+  }
+  runningCondvar_.notify_all();
+}
+
+void FunctionScheduler::setNextRunTime(
+    RepeatFunc& func,
+    steady_clock::time_point now) {
   if (steady_) {
     // This allows scheduler to catch up
-    func->setNextRunTimeSteady();
+    func.setNextRunTimeSteady();
   } else {
     // Note that we set nextRunTime based on the current time where we started
     // the function call, rather than the time when the function finishes.
     // This ensures that we call the function once every time interval, as
     // opposed to waiting time interval seconds between calls.  (These can be
     // different if the function takes a significant amount of time to run.)
-    func->setNextRunTimeStrict(now);
+    func.setNextRunTimeStrict(now);
   }
+}
+
+void FunctionScheduler::runOneFunction(
+    std::unique_lock<std::mutex>& lock,
+    steady_clock::time_point now,
+    std::unique_ptr<RepeatFunc> func) {
+  DCHECK(lock.mutex() == &mutex_);
+  DCHECK(lock.owns_lock());
+
+  // The function to run has been removed from functions_ (or wheel_).
+  // We need to release mutex_ while we invoke this function, and we need to
+  // maintain the heap property on functions_ while mutex_ is unlocked.
+  if (!func->cb) {
+    VLOG(5) << func->name << "function has been canceled while waiting";
+    return;
+  }
+  if (executor_) {
+    dispatchFunction(lock, now, std::move(func));
+    return;
+  }
+  currentFunction_ = func.get();
+  // Update the function's next run time.
+  setNextRunTime(*func, now);
 
   // Release the lock while we invoke the user's function
   lock.unlock();
@@ -431,7 +541,7 @@ void FunctionScheduler::runOneFunction(std::unique_lock<std::mutex>& lock,
   // Invoke the function
   try {
     VLOG(5) << "Now running " << func->name;
-    func->cb();
+    func->cb->fn();
   } catch (const std::exception& ex) {
     LOG(ERROR) << "Error running the scheduled function <"
       << func->name << ">: " << exceptionStr(ex);
@@ -453,19 +563,105 @@ void FunctionScheduler::runOneFunction(std::unique_lock<std::mutex>& lock,
     return;
   }
 
-  // Re-insert the function into our functions_ heap.
-  // We only maintain the heap property while running_ is set.  (running_ may
-  // have been cleared while we were invoking the user's function.)
-  functions_.push_back(std::move(func));
-
   // Clear currentFunction_
   currentFunction_ = nullptr;
 
+  // Re-insert the function into our functions_ heap.
+  scheduleFunction(lock, std::move(func));
+}
+
+void FunctionScheduler::dispatchFunction(
+    std::unique_lock<std::mutex>& lock,
+    steady_clock::time_point now,
+    std::unique_ptr<RepeatFunc> func) {
+  auto cb = func->cb;
+  auto name = func->name;
+  bool dispatch = !cb->running;
+  if (dispatch) {
+    cb->running = true;
+    ++dispatched_;
+  } else {
+    VLOG(5) << name << " is still running, skipping this run";
+  }
+
+  // Schedule the next run now, rather than once this one completes, which
+  // may well be after it's due
+  if (func->runOnce) {
+    functionsMap_.erase(func->name);
+  } else {
+    setNextRunTime(*func, now);
+    scheduleFunction(lock, std::move(func));
+  }
+  if (!dispatch) {
+    return;
+  }
+
+  // The executor may run it inline
+  lock.unlock();
+  auto run = [this, cb, name] {
+    try {
+      VLOG(5) << "Now running " << name;
+      cb->fn();
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Error running the scheduled function <" << name
+                 << ">: " << exceptionStr(ex);
+    }
+    std::lock_guard<std::mutex> g(mutex_);
+    cb->running = false;
+    --dispatched_;
+    dispatchedCondvar_.notify_all();
+  };
+  try {
+    executor_->add(std::move(run));
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Error adding the scheduled function <" << name
+               << "> to the executor: " << exceptionStr(ex);
+    std::lock_guard<std::mutex> g(mutex_);
+    cb->running = false;
+    --dispatched_;
+    dispatchedCondvar_.notify_all();
+  }
+  lock.lock();
+}
+
+void FunctionScheduler::scheduleFunction(
+    const std::unique_lock<std::mutex>& lock,
+    std::unique_ptr<RepeatFunc> func) {
+  DCHECK(lock.mutex() == &mutex_);
+  DCHECK(lock.owns_lock());
+
+  // We only maintain the heap property (and the wheel) while running_ is
+  // set.  (running_ may have been cleared while we were invoking the user's
+  // function.)  start() takes care of the functions added otherwise.
+  if (running_ && wheelTick_ > milliseconds::zero()) {
+    addFunctionToWheel(std::move(func));
+    return;
+  }
+  functions_.push_back(std::move(func));
   if (running_) {
     std::push_heap(functions_.begin(), functions_.end(), fnCmp_);
   }
 }
 
+void FunctionScheduler::addFunctionToWheel(std::unique_ptr<RepeatFunc> func) {
+  auto tick = std::max(toTick(func->getNextRunTime()), wheelCursor_);
+  wheel_[tick & (wheel_.size() - 1)].push_back(std::move(func));
+  ++wheelCount_;
+}
+
+int64_t FunctionScheduler::toTick(steady_clock::time_point time) const {
+  auto sinceEpoch = time - wheelEpoch_;
+  if (sinceEpoch <= steady_clock::duration::zero()) {
+    return 0;
+  }
+  // Rounded up, so that functions don't run early
+  return (sinceEpoch + wheelTick_ - steady_clock::duration(1)) / wheelTick_;
+}
+
+steady_clock::time_point FunctionScheduler::tickTime(int64_t tick) const {
+  return wheelEpoch_ + tick * wheelTick_;
+}
+
 void FunctionScheduler::addFunctionToHeap(
     const std::unique_lock<std::mutex>& lock,
     std::unique_ptr<RepeatFunc> func) {
@@ -473,14 +669,15 @@ void FunctionScheduler::addFunctionToHeap(
   DCHECK(lock.mutex() == &mutex_);
   DCHECK(lock.owns_lock());
 
-  functions_.push_back(std::move(func));
-  functionsMap_[functions_.back()->name] = functions_.back().get();
+  functionsMap_[func->name] = func.get();
   if (running_) {
-    functions_.back()->resetNextRunTime(steady_clock::now());
-    std::push_heap(functions_.begin(), functions_.end(), fnCmp_);
+    func->resetNextRunTime(steady_clock::now());
+    scheduleFunction(lock, std::move(func));
     // Signal the running thread to wake up and see if it needs to change
     // its current scheduling decision.
     runningCondvar_.notify_one();
+  } else {
+    functions_.push_back(std::move(func));
   }
 }
 
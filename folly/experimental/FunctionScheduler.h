@@ -16,11 +16,13 @@
 
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/hash/Hash.h>
 #include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -43,8 +45,10 @@ namespace folly {
  *   fs.shutdown();
  *
  *
- * Note: the class uses only one thread - if you want to use more than one
- *       thread, either use multiple FunctionScheduler objects, or check out
+ * Note: by default the class uses only one thread, which runs the functions
+ *       one after the other, so a slow function delays the others.  To run
+ *       them on more threads, give it an executor with setExecutor(), use
+ *       multiple FunctionScheduler objects, or check out
  *       ThreadedRepeatingFunctionRunner.h for a much simpler contract of
  *       "run each function periodically in its own thread".
  *
@@ -67,6 +71,33 @@ class FunctionScheduler {
    */
   void setSteady(bool steady) { steady_ = steady; }
 
+  /**
+   * Runs the functions on executor rather than on the scheduler's thread,
+   * which then only keeps time, so that a slow function doesn't delay the
+   * others.  A run of a function that comes due while its previous run is
+   * still in progress is skipped.  shutdown() (and so the destructor) waits
+   * for the runs in progress, as do the cancel*AndWait() functions for the
+   * functions they cancel.
+   *
+   * NOTE: it's only safe to set this before calling start()
+   */
+  void setExecutor(Executor* executor) { executor_ = executor; }
+
+  /**
+   * Keeps the functions on a timing wheel with slots of tick, rather than
+   * in a heap, so that scheduling a run takes constant time, however many
+   * functions there are: use this for tens of thousands of functions.
+   *
+   * Run times are rounded up to a multiple of tick, so functions due within
+   * the same tick run together, in a batch; and without setSteady(), the
+   * next run of a function is computed from the tick it ran in, rather than
+   * from when the scheduler got to it, so functions with the same interval
+   * stay in step rather than drifting apart.
+   *
+   * NOTE: it's only safe to call this before calling start()
+   */
+  void setTimerWheelTick(std::chrono::milliseconds tick);
+
   /*
    * Parameters to control the function interval.
    *
@@ -201,8 +232,17 @@ class FunctionScheduler {
   void setThreadName(StringPiece threadName);
 
  private:
+  struct Callback {
+    explicit Callback(Function<void()>&& f) : fn(std::move(f)) {}
+
+    Function<void()> fn;
+    // Whether a run is in progress on the executor.  Protected by mutex_.
+    bool running{false};
+  };
+
   struct RepeatFunc {
-    Function<void()> cb;
+    // Shared with the runs in progress on the executor, if any
+    std::shared_ptr<Callback> cb;
     IntervalDistributionFunc intervalFunc;
     std::chrono::steady_clock::time_point nextRunTime;
     std::string name;
@@ -217,7 +257,7 @@ class FunctionScheduler {
         const std::string& intervalDistDescription,
         std::chrono::milliseconds delay,
         bool once)
-        : cb(std::move(cback)),
+        : cb(std::make_shared<Callback>(std::move(cback))),
           intervalFunc(std::move(intervalFn)),
           nextRunTime(),
           name(nameID),
@@ -236,8 +276,8 @@ class FunctionScheduler {
       nextRunTime = curTime + startDelay;
     }
     void cancel() {
-      // Simply reset cb to an empty function.
-      cb = {};
+      // Simply reset cb to an empty pointer.
+      cb = nullptr;
     }
     bool isValid() const { return bool(cb); }
   };
@@ -252,12 +292,30 @@ class FunctionScheduler {
   typedef std::unordered_map<StringPiece, RepeatFunc*, Hash> FunctionMap;
 
   void run();
-  void runOneFunction(std::unique_lock<std::mutex>& lock,
-                      std::chrono::steady_clock::time_point now);
+  void runWheel(std::unique_lock<std::mutex>& lock);
+  void runOneFunction(
+      std::unique_lock<std::mutex>& lock,
+      std::chrono::steady_clock::time_point now,
+      std::unique_ptr<RepeatFunc> func);
+  void dispatchFunction(
+      std::unique_lock<std::mutex>& lock,
+      std::chrono::steady_clock::time_point now,
+      std::unique_ptr<RepeatFunc> func);
+  void setNextRunTime(
+      RepeatFunc& func,
+      std::chrono::steady_clock::time_point now);
   void cancelFunction(const std::unique_lock<std::mutex>& lock,
                       RepeatFunc* it);
   void addFunctionToHeap(const std::unique_lock<std::mutex>& lock,
                          std::unique_ptr<RepeatFunc> func);
+  // Puts the function in the heap or the wheel, as it is already in
+  // functionsMap_
+  void scheduleFunction(const std::unique_lock<std::mutex>& lock,
+                        std::unique_ptr<RepeatFunc> func);
+  void addFunctionToWheel(std::unique_ptr<RepeatFunc> func);
+  // The first tick at or after time, and the time of a tick
+  int64_t toTick(std::chrono::steady_clock::time_point time) const;
+  std::chrono::steady_clock::time_point tickTime(int64_t tick) const;
 
   void addFunctionInternal(
       Function<void()>&& cb,
@@ -280,7 +338,7 @@ class FunctionScheduler {
   bool running_{false};
 
   // The functions to run.
-  // This is a heap, ordered by next run time.
+  // This is a heap, ordered by next run time (unless it's in wheel_).
   FunctionHeap functions_;
   FunctionMap functionsMap_;
   RunTimeOrder fnCmp_;
@@ -293,6 +351,23 @@ class FunctionScheduler {
   // or when the FunctionScheduler is stopped.
   std::condition_variable runningCondvar_;
 
+  // Signalled whenever a run on executor_ completes.
+  std::condition_variable dispatchedCondvar_;
+  Executor* executor_{nullptr};
+  // The number of runs in progress on executor_.
+  size_t dispatched_{0};
+
+  // While running with a timing wheel, the functions are in wheel_ rather
+  // than in functions_: the functions due at tick t are in slot
+  // t % wheel_.size() (along with some due that many ticks later, etc.),
+  // unordered.  Tick t is at wheelEpoch_ + t * wheelTick_, and the slot of
+  // wheelCursor_ is the next one to run.
+  std::chrono::milliseconds wheelTick_{0};
+  std::vector<FunctionHeap> wheel_;
+  size_t wheelCount_{0};
+  std::chrono::steady_clock::time_point wheelEpoch_;
+  int64_t wheelCursor_{0};
+
   std::string threadName_;
   bool steady_{false};
   bool cancellingCurrentFunction_{false};
@@ -15,11 +15,36 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
 #include <folly/futures/Future.h>
-#include <folly/futures/SharedPromise.h>
 
 namespace folly {
 
+/**
+ * Runs a DAG of asynchronous tasks, each node starting once all the nodes it
+ * depends on have completed.
+ *
+ * Ready nodes are scheduled critical path first: a node's priority is the
+ * longest chain of costs from it to the end of the DAG, so that the nodes
+ * holding up the whole run get executors first.  Nodes on executors with
+ * several priorities (e.g. CPUThreadPoolExecutor) are spread over them with
+ * addWithPriority(), and nodes that become ready together are added most
+ * critical first.  A node's cost is the time it ran for on the previous run,
+ * or the estimate given to setCost().
+ *
+ * A DAG can be run again once its run has completed, reusing its nodes and
+ * bookkeeping; nodes must not be added, removed or connected during a run.
+ * timing() has the time each node spent queued and running on the last run.
+ *
+ * If a node fails, the nodes depending on it, directly or not, are skipped,
+ * and go() fails with the first error once the run has completed.
+ */
 class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
  public:
   static std::shared_ptr<FutureDAG> create() {
@@ -29,7 +54,15 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
   typedef size_t Handle;
   typedef std::function<Future<Unit>()> FutureFunc;
 
+  struct NodeTiming {
+    // From the last of the node's dependencies completing to it starting
+    std::chrono::nanoseconds queued{0};
+    // From the node starting to its future completing
+    std::chrono::nanoseconds running{0};
+  };
+
   Handle add(FutureFunc func, Executor* executor = nullptr) {
+    roots.clear();
     nodes.emplace_back(std::move(func), executor);
     return nodes.size() - 1;
   }
@@ -38,6 +71,7 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
     if (a >= nodes.size()) {
       return;
     }
+    roots.clear();
 
     if (nodes[a].hasDependents) {
       for (auto& node : nodes) {
@@ -70,6 +104,7 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
       }
     }
 
+    roots.clear();
     nodes.erase(nodes.begin(), nodes.begin() + source_node);
     nodes.erase(nodes.begin() + 1, nodes.end());
     nodes[0].hasDependents = false;
@@ -77,112 +112,206 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
   }
 
   void dependency(Handle a, Handle b) {
+    roots.clear();
     nodes[b].dependencies.push_back(a);
     nodes[a].hasDependents = true;
   }
 
-  void clean_state(Handle source, Handle sink) {
-    for (auto handle : nodes[sink].dependencies) {
-      nodes[handle].hasDependents = false;
-    }
-    nodes[0].hasDependents = false;
-    remove(source);
-    remove(sink);
+  /**
+   * Estimated run time of a node, for scheduling, instead of the time it
+   * took on the previous run.  0 goes back to the latter.
+   */
+  void setCost(Handle a, std::chrono::nanoseconds cost) {
+    nodes[a].cost = cost;
   }
 
-  Future<Unit> go() {
-    if (hasCycle()) {
-      return makeFuture<Unit>(std::runtime_error("Cycle in FutureDAG graph"));
+  const NodeTiming& timing(Handle a) const {
+    return nodes[a].timing;
+  }
+
+  /**
+   * The nodes on the costliest chain through the DAG, as of the last go(),
+   * from first to run to last.  Empty if the DAG changed since.
+   */
+  std::vector<Handle> criticalPath() const {
+    std::vector<Handle> path;
+    if (roots.empty()) {
+      return path;
     }
-    std::vector<Handle> rootNodes;
-    std::vector<Handle> leafNodes;
-    for (Handle handle = 0; handle < nodes.size(); handle++) {
-      if (nodes[handle].dependencies.empty()) {
-        rootNodes.push_back(handle);
-      }
-      if (!nodes[handle].hasDependents) {
-        leafNodes.push_back(handle);
+    // The roots and dependents are sorted most critical first
+    for (auto handle = roots.front();; handle = nodes[handle].dependents[0]) {
+      path.push_back(handle);
+      if (nodes[handle].dependents.empty()) {
+        return path;
       }
     }
+  }
 
-    auto sinkHandle = add([] { return Future<Unit>(); });
-    for (auto handle : leafNodes) {
-      dependency(handle, sinkHandle);
+  Future<Unit> go() {
+    if (!prepare()) {
+      return makeFuture<Unit>(std::runtime_error("Cycle in FutureDAG graph"));
     }
-
-    auto sourceHandle = add(nullptr);
-    for (auto handle : rootNodes) {
-      dependency(sourceHandle, handle);
+    if (nodes.empty()) {
+      return makeFuture();
     }
 
-    for (Handle handle = 0; handle < nodes.size() - 1; handle++) {
-      std::vector<Future<Unit>> dependencies;
-      for (auto depHandle : nodes[handle].dependencies) {
-        dependencies.push_back(nodes[depHandle].promise.getFuture());
-      }
-
-      collect(dependencies)
-          .via(nodes[handle].executor)
-          .then([this, handle] {
-            nodes[handle].func().then([this, handle](Try<Unit>&& t) {
-              nodes[handle].promise.setTry(std::move(t));
-            });
-          })
-          .onError([this, handle](exception_wrapper ew) {
-            nodes[handle].promise.setException(std::move(ew));
-          });
+    for (Handle handle = 0; handle < nodes.size(); handle++) {
+      states[handle].pending.store(
+          nodes[handle].dependencies.size(), std::memory_order_relaxed);
+      states[handle].skip.store(false, std::memory_order_relaxed);
     }
+    remaining.store(nodes.size(), std::memory_order_relaxed);
+    failed.store(false, std::memory_order_relaxed);
+    error = exception_wrapper();
+    done = Promise<Unit>();
+    auto future = done.getFuture();
+    // Released when the run completes
+    self = shared_from_this();
 
-    nodes[sourceHandle].promise.setValue();
-    return nodes[sinkHandle].promise.getFuture().then(
-        [that = shared_from_this(), sourceHandle, sinkHandle]() {
-          that->clean_state(sourceHandle, sinkHandle);
-        });
+    auto now = std::chrono::steady_clock::now();
+    for (auto handle : roots) {
+      nodes[handle].ready = now;
+      schedule(handle);
+    }
+    return future;
   }
 
  private:
   FutureDAG() = default;
 
-  bool hasCycle() {
-    // Perform a modified topological sort to detect cycles
-    std::vector<std::vector<Handle>> dependencies;
+  // Sorts the nodes topologically, and works out their priorities.  Returns
+  // false if there is a cycle.
+  bool prepare() {
+    auto size = nodes.size();
+    if (statesCapacity < size) {
+      states.reset(new State[size]);
+      statesCapacity = size;
+    }
     for (auto& node : nodes) {
-      dependencies.push_back(node.dependencies);
+      node.dependents.clear();
+    }
+    for (Handle handle = 0; handle < size; handle++) {
+      for (auto dep : nodes[handle].dependencies) {
+        nodes[dep].dependents.push_back(handle);
+      }
     }
 
-    std::vector<size_t> dependents(nodes.size());
-    for (auto& dependencyEdges : dependencies) {
-      for (auto handle : dependencyEdges) {
-        dependents[handle]++;
+    // Every node after the nodes depending on it, counting in pending the
+    // dependents not yet in the order
+    order.clear();
+    for (Handle handle = 0; handle < size; handle++) {
+      auto dependents = nodes[handle].dependents.size();
+      states[handle].pending.store(dependents, std::memory_order_relaxed);
+      if (dependents == 0) {
+        order.push_back(handle);
       }
     }
+    for (size_t i = 0; i < order.size(); i++) {
+      for (auto dep : nodes[order[i]].dependencies) {
+        auto& pending = states[dep].pending;
+        if (pending.fetch_sub(1, std::memory_order_relaxed) == 1) {
+          order.push_back(dep);
+        }
+      }
+    }
+    if (order.size() < size) {
+      roots.clear();
+      return false;
+    }
 
-    std::vector<Handle> handles;
-    for (Handle handle = 0; handle < nodes.size(); handle++) {
-      if (!nodes[handle].hasDependents) {
-        handles.push_back(handle);
+    uint64_t longest = 0;
+    for (auto handle : order) {
+      auto& node = nodes[handle];
+      uint64_t after = 0;
+      for (auto dep : node.dependents) {
+        after = std::max(after, nodes[dep].pathCost);
       }
+      auto cost = node.cost.count() > 0 ? node.cost : node.timing.running;
+      node.pathCost = after + uint64_t(std::max<int64_t>(cost.count(), 1));
+      longest = std::max(longest, node.pathCost);
     }
 
-    while (!handles.empty()) {
-      auto handle = handles.back();
-      handles.pop_back();
-      while (!dependencies[handle].empty()) {
-        auto dependency = dependencies[handle].back();
-        dependencies[handle].pop_back();
-        if (--dependents[dependency] == 0) {
-          handles.push_back(dependency);
-        }
+    auto moreCritical = [this](Handle a, Handle b) {
+      return nodes[a].pathCost > nodes[b].pathCost;
+    };
+    roots.clear();
+    for (Handle handle = 0; handle < size; handle++) {
+      auto& node = nodes[handle];
+      if (node.dependencies.empty()) {
+        roots.push_back(handle);
+      }
+      std::sort(node.dependents.begin(), node.dependents.end(), moreCritical);
+
+      // Spread over the executor's priorities, most critical highest
+      node.priority = Executor::MID_PRI;
+      auto levels = node.executor ? node.executor->getNumPriorities() : 1;
+      if (levels > 1) {
+        auto level = node.pathCost * (levels - 1) / longest;
+        node.priority = static_cast<int8_t>(int(level) - levels / 2);
       }
     }
+    std::sort(roots.begin(), roots.end(), moreCritical);
+    return true;
+  }
 
-    for (auto& dependencyEdges : dependencies) {
-      if (!dependencyEdges.empty()) {
-        return true;
+  void schedule(Handle handle) {
+    auto& node = nodes[handle];
+    if (states[handle].skip.load(std::memory_order_relaxed)) {
+      node.timing = NodeTiming();
+      finish(handle, exception_wrapper());
+      return;
+    }
+
+    auto run = [this, handle] {
+      auto& runNode = nodes[handle];
+      runNode.start = std::chrono::steady_clock::now();
+      runNode.timing.queued = runNode.start - runNode.ready;
+      makeFutureWith([&runNode] { return runNode.func(); })
+          .then([this, handle](Try<Unit>&& t) {
+            auto& doneNode = nodes[handle];
+            doneNode.timing.running =
+                std::chrono::steady_clock::now() - doneNode.start;
+            finish(
+                handle, t.hasException() ? t.exception() : exception_wrapper());
+          });
+    };
+    if (!node.executor) {
+      run();
+    } else if (node.priority != Executor::MID_PRI) {
+      node.executor->addWithPriority(std::move(run), node.priority);
+    } else {
+      node.executor->add(std::move(run));
+    }
+  }
+
+  void finish(Handle handle, exception_wrapper ew) {
+    bool skip = ew || states[handle].skip.load(std::memory_order_relaxed);
+    if (ew && !failed.exchange(true, std::memory_order_relaxed)) {
+      error = std::move(ew);
+    }
+    for (auto dep : nodes[handle].dependents) {
+      if (skip) {
+        states[dep].skip.store(true, std::memory_order_relaxed);
+      }
+      if (states[dep].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        nodes[dep].ready = std::chrono::steady_clock::now();
+        schedule(dep);
       }
     }
+    // Last, as completing the run may destroy the DAG
+    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      complete();
+    }
+  }
 
-    return false;
+  void complete() {
+    auto keepAlive = std::move(self);
+    auto promise = std::move(done);
+    if (error) {
+      promise.setException(std::move(error));
+    } else {
+      promise.setValue();
+    }
   }
 
   struct Node {
@@ -191,13 +320,39 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
 
     FutureFunc func{nullptr};
     Executor* executor{nullptr};
-    SharedPromise<Unit> promise;
     std::vector<Handle> dependencies;
     bool hasDependents{false};
-    bool visited{false};
+
+    std::chrono::nanoseconds cost{0};
+    NodeTiming timing;
+
+    // Worked out by prepare()
+    std::vector<Handle> dependents;
+    uint64_t pathCost{0};
+    int8_t priority{Executor::MID_PRI};
+
+    // Of the current run
+    std::chrono::steady_clock::time_point ready;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  // Per node state of the current run, kept apart as atomics can't move
+  struct State {
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> skip{false};
   };
 
   std::vector<Node> nodes;
+  std::vector<Handle> roots;
+  std::vector<Handle> order;
+  std::unique_ptr<State[]> states;
+  size_t statesCapacity{0};
+
+  std::atomic<size_t> remaining{0};
+  std::atomic<bool> failed{false};
+  exception_wrapper error;
+  Promise<Unit> done;
+  std::shared_ptr<FutureDAG> self;
 };
 
 // Polymorphic functor implementation
@@ -16,6 +16,9 @@
 
 #include <folly/experimental/JSONSchema.h>
 
+#include <algorithm>
+#include <set>
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/regex.hpp>
 #include <folly/Conv.h>
@@ -23,6 +26,7 @@
 #include <folly/Optional.h>
 #include <folly/Singleton.h>
 #include <folly/String.h>
+#include <folly/experimental/LazyJson.h>
 #include <folly/json.h>
 
 namespace folly {
@@ -653,6 +657,38 @@ struct NotValidator final : IValidator {
   std::unique_ptr<IValidator> validator_;
 };
 
+/**
+ * Find the schema an absolute ref, e.g. #/foo/bar, points to in the root
+ * schema. Returns nullptr if there is no such schema.
+ */
+const dynamic* resolveRef(const dynamic& root, StringPiece ref) {
+  std::vector<std::string> parts;
+  split("/", ref, parts);
+  const auto* s = &root; // First part is '#'
+  for (size_t i = 1; s && i < parts.size(); ++i) {
+    // Per the standard, we must replace ~1 with / and then ~0 with ~
+    boost::replace_all(parts[i], "~1", "/");
+    boost::replace_all(parts[i], "~0", "~");
+    if (s->isObject()) {
+      s = s->get_ptr(parts[i]);
+      continue;
+    }
+    if (s->isArray()) {
+      try {
+        const size_t pos = to<size_t>(parts[i]);
+        if (pos < s->size()) {
+          s = s->get_ptr(pos);
+          continue;
+        }
+      } catch (const std::range_error&) {
+        // ignore
+      }
+    }
+    break;
+  }
+  return s;
+}
+
 void SchemaValidator::loadSchema(SchemaValidatorContext& context,
                                  const dynamic& schema) {
   if (!schema.isObject() || schema.empty()) {
@@ -673,30 +709,7 @@ void SchemaValidator::loadSchema(SchemaValidatorContext& context,
 
       // This is a ref, but we haven't loaded it yet. Find where it is based on
       // the root schema.
-      std::vector<std::string> parts;
-      split("/", p->stringPiece(), parts);
-      const auto* s = &context.schema; // First part is '#'
-      for (size_t i = 1; s && i < parts.size(); ++i) {
-        // Per the standard, we must replace ~1 with / and then ~0 with ~
-        boost::replace_all(parts[i], "~1", "/");
-        boost::replace_all(parts[i], "~0", "~");
-        if (s->isObject()) {
-          s = s->get_ptr(parts[i]);
-          continue;
-        }
-        if (s->isArray()) {
-          try {
-            const size_t pos = to<size_t>(parts[i]);
-            if (pos < s->size()) {
-              s = s->get_ptr(pos);
-              continue;
-            }
-          } catch (const std::range_error&) {
-            // ignore
-          }
-        }
-        break;
-      }
+      const auto* s = resolveRef(context.schema, p->stringPiece());
       // If you have a self-recursive reference, this avoids getting into an
       // infinite recursion, where we try to load a schema that just references
       // itself, and then we try to load it again, and so on.
@@ -847,6 +860,945 @@ Optional<SchemaError> SchemaValidator::validate(ValidationContext& vc,
   return none;
 }
 
+/**
+ * Schema compiler, for compileValidator().
+ *
+ * Every (sub)schema becomes a contiguous run of instructions in one vector,
+ * and is referred to by its index in Program::schemas. Keywords that can't
+ * fail for any value (e.g. a non-numeric "minimum", or "items" with an empty
+ * schema) don't produce an instruction at all. The property names an object
+ * schema mentions in "properties", "required" and "dependencies" are
+ * gathered into one sorted table, and validating an object is a single pass
+ * over its members that records which of those names were seen.
+ *
+ * The interpreter is a template over the value type, to run the same program
+ * on a dynamic or on a json::LazyValue.
+ */
+enum class Op : uint8_t {
+  TYPE, // arg: bitmask of allowed dynamic::Types, bound: constant (for errors)
+  MULTIPLE_OF, // arg: constant
+  MINIMUM, // arg: constant
+  MAXIMUM, // arg: constant
+  MIN_LENGTH,
+  MAX_LENGTH,
+  PATTERN, // arg: regex
+  ITEMS, // arg: schema, for every element
+  TUPLE_ITEMS, // arg: tuple
+  MIN_ITEMS,
+  MAX_ITEMS,
+  UNIQUE_ITEMS,
+  MIN_PROPERTIES,
+  MAX_PROPERTIES,
+  OBJECT, // arg: object table
+  ENUM, // arg: constant
+  CALL, // arg: schema, for the same value ($ref and allOf)
+  ANY_OF, // arg: schema list
+  ONE_OF, // arg: schema list
+  NOT, // arg: schema
+};
+
+struct Instruction {
+  Op op;
+  bool exclusive; // for MINIMUM and MAXIMUM
+  uint32_t arg;
+  int64_t bound; // for MIN_* and MAX_*
+};
+
+constexpr uint32_t kNoSchema = std::numeric_limits<uint32_t>::max();
+
+struct TupleItems {
+  std::vector<uint32_t> items;
+  bool allowAdditional;
+  uint32_t additional; // or kNoSchema
+};
+
+struct ObjectTable {
+  struct Dependency {
+    uint32_t name;
+    std::vector<uint32_t> properties;
+    uint32_t schema; // or kNoSchema
+  };
+
+  // Index of key in names, or kNoSchema
+  uint32_t find(StringPiece key) const {
+    auto it = std::lower_bound(
+        names.begin(),
+        names.end(),
+        key,
+        [](const std::string& name, StringPiece k) {
+          return StringPiece(name) < k;
+        });
+    if (it == names.end() || StringPiece(*it) != key) {
+      return kNoSchema;
+    }
+    return uint32_t(it - names.begin());
+  }
+
+  // All property names mentioned by the schema, sorted. Everything else
+  // refers to names by index.
+  std::vector<std::string> names;
+
+  // Whether members are checked at all, i.e. whether "properties",
+  // "patternProperties" or "additionalProperties" can fail
+  bool checkMembers{false};
+  // Schema in "properties" for each name, or kNoSchema
+  std::vector<uint32_t> properties;
+  std::vector<std::pair<boost::regex, uint32_t>> patterns;
+  bool allowAdditional{true};
+  uint32_t additional{kNoSchema};
+
+  std::vector<uint32_t> required;
+  std::vector<Dependency> dependencies;
+};
+
+struct Program {
+  struct Range {
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  std::vector<Instruction> code;
+  // Schema 0 is the root
+  std::vector<Range> schemas;
+  std::vector<dynamic> constants;
+  std::vector<boost::regex> regexes;
+  std::vector<TupleItems> tuples;
+  std::vector<ObjectTable> objects;
+  std::vector<std::vector<uint32_t>> lists;
+};
+
+class SchemaCompiler {
+ public:
+  explicit SchemaCompiler(const dynamic& root) : root_(root) {}
+
+  Program compile() {
+    refs_["#"] = newSchema();
+    compileInto(0, root_);
+    return std::move(program_);
+  }
+
+ private:
+  uint32_t newSchema() {
+    program_.schemas.push_back({0, 0});
+    done_.push_back(false);
+    return uint32_t(program_.schemas.size() - 1);
+  }
+
+  uint32_t compile(const dynamic& schema) {
+    auto id = newSchema();
+    compileInto(id, schema);
+    return id;
+  }
+
+  void compileInto(uint32_t id, const dynamic& schema) {
+    // Subschemas are appended to the program as they are compiled, so gather
+    // this one's code on the side.
+    std::vector<Instruction> code;
+    emitSchema(code, schema);
+    auto& program = program_.code;
+    program_.schemas[id] = {uint32_t(program.size()),
+                            uint32_t(program.size() + code.size())};
+    program.insert(program.end(), code.begin(), code.end());
+    done_[id] = true;
+  }
+
+  // Whether schema id is compiled and passes everything. A schema that is
+  // still being compiled, because it refers to itself, might not.
+  bool isEmpty(uint32_t id) const {
+    const auto& range = program_.schemas[id];
+    return done_[id] && range.begin == range.end;
+  }
+
+  uint32_t addConstant(dynamic value) {
+    program_.constants.push_back(std::move(value));
+    return uint32_t(program_.constants.size() - 1);
+  }
+
+  static void emit(
+      std::vector<Instruction>& code,
+      Op op,
+      uint32_t arg = 0,
+      int64_t bound = 0,
+      bool exclusive = false) {
+    code.push_back({op, exclusive, arg, bound});
+  }
+
+  void emitCall(std::vector<Instruction>& code, uint32_t id) {
+    if (!isEmpty(id)) {
+      emit(code, Op::CALL, id);
+    }
+  }
+
+  static void emitSize(
+      std::vector<Instruction>& code,
+      Op op,
+      const dynamic* schema) {
+    if (schema && schema->isInt() && schema->getInt() >= 0) {
+      emit(code, op, 0, schema->getInt());
+    }
+  }
+
+  void emitComparison(
+      std::vector<Instruction>& code,
+      Op op,
+      const dynamic* schema,
+      const dynamic* exclusive) {
+    if (schema && schema->isNumber()) {
+      emit(
+          code,
+          op,
+          addConstant(*schema),
+          0,
+          exclusive && exclusive->isBool() && exclusive->getBool());
+    }
+  }
+
+  void emitSchema(std::vector<Instruction>& code, const dynamic& schema);
+  void emitItems(
+      std::vector<Instruction>& code,
+      const dynamic* items,
+      const dynamic* additionalItems);
+  void emitObject(std::vector<Instruction>& code, const dynamic& schema);
+  void emitType(std::vector<Instruction>& code, const dynamic& schema);
+  uint32_t addList(const dynamic& schema);
+
+  const dynamic& root_;
+  Program program_;
+  std::vector<bool> done_;
+  std::unordered_map<std::string, uint32_t> refs_;
+};
+
+void SchemaCompiler::emitSchema(
+    std::vector<Instruction>& code,
+    const dynamic& schema) {
+  if (!schema.isObject() || schema.empty()) {
+    return;
+  }
+
+  // As in SchemaValidator::loadSchema(), a $ref replaces everything else.
+  if (const auto* p = schema.get_ptr("$ref")) {
+    if (p->isString() && p->stringPiece().startsWith('#')) {
+      auto it = refs_.find(p->getString());
+      if (it != refs_.end()) {
+        emitCall(code, it->second);
+        return;
+      }
+      if (const auto* s = resolveRef(root_, p->stringPiece())) {
+        // Register the ref before compiling it, for refs to itself
+        auto id = newSchema();
+        refs_[p->getString()] = id;
+        compileInto(id, *s);
+        emitCall(code, id);
+        return;
+      }
+    }
+  }
+
+  // Numeric validators
+  if (const auto* p = schema.get_ptr("multipleOf")) {
+    // A multiple of 0 is invalid per the metaschema, and can't be checked
+    if (p->isNumber() && p->asDouble() != 0) {
+      emit(code, Op::MULTIPLE_OF, addConstant(*p));
+    }
+  }
+  emitComparison(
+      code,
+      Op::MAXIMUM,
+      schema.get_ptr("maximum"),
+      schema.get_ptr("exclusiveMaximum"));
+  emitComparison(
+      code,
+      Op::MINIMUM,
+      schema.get_ptr("minimum"),
+      schema.get_ptr("exclusiveMinimum"));
+
+  // String validators
+  emitSize(code, Op::MAX_LENGTH, schema.get_ptr("maxLength"));
+  emitSize(code, Op::MIN_LENGTH, schema.get_ptr("minLength"));
+  if (const auto* p = schema.get_ptr("pattern")) {
+    if (p->isString()) {
+      program_.regexes.emplace_back(p->getString());
+      emit(code, Op::PATTERN, uint32_t(program_.regexes.size() - 1));
+    }
+  }
+
+  // Array validators
+  emitSize(code, Op::MAX_ITEMS, schema.get_ptr("maxItems"));
+  emitSize(code, Op::MIN_ITEMS, schema.get_ptr("minItems"));
+  if (const auto* p = schema.get_ptr("uniqueItems")) {
+    if (p->isBool() && p->getBool()) {
+      emit(code, Op::UNIQUE_ITEMS);
+    }
+  }
+  emitItems(code, schema.get_ptr("items"), schema.get_ptr("additionalItems"));
+
+  // Object validators; the cheap size checks first
+  emitSize(code, Op::MAX_PROPERTIES, schema.get_ptr("maxProperties"));
+  emitSize(code, Op::MIN_PROPERTIES, schema.get_ptr("minProperties"));
+  emitObject(code, schema);
+
+  // Misc validators
+  if (const auto* p = schema.get_ptr("enum")) {
+    if (p->isArray()) {
+      emit(code, Op::ENUM, addConstant(*p));
+    }
+  }
+  if (const auto* p = schema.get_ptr("type")) {
+    emitType(code, *p);
+  }
+  if (const auto* p = schema.get_ptr("allOf")) {
+    if (p->isArray()) {
+      for (const auto& item : *p) {
+        emitCall(code, compile(item));
+      }
+    }
+  }
+  if (const auto* p = schema.get_ptr("anyOf")) {
+    emit(code, Op::ANY_OF, addList(*p));
+  }
+  if (const auto* p = schema.get_ptr("oneOf")) {
+    emit(code, Op::ONE_OF, addList(*p));
+  }
+  if (const auto* p = schema.get_ptr("not")) {
+    emit(code, Op::NOT, compile(*p));
+  }
+}
+
+void SchemaCompiler::emitItems(
+    std::vector<Instruction>& code,
+    const dynamic* items,
+    const dynamic* additionalItems) {
+  // Without an array of items, additionalItems is ignored
+  if (items && items->isObject()) {
+    auto id = compile(*items);
+    if (!isEmpty(id)) {
+      emit(code, Op::ITEMS, id);
+    }
+    return;
+  }
+  if (!items || !items->isArray()) {
+    return;
+  }
+  TupleItems tuple{{}, true, kNoSchema};
+  for (const auto& item : *items) {
+    tuple.items.push_back(compile(item));
+  }
+  if (additionalItems) {
+    if (additionalItems->isBool()) {
+      tuple.allowAdditional = additionalItems->getBool();
+    } else if (additionalItems->isObject()) {
+      tuple.additional = compile(*additionalItems);
+    }
+  }
+  program_.tuples.push_back(std::move(tuple));
+  emit(code, Op::TUPLE_ITEMS, uint32_t(program_.tuples.size() - 1));
+}
+
+void SchemaCompiler::emitObject(
+    std::vector<Instruction>& code,
+    const dynamic& schema) {
+  const auto* properties = schema.get_ptr("properties");
+  const auto* patternProperties = schema.get_ptr("patternProperties");
+  const auto* additionalProperties = schema.get_ptr("additionalProperties");
+  const auto* required = schema.get_ptr("required");
+  const auto* dependencies = schema.get_ptr("dependencies");
+
+  // Gather all the names first, so that they can be referred to by index
+  std::set<std::string> names;
+  if (properties && properties->isObject()) {
+    for (const auto& key : properties->keys()) {
+      if (key.isString()) {
+        names.insert(key.getString());
+      }
+    }
+  }
+  if (required && required->isArray()) {
+    for (const auto& item : *required) {
+      if (item.isString()) {
+        names.insert(item.getString());
+      }
+    }
+  }
+  if (dependencies && dependencies->isObject()) {
+    for (const auto& pair : dependencies->items()) {
+      if (!pair.first.isString()) {
+        continue;
+      }
+      names.insert(pair.first.getString());
+      if (pair.second.isArray()) {
+        for (const auto& item : pair.second) {
+          if (item.isString()) {
+            names.insert(item.getString());
+          }
+        }
+      }
+    }
+  }
+
+  ObjectTable table;
+  table.names.assign(names.begin(), names.end());
+  table.properties.assign(table.names.size(), kNoSchema);
+  if (properties && properties->isObject()) {
+    for (const auto& pair : properties->items()) {
+      if (pair.first.isString()) {
+        table.properties[table.find(pair.first.stringPiece())] =
+            compile(pair.second);
+        table.checkMembers = true;
+      }
+    }
+  }
+  if (patternProperties && patternProperties->isObject()) {
+    for (const auto& pair : patternProperties->items()) {
+      if (pair.first.isString()) {
+        table.patterns.emplace_back(
+            boost::regex(pair.first.getString()), compile(pair.second));
+        table.checkMembers = true;
+      }
+    }
+  }
+  if (additionalProperties) {
+    if (additionalProperties->isBool()) {
+      table.allowAdditional = additionalProperties->getBool();
+      table.checkMembers |= !table.allowAdditional;
+    } else if (additionalProperties->isObject()) {
+      table.additional = compile(*additionalProperties);
+      table.checkMembers |= !isEmpty(table.additional);
+    }
+  }
+  if (required && required->isArray()) {
+    for (const auto& item : *required) {
+      if (item.isString()) {
+        table.required.push_back(table.find(item.stringPiece()));
+      }
+    }
+  }
+  if (dependencies && dependencies->isObject()) {
+    for (const auto& pair : dependencies->items()) {
+      if (!pair.first.isString()) {
+        continue;
+      }
+      ObjectTable::Dependency dep{
+          table.find(pair.first.stringPiece()), {}, kNoSchema};
+      if (pair.second.isArray()) {
+        for (const auto& item : pair.second) {
+          if (item.isString()) {
+            dep.properties.push_back(table.find(item.stringPiece()));
+          }
+        }
+      } else if (pair.second.isObject()) {
+        dep.schema = compile(pair.second);
+      }
+      table.dependencies.push_back(std::move(dep));
+    }
+  }
+
+  if (table.checkMembers || !table.required.empty() ||
+      !table.dependencies.empty()) {
+    program_.objects.push_back(std::move(table));
+    emit(code, Op::OBJECT, uint32_t(program_.objects.size() - 1));
+  }
+}
+
+void SchemaCompiler::emitType(
+    std::vector<Instruction>& code,
+    const dynamic& schema) {
+  // As in TypeValidator, a type with no valid names rejects everything
+  uint32_t mask = 0;
+  std::string typeStr;
+  auto addType = [&](StringPiece value) {
+    if (value == "array") {
+      mask |= 1u << dynamic::Type::ARRAY;
+    } else if (value == "boolean") {
+      mask |= 1u << dynamic::Type::BOOL;
+    } else if (value == "integer") {
+      mask |= 1u << dynamic::Type::INT64;
+    } else if (value == "number") {
+      mask |= 1u << dynamic::Type::INT64;
+      mask |= 1u << dynamic::Type::DOUBLE;
+    } else if (value == "null") {
+      mask |= 1u << dynamic::Type::NULLT;
+    } else if (value == "object") {
+      mask |= 1u << dynamic::Type::OBJECT;
+    } else if (value == "string") {
+      mask |= 1u << dynamic::Type::STRING;
+    } else {
+      return;
+    }
+    if (!typeStr.empty()) {
+      typeStr += ", ";
+    }
+    typeStr += value.str();
+  };
+  if (schema.isString()) {
+    addType(schema.stringPiece());
+  } else if (schema.isArray()) {
+    for (const auto& item : schema) {
+      if (item.isString()) {
+        addType(item.stringPiece());
+      }
+    }
+  }
+  emit(code, Op::TYPE, mask, addConstant(std::move(typeStr)));
+}
+
+uint32_t SchemaCompiler::addList(const dynamic& schema) {
+  // A missing or empty list of schemas rejects everything
+  std::vector<uint32_t> list;
+  if (schema.isArray()) {
+    for (const auto& item : schema) {
+      list.push_back(compile(item));
+    }
+  }
+  program_.lists.push_back(std::move(list));
+  return uint32_t(program_.lists.size() - 1);
+}
+
+// Uniform access to dynamic and json::LazyValue for the interpreter
+
+double toDouble(const dynamic& value) {
+  return value.asDouble();
+}
+
+double toDouble(const json::LazyValue& value) {
+  return value.getDouble();
+}
+
+const dynamic& toDynamic(const dynamic& value) {
+  return value;
+}
+
+dynamic toDynamic(const json::LazyValue& value) {
+  return value.toDynamic();
+}
+
+bool getKey(const dynamic& key, StringPiece& out) {
+  if (!key.isString()) {
+    return false;
+  }
+  out = key.stringPiece();
+  return true;
+}
+
+bool getKey(const json::LazyValue& key, StringPiece& out) {
+  out = key.stringPiece();
+  return true;
+}
+
+bool equals(const dynamic& value, const dynamic& other) {
+  return value == other;
+}
+
+// Same as value.toDynamic() == other, without materializing scalars
+bool equals(const json::LazyValue& value, const dynamic& other) {
+  switch (value.type()) {
+    case dynamic::Type::NULLT:
+      return other.isNull();
+    case dynamic::Type::BOOL:
+      return other.isBool() && value.getBool() == other.getBool();
+    case dynamic::Type::INT64:
+      if (other.isInt()) {
+        return value.getInt() == other.getInt();
+      }
+      return other.isDouble() && value.getInt() == other.getDouble();
+    case dynamic::Type::DOUBLE:
+      if (other.isDouble()) {
+        return value.getDouble() == other.getDouble();
+      }
+      return other.isInt() && other.getInt() == value.getDouble();
+    case dynamic::Type::STRING:
+      return other.isString() && value.stringPiece() == other.stringPiece();
+    default:
+      return value.toDynamic() == other;
+  }
+}
+
+bool hasUniqueItems(const dynamic& value) {
+  for (const auto& i : value) {
+    for (const auto& j : value) {
+      if (&i != &j && i == j) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool hasUniqueItems(const json::LazyValue& value) {
+  // Rare enough not to bother comparing LazyValues with each other
+  return hasUniqueItems(value.toDynamic());
+}
+
+template <class Value>
+class Interpreter {
+ public:
+  explicit Interpreter(const Program& program) : program_(program) {}
+
+  Optional<SchemaError> validate(const Value& value) {
+    if (run(0, value, 0)) {
+      return none;
+    }
+    return std::move(error_);
+  }
+
+ private:
+  // depth counts the schemas applied to value itself (as opposed to one of
+  // its members) on the way here. Past the number of schemas, one of them
+  // was applied twice, and will be forever.
+  bool run(uint32_t schema, const Value& value, size_t depth) {
+    if (depth > program_.schemas.size()) {
+      throw std::runtime_error("Infinite recursion detected");
+    }
+    const auto& range = program_.schemas[schema];
+    for (auto pc = range.begin; pc != range.end; ++pc) {
+      if (!execute(program_.code[pc], value, depth)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Records the first error outside of anyOf, oneOf and not, and fails
+  bool fail(StringPiece expected, const Value& value) {
+    if (quiet_ == 0 && !error_) {
+      error_.emplace(expected, toDynamic(value));
+    }
+    return false;
+  }
+
+  bool fail(StringPiece expected, const dynamic& schema, const Value& value) {
+    if (quiet_ == 0 && !error_) {
+      error_.emplace(expected, schema, toDynamic(value));
+    }
+    return false;
+  }
+
+  template <typename Numeric>
+  bool compare(
+      const Instruction& ins,
+      const Value& value,
+      Numeric s,
+      Numeric v) {
+    const auto& schema = program_.constants[ins.arg];
+    if (ins.op == Op::MINIMUM) {
+      if (ins.exclusive ? v <= s : v < s) {
+        return fail(
+            ins.exclusive ? "greater than " : "greater than or equal to ",
+            schema,
+            value);
+      }
+    } else {
+      if (ins.exclusive ? v >= s : v > s) {
+        return fail(
+            ins.exclusive ? "less than " : "less than or equal to ",
+            schema,
+            value);
+      }
+    }
+    return true;
+  }
+
+  bool checkSize(const Instruction& ins, const Value& value, size_t size) {
+    bool ok = ins.op == Op::MIN_LENGTH || ins.op == Op::MIN_ITEMS ||
+            ins.op == Op::MIN_PROPERTIES
+        ? ins.bound <= int64_t(size)
+        : ins.bound >= int64_t(size);
+    return ok || fail("different length string/array/object", value);
+  }
+
+  bool execute(const Instruction& ins, const Value& value, size_t depth);
+  bool checkTuple(const TupleItems& tuple, const Value& value);
+  bool checkObject(const ObjectTable& table, const Value& value, size_t depth);
+  bool checkAnyOf(const Instruction& ins, const Value& value, size_t depth);
+
+  const Program& program_;
+  // Nesting level of anyOf, oneOf and not, whose failures aren't errors
+  size_t quiet_{0};
+  Optional<SchemaError> error_;
+};
+
+template <class Value>
+bool Interpreter<Value>::execute(
+    const Instruction& ins,
+    const Value& value,
+    size_t depth) {
+  switch (ins.op) {
+    case Op::TYPE:
+      if (!(ins.arg & (1u << value.type()))) {
+        return fail(
+            "a value of type ", program_.constants[ins.bound], value);
+      }
+      return true;
+    case Op::MULTIPLE_OF: {
+      if (!value.isNumber()) {
+        return true;
+      }
+      const auto& schema = program_.constants[ins.arg];
+      if (schema.isDouble() || value.isDouble()) {
+        const auto rem = std::remainder(toDouble(value), schema.asDouble());
+        if (std::abs(rem) > std::numeric_limits<double>::epsilon()) {
+          return fail("a multiple of ", schema, value);
+        }
+      } else if ((value.getInt() % schema.getInt()) != 0) {
+        return fail("a multiple of ", schema, value);
+      }
+      return true;
+    }
+    case Op::MINIMUM:
+    case Op::MAXIMUM: {
+      if (!value.isNumber()) {
+        return true;
+      }
+      const auto& schema = program_.constants[ins.arg];
+      if (schema.isDouble() || value.isDouble()) {
+        return compare(ins, value, schema.asDouble(), toDouble(value));
+      }
+      return compare(ins, value, schema.getInt(), value.getInt());
+    }
+    case Op::MIN_LENGTH:
+    case Op::MAX_LENGTH:
+      return !value.isString() ||
+          checkSize(ins, value, value.stringPiece().size());
+    case Op::PATTERN: {
+      if (!value.isString()) {
+        return true;
+      }
+      auto str = value.stringPiece();
+      if (!boost::regex_search(
+              str.begin(), str.end(), program_.regexes[ins.arg])) {
+        return fail("string matching regex", value);
+      }
+      return true;
+    }
+    case Op::ITEMS:
+      if (value.isArray()) {
+        for (const auto& item : value) {
+          if (!run(ins.arg, item, 0)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    case Op::TUPLE_ITEMS:
+      return !value.isArray() ||
+          checkTuple(program_.tuples[ins.arg], value);
+    case Op::MIN_ITEMS:
+    case Op::MAX_ITEMS:
+      return !value.isArray() || checkSize(ins, value, value.size());
+    case Op::UNIQUE_ITEMS:
+      if (value.isArray() && !hasUniqueItems(value)) {
+        return fail("unique items in array", value);
+      }
+      return true;
+    case Op::MIN_PROPERTIES:
+    case Op::MAX_PROPERTIES:
+      return !value.isObject() || checkSize(ins, value, value.size());
+    case Op::OBJECT:
+      return !value.isObject() ||
+          checkObject(program_.objects[ins.arg], value, depth);
+    case Op::ENUM: {
+      const auto& schema = program_.constants[ins.arg];
+      for (const auto& item : schema) {
+        if (equals(value, item)) {
+          return true;
+        }
+      }
+      return fail("one of enum values: ", schema, value);
+    }
+    case Op::CALL:
+      return run(ins.arg, value, depth + 1);
+    case Op::ANY_OF:
+    case Op::ONE_OF:
+      return checkAnyOf(ins, value, depth);
+    case Op::NOT: {
+      ++quiet_;
+      bool ok = run(ins.arg, value, depth + 1);
+      --quiet_;
+      if (ok) {
+        return fail("Expected schema validation to fail", value);
+      }
+      return true;
+    }
+  }
+  return true;
+}
+
+template <class Value>
+bool Interpreter<Value>::checkTuple(
+    const TupleItems& tuple,
+    const Value& value) {
+  size_t pos = 0;
+  for (const auto& item : value) {
+    if (pos < tuple.items.size()) {
+      if (!run(tuple.items[pos], item, 0)) {
+        return false;
+      }
+    } else if (!tuple.allowAdditional) {
+      return fail("no more additional items", value);
+    } else if (tuple.additional != kNoSchema) {
+      if (!run(tuple.additional, item, 0)) {
+        return false;
+      }
+    } else {
+      break;
+    }
+    ++pos;
+  }
+  return true;
+}
+
+template <class Value>
+bool Interpreter<Value>::checkObject(
+    const ObjectTable& table,
+    const Value& value,
+    size_t depth) {
+  // Which of table.names the object has; in a bitmask unless there are too
+  // many of them
+  const auto numNames = table.names.size();
+  const bool track = !table.required.empty() || !table.dependencies.empty();
+  uint64_t seenMask = 0;
+  std::vector<bool> seenVector;
+  if (track && numNames > 64) {
+    seenVector.resize(numNames);
+  }
+  auto seen = [&](uint32_t name) {
+    return numNames > 64 ? bool(seenVector[name])
+                         : ((seenMask >> name) & 1) != 0;
+  };
+
+  for (const auto& pair : value.items()) {
+    StringPiece key;
+    if (!getKey(pair.first, key)) {
+      continue;
+    }
+    const auto name = table.find(key);
+    if (track && name != kNoSchema) {
+      if (numNames > 64) {
+        seenVector[name] = true;
+      } else {
+        seenMask |= uint64_t(1) << name;
+      }
+    }
+    if (!table.checkMembers) {
+      continue;
+    }
+
+    bool matched = false;
+    if (name != kNoSchema && table.properties[name] != kNoSchema) {
+      if (!run(table.properties[name], pair.second, 0)) {
+        return false;
+      }
+      matched = true;
+    }
+    for (const auto& pattern : table.patterns) {
+      if (boost::regex_search(key.begin(), key.end(), pattern.first)) {
+        if (!run(pattern.second, pair.second, 0)) {
+          return false;
+        }
+        matched = true;
+      }
+    }
+    if (matched) {
+      continue;
+    }
+    if (!table.allowAdditional) {
+      return fail("no more additional properties", value);
+    }
+    if (table.additional != kNoSchema &&
+        !run(table.additional, pair.second, 0)) {
+      return false;
+    }
+  }
+
+  for (auto name : table.required) {
+    if (!seen(name)) {
+      return fail("property ", table.names[name], value);
+    }
+  }
+  for (const auto& dep : table.dependencies) {
+    if (seen(dep.name)) {
+      for (auto name : dep.properties) {
+        if (!seen(name)) {
+          return fail("property ", table.names[name], value);
+        }
+      }
+    }
+  }
+  for (const auto& dep : table.dependencies) {
+    if (dep.schema != kNoSchema && seen(dep.name) &&
+        !run(dep.schema, value, depth + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Value>
+bool Interpreter<Value>::checkAnyOf(
+    const Instruction& ins,
+    const Value& value,
+    size_t depth) {
+  // Stop as soon as the outcome is known
+  const size_t enough = ins.op == Op::ANY_OF ? 1 : 2;
+  size_t success = 0;
+  ++quiet_;
+  for (auto schema : program_.lists[ins.arg]) {
+    if (run(schema, value, depth + 1) && ++success == enough) {
+      break;
+    }
+  }
+  --quiet_;
+  if (success == 0) {
+    return fail("at least one valid schema", value);
+  } else if (success > 1 && ins.op == Op::ONE_OF) {
+    return fail("exactly one valid schema", value);
+  }
+  return true;
+}
+
+struct CompiledSchemaValidator final : CompiledValidator {
+  explicit CompiledSchemaValidator(Program program)
+      : program_(std::move(program)) {}
+
+  void validate(const dynamic& value) const override {
+    doValidate(value);
+  }
+  exception_wrapper try_validate(const dynamic& value) const
+      noexcept override {
+    return doTryValidate(value);
+  }
+  void validate(const json::LazyValue& value) const override {
+    doValidate(value);
+  }
+  exception_wrapper try_validate(const json::LazyValue& value) const
+      noexcept override {
+    return doTryValidate(value);
+  }
+
+ private:
+  template <class Value>
+  void doValidate(const Value& value) const {
+    if (auto se = Interpreter<Value>(program_).validate(value)) {
+      throw * se;
+    }
+  }
+
+  template <class Value>
+  exception_wrapper doTryValidate(const Value& value) const noexcept {
+    try {
+      if (auto se = Interpreter<Value>(program_).validate(value)) {
+        return make_exception_wrapper<SchemaError>(*se);
+      }
+    } catch (const std::exception& e) {
+      return exception_wrapper(std::current_exception(), e);
+    } catch (...) {
+      return exception_wrapper(std::current_exception());
+    }
+    return exception_wrapper();
+  }
+
+  const Program program_;
+};
+
 /**
  * Metaschema, i.e. schema for schema.
  * Inlined from the $schema url
@@ -1022,6 +1974,11 @@ std::unique_ptr<Validator> makeValidator(const dynamic& schema) {
   return std::move(v);
 }
 
+std::unique_ptr<CompiledValidator> compileValidator(const dynamic& schema) {
+  return std::make_unique<CompiledSchemaValidator>(
+      SchemaCompiler(schema).compile());
+}
+
 std::shared_ptr<Validator> makeSchemaValidator() {
   return schemaValidator.try_get();
 }
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/JsonWriter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include <folly/Function.h>
+#include <folly/Unicode.h>
+
+namespace folly {
+namespace json {
+
+namespace {
+
+// Size of the buffers added to the queue as it fills up
+constexpr size_t kAllocationSize = 4096;
+
+const serialization_opts& defaultOpts() {
+  static const serialization_opts opts;
+  return opts;
+}
+
+} // namespace
+
+void JsonWriter::Output::flush() {
+  if (cur_ != begin_) {
+    queue_.postallocate(uint64_t(cur_ - begin_));
+  }
+  // The queue may be used by others until we write again
+  begin_ = cur_ = end_ = nullptr;
+}
+
+void JsonWriter::Output::reserveSlow(size_t n) {
+  flush();
+  auto space = queue_.preallocate(n, std::max(n, kAllocationSize));
+  begin_ = cur_ = static_cast<char*>(space.first);
+  end_ = begin_ + space.second;
+}
+
+JsonWriter::JsonWriter(IOBufQueue& queue)
+    : JsonWriter(queue, defaultOpts()) {}
+
+JsonWriter::JsonWriter(IOBufQueue& queue, serialization_opts const& opts)
+    : out_(queue), opts_(opts) {}
+
+JsonWriter::~JsonWriter() {
+  flush();
+}
+
+JsonWriter& JsonWriter::beginObject() {
+  beforeValue();
+  begin(true);
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  end(true);
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  beforeValue();
+  begin(false);
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  end(false);
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(StringPiece key) {
+  beginKey();
+  writeString(key);
+  endKey();
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(StringPiece str) {
+  beforeValue();
+  writeString(str);
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(double d) {
+  beforeValue();
+  writeDouble(d);
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+  beforeValue();
+  out_ += b ? "true" : "false";
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::nullptr_t) {
+  beforeValue();
+  out_ += "null";
+  afterValue();
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const dynamic& dyn) {
+  beforeValue();
+  writeDynamic(dyn);
+  afterValue();
+  return *this;
+}
+
+void JsonWriter::beforeValue() {
+  if (stack_.empty()) {
+    if (done_) {
+      throw std::logic_error("JsonWriter: more than one top-level value");
+    }
+    return;
+  }
+  auto& frame = stack_.back();
+  if (frame.isObject) {
+    if (!frame.hasKey) {
+      throw std::logic_error("JsonWriter: expected a key");
+    }
+    frame.hasKey = false;
+    return;
+  }
+  if (!frame.empty) {
+    out_ += ',';
+  }
+  frame.empty = false;
+  newline();
+}
+
+void JsonWriter::beginKey() {
+  if (stack_.empty() || !stack_.back().isObject) {
+    throw std::logic_error("JsonWriter: key outside of an object");
+  }
+  auto& frame = stack_.back();
+  if (frame.hasKey) {
+    throw std::logic_error("JsonWriter: expected a value");
+  }
+  if (!frame.empty) {
+    out_ += ',';
+  }
+  frame.empty = false;
+  newline();
+}
+
+void JsonWriter::endKey() {
+  out_ += opts_.pretty_formatting ? " : " : ":";
+  stack_.back().hasKey = true;
+}
+
+void JsonWriter::begin(bool isObject) {
+  out_ += isObject ? '{' : '[';
+  stack_.push_back(Frame{isObject, true, false});
+}
+
+void JsonWriter::end(bool isObject) {
+  if (stack_.empty() || stack_.back().isObject != isObject) {
+    throw std::logic_error(
+        isObject ? "JsonWriter: endObject() outside of an object"
+                 : "JsonWriter: endArray() outside of an array");
+  }
+  if (stack_.back().hasKey) {
+    throw std::logic_error("JsonWriter: expected a value");
+  }
+  bool empty = stack_.back().empty;
+  stack_.pop_back();
+  if (!empty) {
+    newline();
+  }
+  out_ += isObject ? '}' : ']';
+}
+
+void JsonWriter::newline() {
+  if (opts_.pretty_formatting) {
+    out_ += '\n';
+    for (size_t i = 0; i < stack_.size(); ++i) {
+      out_ += "  ";
+    }
+  }
+}
+
+void JsonWriter::writeInt(int64_t i) {
+  char buffer[20];
+  if (i < 0) {
+    out_ += '-';
+    out_.append(
+        buffer, uint64ToBufferUnsafe(~static_cast<uint64_t>(i) + 1, buffer));
+  } else {
+    out_.append(buffer, uint64ToBufferUnsafe(uint64_t(i), buffer));
+  }
+}
+
+void JsonWriter::writeInt(uint64_t i) {
+  char buffer[20];
+  out_.append(buffer, uint64ToBufferUnsafe(i, buffer));
+}
+
+void JsonWriter::writeDouble(double d) {
+  if (!opts_.allow_nan_inf && (std::isnan(d) || std::isinf(d))) {
+    throw std::runtime_error(
+        "folly::toJson: JSON object value was a NaN or INF");
+  }
+  scratch_.clear();
+  toAppend(d, &scratch_, opts_.double_mode, opts_.double_num_digits);
+  out_ += scratch_;
+}
+
+void JsonWriter::writeString(StringPiece str) {
+  // Copied as it is if there is nothing to escape, encode or replace
+  bool checkUtf8 = opts_.validate_utf8 || opts_.skip_invalid_utf8;
+  if (detail::firstEscapable(str, opts_.encode_non_ascii) == str.size() &&
+      (!checkUtf8 || utf8Valid(str, true))) {
+    out_ += '"';
+    out_ += str;
+    out_ += '"';
+    return;
+  }
+  scratch_.clear();
+  escapeString(str, scratch_, opts_);
+  out_ += scratch_;
+}
+
+void JsonWriter::writeDynamic(const dynamic& dyn) {
+  switch (dyn.type()) {
+    case dynamic::DOUBLE:
+      writeDouble(dyn.getDouble());
+      break;
+    case dynamic::INT64: {
+      auto i = dyn.getInt();
+      if (opts_.javascript_safe) {
+        // Use folly::to to check that this integer can be represented
+        // as a double without loss of precision.
+        i = int64_t(to<double>(i));
+      }
+      writeInt(i);
+      break;
+    }
+    case dynamic::BOOL:
+      out_ += dyn.getBool() ? "true" : "false";
+      break;
+    case dynamic::NULLT:
+      out_ += "null";
+      break;
+    case dynamic::STRING:
+      writeString(dyn.getString());
+      break;
+    case dynamic::ARRAY:
+      begin(false);
+      for (auto& element : dyn) {
+        beforeValue();
+        writeDynamic(element);
+      }
+      end(false);
+      break;
+    case dynamic::OBJECT:
+      begin(true);
+      if (opts_.sort_keys || opts_.sort_keys_by) {
+        using ref =
+            std::reference_wrapper<decltype(dyn.items())::value_type const>;
+        std::vector<ref> refs(dyn.items().begin(), dyn.items().end());
+
+        using SortByRef = FunctionRef<bool(dynamic const&, dynamic const&)>;
+        auto const& sortKeysBy = opts_.sort_keys_by
+            ? SortByRef(opts_.sort_keys_by)
+            : SortByRef(std::less<dynamic>());
+        std::sort(refs.begin(), refs.end(), [&](ref a, ref b) {
+          // Only compare keys.  No ordering among identical keys.
+          return sortKeysBy(a.get().first, b.get().first);
+        });
+        for (auto& item : refs) {
+          writeItem(item.get().first, item.get().second);
+        }
+      } else {
+        for (auto& item : dyn.items()) {
+          writeItem(item.first, item.second);
+        }
+      }
+      end(true);
+      break;
+    default:
+      CHECK(0) << "Bad type " << dyn.type();
+  }
+}
+
+void JsonWriter::writeItem(const dynamic& key, const dynamic& value) {
+  if (!opts_.allow_non_string_keys && !key.isString()) {
+    throw std::runtime_error(
+        "folly::toJson: JSON object key was not a string");
+  }
+  beginKey();
+  writeDynamic(key);
+  endKey();
+  beforeValue();
+  writeDynamic(value);
+}
+
+void serialize(
+    const dynamic& dyn,
+    IOBufQueue& queue,
+    serialization_opts const& opts) {
+  JsonWriter(queue, opts).value(dyn);
+}
+
+} // namespace json
+} // namespace folly
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A streaming JSON serializer that writes straight into an IOBufQueue.
+ *
+ * json::serialize() builds a std::string, which is reallocated as it grows
+ * and then usually copied into an IOBuf to be sent.  JsonWriter appends to
+ * the tail of an IOBufQueue instead, through preallocate()/postallocate(),
+ * so the output is written once, in place, into buffers that can be handed
+ * to a socket as they are.
+ *
+ * Values are written one at a time, SAX style, without building a dynamic
+ * first:
+ *
+ *   IOBufQueue queue(IOBufQueue::cacheChainLength());
+ *   JsonWriter w(queue);
+ *   w.beginObject();
+ *   w.key("id").value(12);
+ *   w.key("tags").beginArray().value("a").value("b").endArray();
+ *   w.key("extra").value(someDynamic);
+ *   w.endObject();
+ *   w.flush();
+ *
+ * Commas, colons and (with pretty_formatting) newlines and indentation are
+ * inserted as needed, and the output is byte for byte what
+ * json::serialize() produces for the equivalent dynamic.  Misuse, like a
+ * value where a key is expected or a second top-level value, throws
+ * std::logic_error.
+ *
+ * Strings are scanned 16 or 32 bytes at a time (json::detail::firstEscapable()
+ * and, with validate_utf8, utf8Valid()) and copied directly when there is
+ * nothing to escape, which is the common case; the others go through
+ * json::escapeString().
+ *
+ * The writer holds a preallocated region of the queue between calls, so
+ * the queue must not be used by anything else until flush() (or the
+ * writer's destructor) has been called.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Likely.h>
+#include <folly/Range.h>
+#include <folly/dynamic.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/json.h>
+
+namespace folly {
+namespace json {
+
+class JsonWriter {
+ public:
+  explicit JsonWriter(IOBufQueue& queue);
+  // opts must outlive the writer
+  JsonWriter(IOBufQueue& queue, serialization_opts const& opts);
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  // Flushes
+  ~JsonWriter();
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+
+  // The next value is for key
+  JsonWriter& key(StringPiece key);
+
+  JsonWriter& value(StringPiece str);
+  JsonWriter& value(const char* str) {
+    return value(StringPiece(str));
+  }
+  JsonWriter& value(const std::string& str) {
+    return value(StringPiece(str));
+  }
+  JsonWriter& value(double d);
+  JsonWriter& value(bool b);
+  JsonWriter& value(std::nullptr_t);
+  JsonWriter& value(const dynamic& dyn);
+
+  template <
+      class T,
+      typename std::enable_if<
+          std::is_integral<T>::value && !std::is_same<T, bool>::value,
+          int>::type = 0>
+  JsonWriter& value(T i) {
+    beforeValue();
+    if (opts_.javascript_safe) {
+      // Check that the integer can be represented as a double without loss
+      // of precision, as serialize() does
+      to<double>(i);
+    }
+    using Wide = typename std::
+        conditional<std::is_signed<T>::value, int64_t, uint64_t>::type;
+    writeInt(Wide(i));
+    afterValue();
+    return *this;
+  }
+
+  // Whether a complete top-level value has been written
+  bool done() const {
+    return done_;
+  }
+
+  // Current nesting depth
+  size_t depth() const {
+    return stack_.size();
+  }
+
+  /**
+   * Commits what has been written so far to the queue, so that it can be
+   * used again.  Writing can continue afterwards.
+   */
+  void flush() {
+    out_.flush();
+  }
+
+ private:
+  // Appends to the preallocated tail of the queue
+  class Output {
+   public:
+    explicit Output(IOBufQueue& queue) : queue_(queue) {}
+
+    void append(const char* data, size_t n) {
+      if (UNLIKELY(size_t(end_ - cur_) < n)) {
+        reserveSlow(n);
+      }
+      memcpy(cur_, data, n);
+      cur_ += n;
+    }
+    void append(StringPiece str) {
+      append(str.data(), str.size());
+    }
+    void push_back(char c) {
+      if (UNLIKELY(cur_ == end_)) {
+        reserveSlow(1);
+      }
+      *cur_++ = c;
+    }
+    Output& operator+=(char c) {
+      push_back(c);
+      return *this;
+    }
+    Output& operator+=(StringPiece str) {
+      append(str);
+      return *this;
+    }
+
+    void flush();
+
+   private:
+    void reserveSlow(size_t n);
+
+    IOBufQueue& queue_;
+    // Preallocated region [begin_, end_), written up to cur_
+    char* begin_{nullptr};
+    char* cur_{nullptr};
+    char* end_{nullptr};
+  };
+
+  struct Frame {
+    bool isObject;
+    bool empty;
+    // Objects: a key has been written, and its value hasn't
+    bool hasKey;
+  };
+
+  void beforeValue();
+  void afterValue() {
+    if (stack_.empty()) {
+      done_ = true;
+    }
+  }
+  void beginKey();
+  void endKey();
+  void begin(bool isObject);
+  void end(bool isObject);
+  void newline();
+
+  void writeInt(int64_t i);
+  void writeInt(uint64_t i);
+  void writeDouble(double d);
+  void writeString(StringPiece str);
+  void writeDynamic(const dynamic& dyn);
+  void writeItem(const dynamic& key, const dynamic& value);
+
+  Output out_;
+  serialization_opts const& opts_;
+  std::vector<Frame> stack_;
+  bool done_{false};
+  // For strings that need escaping, and doubles
+  std::string scratch_;
+};
+
+/*
+ * Serializes dyn to the end of queue, as json::serialize() would.
+ */
+void serialize(
+    const dynamic& dyn,
+    IOBufQueue& queue,
+    serialization_opts const& opts = serialization_opts());
+
+} // namespace json
+} // namespace folly
@@ -0,0 +1,824 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/LazyJson.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/Portability.h>
+#include <folly/Unicode.h>
+#include <folly/lang/Assume.h>
+#include <folly/portability/BitsFunctexcept.h>
+
+#if FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#define FOLLY_LAZYJSON_SSE2 1
+#endif
+
+namespace folly {
+namespace json {
+
+namespace {
+
+enum CharClass : uint8_t {
+  kQuote = 1,
+  kBackslash = 2,
+  kStructural = 4,
+  kWhitespace = 8,
+};
+
+struct CharClasses {
+  uint8_t table[256];
+
+  CharClasses() {
+    std::fill(std::begin(table), std::end(table), 0);
+    table[uint8_t('"')] = kQuote;
+    table[uint8_t('\\')] = kBackslash;
+    for (char c : {'{', '}', '[', ']', ':', ','}) {
+      table[uint8_t(c)] = kStructural;
+    }
+    for (char c : {' ', '\t', '\n', '\r'}) {
+      table[uint8_t(c)] = kWhitespace;
+    }
+  }
+
+  uint8_t operator[](char c) const {
+    return table[uint8_t(c)];
+  }
+};
+
+const CharClasses kCharClasses;
+
+constexpr size_t kBlockSize = 64;
+
+// Bit i is set if byte i of the block is in the class
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t structural;
+  uint64_t whitespace;
+};
+
+#if FOLLY_LAZYJSON_SSE2
+
+inline uint64_t eqMask(__m128i v, char c) {
+  return uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+}
+
+BlockMasks classify(const char* block) {
+  BlockMasks m{0, 0, 0, 0};
+  for (size_t i = 0; i < kBlockSize / 16; ++i) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+    const size_t shift = i * 16;
+    m.quote |= eqMask(v, '"') << shift;
+    m.backslash |= eqMask(v, '\\') << shift;
+    m.structural |=
+        (eqMask(v, '{') | eqMask(v, '}') | eqMask(v, '[') | eqMask(v, ']') |
+         eqMask(v, ':') | eqMask(v, ','))
+        << shift;
+    m.whitespace |=
+        (eqMask(v, ' ') | eqMask(v, '\t') | eqMask(v, '\n') | eqMask(v, '\r'))
+        << shift;
+  }
+  return m;
+}
+
+#else
+
+BlockMasks classify(const char* block) {
+  BlockMasks m{0, 0, 0, 0};
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    auto cls = kCharClasses[block[i]];
+    const uint64_t bit = uint64_t(1) << i;
+    m.quote |= (cls & kQuote) ? bit : 0;
+    m.backslash |= (cls & kBackslash) ? bit : 0;
+    m.structural |= (cls & kStructural) ? bit : 0;
+    m.whitespace |= (cls & kWhitespace) ? bit : 0;
+  }
+  return m;
+}
+
+#endif
+
+// Bit i is the xor of bits 0..i
+inline uint64_t prefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Carries from one block to the next
+struct Stage1State {
+  // The first byte is escaped by a backslash ending the previous block
+  uint64_t prevEscaped{0};
+  // All ones if the previous block ended inside a string
+  uint64_t prevInString{0};
+  // The previous block ended with a scalar character
+  uint64_t prevScalar{0};
+};
+
+// Characters preceded by an odd number of backslashes
+inline uint64_t findEscaped(uint64_t backslash, uint64_t& prevEscaped) {
+  constexpr uint64_t kEvenBits = 0x5555555555555555ULL;
+  backslash &= ~prevEscaped;
+  const uint64_t followsEscape = (backslash << 1) | prevEscaped;
+  // Adding a run's first backslash to the run carries past its end; runs
+  // starting on odd bits are made to start on even ones this way, so that
+  // one mask of alternate bits works for all of them
+  const uint64_t oddStarts = backslash & ~kEvenBits & ~followsEscape;
+  const uint64_t sum = oddStarts + backslash;
+  prevEscaped = sum < oddStarts ? 1 : 0;
+  const uint64_t invert = sum << 1;
+  return (kEvenBits ^ invert) & followsEscape;
+}
+
+inline uint64_t structuralBits(const char* block, Stage1State& state) {
+  const auto m = classify(block);
+  const uint64_t escaped = findEscaped(m.backslash, state.prevEscaped);
+  const uint64_t quote = m.quote & ~escaped;
+  // Set from an opening quote up to, not including, the closing quote
+  const uint64_t inString = prefixXor(quote) ^ state.prevInString;
+  state.prevInString = uint64_t(int64_t(inString) >> 63);
+
+  const uint64_t scalar = ~(m.structural | m.whitespace | quote | inString);
+  const uint64_t scalarStarts = scalar & ~((scalar << 1) | state.prevScalar);
+  state.prevScalar = scalar >> 63;
+
+  return (m.structural & ~inString) | quote | scalarStarts;
+}
+
+inline void appendBits(
+    uint64_t bits,
+    uint32_t base,
+    std::vector<uint32_t>& index) {
+  while (bits) {
+    index.push_back(base + uint32_t(findFirstSet(bits) - 1));
+    bits &= bits - 1;
+  }
+}
+
+inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Whether the unsigned decimal digits overflow int64_t
+bool overflowsInt64(StringPiece digits, bool negative) {
+  while (digits.size() > 1 && digits.front() == '0') {
+    digits.pop_front();
+  }
+  StringPiece limit = negative ? "9223372036854775808" : "9223372036854775807";
+  return digits.size() > limit.size() ||
+      (digits.size() == limit.size() && digits > limit);
+}
+
+} // namespace
+
+namespace detail {
+
+bool findStructurals(StringPiece json, std::vector<uint32_t>& index) {
+  Stage1State state;
+  const char* p = json.data();
+  const size_t size = json.size();
+  size_t pos = 0;
+  for (; pos + kBlockSize <= size; pos += kBlockSize) {
+    appendBits(structuralBits(p + pos, state), uint32_t(pos), index);
+  }
+  if (pos < size) {
+    // Pad the last block with whitespace
+    char block[kBlockSize];
+    std::memset(block, ' ', kBlockSize);
+    std::memcpy(block, p + pos, size - pos);
+    appendBits(structuralBits(block, state), uint32_t(pos), index);
+  }
+  return state.prevInString == 0;
+}
+
+} // namespace detail
+
+LazyDocument::LazyDocument(StringPiece json, serialization_opts const& opts)
+    : json_(json),
+      allowTrailingComma_(opts.allow_trailing_comma),
+      doubleFallback_(opts.double_fallback),
+      numbersAsStrings_(opts.parse_numbers_as_strings),
+      recursionLimit_(opts.recursion_limit) {
+  parse();
+}
+
+void LazyDocument::error(uint32_t offset, const char* what) const {
+  auto before = json_.subpiece(0, offset);
+  auto line = std::count(before.begin(), before.end(), '\n');
+  auto context = json_.subpiece(offset, 16 /* arbitrary */);
+  throw std::runtime_error(to<std::string>(
+      "json parse error on line ",
+      line,
+      !context.empty() ? to<std::string>(" near `", context, '\'') : "",
+      ": ",
+      what));
+}
+
+void LazyDocument::parse() {
+  using detail::TapeKind;
+
+  if (json_.size() >= std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("LazyDocument: json too large");
+  }
+  const char* s = json_.data();
+  const auto end = uint32_t(json_.size());
+
+  std::vector<uint32_t> index;
+  index.reserve(json_.size() / 8 + 1);
+  if (!detail::findStructurals(json_, index)) {
+    error(end, "unterminated string");
+  }
+  tape_.reserve(index.size());
+
+  enum class State { VALUE, ARRAY_NEXT, OBJECT_KEY, OBJECT_NEXT };
+
+  // Tape indices of the open containers
+  std::vector<uint32_t> stack;
+  auto pushString = [&](uint32_t open, size_t& i) {
+    // Stage 1 leaves nothing between a string's quotes
+    auto close = index[i++];
+    DCHECK_EQ(s[close], '"');
+    tape_.push_back({TapeKind::STRING, open + 1, close});
+  };
+  auto closeContainer = [&] {
+    tape_[stack.back()].b = uint32_t(tape_.size());
+    stack.pop_back();
+  };
+  auto next = [&](size_t i) { return i < index.size() ? s[index[i]] : EOF; };
+
+  size_t i = 0;
+  State state = State::VALUE;
+  for (;;) {
+    switch (state) {
+      case State::VALUE: {
+        if (i == index.size()) {
+          error(end, "expected json value");
+        }
+        auto offset = index[i++];
+        if (!stack.empty() && tape_[stack.back()].kind == TapeKind::ARRAY) {
+          ++tape_[stack.back()].a;
+        }
+        const char c = s[offset];
+        if (c == '[' || c == '{') {
+          if (stack.size() >= recursionLimit_) {
+            error(offset, "recursion limit exceeded");
+          }
+          const bool isObject = c == '{';
+          tape_.push_back(
+              {isObject ? TapeKind::OBJECT : TapeKind::ARRAY, 0, 0});
+          stack.push_back(uint32_t(tape_.size() - 1));
+          if (next(i) == (isObject ? '}' : ']')) {
+            ++i;
+            closeContainer();
+            break;
+          }
+          state = isObject ? State::OBJECT_KEY : State::VALUE;
+          continue;
+        }
+        if (c == '"') {
+          pushString(offset, i);
+        } else {
+          parseScalar(offset);
+        }
+        break;
+      }
+
+      case State::ARRAY_NEXT:
+      case State::OBJECT_NEXT: {
+        const bool isObject = state == State::OBJECT_NEXT;
+        const char close = isObject ? '}' : ']';
+        if (i == index.size()) {
+          error(end, isObject ? "expected '}'" : "expected ']'");
+        }
+        auto offset = index[i++];
+        if (s[offset] == ',') {
+          if (allowTrailingComma_ && next(i) == close) {
+            ++i;
+            closeContainer();
+            break;
+          }
+          state = isObject ? State::OBJECT_KEY : State::VALUE;
+          continue;
+        }
+        if (s[offset] != close) {
+          error(offset, isObject ? "expected '}'" : "expected ']'");
+        }
+        closeContainer();
+        break;
+      }
+
+      case State::OBJECT_KEY: {
+        if (i == index.size() || next(i) != '"') {
+          error(
+              i == index.size() ? end : index[i],
+              "expected string for object key name");
+        }
+        auto offset = index[i++];
+        ++tape_[stack.back()].a;
+        pushString(offset, i);
+        if (next(i) != ':') {
+          error(i == index.size() ? end : index[i], "expected ':'");
+        }
+        ++i;
+        state = State::VALUE;
+        continue;
+      }
+    }
+
+    // A value is complete
+    if (stack.empty()) {
+      break;
+    }
+    state = tape_[stack.back()].kind == TapeKind::ARRAY ? State::ARRAY_NEXT
+                                                        : State::OBJECT_NEXT;
+  }
+
+  if (i < index.size() && s[index[i]] != '\0') {
+    error(index[i], "parsing didn't consume all input");
+  }
+}
+
+void LazyDocument::parseScalar(uint32_t offset) {
+  using detail::TapeKind;
+
+  const char* s = json_.data();
+  // Up to the next structural character, as found by stage 1; stray
+  // backslashes and the quotes they escape make the token invalid
+  auto e = offset;
+  while (e < json_.size() &&
+         (kCharClasses[s[e]] & (kStructural | kWhitespace | kQuote)) == 0) {
+    ++e;
+  }
+  const StringPiece token(s + offset, s + e);
+
+  auto push = [&](TapeKind kind) { tape_.push_back({kind, offset, e}); };
+  if (token == "true") {
+    return push(TapeKind::TRUE_);
+  }
+  if (token == "false") {
+    return push(TapeKind::FALSE_);
+  }
+  if (token == "null") {
+    return push(TapeKind::NULLT);
+  }
+  if (token == "Infinity" || token == "-Infinity" || token == "NaN") {
+    return push(numbersAsStrings_ ? TapeKind::NUMBER_STRING : TapeKind::DOUBLE);
+  }
+
+  // -?\d+(\.\d+)?([eE][+-]?\d+)?, leading zeros allowed as in parseJson()
+  const char* p = token.begin();
+  const bool negative = p != token.end() && *p == '-';
+  if (negative) {
+    ++p;
+  }
+  const char* digits = p;
+  while (p != token.end() && isDigit(*p)) {
+    ++p;
+  }
+  if (p == digits) {
+    error(offset, negative ? "expected digits after `-'" : "expected json value");
+  }
+  const StringPiece integral(digits, p);
+  bool isDouble = false;
+  if (p != token.end() && *p == '.') {
+    isDouble = true;
+    const char* fraction = ++p;
+    while (p != token.end() && isDigit(*p)) {
+      ++p;
+    }
+    if (p == fraction) {
+      error(offset, "expected digits after `.'");
+    }
+  }
+  if (p != token.end() && (*p == 'e' || *p == 'E')) {
+    isDouble = true;
+    ++p;
+    if (p != token.end() && (*p == '+' || *p == '-')) {
+      ++p;
+    }
+    const char* exponent = p;
+    while (p != token.end() && isDigit(*p)) {
+      ++p;
+    }
+    if (p == exponent) {
+      error(offset, "expected digits in exponent");
+    }
+  }
+  if (p != token.end()) {
+    error(offset, "invalid number");
+  }
+
+  if (numbersAsStrings_) {
+    return push(TapeKind::NUMBER_STRING);
+  }
+  if (!isDouble && overflowsInt64(integral, negative)) {
+    if (!doubleFallback_) {
+      error(offset, "integer out of range");
+    }
+    isDouble = true;
+  }
+  push(isDouble ? TapeKind::DOUBLE : TapeKind::INT64);
+}
+
+void LazyDocument::decodeString(
+    uint32_t begin,
+    uint32_t end,
+    std::string& out) const {
+  const char* s = json_.data();
+  if (std::memchr(s + begin, '\0', end - begin) != nullptr) {
+    error(begin, "null byte in string");
+  }
+
+  auto hexVal = [&](uint32_t pos) -> uint16_t {
+    char c = s[pos];
+    return uint16_t(
+        c >= '0' && c <= '9' ? c - '0' :
+        c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+        c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+        (error(pos, "invalid hex digit"), 0));
+  };
+  auto readHex = [&](uint32_t& pos) -> uint16_t {
+    if (end - pos < 4) {
+      error(pos, "expected 4 hex digits");
+    }
+    uint16_t ret = uint16_t(
+        hexVal(pos) * 4096 + hexVal(pos + 1) * 256 + hexVal(pos + 2) * 16 +
+        hexVal(pos + 3));
+    pos += 4;
+    return ret;
+  };
+
+  auto pos = begin;
+  while (pos < end) {
+    auto bs = static_cast<const char*>(std::memchr(s + pos, '\\', end - pos));
+    if (bs == nullptr) {
+      out.append(s + pos, s + end);
+      break;
+    }
+    out.append(s + pos, bs);
+    pos = uint32_t(bs - s) + 1;
+    // Stage 1 never ends a string on a backslash
+    const char c = s[pos++];
+    switch (c) {
+      case '\"': out.push_back('\"'); break;
+      case '\\': out.push_back('\\'); break;
+      case '/':  out.push_back('/');  break;
+      case 'b':  out.push_back('\b'); break;
+      case 'f':  out.push_back('\f'); break;
+      case 'n':  out.push_back('\n'); break;
+      case 'r':  out.push_back('\r'); break;
+      case 't':  out.push_back('\t'); break;
+      case 'u': {
+        uint32_t codePoint = readHex(pos);
+        if (codePoint >= 0xd800 && codePoint <= 0xdbff) {
+          if (end - pos < 2 || s[pos] != '\\' || s[pos + 1] != 'u') {
+            error(pos, "expected another unicode escape for second half of "
+                       "surrogate pair");
+          }
+          pos += 2;
+          uint16_t second = readHex(pos);
+          if (second >= 0xdc00 && second <= 0xdfff) {
+            codePoint = 0x10000 + ((codePoint & 0x3ff) << 10) +
+                        (second & 0x3ff);
+          } else {
+            error(pos, "second character in surrogate pair is invalid");
+          }
+        } else if (codePoint >= 0xdc00 && codePoint <= 0xdfff) {
+          error(pos, "invalid unicode code point (in range [0xdc00,0xdfff])");
+        }
+        out += codePointToUtf8(codePoint);
+        break;
+      }
+      default:
+        error(pos - 1, to<std::string>("unknown escape ", c, " in string")
+                           .c_str());
+    }
+  }
+}
+
+StringPiece LazyDocument::copyToArena(StringPiece str) const {
+  std::lock_guard<std::mutex> g(arenaMutex_);
+  auto p = static_cast<char*>(arena_.allocate(std::max<size_t>(str.size(), 1)));
+  std::memcpy(p, str.data(), str.size());
+  return StringPiece(p, str.size());
+}
+
+size_t LazyDocument::arenaSize() const {
+  std::lock_guard<std::mutex> g(arenaMutex_);
+  return arena_.totalSize();
+}
+
+dynamic LazyDocument::toDynamic() const {
+  return root().toDynamic();
+}
+
+dynamic::Type LazyValue::type() const {
+  using detail::TapeKind;
+  switch (entry().kind) {
+    case TapeKind::NULLT:
+      return dynamic::NULLT;
+    case TapeKind::TRUE_:
+    case TapeKind::FALSE_:
+      return dynamic::BOOL;
+    case TapeKind::INT64:
+      return dynamic::INT64;
+    case TapeKind::DOUBLE:
+      return dynamic::DOUBLE;
+    case TapeKind::STRING:
+    case TapeKind::NUMBER_STRING:
+      return dynamic::STRING;
+    case TapeKind::ARRAY:
+      return dynamic::ARRAY;
+    case TapeKind::OBJECT:
+      return dynamic::OBJECT;
+  }
+  assume_unreachable();
+}
+
+const char* LazyValue::typeName() const {
+  switch (type()) {
+    case dynamic::NULLT:
+      return "null";
+    case dynamic::BOOL:
+      return "boolean";
+    case dynamic::INT64:
+      return "int64";
+    case dynamic::DOUBLE:
+      return "double";
+    case dynamic::STRING:
+      return "string";
+    case dynamic::ARRAY:
+      return "array";
+    case dynamic::OBJECT:
+      return "object";
+  }
+  assume_unreachable();
+}
+
+bool LazyValue::isNull() const {
+  return type() == dynamic::NULLT;
+}
+bool LazyValue::isBool() const {
+  return type() == dynamic::BOOL;
+}
+bool LazyValue::isInt() const {
+  return type() == dynamic::INT64;
+}
+bool LazyValue::isDouble() const {
+  return type() == dynamic::DOUBLE;
+}
+bool LazyValue::isNumber() const {
+  return isInt() || isDouble();
+}
+bool LazyValue::isString() const {
+  return type() == dynamic::STRING;
+}
+bool LazyValue::isArray() const {
+  return type() == dynamic::ARRAY;
+}
+bool LazyValue::isObject() const {
+  return type() == dynamic::OBJECT;
+}
+
+StringPiece LazyValue::text() const {
+  const char* s = doc_->json_.data();
+  return StringPiece(s + entry().a, s + entry().b);
+}
+
+bool LazyValue::getBool() const {
+  if (!isBool()) {
+    throw TypeError("bool", type());
+  }
+  return entry().kind == detail::TapeKind::TRUE_;
+}
+
+int64_t LazyValue::getInt() const {
+  if (!isInt()) {
+    throw TypeError("int64", type());
+  }
+  return to<int64_t>(text());
+}
+
+double LazyValue::getDouble() const {
+  if (isInt()) {
+    return double(getInt());
+  }
+  if (!isDouble()) {
+    throw TypeError("double", type());
+  }
+  auto t = text();
+  if (t == "Infinity") {
+    return std::numeric_limits<double>::infinity();
+  }
+  if (t == "-Infinity") {
+    return -std::numeric_limits<double>::infinity();
+  }
+  if (t == "NaN") {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return to<double>(t);
+}
+
+std::string LazyValue::getString() const {
+  if (!isString()) {
+    throw TypeError("string", type());
+  }
+  if (entry().kind == detail::TapeKind::NUMBER_STRING) {
+    return text().str();
+  }
+  std::string out;
+  out.reserve(entry().b - entry().a);
+  doc_->decodeString(entry().a, entry().b, out);
+  return out;
+}
+
+StringPiece LazyValue::getRawString() const {
+  if (!isString()) {
+    throw TypeError("string", type());
+  }
+  return text();
+}
+
+StringPiece LazyValue::stringPiece() const {
+  auto raw = getRawString();
+  if (entry().kind == detail::TapeKind::NUMBER_STRING ||
+      std::memchr(raw.data(), '\\', raw.size()) == nullptr) {
+    return raw;
+  }
+  return doc_->copyToArena(getString());
+}
+
+void LazyValue::checkScalar(const char* expected) const {
+  if (isArray() || isObject()) {
+    throw TypeError(expected, type());
+  }
+}
+
+std::string LazyValue::asString() const {
+  checkScalar("string");
+  return toDynamic().asString();
+}
+
+double LazyValue::asDouble() const {
+  checkScalar("double");
+  return toDynamic().asDouble();
+}
+
+int64_t LazyValue::asInt() const {
+  checkScalar("int64");
+  return toDynamic().asInt();
+}
+
+bool LazyValue::asBool() const {
+  checkScalar("boolean");
+  return toDynamic().asBool();
+}
+
+size_t LazyValue::size() const {
+  if (!isArray() && !isObject()) {
+    throw TypeError("array/object", type());
+  }
+  return entry().a;
+}
+
+uint32_t LazyValue::skip() const {
+  return isArray() || isObject() ? entry().b : index_ + 1;
+}
+
+LazyValue LazyValue::operator[](size_t index) const {
+  if (!isArray()) {
+    throw TypeError("array", type());
+  }
+  if (index >= entry().a) {
+    std::__throw_out_of_range("out of range in json array");
+  }
+  auto it = begin();
+  for (; index > 0; --index) {
+    ++it;
+  }
+  return *it;
+}
+
+bool LazyValue::keyEquals(StringPiece key) const {
+  auto raw = text();
+  if (std::memchr(raw.data(), '\\', raw.size()) == nullptr) {
+    return raw == key;
+  }
+  return getString() == key;
+}
+
+Optional<LazyValue> LazyValue::find(StringPiece key) const {
+  if (!isObject()) {
+    throw TypeError("object", type());
+  }
+  Optional<LazyValue> found;
+  for (auto item : items()) {
+    if (item.first.keyEquals(key)) {
+      found = item.second;
+    }
+  }
+  return found;
+}
+
+LazyValue LazyValue::operator[](StringPiece key) const {
+  auto value = find(key);
+  if (!value) {
+    std::__throw_out_of_range("couldn't find key in json object");
+  }
+  return *value;
+}
+
+LazyValue::const_iterator LazyValue::begin() const {
+  if (!isArray()) {
+    throw TypeError("array", type());
+  }
+  return const_iterator(doc_, index_ + 1);
+}
+
+LazyValue::const_iterator LazyValue::end() const {
+  if (!isArray()) {
+    throw TypeError("array", type());
+  }
+  return const_iterator(doc_, entry().b);
+}
+
+template <LazyValue::IterationMode Mode>
+LazyValue::IterableProxy<LazyValue::Iterator<Mode>> LazyValue::objectRange()
+    const {
+  if (!isObject()) {
+    throw TypeError("object", type());
+  }
+  return {Iterator<Mode>(doc_, index_ + 1), Iterator<Mode>(doc_, entry().b)};
+}
+
+LazyValue::IterableProxy<LazyValue::const_key_iterator> LazyValue::keys()
+    const {
+  return objectRange<IterationMode::KEYS>();
+}
+
+LazyValue::IterableProxy<LazyValue::const_value_iterator> LazyValue::values()
+    const {
+  return objectRange<IterationMode::VALUES>();
+}
+
+LazyValue::IterableProxy<LazyValue::const_item_iterator> LazyValue::items()
+    const {
+  return objectRange<IterationMode::ITEMS>();
+}
+
+dynamic LazyValue::toDynamic() const {
+  switch (type()) {
+    case dynamic::NULLT:
+      return nullptr;
+    case dynamic::BOOL:
+      return getBool();
+    case dynamic::INT64:
+      return getInt();
+    case dynamic::DOUBLE:
+      return getDouble();
+    case dynamic::STRING:
+      return getString();
+    case dynamic::ARRAY: {
+      dynamic ret = dynamic::array;
+      for (auto value : *this) {
+        ret.push_back(value.toDynamic());
+      }
+      return ret;
+    }
+    case dynamic::OBJECT: {
+      dynamic ret = dynamic::object;
+      for (auto item : items()) {
+        ret.insert(item.first.getString(), item.second.toDynamic());
+      }
+      return ret;
+    }
+  }
+  assume_unreachable();
+}
+
+} // namespace json
+} // namespace folly
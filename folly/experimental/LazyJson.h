@@ -0,0 +1,350 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A read-only JSON parser that doesn't build a folly::dynamic.
+ *
+ * LazyDocument parses in two passes, in the style of simdjson:
+ *
+ *  1. Find the structural characters ({}[]:, and quotes) outside of
+ *     strings, and the first character of every other value, 64 bytes at a
+ *     time.  Quote, backslash and whitespace positions become bitmasks (with
+ *     SSE2 on x86, a table lookup per byte elsewhere), escaped quotes and
+ *     string interiors are masked out with bit arithmetic, and the remaining
+ *     positions are appended to an index.
+ *
+ *  2. Walk the index to check the grammar, and write a tape: one entry per
+ *     value, in document order.  A string or number entry is just its
+ *     offset in the input; an array or object entry records how many
+ *     elements it has and where on the tape it ends, so that it can be
+ *     skipped in one step.
+ *
+ * Nothing is allocated per value.  LazyValue is a (document, tape index)
+ * pair, and decodes what it points to when asked: strings are unescaped by
+ * getString(), numbers converted by getInt() and getDouble(), and
+ * toDynamic() builds a dynamic for any subtree.  Looking up an array index
+ * or object key walks the container's elements, skipping nested containers;
+ * use the iterators to visit all of them.
+ *
+ * For code that only reads a parsed document, LazyValue has the read-only
+ * accessors of dynamic (type checks, asX() conversions, stringPiece(),
+ * operator[], find(), keys(), values(), items()), and can replace it without
+ * any allocation per node: the document owns one tape plus, for strings
+ * with escape sequences read through stringPiece(), a SysArena, and
+ * destroying it frees everything in a few calls to free() however big the
+ * document is.
+ *
+ * Parsing follows parseJson() and its options (allow_trailing_comma,
+ * recursion_limit, double_fallback and parse_numbers_as_strings are
+ * honored; allow_non_string_keys is not supported), except that numbers
+ * must follow the JSON grammar strictly, and that escape sequences and null
+ * bytes in strings are only checked when the string is decoded.  Parse errors throw
+ * std::runtime_error; accessing a value as the wrong type throws TypeError.
+ *
+ * The document refers to the input and doesn't copy it: the input must
+ * outlive the document and all values and StringPieces obtained from it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+#include <folly/memory/Arena.h>
+
+namespace folly {
+namespace json {
+
+class LazyValue;
+
+namespace detail {
+
+enum class TapeKind : uint8_t {
+  NULLT,
+  TRUE_,
+  FALSE_,
+  INT64,
+  DOUBLE,
+  STRING,
+  // a number, with parse_numbers_as_strings
+  NUMBER_STRING,
+  ARRAY,
+  OBJECT,
+};
+
+struct TapeEntry {
+  TapeKind kind;
+  // Scalars: first byte of the value in the input (after the opening quote
+  // for strings).  Containers: number of elements (key/value pairs for
+  // objects).
+  uint32_t a;
+  // Scalars: end of the value in the input (at the closing quote for
+  // strings).  Containers: tape index past the last element.
+  uint32_t b;
+};
+
+// Stage 1: appends the input offsets of structural characters, of both
+// quotes of every string and of the first character of every other scalar
+// to index.  Returns false if the last string is unterminated.
+bool findStructurals(StringPiece json, std::vector<uint32_t>& index);
+
+} // namespace detail
+
+class LazyDocument {
+ public:
+  /**
+   * Parses json, which isn't copied and must outlive the document.  Throws
+   * std::runtime_error if json is malformed.
+   */
+  explicit LazyDocument(
+      StringPiece json,
+      serialization_opts const& opts = serialization_opts());
+
+  LazyDocument(const LazyDocument&) = delete;
+  LazyDocument& operator=(const LazyDocument&) = delete;
+
+  LazyValue root() const;
+
+  dynamic toDynamic() const;
+
+  StringPiece json() const {
+    return json_;
+  }
+
+  // Number of values in the document
+  size_t size() const {
+    return tape_.size();
+  }
+
+  // Bytes allocated for strings decoded by LazyValue::stringPiece()
+  size_t arenaSize() const;
+
+ private:
+  friend class LazyValue;
+
+  void parse();
+  void parseScalar(uint32_t offset);
+  // Appends the string between offsets begin and end, unescaped, to out
+  void decodeString(uint32_t begin, uint32_t end, std::string& out) const;
+  StringPiece copyToArena(StringPiece str) const;
+  [[noreturn]] void error(uint32_t offset, const char* what) const;
+
+  StringPiece json_;
+  bool allowTrailingComma_;
+  bool doubleFallback_;
+  bool numbersAsStrings_;
+  unsigned int recursionLimit_;
+  std::vector<detail::TapeEntry> tape_;
+
+  // Decoded strings; freed all at once with the document
+  mutable std::mutex arenaMutex_;
+  mutable SysArena arena_;
+};
+
+class LazyValue {
+ public:
+  enum class IterationMode {
+    ELEMENTS, // of an array
+    KEYS,
+    VALUES,
+    ITEMS,
+  };
+
+  template <IterationMode Mode>
+  class Iterator;
+
+  using ItemType = std::pair<LazyValue, LazyValue>;
+  using const_iterator = Iterator<IterationMode::ELEMENTS>;
+  using const_key_iterator = Iterator<IterationMode::KEYS>;
+  using const_value_iterator = Iterator<IterationMode::VALUES>;
+  using const_item_iterator = Iterator<IterationMode::ITEMS>;
+
+  template <class It>
+  struct IterableProxy {
+    It b;
+    It e;
+
+    It begin() const {
+      return b;
+    }
+    It end() const {
+      return e;
+    }
+  };
+
+  dynamic::Type type() const;
+  const char* typeName() const;
+
+  bool isNull() const;
+  bool isBool() const;
+  bool isInt() const;
+  bool isDouble() const;
+  bool isNumber() const;
+  bool isString() const;
+  bool isArray() const;
+  bool isObject() const;
+
+  bool getBool() const;
+  int64_t getInt() const;
+  // Also converts integers
+  double getDouble() const;
+  // Decodes escape sequences
+  std::string getString() const;
+  // The string as it appears in the input, between the quotes
+  StringPiece getRawString() const;
+
+  /**
+   * The decoded string, without a copy unless it has escape sequences, in
+   * which case it is decoded into the document's arena (on every call).
+   * Valid for the lifetime of the document.
+   */
+  StringPiece stringPiece() const;
+
+  // Scalar conversions with the semantics of dynamic's; throw TypeError for
+  // arrays and objects
+  std::string asString() const;
+  double asDouble() const;
+  int64_t asInt() const;
+  bool asBool() const;
+
+  // Number of elements of an array, or of key/value pairs of an object
+  size_t size() const;
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /**
+   * Array element; linear in index.  Throws std::out_of_range if there is no
+   * such element.
+   */
+  LazyValue operator[](size_t index) const;
+  LazyValue at(size_t index) const {
+    return (*this)[index];
+  }
+
+  /**
+   * Value for key, linear in the size of the object.  Throws
+   * std::out_of_range if key is missing.  If the object has the key more
+   * than once, the last value wins, as in parseJson().
+   */
+  LazyValue operator[](StringPiece key) const;
+  LazyValue at(StringPiece key) const {
+    return (*this)[key];
+  }
+  Optional<LazyValue> find(StringPiece key) const;
+  size_t count(StringPiece key) const {
+    return find(key).hasValue() ? 1 : 0;
+  }
+
+  // Elements of an array
+  const_iterator begin() const;
+  const_iterator end() const;
+  // Keys, values and key/value pairs of an object
+  IterableProxy<const_key_iterator> keys() const;
+  IterableProxy<const_value_iterator> values() const;
+  IterableProxy<const_item_iterator> items() const;
+
+  dynamic toDynamic() const;
+
+ private:
+  friend class LazyDocument;
+
+  LazyValue(const LazyDocument* doc, uint32_t index)
+      : doc_(doc), index_(index) {}
+
+  const detail::TapeEntry& entry() const {
+    return doc_->tape_[index_];
+  }
+  StringPiece text() const;
+  bool keyEquals(StringPiece key) const;
+  // Tape index past this value
+  uint32_t skip() const;
+  void checkScalar(const char* expected) const;
+  template <IterationMode Mode>
+  IterableProxy<Iterator<Mode>> objectRange() const;
+
+  const LazyDocument* doc_;
+  uint32_t index_;
+};
+
+template <LazyValue::IterationMode Mode>
+class LazyValue::Iterator : public std::iterator<
+                                std::forward_iterator_tag,
+                                const typename std::conditional<
+                                    Mode == IterationMode::ITEMS,
+                                    ItemType,
+                                    LazyValue>::type> {
+ public:
+  using Value = typename std::
+      conditional<Mode == IterationMode::ITEMS, ItemType, LazyValue>::type;
+
+  Iterator() = default;
+
+  Value operator*() const {
+    return deref(static_cast<Value*>(nullptr));
+  }
+
+  Iterator& operator++() {
+    // Object iterators point at the key, and skip it and then the value
+    const bool isObject = Mode != IterationMode::ELEMENTS;
+    index_ = LazyValue(doc_, index_ + (isObject ? 1 : 0)).skip();
+    return *this;
+  }
+  Iterator operator++(int) {
+    auto it = *this;
+    ++*this;
+    return it;
+  }
+
+  bool operator==(const Iterator& other) const {
+    return index_ == other.index_;
+  }
+  bool operator!=(const Iterator& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  friend class LazyValue;
+
+  Iterator(const LazyDocument* doc, uint32_t index)
+      : doc_(doc), index_(index) {}
+
+  LazyValue deref(LazyValue*) const {
+    return LazyValue(doc_, index_ + (Mode == IterationMode::VALUES ? 1 : 0));
+  }
+  ItemType deref(ItemType*) const {
+    return {LazyValue(doc_, index_), LazyValue(doc_, index_ + 1)};
+  }
+
+  const LazyDocument* doc_{nullptr};
+  uint32_t index_{0};
+};
+
+inline LazyValue LazyDocument::root() const {
+  return LazyValue(this, 0);
+}
+
+} // namespace json
+} // namespace folly
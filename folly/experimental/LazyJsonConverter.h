@@ -0,0 +1,326 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Decodes a LazyValue (see LazyJson.h) into C++ types, like convertTo<T>()
+ * of DynamicConverter.h does for dynamic, but without building a dynamic
+ * first.
+ *
+ * Structs are bound through a table of their fields, given by specializing
+ * JsonFields:
+ *
+ *   struct Endpoint {
+ *     StringPiece host;
+ *     uint16_t port{80};
+ *     Optional<std::vector<std::string>> tags;
+ *   };
+ *
+ *   namespace folly { namespace json {
+ *   template <>
+ *   struct JsonFields<Endpoint> {
+ *     static auto fields() {
+ *       return std::make_tuple(
+ *           jsonField("host", &Endpoint::host),
+ *           jsonField("port", &Endpoint::port),
+ *           jsonField("tags", &Endpoint::tags));
+ *     }
+ *   };
+ *   }}
+ *
+ *   LazyDocument doc(input);
+ *   auto endpoint = json::convertTo<Endpoint>(doc.root());
+ *
+ * The object is walked once, and each key is matched against the names of
+ * the fields; keys without a field are ignored, and fields without a key
+ * keep their default value (an Optional field is only set if its key is
+ * there and not null). As in parseJson(), the last of duplicate keys wins.
+ *
+ * StringPiece and LazyValue targets aren't copied: they point into the
+ * input (or, for strings with escape sequences, into the arena of the
+ * document), and are valid as long as the document and the input are.
+ *
+ * Scalars are converted with the semantics of dynamic's asX() (so "12"
+ * converts to an int), and narrowed with folly::to(). Mismatched types
+ * throw TypeError, and out-of-range numbers ConversionError. Other types
+ * are supported by specializing LazyConverter.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Conv.h>
+#include <folly/DynamicConverter.h>
+#include <folly/FBString.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/Utility.h>
+#include <folly/dynamic.h>
+#include <folly/experimental/LazyJson.h>
+
+namespace folly {
+namespace json {
+
+template <class T>
+T convertTo(const LazyValue& value);
+
+/**
+ * Each specialization of LazyConverter has the function
+ *     'static T convert(const LazyValue&);'
+ */
+template <class T, class Enable = void>
+struct LazyConverter;
+
+/**
+ * Specialize with a static fields() returning a tuple of jsonField()s to
+ * decode a struct from an object.
+ */
+template <class T>
+struct JsonFields {};
+
+template <class T, class M>
+struct JsonField {
+  StringPiece name;
+  M T::*member;
+};
+
+template <class T, class M>
+constexpr JsonField<T, M> jsonField(StringPiece name, M T::*member) {
+  return {name, member};
+}
+
+namespace detail {
+
+template <class T, class = void>
+struct HasJsonFields : std::false_type {};
+
+template <class T>
+struct HasJsonFields<T, void_t<decltype(JsonFields<T>::fields())>>
+    : std::true_type {};
+
+template <class T, class M>
+bool bindIfNamed(
+    T& out,
+    StringPiece key,
+    const LazyValue& value,
+    const JsonField<T, M>& field) {
+  if (key != field.name) {
+    return false;
+  }
+  out.*field.member = convertTo<M>(value);
+  return true;
+}
+
+template <class T, class Fields, std::size_t... Is>
+void bindField(
+    T& out,
+    StringPiece key,
+    const LazyValue& value,
+    const Fields& fields,
+    index_sequence<Is...>) {
+  // Stops at the first field of that name
+  bool bound = false;
+  (void)std::initializer_list<bool>{
+      (bound =
+           bound || bindIfNamed(out, key, value, std::get<Is>(fields)))...};
+}
+
+} // namespace detail
+
+// bool
+template <>
+struct LazyConverter<bool> {
+  static bool convert(const LazyValue& v) {
+    return v.asBool();
+  }
+};
+
+// integrals
+template <class T>
+struct LazyConverter<
+    T,
+    typename std::enable_if<
+        std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+  static T convert(const LazyValue& v) {
+    return folly::to<T>(v.asInt());
+  }
+};
+
+// enums
+template <class T>
+struct LazyConverter<
+    T,
+    typename std::enable_if<std::is_enum<T>::value>::type> {
+  static T convert(const LazyValue& v) {
+    using type = typename std::underlying_type<T>::type;
+    return static_cast<T>(LazyConverter<type>::convert(v));
+  }
+};
+
+// floating point
+template <class T>
+struct LazyConverter<
+    T,
+    typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static T convert(const LazyValue& v) {
+    return folly::to<T>(v.asDouble());
+  }
+};
+
+// strings: copied, and decoded
+template <>
+struct LazyConverter<std::string> {
+  static std::string convert(const LazyValue& v) {
+    return v.asString();
+  }
+};
+
+template <>
+struct LazyConverter<fbstring> {
+  static fbstring convert(const LazyValue& v) {
+    return fbstring(v.asString());
+  }
+};
+
+// strings: not copied
+template <>
+struct LazyConverter<StringPiece> {
+  static StringPiece convert(const LazyValue& v) {
+    return v.stringPiece();
+  }
+};
+
+// subtrees, left to be decoded later
+template <>
+struct LazyConverter<LazyValue> {
+  static LazyValue convert(const LazyValue& v) {
+    return v;
+  }
+};
+
+template <>
+struct LazyConverter<dynamic> {
+  static dynamic convert(const LazyValue& v) {
+    return v.toDynamic();
+  }
+};
+
+// null, or a value
+template <class T>
+struct LazyConverter<Optional<T>> {
+  static Optional<T> convert(const LazyValue& v) {
+    if (v.isNull()) {
+      return none;
+    }
+    return convertTo<T>(v);
+  }
+};
+
+// std::pair: an array of 2, or an object of 1
+template <class F, class S>
+struct LazyConverter<std::pair<F, S>> {
+  static std::pair<F, S> convert(const LazyValue& v) {
+    if (v.isArray() && v.size() == 2) {
+      return std::make_pair(convertTo<F>(v[0]), convertTo<S>(v[1]));
+    } else if (v.isObject() && v.size() == 1) {
+      auto item = *v.items().begin();
+      return std::make_pair(
+          convertTo<F>(item.first), convertTo<S>(item.second));
+    } else {
+      throw TypeError("array (size 2) or object (size 1)", v.type());
+    }
+  }
+};
+
+// non-associative containers, from arrays
+template <class C>
+struct LazyConverter<
+    C,
+    typename std::enable_if<
+        dynamicconverter_detail::is_container<C>::value &&
+        !dynamicconverter_detail::is_associative<C>::value>::type> {
+  static C convert(const LazyValue& v) {
+    if (!v.isArray()) {
+      throw TypeError("array", v.type());
+    }
+    C ret;
+    for (auto element : v) {
+      ret.insert(ret.end(), convertTo<typename C::value_type>(element));
+    }
+    return ret;
+  }
+};
+
+// associative containers, from objects
+template <class C>
+struct LazyConverter<
+    C,
+    typename std::enable_if<
+        dynamicconverter_detail::is_container<C>::value &&
+        dynamicconverter_detail::is_map<C>::value>::type> {
+  static C convert(const LazyValue& v) {
+    if (!v.isObject()) {
+      throw TypeError("object", v.type());
+    }
+    C ret;
+    for (auto item : v.items()) {
+      // The last of duplicate keys wins
+      ret[convertTo<typename C::key_type>(item.first)] =
+          convertTo<typename C::mapped_type>(item.second);
+    }
+    return ret;
+  }
+};
+
+// structs with a JsonFields specialization, from objects
+template <class T>
+struct LazyConverter<
+    T,
+    typename std::enable_if<detail::HasJsonFields<T>::value>::type> {
+  static T convert(const LazyValue& v) {
+    if (!v.isObject()) {
+      throw TypeError("object", v.type());
+    }
+    const auto fields = JsonFields<T>::fields();
+    using Indices =
+        make_index_sequence<std::tuple_size<decltype(fields)>::value>;
+    T ret;
+    for (auto item : v.items()) {
+      detail::bindField(
+          ret, item.first.stringPiece(), item.second, fields, Indices{});
+    }
+    return ret;
+  }
+};
+
+template <class T>
+T convertTo(const LazyValue& value) {
+  return LazyConverter<typename std::remove_cv<T>::type>::convert(value);
+}
+
+template <class T>
+T convertTo(const LazyDocument& doc) {
+  return convertTo<T>(doc.root());
+}
+
+} // namespace json
+} // namespace folly
@@ -21,10 +21,13 @@
 #include <cstring>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
+#include <folly/CachelinePadded.h>
 #include <folly/Portability.h>
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/detail/TurnSequencer.h>
 #include <folly/portability/TypeTraits.h>
 #include <folly/portability/Unistd.h>
@@ -98,6 +101,8 @@ class LockFreeRingBuffer: boost::noncopyable {
 
   explicit LockFreeRingBuffer(uint32_t capacity) noexcept
     : capacity_(capacity)
+    , pow2_((capacity & (capacity - 1)) == 0)
+    , shift_(pow2_ ? uint8_t(__builtin_ctz(capacity)) : 0)
     , slots_(new detail::RingBufferSlot<T,Atom>[capacity])
     , ticket_(0)
   {}
@@ -120,6 +125,25 @@ class LockFreeRingBuffer: boost::noncopyable {
     return Cursor(ticket);
   }
 
+  /// Perform count consecutive writes of values[0], ..., values[count - 1]
+  /// with a single atomic increment of the ticket: writes from other
+  /// threads never land in the middle of the range.  Can block like
+  /// write(), and if count > capacity only the last <capacity> values
+  /// remain readable.  Returns a Cursor pointing to the first of them.
+  Cursor writeRange(const T* values, size_t count) noexcept {
+    uint64_t ticket = ticket_.fetch_add(count);
+    uint32_t i = idx(ticket);
+    uint32_t t = turn(ticket);
+    for (size_t n = 0; n < count; ++n) {
+      slots_[i].write(t, values[n]);
+      if (++i == capacity_) {
+        i = 0;
+        ++t;
+      }
+    }
+    return Cursor(ticket);
+  }
+
   /// Read the value at the cursor.
   /// Returns true if the read succeeded, false otherwise. If the return
   /// value is false, dest is to be considered partially read and in an
@@ -136,6 +160,28 @@ class LockFreeRingBuffer: boost::noncopyable {
     return slots_[idx(cursor.ticket)].waitAndTryRead(dest, turn(cursor.ticket));
   }
 
+  /// Read up to count consecutive writes, starting at the cursor, into
+  /// dest.  Stops at the first write that hasn't occurred yet or was
+  /// already overwritten, and moves the cursor past the ones read.
+  /// Returns how many were read; dest[n] for n >= that value is to be
+  /// considered garbage.  To take a snapshot of the buffer, start from
+  /// currentTail(), with some skipFraction if writers might otherwise
+  /// overwrite the oldest entries before they are read.
+  size_t tryReadRange(T* dest, size_t count, Cursor& cursor) noexcept {
+    uint32_t i = idx(cursor.ticket);
+    uint32_t t = turn(cursor.ticket);
+    size_t n = 0;
+    while (n < count && slots_[i].tryRead(dest[n], t)) {
+      ++n;
+      if (++i == capacity_) {
+        i = 0;
+        ++t;
+      }
+    }
+    cursor.ticket += n;
+    return n;
+  }
+
   /// Returns a Cursor pointing to the first write that has not occurred yet.
   Cursor currentHead() noexcept {
     return Cursor(ticket_.load());
@@ -160,25 +206,93 @@ class LockFreeRingBuffer: boost::noncopyable {
     return Cursor(ticket - backStep);
   }
 
+  uint32_t capacity() const noexcept {
+    return capacity_;
+  }
+
   ~LockFreeRingBuffer() {
   }
 
  private:
   const uint32_t capacity_;
 
+  // A 64-bit division costs more than the rest of a write, so power of
+  // two capacities use a mask and a shift instead
+  const bool pow2_;
+  const uint8_t shift_;
+
   const std::unique_ptr<detail::RingBufferSlot<T,Atom>[]> slots_;
 
   Atom<uint64_t> ticket_;
 
   uint32_t idx(uint64_t ticket) noexcept {
-    return ticket % capacity_;
+    return pow2_ ? uint32_t(ticket & (capacity_ - 1))
+                 : uint32_t(ticket % capacity_);
   }
 
   uint32_t turn(uint64_t ticket) noexcept {
-    return (uint32_t)(ticket / capacity_);
+    return pow2_ ? uint32_t(ticket >> shift_) : uint32_t(ticket / capacity_);
   }
 }; // LockFreeRingBuffer
 
+/// A LockFreeRingBuffer per CPU (as picked by AccessSpreader), so that
+/// writers on different cores don't contend on the same ticket and slots.
+/// Each shard is a complete LockFreeRingBuffer with its own stream of
+/// writes, read through shard(i); the order of writes is only kept within
+/// a shard, so records that need a global order should carry a timestamp.
+/// A thread that migrates mid-write is harmless: shards take writes from
+/// any thread.
+///
+///   ShardedLockFreeRingBuffer<Event> events(1024);
+///   events.write(event);                     // hot path
+///   for (size_t i = 0; i < events.numShards(); ++i) {
+///     auto& shard = events.shard(i);
+///     auto cursor = shard.currentTail();
+///     n = shard.tryReadRange(buf, shard.capacity(), cursor);
+///   }
+template <typename T, template <typename> class Atom = std::atomic>
+class ShardedLockFreeRingBuffer : boost::noncopyable {
+ public:
+  using Shard = LockFreeRingBuffer<T, Atom>;
+
+  explicit ShardedLockFreeRingBuffer(
+      uint32_t shardCapacity,
+      size_t numShards = CacheLocality::system<Atom>().numCpus) {
+    assert(numShards > 0);
+    shards_.reserve(numShards);
+    for (size_t i = 0; i < numShards; ++i) {
+      shards_.emplace_back(new CachelinePadded<Shard>(shardCapacity));
+    }
+  }
+
+  /// Writes to the current CPU's shard.  See LockFreeRingBuffer::write().
+  void write(T& value) noexcept {
+    localShard().write(value);
+  }
+
+  /// Writes a contiguous range to the current CPU's shard.  See
+  /// LockFreeRingBuffer::writeRange().
+  void writeRange(const T* values, size_t count) noexcept {
+    localShard().writeRange(values, count);
+  }
+
+  /// The shard the current CPU writes to
+  Shard& localShard() noexcept {
+    return **shards_[AccessSpreader<Atom>::current(shards_.size())];
+  }
+
+  Shard& shard(size_t i) noexcept {
+    return **shards_[i];
+  }
+
+  size_t numShards() const noexcept {
+    return shards_.size();
+  }
+
+ private:
+  std::vector<std::unique_ptr<CachelinePadded<Shard>>> shards_;
+}; // ShardedLockFreeRingBuffer
+
 namespace detail {
 template <typename T, template <typename> class Atom>
 class RingBufferSlot {
@@ -189,14 +303,14 @@ class RingBufferSlot {
   {
   }
 
-  void write(const uint32_t turn, T& value) noexcept {
+  void write(const uint32_t turn, const T& value) noexcept {
     Atom<uint32_t> cutoff(0);
     sequencer_.waitForTurn(turn * 2, cutoff, false);
 
     // Change to an odd-numbered turn to indicate write in process
     sequencer_.completeTurn(turn * 2);
 
-    data = std::move(value);
+    data = value;
     sequencer_.completeTurn(turn * 2 + 1);
     // At (turn + 1) * 2
   }
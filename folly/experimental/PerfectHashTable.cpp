@@ -0,0 +1,480 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/PerfectHashTable.h>
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/Varint.h>
+#include <folly/gen/Base.h>
+#include <folly/gen/ParallelMap.h>
+#include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
+
+namespace folly {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x4c42544853415046ULL; // "FPASHTBL"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 128;
+constexpr size_t kBufferSize = 1 << 20;
+constexpr size_t kBucketSize = 4;
+// Seeds tried per shard before giving up; one almost always suffices.
+constexpr size_t kMaxAttempts = 16;
+constexpr uint64_t kEmpty = std::numeric_limits<uint64_t>::max();
+
+static_assert(
+    sizeof(detail::PerfectHashTableHeader) <= kHeaderSize,
+    "header too large");
+static_assert(kIsLittleEndian, "PerfectHashTable requires little endianness");
+
+// Maps a 32-bit hash uniformly onto [0, n) without a division.
+inline uint32_t reduce(uint32_t hash, uint32_t n) {
+  return uint32_t((uint64_t(hash) * n) >> 32);
+}
+
+inline uint32_t shardOf(uint64_t h1, uint64_t numShards) {
+  return reduce(uint32_t(h1 >> 32), uint32_t(numShards));
+}
+
+inline uint32_t bucketOf(uint64_t h1, uint64_t numBuckets) {
+  return reduce(uint32_t(h1), uint32_t(numBuckets));
+}
+
+inline uint64_t numBucketsFor(uint64_t n) {
+  return std::max<uint64_t>(1, (n + kBucketSize - 1) / kBucketSize);
+}
+
+[[noreturn]] void throwCorrupt(StringPiece what) {
+  throw std::runtime_error(to<std::string>("PerfectHashTable: ", what));
+}
+
+class BufferedWriter {
+ public:
+  explicit BufferedWriter(int fd) : fd_(fd) {}
+
+  void write(StringPiece bytes) {
+    buffer_.append(bytes.data(), bytes.size());
+    pos_ += bytes.size();
+    if (buffer_.size() >= kBufferSize) {
+      flush();
+    }
+  }
+
+  void padTo8() {
+    static const char kZeros[8] = {};
+    write(StringPiece(kZeros, (8 - pos_ % 8) % 8));
+  }
+
+  void flush() {
+    checkUnixError(
+        writeFull(fd_, buffer_.data(), buffer_.size()),
+        "PerfectHashTableBuilder: write failed");
+    buffer_.clear();
+  }
+
+  uint64_t pos() const {
+    return pos_;
+  }
+
+ private:
+  int fd_;
+  uint64_t pos_{0};
+  std::string buffer_;
+};
+
+template <class T>
+StringPiece asBytes(const std::vector<T>& v) {
+  return StringPiece(
+      reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+} // namespace
+
+namespace detail {
+
+PerfectHashTableHash perfectHashTableHash(StringPiece key, uint64_t seed) {
+  PerfectHashTableHash hash{seed, seed};
+  hash::SpookyHashV2::Hash128(key.data(), key.size(), &hash.h1, &hash.h2);
+  return hash;
+}
+
+uint32_t perfectHashTablePosition(
+    uint64_t h2,
+    uint64_t shardSeed,
+    uint16_t pilot,
+    uint32_t n) {
+  auto mixed = hash::twang_mix64(h2 ^ hash::twang_mix64(shardSeed + pilot));
+  return reduce(uint32_t(mixed >> 32), n);
+}
+
+} // namespace detail
+
+struct PerfectHashTableBuilder::Shard {
+  uint64_t seed{0};
+  std::vector<uint16_t> pilots;
+  // Entry placed at each position
+  std::vector<uint64_t> entries;
+  bool duplicate{false};
+};
+
+PerfectHashTableBuilder::PerfectHashTableBuilder(Options options)
+    : options_(options) {
+  CHECK_GT(options_.shardSize, 0);
+  CHECK_LE(options_.shardSize, 1u << 20);
+  offsets_.push_back(0);
+}
+
+void PerfectHashTableBuilder::add(StringPiece key, StringPiece value) {
+  uint8_t length[kMaxVarintLength64];
+  data_.append(
+      reinterpret_cast<const char*>(length), encodeVarint(key.size(), length));
+  data_.append(key.data(), key.size());
+  data_.append(value.data(), value.size());
+  offsets_.push_back(data_.size());
+  hashes_.push_back(detail::perfectHashTableHash(key, options_.seed));
+}
+
+StringPiece PerfectHashTableBuilder::entryKey(uint64_t i) const {
+  ByteRange bytes(
+      reinterpret_cast<const uint8_t*>(data_.data()) + offsets_[i],
+      reinterpret_cast<const uint8_t*>(data_.data()) + offsets_[i + 1]);
+  auto length = decodeVarint(bytes);
+  return StringPiece(StringPiece(bytes).subpiece(0, length));
+}
+
+PerfectHashTableBuilder::Shard PerfectHashTableBuilder::placeShard(
+    const std::vector<uint64_t>& entries,
+    uint64_t begin,
+    uint64_t end,
+    uint64_t shard) const {
+  Shard result;
+  auto n = end - begin;
+  auto numBuckets = numBucketsFor(n);
+  result.pilots.assign(numBuckets, 0);
+  if (n == 0) {
+    return result;
+  }
+
+  // Group the keys by bucket; equal hashes end up next to each other.
+  std::vector<std::pair<uint32_t, uint64_t>> keys;
+  keys.reserve(n);
+  for (auto i = begin; i < end; i++) {
+    auto e = entries[i];
+    keys.emplace_back(bucketOf(hashes_[e].h1, numBuckets), e);
+  }
+  std::sort(keys.begin(), keys.end(), [&](const auto& a, const auto& b) {
+    if (a.first != b.first) {
+      return a.first < b.first;
+    }
+    return hashes_[a.second].h2 < hashes_[b.second].h2;
+  });
+  for (size_t i = 1; i < keys.size(); i++) {
+    auto& a = hashes_[keys[i - 1].second];
+    auto& b = hashes_[keys[i].second];
+    if (a.h1 == b.h1 && a.h2 == b.h2 &&
+        entryKey(keys[i - 1].second) == entryKey(keys[i].second)) {
+      result.duplicate = true;
+      return result;
+    }
+  }
+
+  // Buckets as [first, last) ranges of keys, largest first
+  std::vector<std::pair<uint32_t, uint32_t>> buckets;
+  for (size_t i = 0; i < keys.size();) {
+    auto j = i + 1;
+    while (j < keys.size() && keys[j].first == keys[i].first) {
+      j++;
+    }
+    buckets.emplace_back(i, j);
+    i = j;
+  }
+  std::stable_sort(buckets.begin(), buckets.end(), [](auto a, auto b) {
+    return a.second - a.first > b.second - b.first;
+  });
+
+  result.entries.resize(n);
+  for (size_t attempt = 0; attempt < kMaxAttempts; attempt++) {
+    auto seed = hash::twang_mix64(shard * kMaxAttempts + attempt);
+    std::fill(result.entries.begin(), result.entries.end(), kEmpty);
+    bool placed = true;
+    for (auto bucket : buckets) {
+      bool found = false;
+      for (uint32_t pilot = 0; pilot <= 0xffff; pilot++) {
+        auto last = bucket.first;
+        for (; last < bucket.second; last++) {
+          auto e = keys[last].second;
+          auto pos = detail::perfectHashTablePosition(
+              hashes_[e].h2, seed, uint16_t(pilot), uint32_t(n));
+          if (result.entries[pos] != kEmpty) {
+            break;
+          }
+          result.entries[pos] = e;
+        }
+        if (last == bucket.second) {
+          result.pilots[keys[bucket.first].first] = uint16_t(pilot);
+          found = true;
+          break;
+        }
+        // Undo the keys placed with this pilot.
+        for (auto k = bucket.first; k < last; k++) {
+          auto pos = detail::perfectHashTablePosition(
+              hashes_[keys[k].second].h2, seed, uint16_t(pilot), uint32_t(n));
+          result.entries[pos] = kEmpty;
+        }
+      }
+      if (!found) {
+        placed = false;
+        break;
+      }
+    }
+    if (placed) {
+      result.seed = seed;
+      return result;
+    }
+  }
+  // Reported by write()
+  result.entries.clear();
+  return result;
+}
+
+void PerfectHashTableBuilder::write(const char* path) const {
+  write(File(path, O_WRONLY | O_CREAT | O_TRUNC));
+}
+
+void PerfectHashTableBuilder::write(File file) const {
+  uint64_t n = hashes_.size();
+  uint64_t numShards =
+      std::max<uint64_t>(1, (n + options_.shardSize - 1) / options_.shardSize);
+  CHECK_LE(numShards, std::numeric_limits<uint32_t>::max());
+
+  // Group the entries by shard with a counting sort.
+  std::vector<uint64_t> shardBegin(numShards + 1, 0);
+  for (auto& hash : hashes_) {
+    shardBegin[shardOf(hash.h1, numShards) + 1]++;
+  }
+  for (uint64_t s = 0; s < numShards; s++) {
+    shardBegin[s + 1] += shardBegin[s];
+  }
+  std::vector<uint64_t> entries(n);
+  {
+    auto next = shardBegin;
+    for (uint64_t e = 0; e < n; e++) {
+      entries[next[shardOf(hashes_[e].h1, numShards)]++] = e;
+    }
+  }
+
+  // Shards are independent; place them on options_.threads threads.
+  auto shards = gen::range<uint64_t>(0, numShards) |
+      gen::pmap(
+          [&](uint64_t s) {
+            return placeShard(entries, shardBegin[s], shardBegin[s + 1], s);
+          },
+          options_.threads) |
+      gen::as<std::vector>();
+
+  detail::PerfectHashTableHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.count = n;
+  header.numShards = numShards;
+  header.seed = options_.seed;
+
+  std::vector<detail::PerfectHashTableShard> shardInfo;
+  shardInfo.reserve(numShards + 1);
+  uint64_t firstBucket = 0;
+  for (uint64_t s = 0; s < numShards; s++) {
+    auto& shard = shards[s];
+    if (shard.duplicate) {
+      throw std::invalid_argument("PerfectHashTableBuilder: duplicate key");
+    }
+    if (shard.entries.size() != shardBegin[s + 1] - shardBegin[s]) {
+      throw std::runtime_error(
+          "PerfectHashTableBuilder: no perfect hash found for a shard");
+    }
+    shardInfo.push_back({shardBegin[s], firstBucket, shard.seed});
+    firstBucket += shard.pilots.size();
+  }
+  shardInfo.push_back({n, firstBucket, 0});
+
+  BufferedWriter out(file.fd());
+  out.write(StringPiece(std::string(kHeaderSize, '\0')));
+
+  header.shardsOffset = out.pos();
+  out.write(asBytes(shardInfo));
+  header.shardsSize = out.pos() - header.shardsOffset;
+
+  header.pilotsOffset = out.pos();
+  for (auto& shard : shards) {
+    out.write(asBytes(shard.pilots));
+  }
+  header.pilotsSize = out.pos() - header.pilotsOffset;
+
+  // Entries in hash order, with their offsets
+  out.padTo8();
+  header.offsetsOffset = out.pos();
+  uint64_t offset = 0;
+  for (auto& shard : shards) {
+    for (auto e : shard.entries) {
+      out.write(StringPiece(
+          reinterpret_cast<const char*>(&offset), sizeof(offset)));
+      offset += offsets_[e + 1] - offsets_[e];
+    }
+  }
+  out.write(
+      StringPiece(reinterpret_cast<const char*>(&offset), sizeof(offset)));
+  header.offsetsSize = out.pos() - header.offsetsOffset;
+
+  header.dataOffset = out.pos();
+  for (auto& shard : shards) {
+    for (auto e : shard.entries) {
+      out.write(StringPiece(data_).subpiece(
+          offsets_[e], offsets_[e + 1] - offsets_[e]));
+    }
+  }
+  header.dataSize = out.pos() - header.dataOffset;
+  header.fileSize = out.pos();
+
+  out.flush();
+  checkUnixError(
+      pwriteFull(file.fd(), &header, sizeof(header), 0),
+      "PerfectHashTableBuilder: writing header failed");
+}
+
+PerfectHashTable::PerfectHashTable(const char* path)
+    : PerfectHashTable(File(path)) {}
+
+PerfectHashTable::PerfectHashTable(File file)
+    : PerfectHashTable(MemoryMapping(std::move(file))) {}
+
+PerfectHashTable::PerfectHashTable(MemoryMapping mapping)
+    : mapping_(std::move(mapping)) {
+  open();
+}
+
+void PerfectHashTable::open() {
+  auto range = mapping_.range();
+  if (range.size() < kHeaderSize) {
+    throwCorrupt("file too short");
+  }
+  detail::PerfectHashTableHeader header;
+  std::memcpy(&header, range.data(), sizeof(header));
+  if (header.magic != kMagic) {
+    throwCorrupt("bad magic number");
+  }
+  if (header.version != kVersion) {
+    throwCorrupt(to<std::string>("unsupported version ", header.version));
+  }
+  if (header.fileSize != range.size()) {
+    throwCorrupt("file size doesn't match header");
+  }
+  auto section = [&](uint64_t offset, uint64_t size, size_t align) {
+    if (offset % align != 0 || offset > range.size() ||
+        size > range.size() - offset) {
+      throwCorrupt("section out of bounds");
+    }
+    return range.subpiece(offset, size);
+  };
+  auto shards = section(header.shardsOffset, header.shardsSize, 8);
+  auto pilots = section(header.pilotsOffset, header.pilotsSize, 2);
+  auto offsets = section(header.offsetsOffset, header.offsetsSize, 8);
+  data_ = StringPiece(section(header.dataOffset, header.dataSize, 1));
+
+  // Every entry takes at least a byte, which bounds the sizes below.
+  if (header.count > header.dataSize || header.numShards == 0 ||
+      header.numShards > std::numeric_limits<uint32_t>::max()) {
+    throwCorrupt("bad entry or shard count");
+  }
+  size_ = header.count;
+  numShards_ = header.numShards;
+  seed_ = header.seed;
+  if (shards.size() !=
+      (numShards_ + 1) * sizeof(detail::PerfectHashTableShard)) {
+    throwCorrupt("shard array size mismatch");
+  }
+  if (offsets.size() != (size_ + 1) * sizeof(uint64_t)) {
+    throwCorrupt("offsets size mismatch");
+  }
+  shards_ = reinterpret_cast<const detail::PerfectHashTableShard*>(
+      shards.data());
+  pilots_ = reinterpret_cast<const uint16_t*>(pilots.data());
+  offsets_ = reinterpret_cast<const uint64_t*>(offsets.data());
+
+  // Lookups trust the shard array, so check all of it.
+  if (shards_[0].firstEntry != 0 || shards_[0].firstBucket != 0 ||
+      shards_[numShards_].firstEntry != size_ ||
+      shards_[numShards_].firstBucket * sizeof(uint16_t) != pilots.size()) {
+    throwCorrupt("bad shard array");
+  }
+  for (uint64_t s = 0; s < numShards_; s++) {
+    auto& shard = shards_[s];
+    auto& next = shards_[s + 1];
+    if (next.firstEntry < shard.firstEntry ||
+        next.firstEntry - shard.firstEntry >
+            std::numeric_limits<uint32_t>::max() ||
+        next.firstBucket - shard.firstBucket !=
+            numBucketsFor(next.firstEntry - shard.firstEntry)) {
+      throwCorrupt("bad shard array");
+    }
+  }
+}
+
+std::pair<StringPiece, StringPiece> PerfectHashTable::entry(size_t i) const {
+  DCHECK_LT(i, size_);
+  auto begin = offsets_[i];
+  auto end = offsets_[i + 1];
+  if (begin > end || end > data_.size()) {
+    throwCorrupt("entry out of bounds");
+  }
+  auto bytes = ByteRange(data_.subpiece(begin, end - begin));
+  auto length = decodeVarint(bytes);
+  if (length > bytes.size()) {
+    throwCorrupt("key out of bounds");
+  }
+  auto rest = StringPiece(bytes);
+  return std::make_pair(rest.subpiece(0, length), rest.subpiece(length));
+}
+
+Optional<StringPiece> PerfectHashTable::find(StringPiece key) const {
+  auto hash = detail::perfectHashTableHash(key, seed_);
+  auto& shard = shards_[shardOf(hash.h1, numShards_)];
+  auto& next = (&shard)[1];
+  auto n = uint32_t(next.firstEntry - shard.firstEntry);
+  if (n == 0) {
+    return none;
+  }
+  auto bucket = bucketOf(hash.h1, next.firstBucket - shard.firstBucket);
+  auto pilot = pilots_[shard.firstBucket + bucket];
+  auto e = entry(
+      shard.firstEntry +
+      detail::perfectHashTablePosition(hash.h2, shard.seed, pilot, n));
+  if (e.first == key) {
+    return e.second;
+  }
+  return none;
+}
+
+} // namespace folly
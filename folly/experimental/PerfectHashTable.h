@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * An immutable hash table of string keys and values, indexed by a minimal
+ * perfect hash function and stored in a file meant to be memory mapped.
+ *
+ * Where a SortedTable lookup binary searches, a PerfectHashTable lookup
+ * computes the position of its entry directly: it reads one 16-bit
+ * "pilot" for the key's bucket, then the entry's offset, then the entry.
+ * There are no collision chains and no empty slots; the n entries take
+ * positions 0 to n - 1.
+ *
+ * The hash function follows PTHash: keys are split into shards of about
+ * shardSize keys, and within each shard into buckets of about four keys.
+ * Buckets are placed largest first, each by trying pilots until every
+ * key in the bucket lands on a free position.  The index costs half a
+ * byte per key, plus 24 bytes per shard.  Shards are independent, so the
+ * builder places them in parallel with gen::pmap.
+ *
+ *   PerfectHashTableBuilder builder;
+ *   builder.add("apple", "red");
+ *   builder.add("banana", "yellow");
+ *   builder.write("/tmp/table");
+ *
+ *   PerfectHashTable table("/tmp/table");
+ *   auto value = table.find("apple");   // Optional<StringPiece>
+ *
+ * As with SortedTable, the file format uses the host's byte order, which
+ * must be little endian.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/system/MemoryMapping.h>
+
+namespace folly {
+
+namespace detail {
+
+struct PerfectHashTableHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t flags;
+  uint64_t count;
+  uint64_t numShards;
+  uint64_t seed;
+  uint64_t shardsOffset;
+  uint64_t shardsSize;
+  uint64_t pilotsOffset;
+  uint64_t pilotsSize;
+  uint64_t offsetsOffset;
+  uint64_t offsetsSize;
+  uint64_t dataOffset;
+  uint64_t dataSize;
+  uint64_t fileSize;
+};
+
+// Shard i holds entries [firstEntry, shards[i + 1].firstEntry) and buckets
+// [firstBucket, shards[i + 1].firstBucket); a sentinel closes the array.
+struct PerfectHashTableShard {
+  uint64_t firstEntry;
+  uint64_t firstBucket;
+  uint64_t seed;
+};
+
+struct PerfectHashTableHash {
+  uint64_t h1; // picks the shard and the bucket
+  uint64_t h2; // combined with the pilot to pick the position
+};
+
+PerfectHashTableHash perfectHashTableHash(StringPiece key, uint64_t seed);
+
+// Position of a key within a shard of n entries.
+uint32_t perfectHashTablePosition(
+    uint64_t h2,
+    uint64_t shardSeed,
+    uint16_t pilot,
+    uint32_t n);
+
+} // namespace detail
+
+/**
+ * Collects key/value pairs in memory and writes a PerfectHashTable file.
+ * Keys may be added in any order.
+ */
+class PerfectHashTableBuilder {
+ public:
+  struct Options {
+    Options() {}
+
+    // Convenience methods; return *this for chaining.
+    Options& setThreads(size_t v) {
+      threads = v;
+      return *this;
+    }
+    Options& setShardSize(size_t v) {
+      shardSize = v;
+      return *this;
+    }
+    Options& setSeed(uint64_t v) {
+      seed = v;
+      return *this;
+    }
+
+    // Number of threads placing shards; 0 means one per CPU.
+    size_t threads = 0;
+
+    // Average number of keys per shard.  Larger shards take longer to
+    // place; smaller ones make the shard array larger.
+    size_t shardSize = 2048;
+
+    // Seed of the key hash.
+    uint64_t seed = 0;
+  };
+
+  explicit PerfectHashTableBuilder(Options options = Options());
+
+  PerfectHashTableBuilder(const PerfectHashTableBuilder&) = delete;
+  PerfectHashTableBuilder& operator=(const PerfectHashTableBuilder&) = delete;
+
+  void add(StringPiece key, StringPiece value);
+
+  size_t size() const {
+    return hashes_.size();
+  }
+
+  // Builds the hash function and writes the table, creating or truncating
+  // the file at path.  Throws std::invalid_argument if a key was added
+  // twice, and std::system_error on I/O errors.
+  void write(const char* path) const;
+  void write(File file) const;
+
+ private:
+  struct Shard;
+
+  Shard placeShard(
+      const std::vector<uint64_t>& entries,
+      uint64_t begin,
+      uint64_t end,
+      uint64_t shard) const;
+  StringPiece entryKey(uint64_t i) const;
+
+  Options options_;
+  // Entries serialized as in the file, back to back, in insertion order
+  std::string data_;
+  std::vector<uint64_t> offsets_;
+  std::vector<detail::PerfectHashTableHash> hashes_;
+};
+
+/**
+ * Reads a PerfectHashTable file in place.  Returned StringPieces point
+ * into the mapping, and are valid as long as the PerfectHashTable is.
+ *
+ * All methods are const and safe to call from many threads.
+ */
+class PerfectHashTable {
+ public:
+  // Throw std::runtime_error if the file is not a valid table.
+  explicit PerfectHashTable(const char* path);
+  explicit PerfectHashTable(File file);
+  explicit PerfectHashTable(MemoryMapping mapping);
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  Optional<StringPiece> find(StringPiece key) const;
+
+  // The key and value of the i-th entry, in no particular order.
+  std::pair<StringPiece, StringPiece> entry(size_t i) const;
+
+  const MemoryMapping& mapping() const {
+    return mapping_;
+  }
+
+ private:
+  void open();
+
+  MemoryMapping mapping_;
+  size_t size_{0};
+  uint64_t numShards_{0};
+  uint64_t seed_{0};
+  const detail::PerfectHashTableShard* shards_{nullptr};
+  const uint16_t* pilots_{nullptr};
+  const uint64_t* offsets_{nullptr};
+  StringPiece data_;
+};
+
+} // namespace folly
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Function.h>
+#include <folly/experimental/hazptr/hazptr.h>
+
+namespace folly {
+
+/**
+ * The current version of a read-mostly object, e.g. a config.
+ *
+ * Readers take a Snapshot of the current version, which protects it with a
+ * hazard pointer instead of incrementing a reference count: reads don't
+ * write any shared cache line, and only retry if a publish happens at the
+ * same time.  Snapshots can be kept as long as needed, moved to other
+ * threads and copied; the version they see is freed when the last one
+ * goes away, even if it has been replaced (or the cell destroyed) since.
+ *
+ *   ReadMostlyCell<Config> config(loadConfig());
+ *
+ *   // readers
+ *   auto snapshot = config.getSnapshot();
+ *   use(snapshot->timeout);
+ *
+ *   // writers
+ *   config.publish(loadConfig());
+ *   config.update([](Config& c) { c.timeout = 10; });
+ *
+ * Writers are serialized.  Concurrent update() calls are batched: one
+ * writer copies the current version once, applies all the pending
+ * updates to the copy and publishes it, so N updates cost one copy and
+ * one retire instead of N.
+ *
+ * addCallback() registers a function that gets every new version, e.g.
+ * to invalidate caches derived from it.
+ *
+ * Snapshot has the read interface of observer::Snapshot (get(), *, ->,
+ * getVersion()); observer::HazptrObserver uses a ReadMostlyCell to cache
+ * an Observer's value.
+ */
+template <typename T>
+class ReadMostlyCell {
+  struct Node : hazptr::hazptr_obj_base<Node> {
+    Node(std::shared_ptr<const T> v, size_t ver)
+        : value(std::move(v)), version(ver) {}
+
+    std::shared_ptr<const T> value;
+    size_t version;
+  };
+
+ public:
+  class Snapshot {
+   public:
+    /* An empty snapshot */
+    Snapshot() noexcept : holder_(nullptr) {}
+
+    Snapshot(const Snapshot& other) : holder_(nullptr), node_(other.node_) {
+      if (node_) {
+        // other protects node_ until ours does
+        hazptr::hazptr_holder holder;
+        holder.reset(node_);
+        holder_ = std::move(holder);
+      }
+    }
+
+    Snapshot(Snapshot&& other) noexcept
+        : holder_(std::move(other.holder_)), node_(other.node_) {
+      other.node_ = nullptr;
+    }
+
+    Snapshot& operator=(const Snapshot& other) {
+      if (this != &other) {
+        *this = Snapshot(other);
+      }
+      return *this;
+    }
+
+    Snapshot& operator=(Snapshot&& other) noexcept {
+      if (this != &other) {
+        holder_ = std::move(other.holder_);
+        node_ = other.node_;
+        other.node_ = nullptr;
+      }
+      return *this;
+    }
+
+    const T& operator*() const {
+      return *get();
+    }
+
+    const T* operator->() const {
+      return get();
+    }
+
+    const T* get() const {
+      return node_ ? node_->value.get() : nullptr;
+    }
+
+    /**
+     * The version of the snapshot, 0 for the cell's initial value and one
+     * more for each publish.
+     */
+    size_t getVersion() const {
+      DCHECK(node_);
+      return node_->version;
+    }
+
+    explicit operator bool() const {
+      return node_ != nullptr;
+    }
+
+   private:
+    friend class ReadMostlyCell;
+
+    explicit Snapshot(const std::atomic<Node*>& src) {
+      node_ = holder_.get_protected(src);
+    }
+
+    hazptr::hazptr_holder holder_;
+    const Node* node_{nullptr};
+  };
+
+  using Callback = folly::Function<void(const Snapshot&)>;
+
+  /**
+   * Returned by addCallback(), unregisters the callback when destroyed.
+   * Must not outlive the cell, nor be destroyed from a callback.
+   */
+  class CallbackHandle {
+   public:
+    CallbackHandle() = default;
+
+    CallbackHandle(CallbackHandle&& other) noexcept
+        : cell_(other.cell_), it_(other.it_) {
+      other.cell_ = nullptr;
+    }
+
+    CallbackHandle& operator=(CallbackHandle&& other) noexcept {
+      if (this != &other) {
+        cancel();
+        cell_ = other.cell_;
+        it_ = other.it_;
+        other.cell_ = nullptr;
+      }
+      return *this;
+    }
+
+    ~CallbackHandle() {
+      cancel();
+    }
+
+    void cancel() {
+      if (cell_) {
+        std::lock_guard<std::mutex> g(cell_->writeMutex_);
+        cell_->callbacks_.erase(it_);
+        cell_ = nullptr;
+      }
+    }
+
+   private:
+    friend class ReadMostlyCell;
+
+    CallbackHandle(
+        ReadMostlyCell* cell,
+        typename std::list<Callback>::iterator it)
+        : cell_(cell), it_(it) {}
+
+    ReadMostlyCell* cell_{nullptr};
+    typename std::list<Callback>::iterator it_;
+  };
+
+  explicit ReadMostlyCell(T value)
+      : ReadMostlyCell(std::make_shared<const T>(std::move(value))) {}
+
+  explicit ReadMostlyCell(std::shared_ptr<const T> value)
+      : node_(new Node(std::move(value), 0)) {
+    DCHECK(node_.load(std::memory_order_relaxed)->value);
+  }
+
+  ReadMostlyCell(const ReadMostlyCell&) = delete;
+  ReadMostlyCell& operator=(const ReadMostlyCell&) = delete;
+
+  /* Snapshots may still be using the last version, so it is retired */
+  ~ReadMostlyCell() {
+    node_.load(std::memory_order_relaxed)->retire();
+  }
+
+  Snapshot getSnapshot() const {
+    return Snapshot(node_);
+  }
+
+  Snapshot operator*() const {
+    return getSnapshot();
+  }
+
+  /* Number of publishes so far, the version of the current snapshot */
+  size_t getVersion() const {
+    return version_.load(std::memory_order_acquire);
+  }
+
+  /* Whether a newer version than snapshot's has been published */
+  bool needRefresh(const Snapshot& snapshot) const {
+    return snapshot.getVersion() < getVersion();
+  }
+
+  /* Make value the current version */
+  void publish(std::shared_ptr<const T> value) {
+    DCHECK(value);
+    std::lock_guard<std::mutex> g(writeMutex_);
+    publishLocked(std::move(value));
+  }
+
+  void publish(T value) {
+    publish(std::make_shared<const T>(std::move(value)));
+  }
+
+  /**
+   * Publish a copy of the current version, modified by f.  When update()
+   * returns, f has been applied and published, but possibly by another
+   * writer, in the same version as other concurrent updates.  f must not
+   * throw.
+   */
+  void update(folly::Function<void(T&)> f) {
+    {
+      std::lock_guard<std::mutex> g(pendingMutex_);
+      pending_.push_back(std::move(f));
+    }
+    std::lock_guard<std::mutex> g(writeMutex_);
+    std::vector<folly::Function<void(T&)>> batch;
+    {
+      std::lock_guard<std::mutex> pg(pendingMutex_);
+      batch.swap(pending_);
+    }
+    if (batch.empty()) {
+      return; // the last writer applied ours
+    }
+    auto next =
+        std::make_shared<T>(*node_.load(std::memory_order_relaxed)->value);
+    applyAll(batch, *next);
+    publishLocked(std::move(next));
+  }
+
+  /**
+   * Call cb with the current version, then with each new version, from
+   * the publishing thread, in order.  Callbacks must not publish to this
+   * cell or destroy a CallbackHandle of it.
+   */
+  CallbackHandle addCallback(Callback cb) {
+    std::lock_guard<std::mutex> g(writeMutex_);
+    cb(getSnapshot());
+    callbacks_.push_back(std::move(cb));
+    return CallbackHandle(this, std::prev(callbacks_.end()));
+  }
+
+ private:
+  static void applyAll(
+      std::vector<folly::Function<void(T&)>>& batch,
+      T& value) noexcept {
+    for (auto& f : batch) {
+      f(value);
+    }
+  }
+
+  // writeMutex_ must be held
+  void publishLocked(std::shared_ptr<const T> value) {
+    auto version = version_.load(std::memory_order_relaxed) + 1;
+    auto old = node_.exchange(
+        new Node(std::move(value), version), std::memory_order_acq_rel);
+    version_.store(version, std::memory_order_release);
+    old->retire();
+    if (!callbacks_.empty()) {
+      auto snapshot = getSnapshot();
+      for (auto& cb : callbacks_) {
+        cb(snapshot);
+      }
+    }
+  }
+
+  std::atomic<Node*> node_;
+  std::atomic<size_t> version_{0};
+
+  std::mutex writeMutex_;
+  std::list<Callback> callbacks_;
+
+  std::mutex pendingMutex_;
+  std::vector<folly::Function<void(T&)>> pending_;
+};
+
+} // namespace folly
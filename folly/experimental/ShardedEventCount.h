@@ -0,0 +1,264 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/CachelinePadded.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/detail/Futex.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+/**
+ * An EventCount (see EventCount.h) whose waiters are spread over several
+ * futex words, one per node (the cpus sharing a last-level cache, as for
+ * AccessSpreader) by default, for pools of threads that sleep and are woken
+ * often:
+ *
+ *  - Waiters only write the word of their node, so going to sleep doesn't
+ *    bounce a single cache line between all the idle threads of a large
+ *    host.
+ *
+ *  - notify(n) wakes up to n waiters from sleep, starting with those of the
+ *    notifier's node: it bumps the epoch of only as many words as it takes
+ *    to find n waiters, with one futexWake() per word, so adding a task
+ *    to an idle pool wakes one thread rather than all of them. notifyAll()
+ *    wakes everybody, as EventCount's does.
+ *
+ *  - wait() spins for a while before going to sleep, as a notification
+ *    often comes right after a thread runs out of work.
+ *
+ * The guarantee is that of a condition variable: if prepareWait() returns
+ * before notify() is called, at least one waiter that prepared before (if
+ * any) returns from wait() (for notifyAll(), all of them do). As with
+ * EventCount, waiters must recheck their condition; await() does.
+ *
+ * stats() counts how waits ended (spinning or after parking in the
+ * kernel), and the notifications that found waiters.
+ */
+class ShardedEventCount {
+ public:
+  static constexpr size_t kDefaultSpins = 256;
+
+  /**
+   * numShards 0 means one per node of CacheLocality::system(); spins is
+   * how many times wait() checks for a notification (with a pause in
+   * between) before parking.
+   */
+  explicit ShardedEventCount(
+      size_t numShards = 0,
+      size_t spins = kDefaultSpins)
+      : numShards_(numShards != 0 ? numShards : defaultNumShards()),
+        spins_(spins),
+        shards_(new CachelinePadded<Shard>[numShards_]) {}
+
+  ShardedEventCount(const ShardedEventCount&) = delete;
+  ShardedEventCount& operator=(const ShardedEventCount&) = delete;
+
+  class Key {
+    friend class ShardedEventCount;
+    Key(uint32_t shard, uint32_t epoch) noexcept
+        : shard_(shard), epoch_(epoch) {}
+    uint32_t shard_;
+    uint32_t epoch_;
+  };
+
+  struct Stats {
+    uint64_t waits{0}; // calls to wait()
+    uint64_t spinWakeups{0}; // waits that ended while spinning
+    uint64_t parks{0}; // times waiters went to sleep in the kernel
+    uint64_t notifies{0}; // words whose waiters a notification woke
+  };
+
+  void notify() noexcept {
+    notify(1);
+  }
+  void notify(size_t n) noexcept;
+  void notifyAll() noexcept {
+    notify(SIZE_MAX);
+  }
+
+  Key prepareWait() noexcept;
+  void cancelWait(Key key) noexcept;
+  void wait(Key key) noexcept;
+
+  /**
+   * Wait for condition() to become true.  Will clean up appropriately if
+   * condition() throws, and then rethrow.
+   */
+  template <class Condition>
+  void await(Condition condition);
+
+  size_t numShards() const {
+    return numShards_;
+  }
+
+  // Sums of the counts of all the words; approximate while in use
+  Stats stats() const;
+
+ private:
+  struct Shard {
+    // The epoch in the most significant 32 bits and the waiter count in
+    // the least significant 32 bits, as in EventCount
+    std::atomic<uint64_t> val{0};
+    std::atomic<uint64_t> waits{0};
+    std::atomic<uint64_t> spinWakeups{0};
+    std::atomic<uint64_t> parks{0};
+    std::atomic<uint64_t> notifies{0};
+
+    detail::Futex<std::atomic>* epochFutex() {
+      return reinterpret_cast<detail::Futex<std::atomic>*>(&val) +
+          kEpochOffset;
+    }
+  };
+
+  static size_t defaultNumShards() {
+    const auto& caches = CacheLocality::system().numCachesByLevel;
+    return caches.empty() ? 1 : std::max<size_t>(caches.back(), 1);
+  }
+
+  size_t currentShard() const {
+    return numShards_ == 1 ? 0 : AccessSpreader<>::current(numShards_);
+  }
+
+  static void bump(std::atomic<uint64_t>& counter) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+  }
+
+  static_assert(sizeof(detail::Futex<std::atomic>) == 4, "bad platform");
+
+  static constexpr size_t kEpochOffset = kIsLittleEndian ? 1 : 0;
+  static constexpr uint64_t kAddWaiter = uint64_t(1);
+  static constexpr uint64_t kSubWaiter = uint64_t(-1);
+  static constexpr size_t kEpochShift = 32;
+  static constexpr uint64_t kAddEpoch = uint64_t(1) << kEpochShift;
+  static constexpr uint64_t kWaiterMask = kAddEpoch - 1;
+
+  const size_t numShards_;
+  const size_t spins_;
+  std::unique_ptr<CachelinePadded<Shard>[]> shards_;
+};
+
+inline void ShardedEventCount::notify(size_t n) noexcept {
+  // Pairs with the fence in prepareWait(): either the waiter sees the
+  // condition that the caller made true, or this sees the waiter
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const size_t first = currentShard();
+  for (size_t i = 0; i < numShards_ && n > 0; ++i) {
+    auto& shard = *shards_[(first + i) % numShards_];
+    if ((shard.val.load(std::memory_order_relaxed) & kWaiterMask) == 0) {
+      continue;
+    }
+    uint64_t prev =
+        shard.val.fetch_add(kAddEpoch, std::memory_order_acq_rel);
+    size_t waiters = prev & kWaiterMask;
+    if (waiters == 0) {
+      continue;
+    }
+    size_t woken = std::min(n, waiters);
+    shard.epochFutex()->futexWake(int(std::min<size_t>(woken, INT_MAX)));
+    shard.notifies.fetch_add(1, std::memory_order_relaxed);
+    n -= woken;
+  }
+}
+
+inline ShardedEventCount::Key ShardedEventCount::prepareWait() noexcept {
+  const size_t i = currentShard();
+  uint64_t prev =
+      shards_[i]->val.fetch_add(kAddWaiter, std::memory_order_acq_rel);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return Key(uint32_t(i), uint32_t(prev >> kEpochShift));
+}
+
+inline void ShardedEventCount::cancelWait(Key key) noexcept {
+  uint64_t prev = shards_[key.shard_]->val.fetch_add(
+      kSubWaiter, std::memory_order_seq_cst);
+  DCHECK_NE((prev & kWaiterMask), 0);
+}
+
+inline void ShardedEventCount::wait(Key key) noexcept {
+  auto& shard = *shards_[key.shard_];
+  bump(shard.waits);
+  auto notified = [&] {
+    return (shard.val.load(std::memory_order_acquire) >> kEpochShift) !=
+        key.epoch_;
+  };
+  bool spun = false;
+  for (size_t i = 0; i < spins_; ++i) {
+    if (notified()) {
+      bump(shard.spinWakeups);
+      spun = true;
+      break;
+    }
+    asm_volatile_pause();
+  }
+  if (!spun) {
+    while (!notified()) {
+      bump(shard.parks);
+      shard.epochFutex()->futexWait(key.epoch_);
+    }
+  }
+  uint64_t prev = shard.val.fetch_add(kSubWaiter, std::memory_order_seq_cst);
+  DCHECK_NE((prev & kWaiterMask), 0);
+}
+
+template <class Condition>
+void ShardedEventCount::await(Condition condition) {
+  if (condition()) {
+    return; // fast path
+  }
+  for (;;) {
+    auto key = prepareWait();
+    bool done;
+    try {
+      done = condition();
+    } catch (...) {
+      cancelWait(key);
+      throw;
+    }
+    if (done) {
+      cancelWait(key);
+      break;
+    }
+    wait(key);
+  }
+}
+
+inline ShardedEventCount::Stats ShardedEventCount::stats() const {
+  Stats stats;
+  for (size_t i = 0; i < numShards_; ++i) {
+    const auto& shard = *shards_[i];
+    stats.waits += shard.waits.load(std::memory_order_relaxed);
+    stats.spinWakeups += shard.spinWakeups.load(std::memory_order_relaxed);
+    stats.parks += shard.parks.load(std::memory_order_relaxed);
+    stats.notifies += shard.notifies.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+} // namespace folly
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/SortedTable.h>
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/Varint.h>
+#include <folly/portability/SysMman.h>
+
+namespace folly {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x4c42545354524f53ULL; // "SORTSTBL"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kCompressedOffsets = 1;
+// Room for the header to grow; the entries start after it.
+constexpr size_t kHeaderSize = 128;
+constexpr size_t kBufferSize = 1 << 20;
+
+static_assert(
+    sizeof(detail::SortedTableHeader) <= kHeaderSize,
+    "header too large");
+static_assert(kIsLittleEndian, "SortedTable requires little endianness");
+
+[[noreturn]] void throwCorrupt(StringPiece what) {
+  throw std::runtime_error(to<std::string>("SortedTable: ", what));
+}
+
+using OffsetReader = compression::EliasFanoReader<
+    detail::SortedTableOffsetEncoder,
+    compression::instructions::Default,
+    true>;
+
+} // namespace
+
+SortedTableBuilder::SortedTableBuilder(const char* path, Options options)
+    : SortedTableBuilder(File(path, O_WRONLY | O_CREAT | O_TRUNC), options) {}
+
+SortedTableBuilder::SortedTableBuilder(File file, Options options)
+    : file_(std::move(file)), options_(options), pos_(kHeaderSize) {
+  CHECK_GT(options_.fenceInterval, 0);
+  // Reserve the header, which finish() writes once the layout is known.
+  buffer_.assign(kHeaderSize, '\0');
+}
+
+void SortedTableBuilder::add(StringPiece key, StringPiece value) {
+  CHECK(!finished_);
+  if (!offsets_.empty() && !(StringPiece(lastKey_) < key)) {
+    throw std::invalid_argument(
+        "SortedTableBuilder: keys must be added in increasing order");
+  }
+  if (offsets_.size() % options_.fenceInterval == 0) {
+    fenceOffsets_.push_back(fenceKeys_.size());
+    fenceKeys_.append(key.data(), key.size());
+  }
+  offsets_.push_back(pos_ - kHeaderSize);
+
+  uint8_t length[kMaxVarintLength64];
+  write(StringPiece(
+      reinterpret_cast<const char*>(length), encodeVarint(key.size(), length)));
+  write(key);
+  write(value);
+  lastKey_.assign(key.data(), key.size());
+}
+
+void SortedTableBuilder::finish() {
+  CHECK(!finished_);
+  finished_ = true;
+
+  detail::SortedTableHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.count = offsets_.size();
+  header.fenceInterval = options_.fenceInterval;
+  header.dataOffset = kHeaderSize;
+  header.dataSize = pos_ - kHeaderSize;
+
+  // The end of the last entry.
+  offsets_.push_back(header.dataSize);
+  padTo8();
+  header.offsetsOffset = pos_;
+  if (options_.compressOffsets) {
+    auto list = detail::SortedTableOffsetEncoder::encode(
+        offsets_.begin(), offsets_.end());
+    SCOPE_EXIT {
+      list.free();
+    };
+    header.flags |= kCompressedOffsets;
+    header.efNumLowerBits = list.numLowerBits;
+    header.efUpperBytes = list.upperSize();
+    write(StringPiece(ByteRange(list.data)));
+    // The reader may load up to 7 bytes past the end of the list.
+    write(StringPiece("\0\0\0\0\0\0\0", 7));
+  } else {
+    write(StringPiece(
+        reinterpret_cast<const char*>(offsets_.data()),
+        offsets_.size() * sizeof(uint64_t)));
+  }
+  header.offsetsSize = pos_ - header.offsetsOffset;
+
+  padTo8();
+  header.fencesOffset = pos_;
+  fenceOffsets_.push_back(fenceKeys_.size());
+  write(StringPiece(
+      reinterpret_cast<const char*>(fenceOffsets_.data()),
+      fenceOffsets_.size() * sizeof(uint64_t)));
+  write(fenceKeys_);
+  header.fencesSize = pos_ - header.fencesOffset;
+  header.fileSize = pos_;
+
+  flush();
+  checkUnixError(
+      pwriteFull(file_.fd(), &header, sizeof(header), 0),
+      "SortedTableBuilder: writing header failed");
+}
+
+void SortedTableBuilder::write(StringPiece bytes) {
+  buffer_.append(bytes.data(), bytes.size());
+  pos_ += bytes.size();
+  if (buffer_.size() >= kBufferSize) {
+    flush();
+  }
+}
+
+void SortedTableBuilder::flush() {
+  checkUnixError(
+      writeFull(file_.fd(), buffer_.data(), buffer_.size()),
+      "SortedTableBuilder: write failed");
+  buffer_.clear();
+}
+
+void SortedTableBuilder::padTo8() {
+  static const char kZeros[8] = {};
+  write(StringPiece(kZeros, (8 - pos_ % 8) % 8));
+}
+
+SortedTable::SortedTable(const char* path) : SortedTable(File(path)) {}
+
+SortedTable::SortedTable(File file)
+    : SortedTable(MemoryMapping(std::move(file))) {}
+
+SortedTable::SortedTable(MemoryMapping mapping) : mapping_(std::move(mapping)) {
+  open();
+}
+
+void SortedTable::open() {
+  auto range = mapping_.range();
+  if (range.size() < kHeaderSize) {
+    throwCorrupt("file too short");
+  }
+  detail::SortedTableHeader header;
+  std::memcpy(&header, range.data(), sizeof(header));
+  if (header.magic != kMagic) {
+    throwCorrupt("bad magic number");
+  }
+  if (header.version != kVersion) {
+    throwCorrupt(to<std::string>("unsupported version ", header.version));
+  }
+  if (header.fileSize != range.size()) {
+    throwCorrupt("file size doesn't match header");
+  }
+  auto section = [&](uint64_t offset, uint64_t size) {
+    if (offset % 8 != 0 || offset > range.size() ||
+        size > range.size() - offset) {
+      throwCorrupt("section out of bounds");
+    }
+    return range.subpiece(offset, size);
+  };
+  data_ = StringPiece(section(header.dataOffset, header.dataSize));
+  auto offsets = section(header.offsetsOffset, header.offsetsSize);
+  auto fences = section(header.fencesOffset, header.fencesSize);
+
+  // Every entry takes at least a byte, which bounds the sizes below.
+  if (header.count > header.dataSize || header.fenceInterval == 0) {
+    throwCorrupt("bad entry count");
+  }
+  size_ = header.count;
+  fenceInterval_ = header.fenceInterval;
+  numFences_ = (size_ + fenceInterval_ - 1) / fenceInterval_;
+
+  auto fenceOffsetsSize = (numFences_ + 1) * sizeof(uint64_t);
+  if (fences.size() < fenceOffsetsSize) {
+    throwCorrupt("fence index too short");
+  }
+  fenceOffsets_ = reinterpret_cast<const uint64_t*>(fences.data());
+  fenceKeys_ = reinterpret_cast<const char*>(fences.data()) + fenceOffsetsSize;
+  if (fenceOffsets_[numFences_] != fences.size() - fenceOffsetsSize) {
+    throwCorrupt("fence index size mismatch");
+  }
+
+  compressed_ = header.flags & kCompressedOffsets;
+  if (compressed_) {
+    if (header.efNumLowerBits > 56) {
+      throwCorrupt("bad offset coding");
+    }
+    auto layout = detail::SortedTableOffsetEncoder::Layout::fromInternalSizes(
+        uint8_t(header.efNumLowerBits), header.efUpperBytes, size_ + 1);
+    if (layout.bytes() + 7 > offsets.size()) {
+      throwCorrupt("offsets too short");
+    }
+    efOffsets_ = layout.openList(offsets);
+  } else {
+    if (offsets.size() != (size_ + 1) * sizeof(uint64_t)) {
+      throwCorrupt("offsets size mismatch");
+    }
+    offsets_ = reinterpret_cast<const uint64_t*>(offsets.data());
+  }
+
+  // Every lookup starts in the fence index.
+  mapping_.advise(MADV_WILLNEED, header.fencesOffset, header.fencesSize);
+}
+
+std::pair<uint64_t, uint64_t> SortedTable::entryBounds(size_t i) const {
+  if (compressed_) {
+    OffsetReader reader(efOffsets_);
+    reader.jump(i);
+    auto begin = reader.value();
+    reader.next();
+    return std::make_pair(begin, reader.value());
+  }
+  return std::make_pair(offsets_[i], offsets_[i + 1]);
+}
+
+std::pair<StringPiece, StringPiece> SortedTable::entry(size_t i) const {
+  DCHECK_LT(i, size_);
+  auto bounds = entryBounds(i);
+  if (bounds.first > bounds.second || bounds.second > data_.size()) {
+    throwCorrupt("entry out of bounds");
+  }
+  auto bytes =
+      ByteRange(data_.subpiece(bounds.first, bounds.second - bounds.first));
+  auto length = decodeVarint(bytes);
+  if (length > bytes.size()) {
+    throwCorrupt("key out of bounds");
+  }
+  auto rest = StringPiece(bytes);
+  return std::make_pair(rest.subpiece(0, length), rest.subpiece(length));
+}
+
+StringPiece SortedTable::fence(size_t j) const {
+  auto begin = fenceOffsets_[j];
+  return StringPiece(fenceKeys_ + begin, fenceOffsets_[j + 1] - begin);
+}
+
+size_t SortedTable::lowerBound(StringPiece key) const {
+  // The first fence greater than key.
+  size_t lo = 0;
+  size_t hi = numFences_;
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    if (key < fence(mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  if (lo == 0) {
+    return 0;
+  }
+  // The answer is in the block before it, or is its first entry.
+  lo = (lo - 1) * fenceInterval_;
+  hi = std::min(size_, lo + fenceInterval_);
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    if (this->key(mid) < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+Optional<StringPiece> SortedTable::find(StringPiece key) const {
+  auto i = lowerBound(key);
+  if (i < size_) {
+    auto e = entry(i);
+    if (e.first == key) {
+      return e.second;
+    }
+  }
+  return none;
+}
+
+} // namespace folly
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * An immutable table of string keys and values sorted by key, in a file
+ * meant to be memory mapped and used in place.
+ *
+ * Loading a large lookup table into a sorted_vector_map at startup takes
+ * time proportional to its size, and each process holds its own copy.
+ * Opening a SortedTable only maps the file and checks its header, so it
+ * takes milliseconds whatever the size, and every process mapping the
+ * same file shares its pages in the page cache.
+ *
+ * The file holds, after a fixed header:
+ *   - the entries, each a varint key length, the key and the value,
+ *     back to back in key order;
+ *   - the offset of each entry in that region, either as an array of
+ *     64-bit integers or Elias-Fano coded, which typically takes under
+ *     two bytes per entry;
+ *   - a sparse fence index: a copy of every fenceInterval-th key.
+ *
+ * A lookup binary searches the fences, which are small and stay in the
+ * page cache, then the one block of fenceInterval entries they point
+ * to, so a cold lookup touches a few pages rather than log2(size).
+ *
+ *   {
+ *     SortedTableBuilder builder("/tmp/table");
+ *     builder.add("apple", "red");
+ *     builder.add("banana", "yellow");
+ *     builder.finish();
+ *   }
+ *   SortedTable table("/tmp/table");
+ *   auto value = table.find("apple");   // Optional<StringPiece>
+ *
+ * The file format uses the host's byte order, and is checked for on
+ * open; both are little endian wherever EliasFanoCoding.h works.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/experimental/EliasFanoCoding.h>
+#include <folly/system/MemoryMapping.h>
+
+namespace folly {
+
+namespace detail {
+
+struct SortedTableHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t flags;
+  uint64_t count;
+  uint64_t fenceInterval;
+  uint64_t dataOffset;
+  uint64_t dataSize;
+  uint64_t offsetsOffset;
+  uint64_t offsetsSize;
+  uint64_t efNumLowerBits;
+  uint64_t efUpperBytes;
+  uint64_t fencesOffset;
+  uint64_t fencesSize;
+  uint64_t fileSize;
+};
+
+using SortedTableOffsetEncoder =
+    compression::EliasFanoEncoderV2<uint64_t, size_t, 0, 128>;
+
+} // namespace detail
+
+/**
+ * Writes a SortedTable file.  Entries are streamed to the file as they
+ * are added, in strictly increasing key order; only their offsets and
+ * the fence keys are kept in memory until finish().
+ *
+ * Throws std::system_error on I/O errors.
+ */
+class SortedTableBuilder {
+ public:
+  struct Options {
+    Options() {}
+
+    // Convenience methods; return *this for chaining.
+    Options& setFenceInterval(size_t v) {
+      fenceInterval = v;
+      return *this;
+    }
+    Options& setCompressOffsets(bool v) {
+      compressOffsets = v;
+      return *this;
+    }
+
+    // Number of entries per fence.  Larger intervals make the index
+    // smaller, and the binary search in each block longer.
+    size_t fenceInterval = 64;
+
+    // Elias-Fano code the entry offsets, rather than storing 8 bytes per
+    // entry.  Lookups decode two offsets per probe instead of loading
+    // them, which costs a little time.
+    bool compressOffsets = false;
+  };
+
+  // Creates, or truncates, the file at path.
+  explicit SortedTableBuilder(const char* path, Options options = Options());
+  explicit SortedTableBuilder(File file, Options options = Options());
+
+  SortedTableBuilder(const SortedTableBuilder&) = delete;
+  SortedTableBuilder& operator=(const SortedTableBuilder&) = delete;
+
+  // Throws std::invalid_argument if key is not greater than the last one.
+  void add(StringPiece key, StringPiece value);
+
+  // Writes the offsets, the fence index and the header.  The table is
+  // unreadable until then.
+  void finish();
+
+  size_t size() const {
+    return offsets_.size();
+  }
+
+ private:
+  void write(StringPiece bytes);
+  void flush();
+  void padTo8();
+
+  File file_;
+  Options options_;
+  uint64_t pos_;
+  std::string buffer_;
+  std::string lastKey_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> fenceOffsets_;
+  std::string fenceKeys_;
+  bool finished_{false};
+};
+
+/**
+ * Reads a SortedTable file in place.  Returned StringPieces point into
+ * the mapping, and are valid as long as the SortedTable is.
+ *
+ * All methods are const and safe to call from many threads.
+ */
+class SortedTable {
+ public:
+  // Throw std::runtime_error if the file is not a valid table.
+  explicit SortedTable(const char* path);
+  explicit SortedTable(File file);
+  explicit SortedTable(MemoryMapping mapping);
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  Optional<StringPiece> find(StringPiece key) const;
+
+  // Index of the first entry whose key is not less than key, or size().
+  size_t lowerBound(StringPiece key) const;
+
+  // The key and value of the i-th entry in key order.
+  std::pair<StringPiece, StringPiece> entry(size_t i) const;
+
+  StringPiece key(size_t i) const {
+    return entry(i).first;
+  }
+
+  StringPiece value(size_t i) const {
+    return entry(i).second;
+  }
+
+  const MemoryMapping& mapping() const {
+    return mapping_;
+  }
+
+ private:
+  void open();
+  std::pair<uint64_t, uint64_t> entryBounds(size_t i) const;
+  StringPiece fence(size_t j) const;
+
+  MemoryMapping mapping_;
+  size_t size_{0};
+  size_t fenceInterval_{0};
+  size_t numFences_{0};
+  StringPiece data_;
+  const uint64_t* offsets_{nullptr};
+  compression::EliasFanoCompressedList efOffsets_;
+  bool compressed_{false};
+  const uint64_t* fenceOffsets_{nullptr};
+  const char* fenceKeys_{nullptr};
+};
+
+} // namespace folly
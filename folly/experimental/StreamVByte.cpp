@@ -0,0 +1,394 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/StreamVByte.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/Portability.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define FOLLY_STREAMVBYTE_SSSE3 1
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FOLLY_STREAMVBYTE_NEON 1
+#endif
+
+namespace folly {
+
+namespace {
+
+static_assert(kIsLittleEndian, "StreamVByte requires little endianness");
+
+enum class Mode { kPlain, kDelta, kZigZag };
+
+// Control bits per value, and values per control byte
+template <class T>
+struct Format;
+
+template <>
+struct Format<uint32_t> {
+  static constexpr size_t kBits = 2;
+  static constexpr size_t kPerControlByte = 4;
+};
+
+template <>
+struct Format<uint64_t> {
+  static constexpr size_t kBits = 4;
+  static constexpr size_t kPerControlByte = 2;
+};
+
+template <class T>
+inline size_t lengthOf(uint8_t control, size_t j) {
+  constexpr size_t kLengthMask = sizeof(T) - 1;
+  return ((control >> (j * Format<T>::kBits)) & kLengthMask) + 1;
+}
+
+// For each control byte, the shuffle that spreads its values' bytes over
+// 16-byte lanes, and the total length of its values.
+struct Tables {
+  Tables() {
+    build<uint32_t>(shuffle32, length32);
+    build<uint64_t>(shuffle64, length64);
+  }
+
+  template <class T>
+  static void build(uint8_t (&shuffle)[256][16], uint8_t (&length)[256]) {
+    for (size_t control = 0; control < 256; ++control) {
+      size_t pos = 0;
+      for (size_t j = 0; j < Format<T>::kPerControlByte; ++j) {
+        auto len = lengthOf<T>(uint8_t(control), j);
+        for (size_t b = 0; b < sizeof(T); ++b) {
+          shuffle[control][j * sizeof(T) + b] =
+              b < len ? uint8_t(pos + b) : 0x80;
+        }
+        pos += len;
+      }
+      length[control] = uint8_t(pos);
+    }
+  }
+
+  alignas(16) uint8_t shuffle32[256][16];
+  alignas(16) uint8_t shuffle64[256][16];
+  uint8_t length32[256];
+  uint8_t length64[256];
+};
+
+const Tables& tables() {
+  static const Tables t;
+  return t;
+}
+
+template <class T>
+inline size_t bytesFor(T v) {
+  return (findLastSet(v | 1) + 7) / 8;
+}
+
+template <class T>
+inline T zigzagEncode(T v) {
+  using S = typename std::make_signed<T>::type;
+  return (v << 1) ^ T(S(v) >> (8 * sizeof(T) - 1));
+}
+
+template <class T>
+inline T zigzagDecode(T v) {
+  return (v >> 1) ^ (T(0) - (v & 1));
+}
+
+[[noreturn]] void throwTruncated() {
+  throw std::out_of_range("StreamVByte: input truncated");
+}
+
+template <Mode M, class T>
+size_t encode(const T* in, size_t n, uint8_t* out, T previous) {
+  constexpr size_t kPer = Format<T>::kPerControlByte;
+  auto control = out;
+  auto controlBytes = (n + kPer - 1) / kPer;
+  std::memset(control, 0, controlBytes);
+  auto data = out + controlBytes;
+  for (size_t i = 0; i < n; ++i) {
+    T v = in[i];
+    if (M == Mode::kDelta) {
+      auto delta = v - previous;
+      previous = v;
+      v = delta;
+    } else if (M == Mode::kZigZag) {
+      v = zigzagEncode(v);
+    }
+    auto len = bytesFor(v);
+    auto shift = (i % kPer) * Format<T>::kBits;
+    control[i / kPer] |= uint8_t((len - 1) << shift);
+    // Writes all of v; the bytes past len are overwritten by what follows
+    // and are within streamVByteMaxEncodedSize.
+    std::memcpy(data, &v, sizeof(T));
+    data += len;
+  }
+  return size_t(data - out);
+}
+
+#if FOLLY_STREAMVBYTE_SSSE3
+
+template <class T>
+struct Simd;
+
+template <>
+struct Simd<uint32_t> {
+  using V = __m128i;
+  static V broadcast(uint32_t v) {
+    return _mm_set1_epi32(int32_t(v));
+  }
+  static V prefixSum(V v, V& previous) {
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi32(v, previous);
+    previous = _mm_shuffle_epi32(v, 0xff);
+    return v;
+  }
+  static V zigzag(V v) {
+    auto sign = _mm_sub_epi32(
+        _mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi32(1)));
+    return _mm_xor_si128(_mm_srli_epi32(v, 1), sign);
+  }
+};
+
+template <>
+struct Simd<uint64_t> {
+  using V = __m128i;
+  static V broadcast(uint64_t v) {
+    return _mm_set1_epi64x(int64_t(v));
+  }
+  static V prefixSum(V v, V& previous) {
+    v = _mm_add_epi64(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi64(v, previous);
+    previous = _mm_unpackhi_epi64(v, v);
+    return v;
+  }
+  static V zigzag(V v) {
+    auto sign = _mm_sub_epi64(
+        _mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi64x(1)));
+    return _mm_xor_si128(_mm_srli_epi64(v, 1), sign);
+  }
+};
+
+inline __m128i shuffleLoad(const uint8_t* data, const uint8_t* shuffle) {
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+      _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle)));
+}
+
+inline void store(void* out, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+}
+
+#elif FOLLY_STREAMVBYTE_NEON
+
+template <class T>
+struct Simd;
+
+template <>
+struct Simd<uint32_t> {
+  using V = uint32x4_t;
+  static V cast(uint8x16_t v) {
+    return vreinterpretq_u32_u8(v);
+  }
+  static V broadcast(uint32_t v) {
+    return vdupq_n_u32(v);
+  }
+  static V prefixSum(V v, V& previous) {
+    auto zero = vdupq_n_u32(0);
+    v = vaddq_u32(v, vextq_u32(zero, v, 3));
+    v = vaddq_u32(v, vextq_u32(zero, v, 2));
+    v = vaddq_u32(v, previous);
+    previous = vdupq_laneq_u32(v, 3);
+    return v;
+  }
+  static V zigzag(V v) {
+    auto sign = vreinterpretq_u32_s32(
+        vnegq_s32(vreinterpretq_s32_u32(vandq_u32(v, vdupq_n_u32(1)))));
+    return veorq_u32(vshrq_n_u32(v, 1), sign);
+  }
+};
+
+template <>
+struct Simd<uint64_t> {
+  using V = uint64x2_t;
+  static V cast(uint8x16_t v) {
+    return vreinterpretq_u64_u8(v);
+  }
+  static V broadcast(uint64_t v) {
+    return vdupq_n_u64(v);
+  }
+  static V prefixSum(V v, V& previous) {
+    v = vaddq_u64(v, vextq_u64(vdupq_n_u64(0), v, 1));
+    v = vaddq_u64(v, previous);
+    previous = vdupq_laneq_u64(v, 1);
+    return v;
+  }
+  static V zigzag(V v) {
+    auto sign = vreinterpretq_u64_s64(
+        vnegq_s64(vreinterpretq_s64_u64(vandq_u64(v, vdupq_n_u64(1)))));
+    return veorq_u64(vshrq_n_u64(v, 1), sign);
+  }
+};
+
+inline uint8x16_t shuffleLoad(const uint8_t* data, const uint8_t* shuffle) {
+  // Indices of 0x80 are out of range, and produce 0.
+  return vqtbl1q_u8(vld1q_u8(data), vld1q_u8(shuffle));
+}
+
+inline void store(void* out, uint32x4_t v) {
+  vst1q_u32(static_cast<uint32_t*>(out), v);
+}
+
+inline void store(void* out, uint64x2_t v) {
+  vst1q_u64(static_cast<uint64_t*>(out), v);
+}
+
+#endif
+
+template <Mode M, class T>
+size_t decode(ByteRange in, size_t n, T* out, T previous) {
+  constexpr size_t kPer = Format<T>::kPerControlByte;
+  auto controlBytes = (n + kPer - 1) / kPer;
+  if (in.size() < controlBytes) {
+    throwTruncated();
+  }
+  auto control = in.begin();
+  auto data = control + controlBytes;
+  auto end = in.end();
+  size_t i = 0;
+
+#if FOLLY_STREAMVBYTE_SSSE3 || FOLLY_STREAMVBYTE_NEON
+  // A group loads 16 bytes, so stop early enough not to read past end.
+  const auto& t = tables();
+  const auto& shuffles = sizeof(T) == 4 ? t.shuffle32 : t.shuffle64;
+  const auto& lengths = sizeof(T) == 4 ? t.length32 : t.length64;
+  auto vprevious = Simd<T>::broadcast(previous);
+  for (size_t g = 0; g < n / kPer && end - data >= 16; ++g) {
+    auto key = control[g];
+    auto v = shuffleLoad(data, shuffles[key]);
+#if FOLLY_STREAMVBYTE_NEON
+    auto w = Simd<T>::cast(v);
+#else
+    auto w = v;
+#endif
+    if (M == Mode::kDelta) {
+      w = Simd<T>::prefixSum(w, vprevious);
+    } else if (M == Mode::kZigZag) {
+      w = Simd<T>::zigzag(w);
+    }
+    store(out + i, w);
+    data += lengths[key];
+    i += kPer;
+  }
+  if (M == Mode::kDelta && i > 0) {
+    previous = out[i - 1];
+  }
+#endif
+
+  for (; i < n; ++i) {
+    auto len = lengthOf<T>(control[i / kPer], i % kPer);
+    if (size_t(end - data) < len) {
+      throwTruncated();
+    }
+    T v = 0;
+    std::memcpy(&v, data, len);
+    data += len;
+    if (M == Mode::kDelta) {
+      v += previous;
+      previous = v;
+    } else if (M == Mode::kZigZag) {
+      v = zigzagDecode(v);
+    }
+    out[i] = v;
+  }
+  return size_t(data - in.begin());
+}
+
+} // namespace
+
+size_t streamVByteEncode(const uint32_t* in, size_t n, uint8_t* out) {
+  return encode<Mode::kPlain>(in, n, out, uint32_t(0));
+}
+
+size_t streamVByteEncode(const uint64_t* in, size_t n, uint8_t* out) {
+  return encode<Mode::kPlain>(in, n, out, uint64_t(0));
+}
+
+size_t streamVByteDecode(ByteRange in, size_t n, uint32_t* out) {
+  return decode<Mode::kPlain>(in, n, out, uint32_t(0));
+}
+
+size_t streamVByteDecode(ByteRange in, size_t n, uint64_t* out) {
+  return decode<Mode::kPlain>(in, n, out, uint64_t(0));
+}
+
+size_t streamVByteEncodeDelta(
+    const uint32_t* in,
+    size_t n,
+    uint8_t* out,
+    uint32_t previous) {
+  return encode<Mode::kDelta>(in, n, out, previous);
+}
+
+size_t streamVByteEncodeDelta(
+    const uint64_t* in,
+    size_t n,
+    uint8_t* out,
+    uint64_t previous) {
+  return encode<Mode::kDelta>(in, n, out, previous);
+}
+
+size_t streamVByteDecodeDelta(
+    ByteRange in,
+    size_t n,
+    uint32_t* out,
+    uint32_t previous) {
+  return decode<Mode::kDelta>(in, n, out, previous);
+}
+
+size_t streamVByteDecodeDelta(
+    ByteRange in,
+    size_t n,
+    uint64_t* out,
+    uint64_t previous) {
+  return decode<Mode::kDelta>(in, n, out, previous);
+}
+
+size_t streamVByteEncodeZigZag(const int32_t* in, size_t n, uint8_t* out) {
+  return encode<Mode::kZigZag>(
+      reinterpret_cast<const uint32_t*>(in), n, out, uint32_t(0));
+}
+
+size_t streamVByteEncodeZigZag(const int64_t* in, size_t n, uint8_t* out) {
+  return encode<Mode::kZigZag>(
+      reinterpret_cast<const uint64_t*>(in), n, out, uint64_t(0));
+}
+
+size_t streamVByteDecodeZigZag(ByteRange in, size_t n, int32_t* out) {
+  return decode<Mode::kZigZag>(
+      in, n, reinterpret_cast<uint32_t*>(out), uint32_t(0));
+}
+
+size_t streamVByteDecodeZigZag(ByteRange in, size_t n, int64_t* out) {
+  return decode<Mode::kZigZag>(
+      in, n, reinterpret_cast<uint64_t*>(out), uint64_t(0));
+}
+
+} // namespace folly
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stream VByte: a variable-length integer encoding for whole arrays,
+ * designed for fast SIMD decoding.
+ *
+ * Like GroupVarint, each value takes only as many bytes as it needs, with
+ * its length stored in a separate control field.  Unlike GroupVarint, all
+ * control bytes come first, followed by all data bytes:
+ *
+ *   uint32_t: one control byte per 4 values, 2 bits each (length 1-4)
+ *   uint64_t: one control byte per 2 values, 4 bits each (length 1-8)
+ *
+ * so the decoder never waits for the data to find the next control byte.
+ * Each control byte indexes a table of shuffles that expands the next 16
+ * data bytes into 4 (or 2) integers in one instruction, with SSSE3 on
+ * x86 and NEON on aarch64; other platforms use a scalar loop.
+ *
+ * The number of values is not stored; the caller keeps it.  Encoding
+ * writes at most streamVByteMaxEncodedSize<T>(n) bytes.  Decoding never
+ * reads past the given input, and throws std::out_of_range if it is too
+ * short.  All functions return the number of bytes written or read.
+ *
+ * The Delta variants store differences from the previous value, which
+ * keeps sorted ids small; the ZigZag variants map small negative numbers
+ * to small unsigned ones.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+template <class T>
+constexpr size_t streamVByteMaxEncodedSize(size_t n) {
+  static_assert(
+      sizeof(T) == 4 || sizeof(T) == 8, "StreamVByte encodes 32 or 64 bits");
+  return (sizeof(T) == 4 ? (n + 3) / 4 : (n + 1) / 2) + n * sizeof(T);
+}
+
+size_t streamVByteEncode(const uint32_t* in, size_t n, uint8_t* out);
+size_t streamVByteEncode(const uint64_t* in, size_t n, uint8_t* out);
+size_t streamVByteDecode(ByteRange in, size_t n, uint32_t* out);
+size_t streamVByteDecode(ByteRange in, size_t n, uint64_t* out);
+
+// The first value is stored relative to previous.
+size_t streamVByteEncodeDelta(
+    const uint32_t* in,
+    size_t n,
+    uint8_t* out,
+    uint32_t previous = 0);
+size_t streamVByteEncodeDelta(
+    const uint64_t* in,
+    size_t n,
+    uint8_t* out,
+    uint64_t previous = 0);
+size_t streamVByteDecodeDelta(
+    ByteRange in,
+    size_t n,
+    uint32_t* out,
+    uint32_t previous = 0);
+size_t streamVByteDecodeDelta(
+    ByteRange in,
+    size_t n,
+    uint64_t* out,
+    uint64_t previous = 0);
+
+size_t streamVByteEncodeZigZag(const int32_t* in, size_t n, uint8_t* out);
+size_t streamVByteEncodeZigZag(const int64_t* in, size_t n, uint8_t* out);
+size_t streamVByteDecodeZigZag(ByteRange in, size_t n, int32_t* out);
+size_t streamVByteDecodeZigZag(ByteRange in, size_t n, int64_t* out);
+
+} // namespace folly
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/StringInterner.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/hash/Xxh3.h>
+
+namespace folly {
+
+namespace {
+
+// Strings are packed without padding
+constexpr size_t kArenaBlockSize = 64 * 1024;
+constexpr size_t kArenaAlign = 1;
+
+inline uint64_t hashString(StringPiece s) {
+  return hash::xxh3_64(s.data(), s.size());
+}
+
+inline uint64_t makeSlot(uint64_t hash, uint32_t handle) {
+  return (hash & ~uint64_t(0xffffffff)) | (uint64_t(handle) + 1);
+}
+
+} // namespace
+
+constexpr uint32_t StringInterner::kNotFound;
+constexpr unsigned StringInterner::kFirstSegmentShift;
+constexpr size_t StringInterner::kFirstSegmentSize;
+constexpr size_t StringInterner::kMaxSegments;
+
+StringInterner::Table::Table(size_t capacity)
+    : mask(capacity - 1),
+      slots(new std::atomic<uint64_t>[capacity]) {
+  for (size_t i = 0; i < capacity; ++i) {
+    slots[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+StringInterner::StringInterner(size_t initialCapacity)
+    : arena_(kArenaBlockSize, SysArena::kNoSizeLimit, kArenaAlign) {
+  size_t capacity = 16;
+  while (capacity < 2 * initialCapacity) {
+    capacity *= 2;
+  }
+  tables_.emplace_back(new Table(capacity));
+  table_.store(tables_.back().get(), std::memory_order_release);
+  for (auto& segment : segments_) {
+    segment.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+StringInterner::~StringInterner() {}
+
+uint32_t StringInterner::findIn(
+    const Table& table,
+    StringPiece s,
+    uint64_t hash) const {
+  uint64_t tag = hash & ~uint64_t(0xffffffff);
+  for (size_t i = hash >> 32 & table.mask;; i = (i + 1) & table.mask) {
+    uint64_t slot = table.slots[i].load(std::memory_order_acquire);
+    if (slot == 0) {
+      return kNotFound;
+    }
+    if ((slot & ~uint64_t(0xffffffff)) == tag) {
+      uint32_t handle = uint32_t(slot) - 1;
+      if (lookup(handle) == s) {
+        return handle;
+      }
+    }
+  }
+}
+
+uint32_t StringInterner::find(StringPiece s) const {
+  return findIn(*table_.load(std::memory_order_acquire), s, hashString(s));
+}
+
+void StringInterner::insertInto(Table& table, uint64_t slot) {
+  for (size_t i = slot >> 32 & table.mask;; i = (i + 1) & table.mask) {
+    if (table.slots[i].load(std::memory_order_relaxed) == 0) {
+      table.slots[i].store(slot, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+void StringInterner::grow() {
+  const Table& old = *tables_.back();
+  std::unique_ptr<Table> table(new Table(2 * (old.mask + 1)));
+  for (size_t i = 0; i <= old.mask; ++i) {
+    uint64_t slot = old.slots[i].load(std::memory_order_relaxed);
+    if (slot != 0) {
+      insertInto(*table, slot);
+    }
+  }
+  tables_.push_back(std::move(table));
+  table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+uint32_t StringInterner::intern(StringPiece s) {
+  uint64_t hash = hashString(s);
+  uint32_t handle = findIn(*table_.load(std::memory_order_acquire), s, hash);
+  if (handle != kNotFound) {
+    return handle;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another writer may have interned s since we looked
+  handle = findIn(*tables_.back(), s, hash);
+  if (handle != kNotFound) {
+    return handle;
+  }
+
+  handle = size_.load(std::memory_order_relaxed);
+  if (handle == kNotFound) {
+    throw std::length_error("StringInterner: too many strings");
+  }
+  if (2 * (size_t(handle) + 1) > tables_.back()->mask + 1) {
+    grow();
+  }
+
+  auto pos = locate(handle);
+  StringPiece* segment = segments_[pos.first].load(std::memory_order_relaxed);
+  if (!segment) {
+    segmentStorage_.emplace_back(
+        new StringPiece[kFirstSegmentSize << pos.first]);
+    segment = segmentStorage_.back().get();
+    segments_[pos.first].store(segment, std::memory_order_release);
+  }
+
+  StringPiece copy("");
+  if (!s.empty()) {
+    auto data = static_cast<char*>(arena_.allocate(s.size()));
+    memcpy(data, s.data(), s.size());
+    copy.reset(data, s.size());
+  }
+  segment[pos.second] = copy;
+
+  // Publishing the slot publishes the piece; readers that found the
+  // handle some other way synchronize through size_ or the caller.
+  insertInto(*tables_.back(), makeSlot(hash, handle));
+  size_.store(handle + 1, std::memory_order_release);
+  return handle;
+}
+
+StringInterner& StringInterner::defaultInterner() {
+  static auto instance = new StringInterner(1024);
+  return *instance;
+}
+
+} // namespace folly
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A concurrent pool of interned strings.  Each distinct string is stored
+ * once, for the lifetime of the interner, and is identified by a dense
+ * 32-bit handle (0, 1, 2, ... in order of first insertion):
+ *
+ *   StringInterner interner;
+ *   uint32_t h = interner.intern("requests.count");
+ *   StringPiece s = interner.lookup(h);          // "requests.count"
+ *   assert(interner.intern(std::string("requests.count")) == h);
+ *   assert(s.data() == interner.internPiece("requests.count").data());
+ *
+ * Strings are packed back to back in an arena, without per-string
+ * allocations or headers, so the StringPieces returned stay valid until
+ * the interner is destroyed.
+ *
+ * Looking up a string that is already interned (find(), and intern() of an
+ * existing string) and resolving a handle (lookup()) are lock-free: they
+ * only read atomics published by writers.  Inserting a new string takes a
+ * mutex.  The index is an open addressing hash table that is replaced by
+ * one twice as large when it gets half full; replaced tables are kept
+ * until destruction so concurrent readers never see freed memory (they
+ * add up to less than the current one).
+ *
+ * To share key storage between StringKeyed* containers, give them an
+ * InterningAllocator (see StringKeyedCommon.h).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <folly/Bits.h>
+#include <folly/Range.h>
+#include <folly/memory/Arena.h>
+
+namespace folly {
+
+class StringInterner {
+ public:
+  // Returned by find() for strings that were never interned
+  static constexpr uint32_t kNotFound = uint32_t(-1);
+
+  explicit StringInterner(size_t initialCapacity = 64);
+  ~StringInterner();
+
+  StringInterner(const StringInterner&) = delete;
+  StringInterner& operator=(const StringInterner&) = delete;
+
+  /**
+   * Returns the handle of s, interning a copy of it first if needed.
+   * Throws std::length_error if there are already 2^32 - 1 strings.
+   */
+  uint32_t intern(StringPiece s);
+
+  /**
+   * Returns the interned copy of s, interning it first if needed.
+   */
+  StringPiece internPiece(StringPiece s) {
+    return lookup(intern(s));
+  }
+
+  /**
+   * Returns the handle of s, or kNotFound.  Never blocks.
+   */
+  uint32_t find(StringPiece s) const;
+
+  /**
+   * Returns the string with the given handle, which must have been
+   * returned by this interner.  Never blocks.
+   */
+  StringPiece lookup(uint32_t handle) const {
+    auto pos = locate(handle);
+    return segments_[pos.first].load(std::memory_order_acquire)[pos.second];
+  }
+
+  /**
+   * Number of distinct strings interned so far.
+   */
+  size_t size() const {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * A process-wide interner, never destroyed.
+   */
+  static StringInterner& defaultInterner();
+
+ private:
+  // Handles index a sequence of segments of kFirstSegmentSize,
+  // 2 * kFirstSegmentSize, 4 * kFirstSegmentSize... pieces, so existing
+  // pieces never move.
+  static constexpr unsigned kFirstSegmentShift = 6;
+  static constexpr size_t kFirstSegmentSize = size_t(1) << kFirstSegmentShift;
+  static constexpr size_t kMaxSegments = 33 - kFirstSegmentShift;
+
+  // Slots hold (hash >> 32) << 32 | (handle + 1); 0 is empty.
+  struct Table {
+    explicit Table(size_t capacity);
+
+    size_t mask;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+  };
+
+  static std::pair<size_t, size_t> locate(uint32_t handle) {
+    uint64_t i = uint64_t(handle) + kFirstSegmentSize;
+    unsigned segment = findLastSet(i) - 1;
+    return {segment - kFirstSegmentShift, i - (uint64_t(1) << segment)};
+  }
+
+  uint32_t findIn(const Table& table, StringPiece s, uint64_t hash) const;
+  static void insertInto(Table& table, uint64_t slot);
+  void grow();
+
+  std::atomic<Table*> table_;
+  std::atomic<StringPiece*> segments_[kMaxSegments];
+  std::atomic<uint32_t> size_{0};
+
+  // Only used by writers, under mutex_
+  std::mutex mutex_;
+  SysArena arena_;
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::vector<std::unique_ptr<StringPiece[]>> segmentStorage_;
+};
+
+} // namespace folly
@@ -21,6 +21,7 @@
 #include <memory>
 
 #include <folly/Range.h>
+#include <folly/experimental/StringInterner.h>
 
 namespace folly {
 
@@ -42,4 +43,65 @@ void stringPieceDel(StringPiece piece, const Alloc& alloc) {
     .deallocate(const_cast<char*>(piece.data()), piece.size());
 }
 
+/**
+ * An allocator for StringKeyed* containers that keys them on strings
+ * interned in a StringInterner instead of on private copies: every
+ * container using the same interner shares one copy of each key, and
+ * erasing a key leaves it interned.  Everything else is allocated by
+ * std::allocator.
+ *
+ *   StringKeyedUnorderedMap<
+ *       int,
+ *       Hash,
+ *       std::equal_to<StringPiece>,
+ *       InterningAllocator<std::pair<const StringPiece, int>>> counters;
+ */
+template <class T>
+class InterningAllocator : public std::allocator<T> {
+ public:
+  template <class U>
+  struct rebind {
+    typedef InterningAllocator<U> other;
+  };
+
+  InterningAllocator() noexcept
+      : interner_(&StringInterner::defaultInterner()) {}
+
+  explicit InterningAllocator(StringInterner& interner) noexcept
+      : interner_(&interner) {}
+
+  template <class U>
+  /* implicit */ InterningAllocator(const InterningAllocator<U>& other) noexcept
+      : interner_(&other.interner()) {}
+
+  StringInterner& interner() const {
+    return *interner_;
+  }
+
+ private:
+  StringInterner* interner_;
+};
+
+template <class T, class U>
+bool operator==(const InterningAllocator<T>& a,
+                const InterningAllocator<U>& b) {
+  return &a.interner() == &b.interner();
+}
+
+template <class T, class U>
+bool operator!=(const InterningAllocator<T>& a,
+                const InterningAllocator<U>& b) {
+  return !(a == b);
+}
+
+template <class T>
+StringPiece stringPieceDup(StringPiece piece,
+                           const InterningAllocator<T>& alloc) {
+  return alloc.interner().internPiece(piece);
+}
+
+template <class T>
+void stringPieceDel(StringPiece /* piece */,
+                    const InterningAllocator<T>& /* alloc */) {}
+
 } // namespace folly
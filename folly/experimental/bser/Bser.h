@@ -93,6 +93,61 @@ folly::dynamic parseBser(const folly::IOBuf*);
 // the header, or throws a runtime_error if the header is invalid
 size_t decodePduLength(const folly::IOBuf*);
 
+// Receives the values of a BSER pdu as it is parsed, for callers that don't
+// need a folly::dynamic.  Templated arrays are passed as arrays of objects,
+// and their skipped values as null.
+class BserVisitor {
+ public:
+  virtual ~BserVisitor() {}
+
+  virtual void onNull() = 0;
+  virtual void onBool(bool value) = 0;
+  virtual void onInt(int64_t value) = 0;
+  virtual void onReal(double value) = 0;
+  // Strings and keys are only valid during the call.  They point into the
+  // buffers being parsed, unless they span several of them.
+  virtual void onString(folly::StringPiece value) = 0;
+  virtual void onArrayBegin(size_t size) = 0;
+  virtual void onArrayEnd() = 0;
+  virtual void onObjectBegin(size_t size) = 0;
+  virtual void onKey(folly::StringPiece key) = 0;
+  virtual void onObjectEnd() = 0;
+};
+
+// Parse a BSER pdu from a chain of buffers, which is never coalesced,
+// passing its values to visitor.
+void visitBser(const folly::IOBuf*, BserVisitor& visitor);
+
+// Splits a stream of BSER pdus into whole pdus, as its data arrives.
+//
+//   BserPduReader reader;
+//   while (auto data = readSome()) {
+//     reader.append(std::move(data));
+//     while (auto pdu = reader.next()) {
+//       visitBser(pdu.get(), visitor);
+//     }
+//   }
+class BserPduReader {
+ public:
+  // Append the next data of the stream
+  void append(std::unique_ptr<folly::IOBuf> data);
+
+  // The next whole pdu, sharing the buffers appended, or nullptr if its
+  // data hasn't all arrived.  Throws std::runtime_error if its header is
+  // invalid.
+  std::unique_ptr<folly::IOBuf> next();
+
+  // Bytes appended that aren't part of a pdu returned yet
+  size_t pendingLength() const {
+    return queue_.chainLength();
+  }
+
+ private:
+  folly::IOBufQueue queue_{folly::IOBufQueue::cacheChainLength()};
+  // Length of the next pdu once its header has been decoded, 0 until then
+  size_t pduLength_{0};
+};
+
 folly::fbstring toBser(folly::dynamic const&, const serialization_opts&);
 std::unique_ptr<folly::IOBuf> toBserIOBuf(
     folly::dynamic const&,
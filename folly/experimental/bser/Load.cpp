@@ -16,6 +16,10 @@
 
 #include <folly/experimental/bser/Bser.h>
 
+#include <deque>
+#include <string>
+#include <vector>
+
 #include <folly/String.h>
 #include <folly/io/Cursor.h>
 
@@ -201,6 +205,188 @@ static size_t decodeHeader(Cursor& curs) {
   return int_size + 3 /* magic + int type */ + decodeInt(curs);
 }
 
+namespace {
+
+// Visits the values of a pdu, with strings that point into its buffers
+// unless they span several of them
+class Visitor {
+ public:
+  explicit Visitor(BserVisitor& visitor) : visitor_(visitor) {}
+
+  void visitValue(Cursor& curs) {
+    switch ((BserType)curs.read<int8_t>()) {
+      case BserType::Int8:
+        return visitor_.onInt(curs.read<int8_t>());
+      case BserType::Int16:
+        return visitor_.onInt(curs.read<int16_t>());
+      case BserType::Int32:
+        return visitor_.onInt(curs.read<int32_t>());
+      case BserType::Int64:
+        return visitor_.onInt(curs.read<int64_t>());
+      case BserType::Real: {
+        double dval;
+        curs.pull((void*)&dval, sizeof(dval));
+        return visitor_.onReal(dval);
+      }
+      case BserType::Null:
+        return visitor_.onNull();
+      case BserType::True:
+        return visitor_.onBool(true);
+      case BserType::False:
+        return visitor_.onBool(false);
+      case BserType::String:
+        return visitor_.onString(readString(curs));
+      case BserType::Array:
+        return visitArray(curs);
+      case BserType::Object:
+        return visitObject(curs);
+      case BserType::Template:
+        return visitTemplate(curs);
+      case BserType::Skip:
+        throw std::runtime_error(
+            "Skip not valid at this location in the bser stream");
+      default:
+        throw std::runtime_error("invalid bser encoding");
+    }
+  }
+
+ private:
+  size_t readSize(Cursor& curs) {
+    auto size = decodeInt(curs);
+    if (size < 0) {
+      throw std::range_error("size must not be negative");
+    }
+    return size_t(size);
+  }
+
+  StringPiece readString(Cursor& curs) {
+    auto len = readSize(curs);
+    auto bytes = curs.peekBytes();
+    if (bytes.size() >= len) {
+      curs.skip(len);
+      return StringPiece(bytes.subpiece(0, len));
+    }
+    if (!curs.canAdvance(len)) {
+      throwDecodeError(curs, "string of ", len, " bytes is truncated");
+    }
+    scratch_.resize(len);
+    curs.pull(&scratch_[0], len);
+    return scratch_;
+  }
+
+  void visitArray(Cursor& curs) {
+    auto size = readSize(curs);
+    visitor_.onArrayBegin(size);
+    while (size-- > 0) {
+      visitValue(curs);
+    }
+    visitor_.onArrayEnd();
+  }
+
+  void visitObject(Cursor& curs) {
+    auto size = readSize(curs);
+    visitor_.onObjectBegin(size);
+    while (size-- > 0) {
+      if ((BserType)curs.read<int8_t>() != BserType::String) {
+        throwDecodeError(curs, "expected String");
+      }
+      visitor_.onKey(readString(curs));
+      visitValue(curs);
+    }
+    visitor_.onObjectEnd();
+  }
+
+  void visitTemplate(Cursor& curs) {
+    // List of property names, used for every object
+    if ((BserType)curs.read<int8_t>() != BserType::Array) {
+      throw std::runtime_error("Expected array encoding for property names");
+    }
+    auto nameCount = readSize(curs);
+    std::vector<StringPiece> names;
+    std::deque<std::string> copies;
+    while (nameCount-- > 0) {
+      if ((BserType)curs.read<int8_t>() != BserType::String) {
+        throwDecodeError(curs, "expected String");
+      }
+      auto name = readString(curs);
+      if (name.data() == scratch_.data()) {
+        copies.push_back(name.str());
+        name = copies.back();
+      }
+      names.push_back(name);
+    }
+
+    auto size = readSize(curs);
+    visitor_.onArrayBegin(size);
+    while (size-- > 0) {
+      visitor_.onObjectBegin(names.size());
+      for (auto& name : names) {
+        visitor_.onKey(name);
+        if ((BserType)curs.peekBytes().at(0) == BserType::Skip) {
+          curs.skip(1);
+          visitor_.onNull();
+        } else {
+          visitValue(curs);
+        }
+      }
+      visitor_.onObjectEnd();
+    }
+    visitor_.onArrayEnd();
+  }
+
+  BserVisitor& visitor_;
+  std::string scratch_;
+};
+
+// Length of the pdu header, if enough of it is available to know it
+size_t headerLength(const IOBufQueue& queue) {
+  if (queue.chainLength() < sizeof(kMagic) + 1) {
+    return 0;
+  }
+  Cursor curs(queue.front());
+  curs.skip(sizeof(kMagic));
+  switch ((BserType)curs.read<int8_t>()) {
+    case BserType::Int8:
+      return sizeof(kMagic) + 2;
+    case BserType::Int16:
+      return sizeof(kMagic) + 3;
+    case BserType::Int32:
+      return sizeof(kMagic) + 5;
+    case BserType::Int64:
+      return sizeof(kMagic) + 9;
+    default:
+      throw std::runtime_error("invalid BSER pdu length encoding");
+  }
+}
+
+} // namespace
+
+void visitBser(const IOBuf* buf, BserVisitor& visitor) {
+  Cursor curs(buf);
+  decodeHeader(curs);
+  Visitor(visitor).visitValue(curs);
+}
+
+void BserPduReader::append(std::unique_ptr<IOBuf> data) {
+  queue_.append(std::move(data));
+}
+
+std::unique_ptr<IOBuf> BserPduReader::next() {
+  if (pduLength_ == 0) {
+    auto length = headerLength(queue_);
+    if (length == 0 || queue_.chainLength() < length) {
+      return nullptr;
+    }
+    pduLength_ = decodePduLength(queue_.front());
+  }
+  if (queue_.chainLength() < pduLength_) {
+    return nullptr;
+  }
+  auto pdu = queue_.split(pduLength_);
+  pduLength_ = 0;
+  return pdu;
+}
+
 size_t decodePduLength(const folly::IOBuf* buf) {
   Cursor curs(buf);
   return decodeHeader(curs);
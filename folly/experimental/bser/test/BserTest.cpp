@@ -17,6 +17,7 @@
 #include <folly/experimental/bser/Bser.h>
 
 #include <folly/String.h>
+#include <folly/io/IOBufQueue.h>
 #include <folly/portability/GTest.h>
 
 using folly::dynamic;
@@ -118,5 +119,160 @@ TEST(Bser, PduLength) {
   EXPECT_EQ(len, 44) << "PduLength should be 44, got " << len;
 }
 
+namespace {
+
+// Builds the dynamic that parseBser() would, checking that strings are
+// only copied when they span several buffers
+class DynamicBuilder : public folly::bser::BserVisitor {
+ public:
+  explicit DynamicBuilder(const folly::IOBuf* buf) : buf_(buf) {}
+
+  void onNull() override {
+    add(nullptr);
+  }
+  void onBool(bool value) override {
+    add(value);
+  }
+  void onInt(int64_t value) override {
+    add(value);
+  }
+  void onReal(double value) override {
+    add(value);
+  }
+  void onString(folly::StringPiece value) override {
+    checkZeroCopy(value);
+    add(value);
+  }
+  void onArrayBegin(size_t) override {
+    stack_.push_back(dynamic::array());
+  }
+  void onArrayEnd() override {
+    end();
+  }
+  void onObjectBegin(size_t) override {
+    stack_.push_back(dynamic::object());
+  }
+  void onKey(folly::StringPiece key) override {
+    checkZeroCopy(key);
+    keys_.push_back(key.str());
+  }
+  void onObjectEnd() override {
+    end();
+  }
+
+  dynamic result{nullptr};
+  size_t copied{0};
+
+ private:
+  void checkZeroCopy(folly::StringPiece value) {
+    for (auto range : *buf_) {
+      folly::StringPiece piece(range);
+      if (value.begin() >= piece.begin() && value.end() <= piece.end()) {
+        return;
+      }
+    }
+    ++copied;
+  }
+
+  void add(dynamic value) {
+    if (stack_.empty()) {
+      result = std::move(value);
+    } else if (stack_.back().isArray()) {
+      stack_.back().push_back(std::move(value));
+    } else {
+      stack_.back()[keys_.back()] = std::move(value);
+      keys_.pop_back();
+    }
+  }
+
+  void end() {
+    auto value = std::move(stack_.back());
+    stack_.pop_back();
+    add(std::move(value));
+  }
+
+  const folly::IOBuf* buf_;
+  std::vector<dynamic> stack_;
+  std::vector<std::string> keys_;
+};
+
+// The same data, in buffers of at most chunkSize bytes
+std::unique_ptr<folly::IOBuf> split(folly::ByteRange data, size_t chunkSize) {
+  folly::IOBufQueue queue;
+  while (!data.empty()) {
+    auto chunk = data.subpiece(0, chunkSize);
+    queue.append(folly::IOBuf::copyBuffer(chunk.data(), chunk.size()));
+    data.advance(chunk.size());
+  }
+  return queue.move();
+}
+
+} // namespace
+
+TEST(Bser, Visitor) {
+  dynamic nested = dynamic::object("key", "value")(
+      "list", dynamic::array(1, 2.5, "a longer string", nullptr, true))(
+      "empty", dynamic::array());
+  std::vector<std::pair<dynamic, folly::fbstring>> cases;
+  for (const auto& dyn : roundtrips) {
+    cases.emplace_back(
+        dyn, folly::bser::toBser(dyn, folly::bser::serialization_opts()));
+  }
+  cases.emplace_back(
+      nested, folly::bser::toBser(nested, folly::bser::serialization_opts()));
+  cases.emplace_back(
+      template_dynamic,
+      folly::fbstring(
+          reinterpret_cast<const char*>(template_blob),
+          sizeof(template_blob) - 1));
+
+  for (auto& c : cases) {
+    auto data = folly::ByteRange(folly::StringPiece(c.second));
+    // In a single buffer, no string is copied
+    {
+      auto buf = folly::IOBuf::wrapBuffer(data);
+      DynamicBuilder builder(buf.get());
+      folly::bser::visitBser(buf.get(), builder);
+      EXPECT_EQ(c.first, builder.result);
+      EXPECT_EQ(0, builder.copied);
+    }
+    for (size_t chunkSize : {1, 2, 3, 7}) {
+      auto buf = split(data, chunkSize);
+      DynamicBuilder builder(buf.get());
+      folly::bser::visitBser(buf.get(), builder);
+      EXPECT_EQ(c.first, builder.result) << chunkSize;
+      EXPECT_EQ(c.first, folly::bser::parseBser(buf.get())) << chunkSize;
+    }
+  }
+}
+
+TEST(Bser, PduReader) {
+  folly::fbstring stream;
+  std::vector<dynamic> expected;
+  for (const auto& dyn : roundtrips) {
+    stream += folly::bser::toBser(dyn, folly::bser::serialization_opts());
+    expected.push_back(dyn);
+  }
+  auto data = folly::ByteRange(folly::StringPiece(stream));
+
+  for (size_t chunkSize : {1, 2, 5, 1000}) {
+    folly::bser::BserPduReader reader;
+    std::vector<dynamic> found;
+    auto chunks = split(data, chunkSize);
+    for (auto range : *chunks) {
+      reader.append(folly::IOBuf::copyBuffer(range.data(), range.size()));
+      while (auto pdu = reader.next()) {
+        found.push_back(folly::bser::parseBser(pdu.get()));
+      }
+    }
+    EXPECT_EQ(expected, found) << chunkSize;
+    EXPECT_EQ(0, reader.pendingLength());
+  }
+
+  folly::bser::BserPduReader reader;
+  reader.append(folly::IOBuf::copyBuffer("\x00\x02\x03\x01", 4));
+  EXPECT_THROW(reader.next(), std::runtime_error);
+}
+
 /* vim:ts=2:sw=2:et:
  */
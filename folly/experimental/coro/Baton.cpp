@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Baton.h>
+
+#if FOLLY_HAS_CORO
+#include <glog/logging.h>
+
+namespace folly {
+namespace coro {
+
+Baton::~Baton() {
+  // A waiter would never be resumed
+  DCHECK(
+      state_.load(std::memory_order_relaxed) == nullptr ||
+      state_.load(std::memory_order_relaxed) == static_cast<const void*>(this));
+}
+
+void Baton::post() noexcept {
+  const void* signalled = static_cast<const void*>(this);
+  auto old = state_.exchange(signalled, std::memory_order_acq_rel);
+  if (old == signalled) {
+    return;
+  }
+  // A resumed waiter may destroy the Baton, don't touch it anymore
+  auto waiter = static_cast<WaitOperation*>(const_cast<void*>(old));
+  while (waiter) {
+    auto next = waiter->next_;
+    waiter->awaitingCoroutine_.resume();
+    waiter = next;
+  }
+}
+
+void Baton::reset() noexcept {
+  const void* signalled = static_cast<const void*>(this);
+  state_.compare_exchange_strong(
+      signalled, nullptr, std::memory_order_relaxed, std::memory_order_relaxed);
+}
+
+bool Baton::waitImpl(WaitOperation* awaiter) const noexcept {
+  const void* signalled = static_cast<const void*>(this);
+  auto old = state_.load(std::memory_order_acquire);
+  do {
+    if (old == signalled) {
+      return false;
+    }
+    awaiter->next_ = static_cast<WaitOperation*>(const_cast<void*>(old));
+  } while (!state_.compare_exchange_weak(
+      old,
+      static_cast<const void*>(awaiter),
+      std::memory_order_release,
+      std::memory_order_acquire));
+  return true;
+}
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
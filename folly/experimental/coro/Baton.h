@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+
+/**
+ * A one-shot event that coroutines can wait for without blocking a thread.
+ *
+ *   Baton baton;
+ *
+ *   // waiters, any number of them
+ *   co_await baton;
+ *
+ *   // from anywhere, coroutine or not
+ *   baton.post();
+ *
+ * post() resumes all the waiters inline, before it returns; a waiting Task
+ * gets back to its executor instead (see Task.h).  Waiting on a posted
+ * Baton doesn't suspend.  reset() makes a posted Baton not posted again,
+ * and must not race with waiters or post().
+ */
+class Baton {
+ public:
+  class WaitOperation {
+   public:
+    explicit WaitOperation(const Baton& baton) noexcept : baton_(baton) {}
+
+    bool await_ready() const noexcept {
+      return baton_.ready();
+    }
+
+    bool await_suspend(coroutine_handle<> awaitingCoroutine) noexcept {
+      awaitingCoroutine_ = awaitingCoroutine;
+      return baton_.waitImpl(this);
+    }
+
+    void await_resume() noexcept {}
+
+   private:
+    friend class Baton;
+
+    const Baton& baton_;
+    coroutine_handle<> awaitingCoroutine_;
+    WaitOperation* next_{nullptr};
+  };
+
+  explicit Baton(bool initiallySignalled = false) noexcept
+      : state_(initiallySignalled ? static_cast<const void*>(this) : nullptr) {}
+
+  Baton(const Baton&) = delete;
+  Baton& operator=(const Baton&) = delete;
+
+  ~Baton();
+
+  bool ready() const noexcept {
+    return state_.load(std::memory_order_acquire) ==
+        static_cast<const void*>(this);
+  }
+
+  WaitOperation operator co_await() const noexcept {
+    return WaitOperation(*this);
+  }
+
+  void post() noexcept;
+
+  void reset() noexcept;
+
+ private:
+  // Returns false, to not suspend, if the Baton was posted already
+  bool waitImpl(WaitOperation* awaiter) const noexcept;
+
+  // this if posted, otherwise the last waiter, a stack through next_
+  mutable std::atomic<const void*> state_;
+};
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
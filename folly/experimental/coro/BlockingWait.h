@@ -0,0 +1,91 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/coro/Task.h>
+
+/**
+ * blockingWait() waits for a Task, or anything awaitable, from
+ * non-coroutine code, and returns its result or rethrows its exception.
+ *
+ * A Task without an executor, and anything else awaitable, runs on the
+ * calling thread, which drives a ManualExecutor until it's done; a
+ * TaskWithExecutor runs on its executor.
+ *
+ * Don't call it from a thread that the awaited work needs to make
+ * progress, e.g. from a task running on the executor it waits for.
+ */
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+
+template <typename T>
+T blockingWait(TaskWithExecutor<T> task) {
+  return std::move(task).start().get();
+}
+
+inline void blockingWait(TaskWithExecutor<void> task) {
+  std::move(task).start().get();
+}
+
+template <typename T>
+T blockingWait(Task<T> task) {
+  ManualExecutor executor;
+  auto future = std::move(task).scheduleOn(&executor).start();
+  executor.waitFor(future);
+  return std::move(future).get();
+}
+
+inline void blockingWait(Task<void> task) {
+  ManualExecutor executor;
+  auto future = std::move(task).scheduleOn(&executor).start();
+  executor.waitFor(future);
+  std::move(future).get();
+}
+
+namespace detail {
+
+template <typename Awaitable>
+Task<await_result_t<Awaitable>> makeBlockingWaitTask(Awaitable awaitable) {
+  co_return co_await std::move(awaitable);
+}
+
+template <typename T>
+struct IsTask : std::false_type {};
+template <typename T>
+struct IsTask<Task<T>> : std::true_type {};
+template <typename T>
+struct IsTask<TaskWithExecutor<T>> : std::true_type {};
+
+} // namespace detail
+
+template <
+    typename Awaitable,
+    typename = std::enable_if_t<!detail::IsTask<std::decay_t<Awaitable>>::value>>
+decltype(auto) blockingWait(Awaitable&& awaitable) {
+  return blockingWait(detail::makeBlockingWaitTask<std::decay_t<Awaitable>>(
+      static_cast<Awaitable&&>(awaitable)));
+}
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/Utility.h>
+#include <folly/experimental/coro/Task.h>
+
+/**
+ * Run Tasks concurrently, on the executor of the awaiting Task.
+ *
+ *   // Both fetches are in flight at the same time
+ *   std::tuple<int, std::string> r = co_await collectAll(fetchA(), fetchB());
+ *
+ * collectAll() gets all the results, or rethrows the exception of the first
+ * Task (in argument order) that failed, once all have finished.  Void Tasks
+ * produce a Unit.
+ *
+ * collectAny() gets the index and result of the first Task to finish.  It
+ * still waits for all of the others before it returns, since they may
+ * refer to the caller's frame; their results are dropped.
+ *
+ * Each Task is started through the executor, so they interleave even on a
+ * single-threaded executor, and run in parallel on a thread pool.
+ */
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+namespace detail {
+
+// Resumes the coroutine in arriveAndWait() once count arrive()s happened
+class CollectBarrier {
+ public:
+  explicit CollectBarrier(size_t count) noexcept : count_(count + 1) {}
+
+  void arrive() noexcept {
+    if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      continuation_.resume();
+    }
+  }
+
+  auto arriveAndWait() noexcept {
+    class Awaiter {
+     public:
+      explicit Awaiter(CollectBarrier& barrier) noexcept : barrier_(barrier) {}
+
+      bool await_ready() noexcept {
+        return false;
+      }
+
+      bool await_suspend(coroutine_handle<> h) noexcept {
+        barrier_.continuation_ = h;
+        // The last one to arrive resumes h; don't suspend if it's us
+        return barrier_.count_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+      }
+
+      void await_resume() noexcept {}
+
+     private:
+      CollectBarrier& barrier_;
+    };
+    return Awaiter(*this);
+  }
+
+ private:
+  std::atomic<size_t> count_;
+  coroutine_handle<> continuation_;
+};
+
+template <typename T>
+DetachedTask collectStart(
+    Task<T> task,
+    Executor* executor,
+    Try<T>& result,
+    CollectBarrier& barrier) {
+  result = co_await std::move(task).scheduleOn(executor).co_awaitTry();
+  barrier.arrive();
+}
+
+constexpr size_t kCollectNone = ~size_t(0);
+
+template <typename T>
+DetachedTask collectAnyStart(
+    Task<T> task,
+    Executor* executor,
+    size_t index,
+    std::atomic<size_t>& first,
+    Try<T>& result,
+    CollectBarrier& barrier) {
+  auto r = co_await std::move(task).scheduleOn(executor).co_awaitTry();
+  auto none = kCollectNone;
+  if (first.compare_exchange_strong(
+          none, index, std::memory_order_relaxed, std::memory_order_relaxed)) {
+    result = std::move(r);
+  }
+  barrier.arrive();
+}
+
+template <typename T>
+Unit::LiftT<T> collectValue(Try<T>&& result) {
+  return std::move(result).value();
+}
+
+inline Unit collectValue(Try<void>&& result) {
+  result.throwIfFailed();
+  return unit;
+}
+
+template <typename... Ts, size_t... Is>
+Task<std::tuple<Unit::LiftT<Ts>...>> collectAllImpl(
+    index_sequence<Is...>,
+    Task<Ts>... tasks) {
+  auto executor = co_await co_current_executor;
+  std::tuple<Try<Ts>...> results;
+  CollectBarrier barrier(sizeof...(Ts));
+  (void)std::initializer_list<int>{
+      (collectStart(
+           std::move(tasks), executor, std::get<Is>(results), barrier),
+       0)...};
+  co_await barrier.arriveAndWait();
+  co_return std::tuple<Unit::LiftT<Ts>...>(
+      collectValue(std::move(std::get<Is>(results)))...);
+}
+
+} // namespace detail
+
+template <typename... Ts>
+Task<std::tuple<Unit::LiftT<Ts>...>> collectAll(Task<Ts>... tasks) {
+  return detail::collectAllImpl(
+      make_index_sequence<sizeof...(Ts)>{}, std::move(tasks)...);
+}
+
+template <typename T>
+Task<std::vector<Unit::LiftT<T>>> collectAll(std::vector<Task<T>> tasks) {
+  auto executor = co_await co_current_executor;
+  std::vector<Try<T>> results(tasks.size());
+  detail::CollectBarrier barrier(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    detail::collectStart(std::move(tasks[i]), executor, results[i], barrier);
+  }
+  co_await barrier.arriveAndWait();
+
+  std::vector<Unit::LiftT<T>> values;
+  values.reserve(results.size());
+  for (auto& result : results) {
+    values.push_back(detail::collectValue(std::move(result)));
+  }
+  co_return values;
+}
+
+template <typename T>
+Task<std::pair<size_t, Try<T>>> collectAny(std::vector<Task<T>> tasks) {
+  if (tasks.empty()) {
+    throw std::invalid_argument("collectAny() of no Tasks");
+  }
+  auto executor = co_await co_current_executor;
+  std::atomic<size_t> first{detail::kCollectNone};
+  Try<T> result;
+  detail::CollectBarrier barrier(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    detail::collectAnyStart(
+        std::move(tasks[i]), executor, i, first, result, barrier);
+  }
+  co_await barrier.arriveAndWait();
+  co_return std::make_pair(
+      first.load(std::memory_order_relaxed), std::move(result));
+}
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
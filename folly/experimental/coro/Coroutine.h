@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include <folly/Portability.h>
+
+/**
+ * The coroutine support library folly::coro is built on, from either C++20
+ * (<coroutine>) or the Coroutines TS (<experimental/coroutine>).  Everything
+ * in folly/experimental/coro is empty unless FOLLY_HAS_CORO is 1.
+ */
+
+#if FOLLY_HAS_STD_COROUTINES
+#include <coroutine>
+#define FOLLY_HAS_CORO 1
+#elif FOLLY_HAS_COROUTINES
+#include <experimental/coroutine>
+#define FOLLY_HAS_CORO 1
+#else
+#define FOLLY_HAS_CORO 0
+#endif
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+
+#if FOLLY_HAS_STD_COROUTINES
+using std::coroutine_handle;
+using std::suspend_always;
+using std::suspend_never;
+#else
+using std::experimental::coroutine_handle;
+using std::experimental::suspend_always;
+using std::experimental::suspend_never;
+#endif
+
+namespace detail {
+
+template <int N>
+struct AwaiterPriority : AwaiterPriority<N - 1> {};
+template <>
+struct AwaiterPriority<0> {};
+
+template <typename Awaitable>
+auto getAwaiter(Awaitable&& awaitable, AwaiterPriority<2>)
+    -> decltype(static_cast<Awaitable&&>(awaitable).operator co_await()) {
+  return static_cast<Awaitable&&>(awaitable).operator co_await();
+}
+
+template <typename Awaitable>
+auto getAwaiter(Awaitable&& awaitable, AwaiterPriority<1>)
+    -> decltype(operator co_await(static_cast<Awaitable&&>(awaitable))) {
+  return operator co_await(static_cast<Awaitable&&>(awaitable));
+}
+
+template <typename Awaitable>
+Awaitable&& getAwaiter(Awaitable&& awaitable, AwaiterPriority<0>) {
+  return static_cast<Awaitable&&>(awaitable);
+}
+
+} // namespace detail
+
+/**
+ * What `co_await awaitable` calls await_ready() etc. on, outside of any
+ * await_transform(): the result of its operator co_await, member or free,
+ * or the awaitable itself.
+ */
+template <typename Awaitable>
+auto get_awaiter(Awaitable&& awaitable) -> decltype(detail::getAwaiter(
+    static_cast<Awaitable&&>(awaitable),
+    detail::AwaiterPriority<2>{})) {
+  return detail::getAwaiter(
+      static_cast<Awaitable&&>(awaitable), detail::AwaiterPriority<2>{});
+}
+
+template <typename Awaitable>
+using awaiter_type_t = decltype(get_awaiter(std::declval<Awaitable>()));
+
+/** The type of `co_await std::declval<Awaitable>()` */
+template <typename Awaitable>
+using await_result_t = decltype(
+    std::declval<std::add_lvalue_reference_t<awaiter_type_t<Awaitable>>>()
+        .await_resume());
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
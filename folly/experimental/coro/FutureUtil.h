@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utility>
+
+#include <folly/Try.h>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/experimental/coro/Coroutine.h>
+#include <folly/futures/Future.h>
+
+/**
+ * Makes Future<T> and SemiFuture<T> awaitable, with a T result (or the
+ * exception rethrown).  The awaiting coroutine is resumed on the thread
+ * that fulfills the future, unless it's a Task: Tasks get back to their
+ * executor (see Task.h).
+ *
+ *   Task<std::string> fetch(Key key) {
+ *     auto value = co_await client.get(key); // returns a Future
+ *     co_return value.toString();
+ *   }
+ *
+ * The other way around, TaskWithExecutor::start() returns a SemiFuture.
+ */
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+namespace detail {
+
+template <typename T>
+class FutureAwaiter {
+ public:
+  explicit FutureAwaiter(Future<T>&& future) noexcept
+      : future_(std::move(future)) {}
+
+  bool await_ready() {
+    if (future_.isReady()) {
+      result_ = std::move(future_.getTry());
+      return true;
+    }
+    return false;
+  }
+
+  void await_suspend(coroutine_handle<> h) {
+    // The callback may run before setCallback_ returns
+    future_.setCallback_([this, h](Try<T>&& result) mutable {
+      result_ = std::move(result);
+      h.resume();
+    });
+  }
+
+  T await_resume() {
+    return std::move(result_).value();
+  }
+
+ private:
+  Future<T> future_;
+  Try<T> result_;
+};
+
+} // namespace detail
+} // namespace coro
+
+template <typename T>
+coro::detail::FutureAwaiter<T> operator co_await(Future<T>&& future) noexcept {
+  return coro::detail::FutureAwaiter<T>(std::move(future));
+}
+
+template <typename T>
+coro::detail::FutureAwaiter<T> operator co_await(SemiFuture<T>&& future) {
+  // Deferred work, if any, runs where the future is fulfilled
+  return coro::detail::FutureAwaiter<T>(
+      std::move(future).via(&InlineExecutor::instance()));
+}
+
+} // namespace folly
+#endif // FOLLY_HAS_CORO
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Mutex.h>
+
+#if FOLLY_HAS_CORO
+#include <glog/logging.h>
+
+namespace folly {
+namespace coro {
+
+Mutex::~Mutex() {
+  DCHECK(state_.load(std::memory_order_relaxed) == unlocked());
+  DCHECK(waiters_ == nullptr);
+}
+
+void Mutex::unlock() noexcept {
+  DCHECK(state_.load(std::memory_order_relaxed) != unlocked());
+
+  auto head = waiters_;
+  if (head == nullptr) {
+    auto old = state_.load(std::memory_order_relaxed);
+    if (old == nullptr &&
+        state_.compare_exchange_strong(
+            old,
+            unlocked(),
+            std::memory_order_release,
+            std::memory_order_relaxed)) {
+      return;
+    }
+
+    // Take the new waiters, which are newest first
+    old = state_.exchange(nullptr, std::memory_order_acquire);
+    DCHECK(old != nullptr && old != unlocked());
+    auto waiter = static_cast<LockOperation*>(const_cast<void*>(old));
+    do {
+      auto next = waiter->next_;
+      waiter->next_ = head;
+      head = waiter;
+      waiter = next;
+    } while (waiter);
+  }
+
+  // Hand the lock over to the first waiter
+  waiters_ = head->next_;
+  head->awaitingCoroutine_.resume();
+}
+
+bool Mutex::lockAsyncImpl(LockOperation* awaiter) noexcept {
+  auto old = state_.load(std::memory_order_relaxed);
+  while (true) {
+    if (old == unlocked()) {
+      if (state_.compare_exchange_weak(
+              old,
+              nullptr,
+              std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return false;
+      }
+    } else {
+      awaiter->next_ = static_cast<LockOperation*>(const_cast<void*>(old));
+      if (state_.compare_exchange_weak(
+              old,
+              static_cast<const void*>(awaiter),
+              std::memory_order_release,
+              std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+}
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
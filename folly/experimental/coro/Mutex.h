@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+
+/**
+ * A mutex that coroutines wait for without blocking their thread.
+ *
+ *   Mutex m;
+ *
+ *   Task<void> increment() {
+ *     auto lock = co_await m.co_scoped_lock();
+ *     ++counter;
+ *   }
+ *
+ * or co_await m.co_lock() and m.unlock().  Waiters get the mutex in FIFO
+ * order.  unlock() resumes the next waiter inline, before it returns; a
+ * waiting Task gets back to its executor instead (see Task.h).  Unlike
+ * std::mutex, it may be unlocked on another thread than the one that
+ * locked it.
+ *
+ * Taking an uncontended lock is an uncontended CAS, like std::mutex.
+ */
+class Mutex {
+  class LockOperation {
+   public:
+    explicit LockOperation(Mutex& mutex) noexcept : mutex_(mutex) {}
+
+    bool await_ready() noexcept {
+      return mutex_.try_lock();
+    }
+
+    bool await_suspend(coroutine_handle<> awaitingCoroutine) noexcept {
+      awaitingCoroutine_ = awaitingCoroutine;
+      return mutex_.lockAsyncImpl(this);
+    }
+
+    void await_resume() noexcept {}
+
+   protected:
+    friend class Mutex;
+
+    Mutex& mutex_;
+
+   private:
+    coroutine_handle<> awaitingCoroutine_;
+    LockOperation* next_{nullptr};
+  };
+
+  class ScopedLockOperation : public LockOperation {
+   public:
+    using LockOperation::LockOperation;
+
+    std::unique_lock<Mutex> await_resume() noexcept {
+      return std::unique_lock<Mutex>(mutex_, std::adopt_lock);
+    }
+  };
+
+ public:
+  Mutex() noexcept : state_(unlocked()) {}
+
+  Mutex(const Mutex&) = delete;
+  Mutex& operator=(const Mutex&) = delete;
+
+  ~Mutex();
+
+  bool try_lock() noexcept {
+    auto old = unlocked();
+    return state_.compare_exchange_strong(
+        old, nullptr, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  /** co_await m.co_lock() locks m */
+  LockOperation co_lock() noexcept {
+    return LockOperation(*this);
+  }
+
+  /** co_await m.co_scoped_lock() locks m, in a std::unique_lock<Mutex> */
+  ScopedLockOperation co_scoped_lock() noexcept {
+    return ScopedLockOperation(*this);
+  }
+
+  void unlock() noexcept;
+
+ private:
+  const void* unlocked() const noexcept {
+    return this;
+  }
+
+  // Returns false, to not suspend, if the mutex was acquired
+  bool lockAsyncImpl(LockOperation* awaiter) noexcept;
+
+  // unlocked() if unlocked, nullptr if locked with no new waiters, and the
+  // last new waiter otherwise: a stack through next_
+  std::atomic<const void*> state_;
+  // FIFO of the waiters moved from state_, only accessed with the lock held
+  LockOperation* waiters_{nullptr};
+};
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <exception>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <folly/Executor.h>
+#include <folly/Portability.h>
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/experimental/coro/Coroutine.h>
+#include <folly/experimental/coro/FutureUtil.h>
+#include <folly/experimental/coro/ViaIfAsync.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+
+/**
+ * folly::coro::Task<T> is a lazily started coroutine producing a T, bound
+ * to an executor when it is awaited.
+ *
+ *   Task<int> getValue(Key key);
+ *
+ *   Task<int> sum(Key a, Key b) {
+ *     auto x = co_await getValue(a);
+ *     auto y = co_await getValue(b);
+ *     co_return x + y;
+ *   }
+ *
+ *   // from non-coroutine code
+ *   SemiFuture<int> f = sum(a, b).scheduleOn(executor).start();
+ *   int s = blockingWait(sum(a, b).scheduleOn(executor));
+ *
+ * Nothing runs until a Task is awaited.  A Task awaited by another Task
+ * runs on the awaiting Task's executor, and the two transfer control
+ * directly to each other (symmetric transfer): no allocation besides the
+ * coroutine frame, no executor hop and no stack growth per call.
+ *
+ * Everything else a Task awaits (futures, Baton, Mutex, a Task scheduled
+ * elsewhere with scheduleOn()...) is wrapped in co_viaIfAsync(), so if the
+ * Task has to suspend it is resumed on its own executor.  A top-level Task
+ * must be given an executor with scheduleOn().
+ *
+ * Tasks are move-only, and awaited as rvalues, once.
+ *
+ * Requires C++20 coroutines or the Coroutines TS, see Coroutine.h.
+ */
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+
+template <typename T = void>
+class Task;
+
+template <typename T = void>
+class TaskWithExecutor;
+
+/** co_await co_current_executor gets the executor of the awaiting Task */
+struct co_current_executor_t {};
+constexpr co_current_executor_t co_current_executor{};
+
+namespace detail {
+
+template <typename T>
+class TaskAwaiter;
+template <typename T>
+class TaskWithExecutorAwaiter;
+
+class TaskPromiseBase {
+  class FinalAwaiter {
+   public:
+    bool await_ready() noexcept {
+      return false;
+    }
+
+    template <typename Promise>
+    coroutine_handle<> await_suspend(coroutine_handle<Promise> h) noexcept {
+      return h.promise().continuation_;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  class CurrentExecutorAwaiter {
+   public:
+    explicit CurrentExecutorAwaiter(Executor* executor) noexcept
+        : executor_(executor) {}
+
+    bool await_ready() noexcept {
+      return true;
+    }
+
+    void await_suspend(coroutine_handle<>) noexcept {}
+
+    Executor* await_resume() noexcept {
+      return executor_;
+    }
+
+   private:
+    Executor* executor_;
+  };
+
+ public:
+  suspend_always initial_suspend() noexcept {
+    return {};
+  }
+
+  FinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+
+  template <typename U>
+  auto await_transform(Task<U>&& task) noexcept;
+
+  template <typename Awaitable>
+  auto await_transform(Awaitable&& awaitable) {
+    return co_viaIfAsync(executor_, static_cast<Awaitable&&>(awaitable));
+  }
+
+  CurrentExecutorAwaiter await_transform(co_current_executor_t) noexcept {
+    return CurrentExecutorAwaiter(executor_);
+  }
+
+ protected:
+  template <typename>
+  friend class folly::coro::Task;
+  template <typename>
+  friend class folly::coro::TaskWithExecutor;
+  template <typename>
+  friend class TaskAwaiter;
+  template <typename>
+  friend class TaskWithExecutorAwaiter;
+
+  coroutine_handle<> continuation_;
+  Executor* executor_{nullptr};
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  template <typename U>
+  void return_value(U&& value) {
+    result_ = Try<T>(in_place, static_cast<U&&>(value));
+  }
+
+  void unhandled_exception() noexcept {
+    result_ = Try<T>(
+        exception_wrapper::from_exception_ptr(std::current_exception()));
+  }
+
+  Try<T>& result() noexcept {
+    return result_;
+  }
+
+ private:
+  Try<T> result_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+
+  void return_void() noexcept {}
+
+  void unhandled_exception() noexcept {
+    result_ = Try<void>(
+        exception_wrapper::from_exception_ptr(std::current_exception()));
+  }
+
+  Try<void>& result() noexcept {
+    return result_;
+  }
+
+ private:
+  Try<void> result_;
+};
+
+// Resumes the awaiting coroutine with the Task's result, or rethrows
+template <typename T>
+class TaskAwaiter {
+ public:
+  using Handle = coroutine_handle<TaskPromise<T>>;
+
+  explicit TaskAwaiter(Handle coro) noexcept : coro_(coro) {}
+
+  TaskAwaiter(TaskAwaiter&& other) noexcept
+      : coro_(std::exchange(other.coro_, {})) {}
+
+  TaskAwaiter& operator=(TaskAwaiter&&) = delete;
+
+  ~TaskAwaiter() {
+    if (coro_) {
+      coro_.destroy();
+    }
+  }
+
+  bool await_ready() noexcept {
+    return false;
+  }
+
+  coroutine_handle<> await_suspend(coroutine_handle<> continuation) noexcept {
+    coro_.promise().continuation_ = continuation;
+    return coro_;
+  }
+
+  T await_resume() {
+    return std::move(coro_.promise().result()).value();
+  }
+
+ protected:
+  Handle coro_;
+};
+
+// Starts the Task on its executor instead of transferring to it
+template <typename T>
+class TaskWithExecutorAwaiter : public TaskAwaiter<T> {
+ public:
+  using TaskAwaiter<T>::TaskAwaiter;
+
+  void await_suspend(coroutine_handle<> continuation) {
+    auto& promise = this->coro_.promise();
+    promise.continuation_ = continuation;
+    promise.executor_->add([coro = this->coro_]() mutable { coro.resume(); });
+  }
+};
+
+template <typename T>
+class TaskWithExecutorTryAwaiter : public TaskWithExecutorAwaiter<T> {
+ public:
+  using TaskWithExecutorAwaiter<T>::TaskWithExecutorAwaiter;
+
+  Try<T> await_resume() noexcept {
+    return std::move(this->coro_.promise().result());
+  }
+};
+
+// A coroutine nobody waits for, that frees itself when done
+class DetachedTask {
+ public:
+  class promise_type {
+   public:
+    DetachedTask get_return_object() noexcept {
+      return {};
+    }
+
+    suspend_never initial_suspend() noexcept {
+      return {};
+    }
+
+    suspend_never final_suspend() noexcept {
+      return {};
+    }
+
+    void return_void() noexcept {}
+
+    [[noreturn]] void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+inline Try<Unit> liftTry(Try<void>&& t) {
+  if (t.hasException()) {
+    return Try<Unit>(std::move(t.exception()));
+  }
+  return Try<Unit>(unit);
+}
+
+template <typename T>
+Try<T> liftTry(Try<T>&& t) {
+  return std::move(t);
+}
+
+template <typename T>
+DetachedTask startDetached(
+    TaskWithExecutor<T> task,
+    Promise<Unit::LiftT<T>> promise) {
+  promise.setTry(liftTry(co_await std::move(task).co_awaitTry()));
+}
+
+} // namespace detail
+
+template <typename T>
+class FOLLY_NODISCARD Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+  using value_type = T;
+
+  Task(Task&& other) noexcept : coro_(std::exchange(other.coro_, {})) {}
+
+  Task& operator=(Task other) noexcept {
+    std::swap(coro_, other.coro_);
+    return *this;
+  }
+
+  Task(const Task&) = delete;
+
+  ~Task() {
+    if (coro_) {
+      coro_.destroy();
+    }
+  }
+
+  /**
+   * Bind to executor, to start or await from outside of the Task's own
+   * executor.
+   */
+  TaskWithExecutor<T> scheduleOn(Executor* executor) && {
+    DCHECK(coro_);
+    coro_.promise().executor_ = executor;
+    return TaskWithExecutor<T>(std::exchange(coro_, {}));
+  }
+
+ private:
+  friend class detail::TaskPromiseBase;
+  friend class detail::TaskPromise<T>;
+
+  using Handle = coroutine_handle<promise_type>;
+
+  explicit Task(Handle coro) noexcept : coro_(coro) {}
+
+  Handle coro_;
+};
+
+/**
+ * A Task bound to an executor.  Awaiting it starts it on that executor;
+ * an awaiting Task is resumed on its own executor once it's done.
+ */
+template <typename T>
+class FOLLY_NODISCARD TaskWithExecutor {
+ public:
+  using value_type = T;
+
+  TaskWithExecutor(TaskWithExecutor&& other) noexcept
+      : coro_(std::exchange(other.coro_, {})) {}
+
+  TaskWithExecutor& operator=(TaskWithExecutor other) noexcept {
+    std::swap(coro_, other.coro_);
+    return *this;
+  }
+
+  TaskWithExecutor(const TaskWithExecutor&) = delete;
+
+  ~TaskWithExecutor() {
+    if (coro_) {
+      coro_.destroy();
+    }
+  }
+
+  Executor* executor() const noexcept {
+    return coro_.promise().executor_;
+  }
+
+  /**
+   * Run the Task on its executor, from non-coroutine code.  Void Tasks
+   * fulfill a SemiFuture<Unit>.
+   */
+  SemiFuture<Unit::LiftT<T>> start() && {
+    Promise<Unit::LiftT<T>> promise;
+    auto future = promise.getFuture().semi();
+    detail::startDetached(std::move(*this), std::move(promise));
+    return future;
+  }
+
+  detail::TaskWithExecutorAwaiter<T> operator co_await() && noexcept {
+    DCHECK(coro_);
+    return detail::TaskWithExecutorAwaiter<T>(std::exchange(coro_, {}));
+  }
+
+  /** co_await task.co_awaitTry() gets a Try<T> instead of rethrowing */
+  auto co_awaitTry() && noexcept {
+    struct TryAwaitable {
+      detail::TaskWithExecutorTryAwaiter<T> operator co_await() && noexcept {
+        return std::move(awaiter);
+      }
+      detail::TaskWithExecutorTryAwaiter<T> awaiter;
+    };
+    DCHECK(coro_);
+    return TryAwaitable{
+        detail::TaskWithExecutorTryAwaiter<T>(std::exchange(coro_, {}))};
+  }
+
+ private:
+  friend class Task<T>;
+
+  using Handle = coroutine_handle<detail::TaskPromise<T>>;
+
+  explicit TaskWithExecutor(Handle coro) noexcept : coro_(coro) {}
+
+  Handle coro_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template <typename U>
+auto TaskPromiseBase::await_transform(Task<U>&& task) noexcept {
+  DCHECK(task.coro_);
+  task.coro_.promise().executor_ = executor_;
+  return TaskAwaiter<U>(std::exchange(task.coro_, {}));
+}
+
+} // namespace detail
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <folly/Executor.h>
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_CORO
+namespace folly {
+namespace coro {
+namespace detail {
+
+/**
+ * A coroutine that, when resumed, schedules the resumption of another
+ * coroutine on an executor.  Awaiters are resumed through it instead of
+ * the awaiting coroutine itself.
+ */
+class ViaCoroutine {
+ public:
+  class promise_type {
+   public:
+    ViaCoroutine get_return_object() noexcept {
+      return ViaCoroutine(
+          coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    suspend_always initial_suspend() noexcept {
+      return {};
+    }
+
+    auto final_suspend() noexcept {
+      struct Awaiter {
+        bool await_ready() noexcept {
+          return false;
+        }
+        void await_suspend(coroutine_handle<promise_type> h) noexcept {
+          // The awaiter, and therefore this coroutine, may be destroyed as
+          // soon as the continuation runs
+          auto& promise = h.promise();
+          promise.executor_->add(
+              [continuation = promise.continuation_]() mutable {
+                continuation.resume();
+              });
+        }
+        void await_resume() noexcept {}
+      };
+      return Awaiter{};
+    }
+
+    void return_void() noexcept {}
+
+    [[noreturn]] void unhandled_exception() noexcept {
+      std::terminate();
+    }
+
+   private:
+    friend class ViaCoroutine;
+
+    Executor* executor_{nullptr};
+    coroutine_handle<> continuation_;
+  };
+
+  static ViaCoroutine create(Executor* executor, coroutine_handle<> h);
+
+  ViaCoroutine() noexcept = default;
+
+  ViaCoroutine(ViaCoroutine&& other) noexcept
+      : coro_(std::exchange(other.coro_, {})) {}
+
+  ViaCoroutine& operator=(ViaCoroutine&& other) noexcept {
+    std::swap(coro_, other.coro_);
+    return *this;
+  }
+
+  ~ViaCoroutine() {
+    if (coro_) {
+      coro_.destroy();
+    }
+  }
+
+  coroutine_handle<> getHandle() noexcept {
+    return coro_;
+  }
+
+ private:
+  explicit ViaCoroutine(coroutine_handle<promise_type> coro) noexcept
+      : coro_(coro) {}
+
+  static ViaCoroutine createImpl() {
+    co_return;
+  }
+
+  coroutine_handle<promise_type> coro_;
+};
+
+inline ViaCoroutine ViaCoroutine::create(
+    Executor* executor,
+    coroutine_handle<> h) {
+  auto via = createImpl();
+  via.coro_.promise().executor_ = executor;
+  via.coro_.promise().continuation_ = h;
+  return via;
+}
+
+} // namespace detail
+
+/**
+ * Awaits Awaitable, and resumes the awaiting coroutine on executor if it
+ * had to suspend.  Returned by co_viaIfAsync().
+ */
+template <typename Awaitable>
+class ViaIfAsyncAwaiter {
+  using Awaiter = awaiter_type_t<Awaitable>;
+  // An awaitable that is its own awaiter is kept by value, unless it's an
+  // lvalue
+  using Storage = std::conditional_t<
+      std::is_rvalue_reference<Awaiter>::value,
+      std::remove_reference_t<Awaiter>,
+      Awaiter>;
+
+ public:
+  ViaIfAsyncAwaiter(Executor* executor, Awaitable&& awaitable)
+      : executor_(executor),
+        awaiter_(get_awaiter(static_cast<Awaitable&&>(awaitable))) {
+    DCHECK(executor_);
+  }
+
+  bool await_ready() {
+    return awaiter_.await_ready();
+  }
+
+  template <typename Promise>
+  auto await_suspend(coroutine_handle<Promise> h) {
+    via_ = detail::ViaCoroutine::create(executor_, h);
+    return awaiter_.await_suspend(via_.getHandle());
+  }
+
+  decltype(auto) await_resume() {
+    return awaiter_.await_resume();
+  }
+
+ private:
+  Executor* executor_;
+  Storage awaiter_;
+  detail::ViaCoroutine via_;
+};
+
+/**
+ * co_await co_viaIfAsync(executor, awaitable) is co_await awaitable, except
+ * that if the awaiting coroutine is suspended, it is resumed on executor
+ * rather than on whatever thread completed awaitable.  Coroutines that
+ * await it without suspending keep running where they are.
+ *
+ * Task applies it to everything it awaits, except other Tasks, so that a
+ * Task always runs on its executor.
+ */
+template <typename Awaitable>
+ViaIfAsyncAwaiter<Awaitable> co_viaIfAsync(
+    Executor* executor,
+    Awaitable&& awaitable) {
+  return ViaIfAsyncAwaiter<Awaitable>(
+      executor, static_cast<Awaitable&&>(awaitable));
+}
+
+} // namespace coro
+} // namespace folly
+#endif // FOLLY_HAS_CORO
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Baton.h>
+
+#include <thread>
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/experimental/coro/Task.h>
+#include <folly/portability/GTest.h>
+
+#if FOLLY_HAS_CORO
+using folly::ManualExecutor;
+using namespace folly::coro;
+
+namespace {
+
+Task<void> waitAndCount(Baton& baton, int& count) {
+  co_await baton;
+  ++count;
+}
+
+} // namespace
+
+TEST(Baton, Ready) {
+  Baton b;
+  EXPECT_FALSE(b.ready());
+  b.post();
+  EXPECT_TRUE(b.ready());
+  b.reset();
+  EXPECT_FALSE(b.ready());
+
+  Baton posted(true);
+  EXPECT_TRUE(posted.ready());
+}
+
+TEST(Baton, WaitPosted) {
+  Baton b(true);
+  int count = 0;
+  blockingWait(waitAndCount(b, count));
+  EXPECT_EQ(1, count);
+}
+
+TEST(Baton, ManyWaiters) {
+  ManualExecutor executor;
+  Baton b;
+  int count = 0;
+  auto f1 = waitAndCount(b, count).scheduleOn(&executor).start();
+  auto f2 = waitAndCount(b, count).scheduleOn(&executor).start();
+  executor.run();
+  EXPECT_EQ(0, count);
+  b.post();
+  // The waiters get back to their executor
+  EXPECT_EQ(0, count);
+  executor.run();
+  EXPECT_EQ(2, count);
+  EXPECT_TRUE(f1.isReady());
+  EXPECT_TRUE(f2.isReady());
+}
+
+TEST(Baton, PostFromOtherThread) {
+  Baton b;
+  int count = 0;
+  std::thread t([&] { b.post(); });
+  blockingWait(waitAndCount(b, count));
+  t.join();
+  EXPECT_EQ(1, count);
+}
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Collect.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/coro/Baton.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/portability/GTest.h>
+
+#if FOLLY_HAS_CORO
+using folly::CPUThreadPoolExecutor;
+using namespace folly::coro;
+
+namespace {
+
+Task<int> value(int v) {
+  co_return v;
+}
+
+Task<void> waitFor(Baton& baton, int& done) {
+  co_await baton;
+  ++done;
+}
+
+Task<int> fails() {
+  throw std::runtime_error("fails");
+  co_return 0;
+}
+
+} // namespace
+
+TEST(Collect, CollectAllTuple) {
+  auto task = []() -> Task<void> {
+    auto r = co_await collectAll(
+        value(1), []() -> Task<std::string> { co_return "two"; }());
+    EXPECT_EQ(1, std::get<0>(r));
+    EXPECT_EQ("two", std::get<1>(r));
+  };
+  blockingWait(task());
+}
+
+TEST(Collect, CollectAllRunsConcurrently) {
+  // The first Task can't finish before the second one started
+  auto task = []() -> Task<void> {
+    Baton baton;
+    int done = 0;
+    auto post = [&]() -> Task<void> {
+      baton.post();
+      co_return;
+    };
+    auto r = co_await collectAll(waitFor(baton, done), post());
+    EXPECT_EQ(1, done);
+    (void)r;
+  };
+  blockingWait(task());
+}
+
+TEST(Collect, CollectAllVector) {
+  CPUThreadPoolExecutor pool(4);
+  auto task = []() -> Task<int> {
+    std::vector<Task<int>> tasks;
+    for (int i = 0; i < 100; ++i) {
+      tasks.push_back(value(i));
+    }
+    auto values = co_await collectAll(std::move(tasks));
+    int sum = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+      EXPECT_EQ(int(i), values[i]);
+      sum += values[i];
+    }
+    co_return sum;
+  };
+  EXPECT_EQ(4950, blockingWait(task().scheduleOn(&pool)));
+}
+
+TEST(Collect, CollectAllException) {
+  auto task = []() -> Task<void> {
+    co_await collectAll(value(1), fails());
+  };
+  EXPECT_THROW(blockingWait(task()), std::runtime_error);
+}
+
+TEST(Collect, CollectAny) {
+  auto task = []() -> Task<void> {
+    Baton baton;
+    int done = 0;
+    // Lambdas must outlive their coroutines
+    auto waits = [&]() -> Task<int> {
+      co_await baton;
+      ++done;
+      co_return 0;
+    };
+    auto posts = [&]() -> Task<int> {
+      // Let the other one finish once this one did
+      baton.post();
+      co_return 1;
+    };
+    std::vector<Task<int>> tasks;
+    tasks.push_back(waits());
+    tasks.push_back(posts());
+    auto r = co_await collectAny(std::move(tasks));
+    EXPECT_EQ(1, r.first);
+    EXPECT_EQ(1, r.second.value());
+    // All of them finished
+    EXPECT_EQ(1, done);
+  };
+  blockingWait(task());
+}
+
+TEST(Collect, CollectAnyException) {
+  auto task = []() -> Task<void> {
+    std::vector<Task<int>> tasks;
+    tasks.push_back(fails());
+    auto r = co_await collectAny(std::move(tasks));
+    EXPECT_EQ(0, r.first);
+    EXPECT_TRUE(r.second.hasException());
+  };
+  blockingWait(task());
+}
+#endif
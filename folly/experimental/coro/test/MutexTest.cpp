@@ -0,0 +1,100 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Mutex.h>
+
+#include <vector>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/experimental/coro/Collect.h>
+#include <folly/experimental/coro/Task.h>
+#include <folly/portability/GTest.h>
+
+#if FOLLY_HAS_CORO
+using namespace folly;
+using namespace folly::coro;
+
+TEST(Mutex, TryLock) {
+  Mutex m;
+  EXPECT_TRUE(m.try_lock());
+  EXPECT_FALSE(m.try_lock());
+  m.unlock();
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
+
+TEST(Mutex, Fifo) {
+  ManualExecutor executor;
+  Mutex m;
+  std::vector<int> order;
+  auto locker = [&](int i) -> Task<void> {
+    co_await m.co_lock();
+    order.push_back(i);
+    m.unlock();
+  };
+
+  ASSERT_TRUE(m.try_lock());
+  std::vector<SemiFuture<Unit>> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures.push_back(locker(i).scheduleOn(&executor).start());
+    executor.run();
+  }
+  EXPECT_TRUE(order.empty());
+  m.unlock();
+  executor.drain();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+  for (auto& f : futures) {
+    EXPECT_TRUE(f.isReady());
+  }
+}
+
+TEST(Mutex, ScopedLock) {
+  Mutex m;
+  auto task = [&]() -> Task<void> {
+    {
+      auto lock = co_await m.co_scoped_lock();
+      EXPECT_TRUE(lock.owns_lock());
+      EXPECT_FALSE(m.try_lock());
+    }
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+  };
+  blockingWait(task());
+}
+
+TEST(Mutex, Stress) {
+  CPUThreadPoolExecutor pool(4);
+  Mutex m;
+  int counter = 0;
+  auto increment = [&]() -> Task<void> {
+    for (int i = 0; i < 100; ++i) {
+      auto lock = co_await m.co_scoped_lock();
+      ++counter;
+    }
+  };
+  auto task = [&]() -> Task<void> {
+    std::vector<Task<void>> tasks;
+    for (int i = 0; i < 50; ++i) {
+      tasks.push_back(increment());
+    }
+    co_await collectAll(std::move(tasks));
+  };
+  blockingWait(task().scheduleOn(&pool));
+  EXPECT_EQ(5000, counter);
+}
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Task.h>
+
+#include <stdexcept>
+#include <thread>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/futures/Future.h>
+#include <folly/portability/GTest.h>
+
+#if FOLLY_HAS_CORO
+using namespace folly;
+using namespace folly::coro;
+
+namespace {
+
+Task<int> fortyTwo() {
+  co_return 42;
+}
+
+Task<int> addOne(int depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await addOne(depth - 1);
+}
+
+Task<void> throws() {
+  throw std::runtime_error("boom");
+  co_return;
+}
+
+Task<Executor*> currentExecutor() {
+  co_return co_await co_current_executor;
+}
+
+} // namespace
+
+TEST(Task, Lazy) {
+  bool started = false;
+  auto lambda = [&]() -> Task<int> {
+    started = true;
+    co_return 1;
+  };
+  auto task = lambda();
+  EXPECT_FALSE(started);
+  EXPECT_EQ(1, blockingWait(std::move(task)));
+  EXPECT_TRUE(started);
+}
+
+TEST(Task, AwaitTask) {
+  auto task = []() -> Task<int> {
+    auto x = co_await fortyTwo();
+    co_return x + 1;
+  };
+  EXPECT_EQ(43, blockingWait(task()));
+}
+
+TEST(Task, DeepRecursion) {
+  // Nested Tasks transfer control to each other without executor hops
+  EXPECT_EQ(10000, blockingWait(addOne(10000)));
+}
+
+TEST(Task, Exception) {
+  EXPECT_THROW(blockingWait(throws()), std::runtime_error);
+
+  auto caught = []() -> Task<bool> {
+    try {
+      co_await throws();
+    } catch (const std::runtime_error&) {
+      co_return true;
+    }
+    co_return false;
+  };
+  EXPECT_TRUE(blockingWait(caught()));
+}
+
+TEST(Task, MoveOnly) {
+  auto task = []() -> Task<std::unique_ptr<int>> {
+    co_return std::make_unique<int>(7);
+  };
+  EXPECT_EQ(7, *blockingWait(task()));
+}
+
+TEST(Task, ScheduleOn) {
+  CPUThreadPoolExecutor pool(2);
+  auto task = []() -> Task<std::thread::id> {
+    co_return std::this_thread::get_id();
+  };
+  EXPECT_NE(
+      std::this_thread::get_id(), blockingWait(task().scheduleOn(&pool)));
+  EXPECT_EQ(&pool, blockingWait(currentExecutor().scheduleOn(&pool)));
+}
+
+TEST(Task, Start) {
+  ManualExecutor executor;
+  auto future = fortyTwo().scheduleOn(&executor).start();
+  EXPECT_FALSE(future.isReady());
+  executor.run();
+  EXPECT_TRUE(future.isReady());
+  EXPECT_EQ(42, std::move(future).get());
+
+  auto failed = throws().scheduleOn(&executor).start();
+  executor.run();
+  EXPECT_THROW(std::move(failed).get(), std::runtime_error);
+}
+
+TEST(Task, ExecutorAffinity) {
+  ManualExecutor executor;
+  CPUThreadPoolExecutor pool(1);
+  auto task = [&]() -> Task<void> {
+    auto id = std::this_thread::get_id();
+    // A Task awaited from another executor completes there, and this Task
+    // gets back to its own executor
+    auto other = co_await currentExecutor().scheduleOn(&pool);
+    EXPECT_EQ(&pool, other);
+    EXPECT_EQ(id, std::this_thread::get_id());
+
+    auto value = co_await via(&pool).then([] { return 5; });
+    EXPECT_EQ(5, value);
+    EXPECT_EQ(id, std::this_thread::get_id());
+    EXPECT_EQ(&executor, co_await currentExecutor());
+  };
+  auto future = task().scheduleOn(&executor).start();
+  executor.waitFor(future);
+  std::move(future).get();
+}
+
+TEST(Task, AwaitFuture) {
+  auto task = []() -> Task<int> {
+    auto a = co_await makeFuture(1);
+    Promise<int> p;
+    auto f = p.getFuture();
+    std::thread t([&] { p.setValue(2); });
+    auto b = co_await std::move(f);
+    t.join();
+    auto c = co_await makeFuture(3).semi();
+    co_return a + b + c;
+  };
+  EXPECT_EQ(6, blockingWait(task()));
+
+  auto failed = []() -> Task<int> {
+    co_return co_await makeFuture<int>(std::logic_error("no"));
+  };
+  EXPECT_THROW(blockingWait(failed()), std::logic_error);
+}
+
+TEST(Task, BlockingWaitAwaitable) {
+  EXPECT_EQ(3, blockingWait(makeFuture(3)));
+}
+
+TEST(Task, CoAwaitTry) {
+  auto task = []() -> Task<void> {
+    auto executor = co_await co_current_executor;
+    auto t = co_await throws().scheduleOn(executor).co_awaitTry();
+    EXPECT_TRUE(t.hasException<std::runtime_error>());
+  };
+  blockingWait(task());
+}
+#endif
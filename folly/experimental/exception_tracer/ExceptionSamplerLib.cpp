@@ -0,0 +1,270 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/exception_tracer/ExceptionSamplerLib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+
+#include <glog/logging.h>
+
+#include <folly/Indestructible.h>
+#include <folly/Likely.h>
+#include <folly/RWSpinLock.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include <folly/experimental/exception_tracer/ExceptionTracerLib.h>
+#include <folly/experimental/symbolizer/CachedSymbolizer.h>
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+
+using namespace folly::exception_tracer;
+
+namespace {
+
+// Frames kept for a throw site
+constexpr size_t kSiteFrames = 16;
+// Our own frames (getStackTrace(), sampleThrow(), throwHandler() and
+// __cxa_throw()), which are dropped
+constexpr size_t kInternalFrames = 4;
+
+std::atomic<uint32_t> gSamplingRate{0};
+
+// Throws of this thread left until the next sample; 0 if not drawn yet
+FOLLY_TLS uint32_t gCountdown;
+
+// We use the hash of the throw site's stack trace and exception type to
+// uniquely identify it.
+using ThrowSiteId = uint64_t;
+
+using ThrowSitesHolderType = std::unordered_map<ThrowSiteId, ThrowSiteStats>;
+
+void merge(ThrowSitesHolderType& from, ThrowSitesHolderType& into) {
+  for (auto& item : from) {
+    auto inserted = into.insert(item);
+    if (!inserted.second) {
+      inserted.first->second.samples += item.second.samples;
+      inserted.first->second.count += item.second.count;
+    }
+  }
+}
+
+// Samples of the threads that exited since the last report
+folly::Synchronized<ThrowSitesHolderType>& exitedThreadsSites() {
+  static folly::Indestructible<folly::Synchronized<ThrowSitesHolderType>>
+      sites;
+  return *sites;
+}
+
+struct ThrowSitesStorage {
+  ~ThrowSitesStorage() {
+    appendTo(*exitedThreadsSites().wlock());
+  }
+
+  void appendTo(ThrowSitesHolderType& data) {
+    ThrowSitesHolderType tempHolder;
+    sitesHolder->swap(tempHolder);
+    merge(tempHolder, data);
+  }
+
+  folly::Synchronized<ThrowSitesHolderType, folly::RWSpinLock> sitesHolder;
+};
+
+class Tag {};
+
+folly::ThreadLocal<ThrowSitesStorage, Tag> gThrowSites;
+
+// Uniform in [1, 2 * rate), so that samples are about rate throws apart
+// without following the period of the code that throws
+uint32_t drawCountdown(uint32_t rate) {
+  if (rate == 1) {
+    return 1;
+  }
+  uint32_t max = rate > std::numeric_limits<uint32_t>::max() / 2
+      ? std::numeric_limits<uint32_t>::max()
+      : 2 * rate;
+  return folly::Random::rand32(1, max);
+}
+
+FOLLY_NOINLINE void sampleThrow(std::type_info* exType, uint32_t rate) {
+  try {
+    uintptr_t frames[kInternalFrames + kSiteFrames];
+    auto n = folly::symbolizer::getStackTrace(
+        frames, kInternalFrames + kSiteFrames);
+    // If we fail to collect the stack trace we just count the throw under
+    // an empty stack trace.
+    size_t count = n > ssize_t(kInternalFrames) ? n - kInternalFrames : 0;
+
+    // The exception type and the frames, hashed together
+    uintptr_t key[kSiteFrames + 1];
+    key[0] = reinterpret_cast<uintptr_t>(exType);
+    std::copy(
+        frames + kInternalFrames, frames + kInternalFrames + count, key + 1);
+    auto siteId =
+        folly::hash::SpookyHashV2::Hash64(key, (count + 1) * sizeof(key[0]), 0);
+
+    SYNCHRONIZED(holder, gThrowSites->sitesHolder) {
+      auto& site = holder[siteId];
+      if (site.samples == 0) {
+        site.type = exType;
+        site.frames.assign(key + 1, key + 1 + count);
+      }
+      ++site.samples;
+      site.count += rate;
+    }
+  } catch (...) {
+    // Out of memory; drop the sample
+  }
+}
+
+/*
+ * This handler samples the exceptions thrown by the program; the samples
+ * are stored in thread local storage.
+ */
+void throwHandler(void*, std::type_info* exType, void (*)(void*)) noexcept {
+  auto rate = gSamplingRate.load(std::memory_order_relaxed);
+  if (LIKELY(rate == 0)) {
+    return;
+  }
+  if (gCountdown == 0) {
+    gCountdown = drawCountdown(rate);
+  }
+  if (--gCountdown == 0) {
+    sampleThrow(exType, rate);
+  }
+}
+
+struct Initializer {
+  Initializer() {
+    registerCxaThrowCallback(throwHandler);
+  }
+};
+
+Initializer initializer;
+
+} // namespace
+
+namespace folly {
+namespace exception_tracer {
+
+void setExceptionSamplingRate(uint32_t oneIn) {
+  gSamplingRate.store(oneIn, std::memory_order_relaxed);
+}
+
+uint32_t getExceptionSamplingRate() {
+  return gSamplingRate.load(std::memory_order_relaxed);
+}
+
+std::vector<ThrowSiteStats> getThrowSiteStatistics() {
+  ThrowSitesHolderType accumulator;
+  for (auto& threadSites : gThrowSites.accessAllThreads()) {
+    threadSites.appendTo(accumulator);
+  }
+  {
+    ThrowSitesHolderType exited;
+    exitedThreadsSites().wlock()->swap(exited);
+    merge(exited, accumulator);
+  }
+
+  std::vector<ThrowSiteStats> result;
+  result.reserve(accumulator.size());
+  for (auto& item : accumulator) {
+    result.push_back(std::move(item.second));
+  }
+
+  std::sort(
+      result.begin(),
+      result.end(),
+      [](const ThrowSiteStats& lhs, const ThrowSiteStats& rhs) {
+        return lhs.count > rhs.count;
+      });
+
+  return result;
+}
+
+void printThrowSites(
+    std::ostream& out,
+    const std::vector<ThrowSiteStats>& sites,
+    size_t maxSites,
+    size_t maxFrames) {
+  using namespace folly::symbolizer;
+  // Shared by all reports, which mostly see the same sites again
+  static Indestructible<CachedSymbolizer> symbolizer;
+
+  for (size_t i = 0; i < std::min(maxSites, sites.size()); ++i) {
+    const auto& site = sites[i];
+    out << "Throw site: " << site.count << " throws (" << site.samples
+        << (site.samples == 1 ? " sample" : " samples") << ") of "
+        << (site.type ? folly::demangle(*site.type) : "(unknown type)")
+        << "\n";
+    try {
+      size_t frameCount = std::min(maxFrames, site.frames.size());
+      std::vector<SymbolizedFrame> frames(frameCount);
+      symbolizer->symbolize(site.frames.data(), frames.data(), frameCount);
+      OStreamSymbolizePrinter osp(out);
+      osp.println(site.frames.data(), frames.data(), frameCount);
+    } catch (const std::exception& e) {
+      out << "\n !! caught " << folly::exceptionStr(e) << "\n";
+    }
+  }
+}
+
+ThrowSiteReporter::ThrowSiteReporter(
+    std::chrono::milliseconds interval,
+    Callback callback)
+    : interval_(interval), callback_(std::move(callback)) {
+  thread_ = std::thread([this] { run(); });
+}
+
+ThrowSiteReporter::~ThrowSiteReporter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cond_.notify_one();
+  thread_.join();
+}
+
+void ThrowSiteReporter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!cond_.wait_for(lock, interval_, [&] { return stopping_; })) {
+    lock.unlock();
+    auto sites = getThrowSiteStatistics();
+    try {
+      if (callback_) {
+        callback_(std::move(sites));
+      } else if (!sites.empty()) {
+        std::ostringstream out;
+        printThrowSites(out, sites);
+        LOG(WARNING) << "Hottest throw sites:\n" << out.str();
+      }
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Throw site report failed: " << folly::exceptionStr(e);
+    }
+    lock.lock();
+  }
+}
+
+} // namespace exception_tracer
+} // namespace folly
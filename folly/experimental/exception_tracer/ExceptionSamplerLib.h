@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Sampling of thrown exceptions, cheap enough to leave enabled in
+// production to find the sites that throw the most.
+//
+// Once enabled with setExceptionSamplingRate(n), about one in n throws of
+// each thread (at random) captures a short stack trace, and is counted
+// under its throw site: the type of the exception and that stack. Other
+// throws only decrement a thread-local counter. Stacks are symbolized when
+// printed, through a CachedSymbolizer shared by all reports.
+//
+// Like ExceptionCounterLib, this works by intercepting __cxa_throw, so the
+// library must be linked in (or LD_PRELOADed) with ExceptionTracerLib.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+namespace folly {
+namespace exception_tracer {
+
+struct ThrowSiteStats {
+  const std::type_info* type;
+  // Innermost first, starting with the function that threw
+  std::vector<uintptr_t> frames;
+  // Throws that were sampled
+  uint64_t samples;
+  // Estimated throws, from the samples and the rates they were taken at
+  uint64_t count;
+};
+
+/**
+ * Sample about one in oneIn throws; 0 (the default) disables sampling.
+ */
+void setExceptionSamplingRate(uint32_t oneIn);
+uint32_t getExceptionSamplingRate();
+
+/**
+ * Accumulates the throw sites sampled by all threads since the last call,
+ * and resets them; sorted by decreasing count.
+ */
+std::vector<ThrowSiteStats> getThrowSiteStatistics();
+
+/**
+ * Prints the first maxSites sites, with up to maxFrames symbolized frames
+ * each. Symbolization is slow the first time an address is seen.
+ */
+void printThrowSites(
+    std::ostream& out,
+    const std::vector<ThrowSiteStats>& sites,
+    size_t maxSites = 10,
+    size_t maxFrames = 8);
+
+/**
+ * Calls callback with getThrowSiteStatistics() every interval, from a
+ * thread of its own, until destroyed. By default, the hottest sites are
+ * logged as warnings.
+ */
+class ThrowSiteReporter {
+ public:
+  using Callback = std::function<void(std::vector<ThrowSiteStats>)>;
+
+  explicit ThrowSiteReporter(
+      std::chrono::milliseconds interval,
+      Callback callback = nullptr);
+
+  // Stops, without a last report
+  ~ThrowSiteReporter();
+
+  ThrowSiteReporter(const ThrowSiteReporter&) = delete;
+  ThrowSiteReporter& operator=(const ThrowSiteReporter&) = delete;
+
+ private:
+  void run();
+
+  const std::chrono::milliseconds interval_;
+  const Callback callback_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stopping_{false};
+  std::thread thread_;
+};
+
+} // namespace exception_tracer
+} // namespace folly
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/Demangle.h>
+#include <folly/experimental/exception_tracer/ExceptionSamplerLib.h>
+#include <folly/portability/GTest.h>
+
+struct MyException {};
+
+[[noreturn]] FOLLY_NOINLINE void bar() {
+  throw std::runtime_error("hello");
+}
+
+[[noreturn]] FOLLY_NOINLINE void foo() {
+  throw MyException();
+}
+
+using namespace folly::exception_tracer;
+
+template <typename F>
+void throwAndCatch(F f) {
+  try {
+    f();
+  } catch (...) {
+    // ignore
+  }
+}
+
+class ExceptionSampler : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    getThrowSiteStatistics();
+  }
+
+  void TearDown() override {
+    setExceptionSamplingRate(0);
+  }
+};
+
+TEST_F(ExceptionSampler, disabled) {
+  EXPECT_EQ(0, getExceptionSamplingRate());
+  for (volatile int i = 0; i < 100; ++i) {
+    throwAndCatch(bar);
+  }
+  EXPECT_TRUE(getThrowSiteStatistics().empty());
+}
+
+TEST_F(ExceptionSampler, everyThrow) {
+  setExceptionSamplingRate(1);
+  throwAndCatch(foo);
+  // Use volatile to prevent loop unrolling (it screws up stack frame grouping).
+  for (volatile int i = 0; i < 10; ++i) {
+    throwAndCatch(bar);
+  }
+  setExceptionSamplingRate(0);
+
+  auto sites = getThrowSiteStatistics();
+  ASSERT_EQ(2, sites.size());
+  EXPECT_EQ(typeid(std::runtime_error), *sites[0].type);
+  EXPECT_EQ(10, sites[0].samples);
+  EXPECT_EQ(10, sites[0].count);
+  EXPECT_EQ(typeid(MyException), *sites[1].type);
+  EXPECT_EQ(1, sites[1].count);
+  EXPECT_FALSE(sites[0].frames.empty());
+
+  std::ostringstream out;
+  printThrowSites(out, sites, 1);
+  auto report = out.str();
+  EXPECT_NE(std::string::npos, report.find("10 throws (10 samples)"))
+      << report;
+  EXPECT_NE(
+      std::string::npos,
+      report.find(folly::demangle(typeid(std::runtime_error)).toStdString()))
+      << report;
+  EXPECT_NE(std::string::npos, report.find("bar")) << report;
+  EXPECT_EQ(std::string::npos, report.find("MyException")) << report;
+
+  EXPECT_TRUE(getThrowSiteStatistics().empty());
+}
+
+TEST_F(ExceptionSampler, oneInN) {
+  constexpr size_t kNumIterations = 100000;
+  constexpr size_t kNumThreads = 4;
+  constexpr uint32_t kRate = 100;
+  setExceptionSamplingRate(kRate);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([] {
+      for (size_t i = 0; i < kNumIterations; ++i) {
+        throwAndCatch(foo);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  auto sites = getThrowSiteStatistics();
+  ASSERT_EQ(1, sites.size());
+  auto expected = kNumIterations * kNumThreads;
+  EXPECT_EQ(sites[0].samples * kRate, sites[0].count);
+  EXPECT_GT(sites[0].count, expected * 8 / 10);
+  EXPECT_LT(sites[0].count, expected * 12 / 10);
+}
+
+TEST_F(ExceptionSampler, reporter) {
+  setExceptionSamplingRate(1);
+  std::atomic<uint64_t> reported{0};
+  folly::Baton<> baton;
+  {
+    ThrowSiteReporter reporter(
+        std::chrono::milliseconds(10),
+        [&](std::vector<ThrowSiteStats> sites) {
+          for (auto& site : sites) {
+            reported += site.count;
+          }
+          if (reported >= 5) {
+            baton.post();
+          }
+        });
+    for (volatile int i = 0; i < 5; ++i) {
+      throwAndCatch(bar);
+    }
+    baton.wait();
+  }
+  EXPECT_EQ(5, reported);
+}
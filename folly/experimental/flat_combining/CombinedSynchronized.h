@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include <folly/ThreadLocal.h>
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/experimental/flat_combining/FlatCombining.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+
+namespace folly {
+
+/// CombinedSynchronized<T> guards a T like Synchronized<T>::withLock(),
+/// but runs the operations through flat combining (see FlatCombining.h):
+/// when the lock is contended, the operation is posted to the calling
+/// thread's combining record, and whichever thread holds the lock (or the
+/// dedicated combiner thread, if requested) runs the pending operations
+/// in a batch, keeping T in its cache.  No class has to be derived from
+/// FlatCombining.
+///
+///   CombinedSynchronized<std::unordered_map<std::string, int64_t>> counts;
+///
+///   auto n = counts.withLock([&](auto& map) { return ++map[key]; });
+///
+///   // Returns right away; the future completes once the operation ran
+///   Future<Unit> done = counts.withLockAsync(
+///       [key](auto& map) { ++map[key]; });
+///
+/// Operations from one thread run in the order they were submitted.  They
+/// may run on another thread, so they must not rely on thread locals.
+/// Exceptions are passed on to the caller (or future).
+///
+/// Without a dedicated combiner, an asynchronous operation that couldn't
+/// run right away runs when some thread next gets the lock; drain() (and
+/// the destructor) runs the stragglers once the other threads are done.
+template <
+    typename T,
+    typename Mutex = std::mutex,
+    template <typename> class Atom = std::atomic>
+class CombinedSynchronized {
+  class Combiner : public FlatCombining<Combiner, Mutex, Atom> {
+   public:
+    using FlatCombining<Combiner, Mutex, Atom>::FlatCombining;
+  };
+  using Rec = typename Combiner::Rec;
+
+  template <typename Function>
+  using ResultOf =
+      typename std::decay<decltype(std::declval<Function&>()(
+          std::declval<T&>()))>::type;
+
+ public:
+  /// dedicated, numRecs and maxOps are passed on to FlatCombining; a
+  /// dedicated combiner takes a thread per instance.
+  explicit CombinedSynchronized(
+      T value = T(),
+      bool dedicated = false,
+      uint32_t numRecs = 0,
+      uint32_t maxOps = 0)
+      : value_(std::move(value)),
+        combiner_(dedicated, numRecs, maxOps),
+        recs_([this] { return new RecHolder(combiner_); }) {}
+
+  ~CombinedSynchronized() {
+    drain();
+  }
+
+  CombinedSynchronized(const CombinedSynchronized&) = delete;
+  CombinedSynchronized& operator=(const CombinedSynchronized&) = delete;
+
+  /// Runs function(value) with exclusive access, maybe on another thread,
+  /// and returns (a copy of) its result.
+  template <typename Function>
+  ResultOf<Function> withLock(Function&& function) {
+    Try<ResultOf<Function>> result;
+    combiner_.requestFC(
+        [&] { result = makeTryWith([&] { return function(value_); }); },
+        recs_->rec,
+        true /* syncop */);
+    return std::move(result).value();
+  }
+
+  /// Submits function(value) to run with exclusive access, and returns a
+  /// future for its result.  Doesn't block, unless this thread's previous
+  /// asynchronous operation is still pending, or all combining records
+  /// are in use.
+  template <typename Function>
+  Future<typename Unit::Lift<ResultOf<Function>>::type> withLockAsync(
+      Function function) {
+    // Boxed, since records only hold small function objects inline
+    struct Op {
+      Function function;
+      Promise<typename Unit::Lift<ResultOf<Function>>::type> promise;
+    };
+    auto op = std::make_unique<Op>(Op{std::move(function), {}});
+    auto future = op->promise.getFuture();
+    combiner_.requestFC(
+        [ this, op = std::move(op) ] {
+          op->promise.setWith([&] { return op->function(value_); });
+        },
+        recs_->rec,
+        false /* syncop */);
+    return future;
+  }
+
+  /// A copy of the value.
+  T copy() {
+    return withLock([](const T& value) { return value; });
+  }
+
+  /// Waits for all pending asynchronous operations to complete.  Like
+  /// FlatCombining::drainAll(), this must not run concurrently with
+  /// other operations.
+  void drain() {
+    combiner_.drainAll();
+  }
+
+ private:
+  // This thread's combining record; null if there were none left, in
+  // which case operations that can't run right away wait for the lock.
+  struct RecHolder {
+    explicit RecHolder(Combiner& c) : combiner(c), rec(c.allocRec()) {}
+    ~RecHolder() {
+      combiner.freeRec(rec);
+    }
+
+    Combiner& combiner;
+    Rec* rec;
+  };
+
+  T value_;
+  Combiner combiner_;
+  ThreadLocal<RecHolder> recs_;
+};
+
+} // namespace folly
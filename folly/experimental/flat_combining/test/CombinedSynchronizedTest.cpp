@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/flat_combining/CombinedSynchronized.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::CombinedSynchronized;
+
+TEST(CombinedSynchronized, basic) {
+  CombinedSynchronized<std::vector<int>> v(std::vector<int>{1, 2});
+  EXPECT_EQ(2, v.withLock([](std::vector<int>& x) { return x.size(); }));
+  v.withLock([](std::vector<int>& x) { x.push_back(3); });
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), v.copy());
+  EXPECT_THROW(
+      v.withLock([](std::vector<int>& x) { return x.at(10); }),
+      std::out_of_range);
+
+  auto f = v.withLockAsync([](std::vector<int>& x) { return x.back(); });
+  v.drain();
+  EXPECT_EQ(3, f.get());
+  auto g = v.withLockAsync([](std::vector<int>& x) { x.clear(); });
+  v.drain();
+  g.get();
+  EXPECT_TRUE(v.copy().empty());
+}
+
+static void runCounters(bool dedicated) {
+  CombinedSynchronized<std::unordered_map<std::string, long>> counts(
+      {}, dedicated);
+  const int numThreads = 8;
+  const int numIters = 10000;
+  std::vector<std::vector<folly::Future<folly::Unit>>> futures(numThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < numIters; ++i) {
+        auto key = std::to_string(i % 10);
+        if ((t + i) % 2) {
+          counts.withLock([&](std::unordered_map<std::string, long>& m) {
+            ++m[key];
+          });
+        } else {
+          futures[t].push_back(counts.withLockAsync(
+              [key](std::unordered_map<std::string, long>& m) { ++m[key]; }));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  counts.drain();
+  for (auto& threadFutures : futures) {
+    for (auto& f : threadFutures) {
+      EXPECT_TRUE(f.isReady());
+    }
+  }
+
+  auto m = counts.copy();
+  EXPECT_EQ(10, m.size());
+  for (auto& kv : m) {
+    EXPECT_EQ(numThreads * numIters / 10, kv.second);
+  }
+}
+
+TEST(CombinedSynchronized, concurrent) {
+  runCounters(false);
+}
+
+TEST(CombinedSynchronized, dedicated) {
+  runCounters(true);
+}
+
+TEST(CombinedSynchronized, order) {
+  // Operations from one thread are applied in order, sync or not
+  CombinedSynchronized<std::vector<int>> v;
+  std::thread other([&] {
+    for (int i = 0; i < 1000; ++i) {
+      v.withLock([](std::vector<int>& x) { x.push_back(-1); });
+    }
+  });
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3) {
+      v.withLockAsync([i](std::vector<int>& x) { x.push_back(i); });
+    } else {
+      v.withLock([i](std::vector<int>& x) { x.push_back(i); });
+    }
+  }
+  other.join();
+  v.drain();
+  int last = -1;
+  for (int x : v.copy()) {
+    if (x >= 0) {
+      EXPECT_EQ(last + 1, x);
+      last = x;
+    }
+  }
+  EXPECT_EQ(999, last);
+}
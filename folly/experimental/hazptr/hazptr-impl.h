@@ -58,11 +58,13 @@
 #define HAZPTR_STATS false
 #endif
 
+#include <folly/Executor.h>
 #include <folly/concurrency/CacheLocality.h>
 #include <folly/experimental/hazptr/debug.h>
 #include <folly/synchronization/AsymmetricMemoryBarrier.h>
 
 #include <mutex> // for thread caching
+#include <thread> // for yielding to protected objects and pending tasks
 #include <unordered_set> // for hash set in bulk reclamation
 
 namespace folly {
@@ -187,14 +189,19 @@ inline constexpr hazptr_domain::hazptr_domain(memory_resource* mr) noexcept
  */
 
 template <typename T, typename D>
-inline void hazptr_obj_base<T, D>::retire(hazptr_domain& domain, D deleter) {
-  DEBUG_PRINT(this << " " << &domain);
+inline void hazptr_obj_base<T, D>::preRetire(D deleter) {
   deleter_ = std::move(deleter);
   reclaim_ = [](hazptr_obj* p) {
     auto hobp = static_cast<hazptr_obj_base*>(p);
     auto obj = static_cast<T*>(hobp);
     hobp->deleter_(obj);
   };
+}
+
+template <typename T, typename D>
+inline void hazptr_obj_base<T, D>::retire(hazptr_domain& domain, D deleter) {
+  DEBUG_PRINT(this << " " << &domain);
+  preRetire(std::move(deleter));
   if (HAZPTR_PRIV &&
       (HAZPTR_ONE_DOMAIN || (&domain == &default_hazptr_domain()))) {
     if (hazptr_priv_try_retire(this)) {
@@ -204,15 +211,21 @@ inline void hazptr_obj_base<T, D>::retire(hazptr_domain& domain, D deleter) {
   domain.objRetire(this);
 }
 
+template <typename T, typename D>
+inline void hazptr_obj_base<T, D>::retire(
+    hazptr_obj_cohort& cohort,
+    D deleter) {
+  DEBUG_PRINT(this << " " << &cohort);
+  preRetire(std::move(deleter));
+  cohort.objRetire(this);
+}
+
 /**
  *  hazptr_obj_base_refcounted
  */
 
 template <typename T, typename D>
-inline void hazptr_obj_base_refcounted<T, D>::retire(
-    hazptr_domain& domain,
-    D deleter) {
-  DEBUG_PRINT(this << " " << &domain);
+inline void hazptr_obj_base_refcounted<T, D>::preRetire(D deleter) {
   deleter_ = std::move(deleter);
   reclaim_ = [](hazptr_obj* p) {
     auto hrobp = static_cast<hazptr_obj_base_refcounted*>(p);
@@ -221,6 +234,14 @@ inline void hazptr_obj_base_refcounted<T, D>::retire(
       hrobp->deleter_(obj);
     }
   };
+}
+
+template <typename T, typename D>
+inline void hazptr_obj_base_refcounted<T, D>::retire(
+    hazptr_domain& domain,
+    D deleter) {
+  DEBUG_PRINT(this << " " << &domain);
+  preRetire(std::move(deleter));
   if (HAZPTR_PRIV &&
       (HAZPTR_ONE_DOMAIN || (&domain == &default_hazptr_domain()))) {
     if (hazptr_priv_try_retire(this)) {
@@ -230,6 +251,15 @@ inline void hazptr_obj_base_refcounted<T, D>::retire(
   domain.objRetire(this);
 }
 
+template <typename T, typename D>
+inline void hazptr_obj_base_refcounted<T, D>::retire(
+    hazptr_obj_cohort& cohort,
+    D deleter) {
+  DEBUG_PRINT(this << " " << &cohort);
+  preRetire(std::move(deleter));
+  cohort.objRetire(this);
+}
+
 template <typename T, typename D>
 inline void hazptr_obj_base_refcounted<T, D>::acquire_ref() {
   DEBUG_PRINT(this);
@@ -485,6 +515,7 @@ FOLLY_ALWAYS_INLINE hazptr_array<M>::~hazptr_array() {
       auto count = tc.count();
       if ((M <= HAZPTR_TC_SIZE) && (count + M <= HAZPTR_TC_SIZE)) {
         for (size_t i = 0; i < M; ++i) {
+          h[i].reset();
           tc[count + i].hprec_ = h[i].hazptr_;
           DEBUG_PRINT(i << " " << &h[i]);
           new (&h[i]) hazptr_holder(nullptr);
@@ -566,7 +597,12 @@ FOLLY_ALWAYS_INLINE hazptr_local<M>::hazptr_local() {
 
 template <size_t M>
 FOLLY_ALWAYS_INLINE hazptr_local<M>::~hazptr_local() {
+  auto h = reinterpret_cast<hazptr_holder*>(&raw_);
   if (LIKELY(!need_destruct_)) {
+    /* Stale hazard pointers would hold back cohorts waiting on them */
+    for (size_t i = 0; i < M; ++i) {
+      h[i].reset();
+    }
     if (kIsDebug) {
       auto ptc = hazptr_tc_tls();
       DCHECK(ptc != nullptr);
@@ -577,7 +613,6 @@ FOLLY_ALWAYS_INLINE hazptr_local<M>::~hazptr_local() {
     return;
   }
   // Slow path
-  auto h = reinterpret_cast<hazptr_holder*>(&raw_);
   for (size_t i = 0; i < M; ++i) {
     h[i].~hazptr_holder();
   }
@@ -670,8 +705,17 @@ void hazptr_domain::retire(T* obj, D reclaim) {
   objRetire(node);
 }
 
+inline void hazptr_domain::set_executor(Executor* executor) noexcept {
+  DEBUG_PRINT(this << " " << executor);
+  executor_.store(executor, std::memory_order_release);
+}
+
 inline hazptr_domain::~hazptr_domain() {
   DEBUG_PRINT(this);
+  /* wait for queued reclamation tasks, which refer to this domain */
+  while (pending_.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
   { /* reclaim all remaining retired objects */
     hazptr_obj* next;
     auto retired = retired_.exchange(nullptr);
@@ -767,6 +811,11 @@ inline void hazptr_domain::tryBulkReclaim() {
       break;
     }
   } while (true);
+  auto executor = executor_.load(std::memory_order_acquire);
+  if (executor) {
+    asyncBulkReclaim(executor);
+    return;
+  }
   bulkReclaim();
 }
 
@@ -774,14 +823,45 @@ inline void hazptr_domain::bulkReclaim() {
   DEBUG_PRINT(this);
   /*** Full fence ***/ hazptr_mb::heavy();
   auto p = retired_.exchange(nullptr, std::memory_order_acquire);
+  hazptr_obj* retired;
+  hazptr_obj* tail;
+  auto rcount = reclaimUnprotected(p, retired, tail);
+  if (tail) {
+    pushRetired(retired, tail, rcount);
+  }
+}
+
+inline void hazptr_domain::asyncBulkReclaim(Executor* executor) {
+  DEBUG_PRINT(this << " " << executor);
+  /* The guard is destroyed with the task, whether or not it ran */
+  pending_.fetch_add(1, std::memory_order_acq_rel);
+  std::unique_ptr<hazptr_domain, void (*)(hazptr_domain*)> guard(
+      this, [](hazptr_domain* domain) {
+        domain->pending_.fetch_sub(1, std::memory_order_release);
+      });
+  try {
+    executor->add([guard = std::move(guard)] { guard->bulkReclaim(); });
+  } catch (...) {
+    bulkReclaim();
+  }
+}
+
+/* Reclaims the objects in the list p that are not protected by any
+ * hazard pointer of this domain. The remaining objects are linked
+ * from head to tail, and their number is returned.  The caller must
+ * have issued a heavy fence before taking p from a shared list. */
+inline int hazptr_domain::reclaimUnprotected(
+    hazptr_obj* p,
+    hazptr_obj*& head,
+    hazptr_obj*& tail) {
   auto h = hazptrs_.load(std::memory_order_acquire);
   std::unordered_set<const void*> hs; // TODO lock-free alternative
   for (; h; h = h->next_) {
     hs.insert(h->get());
   }
   int rcount = 0;
-  hazptr_obj* retired = nullptr;
-  hazptr_obj* tail = nullptr;
+  head = nullptr;
+  tail = nullptr;
   hazptr_obj* next;
   for (; p; p = next) {
     next = p->next_;
@@ -789,17 +869,80 @@ inline void hazptr_domain::bulkReclaim() {
       DEBUG_PRINT(this << " " << p << " " << p->reclaim_);
       (*(p->reclaim_))(p);
     } else {
-      p->next_ = retired;
-      retired = p;
+      p->next_ = head;
+      head = p;
       if (tail == nullptr) {
         tail = p;
       }
       ++rcount;
     }
   }
+  return rcount;
+}
+
+/** hazptr_obj_cohort */
+
+inline hazptr_obj_cohort::hazptr_obj_cohort(hazptr_domain& domain) noexcept
+    : domain_(&domain) {}
+
+inline hazptr_obj_cohort::~hazptr_obj_cohort() {
+  DEBUG_PRINT(this);
+  /* Reclaiming an object may retire more objects to this cohort */
+  while (retired_.load(std::memory_order_acquire)) {
+    rcount_.store(0, std::memory_order_relaxed);
+    if (bulkReclaim() > 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+inline void hazptr_obj_cohort::objRetire(hazptr_obj* p) {
+  auto rcount = pushRetired(p, p, 1);
+  if (domain_->reachedThreshold(rcount)) {
+    tryBulkReclaim();
+  }
+}
+
+inline int
+hazptr_obj_cohort::pushRetired(hazptr_obj* head, hazptr_obj* tail, int count) {
+  /*** Full fence ***/ hazptr_mb::light();
+  tail->next_ = retired_.load(std::memory_order_acquire);
+  while (!retired_.compare_exchange_weak(
+      tail->next_,
+      head,
+      std::memory_order_release,
+      std::memory_order_acquire)) {
+  }
+  return rcount_.fetch_add(count) + count;
+}
+
+inline void hazptr_obj_cohort::tryBulkReclaim() {
+  DEBUG_PRINT(this);
+  do {
+    auto rcount = rcount_.load(std::memory_order_acquire);
+    if (!domain_->reachedThreshold(rcount)) {
+      return;
+    }
+    if (rcount_.compare_exchange_weak(
+            rcount, 0, std::memory_order_release, std::memory_order_relaxed)) {
+      break;
+    }
+  } while (true);
+  bulkReclaim();
+}
+
+/* Returns the number of objects that were still protected */
+inline int hazptr_obj_cohort::bulkReclaim() {
+  DEBUG_PRINT(this);
+  /*** Full fence ***/ hazptr_mb::heavy();
+  auto p = retired_.exchange(nullptr, std::memory_order_acquire);
+  hazptr_obj* retired;
+  hazptr_obj* tail;
+  auto rcount = domain_->reclaimUnprotected(p, retired, tail);
   if (tail) {
     pushRetired(retired, tail, rcount);
   }
+  return rcount;
 }
 
 /** hazptr_stats */
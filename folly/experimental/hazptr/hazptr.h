@@ -22,6 +22,9 @@
 #include <folly/experimental/hazptr/memory_resource.h>
 
 namespace folly {
+
+class Executor;
+
 namespace hazptr {
 
 /** hazptr_rec: Private class that contains hazard pointers. */
@@ -40,6 +43,10 @@ class hazptr_obj_base;
 template <typename T, typename Deleter>
 class hazptr_obj_base_refcounted;
 
+/** hazptr_obj_cohort: Group of retired objects that are all reclaimed
+ *  by the time the cohort is destroyed. */
+class hazptr_obj_cohort;
+
 /** hazptr_local: Optimized template for bulk construction and destruction of
  *  hazard pointers */
 template <size_t M>
@@ -66,8 +73,16 @@ class hazptr_domain {
   template <typename T, typename D = std::default_delete<T>>
   void retire(T* obj, D reclaim = {});
 
+  /** Run the bulk reclamation triggered by retiring objects as a task
+   *  on executor, instead of in the retiring thread.  Passing nullptr
+   *  restores inline reclamation.  Tasks that are still queued keep the
+   *  domain from being destroyed; an executor that drops them without
+   *  running them leaves their objects for a later scan. */
+  void set_executor(Executor* executor) noexcept;
+
  private:
   friend class hazptr_holder;
+  friend class hazptr_obj_cohort;
   template <typename, typename>
   friend class hazptr_obj_base;
   template <typename, typename>
@@ -79,6 +94,8 @@ class hazptr_domain {
   std::atomic<hazptr_obj*> retired_ = {nullptr};
   std::atomic<int> hcount_ = {0};
   std::atomic<int> rcount_ = {0};
+  std::atomic<Executor*> executor_ = {nullptr};
+  std::atomic<int> pending_ = {0};
 
   void objRetire(hazptr_obj*);
   hazptr_rec* hazptrAcquire();
@@ -87,6 +104,8 @@ class hazptr_domain {
   bool reachedThreshold(int rcount);
   void tryBulkReclaim();
   void bulkReclaim();
+  void asyncBulkReclaim(Executor* executor);
+  int reclaimUnprotected(hazptr_obj* p, hazptr_obj*& head, hazptr_obj*& tail);
 };
 
 /** Get the default hazptr_domain */
@@ -106,6 +125,7 @@ class hazptr_obj {
   template <typename, typename>
   friend class hazptr_obj_base_refcounted;
   friend struct hazptr_priv;
+  friend class hazptr_obj_cohort;
 
   void (*reclaim_)(hazptr_obj*);
   hazptr_obj* next_;
@@ -121,8 +141,14 @@ class hazptr_obj_base : public hazptr_obj {
    * reclaiming it to the hazptr library */
   void retire(hazptr_domain& domain = default_hazptr_domain(), D reclaim = {});
 
+  /* Retire a removed object to a cohort, which reclaims it no later
+   * than its own destruction */
+  void retire(hazptr_obj_cohort& cohort, D reclaim = {});
+
  private:
   D deleter_;
+
+  void preRetire(D deleter);
 };
 
 /** Definition of hazptr_recounted_obj_base */
@@ -133,6 +159,10 @@ class hazptr_obj_base_refcounted : public hazptr_obj {
    * reclaiming it to the hazptr library */
   void retire(hazptr_domain& domain = default_hazptr_domain(), D reclaim = {});
 
+  /* Retire a removed object to a cohort, which reclaims it no later
+   * than its own destruction */
+  void retire(hazptr_obj_cohort& cohort, D reclaim = {});
+
   /* aquire_ref() increments the reference count
    *
    * acquire_ref_safe() is the same as acquire_ref() except that in
@@ -150,6 +180,46 @@ class hazptr_obj_base_refcounted : public hazptr_obj {
  private:
   std::atomic<uint32_t> refcount_{0};
   D deleter_;
+
+  void preRetire(D deleter);
+};
+
+/** Definition of hazptr_obj_cohort
+ *
+ *  Objects retired to a cohort, typically the nodes of one data
+ *  structure, stay on the cohort's own list rather than the domain's.
+ *  Once the list is long enough it is scanned in bulk against the
+ *  domain's hazard pointers, and the destructor reclaims whatever is
+ *  left, so the objects never outlive the structure they belong to.
+ */
+class hazptr_obj_cohort {
+  template <typename, typename>
+  friend class hazptr_obj_base;
+  template <typename, typename>
+  friend class hazptr_obj_base_refcounted;
+
+ public:
+  explicit hazptr_obj_cohort(
+      hazptr_domain& domain = default_hazptr_domain()) noexcept;
+  /* Reclaims all objects retired to the cohort, waiting for those
+   * that are still protected to be unprotected. Must not be concurrent
+   * with retiring objects to the cohort. */
+  ~hazptr_obj_cohort();
+
+  hazptr_obj_cohort(const hazptr_obj_cohort&) = delete;
+  hazptr_obj_cohort(hazptr_obj_cohort&&) = delete;
+  hazptr_obj_cohort& operator=(const hazptr_obj_cohort&) = delete;
+  hazptr_obj_cohort& operator=(hazptr_obj_cohort&&) = delete;
+
+ private:
+  hazptr_domain* domain_;
+  std::atomic<hazptr_obj*> retired_ = {nullptr};
+  std::atomic<int> rcount_ = {0};
+
+  void objRetire(hazptr_obj*);
+  int pushRetired(hazptr_obj* head, hazptr_obj* tail, int count);
+  void tryBulkReclaim();
+  int bulkReclaim();
 };
 
 /** hazptr_holder: Class for automatic acquisition and release of
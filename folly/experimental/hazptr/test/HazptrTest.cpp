@@ -25,6 +25,7 @@
 #include <folly/experimental/hazptr/hazptr.h>
 #include <folly/experimental/hazptr/test/HazptrUse1.h>
 #include <folly/experimental/hazptr/test/HazptrUse2.h>
+#include <folly/executors/ManualExecutor.h>
 
 #include <folly/portability/GFlags.h>
 #include <folly/portability/GTest.h>
@@ -574,3 +575,113 @@ TEST_F(HazptrTest, FreeFunctionRetire) {
   }
   EXPECT_TRUE(retired);
 }
+
+/* Test cohorts */
+
+std::atomic<int> cohortReclaimed;
+
+struct CohortNode : hazptr_obj_base<CohortNode> {
+  hazptr_obj_cohort* cohort_;
+  CohortNode* child_;
+  explicit CohortNode(hazptr_obj_cohort* cohort, CohortNode* child = nullptr)
+      : cohort_(cohort), child_(child) {}
+  ~CohortNode() {
+    ++cohortReclaimed;
+    if (child_) {
+      child_->retire(*cohort_);
+    }
+  }
+};
+
+TEST_F(HazptrTest, Cohort) {
+  cohortReclaimed.store(0);
+  int num = 3 * HAZPTR_SCAN_THRESHOLD;
+  {
+    hazptr_obj_cohort cohort;
+    for (int i = 0; i < num; ++i) {
+      (new CohortNode(&cohort))->retire(cohort);
+    }
+    // Bulk scans ran as the cohort's list grew
+    EXPECT_GT(cohortReclaimed.load(), 0);
+  }
+  EXPECT_EQ(num, cohortReclaimed.load());
+}
+
+TEST_F(HazptrTest, CohortChain) {
+  cohortReclaimed.store(0);
+  {
+    hazptr_obj_cohort cohort;
+    CohortNode* head = nullptr;
+    for (int i = 0; i < 100; ++i) {
+      head = new CohortNode(&cohort, head);
+    }
+    // Each node retires the next one when it is reclaimed
+    head->retire(cohort);
+  }
+  EXPECT_EQ(100, cohortReclaimed.load());
+}
+
+TEST_F(HazptrTest, CohortWaitsForProtected) {
+  cohortReclaimed.store(0);
+  std::atomic<bool> protectedNode(false);
+  std::atomic<bool> unprotected(false);
+  auto cohort = new hazptr_obj_cohort;
+  std::atomic<CohortNode*> src(new CohortNode(cohort));
+  std::thread reader([&] {
+    hazptr_holder hptr;
+    hptr.get_protected(src);
+    protectedNode.store(true);
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(0, cohortReclaimed.load());
+    unprotected.store(true);
+  });
+  while (!protectedNode.load()) {
+    std::this_thread::yield();
+  }
+  src.load()->retire(*cohort);
+  delete cohort;
+  EXPECT_TRUE(unprotected.load());
+  EXPECT_EQ(1, cohortReclaimed.load());
+  reader.join();
+}
+
+TEST_F(HazptrTest, CohortOtherDomain) {
+  cohortReclaimed.store(0);
+  hazptr_domain myDomain0;
+  {
+    hazptr_obj_cohort cohort(myDomain0);
+    for (int i = 0; i < 10; ++i) {
+      (new CohortNode(&cohort))->retire(cohort);
+    }
+  }
+  EXPECT_EQ(10, cohortReclaimed.load());
+}
+
+/* Test asynchronous reclamation */
+
+TEST_F(HazptrTest, Executor) {
+  struct Thing : hazptr_obj_base<Thing> {
+    std::atomic<int>* reclaimed_;
+    explicit Thing(std::atomic<int>* reclaimed) : reclaimed_(reclaimed) {}
+    ~Thing() {
+      ++*reclaimed_;
+    }
+  };
+  std::atomic<int> reclaimed(0);
+  folly::ManualExecutor executor;
+  int num = 3 * HAZPTR_SCAN_THRESHOLD;
+  {
+    hazptr_domain myDomain0;
+    myDomain0.set_executor(&executor);
+    for (int i = 0; i < num; ++i) {
+      (new Thing(&reclaimed))->retire(myDomain0);
+    }
+    // Nothing is reclaimed by the retiring thread
+    EXPECT_EQ(0, reclaimed.load());
+    executor.drain();
+    EXPECT_GT(reclaimed.load(), 0);
+    myDomain0.set_executor(nullptr);
+  }
+  EXPECT_EQ(num, reclaimed.load());
+}
@@ -17,6 +17,7 @@
 #include <folly/experimental/io/AsyncIO.h>
 
 #include <sys/eventfd.h>
+#include <algorithm>
 #include <cerrno>
 #include <ostream>
 #include <stdexcept>
@@ -29,6 +30,8 @@
 #include <folly/Format.h>
 #include <folly/Likely.h>
 #include <folly/String.h>
+#include <folly/container/F14Map.h>
+#include <folly/detail/IoUring.h>
 #include <folly/portability/Unistd.h>
 
 namespace folly {
@@ -44,6 +47,8 @@ void AsyncIOOp::reset(NotificationCallback cb) {
   state_ = State::UNINITIALIZED;
   result_ = -EINVAL;
   memset(&iocb_, 0, sizeof(iocb_));
+  openat_ = false;
+  openatPath_ = nullptr;
 }
 
 AsyncIOOp::~AsyncIOOp() {
@@ -102,13 +107,95 @@ void AsyncIOOp::pwritev(int fd, const iovec* iov, int iovcnt, off_t start) {
   io_prep_pwritev(&iocb_, fd, iov, iovcnt, start);
 }
 
+void AsyncIOOp::fsync(int fd) {
+  init();
+  io_prep_fsync(&iocb_, fd);
+}
+
+void AsyncIOOp::fdatasync(int fd) {
+  init();
+  io_prep_fdsync(&iocb_, fd);
+}
+
+void AsyncIOOp::openat(int dirfd, const char* path, int flags, mode_t mode) {
+  init();
+  iocb_.aio_fildes = dirfd;
+  iocb_.aio_lio_opcode = IO_CMD_NOOP;
+  openat_ = true;
+  openatPath_ = path;
+  openatFlags_ = flags;
+  openatMode_ = mode;
+}
+
 void AsyncIOOp::init() {
   CHECK_EQ(state_, State::UNINITIALIZED);
   state_ = State::INITIALIZED;
 }
 
-AsyncIO::AsyncIO(size_t capacity, PollMode pollMode) : capacity_(capacity) {
+#if FOLLY_HAVE_IO_URING
+
+/**
+ * State of an io_uring instance: the kernel-shared rings, and the buffers
+ * and files registered with them.
+ */
+struct AsyncIO::IoUring : detail::IoUringRings {
+  IoUring(size_t capacity, const Options& options)
+      : IoUringRings(
+            static_cast<unsigned>(capacity),
+            options.sqPoll ? IORING_SETUP_SQPOLL : 0,
+            options.sqPoll ? static_cast<unsigned>(options.sqPollIdle.count())
+                           : 0),
+        sqPoll(options.sqPoll) {}
+
+  // Returns the index of the registered buffer containing [buf, buf+size),
+  // or -1.
+  int findBuffer(const void* buf, size_t size) const {
+    auto p = static_cast<const char*>(buf);
+    auto iter = std::upper_bound(
+        buffers.begin(),
+        buffers.end(),
+        p,
+        [](const char* needle, const RegisteredBuffer& b) {
+          return needle < b.begin;
+        });
+    if (iter == buffers.begin()) {
+      return -1;
+    }
+    --iter;
+    return p + size <= iter->end ? iter->index : -1;
+  }
+
+  void prepare(io_uring_sqe* sqe, AsyncIOOp* op);
+
+  bool sqPoll{false};
+
+  // Serializes submitters, the SQ tail is ours to maintain.
+  std::mutex submitMutex;
+
+  struct RegisteredBuffer {
+    const char* begin;
+    const char* end;
+    int index;
+  };
+  std::vector<RegisteredBuffer> buffers; // sorted by begin
+  F14ValueMap<int, int> files; // fd -> registered index
+};
+
+#else
+
+struct AsyncIO::IoUring {};
+
+#endif
+
+AsyncIO::AsyncIO(size_t capacity, PollMode pollMode)
+    : AsyncIO(capacity, pollMode, Options()) {}
+
+AsyncIO::AsyncIO(size_t capacity, PollMode pollMode, const Options& options)
+    : options_(options), capacity_(capacity) {
   CHECK_GT(capacity_, 0);
+  if (options_.backend == Backend::IO_URING && !ioUringSupported()) {
+    throw std::runtime_error("AsyncIO: io_uring is not supported");
+  }
   completed_.reserve(capacity_);
   if (pollMode == POLLABLE) {
     pollFd_ = eventfd(0, EFD_NONBLOCK);
@@ -122,11 +209,16 @@ AsyncIO::~AsyncIO() {
     int rc = io_queue_release(ctx_);
     CHECK_EQ(rc, 0) << "io_queue_release: " << errnoStr(-rc);
   }
+  uring_.reset();
   if (pollFd_ != -1) {
     CHECK_ERR(close(pollFd_));
   }
 }
 
+bool AsyncIO::ioUringSupported() {
+  return detail::ioUringSupported();
+}
+
 void AsyncIO::decrementPending() {
   auto p = pending_.fetch_add(-1, std::memory_order_acq_rel);
   DCHECK_GE(p, 1);
@@ -136,6 +228,11 @@ void AsyncIO::initializeContext() {
   if (!ctxSet_.load(std::memory_order_acquire)) {
     std::lock_guard<std::mutex> lock(initMutex_);
     if (!ctxSet_.load(std::memory_order_relaxed)) {
+      if (options_.backend == Backend::IO_URING) {
+        initializeIoUring();
+        ctxSet_.store(true, std::memory_order_release);
+        return;
+      }
       int rc = io_queue_init(capacity_, &ctx_);
       // returns negative errno
       if (rc == -EAGAIN) {
@@ -163,8 +260,16 @@ void AsyncIO::initializeContext() {
 
 void AsyncIO::submit(Op* op) {
   CHECK_EQ(op->state(), Op::State::INITIALIZED);
+  if (op->openat_ && options_.backend != Backend::IO_URING) {
+    throw std::invalid_argument("AsyncIO: openat requires io_uring");
+  }
   initializeContext(); // on demand
 
+  if (options_.backend == Backend::IO_URING) {
+    submitIoUring(Range<Op**>(&op, 1));
+    return;
+  }
+
   // We can increment past capacity, but we'll clean up after ourselves.
   auto p = pending_.fetch_add(1, std::memory_order_acq_rel);
   if (p >= capacity_) {
@@ -186,8 +291,61 @@ void AsyncIO::submit(Op* op) {
   op->start();
 }
 
+size_t AsyncIO::submit(Range<Op**> ops) {
+  for (auto op : ops) {
+    CHECK_EQ(op->state(), Op::State::INITIALIZED);
+    if (op->openat_ && options_.backend != Backend::IO_URING) {
+      throw std::invalid_argument("AsyncIO: openat requires io_uring");
+    }
+  }
+  initializeContext(); // on demand
+
+  if (options_.backend == Backend::IO_URING) {
+    return submitIoUring(ops);
+  }
+  if (ops.empty()) {
+    return 0;
+  }
+
+  auto p = pending_.fetch_add(ops.size(), std::memory_order_acq_rel);
+  if (p + ops.size() > capacity_) {
+    pending_.fetch_sub(ops.size(), std::memory_order_acq_rel);
+    throw std::range_error("AsyncIO: too many pending requests");
+  }
+  std::vector<iocb*> cbs;
+  cbs.reserve(ops.size());
+  for (auto op : ops) {
+    iocb* cb = &op->iocb_;
+    cb->data = nullptr; // unused
+    if (pollFd_ != -1) {
+      io_set_eventfd(cb, pollFd_);
+    }
+    cbs.push_back(cb);
+  }
+
+  // io_submit() stops at the first iocb it can't submit
+  size_t done = 0;
+  while (done < cbs.size()) {
+    int rc = io_submit(ctx_, long(cbs.size() - done), cbs.data() + done);
+    if (rc <= 0) {
+      pending_.fetch_sub(cbs.size() - done, std::memory_order_acq_rel);
+      if (done == 0) {
+        throwSystemErrorExplicit(
+            rc < 0 ? -rc : EAGAIN, "AsyncIO: io_submit failed");
+      }
+      break;
+    }
+    for (size_t i = done; i < done + size_t(rc); ++i) {
+      ops[i]->start();
+    }
+    done += size_t(rc);
+  }
+  submitted_ += done;
+  return done;
+}
+
 Range<AsyncIO::Op**> AsyncIO::wait(size_t minRequests) {
-  CHECK(ctx_);
+  CHECK(ctxSet_.load(std::memory_order_acquire));
   CHECK_EQ(pollFd_, -1) << "wait() only allowed on non-pollable object";
   auto p = pending_.load(std::memory_order_acquire);
   CHECK_LE(minRequests, p);
@@ -195,13 +353,13 @@ Range<AsyncIO::Op**> AsyncIO::wait(size_t minRequests) {
 }
 
 Range<AsyncIO::Op**> AsyncIO::cancel() {
-  CHECK(ctx_);
+  CHECK(ctxSet_.load(std::memory_order_acquire));
   auto p = pending_.load(std::memory_order_acquire);
   return doWait(WaitType::CANCEL, p, p, canceled_);
 }
 
 Range<AsyncIO::Op**> AsyncIO::pollCompleted() {
-  CHECK(ctx_);
+  CHECK(ctxSet_.load(std::memory_order_acquire));
   CHECK_NE(pollFd_, -1) << "pollCompleted() only allowed on pollable object";
   uint64_t numEvents;
   // This sets the eventFd counter to 0, see
@@ -216,6 +374,12 @@ Range<AsyncIO::Op**> AsyncIO::pollCompleted() {
   checkUnixError(rc, "AsyncIO: read from event fd failed");
   DCHECK_EQ(rc, 8);
 
+  if (options_.backend == Backend::IO_URING) {
+    // The counter is bumped once per CQE, but a CQE posted after the read
+    // above may already be visible, so reap whatever is there.
+    return doWait(WaitType::COMPLETE, 0, pending_, completed_);
+  }
+
   DCHECK_GT(numEvents, 0);
   DCHECK_LE(numEvents, pending_);
 
@@ -228,6 +392,10 @@ Range<AsyncIO::Op**> AsyncIO::doWait(
     size_t minRequests,
     size_t maxRequests,
     std::vector<Op*>& result) {
+  if (options_.backend == Backend::IO_URING) {
+    return doWaitIoUring(type, minRequests, maxRequests, result);
+  }
+
   io_event events[maxRequests];
 
   // Unfortunately, Linux AIO doesn't implement io_cancel, so even for
@@ -273,6 +441,257 @@ Range<AsyncIO::Op**> AsyncIO::doWait(
   return range(result);
 }
 
+#if FOLLY_HAVE_IO_URING
+
+void AsyncIO::initializeIoUring() {
+  auto uring = std::make_unique<IoUring>(capacity_, options_);
+  if (pollFd_ != -1) {
+    int rc = detail::ioUringRegister(
+        uring->fd, IORING_REGISTER_EVENTFD, &pollFd_, 1);
+    checkUnixError(rc, "AsyncIO: registering the eventfd failed");
+  }
+  uring_ = std::move(uring);
+}
+
+void AsyncIO::registerBuffers(Range<const iovec*> buffers) {
+  if (options_.backend != Backend::IO_URING) {
+    throw std::invalid_argument("AsyncIO: registerBuffers requires io_uring");
+  }
+  initializeContext();
+  CHECK(uring_->buffers.empty()) << "buffers may only be registered once";
+  CHECK_EQ(totalSubmits(), 0);
+  int rc = detail::ioUringRegister(
+      uring_->fd,
+      IORING_REGISTER_BUFFERS,
+      buffers.begin(),
+      static_cast<unsigned>(buffers.size()));
+  checkUnixError(rc, "AsyncIO: io_uring buffer registration failed");
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    auto begin = static_cast<const char*>(buffers[i].iov_base);
+    uring_->buffers.push_back(
+        {begin, begin + buffers[i].iov_len, static_cast<int>(i)});
+  }
+  std::sort(
+      uring_->buffers.begin(),
+      uring_->buffers.end(),
+      [](const IoUring::RegisteredBuffer& a,
+         const IoUring::RegisteredBuffer& b) { return a.begin < b.begin; });
+}
+
+void AsyncIO::registerFiles(Range<const int*> fds) {
+  if (options_.backend != Backend::IO_URING) {
+    throw std::invalid_argument("AsyncIO: registerFiles requires io_uring");
+  }
+  initializeContext();
+  CHECK(uring_->files.empty()) << "files may only be registered once";
+  CHECK_EQ(totalSubmits(), 0);
+  int rc = detail::ioUringRegister(
+      uring_->fd,
+      IORING_REGISTER_FILES,
+      fds.begin(),
+      static_cast<unsigned>(fds.size()));
+  checkUnixError(rc, "AsyncIO: io_uring file registration failed");
+  for (size_t i = 0; i < fds.size(); ++i) {
+    uring_->files.emplace(fds[i], static_cast<int>(i));
+  }
+}
+
+void AsyncIO::IoUring::prepare(io_uring_sqe* sqe, AsyncIOOp* op) {
+  memset(sqe, 0, sizeof(*sqe));
+  const iocb& cb = op->iocb_;
+  sqe->fd = cb.aio_fildes;
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+
+  if (op->openat_) {
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->addr = reinterpret_cast<uintptr_t>(op->openatPath_);
+    sqe->len = op->openatMode_;
+    sqe->open_flags = static_cast<uint32_t>(op->openatFlags_);
+    return; // the dirfd can't be a registered file
+  }
+
+  switch (cb.aio_lio_opcode) {
+    case IO_CMD_PREAD:
+    case IO_CMD_PWRITE: {
+      bool read = cb.aio_lio_opcode == IO_CMD_PREAD;
+      int index = findBuffer(cb.u.c.buf, cb.u.c.nbytes);
+      if (index >= 0) {
+        sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->addr = reinterpret_cast<uintptr_t>(cb.u.c.buf);
+        sqe->len = static_cast<uint32_t>(cb.u.c.nbytes);
+        sqe->buf_index = static_cast<uint16_t>(index);
+      } else {
+        // READV / WRITEV work on every io_uring kernel, READ / WRITE
+        // need 5.6
+        op->iov_.iov_base = cb.u.c.buf;
+        op->iov_.iov_len = cb.u.c.nbytes;
+        sqe->opcode = read ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->addr = reinterpret_cast<uintptr_t>(&op->iov_);
+        sqe->len = 1;
+      }
+      sqe->off = static_cast<uint64_t>(cb.u.c.offset);
+      break;
+    }
+    case IO_CMD_PREADV:
+    case IO_CMD_PWRITEV:
+      sqe->opcode = cb.aio_lio_opcode == IO_CMD_PREADV ? IORING_OP_READV
+                                                       : IORING_OP_WRITEV;
+      sqe->addr = reinterpret_cast<uintptr_t>(cb.u.v.vec);
+      sqe->len = static_cast<uint32_t>(cb.u.v.nr);
+      sqe->off = static_cast<uint64_t>(cb.u.v.offset);
+      break;
+    case IO_CMD_FSYNC:
+    case IO_CMD_FDSYNC:
+      sqe->opcode = IORING_OP_FSYNC;
+      if (cb.aio_lio_opcode == IO_CMD_FDSYNC) {
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      }
+      break;
+    default:
+      LOG(FATAL) << "AsyncIO: unsupported op " << *op;
+  }
+
+  if (!files.empty()) {
+    auto iter = files.find(sqe->fd);
+    if (iter != files.end()) {
+      sqe->fd = iter->second;
+      sqe->flags |= IOSQE_FIXED_FILE;
+    }
+  }
+}
+
+size_t AsyncIO::submitIoUring(Range<Op**> ops) {
+  if (ops.empty()) {
+    return 0;
+  }
+  auto p = pending_.fetch_add(ops.size(), std::memory_order_acq_rel);
+  if (p + ops.size() > capacity_) {
+    pending_.fetch_sub(ops.size(), std::memory_order_acq_rel);
+    throw std::range_error("AsyncIO: too many pending requests");
+  }
+
+  auto& uring = *uring_;
+  std::lock_guard<std::mutex> lock(uring.submitMutex);
+  unsigned tail = *uring.sqTail;
+  for (auto op : ops) {
+    unsigned index = tail & uring.sqMask;
+    uring.prepare(&uring.sqes[index], op);
+    uring.sqArray[index] = index;
+    // before publishing, the completion may be reaped immediately
+    op->start();
+    ++tail;
+  }
+  __atomic_store_n(uring.sqTail, tail, __ATOMIC_RELEASE);
+
+  if (uring.sqPoll) {
+    if (__atomic_load_n(uring.sqFlags, __ATOMIC_ACQUIRE) &
+        IORING_SQ_NEED_WAKEUP) {
+      detail::ioUringEnter(uring.fd, 0, 0, IORING_ENTER_SQ_WAKEUP);
+    }
+  } else {
+    size_t toSubmit = ops.size();
+    while (toSubmit > 0) {
+      int rc = detail::ioUringEnter(
+          uring.fd, static_cast<unsigned>(toSubmit), 0, 0);
+      if (rc < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // The kernel consumed nothing more, take the remaining entries
+        // back out of the ring.
+        int err = errno;
+        *uring.sqTail = tail - static_cast<unsigned>(toSubmit);
+        for (size_t i = ops.size() - toSubmit; i < ops.size(); ++i) {
+          ops[i]->state_ = Op::State::INITIALIZED;
+        }
+        pending_.fetch_sub(toSubmit, std::memory_order_acq_rel);
+        size_t done = ops.size() - toSubmit;
+        submitted_ += done;
+        if (done == 0) {
+          throwSystemErrorExplicit(err, "AsyncIO: io_uring_enter failed");
+        }
+        return done;
+      }
+      toSubmit -= static_cast<size_t>(rc);
+    }
+  }
+  submitted_ += ops.size();
+  return ops.size();
+}
+
+Range<AsyncIO::Op**> AsyncIO::doWaitIoUring(
+    WaitType type,
+    size_t minRequests,
+    size_t maxRequests,
+    std::vector<Op*>& result) {
+  auto& uring = *uring_;
+  result.clear();
+  // There is no way to cancel in-flight disk IO either, wait for it.
+  while (true) {
+    unsigned head = *uring.cqHead;
+    unsigned tail = __atomic_load_n(uring.cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail && result.size() < maxRequests) {
+      const io_uring_cqe& cqe = uring.cqes[head & uring.cqMask];
+      auto op = reinterpret_cast<Op*>(static_cast<uintptr_t>(cqe.user_data));
+      ssize_t res = cqe.res;
+      ++head;
+      // release the slot before running callbacks, which may submit
+      __atomic_store_n(uring.cqHead, head, __ATOMIC_RELEASE);
+      decrementPending();
+      switch (type) {
+        case WaitType::COMPLETE:
+          op->complete(res);
+          break;
+        case WaitType::CANCEL:
+          op->cancel();
+          break;
+      }
+      result.push_back(op);
+    }
+    if (result.size() >= minRequests) {
+      break;
+    }
+    int rc = detail::ioUringEnter(
+        uring.fd,
+        0,
+        static_cast<unsigned>(minRequests - result.size()),
+        IORING_ENTER_GETEVENTS);
+    CHECK(rc >= 0 || errno == EINTR)
+        << "AsyncIO: io_uring_enter failed with error " << errnoStr(errno);
+  }
+  return range(result);
+}
+
+#else
+
+void AsyncIO::initializeIoUring() {
+  throw std::runtime_error("AsyncIO: io_uring is not supported");
+}
+
+void AsyncIO::registerBuffers(Range<const iovec*>) {
+  throw std::invalid_argument("AsyncIO: registerBuffers requires io_uring");
+}
+
+void AsyncIO::registerFiles(Range<const int*>) {
+  throw std::invalid_argument("AsyncIO: registerFiles requires io_uring");
+}
+
+size_t AsyncIO::submitIoUring(Range<Op**>) {
+  initializeIoUring();
+  return 0;
+}
+
+Range<AsyncIO::Op**> AsyncIO::doWaitIoUring(
+    WaitType,
+    size_t,
+    size_t,
+    std::vector<Op*>&) {
+  initializeIoUring();
+  return Range<Op**>();
+}
+
+#endif
+
 AsyncIOQueue::AsyncIOQueue(AsyncIO* asyncIO) : asyncIO_(asyncIO) {}
 
 AsyncIOQueue::~AsyncIOQueue() {
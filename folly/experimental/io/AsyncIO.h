@@ -19,10 +19,12 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <iosfwd>
+#include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
@@ -74,6 +76,19 @@ class AsyncIOOp : private boost::noncopyable {
   void pwrite(int fd, Range<const unsigned char*> range, off_t start);
   void pwritev(int fd, const iovec* iov, int iovcnt, off_t start);
 
+  /**
+   * Initiate an fsync / fdatasync request.
+   */
+  void fsync(int fd);
+  void fdatasync(int fd);
+
+  /**
+   * Initiate an openat(2) request; on success result() is the new file
+   * descriptor.  path must remain valid until the op completes.  Only
+   * supported by the io_uring backend (see AsyncIO::Backend).
+   */
+  void openat(int dirfd, const char* path, int flags, mode_t mode = 0);
+
   /**
    * Return the current operation state.
    */
@@ -114,6 +129,17 @@ class AsyncIOOp : private boost::noncopyable {
   iocb iocb_;
   State state_;
   ssize_t result_;
+
+  // openat() can't be expressed as an iocb, its arguments are kept here
+  // (and iocb_.aio_fildes holds the dirfd).
+  bool openat_{false};
+  const char* openatPath_{nullptr};
+  int openatFlags_{0};
+  mode_t openatMode_{0};
+
+  // Storage for the single-buffer iovec used by pread / pwrite when
+  // submitted through io_uring.
+  iovec iov_;
 };
 
 std::ostream& operator<<(std::ostream& stream, const AsyncIOOp& o);
@@ -121,6 +147,14 @@ std::ostream& operator<<(std::ostream& stream, AsyncIOOp::State state);
 
 /**
  * C++ interface around Linux Async IO.
+ *
+ * Two kernel interfaces are supported.  The default, libaio (io_submit /
+ * io_getevents), only behaves asynchronously for O_DIRECT files and costs
+ * at least one syscall per submit and per reap.  io_uring (Linux 5.1+)
+ * also handles buffered IO, fsync and (5.6+) openat, and shares submission
+ * and completion rings with the kernel, so a batch of ops is submitted
+ * with one syscall and completions are reaped without any syscall at all
+ * when they are already available.
  */
 class AsyncIO : private boost::noncopyable {
  public:
@@ -131,6 +165,22 @@ class AsyncIO : private boost::noncopyable {
     POLLABLE,
   };
 
+  enum class Backend {
+    LIBAIO,
+    IO_URING,
+  };
+
+  struct Options {
+    Backend backend{Backend::LIBAIO};
+
+    // io_uring only: have a kernel thread poll the submission ring, so
+    // that submit() doesn't make a syscall at all as long as the thread is
+    // busy.  The thread goes to sleep after sqPollIdle without work.
+    // Usually requires CAP_SYS_NICE (or Linux 5.11+).
+    bool sqPoll{false};
+    std::chrono::milliseconds sqPollIdle{1000};
+  };
+
   /**
    * Create an AsyncIO context capable of holding at most 'capacity' pending
    * requests at the same time.  As requests complete, others can be scheduled,
@@ -152,8 +202,19 @@ class AsyncIO : private boost::noncopyable {
    * of the current number of pending requests.
    */
   explicit AsyncIO(size_t capacity, PollMode pollMode = NOT_POLLABLE);
+  AsyncIO(size_t capacity, PollMode pollMode, const Options& options);
   ~AsyncIO();
 
+  /**
+   * Return true if the running kernel supports io_uring (and it isn't
+   * disabled by a seccomp policy or sysctl).
+   */
+  static bool ioUringSupported();
+
+  Backend backend() const {
+    return options_.backend;
+  }
+
   /**
    * Wait for at least minRequests to complete.  Returns the requests that
    * have completed; the returned range is valid until the next call to
@@ -211,18 +272,61 @@ class AsyncIO : private boost::noncopyable {
    */
   void submit(Op* op);
 
+  /**
+   * Submit a batch of ops, in order.  With io_uring the whole batch costs a
+   * single syscall (none with sqPoll), and with libaio a single io_submit()
+   * unless the kernel stops short.
+   *
+   * Throws, and submits none of them, if they don't all fit in the
+   * capacity, or if the kernel refuses the first one.  If the kernel
+   * refuses an op after accepting earlier ones, returns the number of ops
+   * submitted: the ops past those are left INITIALIZED, and may be
+   * submitted again.  Otherwise returns ops.size().
+   */
+  size_t submit(Range<Op**> ops);
+
+  /**
+   * io_uring only: register buffers with the kernel, which then keeps
+   * them mapped instead of pinning the pages on every IO.  pread / pwrite
+   * ops whose buffer lies entirely within a registered buffer use the
+   * fixed-buffer opcodes automatically.  May only be called once, before
+   * any op is submitted; the memory must stay valid for the lifetime of
+   * this object.
+   */
+  void registerBuffers(Range<const iovec*> buffers);
+
+  /**
+   * io_uring only: register file descriptors with the kernel, which saves
+   * the per-IO file table lookup and reference counting.  Ops on
+   * registered fds use them automatically.  May only be called once,
+   * before any op is submitted; the fds must stay open for the lifetime of
+   * this object.
+   */
+  void registerFiles(Range<const int*> fds);
+
  private:
+  struct IoUring;
+  enum class WaitType { COMPLETE, CANCEL };
+
   void decrementPending();
   void initializeContext();
+  void initializeIoUring();
+  size_t submitIoUring(Range<Op**> ops);
+  Range<AsyncIO::Op**> doWaitIoUring(
+      WaitType type,
+      size_t minRequests,
+      size_t maxRequests,
+      std::vector<Op*>& result);
 
-  enum class WaitType { COMPLETE, CANCEL };
   Range<AsyncIO::Op**> doWait(
       WaitType type,
       size_t minRequests,
       size_t maxRequests,
       std::vector<Op*>& result);
 
+  const Options options_;
   io_context_t ctx_{nullptr};
+  std::unique_ptr<IoUring> uring_;
   std::atomic<bool> ctxSet_{false};
   std::mutex initMutex_;
 
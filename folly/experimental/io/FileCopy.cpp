@@ -0,0 +1,271 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/io/FileCopy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/futures/Future.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Memory.h>
+#include <folly/portability/SysStat.h>
+
+namespace folly {
+
+namespace {
+
+size_t roundUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+void adviseWillNeed(int fd, off_t offset, size_t len) {
+#if __linux__
+  // Only a hint: ignore errors
+  posix_fadvise(fd, offset, off_t(len), POSIX_FADV_WILLNEED);
+#else
+  (void)fd, (void)offset, (void)len;
+#endif
+}
+
+void adviseDontNeed(int fd, off_t offset, size_t len) {
+#if __linux__
+  posix_fadvise(fd, offset, off_t(len), POSIX_FADV_DONTNEED);
+#else
+  (void)fd, (void)offset, (void)len;
+#endif
+}
+
+// Opens with O_DIRECT if *direct and the filesystem allows it, and sets
+// *direct to whether it did.
+File openFile(StringPiece filename, int flags, mode_t mode, bool* direct) {
+  auto const path = filename.str();
+  int fd;
+#ifdef O_DIRECT
+  if (*direct) {
+    fd = openNoInt(path.c_str(), flags | O_DIRECT, mode);
+    if (fd != -1 || errno != EINVAL) {
+      checkUnixError(fd, "open: ", filename);
+      return File(fd, /*ownsFd=*/true);
+    }
+    // EINVAL: the filesystem doesn't support O_DIRECT (tmpfs, for one)
+  }
+#endif
+  *direct = false;
+  fd = openNoInt(path.c_str(), flags, mode);
+  checkUnixError(fd, "open: ", filename);
+  return File(fd, /*ownsFd=*/true);
+}
+
+struct AlignedFree {
+  void operator()(void* p) const { detail::aligned_free(p); }
+};
+
+/**
+ * Calls fn(offset, length, buffer) for the chunks of the first size bytes
+ * of inFd, from up to options.parallelism tasks on the executor, or from
+ * this thread, and gives the kernel the hints of the options around it.
+ * With direct, chunks are aligned for O_DIRECT, and each task has its own
+ * aligned buffer of a chunk.
+ */
+template <class F>
+void forEachChunk(
+    int inFd,
+    size_t size,
+    bool direct,
+    Executor* executor,
+    const FileCopyOptions& options,
+    F fn) {
+  if (options.chunkSize == 0) {
+    throw std::invalid_argument("FileCopyOptions: chunkSize must be > 0");
+  }
+  auto const chunkSize = direct
+      ? roundUp(options.chunkSize, kDirectIOAlignment)
+      : options.chunkSize;
+  auto const count = (size + chunkSize - 1) / chunkSize;
+  auto parallelism = options.parallelism;
+  if (parallelism == 0) {
+    parallelism = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  if (!executor) {
+    parallelism = 1;
+  }
+  parallelism = std::min(parallelism, count);
+  // Each task's next chunk is about this far ahead of its current one
+  auto const readaheadDistance = parallelism * chunkSize;
+
+  // Tasks take the next chunk as they finish one, so that a slow request
+  // doesn't hold up the others
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    std::unique_ptr<char, AlignedFree> buffer;
+    if (direct) {
+      buffer.reset(static_cast<char*>(
+          detail::aligned_malloc(chunkSize, kDirectIOAlignment)));
+      if (!buffer) {
+        throw std::bad_alloc();
+      }
+    }
+    size_t i;
+    while ((i = next.fetch_add(1)) < count) {
+      auto const offset = i * chunkSize;
+      auto const len = std::min(chunkSize, size - offset);
+      if (options.readahead && !direct &&
+          offset + readaheadDistance < size) {
+        adviseWillNeed(inFd, off_t(offset + readaheadDistance), chunkSize);
+      }
+      fn(off_t(offset), len, buffer.get());
+      if (options.dropCache) {
+        adviseDontNeed(inFd, off_t(offset), len);
+      }
+    }
+  };
+
+  if (parallelism <= 1) {
+    work();
+    return;
+  }
+  std::vector<Future<Unit>> futures;
+  futures.reserve(parallelism);
+  for (size_t i = 0; i < parallelism; ++i) {
+    futures.push_back(via(executor, work));
+  }
+  // Waits for all of them, as they use this frame
+  for (auto& t : collectAll(futures).get()) {
+    t.throwIfFailed();
+  }
+}
+
+[[noreturn]] void throwShortFile() {
+  throw std::runtime_error("file is shorter than expected");
+}
+
+// Copies the first size bytes; with direct, the last chunk is written
+// rounded up to kDirectIOAlignment, for the caller to truncate.
+void copyChunks(
+    int inFd,
+    int outFd,
+    size_t size,
+    bool direct,
+    Executor* executor,
+    const FileCopyOptions& options) {
+  forEachChunk(
+      inFd,
+      size,
+      direct,
+      executor,
+      options,
+      [&](off_t offset, size_t len, char* buffer) {
+        if (direct) {
+          auto const alignedLen = roundUp(len, kDirectIOAlignment);
+          auto r = preadFull(inFd, buffer, alignedLen, offset);
+          checkUnixError(r, "pread");
+          if (size_t(r) < len) {
+            throwShortFile();
+          }
+          r = pwriteFull(outFd, buffer, alignedLen, offset);
+          checkUnixError(r, "pwrite");
+        } else {
+          auto r = pcopyFull(inFd, offset, outFd, offset, len);
+          checkUnixError(r, "copy");
+          if (size_t(r) < len) {
+            throwShortFile();
+          }
+        }
+      });
+}
+
+} // namespace
+
+void copyFile(
+    StringPiece from,
+    StringPiece to,
+    Executor* executor,
+    const FileCopyOptions& options) {
+  bool inDirect = options.directIO;
+  auto in = openFile(from, O_RDONLY | O_CLOEXEC, 0, &inDirect);
+  struct stat st;
+  checkUnixError(fstat(in.fd(), &st), "fstat: ", from);
+  auto const size = size_t(st.st_size);
+
+  bool outDirect = options.directIO;
+  auto out = openFile(
+      to,
+      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+      st.st_mode & 0777,
+      &outDirect);
+  // Aligned requests also work on a file without O_DIRECT
+  auto const direct = inDirect || outDirect;
+  copyChunks(in.fd(), out.fd(), size, direct, executor, options);
+  if (direct) {
+    checkUnixError(ftruncateNoInt(out.fd(), off_t(size)), "ftruncate: ", to);
+  }
+  out.close();
+}
+
+void copyFileRange(
+    int inFd,
+    int outFd,
+    size_t size,
+    Executor* executor,
+    const FileCopyOptions& options) {
+  copyChunks(inFd, outFd, size, false, executor, options);
+}
+
+std::string readFileParallel(
+    StringPiece filename,
+    Executor* executor,
+    const FileCopyOptions& options) {
+  bool direct = options.directIO;
+  auto in = openFile(filename, O_RDONLY | O_CLOEXEC, 0, &direct);
+  struct stat st;
+  checkUnixError(fstat(in.fd(), &st), "fstat: ", filename);
+  auto const size = size_t(st.st_size);
+  std::string out(size, '\0');
+
+  forEachChunk(
+      in.fd(),
+      size,
+      direct,
+      executor,
+      options,
+      [&](off_t offset, size_t len, char* buffer) {
+        ssize_t r;
+        if (direct) {
+          r = preadFull(
+              in.fd(), buffer, roundUp(len, kDirectIOAlignment), offset);
+          checkUnixError(r, "pread: ", filename);
+          memcpy(&out[size_t(offset)], buffer, std::min(size_t(r), len));
+        } else {
+          r = preadFull(in.fd(), &out[size_t(offset)], len, offset);
+          checkUnixError(r, "pread: ", filename);
+        }
+        if (size_t(r) < len) {
+          throwShortFile();
+        }
+      });
+  return out;
+}
+
+} // namespace folly
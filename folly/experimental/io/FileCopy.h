@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Copying and reading large files with several concurrent requests in
+ * flight, which is what it takes to approach the bandwidth of SSDs and of
+ * striped disks.
+ *
+ * The file is divided into chunks, which up to `parallelism` tasks on an
+ * executor copy or read, taking the next chunk as they finish one.  Without
+ * an executor, the calling thread does all the work, one chunk at a time.
+ *
+ * Copies go through pcopyFull() (see FileUtil.h), so the kernel copies the
+ * data when the filesystems allow it.  With directIO, data instead goes
+ * through aligned buffers, with O_DIRECT, bypassing the page cache.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <folly/Executor.h>
+#include <folly/Range.h>
+
+namespace folly {
+
+struct FileCopyOptions {
+  FileCopyOptions() {}
+
+  FileCopyOptions& setChunkSize(size_t v) { chunkSize = v; return *this; }
+  FileCopyOptions& setParallelism(size_t v) { parallelism = v; return *this; }
+  FileCopyOptions& setDirectIO(bool v) { directIO = v; return *this; }
+  FileCopyOptions& setReadahead(bool v) { readahead = v; return *this; }
+  FileCopyOptions& setDropCache(bool v) { dropCache = v; return *this; }
+
+  // Bytes per request; rounded up to kDirectIOAlignment with directIO
+  size_t chunkSize = 8 << 20;
+  // Tasks on the executor; 0 for the number of CPUs
+  size_t parallelism = 0;
+  // Open the files with O_DIRECT, where the platform and the filesystem
+  // support it; otherwise, ignored
+  bool directIO = false;
+  // Ask the kernel to read ahead the chunk that each task will likely take
+  // next, while it works on the current one
+  bool readahead = true;
+  // Drop the chunks of the source from the page cache once they're done,
+  // so that copying a large file doesn't evict everything else
+  bool dropCache = false;
+};
+
+// Alignment of the offsets, lengths and buffers of directIO requests
+constexpr size_t kDirectIOAlignment = 4096;
+
+/**
+ * Copy the contents of the file `from` to `to`, which is created (with the
+ * permission bits of `from`) or truncated.  Throws std::system_error on
+ * error, leaving `to` partially written.
+ *
+ * Blocks until the copy is done, so it mustn't be called from the threads
+ * of the executor.
+ */
+void copyFile(
+    StringPiece from,
+    StringPiece to,
+    Executor* executor = nullptr,
+    const FileCopyOptions& options = FileCopyOptions());
+
+/**
+ * Copy the first `size` bytes of inFd to outFd, at the same offsets,
+ * without changing the file offsets.  outFd is not truncated or extended;
+ * writing past its end extends it.  Throws std::system_error on error, and
+ * std::runtime_error if inFd has fewer than `size` bytes.
+ *
+ * options.directIO only applies to the files that copyFile() and
+ * readFileParallel() open themselves.
+ */
+void copyFileRange(
+    int inFd,
+    int outFd,
+    size_t size,
+    Executor* executor = nullptr,
+    const FileCopyOptions& options = FileCopyOptions());
+
+/**
+ * Read the whole file into a string, as readFile() does, but with chunks
+ * read concurrently.  The size of the file is taken when it's opened.
+ * Throws std::system_error on error.
+ */
+std::string readFileParallel(
+    StringPiece filename,
+    Executor* executor = nullptr,
+    const FileCopyOptions& options = FileCopyOptions());
+
+} // namespace folly
@@ -132,8 +132,9 @@ ManagedBuffer allocateAligned(size_t size) {
 
 void testReadsSerially(
     const std::vector<TestSpec>& specs,
-    AsyncIO::PollMode pollMode) {
-  AsyncIO aioReader(1, pollMode);
+    AsyncIO::PollMode pollMode,
+    const AsyncIO::Options& options = AsyncIO::Options()) {
+  AsyncIO aioReader(1, pollMode, options);
   AsyncIO::Op op;
   int fd = ::open(tempFile.path().c_str(), O_DIRECT | O_RDONLY);
   PCHECK(fd != -1);
@@ -161,8 +162,9 @@ void testReadsSerially(
 void testReadsParallel(
     const std::vector<TestSpec>& specs,
     AsyncIO::PollMode pollMode,
-    bool multithreaded) {
-  AsyncIO aioReader(specs.size(), pollMode);
+    bool multithreaded,
+    const AsyncIO::Options& options = AsyncIO::Options()) {
+  AsyncIO aioReader(specs.size(), pollMode, options);
   std::unique_ptr<AsyncIO::Op[]> ops(new AsyncIO::Op[specs.size()]);
   std::vector<ManagedBuffer> bufs;
   bufs.reserve(specs.size());
@@ -225,9 +227,10 @@ void testReadsParallel(
 
 void testReadsQueued(
     const std::vector<TestSpec>& specs,
-    AsyncIO::PollMode pollMode) {
+    AsyncIO::PollMode pollMode,
+    const AsyncIO::Options& options = AsyncIO::Options()) {
   size_t readerCapacity = std::max(specs.size() / 2, size_t(1));
-  AsyncIO aioReader(readerCapacity, pollMode);
+  AsyncIO aioReader(readerCapacity, pollMode, options);
   AsyncIOQueue aioQueue(&aioReader);
   std::unique_ptr<AsyncIO::Op[]> ops(new AsyncIO::Op[specs.size()]);
   std::vector<ManagedBuffer> bufs;
@@ -277,11 +280,20 @@ void testReadsQueued(
   }
 }
 
-void testReads(const std::vector<TestSpec>& specs, AsyncIO::PollMode pollMode) {
-  testReadsSerially(specs, pollMode);
-  testReadsParallel(specs, pollMode, false);
-  testReadsParallel(specs, pollMode, true);
-  testReadsQueued(specs, pollMode);
+void testReads(
+    const std::vector<TestSpec>& specs,
+    AsyncIO::PollMode pollMode,
+    const AsyncIO::Options& options = AsyncIO::Options()) {
+  testReadsSerially(specs, pollMode, options);
+  testReadsParallel(specs, pollMode, false, options);
+  testReadsParallel(specs, pollMode, true, options);
+  testReadsQueued(specs, pollMode, options);
+}
+
+AsyncIO::Options ioUringOptions() {
+  AsyncIO::Options options;
+  options.backend = AsyncIO::Backend::IO_URING;
+  return options;
 }
 
 } // namespace
@@ -457,3 +469,173 @@ TEST(AsyncIO, Cancel) {
   }
   EXPECT_EQ(foundCompleted, completed);
 }
+
+TEST(AsyncIO, SubmitBatch) {
+  constexpr size_t kNumOps = 4;
+  AsyncIO aio(kNumOps, AsyncIO::NOT_POLLABLE);
+  int fd = ::open(tempFile.path().c_str(), O_DIRECT | O_RDONLY);
+  PCHECK(fd != -1);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+
+  auto buf = allocateAligned((kNumOps + 1) * kAlign);
+  std::vector<AsyncIO::Op> ops(kNumOps + 1);
+  std::vector<AsyncIO::Op*> batch;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    ops[i].pread(fd, buf.get() + i * kAlign, kAlign, off_t(i * kAlign));
+    batch.push_back(&ops[i]);
+  }
+
+  // Over capacity: none is submitted
+  EXPECT_THROW(aio.submit(folly::range(batch)), std::range_error);
+  EXPECT_EQ(0, aio.pending());
+  for (auto& op : ops) {
+    EXPECT_EQ(AsyncIO::Op::State::INITIALIZED, op.state());
+  }
+
+  batch.pop_back();
+  EXPECT_EQ(kNumOps, aio.submit(folly::range(batch)));
+  EXPECT_EQ(kNumOps, aio.pending());
+  EXPECT_EQ(kNumOps, aio.totalSubmits());
+  size_t done = 0;
+  while (done < kNumOps) {
+    done += aio.wait(1).size();
+  }
+  for (size_t i = 0; i < kNumOps; ++i) {
+    EXPECT_EQ(kAlign, ops[i].result()) << folly::errnoStr(-ops[i].result());
+  }
+}
+
+TEST(AsyncIO, IoUringReadsNotPollable) {
+  if (!AsyncIO::ioUringSupported()) {
+    return;
+  }
+  std::vector<TestSpec> specs;
+  for (int i = 0; i < 20; i++) {
+    specs.push_back({off_t(i * kAlign), (i % 4 + 1) * kAlign});
+  }
+  testReads({{0, 0}}, AsyncIO::NOT_POLLABLE, ioUringOptions());
+  testReads(specs, AsyncIO::NOT_POLLABLE, ioUringOptions());
+}
+
+TEST(AsyncIO, IoUringReadsPollable) {
+  if (!AsyncIO::ioUringSupported()) {
+    return;
+  }
+  std::vector<TestSpec> specs;
+  for (int i = 0; i < 20; i++) {
+    specs.push_back({off_t(i * kAlign), (i % 4 + 1) * kAlign});
+  }
+  testReads(specs, AsyncIO::POLLABLE, ioUringOptions());
+}
+
+TEST(AsyncIO, IoUringBufferedWriteAndFsync) {
+  if (!AsyncIO::ioUringSupported()) {
+    return;
+  }
+  auto path = fs::temp_directory_path() / fs::unique_path();
+  int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  PCHECK(fd != -1);
+  SCOPE_EXIT {
+    ::close(fd);
+    fs::remove(path);
+  };
+
+  AsyncIO aio(3, AsyncIO::NOT_POLLABLE, ioUringOptions());
+  std::string data(1000, 'x');
+  AsyncIO::Op write;
+  write.pwrite(fd, data.data(), data.size(), 0);
+  aio.submit(&write);
+  auto ops = aio.wait(1);
+  ASSERT_EQ(1, ops.size());
+  EXPECT_EQ(data.size(), write.result());
+
+  AsyncIO::Op sync;
+  sync.fsync(fd);
+  AsyncIO::Op datasync;
+  datasync.fdatasync(fd);
+  AsyncIO::Op* batch[] = {&sync, &datasync};
+  EXPECT_EQ(2, aio.submit(folly::range(batch)));
+  EXPECT_EQ(2, aio.pending());
+  EXPECT_EQ(3, aio.totalSubmits());
+  aio.wait(2);
+  EXPECT_EQ(0, sync.result());
+  EXPECT_EQ(0, datasync.result());
+
+  std::string read(data.size(), '\0');
+  AsyncIO::Op readOp;
+  readOp.pread(fd, &read[0], read.size(), 0);
+  aio.submit(&readOp);
+  aio.wait(1);
+  EXPECT_EQ(data.size(), readOp.result());
+  EXPECT_EQ(data, read);
+}
+
+TEST(AsyncIO, IoUringOpenat) {
+  if (!AsyncIO::ioUringSupported()) {
+    return;
+  }
+  AsyncIO aio(1, AsyncIO::NOT_POLLABLE, ioUringOptions());
+  AsyncIO::Op op;
+  auto path = tempFile.path(); // must outlive the op
+  op.openat(AT_FDCWD, path.c_str(), O_RDONLY);
+  aio.submit(&op);
+  aio.wait(1);
+  auto fd = op.result();
+  if (fd == -EINVAL) {
+    return; // IORING_OP_OPENAT needs Linux 5.6
+  }
+  ASSERT_GE(fd, 0) << folly::errnoStr(-fd);
+  ::close(int(fd));
+
+  op.reset();
+  op.openat(AT_FDCWD, "/nonexistent/file", O_RDONLY);
+  aio.submit(&op);
+  aio.wait(1);
+  EXPECT_EQ(-ENOENT, op.result());
+}
+
+TEST(AsyncIO, IoUringRegistered) {
+  if (!AsyncIO::ioUringSupported()) {
+    return;
+  }
+  int fd = ::open(tempFile.path().c_str(), O_DIRECT | O_RDONLY);
+  PCHECK(fd != -1);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+
+  constexpr size_t kNumOps = 8;
+  auto buf = allocateAligned(kNumOps * kAlign);
+  iovec iov{buf.get(), kNumOps * kAlign};
+
+  AsyncIO aio(kNumOps, AsyncIO::NOT_POLLABLE, ioUringOptions());
+  aio.registerBuffers(folly::Range<const iovec*>(&iov, 1));
+  aio.registerFiles(folly::Range<const int*>(&fd, 1));
+
+  std::vector<AsyncIO::Op> ops(kNumOps);
+  std::vector<AsyncIO::Op*> batch;
+  for (size_t i = 0; i < kNumOps; ++i) {
+    ops[i].pread(fd, buf.get() + i * kAlign, kAlign, off_t(i * kAlign));
+    batch.push_back(&ops[i]);
+  }
+  aio.submit(folly::range(batch));
+  size_t done = 0;
+  while (done < kNumOps) {
+    done += aio.wait(1).size();
+  }
+  for (auto& op : ops) {
+    EXPECT_EQ(kAlign, op.result()) << folly::errnoStr(-op.result());
+  }
+}
+
+TEST(AsyncIO, IoUringRequiredForOpenatAndRegistration) {
+  AsyncIO aio(1, AsyncIO::NOT_POLLABLE);
+  AsyncIO::Op op;
+  op.openat(AT_FDCWD, "/", O_RDONLY);
+  EXPECT_THROW(aio.submit(&op), std::logic_error);
+  int fd = 0;
+  EXPECT_THROW(
+      aio.registerFiles(folly::Range<const int*>(&fd, 1)), std::logic_error);
+}
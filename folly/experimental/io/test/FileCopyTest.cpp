@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/io/FileCopy.h>
+
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/SysStat.h>
+
+using namespace folly;
+using folly::test::TemporaryDirectory;
+
+namespace {
+
+std::string makeData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = char(i * 7 + i / 251);
+  }
+  return data;
+}
+
+std::string readAll(const std::string& path) {
+  std::string contents;
+  EXPECT_TRUE(readFile(path.c_str(), contents));
+  return contents;
+}
+
+} // namespace
+
+class FileCopyTest : public ::testing::TestWithParam<bool> {
+ protected:
+  std::string path(StringPiece name) const {
+    return (dir_.path() / name.str()).string();
+  }
+
+  // Small chunks, so that there are many of them
+  FileCopyOptions options() const {
+    return FileCopyOptions()
+        .setChunkSize(10000)
+        .setParallelism(4)
+        .setDirectIO(GetParam())
+        .setDropCache(true);
+  }
+
+  TemporaryDirectory dir_;
+  CPUThreadPoolExecutor executor_{4};
+};
+
+TEST_P(FileCopyTest, CopyFile) {
+  for (size_t size : {0, 1, 4096, 10000, 123457}) {
+    auto data = makeData(size);
+    ASSERT_TRUE(writeFile(data, path("in").c_str()));
+    ASSERT_EQ(0, chmod(path("in").c_str(), 0640));
+
+    copyFile(path("in"), path("out"), &executor_, options());
+    EXPECT_EQ(data, readAll(path("out")));
+    struct stat st;
+    ASSERT_EQ(0, stat(path("out").c_str(), &st));
+    EXPECT_EQ(0640, st.st_mode & 0777);
+
+    // Without an executor, and over an existing file
+    ASSERT_TRUE(writeFile(makeData(size + 5000), path("out").c_str()));
+    copyFile(path("in"), path("out"), nullptr, options());
+    EXPECT_EQ(data, readAll(path("out")));
+  }
+}
+
+TEST_P(FileCopyTest, ReadFileParallel) {
+  for (size_t size : {0, 1, 4096, 10000, 123457}) {
+    auto data = makeData(size);
+    ASSERT_TRUE(writeFile(data, path("in").c_str()));
+    EXPECT_EQ(data, readFileParallel(path("in"), &executor_, options()));
+    EXPECT_EQ(data, readFileParallel(path("in"), nullptr, options()));
+  }
+}
+
+TEST_P(FileCopyTest, Errors) {
+  EXPECT_THROW(
+      copyFile(path("missing"), path("out"), &executor_, options()),
+      std::system_error);
+  EXPECT_THROW(
+      readFileParallel(path("missing"), &executor_, options()),
+      std::system_error);
+  ASSERT_TRUE(writeFile(makeData(100), path("in").c_str()));
+  EXPECT_THROW(
+      copyFile(path("in"), path("out"), nullptr, options().setChunkSize(0)),
+      std::invalid_argument);
+}
+
+INSTANTIATE_TEST_CASE_P(DirectIO, FileCopyTest, ::testing::Bool());
+
+TEST(FileCopy, CopyFileRange) {
+  TemporaryDirectory dir;
+  auto data = makeData(50000);
+  auto inPath = (dir.path() / "in").string();
+  auto outPath = (dir.path() / "out").string();
+  ASSERT_TRUE(writeFile(data, inPath.c_str()));
+  File in(inPath);
+  File out(outPath, O_RDWR | O_CREAT);
+  CPUThreadPoolExecutor executor(4);
+  auto options = FileCopyOptions().setChunkSize(3000);
+
+  copyFileRange(in.fd(), out.fd(), 20000, &executor, options);
+  EXPECT_EQ(data.substr(0, 20000), readAll(outPath));
+  EXPECT_THROW(
+      copyFileRange(in.fd(), out.fd(), 60000, &executor, options),
+      std::runtime_error);
+}
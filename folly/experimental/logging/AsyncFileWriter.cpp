@@ -15,8 +15,11 @@
  */
 #include <folly/experimental/logging/AsyncFileWriter.h>
 
+#include <algorithm>
+
 #include <folly/Exception.h>
 #include <folly/FileUtil.h>
+#include <folly/Likely.h>
 #include <folly/experimental/logging/LoggerDB.h>
 #include <folly/system/ThreadName.h>
 
@@ -25,6 +28,10 @@ using folly::StringPiece;
 
 namespace folly {
 
+constexpr size_t AsyncFileWriter::kDefaultMaxBufferSize;
+constexpr uint32_t AsyncFileWriter::kQueueSize;
+constexpr size_t AsyncFileWriter::kDeferredMessageSize;
+
 AsyncFileWriter::AsyncFileWriter(StringPiece path)
     : AsyncFileWriter{File{path.str(), O_WRONLY | O_APPEND | O_CREAT}} {}
 
@@ -32,118 +39,275 @@ AsyncFileWriter::AsyncFileWriter(folly::File&& file)
     : file_{std::move(file)}, ioThread_([this] { ioThread(); }) {}
 
 AsyncFileWriter::~AsyncFileWriter() {
-  data_->stop = true;
-  messageReady_.notify_one();
+  stop_.store(true, std::memory_order_release);
+  messageReady_.notify();
   ioThread_.join();
 }
 
+AsyncFileWriter::ThreadBuffer& AsyncFileWriter::getThreadBuffer() {
+  auto handle = threadHandle_.get();
+  if (UNLIKELY(!handle->buffer)) {
+    handle->buffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    buffers_.push_back(handle->buffer);
+    buffersVersion_.fetch_add(1, std::memory_order_release);
+  }
+  return *handle->buffer;
+}
+
 void AsyncFileWriter::writeMessage(StringPiece buffer, uint32_t flags) {
   return writeMessage(buffer.str(), flags);
 }
 
 void AsyncFileWriter::writeMessage(std::string&& buffer, uint32_t flags) {
-  auto data = data_.lock();
-  if ((data->currentBufferSize >= data->maxBufferBytes) &&
-      !(flags & NEVER_DISCARD)) {
-    ++data->numDiscarded;
-    return;
-  }
+  auto size = buffer.size();
+  pushMessage(Message{std::move(buffer), nullptr}, size, flags);
+}
 
-  data->currentBufferSize += buffer.size();
-  auto* queue = data->getCurrentQueue();
-  queue->emplace_back(std::move(buffer));
-  messageReady_.notify_one();
+void AsyncFileWriter::writeDeferredMessage(
+    DeferredMessage&& message,
+    uint32_t flags) {
+  pushMessage(
+      Message{std::string(), std::move(message)}, kDeferredMessageSize, flags);
 }
 
-void AsyncFileWriter::flush() {
-  auto data = data_.lock();
-  auto start = data->ioThreadCounter;
-
-  // Wait until ioThreadCounter increments by at least two.
-  // Waiting for a single increment is not sufficient, as this happens after
-  // the I/O thread has swapped the queues, which is before it has actually
-  // done the I/O.
-  while (data->ioThreadCounter < start + 2) {
-    if (data->ioThreadDone) {
+void AsyncFileWriter::pushMessage(
+    Message&& message,
+    size_t size,
+    uint32_t flags) {
+  auto& threadBuffer = getThreadBuffer();
+  auto fits = [&] {
+    auto bytes = threadBuffer.bytes.load(std::memory_order_relaxed);
+    return (bytes == 0 || bytes + size <= getMaxBufferSize()) &&
+        !threadBuffer.queue.isFull();
+  };
+
+  while (true) {
+    if (fits()) {
+      // Counted first, the I/O thread may pop the message right away
+      threadBuffer.bytes.fetch_add(size, std::memory_order_relaxed);
+      // Only moved from if it was added
+      if (threadBuffer.queue.write(std::move(message))) {
+        threadBuffer.numPushed.store(
+            threadBuffer.numPushed.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+        messageReady_.notify();
+        return;
+      }
+      threadBuffer.bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    if (!(flags & NEVER_DISCARD) &&
+        getOverflowPolicy() == OverflowPolicy::DISCARD) {
+      threadBuffer.numDiscarded.fetch_add(1, std::memory_order_relaxed);
       return;
     }
 
-    // Enqueue an empty string and wake the I/O thread.
-    // The empty string ensures that the I/O thread will break out of its wait
-    // loop and increment the ioThreadCounter, even if there is no other work
-    // to do.
-    data->getCurrentQueue()->emplace_back();
-    messageReady_.notify_one();
+    // Wait until the I/O thread drains our buffer
+    auto key = spaceAvailable_.prepareWait();
+    if (fits()) {
+      spaceAvailable_.cancelWait();
+      continue;
+    }
+    messageReady_.notify();
+    spaceAvailable_.wait(key);
+  }
+}
+
+void AsyncFileWriter::flush() {
+  // The messages written so far by each thread
+  std::vector<std::pair<std::shared_ptr<ThreadBuffer>, uint64_t>> targets;
+  {
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    for (const auto& buffer : buffers_) {
+      targets.emplace_back(
+          buffer, buffer->numPushed.load(std::memory_order_acquire));
+    }
+  }
+  auto done = [&] {
+    for (const auto& target : targets) {
+      if (target.first->numWritten.load(std::memory_order_acquire) <
+          target.second) {
+        return false;
+      }
+    }
+    return true;
+  };
 
-    // Wait for notification from the I/O thread that it has done work.
-    ioCV_.wait(data.getUniqueLock());
+  std::unique_lock<std::mutex> lock(ioMutex_);
+  while (!done()) {
+    if (ioThreadDone_) {
+      return;
+    }
+    // Wait for the I/O thread to go around its loop once more
+    auto counter = ioThreadCounter_;
+    messageReady_.notify();
+    ioCV_.wait(lock, [&] {
+      return ioThreadCounter_ != counter || ioThreadDone_;
+    });
   }
 }
 
+uint64_t AsyncFileWriter::getNumDiscarded() const {
+  uint64_t numDiscarded =
+      numDiscardedReported_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(buffersMutex_);
+  for (const auto& buffer : buffers_) {
+    numDiscarded += buffer->numDiscarded.load(std::memory_order_relaxed);
+  }
+  return numDiscarded;
+}
+
 void AsyncFileWriter::ioThread() {
   folly::setThreadName("log_writer");
 
-  while (true) {
-    // With the lock held, grab a pointer to the current queue, then increment
-    // the ioThreadCounter index so that other threads will write into the
-    // other queue as we process this one.
-    std::vector<std::string>* ioQueue;
-    size_t numDiscarded;
-    bool stop;
-    {
-      auto data = data_.lock();
-      ioQueue = data->getCurrentQueue();
-      while (ioQueue->empty() && !data->stop) {
-        messageReady_.wait(data.getUniqueLock());
+  // Our copy of buffers_, refreshed when threads add theirs
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  uint64_t buffersVersion = 0;
+  auto refreshBuffers = [&] {
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    // Forget the buffers of exited threads once they are empty
+    buffers_.erase(
+        std::remove_if(
+            buffers_.begin(),
+            buffers_.end(),
+            [](const std::shared_ptr<ThreadBuffer>& buffer) {
+              return buffer->orphaned.load(std::memory_order_acquire) &&
+                  buffer->queue.isEmpty() &&
+                  buffer->numDiscarded.load(std::memory_order_relaxed) == 0;
+            }),
+        buffers_.end());
+    buffers = buffers_;
+    buffersVersion = buffersVersion_.load(std::memory_order_acquire);
+  };
+  auto hasMessages = [&] {
+    if (buffersVersion_.load(std::memory_order_acquire) != buffersVersion) {
+      return true;
+    }
+    for (const auto& buffer : buffers) {
+      if (!buffer->queue.isEmpty() ||
+          buffer->numDiscarded.load(std::memory_order_relaxed) > 0) {
+        return true;
       }
+    }
+    return false;
+  };
 
-      ++data->ioThreadCounter;
-      numDiscarded = data->numDiscarded;
-      data->numDiscarded = 0;
-      data->currentBufferSize = 0;
-      stop = data->stop;
+  size_t numRounds = 0;
+  while (true) {
+    // Stop once the messages written before the destructor are written
+    bool stop = stop_.load(std::memory_order_acquire);
+    if (buffersVersion_.load(std::memory_order_acquire) != buffersVersion ||
+        ++numRounds % 1024 == 0) {
+      refreshBuffers();
+    }
+    bool wrote = drainBuffers(buffers);
+
+    {
+      std::lock_guard<std::mutex> lock(ioMutex_);
+      ++ioThreadCounter_;
     }
     ioCV_.notify_all();
+    if (wrote) {
+      spaceAvailable_.notifyAll();
+      continue;
+    }
+    if (stop) {
+      break;
+    }
 
-    // Write the log messages now that we have released the lock
-    try {
-      performIO(ioQueue);
-    } catch (const std::exception& ex) {
-      onIoError(ex);
+    auto key = messageReady_.prepareWait();
+    if (hasMessages() || stop_.load(std::memory_order_acquire)) {
+      messageReady_.cancelWait();
+      continue;
     }
+    messageReady_.wait(key);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(ioMutex_);
+    ioThreadDone_ = true;
+  }
+  ioCV_.notify_all();
+}
 
-    // clear() empties the vector, but the allocated capacity remains so we can
-    // just reuse it without having to re-allocate in most cases.
-    ioQueue->clear();
+bool AsyncFileWriter::drainBuffers(
+    std::vector<std::shared_ptr<ThreadBuffer>>& buffers) {
+  // Messages taken from each buffer at once, so that a busy thread
+  // doesn't delay the others
+  constexpr size_t kMaxMessagesPerBuffer = 256;
 
-    if (numDiscarded > 0) {
-      auto msg = getNumDiscardedMsg(numDiscarded);
-      if (!msg.empty()) {
-        auto ret = folly::writeFull(file_.fd(), msg.data(), msg.size());
-        // We currently ignore errors from writeFull() here.
-        // There's not much we can really do.
-        (void)ret;
+  size_t numDiscarded = 0;
+  // How many messages of buffers[i] ioQueue_ has
+  std::vector<size_t> counts(buffers.size(), 0);
+  for (size_t n = 0; n < buffers.size(); ++n) {
+    auto i = (nextBuffer_ + n) % buffers.size();
+    auto& buffer = *buffers[i];
+    size_t bytes = 0;
+    while (counts[i] < kMaxMessagesPerBuffer) {
+      auto message = buffer.queue.frontPtr();
+      if (!message) {
+        break;
       }
+      if (message->deferred) {
+        bytes += kDeferredMessageSize;
+        ioQueue_.emplace_back(formatDeferredMessage(message->deferred));
+      } else {
+        bytes += message->text.size();
+        ioQueue_.emplace_back(std::move(message->text));
+      }
+      buffer.queue.popFront();
+      ++counts[i];
     }
+    buffer.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    numDiscarded += buffer.numDiscarded.exchange(0, std::memory_order_relaxed);
+  }
+  nextBuffer_ = buffers.empty() ? 0 : (nextBuffer_ + 1) % buffers.size();
+  if (ioQueue_.empty() && numDiscarded == 0) {
+    return false;
+  }
 
-    if (stop) {
-      data_->ioThreadDone = true;
-      break;
+  // Write the log messages
+  try {
+    performIO(ioQueue_);
+  } catch (const std::exception& ex) {
+    onIoError(ex);
+  }
+
+  // clear() empties the vector, but the allocated capacity remains so we can
+  // just reuse it without having to re-allocate in most cases.
+  ioQueue_.clear();
+
+  if (numDiscarded > 0) {
+    numDiscardedReported_.fetch_add(numDiscarded, std::memory_order_relaxed);
+    auto msg = getNumDiscardedMsg(numDiscarded);
+    if (!msg.empty()) {
+      auto ret = folly::writeFull(file_.fd(), msg.data(), msg.size());
+      // We currently ignore errors from writeFull() here.
+      // There's not much we can really do.
+      (void)ret;
+    }
+  }
+
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    if (counts[i] > 0) {
+      buffers[i]->numWritten.fetch_add(counts[i], std::memory_order_release);
     }
   }
+  return true;
 }
 
-void AsyncFileWriter::performIO(std::vector<std::string>* ioQueue) {
+void AsyncFileWriter::performIO(const std::vector<std::string>& ioQueue) {
   // kNumIovecs controls the maximum number of strings we write at once in a
   // single writev() call.
   constexpr int kNumIovecs = 64;
   std::array<iovec, kNumIovecs> iovecs;
 
   size_t idx = 0;
-  while (idx < ioQueue->size()) {
+  while (idx < ioQueue.size()) {
     int numIovecs = 0;
-    while (numIovecs < kNumIovecs && idx < ioQueue->size()) {
-      const auto& str = (*ioQueue)[idx];
+    while (numIovecs < kNumIovecs && idx < ioQueue.size()) {
+      const auto& str = ioQueue[idx];
       iovecs[numIovecs].iov_base = const_cast<char*>(str.data());
       iovecs[numIovecs].iov_len = str.size();
       ++numIovecs;
@@ -155,6 +319,20 @@ void AsyncFileWriter::performIO(std::vector<std::string>* ioQueue) {
   }
 }
 
+std::string AsyncFileWriter::formatDeferredMessage(
+    DeferredMessage& message) {
+  try {
+    return message();
+  } catch (const std::exception& ex) {
+    LoggerDB::internalWarning(
+        __FILE__,
+        __LINE__,
+        "error formatting a log message in AsyncFileWriter: ",
+        folly::exceptionStr(ex));
+  }
+  return std::string();
+}
+
 void AsyncFileWriter::onIoError(const std::exception& ex) {
   LoggerDB::internalWarning(
       __FILE__,
@@ -15,13 +15,19 @@
  */
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <folly/File.h>
+#include <folly/ProducerConsumerQueue.h>
 #include <folly/Range.h>
-#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/experimental/EventCount.h>
 #include <folly/experimental/logging/LogWriter.h>
 
 namespace folly {
@@ -40,9 +46,29 @@ namespace folly {
  * However, one downside is that if your program crashes, not all log messages
  * may have been written, so you may lose messages generated immediately before
  * the crash.
+ *
+ * Each thread writing messages has its own single-producer queue, which the
+ * I/O thread drains in turn, writing the messages of all threads with as
+ * few writev() calls as it can.  Writing a message thus takes no lock, and
+ * the messages of a thread are written in order.
+ *
+ * Messages given to writeDeferredMessage() are serialized by the I/O thread.
  */
 class AsyncFileWriter : public LogWriter {
  public:
+  /**
+   * What writeMessage() does when the buffer of its thread is full.
+   * Messages with the NEVER_DISCARD flag always wait.
+   */
+  enum class OverflowPolicy {
+    // Drop the message, and count it
+    DISCARD,
+    // Wait for the I/O thread to make room
+    BLOCK,
+  };
+
+  static constexpr size_t kDefaultMaxBufferSize = 1024 * 1024;
+
   /**
    * Construct an AsyncFileWriter that appends to the file at the specified
    * path.
@@ -58,6 +84,8 @@ class AsyncFileWriter : public LogWriter {
 
   void writeMessage(folly::StringPiece buffer, uint32_t flags = 0) override;
   void writeMessage(std::string&& buffer, uint32_t flags = 0) override;
+  void writeDeferredMessage(DeferredMessage&& message, uint32_t flags = 0)
+      override;
 
   /**
    * Block until the I/O thread has finished writing all messages that
@@ -65,47 +93,118 @@ class AsyncFileWriter : public LogWriter {
    */
   void flush() override;
 
+  /**
+   * The bytes of messages each thread may have waiting for the I/O thread.
+   * A message larger than this is accepted when its thread has none
+   * waiting.
+   */
+  void setMaxBufferSize(size_t size) {
+    maxBufferSize_.store(size, std::memory_order_relaxed);
+  }
+  size_t getMaxBufferSize() const {
+    return maxBufferSize_.load(std::memory_order_relaxed);
+  }
+
+  void setOverflowPolicy(OverflowPolicy policy) {
+    overflowPolicy_.store(policy, std::memory_order_relaxed);
+  }
+  OverflowPolicy getOverflowPolicy() const {
+    return overflowPolicy_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of messages discarded since construction.
+   */
+  uint64_t getNumDiscarded() const;
+
  private:
+  // Messages each thread may have waiting, whatever their size
+  static constexpr uint32_t kQueueSize = 4096;
+  // What a deferred message counts for in maxBufferSize_, a guess
+  static constexpr size_t kDeferredMessageSize = 256;
+
+  // Either text, or a deferred message the I/O thread serializes
+  struct Message {
+    std::string text;
+    DeferredMessage deferred;
+  };
+
   /*
-   * A simple implementation using two queues.
-   * All writer threads enqueue into one queue while the I/O thread is
-   * processing the other.
-   *
-   * We could potentially also provide an implementation using folly::MPMCQueue
-   * in the future, which may improve contention under very high write loads.
+   * The messages of one writer thread.  The thread pushes, and the I/O
+   * thread pops; both hold a reference, so messages written just before the
+   * thread exits are still written.
    */
-  struct Data {
-    std::array<std::vector<std::string>, 2> queues;
-    bool stop{false};
-    bool ioThreadDone{false};
-    uint64_t ioThreadCounter{0};
-    size_t maxBufferBytes{1024 * 1024};
-    size_t currentBufferSize{0};
-    size_t numDiscarded{0};
-
-    std::vector<std::string>* getCurrentQueue() {
-      return &queues[ioThreadCounter & 0x1];
+  struct ThreadBuffer {
+    ThreadBuffer() : queue(kQueueSize) {}
+
+    folly::ProducerConsumerQueue<Message> queue;
+    // Bytes in queue, to bound memory
+    std::atomic<size_t> bytes{0};
+    // Messages pushed, and written by the I/O thread, for flush()
+    std::atomic<uint64_t> numPushed{0};
+    std::atomic<uint64_t> numWritten{0};
+    std::atomic<uint64_t> numDiscarded{0};
+    // The writer thread exited
+    std::atomic<bool> orphaned{false};
+  };
+
+  struct ThreadHandle {
+    ~ThreadHandle() {
+      if (buffer) {
+        buffer->orphaned.store(true, std::memory_order_release);
+      }
     }
+
+    std::shared_ptr<ThreadBuffer> buffer;
   };
 
+  ThreadBuffer& getThreadBuffer();
+  void pushMessage(Message&& message, size_t size, uint32_t flags);
+
   void ioThread();
-  void performIO(std::vector<std::string>* ioQueue);
+  // Writes what the buffers hold, returns false if there was nothing
+  bool drainBuffers(std::vector<std::shared_ptr<ThreadBuffer>>& buffers);
+  void performIO(const std::vector<std::string>& ioQueue);
+  std::string formatDeferredMessage(DeferredMessage& message);
 
   void onIoError(const std::exception& ex);
   std::string getNumDiscardedMsg(size_t numDiscarded);
 
   folly::File file_;
-  folly::Synchronized<Data, std::mutex> data_;
+  std::atomic<size_t> maxBufferSize_{kDefaultMaxBufferSize};
+  std::atomic<OverflowPolicy> overflowPolicy_{OverflowPolicy::DISCARD};
+
+  folly::ThreadLocal<ThreadHandle> threadHandle_;
+  /**
+   * The buffers of the threads that wrote messages.  buffersVersion_
+   * changes whenever a thread adds its own.
+   */
+  mutable std::mutex buffersMutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::atomic<uint64_t> buffersVersion_{0};
+
+  // Used by the I/O thread only
+  size_t nextBuffer_{0};
+  std::vector<std::string> ioQueue_;
+  std::atomic<uint64_t> numDiscardedReported_{0};
+
   /**
    * messageReady_ is signaled by writer threads whenever they add a new
-   * message to the current queue.
+   * message, and wakes the I/O thread if it sleeps.  spaceAvailable_ is
+   * signaled by the I/O thread after it drained the buffers.
    */
-  std::condition_variable messageReady_;
+  folly::EventCount messageReady_;
+  folly::EventCount spaceAvailable_;
+  std::atomic<bool> stop_{false};
+
   /**
    * ioCV_ is signaled by the I/O thread each time it increments
-   * the ioThreadCounter (once each time around its loop).
+   * ioThreadCounter_ (once each time around its loop).
    */
+  std::mutex ioMutex_;
   std::condition_variable ioCV_;
+  uint64_t ioThreadCounter_{0};
+  bool ioThreadDone_{false};
 
   /**
    * The I/O thread.
@@ -202,8 +202,9 @@ void LogCategory::updateEffectiveLevel(LogLevel newEffectiveLevel) {
   }
 
   // Update all of the values in xlogLevels_
-  for (auto* levelPtr : xlogLevels_) {
-    levelPtr->store(newEffectiveLevel, std::memory_order_release);
+  for (auto* cache = xlogLevels_.load(std::memory_order_acquire); cache;
+       cache = cache->next) {
+    cache->level.store(newEffectiveLevel, std::memory_order_release);
   }
 
   // Update all children loggers
@@ -226,7 +227,12 @@ void LogCategory::parentLevelUpdated(LogLevel parentEffectiveLevel) {
   updateEffectiveLevel(newEffectiveLevel);
 }
 
-void LogCategory::registerXlogLevel(std::atomic<LogLevel>* levelPtr) {
-  xlogLevels_.push_back(levelPtr);
+void LogCategory::registerXlogLevel(XlogLevelCache* cache) {
+  // Other XLOG() statements may be registering concurrently
+  auto* head = xlogLevels_.load(std::memory_order_relaxed);
+  do {
+    cache->next = head;
+  } while (!xlogLevels_.compare_exchange_weak(
+      head, cache, std::memory_order_release, std::memory_order_relaxed));
 }
 } // namespace folly
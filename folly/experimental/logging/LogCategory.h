@@ -30,6 +30,21 @@ class LoggerDB;
 class LogHandler;
 class LogMessage;
 
+/**
+ * The copy of a LogCategory's effective level that an XLOG() statement
+ * checks.
+ *
+ * These have static storage duration and rely on zero-initialization, so
+ * that XLOG() works before main().  LogCategory links the registered ones
+ * into a list, to keep them up-to-date; the level check reads only level.
+ */
+struct XlogLevelCache {
+  std::atomic<LogLevel> level;
+  // Set by the thread that registers this cache
+  std::atomic<bool> registered;
+  XlogLevelCache* next;
+};
+
 /**
  * LogCategory stores all of the logging configuration for a specific
  * log category.
@@ -184,9 +199,10 @@ class LogCategory {
    * level changes.
    *
    * This function should only be invoked by LoggerDB, and the LoggerDB lock
-   * must be held when calling it.
+   * must be held when calling it, in shared mode at least.  The cache must
+   * not be registered yet.
    */
-  void registerXlogLevel(std::atomic<LogLevel>* levelPtr);
+  void registerXlogLevel(XlogLevelCache* cache);
 
  private:
   enum : uint32_t { FLAG_INHERIT = 0x80000000 };
@@ -252,8 +268,10 @@ class LogCategory {
    * The XLOG*() statements will check these values.  We ensure they are kept
    * up-to-date each time the effective log level changes for this category.
    *
-   * This list may only be accessed while holding the main LoggerDB lock.
+   * XLOG() statements add themselves while holding the main LoggerDB lock in
+   * shared mode, and level changes walk the list while holding it
+   * exclusively.
    */
-  std::vector<std::atomic<LogLevel>*> xlogLevels_;
+  std::atomic<XlogLevelCache*> xlogLevels_{nullptr};
 };
 } // namespace folly
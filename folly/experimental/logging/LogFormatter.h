@@ -38,6 +38,9 @@ class LogFormatter {
    *     message.  Note that this is likely different from the LogCategory
    *     where the message was originally logged, which can be accessed as
    *     message->getCategory()
+   *
+   * This may be called from the thread of a LogWriter, for messages whose
+   * formatting is deferred, and so concurrently with other calls.
    */
   virtual std::string formatMessage(
       const LogMessage& message,
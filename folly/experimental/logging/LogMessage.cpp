@@ -37,6 +37,20 @@ LogMessage::LogMessage(
   sanitizeMessage();
 }
 
+LogMessage::LogMessage(
+    const LogCategory* category,
+    LogLevel level,
+    StringPiece filename,
+    unsigned int lineNumber,
+    std::shared_ptr<const DeferredText> text)
+    : category_{category},
+      level_{level},
+      threadID_{getOSThreadID()},
+      timestamp_{system_clock::now()},
+      filename_{filename},
+      lineNumber_{lineNumber},
+      deferredText_{std::move(text)} {}
+
 LogMessage::LogMessage(
     const LogCategory* category,
     LogLevel level,
@@ -76,7 +90,13 @@ StringPiece LogMessage::getFileBaseName() const {
   return filename_.subpiece(idx + 1);
 }
 
-void LogMessage::sanitizeMessage() {
+void LogMessage::formatDeferredTextSlow() const {
+  rawMessage_ = deferredText_->format();
+  deferredText_.reset();
+  sanitizeMessage();
+}
+
+void LogMessage::sanitizeMessage() const {
   // Compute how long the sanitized string will be.
   size_t sanitizedLength = 0;
   for (const char c : rawMessage_) {
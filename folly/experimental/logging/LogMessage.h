@@ -17,6 +17,7 @@
 
 #include <sys/types.h>
 #include <chrono>
+#include <memory>
 #include <string>
 
 #include <folly/Range.h>
@@ -37,6 +38,23 @@ class LogCategory;
  */
 class LogMessage {
  public:
+  /**
+   * The text of a message whose formatting was deferred: the format string
+   * and copies of the arguments, formatted on first use.  This lets a
+   * LogWriter format messages in its own thread, see
+   * LoggerDB::setDeferFormatting().
+   */
+  class DeferredText {
+   public:
+    virtual ~DeferredText() {}
+
+    /**
+     * May be called from any thread, and must not throw: formatting errors
+     * are reported in the returned text.
+     */
+    virtual std::string format() const = 0;
+  };
+
   LogMessage(
       const LogCategory* category,
       LogLevel level,
@@ -51,6 +69,13 @@ class LogMessage {
       folly::StringPiece msg)
       : LogMessage(category, level, filename, lineNumber, msg.str()) {}
 
+  LogMessage(
+      const LogCategory* category,
+      LogLevel level,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      std::shared_ptr<const DeferredText> text);
+
   /**
    * Construct a LogMessage with an explicit timestamp.
    * This is primarily intended for use in unit tests, so the tests can get
@@ -90,6 +115,7 @@ class LogMessage {
   }
 
   const std::string& getMessage() const {
+    formatDeferredText();
     // If no characters needed to be sanitized, message_ will be empty.
     if (message_.empty()) {
       return rawMessage_;
@@ -98,15 +124,33 @@ class LogMessage {
   }
 
   const std::string& getRawMessage() const {
+    formatDeferredText();
     return rawMessage_;
   }
 
   bool containsNewlines() const {
+    formatDeferredText();
     return containsNewlines_;
   }
 
+  /**
+   * Returns true if the text of this message has not been formatted yet.
+   *
+   * Getting the message text formats it, so a LogMessage whose text is
+   * deferred must not be used by several threads at once.  Copies may be.
+   */
+  bool isTextDeferred() const {
+    return deferredText_ != nullptr;
+  }
+
  private:
-  void sanitizeMessage();
+  void formatDeferredText() const {
+    if (deferredText_) {
+      formatDeferredTextSlow();
+    }
+  }
+  void formatDeferredTextSlow() const;
+  void sanitizeMessage() const;
 
   const LogCategory* const category_{nullptr};
   LogLevel const level_{static_cast<LogLevel>(0)};
@@ -129,7 +173,7 @@ class LogMessage {
    * This allows log handlers that perform special handling of multi-line
    * messages to easily detect if a message contains multiple lines or not.
    */
-  bool containsNewlines_{false};
+  mutable bool containsNewlines_{false};
 
   /**
    * rawMessage_ contains the original message.
@@ -137,7 +181,13 @@ class LogMessage {
    * This may contain arbitrary binary data, including unprintable characters
    * and nul bytes.
    */
-  std::string const rawMessage_;
+  mutable std::string rawMessage_;
+
+  /**
+   * deferredText_ is set until the message text has been formatted into
+   * rawMessage_.
+   */
+  mutable std::shared_ptr<const DeferredText> deferredText_;
 
   /**
    * message_ contains a sanitized version of the log message.
@@ -147,6 +197,6 @@ class LogMessage {
    * are responsible for deciding how they want to handle log messages with
    * internal newlines.
    */
-  std::string message_;
+  mutable std::string message_;
 };
 } // namespace folly
@@ -110,7 +110,7 @@ LogCategory* getXlogCategory(XlogFileScopeInfo* fileScopeInfo) {
   // By the time a LogStreamProcessor is created, the XlogFileScopeInfo object
   // should have already been initialized to perform the log level check.
   // Therefore we never need to check if it is initialized here.
-  return fileScopeInfo->category;
+  return fileScopeInfo->category.load(std::memory_order_relaxed);
 }
 } // namespace
 
@@ -178,6 +178,14 @@ void LogStreamProcessor::logNow() noexcept {
   //
   // Any other error here is unexpected and we also want to fail hard
   // in that situation too.
+  if (deferredText_ && stream_.empty()) {
+    category_->admitMessage(LogMessage{category_,
+                                       level_,
+                                       filename_,
+                                       lineNumber_,
+                                       std::move(deferredText_)});
+    return;
+  }
   category_->admitMessage(LogMessage{category_,
                                      level_,
                                      filename_,
@@ -187,6 +195,11 @@ void LogStreamProcessor::logNow() noexcept {
 
 std::string LogStreamProcessor::extractMessageString(
     LogStream& stream) noexcept {
+  if (deferredText_) {
+    // Text was streamed after the arguments, so format them now
+    message_ = deferredText_->format();
+    deferredText_.reset();
+  }
   if (stream.empty()) {
     return std::move(message_);
   }
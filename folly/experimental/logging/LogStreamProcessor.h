@@ -20,10 +20,16 @@
 #include <folly/Demangle.h>
 #include <folly/Format.h>
 #include <folly/Portability.h>
+#include <folly/Traits.h>
+#include <folly/Utility.h>
 #include <folly/experimental/logging/LogCategory.h>
 #include <folly/experimental/logging/LogMessage.h>
 #include <folly/experimental/logging/LogStream.h>
+#include <folly/experimental/logging/LoggerDB.h>
 #include <cstdlib>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 
 namespace folly {
 
@@ -68,6 +74,53 @@ inline void fallbackFormatOneArg(std::string* str, const Arg* arg, long) {
 #endif
   str->append("<no_string_conversion>)");
 }
+
+/*
+ * How a log message whose formatting is deferred stores an argument of type
+ * T, if it can: numbers and pointers are copied, and strings are copied into
+ * a std::string.  Anything else is formatted right away.
+ */
+template <typename T, typename = void>
+struct DeferredLogArg : std::false_type {};
+
+template <typename T>
+struct DeferredLogArg<
+    T,
+    typename std::enable_if<
+        std::is_arithmetic<T>::value ||
+        (std::is_pointer<T>::value &&
+         !std::is_same<
+             char,
+             typename std::remove_cv<
+                 typename std::remove_pointer<T>::type>::type>::value)>::type>
+    : std::true_type {
+  using type = T;
+  static T capture(T value) {
+    return value;
+  }
+};
+
+template <typename T>
+struct DeferredLogArg<
+    T,
+    typename std::enable_if<
+        std::is_same<T, std::string>::value ||
+        std::is_same<T, folly::StringPiece>::value ||
+        (std::is_pointer<T>::value &&
+         std::is_same<
+             char,
+             typename std::remove_cv<
+                 typename std::remove_pointer<T>::type>::type>::value)>::type>
+    : std::true_type {
+  using type = std::string;
+  static std::string capture(folly::StringPiece value) {
+    return value.str();
+  }
+  static std::string capture(const char* value) {
+    // folly::format() prints null C strings this way
+    return value ? std::string(value) : std::string("(null)");
+  }
+};
 } // namespace detail
 
 template <bool IsInHeaderFile>
@@ -156,7 +209,9 @@ class LogStreamProcessor {
             filename,
             lineNumber,
             INTERNAL,
-            formatLogString(fmt, std::forward<Args>(args)...)) {}
+            std::string()) {
+    formatOrDefer(fmt, args...);
+  }
 
   /*
    * Versions of the above constructors for use in XLOG() statements.
@@ -213,7 +268,9 @@ class LogStreamProcessor {
             filename,
             lineNumber,
             INTERNAL,
-            formatLogString(fmt, std::forward<Args>(args)...)) {}
+            std::string()) {
+    formatOrDefer(fmt, args...);
+  }
 
 #ifdef __INCLUDE_LEVEL__
   /*
@@ -276,7 +333,9 @@ class LogStreamProcessor {
             filename,
             lineNumber,
             INTERNAL,
-            formatLogString(fmt, std::forward<Args>(args)...)) {}
+            std::string()) {
+    formatOrDefer(fmt, args...);
+  }
 #endif
 
   ~LogStreamProcessor() noexcept;
@@ -329,6 +388,73 @@ class LogStreamProcessor {
 
   std::string extractMessageString(LogStream& stream) noexcept;
 
+  /**
+   * The text of a log message whose formatting is deferred, with the
+   * arguments stored as given by detail::DeferredLogArg.
+   *
+   * The format string is copied too, since it need not be a literal.
+   */
+  template <typename... Args>
+  class DeferredText : public LogMessage::DeferredText {
+   public:
+    template <typename... Values>
+    explicit DeferredText(folly::StringPiece fmt, const Values&... values)
+        : fmt_(fmt.str()),
+          args_(detail::DeferredLogArg<typename std::decay<Values>::type>::
+                    capture(values)...) {}
+
+    std::string format() const override {
+      return formatImpl(folly::make_index_sequence<sizeof...(Args)>{});
+    }
+
+   private:
+    template <size_t... Indices>
+    std::string formatImpl(folly::index_sequence<Indices...>) const {
+      return formatLogString(fmt_, std::get<Indices>(args_)...);
+    }
+
+    std::string fmt_;
+    std::tuple<Args...> args_;
+  };
+
+  /**
+   * Format the message of a FORMAT log statement, or just store its
+   * arguments if LoggerDB::setDeferFormatting() is enabled and they all can
+   * be.
+   */
+  template <typename... Args>
+  FOLLY_NOINLINE void formatOrDefer(
+      folly::StringPiece fmt,
+      const Args&... args) noexcept {
+    formatOrDefer(
+        StrictConjunction<
+            detail::DeferredLogArg<typename std::decay<Args>::type>...>{},
+        fmt,
+        args...);
+  }
+
+  template <typename... Args>
+  void formatOrDefer(
+      std::true_type,
+      folly::StringPiece fmt,
+      const Args&... args) noexcept {
+    if (LoggerDB::getDeferFormatting()) {
+      deferredText_ = std::make_shared<const DeferredText<
+          typename detail::DeferredLogArg<typename std::decay<Args>::type>::
+              type...>>(fmt, args...);
+    } else {
+      message_ = formatLogString(fmt, args...);
+    }
+  }
+
+  template <typename... Args>
+  void formatOrDefer(
+      std::false_type,
+      folly::StringPiece fmt,
+      const Args&... args) noexcept {
+    message_ = formatLogString(fmt, args...);
+  }
+
   /**
    * Construct a log message string using folly::to<std::string>()
    *
@@ -363,7 +489,7 @@ class LogStreamProcessor {
    * exceptions, but instead just log an error string when something goes wrong.
    */
   template <typename... Args>
-  FOLLY_NOINLINE std::string formatLogString(
+  FOLLY_NOINLINE static std::string formatLogString(
       folly::StringPiece fmt,
       const Args&... args) noexcept {
     try {
@@ -395,7 +521,7 @@ class LogStreamProcessor {
    * mechanism to folly::to<std::string>(), if supported.
    */
   template <typename Arg1, typename... Args>
-  void
+  static void
   fallbackFormat(std::string* str, const Arg1& arg1, const Args&... remainder) {
     detail::fallbackFormatOneArg(str, &arg1, 0);
     str->append(", ");
@@ -403,7 +529,7 @@ class LogStreamProcessor {
   }
 
   template <typename Arg>
-  void fallbackFormat(std::string* str, const Arg& arg) {
+  static void fallbackFormat(std::string* str, const Arg& arg) {
     detail::fallbackFormatOneArg(str, &arg, 0);
   }
 
@@ -412,6 +538,7 @@ class LogStreamProcessor {
   folly::StringPiece filename_;
   unsigned int lineNumber_;
   std::string message_;
+  std::shared_ptr<const LogMessage::DeferredText> deferredText_;
   LogStream stream_;
 };
 
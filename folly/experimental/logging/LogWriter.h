@@ -15,6 +15,9 @@
  */
 #pragma once
 
+#include <string>
+
+#include <folly/Function.h>
 #include <folly/Range.h>
 
 namespace folly {
@@ -63,6 +66,25 @@ class LogWriter {
     writeMessage(folly::StringPiece{buffer}, flags);
   }
 
+  /**
+   * Serializes a message when called, see writeDeferredMessage().
+   */
+  using DeferredMessage = folly::Function<std::string()>;
+
+  /**
+   * Write a message that has not been serialized yet.
+   *
+   * StandardLogHandler uses this for messages whose formatting is deferred
+   * (see LoggerDB::setDeferFormatting()), so that a LogWriter that hands
+   * messages to another thread may serialize them there as well.  The
+   * default implementation serializes the message right away.
+   */
+  virtual void writeDeferredMessage(
+      DeferredMessage&& message,
+      uint32_t flags = 0) {
+    writeMessage(message(), flags);
+  }
+
   /**
    * Block until all messages that have already been sent to this LogWriter
    * have been written.
@@ -199,52 +199,63 @@ size_t LoggerDB::flushAllHandlers() {
   return handlers.size();
 }
 
-LogLevel LoggerDB::xlogInit(
-    StringPiece categoryName,
-    std::atomic<LogLevel>* xlogCategoryLevel,
-    LogCategory** xlogCategory) {
-  // Hold the lock for the duration of the operation
-  // xlogInit() may be called from multiple threads simultaneously.
-  // Only one needs to perform the initialization.
-  auto loggersByName = loggersByName_.wlock();
-  if (xlogCategory != nullptr && *xlogCategory != nullptr) {
-    // The xlogCategory was already initialized before we acquired the lock
-    return (*xlogCategory)->getEffectiveLevel();
+LogCategory* LoggerDB::getOrCreateXlogCategory(StringPiece name) {
+  // The category usually exists already, unless this is the first XLOG()
+  // statement using it.  Concurrent XLOG() statements then don't wait for
+  // each other.
+  {
+    auto loggersByName = loggersByName_.rlock();
+    auto it = loggersByName->find(name);
+    if (it != loggersByName->end()) {
+      return it->second.get();
+    }
   }
+  auto loggersByName = loggersByName_.wlock();
+  return getOrCreateCategoryLocked(*loggersByName, name);
+}
 
-  auto* category = getOrCreateCategoryLocked(*loggersByName, categoryName);
+LogLevel LoggerDB::xlogInit(
+    StringPiece categoryName,
+    XlogLevelCache* xlogCategoryLevel,
+    std::atomic<LogCategory*>* xlogCategory) {
+  auto* category = getOrCreateXlogCategory(categoryName);
   if (xlogCategory) {
     // Set *xlogCategory before we update xlogCategoryLevel below.
     // This is important, since the XLOG() macros check xlogCategoryLevel to
     // tell if *xlogCategory has been initialized yet.
-    *xlogCategory = category;
+    xlogCategory->store(category, std::memory_order_relaxed);
   }
+
+  // The effective level only changes while the lock is held exclusively, so
+  // it can't change between the time we read it and the time we register
+  // the cache to be kept up-to-date.
+  auto loggersByName = loggersByName_.rlock();
   auto level = category->getEffectiveLevel();
-  xlogCategoryLevel->store(level, std::memory_order_release);
-  category->registerXlogLevel(xlogCategoryLevel);
+  xlogCategoryLevel->level.store(level, std::memory_order_release);
+  // xlogInit() may be called from multiple threads simultaneously.
+  // Only one needs to register the cache.
+  auto registered =
+      xlogCategoryLevel->registered.exchange(true, std::memory_order_relaxed);
+  if (!registered) {
+    category->registerXlogLevel(xlogCategoryLevel);
+  }
   return level;
 }
 
 LogCategory* LoggerDB::xlogInitCategory(
     StringPiece categoryName,
-    LogCategory** xlogCategory,
+    std::atomic<LogCategory*>* xlogCategory,
     std::atomic<bool>* isInitialized) {
-  // Hold the lock for the duration of the operation
   // xlogInitCategory() may be called from multiple threads simultaneously.
-  // Only one needs to perform the initialization.
-  auto loggersByName = loggersByName_.wlock();
-  if (isInitialized->load(std::memory_order_acquire)) {
-    // The xlogCategory was already initialized before we acquired the lock
-    return *xlogCategory;
-  }
-
-  auto* category = getOrCreateCategoryLocked(*loggersByName, categoryName);
-  *xlogCategory = category;
+  // They all find the same category.
+  auto* category = getOrCreateXlogCategory(categoryName);
+  xlogCategory->store(category, std::memory_order_relaxed);
   isInitialized->store(true, std::memory_order_release);
   return category;
 }
 
 std::atomic<LoggerDB::InternalWarningHandler> LoggerDB::warningHandler_;
+std::atomic<bool> LoggerDB::deferFormatting_{false};
 
 void LoggerDB::internalWarningImpl(
     folly::StringPiece filename,
@@ -19,6 +19,7 @@
 #include <folly/CppAttributes.h>
 #include <folly/Range.h>
 #include <folly/Synchronized.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -30,6 +31,7 @@ namespace folly {
 
 class LogCategory;
 enum class LogLevel : uint32_t;
+struct XlogLevelCache;
 
 /**
  * LoggerDB stores the set of LogCategory objects.
@@ -100,18 +102,22 @@ class LoggerDB {
   size_t flushAllHandlers();
 
   /**
-   * Initialize the LogCategory* and std::atomic<LogLevel> used by an XLOG()
+   * Initialize the LogCategory* and XlogLevelCache used by an XLOG()
    * statement.
    *
    * Returns the current effective LogLevel of the category.
+   *
+   * Several threads may initialize the same statement at once.  This only
+   * takes the LoggerDB lock exclusively the first time a category is used,
+   * to create it.
    */
   LogLevel xlogInit(
       folly::StringPiece categoryName,
-      std::atomic<LogLevel>* xlogCategoryLevel,
-      LogCategory** xlogCategory);
+      XlogLevelCache* xlogCategoryLevel,
+      std::atomic<LogCategory*>* xlogCategory);
   LogCategory* xlogInitCategory(
       folly::StringPiece categoryName,
-      LogCategory** xlogCategory,
+      std::atomic<LogCategory*>* xlogCategory,
       std::atomic<bool>* isInitialized);
 
   enum TestConstructorArg { TESTING };
@@ -164,6 +170,26 @@ class LoggerDB {
    */
   static void setInternalWarningHandler(InternalWarningHandler handler);
 
+  /**
+   * Defer the formatting of XLOGF() and FB_LOGF() messages.
+   *
+   * When enabled, a log statement whose arguments are all numbers, strings or
+   * pointers copies them into the LogMessage instead of formatting them, and
+   * the text is formatted when a LogHandler first needs it.  A
+   * StandardLogHandler then leaves both this and the LogFormatter work to
+   * its LogWriter, which an AsyncFileWriter does in its I/O thread, off the
+   * thread that logged.
+   *
+   * Pointer arguments are formatted as addresses, so they need not remain
+   * valid.  This is disabled by default.
+   */
+  static void setDeferFormatting(bool defer) {
+    deferFormatting_.store(defer, std::memory_order_relaxed);
+  }
+  static bool getDeferFormatting() {
+    return deferFormatting_.load(std::memory_order_relaxed);
+  }
+
  private:
   using LoggerNameMap = std::unordered_map<
       folly::StringPiece,
@@ -183,6 +209,7 @@ class LoggerDB {
       LoggerNameMap& loggersByName,
       folly::StringPiece name,
       LogCategory* parent);
+  LogCategory* getOrCreateXlogCategory(folly::StringPiece name);
 
   static void internalWarningImpl(
       folly::StringPiece filename,
@@ -202,5 +229,6 @@ class LoggerDB {
   folly::Synchronized<LoggerNameMap> loggersByName_;
 
   static std::atomic<InternalWarningHandler> warningHandler_;
+  static std::atomic<bool> deferFormatting_;
 };
 } // namespace folly
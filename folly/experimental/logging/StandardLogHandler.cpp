@@ -34,6 +34,14 @@ void StandardLogHandler::handleMessage(
   if (message.getLevel() < getLevel()) {
     return;
   }
+  if (message.isTextDeferred()) {
+    // Copying the message is cheap while its text is not formatted
+    writer_->writeDeferredMessage(
+        [ formatter = formatter_, message, handlerCategory ] {
+          return formatter->formatMessage(message, handlerCategory);
+        });
+    return;
+  }
   writer_->writeMessage(formatter_->formatMessage(message, handlerCategory));
 }
 
@@ -36,6 +36,9 @@ class LogWriter;
  *
  * StandardLogHandler also supports ignoring messages less than a specific
  * LogLevel.  By default it processes all messages.
+ *
+ * Messages whose formatting is deferred are given to the LogWriter with
+ * writeDeferredMessage(), so the LogFormatter may run in the writer's thread.
  */
 class StandardLogHandler : public LogHandler {
  public:
@@ -254,6 +254,132 @@ TEST(AsyncFileWriter, flush) {
   future.get(10ms);
 }
 
+TEST(AsyncFileWriter, threadExit) {
+  TemporaryFile tmpFile{"logging_test"};
+
+  {
+    AsyncFileWriter writer{folly::File{tmpFile.fd(), false}};
+    // Each thread exits right after its messages, before they are written
+    for (int n = 0; n < 10; ++n) {
+      std::thread([&writer, n] {
+        writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+      }).join();
+    }
+    writer.flush();
+
+    std::string data;
+    ASSERT_TRUE(folly::readFile(tmpFile.path().string().c_str(), data));
+    EXPECT_EQ(10, std::count(data.begin(), data.end(), '\n'));
+  }
+}
+
+TEST(AsyncFileWriter, deferredMessages) {
+  TemporaryFile tmpFile{"logging_test"};
+
+  AsyncFileWriter writer{folly::File{tmpFile.fd(), false}};
+  std::vector<std::thread::id> formatThreads;
+  for (int n = 0; n < 3; ++n) {
+    writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+    writer.writeDeferredMessage([&formatThreads, n] {
+      formatThreads.push_back(std::this_thread::get_id());
+      return folly::to<std::string>("deferred ", n, "\n");
+    });
+  }
+  writer.flush();
+
+  std::string data;
+  ASSERT_TRUE(folly::readFile(tmpFile.path().string().c_str(), data));
+  EXPECT_EQ(
+      "message 0\ndeferred 0\n"
+      "message 1\ndeferred 1\n"
+      "message 2\ndeferred 2\n",
+      data);
+  // Formatted by the I/O thread
+  ASSERT_EQ(3, formatThreads.size());
+  for (const auto& id : formatThreads) {
+    EXPECT_NE(std::this_thread::get_id(), id);
+  }
+}
+
+TEST(AsyncFileWriter, discardCount) {
+  std::array<int, 2> fds;
+  auto rc = pipe(fds.data());
+  folly::checkUnixError(rc, "failed to create pipe");
+  File readPipe{fds[0], true};
+  File writePipe{fds[1], true};
+  auto paddingSize = fillUpPipe(writePipe.fd());
+
+  std::thread reader;
+  {
+    AsyncFileWriter writer{std::move(writePipe)};
+    writer.setMaxBufferSize(1000);
+    EXPECT_EQ(
+        AsyncFileWriter::OverflowPolicy::DISCARD, writer.getOverflowPolicy());
+
+    // The I/O thread blocks on the full pipe with the first messages, and
+    // then a thousand more bytes fit
+    size_t numMessages = 100;
+    for (size_t n = 0; n < numMessages; ++n) {
+      writer.writeMessage(std::string(99, 'x') + "\n");
+    }
+    auto numDiscarded = writer.getNumDiscarded();
+    EXPECT_GT(numDiscarded, 0);
+    EXPECT_LT(numDiscarded, numMessages);
+
+    reader = std::thread([&] {
+      std::vector<char> buf(paddingSize);
+      readFull(readPipe.fd(), buf.data(), buf.size());
+      // Then the messages and the discard notification, until the writer
+      // closes the pipe
+      while (readNoInt(readPipe.fd(), buf.data(), buf.size()) > 0) {
+      }
+    });
+    writer.flush();
+    EXPECT_EQ(numDiscarded, writer.getNumDiscarded());
+  }
+  reader.join();
+}
+
+TEST(AsyncFileWriter, blockPolicy) {
+  std::array<int, 2> fds;
+  auto rc = pipe(fds.data());
+  folly::checkUnixError(rc, "failed to create pipe");
+  File readPipe{fds[0], true};
+  File writePipe{fds[1], true};
+  auto paddingSize = fillUpPipe(writePipe.fd());
+
+  std::string data;
+  {
+    AsyncFileWriter writer{std::move(writePipe)};
+    writer.setMaxBufferSize(1000);
+    writer.setOverflowPolicy(AsyncFileWriter::OverflowPolicy::BLOCK);
+
+    std::atomic<bool> writing{true};
+    std::thread writeThread([&] {
+      for (int n = 0; n < 100; ++n) {
+        writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+      }
+      writing = false;
+    });
+
+    // The writer waits for the pipe
+    /* sleep override */
+    std::this_thread::sleep_for(10ms);
+    EXPECT_TRUE(writing);
+
+    std::vector<char> buf(paddingSize);
+    readFull(readPipe.fd(), buf.data(), buf.size());
+    writeThread.join();
+    EXPECT_EQ(0, writer.getNumDiscarded());
+  }
+  ASSERT_TRUE(folly::readFile(readPipe.fd(), data));
+  std::string expected;
+  for (int n = 0; n < 100; ++n) {
+    expected += folly::to<std::string>("message ", n, "\n");
+  }
+  EXPECT_EQ(expected, data);
+}
+
 // A large-ish message suffix, just to consume space and help fill up
 // log buffers faster.
 static constexpr StringPiece kMsgSuffix{
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include <folly/experimental/logging/Logger.h>
+#include <thread>
+#include <vector>
+
+#include <folly/experimental/logging/LogCategory.h>
 #include <folly/experimental/logging/LoggerDB.h>
 #include <folly/experimental/logging/test/TestLogHandler.h>
 #include <folly/portability/GTest.h>
@@ -97,3 +101,38 @@ TEST(LoggerDB, processConfigString) {
   EXPECT_EQ(
       LogLevel::DEBUG, db.getCategory("foo.test.stuff")->getEffectiveLevel());
 }
+
+TEST(LoggerDB, xlogInit) {
+  LoggerDB db{LoggerDB::TESTING};
+  db.setLevel("foo", LogLevel::INFO);
+
+  // Statements of one file and of a header using the same category,
+  // initialized by many threads at once
+  XlogLevelCache fileLevel{};
+  std::atomic<LogCategory*> fileCategory{nullptr};
+  XlogLevelCache headerLevel{};
+  std::vector<std::thread> threads;
+  for (size_t n = 0; n < 8; ++n) {
+    threads.emplace_back([&] {
+      EXPECT_EQ(
+          LogLevel::INFO, db.xlogInit("foo.bar", &fileLevel, &fileCategory));
+      EXPECT_EQ(LogLevel::INFO, db.xlogInit("foo.bar", &headerLevel, nullptr));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto* category = db.getCategory("foo.bar");
+  EXPECT_EQ(category, fileCategory.load());
+  EXPECT_EQ(LogLevel::INFO, fileLevel.level.load());
+  EXPECT_EQ(LogLevel::INFO, headerLevel.level.load());
+
+  // Both were registered once, and follow level changes
+  db.setLevel("foo", LogLevel::DBG3);
+  EXPECT_EQ(LogLevel::DBG3, fileLevel.level.load());
+  EXPECT_EQ(LogLevel::DBG3, headerLevel.level.load());
+  db.setLevel("foo.bar", LogLevel::WARN, false);
+  EXPECT_EQ(LogLevel::WARN, fileLevel.level.load());
+  EXPECT_EQ(LogLevel::WARN, headerLevel.level.load());
+}
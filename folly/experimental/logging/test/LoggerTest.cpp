@@ -13,6 +13,8 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <folly/FBString.h>
+#include <folly/ScopeGuard.h>
 #include <folly/experimental/logging/LogCategory.h>
 #include <folly/experimental/logging/LogHandler.h>
 #include <folly/experimental/logging/LogMessage.h>
@@ -271,6 +273,71 @@ TEST_F(LoggerTest, streamingArgs) {
   messages.clear();
 }
 
+TEST_F(LoggerTest, deferFormatting) {
+  LoggerDB::setDeferFormatting(true);
+  SCOPE_EXIT {
+    LoggerDB::setDeferFormatting(false);
+  };
+  auto& messages = handler_->getMessages();
+
+  // Strings are copied, so they need not outlive the log statement
+  {
+    std::string str = "hello";
+    StringPiece piece = "piece";
+    const char* nullStr = nullptr;
+    FB_LOGF(
+        logger_,
+        WARN,
+        "{} {:03d} {} {} {} {:.1f}",
+        str,
+        7,
+        piece,
+        nullStr,
+        "literal",
+        1.5);
+    str = "overwritten";
+  }
+  ASSERT_EQ(1, messages.size());
+  EXPECT_TRUE(messages[0].first.isTextDeferred());
+  EXPECT_EQ("hello 007 piece (null) literal 1.5", messages[0].first.getMessage());
+  EXPECT_FALSE(messages[0].first.isTextDeferred());
+  EXPECT_FALSE(messages[0].first.containsNewlines());
+  messages.clear();
+
+  // Format errors are reported when the message is formatted
+  FB_LOGF(logger_, WARN, "param1: {:06d}, param2: {:s}", 1234, 5);
+  ASSERT_EQ(1, messages.size());
+  EXPECT_TRUE(messages[0].first.isTextDeferred());
+  EXPECT_EQ(
+      "error formatting log message: "
+      "invalid format argument {:s}: invalid specifier 's'; "
+      "format string: \"param1: {:06d}, param2: {:s}\", "
+      "arguments: (int: 1234), (int: 5)",
+      messages[0].first.getMessage());
+  messages.clear();
+
+  // Streamed arguments are formatted right away
+  FB_LOGF(logger_, WARN, "x={}", 34) << ", also " << 12;
+  ASSERT_EQ(1, messages.size());
+  EXPECT_FALSE(messages[0].first.isTextDeferred());
+  EXPECT_EQ("x=34, also 12", messages[0].first.getMessage());
+  messages.clear();
+
+  // So are other argument types
+  fbstring value{"fb"};
+  FB_LOGF(logger_, WARN, "value={}", value);
+  ASSERT_EQ(1, messages.size());
+  EXPECT_FALSE(messages[0].first.isTextDeferred());
+  EXPECT_EQ("value=fb", messages[0].first.getMessage());
+  messages.clear();
+
+  LoggerDB::setDeferFormatting(false);
+  FB_LOGF(logger_, WARN, "x={}", 34);
+  ASSERT_EQ(1, messages.size());
+  EXPECT_FALSE(messages[0].first.isTextDeferred());
+  EXPECT_EQ("x=34", messages[0].first.getMessage());
+}
+
 TEST_F(LoggerTest, escapeSequences) {
   // Escape characters (and any other unprintable characters) in the log
   // message should be escaped when logged.
@@ -53,6 +53,12 @@ class TestLogWriter : public LogWriter {
       override {
     messages_.emplace_back(buffer.str());
   }
+
+  void writeDeferredMessage(
+      DeferredMessage&& message,
+      uint32_t /* flags */ = 0) override {
+    deferred_.push_back(std::move(message));
+  }
   void flush() override {}
 
   std::vector<std::string>& getMessages() {
@@ -61,9 +67,25 @@ class TestLogWriter : public LogWriter {
   const std::vector<std::string>& getMessages() const {
     return messages_;
   }
+  std::vector<DeferredMessage>& getDeferredMessages() {
+    return deferred_;
+  }
 
  private:
   std::vector<std::string> messages_;
+  std::vector<DeferredMessage> deferred_;
+};
+
+class TestDeferredText : public LogMessage::DeferredText {
+ public:
+  explicit TestDeferredText(int value) : value_(value) {}
+
+  std::string format() const override {
+    return folly::to<std::string>("value ", value_);
+  }
+
+ private:
+  int value_;
 };
 } // namespace
 
@@ -131,3 +153,29 @@ TEST(StandardLogHandler, levelCheck) {
       "ERR::log_cat::handler_cat::src/test.cpp::1234::oh noes", messages.at(2));
   messages.clear();
 }
+
+TEST(StandardLogHandler, deferredText) {
+  auto writer = make_shared<TestLogWriter>();
+  StandardLogHandler handler(make_shared<TestLogFormatter>(), writer);
+
+  LoggerDB db{LoggerDB::TESTING};
+  auto logCategory = db.getCategory("log_cat");
+  auto handlerCategory = db.getCategory("handler_cat");
+
+  {
+    LogMessage msg{logCategory,
+                   LogLevel::INFO,
+                   "src/test.cpp",
+                   1234,
+                   make_shared<TestDeferredText>(42)};
+    EXPECT_TRUE(msg.isTextDeferred());
+    handler.handleMessage(msg, handlerCategory);
+    // The writer formats the message, and the message was not formatted
+    EXPECT_TRUE(msg.isTextDeferred());
+  }
+  EXPECT_EQ(0, writer->getMessages().size());
+  ASSERT_EQ(1, writer->getDeferredMessages().size());
+  EXPECT_EQ(
+      "INFO::log_cat::handler_cat::src/test.cpp::1234::value 42",
+      writer->getDeferredMessages()[0]());
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2004-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Compile out the debug XLOG() statements of this file
+#define FOLLY_XLOG_MIN_LEVEL INFO
+
+#include <folly/experimental/logging/test/XlogHeader1.h>
+#include <folly/experimental/logging/xlog.h>
+
+namespace logging_test {
+size_t testXlogFile3MinLevel(folly::StringPiece msg) {
+  size_t numEvaluated = 0;
+  auto arg = [&] {
+    ++numEvaluated;
+    return msg;
+  };
+  XLOG(DBG1) << "file3 dbg1: " << arg();
+  XLOGF(DBG5, "file3 dbg5: {}", arg());
+  if (XLOG_IS_ON(DBG9)) {
+    arg();
+  }
+  XLOG(INFO, "file3 info: ", arg());
+  return numEvaluated;
+}
+} // namespace logging_test
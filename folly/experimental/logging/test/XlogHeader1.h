@@ -29,7 +29,10 @@ inline void testXlogHdrLoop(size_t numIters, folly::StringPiece arg) {
   XLOGF(DBG1, "finished: {}", arg);
 }
 
-// Prototypes for functions defined in XlogFile1.cpp and XlogFile2.cpp
+// Prototypes for functions defined in XlogFile1.cpp, XlogFile2.cpp and
+// XlogFile3.cpp
 void testXlogFile1Dbg1(folly::StringPiece msg);
 void testXlogFile2Dbg1(folly::StringPiece msg);
+// Returns how many of its log arguments were evaluated
+size_t testXlogFile3MinLevel(folly::StringPiece msg);
 } // namespace logging_test
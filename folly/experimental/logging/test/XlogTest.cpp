@@ -184,3 +184,25 @@ TEST(Xlog, perFileCategoryHandling) {
       messages[0].first.getCategory()->getName());
   messages.clear();
 }
+
+TEST(Xlog, minLevel) {
+  using namespace logging_test;
+  auto handler = make_shared<TestLogHandler>();
+  LoggerDB::get()->getCategory("folly.experimental.logging.test.XlogFile3")
+      ->addHandler(handler);
+  auto& messages = handler->getMessages();
+
+  // XlogFile3.cpp compiles out the statements below INFO, whatever the
+  // category level
+  LoggerDB::get()->setLevel(
+      "folly.experimental.logging.test.XlogFile3", LogLevel::DBG9);
+  EXPECT_EQ(1, testXlogFile3MinLevel("hello"));
+  ASSERT_EQ(1, messages.size());
+  EXPECT_EQ("file3 info: hello", messages[0].first.getMessage());
+  messages.clear();
+
+  LoggerDB::get()->setLevel(
+      "folly.experimental.logging.test.XlogFile3", LogLevel::WARN, false);
+  EXPECT_EQ(0, testXlogFile3MinLevel("world"));
+  EXPECT_EQ(0, messages.size());
+}
@@ -90,7 +90,7 @@ template <bool IsInHeaderFile>
 LogLevel XlogLevelInfo<IsInHeaderFile>::loadLevelFull(
     folly::StringPiece categoryName,
     bool isOverridden) {
-  auto currentLevel = level_.load(std::memory_order_acquire);
+  auto currentLevel = level_.level.load(std::memory_order_acquire);
   if (UNLIKELY(currentLevel == ::folly::LogLevel::UNINITIALIZED)) {
     return LoggerDB::get()->xlogInit(
         isOverridden ? categoryName : getXlogCategoryNameForFile(categoryName),
@@ -115,7 +115,8 @@ LogLevel XlogLevelInfo<false>::loadLevelFull(
     folly::StringPiece categoryName,
     bool isOverridden,
     XlogFileScopeInfo* fileScopeInfo) {
-  auto currentLevel = fileScopeInfo->level.load(std::memory_order_acquire);
+  auto currentLevel =
+      fileScopeInfo->level.level.load(std::memory_order_acquire);
   if (UNLIKELY(currentLevel == ::folly::LogLevel::UNINITIALIZED)) {
     return LoggerDB::get()->xlogInit(
         isOverridden ? categoryName : getXlogCategoryNameForFile(categoryName),
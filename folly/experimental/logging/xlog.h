@@ -36,6 +36,19 @@
  * overridden using XLOG_SET_CATEGORY_NAME() macro.
  */
 
+/**
+ * XLOG() statements with a level lower than FOLLY_XLOG_MIN_LEVEL are compiled
+ * out: their level check is constant, so neither the statement nor its
+ * arguments emit any code.  Define it to the name of a LogLevel before
+ * including this file, usually on the command line; for instance
+ * -DFOLLY_XLOG_MIN_LEVEL=INFO removes all debug XLOG() statements.
+ *
+ * Fatal XLOG() statements are always kept.
+ */
+#ifndef FOLLY_XLOG_MIN_LEVEL
+#define FOLLY_XLOG_MIN_LEVEL MIN_LEVEL
+#endif
+
 /**
  * Log a message to this file's default log category.
  *
@@ -155,17 +168,21 @@
  * automatically keeps it up-to-date when the category's effective level is
  * changed.
  *
+ * Levels below FOLLY_XLOG_MIN_LEVEL are rejected at compile time.
+ *
  * See XlogLevelInfo for the implementation details.
  */
-#define XLOG_IS_ON_IMPL(level)                                         \
-  ([] {                                                                \
-    static ::folly::XlogLevelInfo<XLOG_IS_IN_HEADER_FILE> _xlogLevel_; \
-    return _xlogLevel_.check(                                          \
-        (level),                                                       \
-        xlog_detail::getXlogCategoryName(__FILE__, 0),                 \
-        xlog_detail::isXlogCategoryOverridden(0),                      \
-        &xlog_detail::xlogFileScopeInfo);                              \
-  }())
+#define XLOG_IS_ON_IMPL(level)                                           \
+  (::folly::isXlogLevelCompiledIn(                                       \
+       (level), ::folly::LogLevel::FOLLY_XLOG_MIN_LEVEL) &&              \
+   [] {                                                                  \
+     static ::folly::XlogLevelInfo<XLOG_IS_IN_HEADER_FILE> _xlogLevel_;  \
+     return _xlogLevel_.check(                                           \
+         (level),                                                        \
+         xlog_detail::getXlogCategoryName(__FILE__, 0),                  \
+         xlog_detail::isXlogCategoryOverridden(0),                       \
+         &xlog_detail::xlogFileScopeInfo);                               \
+   }())
 
 /**
  * Get the name of the log category that will be used by XLOG() statements
@@ -237,11 +254,23 @@
 
 namespace folly {
 
-class XlogFileScopeInfo {
+/**
+ * Returns false if XLOG() statements with the given level are compiled out.
+ */
+constexpr bool isXlogLevelCompiledIn(LogLevel level, LogLevel minLevel) {
+  return level >= minLevel || isLogLevelFatal(level);
+}
+
+/*
+ * Aligned so that the level, which every XLOG() statement of the file
+ * checks, and the category, which enabled statements read next, share a
+ * cache line.
+ */
+class alignas(32) XlogFileScopeInfo {
  public:
 #ifdef __INCLUDE_LEVEL__
-  std::atomic<::folly::LogLevel> level;
-  ::folly::LogCategory* category;
+  ::folly::XlogLevelCache level;
+  std::atomic<::folly::LogCategory*> category;
 #endif
 };
 
@@ -268,7 +297,7 @@ class XlogLevelInfo {
     // we disabled debug statements to be cheap.  If the log message is
     // enabled then this check will still be minimal perf overhead compared to
     // the overall cost of logging it.
-    if (LIKELY(levelToCheck < level_.load(std::memory_order_relaxed))) {
+    if (LIKELY(levelToCheck < level_.level.load(std::memory_order_relaxed))) {
       return false;
     }
 
@@ -289,7 +318,7 @@ class XlogLevelInfo {
 
   // XlogLevelInfo objects are always defined with static storage.
   // This member will always be zero-initialized on program start.
-  std::atomic<LogLevel> level_;
+  XlogLevelCache level_;
 };
 
 template <bool IsInHeaderFile>
@@ -302,7 +331,7 @@ class XlogCategoryInfo {
   LogCategory* init(folly::StringPiece categoryName, bool isOverridden);
 
   LogCategory* getCategory(XlogFileScopeInfo*) {
-    return category_;
+    return category_.load(std::memory_order_relaxed);
   }
 
   /**
@@ -316,7 +345,7 @@ class XlogCategoryInfo {
  private:
   // These variables will always be zero-initialized on program start.
   std::atomic<bool> isInitialized_;
-  LogCategory* category_;
+  std::atomic<LogCategory*> category_;
 };
 
 #ifdef __INCLUDE_LEVEL__
@@ -337,7 +366,7 @@ class XlogLevelInfo<false> {
     // relaxed check first.
     if (LIKELY(
             levelToCheck <
-            fileScopeInfo->level.load(::std::memory_order_relaxed))) {
+            fileScopeInfo->level.level.load(::std::memory_order_relaxed))) {
       return false;
     }
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <memory>
+
+#include <folly/Unit.h>
+#include <folly/experimental/ReadMostlyCell.h>
+#include <folly/experimental/observer/Observer.h>
+
+namespace folly {
+namespace observer {
+
+/**
+ * HazptrObserver has the read interface of Observer, but getSnapshot()
+ * doesn't touch a shared reference count: the current value is kept in a
+ * ReadMostlyCell, updated when the Observer changes, and snapshots are
+ * protected by hazard pointers.  Use it instead of Observer (or
+ * TLObserver, when there are many threads) for values that are read very
+ * often.
+ *
+ *   HazptrObserver<Config> config(configObserver);
+ *   auto snapshot = config.getSnapshot();
+ *   use(snapshot->timeout);
+ *
+ * Snapshots behave like observer::Snapshot, except that getVersion()
+ * counts the updates seen by this HazptrObserver.  Copies of a
+ * HazptrObserver share its cell.
+ */
+template <typename T>
+class HazptrObserver {
+ public:
+  using Snapshot = typename ReadMostlyCell<T>::Snapshot;
+
+  explicit HazptrObserver(Observer<T> observer)
+      : cell_(std::make_shared<ReadMostlyCell<T>>(toShared(observer))),
+        updater_(makeObserver(
+            [observer = std::move(observer), cell = cell_]() mutable {
+              auto data = toShared(observer);
+              if (data.get() != cell->getSnapshot().get()) {
+                cell->publish(std::move(data));
+              }
+              return Unit{};
+            })) {}
+
+  Snapshot getSnapshot() const {
+    return cell_->getSnapshot();
+  }
+
+  Snapshot operator*() const {
+    return getSnapshot();
+  }
+
+  /* Whether snapshot, from this HazptrObserver, is out of date */
+  bool needRefresh(const Snapshot& snapshot) const {
+    return cell_->needRefresh(snapshot);
+  }
+
+ private:
+  // Keeps the observer::Snapshot, and so the value, alive
+  static std::shared_ptr<const T> toShared(const Observer<T>& observer) {
+    auto snapshot =
+        std::make_shared<observer::Snapshot<T>>(observer.getSnapshot());
+    auto ptr = snapshot->get();
+    return std::shared_ptr<const T>(std::move(snapshot), ptr);
+  }
+
+  std::shared_ptr<ReadMostlyCell<T>> cell_;
+  Observer<Unit> updater_;
+};
+
+template <typename T>
+HazptrObserver<T> makeHazptrObserver(Observer<T> observer) {
+  return HazptrObserver<T>(std::move(observer));
+}
+
+template <typename F>
+auto makeHazptrObserver(F&& creator) {
+  return makeHazptrObserver(makeObserver(std::forward<F>(creator)));
+}
+
+} // namespace observer
+} // namespace folly
@@ -61,7 +61,8 @@ size_t Core::refresh(size_t version, bool force) {
       return versionLastChange_;
     }
 
-    bool needRefresh = force || version_ == 0;
+    bool needRefresh =
+        forceRefresh_.exchange(false) || force || version_ == 0;
 
     ObserverManager::DependencyRecorder dependencyRecorder(*this);
 
@@ -136,7 +137,8 @@ size_t Core::refresh(size_t version, bool force) {
   auto dependents = dependents_.copy();
 
   for (const auto& dependentWeak : dependents) {
-    if (auto dependent = dependentWeak.lock()) {
+    auto dependent = dependentWeak.lock();
+    if (dependent && dependent->markScheduled(version)) {
       ObserverManager::scheduleRefresh(std::move(dependent), version);
     }
   }
@@ -166,6 +168,16 @@ void Core::addDependent(Core::WeakPtr dependent) {
   });
 }
 
+bool Core::markScheduled(size_t version) {
+  auto scheduled = versionScheduled_.load();
+  while (scheduled < version) {
+    if (versionScheduled_.compare_exchange_weak(scheduled, version)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void Core::removeStaleDependents() {
   // This is inefficient, the assumption is that we won't have many dependents
   dependents_.withWLock([](Dependents& dependents) {
@@ -88,6 +88,15 @@ class Core : public std::enable_shared_from_this<Core> {
    */
   size_t refresh(size_t version, bool force = false);
 
+  /**
+   * Makes the next refresh re-compute the observed object, even if it's
+   * for a version its dependencies didn't change in, or if it is pulled by
+   * a dependent before its own scheduled refresh runs.
+   */
+  void setForceRefresh() {
+    forceRefresh_ = true;
+  }
+
   ~Core();
 
  private:
@@ -96,6 +105,11 @@ class Core : public std::enable_shared_from_this<Core> {
   void addDependent(Core::WeakPtr dependent);
   void removeStaleDependents();
 
+  // Returns true if this wasn't scheduled to be refreshed at version yet,
+  // so that it's scheduled once per version, however many of its
+  // dependencies change in it.
+  bool markScheduled(size_t version);
+
   using Dependents = std::vector<WeakPtr>;
   using Dependencies = std::unordered_set<Ptr>;
 
@@ -104,6 +118,8 @@ class Core : public std::enable_shared_from_this<Core> {
 
   std::atomic<size_t> version_{0};
   std::atomic<size_t> versionLastChange_{0};
+  std::atomic<size_t> versionScheduled_{0};
+  std::atomic<bool> forceRefresh_{false};
 
   folly::Synchronized<VersionedData> data_;
 
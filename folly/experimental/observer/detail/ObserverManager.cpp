@@ -20,6 +20,7 @@
 #include <folly/MPMCQueue.h>
 #include <folly/Range.h>
 #include <folly/Singleton.h>
+#include <folly/concurrency/UnboundedQueue.h>
 #include <folly/portability/GFlags.h>
 #include <folly/system/ThreadName.h>
 
@@ -38,13 +39,12 @@ DEFINE_int32(
 static constexpr StringPiece kObserverManagerThreadNamePrefix{"ObserverMngr"};
 
 namespace {
-constexpr size_t kCurrentQueueSize{10 * 1024};
 constexpr size_t kNextQueueSize{10 * 1024};
 } // namespace
 
 class ObserverManager::CurrentQueue {
  public:
-  CurrentQueue() : queue_(kCurrentQueueSize) {
+  CurrentQueue() {
     if (FLAGS_observer_manager_pool_size < 1) {
       LOG(ERROR) << "--observer_manager_pool_size should be >= 1";
       FLAGS_observer_manager_pool_size = 1;
@@ -57,7 +57,7 @@ class ObserverManager::CurrentQueue {
 
         while (true) {
           Function<void()> task;
-          queue_.blockingRead(task);
+          queue_.dequeue(task);
 
           if (!task) {
             return;
@@ -76,28 +76,24 @@ class ObserverManager::CurrentQueue {
 
   ~CurrentQueue() {
     for (size_t i = 0; i < threads_.size(); ++i) {
-      queue_.blockingWrite(nullptr);
+      queue_.enqueue(nullptr);
     }
 
     for (auto& thread : threads_) {
       thread.join();
     }
 
-    CHECK(queue_.isEmpty());
+    CHECK(queue_.empty());
   }
 
+  // Never blocks or fails: a batch of updates schedules at most one
+  // refresh of each Observer, but there may be any number of them.
   void add(Function<void()> task) {
-    if (ObserverManager::inManagerThread()) {
-      if (!queue_.write(std::move(task))) {
-        throw std::runtime_error("Too many Observers scheduled for update.");
-      }
-    } else {
-      queue_.blockingWrite(std::move(task));
-    }
+    queue_.enqueue(std::move(task));
   }
 
  private:
-  MPMCQueue<Function<void()>> queue_;
+  UMPMCQueue<Function<void()>, true> queue_;
   std::vector<std::thread> threads_;
 };
 
@@ -137,6 +133,12 @@ class ObserverManager::NextQueue {
             }
           }
 
+          // Leaf Observers may be refreshed by their dependents before
+          // their own refreshes run, and must still pick up their new
+          // values.
+          for (auto& core : cores) {
+            core->setForceRefresh();
+          }
           ++manager_.version_;
         }
 
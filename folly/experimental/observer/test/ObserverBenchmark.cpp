@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/experimental/observer/SimpleObservable.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly::observer;
+
+BENCHMARK(GetSnapshot, iters) {
+  SimpleObservable<int> observable(42);
+  auto observer = observable.getObserver();
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    sum += *observer.getSnapshot();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK(GetSnapshotDerived, iters) {
+  SimpleObservable<int> observable(42);
+  auto observer = makeObserver(
+      [child = observable.getObserver()] { return **child + 1; });
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    sum += *observer.getSnapshot();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Updates n Observables at once, and waits for an Observer of all of them
+// to see the new values
+void updateMany(size_t iters, size_t n) {
+  std::vector<std::unique_ptr<SimpleObservable<size_t>>> observables;
+  std::vector<Observer<size_t>> observers;
+  BENCHMARK_SUSPEND {
+    for (size_t i = 0; i < n; ++i) {
+      observables.push_back(std::make_unique<SimpleObservable<size_t>>(0));
+      observers.push_back(observables.back()->getObserver());
+    }
+  }
+  auto sum = makeObserver([observers] {
+    size_t result = 0;
+    for (auto& observer : observers) {
+      result += **observer;
+    }
+    return result;
+  });
+
+  for (size_t i = 1; i <= iters; ++i) {
+    for (auto& observable : observables) {
+      observable->setValue(i);
+    }
+    while (**sum != i * n) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+BENCHMARK_PARAM(updateMany, 1)
+BENCHMARK_PARAM(updateMany, 100)
+BENCHMARK_PARAM(updateMany, 10000)
+
+BENCHMARK_DRAW_LINE();
+
+// Updates an Observable with n Observers, and waits for all of them to see
+// the new value
+void fanOut(size_t iters, size_t n) {
+  SimpleObservable<size_t> observable(0);
+  std::vector<Observer<size_t>> observers;
+  BENCHMARK_SUSPEND {
+    for (size_t i = 0; i < n; ++i) {
+      observers.push_back(makeObserver(
+          [child = observable.getObserver()] { return **child; }));
+    }
+  }
+
+  for (size_t i = 1; i <= iters; ++i) {
+    observable.setValue(i);
+    for (auto& observer : observers) {
+      while (**observer != i) {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+BENCHMARK_PARAM(fanOut, 1)
+BENCHMARK_PARAM(fanOut, 100)
+BENCHMARK_PARAM(fanOut, 10000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -17,6 +17,7 @@
 #include <thread>
 
 #include <folly/Baton.h>
+#include <folly/experimental/observer/HazptrObserver.h>
 #include <folly/experimental/observer/SimpleObservable.h>
 #include <folly/portability/GTest.h>
 
@@ -251,6 +252,41 @@ TEST(Observer, Stress) {
   });
 }
 
+TEST(Observer, ManyObservables) {
+  // More Observables updated at once than the manager's queues hold
+  constexpr size_t numObservables = 12000;
+  std::vector<std::unique_ptr<SimpleObservable<int>>> observables;
+  std::vector<Observer<int>> observers;
+  for (size_t i = 0; i < numObservables; ++i) {
+    observables.push_back(std::make_unique<SimpleObservable<int>>(0));
+    observers.push_back(observables.back()->getObserver());
+  }
+
+  auto computations = std::make_shared<std::atomic<size_t>>(0);
+  auto observer = makeObserver([observers, computations] {
+    ++*computations;
+    int sum = 0;
+    for (auto& child : observers) {
+      sum += **child;
+    }
+    return sum;
+  });
+  EXPECT_EQ(0, **observer);
+
+  for (auto& observable : observables) {
+    observable->setValue(1);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while (**observer != int(numObservables) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(int(numObservables), **observer);
+  // Once per batch of updates, not once per update
+  EXPECT_LT(*computations, numObservables / 100);
+}
+
 TEST(Observer, TLObserver) {
   auto createTLObserver = [](int value) {
     return folly::observer::makeTLObserver([=] { return value; });
@@ -263,6 +299,28 @@ TEST(Observer, TLObserver) {
   EXPECT_EQ(41, ***k);
 }
 
+TEST(Observer, HazptrObserver) {
+  SimpleObservable<int> observable(42);
+  auto observer = makeHazptrObserver(observable.getObserver());
+
+  auto snapshot = observer.getSnapshot();
+  EXPECT_EQ(42, *snapshot);
+  EXPECT_FALSE(observer.needRefresh(snapshot));
+
+  observable.setValue(24);
+  for (int i = 0; i < 1000 && !observer.needRefresh(snapshot); ++i) {
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds{1});
+  }
+  EXPECT_TRUE(observer.needRefresh(snapshot));
+  EXPECT_EQ(24, **observer);
+  // Old snapshots keep their value
+  EXPECT_EQ(42, *snapshot);
+
+  auto copy = observer;
+  EXPECT_EQ(24, **copy);
+}
+
 TEST(Observer, SubscribeCallback) {
   static auto mainThreadId = std::this_thread::get_id();
   static std::function<void()> updatesCob;
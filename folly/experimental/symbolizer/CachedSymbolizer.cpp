@@ -0,0 +1,312 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/symbolizer/CachedSymbolizer.h>
+
+#include <link.h>
+
+#include <algorithm>
+#include <climits>
+#include <limits>
+
+#include <folly/Bits.h>
+#include <folly/Memory.h>
+#include <folly/ScopeGuard.h>
+#include <folly/hash/Hash.h>
+#include <folly/portability/Unistd.h>
+
+extern struct r_debug _r_debug;
+
+namespace folly {
+namespace symbolizer {
+
+namespace {
+
+ElfCache* defaultElfCache() {
+  static constexpr size_t defaultCapacity = 500;
+  static auto cache = new ElfCache(defaultCapacity);
+  return cache;
+}
+
+} // namespace
+
+constexpr size_t CachedSymbolizer::kDefaultCacheSize;
+
+CachedSymbolizer::Module::Module(
+    std::string path_,
+    std::shared_ptr<ElfFile> file_,
+    uintptr_t bias_,
+    uintptr_t start_,
+    uintptr_t end_)
+    : path(std::move(path_)),
+      file(std::move(file_)),
+      bias(bias_),
+      start(start_),
+      end(end_),
+      dwarf(file.get()) {}
+
+const CachedSymbolizer::Symbol* CachedSymbolizer::Module::findSymbol(
+    uintptr_t address) const {
+  auto it = std::upper_bound(
+      symbols.begin(),
+      symbols.end(),
+      address,
+      [](uintptr_t addr, const Symbol& sym) { return addr < sym.start; });
+  // Symbols may be nested; walk back until none of the earlier ones can
+  // contain the address.
+  while (it != symbols.begin()) {
+    --it;
+    if (address < it->end) {
+      return &*it;
+    }
+    if (it->maxEnd <= address) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+CachedSymbolizer::CachedSymbolizer(
+    Dwarf::LocationInfoMode mode,
+    size_t cacheSize,
+    ElfCacheBase* cache)
+    : cache_(cache ? cache : defaultElfCache()),
+      mode_(mode),
+      mask_(nextPowTwo(std::max<size_t>(cacheSize, 1)) - 1),
+      entries_(new std::atomic<Entry*>[mask_ + 1]) {
+  for (size_t i = 0; i <= mask_; ++i) {
+    entries_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+CachedSymbolizer::~CachedSymbolizer() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    delete entries_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void CachedSymbolizer::symbolize(
+    const uintptr_t* addresses,
+    SymbolizedFrame* frames,
+    size_t frameCount) {
+  hazptr::hazptr_holder hptr;
+  for (size_t i = 0; i < frameCount; ++i) {
+    auto& frame = frames[i];
+    if (frame.found) {
+      continue;
+    }
+    auto const address = addresses[i];
+    if (lookup(hptr, address, frame)) {
+      continue;
+    }
+
+    frame.clear();
+    auto entry = symbolizeSlow(address);
+    if (!entry) {
+      continue;
+    }
+    fillFrame(*entry, frame);
+    auto& slot = entries_[hash::twang_mix64(address) & mask_];
+    auto old = slot.exchange(entry.release(), std::memory_order_acq_rel);
+    if (old) {
+      old->retire(cohort_);
+    }
+  }
+}
+
+bool CachedSymbolizer::lookup(
+    hazptr::hazptr_holder& hptr,
+    uintptr_t address,
+    SymbolizedFrame& frame) const {
+  auto& slot = entries_[hash::twang_mix64(address) & mask_];
+  auto entry = hptr.get_protected(slot);
+  SCOPE_EXIT {
+    hptr.reset();
+  };
+  if (!entry || entry->address != address) {
+    return false;
+  }
+  fillFrame(*entry, frame);
+  return true;
+}
+
+void CachedSymbolizer::fillFrame(const Entry& entry, SymbolizedFrame& frame) {
+  frame.clear();
+  frame.found = true;
+  frame.name = entry.name;
+  frame.location = entry.location;
+  frame.file_ = entry.module->file;
+}
+
+std::unique_ptr<CachedSymbolizer::Entry> CachedSymbolizer::symbolizeSlow(
+    uintptr_t address) {
+  const Module* module = nullptr;
+  bool reload = false;
+  {
+    SharedMutex::ReadHolder guard(modulesMutex_);
+    module = findModule(address);
+    reload = !module && countLoadedElfFiles() != loadedCount_;
+  }
+  if (reload) {
+    SharedMutex::WriteHolder guard(modulesMutex_);
+    module = findModule(address);
+    if (!module && countLoadedElfFiles() != loadedCount_) {
+      loadModules();
+      module = findModule(address);
+    }
+  }
+  if (!module) {
+    // Not cached, so that it can be found if its library gets loaded
+    return nullptr;
+  }
+
+  auto entry = std::make_unique<Entry>();
+  entry->address = address;
+  entry->module = module;
+  entry->name = nullptr;
+  auto const fileAddress = address - module->bias;
+  if (auto sym = module->findSymbol(fileAddress)) {
+    entry->name = sym->name;
+    module->dwarf.findAddress(fileAddress, entry->location, mode_);
+  }
+  return entry;
+}
+
+const CachedSymbolizer::Module* CachedSymbolizer::findModule(
+    uintptr_t address) const {
+  auto it = std::upper_bound(
+      modules_.begin(),
+      modules_.end(),
+      address,
+      [](uintptr_t addr, const std::unique_ptr<Module>& module) {
+        return addr < module->start;
+      });
+  if (it == modules_.begin() || address >= (*--it)->end) {
+    return nullptr;
+  }
+  return it->get();
+}
+
+void CachedSymbolizer::loadModules() {
+  loadedCount_ = countLoadedElfFiles();
+  if (_r_debug.r_version != 1) {
+    return;
+  }
+
+  char selfPath[PATH_MAX + 8];
+  ssize_t selfSize;
+  if ((selfSize = readlink("/proc/self/exe", selfPath, PATH_MAX + 1)) == -1) {
+    return;
+  }
+  selfPath[selfSize] = '\0';
+
+  for (auto lmap = _r_debug.r_map; lmap != nullptr; lmap = lmap->l_next) {
+    // See Symbolizer::symbolize() for the empty name. l_addr is the
+    // difference between run time and file addresses, 0 for executables
+    // that aren't position-independent.
+    auto const objPath = lmap->l_name[0] != '\0' ? lmap->l_name : selfPath;
+    auto const bias = uintptr_t(lmap->l_addr);
+    auto known = std::any_of(
+        modules_.begin(),
+        modules_.end(),
+        [&](const std::unique_ptr<Module>& module) {
+          return module->bias == bias && module->path == objPath;
+        });
+    if (known) {
+      continue;
+    }
+
+    auto elfFile = cache_->getFile(objPath);
+    if (!elfFile) {
+      continue;
+    }
+    if (auto module = loadModule(objPath, std::move(elfFile), bias)) {
+      modules_.push_back(std::move(module));
+    }
+  }
+
+  std::sort(
+      modules_.begin(),
+      modules_.end(),
+      [](const std::unique_ptr<Module>& a, const std::unique_ptr<Module>& b) {
+        return a->start < b->start;
+      });
+}
+
+std::unique_ptr<CachedSymbolizer::Module> CachedSymbolizer::loadModule(
+    const char* path,
+    std::shared_ptr<ElfFile> file,
+    uintptr_t bias) {
+  auto start = std::numeric_limits<uintptr_t>::max();
+  uintptr_t end = 0;
+  file->iterateProgramHeaders([&](const ElfPhdr& ph) {
+    if (ph.p_type == PT_LOAD && ph.p_memsz != 0) {
+      start = std::min<uintptr_t>(start, ph.p_vaddr);
+      end = std::max<uintptr_t>(end, ph.p_vaddr + ph.p_memsz);
+    }
+    return false;
+  });
+  if (start >= end) {
+    return nullptr;
+  }
+
+  auto module = std::make_unique<Module>(
+      path, std::move(file), bias, start + bias, end + bias);
+  auto& elf = *module->file;
+  auto& symbols = module->symbols;
+
+  // Same symbols as ElfFile::getDefinitionByAddress(), which prefers those
+  // of .dynsym; stable_sort keeps them first among those at one address.
+  auto addSymbols = [&](const ElfShdr& section) {
+    elf.iterateSymbolsWithTypes(
+        section, {STT_OBJECT, STT_FUNC, STT_GNU_IFUNC}, [&](const ElfSym& sym) {
+          if (sym.st_shndx != SHN_UNDEF && sym.st_size != 0) {
+            symbols.push_back(Symbol{sym.st_value,
+                                     sym.st_value + sym.st_size,
+                                     0,
+                                     elf.getSymbolName({&section, &sym})});
+          }
+          return false;
+        });
+    return false;
+  };
+  elf.iterateSectionsWithType(SHT_DYNSYM, addSymbols);
+  elf.iterateSectionsWithType(SHT_SYMTAB, addSymbols);
+
+  std::stable_sort(
+      symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.start < b.start;
+      });
+  symbols.erase(
+      std::unique(
+          symbols.begin(),
+          symbols.end(),
+          [](const Symbol& a, const Symbol& b) {
+            return a.start == b.start && a.end == b.end;
+          }),
+      symbols.end());
+  uintptr_t maxEnd = 0;
+  for (auto& sym : symbols) {
+    maxEnd = std::max(maxEnd, sym.end);
+    sym.maxEnd = maxEnd;
+  }
+  symbols.shrink_to_fit();
+
+  return module;
+}
+
+} // namespace symbolizer
+} // namespace folly
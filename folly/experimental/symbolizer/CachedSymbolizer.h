@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/SharedMutex.h>
+#include <folly/experimental/hazptr/hazptr.h>
+#include <folly/experimental/symbolizer/Dwarf.h>
+#include <folly/experimental/symbolizer/Elf.h>
+#include <folly/experimental/symbolizer/ElfCache.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+
+namespace folly {
+namespace symbolizer {
+
+/**
+ * Symbolizer for the code of the running process that remembers what it
+ * found, for when the same addresses are symbolized over and over again,
+ * e.g. by a sampling profiler.
+ *
+ * Symbolized addresses are kept in a fixed-size, direct-mapped cache whose
+ * lookups take no locks (entries are protected by hazard pointers). On a
+ * miss, the address is looked up in a sorted index of the symbols of the
+ * ELF file that contains it, built the first time that file is seen,
+ * instead of scanning its symbol tables; only the DWARF line lookup still
+ * happens for every miss.
+ *
+ * Libraries loaded later are found on the next miss for an address
+ * outside of the known ones; such addresses are not cached. Libraries must
+ * not be unloaded while the CachedSymbolizer exists: the names of its
+ * frames point into their ELF files, and cached addresses are not
+ * invalidated.
+ *
+ * MT-safe. Not async-signal-safe.
+ */
+class CachedSymbolizer {
+ public:
+  static constexpr size_t kDefaultCacheSize = 16384;
+
+  explicit CachedSymbolizer(
+      Dwarf::LocationInfoMode mode = Symbolizer::kDefaultLocationInfoMode)
+      : CachedSymbolizer(mode, kDefaultCacheSize) {}
+
+  /**
+   * cacheSize is the number of cached addresses, rounded up to a power of
+   * two. ELF files are opened through cache, or a default ElfCache if
+   * null; they are kept open for as long as the CachedSymbolizer exists.
+   */
+  CachedSymbolizer(
+      Dwarf::LocationInfoMode mode,
+      size_t cacheSize,
+      ElfCacheBase* cache = nullptr);
+
+  ~CachedSymbolizer();
+
+  CachedSymbolizer(const CachedSymbolizer&) = delete;
+  CachedSymbolizer& operator=(const CachedSymbolizer&) = delete;
+
+  /**
+   * Symbolize given addresses, like Symbolizer::symbolize(). Frames that
+   * are already found are left alone.
+   */
+  void symbolize(
+      const uintptr_t* addresses,
+      SymbolizedFrame* frames,
+      size_t frameCount);
+
+  template <size_t N>
+  void symbolize(FrameArray<N>& fa) {
+    symbolize(fa.addresses, fa.frames, fa.frameCount);
+  }
+
+  /**
+   * Shortcut to symbolize one address.
+   */
+  bool symbolize(uintptr_t address, SymbolizedFrame& frame) {
+    symbolize(&address, &frame, 1);
+    return frame.found;
+  }
+
+ private:
+  struct Symbol {
+    uintptr_t start;
+    uintptr_t end;
+    // Largest end of this symbol and those before it
+    uintptr_t maxEnd;
+    const char* name;
+  };
+
+  // An ELF file mapped in the process, and the index of its symbols
+  struct Module {
+    Module(
+        std::string path,
+        std::shared_ptr<ElfFile> file,
+        uintptr_t bias,
+        uintptr_t start,
+        uintptr_t end);
+
+    // Symbol containing the given file address, or nullptr
+    const Symbol* findSymbol(uintptr_t address) const;
+
+    const std::string path;
+    const std::shared_ptr<ElfFile> file;
+    // Difference between run time and file addresses
+    const uintptr_t bias;
+    // Run time addresses of its loaded segments, [start, end)
+    const uintptr_t start;
+    const uintptr_t end;
+    const Dwarf dwarf;
+    // Sorted by start
+    std::vector<Symbol> symbols;
+  };
+
+  struct Entry : hazptr::hazptr_obj_base<Entry> {
+    uintptr_t address;
+    const Module* module;
+    const char* name;
+    Dwarf::LocationInfo location;
+  };
+
+  bool lookup(
+      hazptr::hazptr_holder& hptr,
+      uintptr_t address,
+      SymbolizedFrame& frame) const;
+  std::unique_ptr<Entry> symbolizeSlow(uintptr_t address);
+  const Module* findModule(uintptr_t address) const;
+  void loadModules();
+  std::unique_ptr<Module> loadModule(
+      const char* path,
+      std::shared_ptr<ElfFile> file,
+      uintptr_t bias);
+  static void fillFrame(const Entry& entry, SymbolizedFrame& frame);
+
+  ElfCacheBase* const cache_;
+  const Dwarf::LocationInfoMode mode_;
+
+  const size_t mask_;
+  std::unique_ptr<std::atomic<Entry*>[]> entries_;
+
+  // Protects modules_, sorted by start. Modules are never removed.
+  mutable SharedMutex modulesMutex_;
+  std::vector<std::unique_ptr<Module>> modules_;
+  // countLoadedElfFiles() when modules_ was last updated
+  size_t loadedCount_{0};
+
+  // Replaced entries; they are all reclaimed by the time we are gone
+  hazptr::hazptr_obj_cohort cohort_;
+};
+
+} // namespace symbolizer
+} // namespace folly
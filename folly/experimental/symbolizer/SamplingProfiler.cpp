@@ -0,0 +1,278 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/symbolizer/SamplingProfiler.h>
+
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+#include <folly/Exception.h>
+#include <folly/Format.h>
+#include <folly/experimental/symbolizer/CachedSymbolizer.h>
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/hash/Hash.h>
+#include <folly/portability/SysSyscall.h>
+#include <folly/portability/Unistd.h>
+
+namespace folly {
+namespace symbolizer {
+
+namespace {
+
+// The profiler that samples, and the number of signal handlers that may
+// be using it
+std::atomic<SamplingProfiler*> activeProfiler{nullptr};
+std::atomic<int> runningHandlers{0};
+
+// Frames of the signal handler itself, dropped from the samples
+constexpr size_t kHandlerFrames = 8;
+
+// Address of the instruction interrupted by the signal, 0 if unknown
+uintptr_t getInterruptedAddress(void* context) {
+#if defined(__linux__) && defined(__x86_64__)
+  return uintptr_t(
+      static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__linux__) && defined(__aarch64__)
+  return uintptr_t(static_cast<ucontext_t*>(context)->uc_mcontext.pc);
+#else
+  (void)context;
+  return 0;
+#endif
+}
+
+} // namespace
+
+constexpr size_t SamplingProfiler::kMaxFrames;
+
+size_t SamplingProfiler::StackHash::operator()(
+    const std::vector<uintptr_t>& stack) const {
+  return hash::hash_range(stack.begin(), stack.end());
+}
+
+SamplingProfiler::SamplingProfiler(Options options) : options_(options) {
+  buffers_.reserve(options_.maxThreads);
+  for (size_t i = 0; i < options_.maxThreads; ++i) {
+    buffers_.push_back(std::make_unique<ThreadBuffer>(options_.bufferSize));
+  }
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  stop();
+}
+
+void SamplingProfiler::start() {
+  if (running_) {
+    return;
+  }
+  SamplingProfiler* expected = nullptr;
+  if (!activeProfiler.compare_exchange_strong(expected, this)) {
+    throw std::logic_error("SamplingProfiler: another profiler is running");
+  }
+  installSignalHandler();
+  stopping_ = false;
+  drainThread_ = std::thread([this] { drainLoop(); });
+  running_ = true;
+
+  auto usec = std::max<int64_t>(options_.interval.count(), 1);
+  struct itimerval timer;
+  timer.it_interval.tv_sec = usec / 1000000;
+  timer.it_interval.tv_usec = usec % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    int savedErrno = errno;
+    stop();
+    throwSystemErrorExplicit(savedErrno, "setitimer");
+  }
+}
+
+void SamplingProfiler::stop() {
+  if (!running_) {
+    return;
+  }
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, nullptr);
+
+  // No handler touches our buffers once it's over
+  activeProfiler.store(nullptr);
+  while (runningHandlers.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    stopping_ = true;
+  }
+  drainCond_.notify_one();
+  drainThread_.join();
+  drain();
+  running_ = false;
+}
+
+std::string SamplingProfiler::getCollapsedStacks() const {
+  std::vector<std::pair<std::vector<uintptr_t>, uint64_t>> stacks;
+  {
+    std::lock_guard<std::mutex> lock(stacksMutex_);
+    stacks.assign(stacks_.begin(), stacks_.end());
+  }
+
+  // Stacks that differ only by their addresses within functions are merged
+  CachedSymbolizer symbolizer;
+  std::map<std::string, uint64_t> lines;
+  std::vector<uintptr_t> addresses;
+  std::vector<SymbolizedFrame> frames;
+  for (const auto& stack : stacks) {
+    auto const& sampled = stack.first;
+    // Return addresses point after their call, which may be in the next
+    // function or line
+    addresses.assign(sampled.begin(), sampled.end());
+    for (size_t i = 1; i < addresses.size(); ++i) {
+      --addresses[i];
+    }
+    frames.assign(addresses.size(), SymbolizedFrame());
+    symbolizer.symbolize(addresses.data(), frames.data(), frames.size());
+
+    std::string line;
+    for (size_t i = frames.size(); i-- > 0;) {
+      if (!line.empty()) {
+        line.push_back(';');
+      }
+      if (frames[i].found && frames[i].name) {
+        line += frames[i].demangledName().toStdString();
+      } else {
+        line += sformat("{:#x}", sampled[i]);
+      }
+    }
+    lines[line] += stack.second;
+  }
+
+  std::string out;
+  for (const auto& line : lines) {
+    out += sformat("{} {}\n", line.first, line.second);
+  }
+  return out;
+}
+
+uint64_t SamplingProfiler::getSampleCount() const {
+  std::lock_guard<std::mutex> lock(stacksMutex_);
+  return sampleCount_;
+}
+
+void SamplingProfiler::installSignalHandler() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = &SamplingProfiler::signalHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    checkUnixError(sigaction(SIGPROF, &sa, nullptr), "sigaction");
+  });
+}
+
+void SamplingProfiler::signalHandler(
+    int /* signo */,
+    siginfo_t* /* info */,
+    void* context) {
+  int savedErrno = errno;
+  runningHandlers.fetch_add(1);
+  if (auto profiler = activeProfiler.load()) {
+    profiler->takeSample(context);
+  }
+  runningHandlers.fetch_sub(1);
+  errno = savedErrno;
+}
+
+void SamplingProfiler::takeSample(void* context) {
+  uintptr_t frames[kMaxFrames + kHandlerFrames];
+  auto n = getStackTraceSafe(frames, kMaxFrames + kHandlerFrames);
+  if (n <= 0) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Start from the interrupted frame if it can be found
+  size_t first = 0;
+  auto const address = getInterruptedAddress(context);
+  for (size_t i = 0; address != 0 && i < size_t(n); ++i) {
+    if (frames[i] == address) {
+      first = i;
+      break;
+    }
+  }
+
+  auto buffer = getThreadBuffer();
+  if (!buffer) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Sample sample;
+  sample.frameCount = std::min(size_t(n) - first, kMaxFrames);
+  memcpy(
+      sample.frames, frames + first, sample.frameCount * sizeof(uintptr_t));
+  if (!buffer->queue.write(sample)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+SamplingProfiler::ThreadBuffer* SamplingProfiler::getThreadBuffer() {
+  // No thread-local storage, its first use may allocate
+  auto const tid = pid_t(syscall(FOLLY_SYS_gettid));
+  auto const count = buffers_.size();
+  auto const start = size_t(hash::twang_mix64(uint64_t(tid))) % count;
+  for (size_t i = 0; i < count; ++i) {
+    auto buffer = buffers_[(start + i) % count].get();
+    auto owner = buffer->tid.load(std::memory_order_relaxed);
+    if (owner == tid) {
+      return buffer;
+    }
+    if (owner == 0 &&
+        buffer->tid.compare_exchange_strong(
+            owner, tid, std::memory_order_relaxed)) {
+      return buffer;
+    }
+  }
+  return nullptr;
+}
+
+void SamplingProfiler::drainLoop() {
+  std::unique_lock<std::mutex> lock(drainMutex_);
+  while (!drainCond_.wait_for(
+      lock, options_.drainInterval, [&] { return stopping_; })) {
+    drain();
+  }
+}
+
+void SamplingProfiler::drain() {
+  std::lock_guard<std::mutex> lock(stacksMutex_);
+  for (auto& buffer : buffers_) {
+    while (auto sample = buffer->queue.frontPtr()) {
+      ++stacks_[std::vector<uintptr_t>(
+          sample->frames, sample->frames + sample->frameCount)];
+      ++sampleCount_;
+      buffer->queue.popFront();
+    }
+  }
+}
+
+} // namespace symbolizer
+} // namespace folly
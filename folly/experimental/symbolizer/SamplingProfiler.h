@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * CPU profiler that samples the stacks of the threads of the process.
+ *
+ *   SamplingProfiler profiler;
+ *   profiler.start();
+ *   sleep(30);
+ *   profiler.stop();
+ *   std::cout << profiler.getCollapsedStacks();
+ *
+ * SIGPROF is delivered every interval of CPU time used by the process, to
+ * the thread that was running. Its handler captures the stack of that
+ * thread into a lock-free ring buffer of the thread, without allocating or
+ * locking; a background thread empties the buffers every drainInterval
+ * and counts identical stacks. Stacks are only symbolized when asked for.
+ *
+ * The output is in the "collapsed" format of flame graph tools: one line
+ * per distinct stack, its frames from the outermost one, separated by ';',
+ * then a space and the number of samples.
+ *
+ * Only one SamplingProfiler may run at a time in a process. The SIGPROF
+ * handler stays installed once started, and nothing else may use SIGPROF
+ * or ITIMER_PROF.
+ */
+
+#pragma once
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/ProducerConsumerQueue.h>
+
+namespace folly {
+namespace symbolizer {
+
+class SamplingProfiler {
+ public:
+  static constexpr size_t kMaxFrames = 64;
+
+  struct Options {
+    // CPU time between two samples
+    std::chrono::microseconds interval{10000};
+    // Threads that can be sampled; samples of more threads are dropped
+    size_t maxThreads{256};
+    // Samples buffered per thread between two drains
+    uint32_t bufferSize{32};
+    std::chrono::milliseconds drainInterval{10};
+  };
+
+  SamplingProfiler() : SamplingProfiler(Options()) {}
+  explicit SamplingProfiler(Options options);
+
+  // Stops
+  ~SamplingProfiler();
+
+  SamplingProfiler(const SamplingProfiler&) = delete;
+  SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+  /**
+   * Start sampling. Throws std::logic_error if another SamplingProfiler is
+   * running, or std::system_error if the timer can't be set. Samples of
+   * previous runs are kept.
+   */
+  void start();
+
+  /**
+   * Stop sampling; all samples taken so far are counted when it returns.
+   */
+  void stop();
+
+  /**
+   * Symbolize the stacks sampled so far, in the collapsed format. Slow.
+   */
+  std::string getCollapsedStacks() const;
+
+  // Samples counted so far
+  uint64_t getSampleCount() const;
+  // Samples dropped because their thread's buffer was full, or because
+  // too many threads were sampled
+  uint64_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Sample {
+    uint32_t frameCount;
+    uintptr_t frames[kMaxFrames];
+  };
+
+  // Buffer of the thread whose id is tid; only its signal handler writes
+  // to it.
+  struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t size) : queue(size + 1) {}
+
+    std::atomic<pid_t> tid{0};
+    ProducerConsumerQueue<Sample> queue;
+  };
+
+  struct StackHash {
+    size_t operator()(const std::vector<uintptr_t>& stack) const;
+  };
+
+  static void installSignalHandler();
+  static void signalHandler(int signo, siginfo_t* info, void* context);
+  void takeSample(void* context);
+  ThreadBuffer* getThreadBuffer();
+
+  void drainLoop();
+  void drain();
+
+  const Options options_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::atomic<uint64_t> dropped_{0};
+
+  bool running_{false};
+  std::mutex drainMutex_;
+  std::condition_variable drainCond_;
+  bool stopping_{false};
+  std::thread drainThread_;
+
+  // Protects stacks_, sampled stacks from the innermost frame, and their
+  // number of samples
+  mutable std::mutex stacksMutex_;
+  std::unordered_map<std::vector<uintptr_t>, uint64_t, StackHash> stacks_;
+  uint64_t sampleCount_{0};
+};
+
+} // namespace symbolizer
+} // namespace folly
@@ -33,6 +33,7 @@
 namespace folly {
 namespace symbolizer {
 
+class CachedSymbolizer;
 class Symbolizer;
 
 /**
@@ -62,6 +63,8 @@ struct SymbolizedFrame {
   }
 
  private:
+  friend class CachedSymbolizer;
+
   std::shared_ptr<ElfFile> file_;
 };
 
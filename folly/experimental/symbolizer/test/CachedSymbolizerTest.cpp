@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/symbolizer/CachedSymbolizer.h>
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+namespace folly {
+namespace symbolizer {
+namespace test {
+
+void foo() {}
+
+FrameArray<100> goldenFrames;
+
+int comparator(const void* ap, const void* bp) {
+  getStackTrace(goldenFrames);
+
+  int a = *static_cast<const int*>(ap);
+  int b = *static_cast<const int*>(bp);
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+FOLLY_NOINLINE void bar();
+
+void bar() {
+  int a[2] = {1, 2};
+  // Use qsort, which is in a different library
+  qsort(a, 2, sizeof(int), comparator);
+}
+
+void expectSameFrame(const SymbolizedFrame& a, const SymbolizedFrame& b) {
+  EXPECT_EQ(a.found, b.found);
+  EXPECT_STREQ(a.name, b.name);
+  EXPECT_EQ(a.location.hasFileAndLine, b.location.hasFileAndLine);
+  EXPECT_EQ(a.location.file.toString(), b.location.file.toString());
+  EXPECT_EQ(a.location.line, b.location.line);
+}
+
+TEST(CachedSymbolizer, Single) {
+  CachedSymbolizer symbolizer;
+  for (int i = 0; i < 2; ++i) {
+    SymbolizedFrame a;
+    ASSERT_TRUE(symbolizer.symbolize(reinterpret_cast<uintptr_t>(foo), a));
+    EXPECT_EQ("folly::symbolizer::test::foo()", a.demangledName());
+  }
+}
+
+TEST(CachedSymbolizer, NotFound) {
+  CachedSymbolizer symbolizer;
+  SymbolizedFrame a;
+  EXPECT_FALSE(symbolizer.symbolize(uintptr_t(8), a));
+}
+
+TEST(CachedSymbolizer, SameAsSymbolizer) {
+  bar();
+  ASSERT_GT(goldenFrames.frameCount, 2);
+
+  Symbolizer symbolizer;
+  symbolizer.symbolize(goldenFrames);
+
+  // A tiny cache, for the entries to get replaced
+  CachedSymbolizer cached(Symbolizer::kDefaultLocationInfoMode, 2);
+  for (int i = 0; i < 3; ++i) {
+    FrameArray<100> frames;
+    frames.frameCount = goldenFrames.frameCount;
+    std::copy(
+        goldenFrames.addresses,
+        goldenFrames.addresses + goldenFrames.frameCount,
+        frames.addresses);
+    cached.symbolize(frames);
+    for (size_t j = 0; j < frames.frameCount; ++j) {
+      expectSameFrame(goldenFrames.frames[j], frames.frames[j]);
+    }
+  }
+}
+
+TEST(CachedSymbolizer, Batch) {
+  std::vector<uintptr_t> addresses;
+  for (int i = 0; i < 100; ++i) {
+    addresses.push_back(reinterpret_cast<uintptr_t>(foo));
+    addresses.push_back(reinterpret_cast<uintptr_t>(bar));
+  }
+  addresses.push_back(uintptr_t(8));
+
+  CachedSymbolizer symbolizer;
+  std::vector<SymbolizedFrame> frames(addresses.size());
+  symbolizer.symbolize(addresses.data(), frames.data(), frames.size());
+  for (size_t i = 0; i + 1 < frames.size(); i += 2) {
+    EXPECT_EQ("folly::symbolizer::test::foo()", frames[i].demangledName());
+    EXPECT_EQ("folly::symbolizer::test::bar()", frames[i + 1].demangledName());
+  }
+  EXPECT_FALSE(frames.back().found);
+}
+
+TEST(CachedSymbolizer, Concurrent) {
+  bar();
+  Symbolizer symbolizer;
+  symbolizer.symbolize(goldenFrames);
+
+  CachedSymbolizer cached(Symbolizer::kDefaultLocationInfoMode, 4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 100; ++i) {
+        SymbolizedFrame frames[100];
+        cached.symbolize(
+            goldenFrames.addresses, frames, goldenFrames.frameCount);
+        for (size_t j = 0; j < goldenFrames.frameCount; ++j) {
+          ASSERT_STREQ(goldenFrames.frames[j].name, frames[j].name);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+} // namespace test
+} // namespace symbolizer
+} // namespace folly
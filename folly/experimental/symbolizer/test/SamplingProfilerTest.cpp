@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/symbolizer/SamplingProfiler.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/String.h>
+#include <folly/portability/GTest.h>
+
+namespace folly {
+namespace symbolizer {
+namespace test {
+
+using namespace std::chrono;
+
+FOLLY_NOINLINE void burnCpu(milliseconds duration) {
+  auto end = steady_clock::now() + duration;
+  uint64_t n = 0;
+  while (steady_clock::now() < end) {
+    doNotOptimizeAway(++n);
+  }
+}
+
+SamplingProfiler::Options fastOptions() {
+  SamplingProfiler::Options options;
+  options.interval = milliseconds(1);
+  return options;
+}
+
+TEST(SamplingProfiler, Basic) {
+  SamplingProfiler profiler(fastOptions());
+  profiler.start();
+  burnCpu(milliseconds(300));
+  profiler.stop();
+
+  EXPECT_GT(profiler.getSampleCount(), 0);
+  auto stacks = profiler.getCollapsedStacks();
+  EXPECT_NE(std::string::npos, stacks.find("burnCpu")) << stacks;
+
+  uint64_t total = 0;
+  std::vector<StringPiece> lines;
+  split('\n', StringPiece(stacks), lines, true);
+  for (auto line : lines) {
+    auto pos = line.rfind(' ');
+    ASSERT_NE(StringPiece::npos, pos) << line;
+    total += to<uint64_t>(line.subpiece(pos + 1));
+  }
+  EXPECT_EQ(profiler.getSampleCount(), total);
+}
+
+TEST(SamplingProfiler, Threads) {
+  SamplingProfiler profiler(fastOptions());
+  profiler.start();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] { burnCpu(milliseconds(200)); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  profiler.stop();
+
+  EXPECT_GT(profiler.getSampleCount(), 0);
+  EXPECT_NE(
+      std::string::npos, profiler.getCollapsedStacks().find("burnCpu"));
+}
+
+TEST(SamplingProfiler, StartStop) {
+  SamplingProfiler profiler(fastOptions());
+  profiler.start();
+  {
+    SamplingProfiler other;
+    EXPECT_THROW(other.start(), std::logic_error);
+  }
+  burnCpu(milliseconds(100));
+  profiler.stop();
+
+  // Nothing is sampled while stopped
+  auto count = profiler.getSampleCount() + profiler.getDroppedCount();
+  burnCpu(milliseconds(100));
+  EXPECT_EQ(count, profiler.getSampleCount() + profiler.getDroppedCount());
+
+  // Samples add up
+  profiler.start();
+  burnCpu(milliseconds(100));
+  profiler.stop();
+  EXPECT_GT(profiler.getSampleCount() + profiler.getDroppedCount(), count);
+
+  // Another profiler can start once it's stopped
+  SamplingProfiler other(fastOptions());
+  other.start();
+  other.stop();
+}
+
+} // namespace test
+} // namespace symbolizer
+} // namespace folly
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/Bitmap.h>
+
+#include <random>
+#include <vector>
+
+#include <folly/Bits.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace folly::bitmap;
+
+namespace {
+
+bool testBit(const std::vector<uint64_t>& words, size_t i) {
+  return (words[i / 64] >> (i % 64)) & 1;
+}
+
+// Sparse, dense and in between, so that whole words are sometimes 0
+std::vector<uint64_t> randomWords(size_t n, std::mt19937_64& rng) {
+  std::vector<uint64_t> words(n);
+  for (auto& word : words) {
+    switch (rng() % 4) {
+      case 0:
+        word = 0;
+        break;
+      case 1:
+        word = rng() & rng() & rng();
+        break;
+      case 2:
+        word = rng();
+        break;
+      default:
+        word = rng() | rng();
+        break;
+    }
+  }
+  return words;
+}
+
+class BitmapTest : public ::testing::TestWithParam<bitmap::detail::Kernel> {
+ protected:
+  void SetUp() override {
+    saved_ = bitmap::detail::kernel();
+    if (!bitmap::detail::setKernel(GetParam())) {
+      skip_ = true;
+    }
+  }
+
+  void TearDown() override {
+    bitmap::detail::setKernel(saved_);
+  }
+
+  bool skip_{false};
+  bitmap::detail::Kernel saved_;
+  std::mt19937_64 rng_{1234};
+};
+
+} // namespace
+
+TEST_P(BitmapTest, Binary) {
+  if (skip_) {
+    return;
+  }
+  EXPECT_EQ(GetParam(), bitmap::detail::kernel());
+  for (size_t n : {0, 1, 3, 4, 7, 8, 9, 31, 64, 100, 1000}) {
+    auto a = randomWords(n, rng_);
+    auto b = randomWords(n, rng_);
+    std::vector<uint64_t> dst(n + 1, 0x5555);
+    andWords(dst.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(a[i] & b[i], dst[i]);
+    }
+    // Nothing written past the end
+    EXPECT_EQ(0x5555, dst[n]);
+    orWords(dst.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(a[i] | b[i], dst[i]);
+    }
+    xorWords(dst.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(a[i] ^ b[i], dst[i]);
+    }
+    auto expected = a;
+    for (size_t i = 0; i < n; ++i) {
+      expected[i] &= ~b[i];
+    }
+    // In place
+    andNotWords(a.data(), a.data(), b.data(), n);
+    EXPECT_EQ(expected, a);
+  }
+}
+
+TEST_P(BitmapTest, Popcount) {
+  if (skip_) {
+    return;
+  }
+  for (size_t n : {0, 1, 3, 4, 5, 8, 15, 16, 17, 1000}) {
+    auto a = randomWords(n, rng_);
+    auto b = randomWords(n, rng_);
+    size_t count = 0;
+    size_t countAnd = 0;
+    for (size_t i = 0; i < n; ++i) {
+      count += folly::popcount(a[i]);
+      countAnd += folly::popcount(a[i] & b[i]);
+    }
+    EXPECT_EQ(count, popcount(a.data(), n));
+    EXPECT_EQ(countAnd, popcountAnd(a.data(), b.data(), n));
+  }
+
+  std::vector<uint64_t> ones(100, ~uint64_t(0));
+  EXPECT_EQ(6400, popcount(ones.data(), ones.size()));
+}
+
+TEST_P(BitmapTest, PopcountRange) {
+  if (skip_) {
+    return;
+  }
+  auto words = randomWords(40, rng_);
+  size_t size = words.size() * 64;
+  std::vector<size_t> prefix(size + 1, 0);
+  for (size_t i = 0; i < size; ++i) {
+    prefix[i + 1] = prefix[i] + testBit(words, i);
+  }
+  for (size_t begin = 0; begin <= size; begin += 7) {
+    for (size_t end = begin; end <= size; end += 13) {
+      ASSERT_EQ(
+          prefix[end] - prefix[begin],
+          popcountRange(words.data(), begin, end))
+          << begin << " " << end;
+    }
+    EXPECT_EQ(
+        prefix[size] - prefix[begin],
+        popcountRange(words.data(), begin, size));
+  }
+  EXPECT_EQ(0, popcountRange(words.data(), 10, 5));
+}
+
+TEST_P(BitmapTest, FindFirstSet) {
+  if (skip_) {
+    return;
+  }
+  std::vector<uint64_t> words(50, 0);
+  size_t size = 50 * 64 - 10;
+  EXPECT_EQ(size, findFirstSet(words.data(), size));
+  // Past the end
+  words.back() = uint64_t(1) << 60;
+  EXPECT_EQ(size, findFirstSet(words.data(), size));
+
+  for (size_t bit : {size_t(3000), size_t(1000), size_t(64), size_t(0)}) {
+    words[bit / 64] |= uint64_t(1) << (bit % 64);
+    EXPECT_EQ(bit, findFirstSet(words.data(), size));
+  }
+  EXPECT_EQ(64, findFirstSet(words.data(), size, 1));
+  EXPECT_EQ(64, findFirstSet(words.data(), size, 64));
+  EXPECT_EQ(1000, findFirstSet(words.data(), size, 65));
+  EXPECT_EQ(3000, findFirstSet(words.data(), size, 1001));
+  EXPECT_EQ(size, findFirstSet(words.data(), size, 3001));
+  EXPECT_EQ(size, findFirstSet(words.data(), size, size));
+
+  auto random = randomWords(100, rng_);
+  size = 100 * 64;
+  size_t expected = size;
+  for (size_t from = size; from-- > 0;) {
+    if (testBit(random, from)) {
+      expected = from;
+    }
+    ASSERT_EQ(expected, findFirstSet(random.data(), size, from));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    Kernels,
+    BitmapTest,
+    ::testing::Values(
+        bitmap::detail::Kernel::SCALAR,
+        bitmap::detail::Kernel::AVX2,
+        bitmap::detail::Kernel::AVX512));
+
+template <class Instructions>
+void testRankSelect(size_t size, double density) {
+  std::mt19937_64 rng(size);
+  std::bernoulli_distribution bit(density);
+  std::vector<uint64_t> words((size + 63) / 64 + 1, 0);
+  std::vector<size_t> positions;
+  for (size_t i = 0; i < size; ++i) {
+    if (bit(rng)) {
+      words[i / 64] |= uint64_t(1) << (i % 64);
+      positions.push_back(i);
+    }
+  }
+  // Set bits past the end are ignored
+  words.back() = ~uint64_t(0);
+  if (size % 64 != 0) {
+    words[size / 64] |= ~uint64_t(0) << (size % 64);
+  }
+
+  RankSelectIndex<Instructions> index(words.data(), size);
+  EXPECT_EQ(size, index.size());
+  ASSERT_EQ(positions.size(), index.count());
+  size_t rank = 0;
+  for (size_t i = 0; i <= size; ++i) {
+    ASSERT_EQ(rank, index.rank(i)) << i;
+    if (rank < positions.size() && positions[rank] == i) {
+      ++rank;
+    }
+  }
+  for (size_t k = 0; k < positions.size(); ++k) {
+    ASSERT_EQ(positions[k], index.select(k)) << k;
+  }
+  EXPECT_LT(index.memoryUsage(), size / 4 + 1000);
+}
+
+TEST(RankSelectIndex, Empty) {
+  RankSelectIndex<> index(nullptr, 0);
+  EXPECT_EQ(0, index.count());
+  EXPECT_EQ(0, index.rank(0));
+}
+
+TEST(RankSelectIndex, Simple) {
+  for (size_t size : {1, 63, 64, 65, 511, 512, 513, 100000}) {
+    for (double density : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+      testRankSelect<compression::instructions::Default>(size, density);
+    }
+  }
+}
+
+TEST(RankSelectIndex, Large) {
+  // Runs of empty blocks between dense ones
+  testRankSelect<compression::instructions::Default>(3000000, 0.001);
+  testRankSelect<compression::instructions::Default>(3000000, 0.3);
+  if (compression::instructions::Haswell::supported()) {
+    testRankSelect<compression::instructions::Haswell>(3000000, 0.3);
+  }
+}
@@ -106,6 +106,35 @@ void testNext(const std::vector<uint32_t>& data, const List& list) {
   EXPECT_EQ(reader.position(), reader.size());
 }
 
+template <class Reader, class List>
+void testNextBatch(const std::vector<uint32_t>& data, const List& list) {
+  for (size_t batch : {1, 3, 64, 1000}) {
+    Reader reader(list);
+    std::vector<typename Reader::ValueType> values(batch);
+    size_t i = 0;
+    // Mix batches with single steps
+    while (i < data.size()) {
+      if (i % 7 == 3) {
+        ASSERT_TRUE(reader.next());
+        EXPECT_EQ(reader.value(), data[i++]);
+        continue;
+      }
+      auto n = reader.nextBatch(values.data(), batch);
+      ASSERT_EQ(std::min(batch, data.size() - i), n);
+      for (size_t j = 0; j < n; ++j) {
+        ASSERT_EQ(data[i + j], values[j]);
+      }
+      i += n;
+      EXPECT_EQ(reader.position(), i - 1);
+      EXPECT_EQ(reader.value(), data[i - 1]);
+      maybeTestPreviousValue(data, reader, i - 1);
+    }
+    EXPECT_EQ(0, reader.nextBatch(values.data(), batch));
+    EXPECT_FALSE(reader.valid());
+    EXPECT_EQ(reader.position(), reader.size());
+  }
+}
+
 template <class Reader, class List>
 void testSkip(const std::vector<uint32_t>& data, const List& list,
               size_t skipStep) {
@@ -279,6 +308,7 @@ template <class Reader, class Encoder>
 void testAll(const std::vector<uint32_t>& data) {
   auto list = Encoder::encode(data.begin(), data.end());
   testNext<Reader>(data, list);
+  testNextBatch<Reader>(data, list);
   testSkip<Reader>(data, list);
   testSkipTo<Reader>(data, list);
   testJump<Reader>(data, list);
@@ -302,6 +332,28 @@ void bmNext(const List& list, const std::vector<uint32_t>& data, size_t iters) {
   }
 }
 
+template <class Reader, class List>
+void bmNextBatch(
+    const List& list,
+    const std::vector<uint32_t>& data,
+    size_t iters) {
+  if (data.empty()) {
+    return;
+  }
+
+  Reader reader(list);
+  typename Reader::ValueType values[128];
+  for (size_t i = 0; i < iters;) {
+    auto n = reader.nextBatch(values, 128);
+    if (LIKELY(n != 0)) {
+      folly::doNotOptimizeAway(values[n - 1]);
+      i += n;
+    } else {
+      reader.reset();
+    }
+  }
+}
+
 template <class Reader, class List>
 void bmSkip(const List& list,
             const std::vector<uint32_t>& /* data */,
@@ -15,12 +15,15 @@
  */
 
 #include <algorithm>
+#include <iterator>
 #include <limits>
 #include <numeric>
 #include <random>
 #include <vector>
 
 #include <folly/Benchmark.h>
+#include <folly/experimental/BitVectorCoding.h>
+#include <folly/experimental/CodingIntersection.h>
 #include <folly/experimental/EliasFanoCoding.h>
 #include <folly/experimental/Select64.h>
 #include <folly/experimental/test/CodingTestUtils.h>
@@ -167,6 +170,45 @@ TEST_F(EliasFanoCodingTest, BugLargeGapInUpperBits) { // t16274876
   list.free();
 }
 
+TEST_F(EliasFanoCodingTest, Intersect) {
+  using Encoder = EliasFanoEncoderV2<uint32_t, uint32_t, 128, 128>;
+  using Reader = EliasFanoReader<Encoder, instructions::EF_TEST_ARCH>;
+  using BVEncoder = BitVectorEncoder<uint32_t, uint32_t, 128, 128>;
+  using BVReader = BitVectorReader<BVEncoder, instructions::EF_TEST_ARCH>;
+
+  std::mt19937 gen;
+  // Similar sizes are merged, skewed ones skipped through
+  for (size_t sizeB : {0, 1, 1000, 20 * 1000, 100 * 1000}) {
+    auto a = generateRandomList(20 * 1000, 200 * 1000, gen);
+    auto b = sizeB == 0 ? std::vector<uint32_t>()
+                        : generateRandomList(sizeB, 200 * 1000, gen);
+    std::vector<uint32_t> expected;
+    std::set_intersection(
+        a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+    auto listA = Encoder::encode(a.begin(), a.end());
+    auto listB = Encoder::encode(b.begin(), b.end());
+    auto bvListB = BVEncoder::encode(b.begin(), b.end());
+    {
+      Reader readerA(listA);
+      Reader readerB(listB);
+      std::vector<uint32_t> result;
+      intersect(readerA, readerB, std::back_inserter(result));
+      EXPECT_EQ(expected, result);
+    }
+    {
+      Reader readerA(listA);
+      BVReader readerB(bvListB);
+      std::vector<uint32_t> result;
+      intersect(readerB, readerA, std::back_inserter(result));
+      EXPECT_EQ(expected, result);
+    }
+    listA.free();
+    listB.free();
+    bvListB.free();
+  }
+}
+
 namespace bm {
 
 typedef EliasFanoEncoderV2<uint32_t, uint32_t, 128, 128> Encoder;
@@ -175,12 +217,19 @@ typedef EliasFanoReader<Encoder> Reader;
 std::vector<uint32_t> data;
 std::vector<size_t> order;
 
+// As long as data, and a hundred times shorter, to intersect with it
+std::vector<uint32_t> similarData;
+std::vector<uint32_t> shortData;
+typename Encoder::MutableCompressedList similarList;
+typename Encoder::MutableCompressedList shortList;
+
 std::vector<uint32_t> encodeSmallData;
 std::vector<uint32_t> encodeLargeData;
 
 std::vector<std::pair<size_t, size_t>> numLowerBitsInput;
 
 typename Encoder::MutableCompressedList list;
+using List = typename Encoder::MutableCompressedList;
 
 void init() {
   std::mt19937 gen;
@@ -192,6 +241,11 @@ void init() {
   std::iota(order.begin(), order.end(), size_t());
   std::shuffle(order.begin(), order.end(), gen);
 
+  similarData = generateRandomList(100 * 1000, 10 * 1000 * 1000, gen);
+  similarList = Encoder::encode(similarData.begin(), similarData.end());
+  shortData = generateRandomList(1000, 10 * 1000 * 1000, gen);
+  shortList = Encoder::encode(shortData.begin(), shortData.end());
+
   encodeSmallData = generateRandomList(10, 100 * 1000, gen);
   encodeLargeData = generateRandomList(1000 * 1000, 100 * 1000 * 1000, gen);
 
@@ -205,6 +259,54 @@ void init() {
 
 void free() {
   list.free();
+  similarList.free();
+  shortList.free();
+}
+
+// Intersects list with other, as the loop a caller would write with
+// next() and skipTo().
+size_t intersectLoop(const List& other) {
+  Reader a(list);
+  Reader b(other);
+  size_t count = 0;
+  if (!a.next() || !b.next()) {
+    return 0;
+  }
+  while (true) {
+    if (a.value() == b.value()) {
+      ++count;
+      if (!a.next() || !b.next()) {
+        break;
+      }
+    } else if (a.value() < b.value()) {
+      if (!a.skipTo(b.value())) {
+        break;
+      }
+    } else if (!b.skipTo(a.value())) {
+      break;
+    }
+  }
+  return count;
+}
+
+struct Counter {
+  Counter& operator*() {
+    return *this;
+  }
+  Counter& operator++(int) {
+    return *this;
+  }
+  Counter& operator=(uint32_t) {
+    ++count;
+    return *this;
+  }
+  size_t count = 0;
+};
+
+size_t intersectBatched(const List& other) {
+  Reader a(list);
+  Reader b(other);
+  return intersect(a, b, Counter()).count;
 }
 
 } // namespace bm
@@ -213,6 +315,10 @@ BENCHMARK(Next, iters) {
   bmNext<bm::Reader>(bm::list, bm::data, iters);
 }
 
+BENCHMARK(NextBatch, iters) {
+  bmNextBatch<bm::Reader>(bm::list, bm::data, iters);
+}
+
 size_t Skip_ForwardQ128(size_t iters, size_t logAvgSkip) {
   bmSkip<bm::Reader>(bm::list, bm::data, logAvgSkip, iters);
   return iters;
@@ -251,6 +357,32 @@ BENCHMARK(JumpTo_SkipQ128, iters) {
 
 BENCHMARK_DRAW_LINE();
 
+BENCHMARK(Intersect_Loop_Similar, iters) {
+  while (iters--) {
+    folly::doNotOptimizeAway(bm::intersectLoop(bm::similarList));
+  }
+}
+
+BENCHMARK_RELATIVE(Intersect_Similar, iters) {
+  while (iters--) {
+    folly::doNotOptimizeAway(bm::intersectBatched(bm::similarList));
+  }
+}
+
+BENCHMARK(Intersect_Loop_Short, iters) {
+  while (iters--) {
+    folly::doNotOptimizeAway(bm::intersectLoop(bm::shortList));
+  }
+}
+
+BENCHMARK_RELATIVE(Intersect_Short, iters) {
+  while (iters--) {
+    folly::doNotOptimizeAway(bm::intersectBatched(bm::shortList));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
 BENCHMARK(Encode_10) {
   auto list = bm::Encoder::encode(bm::encodeSmallData.begin(),
                                   bm::encodeSmallData.end());
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/experimental/EventBaseProfiler.h>
+
+#include <thread>
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+using Phase = EventBaseLoopProfiler::Phase;
+
+namespace {
+
+class SleepingLoopCallback : public EventBase::LoopCallback {
+ public:
+  void runLoopCallback() noexcept override {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(20));
+  }
+};
+
+EventBaseProfiler::Options slowOptions() {
+  EventBaseProfiler::Options options;
+  options.slowCallbackThreshold = milliseconds(5);
+  return options;
+}
+
+} // namespace
+
+TEST(EventBaseProfilerTest, SlowLoopCallback) {
+  EventBase evb;
+  std::vector<EventBaseProfiler::SlowCallback> slow;
+  EventBaseProfiler profiler(
+      &evb, slowOptions(), [&](const EventBaseProfiler::SlowCallback& s) {
+        slow.push_back(s);
+      });
+
+  SleepingLoopCallback callback;
+  evb.runInLoop(&callback);
+  evb.runInEventBaseThread([] {});
+  evb.loop();
+
+  ASSERT_EQ(1, slow.size());
+  EXPECT_EQ(Phase::LOOP_CALLBACK, slow[0].phase);
+  EXPECT_NE(std::string::npos, slow[0].name.find("SleepingLoopCallback"));
+  EXPECT_GE(slow[0].duration, milliseconds(20));
+
+  auto series = profiler.getSlowCallbackTimeSeries();
+  series.update(EventBaseProfiler::Clock::now());
+  EXPECT_EQ(1, series.count());
+}
+
+TEST(EventBaseProfilerTest, SlowTimeout) {
+  EventBase evb;
+  std::vector<EventBaseProfiler::SlowCallback> slow;
+  EventBaseProfiler profiler(
+      &evb, slowOptions(), [&](const EventBaseProfiler::SlowCallback& s) {
+        slow.push_back(s);
+      });
+
+  auto timeout = AsyncTimeout::make(evb, [&]() noexcept {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(20));
+  });
+  timeout->scheduleTimeout(1);
+  evb.loop();
+
+  ASSERT_EQ(1, slow.size());
+  EXPECT_EQ(Phase::TIMER, slow[0].phase);
+  EXPECT_FALSE(slow[0].name.empty());
+}
+
+TEST(EventBaseProfilerTest, PhaseTimes) {
+  EventBase evb;
+  EventBaseProfiler profiler(&evb, EventBaseProfiler::Options());
+
+  // Nothing is slow without a threshold
+  SleepingLoopCallback callback;
+  evb.runInLoop(&callback);
+  evb.loop();
+  // Flushes the time series
+  /* sleep override */ std::this_thread::sleep_for(milliseconds(2));
+  evb.loopOnce(EVLOOP_NONBLOCK);
+
+  auto now = EventBaseProfiler::Clock::now();
+  auto iterations = profiler.getIterationTimeSeries();
+  iterations.update(now);
+  EXPECT_GE(iterations.count(), 2);
+  EXPECT_GE(iterations.sum(), 20000);
+
+  auto loop = profiler.getTimeSeries(Phase::LOOP_CALLBACK);
+  loop.update(now);
+  EXPECT_EQ(iterations.count(), loop.count());
+  EXPECT_GE(loop.sum(), 20000);
+  EXPECT_LE(loop.sum(), iterations.sum());
+
+  auto slow = profiler.getSlowCallbackTimeSeries();
+  slow.update(now);
+  EXPECT_EQ(0, slow.count());
+}
+
+TEST(EventBaseProfilerTest, Detach) {
+  EventBase evb;
+  {
+    EventBaseProfiler profiler(&evb, EventBaseProfiler::Options());
+    EXPECT_EQ(&profiler, evb.getLoopProfiler());
+  }
+  EXPECT_EQ(nullptr, evb.getLoopProfiler());
+  evb.runInEventBaseThread([] {});
+  evb.loop();
+}
@@ -17,12 +17,15 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <mutex>
 #include <random>
+#include <vector>
 
 #include <boost/thread.hpp>
 
 #include <folly/Baton.h>
 #include <folly/Random.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/experimental/FunctionScheduler.h>
 #include <folly/portability/GTest.h>
 
@@ -691,3 +694,129 @@ TEST(FunctionScheduler, ConcurrentCancelFunctionAndWait) {
   th1.join();
   th2.join();
 }
+
+TEST(FunctionScheduler, Executor) {
+  CPUThreadPoolExecutor executor(2);
+  std::atomic<int> fast(0);
+  std::atomic<int> slow(0);
+  FunctionScheduler fs;
+  fs.setExecutor(&executor);
+  // The slow function doesn't delay the fast one, and its runs which come
+  // due while it's still running are skipped rather than piling up
+  fs.addFunction(
+      [&] {
+        ++slow;
+        delay(5);
+      },
+      testInterval(1),
+      "slow");
+  fs.addFunction([&] { ++fast; }, testInterval(1), "fast");
+  fs.start();
+  delay(7);
+  EXPECT_LE(6, fast.load());
+  EXPECT_EQ(2, slow.load());
+  EXPECT_TRUE(fs.cancelFunctionAndWait("slow"));
+  fs.shutdown();
+  EXPECT_EQ(2, slow.load());
+}
+
+TEST(FunctionScheduler, ExecutorWaits) {
+  CPUThreadPoolExecutor executor(2);
+  std::atomic<int> total(0);
+  FunctionScheduler fs;
+  fs.setExecutor(&executor);
+  auto slowAdd = [&] {
+    delay(3);
+    ++total;
+  };
+  fs.addFunction(slowAdd, testInterval(100), "add1");
+  fs.addFunctionOnce(slowAdd, "add2");
+  fs.start();
+  delay(1);
+  EXPECT_TRUE(fs.cancelFunctionAndWait("add1"));
+  EXPECT_LE(1, total.load());
+  // Waits for add2, which ran once and is no longer scheduled
+  fs.shutdown();
+  EXPECT_EQ(2, total.load());
+}
+
+TEST(FunctionScheduler, TimerWheel) {
+  int total = 0;
+  FunctionScheduler fs;
+  fs.setTimerWheelTick(milliseconds(10));
+  // add2 runs at 0, 2, 4..., add3 at 1.5, 4.5...
+  fs.addFunction([&] { total += 2; }, testInterval(2), "add2");
+  fs.addFunction(
+      [&] { total += 3; }, testInterval(3), "add3", testInterval(3) / 2);
+  fs.start();
+  delay(1);
+  EXPECT_EQ(2, total);
+  delay(2);
+  EXPECT_EQ(7, total);
+  delay(2);
+  EXPECT_EQ(12, total);
+  EXPECT_TRUE(fs.cancelFunction("add2"));
+  EXPECT_TRUE(fs.resetFunctionTimer("add3"));
+  delay(2);
+  EXPECT_EQ(15, total);
+  fs.shutdown();
+
+  // Functions are kept when stopped, and start over when restarted
+  delay(3);
+  EXPECT_EQ(15, total);
+  fs.start();
+  delay(1);
+  EXPECT_EQ(15, total);
+  delay(1);
+  EXPECT_EQ(18, total);
+  fs.cancelAllFunctions();
+  delay(3);
+  EXPECT_EQ(18, total);
+  fs.shutdown();
+}
+
+TEST(FunctionScheduler, TimerWheelManyFunctions) {
+  constexpr int kFunctions = 20000;
+  std::atomic<int> total(0);
+  FunctionScheduler fs;
+  fs.setTimerWheelTick(milliseconds(10));
+  for (int i = 0; i < kFunctions; ++i) {
+    fs.addFunction(
+        [&] { ++total; },
+        testInterval(2),
+        to<std::string>("f", i),
+        milliseconds(i % 50));
+  }
+  fs.start();
+  delay(3);
+  EXPECT_EQ(2 * kFunctions, total.load());
+  fs.shutdown();
+}
+
+TEST(FunctionScheduler, TimerWheelCoalesces) {
+  std::vector<std::chrono::steady_clock::time_point> runs[2];
+  std::mutex mutex;
+  FunctionScheduler fs;
+  fs.setTimerWheelTick(testInterval(1) / 2);
+  fs.start();
+  for (int i = 0; i < 2; ++i) {
+    fs.addFunction(
+        [&, i] {
+          std::lock_guard<std::mutex> g(mutex);
+          runs[i].push_back(std::chrono::steady_clock::now());
+        },
+        testInterval(1),
+        to<std::string>("f", i));
+    std::this_thread::sleep_for(testInterval(1) / 10);
+  }
+  delay(4);
+  fs.shutdown();
+
+  // Added a bit apart, but they run in the same tick
+  std::lock_guard<std::mutex> g(mutex);
+  ASSERT_LE(4, runs[0].size());
+  ASSERT_LE(4, runs[1].size());
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_LT(runs[1][i] - runs[0][i], testInterval(1) / 10);
+  }
+}
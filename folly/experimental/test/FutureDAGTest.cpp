@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <boost/thread/barrier.hpp>
+#include <folly/executors/ManualExecutor.h>
 #include <folly/experimental/FutureDAG.h>
 #include <folly/portability/GTest.h>
 
@@ -273,3 +274,116 @@ TEST_F(FutureDAGTest, DestroyBeforeComplete) {
   barrier->wait();
   ASSERT_NO_THROW(f.get());
 }
+
+TEST_F(FutureDAGTest, ThrowSkipsDependents) {
+  std::vector<int> ran;
+  auto h1 = dag->add(throwFunc);
+  auto h2 = dag->add([&] {
+    ran.push_back(2);
+    return makeFuture();
+  });
+  auto h3 = dag->add([&] {
+    ran.push_back(3);
+    return makeFuture();
+  });
+  auto h4 = dag->add([&] {
+    ran.push_back(4);
+    return makeFuture();
+  });
+  dag->dependency(h1, h2);
+  dag->dependency(h2, h3);
+  (void)h4;
+  EXPECT_THROW(dag->go().get(), std::runtime_error);
+  EXPECT_EQ(std::vector<int>{4}, ran);
+}
+
+TEST_F(FutureDAGTest, CriticalPathFirst) {
+  ManualExecutor executor;
+  std::vector<Handle> ran;
+  auto addNode = [&] {
+    auto handle = std::make_shared<Handle>();
+    *handle = dag->add(
+        [&ran, handle] {
+          ran.push_back(*handle);
+          return makeFuture();
+        },
+        &executor);
+    return *handle;
+  };
+  auto shortNode = addNode();
+  auto h1 = addNode();
+  auto h2 = addNode();
+  auto h3 = addNode();
+  dag->dependency(h1, h2);
+  dag->dependency(h2, h3);
+
+  auto f = dag->go();
+  executor.drain();
+  ASSERT_NO_THROW(f.get());
+  EXPECT_EQ(h1, ran.front());
+  EXPECT_EQ((std::vector<Handle>{h1, h2, h3}), dag->criticalPath());
+
+  // A costlier node comes first, and is the critical path on its own
+  dag->setCost(shortNode, std::chrono::seconds(1));
+  ran.clear();
+  f = dag->go();
+  executor.drain();
+  ASSERT_NO_THROW(f.get());
+  EXPECT_EQ(shortNode, ran.front());
+  EXPECT_EQ(std::vector<Handle>{shortNode}, dag->criticalPath());
+}
+
+namespace {
+
+struct PriorityRecordingExecutor : Executor {
+  void add(Func func) override {
+    addWithPriority(std::move(func), MID_PRI);
+  }
+  void addWithPriority(Func func, int8_t priority) override {
+    priorities.push_back(priority);
+    func();
+  }
+  uint8_t getNumPriorities() const override {
+    return 3;
+  }
+
+  std::vector<int8_t> priorities;
+};
+
+} // namespace
+
+TEST_F(FutureDAGTest, Priorities) {
+  PriorityRecordingExecutor executor;
+  auto h1 = dag->add(makeFutureFunc, &executor);
+  auto h2 = dag->add(makeFutureFunc, &executor);
+  auto h3 = dag->add(makeFutureFunc, &executor);
+  dag->dependency(h1, h2);
+  dag->dependency(h2, h3);
+  ASSERT_NO_THROW(dag->go().get());
+  EXPECT_EQ((std::vector<int8_t>{1, 0, -1}), executor.priorities);
+}
+
+TEST_F(FutureDAGTest, Rerun) {
+  size_t runs = 0;
+  auto h1 = dag->add([&] {
+    ++runs;
+    return makeFuture();
+  });
+  auto h2 = dag->add([&] {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++runs;
+    return makeFuture();
+  });
+  auto h3 = dag->add(makeFutureFunc);
+  dag->dependency(h1, h3);
+  dag->dependency(h2, h3);
+  for (size_t i = 1; i <= 3; ++i) {
+    ASSERT_NO_THROW(dag->go().get());
+    EXPECT_EQ(2 * i, runs);
+  }
+  EXPECT_LE(std::chrono::milliseconds(10), dag->timing(h2).running);
+  EXPECT_GT(std::chrono::milliseconds(10), dag->timing(h1).running);
+  // Costs are the times measured on the previous run
+  EXPECT_EQ((std::vector<Handle>{h2, h3}), dag->criticalPath());
+}
@@ -16,6 +16,7 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 
 #include <folly/experimental/JSONSchema.h>
+#include <folly/experimental/LazyJson.h>
 #include <folly/json.h>
 #include <folly/portability/GTest.h>
 
@@ -41,6 +42,24 @@ bool check(const dynamic& schema, const dynamic& value, bool check = true) {
   return true;
 }
 
+// Validates value with a compiled validator, which must agree with
+// makeValidator()
+bool checkCompiled(const dynamic& schema, const dynamic& value) {
+  bool valid = !compileValidator(schema)->try_validate(value);
+  EXPECT_EQ(valid, !makeValidator(schema)->try_validate(value))
+      << toJson(schema) << " " << toJson(value);
+  return valid;
+}
+
+// Validates json both ways with a compiled validator
+bool checkLazy(const dynamic& schema, folly::StringPiece json) {
+  auto validator = compileValidator(schema);
+  bool valid = !validator->try_validate(parseJson(json));
+  folly::json::LazyDocument doc(json);
+  EXPECT_EQ(valid, !validator->try_validate(doc.root())) << json;
+  return valid;
+}
+
 TEST(JSONSchemaTest, TestMultipleOfInt) {
   dynamic schema = dynamic::object("multipleOf", 2);
   ASSERT_TRUE(check(schema, "invalid"));
@@ -254,6 +273,8 @@ TEST(JSONSchemaTest, TestInfinitelyRecursiveRef) {
   dynamic schema = dynamic::object("not", dynamic::object("$ref", "#"));
   auto validator = makeValidator(schema);
   ASSERT_THROW(validator->validate(dynamic::array(1, 2)), std::runtime_error);
+  auto compiled = compileValidator(schema);
+  ASSERT_THROW(compiled->validate(dynamic::array(1, 2)), std::runtime_error);
 }
 
 TEST(JSONSchemaTest, TestRequired) {
@@ -448,3 +469,129 @@ TEST(JSONSchemaTest, TestProductSchema) {
   }";
   ASSERT_TRUE(check(parseJson(productSchema), parseJson(product)));
 }
+
+TEST(JSONSchemaTest, TestCompiledKeywords) {
+  struct {
+    const char* schema;
+    const char* value;
+    bool valid;
+  } cases[] = {
+      {R"({"multipleOf": 1.5})", "24.0", true},
+      {R"({"multipleOf": 1.5})", "5", false},
+      {R"({"minimum": 2, "exclusiveMinimum": true})", "2", false},
+      {R"({"minimum": 2, "exclusiveMinimum": true})", "3", true},
+      {R"({"maximum": 12.75})", "12.76", false},
+      {R"({"minLength": 3, "maxLength": 5})", R"("abcd")", true},
+      {R"({"minLength": 3, "maxLength": 5})", R"("a")", false},
+      {R"({"pattern": "[1-9]+"})", R"("abc")", false},
+      {R"({"minItems": 1, "maxItems": 3, "uniqueItems": true})",
+       "[1, 2]",
+       true},
+      {R"({"minItems": 1, "maxItems": 3, "uniqueItems": true})",
+       "[1, 1]",
+       false},
+      {R"({"minItems": 1, "maxItems": 3, "uniqueItems": true})",
+       "[]",
+       false},
+      {R"({"items": [{"minimum": 2}], "additionalItems": {"maximum": 3}})",
+       "[2, 3, 3]",
+       true},
+      {R"({"items": [{"minimum": 2}], "additionalItems": {"maximum": 3}})",
+       "[2, 4]",
+       false},
+      {R"({"required": ["foo", "bar"]})", R"({"foo": 1})", false},
+      {R"({"minProperties": 1, "maxProperties": 2})", "{}", false},
+      {R"({"properties": {"p1": {"minimum": 1}},
+           "patternProperties": {"^[0-9]+$": {"type": "string"}},
+           "additionalProperties": {"maximum": 5}})",
+       R"({"p1": 1, "123": "x", "other": 4})",
+       true},
+      {R"({"properties": {"p1": {"minimum": 1}},
+           "patternProperties": {"^[0-9]+$": {"type": "string"}},
+           "additionalProperties": {"maximum": 5}})",
+       R"({"other": 6})",
+       false},
+      {R"({"dependencies": {"p1": ["p2"]}})", R"({"p1": 1})", false},
+      {R"({"dependencies": {"p1": ["p2"]}})", R"({"p1": 1, "p2": 1})", true},
+      {R"({"enum": ["a", 1]})", "1", true},
+      {R"({"enum": ["a", 1]})", R"("b")", false},
+      {R"({"type": ["integer", "null"]})", "null", true},
+      {R"({"type": ["integer", "null"]})", "1.5", false},
+      {R"({"allOf": [{"minimum": 1}, {"maximum": 3}]})", "4", false},
+      {R"({"anyOf": [{"type": "string"}, {"minimum": 5}]})", "3", false},
+      {R"({"anyOf": [{"type": "string"}, {"minimum": 5}]})", R"("x")", true},
+      {R"({"oneOf": [{"minimum": 1}, {"maximum": 3}]})", "2", false},
+      {R"({"oneOf": [{"minimum": 1}, {"maximum": 3}]})", "5", true},
+      {R"({"not": {"type": "string"}})", R"("x")", false},
+      {R"({"definitions": {"pos": {"minimum": 0}},
+           "properties": {"a": {"$ref": "#/definitions/pos"}}})",
+       R"({"a": -1})",
+       false},
+  };
+  for (const auto& c : cases) {
+    EXPECT_EQ(c.valid, checkCompiled(parseJson(c.schema), parseJson(c.value)))
+        << c.schema << " " << c.value;
+  }
+}
+
+TEST(JSONSchemaTest, TestCompiledLazy) {
+  dynamic schema = parseJson(R"({
+    "type": "object",
+    "properties": {
+      "id": {"type": "integer", "minimum": 1},
+      "name": {"type": "string", "minLength": 1, "pattern": "^[a-z ]+$"},
+      "price": {"type": "number", "exclusiveMinimum": true, "minimum": 0},
+      "tags": {
+        "type": "array",
+        "items": {"enum": ["home", "green", "caf\u00e9"]},
+        "uniqueItems": true
+      }
+    },
+    "additionalProperties": false,
+    "required": ["id", "name"],
+    "dependencies": {"price": ["tags"]}
+  })");
+  ASSERT_TRUE(checkLazy(schema, R"({"id": 1, "name": "door"})"));
+  ASSERT_TRUE(checkLazy(
+      schema,
+      R"({"id": 2, "name": "door", "price": 1.5, "tags": ["caf\u00e9"]})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 0, "name": "door"})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 1.5, "name": "door"})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 1, "name": "Door"})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 1})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 1, "name": "door", "x": 1})"));
+  ASSERT_FALSE(checkLazy(schema, R"({"id": 1, "name": "door", "price": 1})"));
+  ASSERT_FALSE(checkLazy(
+      schema, R"({"id": 1, "name": "door", "price": 0, "tags": []})"));
+  ASSERT_FALSE(checkLazy(
+      schema,
+      R"({"id": 1, "name": "door", "price": 1, "tags": ["home", "home"]})"));
+  ASSERT_FALSE(checkLazy(
+      schema, R"({"id": 1, "name": "door", "price": 1, "tags": ["red"]})"));
+  ASSERT_FALSE(checkLazy(schema, R"([1, 2])"));
+}
+
+TEST(JSONSchemaTest, TestCompiledManyRequired) {
+  // More names than fit in the bitmask of seen properties
+  dynamic required = dynamic::array;
+  dynamic value = dynamic::object;
+  for (int i = 0; i < 100; ++i) {
+    required.push_back(folly::to<std::string>("p", i));
+    value[folly::to<std::string>("p", i)] = i;
+  }
+  dynamic schema = dynamic::object("required", required);
+  ASSERT_TRUE(checkCompiled(schema, value));
+  value.erase("p99");
+  ASSERT_FALSE(checkCompiled(schema, value));
+}
+
+TEST(JSONSchemaTest, TestCompiledError) {
+  auto validator = compileValidator(dynamic::object("minimum", 2));
+  auto ew = validator->try_validate(1);
+  ASSERT_TRUE(ew.with_exception([](const std::runtime_error& e) {
+    EXPECT_STREQ(
+        "Expected to get greater than or equal to 2 for value 1", e.what());
+  }));
+  ASSERT_THROW(validator->validate(1), std::runtime_error);
+  validator->validate(3); // doesn't throw
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/JsonWriter.h>
+
+#include <limits>
+#include <random>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace folly::json;
+
+namespace {
+
+std::string toString(IOBufQueue& queue) {
+  auto buf = queue.move();
+  return buf ? buf->moveToFbString().toStdString() : std::string();
+}
+
+std::string serializeToQueue(
+    const dynamic& dyn,
+    const serialization_opts& opts = serialization_opts()) {
+  IOBufQueue queue(IOBufQueue::cacheChainLength());
+  serialize(dyn, queue, opts);
+  return toString(queue);
+}
+
+} // namespace
+
+TEST(JsonWriter, Sax) {
+  IOBufQueue queue(IOBufQueue::cacheChainLength());
+  {
+    JsonWriter w(queue);
+    w.beginObject();
+    w.key("id").value(12);
+    w.key("tags").beginArray().value("a").value(std::string("b")).endArray();
+    w.key("empty").beginObject().endObject();
+    w.key("x").value(-1.5).key("y").value(true).key("z").value(nullptr);
+    w.key("big").value(std::numeric_limits<uint64_t>::max());
+    w.key("min").value(std::numeric_limits<int64_t>::min());
+    w.key("dyn").value(dynamic::object("k", dynamic::array(1, "\n")));
+    EXPECT_FALSE(w.done());
+    EXPECT_EQ(1, w.depth());
+    w.endObject();
+    EXPECT_TRUE(w.done());
+  }
+  EXPECT_EQ(
+      R"({"id":12,"tags":["a","b"],"empty":{},"x":-1.5,"y":true,"z":null,)"
+      R"("big":18446744073709551615,"min":-9223372036854775808,)"
+      R"("dyn":{"k":[1,"\n"]}})",
+      toString(queue));
+}
+
+TEST(JsonWriter, MatchesSerialize) {
+  dynamic dyn = dynamic::object("a", dynamic::array(1, 2.5, "x\"y", nullptr))(
+      "b", dynamic::object())("c", dynamic::array())(
+      "d", dynamic::object("e", dynamic::array(dynamic::object("f", false))))(
+      "\xc3\xa9", "caf\xc3\xa9");
+
+  serialization_opts opts;
+  EXPECT_EQ(serialize(dyn, opts), serializeToQueue(dyn, opts));
+  opts.pretty_formatting = true;
+  EXPECT_EQ(serialize(dyn, opts), serializeToQueue(dyn, opts));
+  opts.sort_keys = true;
+  EXPECT_EQ(serialize(dyn, opts), serializeToQueue(dyn, opts));
+  opts.encode_non_ascii = true;
+  EXPECT_EQ(serialize(dyn, opts), serializeToQueue(dyn, opts));
+
+  // Scalars at the top level
+  for (auto scalar : {dynamic(1), dynamic("s"), dynamic(nullptr)}) {
+    EXPECT_EQ(toJson(scalar), serializeToQueue(scalar));
+  }
+}
+
+TEST(JsonWriter, Errors) {
+  IOBufQueue queue;
+  {
+    JsonWriter w(queue);
+    EXPECT_THROW(w.key("a"), std::logic_error);
+    EXPECT_THROW(w.endArray(), std::logic_error);
+    w.beginObject();
+    EXPECT_THROW(w.value(1), std::logic_error);
+    EXPECT_THROW(w.endArray(), std::logic_error);
+    w.key("a");
+    EXPECT_THROW(w.key("b"), std::logic_error);
+    EXPECT_THROW(w.endObject(), std::logic_error);
+    w.value(1).endObject();
+    EXPECT_THROW(w.value(2), std::logic_error);
+  }
+  EXPECT_EQ(R"({"a":1})", toString(queue));
+
+  EXPECT_THROW(
+      serializeToQueue(dynamic::object(1, 2)), std::runtime_error);
+  serialization_opts opts;
+  opts.allow_non_string_keys = true;
+  EXPECT_EQ("{1:2}", serializeToQueue(dynamic::object(1, 2), opts));
+  EXPECT_THROW(serializeToQueue(dynamic(NAN)), std::runtime_error);
+  opts.javascript_safe = true;
+  EXPECT_ANY_THROW(serializeToQueue(dynamic((int64_t(1) << 62) + 1), opts));
+}
+
+TEST(JsonWriter, Flush) {
+  IOBufQueue queue(IOBufQueue::cacheChainLength());
+  JsonWriter w(queue);
+  w.beginArray();
+  std::string expected = "[";
+  for (int i = 0; i < 10000; ++i) {
+    w.value(i);
+    expected += (i ? "," : "") + to<std::string>(i);
+  }
+  w.flush();
+  // Spans several buffers, written in place
+  EXPECT_LT(1, queue.front()->countChainElements());
+  EXPECT_EQ(expected.size(), queue.chainLength());
+
+  // The queue can be used between flushes
+  queue.append(",\"between\"");
+  w.value("after").endArray();
+  w.flush();
+  EXPECT_EQ(expected + R"(,"between","after"])", toString(queue));
+}
+
+TEST(JsonWriter, FirstEscapable) {
+  const char escapable[] = {'"', '\\', '\n', '\0', '\x1f', '\x80', '\xff'};
+  std::mt19937 rng(1234);
+  for (size_t size : {0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 100}) {
+    for (int i = 0; i < 100; ++i) {
+      // Printable ASCII, with up to two characters that need escaping
+      std::string s;
+      for (size_t k = 0; k < size; ++k) {
+        char c = char(0x20 + rng() % 0x5f);
+        s.push_back(c == '"' || c == '\\' ? ' ' : c);
+      }
+      for (int j = rng() % 3; j > 0 && size > 0; --j) {
+        s[rng() % size] = escapable[rng() % sizeof(escapable)];
+      }
+      auto first = s.find_first_of(std::string(escapable, sizeof(escapable)));
+      EXPECT_EQ(
+          first == std::string::npos ? size : first,
+          json::detail::firstEscapable(s));
+      // Without non-ascii bytes
+      first = s.find_first_of(std::string(escapable, sizeof(escapable) - 2));
+      EXPECT_EQ(
+          first == std::string::npos ? size : first,
+          json::detail::firstEscapable(s, false));
+    }
+  }
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/LazyJsonConverter.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using folly::json::LazyDocument;
+using folly::json::LazyValue;
+using folly::json::convertTo;
+
+namespace {
+
+enum class Role { LEADER = 1, FOLLOWER = 2 };
+
+struct Endpoint {
+  StringPiece host;
+  uint16_t port{80};
+};
+
+struct Server {
+  std::string name;
+  Endpoint endpoint;
+  Role role{Role::FOLLOWER};
+  double weight{1.0};
+  bool enabled{false};
+  Optional<std::vector<std::string>> tags;
+  std::map<std::string, int64_t> limits;
+  Optional<LazyValue> extra;
+};
+
+} // namespace
+
+namespace folly {
+namespace json {
+
+template <>
+struct JsonFields<Endpoint> {
+  static auto fields() {
+    return std::make_tuple(
+        jsonField("host", &Endpoint::host), jsonField("port", &Endpoint::port));
+  }
+};
+
+template <>
+struct JsonFields<Server> {
+  static auto fields() {
+    return std::make_tuple(
+        jsonField("name", &Server::name),
+        jsonField("endpoint", &Server::endpoint),
+        jsonField("role", &Server::role),
+        jsonField("weight", &Server::weight),
+        jsonField("enabled", &Server::enabled),
+        jsonField("tags", &Server::tags),
+        jsonField("limits", &Server::limits),
+        jsonField("extra", &Server::extra));
+  }
+};
+
+} // namespace json
+} // namespace folly
+
+TEST(LazyJsonConverter, scalars) {
+  LazyDocument doc(R"([true, 42, -7, 2.5, "12", "a\tb", null])");
+  auto root = doc.root();
+  EXPECT_TRUE(convertTo<bool>(root[0]));
+  EXPECT_EQ(42, convertTo<int>(root[1]));
+  EXPECT_EQ(-7, convertTo<int8_t>(root[2]));
+  EXPECT_EQ(2.5, convertTo<double>(root[3]));
+  EXPECT_EQ(12, convertTo<int>(root[4]));
+  EXPECT_EQ("a\tb", convertTo<std::string>(root[5]));
+  EXPECT_EQ("a\tb", convertTo<StringPiece>(root[5]));
+  EXPECT_EQ(none, convertTo<Optional<int>>(root[6]));
+  EXPECT_EQ(42, convertTo<Optional<int>>(root[1]));
+  EXPECT_EQ(Role::LEADER, convertTo<Role>(root[0]));
+  EXPECT_THROW(convertTo<uint8_t>(root[2]), ConversionError);
+  EXPECT_THROW(convertTo<StringPiece>(root[1]), TypeError);
+  EXPECT_THROW(convertTo<std::vector<int>>(root[1]), TypeError);
+}
+
+TEST(LazyJsonConverter, containers) {
+  LazyDocument doc(R"({"list": [1, 2, 3], "pair": ["a", 1],
+                       "map": {"x": [1], "y": [], "x": [2, 3]}})");
+  auto root = doc.root();
+  EXPECT_EQ(
+      std::vector<int>({1, 2, 3}), convertTo<std::vector<int>>(root["list"]));
+  EXPECT_EQ(
+      std::make_pair(std::string("a"), 1),
+      (convertTo<std::pair<std::string, int>>(root["pair"])));
+  // The last of duplicate keys wins
+  auto map = convertTo<std::map<StringPiece, std::vector<int>>>(root["map"]);
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(std::vector<int>({2, 3}), map["x"]);
+  EXPECT_TRUE(map["y"].empty());
+}
+
+TEST(LazyJsonConverter, structs) {
+  std::string json = R"({
+    "name": "db1",
+    "endpoint": {"host": "db1.example.com", "port": 5432, "ignored": [1]},
+    "role": 1,
+    "weight": 0.5,
+    "enabled": true,
+    "tags": ["primary", "ssd"],
+    "limits": {"connections": 100},
+    "extra": {"anything": [null]},
+    "unknown": {"nested": true}
+  })";
+  LazyDocument doc(json);
+  auto server = convertTo<Server>(doc);
+  EXPECT_EQ("db1", server.name);
+  EXPECT_EQ("db1.example.com", server.endpoint.host);
+  EXPECT_EQ(5432, server.endpoint.port);
+  EXPECT_EQ(Role::LEADER, server.role);
+  EXPECT_EQ(0.5, server.weight);
+  EXPECT_TRUE(server.enabled);
+  ASSERT_TRUE(server.tags.hasValue());
+  EXPECT_EQ(std::vector<std::string>({"primary", "ssd"}), *server.tags);
+  EXPECT_EQ(100, server.limits["connections"]);
+  ASSERT_TRUE(server.extra.hasValue());
+  EXPECT_EQ(
+      dynamic(dynamic::object("anything", dynamic::array(nullptr))),
+      server.extra->toDynamic());
+
+  // StringPieces point into the input
+  EXPECT_GE(server.endpoint.host.begin(), json.data());
+  EXPECT_LE(server.endpoint.host.end(), json.data() + json.size());
+}
+
+TEST(LazyJsonConverter, structDefaults) {
+  LazyDocument doc(R"({"name": "db2", "endpoint": {}, "tags": null})");
+  auto server = convertTo<Server>(doc);
+  EXPECT_EQ("db2", server.name);
+  EXPECT_EQ("", server.endpoint.host);
+  EXPECT_EQ(80, server.endpoint.port);
+  EXPECT_EQ(Role::FOLLOWER, server.role);
+  EXPECT_EQ(1.0, server.weight);
+  EXPECT_FALSE(server.tags.hasValue());
+
+  LazyDocument bad(R"({"endpoint": {"port": "http"}})");
+  EXPECT_THROW(convertTo<Server>(bad), std::exception);
+  LazyDocument notObject("[]");
+  EXPECT_THROW(convertTo<Server>(notObject), TypeError);
+}
+
+TEST(LazyJsonConverter, vectorOfStructs) {
+  LazyDocument doc(R"([{"host": "a", "port": 1}, {"host": "b\u0021"}])");
+  auto endpoints = convertTo<std::vector<Endpoint>>(doc);
+  ASSERT_EQ(2, endpoints.size());
+  EXPECT_EQ("a", endpoints[0].host);
+  EXPECT_EQ(1, endpoints[0].port);
+  // Decoded into the document's arena
+  EXPECT_EQ("b!", endpoints[1].host);
+  EXPECT_EQ(80, endpoints[1].port);
+}
@@ -0,0 +1,400 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/LazyJson.h>
+
+#include <cmath>
+#include <random>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/GTest.h>
+
+using folly::dynamic;
+using folly::parseJson;
+using folly::StringPiece;
+using folly::json::LazyDocument;
+using folly::json::LazyValue;
+
+namespace {
+
+void expectSameAsParseJson(StringPiece json) {
+  SCOPED_TRACE(json.str());
+  LazyDocument doc(json);
+  EXPECT_EQ(parseJson(json), doc.toDynamic());
+}
+
+// Offsets stage 1 should find, one character at a time
+std::vector<uint32_t> referenceStructurals(StringPiece json) {
+  std::vector<uint32_t> index;
+  bool inString = false;
+  bool escaped = false;
+  bool inScalar = false;
+  for (uint32_t i = 0; i < json.size(); ++i) {
+    char c = json[i];
+    if (inString) {
+      if (escaped) {
+        escaped = false;
+      } else if (c == '\\') {
+        escaped = true;
+      } else if (c == '"') {
+        index.push_back(i);
+        inString = false;
+      }
+      continue;
+    }
+    bool structural = c == '{' || c == '}' || c == '[' || c == ']' ||
+        c == ':' || c == ',';
+    bool whitespace = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    // Backslashes are only valid in strings, but escape quotes anywhere
+    bool quote = c == '"' && !escaped;
+    escaped = c == '\\' && !escaped;
+    if (quote) {
+      index.push_back(i);
+      inString = true;
+      inScalar = false;
+    } else if (structural) {
+      index.push_back(i);
+      inScalar = false;
+    } else if (whitespace) {
+      inScalar = false;
+    } else if (!inScalar) {
+      index.push_back(i);
+      inScalar = true;
+    }
+  }
+  return index;
+}
+
+std::string makeBenchmarkJson() {
+  std::string json = "[";
+  for (int i = 0; i < 1000; ++i) {
+    if (i > 0) {
+      json += ',';
+    }
+    json += folly::to<std::string>(
+        "{\"id\":",
+        i,
+        ",\"name\":\"user number ",
+        i,
+        "\",\"score\":",
+        i * 0.25,
+        ",\"active\":",
+        i % 2 ? "true" : "false",
+        ",\"tags\":[\"alpha\",\"beta\",\"gamma\"],",
+        "\"address\":{\"city\":\"Menlo Park\",\"zip\":\"94025\"}}");
+  }
+  json += "]";
+  return json;
+}
+
+} // namespace
+
+TEST(LazyJson, Scalars) {
+  LazyDocument doc(
+      R"({"n": null, "t": true, "f": false, "i": -42, "d": 1.5e3,
+          "s": "hi", "big": 9223372036854775807})");
+  auto root = doc.root();
+  EXPECT_TRUE(root.isObject());
+  EXPECT_EQ(7, root.size());
+  EXPECT_TRUE(root["n"].isNull());
+  EXPECT_TRUE(root["t"].getBool());
+  EXPECT_FALSE(root["f"].getBool());
+  EXPECT_EQ(-42, root["i"].getInt());
+  EXPECT_EQ(-42.0, root["i"].getDouble());
+  EXPECT_TRUE(root["d"].isDouble());
+  EXPECT_EQ(1500.0, root["d"].getDouble());
+  EXPECT_EQ("hi", root["s"].getString());
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), root["big"].getInt());
+
+  EXPECT_THROW(root["s"].getInt(), folly::TypeError);
+  EXPECT_THROW(root["i"].getString(), folly::TypeError);
+  EXPECT_THROW(root["i"].size(), folly::TypeError);
+  EXPECT_THROW(root[0], folly::TypeError);
+  EXPECT_THROW(root["missing"], std::out_of_range);
+  EXPECT_FALSE(root.find("missing").hasValue());
+  EXPECT_EQ(0, root.count("missing"));
+}
+
+TEST(LazyJson, Containers) {
+  LazyDocument doc(R"([1, [2, [3, {}]], {"a": [4, 5], "b": {"c": 6}}, [], 7])");
+  auto root = doc.root();
+  ASSERT_EQ(5, root.size());
+  EXPECT_EQ(1, root[0].getInt());
+  EXPECT_EQ(3, root[1][1][0].getInt());
+  EXPECT_TRUE(root[1][1][1].empty());
+  EXPECT_EQ(5, root[2]["a"][1].getInt());
+  EXPECT_EQ(6, root[2]["b"]["c"].getInt());
+  EXPECT_TRUE(root[3].empty());
+  // Skips the nested containers
+  EXPECT_EQ(7, root[4].getInt());
+  EXPECT_THROW(root[5], std::out_of_range);
+
+  std::vector<dynamic::Type> types;
+  for (auto value : root) {
+    types.push_back(value.type());
+  }
+  EXPECT_EQ(
+      (std::vector<dynamic::Type>{
+          dynamic::INT64,
+          dynamic::ARRAY,
+          dynamic::OBJECT,
+          dynamic::ARRAY,
+          dynamic::INT64}),
+      types);
+
+  std::vector<std::string> keys;
+  for (auto item : root[2].items()) {
+    keys.push_back(item.first.getString());
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), keys);
+  EXPECT_THROW(root[2].begin(), folly::TypeError);
+  EXPECT_THROW(root.items(), folly::TypeError);
+}
+
+TEST(LazyJson, Keys) {
+  LazyDocument doc(R"({"a\"b": 1, "\u00e9": 2, "dup": 3, "dup": 4})");
+  auto root = doc.root();
+  EXPECT_EQ(1, root["a\"b"].getInt());
+  EXPECT_EQ("a\\\"b", (*root.items().begin()).first.getRawString());
+  EXPECT_EQ(2, root["\xc3\xa9"].getInt());
+  // Last one wins, as in parseJson
+  EXPECT_EQ(4, root["dup"].getInt());
+}
+
+TEST(LazyJson, DynamicAccessors) {
+  auto json = R"({"b": true, "i": 12, "d": 2.5, "s": "34", "n": null,
+                  "a": [1], "o": {"x": 1, "y": [2]}})";
+  LazyDocument doc(json);
+  auto root = doc.root();
+  auto expected = parseJson(json);
+
+  for (auto key : {"b", "i", "d", "s", "n", "a", "o"}) {
+    EXPECT_EQ(expected[key].typeName(), std::string(root[key].typeName()));
+  }
+  EXPECT_EQ(expected["b"].asInt(), root["b"].asInt());
+  EXPECT_EQ(expected["i"].asString(), root["i"].asString());
+  EXPECT_EQ(expected["d"].asString(), root["d"].asString());
+  EXPECT_EQ(expected["s"].asDouble(), root["s"].asDouble());
+  EXPECT_EQ(expected["i"].asBool(), root["i"].asBool());
+  EXPECT_THROW(root["a"].asInt(), folly::TypeError);
+  EXPECT_THROW(root["o"].asString(), folly::TypeError);
+
+  std::vector<std::string> keys;
+  for (auto key : root["o"].keys()) {
+    keys.push_back(key.getString());
+  }
+  EXPECT_EQ((std::vector<std::string>{"x", "y"}), keys);
+  std::vector<dynamic> values;
+  for (auto value : root["o"].values()) {
+    values.push_back(value.toDynamic());
+  }
+  EXPECT_EQ((std::vector<dynamic>{1, dynamic::array(2)}), values);
+  EXPECT_THROW(root["a"].keys(), folly::TypeError);
+}
+
+TEST(LazyJson, StringPiece) {
+  LazyDocument doc(R"(["plain", "esc\naped", "\u00e9"])");
+  auto root = doc.root();
+
+  // Points into the input when there is nothing to decode
+  auto arenaSize = doc.arenaSize();
+  auto plain = root[0].stringPiece();
+  EXPECT_EQ("plain", plain);
+  EXPECT_TRUE(doc.json().begin() <= plain.begin());
+  EXPECT_TRUE(plain.end() <= doc.json().end());
+  EXPECT_EQ(arenaSize, doc.arenaSize());
+
+  // Decoded into the document's arena otherwise
+  EXPECT_EQ("esc\naped", root[1].stringPiece());
+  EXPECT_EQ("\xc3\xa9", root[2].stringPiece());
+  EXPECT_LT(arenaSize, doc.arenaSize());
+}
+
+TEST(LazyJson, MatchesParseJson) {
+  for (auto json : {
+           "null",
+           " true ",
+           "-0",
+           "0.5",
+           "1e-3",
+           "-12E+2",
+           "007",
+           "\"\"",
+           "\"tab\\there \\/ \\\\ \\\" \\b\\f\\n\\r\"",
+           "\"I \\u2665 UTF-8 \\ud83d\\ude00\"",
+           "\"caf\xc3\xa9\"",
+           "[]",
+           "{}",
+           "[[[[[]]]]]",
+           "[1, -2, 3.25, \"x\", null, true, false, {\"k\": [{}]}]",
+           "{\"a\":{\"b\":{\"c\":[1,2,{\"d\":\"e\"}]}},\"f\":-1.5}",
+           "[Infinity, -Infinity]",
+           " \n\t\r[ 1 ,\n 2 ] \n",
+       }) {
+    expectSameAsParseJson(json);
+  }
+  LazyDocument nan("NaN");
+  EXPECT_TRUE(std::isnan(nan.root().getDouble()));
+
+  expectSameAsParseJson(makeBenchmarkJson());
+}
+
+TEST(LazyJson, StringsAcrossBlocks) {
+  // Quotes and runs of backslashes at every offset around the 64 byte
+  // blocks of stage 1
+  for (size_t pad = 0; pad < 70; ++pad) {
+    for (size_t backslashes = 0; backslashes < 6; ++backslashes) {
+      std::string s(pad, 'x');
+      s.append(backslashes * 2, '\\');
+      s += "\\\"";
+      s += std::string(pad % 7, 'y');
+      auto json = folly::to<std::string>(
+          "[\"", s, "\", {\"", s, "\": \"", std::string(pad, ' '), "\"}]");
+      expectSameAsParseJson(json);
+    }
+  }
+}
+
+TEST(LazyJson, Structurals) {
+  std::mt19937 rng(12345);
+  const char alphabet[] = "\"\\{}[]:, \n1ax";
+  for (int iter = 0; iter < 2000; ++iter) {
+    std::string json(rng() % 300, ' ');
+    for (auto& c : json) {
+      c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+    std::vector<uint32_t> index;
+    bool terminated = folly::json::detail::findStructurals(json, index);
+    auto expected = referenceStructurals(json);
+    if (terminated) {
+      EXPECT_EQ(expected, index) << json;
+    }
+  }
+}
+
+TEST(LazyJson, Errors) {
+  for (auto json : {
+           "",
+           "   ",
+           "[",
+           "[1,",
+           "[1 2]",
+           "{\"a\" 1}",
+           "{\"a\": }",
+           "{1: 2}",
+           "{\"a\": 1,}",
+           "[1,]",
+           "\"unterminated",
+           "\"escaped quote\\\"",
+           "tru",
+           "nulll",
+           "-",
+           "1e",
+           "01x",
+           "1 2",
+           "[1]]",
+           "\"a\"b",
+           "[1\\\"]",
+           "9223372036854775808",
+       }) {
+    SCOPED_TRACE(json);
+    EXPECT_THROW(LazyDocument doc(json), std::runtime_error);
+    EXPECT_THROW(parseJson(json), std::runtime_error);
+  }
+
+  try {
+    LazyDocument doc("[1,\n2,\n x]");
+    ADD_FAILURE();
+  } catch (const std::runtime_error& e) {
+    EXPECT_EQ(
+        "json parse error on line 2 near `x]': expected json value",
+        std::string(e.what()));
+  }
+
+  // Stricter than parseJson
+  EXPECT_THROW(LazyDocument("1."), std::runtime_error);
+
+  // Strings are only decoded on demand
+  LazyDocument doc("[\"\\q\"]");
+  EXPECT_THROW(doc.root()[0].getString(), std::runtime_error);
+}
+
+TEST(LazyJson, Options) {
+  folly::json::serialization_opts opts;
+  opts.allow_trailing_comma = true;
+  EXPECT_EQ(
+      dynamic(dynamic::array(1, dynamic::object("a", 2))),
+      LazyDocument("[1, {\"a\": 2,},]", opts).toDynamic());
+
+  opts = folly::json::serialization_opts();
+  opts.recursion_limit = 3;
+  EXPECT_NO_THROW(LazyDocument("[[[1]]]", opts));
+  EXPECT_THROW(LazyDocument("[[[[1]]]]", opts), std::runtime_error);
+
+  opts = folly::json::serialization_opts();
+  opts.double_fallback = true;
+  LazyDocument big("18446744073709551616", opts);
+  EXPECT_TRUE(big.root().isDouble());
+  EXPECT_EQ(18446744073709551616.0, big.root().getDouble());
+
+  opts = folly::json::serialization_opts();
+  opts.parse_numbers_as_strings = true;
+  auto json = "[1, -2.5e3, Infinity]";
+  EXPECT_EQ(parseJson(json, opts), LazyDocument(json, opts).toDynamic());
+}
+
+BENCHMARK(parseJsonLarge, iters) {
+  std::string json;
+  BENCHMARK_SUSPEND {
+    json = makeBenchmarkJson();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(parseJson(json));
+  }
+}
+
+BENCHMARK_RELATIVE(lazyParseLarge, iters) {
+  std::string json;
+  BENCHMARK_SUSPEND {
+    json = makeBenchmarkJson();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    LazyDocument doc(json);
+    folly::doNotOptimizeAway(doc.size());
+  }
+}
+
+BENCHMARK_RELATIVE(lazyParseLargeToDynamic, iters) {
+  std::string json;
+  BENCHMARK_SUSPEND {
+    json = makeBenchmarkJson();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(LazyDocument(json).toDynamic());
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_benchmark) {
+    folly::runBenchmarks();
+  }
+  return RUN_ALL_TESTS();
+}
@@ -16,6 +16,7 @@
 
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <folly/experimental/LockFreeRingBuffer.h>
 #include <folly/portability/GTest.h>
@@ -257,4 +258,111 @@ TEST(LockFreeRingBuffer, moveBackwardsCanFail) {
   EXPECT_FALSE(cursor.moveBackward()); // moving back does nothing
 }
 
+TEST(LockFreeRingBuffer, writeRangeReadRange) {
+  // Power of two and not, and ranges that wrap around
+  for (uint32_t capacity : {16u, 13u}) {
+    LockFreeRingBuffer<int> rb(capacity);
+    std::vector<int> values(10);
+    int next = 0;
+    for (int round = 0; round < 10; round++) {
+      for (auto& v : values) {
+        v = next++;
+      }
+      auto cursor = rb.writeRange(values.data(), values.size());
+
+      std::vector<int> dest(values.size() + 5, -1);
+      EXPECT_EQ(
+          values.size(), rb.tryReadRange(dest.data(), dest.size(), cursor));
+      dest.resize(values.size());
+      EXPECT_EQ(values, dest);
+      EXPECT_EQ(next, (value<int, std::atomic>)(cursor));
+    }
+
+    // The oldest writes were overwritten
+    auto cursor = rb.currentHead();
+    cursor.moveBackward(capacity + 1);
+    int dest[4];
+    EXPECT_EQ(0, rb.tryReadRange(dest, 4, cursor));
+
+    cursor = rb.currentTail();
+    std::vector<int> all(capacity);
+    EXPECT_EQ(capacity, rb.tryReadRange(all.data(), capacity, cursor));
+    for (uint32_t i = 0; i < capacity; i++) {
+      EXPECT_EQ(next - int(capacity) + int(i), all[i]);
+    }
+  }
+}
+
+TEST(LockFreeRingBuffer, writeRangeIsContiguous) {
+  const int kRange = 8;
+  const int kRounds = 1000;
+  const int kWriters = 4;
+  LockFreeRingBuffer<int> rb(kRange * kRounds * kWriters);
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < kWriters; w++) {
+    threads.emplace_back([&, w] {
+      int values[kRange];
+      for (int round = 0; round < kRounds; round++) {
+        for (int i = 0; i < kRange; i++) {
+          values[i] = (w * kRounds + round) * kRange + i;
+        }
+        rb.writeRange(values, kRange);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> all(kRange * kRounds * kWriters);
+  auto cursor = rb.currentTail();
+  ASSERT_EQ(all.size(), rb.tryReadRange(all.data(), all.size(), cursor));
+  for (size_t i = 0; i < all.size(); i += kRange) {
+    EXPECT_EQ(0, all[i] % kRange);
+    for (int j = 1; j < kRange; j++) {
+      EXPECT_EQ(all[i] + j, all[i + j]);
+    }
+  }
+}
+
+TEST(LockFreeRingBuffer, sharded) {
+  const int kWrites = 1000;
+  const int kWriters = 4;
+  ShardedLockFreeRingBuffer<int> rb(kWrites * kWriters, 3);
+  EXPECT_EQ(3, rb.numShards());
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < kWriters; w++) {
+    threads.emplace_back([&, w] {
+      for (int i = 0; i < kWrites; i++) {
+        int val = w * kWrites + i;
+        rb.write(val);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Every write is in exactly one shard, and each writer's writes are in
+  // order within a shard
+  std::vector<int> seen(kWrites * kWriters, 0);
+  for (size_t i = 0; i < rb.numShards(); i++) {
+    auto& shard = rb.shard(i);
+    std::vector<int> values(shard.capacity());
+    auto cursor = shard.currentTail();
+    size_t n = shard.tryReadRange(values.data(), values.size(), cursor);
+    std::vector<int> last(kWriters, -1);
+    for (size_t j = 0; j < n; j++) {
+      seen[values[j]]++;
+      EXPECT_LT(last[values[j] / kWrites], values[j]);
+      last[values[j] / kWrites] = values[j];
+    }
+  }
+  for (int count : seen) {
+    EXPECT_EQ(1, count);
+  }
+}
+
 } // namespace folly
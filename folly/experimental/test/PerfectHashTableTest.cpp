@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/PerfectHashTable.h>
+
+#include <set>
+#include <string>
+
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using folly::test::TemporaryFile;
+
+namespace {
+
+std::string keyFor(size_t i) {
+  return sformat("key{}", i * 7919);
+}
+
+std::string valueFor(size_t i) {
+  return std::string(i % 13, char('a' + i % 26));
+}
+
+void build(
+    const TemporaryFile& file,
+    size_t n,
+    PerfectHashTableBuilder::Options options =
+        PerfectHashTableBuilder::Options()) {
+  PerfectHashTableBuilder builder(options);
+  for (size_t i = 0; i < n; i++) {
+    builder.add(keyFor(i), valueFor(i));
+  }
+  EXPECT_EQ(n, builder.size());
+  builder.write(file.path().c_str());
+}
+
+void checkTable(const PerfectHashTable& table, size_t n) {
+  ASSERT_EQ(n, table.size());
+  for (size_t i = 0; i < n; i++) {
+    auto value = table.find(keyFor(i));
+    ASSERT_TRUE(value.hasValue()) << i;
+    EXPECT_EQ(valueFor(i), *value);
+    EXPECT_FALSE(table.find(keyFor(i) + "x").hasValue());
+  }
+  // Every entry appears exactly once
+  std::set<std::string> keys;
+  for (size_t i = 0; i < n; i++) {
+    keys.insert(table.entry(i).first.str());
+  }
+  EXPECT_EQ(n, keys.size());
+}
+
+} // namespace
+
+TEST(PerfectHashTable, Basic) {
+  TemporaryFile file;
+  PerfectHashTableBuilder builder;
+  builder.add("banana", "yellow");
+  builder.add("apple", "red");
+  builder.add("cherry", "");
+  builder.write(file.path().c_str());
+
+  PerfectHashTable table(file.path().c_str());
+  EXPECT_EQ(3, table.size());
+  EXPECT_FALSE(table.empty());
+  EXPECT_EQ("red", table.find("apple").value());
+  EXPECT_EQ("yellow", table.find("banana").value());
+  EXPECT_EQ("", table.find("cherry").value());
+  EXPECT_FALSE(table.find("apricot").hasValue());
+  EXPECT_FALSE(table.find("").hasValue());
+}
+
+TEST(PerfectHashTable, Empty) {
+  TemporaryFile file;
+  build(file, 0);
+  PerfectHashTable table(file.path().c_str());
+  EXPECT_TRUE(table.empty());
+  EXPECT_FALSE(table.find("a").hasValue());
+}
+
+TEST(PerfectHashTable, Sizes) {
+  for (size_t n : {1, 2, 5, 100, 4000, 50000}) {
+    TemporaryFile file;
+    build(file, n);
+    checkTable(PerfectHashTable(file.path().c_str()), n);
+  }
+}
+
+TEST(PerfectHashTable, Options) {
+  for (size_t threads : {1, 4}) {
+    for (size_t shardSize : {1, 3, 100, 100000}) {
+      TemporaryFile file;
+      build(
+          file,
+          3000,
+          PerfectHashTableBuilder::Options()
+              .setThreads(threads)
+              .setShardSize(shardSize)
+              .setSeed(threads * shardSize));
+      checkTable(PerfectHashTable(file.path().c_str()), 3000);
+    }
+  }
+}
+
+TEST(PerfectHashTable, Deterministic) {
+  TemporaryFile a;
+  TemporaryFile b;
+  build(a, 1000, PerfectHashTableBuilder::Options().setThreads(1));
+  build(b, 1000, PerfectHashTableBuilder::Options().setThreads(3));
+  std::string contentsA;
+  std::string contentsB;
+  ASSERT_TRUE(readFile(a.path().c_str(), contentsA));
+  ASSERT_TRUE(readFile(b.path().c_str(), contentsB));
+  EXPECT_EQ(contentsA, contentsB);
+}
+
+TEST(PerfectHashTable, DuplicateKey) {
+  TemporaryFile file;
+  PerfectHashTableBuilder builder;
+  builder.add("a", "1");
+  builder.add("b", "2");
+  builder.add("a", "3");
+  EXPECT_THROW(builder.write(file.path().c_str()), std::invalid_argument);
+}
+
+TEST(PerfectHashTable, Corrupt) {
+  TemporaryFile file;
+  build(file, 100);
+  std::string contents;
+  ASSERT_TRUE(readFile(file.path().c_str(), contents));
+
+  auto check = [&](std::string bytes) {
+    TemporaryFile bad;
+    ASSERT_TRUE(writeFile(bytes, bad.path().c_str()));
+    EXPECT_THROW(PerfectHashTable(bad.path().c_str()), std::runtime_error);
+  };
+  check("");
+  check(contents.substr(0, 64));
+  check(contents.substr(0, contents.size() - 1));
+  auto badMagic = contents;
+  badMagic[0] ^= 1;
+  check(badMagic);
+  // The first shard's entry count
+  auto badShards = contents;
+  badShards[128 + 24] ^= 1;
+  check(badShards);
+}
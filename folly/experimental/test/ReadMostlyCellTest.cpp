@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/experimental/ReadMostlyCell.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(ReadMostlyCell, PublishAndSnapshot) {
+  ReadMostlyCell<std::string> cell("a");
+  auto s0 = cell.getSnapshot();
+  EXPECT_EQ("a", *s0);
+  EXPECT_EQ(0, s0.getVersion());
+  EXPECT_FALSE(cell.needRefresh(s0));
+
+  cell.publish(std::string("b"));
+  EXPECT_EQ(1, cell.getVersion());
+  EXPECT_TRUE(cell.needRefresh(s0));
+  // Old snapshots keep their version alive
+  EXPECT_EQ("a", *s0);
+
+  auto s1 = *cell;
+  EXPECT_EQ("b", *s1);
+  EXPECT_EQ(1, s1.getVersion());
+
+  auto copy = s0;
+  s0 = ReadMostlyCell<std::string>::Snapshot();
+  EXPECT_FALSE(s0);
+  EXPECT_EQ("a", *copy);
+  auto moved = std::move(copy);
+  EXPECT_EQ("a", *moved);
+  EXPECT_EQ(nullptr, copy.get());
+}
+
+TEST(ReadMostlyCell, SnapshotOutlivesCell) {
+  ReadMostlyCell<std::string>::Snapshot snapshot;
+  {
+    auto data = std::make_shared<const std::string>("x");
+    ReadMostlyCell<std::string> cell(data);
+    snapshot = cell.getSnapshot();
+    EXPECT_EQ(data.get(), snapshot.get());
+  }
+  EXPECT_EQ("x", *snapshot);
+}
+
+TEST(ReadMostlyCell, Update) {
+  ReadMostlyCell<std::vector<int>> cell(std::vector<int>{});
+  cell.update([](std::vector<int>& v) { v.push_back(1); });
+  cell.update([](std::vector<int>& v) { v.push_back(2); });
+  EXPECT_EQ((std::vector<int>{1, 2}), *cell.getSnapshot());
+  EXPECT_EQ(2, cell.getVersion());
+}
+
+TEST(ReadMostlyCell, ConcurrentUpdatesAreBatched) {
+  constexpr int kThreads = 8;
+  constexpr int kUpdates = 1000;
+  ReadMostlyCell<int> cell(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kUpdates; ++i) {
+        cell.update([](int& v) { ++v; });
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(kThreads * kUpdates, *cell.getSnapshot());
+  EXPECT_LE(cell.getVersion(), size_t(kThreads * kUpdates));
+}
+
+TEST(ReadMostlyCell, Callback) {
+  ReadMostlyCell<int> cell(1);
+  std::vector<std::pair<int, size_t>> seen;
+  {
+    auto handle = cell.addCallback([&](const ReadMostlyCell<int>::Snapshot& s) {
+      seen.emplace_back(*s, s.getVersion());
+    });
+    cell.publish(2);
+    cell.update([](int& v) { v *= 10; });
+  }
+  cell.publish(3);
+  EXPECT_EQ(
+      (std::vector<std::pair<int, size_t>>{{1, 0}, {2, 1}, {20, 2}}), seen);
+}
+
+TEST(ReadMostlyCell, ConcurrentReaders) {
+  ReadMostlyCell<std::string> cell(std::string(100, 'a'));
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        auto s = cell.getSnapshot();
+        auto c = (*s)[0];
+        EXPECT_EQ(std::string(100, c), *s);
+      }
+    });
+  }
+  for (char c = 'a'; c <= 'z'; ++c) {
+    for (int i = 0; i < 100; ++i) {
+      cell.publish(std::string(100, c));
+    }
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+}
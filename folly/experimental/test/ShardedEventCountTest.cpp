@@ -0,0 +1,177 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/ShardedEventCount.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+class Semaphore {
+ public:
+  Semaphore(size_t shards, size_t spins) : ec_(shards, spins) {}
+
+  void down() {
+    ec_.await([this] { return tryDown(); });
+  }
+
+  void up() {
+    ++value_;
+    ec_.notify();
+  }
+
+  int value() const {
+    return value_;
+  }
+
+ private:
+  bool tryDown() {
+    for (int v = value_; v != 0;) {
+      if (value_.compare_exchange_weak(v, v - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::atomic<int> value_{0};
+  ShardedEventCount ec_;
+};
+
+void runSemaphore(size_t shards, size_t spins) {
+  // We're basically testing for no deadlock: every up() wakes one waiter
+  static const int kThreads = 16;
+  static const int kOps = 20000;
+  Semaphore sem(shards, spins);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kOps; ++j) {
+        sem.down();
+      }
+    });
+    threads.emplace_back([&] {
+      for (int j = 0; j < kOps; ++j) {
+        sem.up();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, sem.value());
+}
+
+void waitForWaiters(const ShardedEventCount& ec, uint64_t parks) {
+  while (ec.stats().parks < parks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+} // namespace
+
+TEST(ShardedEventCount, Semaphore) {
+  runSemaphore(1, 0);
+  runSemaphore(4, 0);
+  runSemaphore(4, ShardedEventCount::kDefaultSpins);
+  runSemaphore(0, ShardedEventCount::kDefaultSpins);
+}
+
+TEST(ShardedEventCount, NotifyN) {
+  static const int kWaiters = 6;
+  ShardedEventCount ec(3, 0);
+  std::atomic<int> tickets{0};
+  std::atomic<int> done{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kWaiters; ++i) {
+    threads.emplace_back([&] {
+      ec.await([&] {
+        for (int t = tickets; t != 0;) {
+          if (tickets.compare_exchange_weak(t, t - 1)) {
+            return true;
+          }
+        }
+        return false;
+      });
+      ++done;
+    });
+  }
+  waitForWaiters(ec, kWaiters);
+
+  tickets += 2;
+  ec.notify(2);
+  while (done < 2) {
+    std::this_thread::yield();
+  }
+  // Only as many as were notified woke up
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(2, done);
+  EXPECT_LE(ec.stats().notifies, 2);
+
+  tickets += kWaiters - 2;
+  ec.notifyAll();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kWaiters, done);
+  EXPECT_EQ(0, tickets);
+}
+
+TEST(ShardedEventCount, Stats) {
+  ShardedEventCount ec(2, ShardedEventCount::kDefaultSpins);
+  EXPECT_EQ(2, ec.numShards());
+
+  // Notified before waiting: wait() returns right away
+  auto key = ec.prepareWait();
+  ec.notify();
+  ec.wait(key);
+  auto stats = ec.stats();
+  EXPECT_EQ(1, stats.waits);
+  EXPECT_EQ(1, stats.spinWakeups);
+  EXPECT_EQ(0, stats.parks);
+  EXPECT_EQ(1, stats.notifies);
+
+  // Nobody to wake
+  ec.notifyAll();
+  key = ec.prepareWait();
+  ec.cancelWait(key);
+  ec.notify();
+  EXPECT_EQ(1, ec.stats().notifies);
+
+  std::thread waiter([&] {
+    auto k = ec.prepareWait();
+    ec.wait(k);
+  });
+  waitForWaiters(ec, 1);
+  ec.notify();
+  waiter.join();
+  stats = ec.stats();
+  EXPECT_EQ(2, stats.waits);
+  EXPECT_EQ(1, stats.parks);
+  EXPECT_EQ(2, stats.notifies);
+}
+
+TEST(ShardedEventCount, DefaultShards) {
+  ShardedEventCount ec;
+  EXPECT_LE(1, ec.numShards());
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/SortedTable.h>
+
+#include <string>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using folly::test::TemporaryFile;
+
+namespace {
+
+std::string keyFor(size_t i) {
+  return sformat("key{:08}", i);
+}
+
+std::string valueFor(size_t i) {
+  return std::string(i % 17, char('a' + i % 26));
+}
+
+void build(
+    const TemporaryFile& file,
+    size_t n,
+    SortedTableBuilder::Options options = SortedTableBuilder::Options()) {
+  SortedTableBuilder builder(file.path().c_str(), options);
+  for (size_t i = 0; i < n; i++) {
+    builder.add(keyFor(i), valueFor(i));
+  }
+  EXPECT_EQ(n, builder.size());
+  builder.finish();
+}
+
+void checkTable(const SortedTable& table, size_t n) {
+  ASSERT_EQ(n, table.size());
+  for (size_t i = 0; i < n; i++) {
+    auto value = table.find(keyFor(i));
+    ASSERT_TRUE(value.hasValue()) << i;
+    EXPECT_EQ(valueFor(i), *value);
+    EXPECT_EQ(keyFor(i), table.key(i));
+    EXPECT_EQ(i, table.lowerBound(keyFor(i)));
+    // Between key i and key i + 1
+    EXPECT_EQ(i + 1, table.lowerBound(keyFor(i) + "x"));
+    EXPECT_FALSE(table.find(keyFor(i) + "x").hasValue());
+  }
+  EXPECT_EQ(0, table.lowerBound(""));
+  EXPECT_EQ(n, table.lowerBound("l"));
+  EXPECT_FALSE(table.find("").hasValue());
+  EXPECT_FALSE(table.find("l").hasValue());
+}
+
+} // namespace
+
+TEST(SortedTable, Basic) {
+  TemporaryFile file;
+  {
+    SortedTableBuilder builder(file.path().c_str());
+    builder.add("apple", "red");
+    builder.add("banana", "yellow");
+    builder.add("cherry", "");
+    builder.finish();
+  }
+  SortedTable table(file.path().c_str());
+  EXPECT_EQ(3, table.size());
+  EXPECT_FALSE(table.empty());
+  EXPECT_EQ("red", table.find("apple").value());
+  EXPECT_EQ("yellow", table.find("banana").value());
+  EXPECT_EQ("", table.find("cherry").value());
+  EXPECT_FALSE(table.find("apricot").hasValue());
+  EXPECT_EQ(1, table.lowerBound("apricot"));
+  EXPECT_EQ(
+      std::make_pair(StringPiece("banana"), StringPiece("yellow")),
+      table.entry(1));
+}
+
+TEST(SortedTable, Empty) {
+  TemporaryFile file;
+  build(file, 0);
+  SortedTable table(file.path().c_str());
+  EXPECT_TRUE(table.empty());
+  EXPECT_FALSE(table.find("a").hasValue());
+  EXPECT_EQ(0, table.lowerBound("a"));
+}
+
+TEST(SortedTable, Uncompressed) {
+  for (size_t n : {1, 63, 64, 65, 1000, 5000}) {
+    TemporaryFile file;
+    build(file, n);
+    checkTable(SortedTable(file.path().c_str()), n);
+  }
+}
+
+TEST(SortedTable, CompressedOffsets) {
+  for (size_t n : {1, 63, 64, 65, 1000, 5000}) {
+    TemporaryFile plain;
+    TemporaryFile compressed;
+    build(plain, n);
+    build(
+        compressed, n, SortedTableBuilder::Options().setCompressOffsets(true));
+    SortedTable table(compressed.path().c_str());
+    checkTable(table, n);
+    if (n >= 1000) {
+      EXPECT_LT(
+          table.mapping().range().size(),
+          SortedTable(plain.path().c_str()).mapping().range().size());
+    }
+  }
+}
+
+TEST(SortedTable, FenceInterval) {
+  for (size_t interval : {1, 2, 7, 1000}) {
+    TemporaryFile file;
+    build(
+        file, 300, SortedTableBuilder::Options().setFenceInterval(interval));
+    checkTable(SortedTable(file.path().c_str()), 300);
+  }
+}
+
+TEST(SortedTable, BinaryKeysAndValues) {
+  TemporaryFile file;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 256; i++) {
+    keys.push_back(std::string(1, '\0') + char(i));
+  }
+  {
+    SortedTableBuilder builder(file.path().c_str());
+    for (auto& key : keys) {
+      builder.add(key, key + std::string(300, '\0'));
+    }
+    builder.finish();
+  }
+  SortedTable table(file.path().c_str());
+  // unsigned char ordering, as StringPiece compares
+  for (auto& key : keys) {
+    auto value = table.find(key);
+    ASSERT_TRUE(value.hasValue());
+    EXPECT_EQ(key + std::string(300, '\0'), *value);
+  }
+}
+
+TEST(SortedTable, OutOfOrder) {
+  TemporaryFile file;
+  SortedTableBuilder builder(file.path().c_str());
+  builder.add("b", "");
+  EXPECT_THROW(builder.add("a", ""), std::invalid_argument);
+  EXPECT_THROW(builder.add("b", ""), std::invalid_argument);
+  builder.add("c", "");
+  builder.finish();
+  EXPECT_EQ(2, SortedTable(file.path().c_str()).size());
+}
+
+TEST(SortedTable, Corrupt) {
+  TemporaryFile file;
+  build(file, 100);
+  std::string contents;
+  ASSERT_TRUE(readFile(file.path().c_str(), contents));
+
+  auto check = [&](std::string bytes) {
+    TemporaryFile bad;
+    ASSERT_TRUE(writeFile(bytes, bad.path().c_str()));
+    EXPECT_THROW(SortedTable(bad.path().c_str()), std::runtime_error);
+  };
+  check("");
+  check(contents.substr(0, 64));
+  check(contents.substr(0, contents.size() - 1));
+  check(contents + "x");
+  auto badMagic = contents;
+  badMagic[0] ^= 1;
+  check(badMagic);
+  auto badVersion = contents;
+  badVersion[8] ^= 1;
+  check(badVersion);
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/StreamVByte.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/GroupVarint.h>
+
+using namespace folly;
+
+namespace {
+
+constexpr size_t kCount = 1 << 16;
+
+std::vector<uint32_t> values;
+std::vector<uint32_t> sortedValues;
+std::vector<uint8_t> streamVByte;
+std::vector<uint8_t> streamVByteDelta;
+std::vector<char> groupVarint;
+std::vector<uint32_t> decoded(kCount);
+
+void init() {
+  std::mt19937 rng(1);
+  // Mostly small, like counters and ids relative to a base
+  std::geometric_distribution<uint32_t> dist(1e-4);
+  for (size_t i = 0; i < kCount; ++i) {
+    values.push_back(dist(rng));
+  }
+  sortedValues = values;
+  std::partial_sum(
+      sortedValues.begin(), sortedValues.end(), sortedValues.begin());
+
+  streamVByte.resize(streamVByteMaxEncodedSize<uint32_t>(kCount));
+  streamVByte.resize(
+      streamVByteEncode(values.data(), kCount, streamVByte.data()));
+  streamVByteDelta.resize(streamVByteMaxEncodedSize<uint32_t>(kCount));
+  streamVByteDelta.resize(streamVByteEncodeDelta(
+      sortedValues.data(), kCount, streamVByteDelta.data()));
+
+  groupVarint.resize(kCount / 4 * GroupVarint32::kMaxSize);
+  char* p = groupVarint.data();
+  for (size_t i = 0; i < kCount; i += 4) {
+    p = GroupVarint32::encode(p, &values[i]);
+  }
+}
+
+} // namespace
+
+BENCHMARK(GroupVarint32Decode, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    const char* p = groupVarint.data();
+    for (size_t j = 0; j < kCount; j += 4) {
+      p = GroupVarint32::decode(p, &decoded[j]);
+    }
+    doNotOptimizeAway(decoded[kCount - 1]);
+  }
+  BENCHMARK_SUSPEND {
+    CHECK(decoded == values);
+  }
+}
+
+BENCHMARK_RELATIVE(StreamVByteDecode, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    streamVByteDecode(
+        ByteRange(streamVByte.data(), streamVByte.size()),
+        kCount,
+        decoded.data());
+    doNotOptimizeAway(decoded[kCount - 1]);
+  }
+  BENCHMARK_SUSPEND {
+    CHECK(decoded == values);
+  }
+}
+
+BENCHMARK_RELATIVE(StreamVByteDecodeDelta, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    streamVByteDecodeDelta(
+        ByteRange(streamVByteDelta.data(), streamVByteDelta.size()),
+        kCount,
+        decoded.data());
+    doNotOptimizeAway(decoded[kCount - 1]);
+  }
+  BENCHMARK_SUSPEND {
+    CHECK(decoded == sortedValues);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(StreamVByteEncode, iters) {
+  std::vector<uint8_t> out(streamVByteMaxEncodedSize<uint32_t>(kCount));
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(streamVByteEncode(values.data(), kCount, out.data()));
+  }
+}
+
+#if 0
+Intel Xeon, GCC -O2 -msse4.2, 65536 values per iteration
+============================================================================
+folly/experimental/test/StreamVByteBenchmark.cpp relative  time/iter  iters/s
+============================================================================
+GroupVarint32Decode                                         60.52us   16.52K
+StreamVByteDecode                                440.88%    13.73us   72.85K
+StreamVByteDecodeDelta                           286.33%    21.14us   47.31K
+----------------------------------------------------------------------------
+StreamVByteEncode                                           91.54us   10.92K
+============================================================================
+#endif
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/StreamVByte.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+// Values of every encoded length
+template <class T>
+std::vector<T> makeValues(size_t n, uint32_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<T> values(n);
+  for (auto& v : values) {
+    auto bits = rng() % (8 * sizeof(T) + 1);
+    v = bits == 0 ? 0 : T(rng() >> (64 - bits));
+  }
+  return values;
+}
+
+template <class T, class Encode, class Decode>
+void checkRoundTrip(const std::vector<T>& values, Encode enc, Decode dec) {
+  auto n = values.size();
+  std::vector<uint8_t> buf(streamVByteMaxEncodedSize<T>(n));
+  auto size = enc(values.data(), n, buf.data());
+  EXPECT_LE(size, buf.size());
+  // Decode from exactly the encoded bytes, so that a read past the end
+  // shows up under ASAN.
+  std::vector<uint8_t> exact(buf.begin(), buf.begin() + size);
+  std::vector<T> decoded(n);
+  EXPECT_EQ(size, dec(ByteRange(exact.data(), size), n, decoded.data()));
+  EXPECT_EQ(values, decoded);
+}
+
+template <class T>
+void checkPlain(const std::vector<T>& values) {
+  checkRoundTrip(
+      values,
+      [](const T* in, size_t n, uint8_t* out) {
+        return streamVByteEncode(in, n, out);
+      },
+      [](ByteRange in, size_t n, T* out) {
+        return streamVByteDecode(in, n, out);
+      });
+}
+
+} // namespace
+
+TEST(StreamVByte, Empty) {
+  uint8_t buf[1] = {};
+  uint32_t values[1] = {};
+  EXPECT_EQ(0, streamVByteEncode(values, 0, buf));
+  EXPECT_EQ(0, streamVByteDecode(ByteRange(), 0, values));
+}
+
+TEST(StreamVByte, Lengths) {
+  uint8_t buf[streamVByteMaxEncodedSize<uint32_t>(4)];
+  uint32_t values32[] = {0, 0x100, 0x10000, 0x1000000};
+  // One control byte, then 1 + 2 + 3 + 4 bytes
+  EXPECT_EQ(11, streamVByteEncode(values32, 4, buf));
+  EXPECT_EQ(0xe4, buf[0]);
+
+  uint8_t buf64[streamVByteMaxEncodedSize<uint64_t>(2)];
+  uint64_t values64[] = {0xff, std::numeric_limits<uint64_t>::max()};
+  EXPECT_EQ(1 + 1 + 8, streamVByteEncode(values64, 2, buf64));
+  EXPECT_EQ(0x70, buf64[0]);
+}
+
+TEST(StreamVByte, RoundTrip32) {
+  for (size_t n : {1, 3, 4, 5, 15, 16, 17, 1000, 10001}) {
+    checkPlain(makeValues<uint32_t>(n, n));
+  }
+}
+
+TEST(StreamVByte, RoundTrip64) {
+  for (size_t n : {1, 2, 3, 15, 16, 17, 1000, 10001}) {
+    checkPlain(makeValues<uint64_t>(n, n));
+  }
+}
+
+TEST(StreamVByte, Delta) {
+  auto values32 = makeValues<uint32_t>(1001, 1);
+  std::sort(values32.begin(), values32.end());
+  auto values64 = makeValues<uint64_t>(1001, 2);
+  std::sort(values64.begin(), values64.end());
+
+  for (uint32_t previous : {0u, 7u}) {
+    checkRoundTrip(
+        values32,
+        [=](const uint32_t* in, size_t n, uint8_t* out) {
+          return streamVByteEncodeDelta(in, n, out, previous);
+        },
+        [=](ByteRange in, size_t n, uint32_t* out) {
+          return streamVByteDecodeDelta(in, n, out, previous);
+        });
+  }
+  checkRoundTrip(
+      values64,
+      [](const uint64_t* in, size_t n, uint8_t* out) {
+        return streamVByteEncodeDelta(in, n, out);
+      },
+      [](ByteRange in, size_t n, uint64_t* out) {
+        return streamVByteDecodeDelta(in, n, out);
+      });
+
+  // Unsorted input still round-trips, through wraparound.
+  checkRoundTrip(
+      makeValues<uint32_t>(1001, 3),
+      [](const uint32_t* in, size_t n, uint8_t* out) {
+        return streamVByteEncodeDelta(in, n, out);
+      },
+      [](ByteRange in, size_t n, uint32_t* out) {
+        return streamVByteDecodeDelta(in, n, out);
+      });
+
+  // Dense ids take one byte each.
+  std::vector<uint32_t> dense(1000);
+  for (size_t i = 0; i < dense.size(); ++i) {
+    dense[i] = uint32_t(1000000 + 3 * i);
+  }
+  std::vector<uint8_t> buf(streamVByteMaxEncodedSize<uint32_t>(1000));
+  // The first id takes 3 bytes.
+  EXPECT_EQ(
+      250 + 1000 + 2, streamVByteEncodeDelta(dense.data(), 1000, buf.data()));
+}
+
+TEST(StreamVByte, ZigZag) {
+  std::vector<int32_t> values32;
+  std::vector<int64_t> values64;
+  for (int i = -500; i < 500; ++i) {
+    values32.push_back(i * i * (i % 3 - 1));
+    values64.push_back(int64_t(i) * i * i * i * (i % 3 - 1));
+  }
+  values32.push_back(std::numeric_limits<int32_t>::min());
+  values32.push_back(std::numeric_limits<int32_t>::max());
+  values64.push_back(std::numeric_limits<int64_t>::min());
+  values64.push_back(std::numeric_limits<int64_t>::max());
+
+  checkRoundTrip(
+      values32,
+      [](const int32_t* in, size_t n, uint8_t* out) {
+        return streamVByteEncodeZigZag(in, n, out);
+      },
+      [](ByteRange in, size_t n, int32_t* out) {
+        return streamVByteDecodeZigZag(in, n, out);
+      });
+  checkRoundTrip(
+      values64,
+      [](const int64_t* in, size_t n, uint8_t* out) {
+        return streamVByteEncodeZigZag(in, n, out);
+      },
+      [](ByteRange in, size_t n, int64_t* out) {
+        return streamVByteDecodeZigZag(in, n, out);
+      });
+
+  // Small magnitudes take one byte.
+  int32_t small[] = {-1, 1, -64, 63};
+  uint8_t buf[streamVByteMaxEncodedSize<int32_t>(4)];
+  EXPECT_EQ(5, streamVByteEncodeZigZag(small, 4, buf));
+}
+
+TEST(StreamVByte, Truncated) {
+  auto values = makeValues<uint32_t>(100, 4);
+  std::vector<uint8_t> buf(streamVByteMaxEncodedSize<uint32_t>(100));
+  auto size = streamVByteEncode(values.data(), 100, buf.data());
+  std::vector<uint32_t> decoded(100);
+  for (size_t cut : {size_t(0), size_t(10), size - 1}) {
+    std::vector<uint8_t> exact(buf.begin(), buf.begin() + cut);
+    EXPECT_THROW(
+        streamVByteDecode(ByteRange(exact.data(), cut), 100, decoded.data()),
+        std::out_of_range);
+  }
+}
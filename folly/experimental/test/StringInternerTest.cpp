@@ -0,0 +1,114 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/StringInterner.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using folly::StringInterner;
+using folly::StringPiece;
+
+TEST(StringInterner, sanity) {
+  StringInterner interner;
+  EXPECT_EQ(0, interner.size());
+  EXPECT_EQ(StringInterner::kNotFound, interner.find("foo"));
+
+  std::string foo("foo");
+  auto h = interner.intern(foo);
+  EXPECT_EQ(0, h);
+  EXPECT_EQ(1, interner.size());
+  EXPECT_EQ("foo", interner.lookup(h));
+  EXPECT_NE(foo.data(), interner.lookup(h).data());
+  EXPECT_EQ(h, interner.intern("foo"));
+  EXPECT_EQ(h, interner.find("foo"));
+
+  EXPECT_EQ(1, interner.intern("bar"));
+  EXPECT_EQ(2, interner.intern(""));
+  EXPECT_EQ("", interner.lookup(2));
+  EXPECT_EQ(2, interner.find(""));
+  EXPECT_EQ(0, interner.find("foo"));
+  EXPECT_EQ(3, interner.size());
+
+  auto piece = interner.internPiece("foo");
+  EXPECT_EQ(interner.lookup(h).data(), piece.data());
+  EXPECT_EQ(3, interner.size());
+}
+
+TEST(StringInterner, grow) {
+  StringInterner interner(1);
+  const uint32_t n = 100000;
+  std::vector<StringPiece> pieces;
+  for (uint32_t i = 0; i < n; ++i) {
+    EXPECT_EQ(i, interner.intern(folly::to<std::string>("key", i)));
+    pieces.push_back(interner.lookup(i));
+  }
+  EXPECT_EQ(n, interner.size());
+  for (uint32_t i = 0; i < n; ++i) {
+    auto key = folly::to<std::string>("key", i);
+    EXPECT_EQ(i, interner.find(key));
+    EXPECT_EQ(i, interner.intern(key));
+    EXPECT_EQ(key, interner.lookup(i));
+    // Interned strings never move
+    EXPECT_EQ(pieces[i].data(), interner.lookup(i).data());
+  }
+  EXPECT_EQ(StringInterner::kNotFound, interner.find("key"));
+}
+
+TEST(StringInterner, concurrent) {
+  StringInterner interner;
+  const size_t numThreads = 8;
+  const size_t numKeys = 20000;
+  std::vector<std::vector<uint32_t>> handles(numThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      // Each thread interns all keys, in a different order
+      handles[t].resize(numKeys);
+      for (size_t j = 0; j < numKeys; ++j) {
+        size_t i = (j * 7919 + t * 1009) % numKeys;
+        auto key = folly::to<std::string>("metric.", i);
+        auto h = interner.intern(key);
+        ASSERT_EQ(key, interner.lookup(h));
+        handles[t][i] = h;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(numKeys, interner.size());
+  for (size_t i = 0; i < numKeys; ++i) {
+    for (size_t t = 1; t < numThreads; ++t) {
+      EXPECT_EQ(handles[0][i], handles[t][i]);
+    }
+    EXPECT_EQ(folly::to<std::string>("metric.", i),
+              interner.lookup(handles[0][i]));
+  }
+}
+
+TEST(StringInterner, defaultInterner) {
+  auto& interner = StringInterner::defaultInterner();
+  EXPECT_EQ(&interner, &StringInterner::defaultInterner());
+  auto piece = interner.internPiece("StringInterner.defaultInterner");
+  EXPECT_EQ(piece.data(),
+            interner.internPiece("StringInterner.defaultInterner").data());
+}
@@ -507,6 +507,27 @@ TEST(StringKeyedMapTest, constructors) {
   EXPECT_EQ(map4.at("key1"), 1);
 }
 
+TEST(StringKeyed, interning) {
+  folly::StringInterner interner;
+  using Alloc = folly::InterningAllocator<std::pair<const StringPiece, int>>;
+  StringKeyedUnorderedMap<int, folly::Hash, std::equal_to<StringPiece>, Alloc>
+      map1(0, folly::Hash(), std::equal_to<StringPiece>(), Alloc(interner));
+  StringKeyedMap<int, std::less<StringPiece>, Alloc> map2{Alloc(interner)};
+
+  string key("key");
+  map1[key] = 1;
+  map2[key] = 2;
+  EXPECT_EQ(1, interner.size());
+  EXPECT_NE(key.data(), map1.begin()->first.data());
+  EXPECT_EQ(map1.begin()->first.data(), map2.begin()->first.data());
+  EXPECT_EQ(interner.internPiece(key).data(), map1.begin()->first.data());
+
+  map1.erase(key);
+  EXPECT_EQ(0, map1.size());
+  EXPECT_EQ("key", map2.begin()->first);
+  EXPECT_EQ(2, map2.at("key"));
+}
+
 int main(int argc, char **argv) {
   FLAGS_logtostderr = true;
   google::InitGoogleLogging(argv[0]);
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <mutex>
+
+#include <glog/logging.h>
+
+namespace folly {
+namespace fibers {
+
+template <typename T>
+template <typename Waiter>
+void Channel<T>::WaitList<Waiter>::push(Waiter& waiter) {
+  if (tail) {
+    tail->next = &waiter;
+  } else {
+    head = &waiter;
+  }
+  tail = &waiter;
+}
+
+template <typename T>
+template <typename Waiter>
+Waiter& Channel<T>::WaitList<Waiter>::pop() {
+  auto& waiter = *head;
+  head = waiter.next;
+  if (!head) {
+    tail = nullptr;
+  }
+  return waiter;
+}
+
+template <typename T>
+Channel<T>::~Channel() {
+  DCHECK(receivers_.empty());
+  DCHECK(senders_.empty());
+}
+
+template <typename T>
+void Channel<T>::wake(Wakeups& wakeups) {
+  for (auto baton : wakeups) {
+    baton->post();
+  }
+  wakeups.clear();
+}
+
+template <typename T>
+bool Channel<T>::hasSpaceLocked() const {
+  return capacity_ == 0 || buffer_.size() < capacity_;
+}
+
+template <typename T>
+bool Channel<T>::trySendLocked(T& value, Wakeups& wakeups) {
+  if (!receivers_.empty()) {
+    // A waiting receiver means the buffer is empty: hand the value over.
+    auto& receiver = receivers_.pop();
+    receiver.value = std::move(value);
+    wakeups.push_back(&receiver.baton);
+    return true;
+  }
+  if (!hasSpaceLocked()) {
+    return false;
+  }
+  buffer_.push_back(std::move(value));
+  return true;
+}
+
+template <typename T>
+Optional<T> Channel<T>::tryRecvLocked(Wakeups& wakeups) {
+  if (buffer_.empty()) {
+    return none;
+  }
+  Optional<T> value(std::move(buffer_.front()));
+  buffer_.pop_front();
+  if (!senders_.empty()) {
+    auto& sender = senders_.pop();
+    buffer_.push_back(std::move(*sender.value));
+    sender.accepted = true;
+    wakeups.push_back(&sender.baton);
+  }
+  return value;
+}
+
+template <typename T>
+bool Channel<T>::send(T value) {
+  Wakeups wakeups;
+  SendWaiter waiter;
+  {
+    std::unique_lock<folly::SpinLock> lg(lock_);
+    if (closed_) {
+      return false;
+    }
+    if (trySendLocked(value, wakeups)) {
+      lg.unlock();
+      wake(wakeups);
+      return true;
+    }
+    waiter.value = &value;
+    senders_.push(waiter);
+  }
+  waiter.baton.wait();
+  return waiter.accepted;
+}
+
+template <typename T>
+bool Channel<T>::trySend(T& value) {
+  Wakeups wakeups;
+  {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    if (closed_ || !trySendLocked(value, wakeups)) {
+      return false;
+    }
+  }
+  wake(wakeups);
+  return true;
+}
+
+template <typename T>
+size_t Channel<T>::sendBatch(std::vector<T>& values) {
+  Wakeups wakeups;
+  size_t sent = 0;
+  while (sent < values.size()) {
+    SendWaiter waiter;
+    {
+      std::lock_guard<folly::SpinLock> lg(lock_);
+      if (closed_) {
+        break;
+      }
+      while (sent < values.size() && trySendLocked(values[sent], wakeups)) {
+        ++sent;
+      }
+      if (sent < values.size()) {
+        waiter.value = &values[sent];
+        senders_.push(waiter);
+      }
+    }
+    wake(wakeups);
+    if (waiter.value) {
+      waiter.baton.wait();
+      if (!waiter.accepted) {
+        break;
+      }
+      ++sent;
+    }
+  }
+  wake(wakeups);
+  return sent;
+}
+
+template <typename T>
+Optional<T> Channel<T>::recv() {
+  Wakeups wakeups;
+  RecvWaiter waiter;
+  {
+    std::unique_lock<folly::SpinLock> lg(lock_);
+    if (auto value = tryRecvLocked(wakeups)) {
+      lg.unlock();
+      wake(wakeups);
+      return value;
+    }
+    if (closed_) {
+      return none;
+    }
+    receivers_.push(waiter);
+  }
+  waiter.baton.wait();
+  return std::move(waiter.value);
+}
+
+template <typename T>
+Optional<T> Channel<T>::tryRecv() {
+  Wakeups wakeups;
+  Optional<T> value;
+  {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    value = tryRecvLocked(wakeups);
+  }
+  wake(wakeups);
+  return value;
+}
+
+template <typename T>
+size_t Channel<T>::recvBatch(std::vector<T>& out, size_t maxValues) {
+  if (maxValues == 0) {
+    return 0;
+  }
+  Wakeups wakeups;
+  RecvWaiter waiter;
+  size_t received = 0;
+  {
+    std::unique_lock<folly::SpinLock> lg(lock_);
+    while (received < maxValues) {
+      auto value = tryRecvLocked(wakeups);
+      if (!value) {
+        break;
+      }
+      out.push_back(std::move(*value));
+      ++received;
+    }
+    if (received > 0 || closed_) {
+      lg.unlock();
+      wake(wakeups);
+      return received;
+    }
+    receivers_.push(waiter);
+  }
+  waiter.baton.wait();
+  if (!waiter.value) {
+    return 0;
+  }
+  out.push_back(std::move(*waiter.value));
+  return 1;
+}
+
+template <typename T>
+void Channel<T>::close() {
+  Wakeups wakeups;
+  {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    while (!receivers_.empty()) {
+      wakeups.push_back(&receivers_.pop().baton);
+    }
+    while (!senders_.empty()) {
+      wakeups.push_back(&senders_.pop().baton);
+    }
+  }
+  wake(wakeups);
+}
+
+template <typename T>
+bool Channel<T>::isClosed() const {
+  std::lock_guard<folly::SpinLock> lg(lock_);
+  return closed_;
+}
+
+template <typename T>
+size_t Channel<T>::size() const {
+  std::lock_guard<folly::SpinLock> lg(lock_);
+  return buffer_.size();
+}
+
+} // namespace fibers
+} // namespace folly
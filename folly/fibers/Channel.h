@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/SpinLock.h>
+#include <folly/small_vector.h>
+#include <folly/fibers/Baton.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * @class Channel
+ *
+ * Fiber-compatible multi-producer multi-consumer FIFO channel.
+ *
+ * send() suspends the calling fiber while a bounded channel is full, and
+ * recv() suspends it while the channel is empty; neither blocks the thread
+ * when called from a fiber. Both may also be called from outside of any
+ * fiber, in which case they block the thread. Waiters are woken with a Baton,
+ * so a fiber always resumes on its own FiberManager, whichever thread the
+ * peer ran on.
+ *
+ * Values are handed directly to a waiting receiver, and a receiver that frees
+ * up space takes the value of the oldest waiting sender, so a woken waiter
+ * never has to retry. Waiters are woken after the channel lock is released,
+ * all at once when one call wakes several (see recvBatch() and sendBatch()).
+ *
+ * close() wakes all waiters. Afterwards send() fails and recv() drains the
+ * values still buffered, then returns none.
+ */
+template <typename T>
+class Channel {
+ public:
+  /**
+   * @param capacity Number of values that may be buffered before send()
+   *                 suspends; 0 means unbounded.
+   */
+  explicit Channel(size_t capacity = 0) : capacity_(capacity) {}
+
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+
+  ~Channel();
+
+  /**
+   * Sends value, waiting for space if the channel is bounded and full.
+   *
+   * @return false if the channel is (or got) closed, in which case value is
+   *         dropped.
+   */
+  bool send(T value);
+
+  /**
+   * Sends value if it can be done without waiting. value is only moved from
+   * if this returns true.
+   */
+  bool trySend(T& value);
+
+  /**
+   * Sends all values in order, waiting for space as needed. Wakes up to
+   * values.size() receivers at once.
+   *
+   * @return number of values sent; less than values.size() only if the
+   *         channel got closed. Sent values are moved from.
+   */
+  size_t sendBatch(std::vector<T>& values);
+
+  /**
+   * Receives the oldest value, waiting for one if the channel is empty.
+   *
+   * @return none once the channel is closed and empty.
+   */
+  Optional<T> recv();
+
+  /**
+   * Receives the oldest value if there is one, without waiting.
+   */
+  Optional<T> tryRecv();
+
+  /**
+   * Waits until at least one value is available (unless the channel is
+   * closed), then appends up to maxValues values to out, waking up to as many
+   * waiting senders at once.
+   *
+   * @return number of values received, 0 only once the channel is closed and
+   *         empty.
+   */
+  size_t recvBatch(std::vector<T>& out, size_t maxValues);
+
+  /**
+   * Closes the channel, waking all waiting senders and receivers.
+   */
+  void close();
+
+  bool isClosed() const;
+
+  /**
+   * @return number of buffered values.
+   */
+  size_t size() const;
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  struct RecvWaiter {
+    Baton baton;
+    Optional<T> value;
+    RecvWaiter* next{nullptr};
+  };
+
+  struct SendWaiter {
+    Baton baton;
+    T* value{nullptr};
+    bool accepted{false};
+    SendWaiter* next{nullptr};
+  };
+
+  template <typename Waiter>
+  struct WaitList {
+    Waiter* head{nullptr};
+    Waiter* tail{nullptr};
+
+    bool empty() const {
+      return head == nullptr;
+    }
+    void push(Waiter& waiter);
+    Waiter& pop();
+  };
+
+  // Batons to post once the lock is released.
+  using Wakeups = folly::small_vector<Baton*, 1>;
+
+  static void wake(Wakeups& wakeups);
+
+  bool hasSpaceLocked() const;
+  // Hands value to a waiting receiver or buffers it. Returns false if there
+  // is no space.
+  bool trySendLocked(T& value, Wakeups& wakeups);
+  // Takes the oldest buffered value, letting a waiting sender in.
+  Optional<T> tryRecvLocked(Wakeups& wakeups);
+
+  const size_t capacity_;
+  mutable folly::SpinLock lock_;
+  std::deque<T> buffer_;
+  WaitList<RecvWaiter> receivers_;
+  WaitList<SendWaiter> senders_;
+  bool closed_{false};
+};
+
+} // namespace fibers
+} // namespace folly
+
+#include <folly/fibers/Channel-inl.h>
@@ -67,9 +67,9 @@ void Fiber::resume() {
   }
 }
 
-Fiber::Fiber(FiberManager& fiberManager)
+Fiber::Fiber(FiberManager& fiberManager, size_t stackSize)
     : fiberManager_(fiberManager),
-      fiberStackSize_(fiberManager_.options_.stackSize),
+      fiberStackSize_(stackSize),
       fiberStackLimit_(fiberManager_.stackAllocator_.allocate(fiberStackSize_)),
       fiberImpl_([this] { fiberFunc(); }, fiberStackLimit_, fiberStackSize_) {
   fiberManager_.allFibers_.push_back(*this);
@@ -149,14 +149,11 @@ void Fiber::recordStackPosition() {
     }
 
     if (UNLIKELY(recordStackUsed_)) {
-      fiberManager_.stackHighWatermark_ = std::max(
-          fiberManager_.stackHighWatermark_,
-          nonMagicInBytes(fiberStackLimit_, fiberStackSize_));
+      auto stackUsed = nonMagicInBytes(fiberStackLimit_, fiberStackSize_);
+      fiberManager_.stackHighWatermark_ =
+          std::max(fiberManager_.stackHighWatermark_, stackUsed);
       VLOG(3) << "Max stack usage: " << fiberManager_.stackHighWatermark_;
-      CHECK(
-          fiberManager_.stackHighWatermark_ <
-          fiberManager_.options_.stackSize - 64)
-          << "Fiber stack overflow";
+      CHECK(stackUsed < fiberStackSize_ - 64) << "Fiber stack overflow";
     }
 
     state_ = INVALID;
@@ -21,6 +21,7 @@
 
 #include <folly/AtomicIntrusiveLinkedList.h>
 #include <folly/CPortability.h>
+#include <folly/CancellationToken.h>
 #include <folly/Function.h>
 #include <folly/IntrusiveList.h>
 #include <folly/Portability.h>
@@ -80,7 +81,7 @@ class Fiber {
   friend class Baton;
   friend class FiberManager;
 
-  explicit Fiber(FiberManager& fiberManager);
+  Fiber(FiberManager& fiberManager, size_t stackSize);
 
   void init(bool recordStackUsed);
 
@@ -111,9 +112,11 @@ class Fiber {
   unsigned char* fiberStackLimit_;
   FiberImpl fiberImpl_; /**< underlying fiber implementation */
   std::shared_ptr<RequestContext> rcontext_; /**< current RequestContext */
+  CancellationToken cancellationToken_; /**< token the task runs under */
   folly::Function<void()> func_; /**< task function */
   bool recordStackUsed_{false};
   bool stackFilledWithMagic_{false};
+  bool stackTailReleased_{false}; /**< stack trimmed while in the pool */
 
   /**
    * Points to next fiber in remote ready list
@@ -17,6 +17,7 @@
 
 #include <signal.h>
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -24,6 +25,7 @@
 
 #include <folly/fibers/Fiber.h>
 #include <folly/fibers/LoopController.h>
+#include <folly/fibers/WorkStealingGroup.h>
 
 #include <folly/ConstexprMath.h>
 #include <folly/SingletonThreadLocal.h>
@@ -68,6 +70,26 @@ static AsanUnpoisonMemoryRegionFuncPtr getUnpoisonMemoryRegionFunc();
 namespace folly {
 namespace fibers {
 
+namespace {
+
+/**
+ * With Options::adaptiveStackSize, new stacks get this many times the stack
+ * high watermark...
+ */
+constexpr size_t kAdaptiveStackFactor = 2;
+
+/**
+ * ...but never less than this.
+ */
+constexpr size_t kMinAdaptiveStackSize = 8 * 1024;
+
+size_t pagesize() {
+  static const size_t pagesize = size_t(sysconf(_SC_PAGESIZE));
+  return pagesize;
+}
+
+} // namespace
+
 FOLLY_TLS FiberManager* FiberManager::currentFiberManager_ = nullptr;
 
 FiberManager::FiberManager(
@@ -79,10 +101,17 @@ FiberManager::FiberManager(
           std::move(options)) {}
 
 FiberManager::~FiberManager() {
+  // Waits for the callback if the thread is running it right now
+  idleCallback_.reset();
+
   if (isLoopScheduled_) {
     loopController_->cancel();
   }
 
+  if (workStealingGroup_) {
+    workStealingGroup_->remove(*this);
+  }
+
   while (!fibersPool_.empty()) {
     fibersPool_.pop_front_and_dispose([](Fiber* fiber) { delete fiber; });
   }
@@ -100,7 +129,63 @@ const LoopController& FiberManager::loopController() const {
 
 bool FiberManager::hasTasks() const {
   return fibersActive_ > 0 || !remoteReadyQueue_.empty() ||
-      !remoteTaskQueue_.empty();
+      !remoteTaskQueue_.empty() || numStealableTasks_.load() > 0;
+}
+
+void FiberManager::joinWorkStealingGroup(
+    std::shared_ptr<WorkStealingGroup> group) {
+  CHECK(!workStealingGroup_) << "Already in a WorkStealingGroup";
+  workStealingGroup_ = std::move(group);
+  workStealingGroup_->add(*this);
+}
+
+void FiberManager::addStealableTask(std::unique_ptr<RemoteTask> task) {
+  size_t backlog;
+  {
+    std::lock_guard<folly::SpinLock> lg(stealableTasksLock_);
+    stealableTasks_.push_back(std::move(task));
+    backlog = numStealableTasks_.fetch_add(1);
+  }
+  workStealingGroup_->markBusy(*this);
+  ensureLoopScheduled();
+  if (backlog > 0) {
+    // More queued than we are about to start: let an idle member help.
+    workStealingGroup_->shareBacklog(*this);
+  }
+}
+
+std::unique_ptr<FiberManager::RemoteTask> FiberManager::popStealableTask(
+    bool fromFront) {
+  if (numStealableTasks_.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<folly::SpinLock> lg(stealableTasksLock_);
+  if (stealableTasks_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<RemoteTask> task;
+  if (fromFront) {
+    task = std::move(stealableTasks_.front());
+    stealableTasks_.pop_front();
+  } else {
+    task = std::move(stealableTasks_.back());
+    stealableTasks_.pop_back();
+  }
+  numStealableTasks_.fetch_sub(1);
+  return task;
+}
+
+bool FiberManager::runStealableTask() {
+  auto task = popStealableTask(true);
+  if (!task) {
+    task = workStealingGroup_->steal(*this);
+  }
+  if (!task) {
+    workStealingGroup_->markIdle(*this);
+    return false;
+  }
+  runRemoteTask(std::move(task));
+  return true;
 }
 
 Fiber* FiberManager::getFiber() {
@@ -111,14 +196,25 @@ Fiber* FiberManager::getFiber() {
     fibersPoolResizerScheduled_ = true;
   }
 
-  if (fibersPool_.empty()) {
-    fiber = new Fiber(*this);
-    ++fibersAllocated_;
-  } else {
+  if (!fibersPool_.empty()) {
     fiber = &fibersPool_.front();
     fibersPool_.pop_front();
     assert(fibersPoolSize_ > 0);
     --fibersPoolSize_;
+    fiber->stackTailReleased_ = false;
+
+    if (UNLIKELY(
+            options_.adaptiveStackSize &&
+            fiber->fiberStackSize_ < newFiberStackSize())) {
+      // Allocated before the watermark grew past its stack.
+      delete fiber;
+      fiber = nullptr;
+      --fibersAllocated_;
+    }
+  }
+  if (!fiber) {
+    fiber = new Fiber(*this, newFiberStackSize());
+    ++fibersAllocated_;
   }
   assert(fiber);
   if (++fibersActive_ > maxFibersActiveLastPeriod_) {
@@ -148,6 +244,17 @@ size_t FiberManager::stackHighWatermark() const {
   return stackHighWatermark_;
 }
 
+size_t FiberManager::newFiberStackSize() const {
+  if (!options_.adaptiveStackSize || options_.recordStackEvery == 0 ||
+      stackHighWatermark_ == 0) {
+    return options_.stackSize;
+  }
+  auto size = std::max(
+      kMinAdaptiveStackSize, stackHighWatermark_ * kAdaptiveStackFactor);
+  size = (size + pagesize() - 1) / pagesize() * pagesize();
+  return std::min(size, options_.stackSize);
+}
+
 void FiberManager::remoteReadyInsert(Fiber* fiber) {
   if (observer_) {
     observer_->runnable(reinterpret_cast<uintptr_t>(fiber));
@@ -180,6 +287,49 @@ void FiberManager::doFibersPoolResizing() {
   }
 
   maxFibersActiveLastPeriod_ = fibersActive_;
+
+  if (options_.idleStackRetainBytes > 0) {
+    // Fibers still in the pool now have been idle for a whole period.
+    releasePooledStacks(options_.idleStackRetainBytes);
+  }
+}
+
+size_t FiberManager::releasePooledStacks(size_t retain) {
+  size_t released = 0;
+  for (auto& fiber : fibersPool_) {
+    if (fiber.stackTailReleased_) {
+      continue;
+    }
+    size_t bytes = 0;
+    if (!stackAllocator_.releaseStackTail(
+            fiber.fiberStackLimit_,
+            fiber.fiberStackSize_,
+            retain,
+            &bytes)) {
+      continue;
+    }
+    fiber.stackTailReleased_ = true;
+    // Released pages read back as zeroes, not as the magic pattern.
+    fiber.stackFilledWithMagic_ = false;
+    released += bytes;
+  }
+  return released;
+}
+
+void FiberManager::registerIdleCallback() {
+  idleCallbackRegistered_ = true;
+  idleCallback_ = folly::detail::MemoryIdler::addIdleCallback([this] {
+    // A thread blocking in the main context of a fiber isn't idle as far
+    // as its FiberManager goes, which may be about to use the pool.
+    if (getFiberManagerUnsafe() != nullptr) {
+      return size_t(0);
+    }
+    // Pooled fibers are suspended with their frames at the top of their
+    // stacks, which must survive.
+    return releasePooledStacks(std::max(
+        options_.idleStackRetainBytes,
+        size_t(folly::detail::MemoryIdler::kDefaultStackToRetain)));
+  });
 }
 
 void FiberManager::FibersPoolResizer::operator()() {
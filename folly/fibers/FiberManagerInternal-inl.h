@@ -164,6 +164,7 @@ inline void FiberManager::runReadyFiber(Fiber* fiber) {
     fiber->rcontext_ = RequestContext::setContext(std::move(fiber->rcontext_));
     fiber->localData_.reset();
     fiber->rcontext_.reset();
+    fiber->cancellationToken_ = CancellationToken();
 
     if (fibersPoolSize_ < options_.maxFibersPoolSize ||
         options_.fibersPoolResizePeriodMs > 0) {
@@ -195,6 +196,9 @@ inline void FiberManager::loopUntilNoReadyImpl() {
     registerAlternateSignalStack();
   }
 #endif
+  if (UNLIKELY(options_.releaseStacksWhenIdle && !idleCallbackRegistered_)) {
+    registerIdleCallback();
+  }
 
   // Support nested FiberManagers
   auto originalFiberManager = this;
@@ -202,7 +206,7 @@ inline void FiberManager::loopUntilNoReadyImpl() {
 
   SCOPE_EXIT {
     isLoopScheduled_ = false;
-    if (!readyFibers_.empty()) {
+    if (!readyFibers_.empty() || numStealableTasks_.load() > 0) {
       ensureLoopScheduled();
     }
     std::swap(currentFiberManager_, originalFiberManager);
@@ -225,20 +229,15 @@ inline void FiberManager::loopUntilNoReadyImpl() {
     });
 
     remoteTaskQueue_.sweep([this, &hadRemoteFiber](RemoteTask* taskPtr) {
-      std::unique_ptr<RemoteTask> task(taskPtr);
-      auto fiber = getFiber();
-      if (task->localData) {
-        fiber->localData_ = *task->localData;
-      }
-      fiber->rcontext_ = std::move(task->rcontext);
-
-      fiber->setFunction(std::move(task->func));
-      if (observer_) {
-        observer_->runnable(reinterpret_cast<uintptr_t>(fiber));
-      }
-      runReadyFiber(fiber);
+      runRemoteTask(std::unique_ptr<RemoteTask>(taskPtr));
       hadRemoteFiber = true;
     });
+
+    if (UNLIKELY(workStealingGroup_ != nullptr) && readyFibers_.empty()) {
+      // Start queued tasks one at a time, so that whatever we don't get to
+      // is left for idle members of the group.
+      hadRemoteFiber |= runStealableTask();
+    }
   }
 
   if (observer_) {
@@ -249,6 +248,24 @@ inline void FiberManager::loopUntilNoReadyImpl() {
   readyFibers_.splice(readyFibers_.end(), yieldedFibers_);
 }
 
+inline void FiberManager::runRemoteTask(std::unique_ptr<RemoteTask> task) {
+  if (task->cancellationToken.isCancellationRequested()) {
+    return;
+  }
+  auto fiber = getFiber();
+  if (task->localData) {
+    fiber->localData_ = *task->localData;
+  }
+  fiber->rcontext_ = std::move(task->rcontext);
+  fiber->cancellationToken_ = std::move(task->cancellationToken);
+
+  fiber->setFunction(std::move(task->func));
+  if (observer_) {
+    observer_->runnable(reinterpret_cast<uintptr_t>(fiber));
+  }
+  runReadyFiber(fiber);
+}
+
 // We need this to be in a struct, not inlined in addTask, because clang crashes
 // otherwise.
 template <typename F>
@@ -264,7 +281,9 @@ struct FiberManager::AddTaskHelper {
 
     void operator()() {
       try {
-        func_();
+        if (!fm_.getCancellationToken().isCancellationRequested()) {
+          func_();
+        }
       } catch (...) {
         fm_.exceptionCallback_(
             std::current_exception(), "running Func functor");
@@ -284,10 +303,32 @@ struct FiberManager::AddTaskHelper {
 
 template <typename F>
 void FiberManager::addTask(F&& func) {
-  typedef AddTaskHelper<F> Helper;
+  if (UNLIKELY(workStealingGroup_ != nullptr)) {
+    addStealableTask(makeRemoteTask(std::forward<F>(func)));
+    return;
+  }
+  auto fiber = getFiber();
+  initLocalData(*fiber);
+  scheduleTask(fiber, std::forward<F>(func));
+}
 
+template <typename F>
+void FiberManager::addTask(F&& func, CancellationToken token) {
+  if (UNLIKELY(workStealingGroup_ != nullptr)) {
+    auto task = makeRemoteTask(std::forward<F>(func));
+    task->cancellationToken = std::move(token);
+    addStealableTask(std::move(task));
+    return;
+  }
   auto fiber = getFiber();
   initLocalData(*fiber);
+  fiber->cancellationToken_ = std::move(token);
+  scheduleTask(fiber, std::forward<F>(func));
+}
+
+template <typename F>
+void FiberManager::scheduleTask(Fiber* fiber, F&& func) {
+  typedef AddTaskHelper<F> Helper;
 
   if (Helper::allocateInBuffer) {
     auto funcLoc = static_cast<typename Helper::Func*>(fiber->getUserBuffer());
@@ -309,16 +350,36 @@ void FiberManager::addTask(F&& func) {
 }
 
 template <typename F>
-void FiberManager::addTaskRemote(F&& func) {
-  auto task = [&]() {
-    auto currentFm = getFiberManagerUnsafe();
-    if (currentFm && currentFm->currentFiber_ &&
-        currentFm->localType_ == localType_) {
-      return std::make_unique<RemoteTask>(
+std::unique_ptr<FiberManager::RemoteTask> FiberManager::makeRemoteTask(
+    F&& func) {
+  auto currentFm = getFiberManagerUnsafe();
+  if (currentFm && currentFm->currentFiber_) {
+    std::unique_ptr<RemoteTask> task;
+    if (currentFm->localType_ == localType_) {
+      task = std::make_unique<RemoteTask>(
           std::forward<F>(func), currentFm->currentFiber_->localData_);
+    } else {
+      task = std::make_unique<RemoteTask>(std::forward<F>(func));
     }
-    return std::make_unique<RemoteTask>(std::forward<F>(func));
-  }();
+    task->cancellationToken = currentFm->currentFiber_->cancellationToken_;
+    return task;
+  }
+  return std::make_unique<RemoteTask>(std::forward<F>(func));
+}
+
+template <typename F>
+void FiberManager::addTaskRemote(F&& func) {
+  auto task = makeRemoteTask(std::forward<F>(func));
+  auto insertHead = [&]() {
+    return remoteTaskQueue_.insertHead(task.release());
+  };
+  loopController_->scheduleThreadSafe(std::ref(insertHead));
+}
+
+template <typename F>
+void FiberManager::addTaskRemote(F&& func, CancellationToken token) {
+  auto task = makeRemoteTask(std::forward<F>(func));
+  task->cancellationToken = std::move(token);
   auto insertHead = [&]() {
     return remoteTaskQueue_.insertHead(task.release());
   };
@@ -502,19 +563,27 @@ T& FiberManager::localThread() {
 
 inline void FiberManager::initLocalData(Fiber& fiber) {
   auto fm = getFiberManagerUnsafe();
-  if (fm && fm->currentFiber_ && fm->localType_ == localType_) {
-    fiber.localData_ = fm->currentFiber_->localData_;
+  if (fm && fm->currentFiber_) {
+    if (fm->localType_ == localType_) {
+      fiber.localData_ = fm->currentFiber_->localData_;
+    }
+    fiber.cancellationToken_ = fm->currentFiber_->cancellationToken_;
   }
   fiber.rcontext_ = RequestContext::saveContext();
 }
 
+inline const CancellationToken& FiberManager::getCancellationToken() const {
+  static const CancellationToken kNone;
+  return currentFiber_ ? currentFiber_->cancellationToken_ : kNone;
+}
+
 template <typename LocalT>
 FiberManager::FiberManager(
     LocalType<LocalT>,
     std::unique_ptr<LoopController> loopController__,
     Options options)
     : loopController_(std::move(loopController__)),
-      stackAllocator_(options.useGuardPages),
+      stackAllocator_(options.useGuardPages, options.useSharedStackPool),
       options_(preprocessOptions(std::move(options))),
       exceptionCallback_([](std::exception_ptr eptr, std::string context) {
         try {
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <deque>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -26,10 +27,13 @@
 
 #include <folly/AtomicIntrusiveLinkedList.h>
 #include <folly/CPortability.h>
+#include <folly/CancellationToken.h>
 #include <folly/Executor.h>
 #include <folly/IntrusiveList.h>
 #include <folly/Likely.h>
+#include <folly/SpinLock.h>
 #include <folly/Try.h>
+#include <folly/detail/MemoryIdler.h>
 #include <folly/io/async/Request.h>
 
 #include <folly/experimental/ExecutionObserver.h>
@@ -50,6 +54,7 @@ class Baton;
 class Fiber;
 class LoopController;
 class TimeoutController;
+class WorkStealingGroup;
 
 template <typename T>
 class LocalType {};
@@ -113,6 +118,44 @@ class FiberManager : public ::folly::Executor {
      */
     uint32_t fibersPoolResizePeriodMs{0};
 
+    /**
+     * Take stacks that aren't protected by guard pages from a process-wide
+     * pool shared by all FiberManagers, and give them back to it (with their
+     * memory released to the OS) when fibers are freed, instead of using
+     * the heap.
+     */
+    bool useSharedStackPool{false};
+
+    /**
+     * On every fibers pool resize (see fibersPoolResizePeriodMs), release
+     * to the OS the stack memory of fibers that sit unused in the pool,
+     * except for the top idleStackRetainBytes of each stack.
+     * Only applies to stacks protected by guard pages or taken from the
+     * shared stack pool. 0 disables.
+     */
+    size_t idleStackRetainBytes{0};
+
+    /**
+     * Also release that stack memory, whatever idleStackRetainBytes is (at
+     * least MemoryIdler::kDefaultStackToRetain is then kept), when the
+     * thread running this FiberManager goes idle: see
+     * MemoryIdler::releaseIdleMemory().  The thread is the one that first
+     * runs the loop.
+     */
+    bool releaseStacksWhenIdle{false};
+
+    /**
+     * Size the stacks of newly allocated fibers after the stack high
+     * watermark sampled with recordStackEvery, with a safety factor, instead
+     * of always using stackSize (which remains the upper bound). Has no
+     * effect unless recordStackEvery is set.
+     *
+     * Only sampled fibers are checked for overflow, so this should be used
+     * together with guard pages and a task mix whose sampled stack usage is
+     * representative.
+     */
+    bool adaptiveStackSize{false};
+
     constexpr Options() {}
   };
 
@@ -186,6 +229,21 @@ class FiberManager : public ::folly::Executor {
   template <typename F>
   void addTask(F&& func);
 
+  /**
+   * Add a new task to be executed under the given cancellation token. Must be
+   * called from FiberManager's thread.
+   *
+   * If cancellation has been requested by the time the fiber would start,
+   * func is destroyed without being run. Once running, the task can observe
+   * the token through getCancellationToken(), and tasks it adds inherit it.
+   *
+   * @param func Task functor; must have a signature of `void func()`.
+   *             The object will be destroyed once task execution is complete.
+   * @param token Token that replaces the one inherited from the current fiber.
+   */
+  template <typename F>
+  void addTask(F&& func, CancellationToken token);
+
   /**
    * Add a new task to be executed and return a future that will be set on
    * return from func. Must be called from FiberManager's thread.
@@ -205,6 +263,21 @@ class FiberManager : public ::folly::Executor {
   template <typename F>
   void addTaskRemote(F&& func);
 
+  /**
+   * Add a new task to be executed under the given cancellation token. Safe to
+   * call from other threads. See addTask(func, token).
+   */
+  template <typename F>
+  void addTaskRemote(F&& func, CancellationToken token);
+
+  /**
+   * Makes this FiberManager a member of the given WorkStealingGroup. From then
+   * on, tasks added with addTask() may be started by any member of the group
+   * (see WorkStealingGroup for details). Must be called from FiberManager's
+   * thread, at most once. The FiberManager leaves the group when destroyed.
+   */
+  void joinWorkStealingGroup(std::shared_ptr<WorkStealingGroup> group);
+
   /**
    * Add a new task to be executed and return a future that will be set on
    * return from func. Safe to call from other threads.
@@ -272,6 +345,18 @@ class FiberManager : public ::folly::Executor {
    */
   bool hasActiveFiber() const;
 
+  /**
+   * @return The cancellation token of the currently running fiber, or a
+   * token that is never cancelled if no fiber is executing.
+   *
+   * Tasks added with addTask / addTaskRemote / addTaskFinally from a fiber
+   * inherit its token, so cancelling it tears down the whole tree of tasks:
+   * tasks that have not started yet are dropped, and running ones can poll
+   * the token or register a CancellationCallback (e.g. to post a Baton they
+   * are waiting on).
+   */
+  const CancellationToken& getCancellationToken() const;
+
   /**
    * @return The currently running fiber or null if no fiber is executing.
    */
@@ -325,8 +410,11 @@ class FiberManager : public ::folly::Executor {
  private:
   friend class Baton;
   friend class Fiber;
+  friend class WorkStealingGroup;
   template <typename F>
   struct AddTaskHelper;
+  template <typename F>
+  void scheduleTask(Fiber* fiber, F&& func);
   template <typename F, typename G>
   struct AddTaskFinallyHelper;
 
@@ -342,9 +430,13 @@ class FiberManager : public ::folly::Executor {
     folly::Function<void()> func;
     std::unique_ptr<Fiber::LocalData> localData;
     std::shared_ptr<RequestContext> rcontext;
+    CancellationToken cancellationToken;
     AtomicIntrusiveLinkedListHook<RemoteTask> nextRemoteTask;
   };
 
+  template <typename F>
+  std::unique_ptr<RemoteTask> makeRemoteTask(F&& func);
+
   void activateFiber(Fiber* fiber);
   void deactivateFiber(Fiber* fiber);
 
@@ -409,6 +501,11 @@ class FiberManager : public ::folly::Executor {
    */
   Fiber* getFiber();
 
+  /**
+   * @return Stack size for newly allocated fibers.
+   */
+  size_t newFiberStackSize() const;
+
   /**
    * Sets local data for given fiber if all conditions are met.
    */
@@ -442,6 +539,25 @@ class FiberManager : public ::folly::Executor {
   folly::AtomicIntrusiveLinkedList<RemoteTask, &RemoteTask::nextRemoteTask>
       remoteTaskQueue_;
 
+  /**
+   * Work stealing state, see WorkStealingGroup. Tasks added with addTask()
+   * while in a group are queued in stealableTasks_: this FiberManager takes
+   * them from the front, other members of the group steal from the back.
+   */
+  std::shared_ptr<WorkStealingGroup> workStealingGroup_;
+  folly::SpinLock stealableTasksLock_;
+  std::deque<std::unique_ptr<RemoteTask>> stealableTasks_;
+  std::atomic<size_t> numStealableTasks_{0};
+  /**
+   * Set when the loop ran out of work, cleared by a member of the group that
+   * hands us a task.
+   */
+  std::atomic<bool> idleForStealing_{false};
+
+  void addStealableTask(std::unique_ptr<RemoteTask> task);
+  std::unique_ptr<RemoteTask> popStealableTask(bool fromFront);
+  bool runStealableTask();
+
   std::shared_ptr<TimeoutController> timeoutManager_;
 
   struct FibersPoolResizer {
@@ -457,12 +573,22 @@ class FiberManager : public ::folly::Executor {
 
   void doFibersPoolResizing();
 
+  // Releases the stacks of pooled fibers but their top retain bytes, and
+  // returns the number of bytes released
+  size_t releasePooledStacks(size_t retain);
+
+  folly::detail::MemoryIdler::IdleCallback idleCallback_;
+  bool idleCallbackRegistered_{false};
+
+  void registerIdleCallback();
+
   /**
    * Only local of this type will be available for fibers.
    */
   std::type_index localType_;
 
   void runReadyFiber(Fiber* fiber);
+  void runRemoteTask(std::unique_ptr<RemoteTask> task);
   void remoteReadyInsert(Fiber* fiber);
 
 #ifdef FOLLY_SANITIZE_ADDRESS
@@ -559,6 +685,19 @@ typename std::result_of<F()>::type inline runInMainContext(F&& func) {
  * When new task is scheduled via addTask / addTaskRemote from a fiber its
  * fiber-local context is copied into the new fiber.
  */
+/**
+ * @return The cancellation token of the currently running fiber, or a token
+ * that is never cancelled when not called from a fiber.
+ */
+inline const CancellationToken& getCancellationToken() {
+  auto fm = FiberManager::getFiberManagerUnsafe();
+  if (fm) {
+    return fm->getCancellationToken();
+  }
+  static const CancellationToken kNone;
+  return kNone;
+}
+
 template <typename T>
 T& local() {
   auto fm = FiberManager::getFiberManagerUnsafe();
@@ -22,10 +22,13 @@
 
 #include <iostream>
 #include <mutex>
+#include <unordered_map>
 
 #include <folly/Singleton.h>
 #include <folly/SpinLock.h>
 #include <folly/Synchronized.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/detail/MemoryIdler.h>
 #include <folly/portability/SysMman.h>
 #include <folly/portability/Unistd.h>
 
@@ -52,6 +55,44 @@ constexpr size_t kNumGuarded = 100;
  */
 constexpr size_t kMaxInUse = 100;
 
+/**
+ * Number of stacks carved out of each mapping made by the shared stack pool
+ */
+constexpr size_t kStacksPerSlab = 64;
+
+/**
+ * Number of independently locked stripes of the shared stack pool
+ */
+constexpr size_t kNumPoolStripes = 8;
+
+static size_t pagesize() {
+  static const size_t pagesize = size_t(sysconf(_SC_PAGESIZE));
+  return pagesize;
+}
+
+/* Returns size rounded up to a multiple of pagesize() */
+static size_t roundUpToPage(size_t size) {
+  return pagesize() * ((size + pagesize() - 1) / pagesize());
+}
+
+/* Releases the whole pages in [begin, end), keeping the mapping */
+/* Returns the number of bytes released that were resident, where known */
+static size_t releasePages(unsigned char* begin, unsigned char* end) {
+#ifdef __linux__
+  return folly::detail::MemoryIdler::releasePages(begin, size_t(end - begin));
+#else
+  auto mask = ~(uintptr_t(pagesize()) - 1);
+  auto b = reinterpret_cast<unsigned char*>(
+      (reinterpret_cast<uintptr_t>(begin) + pagesize() - 1) & mask);
+  auto e =
+      reinterpret_cast<unsigned char*>(reinterpret_cast<uintptr_t>(end) & mask);
+  if (b < e) {
+    PCHECK(0 == ::madvise(b, size_t(e - b), MADV_DONTNEED));
+  }
+  return 0;
+#endif
+}
+
 /**
  * A cache for kNumGuarded stacks of a given size
  *
@@ -130,6 +171,11 @@ class StackCache {
     return true;
   }
 
+  bool owns(unsigned char* limit, size_t size) const {
+    auto p = limit + size - allocSize(size);
+    return p >= storage_ && p < storage_ + allocSize_ * kNumGuarded;
+  }
+
   ~StackCache() {
     assert(storage_);
     SYNCHRONIZED(pages, protectedPages()) {
@@ -163,14 +209,9 @@ class StackCache {
    */
   std::vector<std::pair<unsigned char*, bool>> freeList_;
 
-  static size_t pagesize() {
-    static const size_t pagesize = size_t(sysconf(_SC_PAGESIZE));
-    return pagesize;
-  }
-
   /* Returns a multiple of pagesize() enough to store size + one guard page */
   static size_t allocSize(size_t size) {
-    return pagesize() * ((size + pagesize() - 1) / pagesize() + 1);
+    return roundUpToPage(size) + pagesize();
   }
 
   static folly::Synchronized<std::unordered_set<intptr_t>>& protectedPages() {
@@ -180,6 +221,92 @@ class StackCache {
   }
 };
 
+/**
+ * Process-wide pool of unguarded stacks, shared by every GuardPageAllocator
+ * created with useSharedStackPool.
+ *
+ * Stacks are carved out of mappings of kStacksPerSlab stacks each, so that
+ * a large number of fibers doesn't translate into a large number of memory
+ * maps. Mappings are never unmapped. A stack given back to the pool has all
+ * of its pages released with MADV_DONTNEED, so idle stacks cost address
+ * space but no memory; since pages are only faulted back in by the next
+ * user, they end up on that user's NUMA node.
+ *
+ * Free lists are striped with AccessSpreader, so threads on nearby CPUs
+ * share a stripe (and lock). Other stripes are only looked at before
+ * mapping a new slab.
+ *
+ * Thread safe.
+ */
+class StackPool {
+ public:
+  static StackPool& instance() {
+    static auto inst = new StackPool();
+    return *inst;
+  }
+
+  unsigned char* allocate(size_t size) {
+    auto as = roundUpToPage(size);
+    auto stripe = AccessSpreader<>::current(kNumPoolStripes);
+
+    for (size_t i = 0; i < kNumPoolStripes; ++i) {
+      if (auto p = stripes_[(stripe + i) % kNumPoolStripes].pop(as)) {
+        return p + as - size;
+      }
+    }
+
+    auto slab = ::mmap(
+        nullptr,
+        as * kStacksPerSlab,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (slab == (void*)(-1)) {
+      return nullptr;
+    }
+    auto storage = reinterpret_cast<unsigned char*>(slab);
+    stripes_[stripe].push(as, storage + as, kStacksPerSlab - 1);
+    return storage + as - size;
+  }
+
+  void deallocate(unsigned char* limit, size_t size) {
+    auto as = roundUpToPage(size);
+    auto p = limit + size - as;
+    releasePages(p, p + as);
+    stripes_[AccessSpreader<>::current(kNumPoolStripes)].push(as, p, 1);
+  }
+
+ private:
+  struct Stripe {
+    folly::SpinLock lock;
+    /* LIFO free lists keyed by page-rounded stack size */
+    std::unordered_map<size_t, std::vector<unsigned char*>> freeLists;
+
+    unsigned char* pop(size_t allocSize) {
+      std::lock_guard<folly::SpinLock> lg(lock);
+      auto it = freeLists.find(allocSize);
+      if (it == freeLists.end() || it->second.empty()) {
+        return nullptr;
+      }
+      auto p = it->second.back();
+      it->second.pop_back();
+      return p;
+    }
+
+    /* Pushes count consecutive stacks starting at p */
+    void push(size_t allocSize, unsigned char* p, size_t count) {
+      std::lock_guard<folly::SpinLock> lg(lock);
+      auto& freeList = freeLists[allocSize];
+      for (size_t i = 0; i < count; ++i) {
+        freeList.push_back(p + allocSize * i);
+      }
+    }
+  };
+
+  Stripe stripes_[kNumPoolStripes];
+};
+
 #ifndef _WIN32
 
 namespace {
@@ -291,8 +418,10 @@ class StackCacheEntry {
   std::unique_ptr<StackCache> stackCache_;
 };
 
-GuardPageAllocator::GuardPageAllocator(bool useGuardPages)
-    : useGuardPages_(useGuardPages) {
+GuardPageAllocator::GuardPageAllocator(
+    bool useGuardPages,
+    bool useSharedStackPool)
+    : useGuardPages_(useGuardPages), useSharedStackPool_(useSharedStackPool) {
 #ifndef _WIN32
   installSignalHandler();
 #endif
@@ -311,13 +440,45 @@ unsigned char* GuardPageAllocator::allocate(size_t size) {
       return p;
     }
   }
+  if (useSharedStackPool_) {
+    if (auto p = StackPool::instance().allocate(size)) {
+      return p;
+    }
+    throw std::bad_alloc();
+  }
   return fallbackAllocator_.allocate(size);
 }
 
 void GuardPageAllocator::deallocate(unsigned char* limit, size_t size) {
-  if (!(stackCache_ && stackCache_->cache().giveBack(limit, size))) {
+  if (stackCache_ && stackCache_->cache().giveBack(limit, size)) {
+    return;
+  }
+  if (useSharedStackPool_) {
+    StackPool::instance().deallocate(limit, size);
+  } else {
     fallbackAllocator_.deallocate(limit, size);
   }
 }
+
+bool GuardPageAllocator::releaseStackTail(
+    unsigned char* limit,
+    size_t size,
+    size_t retain,
+    size_t* released) {
+  if (!useSharedStackPool_ &&
+      !(stackCache_ && stackCache_->cache().owns(limit, size))) {
+    return false;
+  }
+  auto keep = roundUpToPage(retain);
+  size_t bytes = 0;
+  if (keep < size) {
+    // Stacks grow down: the tail is the bottom of the allocation.
+    bytes = releasePages(limit, limit + size - keep);
+  }
+  if (released) {
+    *released = bytes;
+  }
+  return true;
+}
 } // namespace fibers
 } // namespace folly
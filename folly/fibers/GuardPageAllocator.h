@@ -33,8 +33,14 @@ class GuardPageAllocator {
   /**
    * @param useGuardPages if true, protect limited amount of stacks with guard
    *                      pages, otherwise acts as std::allocator.
+   * @param useSharedStackPool if true, stacks that don't get a guard page
+   *                           come from (and return to) a process-wide pool
+   *                           shared by all allocators, instead of
+   *                           std::allocator.
    */
-  explicit GuardPageAllocator(bool useGuardPages);
+  explicit GuardPageAllocator(
+      bool useGuardPages,
+      bool useSharedStackPool = false);
   ~GuardPageAllocator();
 
   /**
@@ -47,10 +53,28 @@ class GuardPageAllocator {
    */
   void deallocate(unsigned char* limit, size_t size);
 
+  /**
+   * Returns to the OS the memory of a stack previously returned by
+   * `allocate(size)', except for its top `retain' bytes (rounded up to a
+   * page). The address range stays valid and reads back as zeroes.
+   * If released isn't null, sets it to the number of bytes that were
+   * resident.
+   *
+   * @return false, without doing anything, if the stack didn't come from a
+   *         guard page cache or the shared pool (and so may not be page
+   *         aligned).
+   */
+  bool releaseStackTail(
+      unsigned char* limit,
+      size_t size,
+      size_t retain,
+      size_t* released = nullptr);
+
  private:
   std::unique_ptr<StackCacheEntry> stackCache_;
   std::allocator<unsigned char> fallbackAllocator_;
   bool useGuardPages_{true};
+  bool useSharedStackPool_{false};
 };
 } // namespace fibers
 } // namespace folly
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <folly/futures/EventBaseTimekeeper.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <folly/io/async/EventBase.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * TimedBatchDispatcher collects values added from any number of threads and
+ * fibers into batches, and hands each batch to a dispatch function that
+ * consumes a vector of values and returns a vector of results in the same
+ * order, like BatchDispatcher does.
+ *
+ * Unlike BatchDispatcher and AtomicBatchDispatcher, a batch isn't tied to the
+ * tasks of one FiberManager. It is dispatched as soon as it either
+ *  - holds maxBatchSize values, or
+ *  - is maxLatency old,
+ * whichever happens first; flush() dispatches the current batch right away.
+ * The deadline is kept with the HHWheelTimer of timerEvb (see
+ * EventBaseTimekeeper), and the dispatch function runs on executor. Both
+ * must outlive the dispatcher, as well as any batch still pending.
+ *
+ * Example:
+ *
+ *   TimedBatchDispatcher<Key, Value> lookups(
+ *       *ioExecutor.getEventBase(),
+ *       cpuExecutor,
+ *       [](std::vector<Key>&& keys) { return cache.multiGet(keys); },
+ *       TimedBatchDispatcher<Key, Value>::Options().setMaxBatchSize(100));
+ *
+ *   // From any thread or fiber:
+ *   auto value = lookups.add(key).get();
+ *
+ * Note:
+ *  - If the dispatch function throws, or returns the wrong number of results,
+ *    all futures of the batch get the exception.
+ *  - Destroying the dispatcher dispatches the pending batch.
+ */
+template <typename ValueT, typename ResultT>
+class TimedBatchDispatcher {
+ public:
+  using ValueBatchT = std::vector<ValueT>;
+  using ResultBatchT = std::vector<ResultT>;
+  using PromiseBatchT = std::vector<folly::Promise<ResultT>>;
+  using DispatchFunctionT = folly::Function<ResultBatchT(ValueBatchT&&)>;
+
+  struct Options {
+    /**
+     * Number of values that triggers a dispatch.
+     */
+    size_t maxBatchSize{64};
+    /**
+     * Time after its first value is added that a batch gets dispatched,
+     * however small it is.
+     */
+    std::chrono::milliseconds maxLatency{1};
+
+    Options& setMaxBatchSize(size_t n) {
+      maxBatchSize = n;
+      return *this;
+    }
+    Options& setMaxLatency(std::chrono::milliseconds latency) {
+      maxLatency = latency;
+      return *this;
+    }
+  };
+
+  TimedBatchDispatcher(
+      EventBase& timerEvb,
+      Executor& executor,
+      DispatchFunctionT dispatchFunc,
+      Options options = Options())
+      : state_(std::make_shared<DispatchState>(
+            timerEvb,
+            executor,
+            std::move(dispatchFunc),
+            options)) {
+    if (state_->options.maxBatchSize == 0) {
+      throw std::invalid_argument("maxBatchSize must be positive");
+    }
+  }
+
+  TimedBatchDispatcher(const TimedBatchDispatcher&) = delete;
+  TimedBatchDispatcher& operator=(const TimedBatchDispatcher&) = delete;
+
+  ~TimedBatchDispatcher() {
+    flush();
+  }
+
+  /**
+   * Adds value to the current batch. Thread-safe.
+   *
+   * @return future for the corresponding result of the dispatch function.
+   */
+  Future<ResultT> add(ValueT value) {
+    folly::Promise<ResultT> resultPromise;
+    auto resultFuture = resultPromise.getFuture();
+
+    Batch full;
+    bool startDeadline = false;
+    size_t batchId;
+    {
+      std::lock_guard<std::mutex> lg(state_->mutex);
+      auto& batch = state_->batch;
+      batch.values.emplace_back(std::move(value));
+      batch.promises.emplace_back(std::move(resultPromise));
+      batchId = state_->batchId;
+      if (batch.values.size() >= state_->options.maxBatchSize) {
+        full = state_->takeBatch();
+      } else {
+        startDeadline = batch.values.size() == 1;
+      }
+    }
+
+    if (!full.values.empty()) {
+      state_->dispatch(std::move(full));
+    } else if (startDeadline) {
+      scheduleDeadline(state_, batchId);
+    }
+    return resultFuture;
+  }
+
+  /**
+   * Dispatches the current batch now, if not empty.
+   */
+  void flush() {
+    state_->flush(folly::none);
+  }
+
+ private:
+  struct Batch {
+    ValueBatchT values;
+    PromiseBatchT promises;
+  };
+
+  struct DispatchState : std::enable_shared_from_this<DispatchState> {
+    DispatchState(
+        EventBase& evb,
+        Executor& exe,
+        DispatchFunctionT&& dispatchFunction,
+        const Options& opts)
+        : timerEvb(evb),
+          executor(exe),
+          dispatchFunc(std::move(dispatchFunction)),
+          options(opts) {}
+
+    // Must be called with mutex held.
+    Batch takeBatch() {
+      Batch taken;
+      std::swap(taken, batch);
+      ++batchId;
+      return taken;
+    }
+
+    // Dispatches the current batch, if it is still the one with the given id.
+    void flush(folly::Optional<size_t> id) {
+      Batch taken;
+      {
+        std::lock_guard<std::mutex> lg(mutex);
+        if (batch.values.empty() || (id && *id != batchId)) {
+          return;
+        }
+        taken = takeBatch();
+      }
+      dispatch(std::move(taken));
+    }
+
+    void dispatch(Batch&& taken) {
+      auto self = this->shared_from_this();
+      executor.add([ self, taken = std::move(taken) ]() mutable {
+        self->dispatchFunctionWrapper(taken);
+      });
+    }
+
+    void dispatchFunctionWrapper(Batch& taken) {
+      auto& promises = taken.promises;
+      try {
+        auto results = dispatchFunc(std::move(taken.values));
+        if (results.size() != promises.size()) {
+          throw std::logic_error(
+              "Unexpected number of results returned from dispatch function");
+        }
+
+        for (size_t i = 0; i < promises.size(); i++) {
+          promises[i].setValue(std::move(results[i]));
+        }
+      } catch (const std::exception& ex) {
+        for (size_t i = 0; i < promises.size(); i++) {
+          promises[i].setException(
+              exception_wrapper(std::current_exception(), ex));
+        }
+      } catch (...) {
+        for (size_t i = 0; i < promises.size(); i++) {
+          promises[i].setException(exception_wrapper(std::current_exception()));
+        }
+      }
+    }
+
+    EventBase& timerEvb;
+    Executor& executor;
+    DispatchFunctionT dispatchFunc;
+    const Options options;
+
+    std::mutex mutex;
+    Batch batch;
+    // Incremented whenever a batch is taken, so that a deadline that fires
+    // after its batch was dispatched by size doesn't flush the next one.
+    size_t batchId{0};
+  };
+
+  static void scheduleDeadline(
+      const std::shared_ptr<DispatchState>& state,
+      size_t batchId) {
+    // Deadlines are not cancelled: one that outlives its batch is a no-op.
+    EventBaseTimekeeper(state->timerEvb)
+        .after(state->options.maxLatency)
+        .then([state, batchId](Try<Unit>&&) { state->flush(batchId); });
+  }
+
+  // Pending deadlines and dispatches hold on to the state.
+  std::shared_ptr<DispatchState> state_;
+};
+
+} // namespace fibers
+} // namespace folly
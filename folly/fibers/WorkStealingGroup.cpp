@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/fibers/WorkStealingGroup.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/fibers/LoopController.h>
+
+namespace folly {
+namespace fibers {
+
+WorkStealingGroup::~WorkStealingGroup() {
+  // Members hold a reference to the group.
+  DCHECK(members_.empty());
+}
+
+size_t WorkStealingGroup::size() const {
+  SharedMutex::ReadHolder guard(mutex_);
+  return members_.size();
+}
+
+void WorkStealingGroup::add(FiberManager& fm) {
+  SharedMutex::WriteHolder guard(mutex_);
+  CHECK(members_.empty() || members_.front()->localType_ == fm.localType_)
+      << "All FiberManagers in a WorkStealingGroup must use the same "
+      << "local data type";
+  members_.push_back(&fm);
+  markIdle(fm);
+}
+
+void WorkStealingGroup::remove(FiberManager& fm) {
+  SharedMutex::WriteHolder guard(mutex_);
+  members_.erase(
+      std::remove(members_.begin(), members_.end(), &fm), members_.end());
+  markBusy(fm);
+
+  // Don't drop tasks that nobody got to: move them to other members.
+  while (auto task = fm.popStealableTask(true)) {
+    if (members_.empty()) {
+      LOG(WARNING) << "Dropping a task queued on a FiberManager which left "
+                   << "its WorkStealingGroup";
+      continue;
+    }
+    auto target = claimIdleMember(fm);
+    if (!target) {
+      target = members_[nextVictim_++ % members_.size()];
+    }
+    handTo(*target, std::move(task));
+  }
+}
+
+std::unique_ptr<FiberManager::RemoteTask> WorkStealingGroup::steal(
+    FiberManager& thief) {
+  SharedMutex::ReadHolder guard(mutex_);
+  auto n = members_.size();
+  auto start = nextVictim_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < n; ++i) {
+    auto victim = members_[(start + i) % n];
+    if (victim == &thief ||
+        victim->numStealableTasks_.load(std::memory_order_relaxed) == 0) {
+      continue;
+    }
+    if (auto task = victim->popStealableTask(false)) {
+      tasksStolen_.fetch_add(1, std::memory_order_relaxed);
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void WorkStealingGroup::shareBacklog(FiberManager& busy) {
+  if (numIdle_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  SharedMutex::ReadHolder guard(mutex_);
+  auto member = claimIdleMember(busy);
+  if (!member) {
+    return;
+  }
+  auto task = busy.popStealableTask(false);
+  if (!task) {
+    markIdle(*member);
+    return;
+  }
+  handTo(*member, std::move(task));
+  tasksStolen_.fetch_add(1, std::memory_order_relaxed);
+}
+
+FiberManager* WorkStealingGroup::claimIdleMember(FiberManager& except) {
+  auto n = members_.size();
+  auto start = nextVictim_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < n; ++i) {
+    auto member = members_[(start + i) % n];
+    if (member != &except &&
+        member->idleForStealing_.load(std::memory_order_relaxed) &&
+        member->idleForStealing_.exchange(false)) {
+      numIdle_.fetch_sub(1, std::memory_order_relaxed);
+      return member;
+    }
+  }
+  return nullptr;
+}
+
+void WorkStealingGroup::handTo(
+    FiberManager& fm,
+    std::unique_ptr<FiberManager::RemoteTask> task) {
+  auto insertHead = [&]() {
+    return fm.remoteTaskQueue_.insertHead(task.release());
+  };
+  fm.loopController_->scheduleThreadSafe(std::ref(insertHead));
+}
+
+void WorkStealingGroup::markIdle(FiberManager& fm) {
+  if (!fm.idleForStealing_.exchange(true)) {
+    numIdle_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void WorkStealingGroup::markBusy(FiberManager& fm) {
+  if (fm.idleForStealing_.load(std::memory_order_relaxed) &&
+      fm.idleForStealing_.exchange(false)) {
+    numIdle_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+namespace {
+
+class WorkStealingObserver : public ThreadPoolExecutor::Observer {
+ public:
+  WorkStealingObserver(
+      std::shared_ptr<WorkStealingGroup> group,
+      const FiberManager::Options& opts)
+      : group_(std::move(group)), opts_(opts) {}
+
+  void threadStarted(ThreadPoolExecutor::ThreadHandle* h) override {
+    auto evb = IOThreadPoolExecutor::getEventBase(h);
+    if (!evb) {
+      return;
+    }
+    evb->runInEventBaseThread([evb, group = group_, opts = opts_]() mutable {
+      getFiberManager(*evb, opts).joinWorkStealingGroup(std::move(group));
+    });
+  }
+
+  // FiberManagers leave the group when their EventBase is destroyed.
+  void threadStopped(ThreadPoolExecutor::ThreadHandle*) override {}
+
+ private:
+  std::shared_ptr<WorkStealingGroup> group_;
+  FiberManager::Options opts_;
+};
+
+} // namespace
+
+std::shared_ptr<WorkStealingGroup> enableWorkStealing(
+    IOThreadPoolExecutor& executor,
+    const FiberManager::Options& opts) {
+  auto group = std::make_shared<WorkStealingGroup>();
+  executor.addObserver(std::make_shared<WorkStealingObserver>(group, opts));
+  return group;
+}
+
+} // namespace fibers
+} // namespace folly
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <folly/SharedMutex.h>
+#include <folly/fibers/FiberManagerInternal.h>
+
+namespace folly {
+
+class IOThreadPoolExecutor;
+
+namespace fibers {
+
+/**
+ * A set of FiberManagers, usually one per thread of a thread pool, which
+ * share the tasks that haven't started yet.
+ *
+ * Once a FiberManager has joined a group, tasks added to it with addTask()
+ * are queued instead of getting a fiber right away. The FiberManager starts
+ * queued tasks one at a time, whenever it has no ready fibers left; meanwhile
+ * any other member that runs out of work takes tasks from the back of the
+ * queue and starts them on its own thread. When a queue backs up while some
+ * member is idle, the idle member is handed a task directly, which wakes it
+ * up.
+ *
+ * Only tasks that haven't started move: a fiber always runs to completion on
+ * the FiberManager that started it. Tasks added with addTaskRemote(),
+ * addTaskFinally() or addTaskFuture() are never moved.
+ *
+ * A stolen task runs with the request context, cancellation token and fiber
+ * local data it was added with, but on another thread. Only group
+ * FiberManagers whose tasks don't care which thread they run on (or which
+ * EventBase getFiberManager() returns inside them); all members must use the
+ * same local data type.
+ */
+class WorkStealingGroup {
+ public:
+  WorkStealingGroup() = default;
+  WorkStealingGroup(const WorkStealingGroup&) = delete;
+  WorkStealingGroup& operator=(const WorkStealingGroup&) = delete;
+
+  ~WorkStealingGroup();
+
+  /**
+   * @return number of FiberManagers in the group.
+   */
+  size_t size() const;
+
+  /**
+   * @return number of tasks started by a FiberManager other than the one
+   *         they were added to.
+   */
+  size_t tasksStolen() const {
+    return tasksStolen_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class FiberManager;
+
+  void add(FiberManager& fm);
+  void remove(FiberManager& fm);
+
+  /**
+   * Takes a queued task from some other member, or returns nullptr.
+   */
+  std::unique_ptr<FiberManager::RemoteTask> steal(FiberManager& thief);
+
+  /**
+   * Called by busy when it has more queued tasks than it is about to start:
+   * hands one of them to an idle member, if any.
+   */
+  void shareBacklog(FiberManager& busy);
+
+  void markIdle(FiberManager& fm);
+  void markBusy(FiberManager& fm);
+
+  /**
+   * Returns a member other than except which was idle, after marking it busy.
+   * Must be called with mutex_ held.
+   */
+  FiberManager* claimIdleMember(FiberManager& except);
+
+  /**
+   * Makes fm start task, waking it up if needed.
+   */
+  void handTo(FiberManager& fm, std::unique_ptr<FiberManager::RemoteTask> task);
+
+  mutable folly::SharedMutex mutex_;
+  std::vector<FiberManager*> members_;
+  std::atomic<size_t> numIdle_{0};
+  std::atomic<size_t> nextVictim_{0};
+  std::atomic<size_t> tasksStolen_{0};
+};
+
+/**
+ * Puts the FiberManagers that getFiberManager(evb, opts) returns for the
+ * EventBases of executor's threads, current and future ones, in a new
+ * WorkStealingGroup.
+ */
+std::shared_ptr<WorkStealingGroup> enableWorkStealing(
+    IOThreadPoolExecutor& executor,
+    const FiberManager::Options& opts = FiberManager::Options());
+
+} // namespace fibers
+} // namespace folly
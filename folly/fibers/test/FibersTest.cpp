@@ -13,7 +13,11 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <atomic>
+#include <mutex>
+#include <numeric>
+#include <set>
 #include <thread>
 #include <vector>
 
@@ -22,17 +26,23 @@
 #include <folly/futures/Future.h>
 
 #include <folly/Conv.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/fibers/AddTasks.h>
 #include <folly/fibers/AtomicBatchDispatcher.h>
 #include <folly/fibers/BatchDispatcher.h>
+#include <folly/fibers/Channel.h>
 #include <folly/fibers/EventBaseLoopController.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/fibers/GenericBaton.h>
+#include <folly/fibers/GuardPageAllocator.h>
 #include <folly/fibers/Semaphore.h>
 #include <folly/fibers/SimpleLoopController.h>
+#include <folly/fibers/TimedBatchDispatcher.h>
 #include <folly/fibers/TimedMutex.h>
 #include <folly/fibers/WhenN.h>
+#include <folly/fibers/WorkStealingGroup.h>
 #include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/portability/GTest.h>
 
@@ -1114,6 +1124,59 @@ TEST(FiberManager, addTaskRemoteBasic) {
   EXPECT_EQ(43, result[1]);
 }
 
+TEST(FiberManager, addTaskCancellation) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  folly::CancellationSource source;
+
+  bool ranBefore = false;
+  bool ranAfter = false;
+  bool childRan = false;
+  bool woken = false;
+  Baton baton;
+
+  manager.addTask(
+      [&]() {
+        ranBefore = true;
+        EXPECT_EQ(source.getToken(), getCancellationToken());
+        folly::CancellationCallback cb(
+            getCancellationToken(), [&] { baton.post(); });
+        baton.wait();
+        woken = getCancellationToken().isCancellationRequested();
+        // Inherits the cancelled token, so never runs.
+        addTask([&]() { childRan = true; });
+      },
+      source.getToken());
+  manager.loopUntilNoReady();
+  EXPECT_TRUE(ranBefore);
+  EXPECT_FALSE(woken);
+
+  manager.addTask([&]() { ranAfter = true; }, source.getToken());
+  source.requestCancellation();
+  manager.loopUntilNoReady();
+
+  EXPECT_TRUE(woken);
+  EXPECT_FALSE(childRan);
+  EXPECT_FALSE(ranAfter);
+  EXPECT_FALSE(manager.hasTasks());
+  EXPECT_FALSE(getCancellationToken().canBeCancelled());
+}
+
+TEST(FiberManager, addTaskRemoteCancellation) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  folly::CancellationSource source;
+
+  bool ran = false;
+  std::thread remoteThread{[&]() {
+    manager.addTaskRemote([&]() { ran = true; }, source.getToken());
+    source.requestCancellation();
+  }};
+  remoteThread.join();
+  manager.loopUntilNoReady();
+
+  EXPECT_FALSE(ran);
+  EXPECT_FALSE(manager.hasTasks());
+}
+
 TEST(FiberManager, remoteHasTasks) {
   size_t counter = 0;
   FiberManager fm(std::make_unique<SimpleLoopController>());
@@ -2212,3 +2275,546 @@ TEST(FiberManager, recordStack) {
   std::thread(f).join();
 }
 #endif
+
+TEST(GuardPageAllocator, sharedStackPool) {
+  constexpr size_t kSize = 64 * 1024;
+  GuardPageAllocator allocator(false, true);
+
+  std::vector<unsigned char*> stacks;
+  for (size_t i = 0; i < 100; ++i) {
+    auto p = allocator.allocate(kSize);
+    std::fill(p, p + kSize, 0xff);
+    stacks.push_back(p);
+  }
+  for (auto p : stacks) {
+    allocator.deallocate(p, kSize);
+  }
+
+  // Stacks come back either fresh or with their memory released.
+  GuardPageAllocator other(false, true);
+  for (size_t i = 0; i < 100; ++i) {
+    auto p = other.allocate(kSize);
+    EXPECT_TRUE(std::all_of(p, p + kSize, [](unsigned char c) {
+      return c == 0;
+    }));
+    other.deallocate(p, kSize);
+  }
+}
+
+TEST(GuardPageAllocator, releaseStackTail) {
+  constexpr size_t kSize = 64 * 1024;
+  constexpr size_t kRetain = 4096;
+  for (bool useGuardPages : {true, false}) {
+    GuardPageAllocator allocator(useGuardPages, !useGuardPages);
+    auto p = allocator.allocate(kSize);
+    std::fill(p, p + kSize, 0xff);
+    size_t released = 0;
+    EXPECT_TRUE(allocator.releaseStackTail(p, kSize, kRetain, &released));
+    EXPECT_EQ(kSize - kRetain, released);
+    auto top = p + kSize - kRetain;
+    EXPECT_TRUE(std::all_of(p, top, [](unsigned char c) { return c == 0; }));
+    EXPECT_TRUE(
+        std::all_of(top, p + kSize, [](unsigned char c) { return c == 0xff; }));
+    allocator.deallocate(p, kSize);
+  }
+
+  GuardPageAllocator heap(false, false);
+  auto p = heap.allocate(kSize);
+  EXPECT_FALSE(heap.releaseStackTail(p, kSize, kRetain));
+  heap.deallocate(p, kSize);
+}
+
+#ifndef FOLLY_SANITIZE_ADDRESS
+TEST(FiberManager, adaptiveStackSize) {
+  auto f = [] {
+    FiberManager::Options opts;
+    opts.stackSize = 1024 * 1024;
+    opts.recordStackEvery = 1;
+    opts.adaptiveStackSize = true;
+    opts.useSharedStackPool = true;
+    opts.maxFibersPoolSize = 0;
+
+    FiberManager fm(std::make_unique<SimpleLoopController>(), opts);
+
+    static constexpr size_t n = 1000;
+    size_t tasksRun = 0;
+    for (size_t i = 0; i < 10; ++i) {
+      fm.addTask([&]() {
+        int b[n];
+        for (size_t j = 0; j < n; ++j) {
+          b[j] = j;
+        }
+        tasksRun += b[n - 1] == n - 1;
+      });
+      fm.loopUntilNoReady();
+    }
+
+    EXPECT_EQ(10, tasksRun);
+    EXPECT_LT(n * sizeof(int), fm.stackHighWatermark());
+    EXPECT_GT(opts.stackSize / 4, fm.stackHighWatermark());
+  };
+  std::thread(f).join();
+}
+#endif
+
+TEST(FiberManager, releaseIdleStacks) {
+  FiberManager::Options opts;
+  opts.fibersPoolResizePeriodMs = 50;
+  opts.idleStackRetainBytes = 4096;
+  opts.useSharedStackPool = true;
+#ifndef FOLLY_SANITIZE_ADDRESS
+  opts.recordStackEvery = 2;
+#endif
+
+  FiberManager manager(std::make_unique<EventBaseLoopController>(), opts);
+  folly::EventBase evb;
+  dynamic_cast<EventBaseLoopController&>(manager.loopController())
+      .attachEventBase(evb);
+
+  size_t tasksRun = 0;
+  auto addTasks = [&] {
+    for (size_t i = 0; i < 10; ++i) {
+      manager.addTask([&]() {
+        char buf[8192];
+        std::fill(buf, buf + sizeof(buf), 1);
+        tasksRun += buf[sizeof(buf) - 1];
+      });
+    }
+  };
+
+  addTasks();
+  evb.loopOnce();
+  EXPECT_EQ(10, tasksRun);
+  EXPECT_EQ(10, manager.fibersPoolSize());
+
+  // Idle fibers get their stacks trimmed, and must still be reusable.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  evb.loopOnce();
+  addTasks();
+  evb.loopOnce();
+  EXPECT_EQ(20, tasksRun);
+  EXPECT_EQ(10, manager.fibersAllocated());
+}
+
+TEST(FiberManager, releaseStacksWhenIdle) {
+  FiberManager::Options opts;
+  opts.releaseStacksWhenIdle = true;
+  opts.useSharedStackPool = true;
+
+  FiberManager manager(std::make_unique<SimpleLoopController>(), opts);
+  size_t tasksRun = 0;
+  auto runTasks = [&] {
+    for (size_t i = 0; i < 10; ++i) {
+      manager.addTask([&]() {
+        char buf[8192];
+        std::fill(buf, buf + sizeof(buf), 1);
+        tasksRun += buf[sizeof(buf) - 1];
+      });
+    }
+    manager.loopUntilNoReady();
+  };
+
+  runTasks();
+  EXPECT_EQ(10, manager.fibersPoolSize());
+  auto released = folly::detail::MemoryIdler::releaseIdleMemory();
+#ifdef __linux__
+  EXPECT_LE(10 * 8192, released);
+#endif
+  // Nothing left to release
+  EXPECT_GT(10 * 8192, folly::detail::MemoryIdler::releaseIdleMemory());
+
+  runTasks();
+  EXPECT_EQ(20, tasksRun);
+  EXPECT_EQ(10, manager.fibersAllocated());
+}
+
+TEST(FiberManager, workStealing) {
+  constexpr size_t kThreads = 4;
+  constexpr size_t kTasks = 100;
+
+  folly::IOThreadPoolExecutor executor(kThreads);
+  auto group = enableWorkStealing(executor);
+  while (group->size() < kThreads) {
+    std::this_thread::yield();
+  }
+
+  std::mutex threadsMutex;
+  std::set<std::thread::id> threads;
+  std::atomic<size_t> finished{0};
+  folly::Baton<> done;
+
+  auto evb = executor.getEventBase();
+  evb->runInEventBaseThread([&] {
+    auto& fm = getFiberManager(*evb);
+    for (size_t i = 0; i < kTasks; ++i) {
+      fm.addTask([&] {
+        // Keep the thread busy, so that other threads get to steal.
+        /* sleep override */
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        {
+          std::lock_guard<std::mutex> lg(threadsMutex);
+          threads.insert(std::this_thread::get_id());
+        }
+        if (++finished == kTasks) {
+          done.post();
+        }
+      });
+    }
+  });
+
+  done.wait();
+  EXPECT_GT(threads.size(), 1);
+  EXPECT_GT(group->tasksStolen(), 0);
+
+  executor.join();
+  EXPECT_EQ(0, group->size());
+}
+
+TEST(FiberManager, workStealingKeepsTaskContext) {
+  constexpr size_t kTasks = 50;
+
+  folly::IOThreadPoolExecutor executor(2);
+  auto group = enableWorkStealing(executor);
+  while (group->size() < 2) {
+    std::this_thread::yield();
+  }
+
+  folly::CancellationSource source;
+  source.requestCancellation();
+  std::atomic<size_t> finished{0};
+  std::atomic<size_t> cancelledRan{0};
+  folly::Baton<> done;
+
+  auto evb = executor.getEventBase();
+  evb->runInEventBaseThread([&] {
+    auto& fm = getFiberManager(*evb);
+    for (size_t i = 0; i < kTasks; ++i) {
+      fm.addTask([&] { ++cancelledRan; }, source.getToken());
+    }
+    fm.addTask([&] {
+      folly::RequestContextScopeGuard rctx;
+      auto context = folly::RequestContext::get();
+      for (size_t i = 0; i < kTasks; ++i) {
+        addTask([&, context] {
+          /* sleep override */
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          EXPECT_EQ(context, folly::RequestContext::get());
+          if (++finished == kTasks) {
+            done.post();
+          }
+        });
+      }
+    });
+  });
+
+  done.wait();
+  EXPECT_EQ(0, cancelledRan);
+}
+
+TEST(Channel, unbounded) {
+  Channel<int> channel;
+  EXPECT_EQ(0, channel.capacity());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(channel.send(i));
+  }
+  EXPECT_EQ(100, channel.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, *channel.recv());
+  }
+  EXPECT_FALSE(channel.tryRecv().hasValue());
+}
+
+TEST(Channel, boundedSuspendsFibers) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  Channel<int> channel(2);
+  std::vector<int> received;
+  size_t sent = 0;
+
+  manager.addTask([&] {
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(channel.send(i));
+      ++sent;
+    }
+    channel.close();
+  });
+  manager.addTask([&] {
+    // The producer can only get ahead by the capacity of the channel.
+    EXPECT_EQ(2, sent);
+    EXPECT_EQ(2, channel.size());
+    while (auto value = channel.recv()) {
+      received.push_back(*value);
+      EXPECT_LE(sent, received.size() + 2);
+    }
+  });
+
+  loopController.loop([&] { loopController.stop(); });
+
+  EXPECT_EQ(10, sent);
+  EXPECT_EQ(10, received.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, received[i]);
+  }
+}
+
+TEST(Channel, trySendTryRecv) {
+  Channel<std::unique_ptr<int>> channel(1);
+  auto value = std::make_unique<int>(1);
+  EXPECT_TRUE(channel.trySend(value));
+  EXPECT_EQ(nullptr, value);
+
+  value = std::make_unique<int>(2);
+  EXPECT_FALSE(channel.trySend(value));
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ(2, *value);
+
+  EXPECT_EQ(1, **channel.tryRecv());
+  EXPECT_FALSE(channel.tryRecv().hasValue());
+}
+
+TEST(Channel, close) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  Channel<int> channel(1);
+  bool blockedSendFailed = false;
+  bool blockedRecvFailed = false;
+  Channel<int> empty;
+
+  EXPECT_TRUE(channel.send(1));
+  manager.addTask([&] { blockedSendFailed = !channel.send(2); });
+  manager.addTask([&] { blockedRecvFailed = !empty.recv().hasValue(); });
+  manager.addTask([&] {
+    channel.close();
+    empty.close();
+  });
+
+  loopController.loop([&] { loopController.stop(); });
+
+  EXPECT_TRUE(blockedSendFailed);
+  EXPECT_TRUE(blockedRecvFailed);
+  EXPECT_TRUE(channel.isClosed());
+  EXPECT_FALSE(channel.send(3));
+  // Values sent before close() can still be received.
+  EXPECT_EQ(1, *channel.recv());
+  EXPECT_FALSE(channel.recv().hasValue());
+}
+
+TEST(Channel, batch) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  Channel<int> channel(4);
+  std::vector<int> received;
+  size_t batches = 0;
+
+  manager.addTask([&] {
+    std::vector<int> values(10);
+    std::iota(values.begin(), values.end(), 0);
+    EXPECT_EQ(10, channel.sendBatch(values));
+    channel.close();
+  });
+  manager.addTask([&] {
+    while (channel.recvBatch(received, 3) > 0) {
+      ++batches;
+    }
+  });
+
+  loopController.loop([&] { loopController.stop(); });
+
+  EXPECT_EQ(10, received.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, received[i]);
+  }
+  EXPECT_LT(batches, 10);
+}
+
+TEST(Channel, crossThread) {
+  constexpr size_t kProducers = 4;
+  constexpr size_t kValues = 1000;
+
+  Channel<size_t> channel(16);
+  std::atomic<size_t> sum{0};
+  std::atomic<size_t> count{0};
+
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+  for (size_t i = 0; i < 4; ++i) {
+    fm.addTask([&] {
+      while (auto value = channel.recv()) {
+        sum += *value;
+        ++count;
+      }
+    });
+  }
+  std::thread consumers([&] { evb.loop(); });
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&] {
+      for (size_t i = 0; i < kValues; ++i) {
+        EXPECT_TRUE(channel.send(i));
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  channel.close();
+  consumers.join();
+
+  EXPECT_EQ(kProducers * kValues, count);
+  EXPECT_EQ(kProducers * kValues * (kValues - 1) / 2, sum);
+}
+
+namespace {
+using TestTimedBatchDispatcher = TimedBatchDispatcher<int, std::string>;
+
+std::vector<std::string> toStrings(std::vector<int>&& values) {
+  std::vector<std::string> results;
+  for (auto value : values) {
+    results.push_back(folly::to<std::string>(value));
+  }
+  return results;
+}
+} // namespace
+
+TEST(TimedBatchDispatcher, flushOnSize) {
+  folly::ScopedEventBaseThread timerThread;
+  folly::InlineExecutor executor;
+  std::vector<size_t> batches;
+  TestTimedBatchDispatcher dispatcher(
+      *timerThread.getEventBase(),
+      executor,
+      [&](std::vector<int>&& values) {
+        batches.push_back(values.size());
+        return toStrings(std::move(values));
+      },
+      TestTimedBatchDispatcher::Options()
+          .setMaxBatchSize(3)
+          .setMaxLatency(std::chrono::seconds(60)));
+
+  auto f1 = dispatcher.add(1);
+  auto f2 = dispatcher.add(2);
+  EXPECT_FALSE(f1.isReady());
+  auto f3 = dispatcher.add(3);
+  EXPECT_EQ("1", f1.value());
+  EXPECT_EQ("2", f2.value());
+  EXPECT_EQ("3", f3.value());
+  EXPECT_EQ(std::vector<size_t>{3}, batches);
+}
+
+TEST(TimedBatchDispatcher, flushOnDeadline) {
+  folly::ScopedEventBaseThread timerThread;
+  folly::InlineExecutor executor;
+  std::atomic<size_t> batches{0};
+  TestTimedBatchDispatcher dispatcher(
+      *timerThread.getEventBase(),
+      executor,
+      [&](std::vector<int>&& values) {
+        ++batches;
+        return toStrings(std::move(values));
+      },
+      TestTimedBatchDispatcher::Options()
+          .setMaxBatchSize(100)
+          .setMaxLatency(std::chrono::milliseconds(10)));
+
+  auto f1 = dispatcher.add(1);
+  auto f2 = dispatcher.add(2);
+  EXPECT_EQ("1", f1.get(std::chrono::seconds(10)));
+  EXPECT_EQ("2", f2.get(std::chrono::seconds(10)));
+  EXPECT_EQ(1, batches);
+
+  // A new batch gets a new deadline.
+  EXPECT_EQ("3", dispatcher.add(3).get(std::chrono::seconds(10)));
+  EXPECT_EQ(2, batches);
+}
+
+TEST(TimedBatchDispatcher, flushAndDestroy) {
+  folly::ScopedEventBaseThread timerThread;
+  folly::InlineExecutor executor;
+  size_t batches = 0;
+  auto dispatch = [&](std::vector<int>&& values) {
+    ++batches;
+    return toStrings(std::move(values));
+  };
+  auto options = TestTimedBatchDispatcher::Options().setMaxLatency(
+      std::chrono::seconds(60));
+
+  folly::Future<std::string> f = folly::makeFuture<std::string>("");
+  {
+    TestTimedBatchDispatcher dispatcher(
+        *timerThread.getEventBase(), executor, dispatch, options);
+    dispatcher.flush();
+    EXPECT_EQ(0, batches);
+    auto f1 = dispatcher.add(1);
+    EXPECT_FALSE(f1.isReady());
+    dispatcher.flush();
+    EXPECT_EQ(1, batches);
+    EXPECT_EQ("1", f1.value());
+    f = dispatcher.add(2);
+  }
+  EXPECT_EQ(2, batches);
+  EXPECT_EQ("2", f.value());
+}
+
+TEST(TimedBatchDispatcher, dispatchThrows) {
+  folly::ScopedEventBaseThread timerThread;
+  folly::InlineExecutor executor;
+  TestTimedBatchDispatcher dispatcher(
+      *timerThread.getEventBase(),
+      executor,
+      [](std::vector<int>&&) -> std::vector<std::string> {
+        throw std::runtime_error("dispatch failed");
+      },
+      TestTimedBatchDispatcher::Options().setMaxBatchSize(2));
+
+  auto f1 = dispatcher.add(1);
+  auto f2 = dispatcher.add(2);
+  EXPECT_THROW(f1.value(), std::runtime_error);
+  EXPECT_THROW(f2.value(), std::runtime_error);
+}
+
+TEST(TimedBatchDispatcher, manyThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kValues = 500;
+
+  folly::ScopedEventBaseThread timerThread;
+  folly::IOThreadPoolExecutor executor(2);
+  std::atomic<size_t> batches{0};
+  TestTimedBatchDispatcher dispatcher(
+      *timerThread.getEventBase(),
+      executor,
+      [&](std::vector<int>&& values) {
+        EXPECT_LE(values.size(), 50);
+        ++batches;
+        return toStrings(std::move(values));
+      },
+      TestTimedBatchDispatcher::Options()
+          .setMaxBatchSize(50)
+          .setMaxLatency(std::chrono::milliseconds(5)));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<folly::Future<std::string>> futures;
+      for (int i = 0; i < kValues; ++i) {
+        futures.push_back(dispatcher.add(t * kValues + i));
+      }
+      for (int i = 0; i < kValues; ++i) {
+        EXPECT_EQ(
+            folly::to<std::string>(t * kValues + i),
+            futures[i].get(std::chrono::seconds(10)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_GE(batches, kThreads * kValues / 50);
+  EXPECT_LT(batches, kThreads * kValues);
+}
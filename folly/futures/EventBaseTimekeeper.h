@@ -0,0 +1,66 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/futures/Future.h>
+#include <folly/futures/Timekeeper.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+namespace folly {
+
+/// A Timekeeper that schedules its timeouts on the HHWheelTimer of an
+/// existing EventBase, rather than on a dedicated timer thread.
+///
+/// When after() is called from the EventBase thread the timeout is scheduled
+/// directly; otherwise it is handed over with runInEventBaseThread(). Either
+/// way the returned future completes on the EventBase thread, so futures
+/// that are already via() that EventBase see no thread hop at all.
+///
+/// The timekeeper itself holds no state besides the EventBase and timer, and
+/// futures returned by after() do not reference it, so it may be destroyed
+/// as soon as after() returns. The EventBase (and timer) must outlive every
+/// pending timeout.
+///
+/// Future::within(), Future::onTimeout() and Future::delayed() pick this
+/// timekeeper automatically, using EventBase::timer(), when no Timekeeper is
+/// passed and the future's executor is an EventBase.
+class EventBaseTimekeeper : public Timekeeper {
+ public:
+  /// Uses evb.timer(). Note that its tick interval is coarser than the one
+  /// used by ThreadWheelTimekeeper.
+  explicit EventBaseTimekeeper(EventBase& evb) : evb_(&evb) {}
+
+  /// Uses the given timer, which must be attached to evb.
+  EventBaseTimekeeper(EventBase& evb, HHWheelTimer& timer)
+      : evb_(&evb), timer_(&timer) {}
+
+  /// Implement the Timekeeper interface
+  Future<Unit> after(Duration) override;
+
+  EventBase* getEventBase() const {
+    return evb_;
+  }
+
+ private:
+  EventBase* evb_;
+  // nullptr means evb_->timer(), which may only be created on the EventBase
+  // thread.
+  HHWheelTimer* timer_{nullptr};
+};
+
+} // namespace folly
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <mutex>
 #include <thread>
 
 #include <folly/Baton.h>
@@ -52,6 +53,7 @@ typedef folly::Baton<> FutureBatonType;
 
 namespace detail {
 std::shared_ptr<Timekeeper> getTimekeeperSingleton();
+Timekeeper* getEventBaseTimekeeper(Executor* executor);
 } // namespace detail
 
 namespace futures {
@@ -104,6 +106,11 @@ class CoreCallbackState {
     stealPromise().setException(std::move(ew));
   }
 
+  CancellationToken const& cancellationToken() const noexcept {
+    assert(before_barrier());
+    return promise_.core_->getCancellationToken();
+  }
+
   Promise<T> stealPromise() noexcept {
     assert(before_barrier());
     func_.~F();
@@ -130,6 +137,49 @@ inline auto makeCoreCallbackState(Promise<T>&& p, F&& f) noexcept(
       std::move(p), std::forward<F>(f));
 }
 
+template <class T>
+struct FusedContinuation<T> {
+  using Result = T;
+
+  Try<T> operator()(Try<T>&& t) {
+    return std::move(t);
+  }
+};
+
+template <class T, class F, class... Fs>
+struct FusedContinuation<T, F, Fs...> {
+  using Arg = typename callableResult<T, F>::Arg;
+  using Next = typename callableResult<T, F>::Return::value_type;
+  using Rest = FusedContinuation<Next, Fs...>;
+  using Result = typename Rest::Result;
+
+  static_assert(
+      !callableResult<T, F>::ReturnsFuture::value &&
+          !isSemiFuture<typename Arg::Result>::value,
+      "deferFused() continuations must not return futures");
+
+  template <class FF, class... FFs>
+  explicit FusedContinuation(FF&& f, FFs&&... fs)
+      : func_(std::forward<FF>(f)), rest_(std::forward<FFs>(fs)...) {}
+
+  Try<Result> operator()(Try<T>&& t) {
+    return rest_(step(std::move(t), Arg()));
+  }
+
+ private:
+  template <bool isTry, class... Args>
+  Try<Next> step(Try<T>&& t, argResult<isTry, F, Args...>) {
+    if (!isTry && t.hasException()) {
+      return Try<Next>(std::move(t.exception()));
+    }
+    return makeTryWith(
+        [&] { return std::move(func_)(t.template get<isTry, Args>()...); });
+  }
+
+  F func_;
+  Rest rest_;
+};
+
 template <class T>
 FutureBase<T>::FutureBase(SemiFuture<T>&& other) noexcept : core_(other.core_) {
   other.core_ = nullptr;
@@ -280,6 +330,7 @@ FutureBase<T>::thenImplementation(
 
   Promise<B> p;
   p.core_->setInterruptHandlerNoLock(this->core_->getInterruptHandler());
+  p.core_->setCancellationTokenNoLock(this->core_->getCancellationToken());
 
   // grab the Future now before we lose our handle on the Promise
   auto f = p.getFuture();
@@ -320,6 +371,9 @@ FutureBase<T>::thenImplementation(
 
         if (!isTry && t.hasException()) {
           state.setException(std::move(t.exception()));
+        } else if (
+            !isTry && state.cancellationToken().isCancellationRequested()) {
+          state.setException(make_exception_wrapper<FutureCancellation>());
         } else {
           state.setTry(makeTryWith(
               [&] { return state.invoke(t.template get<isTry, Args>()...); }));
@@ -342,6 +396,7 @@ FutureBase<T>::thenImplementation(
 
   Promise<B> p;
   p.core_->setInterruptHandlerNoLock(this->core_->getInterruptHandler());
+  p.core_->setCancellationTokenNoLock(this->core_->getCancellationToken());
 
   // grab the Future now before we lose our handle on the Promise
   auto f = p.getFuture();
@@ -352,11 +407,18 @@ FutureBase<T>::thenImplementation(
            std::move(p), std::forward<F>(func))](Try<T>&& t) mutable {
         if (!isTry && t.hasException()) {
           state.setException(std::move(t.exception()));
+        } else if (
+            !isTry && state.cancellationToken().isCancellationRequested()) {
+          state.setException(make_exception_wrapper<FutureCancellation>());
         } else {
           auto tf2 = state.tryInvoke(t.template get<isTry, Args>()...);
           if (tf2.hasException()) {
             state.setException(std::move(tf2.exception()));
           } else {
+            // Let cancellation reach the work func started.
+            if (state.cancellationToken().canBeCancelled()) {
+              tf2->core_->setCancellationToken(state.cancellationToken());
+            }
             tf2->setCallback_([p = state.stealPromise()](Try<B> && b) mutable {
               p.setTry(std::move(b));
             });
@@ -508,6 +570,13 @@ inline Future<T> SemiFuture<T>::via(Executor* executor, int8_t priority) && {
   return newFuture;
 }
 
+template <class T>
+SemiFuture<T> SemiFuture<T>::withCancellation(CancellationToken token) && {
+  throwIfInvalid();
+  this->core_->setCancellationToken(std::move(token));
+  return std::move(*this);
+}
+
 template <class T>
 template <typename F>
 SemiFuture<typename futures::detail::callableResult<T, F>::Return::value_type>
@@ -539,6 +608,44 @@ SemiFuture<T>::defer(F&& func) && {
   return sf;
 }
 
+template <class T>
+template <typename... Fs>
+SemiFuture<typename futures::detail::FusedContinuation<
+    T,
+    _t<std::decay<Fs>>...>::Result>
+SemiFuture<T>::deferFused(Fs&&... funcs) && {
+  static_assert(sizeof...(Fs) > 0, "deferFused() needs a continuation");
+  using Fused = futures::detail::FusedContinuation<T, _t<std::decay<Fs>>...>;
+  using R = typename Fused::Result;
+
+  // Same executor handling as defer()
+  auto defKeepAlive = this->getExecutor()
+      ? this->getExecutor()->getKeepAliveToken()
+      : DeferredExecutor::create();
+  auto e = defKeepAlive.get();
+  DCHECK(nullptr != dynamic_cast<DeferredExecutor*>(e));
+  auto f = std::move(*this).via(e);
+
+  Promise<R> p;
+  p.core_->setInterruptHandlerNoLock(f.core_->getInterruptHandler());
+  p.core_->setCancellationTokenNoLock(f.core_->getCancellationToken());
+  SemiFuture<R> sf(p.getFuture());
+
+  // The keepAlive goes with the steps, so that it is released before the
+  // result is set, as with DeferredExecutor::wrap().
+  auto steps = [ka = std::move(defKeepAlive),
+                fused = Fused(std::forward<Fs>(funcs)...)](
+                   Try<T>&& t) mutable { return fused(std::move(t)); };
+  f.setCallback_(
+      [state = futures::detail::makeCoreCallbackState(
+           std::move(p), std::move(steps))](Try<T>&& t) mutable {
+        state.setTry(state.invoke(std::move(t)));
+      });
+
+  sf.setExecutor(e);
+  return sf;
+}
+
 template <class T>
 Future<T> Future<T>::makeEmpty() {
   return Future<T>(futures::detail::EmptyConstruct{});
@@ -611,6 +718,13 @@ inline Future<T> Future<T>::via(Executor* executor, int8_t priority) && {
   return newFuture;
 }
 
+template <class T>
+Future<T> Future<T>::withCancellation(CancellationToken token) && {
+  this->throwIfInvalid();
+  this->core_->setCancellationToken(std::move(token));
+  return std::move(*this);
+}
+
 template <class T>
 inline Future<T> Future<T>::via(Executor* executor, int8_t priority) & {
   this->throwIfInvalid();
@@ -661,6 +775,7 @@ Future<T>::onError(F&& func) {
 
   Promise<T> p;
   p.core_->setInterruptHandlerNoLock(this->core_->getInterruptHandler());
+  p.core_->setCancellationTokenNoLock(this->core_->getCancellationToken());
   auto f = p.getFuture();
 
   this->setCallback_(
@@ -1194,6 +1309,281 @@ window(Executor* executor, Collection input, F func, size_t n) {
   return futures;
 }
 
+// windowCollect and windowReduce
+
+namespace futures {
+namespace detail {
+
+// Runs func on the elements of input, at most n at a time, handing each
+// result to Derived::onResult(i, Try<Result>&&), which returns false to
+// stop starting new tasks.  When the last task is done, Derived::finish()
+// is called and the context deletes itself.  Callbacks refer to it with a
+// plain pointer, as it outlives them all.
+template <class Derived, class Collection, class F, class Result>
+class WindowDriver {
+ public:
+  WindowDriver(Executor* executor, Collection&& input, F&& func)
+      : executor_(executor), input_(std::move(input)), func_(std::move(func)) {}
+
+  size_t size() const {
+    return input_.size();
+  }
+
+  // Gives up ownership of the context.
+  void start(size_t n) {
+    size_t slots = std::min(std::max(n, size_t(1)), input_.size());
+    if (slots == 0) {
+      done();
+      return;
+    }
+    // Hold one more slot while starting, as an inline executor could
+    // finish everything before the loop is done.
+    slots_ = slots + 1;
+    for (size_t i = 0; i < slots; ++i) {
+      executor_->add([this] { spawn(); });
+    }
+    if (--slots_ == 0) {
+      done();
+    }
+  }
+
+ protected:
+  ~WindowDriver() = default;
+
+ private:
+  Derived& derived() {
+    return static_cast<Derived&>(*this);
+  }
+
+  void done() {
+    derived().finish();
+    delete &derived();
+  }
+
+  // With an inline executor and tasks that complete immediately, each
+  // task's callback starts the next one from within spawn(); rather than
+  // recursing once per element, nested calls are queued on the outermost
+  // spawn() of this context on the stack, which loops.
+  struct Trampoline {
+    const void* active;
+    size_t pending;
+  };
+
+  static Trampoline& trampoline() {
+    static FOLLY_TLS Trampoline t{nullptr, 0};
+    return t;
+  }
+
+  void spawn() {
+    auto& t = trampoline();
+    if (t.active == this) {
+      ++t.pending;
+      return;
+    }
+    auto saved = t;
+    t = Trampoline{this, 1};
+    while (t.pending != 0) {
+      --t.pending;
+      // May delete this, but only once no slot is left to queue more work.
+      spawnOne();
+    }
+    t = saved;
+  }
+
+  void spawnOne() {
+    size_t i = next_++;
+    if (i >= input_.size() || stopped_.load(std::memory_order_acquire)) {
+      // This slot has no more work.
+      if (--slots_ == 0) {
+        done();
+      }
+      return;
+    }
+    auto fut = makeFutureWith([&] { return func_(std::move(input_[i])); });
+    fut.setCallback_([this, i](Try<Result>&& t) {
+      executor_->add([this, i, t = std::move(t)]() mutable {
+        if (!derived().onResult(i, std::move(t))) {
+          stopped_.store(true, std::memory_order_release);
+        }
+        spawn();
+      });
+    });
+  }
+
+  Executor* executor_;
+  Collection input_;
+  F func_;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> slots_{0};
+  std::atomic<bool> stopped_{false};
+};
+
+template <class Collection, class F, class Result>
+class WindowCollectContext final
+    : public WindowDriver<
+          WindowCollectContext<Collection, F, Result>,
+          Collection,
+          F,
+          Result> {
+ public:
+  WindowCollectContext(Executor* executor, Collection&& input, F&& func)
+      : WindowCollectContext::WindowDriver(
+            executor,
+            std::move(input),
+            std::move(func)),
+        results_(this->size()) {}
+
+  bool onResult(size_t i, Try<Result>&& t) {
+    if (t.hasException()) {
+      if (!failed_.exchange(true)) {
+        promise_.setException(std::move(t.exception()));
+      }
+      return false;
+    }
+    results_[i] = std::move(t.value());
+    return true;
+  }
+
+  void finish() {
+    if (failed_.load()) {
+      return;
+    }
+    std::vector<Result> values;
+    values.reserve(results_.size());
+    for (auto& r : results_) {
+      values.push_back(std::move(*r));
+    }
+    promise_.setValue(std::move(values));
+  }
+
+  Promise<std::vector<Result>> promise_;
+
+ private:
+  std::vector<Optional<Result>> results_;
+  std::atomic<bool> failed_{false};
+};
+
+template <
+    class Collection,
+    class F,
+    class Result,
+    class T,
+    class R,
+    class Arg>
+class WindowReduceContext final
+    : public WindowDriver<
+          WindowReduceContext<Collection, F, Result, T, R, Arg>,
+          Collection,
+          F,
+          Result> {
+ public:
+  WindowReduceContext(
+      Executor* executor,
+      Collection&& input,
+      F&& func,
+      T&& initial,
+      R&& reducer)
+      : WindowReduceContext::WindowDriver(
+            executor,
+            std::move(input),
+            std::move(func)),
+        memo_(std::move(initial)),
+        reducer_(std::move(reducer)) {}
+
+  bool onResult(size_t /* i */, Try<Result>&& t) {
+    std::lock_guard<std::mutex> g(lock_);
+    if (memo_.hasException()) {
+      return false;
+    }
+    if (!isTry<Arg>::value && t.hasException()) {
+      memo_ = Try<T>(std::move(t.exception()));
+      return false;
+    }
+    memo_ = makeTryWith([&] {
+      return reducer_(
+          std::move(memo_.value()),
+          t.template get<isTry<Arg>::value, Arg&&>());
+    });
+    return !memo_.hasException();
+  }
+
+  void finish() {
+    promise_.setTry(std::move(memo_));
+  }
+
+  Promise<T> promise_;
+
+ private:
+  std::mutex lock_; // protects memo_ and serializes calls to reducer_
+  Try<T> memo_;
+  R reducer_;
+};
+
+} // namespace detail
+} // namespace futures
+
+template <class Collection, class F, class ItT, class Result>
+Future<std::vector<Result>>
+windowCollect(Executor* executor, Collection input, F func, size_t n) {
+  auto ctx = new futures::detail::WindowCollectContext<Collection, F, Result>(
+      executor, std::move(input), std::move(func));
+  auto f = ctx->promise_.getFuture();
+  ctx->start(n);
+  return f;
+}
+
+template <class Collection, class F, class ItT, class Result>
+Future<std::vector<Result>> windowCollect(Collection input, F func, size_t n) {
+  return windowCollect(
+      &InlineExecutor::instance(), std::move(input), std::move(func), n);
+}
+
+template <
+    class Collection,
+    class F,
+    class T,
+    class R,
+    class ItT,
+    class Result,
+    class Arg>
+Future<T> windowReduce(
+    Executor* executor,
+    Collection input,
+    F func,
+    size_t n,
+    T initial,
+    R reducer) {
+  auto ctx = new futures::detail::
+      WindowReduceContext<Collection, F, Result, T, R, Arg>(
+          executor,
+          std::move(input),
+          std::move(func),
+          std::move(initial),
+          std::move(reducer));
+  auto f = ctx->promise_.getFuture();
+  ctx->start(n);
+  return f;
+}
+
+template <
+    class Collection,
+    class F,
+    class T,
+    class R,
+    class ItT,
+    class Result,
+    class Arg>
+Future<T>
+windowReduce(Collection input, F func, size_t n, T initial, R reducer) {
+  return windowReduce(
+      &InlineExecutor::instance(),
+      std::move(input),
+      std::move(func),
+      n,
+      std::move(initial),
+      std::move(reducer));
+}
+
 // reduce
 
 template <class T>
@@ -1288,6 +1678,10 @@ Future<T> Future<T>::within(Duration dur, E e, Timekeeper* tk) {
   }
 
   std::shared_ptr<Timekeeper> tks;
+  if (LIKELY(!tk)) {
+    // Prefer the timer of the EventBase we will complete on, if any.
+    tk = folly::detail::getEventBaseTimekeeper(this->getExecutor());
+  }
   if (LIKELY(!tk)) {
     tks = folly::detail::getTimekeeperSingleton();
     tk = tks.get();
@@ -1331,6 +1725,9 @@ Future<T> Future<T>::within(Duration dur, E e, Timekeeper* tk) {
 
 template <class T>
 Future<T> Future<T>::delayed(Duration dur, Timekeeper* tk) {
+  if (LIKELY(!tk)) {
+    tk = folly::detail::getEventBaseTimekeeper(this->getExecutor());
+  }
   return collectAll(*this, futures::sleep(dur, tk))
       .then([](std::tuple<Try<T>, Try<Unit>> tup) {
         Try<T>& t = std::get<0>(tup);
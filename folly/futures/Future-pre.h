@@ -113,6 +113,11 @@ struct callableResult {
   typedef Future<typename ReturnsFuture::Inner> Return;
 };
 
+// Continuations of SemiFuture::deferFused(), composed into one callable
+// taking Try<T>&& and returning Try<Result>.
+template <class T, class... Fs>
+struct FusedContinuation;
+
 template <typename L>
 struct Extract : Extract<decltype(&L::operator())> { };
 
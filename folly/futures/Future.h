@@ -23,6 +23,7 @@
 #include <type_traits>
 #include <vector>
 
+#include <folly/CancellationToken.h>
 #include <folly/Optional.h>
 #include <folly/Portability.h>
 #include <folly/ScopeGuard.h>
@@ -305,6 +306,24 @@ class SemiFuture : private futures::detail::FutureBase<T> {
   SemiFuture<typename futures::detail::callableResult<T, F>::Return::value_type>
   defer(F&& func) &&;
 
+  /**
+   * Same as std::move(*this).defer(f1).defer(f2)...defer(fn), but fused
+   * into a single continuation: one Core and one callback for the whole
+   * chain rather than one of each per step, and when the deferred work
+   * runs, the steps execute back-to-back without going through the
+   * executor in between.  As with then(), each step can take the previous
+   * value, a Try, or nothing; unlike then(), it must return a value (or
+   * void), not a Future.
+   */
+  template <typename... Fs>
+  SemiFuture<typename futures::detail::
+                 FusedContinuation<T, _t<std::decay<Fs>>...>::Result>
+  deferFused(Fs&&... funcs) &&;
+
+  /// Tie this SemiFuture and everything chained off it to a cancellation
+  /// token. See Future::withCancellation().
+  SemiFuture<T> withCancellation(CancellationToken token) &&;
+
   // Public as for setCallback_
   // Ensure that a boostable executor performs work to chain deferred work
   // cleanly
@@ -456,6 +475,26 @@ class Future : private futures::detail::FutureBase<T> {
       Executor* executor,
       int8_t priority = Executor::MID_PRI) &;
 
+  /// Tie this Future and everything chained off it to a cancellation token.
+  /// Once cancellation is requested on the token:
+  ///
+  /// - FutureCancellation is raised on this Future, as with cancel(), so the
+  ///   promise holder's interrupt handler can stop the work.
+  /// - Continuations added afterwards with then() inherit the token. One that
+  ///   takes a value (not a Try) and has not started yet is skipped, and its
+  ///   Future completes with FutureCancellation. Continuations taking a Try,
+  ///   such as ensure() and onError(), still run.
+  /// - A Future returned by a continuation gets the token too, so the
+  ///   interrupt reaches the nested work.
+  ///
+  ///   auto f = fetch(key)
+  ///       .withCancellation(source.getToken())
+  ///       .then([](Response r) { return parse(r); });
+  ///   source.requestCancellation(); // fetch is interrupted, parse skipped
+  ///
+  /// A default-constructed token costs nothing beyond storing it.
+  Future<T> withCancellation(CancellationToken token) &&;
+
   /** When this Future has completed, execute func which is a function that
     takes one of:
       (const) Try<T>&&
@@ -633,6 +672,11 @@ class Future : private futures::detail::FutureBase<T> {
 
   /// Delay the completion of this Future for at least this duration from
   /// now. The optional Timekeeper is as with futures::sleep().
+  ///
+  /// If no Timekeeper is passed to within(), onTimeout() or delayed() and
+  /// this Future's executor is an EventBase, the timeout is scheduled on
+  /// that EventBase's HHWheelTimer (see EventBaseTimekeeper) rather than on
+  /// the global timekeeper thread.
   Future<T> delayed(Duration, Timekeeper* = nullptr);
 
   /// Block until the future is fulfilled. Returns the value (moved out), or
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/futures/Hedging.h>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace folly {
+namespace futures {
+
+HedgeDelay::HedgeDelay(
+    double quantile,
+    Duration initialDelay,
+    Clock::duration window,
+    size_t numBuckets)
+    : quantile_(quantile),
+      initialDelay_(initialDelay),
+      minSamples_(quantile < 1 ? std::round(1 / (1 - quantile)) : 1),
+      latencies_(
+          in_place,
+          numBuckets,
+          std::initializer_list<Clock::duration>{window}) {
+  if (!(quantile > 0 && quantile <= 1)) {
+    throw std::invalid_argument("HedgeDelay: quantile must be in (0, 1]");
+  }
+}
+
+void HedgeDelay::addLatency(Clock::time_point now, Clock::duration latency) {
+  using Millis = std::chrono::duration<double, std::milli>;
+  latencies_.wlock()->addValue(
+      now, std::chrono::duration_cast<Millis>(latency).count());
+}
+
+Duration HedgeDelay::get(Clock::time_point now) {
+  auto digest = [&] {
+    auto latencies = latencies_.wlock();
+    latencies->update(now);
+    return latencies->getDigest(size_t(0));
+  }();
+  if (digest.count() < minSamples_) {
+    return initialDelay_;
+  }
+  auto millis = std::ceil(digest.estimateQuantile(quantile_));
+  return Duration(Duration::rep(millis));
+}
+
+} // namespace futures
+} // namespace folly
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include <folly/Optional.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
+#include <folly/stats/MultiLevelTDigest.h>
+
+namespace folly {
+namespace futures {
+
+/**
+ *  HedgeDelay
+ *
+ *  Tracks the latencies of a kind of request over a sliding window, and
+ *  suggests how long to wait before hedging one: a high quantile of the
+ *  recent latencies (the p95 by default), so that only the slowest few
+ *  percent of the requests cost a second one.
+ *
+ *  Until the window holds enough latencies for the quantile to mean
+ *  something (1 / (1 - quantile) of them, i.e. 20 for the p95),
+ *  initialDelay is used.
+ *
+ *  This class is thread-safe.
+ */
+class HedgeDelay {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit HedgeDelay(
+      double quantile = 0.95,
+      Duration initialDelay = Duration(100),
+      Clock::duration window = std::chrono::seconds(60),
+      size_t numBuckets = 6);
+
+  void addLatency(Clock::duration latency) {
+    addLatency(Clock::now(), latency);
+  }
+  void addLatency(Clock::time_point now, Clock::duration latency);
+
+  /// The delay after which to hedge a request, rounded up to the
+  /// millisecond.
+  Duration get() {
+    return get(Clock::now());
+  }
+  Duration get(Clock::time_point now);
+
+ private:
+  const double quantile_;
+  const Duration initialDelay_;
+  const double minSamples_;
+  Synchronized<MultiLevelTDigest<Clock>> latencies_;
+};
+
+/**
+ *  hedged
+ *
+ *  Hedges a request: calls ff(0) and, if it hasn't completed after delay,
+ *  ff(1) as well. The first attempt that completes with a value completes
+ *  the returned future, and FutureCancellation is raised on the other one,
+ *  so that its promise holder can stop the work.
+ *
+ *  If an attempt fails before the delay, the hedge starts right away. The
+ *  returned future only fails once both attempts have, with the exception
+ *  of the last one.
+ *
+ *  The hedge is started on the Timekeeper's thread (or by the callback of
+ *  the failed first attempt), so ff must be callable from any thread, and
+ *  outlive both calls.
+ */
+template <class FF>
+typename std::result_of<FF(size_t)>::type hedged(Duration delay, FF&& ff);
+
+/**
+ *  As above, waiting hedgeDelay->get() before hedging. Once the returned
+ *  future completes with a value, the time since the call to hedged() is
+ *  added to hedgeDelay: the latency of the hedged request as a whole, once
+ *  per request, whichever attempt won.
+ */
+template <class FF>
+typename std::result_of<FF(size_t)>::type hedged(
+    std::shared_ptr<HedgeDelay> hedgeDelay,
+    FF&& ff);
+
+namespace detail {
+
+template <class T, class FF>
+class Hedge : public std::enable_shared_from_this<Hedge<T, FF>> {
+ public:
+  explicit Hedge(FF&& ff) : ff_(std::forward<FF>(ff)) {}
+
+  Future<T> start(Duration delay) {
+    auto f = promise_.getFuture();
+    launch(0);
+    if (done_.load(std::memory_order_acquire)) {
+      return f;
+    }
+    auto timer = futures::sleep(delay);
+    auto self = this->shared_from_this();
+    timer.setCallback_([self](Try<Unit>&& t) {
+      if (t.hasValue() && !self->done_.load(std::memory_order_acquire) &&
+          !self->hedgeStarted_.exchange(true)) {
+        self->launch(1);
+      }
+    });
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (done_.load(std::memory_order_acquire)) {
+      lock.unlock();
+      timer.cancel();
+    } else {
+      timer_ = std::move(timer);
+    }
+    return f;
+  }
+
+ private:
+  void launch(size_t i) {
+    auto self = this->shared_from_this();
+    auto f = makeFutureWith([&] { return ff_(i); });
+    f.setCallback_(
+        [self, i](Try<T>&& t) { self->complete(i, std::move(t)); });
+    // Store the attempt to cancel it later, unless the other one has won
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (done_.load(std::memory_order_acquire)) {
+      lock.unlock();
+      f.cancel();
+    } else {
+      attempts_[i] = std::move(f);
+    }
+  }
+
+  void complete(size_t i, Try<T>&& t) {
+    if (t.hasValue()) {
+      if (!done_.exchange(true)) {
+        cancelPending();
+        promise_.setTry(std::move(t));
+      }
+      return;
+    }
+    auto failures = ++failures_;
+    if (i == 0 && !hedgeStarted_.exchange(true)) {
+      launch(1);
+    } else if (failures == 2 && !done_.exchange(true)) {
+      cancelPending();
+      promise_.setTry(std::move(t));
+    }
+  }
+
+  // Cancels the attempts and the timer, before the result is set so that
+  // the loser is cancelled by the time the caller sees it. The callbacks of
+  // the attempts may run inline, so this doesn't hold the lock while
+  // raising.
+  void cancelPending() {
+    Optional<Future<T>> attempts[2];
+    Optional<Future<Unit>> timer;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      attempts[0] = std::move(attempts_[0]);
+      attempts[1] = std::move(attempts_[1]);
+      timer = std::move(timer_);
+      attempts_[0].clear();
+      attempts_[1].clear();
+      timer_.clear();
+    }
+    for (auto& attempt : attempts) {
+      if (attempt) {
+        attempt->cancel();
+      }
+    }
+    if (timer) {
+      timer->cancel();
+    }
+  }
+
+  typename std::decay<FF>::type ff_;
+  Promise<T> promise_;
+  std::atomic<bool> done_{false};
+  std::atomic<bool> hedgeStarted_{false};
+  std::atomic<size_t> failures_{0};
+  std::mutex mutex_; // guards attempts_ and timer_
+  Optional<Future<T>> attempts_[2];
+  Optional<Future<Unit>> timer_;
+};
+
+} // namespace detail
+
+template <class FF>
+typename std::result_of<FF(size_t)>::type hedged(Duration delay, FF&& ff) {
+  using F = typename std::result_of<FF(size_t)>::type;
+  using T = typename F::value_type;
+  auto hedge = std::make_shared<detail::Hedge<T, FF>>(std::forward<FF>(ff));
+  return hedge->start(delay);
+}
+
+template <class FF>
+typename std::result_of<FF(size_t)>::type hedged(
+    std::shared_ptr<HedgeDelay> hedgeDelay,
+    FF&& ff) {
+  using F = typename std::result_of<FF(size_t)>::type;
+  using T = typename F::value_type;
+  auto start = HedgeDelay::Clock::now();
+  auto delay = hedgeDelay->get(start);
+  return hedged(delay, std::forward<FF>(ff))
+      .then([hedgeDelay = std::move(hedgeDelay), start](Try<T>&& t) {
+        if (t.hasValue()) {
+          auto now = HedgeDelay::Clock::now();
+          hedgeDelay->addLatency(now, now - start);
+        }
+        return makeFuture<T>(std::move(t));
+      });
+}
+
+} // namespace futures
+} // namespace folly
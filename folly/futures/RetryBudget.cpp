@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/futures/RetryBudget.h>
+
+#include <stdexcept>
+
+namespace folly {
+namespace futures {
+
+RetryBudget::RetryBudget(
+    double retryRatio,
+    size_t minRetriesPerWindow,
+    Duration window,
+    size_t numBuckets)
+    : retryRatio_(retryRatio),
+      minRetries_(minRetriesPerWindow),
+      counts_(in_place, numBuckets, window) {
+  if (!(retryRatio >= 0)) {
+    throw std::invalid_argument("RetryBudget: retryRatio must be >= 0");
+  }
+  if (window.count() <= 0) {
+    throw std::invalid_argument("RetryBudget: window must be > 0");
+  }
+}
+
+size_t RetryBudget::availableLocked(Counts& counts, TimePoint now) const {
+  counts.successes.update(now);
+  counts.retries.update(now);
+  auto allowed = uint64_t(retryRatio_ * double(counts.successes.count())) +
+      minRetries_;
+  auto used = counts.retries.count();
+  return used < allowed ? size_t(allowed - used) : 0;
+}
+
+void RetryBudget::recordSuccess(TimePoint now) {
+  counts_.wlock()->successes.addValue(now, 1);
+}
+
+bool RetryBudget::tryAcquireRetry(TimePoint now) {
+  auto counts = counts_.wlock();
+  if (availableLocked(*counts, now) == 0) {
+    return false;
+  }
+  counts->retries.addValue(now, 1);
+  return true;
+}
+
+size_t RetryBudget::available(TimePoint now) {
+  return availableLocked(*counts_.wlock(), now);
+}
+
+uint64_t RetryBudget::successes(TimePoint now) {
+  auto counts = counts_.wlock();
+  counts->successes.update(now);
+  return counts->successes.count();
+}
+
+uint64_t RetryBudget::retries(TimePoint now) {
+  auto counts = counts_.wlock();
+  counts->retries.update(now);
+  return counts->retries.count();
+}
+
+} // namespace futures
+} // namespace folly
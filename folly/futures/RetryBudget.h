@@ -0,0 +1,100 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <folly/Synchronized.h>
+#include <folly/stats/BucketedTimeSeries.h>
+
+namespace folly {
+namespace futures {
+
+/**
+ *  RetryBudget
+ *
+ *  Caps the retries of the requests that share it at a fraction of their
+ *  recent successes, plus a floor so that a client with little traffic can
+ *  still retry.
+ *
+ *  Per-request retry limits don't protect a struggling backend: when every
+ *  request fails, each one is tried max_tries times, and each layer of a
+ *  stack that retries multiplies the load again. With a budget shared by
+ *  all the callers of a backend, retries stop once they reach retryRatio of
+ *  the successes, so an outage adds at most that much load.
+ *
+ *  Successes and retries are counted over a sliding window of the given
+ *  duration, in BucketedTimeSeries of numBuckets buckets.
+ *
+ *  Use it with retryingPolicyWithBudget() or retryingWithBudget(), in
+ *  Retrying.h. This class is thread-safe.
+ */
+class RetryBudget {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = Clock::duration;
+  using TimePoint = Clock::time_point;
+
+  explicit RetryBudget(
+      double retryRatio = 0.1,
+      size_t minRetriesPerWindow = 10,
+      Duration window = std::chrono::seconds(10),
+      size_t numBuckets = 10);
+
+  /// Counts a successful request.
+  void recordSuccess() {
+    recordSuccess(Clock::now());
+  }
+  void recordSuccess(TimePoint now);
+
+  /// Takes a retry from the budget, if there is one left; returns false if
+  /// the request should fail instead.
+  bool tryAcquireRetry() {
+    return tryAcquireRetry(Clock::now());
+  }
+  bool tryAcquireRetry(TimePoint now);
+
+  /// The number of retries that tryAcquireRetry() would allow right now.
+  size_t available() {
+    return available(Clock::now());
+  }
+  size_t available(TimePoint now);
+
+  /// Successes and retries counted in the current window.
+  uint64_t successes(TimePoint now);
+  uint64_t retries(TimePoint now);
+
+ private:
+  struct Counts {
+    Counts(size_t numBuckets, Duration window)
+        : successes(numBuckets, window), retries(numBuckets, window) {}
+
+    BucketedTimeSeries<int64_t, Clock> successes;
+    BucketedTimeSeries<int64_t, Clock> retries;
+  };
+
+  size_t availableLocked(Counts& counts, TimePoint now) const;
+
+  const double retryRatio_;
+  const size_t minRetries_;
+  Synchronized<Counts> counts_;
+};
+
+} // namespace futures
+} // namespace folly
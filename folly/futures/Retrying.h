@@ -18,6 +18,7 @@
 
 #include <folly/Random.h>
 #include <folly/futures/Future.h>
+#include <folly/futures/RetryBudget.h>
 
 namespace folly {
 namespace futures {
@@ -223,6 +224,32 @@ retryingPolicyCappedJitteredExponentialBackoff(
       std::forward<Policy>(p));
 }
 
+template <class Policy>
+std::function<Future<bool>(size_t, const exception_wrapper&)>
+retryingPolicyWithBudget(
+    std::shared_ptr<RetryBudget> budget,
+    Policy&& p,
+    retrying_policy_fut_tag) {
+  return [budget = std::move(budget), pm = std::forward<Policy>(p)](
+             size_t n, const exception_wrapper& ex) mutable {
+    return pm(n, ex).then([budget](bool v) {
+      return v && budget->tryAcquireRetry();
+    });
+  };
+}
+
+template <class Policy>
+std::function<Future<bool>(size_t, const exception_wrapper&)>
+retryingPolicyWithBudget(
+    std::shared_ptr<RetryBudget> budget,
+    Policy&& p,
+    retrying_policy_raw_tag) {
+  return [budget = std::move(budget), pm = std::forward<Policy>(p)](
+             size_t n, const exception_wrapper& ex) mutable {
+    return makeFuture(pm(n, ex) && budget->tryAcquireRetry());
+  };
+}
+
 } // namespace detail
 
 template <class Policy, class FF>
@@ -272,5 +299,51 @@ retryingPolicyCappedJitteredExponentialBackoff(
       std::move(p));
 }
 
+/**
+ *  retryingPolicyWithBudget
+ *
+ *  Wraps a policy so that each retry it asks for must also be taken from a
+ *  RetryBudget shared with other requests. Once the budget is spent, the
+ *  most recent exception is final, whatever the policy says; the budget is
+ *  only asked once the policy wants to retry (and, for a backoff policy,
+ *  has slept), so it counts actual retries.
+ *
+ *  The budget must also count the successes of the requests that share it:
+ *  use retryingWithBudget(), or call budget->recordSuccess().
+ */
+template <class Policy>
+std::function<Future<bool>(size_t, const exception_wrapper&)>
+retryingPolicyWithBudget(std::shared_ptr<RetryBudget> budget, Policy&& p) {
+  using tag = typename detail::retrying_policy_traits<Policy>::tag;
+  return detail::retryingPolicyWithBudget(
+      std::move(budget), std::forward<Policy>(p), tag());
+}
+
+/**
+ *  retryingWithBudget
+ *
+ *  retrying() with retryingPolicyWithBudget(budget, p), which also records
+ *  the successful attempts in the budget.
+ */
+template <class Policy, class FF>
+typename std::result_of<FF(size_t)>::type
+retryingWithBudget(std::shared_ptr<RetryBudget> budget, Policy&& p, FF&& ff) {
+  using F = typename std::result_of<FF(size_t)>::type;
+  using T = typename F::value_type;
+  auto q = retryingPolicyWithBudget(budget, std::forward<Policy>(p));
+  return retrying(
+      std::move(q),
+      [budget = std::move(budget), ffm = std::forward<FF>(ff)](
+          size_t n) mutable {
+        return makeFutureWith([&] { return ffm(n); })
+            .then([budget](Try<T>&& t) {
+              if (t.hasValue()) {
+                budget->recordSuccess();
+              }
+              return makeFuture<T>(std::move(t));
+            });
+      });
+}
+
 } // namespace futures
 } // namespace folly
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <folly/futures/Future.h>
+#include <folly/futures/SharedPromise.h>
+#include <folly/hash/Hash.h>
+
+namespace folly {
+
+/*
+ * Singleflight coalesces concurrent calls for the same key: while a call for
+ * a key is in flight, get() hands further callers for that key a SemiFuture
+ * of its result instead of making another call.  This keeps a herd of
+ * requests missing a cache for the same key (e.g. after a flush) from all
+ * hitting the backend.
+ *
+ *   Singleflight<std::string, Value> flight;
+ *   auto value = flight.get(key, [&] { return backend.fetch(key); });
+ *
+ * Results aren't kept once delivered, as caching them is the cache's job;
+ * failures however can be kept for failureTtl, so that callers don't retry a
+ * failing backend over and over.
+ *
+ * Keys are spread over shards, each with its own lock, held only to look up
+ * and update its map: funcs run, and futures are fulfilled, outside of them.
+ * Calling get() from fibers is fine, and waiting on the SemiFuture from a
+ * fiber suspends the fiber, not the thread.
+ *
+ * The Singleflight must outlive the calls it has in flight.
+ */
+template <
+    class Key,
+    class T,
+    class Hash = std::hash<Key>,
+    class KeyEqual = std::equal_to<Key>>
+class Singleflight {
+ public:
+  explicit Singleflight(
+      std::chrono::milliseconds failureTtl = std::chrono::milliseconds(0),
+      size_t numShards = 16)
+      : failureTtl_(failureTtl),
+        numShards_(std::max(numShards, size_t(1))),
+        shards_(new Shard[numShards_]) {}
+
+  Singleflight(const Singleflight&) = delete;
+  Singleflight& operator=(const Singleflight&) = delete;
+
+  /**
+   * Returns the result of the call in flight for key, or of the failed call
+   * for key within failureTtl; or else calls func(), which returns a T or a
+   * Future<T>, and returns its result.
+   */
+  template <class F>
+  SemiFuture<T> get(const Key& key, F&& func) {
+    auto& shard = shardFor(key);
+    std::shared_ptr<SharedPromise<T>> promise;
+    bool leader = false;
+    {
+      std::lock_guard<std::mutex> g(shard.mutex);
+      auto& entry = shard.calls[key];
+      if (!entry.promise ||
+          (entry.failed && entry.expiry <= std::chrono::steady_clock::now())) {
+        entry.promise = std::make_shared<SharedPromise<T>>();
+        entry.failed = false;
+        leader = true;
+      }
+      promise = entry.promise;
+    }
+
+    auto future = promise->getFuture();
+    if (leader) {
+      makeFutureWith(std::forward<F>(func))
+          .then([this, key, promise](Try<T>&& t) {
+            finish(key, promise, std::move(t));
+          });
+    }
+    return future.semi();
+  }
+
+  /**
+   * Forgets the failure kept for key, if any, so that the next get() for it
+   * makes a call.  A call in flight for key isn't affected.
+   */
+  void forget(const Key& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> g(shard.mutex);
+    auto it = shard.calls.find(key);
+    if (it != shard.calls.end() && it->second.failed) {
+      shard.calls.erase(it);
+    }
+  }
+
+  /**
+   * The number of keys with a call in flight, or a failure kept.
+   */
+  size_t size() const {
+    size_t size = 0;
+    for (size_t i = 0; i < numShards_; ++i) {
+      std::lock_guard<std::mutex> g(shards_[i].mutex);
+      size += shards_[i].calls.size();
+    }
+    return size;
+  }
+
+ private:
+  struct Call {
+    std::shared_ptr<SharedPromise<T>> promise;
+    // Only set once a call failed and its failure is being kept
+    bool failed{false};
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Call, Hash, KeyEqual> calls;
+  };
+
+  Shard& shardFor(const Key& key) {
+    // Mixed, as the map picks its buckets from the same hash
+    return shards_[hash::twang_mix64(Hash()(key)) % numShards_];
+  }
+
+  void finish(
+      const Key& key,
+      const std::shared_ptr<SharedPromise<T>>& promise,
+      Try<T>&& t) {
+    {
+      auto& shard = shardFor(key);
+      std::lock_guard<std::mutex> g(shard.mutex);
+      auto it = shard.calls.find(key);
+      if (it != shard.calls.end() && it->second.promise == promise) {
+        if (t.hasException() && failureTtl_.count() > 0) {
+          it->second.failed = true;
+          it->second.expiry = std::chrono::steady_clock::now() + failureTtl_;
+        } else {
+          shard.calls.erase(it);
+        }
+      }
+    }
+    promise->setTry(std::move(t));
+  }
+
+  const std::chrono::milliseconds failureTtl_;
+  const size_t numShards_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace folly
@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include <folly/CancellationToken.h>
 #include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/MicroSpinLock.h>
@@ -32,6 +33,7 @@
 #include <folly/futures/FutureException.h>
 #include <folly/futures/detail/FSM.h>
 #include <folly/portability/BitsFunctexcept.h>
+#include <folly/tracing/StaticTracepoint.h>
 
 #include <folly/io/async/Request.h>
 
@@ -101,6 +103,8 @@ class Core final {
 
   ~Core() {
     DCHECK(attached_ == 0);
+    // Waits out a raiseCancellation() running on another thread.
+    cancellationCallback_.reset();
   }
 
   // not copyable
@@ -173,6 +177,7 @@ class Core final {
 
   /// Call only from Promise thread
   void setResult(Try<T>&& t) {
+    FOLLY_SDT(folly, future_fulfil, this, t.hasException());
     bool transitionToArmed = false;
     auto setResult_ = [&]{ result_ = std::move(t); };
     FSM_START(fsm_)
@@ -292,6 +297,28 @@ class Core final {
     interruptHandler_ = std::move(fn);
   }
 
+  /// Call only from Future thread. Attaches the token to this Core, and
+  /// raises FutureCancellation on it once cancellation is requested (which
+  /// may be right away).
+  void setCancellationToken(CancellationToken token) {
+    cancellationCallback_.reset();
+    cancellationToken_ = std::move(token);
+    if (!hasResult() && cancellationToken_.canBeCancelled()) {
+      cancellationCallback_ = std::make_unique<CancellationCallback>(
+          cancellationToken_, [this] { raiseCancellation(); });
+    }
+  }
+
+  /// Attaches the token without registering for cancellation; used to pass
+  /// a token on to the Core of a continuation.
+  void setCancellationTokenNoLock(CancellationToken const& token) {
+    cancellationToken_ = token;
+  }
+
+  CancellationToken const& getCancellationToken() const {
+    return cancellationToken_;
+  }
+
  private:
   // Helper class that stores a pointer to the `Core` object and calls
   // `derefCallback` and `detachOne` in the destructor.
@@ -368,7 +395,7 @@ class Core final {
           x->add([core_ref = std::move(guard_lambda)]() mutable {
             auto cr = std::move(core_ref);
             Core* const core = cr.getCore();
-            RequestContextScopeGuard rctx(core->context_);
+            RequestContextScopeGuard rctx(std::move(core->context_));
             core->callback_(std::move(*core->result_));
           });
         } else {
@@ -376,7 +403,7 @@ class Core final {
               [core_ref = std::move(guard_lambda)]() mutable {
                 auto cr = std::move(core_ref);
                 Core* const core = cr.getCore();
-                RequestContextScopeGuard rctx(core->context_);
+                RequestContextScopeGuard rctx(std::move(core->context_));
                 core->callback_(std::move(*core->result_));
               },
               priority);
@@ -397,11 +424,25 @@ class Core final {
         callback_ = {};
         detachOne();
       };
-      RequestContextScopeGuard rctx(context_);
+      RequestContextScopeGuard rctx(std::move(context_));
       callback_(std::move(*result_));
     }
   }
 
+  // Runs on the thread requesting cancellation. Holds a reference for the
+  // duration of raise(), unless the Core is already being destroyed.
+  void raiseCancellation() {
+    auto a = attached_.load(std::memory_order_relaxed);
+    do {
+      if (a == 0) {
+        return;
+      }
+    } while (!attached_.compare_exchange_weak(
+        a, static_cast<unsigned char>(a + 1)));
+    raise(make_exception_wrapper<FutureCancellation>());
+    detachOne();
+  }
+
   void detachOne() {
     auto a = attached_--;
     assert(a >= 1);
@@ -432,6 +473,8 @@ class Core final {
   std::shared_ptr<RequestContext> context_ {nullptr};
   std::unique_ptr<exception_wrapper> interrupt_ {};
   std::function<void(exception_wrapper const&)> interruptHandler_ {nullptr};
+  CancellationToken cancellationToken_;
+  std::unique_ptr<CancellationCallback> cancellationCallback_;
 };
 
 template <template <typename...> class T, typename... Ts>
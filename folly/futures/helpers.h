@@ -404,6 +404,31 @@ template <
 std::vector<Future<Result>>
 window(Executor* executor, Collection input, F func, size_t n);
 
+/** windowCollect is collect(window(executor, input, func, n)) without the
+    per-element Promise and Future pairs: one context holds the input, the
+    results and a single Promise, and tasks are started as slots free up.
+
+    Like collect(), the result fails with the first exception, and no
+    further tasks are started once it does; tasks already in flight finish
+    first.  n == 0 is treated as 1, here and in windowReduce.
+  */
+template <
+    class Collection,
+    class F,
+    class ItT = typename std::iterator_traits<
+        typename Collection::iterator>::value_type,
+    class Result = typename futures::detail::resultOf<F, ItT&&>::value_type>
+Future<std::vector<Result>>
+windowCollect(Executor* executor, Collection input, F func, size_t n);
+
+template <
+    class Collection,
+    class F,
+    class ItT = typename std::iterator_traits<
+        typename Collection::iterator>::value_type,
+    class Result = typename futures::detail::resultOf<F, ItT&&>::value_type>
+Future<std::vector<Result>> windowCollect(Collection input, F func, size_t n);
+
 template <typename F, typename T, typename ItT>
 using MaybeTryArg = typename std::conditional<
     futures::detail::callableWith<F, T&&, Try<ItT>&&>::value,
@@ -449,6 +474,45 @@ template <
     class Arg = MaybeTryArg<F, T, ItT>>
 Future<T> unorderedReduce(It first, It last, T initial, F func);
 
+/** windowReduce runs func on the elements of input like window(), at most
+    n at a time, and folds each result into initial as it completes:
+    reducer(T&& memo, Result&&) or reducer(T&& memo, Try<Result>&&), in
+    completion order.  The next task starts as soon as a slot frees up, and
+    no per-element Promise or Future is kept.
+
+    The result fails with the first exception (from func, from a task when
+    reducer takes a value, or from reducer itself), after which no further
+    tasks are started.
+  */
+template <
+    class Collection,
+    class F,
+    class T,
+    class R,
+    class ItT = typename std::iterator_traits<
+        typename Collection::iterator>::value_type,
+    class Result = typename futures::detail::resultOf<F, ItT&&>::value_type,
+    class Arg = MaybeTryArg<R, T, Result>>
+Future<T> windowReduce(
+    Executor* executor,
+    Collection input,
+    F func,
+    size_t n,
+    T initial,
+    R reducer);
+
+template <
+    class Collection,
+    class F,
+    class T,
+    class R,
+    class ItT = typename std::iterator_traits<
+        typename Collection::iterator>::value_type,
+    class Result = typename futures::detail::resultOf<F, ItT&&>::value_type,
+    class Arg = MaybeTryArg<R, T, Result>>
+Future<T>
+windowReduce(Collection input, F func, size_t n, T initial, R reducer);
+
 /// Sugar for the most common case
 template <class Collection, class T, class F>
 auto unorderedReduce(Collection&& c, T&& initial, F&& func)
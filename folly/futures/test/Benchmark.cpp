@@ -82,6 +82,58 @@ BENCHMARK_RELATIVE(hundredThens) {
   someThens(100);
 }
 
+// deferred continuations, one step at a time and fused
+BENCHMARK_DRAW_LINE()
+
+// defer() needs a functor with a non-template operator()
+auto deferIncr = [](Try<int>&& t) { return t.value() + 1; };
+
+BENCHMARK(fourDefers) {
+  Promise<int> p;
+  auto sf = p.getFuture()
+                .semi()
+                .defer(deferIncr)
+                .defer(deferIncr)
+                .defer(deferIncr)
+                .defer(deferIncr);
+  p.setValue(42);
+  folly::doNotOptimizeAway(std::move(sf).get());
+}
+
+BENCHMARK_RELATIVE(fourDefersFused) {
+  Promise<int> p;
+  auto sf = p.getFuture().semi().deferFused(
+      deferIncr, deferIncr, deferIncr, deferIncr);
+  p.setValue(42);
+  folly::doNotOptimizeAway(std::move(sf).get());
+}
+
+// fan-out of 1000 calls, at most 16 in flight; the results are collected
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(collectWindow) {
+  std::vector<int> input(1000);
+  folly::doNotOptimizeAway(
+      collect(window(input, [](int i) { return makeFuture(i); }, 16)).get());
+}
+
+BENCHMARK_RELATIVE(windowCollect) {
+  std::vector<int> input(1000);
+  folly::doNotOptimizeAway(
+      windowCollect(input, [](int i) { return makeFuture(i); }, 16).get());
+}
+
+BENCHMARK_RELATIVE(windowReduce) {
+  std::vector<int> input(1000);
+  auto f = windowReduce(
+      input,
+      [](int i) { return makeFuture(i); },
+      16,
+      0,
+      [](int sum, int b) { return sum + b; });
+  folly::doNotOptimizeAway(f.get());
+}
+
 // Lock contention. Although in practice fulfills tend to be temporally
 // separate from then()s, still sometimes they will be concurrent. So the
 // higher this number is, the better.
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+
+#include <folly/CancellationToken.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(Cancellation, raisesInterrupt) {
+  CancellationSource source;
+  Promise<int> p;
+  bool interrupted = false;
+  p.setInterruptHandler([&](const exception_wrapper& e) {
+    EXPECT_TRUE(e.is_compatible_with<FutureCancellation>());
+    interrupted = true;
+  });
+  auto f = p.getFuture().withCancellation(source.getToken());
+  EXPECT_FALSE(interrupted);
+  source.requestCancellation();
+  EXPECT_TRUE(interrupted);
+}
+
+TEST(Cancellation, alreadyCancelled) {
+  CancellationSource source;
+  source.requestCancellation();
+  Promise<int> p;
+  bool interrupted = false;
+  p.setInterruptHandler([&](const exception_wrapper&) { interrupted = true; });
+  auto f = p.getFuture().withCancellation(source.getToken());
+  EXPECT_TRUE(interrupted);
+}
+
+TEST(Cancellation, defaultToken) {
+  Promise<int> p;
+  bool interrupted = false;
+  p.setInterruptHandler([&](const exception_wrapper&) { interrupted = true; });
+  auto f = p.getFuture().withCancellation(CancellationToken()).then(
+      [](int i) { return i + 1; });
+  p.setValue(1);
+  EXPECT_FALSE(interrupted);
+  EXPECT_EQ(2, f.value());
+}
+
+TEST(Cancellation, skipsValueContinuations) {
+  CancellationSource source;
+  Promise<int> p;
+  bool ran = false;
+  bool ensured = false;
+  auto f = p.getFuture()
+               .withCancellation(source.getToken())
+               .then([&](int i) {
+                 ran = true;
+                 return i;
+               })
+               .ensure([&] { ensured = true; });
+  source.requestCancellation();
+  // The producer ignores the interrupt and completes anyway.
+  p.setValue(1);
+  EXPECT_FALSE(ran);
+  EXPECT_TRUE(ensured);
+  EXPECT_THROW(f.value(), FutureCancellation);
+}
+
+TEST(Cancellation, runsContinuationsStartedBefore) {
+  CancellationSource source;
+  Promise<int> p;
+  auto f = p.getFuture()
+               .withCancellation(source.getToken())
+               .then([&](int i) {
+                 source.requestCancellation();
+                 return i + 1;
+               })
+               .then([](int i) { return i + 1; })
+               .onError([](const FutureCancellation&) { return -1; });
+  p.setValue(1);
+  EXPECT_EQ(-1, f.value());
+}
+
+TEST(Cancellation, reachesNestedFuture) {
+  CancellationSource source;
+  Promise<Unit> outer;
+  Promise<int> inner;
+  bool innerInterrupted = false;
+  inner.setInterruptHandler([&](const exception_wrapper& e) {
+    innerInterrupted = true;
+    inner.setException(e);
+  });
+  auto f = outer.getFuture()
+               .withCancellation(source.getToken())
+               .then([&] { return inner.getFuture(); });
+  outer.setValue();
+  EXPECT_FALSE(f.isReady());
+
+  source.requestCancellation();
+  EXPECT_TRUE(innerInterrupted);
+  ASSERT_TRUE(f.isReady());
+  EXPECT_THROW(f.value(), FutureCancellation);
+}
+
+TEST(Cancellation, semiFuture) {
+  CancellationSource source;
+  Promise<int> p;
+  bool interrupted = false;
+  p.setInterruptHandler([&](const exception_wrapper&) { interrupted = true; });
+  bool ran = false;
+  auto sf = SemiFuture<int>(p.getFuture())
+                .withCancellation(source.getToken())
+                .defer([&](int i) {
+                  ran = true;
+                  return i;
+                });
+  source.requestCancellation();
+  EXPECT_TRUE(interrupted);
+  p.setValue(1);
+  EXPECT_THROW(std::move(sf).get(), FutureCancellation);
+  EXPECT_FALSE(ran);
+}
+
+TEST(Cancellation, chainOutlivedBySource) {
+  CancellationSource source;
+  {
+    Promise<int> p;
+    auto f = p.getFuture().withCancellation(source.getToken()).then(
+        [](int i) { return i; });
+    p.setValue(1);
+    EXPECT_EQ(1, f.value());
+  }
+  source.requestCancellation();
+}
+
+TEST(Cancellation, crossThread) {
+  for (int i = 0; i < 100; ++i) {
+    CancellationSource source;
+    Promise<int> p;
+    p.setInterruptHandler(
+        [&](const exception_wrapper& e) { p.setException(e); });
+    auto f = p.getFuture().withCancellation(source.getToken());
+    std::thread t([&] { source.requestCancellation(); });
+    f.wait();
+    t.join();
+    EXPECT_THROW(f.value(), FutureCancellation);
+  }
+}
@@ -369,6 +369,28 @@ TEST(Future, onError) {
 
 }
 
+namespace {
+struct ErrorCode {
+  int code;
+};
+struct CodedError : std::runtime_error, ErrorCode {
+  explicit CodedError(int c) : std::runtime_error("coded"), ErrorCode{c} {}
+};
+} // namespace
+
+TEST(Future, onErrorNonStdBase) {
+  // Matched against the std::exception with dynamic_cast, not by throwing
+  auto f = makeFuture<int>(CodedError(5))
+               .onError([](std::logic_error&) { return 1; })
+               .onError([](ErrorCode& e) { return e.code; });
+  EXPECT_EQ(5, f.value());
+
+  Promise<int> p;
+  auto f2 = p.getFuture().onError([](ErrorCode const& e) { return e.code; });
+  p.setException(make_exception_wrapper<CodedError>(6));
+  EXPECT_EQ(6, f2.value());
+}
+
 TEST(Future, special) {
   EXPECT_FALSE(std::is_copy_constructible<Future<int>>::value);
   EXPECT_FALSE(std::is_copy_assignable<Future<int>>::value);
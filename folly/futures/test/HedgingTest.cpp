@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/futures/Hedging.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+namespace {
+
+// A request that completes when the test says so, or fails with the
+// interrupt once cancelled
+struct PendingRequest {
+  PendingRequest() {
+    promise.setInterruptHandler([this](const exception_wrapper& e) {
+      cancelled = true;
+      promise.setException(e);
+    });
+  }
+
+  Promise<int> promise;
+  std::atomic<bool> cancelled{false};
+};
+
+} // namespace
+
+TEST(Hedging, fastFirstAttempt) {
+  std::atomic<size_t> calls{0};
+  auto f = futures::hedged(Duration(10), [&](size_t n) {
+    ++calls;
+    return makeFuture(int(n));
+  });
+  EXPECT_EQ(0, f.value());
+  /* sleep override */ std::this_thread::sleep_for(milliseconds(50));
+  EXPECT_EQ(1, calls);
+}
+
+TEST(Hedging, hedgeWinsAndCancelsFirst) {
+  PendingRequest first;
+  auto f = futures::hedged(Duration(10), [&](size_t n) {
+    return n == 0 ? first.promise.getFuture() : makeFuture(42);
+  });
+  EXPECT_EQ(42, f.get(seconds(5)));
+  EXPECT_TRUE(first.cancelled);
+}
+
+TEST(Hedging, firstWinsAndCancelsHedge) {
+  PendingRequest first;
+  PendingRequest second;
+  auto f = futures::hedged(Duration(10), [&](size_t n) {
+    return (n == 0 ? first : second).promise.getFuture();
+  });
+  /* sleep override */ std::this_thread::sleep_for(milliseconds(100));
+  EXPECT_FALSE(f.isReady());
+  first.promise.setValue(7);
+  EXPECT_EQ(7, f.get(seconds(5)));
+  EXPECT_FALSE(first.cancelled);
+  EXPECT_TRUE(second.cancelled);
+}
+
+TEST(Hedging, failureStartsHedgeRightAway) {
+  auto f = futures::hedged(Duration(3600 * 1000), [](size_t n) {
+    return n == 0 ? makeFuture<int>(std::runtime_error("first"))
+                  : makeFuture(2);
+  });
+  EXPECT_EQ(2, f.get(seconds(5)));
+}
+
+TEST(Hedging, bothFail) {
+  auto f = futures::hedged(Duration(10), [](size_t n) {
+    return makeFuture<int>(std::runtime_error(n == 0 ? "first" : "second"));
+  });
+  try {
+    f.get(seconds(5));
+    ADD_FAILURE() << "expected an exception";
+  } catch (const std::runtime_error& e) {
+    EXPECT_STREQ("second", e.what());
+  }
+}
+
+TEST(Hedging, hedgeDelayQuantile) {
+  futures::HedgeDelay delay(0.95, Duration(250), seconds(60), 6);
+  auto now = futures::HedgeDelay::Clock::now();
+  EXPECT_EQ(Duration(250), delay.get(now));
+  for (int i = 1; i <= 100; ++i) {
+    delay.addLatency(now, milliseconds(i));
+  }
+  auto p95 = delay.get(now);
+  EXPECT_GE(p95, Duration(93));
+  EXPECT_LE(p95, Duration(97));
+
+  // Old latencies fall out of the window
+  EXPECT_EQ(Duration(250), delay.get(now + seconds(120)));
+}
+
+TEST(Hedging, hedgeDelayNeedsSamples) {
+  futures::HedgeDelay delay(0.95, Duration(250));
+  auto now = futures::HedgeDelay::Clock::now();
+  for (int i = 0; i < 19; ++i) {
+    delay.addLatency(now, milliseconds(1));
+  }
+  EXPECT_EQ(Duration(250), delay.get(now));
+  delay.addLatency(now, milliseconds(1));
+  EXPECT_EQ(Duration(1), delay.get(now));
+}
+
+TEST(Hedging, hedgedWithHedgeDelay) {
+  auto delay = std::make_shared<futures::HedgeDelay>(0.5, Duration(10));
+  for (int i = 0; i < 4; ++i) {
+    auto f =
+        futures::hedged(delay, [](size_t n) { return makeFuture(int(n)); });
+    EXPECT_EQ(0, f.value());
+  }
+  // The latencies of the (inline) requests were recorded
+  EXPECT_LE(delay->get(), Duration(1));
+}
+
+TEST(Hedging, hedgeDelayRecordsWholeRequest) {
+  // The hedge wins every time, after the initial 20ms delay: what is
+  // recorded is the time since hedged() was called, not since the hedge was
+  auto delay = std::make_shared<futures::HedgeDelay>(0.5, Duration(20));
+  for (int i = 0; i < 2; ++i) {
+    PendingRequest first;
+    auto f = futures::hedged(delay, [&](size_t n) {
+      return n == 0 ? first.promise.getFuture() : makeFuture(42);
+    });
+    EXPECT_EQ(42, f.get(seconds(5)));
+    EXPECT_TRUE(first.cancelled);
+  }
+  EXPECT_GE(delay->get(), Duration(20));
+}
@@ -204,6 +204,73 @@ TEST(RetryingTest, large_retries) {
   }
 }
 
+TEST(RetryingTest, budget_counts) {
+  using ms = milliseconds;
+  futures::RetryBudget budget(0.5, 2, ms(1000), 10);
+  auto now = futures::RetryBudget::Clock::now();
+  EXPECT_EQ(2, budget.available(now));
+  for (int i = 0; i < 10; ++i) {
+    budget.recordSuccess(now);
+  }
+  EXPECT_EQ(10, budget.successes(now));
+  EXPECT_EQ(7, budget.available(now));
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_TRUE(budget.tryAcquireRetry(now));
+  }
+  EXPECT_FALSE(budget.tryAcquireRetry(now));
+  EXPECT_EQ(7, budget.retries(now));
+
+  // Successes and retries expire with the window
+  now += ms(2000);
+  EXPECT_EQ(0, budget.successes(now));
+  EXPECT_EQ(0, budget.retries(now));
+  EXPECT_EQ(2, budget.available(now));
+}
+
+TEST(RetryingTest, policy_with_budget) {
+  auto budget = make_shared<futures::RetryBudget>(0.0, 3);
+  atomic<size_t> attempts{0};
+  auto r = futures::retrying(
+      futures::retryingPolicyWithBudget(
+          budget, futures::retryingPolicyBasic(10)),
+      [&](size_t) {
+        ++attempts;
+        return makeFuture<size_t>(runtime_error("ha"));
+      });
+  EXPECT_THROW(r.value(), runtime_error);
+  // One try, then the 3 retries of the budget
+  EXPECT_EQ(4, attempts);
+  EXPECT_EQ(0, budget->available());
+}
+
+TEST(RetryingTest, retrying_with_budget) {
+  auto budget = make_shared<futures::RetryBudget>(0.5, 0);
+  auto fail = [](size_t) { return makeFuture<size_t>(runtime_error("ha")); };
+  auto policy = [](size_t n, const exception_wrapper&) { return n < 3; };
+
+  // No successes yet, so no retries either
+  auto r = futures::retryingWithBudget(budget, policy, fail);
+  EXPECT_THROW(r.value(), runtime_error);
+  EXPECT_EQ(0, budget->retries(futures::RetryBudget::Clock::now()));
+
+  for (size_t i = 0; i < 4; ++i) {
+    auto s = futures::retryingWithBudget(
+        budget, policy, [](size_t n) { return makeFuture(n); });
+    EXPECT_EQ(0, s.value());
+  }
+  EXPECT_EQ(4, budget->successes(futures::RetryBudget::Clock::now()));
+
+  // 4 successes pay for 2 retries
+  size_t attempts = 0;
+  r = futures::retryingWithBudget(budget, policy, [&](size_t n) {
+    ++attempts;
+    return fail(n);
+  });
+  EXPECT_THROW(r.value(), runtime_error);
+  EXPECT_EQ(3, attempts);
+  EXPECT_EQ(2, budget->retries(futures::RetryBudget::Clock::now()));
+}
+
 /*
 TEST(RetryingTest, policy_sleep_cancel) {
   multiAttemptExpectDurationWithin(5, milliseconds(0), milliseconds(10), []{
@@ -303,3 +303,83 @@ TEST(SemiFuture, MakeSemiFutureFromFutureWithTry) {
   auto tryResult = std::move(sf).get();
   ASSERT_EQ(tryResult.value(), "Try");
 }
+
+TEST(SemiFuture, DeferFused) {
+  std::vector<int> order;
+  Promise<int> p;
+  auto sf = p.getFuture().semi().deferFused(
+      [&](int a) {
+        order.push_back(1);
+        return a + 1;
+      },
+      [&](int a) {
+        order.push_back(2);
+        return std::to_string(a);
+      },
+      [&](std::string&& s) {
+        order.push_back(3);
+        return s + "!";
+      });
+  p.setValue(41);
+  // Nothing runs until the result is requested
+  EXPECT_TRUE(order.empty());
+  EXPECT_EQ("42!", std::move(sf).get());
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), order);
+}
+
+TEST(SemiFuture, DeferFusedVoidAndTry) {
+  int result = 0;
+  Promise<Unit> p;
+  auto sf = p.getFuture()
+                .semi()
+                .defer([&] { result = 1; })
+                .deferFused(
+                    [&] { result *= 10; },
+                    [&](Try<Unit>&& t) {
+                      EXPECT_TRUE(t.hasValue());
+                      return result + 1;
+                    });
+  p.setValue();
+  EXPECT_EQ(11, std::move(sf).get());
+}
+
+TEST(SemiFuture, DeferFusedException) {
+  bool skipped = true;
+  Promise<int> p;
+  auto sf = p.getFuture().semi().deferFused(
+      [](int a) -> int {
+        if (a < 0) {
+          throw std::logic_error("negative");
+        }
+        return a;
+      },
+      [&](int a) {
+        skipped = false;
+        return a;
+      },
+      [](Try<int>&& t) {
+        EXPECT_TRUE(t.hasException<std::logic_error>());
+        return t.hasException() ? -1 : *t;
+      });
+  p.setValue(-5);
+  EXPECT_EQ(-1, std::move(sf).get());
+  EXPECT_TRUE(skipped);
+
+  Promise<int> p2;
+  auto sf2 = p2.getFuture().semi().deferFused([](int a) { return a * 2; });
+  p2.setException(std::runtime_error("broken"));
+  EXPECT_THROW(std::move(sf2).get(), std::runtime_error);
+}
+
+TEST(SemiFuture, DeferFusedVia) {
+  EventBase e2;
+  Promise<int> p;
+  auto f = p.getFuture()
+               .semi()
+               .deferFused(
+                   [](int a) { return a + 1; }, [](int a) { return 2 * a; })
+               .via(&e2)
+               .then([](int a) { return a + 1; });
+  p.setValue(1);
+  EXPECT_EQ(5, f.getVia(&e2));
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/futures/Singleflight.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(Singleflight, coalesce) {
+  Singleflight<std::string, int> flight;
+  Promise<int> p;
+  size_t calls = 0;
+  auto call = [&] {
+    ++calls;
+    return p.getFuture();
+  };
+
+  auto f1 = flight.get("a", call);
+  auto f2 = flight.get("a", call);
+  auto f3 = flight.get("b", [] { return 3; });
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(1, flight.size());
+  EXPECT_EQ(3, std::move(f3).get());
+
+  p.setValue(1);
+  EXPECT_EQ(1, std::move(f1).get());
+  EXPECT_EQ(1, std::move(f2).get());
+  EXPECT_EQ(0, flight.size());
+
+  // Results aren't kept
+  EXPECT_EQ(2, flight.get("a", [] { return 2; }).get());
+}
+
+TEST(Singleflight, failure) {
+  Singleflight<int, int> flight;
+  auto f = flight.get(1, []() -> int { throw std::runtime_error("oops"); });
+  EXPECT_THROW(std::move(f).get(), std::runtime_error);
+  EXPECT_EQ(0, flight.size());
+  EXPECT_EQ(1, flight.get(1, [] { return 1; }).get());
+}
+
+TEST(Singleflight, failureTtl) {
+  Singleflight<int, int> flight(std::chrono::milliseconds(50));
+  size_t calls = 0;
+  auto fail = [&]() -> int {
+    ++calls;
+    throw std::runtime_error("oops");
+  };
+
+  EXPECT_THROW(flight.get(1, fail).get(), std::runtime_error);
+  EXPECT_THROW(flight.get(1, fail).get(), std::runtime_error);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(1, flight.size());
+
+  flight.forget(1);
+  EXPECT_THROW(flight.get(1, fail).get(), std::runtime_error);
+  EXPECT_EQ(2, calls);
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_EQ(1, flight.get(1, [] { return 1; }).get());
+  EXPECT_EQ(0, flight.size());
+}
+
+TEST(Singleflight, threads) {
+  constexpr size_t kThreads = 8;
+  Singleflight<int, int> flight(std::chrono::milliseconds(0), 4);
+  std::atomic<size_t> calls{0};
+  Promise<int> p;
+  auto pf = p.getFuture();
+  std::atomic<size_t> started{0};
+
+  std::vector<std::thread> threads;
+  std::vector<int> results(kThreads);
+  for (size_t i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      auto f = flight.get(42, [&] {
+        ++calls;
+        return std::move(pf);
+      });
+      ++started;
+      results[i] = std::move(f).get();
+    });
+  }
+  while (started < kThreads) {
+    std::this_thread::yield();
+  }
+  p.setValue(42);
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(std::vector<int>(kThreads, 42), results);
+}
+
+TEST(Singleflight, fibers) {
+  Singleflight<int, int> flight;
+  EventBase evb;
+  Promise<int> p;
+  size_t calls = 0;
+  std::vector<int> results;
+  auto call = [&] {
+    ++calls;
+    return p.getFuture();
+  };
+  auto& fm = fibers::getFiberManager(evb);
+  for (size_t i = 0; i < 3; ++i) {
+    // Blocks the fiber, not the thread
+    fm.addTask([&] { results.push_back(flight.get(1, call).get()); });
+  }
+  evb.loopOnce();
+  EXPECT_EQ(1, calls);
+  EXPECT_TRUE(results.empty());
+  p.setValue(7);
+  evb.loop();
+  EXPECT_EQ(std::vector<int>(3, 7), results);
+}
@@ -16,7 +16,9 @@
 
 #include <folly/futures/Timekeeper.h>
 #include <folly/Singleton.h>
+#include <folly/futures/EventBaseTimekeeper.h>
 #include <folly/futures/ThreadWheelTimekeeper.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/portability/GTest.h>
 
 using namespace folly;
@@ -213,6 +215,56 @@ TEST(Timekeeper, executor) {
   EXPECT_EQ(2, tester.count);
 }
 
+TEST(Timekeeper, eventBaseTimekeeperAfter) {
+  EventBase evb;
+  EventBaseTimekeeper tk(evb);
+  auto t1 = now();
+  auto f = tk.after(awhile);
+  EXPECT_EQ(1, evb.timer().count());
+  EXPECT_FALSE(f.isReady());
+  evb.loop();
+  EXPECT_TRUE(f.isReady());
+  EXPECT_FALSE(f.hasException());
+  EXPECT_GE(now() - t1, awhile);
+}
+
+TEST(Timekeeper, eventBaseTimekeeperFromOtherThread) {
+  ScopedEventBaseThread evbThread;
+  auto evb = evbThread.getEventBase();
+  std::thread::id evbThreadId;
+  evb->runInEventBaseThreadAndWait(
+      [&] { evbThreadId = std::this_thread::get_id(); });
+  std::thread::id completedOn;
+  EventBaseTimekeeper(*evb)
+      .after(one_ms)
+      .then([&] { completedOn = std::this_thread::get_id(); })
+      .get();
+  EXPECT_EQ(evbThreadId, completedOn);
+}
+
+TEST(Timekeeper, eventBaseTimekeeperInterrupt) {
+  EventBase evb;
+  auto f = EventBaseTimekeeper(evb).after(too_long);
+  f.cancel();
+  evb.loop();
+  EXPECT_EQ(0, evb.timer().count());
+}
+
+TEST(Timekeeper, withinUsesExecutorEventBase) {
+  EventBase evb;
+  Promise<int> p;
+  auto f = p.getFuture().via(&evb).within(awhile);
+  EXPECT_EQ(1, evb.timer().count());
+  EXPECT_THROW(f.getVia(&evb), TimedOut);
+}
+
+TEST(Timekeeper, delayedUsesExecutorEventBase) {
+  EventBase evb;
+  auto f = makeFuture(42).via(&evb).delayed(awhile);
+  EXPECT_EQ(1, evb.timer().count());
+  EXPECT_EQ(42, f.getVia(&evb));
+}
+
 // TODO(5921764)
 /*
 TEST(Timekeeper, onTimeoutPropagates) {
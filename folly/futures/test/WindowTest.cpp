@@ -357,3 +357,179 @@ TEST(WindowExecutor, allParallelWithError) {
     }
   }
 }
+
+TEST(WindowCollect, basic) {
+  ManualExecutor executor;
+  auto f = windowCollect(
+      &executor,
+      std::vector<std::string>{"1", "2", "3"},
+      [](std::string s) { return makeFuture(folly::to<int>(s)); },
+      2);
+  executor.waitFor(f);
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), f.get());
+
+  auto empty = windowCollect(
+      std::vector<int>(), [](int i) { return makeFuture(i); }, 2);
+  EXPECT_TRUE(empty.get().empty());
+
+  // Inline executor and ready futures: no recursion per element
+  std::vector<int> input(100000, 1);
+  auto big = windowCollect(input, [](int i) { return makeFuture(i); }, 10);
+  EXPECT_EQ(input, big.get());
+}
+
+TEST(WindowCollect, boundedConcurrency) {
+  ManualExecutor executor;
+  std::vector<int> input;
+  std::vector<Promise<int>> ps(10);
+  for (size_t i = 0; i < ps.size(); i++) {
+    input.emplace_back(i);
+  }
+  size_t started = 0;
+  auto f = windowCollect(
+      &executor,
+      input,
+      [&](int i) {
+        ++started;
+        return ps[i].getFuture();
+      },
+      3);
+  executor.run();
+  EXPECT_EQ(3, started);
+  // Each completion starts exactly one more task.
+  for (size_t i = 0; i < ps.size(); i++) {
+    ps[i].setValue(10 * i);
+    executor.run();
+    EXPECT_EQ(std::min(ps.size(), i + 4), started);
+  }
+  EXPECT_TRUE(f.isReady());
+  for (size_t i = 0; i < ps.size(); i++) {
+    EXPECT_EQ(10 * i, f.value()[i]);
+  }
+}
+
+TEST(WindowCollect, error) {
+  ManualExecutor executor;
+  std::vector<Promise<int>> ps(10);
+  std::vector<int> input;
+  for (size_t i = 0; i < ps.size(); i++) {
+    input.emplace_back(i);
+  }
+  size_t started = 0;
+  auto f = windowCollect(
+      &executor,
+      input,
+      [&](int i) {
+        ++started;
+        return ps[i].getFuture();
+      },
+      2);
+  executor.run();
+  ps[1].setException(eggs);
+  executor.run();
+  // Fails right away; no new task was started for the failed slot.
+  EXPECT_TRUE(f.isReady());
+  EXPECT_THROW(f.value(), eggs_t);
+  EXPECT_EQ(2, started);
+  ps[0].setValue(0);
+  executor.run();
+  EXPECT_EQ(2, started);
+
+  // func throwing counts as a failure too
+  auto f2 = windowCollect(
+      std::vector<int>{1, 2, 3},
+      [](int i) -> Future<int> {
+        if (i == 2) {
+          throw eggs;
+        }
+        return makeFuture(i);
+      },
+      1);
+  EXPECT_THROW(f2.value(), eggs_t);
+}
+
+TEST(WindowReduce, basic) {
+  ManualExecutor executor;
+  std::vector<int> input = {1, 2, 3, 4, 5};
+  auto f = windowReduce(
+      &executor,
+      input,
+      [](int i) { return makeFuture(i); },
+      2,
+      0,
+      [](int sum, int b) { return sum + b; });
+  executor.waitFor(f);
+  EXPECT_EQ(15, f.get());
+
+  // Try argument sees errors instead of failing
+  auto f2 = windowReduce(
+      input,
+      [](int i) {
+        return i % 2 ? makeFuture(i) : makeFuture<int>(eggs);
+      },
+      3,
+      std::string(),
+      [](std::string s, Try<int>&& t) {
+        return s + (t.hasValue() ? folly::to<std::string>(*t) : "x");
+      });
+  EXPECT_EQ("1x3x5", f2.get());
+
+  auto empty = windowReduce(
+      std::vector<int>(),
+      [](int i) { return makeFuture(i); },
+      2,
+      7,
+      [](int sum, int b) { return sum + b; });
+  EXPECT_EQ(7, empty.get());
+}
+
+TEST(WindowReduce, completionOrder) {
+  ManualExecutor executor;
+  std::vector<Promise<int>> ps(4);
+  std::vector<int> input = {0, 1, 2, 3};
+  auto f = windowReduce(
+      &executor,
+      input,
+      [&](int i) { return ps[i].getFuture(); },
+      4,
+      std::vector<int>(),
+      [](std::vector<int> v, int b) {
+        v.push_back(b);
+        return v;
+      });
+  executor.run();
+  for (int i : {2, 0, 3, 1}) {
+    ps[i].setValue(i);
+    executor.run();
+  }
+  EXPECT_EQ((std::vector<int>{2, 0, 3, 1}), f.value());
+}
+
+TEST(WindowReduce, error) {
+  std::vector<int> input = {1, 2, 3, 4};
+  size_t started = 0;
+  auto f = windowReduce(
+      input,
+      [&](int i) {
+        ++started;
+        return makeFuture(i);
+      },
+      1,
+      0,
+      [](int sum, int b) {
+        if (b == 2) {
+          throw eggs;
+        }
+        return sum + b;
+      });
+  EXPECT_THROW(f.value(), eggs_t);
+  EXPECT_EQ(2, started);
+
+  auto f2 = windowReduce(
+      input,
+      [](int i) { return i == 3 ? makeFuture<int>(eggs) : makeFuture(i); },
+      1,
+      0,
+      [](int sum, int b) { return sum + b; });
+  EXPECT_THROW(f2.value(), eggs_t);
+}
@@ -98,6 +98,93 @@ class Group : public GenImpl<Value&&, Group<Key, Value>> {
 
 namespace detail {
 
+/**
+ * applySpans() - Send the values of a generator to the given handler in
+ * contiguous spans of at most spanSize values, as Range<const StorageType*>,
+ * until the handler returns false. Returns false if and only if the handler
+ * did. Spans are only valid during the call to the handler.
+ *
+ * Generators that can do better than copying each value into a buffer
+ * implement applySpans(spanSize, handler): sources over contiguous storage
+ * pass slices of it, and filter and map process whole spans at a time.
+ */
+struct SpanHandlerProbe {
+  template <class Span>
+  bool operator()(Span) const {
+    return true;
+  }
+};
+
+template <class Gen, class = void>
+struct HasApplySpans : std::false_type {};
+
+template <class Gen>
+struct HasApplySpans<
+    Gen,
+    void_t<decltype(std::declval<const Gen&>().applySpans(
+        size_t(),
+        SpanHandlerProbe()))>> : std::true_type {};
+
+template <class Gen, class Handler>
+typename std::enable_if<HasApplySpans<Gen>::value, bool>::type
+applySpans(const Gen& gen, size_t spanSize, Handler&& handler) {
+  return gen.applySpans(spanSize, std::forward<Handler>(handler));
+}
+
+template <class Gen, class Handler>
+typename std::enable_if<!HasApplySpans<Gen>::value, bool>::type
+applySpans(const Gen& gen, size_t spanSize, Handler&& handler) {
+  using Value = typename Gen::ValueType;
+  using StorageType = typename Gen::StorageType;
+  std::vector<StorageType> span;
+  span.reserve(spanSize);
+  bool shouldContinue = gen.apply([&](Value value) -> bool {
+    span.push_back(std::forward<Value>(value));
+    if (span.size() == spanSize) {
+      bool needMore =
+          handler(Range<const StorageType*>(span.data(), span.size()));
+      span.clear();
+      return needMore;
+    }
+    return true;
+  });
+  if (shouldContinue && !span.empty()) {
+    shouldContinue =
+        handler(Range<const StorageType*>(span.data(), span.size()));
+  }
+  return shouldContinue;
+}
+
+template <class T, class Handler>
+bool applyContiguousSpans(
+    const T* data,
+    size_t size,
+    size_t spanSize,
+    Handler&& handler) {
+  for (size_t i = 0; i < size; i += spanSize) {
+    if (!handler(Range<const T*>(data + i, std::min(spanSize, size - i)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether the values of container are stored contiguously, as T
+template <class Container, class T, class = void>
+struct IsContiguousOf : std::false_type {};
+
+template <class Container, class T>
+struct IsContiguousOf<
+    Container,
+    T,
+    void_t<
+        decltype(std::declval<const Container&>().data()),
+        decltype(std::declval<const Container&>().size())>>
+    : std::is_same<
+          typename std::remove_cv<typename std::remove_pointer<decltype(
+              std::declval<const Container&>().data())>::type>::type,
+          T> {};
+
 // Classes used for the implementation of Sources, Operators, and Sinks
 
 /*
@@ -141,6 +228,16 @@ class ReferencedSource
     return true;
   }
 
+  template <
+      class Handler,
+      class StorageType = typename ReferencedSource::StorageType,
+      class C = Container>
+  typename std::enable_if<IsContiguousOf<C, StorageType>::value, bool>::type
+  applySpans(size_t spanSize, Handler&& handler) const {
+    return applyContiguousSpans(
+        container_->data(), container_->size(), spanSize, handler);
+  }
+
   // from takes in a normal stl structure, which are all finite
   static constexpr bool infinite = false;
 };
@@ -207,6 +304,13 @@ class CopiedSource
     return true;
   }
 
+  template <class Handler, class C = Container>
+  typename std::enable_if<IsContiguousOf<C, StorageType>::value, bool>::type
+  applySpans(size_t spanSize, Handler&& handler) const {
+    return applyContiguousSpans(
+        copy_->data(), copy_->size(), spanSize, handler);
+  }
+
   // from takes in a normal stl structure, which are all finite
   static constexpr bool infinite = false;
 };
@@ -248,6 +352,16 @@ class RangeSource : public GenImpl<typename Range<Iterator>::reference,
     }
   }
 
+  template <
+      class Handler,
+      class StorageType = typename RangeSource::StorageType,
+      class R = Range<Iterator>>
+  typename std::enable_if<IsContiguousOf<R, StorageType>::value, bool>::type
+  applySpans(size_t spanSize, Handler&& handler) const {
+    return applyContiguousSpans(
+        range_.data(), range_.size(), spanSize, handler);
+  }
+
   // folly::Range only supports finite ranges
   static constexpr bool infinite = false;
 };
@@ -507,6 +621,62 @@ class Map : public Operator<Map<Predicate>> {
       });
     }
 
+    // Maps whole spans, the values are passed to pred as const references
+    template <
+        class Handler,
+        class StorageType = typename Generator::StorageType,
+        class SourceStorage = typename Source::StorageType,
+        class = decltype(std::declval<const Predicate&>()(
+            std::declval<const SourceStorage&>()))>
+    bool applySpans(size_t spanSize, Handler&& handler) const {
+      return applySpansImpl(
+          spanSize,
+          std::forward<Handler>(handler),
+          std::integral_constant<
+              bool,
+              std::is_trivially_copyable<StorageType>::value &&
+                  std::is_default_constructible<StorageType>::value>());
+    }
+
+   private:
+    template <
+        class Handler,
+        class StorageType = typename Generator::StorageType,
+        class SourceStorage = typename Source::StorageType>
+    bool applySpansImpl(size_t spanSize, Handler&& handler, std::true_type)
+        const {
+      std::unique_ptr<StorageType[]> span(new StorageType[spanSize]);
+      return detail::applySpans(
+          source_, spanSize, [&](Range<const SourceStorage*> values) {
+            auto out = span.get();
+            for (auto& value : values) {
+              *out++ = pred_(value);
+            }
+            return handler(Range<const StorageType*>(span.get(), out));
+          });
+    }
+
+    template <
+        class Handler,
+        class StorageType = typename Generator::StorageType,
+        class SourceStorage = typename Source::StorageType>
+    bool applySpansImpl(size_t spanSize, Handler&& handler, std::false_type)
+        const {
+      std::vector<StorageType> span;
+      span.reserve(spanSize);
+      return detail::applySpans(
+          source_, spanSize, [&](Range<const SourceStorage*> values) {
+            span.clear();
+            for (auto& value : values) {
+              span.push_back(pred_(value));
+            }
+            return handler(
+                Range<const StorageType*>(span.data(), span.size()));
+          });
+    }
+
+   public:
+
     static constexpr bool infinite = Source::infinite;
   };
 
@@ -576,6 +746,60 @@ class Filter : public Operator<Filter<Predicate>> {
       });
     }
 
+    // Filters whole spans, the values are passed to pred as const references
+    template <
+        class Handler,
+        class StorageType = typename Generator::StorageType,
+        class = decltype(std::declval<const Predicate&>()(
+            std::declval<const StorageType&>()))>
+    bool applySpans(size_t spanSize, Handler&& handler) const {
+      return applySpansImpl(
+          spanSize,
+          std::forward<Handler>(handler),
+          std::integral_constant<
+              bool,
+              std::is_trivially_copyable<StorageType>::value &&
+                  std::is_default_constructible<StorageType>::value>());
+    }
+
+   private:
+    template <class Handler, class StorageType = typename Generator::StorageType>
+    bool applySpansImpl(size_t spanSize, Handler&& handler, std::true_type)
+        const {
+      // Copies every value, but only keeps those that pass, so that there is
+      // no branch for compilers to vectorize around.
+      std::unique_ptr<StorageType[]> span(new StorageType[spanSize]);
+      return detail::applySpans(
+          source_, spanSize, [&](Range<const StorageType*> values) {
+            size_t size = 0;
+            for (auto& value : values) {
+              span[size] = value;
+              size += bool(pred_(value));
+            }
+            return size == 0 ||
+                handler(Range<const StorageType*>(span.get(), size));
+          });
+    }
+
+    template <class Handler, class StorageType = typename Generator::StorageType>
+    bool applySpansImpl(size_t spanSize, Handler&& handler, std::false_type)
+        const {
+      std::vector<StorageType> span;
+      span.reserve(spanSize);
+      return detail::applySpans(
+          source_, spanSize, [&](Range<const StorageType*> values) {
+            span.clear();
+            for (auto& value : values) {
+              if (pred_(value)) {
+                span.push_back(value);
+              }
+            }
+            return span.empty() ||
+                handler(Range<const StorageType*>(span.data(), span.size()));
+          });
+    }
+
+   public:
     static constexpr bool infinite = Source::infinite;
   };
 
@@ -1366,6 +1590,79 @@ class Batch : public Operator<Batch> {
   }
 };
 
+/**
+ * Spans - For processing a sequence in contiguous spans of values, passed as
+ * Range<const StorageType*>, instead of one value at a time. Spans are only
+ * valid until the next one is requested.
+ *
+ * Spans of sources over contiguous storage, like vectors, are slices of it.
+ * Filters and maps before spans() process whole spans at a time, with loops
+ * that compilers can vectorize; their predicates then receive const
+ * references, and their results are copied. Other generators have their
+ * values copied into a buffer.
+ *
+ * This type is usually used through the 'spans' helper function:
+ *
+ *   auto total
+ *     = from(values)
+ *     | filter([](int i) { return i > 0; })
+ *     | spans(1024)
+ *     | map([](Range<const int*> span) {
+ *         return std::accumulate(span.begin(), span.end(), 0L);
+ *       })
+ *     | sum;
+ *
+ * 'rconcat' turns the spans back into values; sinks after it then run a
+ * tight loop over each span:
+ *
+ *   auto total = from(values) | filter(isPositive) | spans() | rconcat | sum;
+ */
+class Spans : public Operator<Spans> {
+  size_t spanSize_;
+
+ public:
+  static constexpr size_t kDefaultSpanSize = 1024;
+
+  explicit Spans(size_t spanSize) : spanSize_(spanSize) {
+    if (spanSize_ == 0) {
+      throw std::invalid_argument("Span size must be non-zero!");
+    }
+  }
+
+  template <
+      class Value,
+      class Source,
+      class StorageType = typename std::decay<Value>::type,
+      class SpanType = Range<const StorageType*>>
+  class Generator
+      : public GenImpl<SpanType, Generator<Value, Source, StorageType, SpanType>> {
+    Source source_;
+    size_t spanSize_;
+
+   public:
+    explicit Generator(Source source, size_t spanSize)
+        : source_(std::move(source)), spanSize_(spanSize) {}
+
+    template <class Handler>
+    bool apply(Handler&& handler) const {
+      return detail::applySpans(
+          source_, spanSize_, [&](SpanType span) { return handler(span); });
+    }
+
+    static constexpr bool infinite = Source::infinite;
+  };
+
+  template <class Source, class Value, class Gen = Generator<Value, Source>>
+  Gen compose(GenImpl<Value, Source>&& source) const {
+    return Gen(std::move(source.self()), spanSize_);
+  }
+
+  template <class Source, class Value, class Gen = Generator<Value, Source>>
+  Gen compose(const GenImpl<Value, Source>& source) const {
+    return Gen(source.self(), spanSize_);
+  }
+};
+
 /**
  * Window - For overlapping the lifetimes of pipeline values, especially with
  * Futures.
@@ -2455,6 +2752,11 @@ inline detail::Batch batch(size_t batchSize) {
   return detail::Batch(batchSize);
 }
 
+inline detail::Spans spans(
+    size_t spanSize = detail::Spans::kDefaultSpanSize) {
+  return detail::Spans(spanSize);
+}
+
 inline detail::Window window(size_t windowSize) {
   return detail::Window(windowSize);
 }
@@ -357,6 +357,8 @@ class Cycle;
 
 class Batch;
 
+class Spans;
+
 class Window;
 
 class Dereference;
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FOLLY_GEN_PARALLELREDUCE_H_
+#error This file may only be included from folly/gen/ParallelReduce.h
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/Optional.h>
+
+namespace folly {
+namespace gen {
+namespace detail {
+
+/**
+ * ParallelReduceState - Shared by preduce() and the tasks it adds to the
+ * executor, which may outlive it.
+ */
+template <class Result>
+struct ParallelReduceState {
+  explicit ParallelReduceState(size_t sliceCount)
+      : remaining(sliceCount), results(sliceCount) {}
+
+  // Evaluate slices until there are none left; slice is only called for
+  // slices that aren't done, while preduce() waits for them.
+  template <class Slice>
+  void work(const Slice& slice) {
+    size_t i;
+    while ((i = next.fetch_add(1)) < results.size()) {
+      try {
+        results[i] = slice(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (remaining.fetch_sub(1) == 1) {
+        done.post();
+      }
+    }
+  }
+
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> remaining;
+  std::vector<Optional<Result>> results;
+  std::mutex mutex;
+  std::exception_ptr error;
+  Baton<> done;
+};
+
+} // namespace detail
+
+template <
+    class Container,
+    class Pipeline,
+    class Combiner,
+    class StorageType,
+    class Result>
+Result preduce(
+    Executor& executor,
+    const Container& input,
+    const Pipeline& pipeline,
+    Combiner combiner,
+    size_t sliceSize,
+    size_t parallelism) {
+  static_assert(
+      detail::IsContiguousOf<Container, StorageType>::value,
+      "preduce() needs a container with contiguous storage");
+  using Slice = detail::RangeSource<const StorageType*>;
+  if (sliceSize == 0) {
+    throw std::invalid_argument("Slice size must be non-zero!");
+  }
+
+  const StorageType* data = input.data();
+  const size_t size = input.size();
+  if (size == 0) {
+    return Slice(Range<const StorageType*>(data, data)) | pipeline;
+  }
+  const size_t sliceCount = (size + sliceSize - 1) / sliceSize;
+  if (parallelism == 0) {
+    parallelism = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  parallelism = std::min(parallelism, sliceCount);
+
+  auto slice = [data, size, sliceSize, &pipeline](size_t i) {
+    auto begin = data + i * sliceSize;
+    auto end = data + std::min(size, (i + 1) * sliceSize);
+    return Slice(Range<const StorageType*>(begin, end)) | pipeline;
+  };
+  auto state = std::make_shared<detail::ParallelReduceState<Result>>(
+      sliceCount);
+  // This thread is one of the workers
+  for (size_t i = 1; i < parallelism; ++i) {
+    executor.add([state, slice] { state->work(slice); });
+  }
+  state->work(slice);
+  state->done.wait();
+
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+  Result result = std::move(*state->results[0]);
+  for (size_t i = 1; i < sliceCount; ++i) {
+    result = combiner(std::move(result), std::move(*state->results[i]));
+  }
+  return result;
+}
+
+} // namespace gen
+} // namespace folly
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#define FOLLY_GEN_PARALLELREDUCE_H_
+
+#include <folly/Executor.h>
+#include <folly/gen/Base.h>
+
+namespace folly {
+namespace gen {
+
+constexpr size_t kDefaultReduceSliceSize = 64 * 1024;
+
+/**
+ * preduce() - Run a pipeline over slices of a container in parallel on an
+ * executor, and combine the results of the slices.
+ *
+ * The container must store its values contiguously, like a vector. It is
+ * split into slices of sliceSize values; 'from(slice) | pipeline' is
+ * evaluated for each of them by up to 'parallelism' tasks (the number of
+ * CPUs by default), which take the next slice as they finish one, so that
+ * slow slices don't hold up the others. The calling thread evaluates slices
+ * too, then waits for all of them to be done. The results of the slices
+ * are combined in order, so combiner need only be associative:
+ *
+ *   int64_t total = preduce(
+ *       executor,
+ *       rows,
+ *       filter(isValid) | map(score) | sum,
+ *       std::plus<int64_t>());
+ *
+ * The pipeline must end with a sink that gives a result for any slice,
+ * even one whose values are all filtered out (sum, count, foldl, as<>...).
+ * Its stages run concurrently, so they must be safe to call from several
+ * threads at once. The first exception thrown by a slice is rethrown, once
+ * all of them are done.
+ *
+ * Tasks that the executor runs after the last slice is done return right
+ * away, which makes it safe to call from a thread of the executor.
+ */
+template <
+    class Container,
+    class Pipeline,
+    class Combiner,
+    class StorageType = typename std::remove_cv<typename std::remove_pointer<
+        decltype(std::declval<const Container&>().data())>::type>::type,
+    class Result = decltype(
+        std::declval<detail::RangeSource<const StorageType*>>() |
+        std::declval<const Pipeline&>())>
+Result preduce(
+    Executor& executor,
+    const Container& input,
+    const Pipeline& pipeline,
+    Combiner combiner,
+    size_t sliceSize = kDefaultReduceSliceSize,
+    size_t parallelism = 0);
+
+} // namespace gen
+} // namespace folly
+
+#include <folly/gen/ParallelReduce-inl.h>
@@ -1249,6 +1249,57 @@ TEST(Gen, BatchMove) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(Gen, Spans) {
+  auto sizes =
+      mapped([](Range<const int*> span) { return span.size(); }) |
+      as<vector>();
+  auto toVectors = mapped([](Range<const int*> span) {
+                     return vector<int>(span.begin(), span.end());
+                   }) |
+      as<vector>();
+
+  // Buffered
+  EXPECT_EQ(
+      (vector<vector<int>>{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}, {10, 11}}),
+      seq(1, 11) | spans(3) | toVectors);
+  EXPECT_EQ(vector<size_t>{}, seq(1, 0) | spans(3) | sizes);
+  EXPECT_THROW(seq(1, 1) | spans(0) | count, std::invalid_argument);
+
+  // Slices of contiguous storage
+  auto values = seq(1, 11) | as<vector>();
+  EXPECT_EQ(
+      (vector<vector<int>>{{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11}}),
+      from(values) | spans(4) | toVectors);
+  EXPECT_EQ(values.data(), (from(values) | spans(4) | first)->begin());
+  auto slice = folly::range(values.data() + 2, values.data() + 5);
+  EXPECT_EQ(slice.begin(), (from(slice) | spans() | first)->begin());
+  EXPECT_EQ(
+      (vector<size_t>{4, 4, 3}), fromCopy(values) | spans(4) | sizes);
+  EXPECT_EQ(
+      (vector<vector<int>>{{1, 2}}),
+      from(values) | spans(2) | take(1) | toVectors);
+
+  // Filters and maps work span by span
+  auto isOdd = [](int i) { return i % 2 == 1; };
+  EXPECT_EQ(
+      (vector<vector<int>>{{1, 9}, {25, 49}, {81, 121}}),
+      from(values) | filter(isOdd) | map(square) | spans(4) | toVectors);
+  EXPECT_EQ(
+      from(values) | filter(isOdd) | map(square) | sum,
+      from(values) | filter(isOdd) | map(square) | spans(4) | rconcat | sum);
+  EXPECT_EQ(
+      seq(1, 11) | filter(isOdd) | sum,
+      seq(1, 11) | filter(isOdd) | spans(4) | rconcat | sum);
+
+  // Values that can't be copied as is
+  vector<string> strings{"a", "", "b", "c"};
+  EXPECT_EQ(
+      (vector<string>{"a!", "b!", "c!"}),
+      from(strings) | filter([](const string& s) { return !s.empty(); }) |
+          map([](const string& s) { return s + "!"; }) | spans(2) |
+          rconcat | as<vector>());
+}
+
 TEST(Gen, Window) {
   auto expected = seq(0, 10) | as<std::vector>();
   for (size_t windowSize = 1; windowSize <= 20; ++windowSize) {
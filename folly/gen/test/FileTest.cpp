@@ -22,6 +22,7 @@
 #include <folly/experimental/TestUtil.h>
 #include <folly/gen/Base.h>
 #include <folly/gen/File.h>
+#include <folly/gen/Parallel.h>
 #include <folly/portability/GTest.h>
 
 using namespace folly::gen;
@@ -84,6 +85,62 @@ TEST(FileGen, ByLineFull) {
   }
 }
 
+TEST(FileGen, MappedLines) {
+  auto collect = eachTo<std::string>() | as<vector>();
+  const std::string cases[] = {
+      "Hello world\n"
+      "This is the second line\n"
+      "\n"
+      "\n"
+      "a few empty lines above\n"
+      "incomplete last line",
+
+      "complete last line\n",
+
+      "\n",
+
+      "",
+  };
+
+  for (auto& lines : cases) {
+    test::TemporaryFile file("MappedLines");
+    EXPECT_EQ(lines.size(), write(file.fd(), lines.data(), lines.size()));
+
+    auto expected = from({lines}) | resplit('\n') | collect;
+    auto path = file.path().string();
+    EXPECT_EQ(expected, mappedLines(path.c_str()) | collect)
+        << "For Input: '" << lines << "'";
+
+    // Chunks of any size hold whole lines
+    for (size_t chunkSize : {1, 2, 7, 30, 1000}) {
+      EXPECT_EQ(
+          expected,
+          mappedLineChunks(path.c_str(), chunkSize) | concat | collect)
+          << "For Input: '" << lines << "', chunk size " << chunkSize;
+    }
+  }
+}
+
+TEST(FileGen, MappedLineChunksParallel) {
+  test::TemporaryFile file("MappedLineChunks");
+  auto toLine = [](int v) { return to<std::string>(v, '\n'); };
+  auto values = seq(1, 100000);
+  values | map(toLine) | eachAs<StringPiece>() | toFile(File(file.fd()));
+
+  auto path = file.path().string();
+  auto lines = mappedLines(path.c_str());
+  EXPECT_EQ(values | count, lines | count);
+  // The lines outlive iteration
+  auto first = lines | take(1) | as<vector>();
+  EXPECT_EQ("1", first[0]);
+
+  EXPECT_EQ(
+      values | sum,
+      mappedLineChunks(path.c_str(), 1000) |
+          parallel(concat | eachTo<int>() | sub(sum), 4) | sum);
+  EXPECT_THROW(mappedLineChunks(path.c_str(), 0), std::invalid_argument);
+}
+
 class FileGenBufferedTest : public ::testing::TestWithParam<int> {};
 
 TEST_P(FileGenBufferedTest, FileWriter) {
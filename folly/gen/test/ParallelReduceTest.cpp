@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/gen/Base.h>
+#include <folly/gen/ParallelReduce.h>
+#include <folly/gen/String.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace folly::gen;
+
+namespace {
+
+auto isOdd = [](int x) { return x % 2 == 1; };
+auto square = [](int x) { return int64_t(x) * x; };
+
+} // namespace
+
+TEST(Preduce, Sum) {
+  CPUThreadPoolExecutor executor(4);
+  auto input = seq(1, 100000) | as<std::vector>();
+  auto expected = from(input) | filter(isOdd) | map(square) | sum;
+  for (size_t sliceSize : {1, 7, 1000, 100000, 1000000}) {
+    EXPECT_EQ(
+        expected,
+        preduce(
+            executor,
+            input,
+            filter(isOdd) | map(square) | sum,
+            std::plus<int64_t>(),
+            sliceSize))
+        << sliceSize;
+  }
+}
+
+TEST(Preduce, Spans) {
+  CPUThreadPoolExecutor executor(4);
+  auto input = seq(1, 10000) | as<std::vector>();
+  auto spanSums = spans(100) | map([](Range<const int*> span) {
+                    return from(span) | sum;
+                  }) |
+      sum;
+  EXPECT_EQ(
+      50005000,
+      preduce(executor, input, spanSums, std::plus<int>(), 1000, 8));
+}
+
+TEST(Preduce, InOrder) {
+  CPUThreadPoolExecutor executor(4);
+  auto input = seq(0, 999) | as<std::vector>();
+  auto expected = from(input) | eachTo<std::string>() | unsplit<std::string>(",");
+  auto result = preduce(
+      executor,
+      input,
+      eachTo<std::string>() | unsplit<std::string>(","),
+      [](std::string a, const std::string& b) { return a + "," + b; },
+      10);
+  EXPECT_EQ(expected, result);
+}
+
+TEST(Preduce, Empty) {
+  CPUThreadPoolExecutor executor(2);
+  std::vector<int> input;
+  EXPECT_EQ(
+      0, preduce(executor, input, map(square) | sum, std::plus<int64_t>()));
+  EXPECT_EQ(
+      0, preduce(executor, input, count, std::plus<size_t>()));
+}
+
+TEST(Preduce, InlineExecutor) {
+  InlineExecutor executor;
+  auto input = seq(1, 1000) | as<std::vector>();
+  EXPECT_EQ(
+      500500, preduce(executor, input, sum, std::plus<int>(), 10, 4));
+}
+
+TEST(Preduce, ExecutorNeverRuns) {
+  // The calling thread evaluates every slice if it has to
+  ManualExecutor executor;
+  auto input = seq(1, 1000) | as<std::vector>();
+  EXPECT_EQ(
+      500500, preduce(executor, input, sum, std::plus<int>(), 10, 4));
+  EXPECT_EQ(3, executor.run());
+}
+
+TEST(Preduce, Exception) {
+  CPUThreadPoolExecutor executor(4);
+  auto input = seq(1, 10000) | as<std::vector>();
+  auto pipeline = map([](int x) {
+                    if (x == 5000) {
+                      throw std::runtime_error("5000");
+                    }
+                    return x;
+                  }) |
+      sum;
+  EXPECT_THROW(
+      preduce(executor, input, pipeline, std::plus<int>(), 100),
+      std::runtime_error);
+  EXPECT_THROW(
+      preduce(executor, input, sum, std::plus<int>(), 0),
+      std::invalid_argument);
+}
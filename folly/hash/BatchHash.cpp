@@ -0,0 +1,271 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/BatchHash.h>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+#include <folly/hash/Xxh3.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+#if FOLLY_AARCH64 && defined(__ARM_NEON) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define FOLLY_BATCH_HASH_NEON 1
+#else
+#define FOLLY_BATCH_HASH_NEON 0
+#endif
+
+namespace folly {
+namespace hash {
+
+namespace {
+
+// Each Kernel hashes a prefix of the keys, a multiple of its vector width,
+// and returns how many it hashed; the rest are hashed one by one.
+
+struct ScalarKernel {
+  static size_t twangMix64(const uint8_t*, size_t, uint64_t*) {
+    return 0;
+  }
+  static size_t jenkinsRevMix32(const uint8_t*, size_t, uint64_t*) {
+    return 0;
+  }
+  static size_t xxh3_64(const uint8_t*, size_t, uint64_t*, uint64_t) {
+    return 0;
+  }
+};
+
+#if FOLLY_X64
+
+struct Avx2Kernel {
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static size_t twangMix64(const uint8_t* in, size_t count, uint64_t* out) {
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      __m256i k = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(in + 8 * i));
+      k = _mm256_add_epi64(
+          _mm256_xor_si256(k, ones), _mm256_slli_epi64(k, 21));
+      k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 24));
+      k = _mm256_add_epi64(
+          _mm256_add_epi64(k, _mm256_slli_epi64(k, 3)),
+          _mm256_slli_epi64(k, 8));
+      k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 14));
+      k = _mm256_add_epi64(
+          _mm256_add_epi64(k, _mm256_slli_epi64(k, 2)),
+          _mm256_slli_epi64(k, 4));
+      k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 28));
+      k = _mm256_add_epi64(k, _mm256_slli_epi64(k, 31));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), k);
+    }
+    return i;
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static size_t
+  jenkinsRevMix32(const uint8_t* in, size_t count, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      __m256i k = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(in + 4 * i));
+      k = _mm256_add_epi32(k, _mm256_slli_epi32(k, 12));
+      k = _mm256_xor_si256(k, _mm256_srli_epi32(k, 22));
+      k = _mm256_add_epi32(k, _mm256_slli_epi32(k, 4));
+      k = _mm256_xor_si256(k, _mm256_srli_epi32(k, 9));
+      k = _mm256_add_epi32(k, _mm256_slli_epi32(k, 10));
+      k = _mm256_xor_si256(k, _mm256_srli_epi32(k, 2));
+      k = _mm256_add_epi32(k, _mm256_slli_epi32(k, 7));
+      k = _mm256_add_epi32(k, _mm256_slli_epi32(k, 12));
+      // Zero-extended to 64 bits, as size_t
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(out + i),
+          _mm256_cvtepu32_epi64(_mm256_castsi256_si128(k)));
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(out + i + 4),
+          _mm256_cvtepu32_epi64(_mm256_extracti128_si256(k, 1)));
+    }
+    return i;
+  }
+
+  // The low 64 bits of a * b, from three 32x32-bit multiplications
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static __m256i mul64(__m256i a, __m256i b) {
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+        _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+  }
+
+  template <int R>
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static __m256i rotl64(__m256i x) {
+    return _mm256_or_si256(
+        _mm256_slli_epi64(x, R), _mm256_srli_epi64(x, 64 - R));
+  }
+
+  // xxh3_64_0to16() of 8 bytes: xxh3Rrmxmx() of the two 32-bit halves
+  // swapped, keyed
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static size_t
+  xxh3_64(const uint8_t* in, size_t count, uint64_t* out, uint64_t seed) {
+    using namespace detail;
+    const uint8_t* s = kXxh3Secret;
+    seed ^= uint64_t(Endian::swap(uint32_t(seed))) << 32;
+    const __m256i bitflip = _mm256_set1_epi64x(int64_t(
+        (xxh3Read64(s + 8) ^ xxh3Read64(s + 16)) - seed));
+    const __m256i prime = _mm256_set1_epi64x(int64_t(kXxh3PrimeMx2));
+    const __m256i len = _mm256_set1_epi64x(8);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      __m256i h = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(in + 8 * i));
+      h = _mm256_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1));
+      h = _mm256_xor_si256(h, bitflip);
+      h = _mm256_xor_si256(
+          h, _mm256_xor_si256(rotl64<49>(h), rotl64<24>(h)));
+      h = mul64(h, prime);
+      h = _mm256_xor_si256(
+          h, _mm256_add_epi64(_mm256_srli_epi64(h, 35), len));
+      h = mul64(h, prime);
+      h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 28));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+    }
+    return i;
+  }
+};
+
+bool hasAvx2() {
+  static const bool avx2 = CpuId().avx2();
+  return avx2;
+}
+
+#endif
+
+#if FOLLY_BATCH_HASH_NEON
+
+struct NeonKernel {
+  static size_t twangMix64(const uint8_t* in, size_t count, uint64_t* out) {
+    const uint64x2_t ones = vdupq_n_u64(~uint64_t(0));
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+      uint64x2_t k = vreinterpretq_u64_u8(vld1q_u8(in + 8 * i));
+      k = vaddq_u64(veorq_u64(k, ones), vshlq_n_u64(k, 21));
+      k = veorq_u64(k, vshrq_n_u64(k, 24));
+      k = vaddq_u64(vaddq_u64(k, vshlq_n_u64(k, 3)), vshlq_n_u64(k, 8));
+      k = veorq_u64(k, vshrq_n_u64(k, 14));
+      k = vaddq_u64(vaddq_u64(k, vshlq_n_u64(k, 2)), vshlq_n_u64(k, 4));
+      k = veorq_u64(k, vshrq_n_u64(k, 28));
+      k = vaddq_u64(k, vshlq_n_u64(k, 31));
+      vst1q_u64(out + i, k);
+    }
+    return i;
+  }
+
+  static size_t
+  jenkinsRevMix32(const uint8_t* in, size_t count, uint64_t* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      uint32x4_t k = vreinterpretq_u32_u8(vld1q_u8(in + 4 * i));
+      k = vaddq_u32(k, vshlq_n_u32(k, 12));
+      k = veorq_u32(k, vshrq_n_u32(k, 22));
+      k = vaddq_u32(k, vshlq_n_u32(k, 4));
+      k = veorq_u32(k, vshrq_n_u32(k, 9));
+      k = vaddq_u32(k, vshlq_n_u32(k, 10));
+      k = veorq_u32(k, vshrq_n_u32(k, 2));
+      k = vaddq_u32(k, vshlq_n_u32(k, 7));
+      k = vaddq_u32(k, vshlq_n_u32(k, 12));
+      vst1q_u64(out + i, vmovl_u32(vget_low_u32(k)));
+      vst1q_u64(out + i + 2, vmovl_u32(vget_high_u32(k)));
+    }
+    return i;
+  }
+
+  // NEON has no 64-bit multiplication, and two lanes don't beat the scalar
+  // multiplier
+  static size_t xxh3_64(const uint8_t*, size_t, uint64_t*, uint64_t) {
+    return 0;
+  }
+};
+
+#endif
+
+// Calls Kernel::FN(...) with the best Kernel for this CPU
+#if FOLLY_X64
+#define FOLLY_BATCH_HASH_DISPATCH(FN, ...) \
+  (hasAvx2() ? Avx2Kernel::FN(__VA_ARGS__) : ScalarKernel::FN(__VA_ARGS__))
+#elif FOLLY_BATCH_HASH_NEON
+#define FOLLY_BATCH_HASH_DISPATCH(FN, ...) NeonKernel::FN(__VA_ARGS__)
+#else
+#define FOLLY_BATCH_HASH_DISPATCH(FN, ...) ScalarKernel::FN(__VA_ARGS__)
+#endif
+
+} // namespace
+
+namespace detail {
+
+void twangMix64Batch(const void* keys, size_t count, uint64_t* hashes) {
+  auto in = static_cast<const uint8_t*>(keys);
+  size_t i = FOLLY_BATCH_HASH_DISPATCH(twangMix64, in, count, hashes);
+  for (; i < count; ++i) {
+    hashes[i] = twang_mix64(loadUnaligned<uint64_t>(in + 8 * i));
+  }
+}
+
+void jenkinsRevMix32Batch(const void* keys, size_t count, uint64_t* hashes) {
+  auto in = static_cast<const uint8_t*>(keys);
+  size_t i = FOLLY_BATCH_HASH_DISPATCH(jenkinsRevMix32, in, count, hashes);
+  for (; i < count; ++i) {
+    hashes[i] = jenkins_rev_mix32(loadUnaligned<uint32_t>(in + 4 * i));
+  }
+}
+
+void xxh3_64Batch8(
+    const void* keys,
+    size_t count,
+    uint64_t* hashes,
+    uint64_t seed) {
+  auto in = static_cast<const uint8_t*>(keys);
+  size_t i = FOLLY_BATCH_HASH_DISPATCH(xxh3_64, in, count, hashes, seed);
+  for (; i < count; ++i) {
+    hashes[i] = hash::xxh3_64(in + 8 * i, 8, seed);
+  }
+}
+
+} // namespace detail
+
+void xxh3_64_batch(
+    const void* data,
+    size_t len,
+    size_t count,
+    uint64_t* hashes,
+    uint64_t seed) {
+  if (len == 8) {
+    detail::xxh3_64Batch8(data, count, hashes, seed);
+    return;
+  }
+  auto in = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = xxh3_64(in + i * len, len, seed);
+  }
+}
+
+} // namespace hash
+} // namespace folly
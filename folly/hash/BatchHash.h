@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Hashing arrays of keys at once, for bulk inserts into hash tables and
+// sketches.  The results are the same as hashing each key on its own, but
+// the integer mixes and the XXH3 of 8-byte keys hash four keys per
+// instruction with AVX2, or two with NEON.
+//
+//   std::vector<uint64_t> hashes(keys.size());
+//   folly::hash::hash_batch(keys.data(), keys.size(), hashes.data());
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <folly/hash/Hash.h>
+
+namespace folly {
+namespace hash {
+
+namespace detail {
+
+// Keys may be any 8-byte (or 4-byte) type with the same bits as the
+// integer, e.g. long long where uint64_t is unsigned long
+void twangMix64Batch(const void* keys, size_t count, uint64_t* hashes);
+void jenkinsRevMix32Batch(const void* keys, size_t count, uint64_t* hashes);
+void xxh3_64Batch8(
+    const void* keys,
+    size_t count,
+    uint64_t* hashes,
+    uint64_t seed);
+
+// Whether hash_batch() can use the batch mixes for Hasher: folly::hasher
+// of an integer hashes one of 8 bytes with twang_mix64 and one of 4 bytes
+// with jenkins_rev_mix32
+template <class T, class Hasher>
+using BatchMixable = std::integral_constant<
+    bool,
+    std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+        (sizeof(T) == 8 || sizeof(T) == 4) &&
+        std::is_same<Hasher, folly::hasher<T>>::value>;
+
+template <class T, class Hasher>
+void hashBatch(
+    const T* keys,
+    size_t count,
+    uint64_t* hashes,
+    const Hasher&,
+    std::true_type) {
+  if (sizeof(T) == 8) {
+    twangMix64Batch(keys, count, hashes);
+  } else {
+    jenkinsRevMix32Batch(keys, count, hashes);
+  }
+}
+
+template <class T, class Hasher>
+void hashBatch(
+    const T* keys,
+    size_t count,
+    uint64_t* hashes,
+    const Hasher& hasher,
+    std::false_type) {
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = static_cast<uint64_t>(hasher(keys[i]));
+  }
+}
+
+} // namespace detail
+
+/**
+ * hashes[i] = twang_mix64(keys[i]), for i < count.
+ */
+inline void
+twang_mix64_batch(const uint64_t* keys, size_t count, uint64_t* hashes) {
+  detail::twangMix64Batch(keys, count, hashes);
+}
+
+/**
+ * hashes[i] = xxh3_64(&keys[i], 8, seed), for i < count: the XXH3 of each
+ * key as 8 bytes in memory.
+ */
+inline void xxh3_64_batch(
+    const uint64_t* keys,
+    size_t count,
+    uint64_t* hashes,
+    uint64_t seed = 0) {
+  detail::xxh3_64Batch8(keys, count, hashes, seed);
+}
+
+/**
+ * hashes[i] = xxh3_64(data + i * len, len, seed), for i < count: the XXH3
+ * of count records of len bytes each, stored one after the other.  Records
+ * of 8 bytes use the batch implementation; others are hashed in a loop
+ * that inlines XXH3 for records of up to 240 bytes.
+ */
+void xxh3_64_batch(
+    const void* data,
+    size_t len,
+    size_t count,
+    uint64_t* hashes,
+    uint64_t seed = 0);
+
+/**
+ * hashes[i] = hasher(keys[i]), for i < count.  Integers hashed with the
+ * default folly::hasher use the batch implementations of twang_mix64 and
+ * jenkins_rev_mix32; other keys and hashers are hashed in a loop.
+ */
+template <class T, class Hasher = folly::hasher<T>>
+void hash_batch(
+    const T* keys,
+    size_t count,
+    uint64_t* hashes,
+    const Hasher& hasher = Hasher()) {
+  detail::hashBatch(
+      keys, count, hashes, hasher, detail::BatchMixable<T, Hasher>());
+}
+
+} // namespace hash
+} // namespace folly
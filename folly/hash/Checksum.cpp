@@ -16,76 +16,12 @@
 
 #include <folly/hash/Checksum.h>
 #include <boost/crc.hpp>
-#include <folly/CpuId.h>
 #include <folly/hash/detail/ChecksumDetail.h>
-#include <algorithm>
-#include <stdexcept>
-
-#if FOLLY_SSE_PREREQ(4, 2)
-#include <nmmintrin.h>
-#endif
 
 namespace folly {
 
 namespace detail {
 
-uint32_t
-crc32c_sw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum);
-#if FOLLY_SSE_PREREQ(4, 2)
-
-uint32_t
-crc32_sw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum);
-
-// Fast SIMD implementation of CRC-32 for x86 with pclmul
-uint32_t
-crc32_hw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
-  uint32_t sum = startingChecksum;
-  size_t offset = 0;
-
-  // Process unaligned bytes
-  if ((uintptr_t)data & 15) {
-    size_t limit = std::min(nbytes, -(uintptr_t)data & 15);
-    sum = crc32_sw(data, limit, sum);
-    offset += limit;
-    nbytes -= limit;
-  }
-
-  if (nbytes >= 16) {
-    sum = crc32_hw_aligned(sum, (const __m128i*)(data + offset), nbytes / 16);
-    offset += nbytes & ~15;
-    nbytes &= 15;
-  }
-
-  // Remaining unaligned bytes
-  return crc32_sw(data + offset, nbytes, sum);
-}
-
-bool crc32c_hw_supported() {
-  static folly::CpuId id;
-  return id.sse42();
-}
-
-bool crc32_hw_supported() {
-  static folly::CpuId id;
-  return id.sse42();
-}
-
-#else
-
-uint32_t crc32_hw(const uint8_t *data, size_t nbytes,
-    uint32_t startingChecksum) {
-  throw std::runtime_error("crc32_hw is not implemented on this platform");
-}
-
-bool crc32c_hw_supported() {
-  return false;
-}
-
-bool crc32_hw_supported() {
-  return false;
-}
-#endif
-
 template <uint32_t CRC_POLYNOMIAL>
 uint32_t crc_sw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
   // Reverse the bits in the starting checksum so they'll be in the
@@ -123,17 +59,42 @@ crc32_sw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
 
 } // namespace detail
 
+namespace {
+// Below this size, the AVX-512 implementations save too little to be worth
+// powering up the 512-bit units of the CPU
+constexpr size_t kAvx512MinBytes = 512;
+} // namespace
+
 uint32_t crc32c(const uint8_t *data, size_t nbytes,
     uint32_t startingChecksum) {
-  if (detail::crc32c_hw_supported()) {
+  if (nbytes >= kAvx512MinBytes && detail::crc_avx512_supported()) {
+    return detail::crc32c_hw_avx512(data, nbytes, startingChecksum);
+  } else if (detail::crc32c_hw_supported()) {
     return detail::crc32c_hw(data, nbytes, startingChecksum);
   } else {
     return detail::crc32c_sw(data, nbytes, startingChecksum);
   }
 }
 
+void crc32c_multi(
+    const uint8_t* const* data,
+    const size_t* nbytes,
+    uint32_t* checksums,
+    size_t count,
+    uint32_t startingChecksum) {
+  if (detail::crc32c_hw_supported()) {
+    detail::crc32c_hw_multi(data, nbytes, checksums, count, startingChecksum);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      checksums[i] = detail::crc32c_sw(data[i], nbytes[i], startingChecksum);
+    }
+  }
+}
+
 uint32_t crc32(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
-  if (detail::crc32_hw_supported()) {
+  if (nbytes >= kAvx512MinBytes && detail::crc_avx512_supported()) {
+    return detail::crc32_hw_avx512(data, nbytes, startingChecksum);
+  } else if (detail::crc32_hw_supported()) {
     return detail::crc32_hw(data, nbytes, startingChecksum);
   } else {
     return detail::crc32_sw(data, nbytes, startingChecksum);
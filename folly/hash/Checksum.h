@@ -37,6 +37,21 @@ namespace folly {
 uint32_t crc32c(const uint8_t* data, size_t nbytes,
     uint32_t startingChecksum = ~0U);
 
+/**
+ * Compute the CRC-32C checksums of count independent buffers: checksums[i]
+ * is crc32c(data[i], nbytes[i], startingChecksum).
+ *
+ * Faster than calling crc32c() on each buffer when there are many small
+ * ones, like the blocks of a storage file: the hardware-accelerated
+ * implementation checksums several buffers at once.
+ */
+void crc32c_multi(
+    const uint8_t* const* data,
+    const size_t* nbytes,
+    uint32_t* checksums,
+    size_t count,
+    uint32_t startingChecksum = ~0U);
+
 /**
  * Compute the CRC-32 checksum of a buffer, using a hardware-accelerated
  * implementation if available or a portable software implementation as
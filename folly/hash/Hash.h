@@ -28,6 +28,7 @@
 #include <folly/functional/ApplyTuple.h>
 #include <folly/hash/SpookyHashV1.h>
 #include <folly/hash/SpookyHashV2.h>
+#include <folly/hash/Xxh3.h>
 
 /*
  * Various hashing functions.
@@ -445,8 +446,7 @@ struct hasher<char> : detail::integral_hasher {};
 
 template <> struct hasher<std::string> {
   size_t operator()(const std::string& key) const {
-    return static_cast<size_t>(
-        hash::SpookyHashV2::Hash64(key.data(), key.size(), 0));
+    return static_cast<size_t>(hash::xxh3_64(key.data(), key.size()));
   }
 };
 
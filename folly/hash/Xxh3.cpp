@@ -0,0 +1,444 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/Xxh3.h>
+
+#include <cstring>
+#include <new>
+
+#include <folly/CpuId.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
+#if FOLLY_AARCH64 && defined(__ARM_NEON) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define FOLLY_XXH3_NEON 1
+#else
+#define FOLLY_XXH3_NEON 0
+#endif
+
+namespace folly {
+namespace hash {
+namespace detail {
+
+alignas(64) const uint8_t kXxh3Secret[kXxh3SecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+} // namespace detail
+
+namespace {
+
+using namespace detail;
+
+constexpr size_t kStripeLen = 64;
+constexpr size_t kAccCount = 8;
+constexpr size_t kSecretConsumeRate = 8;
+constexpr size_t kStripesPerBlock =
+    (kXxh3SecretSize - kStripeLen) / kSecretConsumeRate;
+constexpr size_t kBlockLen = kStripeLen * kStripesPerBlock;
+constexpr size_t kSecretMergeAccsStart = 11;
+constexpr size_t kSecretLastAccStart = 7;
+
+void initAcc(uint64_t* acc) {
+  acc[0] = kXxh3Prime32_3;
+  acc[1] = kXxh3Prime64_1;
+  acc[2] = kXxh3Prime64_2;
+  acc[3] = kXxh3Prime64_3;
+  acc[4] = kXxh3Prime64_4;
+  acc[5] = kXxh3Prime32_2;
+  acc[6] = kXxh3Prime64_5;
+  acc[7] = kXxh3Prime32_1;
+}
+
+void initSecret(uint8_t* secret, uint64_t seed) {
+  for (size_t i = 0; i < kXxh3SecretSize; i += 16) {
+    uint64_t lo = xxh3Read64(kXxh3Secret + i) + seed;
+    uint64_t hi = xxh3Read64(kXxh3Secret + i + 8) - seed;
+    storeUnaligned(secret + i, Endian::little(lo));
+    storeUnaligned(secret + i + 8, Endian::little(hi));
+  }
+}
+
+// A Kernel accumulates whole stripes into the 8 accumulators, each with
+// the secret advanced by kSecretConsumeRate, and scrambles them at the end
+// of each block; the three implementations produce the same values.
+
+struct ScalarKernel {
+  static void
+  accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* s, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto stripe = in + i * kStripeLen;
+      auto key = s + i * kSecretConsumeRate;
+      for (size_t lane = 0; lane < kAccCount; ++lane) {
+        uint64_t data = xxh3Read64(stripe + 8 * lane);
+        uint64_t keyed = data ^ xxh3Read64(key + 8 * lane);
+        acc[lane ^ 1] += data;
+        acc[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+      }
+    }
+  }
+
+  static void scramble(uint64_t* acc, const uint8_t* s) {
+    for (size_t lane = 0; lane < kAccCount; ++lane) {
+      uint64_t a = xxh3XorShift(acc[lane], 47) ^ xxh3Read64(s + 8 * lane);
+      acc[lane] = a * kXxh3Prime32_1;
+    }
+  }
+};
+
+#if FOLLY_X64
+
+struct Avx2Kernel {
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static void
+  accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* s, size_t n) {
+    auto a = reinterpret_cast<__m256i*>(acc);
+    __m256i a0 = _mm256_load_si256(a);
+    __m256i a1 = _mm256_load_si256(a + 1);
+    for (size_t i = 0; i < n; ++i) {
+      auto stripe = reinterpret_cast<const __m256i*>(in + i * kStripeLen);
+      auto key =
+          reinterpret_cast<const __m256i*>(s + i * kSecretConsumeRate);
+      __m256i d0 = _mm256_loadu_si256(stripe);
+      __m256i d1 = _mm256_loadu_si256(stripe + 1);
+      __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(key));
+      __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(key + 1));
+      // low 32 bits of each lane times its high 32 bits
+      __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+      __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+      // and the data of the neighbouring lane
+      d0 = _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2));
+      d1 = _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2));
+      a0 = _mm256_add_epi64(a0, _mm256_add_epi64(d0, p0));
+      a1 = _mm256_add_epi64(a1, _mm256_add_epi64(d1, p1));
+    }
+    _mm256_store_si256(a, a0);
+    _mm256_store_si256(a + 1, a1);
+  }
+
+  FOLLY_TARGET_ATTRIBUTE("avx2")
+  static void scramble(uint64_t* acc, const uint8_t* s) {
+    auto a = reinterpret_cast<__m256i*>(acc);
+    auto key = reinterpret_cast<const __m256i*>(s);
+    const __m256i prime = _mm256_set1_epi32(int(kXxh3Prime32_1));
+    for (size_t i = 0; i < 2; ++i) {
+      __m256i v = _mm256_load_si256(a + i);
+      v = _mm256_xor_si256(v, _mm256_srli_epi64(v, 47));
+      v = _mm256_xor_si256(v, _mm256_loadu_si256(key + i));
+      // 64x32-bit multiply, from two 32x32-bit ones
+      __m256i lo = _mm256_mul_epu32(v, prime);
+      __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(v, 32), prime);
+      _mm256_store_si256(
+          a + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+  }
+};
+
+#endif
+
+#if FOLLY_XXH3_NEON
+
+struct NeonKernel {
+  static void
+  accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* s, size_t n) {
+    uint64x2_t a[4];
+    for (size_t j = 0; j < 4; ++j) {
+      a[j] = vld1q_u64(acc + 2 * j);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      auto stripe = in + i * kStripeLen;
+      auto key = s + i * kSecretConsumeRate;
+      for (size_t j = 0; j < 4; ++j) {
+        uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(stripe + 16 * j));
+        uint64x2_t keyed =
+            veorq_u64(data, vreinterpretq_u64_u8(vld1q_u8(key + 16 * j)));
+        uint64x2_t swapped = vextq_u64(data, data, 1);
+        a[j] = vaddq_u64(
+            a[j],
+            vmlal_u32(
+                swapped, vmovn_u64(keyed), vshrn_n_u64(keyed, 32)));
+      }
+    }
+    for (size_t j = 0; j < 4; ++j) {
+      vst1q_u64(acc + 2 * j, a[j]);
+    }
+  }
+
+  static void scramble(uint64_t* acc, const uint8_t* s) {
+    const uint32x2_t prime = vdup_n_u32(uint32_t(kXxh3Prime32_1));
+    for (size_t j = 0; j < 4; ++j) {
+      uint64x2_t v = vld1q_u64(acc + 2 * j);
+      v = veorq_u64(v, vshrq_n_u64(v, 47));
+      v = veorq_u64(v, vreinterpretq_u64_u8(vld1q_u8(s + 16 * j)));
+      uint64x2_t hi = vmull_u32(vshrn_n_u64(v, 32), prime);
+      uint64x2_t lo = vmull_u32(vmovn_u64(v), prime);
+      vst1q_u64(acc + 2 * j, vaddq_u64(lo, vshlq_n_u64(hi, 32)));
+    }
+  }
+};
+
+#endif
+
+template <class Kernel>
+void hashLong(uint64_t* acc, const uint8_t* in, size_t len, const uint8_t* s) {
+  initAcc(acc);
+  size_t blocks = (len - 1) / kBlockLen;
+  for (size_t n = 0; n < blocks; ++n) {
+    Kernel::accumulate(acc, in + n * kBlockLen, s, kStripesPerBlock);
+    Kernel::scramble(acc, s + kXxh3SecretSize - kStripeLen);
+  }
+  size_t stripes = ((len - 1) - kBlockLen * blocks) / kStripeLen;
+  Kernel::accumulate(acc, in + blocks * kBlockLen, s, stripes);
+  Kernel::accumulate(
+      acc,
+      in + len - kStripeLen,
+      s + kXxh3SecretSize - kStripeLen - kSecretLastAccStart,
+      1);
+}
+
+uint64_t mergeAccs(const uint64_t* acc, const uint8_t* s, uint64_t start) {
+  uint64_t result = start;
+  for (size_t i = 0; i < 4; ++i) {
+    result += xxh3MulFold64(
+        acc[2 * i] ^ xxh3Read64(s + 16 * i),
+        acc[2 * i + 1] ^ xxh3Read64(s + 16 * i + 8));
+  }
+  return xxh3Avalanche(result);
+}
+
+uint64_t merge64(const uint64_t* acc, const uint8_t* s, uint64_t len) {
+  return mergeAccs(acc, s + kSecretMergeAccsStart, len * kXxh3Prime64_1);
+}
+
+Xxh3Hash128 merge128(const uint64_t* acc, const uint8_t* s, uint64_t len) {
+  return {
+      mergeAccs(acc, s + kSecretMergeAccsStart, len * kXxh3Prime64_1),
+      mergeAccs(
+          acc,
+          s + kXxh3SecretSize - kStripeLen - kSecretMergeAccsStart,
+          ~(len * kXxh3Prime64_2))};
+}
+
+template <class Kernel>
+uint64_t hashLong64(const uint8_t* in, size_t len, uint64_t seed) {
+  alignas(64) uint64_t acc[kAccCount];
+  if (seed == 0) {
+    hashLong<Kernel>(acc, in, len, kXxh3Secret);
+    return merge64(acc, kXxh3Secret, len);
+  }
+  alignas(64) uint8_t secret[kXxh3SecretSize];
+  initSecret(secret, seed);
+  hashLong<Kernel>(acc, in, len, secret);
+  return merge64(acc, secret, len);
+}
+
+template <class Kernel>
+Xxh3Hash128 hashLong128(const uint8_t* in, size_t len, uint64_t seed) {
+  alignas(64) uint64_t acc[kAccCount];
+  if (seed == 0) {
+    hashLong<Kernel>(acc, in, len, kXxh3Secret);
+    return merge128(acc, kXxh3Secret, len);
+  }
+  alignas(64) uint8_t secret[kXxh3SecretSize];
+  initSecret(secret, seed);
+  hashLong<Kernel>(acc, in, len, secret);
+  return merge128(acc, secret, len);
+}
+
+#if FOLLY_X64
+bool hasAvx2() {
+  static const bool avx2 = CpuId().avx2();
+  return avx2;
+}
+#endif
+
+// Calls FN<Kernel>(...) with the best Kernel for this CPU
+#if FOLLY_X64
+#define FOLLY_XXH3_DISPATCH(FN, ...) \
+  (hasAvx2() ? FN<Avx2Kernel>(__VA_ARGS__) : FN<ScalarKernel>(__VA_ARGS__))
+#elif FOLLY_XXH3_NEON
+#define FOLLY_XXH3_DISPATCH(FN, ...) FN<NeonKernel>(__VA_ARGS__)
+#else
+#define FOLLY_XXH3_DISPATCH(FN, ...) FN<ScalarKernel>(__VA_ARGS__)
+#endif
+
+} // namespace
+
+namespace detail {
+
+uint64_t xxh3_64_long(const uint8_t* in, size_t len, uint64_t seed) {
+  return FOLLY_XXH3_DISPATCH(hashLong64, in, len, seed);
+}
+
+uint64_t xxh3_64_long_sw(const uint8_t* in, size_t len, uint64_t seed) {
+  return hashLong64<ScalarKernel>(in, len, seed);
+}
+
+Xxh3Hash128 xxh3_128_long(const uint8_t* in, size_t len, uint64_t seed) {
+  return FOLLY_XXH3_DISPATCH(hashLong128, in, len, seed);
+}
+
+Xxh3Hash128 xxh3_128_long_sw(const uint8_t* in, size_t len, uint64_t seed) {
+  return hashLong128<ScalarKernel>(in, len, seed);
+}
+
+} // namespace detail
+
+constexpr size_t Xxh3::kStripeLen;
+constexpr size_t Xxh3::kBufferSize;
+constexpr size_t Xxh3::kStripesPerBlock;
+
+void Xxh3::reset(uint64_t seed) {
+  initAcc(acc_);
+  initSecret(secret_, seed);
+  bufferedSize_ = 0;
+  stripesSoFar_ = 0;
+  totalLen_ = 0;
+  seed_ = seed;
+}
+
+namespace {
+
+// Accumulates stripes, scrambling whenever a block is complete; a block
+// may span several calls.
+template <class Kernel>
+const uint8_t* consumeStripes(
+    uint64_t* acc,
+    size_t& stripesSoFar,
+    const uint8_t* in,
+    size_t stripes,
+    const uint8_t* secret) {
+  auto key = secret + stripesSoFar * kSecretConsumeRate;
+  size_t blockStripes = kStripesPerBlock - stripesSoFar;
+  if (stripes >= blockStripes) {
+    do {
+      Kernel::accumulate(acc, in, key, blockStripes);
+      Kernel::scramble(acc, secret + kXxh3SecretSize - kStripeLen);
+      in += blockStripes * kStripeLen;
+      stripes -= blockStripes;
+      blockStripes = kStripesPerBlock;
+      key = secret;
+    } while (stripes >= kStripesPerBlock);
+    stripesSoFar = 0;
+  }
+  if (stripes > 0) {
+    Kernel::accumulate(acc, in, key, stripes);
+    in += stripes * kStripeLen;
+    stripesSoFar += stripes;
+  }
+  return in;
+}
+
+} // namespace
+
+template <class Kernel>
+void Xxh3::updateLong(const uint8_t* in, const uint8_t* end) {
+  constexpr size_t kBufferStripes = kBufferSize / kStripeLen;
+  if (bufferedSize_ > 0) {
+    size_t fill = kBufferSize - bufferedSize_;
+    std::memcpy(buffer_ + bufferedSize_, in, fill);
+    in += fill;
+    consumeStripes<Kernel>(
+        acc_, stripesSoFar_, buffer_, kBufferStripes, secret_);
+    bufferedSize_ = 0;
+  }
+  // Always keep some input buffered, since the last stripe is special
+  if (size_t(end - in) > kBufferSize) {
+    size_t stripes = size_t(end - 1 - in) / kStripeLen;
+    in = consumeStripes<Kernel>(acc_, stripesSoFar_, in, stripes, secret_);
+    // digestLong() may need the end of the last stripe
+    std::memcpy(
+        buffer_ + kBufferSize - kStripeLen, in - kStripeLen, kStripeLen);
+  }
+  std::memcpy(buffer_, in, size_t(end - in));
+  bufferedSize_ = size_t(end - in);
+}
+
+void Xxh3::update(const void* data, size_t len) {
+  auto in = static_cast<const uint8_t*>(data);
+  totalLen_ += len;
+  if (len <= kBufferSize - bufferedSize_) {
+    std::memcpy(buffer_ + bufferedSize_, in, len);
+    bufferedSize_ += len;
+    return;
+  }
+  FOLLY_XXH3_DISPATCH(updateLong, in, in + len);
+}
+
+template <class Kernel>
+void Xxh3::digestLong(uint64_t* acc) const {
+  std::memcpy(acc, acc_, sizeof(acc_));
+  alignas(64) uint8_t lastStripe[kStripeLen];
+  const uint8_t* lastStripePtr;
+  if (bufferedSize_ >= kStripeLen) {
+    size_t stripes = (bufferedSize_ - 1) / kStripeLen;
+    size_t stripesSoFar = stripesSoFar_;
+    consumeStripes<Kernel>(acc, stripesSoFar, buffer_, stripes, secret_);
+    lastStripePtr = buffer_ + bufferedSize_ - kStripeLen;
+  } else {
+    // The last stripe starts in what was consumed already
+    size_t catchup = kStripeLen - bufferedSize_;
+    std::memcpy(lastStripe, buffer_ + kBufferSize - catchup, catchup);
+    std::memcpy(lastStripe + catchup, buffer_, bufferedSize_);
+    lastStripePtr = lastStripe;
+  }
+  Kernel::accumulate(
+      acc,
+      lastStripePtr,
+      secret_ + kXxh3SecretSize - kStripeLen - kSecretLastAccStart,
+      1);
+}
+
+uint64_t Xxh3::digest64() const {
+  if (totalLen_ <= kXxh3MidSizeMax) {
+    return xxh3_64(buffer_, size_t(totalLen_), seed_);
+  }
+  alignas(64) uint64_t acc[kAccCount];
+  FOLLY_XXH3_DISPATCH(digestLong, acc);
+  return merge64(acc, secret_, totalLen_);
+}
+
+Xxh3Hash128 Xxh3::digest128() const {
+  if (totalLen_ <= kXxh3MidSizeMax) {
+    return xxh3_128(buffer_, size_t(totalLen_), seed_);
+  }
+  alignas(64) uint64_t acc[kAccCount];
+  FOLLY_XXH3_DISPATCH(digestLong, acc);
+  return merge128(acc, secret_, totalLen_);
+}
+
+#undef FOLLY_XXH3_DISPATCH
+
+} // namespace hash
+} // namespace folly
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// XXH3: 64 and 128-bit noncryptographic hash functions
+// By Yann Collet, BSD 2-Clause license
+//
+// This is the XXH3 algorithm of xxHash 0.8, producing the same values as
+// XXH3_64bits_withSeed() and XXH3_128bits_withSeed() of the reference
+// implementation (on both little and big-endian machines).
+//
+// It is much faster than SpookyHashV2 on short keys, which are hashed
+// entirely inline, and on long inputs, which are processed in 64-byte
+// stripes, with AVX2 or NEON when available.  Inputs up to 240 bytes never
+// leave this header.
+//
+// Values are only stable across folly versions as long as the reference
+// algorithm doesn't change; don't persist them if that matters.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <folly/Bits.h>
+#include <folly/Portability.h>
+
+namespace folly {
+namespace hash {
+
+struct Xxh3Hash128 {
+  uint64_t low64;
+  uint64_t high64;
+};
+
+inline bool operator==(const Xxh3Hash128& a, const Xxh3Hash128& b) {
+  return a.low64 == b.low64 && a.high64 == b.high64;
+}
+
+inline bool operator!=(const Xxh3Hash128& a, const Xxh3Hash128& b) {
+  return !(a == b);
+}
+
+namespace detail {
+
+constexpr size_t kXxh3SecretSize = 192;
+extern const uint8_t kXxh3Secret[kXxh3SecretSize];
+
+constexpr uint64_t kXxh3Prime32_1 = 0x9E3779B1U;
+constexpr uint64_t kXxh3Prime32_2 = 0x85EBCA77U;
+constexpr uint64_t kXxh3Prime32_3 = 0xC2B2AE3DU;
+constexpr uint64_t kXxh3Prime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kXxh3Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kXxh3Prime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kXxh3Prime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kXxh3Prime64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint64_t kXxh3PrimeMx1 = 0x165667919E3779F9ULL;
+constexpr uint64_t kXxh3PrimeMx2 = 0x9FB21C651E98DF25ULL;
+
+constexpr size_t kXxh3MidSizeMax = 240;
+constexpr size_t kXxh3SecretSizeMin = 136;
+constexpr size_t kXxh3MidSizeStartOffset = 3;
+constexpr size_t kXxh3MidSizeLastOffset = 17;
+
+inline uint32_t xxh3Read32(const uint8_t* p) {
+  return Endian::little(loadUnaligned<uint32_t>(p));
+}
+
+inline uint64_t xxh3Read64(const uint8_t* p) {
+  return Endian::little(loadUnaligned<uint64_t>(p));
+}
+
+inline uint64_t xxh3Rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint32_t xxh3Rotl32(uint32_t x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+inline Xxh3Hash128 xxh3Mul128(uint64_t a, uint64_t b) {
+#if FOLLY_HAVE_INT128_T
+  auto product = static_cast<unsigned __int128>(a) * b;
+  return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+  uint64_t loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+  uint64_t hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+  uint64_t loHi = (a & 0xFFFFFFFF) * (b >> 32);
+  uint64_t hiHi = (a >> 32) * (b >> 32);
+  uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+  return {(cross << 32) | (loLo & 0xFFFFFFFF),
+          (hiLo >> 32) + (cross >> 32) + hiHi};
+#endif
+}
+
+inline uint64_t xxh3MulFold64(uint64_t a, uint64_t b) {
+  auto product = xxh3Mul128(a, b);
+  return product.low64 ^ product.high64;
+}
+
+inline uint64_t xxh3XorShift(uint64_t h, int shift) {
+  return h ^ (h >> shift);
+}
+
+inline uint64_t xxh64Avalanche(uint64_t h) {
+  h = xxh3XorShift(h, 33) * kXxh3Prime64_2;
+  h = xxh3XorShift(h, 29) * kXxh3Prime64_3;
+  return xxh3XorShift(h, 32);
+}
+
+inline uint64_t xxh3Avalanche(uint64_t h) {
+  h = xxh3XorShift(h, 37) * kXxh3PrimeMx1;
+  return xxh3XorShift(h, 32);
+}
+
+inline uint64_t xxh3Rrmxmx(uint64_t h, uint64_t len) {
+  h ^= xxh3Rotl64(h, 49) ^ xxh3Rotl64(h, 24);
+  h *= kXxh3PrimeMx2;
+  h ^= (h >> 35) + len;
+  h *= kXxh3PrimeMx2;
+  return xxh3XorShift(h, 28);
+}
+
+inline uint64_t
+xxh3Mix16B(const uint8_t* in, const uint8_t* secret, uint64_t seed) {
+  return xxh3MulFold64(
+      xxh3Read64(in) ^ (xxh3Read64(secret) + seed),
+      xxh3Read64(in + 8) ^ (xxh3Read64(secret + 8) - seed));
+}
+
+inline uint64_t
+xxh3_64_0to16(const uint8_t* in, size_t len, const uint8_t* s, uint64_t seed) {
+  if (len > 8) {
+    uint64_t lo =
+        xxh3Read64(in) ^ ((xxh3Read64(s + 24) ^ xxh3Read64(s + 32)) + seed);
+    uint64_t hi = xxh3Read64(in + len - 8) ^
+        ((xxh3Read64(s + 40) ^ xxh3Read64(s + 48)) - seed);
+    return xxh3Avalanche(
+        len + Endian::swap(lo) + hi + xxh3MulFold64(lo, hi));
+  }
+  if (len >= 4) {
+    seed ^= uint64_t(Endian::swap(uint32_t(seed))) << 32;
+    uint64_t input64 =
+        xxh3Read32(in + len - 4) + (uint64_t(xxh3Read32(in)) << 32);
+    uint64_t bitflip = (xxh3Read64(s + 8) ^ xxh3Read64(s + 16)) - seed;
+    return xxh3Rrmxmx(input64 ^ bitflip, len);
+  }
+  if (len > 0) {
+    uint32_t combined = (uint32_t(in[0]) << 16) |
+        (uint32_t(in[len >> 1]) << 24) | uint32_t(in[len - 1]) |
+        (uint32_t(len) << 8);
+    uint64_t bitflip = (xxh3Read32(s) ^ xxh3Read32(s + 4)) + seed;
+    return xxh64Avalanche(combined ^ bitflip);
+  }
+  return xxh64Avalanche(seed ^ xxh3Read64(s + 56) ^ xxh3Read64(s + 64));
+}
+
+inline uint64_t xxh3_64_17to128(
+    const uint8_t* in,
+    size_t len,
+    const uint8_t* s,
+    uint64_t seed) {
+  uint64_t acc = len * kXxh3Prime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += xxh3Mix16B(in + 48, s + 96, seed);
+        acc += xxh3Mix16B(in + len - 64, s + 112, seed);
+      }
+      acc += xxh3Mix16B(in + 32, s + 64, seed);
+      acc += xxh3Mix16B(in + len - 48, s + 80, seed);
+    }
+    acc += xxh3Mix16B(in + 16, s + 32, seed);
+    acc += xxh3Mix16B(in + len - 32, s + 48, seed);
+  }
+  acc += xxh3Mix16B(in, s, seed);
+  acc += xxh3Mix16B(in + len - 16, s + 16, seed);
+  return xxh3Avalanche(acc);
+}
+
+inline uint64_t xxh3_64_129to240(
+    const uint8_t* in,
+    size_t len,
+    const uint8_t* s,
+    uint64_t seed) {
+  uint64_t acc = len * kXxh3Prime64_1;
+  for (size_t i = 0; i < 8; ++i) {
+    acc += xxh3Mix16B(in + 16 * i, s + 16 * i, seed);
+  }
+  uint64_t accEnd = xxh3Mix16B(
+      in + len - 16, s + kXxh3SecretSizeMin - kXxh3MidSizeLastOffset, seed);
+  acc = xxh3Avalanche(acc);
+  size_t rounds = len / 16;
+  for (size_t i = 8; i < rounds; ++i) {
+    accEnd += xxh3Mix16B(
+        in + 16 * i, s + 16 * (i - 8) + kXxh3MidSizeStartOffset, seed);
+  }
+  return xxh3Avalanche(acc + accEnd);
+}
+
+inline Xxh3Hash128 xxh3_128_0to16(
+    const uint8_t* in,
+    size_t len,
+    const uint8_t* s,
+    uint64_t seed) {
+  if (len > 8) {
+    uint64_t bitflipl = (xxh3Read64(s + 32) ^ xxh3Read64(s + 40)) - seed;
+    uint64_t bitfliph = (xxh3Read64(s + 48) ^ xxh3Read64(s + 56)) + seed;
+    uint64_t lo = xxh3Read64(in);
+    uint64_t hi = xxh3Read64(in + len - 8);
+    auto m = xxh3Mul128(lo ^ hi ^ bitflipl, kXxh3Prime64_1);
+    m.low64 += uint64_t(len - 1) << 54;
+    hi ^= bitfliph;
+    m.high64 += hi + uint64_t(uint32_t(hi)) * (kXxh3Prime32_2 - 1);
+    m.low64 ^= Endian::swap(m.high64);
+    auto h = xxh3Mul128(m.low64, kXxh3Prime64_2);
+    h.high64 += m.high64 * kXxh3Prime64_2;
+    return {xxh3Avalanche(h.low64), xxh3Avalanche(h.high64)};
+  }
+  if (len >= 4) {
+    seed ^= uint64_t(Endian::swap(uint32_t(seed))) << 32;
+    uint64_t input64 =
+        xxh3Read32(in) + (uint64_t(xxh3Read32(in + len - 4)) << 32);
+    uint64_t bitflip = (xxh3Read64(s + 16) ^ xxh3Read64(s + 24)) + seed;
+    auto m = xxh3Mul128(input64 ^ bitflip, kXxh3Prime64_1 + (len << 2));
+    m.high64 += m.low64 << 1;
+    m.low64 ^= m.high64 >> 3;
+    m.low64 = xxh3XorShift(m.low64, 35) * kXxh3PrimeMx2;
+    m.low64 = xxh3XorShift(m.low64, 28);
+    m.high64 = xxh3Avalanche(m.high64);
+    return m;
+  }
+  if (len > 0) {
+    uint32_t combinedl = (uint32_t(in[0]) << 16) |
+        (uint32_t(in[len >> 1]) << 24) | uint32_t(in[len - 1]) |
+        (uint32_t(len) << 8);
+    uint32_t combinedh = xxh3Rotl32(Endian::swap(combinedl), 13);
+    uint64_t bitflipl = (xxh3Read32(s) ^ xxh3Read32(s + 4)) + seed;
+    uint64_t bitfliph = (xxh3Read32(s + 8) ^ xxh3Read32(s + 12)) - seed;
+    return {xxh64Avalanche(combinedl ^ bitflipl),
+            xxh64Avalanche(combinedh ^ bitfliph)};
+  }
+  return {xxh64Avalanche(seed ^ xxh3Read64(s + 64) ^ xxh3Read64(s + 72)),
+          xxh64Avalanche(seed ^ xxh3Read64(s + 80) ^ xxh3Read64(s + 88))};
+}
+
+inline void xxh3Mix32B(
+    Xxh3Hash128& acc,
+    const uint8_t* in1,
+    const uint8_t* in2,
+    const uint8_t* s,
+    uint64_t seed) {
+  acc.low64 += xxh3Mix16B(in1, s, seed);
+  acc.low64 ^= xxh3Read64(in2) + xxh3Read64(in2 + 8);
+  acc.high64 += xxh3Mix16B(in2, s + 16, seed);
+  acc.high64 ^= xxh3Read64(in1) + xxh3Read64(in1 + 8);
+}
+
+inline Xxh3Hash128
+xxh3_128_finish(const Xxh3Hash128& acc, size_t len, uint64_t seed) {
+  uint64_t lo = acc.low64 + acc.high64;
+  uint64_t hi = acc.low64 * kXxh3Prime64_1 + acc.high64 * kXxh3Prime64_4 +
+      (len - seed) * kXxh3Prime64_2;
+  return {xxh3Avalanche(lo), 0 - xxh3Avalanche(hi)};
+}
+
+inline Xxh3Hash128 xxh3_128_17to128(
+    const uint8_t* in,
+    size_t len,
+    const uint8_t* s,
+    uint64_t seed) {
+  Xxh3Hash128 acc{len * kXxh3Prime64_1, 0};
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        xxh3Mix32B(acc, in + 48, in + len - 64, s + 96, seed);
+      }
+      xxh3Mix32B(acc, in + 32, in + len - 48, s + 64, seed);
+    }
+    xxh3Mix32B(acc, in + 16, in + len - 32, s + 32, seed);
+  }
+  xxh3Mix32B(acc, in, in + len - 16, s, seed);
+  return xxh3_128_finish(acc, len, seed);
+}
+
+inline Xxh3Hash128 xxh3_128_129to240(
+    const uint8_t* in,
+    size_t len,
+    const uint8_t* s,
+    uint64_t seed) {
+  Xxh3Hash128 acc{len * kXxh3Prime64_1, 0};
+  for (size_t i = 32; i < 160; i += 32) {
+    xxh3Mix32B(acc, in + i - 32, in + i - 16, s + i - 32, seed);
+  }
+  acc.low64 = xxh3Avalanche(acc.low64);
+  acc.high64 = xxh3Avalanche(acc.high64);
+  for (size_t i = 160; i <= len; i += 32) {
+    xxh3Mix32B(
+        acc,
+        in + i - 32,
+        in + i - 16,
+        s + kXxh3MidSizeStartOffset + i - 160,
+        seed);
+  }
+  xxh3Mix32B(
+      acc,
+      in + len - 16,
+      in + len - 32,
+      s + kXxh3SecretSizeMin - kXxh3MidSizeLastOffset - 16,
+      0 - seed);
+  return xxh3_128_finish(acc, len, seed);
+}
+
+// Inputs longer than kXxh3MidSizeMax.  The _sw versions never use SIMD.
+uint64_t xxh3_64_long(const uint8_t* in, size_t len, uint64_t seed);
+uint64_t xxh3_64_long_sw(const uint8_t* in, size_t len, uint64_t seed);
+Xxh3Hash128 xxh3_128_long(const uint8_t* in, size_t len, uint64_t seed);
+Xxh3Hash128 xxh3_128_long_sw(const uint8_t* in, size_t len, uint64_t seed);
+
+} // namespace detail
+
+/**
+ * 64-bit XXH3 of len bytes at data.
+ */
+inline uint64_t xxh3_64(const void* data, size_t len, uint64_t seed = 0) {
+  auto in = static_cast<const uint8_t*>(data);
+  auto s = detail::kXxh3Secret;
+  if (len <= 16) {
+    return detail::xxh3_64_0to16(in, len, s, seed);
+  }
+  if (len <= 128) {
+    return detail::xxh3_64_17to128(in, len, s, seed);
+  }
+  if (len <= detail::kXxh3MidSizeMax) {
+    return detail::xxh3_64_129to240(in, len, s, seed);
+  }
+  return detail::xxh3_64_long(in, len, seed);
+}
+
+/**
+ * 128-bit XXH3 of len bytes at data.  Not simply two 64-bit hashes: the low
+ * 64 bits differ from xxh3_64().
+ */
+inline Xxh3Hash128
+xxh3_128(const void* data, size_t len, uint64_t seed = 0) {
+  auto in = static_cast<const uint8_t*>(data);
+  auto s = detail::kXxh3Secret;
+  if (len <= 16) {
+    return detail::xxh3_128_0to16(in, len, s, seed);
+  }
+  if (len <= 128) {
+    return detail::xxh3_128_17to128(in, len, s, seed);
+  }
+  if (len <= detail::kXxh3MidSizeMax) {
+    return detail::xxh3_128_129to240(in, len, s, seed);
+  }
+  return detail::xxh3_128_long(in, len, seed);
+}
+
+/**
+ * Streaming XXH3: the digests of a sequence of update()s are the hashes of
+ * the concatenation of their inputs.  Both digests can be taken, at any
+ * time, and more data added afterwards.
+ *
+ *   Xxh3 hasher(seed);
+ *   for (auto& chunk : chunks) {
+ *     hasher.update(chunk.data(), chunk.size());
+ *   }
+ *   uint64_t h = hasher.digest64();
+ *
+ * Buffers up to 256 bytes, so an Xxh3 takes about 600 bytes.
+ */
+class Xxh3 {
+ public:
+  explicit Xxh3(uint64_t seed = 0) {
+    reset(seed);
+  }
+
+  void reset(uint64_t seed = 0);
+
+  void update(const void* data, size_t len);
+
+  uint64_t digest64() const;
+  Xxh3Hash128 digest128() const;
+
+ private:
+  static constexpr size_t kStripeLen = 64;
+  static constexpr size_t kBufferSize = 256;
+  static constexpr size_t kStripesPerBlock =
+      (detail::kXxh3SecretSize - kStripeLen) / 8;
+
+  template <class Kernel>
+  void updateLong(const uint8_t* in, const uint8_t* end);
+  template <class Kernel>
+  void digestLong(uint64_t* acc) const;
+
+  alignas(64) uint64_t acc_[8];
+  alignas(64) uint8_t secret_[detail::kXxh3SecretSize];
+  alignas(64) uint8_t buffer_[kBufferSize];
+  size_t bufferedSize_;
+  size_t stripesSoFar_;
+  uint64_t totalLen_;
+  uint64_t seed_;
+};
+
+} // namespace hash
+} // namespace folly
@@ -112,6 +112,26 @@
 
 #include <folly/hash/detail/ChecksumDetail.h>
 
+#include <algorithm>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+
+#if FOLLY_AARCH64 && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// The 512-bit carry-less multiplication of AVX-512 (VPCLMULQDQ) needs GCC 8
+// or clang 6
+#if FOLLY_SSE_PREREQ(4, 2) && FOLLY_X64 &&                        \
+    ((defined(__clang__) && __clang_major__ >= 6) ||             \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define FOLLY_CRC_AVX512 1
+#else
+#define FOLLY_CRC_AVX512 0
+#endif
+
 namespace folly {
 namespace detail {
 
@@ -272,6 +292,248 @@ _128_bits_at_a_time:
   return _mm_cvtsi128_si32(_mm_srli_si128(_mm_xor_si128(x0, x1), 4));
 }
 
+// Fast SIMD implementation of CRC-32 for x86 with pclmul
+uint32_t
+crc32_hw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  uint32_t sum = startingChecksum;
+  size_t offset = 0;
+
+  // Process unaligned bytes
+  if ((uintptr_t)data & 15) {
+    size_t limit = std::min(nbytes, -(uintptr_t)data & 15);
+    sum = crc32_sw(data, limit, sum);
+    offset += limit;
+    nbytes -= limit;
+  }
+
+  if (nbytes >= 16) {
+    sum = crc32_hw_aligned(sum, (const __m128i*)(data + offset), nbytes / 16);
+    offset += nbytes & ~15;
+    nbytes &= 15;
+  }
+
+  // Remaining unaligned bytes
+  return crc32_sw(data + offset, nbytes, sum);
+}
+
+// Both use pclmul: crc32c_hw() to combine its three streams
+bool crc32c_hw_supported() {
+  static folly::CpuId id;
+  return id.sse42() && id.pclmuldq();
+}
+
+bool crc32_hw_supported() {
+  static folly::CpuId id;
+  return id.sse42() && id.pclmuldq();
+}
+
+#elif FOLLY_AARCH64 && defined(__ARM_FEATURE_CRC32)
+
+// The CRC instructions of ARMv8 cover both polynomials
+uint32_t
+crc32_hw(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  uint32_t sum = startingChecksum;
+  for (; nbytes >= 8; data += 8, nbytes -= 8) {
+    sum = __crc32d(sum, loadUnaligned<uint64_t>(data));
+  }
+  for (; nbytes > 0; ++data, --nbytes) {
+    sum = __crc32b(sum, *data);
+  }
+  return sum;
+}
+
+bool crc32c_hw_supported() {
+  return true;
+}
+
+bool crc32_hw_supported() {
+  return true;
+}
+
+#else
+
+uint32_t crc32_hw(const uint8_t* /* data */, size_t /* nbytes */,
+    uint32_t /* startingChecksum */) {
+  throw std::runtime_error("crc32_hw is not implemented on this platform");
+}
+
+bool crc32c_hw_supported() {
+  return false;
+}
+
+bool crc32_hw_supported() {
+  return false;
+}
+
+#endif
+
+#if FOLLY_CRC_AVX512
+
+namespace {
+
+/*
+ * The multipliers x^D mod G(x) for folding 128-bit lanes across D bits, as
+ * in crc32_hw_aligned(): the low one for the lower half of the lane (the
+ * higher-degree terms), the high one for the upper half; and the constants
+ * of its final reduction.  Computed like those of crc32_hw_aligned(), by
+ * gen_crc32_multipliers.c.
+ */
+struct FoldConstants {
+  uint32_t fold2048Lo, fold2048Hi;
+  uint32_t fold512Lo, fold512Hi;
+  uint32_t fold128Lo, fold128Hi;
+  uint32_t finalMultiplier;
+  uint64_t barrettQuotient, barrettPolynomial;
+};
+
+constexpr FoldConstants kCrc32Constants = {
+    0xCE3371CB, 0xE95C1271, 0x8F352D95, 0x1D9513D7, 0xAE689191, 0xCCAA009E,
+    0xB8BC6765, 0x1F7011641, 0x1DB710641};
+
+constexpr FoldConstants kCrc32cConstants = {
+    0xDCB17AA4, 0xB9E02B86, 0x740EEF02, 0x9E4ADDF8, 0xF20C0DFE, 0x493C7D27,
+    0xDD45AAB8, 0x0DEA713F1, 0x105EC76F1};
+
+FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vl,vpclmulqdq")
+inline __m512i fold512(__m512i x, __m512i multipliers, __m512i next) {
+  // next ^ x.lo * multipliers.lo ^ x.hi * multipliers.hi, lane by lane
+  return _mm512_ternarylogic_epi64(
+      next,
+      _mm512_clmulepi64_epi128(x, multipliers, 0x00),
+      _mm512_clmulepi64_epi128(x, multipliers, 0x11),
+      0x96);
+}
+
+inline __m128i fold128(__m128i x, __m128i multipliers, __m128i next) {
+  next = _mm_xor_si128(next, _mm_clmulepi64_si128(x, multipliers, 0x00));
+  return _mm_xor_si128(next, _mm_clmulepi64_si128(x, multipliers, 0x11));
+}
+
+/*
+ * Fold nblocks >= 1 blocks of 256 bytes with four 512-bit accumulators (16
+ * lanes of 128 bits), then fold those into one lane and reduce it to the
+ * CRC, as at the end of crc32_hw_aligned().
+ */
+FOLLY_TARGET_ATTRIBUTE("avx512f,avx512vl,vpclmulqdq")
+uint32_t crc_fold_avx512(
+    const FoldConstants& k,
+    uint32_t remainder,
+    const uint8_t* data,
+    size_t nblocks) {
+  const __m512i multipliers2048 = _mm512_broadcast_i32x4(
+      _mm_set_epi32(0, k.fold2048Hi, 0, k.fold2048Lo));
+  const __m512i multipliers512 =
+      _mm512_broadcast_i32x4(_mm_set_epi32(0, k.fold512Hi, 0, k.fold512Lo));
+  const __m128i multipliers128 =
+      _mm_set_epi32(0, k.fold128Hi, 0, k.fold128Lo);
+  const __m128i finalMultiplier = _mm_set_epi32(0, 0, 0, k.finalMultiplier);
+  const __m128i mask32 = _mm_set_epi32(0, 0, 0, 0xFFFFFFFF);
+  const __m128i barrett =
+      _mm_set_epi64x(k.barrettPolynomial, k.barrettQuotient);
+
+  auto p = reinterpret_cast<const __m512i*>(data);
+  const auto end = p + nblocks * 4;
+
+  // The CRC so far goes into the first 32 bits, as in crc32_hw_aligned()
+  __m512i x0 = _mm512_xor_si512(
+      _mm512_loadu_si512(p),
+      _mm512_inserti32x4(
+          _mm512_setzero_si512(), _mm_cvtsi32_si128(remainder), 0));
+  __m512i x1 = _mm512_loadu_si512(p + 1);
+  __m512i x2 = _mm512_loadu_si512(p + 2);
+  __m512i x3 = _mm512_loadu_si512(p + 3);
+  for (p += 4; p != end; p += 4) {
+    x0 = fold512(x0, multipliers2048, _mm512_loadu_si512(p));
+    x1 = fold512(x1, multipliers2048, _mm512_loadu_si512(p + 1));
+    x2 = fold512(x2, multipliers2048, _mm512_loadu_si512(p + 2));
+    x3 = fold512(x3, multipliers2048, _mm512_loadu_si512(p + 3));
+  }
+
+  // 2048 => 512 bits
+  x1 = fold512(x0, multipliers512, x1);
+  x2 = fold512(x1, multipliers512, x2);
+  x3 = fold512(x2, multipliers512, x3);
+
+  // 512 => 128 bits
+  __m128i y = _mm512_castsi512_si128(x3);
+  y = fold128(y, multipliers128, _mm512_extracti32x4_epi32(x3, 1));
+  y = fold128(y, multipliers128, _mm512_extracti32x4_epi32(x3, 2));
+  y = fold128(y, multipliers128, _mm512_extracti32x4_epi32(x3, 3));
+
+  // 128 => 96 => 64 bits, then Barrett reduction to 32 bits
+  y = _mm_xor_si128(
+      _mm_srli_si128(y, 8), _mm_clmulepi64_si128(y, multipliers128, 0x10));
+  y = _mm_xor_si128(
+      _mm_srli_si128(y, 4),
+      _mm_clmulepi64_si128(_mm_and_si128(y, mask32), finalMultiplier, 0x00));
+  __m128i z = _mm_clmulepi64_si128(_mm_and_si128(y, mask32), barrett, 0x00);
+  z = _mm_clmulepi64_si128(_mm_and_si128(z, mask32), barrett, 0x10);
+  return _mm_cvtsi128_si32(_mm_srli_si128(_mm_xor_si128(z, y), 4));
+}
+
+} // namespace
+
+uint32_t crc32c_hw_avx512(
+    const uint8_t* data,
+    size_t nbytes,
+    uint32_t startingChecksum) {
+  uint32_t sum = startingChecksum;
+  if (nbytes >= 256) {
+    sum = crc_fold_avx512(kCrc32cConstants, sum, data, nbytes / 256);
+    data += nbytes & ~size_t(255);
+    nbytes &= 255;
+  }
+  return crc32c_hw(data, nbytes, sum);
+}
+
+uint32_t crc32_hw_avx512(
+    const uint8_t* data,
+    size_t nbytes,
+    uint32_t startingChecksum) {
+  uint32_t sum = startingChecksum;
+  if (nbytes >= 256) {
+    sum = crc_fold_avx512(kCrc32Constants, sum, data, nbytes / 256);
+    data += nbytes & ~size_t(255);
+    nbytes &= 255;
+  }
+  return crc32_hw(data, nbytes, sum);
+}
+
+bool crc_avx512_supported() {
+  static const bool supported = [] {
+    folly::CpuId id;
+    if (!(id.avx512f() && id.avx512vl() && id.vpclmulqdq() && id.osxsave() &&
+          crc32c_hw_supported())) {
+      return false;
+    }
+    // The OS must save the AVX-512 registers (opmask, and the upper halves
+    // of zmm0-15 and zmm16-31) on context switches, and the SSE and AVX ones
+    uint32_t xcr0;
+    uint32_t unused;
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(unused) : "c"(0));
+    return (xcr0 & 0xE6) == 0xE6;
+  }();
+  return supported;
+}
+
+#else
+
+uint32_t crc32c_hw_avx512(const uint8_t* /* data */, size_t /* nbytes */,
+    uint32_t /* startingChecksum */) {
+  throw std::runtime_error(
+      "crc32c_hw_avx512 is not implemented on this platform");
+}
+
+uint32_t crc32_hw_avx512(const uint8_t* /* data */, size_t /* nbytes */,
+    uint32_t /* startingChecksum */) {
+  throw std::runtime_error(
+      "crc32_hw_avx512 is not implemented on this platform");
+}
+
+bool crc_avx512_supported() {
+  return false;
+}
+
 #endif
 } // namespace detail
 } // namespace folly
@@ -60,6 +60,50 @@ bool crc32c_hw_supported();
 uint32_t crc32c_sw(const uint8_t* data, size_t nbytes,
     uint32_t startingChecksum = ~0U);
 
+/**
+ * Compute the CRC-32C checksums of count independent buffers using a
+ * hardware-accelerated implementation that interleaves four buffers at a
+ * time, to hide the latency of the CRC instruction.
+ *
+ * @note See crc32c_multi().  Only call this if crc32c_hw_supported().
+ */
+void crc32c_hw_multi(
+    const uint8_t* const* data,
+    const size_t* nbytes,
+    uint32_t* checksums,
+    size_t count,
+    uint32_t startingChecksum = ~0U);
+
+/**
+ * Compute a CRC-32C checksum of a buffer by folding 256 bytes at a time
+ * with the 512-bit carry-less multiplications of AVX-512 (VPCLMULQDQ), and
+ * the tail with crc32c_hw().  Much faster than crc32c_hw() for buffers of
+ * a few KB or more.
+ *
+ * @note Only call this if crc_avx512_supported().
+ */
+uint32_t crc32c_hw_avx512(
+    const uint8_t* data,
+    size_t nbytes,
+    uint32_t startingChecksum = ~0U);
+
+/**
+ * Compute a CRC-32 checksum of a buffer as crc32c_hw_avx512() does, with
+ * crc32_hw() for the tail.
+ *
+ * @note Only call this if crc_avx512_supported().
+ */
+uint32_t crc32_hw_avx512(
+    const uint8_t* data,
+    size_t nbytes,
+    uint32_t startingChecksum = ~0U);
+
+/**
+ * Check whether the CPU, and the OS, support the AVX-512 implementations
+ * of CRC-32 and CRC-32C.
+ */
+bool crc_avx512_supported();
+
 /**
  * Compute a CRC-32 checksum of a buffer using a hardware-accelerated
  * implementation.
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/BatchHash.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <folly/hash/Xxh3.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace folly::hash;
+
+namespace {
+template <class T>
+std::vector<T> randomKeys(size_t n) {
+  std::mt19937_64 rng(1729);
+  std::vector<T> keys(n);
+  for (auto& key : keys) {
+    key = static_cast<T>(rng());
+  }
+  return keys;
+}
+} // namespace
+
+TEST(BatchHash, TwangMix64) {
+  // Not a multiple of the vector widths, and from an unaligned start
+  auto keys = randomKeys<uint64_t>(103);
+  std::vector<uint64_t> hashes(keys.size());
+  twang_mix64_batch(keys.data() + 1, keys.size() - 1, hashes.data());
+  for (size_t i = 1; i < keys.size(); ++i) {
+    EXPECT_EQ(twang_mix64(keys[i]), hashes[i - 1]);
+  }
+}
+
+TEST(BatchHash, Xxh3Keys) {
+  auto keys = randomKeys<uint64_t>(103);
+  std::vector<uint64_t> hashes(keys.size());
+  for (uint64_t seed : {uint64_t(0), uint64_t(42), ~uint64_t(0) / 3}) {
+    xxh3_64_batch(keys.data(), keys.size(), hashes.data(), seed);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      EXPECT_EQ(xxh3_64(&keys[i], sizeof(keys[i]), seed), hashes[i]);
+    }
+  }
+}
+
+TEST(BatchHash, Xxh3Records) {
+  std::string data;
+  std::mt19937 rng(1729);
+  for (size_t i = 0; i < 300 * 20; ++i) {
+    data.push_back(char(rng()));
+  }
+  for (size_t len : {0, 3, 8, 16, 100, 300}) {
+    std::vector<uint64_t> hashes(20);
+    xxh3_64_batch(data.data() + 1, len, hashes.size(), hashes.data(), 7);
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      EXPECT_EQ(xxh3_64(data.data() + 1 + i * len, len, 7), hashes[i]);
+    }
+  }
+}
+
+TEST(BatchHash, Hasher) {
+  auto keys64 = randomKeys<int64_t>(37);
+  auto keys32 = randomKeys<int32_t>(37);
+  auto keys16 = randomKeys<uint16_t>(37);
+  std::vector<uint64_t> hashes(37);
+
+  hash_batch(keys64.data(), keys64.size(), hashes.data());
+  for (size_t i = 0; i < keys64.size(); ++i) {
+    EXPECT_EQ(hasher<int64_t>()(keys64[i]), hashes[i]);
+  }
+  hash_batch(keys32.data(), keys32.size(), hashes.data());
+  for (size_t i = 0; i < keys32.size(); ++i) {
+    EXPECT_EQ(hasher<int32_t>()(keys32[i]), hashes[i]);
+  }
+  hash_batch(keys16.data(), keys16.size(), hashes.data());
+  for (size_t i = 0; i < keys16.size(); ++i) {
+    EXPECT_EQ(hasher<uint16_t>()(keys16[i]), hashes[i]);
+  }
+
+  std::vector<std::string> strings{"a", "bc", "def"};
+  hash_batch(strings.data(), strings.size(), hashes.data());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(hasher<std::string>()(strings[i]), hashes[i]);
+  }
+
+  auto identity = [](uint64_t key) { return key; };
+  hash_batch(keys64.data(), keys64.size(), hashes.data(), identity);
+  for (size_t i = 0; i < keys64.size(); ++i) {
+    EXPECT_EQ(uint64_t(keys64[i]), hashes[i]);
+  }
+}
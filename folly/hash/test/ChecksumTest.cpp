@@ -194,6 +194,67 @@ TEST(Checksum, crc32_continuation) {
   }
 }
 
+TEST(Checksum, crc32c_avx512) {
+  if (folly::detail::crc_avx512_supported()) {
+    testCRC32C(folly::detail::crc32c_hw_avx512);
+    testCRC32CContinuation(folly::detail::crc32c_hw_avx512);
+    for (size_t len = 0; len < 5000; len += 37) {
+      for (size_t offset : {0, 1, 7}) {
+        EXPECT_EQ(
+            folly::detail::crc32c_sw(buffer + offset, len, 0),
+            folly::detail::crc32c_hw_avx512(buffer + offset, len, 0));
+      }
+    }
+  } else {
+    LOG(WARNING) << "skipping AVX-512 CRC-32C tests"
+                 << " (not supported on this CPU)";
+  }
+}
+
+TEST(Checksum, crc32_avx512) {
+  if (folly::detail::crc_avx512_supported()) {
+    for (auto expected : expectedResults) {
+      auto data = buffer + expected.offset;
+      EXPECT_EQ(
+          folly::detail::crc32_sw(data, expected.length, ~0U),
+          folly::detail::crc32_hw_avx512(data, expected.length, ~0U));
+    }
+    for (size_t len = 0; len < 5000; len += 37) {
+      for (size_t offset : {0, 1, 7}) {
+        EXPECT_EQ(
+            folly::detail::crc32_sw(buffer + offset, len, 0),
+            folly::detail::crc32_hw_avx512(buffer + offset, len, 0));
+      }
+    }
+  } else {
+    LOG(WARNING) << "skipping AVX-512 CRC-32 tests"
+                 << " (not supported on this CPU)";
+  }
+}
+
+TEST(Checksum, crc32c_multi) {
+  // Buffers of different lengths and alignments, some empty
+  std::vector<const uint8_t*> data;
+  std::vector<size_t> nbytes;
+  for (size_t i = 0; i < 23; ++i) {
+    data.push_back(buffer + 1000 * i + i % 8);
+    nbytes.push_back(i % 5 == 4 ? 0 : 64 * (i % 3) + 7 * i);
+  }
+  std::vector<uint32_t> checksums(data.size());
+  folly::crc32c_multi(
+      data.data(), nbytes.data(), checksums.data(), data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(folly::crc32c(data[i], nbytes[i]), checksums[i]);
+    EXPECT_EQ(folly::detail::crc32c_sw(data[i], nbytes[i]), checksums[i]);
+  }
+
+  folly::crc32c_multi(
+      data.data(), nbytes.data(), checksums.data(), data.size(), 42);
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(folly::crc32c(data[i], nbytes[i], 42), checksums[i]);
+  }
+}
+
 TEST(Checksum, crc32_type) {
   // Test that crc32_type matches boost::crc_32_type
   testMatchesBoost32Type();
@@ -241,12 +302,42 @@ void benchmarkSoftwareCRC32(unsigned long iters, size_t blockSize) {
   }
 }
 
+void benchmarkAvx512CRC32C(unsigned long iters, size_t blockSize) {
+  if (folly::detail::crc_avx512_supported()) {
+    uint32_t checksum;
+    for (unsigned long i = 0; i < iters; i++) {
+      checksum = folly::detail::crc32c_hw_avx512(buffer, blockSize);
+      folly::doNotOptimizeAway(checksum);
+    }
+  } else {
+    LOG(WARNING) << "skipping AVX-512 CRC-32C benchmarks"
+                 << " (not supported on this CPU)";
+  }
+}
+
+void benchmarkAvx512CRC32(unsigned long iters, size_t blockSize) {
+  if (folly::detail::crc_avx512_supported()) {
+    uint32_t checksum;
+    for (unsigned long i = 0; i < iters; i++) {
+      checksum = folly::detail::crc32_hw_avx512(buffer, blockSize);
+      folly::doNotOptimizeAway(checksum);
+    }
+  } else {
+    LOG(WARNING) << "skipping AVX-512 CRC-32 benchmarks"
+                 << " (not supported on this CPU)";
+  }
+}
+
 // This test fits easily in the L1 cache on modern server processors,
 // and thus it mainly measures the speed of the checksum computation.
 BENCHMARK(crc32c_hardware_1KB_block, iters) {
   benchmarkHardwareCRC32C(iters, 1024);
 }
 
+BENCHMARK(crc32c_avx512_1KB_block, iters) {
+  benchmarkAvx512CRC32C(iters, 1024);
+}
+
 BENCHMARK(crc32c_software_1KB_block, iters) {
   benchmarkSoftwareCRC32C(iters, 1024);
 }
@@ -255,6 +346,10 @@ BENCHMARK(crc32_hardware_1KB_block, iters) {
   benchmarkHardwareCRC32(iters, 1024);
 }
 
+BENCHMARK(crc32_avx512_1KB_block, iters) {
+  benchmarkAvx512CRC32(iters, 1024);
+}
+
 BENCHMARK(crc32_software_1KB_block, iters) {
   benchmarkSoftwareCRC32(iters, 1024);
 }
@@ -266,6 +361,10 @@ BENCHMARK(crc32c_hardware_64KB_block, iters) {
   benchmarkHardwareCRC32C(iters, 64 * 1024);
 }
 
+BENCHMARK(crc32c_avx512_64KB_block, iters) {
+  benchmarkAvx512CRC32C(iters, 64 * 1024);
+}
+
 BENCHMARK(crc32c_software_64KB_block, iters) {
   benchmarkSoftwareCRC32C(iters, 64 * 1024);
 }
@@ -274,6 +373,10 @@ BENCHMARK(crc32_hardware_64KB_block, iters) {
   benchmarkHardwareCRC32(iters, 64 * 1024);
 }
 
+BENCHMARK(crc32_avx512_64KB_block, iters) {
+  benchmarkAvx512CRC32(iters, 64 * 1024);
+}
+
 BENCHMARK(crc32_software_64KB_block, iters) {
   benchmarkSoftwareCRC32(iters, 64 * 1024);
 }
@@ -285,6 +388,10 @@ BENCHMARK(crc32c_hardware_512KB_block, iters) {
   benchmarkHardwareCRC32C(iters, 512 * 1024);
 }
 
+BENCHMARK(crc32c_avx512_512KB_block, iters) {
+  benchmarkAvx512CRC32C(iters, 512 * 1024);
+}
+
 BENCHMARK(crc32c_software_512KB_block, iters) {
   benchmarkSoftwareCRC32C(iters, 512 * 1024);
 }
@@ -293,10 +400,47 @@ BENCHMARK(crc32_hardware_512KB_block, iters) {
   benchmarkHardwareCRC32(iters, 512 * 1024);
 }
 
+BENCHMARK(crc32_avx512_512KB_block, iters) {
+  benchmarkAvx512CRC32(iters, 512 * 1024);
+}
+
 BENCHMARK(crc32_software_512KB_block, iters) {
   benchmarkSoftwareCRC32(iters, 512 * 1024);
 }
 
+BENCHMARK_DRAW_LINE();
+
+// Many small blocks, as in a storage file
+void benchmarkCRC32CBlocks(unsigned long iters, bool multi) {
+  constexpr size_t kBlocks = 64;
+  constexpr size_t kBlockSize = 512;
+  std::vector<const uint8_t*> data;
+  std::vector<size_t> nbytes(kBlocks, kBlockSize);
+  std::vector<uint32_t> checksums(kBlocks);
+  for (size_t i = 0; i < kBlocks; ++i) {
+    data.push_back(buffer + i * kBlockSize);
+  }
+  for (unsigned long i = 0; i < iters; i++) {
+    if (multi) {
+      folly::crc32c_multi(
+          data.data(), nbytes.data(), checksums.data(), kBlocks);
+    } else {
+      for (size_t j = 0; j < kBlocks; ++j) {
+        checksums[j] = folly::crc32c(data[j], nbytes[j]);
+      }
+    }
+    folly::doNotOptimizeAway(checksums);
+  }
+}
+
+BENCHMARK(crc32c_64x512B_blocks, iters) {
+  benchmarkCRC32CBlocks(iters, false);
+}
+
+BENCHMARK_RELATIVE(crc32c_multi_64x512B_blocks, iters) {
+  benchmarkCRC32CBlocks(iters, true);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -17,6 +17,7 @@
 #include <folly/hash/Hash.h>
 
 #include <stdint.h>
+#include <cstring>
 #include <deque>
 #include <random>
 #include <string>
@@ -27,6 +28,7 @@
 #include <folly/Benchmark.h>
 #include <folly/Format.h>
 #include <folly/Preprocessor.h>
+#include <folly/hash/BatchHash.h>
 #include <folly/portability/GFlags.h>
 
 namespace detail {
@@ -54,7 +56,7 @@ template <class Hasher>
 void addHashBenchmark(const std::string& name) {
   static std::deque<std::string> names;
 
-  for (size_t i = 0; i < 16; ++i) {
+  for (size_t i = 0; i <= 16; ++i) {
     auto k = size_t(1) << i;
     names.emplace_back(folly::sformat("{}: k=2^{}",name, i));
     folly::addBenchmark(__FILE__, names.back().c_str(),
@@ -75,14 +77,107 @@ struct SpookyHashV2 {
   }
 };
 
+struct SpookyHashV2_128 {
+  uint64_t operator()(const uint8_t* data, size_t size) const {
+    uint64_t hash1 = 0;
+    uint64_t hash2 = 0;
+    folly::hash::SpookyHashV2::Hash128(data, size, &hash1, &hash2);
+    return hash1 ^ hash2;
+  }
+};
+
+struct Xxh3_64 {
+  uint64_t operator()(const uint8_t* data, size_t size) const {
+    return folly::hash::xxh3_64(data, size);
+  }
+};
+
+struct Xxh3_128 {
+  uint64_t operator()(const uint8_t* data, size_t size) const {
+    auto hash = folly::hash::xxh3_128(data, size);
+    return hash.low64 ^ hash.high64;
+  }
+};
+
 struct FNV64 {
   uint64_t operator()(const uint8_t* data, size_t size) const {
     return folly::hash::fnv64_buf(data, size);
   }
 };
 
+template <class T>
+std::vector<T> batchKeys() {
+  std::vector<T> keys(1024);
+  std::memcpy(keys.data(), benchData.data(), keys.size() * sizeof(T));
+  return keys;
+}
+
 } // namespace detail
 
+// Hashing 1024 integer keys, one by one or at once
+
+BENCHMARK(twang_mix64_loop_1024, iters) {
+  auto keys = detail::batchKeys<uint64_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      hashes[i] = folly::hash::twang_mix64(keys[i]);
+    }
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK_RELATIVE(twang_mix64_batch_1024, iters) {
+  auto keys = detail::batchKeys<uint64_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    folly::hash::twang_mix64_batch(keys.data(), keys.size(), hashes.data());
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK(hasher_int32_loop_1024, iters) {
+  auto keys = detail::batchKeys<int32_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      hashes[i] = folly::hasher<int32_t>()(keys[i]);
+    }
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK_RELATIVE(hasher_int32_batch_1024, iters) {
+  auto keys = detail::batchKeys<int32_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    folly::hash::hash_batch(keys.data(), keys.size(), hashes.data());
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK(xxh3_64_8_bytes_loop_1024, iters) {
+  auto keys = detail::batchKeys<uint64_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      hashes[i] = folly::hash::xxh3_64(&keys[i], sizeof(keys[i]));
+    }
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK_RELATIVE(xxh3_64_8_bytes_batch_1024, iters) {
+  auto keys = detail::batchKeys<uint64_t>();
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t n = 0; n < iters; ++n) {
+    folly::hash::xxh3_64_batch(keys.data(), keys.size(), hashes.data());
+    folly::doNotOptimizeAway(hashes);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
@@ -93,6 +188,9 @@ int main(int argc, char** argv) {
   detail::addHashBenchmark<detail::HASHER>(FB_STRINGIZE(HASHER));
 
   BENCHMARK_HASH(SpookyHashV2);
+  BENCHMARK_HASH(SpookyHashV2_128);
+  BENCHMARK_HASH(Xxh3_64);
+  BENCHMARK_HASH(Xxh3_128);
   BENCHMARK_HASH(FNV64);
 
 #undef BENCHMARK_HASH
@@ -103,44 +201,100 @@ int main(int argc, char** argv) {
 }
 
 #if 0
-Intel(R) Xeon(R) CPU E5-2660 0 @ 2.20GHz
+Intel(R) Xeon(R) Processor (AVX2)
 $ hash_benchmark --bm_min_usec=100000
 ============================================================================
-folly/test/HashBenchmark.cpp                    relative  time/iter  iters/s
+folly/hash/test/HashBenchmark.cpp               relative  time/iter  iters/s
 ============================================================================
-SpookyHashV2: k=2^0                                         11.67ns   85.66M
-SpookyHashV2: k=2^1                                         12.49ns   80.07M
-SpookyHashV2: k=2^2                                         11.87ns   84.22M
-SpookyHashV2: k=2^3                                         12.36ns   80.89M
-SpookyHashV2: k=2^4                                         21.47ns   46.58M
-SpookyHashV2: k=2^5                                         22.21ns   45.02M
-SpookyHashV2: k=2^6                                         31.47ns   31.78M
-SpookyHashV2: k=2^7                                         49.86ns   20.05M
-SpookyHashV2: k=2^8                                         69.56ns   14.38M
-SpookyHashV2: k=2^9                                        102.99ns    9.71M
-SpookyHashV2: k=2^10                                       153.72ns    6.51M
-SpookyHashV2: k=2^11                                       271.43ns    3.68M
-SpookyHashV2: k=2^12                                       498.85ns    2.00M
-SpookyHashV2: k=2^13                                       961.55ns    1.04M
-SpookyHashV2: k=2^14                                         1.88us  532.57K
-SpookyHashV2: k=2^15                                         3.73us  268.42K
---------------------------------------------------------------------------
-FNV64: k=2^0                                                 2.67ns  374.83M
-FNV64: k=2^1                                                 4.67ns  214.24M
-FNV64: k=2^2                                                10.30ns   97.07M
-FNV64: k=2^3                                                23.16ns   43.17M
-FNV64: k=2^4                                                48.77ns   20.51M
-FNV64: k=2^5                                               100.45ns    9.96M
-FNV64: k=2^6                                               201.74ns    4.96M
-FNV64: k=2^7                                               399.42ns    2.50M
-FNV64: k=2^8                                               801.64ns    1.25M
-FNV64: k=2^9                                                 1.59us  627.32K
-FNV64: k=2^10                                                3.19us  313.51K
-FNV64: k=2^11                                                6.38us  156.80K
-FNV64: k=2^12                                               12.75us   78.45K
-FNV64: k=2^13                                               25.49us   39.23K
-FNV64: k=2^14                                               50.98us   19.62K
-FNV64: k=2^15                                              101.93us    9.81K
+SpookyHashV2: k=2^0                                          7.17ns  139.44M
+SpookyHashV2: k=2^1                                          9.21ns  108.56M
+SpookyHashV2: k=2^2                                          8.81ns  113.53M
+SpookyHashV2: k=2^3                                          5.92ns  168.98M
+SpookyHashV2: k=2^4                                         10.35ns   96.59M
+SpookyHashV2: k=2^5                                         14.29ns   69.96M
+SpookyHashV2: k=2^6                                         23.54ns   42.47M
+SpookyHashV2: k=2^7                                         39.70ns   25.19M
+SpookyHashV2: k=2^8                                         90.79ns   11.01M
+SpookyHashV2: k=2^9                                        103.64ns    9.65M
+SpookyHashV2: k=2^10                                       157.78ns    6.34M
+SpookyHashV2: k=2^11                                       234.49ns    4.26M
+SpookyHashV2: k=2^12                                       426.18ns    2.35M
+SpookyHashV2: k=2^13                                       733.48ns    1.36M
+SpookyHashV2: k=2^14                                         1.51us  663.71K
+SpookyHashV2: k=2^15                                         2.98us  335.37K
+SpookyHashV2: k=2^16                                         5.90us  169.43K
+----------------------------------------------------------------------------
+SpookyHashV2_128: k=2^0                                      6.51ns  153.56M
+SpookyHashV2_128: k=2^1                                      6.44ns  155.22M
+SpookyHashV2_128: k=2^2                                      6.26ns  159.63M
+SpookyHashV2_128: k=2^3                                      8.46ns  118.17M
+SpookyHashV2_128: k=2^4                                     10.93ns   91.47M
+SpookyHashV2_128: k=2^5                                     12.80ns   78.15M
+SpookyHashV2_128: k=2^6                                     19.13ns   52.27M
+SpookyHashV2_128: k=2^7                                     34.95ns   28.61M
+SpookyHashV2_128: k=2^8                                     94.97ns   10.53M
+SpookyHashV2_128: k=2^9                                    118.45ns    8.44M
+SpookyHashV2_128: k=2^10                                   139.24ns    7.18M
+SpookyHashV2_128: k=2^11                                   229.23ns    4.36M
+SpookyHashV2_128: k=2^12                                   431.33ns    2.32M
+SpookyHashV2_128: k=2^13                                   757.41ns    1.32M
+SpookyHashV2_128: k=2^14                                     1.44us  694.66K
+SpookyHashV2_128: k=2^15                                     2.78us  360.36K
+SpookyHashV2_128: k=2^16                                     5.27us  189.85K
+----------------------------------------------------------------------------
+Xxh3_64: k=2^0                                               4.69ns  213.05M
+Xxh3_64: k=2^1                                               2.96ns  337.41M
+Xxh3_64: k=2^2                                               2.55ns  392.55M
+Xxh3_64: k=2^3                                               2.55ns  392.61M
+Xxh3_64: k=2^4                                               2.28ns  439.30M
+Xxh3_64: k=2^5                                               3.28ns  305.21M
+Xxh3_64: k=2^6                                               4.74ns  211.00M
+Xxh3_64: k=2^7                                               8.11ns  123.34M
+Xxh3_64: k=2^8                                              22.15ns   45.14M
+Xxh3_64: k=2^9                                              24.87ns   40.22M
+Xxh3_64: k=2^10                                             36.90ns   27.10M
+Xxh3_64: k=2^11                                             69.92ns   14.30M
+Xxh3_64: k=2^12                                            131.03ns    7.63M
+Xxh3_64: k=2^13                                            258.09ns    3.87M
+Xxh3_64: k=2^14                                            514.47ns    1.94M
+Xxh3_64: k=2^15                                              1.02us  980.88K
+Xxh3_64: k=2^16                                              2.63us  380.21K
+----------------------------------------------------------------------------
+Xxh3_128: k=2^0                                              4.03ns  248.20M
+Xxh3_128: k=2^1                                              4.03ns  248.33M
+Xxh3_128: k=2^2                                              3.33ns  299.88M
+Xxh3_128: k=2^3                                              3.48ns  287.62M
+Xxh3_128: k=2^4                                              4.04ns  247.76M
+Xxh3_128: k=2^5                                              4.12ns  242.83M
+Xxh3_128: k=2^6                                              6.16ns  162.30M
+Xxh3_128: k=2^7                                              9.70ns  103.05M
+Xxh3_128: k=2^8                                             26.50ns   37.74M
+Xxh3_128: k=2^9                                             27.87ns   35.88M
+Xxh3_128: k=2^10                                            41.69ns   23.98M
+Xxh3_128: k=2^11                                            79.27ns   12.61M
+Xxh3_128: k=2^12                                           138.90ns    7.20M
+Xxh3_128: k=2^13                                           260.56ns    3.84M
+Xxh3_128: k=2^14                                           537.49ns    1.86M
+Xxh3_128: k=2^15                                             1.02us  977.58K
+Xxh3_128: k=2^16                                             2.63us  379.70K
+----------------------------------------------------------------------------
+FNV64: k=2^0                                                 1.13ns  885.11M
+FNV64: k=2^1                                                 2.17ns  459.98M
+FNV64: k=2^2                                                 4.69ns  213.26M
+FNV64: k=2^3                                                11.32ns   88.32M
+FNV64: k=2^4                                                29.38ns   34.03M
+FNV64: k=2^5                                                79.07ns   12.65M
+FNV64: k=2^6                                               185.40ns    5.39M
+FNV64: k=2^7                                               378.20ns    2.64M
+FNV64: k=2^8                                               756.20ns    1.32M
+FNV64: k=2^9                                                 1.58us  632.67K
+FNV64: k=2^10                                                3.41us  293.13K
+FNV64: k=2^11                                                6.60us  151.60K
+FNV64: k=2^12                                               13.21us   75.71K
+FNV64: k=2^13                                               26.43us   37.84K
+FNV64: k=2^14                                               52.87us   18.91K
+FNV64: k=2^15                                              102.12us    9.79K
+FNV64: k=2^16                                              211.51us    4.73K
 ----------------------------------------------------------------------------
 ============================================================================
 #endif
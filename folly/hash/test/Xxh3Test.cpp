@@ -0,0 +1,488 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/Xxh3.h>
+
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/hash/Hash.h>
+#include <folly/portability/GTest.h>
+
+using folly::hash::Xxh3;
+using folly::hash::Xxh3Hash128;
+using folly::hash::xxh3_128;
+using folly::hash::xxh3_64;
+
+namespace {
+
+constexpr uint64_t kSeed = 0x9E3779B185EBCA8DULL;
+
+// Same input as the sanity checks of the reference implementation
+std::vector<uint8_t> makeInput(size_t size) {
+  std::vector<uint8_t> input(size);
+  uint64_t gen = 2654435761U;
+  for (auto& b : input) {
+    b = uint8_t(gen >> 56);
+    gen *= 11400714785074694797ULL;
+  }
+  return input;
+}
+
+const std::vector<uint8_t> input = makeInput(70000);
+
+struct ExpectedResult {
+  size_t length;
+  uint64_t seed;
+  uint64_t hash64;
+  Xxh3Hash128 hash128;
+};
+
+// From XXH3_64bits_withSeed() and XXH3_128bits_withSeed() of xxHash 0.8.2
+const ExpectedResult expectedResults[] = {
+    {0,
+     0,
+     0x2d06800538d394c2ULL,
+     {0x6001c324468d497fULL, 0x99aa06d3014798d8ULL}},
+    {1,
+     0,
+     0xc44bdff4074eecdbULL,
+     {0xc44bdff4074eecdbULL, 0xa6cd5e9392000f6aULL}},
+    {2,
+     0,
+     0x7a9978044cb8a8bbULL,
+     {0x7a9978044cb8a8bbULL, 0x76750c3c7bf95668ULL}},
+    {3,
+     0,
+     0x54247382a8d6b94dULL,
+     {0x54247382a8d6b94dULL, 0x20efc49ff02422eaULL}},
+    {4,
+     0,
+     0xe5dc74bc51848a51ULL,
+     {0x2e7d8d6876a39fe9ULL, 0x970d585ac632bf8eULL}},
+    {5,
+     0,
+     0xe4243f00720306bbULL,
+     {0x057c7ed2c01fa1d1ULL, 0x62ed587687606b4eULL}},
+    {8,
+     0,
+     0x24ccc9acaa9f65e4ULL,
+     {0x64c69cab4bb21dc5ULL, 0x47a7f080d82bb456ULL}},
+    {9,
+     0,
+     0x14d5001c15dd3f2bULL,
+     {0xed7ccbc501eb7501ULL, 0x564ef6078950d457ULL}},
+    {15,
+     0,
+     0x45556d4d6e1798bcULL,
+     {0x958955df1889e6bcULL, 0xc402609e57ee5772ULL}},
+    {16,
+     0,
+     0x981b17d36c7498c9ULL,
+     {0x562980258a998629ULL, 0xc68c368ecf8a9c05ULL}},
+    {17,
+     0,
+     0x796f5acd3a60f862ULL,
+     {0xabbc12d11973d7dbULL, 0x955fa78643ed3669ULL}},
+    {31,
+     0,
+     0x5d516692ca764c50ULL,
+     {0xec8365e74dc00653ULL, 0x301048a7ab476d21ULL}},
+    {32,
+     0,
+     0x9feaddbdbf57eed3ULL,
+     {0x278410a17595e3f9ULL, 0x98fc6458710dc2e8ULL}},
+    {33,
+     0,
+     0xabfb2d081b400a10ULL,
+     {0xe593bc4e5914c9d1ULL, 0x3103c192ceaa2dedULL}},
+    {63,
+     0,
+     0x83d74a75f2c2577aULL,
+     {0x5e4cb79e9a8121d9ULL, 0x7fc0ae04a6d2bb0bULL}},
+    {64,
+     0,
+     0x9cb48487720ec49dULL,
+     {0xefdb6a44690721a9ULL, 0x6d90e81a9b0fd622ULL}},
+    {65,
+     0,
+     0xfd81aac4bebc3883ULL,
+     {0xfe2f650fa500ec6eULL, 0x6c074d65e54db85aULL}},
+    {96,
+     0,
+     0x935a769a7f94776fULL,
+     {0xe9324473ea9afebeULL, 0xd9d0b885f56c93f1ULL}},
+    {97,
+     0,
+     0xca4ca268fd3c3a6cULL,
+     {0x7c87228ae9671ba7ULL, 0x09dff37faa6b284cULL}},
+    {127,
+     0,
+     0x2408ed71323d6096ULL,
+     {0x802a565a8a79a999ULL, 0xdcfae8002712db1cULL}},
+    {128,
+     0,
+     0xfcff24126754d861ULL,
+     {0xebb15e34a7fb5ab1ULL, 0x39992220e045260aULL}},
+    {129,
+     0,
+     0x98f1b0a679a2ca29ULL,
+     {0x86c9e3bc8f0a3b5cULL, 0x03815fc91f1b30b6ULL}},
+    {160,
+     0,
+     0x9d03a319ed4cbd2bULL,
+     {0x737126c8d7c09ceeULL, 0xba5d218964b622adULL}},
+    {191,
+     0,
+     0x759ffc8ff8fb94bdULL,
+     {0xc4333111ab47a522ULL, 0xaa394ffeb17611ebULL}},
+    {192,
+     0,
+     0xaf9f58e78b8d3587ULL,
+     {0x0679e7f625e389d9ULL, 0x064934db40706c3dULL}},
+    {200,
+     0,
+     0xbddca58935d7c038ULL,
+     {0xeb060f1bb3126f5aULL, 0xe76ff4780fe18439ULL}},
+    {239,
+     0,
+     0x16ce2b9d3b28805dULL,
+     {0xf895e8b860b8a593ULL, 0xe59fc6554b5008bcULL}},
+    {240,
+     0,
+     0x81c3c2b67f568ccfULL,
+     {0x5c9aae94c8ebe5a0ULL, 0xaa4202daa2769dc8ULL}},
+    {241,
+     0,
+     0xc5a639ecd2030e5eULL,
+     {0xc5a639ecd2030e5eULL, 0x99a80ecf0ecfc647ULL}},
+    {255,
+     0,
+     0xe98f979f4ed8a197ULL,
+     {0xe98f979f4ed8a197ULL, 0x961375c87e09efbcULL}},
+    {256,
+     0,
+     0x55de574ad89d0ac5ULL,
+     {0x55de574ad89d0ac5ULL, 0x8b1c66091423d288ULL}},
+    {257,
+     0,
+     0xb17fd5a8ae75bb0bULL,
+     {0xb17fd5a8ae75bb0bULL, 0xf15fee7f9f457599ULL}},
+    {511,
+     0,
+     0x8089715b163e7fc0ULL,
+     {0x8089715b163e7fc0ULL, 0x9f7619cb8d250f0dULL}},
+    {512,
+     0,
+     0x617e49599013cb6bULL,
+     {0x617e49599013cb6bULL, 0x18d2d110dcc9bca1ULL}},
+    {1023,
+     0,
+     0x87a8f7b2f2e22496ULL,
+     {0x87a8f7b2f2e22496ULL, 0xe8083e4d83214c3cULL}},
+    {1024,
+     0,
+     0xdd85c9b5c1109c5cULL,
+     {0xdd85c9b5c1109c5cULL, 0x0d30d24071c64c57ULL}},
+    {1025,
+     0,
+     0xd870c0fa13211c6aULL,
+     {0xd870c0fa13211c6aULL, 0xfd3ee4fe7f2954c6ULL}},
+    {2048,
+     0,
+     0xdd59e2c3a5f038e0ULL,
+     {0xdd59e2c3a5f038e0ULL, 0xf736557fd47073a5ULL}},
+    {2049,
+     0,
+     0xd3afa4329779b921ULL,
+     {0xd3afa4329779b921ULL, 0x4cd2bd192f2d70bdULL}},
+    {4096,
+     0,
+     0xe91206429d1f48f9ULL,
+     {0xe91206429d1f48f9ULL, 0xb9cfaea2ca5626a4ULL}},
+    {10000,
+     0,
+     0xbcd883507019ca90ULL,
+     {0xbcd883507019ca90ULL, 0xe20727cefc44ead3ULL}},
+    {65536,
+     0,
+     0x918f7f0f912ca480ULL,
+     {0x918f7f0f912ca480ULL, 0xdeafbd9df07edb70ULL}},
+    {0,
+     kSeed,
+     0xa8a6b918b2f0364aULL,
+     {0xa986dfc5d7605bfeULL, 0x00feaa732a3ce25eULL}},
+    {1,
+     kSeed,
+     0x032be332dd766ef8ULL,
+     {0x032be332dd766ef8ULL, 0x20e49abcc53b3842ULL}},
+    {2,
+     kSeed,
+     0x764b35c90519ad88ULL,
+     {0x764b35c90519ad88ULL, 0x7b96e6a600dae67dULL}},
+    {3,
+     kSeed,
+     0x634b8990b4976373ULL,
+     {0x634b8990b4976373ULL, 0x1c7ecf6a308cf00eULL}},
+    {4,
+     kSeed,
+     0xaa2e7eccb0c8f747ULL,
+     {0xbfaf51f1e67e0b0fULL, 0x3d53e5dfd837d927ULL}},
+    {5,
+     kSeed,
+     0x5a67c87e50ed80edULL,
+     {0x67a0c170d32090d7ULL, 0xfac738e8fec37715ULL}},
+    {8,
+     kSeed,
+     0x8f973410999b8f6bULL,
+     {0x7b29471dc729b5ffULL, 0xf50cec145bcd5c5aULL}},
+    {9,
+     kSeed,
+     0xb3ae7333d9013f60ULL,
+     {0xaef5dfc0ac9f9044ULL, 0x6b380b43ffa61042ULL}},
+    {15,
+     kSeed,
+     0x710dd5318f6f16d5ULL,
+     {0x6a0a9ca5fd33cb9dULL, 0x48864ef580a95f6bULL}},
+    {16,
+     kSeed,
+     0x663f29333b4db6b1ULL,
+     {0x0346d13a7a5498c7ULL, 0x6ffcb80cd33085c8ULL}},
+    {17,
+     kSeed,
+     0xf3ec5067f4306db3ULL,
+     {0x980a14119985a7dfULL, 0xd77681219e464828ULL}},
+    {31,
+     kSeed,
+     0x9b37274259c549c6ULL,
+     {0xd74750f8952360c3ULL, 0x4639cf7b77ba9096ULL}},
+    {32,
+     kSeed,
+     0x2199fab1534893d9ULL,
+     {0x0054e82631cef166ULL, 0xcc587e4fcdb86bc5ULL}},
+    {33,
+     kSeed,
+     0xad56348da574bb6dULL,
+     {0xc361d36cea597c31ULL, 0x21273c8190c645cdULL}},
+    {63,
+     kSeed,
+     0xc3ab9c8b53960dc7ULL,
+     {0xc6ee481741654b12ULL, 0xaec92695d77fea89ULL}},
+    {64,
+     kSeed,
+     0x4fe8895db9b8c077ULL,
+     {0x9405ba2affa95cebULL, 0x37b738968d40bda5ULL}},
+    {65,
+     kSeed,
+     0xad80aeec1fc9e0a7ULL,
+     {0x9d60c345e5c297cdULL, 0x72503a6fa8d07adbULL}},
+    {96,
+     kSeed,
+     0x70cf51937e500540ULL,
+     {0xd61f3ab58705c405ULL, 0x6f9ed3c2008cb388ULL}},
+    {97,
+     kSeed,
+     0xee461d3add7ee6c9ULL,
+     {0x49ea87f2afe44f66ULL, 0x14e68f850b481adaULL}},
+    {127,
+     kSeed,
+     0x41d2f0c3f483208fULL,
+     {0x54c9d67f8b29dc74ULL, 0x37452e1967d3445bULL}},
+    {128,
+     kSeed,
+     0x73fde75280646649ULL,
+     {0x8394f5c51f1d8246ULL, 0xa0f7ccb68ee02addULL}},
+    {129,
+     kSeed,
+     0x21fffdbca099c844ULL,
+     {0xd4aae26fcec7dc03ULL, 0xad559266067c0bf3ULL}},
+    {160,
+     kSeed,
+     0x3825c75ffe70fde0ULL,
+     {0x46a4a3f67ccd556eULL, 0xc6b7abc26def52acULL}},
+    {191,
+     kSeed,
+     0xabcd155ad6e9f3b6ULL,
+     {0x06f164304a859f69ULL, 0x43aabe2a06795e26ULL}},
+    {192,
+     kSeed,
+     0x69e006aa2156c999ULL,
+     {0xfd5412027e573a96ULL, 0xc1e549baf8d0d863ULL}},
+    {200,
+     kSeed,
+     0x5b899e984b88db8dULL,
+     {0x2236d1b483e8d9ebULL, 0xcf0349dd7cc2b545ULL}},
+    {239,
+     kSeed,
+     0xf59f5c23fcebd3b7ULL,
+     {0xc0a8b4c9698db33dULL, 0xd6701eb51fc21716ULL}},
+    {240,
+     kSeed,
+     0xcc0f58c27ef3d8eeULL,
+     {0x604e98db085c1864ULL, 0x29d2133d6ea58c5bULL}},
+    {241,
+     kSeed,
+     0xdda9b0a161d4829aULL,
+     {0xdda9b0a161d4829aULL, 0xec64afae6a137582ULL}},
+    {255,
+     kSeed,
+     0x2aca7901d9538c75ULL,
+     {0x2aca7901d9538c75ULL, 0xe72ec0137d62df44ULL}},
+    {256,
+     kSeed,
+     0x4d30234b7a3aa61cULL,
+     {0x4d30234b7a3aa61cULL, 0xaaa57235b92d5e7cULL}},
+    {257,
+     kSeed,
+     0x802a6fbf3cacd97cULL,
+     {0x802a6fbf3cacd97cULL, 0x15c1f9c667c815baULL}},
+    {511,
+     kSeed,
+     0x90ec0377ba8d6002ULL,
+     {0x90ec0377ba8d6002ULL, 0xb52cae55536e9fb9ULL}},
+    {512,
+     kSeed,
+     0x3ce457de14c27708ULL,
+     {0x3ce457de14c27708ULL, 0x925d06b8ec5b8040ULL}},
+    {1023,
+     kSeed,
+     0x0f0f02de8590e1b5ULL,
+     {0x0f0f02de8590e1b5ULL, 0x96b80fe329ce5e35ULL}},
+    {1024,
+     kSeed,
+     0xef368a8a2ebabaefULL,
+     {0xef368a8a2ebabaefULL, 0x17600efe2b493a18ULL}},
+    {1025,
+     kSeed,
+     0x96792bcf9af88519ULL,
+     {0x96792bcf9af88519ULL, 0x2c383949f57bf7e1ULL}},
+    {2048,
+     kSeed,
+     0x66f81670669ababcULL,
+     {0x66f81670669ababcULL, 0x23cc3a2e75ebaaeaULL}},
+    {2049,
+     kSeed,
+     0xe48083836cd58024ULL,
+     {0xe48083836cd58024ULL, 0xe4000f7a288a82ceULL}},
+    {4096,
+     kSeed,
+     0x2a3bbb20a5439dcdULL,
+     {0x2a3bbb20a5439dcdULL, 0x8fbc8fd4d526d1bdULL}},
+    {10000,
+     kSeed,
+     0xcb4fc4745fe1706bULL,
+     {0xcb4fc4745fe1706bULL, 0x1029c26e83437399ULL}},
+    {65536,
+     kSeed,
+     0xbcb1719de7bee55bULL,
+     {0xbcb1719de7bee55bULL, 0x1c6ef654c38c880dULL}},
+};
+
+} // namespace
+
+TEST(Xxh3, hash64) {
+  for (auto& expected : expectedResults) {
+    EXPECT_EQ(
+        expected.hash64, xxh3_64(input.data(), expected.length, expected.seed))
+        << expected.length << " bytes, seed " << expected.seed;
+  }
+}
+
+TEST(Xxh3, hash128) {
+  for (auto& expected : expectedResults) {
+    auto h = xxh3_128(input.data(), expected.length, expected.seed);
+    EXPECT_EQ(expected.hash128.low64, h.low64)
+        << expected.length << " bytes, seed " << expected.seed;
+    EXPECT_EQ(expected.hash128.high64, h.high64)
+        << expected.length << " bytes, seed " << expected.seed;
+  }
+}
+
+TEST(Xxh3, software) {
+  using namespace folly::hash::detail;
+  for (auto& expected : expectedResults) {
+    if (expected.length <= kXxh3MidSizeMax) {
+      continue;
+    }
+    EXPECT_EQ(
+        expected.hash64,
+        xxh3_64_long_sw(input.data(), expected.length, expected.seed));
+    EXPECT_EQ(
+        expected.hash128,
+        xxh3_128_long_sw(input.data(), expected.length, expected.seed));
+  }
+}
+
+TEST(Xxh3, unaligned) {
+  for (size_t offset = 1; offset < 8; ++offset) {
+    std::vector<uint8_t> copy(offset);
+    copy.insert(copy.end(), input.begin(), input.begin() + 2048);
+    for (size_t len : {7, 15, 100, 200, 1000, 2048}) {
+      EXPECT_EQ(
+          xxh3_64(input.data(), len, kSeed),
+          xxh3_64(copy.data() + offset, len, kSeed));
+      EXPECT_EQ(
+          xxh3_128(input.data(), len), xxh3_128(copy.data() + offset, len));
+    }
+  }
+}
+
+TEST(Xxh3, streaming) {
+  for (auto& expected : expectedResults) {
+    for (size_t chunk : {1, 7, 64, 100, 256, 257, 4096}) {
+      Xxh3 hasher(expected.seed);
+      for (size_t pos = 0; pos < expected.length; pos += chunk) {
+        hasher.update(
+            input.data() + pos, std::min(chunk, expected.length - pos));
+      }
+      EXPECT_EQ(expected.hash64, hasher.digest64())
+          << expected.length << " bytes in chunks of " << chunk;
+      EXPECT_EQ(expected.hash128, hasher.digest128())
+          << expected.length << " bytes in chunks of " << chunk;
+    }
+  }
+}
+
+TEST(Xxh3, streamingDigestAndContinue) {
+  Xxh3 hasher;
+  for (size_t len = 0; len < 3000; ++len) {
+    EXPECT_EQ(xxh3_64(input.data(), len), hasher.digest64()) << len;
+    EXPECT_EQ(xxh3_128(input.data(), len), hasher.digest128()) << len;
+    hasher.update(input.data() + len, 1);
+  }
+}
+
+TEST(Xxh3, streamingReset) {
+  Xxh3 hasher(kSeed);
+  hasher.update(input.data(), 1000);
+  hasher.reset();
+  hasher.update(input.data(), 500);
+  EXPECT_EQ(xxh3_64(input.data(), 500), hasher.digest64());
+  hasher.reset(kSeed);
+  hasher.update(input.data(), 5000);
+  EXPECT_EQ(xxh3_64(input.data(), 5000, kSeed), hasher.digest64());
+}
+
+TEST(Xxh3, hasher) {
+  std::string s(reinterpret_cast<const char*>(input.data()), 300);
+  for (size_t len = 0; len <= s.size(); ++len) {
+    auto key = s.substr(0, len);
+    auto expected = size_t(xxh3_64(key.data(), key.size()));
+    EXPECT_EQ(expected, folly::hasher<std::string>()(key));
+    EXPECT_EQ(expected, folly::hasher<folly::StringPiece>()(key));
+  }
+}
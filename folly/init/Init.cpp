@@ -16,9 +16,12 @@
 
 #include <folly/init/Init.h>
 
+#include <chrono>
+
 #include <glog/logging.h>
 
 #include <folly/Singleton.h>
+#include <folly/init/StartupTrace.h>
 #include <folly/portability/Config.h>
 
 #ifdef FOLLY_USE_SYMBOLIZER
@@ -29,29 +32,48 @@
 namespace folly {
 
 void init(int* argc, char*** argv, bool removeFlags) {
+  auto const start = std::chrono::steady_clock::now();
 #ifdef FOLLY_USE_SYMBOLIZER
   // Install the handler now, to trap errors received during startup.
   // The callbacks, if any, can be installed later
-  folly::symbolizer::installFatalSignalHandler();
+  {
+    StartupPhase phase("installFatalSignalHandler", "symbolizer");
+    folly::symbolizer::installFatalSignalHandler();
+  }
 #elif !defined(_WIN32)
   google::InstallFailureSignalHandler();
 #endif
 
   // Move from the registration phase to the "you can actually instantiate
   // things now" phase.
-  folly::SingletonVault::singleton()->registrationComplete();
+  {
+    StartupPhase phase("SingletonVault::registrationComplete");
+    folly::SingletonVault::singleton()->registrationComplete();
+  }
 
-  gflags::ParseCommandLineFlags(argc, argv, removeFlags);
+  {
+    StartupPhase phase("gflags::ParseCommandLineFlags");
+    gflags::ParseCommandLineFlags(argc, argv, removeFlags);
+  }
 
-  auto programName = argc && argv && *argc > 0 ? (*argv)[0] : "unknown";
-  google::InitGoogleLogging(programName);
+  {
+    StartupPhase phase("google::InitGoogleLogging");
+    auto programName = argc && argv && *argc > 0 ? (*argv)[0] : "unknown";
+    google::InitGoogleLogging(programName);
+  }
 
 #ifdef FOLLY_USE_SYMBOLIZER
   // Don't use glog's DumpStackTraceAndExit; rely on our signal handler.
   google::InstallFailureFunction(abort);
 
   // Actually install the callbacks into the handler.
-  folly::symbolizer::installFatalSignalCallbacks();
+  {
+    StartupPhase phase("installFatalSignalCallbacks", "symbolizer");
+    folly::symbolizer::installFatalSignalCallbacks();
+  }
 #endif
+
+  recordStartupPhase("folly::init", start);
+  writeStartupTrace();
 }
 } // namespace folly
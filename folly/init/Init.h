@@ -22,6 +22,9 @@
  * correctly and installs signal handlers for a superior debugging experience.
  * It also initializes gflags and glog.
  *
+ * With --folly_startup_trace=<file>, it writes how long each of these took
+ * to <file>; see StartupTrace.h.
+ *
  * @param argc, argv   arguments to your main
  * @param removeFlags  if true, will update argc,argv to remove recognized
  *                     gflags passed on the command line
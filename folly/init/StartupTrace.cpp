@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/init/StartupTrace.h>
+
+#include <algorithm>
+#include <exception>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Indestructible.h>
+#include <folly/Optional.h>
+#include <folly/Singleton.h>
+#include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Time.h>
+#include <folly/portability/Unistd.h>
+#include <folly/system/ThreadId.h>
+
+DEFINE_string(
+    folly_startup_trace,
+    "",
+    "If set, folly::init() writes where the time went during startup to "
+    "this file, in the Chrome trace format");
+
+namespace folly {
+
+namespace {
+
+Synchronized<std::vector<StartupEvent>>& phases() {
+  static Indestructible<Synchronized<std::vector<StartupEvent>>> phases;
+  return *phases;
+}
+
+// When the process started, on the steady clock; to the clock tick
+// (usually 10ms)
+Optional<std::chrono::steady_clock::time_point> processStart() {
+#ifdef __linux__
+  std::string stat;
+  if (!readFile("/proc/self/stat", stat)) {
+    return none;
+  }
+  // The command name, in parentheses, may itself contain anything
+  auto pos = stat.rfind(')');
+  if (pos == std::string::npos) {
+    return none;
+  }
+  std::vector<StringPiece> fields;
+  split(' ', StringPiece(stat).subpiece(pos + 2), fields);
+  // starttime is the 22nd field, the 20th after the command name: clock
+  // ticks since boot
+  if (fields.size() < 20) {
+    return none;
+  }
+  auto ticks = tryTo<uint64_t>(fields[19]);
+  auto const ticksPerSecond = sysconf(_SC_CLK_TCK);
+  struct timespec now;
+  if (!ticks || ticksPerSecond <= 0 || clock_gettime(CLOCK_BOOTTIME, &now)) {
+    return none;
+  }
+  auto const steadyNow = std::chrono::steady_clock::now();
+  auto const sinceBoot = std::chrono::seconds(now.tv_sec) +
+      std::chrono::nanoseconds(now.tv_nsec);
+  auto const startSinceBoot = std::chrono::nanoseconds(
+      *ticks * (uint64_t(1000000000) / uint64_t(ticksPerSecond)));
+  if (startSinceBoot > sinceBoot) {
+    return none;
+  }
+  return steadyNow - (sinceBoot - startSinceBoot);
+#else
+  return none;
+#endif
+}
+
+} // namespace
+
+void recordStartupPhase(
+    StringPiece name,
+    std::chrono::steady_clock::time_point start,
+    StringPiece category) {
+  auto const end = std::chrono::steady_clock::now();
+  StartupEvent event{
+      name.str(), category.str(), start, end - start, getOSThreadID()};
+  phases().wlock()->push_back(std::move(event));
+}
+
+std::vector<StartupEvent> startupEvents() {
+  auto events = *phases().rlock();
+  for (auto& time : SingletonVault::singleton()->creationTimes()) {
+    events.push_back(StartupEvent{
+        time.name, "singleton", time.start, time.total, time.threadId});
+  }
+  std::sort(events.begin(), events.end(), [](auto& a, auto& b) {
+    return a.start < b.start;
+  });
+
+  if (!events.empty()) {
+    auto start = processStart();
+    if (start && *start < events.front().start) {
+      events.insert(
+          events.begin(),
+          StartupEvent{"process start to first phase",
+                       "process",
+                       *start,
+                       events.front().start - *start,
+                       getOSThreadID()});
+    }
+  }
+  return events;
+}
+
+std::string startupTraceJson() {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  auto const events = startupEvents();
+  auto const pid = getpid();
+  dynamic traceEvents = dynamic::array;
+  for (auto& event : events) {
+    auto const ts =
+        duration_cast<microseconds>(event.start - events.front().start);
+    traceEvents.push_back(dynamic::object("name", event.name)(
+        "cat", event.category)("ph", "X")("ts", ts.count())(
+        "dur", duration_cast<microseconds>(event.duration).count())(
+        "pid", pid)("tid", int64_t(event.threadId)));
+  }
+  return toJson(dynamic::object("traceEvents", std::move(traceEvents))(
+      "displayTimeUnit", "ms"));
+}
+
+void writeStartupTrace(StringPiece path) {
+  writeFileAtomic(path, StringPiece(startupTraceJson()));
+}
+
+void writeStartupTrace() {
+  if (FLAGS_folly_startup_trace.empty()) {
+    return;
+  }
+  try {
+    writeStartupTrace(FLAGS_folly_startup_trace);
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Failed to write the startup trace to "
+               << FLAGS_folly_startup_trace << ": " << e.what();
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Where the time goes during startup.
+ *
+ * folly::init() records how long each of its phases takes, and the
+ * SingletonVault records the creation of each singleton (see
+ * SingletonVault::creationTimes()).  With --folly_startup_trace=<file>,
+ * folly::init() writes these, along with the time between the start of the
+ * process and folly::init() (loading, static initialization), to <file> in
+ * the Chrome trace format, which chrome://tracing and Perfetto display.
+ *
+ * Singletons are mostly created after folly::init(), so call
+ * writeStartupTrace() again once the program is done starting up, e.g.
+ * after SingletonVault::doEagerInit(), to include them.
+ *
+ *   folly::init(&argc, &argv);
+ *   {
+ *     folly::StartupPhase phase("loadConfig");
+ *     loadConfig();
+ *   }
+ *   folly::SingletonVault::singleton()->doEagerInit();
+ *   folly::writeStartupTrace();
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+struct StartupEvent {
+  std::string name;
+  // "init", "symbolizer", "singleton" or "process"; whatever the caller
+  // passed for others
+  std::string category;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::nanoseconds duration;
+  uint64_t threadId;
+};
+
+/**
+ * Record a phase of startup, which started at `start` and ends now, on this
+ * thread.  Cheap enough that recording doesn't depend on the flag.
+ */
+void recordStartupPhase(
+    StringPiece name,
+    std::chrono::steady_clock::time_point start,
+    StringPiece category = "init");
+
+/**
+ * Records the phase from its construction to its destruction.
+ */
+class StartupPhase {
+ public:
+  explicit StartupPhase(StringPiece name, StringPiece category = "init")
+      : name_(name.str()), category_(category.str()) {}
+  ~StartupPhase() {
+    recordStartupPhase(name_, start_, category_);
+  }
+
+  StartupPhase(const StartupPhase&) = delete;
+  StartupPhase& operator=(const StartupPhase&) = delete;
+
+ private:
+  std::string name_;
+  std::string category_;
+  std::chrono::steady_clock::time_point start_{
+      std::chrono::steady_clock::now()};
+};
+
+/**
+ * The recorded phases, the creations of the living singletons of the
+ * default vault and, where the platform tells when the process started, a
+ * "process" event from then until the first phase; sorted by start.
+ */
+std::vector<StartupEvent> startupEvents();
+
+/**
+ * startupEvents() in the Chrome trace format: complete ("X") events, in
+ * microseconds since the first of them.
+ */
+std::string startupTraceJson();
+
+/**
+ * Write startupTraceJson() to `path`, replacing it.  Throws
+ * std::system_error on error.
+ */
+void writeStartupTrace(StringPiece path);
+
+/**
+ * Write it to the file of --folly_startup_trace, if there is one.  Logs
+ * errors rather than throwing them, so that tracing can't stop a program
+ * from starting.
+ */
+void writeStartupTrace();
+
+} // namespace folly
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/init/StartupTrace.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <folly/FileUtil.h>
+#include <folly/Singleton.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/json.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+namespace {
+struct Traced {
+  Traced() {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(10));
+  }
+};
+Singleton<Traced> traced;
+} // namespace
+
+TEST(StartupTrace, Events) {
+  SingletonVault::singleton()->registrationComplete();
+  {
+    StartupPhase phase("outer");
+    {
+      StartupPhase inner("inner", "custom");
+      /* sleep override */ std::this_thread::sleep_for(milliseconds(20));
+    }
+    Singleton<Traced>::try_get();
+  }
+
+  auto events = startupEvents();
+  auto find = [&](StringPiece name) {
+    return std::find_if(events.begin(), events.end(), [&](auto& e) {
+      return e.name == name;
+    });
+  };
+  auto outer = find("outer");
+  auto inner = find("inner");
+  auto singleton = std::find_if(events.begin(), events.end(), [](auto& e) {
+    return e.category == "singleton";
+  });
+  ASSERT_NE(events.end(), outer);
+  ASSERT_NE(events.end(), inner);
+  ASSERT_NE(events.end(), singleton);
+  EXPECT_EQ("init", outer->category);
+  EXPECT_EQ("custom", inner->category);
+  EXPECT_GE(inner->duration, milliseconds(20));
+  EXPECT_GE(singleton->duration, milliseconds(10));
+  EXPECT_GE(outer->duration, inner->duration + singleton->duration);
+  // Sorted by start; the inner phases start after the outer one
+  EXPECT_LT(outer, inner);
+  EXPECT_LT(inner, singleton);
+  EXPECT_TRUE(std::is_sorted(events.begin(), events.end(), [](auto& a, auto& b) {
+    return a.start < b.start;
+  }));
+#ifdef __linux__
+  EXPECT_EQ("process", events.front().category);
+#endif
+
+  test::TemporaryDirectory dir;
+  auto path = (dir.path() / "trace.json").string();
+  writeStartupTrace(path);
+  std::string contents;
+  ASSERT_TRUE(readFile(path.c_str(), contents));
+  auto trace = parseJson(contents);
+  auto& traceEvents = trace["traceEvents"];
+  ASSERT_EQ(events.size(), traceEvents.size());
+  EXPECT_EQ(0, traceEvents[0]["ts"].asInt());
+  for (size_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events[i].name, traceEvents[i]["name"].asString());
+    EXPECT_EQ("X", traceEvents[i]["ph"].asString());
+    EXPECT_EQ(
+        duration_cast<microseconds>(events[i].duration).count(),
+        traceEvents[i]["dur"].asInt());
+  }
+}
@@ -0,0 +1,412 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/CompressedRecordIO.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/Varint.h>
+#include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
+
+namespace folly {
+
+using namespace recordio_helpers;
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x6b6c4263;
+constexpr uint32_t kFooterMagic = 0x78644963;
+constexpr size_t kBlockHeaderSize = 16;
+constexpr size_t kFooterSize = 16;
+constexpr size_t kIndexEntrySize = 12;
+
+enum class BlockKind : uint8_t {
+  RECORDS = 0,
+  INDEX = 1,
+};
+
+// Parts of the file that tasks search for blocks, without an index
+constexpr size_t kMinScanPartSize = 1 << 20;
+
+std::unique_ptr<IOBuf> makeBlock(
+    BlockKind kind,
+    io::CodecType codecType,
+    uint32_t recordCount,
+    uint32_t uncompressedLength,
+    std::unique_ptr<IOBuf> data) {
+  // Room for the RecordIO header, for prependHeader()
+  auto block = IOBuf::create(headerSize() + kBlockHeaderSize);
+  block->advance(headerSize());
+  io::Appender appender(block.get(), 0);
+  appender.writeLE<uint32_t>(kBlockMagic);
+  appender.writeLE<uint8_t>(0);
+  appender.writeLE<uint8_t>(uint8_t(codecType));
+  appender.writeLE<uint8_t>(uint8_t(kind));
+  appender.writeLE<uint8_t>(0);
+  appender.writeLE<uint32_t>(recordCount);
+  appender.writeLE<uint32_t>(uncompressedLength);
+  if (data) {
+    block->prependChain(std::move(data));
+  }
+  return block;
+}
+
+struct BlockHeader {
+  io::CodecType codecType;
+  BlockKind kind;
+  uint32_t recordCount;
+  uint32_t uncompressedLength;
+};
+
+// Parse the header of a block, advancing data past it; false if invalid
+bool parseBlockHeader(ByteRange& data, BlockHeader& header) {
+  if (data.size() < kBlockHeaderSize) {
+    return false;
+  }
+  auto buf = IOBuf::wrapBufferAsValue(data.data(), kBlockHeaderSize);
+  io::Cursor cursor(&buf);
+  if (cursor.readLE<uint32_t>() != kBlockMagic ||
+      cursor.readLE<uint8_t>() != 0) {
+    return false;
+  }
+  auto const codecType = cursor.readLE<uint8_t>();
+  auto const kind = cursor.readLE<uint8_t>();
+  if (codecType >= uint8_t(io::CodecType::NUM_CODEC_TYPES) ||
+      kind > uint8_t(BlockKind::INDEX) || cursor.readLE<uint8_t>() != 0) {
+    return false;
+  }
+  header.codecType = io::CodecType(codecType);
+  header.kind = BlockKind(kind);
+  header.recordCount = cursor.readLE<uint32_t>();
+  header.uncompressedLength = cursor.readLE<uint32_t>();
+  data.advance(kBlockHeaderSize);
+  return true;
+}
+
+} // namespace
+
+CompressedRecordIOWriter::CompressedRecordIOWriter(File file)
+    : CompressedRecordIOWriter(std::move(file), Options()) {}
+
+CompressedRecordIOWriter::CompressedRecordIOWriter(File file, Options options)
+    : options_(options),
+      codec_(io::getCodec(options_.codecType, options_.level)),
+      file_(file.dup()),
+      writer_(std::move(file), options_.fileId),
+      writeIndex_(writer_.filePos() == 0) {
+  if (options_.blockSize == 0 ||
+      options_.blockSize > codec_->maxUncompressedLength() ||
+      options_.blockSize >= std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(to<std::string>(
+        "CompressedRecordIOWriter: invalid block size: ", options_.blockSize));
+  }
+  block_.reserve(options_.blockSize + kMaxVarintLength64);
+}
+
+CompressedRecordIOWriter::~CompressedRecordIOWriter() {
+  try {
+    close();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "CompressedRecordIOWriter: close() failed: " << e.what();
+  }
+}
+
+void CompressedRecordIOWriter::write(ByteRange record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) {
+    throw std::logic_error("CompressedRecordIOWriter: closed");
+  }
+  if (!block_.empty() &&
+      block_.size() + kMaxVarintLength64 + record.size() >
+          options_.blockSize) {
+    flushLocked();
+  }
+  uint8_t length[kMaxVarintLength64];
+  block_.append(
+      reinterpret_cast<const char*>(length),
+      encodeVarint(record.size(), length));
+  block_.append(reinterpret_cast<const char*>(record.data()), record.size());
+  ++blockRecordCount_;
+  // A record larger than a block gets one of its own
+  if (block_.size() >= options_.blockSize) {
+    flushLocked();
+  }
+}
+
+void CompressedRecordIOWriter::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  flushLocked();
+}
+
+void CompressedRecordIOWriter::flushLocked() {
+  if (blockRecordCount_ == 0) {
+    return;
+  }
+  if (block_.size() > codec_->maxUncompressedLength() ||
+      block_.size() >= std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(to<std::string>(
+        "CompressedRecordIOWriter: block too large: ", block_.size()));
+  }
+  auto data = IOBuf::wrapBufferAsValue(block_.data(), block_.size());
+  auto block = makeBlock(
+      BlockKind::RECORDS,
+      options_.codecType,
+      blockRecordCount_,
+      uint32_t(block_.size()),
+      codec_->compress(&data));
+  index_.emplace_back(uint64_t(writer_.filePos()), blockRecordCount_);
+  writer_.write(std::move(block));
+  block_.clear();
+  blockRecordCount_ = 0;
+}
+
+void CompressedRecordIOWriter::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  flushLocked();
+  if (!writeIndex_) {
+    return;
+  }
+
+  auto entries = IOBuf::create(index_.size() * kIndexEntrySize);
+  io::Appender appender(entries.get(), 0);
+  for (auto& entry : index_) {
+    appender.writeLE<uint64_t>(entry.first);
+    appender.writeLE<uint32_t>(entry.second);
+  }
+  auto const indexPos = uint64_t(writer_.filePos());
+  auto const length = entries->length();
+  writer_.write(makeBlock(
+      BlockKind::INDEX,
+      io::CodecType::NO_COMPRESSION,
+      uint32_t(index_.size()),
+      uint32_t(length),
+      length ? std::move(entries) : nullptr));
+
+  auto footer = IOBuf::create(kFooterSize);
+  io::Appender footerAppender(footer.get(), 0);
+  footerAppender.writeLE<uint64_t>(indexPos);
+  footerAppender.writeLE<uint32_t>(0);
+  footerAppender.writeLE<uint32_t>(kFooterMagic);
+  auto const n = pwriteFull(
+      file_.fd(), footer->data(), footer->length(), writer_.filePos());
+  checkUnixError(n, "pwrite() failed");
+}
+
+/**
+ * Uncompresses blocks, reusing the codec of the previous block if it's of
+ * the same type.
+ */
+class CompressedRecordIOReader::Decoder {
+ public:
+  explicit Decoder(uint32_t fileId) : fileId_(fileId) {}
+
+  // Returns false if there's no valid block of records at the start of
+  // range
+  bool decode(
+      ByteRange range,
+      off_t pos,
+      const RecordCallback& fn) {
+    auto data = validateRecord(range, fileId_).record;
+    BlockHeader header;
+    if (data.empty() || !parseBlockHeader(data, header) ||
+        header.kind != BlockKind::RECORDS) {
+      return false;
+    }
+    decodeRecords(data, header, pos, fn);
+    return true;
+  }
+
+  void decodeRecords(
+      ByteRange data,
+      const BlockHeader& header,
+      off_t pos,
+      const RecordCallback& fn) {
+    std::unique_ptr<IOBuf> uncompressed;
+    if (header.codecType != io::CodecType::NO_COMPRESSION) {
+      if (!codec_ || codec_->type() != header.codecType) {
+        codec_ = io::getCodec(header.codecType);
+      }
+      auto compressed = IOBuf::wrapBufferAsValue(data);
+      uncompressed =
+          codec_->uncompress(&compressed, uint64_t(header.uncompressedLength));
+      data = uncompressed->coalesce();
+    }
+    if (data.size() != header.uncompressedLength) {
+      throw std::runtime_error(
+          "CompressedRecordIOReader: invalid uncompressed length");
+    }
+    for (uint32_t i = 0; i < header.recordCount; ++i) {
+      auto length = tryDecodeVarint(data);
+      if (!length || *length > data.size()) {
+        throw std::runtime_error("CompressedRecordIOReader: invalid record");
+      }
+      fn(pos, ByteRange(data.data(), size_t(*length)));
+      data.advance(size_t(*length));
+    }
+  }
+
+ private:
+  const uint32_t fileId_;
+  std::unique_ptr<io::Codec> codec_;
+};
+
+CompressedRecordIOReader::CompressedRecordIOReader(File file, uint32_t fileId)
+    : map_(std::move(file)), fileId_(fileId) {
+  readIndex();
+}
+
+void CompressedRecordIOReader::readIndex() {
+  auto const whole = map_.range();
+  if (whole.size() < kFooterSize + headerSize() + kBlockHeaderSize) {
+    return;
+  }
+  auto footer = IOBuf::wrapBufferAsValue(whole.end() - kFooterSize, kFooterSize);
+  io::Cursor cursor(&footer);
+  auto const indexPos = cursor.readLE<uint64_t>();
+  if (cursor.readLE<uint32_t>() != 0 ||
+      cursor.readLE<uint32_t>() != kFooterMagic ||
+      indexPos >= whole.size() - kFooterSize) {
+    return;
+  }
+  auto data = validateRecord(
+                  ByteRange(whole.begin() + indexPos, whole.end() - kFooterSize),
+                  fileId_)
+                  .record;
+  BlockHeader header;
+  if (data.empty() || !parseBlockHeader(data, header) ||
+      header.kind != BlockKind::INDEX ||
+      header.codecType != io::CodecType::NO_COMPRESSION ||
+      data.size() != header.uncompressedLength ||
+      data.size() != size_t(header.recordCount) * kIndexEntrySize) {
+    return;
+  }
+
+  auto entries = IOBuf::wrapBufferAsValue(data);
+  io::Cursor entryCursor(&entries);
+  index_.reserve(header.recordCount);
+  for (uint32_t i = 0; i < header.recordCount; ++i) {
+    Block block;
+    block.pos = off_t(entryCursor.readLE<uint64_t>());
+    block.recordCount = entryCursor.readLE<uint32_t>();
+    if (block.pos < 0 || uint64_t(block.pos) >= indexPos) {
+      index_.clear();
+      return;
+    }
+    index_.push_back(block);
+  }
+  hasIndex_ = true;
+}
+
+void CompressedRecordIOReader::forEach(const RecordCallback& fn) const {
+  Decoder decoder(fileId_);
+  scan(0, map_.range().size(), decoder, fn);
+}
+
+bool CompressedRecordIOReader::readBlock(
+    off_t pos,
+    const RecordCallback& fn) const {
+  auto const whole = map_.range();
+  if (pos < 0 || size_t(pos) >= whole.size()) {
+    return false;
+  }
+  Decoder decoder(fileId_);
+  return decoder.decode(
+      ByteRange(whole.begin() + pos, whole.end()), pos, fn);
+}
+
+void CompressedRecordIOReader::scan(
+    size_t begin,
+    size_t end,
+    Decoder& decoder,
+    const RecordCallback& fn) const {
+  auto const whole = map_.range();
+  auto start = whole.begin() + begin;
+  auto const stop = whole.begin() + end;
+  while (start < stop) {
+    auto record = findRecord(ByteRange(start, stop), whole, fileId_).record;
+    if (record.empty()) {
+      break;
+    }
+    auto const headerStart = record.begin() - headerSize();
+    BlockHeader header;
+    if (parseBlockHeader(record, header) &&
+        header.kind == BlockKind::RECORDS) {
+      decoder.decodeRecords(
+          record, header, off_t(headerStart - whole.begin()), fn);
+    }
+    start = record.end();
+  }
+}
+
+void CompressedRecordIOReader::parallelForEach(
+    Executor* executor,
+    const RecordCallback& fn,
+    size_t parallelism) const {
+  if (parallelism == 0) {
+    parallelism = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  // Tasks take the next block of the index, or the next part of the file,
+  // as they finish one, so that uneven blocks don't hold up the others
+  auto const size = map_.range().size();
+  auto const partSize =
+      std::max(kMinScanPartSize, size / (parallelism * 8) + 1);
+  auto const count =
+      hasIndex_ ? index_.size() : (size + partSize - 1) / partSize;
+  parallelism = std::min(parallelism, count);
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    Decoder decoder(fileId_);
+    size_t i;
+    while ((i = next.fetch_add(1)) < count) {
+      if (hasIndex_) {
+        auto const pos = index_[i].pos;
+        decoder.decode(
+            ByteRange(map_.range().begin() + pos, map_.range().end()),
+            pos,
+            fn);
+      } else {
+        scan(i * partSize, std::min(size, (i + 1) * partSize), decoder, fn);
+      }
+    }
+  };
+
+  std::vector<Future<Unit>> futures;
+  futures.reserve(parallelism);
+  for (size_t i = 0; i < parallelism; ++i) {
+    futures.push_back(via(executor, work));
+  }
+  // Waits for all of them, as they use this frame
+  for (auto& t : collectAll(futures).get()) {
+    t.throwIfFailed();
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Compressed RecordIO: records batched into compressed blocks.
+ *
+ * Each block is stored as one RecordIO record, so the file remains
+ * self-synchronizing: a corrupted block loses its records, and readers
+ * resynchronize at the next one.  When the writer started with an empty
+ * file, closing it appends an index of the blocks, so that readers can
+ * find them without searching the file.
+ *
+ * Large files can be read in parallel on an executor: the blocks of the
+ * index are divided among the tasks or, without an index, the file is
+ * divided into parts, and each task reads the blocks whose RecordIO
+ * header starts in its parts.
+ *
+ * Block payload (little-endian):
+ *   uint32_t magic
+ *   uint8_t  version (0)
+ *   uint8_t  codec type (io::CodecType)
+ *   uint8_t  kind (0 = records, 1 = index)
+ *   uint8_t  reserved (0)
+ *   uint32_t record count
+ *   uint32_t uncompressed length
+ *   the uncompressed data, compressed with the codec; for records, each
+ *   record's length as a varint followed by its bytes, and for the index,
+ *   each block's position (uint64_t) and record count (uint32_t).
+ *
+ * The index is followed by a footer: its position (uint64_t), 0 (uint32_t)
+ * and a magic number (uint32_t), the last 16 bytes of the file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/compression/Compression.h>
+#include <folly/io/RecordIO.h>
+#include <folly/system/MemoryMapping.h>
+
+namespace folly {
+
+/**
+ * Class to write a stream of records into compressed blocks of a file.
+ *
+ * CompressedRecordIOWriter is thread-safe.  Records are only written once
+ * their block is full, or on flush() or close().
+ */
+class CompressedRecordIOWriter {
+ public:
+  struct Options {
+    Options() {}
+
+    Options& setCodecType(io::CodecType v) { codecType = v; return *this; }
+    Options& setLevel(int v) { level = v; return *this; }
+    Options& setBlockSize(size_t v) { blockSize = v; return *this; }
+    Options& setFileId(uint32_t v) { fileId = v; return *this; }
+
+    io::CodecType codecType = io::CodecType::ZSTD;
+    int level = io::COMPRESSION_LEVEL_DEFAULT;
+    // Uncompressed bytes of records after which a block is written; a
+    // larger record gets a block of its own.
+    size_t blockSize = 1 << 20;
+    // Non-zero RecordIO file id of the blocks, as for RecordIOWriter
+    uint32_t fileId = 1;
+  };
+
+  /**
+   * Create a writer that appends blocks to the end of the file.  Throws
+   * std::invalid_argument for invalid options, as getCodec() does.
+   */
+  explicit CompressedRecordIOWriter(File file);
+  CompressedRecordIOWriter(File file, Options options);
+
+  // Closes, logging errors
+  ~CompressedRecordIOWriter();
+
+  CompressedRecordIOWriter(const CompressedRecordIOWriter&) = delete;
+  CompressedRecordIOWriter& operator=(const CompressedRecordIOWriter&) =
+      delete;
+
+  /**
+   * Add a record to the current block.  Records may be empty.
+   */
+  void write(ByteRange record);
+
+  /**
+   * Write the current block, even if it isn't full.
+   */
+  void flush();
+
+  /**
+   * Flush, then write the index if the file was empty to begin with.
+   * Records can't be written once closed.
+   */
+  void close();
+
+  /**
+   * Position in the file where the next block will be written.
+   */
+  off_t filePos() const { return writer_.filePos(); }
+
+ private:
+  void flushLocked();
+
+  std::mutex mutex_;
+  const Options options_;
+  std::unique_ptr<io::Codec> codec_;
+  File file_;
+  RecordIOWriter writer_;
+  const bool writeIndex_;
+  bool closed_{false};
+
+  std::string block_;
+  uint32_t blockRecordCount_{0};
+  // Position and record count of the blocks written
+  std::vector<std::pair<uint64_t, uint32_t>> index_;
+};
+
+/**
+ * Class to read the records of a file written by CompressedRecordIOWriter.
+ * Skips invalid blocks.
+ */
+class CompressedRecordIOReader {
+ public:
+  // Called with the position of the block of a record, and the record,
+  // which is only valid during the call
+  using RecordCallback = std::function<void(off_t, ByteRange)>;
+
+  struct Block {
+    off_t pos;
+    uint32_t recordCount;
+  };
+
+  /**
+   * A reader with a fileId of 0 reads blocks of any file id; otherwise,
+   * only those of the given one.
+   */
+  explicit CompressedRecordIOReader(File file, uint32_t fileId = 0);
+
+  /**
+   * Whether the file ends with a valid index.
+   */
+  bool hasIndex() const { return hasIndex_; }
+
+  /**
+   * The blocks listed in the index; empty without one.
+   */
+  const std::vector<Block>& index() const { return index_; }
+
+  /**
+   * Call fn for the records of every valid block, in order.
+   */
+  void forEach(const RecordCallback& fn) const;
+
+  /**
+   * Call fn for the records of the block that starts at pos, in order.
+   * Returns false if there's no valid block there.  Throws
+   * std::runtime_error if it can't be uncompressed.
+   */
+  bool readBlock(off_t pos, const RecordCallback& fn) const;
+
+  /**
+   * Call fn for the records of every valid block, from up to parallelism
+   * tasks on the executor (the number of CPUs by default).  The records of
+   * a block are passed in order by one task, but blocks are read in any
+   * order, and fn is called concurrently.  Rethrows the first exception
+   * of a task, once all are done.
+   *
+   * Blocks until all the tasks are done, so it mustn't be called from the
+   * threads of the executor.
+   */
+  void parallelForEach(
+      Executor* executor,
+      const RecordCallback& fn,
+      size_t parallelism = 0) const;
+
+ private:
+  class Decoder;
+
+  void readIndex();
+  // Read the blocks whose header starts in [begin, end)
+  void scan(
+      size_t begin,
+      size_t end,
+      Decoder& decoder,
+      const RecordCallback& fn) const;
+
+  MemoryMapping map_;
+  uint32_t fileId_;
+  bool hasIndex_{false};
+  std::vector<Block> index_;
+};
+
+} // namespace folly
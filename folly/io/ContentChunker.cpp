@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/ContentChunker.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+
+namespace folly {
+
+namespace {
+
+struct GearTable {
+  uint64_t values[256];
+};
+
+// 256 random values, from splitmix64.  DO NOT CHANGE, as that would move
+// every chunk boundary in existence.
+constexpr GearTable makeGearTable() {
+  GearTable table{};
+  uint64_t state = 0x466173744344430aULL;
+  for (int i = 0; i < 256; ++i) {
+    state += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    table.values[i] = z ^ (z >> 31);
+  }
+  return table;
+}
+
+constexpr GearTable kGear = makeGearTable();
+
+// A mask of the top `bits` bits
+uint64_t topBits(unsigned bits) {
+  return ~uint64_t(0) << (64 - bits);
+}
+
+} // namespace
+
+ContentChunker::ContentChunker(const ContentChunkerOptions& options)
+    : minSize_(options.minSize),
+      avgSize_(options.avgSize),
+      maxSize_(options.maxSize) {
+  if (!(minSize_ <= avgSize_ && avgSize_ <= maxSize_) || avgSize_ < 256 ||
+      !isPowTwo(avgSize_)) {
+    throw std::invalid_argument("invalid ContentChunkerOptions");
+  }
+  // A boundary every avgSize bytes on average takes log2(avgSize) bits;
+  // FastCDC's normalization level 2 takes two more before avgSize and two
+  // fewer after.
+  unsigned bits = findLastSet(avgSize_) - 1;
+  maskSmall_ = topBits(bits + 2);
+  maskLarge_ = topBits(bits - 2);
+}
+
+Optional<size_t> ContentChunker::next(ByteRange data) {
+  const uint8_t* p = data.data();
+  const size_t n = data.size();
+  // The chunk had base bytes before data, so data[i] is its (base + i)-th
+  const size_t base = size_;
+  uint64_t h = hash_;
+
+  // The first minSize bytes can't end the chunk, and aren't hashed
+  size_t i = base < minSize_ ? std::min(minSize_ - base, n) : 0;
+
+  size_t end = base < avgSize_ ? std::min(avgSize_ - base, n) : 0;
+  for (; i < end; ++i) {
+    h = (h << 1) + kGear.values[p[i]];
+    if (!(h & maskSmall_)) {
+      return cut(i + 1);
+    }
+  }
+
+  end = std::min(maxSize_ - base, n);
+  for (; i < end; ++i) {
+    h = (h << 1) + kGear.values[p[i]];
+    if (!(h & maskLarge_)) {
+      return cut(i + 1);
+    }
+  }
+
+  if (base + i == maxSize_) {
+    return cut(i);
+  }
+  size_ = base + n;
+  hash_ = h;
+  return none;
+}
+
+std::vector<size_t> contentChunkBoundaries(
+    const IOBuf& buf,
+    const ContentChunkerOptions& options) {
+  std::vector<size_t> boundaries;
+  ContentChunker chunker(options);
+  size_t offset = 0;
+  for (ByteRange range : buf) {
+    while (auto len = chunker.next(range)) {
+      offset += *len;
+      boundaries.push_back(offset);
+      range.advance(*len);
+    }
+    offset += range.size();
+  }
+  if (chunker.pending() > 0) {
+    boundaries.push_back(offset);
+  }
+  return boundaries;
+}
+
+} // namespace folly
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Content-defined chunking: splitting a stream into chunks whose boundaries
+ * depend on the bytes around them rather than on their offsets, so that
+ * inserting or deleting bytes only moves the boundaries next to the edit.
+ * Deduplicating stores fingerprint each chunk (see Fingerprint.h), and only
+ * store the chunks they haven't seen.
+ *
+ * This is FastCDC, as described in
+ * Wen Xia et al. (2016)
+ *   FastCDC: a Fast and Efficient Content-Defined Chunking Approach for
+ *   Data Deduplication
+ *   USENIX ATC '16
+ *
+ * A rolling Gear hash, h = (h << 1) + gear[byte], whose top bits depend on
+ * the last 64 bytes only, marks a boundary where its top bits are all 0.
+ * The first minSize bytes of a chunk aren't hashed at all, and the hash
+ * must match more bits before the chunk reaches avgSize than after, which
+ * keeps most chunk sizes close to avgSize; chunks are cut at maxSize
+ * regardless.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+
+namespace folly {
+
+struct ContentChunkerOptions {
+  // Must be minSize <= avgSize <= maxSize, with avgSize a power of 2 of at
+  // least 256 bytes.
+  size_t minSize{2 * 1024};
+  size_t avgSize{8 * 1024};
+  size_t maxSize{64 * 1024};
+};
+
+/**
+ * Finds the chunk boundaries of a stream fed to it piece by piece, as in
+ *
+ *   folly::ContentChunker chunker;
+ *   while (auto len = chunker.next(data)) {
+ *     // The current chunk ends after the first *len bytes of data
+ *     data.advance(*len);
+ *   }
+ *   // All of data is in the current chunk, which goes on in the next piece
+ *
+ * The boundaries only depend on the bytes and the options, not on how the
+ * stream is split into pieces; they're the same on every platform, and
+ * across versions.
+ */
+class ContentChunker {
+ public:
+  /**
+   * Throws std::invalid_argument if the options are invalid.
+   */
+  explicit ContentChunker(
+      const ContentChunkerOptions& options = ContentChunkerOptions());
+
+  /**
+   * Scans data, the next bytes of the stream.  If the current chunk ends
+   * in data, returns the number of bytes of data in it, and starts a new
+   * chunk with the rest; otherwise all of data is in the current chunk,
+   * and returns none.
+   */
+  Optional<size_t> next(ByteRange data);
+
+  /**
+   * The number of bytes in the current chunk so far.  The last chunk of a
+   * stream ends with the stream, if pending() > 0.
+   */
+  size_t pending() const {
+    return size_;
+  }
+
+  /**
+   * Starts a new chunk, as at the beginning of a stream.
+   */
+  void reset() {
+    size_ = 0;
+    hash_ = 0;
+  }
+
+ private:
+  size_t cut(size_t len) {
+    reset();
+    return len;
+  }
+
+  size_t minSize_;
+  size_t avgSize_;
+  size_t maxSize_;
+  // Boundary masks before and after the chunk reaches avgSize
+  uint64_t maskSmall_;
+  uint64_t maskLarge_;
+
+  size_t size_{0};
+  uint64_t hash_{0};
+};
+
+/**
+ * The offsets at which the chunks of buf end, in increasing order; the
+ * last one is buf.computeChainDataLength(), unless buf is empty.
+ */
+std::vector<size_t> contentChunkBoundaries(
+    const IOBuf& buf,
+    const ContentChunkerOptions& options = ContentChunkerOptions());
+
+} // namespace folly
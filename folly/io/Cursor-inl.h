@@ -67,6 +67,37 @@ std::string CursorBase<Derived, BufType>::readTerminatedString(
   return result;
 }
 
+template <class Derived, class BufType>
+void CursorBase<Derived, BufType>::readVarints(uint64_t* out, size_t n) {
+  while (n > 0) {
+    auto bytes = peekBytes();
+    size_t const available = bytes.size();
+    // decodeVarint() doesn't check for the end of the range here
+    while (n > 0 && bytes.size() >= kMaxVarintLength64) {
+      *out++ = decodeVarint(bytes);
+      --n;
+    }
+    skip(available - bytes.size());
+    if (n > 0) {
+      *out++ = readVarintSlow();
+      --n;
+    }
+  }
+}
+
+template <class Derived, class BufType>
+uint64_t CursorBase<Derived, BufType>::readVarintSlow() {
+  uint64_t val = 0;
+  for (int shift = 0; shift <= 63; shift += 7) {
+    uint8_t const b = read<uint8_t>();
+    val |= uint64_t(shift == 63 ? b & 0x01 : b & 0x7f) << shift;
+    if (b < 0x80) {
+      return val;
+    }
+  }
+  throw std::invalid_argument("Invalid varint value. Too big.");
+}
+
 template <class Derived, class BufType>
 template <typename Predicate>
 std::string CursorBase<Derived, BufType>::readWhile(
@@ -28,6 +28,7 @@
 #include <folly/Memory.h>
 #include <folly/Portability.h>
 #include <folly/Range.h>
+#include <folly/Varint.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/portability/BitsFunctexcept.h>
@@ -245,6 +246,46 @@ class CursorBase {
     return Endian::little(read<T>());
   }
 
+  /**
+   * Read n values into out, as n calls to read<T>() (or readBE<T>(),
+   * readLE<T>()) would, but copying all of them that are in the current
+   * buffer at once, and byte swapping them in a loop that compilers
+   * vectorize.  Only values that cross buffers are copied piecewise.
+   */
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type readArray(
+      T* out,
+      size_t n) {
+    pull(out, n * sizeof(T));
+  }
+
+  template <class T>
+  void readArrayBE(T* out, size_t n) {
+    readArray(out, n);
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = Endian::big(out[i]);
+    }
+  }
+
+  template <class T>
+  void readArrayLE(T* out, size_t n) {
+    readArray(out, n);
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = Endian::little(out[i]);
+    }
+  }
+
+  /**
+   * Read n varints (as encoded by folly/Varint.h) into out.  Varints are
+   * decoded in place while at least kMaxVarintLength64 bytes are left in
+   * the current buffer, without checking for its end; only the last few
+   * varints of each buffer are read byte by byte.
+   *
+   * Throws std::out_of_range on underflow, and std::invalid_argument on a
+   * varint longer than kMaxVarintLength64 bytes.
+   */
+  void readVarints(uint64_t* out, size_t n);
+
   /**
    * Read a fixed-length string.
    *
@@ -550,6 +591,8 @@ class CursorBase {
     advanceBufferIfEmpty();
   }
 
+  uint64_t readVarintSlow();
+
   size_t pullAtMostSlow(void* buf, size_t len) {
     uint8_t* p = reinterpret_cast<uint8_t*>(buf);
     size_t copied = 0;
@@ -31,6 +31,7 @@
 #include <folly/ScopeGuard.h>
 #include <folly/hash/SpookyHashV2.h>
 #include <folly/io/Cursor.h>
+#include <folly/io/IOBufAllocator.h>
 #include <folly/memory/Malloc.h>
 
 using std::unique_ptr;
@@ -83,8 +84,19 @@ void takeOwnershipError(bool freeOnError, void* buf,
 
 namespace folly {
 
+// Constant-initialized, so usable by static initializers
+std::atomic<IOBufAllocator*> IOBufAllocator::current_{nullptr};
+
+void IOBufAllocator::set(IOBufAllocator* allocator) {
+  IOBufAllocator* expected = nullptr;
+  CHECK(current_.compare_exchange_strong(expected, allocator) ||
+        expected == allocator)
+      << "An IOBufAllocator is already installed";
+}
+
 struct IOBuf::HeapPrefix {
-  explicit HeapPrefix(uint16_t flg) : magic(kHeapMagic), flags(flg) {}
+  explicit HeapPrefix(uint16_t flg, bool fromAllocator = false)
+      : magic(kHeapMagic), flags(flg), pooled(fromAllocator) {}
   ~HeapPrefix() {
     // Reset magic to 0 on destruction.  This is solely for debugging purposes
     // to help catch bugs where someone tries to use HeapStorage after it has
@@ -94,6 +106,8 @@ struct IOBuf::HeapPrefix {
 
   uint16_t magic;
   std::atomic<uint16_t> flags;
+  // Allocated by the IOBufAllocator (in the padding before the IOBuf)
+  bool pooled;
 };
 
 struct IOBuf::HeapStorage {
@@ -133,13 +147,15 @@ IOBuf::SharedInfo::SharedInfo(FreeFunction fn, void* arg)
 
 void* IOBuf::operator new(size_t size) {
   size_t fullSize = offsetof(HeapStorage, buf) + size;
-  auto* storage = static_cast<HeapStorage*>(malloc(fullSize));
+  bool pooled;
+  auto* storage = static_cast<HeapStorage*>(allocate(fullSize, &fullSize,
+                                                     &pooled));
   // operator new is not allowed to return nullptr
   if (UNLIKELY(storage == nullptr)) {
     throw std::bad_alloc();
   }
 
-  new (&storage->prefix) HeapPrefix(kIOBufInUse);
+  new (&storage->prefix) HeapPrefix(kIOBufInUse, pooled);
   return &(storage->buf);
 }
 
@@ -164,8 +180,13 @@ void IOBuf::releaseStorage(HeapStorage* storage, uint16_t freeFlags) {
     uint16_t newFlags = uint16_t(flags & ~freeFlags);
     if (newFlags == 0) {
       // The storage space is now unused.  Free it.
+      bool pooled = storage->prefix.pooled;
       storage->prefix.HeapPrefix::~HeapPrefix();
-      free(storage);
+      if (pooled) {
+        IOBufAllocator::get()->deallocate(storage);
+      } else {
+        free(storage);
+      }
       return;
     }
 
@@ -184,6 +205,26 @@ void IOBuf::releaseStorage(HeapStorage* storage, uint16_t freeFlags) {
   }
 }
 
+void* IOBuf::allocate(size_t size, size_t* usable, bool* pooled) {
+  auto allocator = IOBufAllocator::get();
+  if (allocator != nullptr) {
+    void* p = allocator->allocate(size, usable);
+    if (p != nullptr) {
+      *pooled = true;
+      // Keeps the SharedInfo at the end of external buffers aligned
+      *usable &= ~size_t(7);
+      return p;
+    }
+  }
+  *pooled = false;
+  *usable = goodMallocSize(size);
+  return malloc(*usable);
+}
+
+void IOBuf::freePooledBuffer(void* buf, void* /* userData */) {
+  IOBufAllocator::get()->deallocate(buf);
+}
+
 void IOBuf::freeInternalBuf(void* /* buf */, void* userData) {
   auto* storage = static_cast<HeapStorage*>(userData);
   releaseStorage(storage, kDataInUse);
@@ -240,10 +281,15 @@ unique_ptr<IOBuf> IOBuf::createCombined(uint64_t capacity) {
   // To save a memory allocation, allocate space for the IOBuf object, the
   // SharedInfo struct, and the data itself all with a single call to malloc().
   size_t requiredStorage = offsetof(HeapFullStorage, align) + capacity;
-  size_t mallocSize = goodMallocSize(requiredStorage);
-  auto* storage = static_cast<HeapFullStorage*>(malloc(mallocSize));
+  size_t mallocSize;
+  bool pooled;
+  auto* storage = static_cast<HeapFullStorage*>(
+      allocate(requiredStorage, &mallocSize, &pooled));
+  if (UNLIKELY(storage == nullptr)) {
+    throw std::bad_alloc();
+  }
 
-  new (&storage->hs.prefix) HeapPrefix(kIOBufInUse | kDataInUse);
+  new (&storage->hs.prefix) HeapPrefix(kIOBufInUse | kDataInUse, pooled);
   new (&storage->shared) SharedInfo(freeInternalBuf, storage);
 
   uint8_t* bufAddr = reinterpret_cast<uint8_t*>(&storage->align);
@@ -802,6 +848,7 @@ void IOBuf::reserveSlow(uint64_t minHeadroom, uint64_t minTailroom) {
 
   size_t newAllocatedCapacity = 0;
   uint8_t* newBuffer = nullptr;
+  bool pooled = false;
   uint64_t newHeadroom = 0;
   uint64_t oldHeadroom = headroom();
 
@@ -846,7 +893,7 @@ void IOBuf::reserveSlow(uint64_t minHeadroom, uint64_t minTailroom) {
   // an internal buffer).  malloc/copy/free.
   if (newBuffer == nullptr) {
     newAllocatedCapacity = goodExtBufferSize(newCapacity);
-    void* p = malloc(newAllocatedCapacity);
+    void* p = allocate(newAllocatedCapacity, &newAllocatedCapacity, &pooled);
     if (UNLIKELY(p == nullptr)) {
       throw std::bad_alloc();
     }
@@ -863,6 +910,9 @@ void IOBuf::reserveSlow(uint64_t minHeadroom, uint64_t minTailroom) {
 
   uint64_t cap;
   initExtBuffer(newBuffer, newAllocatedCapacity, &info, &cap);
+  if (pooled) {
+    info->freeFn = freePooledBuffer;
+  }
 
   if (flags() & kFlagFreeSharedInfo) {
     delete sharedInfo();
@@ -898,11 +948,17 @@ void IOBuf::allocExtBuffer(uint64_t minCapacity,
                            SharedInfo** infoReturn,
                            uint64_t* capacityReturn) {
   size_t mallocSize = goodExtBufferSize(minCapacity);
-  uint8_t* buf = static_cast<uint8_t*>(malloc(mallocSize));
+  bool pooled;
+  uint8_t* buf =
+      static_cast<uint8_t*>(allocate(mallocSize, &mallocSize, &pooled));
   if (UNLIKELY(buf == nullptr)) {
     throw std::bad_alloc();
   }
   initExtBuffer(buf, mallocSize, infoReturn, capacityReturn);
+  if (pooled) {
+    // Not free()-able, so not to be realloc()-ed or given to an fbstring
+    (*infoReturn)->freeFn = freePooledBuffer;
+  }
   *bufReturn = buf;
 }
 
@@ -948,6 +1004,16 @@ fbstring IOBuf::moveToFbString() {
     coalesceAndReallocate(0, computeChainDataLength(), this, 1);
   }
 
+  if (UNLIKELY(sharedInfo()->freeFn != nullptr)) {
+    // Reallocated by the IOBufAllocator, so not for fbstring to free
+    fbstring str(reinterpret_cast<const char*>(data()), length());
+    decrementRefcount();
+    flagsAndSharedInfo_ = 0;
+    buf_ = nullptr;
+    clear();
+    return str;
+  }
+
   // Ensure NUL terminated
   *writableTail() = 0;
   fbstring str(reinterpret_cast<char*>(writableData()),
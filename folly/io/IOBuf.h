@@ -1317,6 +1317,10 @@ class IOBuf {
                              uint64_t* capacityReturn);
   static void releaseStorage(HeapStorage* storage, uint16_t freeFlags);
   static void freeInternalBuf(void* buf, void* userData);
+  // From the IOBufAllocator if there is one (setting *pooled), otherwise
+  // from malloc(); *usable is set to the size that may be used
+  static void* allocate(size_t size, size_t* usable, bool* pooled);
+  static void freePooledBuffer(void* buf, void* userData);
 
   /*
    * Member variables
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace folly {
+
+/*
+ * Allocates the memory of the IOBufs and buffers that IOBuf creates itself
+ * (with create(), createCombined(), createSeparate(), copyBuffer(), and when
+ * growing or coalescing buffers), in place of malloc().
+ *
+ * An allocator is installed with IOBufAllocator::set(), once, before the
+ * buffers it is to allocate are created, and must outlive all of them.
+ * IOBufPool is the allocator folly provides.
+ */
+class IOBufAllocator {
+ public:
+  virtual ~IOBufAllocator() = default;
+
+  /*
+   * Returns at least size bytes, aligned like malloc(), setting *usable to
+   * how many of them may be used, or returns nullptr to leave the
+   * allocation to malloc().
+   */
+  virtual void* allocate(size_t size, size_t* usable) = 0;
+
+  /* Frees what allocate() returned.  Called from any thread. */
+  virtual void deallocate(void* ptr) = 0;
+
+  /*
+   * Installs the allocator for every IOBuf from now on.  The allocator
+   * can't be replaced once installed.
+   */
+  static void set(IOBufAllocator* allocator);
+
+  static IOBufAllocator* get() {
+    return current_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static std::atomic<IOBufAllocator*> current_;
+};
+
+} // namespace folly
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/IOBufPool.h>
+
+#include <algorithm>
+#include <new>
+
+#include <folly/Bits.h>
+#include <folly/Likely.h>
+#include <folly/portability/Memory.h>
+
+namespace folly {
+
+namespace {
+
+// The start of each slab, and so the alignment of the blocks
+constexpr size_t kSlabHeaderSize = 64;
+
+// The blocks a thread moves to or from the shared freelists at once; a
+// thread's freelist holds up to twice as many
+size_t batchSize(size_t sizeClass) {
+  return std::max<size_t>(1, (64 * 1024) / IOBufPool::classSize(sizeClass));
+}
+
+void*& nextBlock(void* block) {
+  return *static_cast<void**>(block);
+}
+
+// Only the owning thread writes the counters, so there is no need for
+// atomic read-modify-writes
+void increment(std::atomic<uint64_t>& counter) {
+  counter.store(
+      counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+constexpr size_t IOBufPool::kMinSize;
+constexpr size_t IOBufPool::kMaxSize;
+constexpr size_t IOBufPool::kNumClasses;
+constexpr size_t IOBufPool::kSlabSize;
+
+static_assert(
+    IOBufPool::kMinSize << (IOBufPool::kNumClasses - 1) == IOBufPool::kMaxSize,
+    "The size classes must end at kMaxSize");
+
+struct IOBufPool::Slab {
+  size_t sizeClass;
+};
+
+struct IOBufPool::ThreadCache {
+  explicit ThreadCache(IOBufPool* p) : pool(p) {}
+
+  ~ThreadCache() {
+    for (size_t c = 0; c < kNumClasses; ++c) {
+      pool->release(c, lists[c], lists[c].size);
+    }
+    pool->retiredHits_ += hits.load(std::memory_order_relaxed);
+    pool->retiredMisses_ += misses.load(std::memory_order_relaxed);
+  }
+
+  IOBufPool* const pool;
+  std::array<Freelist, kNumClasses> lists;
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+IOBufPool::Slabs::~Slabs() {
+  for (auto slab : memory) {
+    detail::aligned_free(slab);
+  }
+}
+
+IOBufPool::IOBufPool() {}
+
+// The thread caches are destroyed first, and release their blocks to
+// shared_ before the slabs are freed
+IOBufPool::~IOBufPool() {}
+
+size_t IOBufPool::sizeClass(size_t size) {
+  if (size <= kMinSize) {
+    return 0;
+  }
+  // The log2 of the next power of 2, relative to kMinSize
+  return findLastSet(size - 1) - findLastSet(kMinSize - 1);
+}
+
+IOBufPool::ThreadCache& IOBufPool::threadCache() {
+  auto cache = caches_.get();
+  if (UNLIKELY(cache == nullptr)) {
+    cache = new ThreadCache(this);
+    caches_.reset(cache);
+  }
+  return *cache;
+}
+
+void* IOBufPool::allocate(size_t size, size_t* usable) {
+  if (UNLIKELY(size > kMaxSize)) {
+    oversized_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  auto c = sizeClass(size);
+  auto& cache = threadCache();
+  auto& list = cache.lists[c];
+  if (LIKELY(list.head != nullptr)) {
+    increment(cache.hits);
+  } else {
+    increment(cache.misses);
+    refill(c, list);
+  }
+  void* block = list.head;
+  list.head = nextBlock(block);
+  --list.size;
+  *usable = classSize(c);
+  return block;
+}
+
+void IOBufPool::deallocate(void* ptr) {
+  auto slab = reinterpret_cast<Slab*>(uintptr_t(ptr) & ~(kSlabSize - 1));
+  auto c = slab->sizeClass;
+  auto& list = threadCache().lists[c];
+  nextBlock(ptr) = list.head;
+  list.head = ptr;
+  ++list.size;
+  auto batch = batchSize(c);
+  if (UNLIKELY(list.size > 2 * batch)) {
+    release(c, list, list.size - batch);
+  }
+}
+
+void IOBufPool::refill(size_t c, Freelist& list) {
+  auto batch = batchSize(c);
+  {
+    auto& shared = shared_[c];
+    std::lock_guard<std::mutex> g(shared.mutex);
+    if (shared.list.head != nullptr) {
+      auto count = std::min(batch, shared.list.size);
+      void* last = shared.list.head;
+      for (size_t i = 1; i < count; ++i) {
+        last = nextBlock(last);
+      }
+      list.head = shared.list.head;
+      list.size = count;
+      shared.list.head = nextBlock(last);
+      shared.list.size -= count;
+      nextBlock(last) = nullptr;
+      return;
+    }
+  }
+
+  auto memory = detail::aligned_malloc(kSlabSize, kSlabSize);
+  if (UNLIKELY(memory == nullptr)) {
+    throw std::bad_alloc();
+  }
+  {
+    std::lock_guard<std::mutex> g(slabs_.mutex);
+    slabs_.memory.push_back(memory);
+  }
+  static_cast<Slab*>(memory)->sizeClass = c;
+
+  // Link the blocks in address order: the thread keeps the first batch,
+  // and shares the rest
+  auto size = classSize(c);
+  auto numBlocks = (kSlabSize - kSlabHeaderSize) / size;
+  auto block = [&](size_t i) -> void* {
+    return static_cast<char*>(memory) + kSlabHeaderSize + i * size;
+  };
+  for (size_t i = 0; i + 1 < numBlocks; ++i) {
+    nextBlock(block(i)) = block(i + 1);
+  }
+  nextBlock(block(numBlocks - 1)) = nullptr;
+  list.head = block(0);
+  if (numBlocks <= batch) {
+    list.size = numBlocks;
+    return;
+  }
+  nextBlock(block(batch - 1)) = nullptr;
+  list.size = batch;
+
+  auto& shared = shared_[c];
+  std::lock_guard<std::mutex> g(shared.mutex);
+  nextBlock(block(numBlocks - 1)) = shared.list.head;
+  shared.list.head = block(batch);
+  shared.list.size += numBlocks - batch;
+}
+
+void IOBufPool::release(size_t c, Freelist& list, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  void* first = list.head;
+  void* last = first;
+  for (size_t i = 1; i < count; ++i) {
+    last = nextBlock(last);
+  }
+  list.head = nextBlock(last);
+  list.size -= count;
+  returned_.fetch_add(count, std::memory_order_relaxed);
+
+  auto& shared = shared_[c];
+  std::lock_guard<std::mutex> g(shared.mutex);
+  nextBlock(last) = shared.list.head;
+  shared.list.head = first;
+  shared.list.size += count;
+}
+
+IOBufPoolStats IOBufPool::getStats() const {
+  IOBufPoolStats stats;
+  stats.hits = retiredHits_.load();
+  stats.misses = retiredMisses_.load();
+  for (const auto& cache : caches_.accessAllThreads()) {
+    stats.hits += cache.hits.load(std::memory_order_relaxed);
+    stats.misses += cache.misses.load(std::memory_order_relaxed);
+  }
+  stats.oversized = oversized_.load(std::memory_order_relaxed);
+  stats.returned = returned_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> g(slabs_.mutex);
+  stats.slabs = slabs_.memory.size();
+  return stats;
+}
+
+} // namespace folly
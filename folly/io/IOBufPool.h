@@ -0,0 +1,123 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <folly/ThreadLocal.h>
+#include <folly/io/IOBufAllocator.h>
+
+namespace folly {
+
+struct IOBufPoolStats {
+  // Allocations served from the freelists of the allocating thread
+  uint64_t hits{0};
+  // Allocations that had to refill those from the shared freelists or from
+  // a new slab
+  uint64_t misses{0};
+  // Allocations larger than the largest size class, left to malloc()
+  uint64_t oversized{0};
+  // Blocks moved from a thread's freelists (once they were full, or when
+  // the thread exited) to the shared freelists, for other threads to reuse
+  uint64_t returned{0};
+  uint64_t slabs{0};
+};
+
+/*
+ * An IOBufAllocator with size classes of powers of 2 from 64 bytes to
+ * kMaxSize, carved out of slabs of kSlabSize bytes:
+ *
+ *   static auto& pool = *new folly::IOBufPool();
+ *   folly::IOBufAllocator::set(&pool);
+ *
+ * Each thread allocates from and frees into its own freelists for each
+ * size class, without synchronization.  When a thread's freelist is full
+ * (because it frees the buffers that another thread allocated, say) half of
+ * it moves to a shared freelist, which threads refill theirs from when they
+ * run out; new slabs are only allocated when that is empty too.  A slab
+ * is carved up, and so first touched, by the thread that needed it, so
+ * with the usual first-touch policy its memory is on that thread's NUMA
+ * node.
+ *
+ * Slabs are only freed with the pool.
+ */
+class IOBufPool : public IOBufAllocator {
+ public:
+  static constexpr size_t kMinSize = 64;
+  static constexpr size_t kMaxSize = 64 * 1024;
+  static constexpr size_t kNumClasses = 11;
+  static constexpr size_t kSlabSize = 1024 * 1024;
+
+  IOBufPool();
+  ~IOBufPool() override;
+
+  void* allocate(size_t size, size_t* usable) override;
+  void deallocate(void* ptr) override;
+
+  /* The counters of every thread so far. */
+  IOBufPoolStats getStats() const;
+
+  static size_t sizeClass(size_t size);
+
+  static size_t classSize(size_t sizeClass) {
+    return kMinSize << sizeClass;
+  }
+
+ private:
+  struct Slab;
+  struct ThreadCache;
+  struct ThreadCacheTag {};
+
+  struct Freelist {
+    void* head{nullptr};
+    size_t size{0};
+  };
+
+  struct SharedFreelist {
+    std::mutex mutex;
+    Freelist list;
+  };
+
+  void refill(size_t sizeClass, Freelist& list);
+  void release(size_t sizeClass, Freelist& list, size_t count);
+  ThreadCache& threadCache();
+
+  std::array<SharedFreelist, kNumClasses> shared_;
+
+  struct Slabs {
+    ~Slabs();
+
+    mutable std::mutex mutex;
+    std::vector<void*> memory;
+  };
+  Slabs slabs_;
+
+  // The counters of the threads that exited
+  std::atomic<uint64_t> retiredHits_{0};
+  std::atomic<uint64_t> retiredMisses_{0};
+  std::atomic<uint64_t> oversized_{0};
+  std::atomic<uint64_t> returned_{0};
+
+  ThreadLocalPtr<ThreadCache, ThreadCacheTag> caches_;
+};
+
+} // namespace folly
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncChildExitHandler.h>
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Subprocess.h>
+
+namespace folly {
+
+AsyncChildExitHandler::AsyncChildExitHandler(EventBase* eventBase)
+    : AsyncSignalHandler(eventBase, Backend::SIGNALFD) {
+  registerSignalHandler(SIGCHLD);
+}
+
+AsyncChildExitHandler::~AsyncChildExitHandler() {
+  unregisterSignalHandler(SIGCHLD);
+}
+
+void AsyncChildExitHandler::add(Subprocess& proc, Callback callback) {
+  getEventBase()->dcheckIsInEventBaseThread();
+  CHECK(proc.returnCode().running());
+  auto pid = proc.pid();
+  auto inserted =
+      children_.emplace(pid, Child{&proc, std::move(callback)}).second;
+  CHECK(inserted) << "child " << pid << " added twice";
+  // In case it exited before we were watching
+  poll(pid);
+}
+
+bool AsyncChildExitHandler::remove(Subprocess& proc) {
+  getEventBase()->dcheckIsInEventBaseThread();
+  auto it = children_.find(proc.pid());
+  if (it == children_.end() || it->second.proc != &proc) {
+    return false;
+  }
+  children_.erase(it);
+  return true;
+}
+
+void AsyncChildExitHandler::signalInfoReceived(
+    const SignalInfo& info) noexcept {
+  if (info.code == CLD_EXITED || info.code == CLD_KILLED ||
+      info.code == CLD_DUMPED) {
+    poll(info.pid);
+  }
+  // Other SIGCHLDs may have been merged into this one; look for their
+  // children once all of the siginfos that were read have been handled.
+  if (!isLoopCallbackScheduled()) {
+    getEventBase()->runInLoop(this);
+  }
+}
+
+void AsyncChildExitHandler::runLoopCallback() noexcept {
+  for (;;) {
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) != 0 ||
+        info.si_pid == 0) {
+      return;
+    }
+    if (!children_.count(info.si_pid)) {
+      // Some other code's child, which waitid() will keep returning until
+      // that code reaps it, and may be hiding ours.
+      pollAll();
+      return;
+    }
+    if (!poll(info.si_pid)) {
+      return;
+    }
+  }
+}
+
+bool AsyncChildExitHandler::poll(pid_t pid) {
+  auto it = children_.find(pid);
+  if (it == children_.end()) {
+    return false;
+  }
+  auto& proc = *it->second.proc;
+  if (proc.poll().running()) {
+    return false;
+  }
+  auto callback = std::move(it->second.callback);
+  children_.erase(it);
+  if (callback) {
+    callback(proc);
+  }
+  return true;
+}
+
+void AsyncChildExitHandler::pollAll() {
+  std::vector<pid_t> pids;
+  pids.reserve(children_.size());
+  for (const auto& child : children_) {
+    pids.push_back(child.first);
+  }
+  // Callbacks may add and remove children
+  for (auto pid : pids) {
+    poll(pid);
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <unordered_map>
+
+#include <folly/Function.h>
+#include <folly/io/async/AsyncSignalHandler.h>
+#include <folly/io/async/EventBase.h>
+
+namespace folly {
+
+class Subprocess;
+
+/**
+ * Reaps Subprocesses from an EventBase loop as they exit.
+ *
+ *   AsyncChildExitHandler children(&evb);
+ *   Subprocess proc({"/bin/true"});
+ *   children.add(proc, [](Subprocess& p) {
+ *     LOG(INFO) << p.returnCode().str();
+ *   });
+ *
+ * SIGCHLD is read through a signalfd (see AsyncSignalHandler), and each
+ * siginfo names the child that exited, which is then reaped with
+ * Subprocess::poll() by pid, so the cost per exit doesn't grow with the
+ * number of children.  As SIGCHLDs that arrive together are merged into
+ * one, the handler then also checks, without reaping, for other exited
+ * children with waitid(WNOWAIT), and only polls all of its children when an
+ * exited child that isn't its own is in the way.
+ *
+ * SIGCHLD is blocked in the constructing thread; block it in every thread of
+ * the process. Linux only. All methods must be called from the EventBase
+ * thread, and children must not be reaped by other means while added.
+ */
+class AsyncChildExitHandler : private AsyncSignalHandler,
+                              private EventBase::LoopCallback {
+ public:
+  // Called from the EventBase loop once proc has been reaped, i.e. with
+  // proc.returnCode() set
+  using Callback = Function<void(Subprocess& proc)>;
+
+  explicit AsyncChildExitHandler(EventBase* eventBase);
+  ~AsyncChildExitHandler() override;
+
+  /**
+   * Watch proc, which must be running, and outlive its callback or its
+   * removal.  If proc has already exited, callback is called before add()
+   * returns.
+   */
+  void add(Subprocess& proc, Callback callback);
+
+  /**
+   * Stop watching proc, without reaping it. Returns false if it wasn't
+   * watched.
+   */
+  bool remove(Subprocess& proc);
+
+  // Number of watched children
+  size_t size() const {
+    return children_.size();
+  }
+
+  using AsyncSignalHandler::getEventBase;
+
+ private:
+  struct Child {
+    Subprocess* proc;
+    Callback callback;
+  };
+  using ChildMap = std::unordered_map<pid_t, Child>;
+
+  void signalReceived(int /* signum */) noexcept override {}
+  void signalInfoReceived(const SignalInfo& info) noexcept override;
+  void runLoopCallback() noexcept override;
+
+  // Reaps the child if it has exited, and calls its callback. Returns
+  // whether it did.
+  bool poll(pid_t pid);
+  void pollAll();
+
+  ChildMap children_;
+};
+
+} // namespace folly
@@ -16,7 +16,13 @@
 #include <folly/io/async/AsyncPipe.h>
 
 #include <folly/FileUtil.h>
+#include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncSocketException.h>
+#include <folly/portability/Sockets.h>
+
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#endif
 
 using std::string;
 using std::unique_ptr;
@@ -54,11 +60,90 @@ void AsyncPipeReader::close() {
   }
 }
 
+void AsyncPipeReader::failSplice(const AsyncSocketException& ex) {
+  VLOG(5) << "AsyncPipeReader(this=" << this << ", fd=" << fd_ <<
+    "): failed while splicing: " << ex.what();
+
+  DCHECK(spliceCallback_ != nullptr);
+  SpliceCallback* callback = spliceCallback_;
+  spliceCallback_ = nullptr;
+  spliceSocket_ = nullptr;
+  callback->spliceErr(ex);
+  close();
+}
+
+void AsyncPipeReader::spliceTo(AsyncSocket* socket, SpliceCallback* callback) {
+  CHECK(readCallback_ == nullptr);
+  CHECK(callback == nullptr || socket != nullptr);
+  spliceSocket_ = socket;
+  spliceCallback_ = callback;
+  if (spliceCallback_ && !isHandlerRegistered() && splicePending_ == 0) {
+    registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  } else if (!spliceCallback_ && isHandlerRegistered()) {
+    unregisterHandler();
+  }
+}
+
+void AsyncPipeReader::handleSplice() {
+  int available = 0;
+#ifdef _WIN32
+  AsyncSocketException ex(AsyncSocketException::NOT_SUPPORTED,
+                          "spliceTo() is not supported on this platform");
+  failSplice(ex);
+  return;
+#else
+  if (ioctl(fd_, FIONREAD, &available) != 0) {
+    AsyncSocketException ex(AsyncSocketException::INTERNAL_ERROR,
+                            "ioctl(FIONREAD) failed", errno);
+    failSplice(ex);
+    return;
+  }
+#endif
+  unregisterHandler();
+  if (available == 0) {
+    // Readable and empty: the write end was closed
+    SpliceCallback* callback = spliceCallback_;
+    spliceCallback_ = nullptr;
+    spliceSocket_ = nullptr;
+    callback->spliceEOF();
+    return;
+  }
+  splicePending_ = size_t(available);
+  spliceSocket_->sendFile(&spliceWriteCallback_, fd_, -1, splicePending_);
+}
+
+void AsyncPipeReader::SpliceWriteCallback::writeSuccess() noexcept {
+  DestructorGuard dg(reader_);
+  size_t len = reader_->splicePending_;
+  reader_->splicePending_ = 0;
+  if (reader_->spliceCallback_) {
+    reader_->spliceCallback_->splicedData(len);
+  }
+  // splicedData() may have stopped splicing
+  if (reader_->spliceCallback_ && !reader_->isHandlerRegistered()) {
+    reader_->registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  }
+}
+
+void AsyncPipeReader::SpliceWriteCallback::writeErr(
+    size_t /* bytesWritten */,
+    const AsyncSocketException& ex) noexcept {
+  DestructorGuard dg(reader_);
+  reader_->splicePending_ = 0;
+  if (reader_->spliceCallback_) {
+    reader_->failSplice(ex);
+  }
+}
+
 void AsyncPipeReader::handlerReady(uint16_t events) noexcept {
   DestructorGuard dg(this);
   CHECK(events & EventHandler::READ);
 
   VLOG(5) << "AsyncPipeReader::handlerReady() this=" << this << ", fd=" << fd_;
+  if (spliceCallback_) {
+    handleSplice();
+    return;
+  }
   assert(readCallback_ != nullptr);
 
   while (readCallback_) {
@@ -26,6 +26,7 @@
 
 namespace folly {
 
+class AsyncSocket;
 class AsyncSocketException;
 
 /**
@@ -77,16 +78,67 @@ class AsyncPipeReader : public EventHandler,
     closeCb_ = closeCb;
   }
 
+  class SpliceCallback {
+   public:
+    virtual ~SpliceCallback() = default;
+
+    /**
+     * len more bytes from the pipe were written to the socket.
+     */
+    virtual void splicedData(size_t /* len */) noexcept {}
+
+    /**
+     * The pipe was closed, and everything in it was written to the socket.
+     * The callback is uninstalled immediately before.
+     */
+    virtual void spliceEOF() noexcept = 0;
+
+    /**
+     * Reading from the pipe or writing to the socket failed.  The callback
+     * is uninstalled, and the pipe closed, immediately before.
+     */
+    virtual void spliceErr(const AsyncSocketException& ex) noexcept = 0;
+  };
+
+  /**
+   * Instead of reading the pipe into a ReadCallback, move what is written to
+   * it straight to socket with AsyncSocket::sendFile(), which splice()s it
+   * on Linux.  Whatever is in the pipe is sent at once, and the pipe isn't
+   * read again until it was written, so a slow socket backs up into the
+   * pipe.  A null callback stops splicing.
+   *
+   * Can't be used while a ReadCallback is installed.  The reader must not be
+   * destroyed while a sendFile() it started is pending.
+   */
+  void spliceTo(AsyncSocket* socket, SpliceCallback* callback);
+
  private:
+  class SpliceWriteCallback : public AsyncWriter::WriteCallback {
+   public:
+    explicit SpliceWriteCallback(AsyncPipeReader* reader) : reader_(reader) {}
+    void writeSuccess() noexcept override;
+    void writeErr(size_t bytesWritten,
+                  const AsyncSocketException& ex) noexcept override;
+
+   private:
+    AsyncPipeReader* reader_;
+  };
+
   ~AsyncPipeReader() override;
 
   void handlerReady(uint16_t events) noexcept override;
+  void handleSplice();
   void failRead(const AsyncSocketException& ex);
+  void failSplice(const AsyncSocketException& ex);
   void close();
 
   int fd_;
   AsyncReader::ReadCallback* readCallback_{nullptr};
   std::function<void(int)> closeCb_;
+  AsyncSocket* spliceSocket_{nullptr};
+  SpliceCallback* spliceCallback_{nullptr};
+  size_t splicePending_{0};    ///< bytes handed to sendFile(), if any
+  SpliceWriteCallback spliceWriteCallback_{this};
 };
 
 /**
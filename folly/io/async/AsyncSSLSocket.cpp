@@ -30,10 +30,34 @@
 #include <folly/Format.h>
 #include <folly/SocketAddress.h>
 #include <folly/SpinLock.h>
+#include <folly/String.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/portability/OpenSSL.h>
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#endif
+#endif
+
+// Kernel TLS needs TLS_RX and AES-GCM-256 (Linux 5.1), and OpenSSL 1.1.1 to
+// find the PRF digest of the negotiated cipher.
+#if defined(TLS_RX) && defined(TLS_CIPHER_AES_GCM_256) && \
+    OPENSSL_VERSION_NUMBER >= 0x10101000L
+#define FOLLY_SSL_HAVE_KTLS 1
+#include <openssl/kdf.h>
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#else
+#define FOLLY_SSL_HAVE_KTLS 0
+#endif
+
 using folly::SocketAddress;
 using folly::SSLContext;
 using std::string;
@@ -72,6 +96,132 @@ inline bool zero_return(int error, int rc) {
   return (error == SSL_ERROR_ZERO_RETURN || (rc == 0 && errno == 0));
 }
 
+#if FOLLY_SSL_HAVE_KTLS
+// TLS record types and the close_notify alert, from RFC 5246
+constexpr unsigned char kTlsRecordAlert = 21;
+constexpr unsigned char kTlsRecordApplicationData = 23;
+constexpr unsigned char kTlsAlertWarning = 1;
+constexpr unsigned char kTlsAlertCloseNotify = 0;
+
+// In TLS 1.2 the Finished message is the only record sent under the new keys
+// before the handshake completes, so the kernel picks up at sequence 1.
+constexpr uint64_t kKtlsInitialSeq = 1;
+
+union KtlsCryptoInfo {
+  tls_crypto_info info;
+  tls12_crypto_info_aes_gcm_128 aes128;
+  tls12_crypto_info_aes_gcm_256 aes256;
+};
+
+template <class CryptoInfo>
+void setKtlsKey(
+    CryptoInfo* ci,
+    uint16_t cipherType,
+    const unsigned char* key,
+    const unsigned char* salt) {
+  ci->info.version = TLS_1_2_VERSION;
+  ci->info.cipher_type = cipherType;
+  memcpy(ci->key, key, sizeof(ci->key));
+  memcpy(ci->salt, salt, sizeof(ci->salt));
+  uint64_t seq = Endian::big(kKtlsInitialSeq);
+  memcpy(ci->rec_seq, &seq, sizeof(ci->rec_seq));
+  // The explicit nonce goes out with every record; like OpenSSL, start it
+  // at the sequence number.
+  memcpy(ci->iv, &seq, sizeof(ci->iv));
+}
+
+/**
+ * Fills in the kernel's crypto state for both directions of an established
+ * TLS 1.2 AES-GCM connection.  OpenSSL doesn't expose the record keys, so
+ * the key block is derived again from the master secret (RFC 5246, section
+ * 6.3).  Returns false if the connection can't be offloaded.
+ */
+bool getKtlsCryptoInfo(
+    SSL* ssl,
+    bool server,
+    KtlsCryptoInfo* tx,
+    KtlsCryptoInfo* rx,
+    socklen_t* infoLen) {
+  if (SSL_version(ssl) != TLS1_2_VERSION) {
+    return false;
+  }
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+  SSL_SESSION* session = SSL_get_session(ssl);
+  if (!cipher || !session) {
+    return false;
+  }
+  size_t keyLen;
+  uint16_t cipherType;
+  switch (SSL_CIPHER_get_cipher_nid(cipher)) {
+    case NID_aes_128_gcm:
+      keyLen = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+      cipherType = TLS_CIPHER_AES_GCM_128;
+      *infoLen = sizeof(tx->aes128);
+      break;
+    case NID_aes_256_gcm:
+      keyLen = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+      cipherType = TLS_CIPHER_AES_GCM_256;
+      *infoLen = sizeof(tx->aes256);
+      break;
+    default:
+      return false;
+  }
+  const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+  if (!md) {
+    return false;
+  }
+
+  static_assert(
+      TLS_CIPHER_AES_GCM_128_SALT_SIZE == TLS_CIPHER_AES_GCM_256_SALT_SIZE,
+      "AES-GCM salt sizes differ");
+  constexpr size_t saltLen = TLS_CIPHER_AES_GCM_128_SALT_SIZE;
+  static const unsigned char kLabel[] = "key expansion";
+
+  unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+  size_t masterLen = SSL_SESSION_get_master_key(session, master, sizeof(master));
+  unsigned char seed[2 * SSL3_RANDOM_SIZE];
+  SSL_get_server_random(ssl, seed, SSL3_RANDOM_SIZE);
+  SSL_get_client_random(ssl, seed + SSL3_RANDOM_SIZE, SSL3_RANDOM_SIZE);
+
+  // client_write_key, server_write_key, client_write_IV, server_write_IV;
+  // AEAD suites have no MAC keys.
+  unsigned char block[2 * TLS_CIPHER_AES_GCM_256_KEY_SIZE + 2 * saltLen];
+  size_t blockLen = 2 * keyLen + 2 * saltLen;
+  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+  bool ok = pctx && EVP_PKEY_derive_init(pctx) > 0 &&
+      EVP_PKEY_CTX_set_tls1_prf_md(pctx, md) > 0 &&
+      EVP_PKEY_CTX_set1_tls1_prf_secret(pctx, master, int(masterLen)) > 0 &&
+      EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, kLabel, int(sizeof(kLabel) - 1)) >
+          0 &&
+      EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, seed, int(sizeof(seed))) > 0 &&
+      EVP_PKEY_derive(pctx, block, &blockLen) > 0;
+  EVP_PKEY_CTX_free(pctx);
+  OPENSSL_cleanse(master, sizeof(master));
+
+  if (ok) {
+    const unsigned char* clientKey = block;
+    const unsigned char* serverKey = block + keyLen;
+    const unsigned char* clientSalt = block + 2 * keyLen;
+    const unsigned char* serverSalt = clientSalt + saltLen;
+    memset(tx, 0, sizeof(*tx));
+    memset(rx, 0, sizeof(*rx));
+    auto set = [&](KtlsCryptoInfo* ci,
+                   const unsigned char* key,
+                   const unsigned char* salt) {
+      if (cipherType == TLS_CIPHER_AES_GCM_128) {
+        setKtlsKey(&ci->aes128, cipherType, key, salt);
+      } else {
+        setKtlsKey(&ci->aes256, cipherType, key, salt);
+      }
+    };
+    set(tx, server ? serverKey : clientKey, server ? serverSalt : clientSalt);
+    set(rx, server ? clientKey : serverKey, server ? clientSalt : serverSalt);
+  }
+  OPENSSL_cleanse(block, sizeof(block));
+  return ok;
+}
+#endif // FOLLY_SSL_HAVE_KTLS
+
 class AsyncSSLSocketConnector: public AsyncSocket::ConnectCallback,
                                 public AsyncSSLSocket::HandshakeCB {
 
@@ -313,12 +463,20 @@ void AsyncSSLSocket::init() {
 void AsyncSSLSocket::closeNow() {
   // Close the SSL connection.
   if (ssl_ != nullptr && fd_ != -1) {
-    int rc = SSL_shutdown(ssl_);
-    if (rc == 0) {
-      rc = SSL_shutdown(ssl_);
-    }
-    if (rc < 0) {
-      ERR_clear_error();
+    if (ktlsTx_) {
+      // OpenSSL's record state is stale, the alert has to come from the
+      // kernel.  Mark the shutdown as sent so the session stays resumable.
+      sendKtlsCloseNotify();
+      SSL_set_shutdown(ssl_, SSL_SENT_SHUTDOWN);
+    } else {
+      int rc = SSL_shutdown(ssl_);
+      // The peer's close_notify can't be read through OpenSSL any more
+      if (rc == 0 && !ktlsRx_) {
+        rc = SSL_shutdown(ssl_);
+      }
+      if (rc < 0) {
+        ERR_clear_error();
+      }
     }
   }
 
@@ -986,6 +1144,12 @@ bool AsyncSSLSocket::willBlock(int ret,
 
     // The timeout (if set) keeps running here
     return true;
+#ifdef SSL_ERROR_WANT_ASYNC
+  } else if (error == SSL_ERROR_WANT_ASYNC && waitForAsyncJob()) {
+    // OpenSSL paused the handshake while a private key operation runs
+    // elsewhere, asyncJobReady() picks it up again.
+    return true;
+#endif
   } else {
     unsigned long lastError = *errErrorOut = ERR_get_error();
     VLOG(6) << "AsyncSSLSocket(fd=" << fd_ << ", "
@@ -1100,6 +1264,13 @@ AsyncSSLSocket::handleAccept() noexcept {
   // Move into STATE_ESTABLISHED in the normal case that we are in
   // STATE_ACCEPTING.
   sslState_ = STATE_ESTABLISHED;
+#ifdef SSL_MODE_ASYNC
+  // Only the handshake needs async jobs, and each one costs a context switch
+  SSL_clear_mode(ssl_, SSL_MODE_ASYNC);
+#endif
+  if (ktlsEnabled_) {
+    enableKtls();
+  }
 
   VLOG(3) << "AsyncSSLSocket " << this << ": fd " << fd_
           << " successfully accepted; state=" << int(state_)
@@ -1172,6 +1343,13 @@ AsyncSSLSocket::handleConnect() noexcept {
   // Move into STATE_ESTABLISHED in the normal case that we are in
   // STATE_CONNECTING.
   sslState_ = STATE_ESTABLISHED;
+#ifdef SSL_MODE_ASYNC
+  // Only the handshake needs async jobs, and each one costs a context switch
+  SSL_clear_mode(ssl_, SSL_MODE_ASYNC);
+#endif
+  if (ktlsEnabled_) {
+    enableKtls();
+  }
 
   VLOG(3) << "AsyncSSLSocket " << this << ": "
           << "fd " << fd_ << " successfully connected; "
@@ -1310,6 +1488,9 @@ AsyncSSLSocket::performRead(void** buf, size_t* buflen, size_t* offset) {
   if (sslState_ == STATE_UNENCRYPTED) {
     return AsyncSocket::performRead(buf, buflen, offset);
   }
+  if (ktlsRx_) {
+    return performKtlsRead(*buf, *buflen);
+  }
 
   int bytes = 0;
   if (!isBufferMovable_) {
@@ -1372,6 +1553,175 @@ AsyncSSLSocket::performRead(void** buf, size_t* buflen, size_t* offset) {
   }
 }
 
+bool AsyncSSLSocket::waitForAsyncJob() {
+#if defined(SSL_ERROR_WANT_ASYNC) && !defined(_WIN32)
+  OSSL_ASYNC_FD fd;
+  size_t numFds = 0;
+  if (!SSL_get_all_async_fds(ssl_, nullptr, &numFds) || numFds != 1 ||
+      !SSL_get_all_async_fds(ssl_, &fd, &numFds)) {
+    return false;
+  }
+  asyncJobWaiter_.initHandler(eventBase_, fd);
+  if (!asyncJobWaiter_.registerHandler(EventHandler::READ)) {
+    return false;
+  }
+  sslState_ = STATE_ASYNC_PENDING;
+
+  // Unregister for all events while blocked here
+  updateEventRegistration(
+      EventHandler::NONE, EventHandler::READ | EventHandler::WRITE);
+
+  // The timeout (if set) keeps running here
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AsyncSSLSocket::asyncJobReady() noexcept {
+  VLOG(3) << "AsyncSSLSocket::asyncJobReady() this=" << this
+          << ", fd=" << fd_ << ", state=" << int(state_) << ", "
+          << "sslState=" << sslState_ << ", events=" << eventFlags_;
+  DestructorGuard dg(this);
+  asyncJobWaiter_.unregisterHandler();
+  if ((sslState_ == STATE_ERROR || sslState_ == STATE_CLOSED) && ssl_) {
+    // The handshake timed out or was closed meanwhile.  Run the paused job
+    // to its end anyway, or OpenSSL never reclaims it.
+    if (server_) {
+      SSL_accept(ssl_);
+    } else {
+      SSL_connect(ssl_);
+    }
+    ERR_clear_error();
+  }
+  if (server_) {
+    restartSSLAccept();
+    return;
+  }
+  if (sslState_ == STATE_CLOSED) {
+    return;
+  }
+  if (sslState_ == STATE_ERROR) {
+    AsyncSocketException ex(
+        AsyncSocketException::TIMED_OUT, "SSL connect timed out");
+    failHandshake(__func__, ex);
+    return;
+  }
+  sslState_ = STATE_CONNECTING;
+  handleConnect();
+}
+
+void AsyncSSLSocket::enableKtls() {
+#if FOLLY_SSL_HAVE_KTLS
+  KtlsCryptoInfo tx;
+  KtlsCryptoInfo rx;
+  socklen_t infoLen = 0;
+  if (!getKtlsCryptoInfo(ssl_, server_, &tx, &rx, &infoLen)) {
+    VLOG(3) << "AsyncSSLSocket " << this << ": kTLS not supported for "
+            << SSL_get_version(ssl_) << " " << getNegotiatedCipherName();
+    return;
+  }
+  if (setsockopt(fd_, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+    VLOG(3) << "AsyncSSLSocket " << this << ": kTLS not available: "
+            << folly::errnoStr(errno);
+  } else {
+    ktlsTx_ = setsockopt(fd_, SOL_TLS, TLS_TX, &tx, infoLen) == 0;
+    // Whatever OpenSSL already pulled off the socket would be lost to the
+    // kernel, so keep receiving through OpenSSL in that case.
+    if (!SSL_has_pending(ssl_) &&
+        (!preReceivedData_ || preReceivedData_->empty())) {
+      ktlsRx_ = setsockopt(fd_, SOL_TLS, TLS_RX, &rx, infoLen) == 0;
+    }
+    VLOG(3) << "AsyncSSLSocket " << this << ": kTLS tx=" << ktlsTx_
+            << " rx=" << ktlsRx_;
+  }
+  OPENSSL_cleanse(&tx, sizeof(tx));
+  OPENSSL_cleanse(&rx, sizeof(rx));
+
+  if (ktlsTx_ && getZeroCopy()) {
+    setZeroCopy(false);
+  }
+#endif
+}
+
+AsyncSocket::ReadResult AsyncSSLSocket::performKtlsRead(
+    void* buf,
+    size_t buflen) {
+#if FOLLY_SSL_HAVE_KTLS
+  // The kernel hands back one record type at a time, and tells us which
+  // one in a control message.
+  iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = buflen;
+  char control[CMSG_SPACE(sizeof(unsigned char))];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t bytes = recvmsg(fd_, &msg, MSG_DONTWAIT);
+  if (bytes < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return ReadResult(READ_BLOCKING);
+    } else {
+      return ReadResult(READ_ERROR);
+    }
+  }
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (bytes > 0 && cmsg && cmsg->cmsg_level == SOL_TLS &&
+      cmsg->cmsg_type == TLS_GET_RECORD_TYPE) {
+    auto type = *reinterpret_cast<unsigned char*>(CMSG_DATA(cmsg));
+    if (type != kTlsRecordApplicationData) {
+      auto data = static_cast<const unsigned char*>(buf);
+      if (type == kTlsRecordAlert && bytes >= 2 &&
+          data[1] == kTlsAlertCloseNotify) {
+        return ReadResult(0);
+      }
+      // Renegotiation or a fatal alert; neither can be handled any more.
+      return ReadResult(
+          READ_ERROR,
+          std::make_unique<AsyncSocketException>(
+              AsyncSocketException::SSL_ERROR,
+              folly::sformat("unexpected TLS record type {}", type)));
+    }
+  }
+  appBytesReceived_ += bytes;
+  return ReadResult(bytes);
+#else
+  (void)buf;
+  (void)buflen;
+  return ReadResult(READ_ERROR);
+#endif
+}
+
+void AsyncSSLSocket::sendKtlsCloseNotify() {
+#if FOLLY_SSL_HAVE_KTLS
+  unsigned char alert[] = {kTlsAlertWarning, kTlsAlertCloseNotify};
+  iovec iov;
+  iov.iov_base = alert;
+  iov.iov_len = sizeof(alert);
+  char control[CMSG_SPACE(sizeof(unsigned char))];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+  *reinterpret_cast<unsigned char*>(CMSG_DATA(cmsg)) = kTlsRecordAlert;
+  // Best effort, like SSL_shutdown() on a non-blocking socket
+  if (sendmsg(fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+    VLOG(4) << "AsyncSSLSocket " << this << ": kTLS close_notify failed: "
+            << folly::errnoStr(errno);
+  }
+#endif
+}
+
 void AsyncSSLSocket::handleWrite() noexcept {
   VLOG(5) << "AsyncSSLSocket::handleWrite() this=" << this << ", fd=" << fd_
           << ", state=" << int(state_) << ", "
@@ -1434,6 +1784,13 @@ AsyncSocket::WriteResult AsyncSSLSocket::performWrite(
     return AsyncSocket::performWrite(
       vec, count, flags, countWritten, partialWritten);
   }
+  if (ktlsTx_) {
+    // The kernel frames and encrypts the data; its sendmsg() rejects MSG_EOR
+    // before Linux 6.5.
+    return AsyncSocket::performWrite(
+        vec, count, unSet(flags, WriteFlags::EOR), countWritten,
+        partialWritten);
+  }
   if (sslState_ != STATE_ESTABLISHED) {
     LOG(ERROR) << "AsyncSSLSocket(fd=" << fd_ << ", state=" << int(state_)
                << ", sslState=" << sslState_
@@ -532,7 +532,8 @@ class AsyncSSLSocket : public virtual AsyncSocket {
   }
 
   bool isDetachable() const override {
-    return AsyncSocket::isDetachable() && !handshakeTimeout_.isScheduled();
+    return AsyncSocket::isDetachable() && !handshakeTimeout_.isScheduled() &&
+        !asyncJobWaiter_.isHandlerRegistered();
   }
 
   virtual void attachTimeoutManager(TimeoutManager* manager) {
@@ -688,6 +689,32 @@ class AsyncSSLSocket : public virtual AsyncSocket {
    */
   void setBufferMovableEnabled(bool enabled);
 
+  /**
+   * Hands the TLS record layer to the kernel (Linux kTLS) once the handshake
+   * completes.  Reads and writes then bypass OpenSSL, and writes use
+   * AsyncSocket's plain path, including sendFile().
+   *
+   * Only TLS 1.2 connections with an AES-GCM cipher suite can be offloaded.
+   * If the cipher or the kernel isn't supported, the socket keeps using
+   * OpenSSL.  Use isKtlsTxEnabled() and isKtlsRxEnabled() to find out what
+   * happened.  This must be called before the handshake starts.
+   *
+   * The kernel rejects MSG_ZEROCOPY on TLS sockets, so zero-copy writes are
+   * turned off when transmit is offloaded.  getRawBytesWritten() and
+   * getRawBytesReceived() only count bytes that went through OpenSSL.
+   */
+  void setKtlsEnabled(bool enabled) {
+    ktlsEnabled_ = enabled;
+  }
+
+  bool isKtlsTxEnabled() const {
+    return ktlsTx_;
+  }
+
+  bool isKtlsRxEnabled() const {
+    return ktlsRx_;
+  }
+
   /**
    * Returns the peer certificate, or nullptr if no peer certificate received.
    */
@@ -801,6 +828,16 @@ class AsyncSSLSocket : public virtual AsyncSocket {
 
   WriteResult interpretSSLError(int rc, int error);
   ReadResult performRead(void** buf, size_t* buflen, size_t* offset) override;
+  // Encrypted data has to go through SSL_read(), or performKtlsRead() to
+  // pick up the record type
+  bool supportsVectoredReads() const override {
+    return sslState_ == STATE_UNENCRYPTED;
+  }
+  // ... and encrypted data written with SSL_write(), unless the kernel does it
+  bool supportsSendFile() const override {
+    return (sslState_ == STATE_UNENCRYPTED || ktlsTx_) &&
+        AsyncSocket::supportsSendFile();
+  }
   WriteResult performWrite(
       const iovec* vec,
       uint32_t count,
@@ -857,6 +894,37 @@ class AsyncSSLSocket : public virtual AsyncSocket {
 
   void startSSLConnect();
 
+  /**
+   * Moves the record layer into the kernel after a successful handshake,
+   * if setKtlsEnabled() asked for it.  Sets ktlsTx_ and ktlsRx_ on
+   * success; on failure the socket carries on with OpenSSL.
+   */
+  void enableKtls();
+  ReadResult performKtlsRead(void* buf, size_t buflen);
+  void sendKtlsCloseNotify();
+
+  /**
+   * Waits for the OpenSSL async job behind SSL_ERROR_WANT_ASYNC, such as a
+   * private key operation offloaded with ssl::offloadPrivateKeyOperations(),
+   * in STATE_ASYNC_PENDING.  Returns false if the job has nothing to wait
+   * on.
+   */
+  bool waitForAsyncJob();
+  void asyncJobReady() noexcept;
+
+  class AsyncJobWaiter : public EventHandler {
+   public:
+    explicit AsyncJobWaiter(AsyncSSLSocket* sslSocket)
+        : sslSocket_(sslSocket) {}
+
+    void handlerReady(uint16_t /* events */) noexcept override {
+      sslSocket_->asyncJobReady();
+    }
+
+   private:
+    AsyncSSLSocket* sslSocket_;
+  };
+
   static void sslInfoCallback(const SSL *ssl, int type, int val);
 
   // Whether the current write to the socket should use MSG_MORE.
@@ -870,6 +938,10 @@ class AsyncSSLSocket : public virtual AsyncSocket {
   bool handshakeComplete_{false};
   bool renegotiateAttempted_{false};
   SSLStateEnum sslState_{STATE_UNINIT};
+  // Kernel TLS offload: requested, and in effect for each direction
+  bool ktlsEnabled_{false};
+  bool ktlsTx_{false};
+  bool ktlsRx_{false};
   std::shared_ptr<folly::SSLContext> ctx_;
   // Callback for SSL_accept() or SSL_connect()
   HandshakeCB* handshakeCallback_{nullptr};
@@ -877,6 +949,7 @@ class AsyncSSLSocket : public virtual AsyncSocket {
   SSL_SESSION *sslSession_{nullptr};
   Timeout handshakeTimeout_;
   Timeout connectionTimeout_;
+  AsyncJobWaiter asyncJobWaiter_{this};
 
   // The app byte num that we are tracking for the MSG_EOR
   // Only one app EOR byte can be tracked.
@@ -22,6 +22,7 @@
 
 #include <folly/FileUtil.h>
 #include <folly/Portability.h>
+#include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/detail/SocketFastOpen.h>
@@ -35,6 +36,18 @@
 #include <string.h>
 #include <sys/types.h>
 
+#if __linux__
+#include <linux/filter.h>
+
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+#endif
+
 namespace fsp = folly::portability::sockets;
 
 namespace folly {
@@ -110,6 +123,17 @@ void AsyncServerSocket::RemoteAcceptor::messageAvailable(
       callback_->connectionAccepted(msg.fd, msg.address);
       break;
     }
+    case MessageType::MSG_NEW_CONNS:
+    {
+      if (connectionEventCallback_) {
+        for (const auto& connection : msg.connections) {
+          connectionEventCallback_->onConnectionDequeuedByAcceptorCallback(
+              connection.fd, connection.address);
+        }
+      }
+      callback_->connectionsAccepted(msg.connections);
+      break;
+    }
     case MessageType::MSG_ERROR:
     {
       std::runtime_error ex(msg.msg);
@@ -357,6 +381,65 @@ bool AsyncServerSocket::setZeroCopy(bool enable) {
   return false;
 }
 
+void AsyncServerSocket::setIncomingCpu(int cpu) {
+  incomingCpu_ = cpu;
+
+#if __linux__
+  for (auto& handler : sockets_) {
+    if (handler.socket_ < 0) {
+      continue;
+    }
+
+    if (setsockopt(handler.socket_, SOL_SOCKET, SO_INCOMING_CPU, &cpu,
+                   sizeof(cpu)) != 0) {
+      LOG(WARNING) << "failed to set SO_INCOMING_CPU on async server socket: "
+                   << folly::errnoStr(errno);
+    }
+  }
+#endif
+}
+
+void AsyncServerSocket::setReusePortCpuSteering(
+    const std::vector<int>& indexOfCpu) {
+#if __linux__
+  // A = cpu; then for each mapped cpu: if (A == cpu) return index.
+  // Returning a position the group doesn't have falls back to the hash.
+  std::vector<sock_filter> code;
+  code.push_back(
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, uint32_t(SKF_AD_OFF + SKF_AD_CPU)));
+  for (size_t cpu = 0; cpu < indexOfCpu.size(); ++cpu) {
+    if (indexOfCpu[cpu] < 0) {
+      continue;
+    }
+    code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, uint32_t(cpu), 0, 1));
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, uint32_t(indexOfCpu[cpu])));
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, uint32_t(-1)));
+  if (code.size() > BPF_MAXINSNS) {
+    throw std::invalid_argument("too many cpus to steer");
+  }
+
+  sock_fprog prog;
+  prog.len = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+  for (auto& handler : sockets_) {
+    if (handler.socket_ < 0) {
+      continue;
+    }
+
+    if (setsockopt(handler.socket_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &prog, sizeof(prog)) != 0) {
+      folly::throwSystemError(errno,
+                              "failed to set SO_ATTACH_REUSEPORT_CBPF on "
+                              "async server socket");
+    }
+  }
+#else
+  (void)indexOfCpu;
+  throw std::runtime_error("reuseport cpu steering is only supported on Linux");
+#endif
+}
+
 void AsyncServerSocket::bind(const SocketAddress& address) {
   if (eventBase_) {
     eventBase_->dcheckIsInEventBaseThread();
@@ -767,6 +850,16 @@ void AsyncServerSocket::setupSocket(int fd, int family) {
 #endif
   }
 
+#if __linux__
+  if (incomingCpu_ >= 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &incomingCpu_,
+                 sizeof(incomingCpu_)) != 0) {
+    // This isn't a fatal error; just log an error message and continue
+    LOG(WARNING) << "failed to set SO_INCOMING_CPU on async server socket: "
+                 << folly::errnoStr(errno);
+  }
+#endif
+
   // Set keepalive as desired
   if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE,
                  (keepAliveEnabled_) ? &one : &zero, sizeof(int)) != 0) {
@@ -811,6 +904,10 @@ void AsyncServerSocket::handlerReady(uint16_t /* events */,
                                      sa_family_t addressFamily) noexcept {
   assert(!callbacks_.empty());
   DestructorGuard dg(this);
+  // Hand over what is left of the batch when we stop accepting
+  SCOPE_EXIT {
+    dispatchBatch();
+  };
 
   // Only accept up to maxAcceptAtOnce_ connections at a time,
   // to avoid starving other I/O handlers using this EventBase.
@@ -902,7 +999,14 @@ void AsyncServerSocket::handlerReady(uint16_t /* events */,
 #endif
 
     // Inform the callback about the new connection
-    dispatchSocket(clientSocket, std::move(address));
+    if (acceptBatchSize_ > 1) {
+      batch_.push_back({clientSocket, std::move(address)});
+      if (batch_.size() >= acceptBatchSize_) {
+        dispatchBatch();
+      }
+    } else {
+      dispatchSocket(clientSocket, std::move(address));
+    }
 
     // If we aren't accepting any more, break out of the loop
     if (!accepting_ || callbacks_.empty()) {
@@ -975,6 +1079,80 @@ void AsyncServerSocket::dispatchSocket(int socket,
   }
 }
 
+void AsyncServerSocket::dispatchBatch() noexcept {
+  if (batch_.empty()) {
+    return;
+  }
+  if (callbacks_.empty()) {
+    // The last callback was removed while the batch was being accepted
+    dropBatch(batch_);
+    batch_.clear();
+    return;
+  }
+
+  uint32_t startingIndex = callbackIndex_;
+
+  // Short circuit if the callback is in the primary EventBase thread; the
+  // batch keeps its storage for the next connections
+  CallbackInfo *info = nextCallback();
+  if (info->eventBase == nullptr) {
+    info->callback->connectionsAccepted(batch_);
+    batch_.clear();
+    return;
+  }
+
+  QueueMessage msg;
+  msg.type = MessageType::MSG_NEW_CONNS;
+  msg.fd = -1;
+  msg.connections = std::move(batch_);
+  batch_.clear();
+  batch_.reserve(std::min(acceptBatchSize_, maxAcceptAtOnce_));
+
+  while (true) {
+    // Copy the connections for the ConnectionEventCallback: the queue may
+    // run them before tryPutMessageNoThrow() returns
+    std::vector<AcceptedConnection> enqueued;
+    if (connectionEventCallback_) {
+      enqueued = msg.connections;
+    }
+    if (info->consumer->getQueue()->tryPutMessageNoThrow(std::move(msg))) {
+      for (const auto& connection : enqueued) {
+        connectionEventCallback_->onConnectionEnqueuedForAcceptorCallback(
+            connection.fd, connection.address);
+      }
+      return;
+    }
+
+    ++numDroppedConnections_;
+    if (acceptRateAdjustSpeed_ > 0) {
+      // aggressively decrease accept rate when in trouble
+      static const double kAcceptRateDecreaseSpeed = 0.1;
+      acceptRate_ *= 1 - kAcceptRateDecreaseSpeed;
+    }
+
+    if (callbackIndex_ == startingIndex) {
+      // Every queue is full, see dispatchSocket()
+      LOG_EVERY_N(ERROR, 100) << "failed to dispatch newly accepted sockets:"
+                              << " all accept callback queues are full";
+      dropBatch(msg.connections);
+      return;
+    }
+
+    info = nextCallback();
+  }
+}
+
+void AsyncServerSocket::dropBatch(
+    std::vector<AcceptedConnection>& connections) noexcept {
+  for (const auto& connection : connections) {
+    closeNoInt(connection.fd);
+    if (connectionEventCallback_) {
+      connectionEventCallback_->onConnectionDropped(
+          connection.fd, connection.address);
+    }
+  }
+}
+
 void AsyncServerSocket::dispatchError(const char *msgstr, int errnoValue) {
   uint32_t startingIndex = callbackIndex_;
   CallbackInfo *info = nextCallback();
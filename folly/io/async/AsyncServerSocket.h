@@ -28,6 +28,7 @@
 
 #include <limits.h>
 #include <stddef.h>
+#include <algorithm>
 #include <exception>
 #include <memory>
 #include <vector>
@@ -133,6 +134,15 @@ class AsyncServerSocket : public DelayedDestruction
     virtual void onBackoffError() noexcept = 0;
   };
 
+  /**
+   * A connection accepted by the socket, as handed to
+   * AcceptCallback::connectionsAccepted().
+   */
+  struct AcceptedConnection {
+    int fd;
+    SocketAddress address;
+  };
+
   class AcceptCallback {
    public:
     virtual ~AcceptCallback() = default;
@@ -169,6 +179,22 @@ class AsyncServerSocket : public DelayedDestruction
      */
     virtual void acceptError(const std::exception& ex) noexcept = 0;
 
+    /**
+     * connectionsAccepted() is called instead of connectionAccepted() with
+     * connections accepted together, when the AsyncServerSocket batches
+     * them (see setAcceptBatchSize()).  The AcceptCallback assumes ownership
+     * of the sockets.
+     *
+     * The default implementation calls connectionAccepted() for each of
+     * them; override it to set up the connections of a burst in one go.
+     */
+    virtual void connectionsAccepted(
+        std::vector<AcceptedConnection>& connections) noexcept {
+      for (auto& connection : connections) {
+        connectionAccepted(connection.fd, connection.address);
+      }
+    }
+
     /**
      * acceptStarted() will be called in the callback's EventBase thread
      * after this callback has been added to the AsyncServerSocket.
@@ -603,6 +629,26 @@ class AsyncServerSocket : public DelayedDestruction
     return numMsgs;
   }
 
+  /**
+   * Set the largest number of connections handed to an AcceptCallback at
+   * once.
+   *
+   * By default (1), every accepted connection goes to the next callback,
+   * round robin.  With a larger size, connections accepted in the same
+   * handler invocation (up to maxAcceptAtOnce) are grouped, and each group
+   * goes to the next callback through connectionsAccepted(): a callback in
+   * another EventBase then gets one notification per group rather than per
+   * connection, which keeps bursts of connections cheap, at the expense of
+   * spreading them less evenly.
+   */
+  void setAcceptBatchSize(uint32_t size) {
+    acceptBatchSize_ = std::max<uint32_t>(size, 1);
+  }
+
+  uint32_t getAcceptBatchSize() const {
+    return acceptBatchSize_;
+  }
+
   /**
    * Set whether or not SO_KEEPALIVE should be enabled on the server socket
    * (and thus on all subsequently-accepted connections). By default, keepalive
@@ -666,6 +712,35 @@ class AsyncServerSocket : public DelayedDestruction
     return reusePortEnabled_;
   }
 
+  /**
+   * Set the cpu whose connections this socket prefers (SO_INCOMING_CPU,
+   * Linux only).  When several sockets share a port with SO_REUSEPORT,
+   * recent kernels (6.1+) hand a connection received on a cpu to the
+   * socket set to that cpu, if there is one.  -1, the default, leaves the
+   * option alone.
+   */
+  void setIncomingCpu(int cpu);
+
+  int getIncomingCpu() const {
+    return incomingCpu_;
+  }
+
+  /**
+   * Steer the connections of this socket's SO_REUSEPORT group by the cpu
+   * that received them (SO_ATTACH_REUSEPORT_CBPF, Linux only): a connection
+   * received on cpu c goes to the socket at position indexOfCpu[c] in the
+   * group, that is the order the sockets were bound in.  Connections on
+   * cpus past the end of indexOfCpu, mapped to -1, or mapped to a position
+   * the group doesn't have, go to the socket chosen by the usual hash.
+   *
+   * The steering applies to the whole group, so it only needs to be set
+   * through one of its sockets, after bind().  Note that when a socket of
+   * the group is closed, the last one takes its position.
+   *
+   * Throws if the kernel refuses the program.
+   */
+  void setReusePortCpuSteering(const std::vector<int>& indexOfCpu);
+
   /**
    * Set whether or not the socket should close during exec() (FD_CLOEXEC). By
    * default, this is enabled
@@ -729,7 +804,8 @@ class AsyncServerSocket : public DelayedDestruction
  private:
   enum class MessageType {
     MSG_NEW_CONN = 0,
-    MSG_ERROR = 1
+    MSG_ERROR = 1,
+    MSG_NEW_CONNS = 2
   };
 
   struct QueueMessage {
@@ -738,6 +814,7 @@ class AsyncServerSocket : public DelayedDestruction
     int err;
     SocketAddress address;
     std::string msg;
+    std::vector<AcceptedConnection> connections; // for MSG_NEW_CONNS
   };
 
   /**
@@ -800,6 +877,8 @@ class AsyncServerSocket : public DelayedDestruction
   void setupSocket(int fd, int family);
   void bindSocket(int fd, const SocketAddress& address, bool isExistingSocket);
   void dispatchSocket(int socket, SocketAddress&& address);
+  void dispatchBatch() noexcept;
+  void dropBatch(std::vector<AcceptedConnection>& connections) noexcept;
   void dispatchError(const char *msg, int errnoValue);
   void enterBackoff();
   void backoffTimeoutExpired();
@@ -869,10 +948,14 @@ class AsyncServerSocket : public DelayedDestruction
   std::chrono::time_point<std::chrono::steady_clock> lastAccepTimestamp_;
   uint64_t numDroppedConnections_;
   uint32_t callbackIndex_;
+  uint32_t acceptBatchSize_{1};
+  // Connections accepted but not dispatched yet, if acceptBatchSize_ > 1
+  std::vector<AcceptedConnection> batch_;
   BackoffTimeout *backoffTimeout_;
   std::vector<CallbackInfo> callbacks_;
   bool keepAliveEnabled_;
   bool reusePortEnabled_{false};
+  int incomingCpu_{-1};
   bool closeOnExec_;
   bool tfo_{false};
   bool noTransparentTls_{false};
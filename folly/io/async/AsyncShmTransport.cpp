@@ -0,0 +1,629 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncShmTransport.h>
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <glog/logging.h>
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncSocketException.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/system/MemoryMapping.h>
+
+#if __linux__ && !__ANDROID__
+#define FOLLY_HAVE_EVENTFD
+#include <folly/io/async/EventFDWrapper.h>
+#endif
+
+namespace folly {
+
+namespace {
+
+// Bits of each end's flags in the control block
+enum : uint32_t {
+  kWantRead = 1 << 0, // waiting for data in the ring it reads
+  kWantWrite = 1 << 1, // waiting for space in the ring it writes
+  kShutdown = 1 << 2, // won't write any more
+  kClosed = 1 << 3, // won't read any more either
+};
+
+struct Control {
+  struct Side {
+    FOLLY_ALIGN_TO_AVOID_FALSE_SHARING std::atomic<uint32_t> flags{0};
+  };
+  Side sides[2];
+};
+
+SPSCRingBuffer<char> makeRing(size_t capacity) {
+  return SPSCRingBuffer<char>::create(
+      MemoryMapping(
+          MemoryMapping::kAnonymous,
+          off_t(SPSCRingBuffer<char>::mappingSize(capacity)),
+          MemoryMapping::Options().setWritable(true).setShared(true)),
+      capacity);
+}
+
+} // namespace
+
+/**
+ * The rings and control block both ends share.  In one process both ends
+ * use the same Channel; after fork() each process uses its copy, which
+ * refers to the same shared memory.
+ */
+class AsyncShmTransport::Channel {
+ public:
+  explicit Channel(size_t capacity)
+      : controlMapping_(
+            MemoryMapping::kAnonymous,
+            off_t(sizeof(Control)),
+            MemoryMapping::Options().setWritable(true).setShared(true)),
+        control_(new (controlMapping_.writableRange().data()) Control()),
+        rings_{{makeRing(capacity), makeRing(capacity)}} {}
+
+  SPSCRingBuffer<char>& ring(int side) {
+    return rings_[size_t(side)];
+  }
+
+  std::atomic<uint32_t>& flags(int side) {
+    return control_->sides[side].flags;
+  }
+
+ private:
+  MemoryMapping controlMapping_;
+  Control* control_;
+  std::array<SPSCRingBuffer<char>, 2> rings_; // rings_[i] is written by i
+};
+
+std::pair<AsyncShmTransport::Endpoint, AsyncShmTransport::Endpoint>
+AsyncShmTransport::makeEndpoints(size_t capacity) {
+#ifdef FOLLY_HAVE_EVENTFD
+  auto makeDoorbell = [] {
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    checkUnixError(fd, "AsyncShmTransport: eventfd() failed");
+    return File(fd, /* ownsFd */ true);
+  };
+  auto channel = std::make_shared<Channel>(capacity);
+  std::pair<Endpoint, Endpoint> ends;
+  ends.first.channel = channel;
+  ends.first.side = 0;
+  ends.first.doorbell = makeDoorbell();
+  ends.second.channel = std::move(channel);
+  ends.second.side = 1;
+  ends.second.doorbell = makeDoorbell();
+  ends.first.peerDoorbell = ends.second.doorbell.dup();
+  ends.second.peerDoorbell = ends.first.doorbell.dup();
+  return ends;
+#else
+  (void)capacity;
+  throw std::runtime_error("AsyncShmTransport needs eventfd()");
+#endif
+}
+
+AsyncShmTransport::AsyncShmTransport(EventBase* evb, Endpoint endpoint)
+    : eventBase_(evb),
+      endpoint_(std::move(endpoint)),
+      readRing_(&endpoint_.channel->ring(1 - endpoint_.side)),
+      writeRing_(&endpoint_.channel->ring(endpoint_.side)),
+      flags_(&endpoint_.channel->flags(endpoint_.side)),
+      peerFlags_(&endpoint_.channel->flags(1 - endpoint_.side)),
+      handler_(this, evb, endpoint_.doorbell.fd()),
+      writeTimeout_(this, evb) {
+  VLOG(5) << "new AsyncShmTransport(" << this << ", evb=" << evb
+          << ", side=" << endpoint_.side << ")";
+}
+
+AsyncShmTransport::~AsyncShmTransport() {
+  VLOG(7) << "actual destruction of AsyncShmTransport(this=" << this << ")";
+}
+
+void AsyncShmTransport::destroy() {
+  closeNow();
+  DelayedDestruction::destroy();
+}
+
+void AsyncShmTransport::DoorbellHandler::handlerReady(
+    uint16_t /* events */) noexcept {
+  transport_->handleDoorbell();
+}
+
+void AsyncShmTransport::WriteTimeout::timeoutExpired() noexcept {
+  transport_->handleWriteTimeout();
+}
+
+// Waking up the peer.  A side that is about to wait sets a flag in
+// wantEvent() and then checks the ring again; a side that made data or
+// space available checks the flag in notifyPeer().  The fences order each
+// side's flag access after its ring access, so at least one of them sees
+// the other's.
+
+void AsyncShmTransport::wantEvent(uint32_t event) {
+  flags_->fetch_or(event, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void AsyncShmTransport::notifyPeer(uint32_t events) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if ((peerFlags_->load(std::memory_order_relaxed) & events) != 0 &&
+      (peerFlags_->fetch_and(~events, std::memory_order_relaxed) & events) !=
+          0) {
+    ring(endpoint_.peerDoorbell.fd());
+  }
+}
+
+void AsyncShmTransport::ring(int fd) {
+  uint64_t one = 1;
+  // Only fails if the counter would overflow, when it is readable anyway
+  writeNoInt(fd, &one, sizeof(one));
+}
+
+uint32_t AsyncShmTransport::peerFlags() const {
+  return peerFlags_->load(std::memory_order_acquire);
+}
+
+void AsyncShmTransport::updateRegistration() {
+  bool want = eventBase_ != nullptr && !closed_ &&
+      (readCallback_ != nullptr || !writes_.empty());
+  if (want && !handler_.isHandlerRegistered()) {
+    handler_.registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  } else if (!want && handler_.isHandlerRegistered()) {
+    handler_.unregisterHandler();
+  }
+}
+
+void AsyncShmTransport::handleDoorbell() noexcept {
+  uint64_t count;
+  readNoInt(endpoint_.doorbell.fd(), &count, sizeof(count));
+
+  DestructorGuard dg(this);
+  handleWrite();
+  handleRead();
+}
+
+// Reads
+
+void AsyncShmTransport::setReadCB(ReadCallback* callback) {
+  if (callback == readCallback_) {
+    return;
+  }
+  if (callback != nullptr && (closed_ || readShutdown_)) {
+    callback->readErr(AsyncSocketException(
+        AsyncSocketException::NOT_OPEN,
+        "setReadCB() called after EOF or close"));
+    return;
+  }
+  readCallback_ = callback;
+  updateRegistration();
+  if (readCallback_ != nullptr && eventBase_ != nullptr) {
+    // Data written while nobody was reading didn't ring
+    ring(endpoint_.doorbell.fd());
+  }
+}
+
+void AsyncShmTransport::handleRead() noexcept {
+  DestructorGuard dg(this);
+  bool waiting = false;
+  for (uint16_t reads = 0; readCallback_ != nullptr;) {
+    auto span = readRing_->readableSpan();
+    if (span.empty()) {
+      if ((peerFlags() & kShutdown) != 0) {
+        // Everything written before the shutdown is visible now
+        if (readRing_->readableSpan(1).empty()) {
+          invokeReadEOF();
+          return;
+        }
+        continue;
+      }
+      if (waiting) {
+        break;
+      }
+      wantEvent(kWantRead);
+      waiting = true;
+      continue;
+    }
+    if (reads++ == maxReadsPerEvent_) {
+      // Let other handlers run, and come back in the next loop iteration
+      ring(endpoint_.doorbell.fd());
+      break;
+    }
+
+    auto callback = readCallback_;
+    if (callback->isBufferMovable()) {
+      size_t n = std::min(span.size(), callback->maxBufferSize());
+      auto buf = IOBuf::copyBuffer(span.begin(), n);
+      readRing_->commitRead(n);
+      bytesReceived_ += n;
+      notifyPeer(kWantWrite);
+      callback->readBufferAvailable(std::move(buf));
+    } else {
+      void* buf = nullptr;
+      size_t len = 0;
+      callback->getReadBuffer(&buf, &len);
+      if (buf == nullptr || len == 0) {
+        failRead(AsyncSocketException(
+            AsyncSocketException::BAD_ARGS,
+            "ReadCallback::getReadBuffer() returned empty buffer"));
+        return;
+      }
+      size_t n = std::min(span.size(), len);
+      std::memcpy(buf, span.begin(), n);
+      readRing_->commitRead(n);
+      bytesReceived_ += n;
+      notifyPeer(kWantWrite);
+      callback->readDataAvailable(n);
+    }
+  }
+  updateRegistration();
+}
+
+void AsyncShmTransport::invokeReadEOF() {
+  DestructorGuard dg(this);
+  readShutdown_ = true;
+  auto callback = readCallback_;
+  readCallback_ = nullptr;
+  if (callback != nullptr) {
+    callback->readEOF();
+  }
+  if (writeShutdown_ && !closed_) {
+    closeNow();
+  }
+  updateRegistration();
+}
+
+void AsyncShmTransport::failRead(const AsyncSocketException& ex) {
+  DestructorGuard dg(this);
+  error_ = true;
+  auto callback = readCallback_;
+  readCallback_ = nullptr;
+  callback->readErr(ex);
+  closeNow();
+}
+
+// Writes
+
+bool AsyncShmTransport::writeFailed(WriteCallback* callback) {
+  if (closed_ || writeShutdown_ || shutdownWritePending_ || closeOnEmpty_) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          AsyncSocketException(
+              AsyncSocketException::NOT_OPEN,
+              "write() called after shutdown or close"));
+    }
+    return true;
+  }
+  if ((peerFlags() & kClosed) != 0) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          AsyncSocketException(
+              AsyncSocketException::END_OF_FILE, "peer closed"));
+    }
+    return true;
+  }
+  return false;
+}
+
+size_t AsyncShmTransport::copyToRing(const void* data, size_t len) {
+  size_t n = writeRing_->write(static_cast<const char*>(data), len);
+  bytesWritten_ += n;
+  return n;
+}
+
+size_t AsyncShmTransport::copyChainToRing(const IOBuf& buf) {
+  size_t written = 0;
+  for (auto range : buf) {
+    size_t n = copyToRing(range.data(), range.size());
+    written += n;
+    if (n < range.size()) {
+      break;
+    }
+  }
+  return written;
+}
+
+void AsyncShmTransport::write(
+    WriteCallback* callback,
+    const void* buf,
+    size_t bytes,
+    WriteFlags flags) {
+  iovec op;
+  op.iov_base = const_cast<void*>(buf);
+  op.iov_len = bytes;
+  writev(callback, &op, 1, flags);
+}
+
+void AsyncShmTransport::writev(
+    WriteCallback* callback,
+    const iovec* vec,
+    size_t count,
+    WriteFlags /* flags */) {
+  if (writeFailed(callback)) {
+    return;
+  }
+  size_t written = 0;
+  size_t i = 0;
+  size_t offset = 0; // into vec[i]
+  if (writes_.empty()) {
+    for (; i < count; ++i) {
+      offset = copyToRing(vec[i].iov_base, vec[i].iov_len);
+      written += offset;
+      if (offset < vec[i].iov_len) {
+        break;
+      }
+      offset = 0;
+    }
+    if (written != 0) {
+      notifyPeer(kWantRead);
+    }
+  }
+  if (i == count) {
+    if (callback != nullptr) {
+      callback->writeSuccess();
+    }
+    return;
+  }
+
+  size_t remaining = 0;
+  for (size_t j = i; j < count; ++j) {
+    remaining += vec[j].iov_len;
+  }
+  remaining -= offset;
+  auto rest = IOBuf::create(remaining);
+  for (size_t j = i; j < count; ++j, offset = 0) {
+    std::memcpy(
+        rest->writableTail(),
+        static_cast<const char*>(vec[j].iov_base) + offset,
+        vec[j].iov_len - offset);
+    rest->append(vec[j].iov_len - offset);
+  }
+  queueWrite(callback, std::move(rest), written);
+}
+
+void AsyncShmTransport::writeChain(
+    WriteCallback* callback,
+    std::unique_ptr<IOBuf>&& buf,
+    WriteFlags /* flags */) {
+  if (writeFailed(callback)) {
+    return;
+  }
+  size_t written = 0;
+  if (writes_.empty()) {
+    written = copyChainToRing(*buf);
+    if (written != 0) {
+      notifyPeer(kWantRead);
+    }
+  }
+  if (written == buf->computeChainDataLength()) {
+    if (callback != nullptr) {
+      callback->writeSuccess();
+    }
+    return;
+  }
+  IOBufQueue rest;
+  rest.append(std::move(buf));
+  rest.trimStart(written);
+  queueWrite(callback, rest.move(), written);
+}
+
+void AsyncShmTransport::queueWrite(
+    WriteCallback* callback,
+    std::unique_ptr<IOBuf> rest,
+    size_t bytesWritten) {
+  writes_.emplace_back();
+  writes_.back().data.append(std::move(rest));
+  writes_.back().callback = callback;
+  writes_.back().bytesWritten = bytesWritten;
+  if (writes_.size() == 1) {
+    scheduleWriteTimeout();
+    // The ring was full a moment ago; it may not be anymore
+    handleWrite();
+  }
+}
+
+void AsyncShmTransport::handleWrite() noexcept {
+  DestructorGuard dg(this);
+  bool waiting = false;
+  while (!writes_.empty()) {
+    if ((peerFlags() & kClosed) != 0) {
+      failAllWrites(AsyncSocketException(
+          AsyncSocketException::END_OF_FILE, "peer closed"));
+      break;
+    }
+    auto& front = writes_.front();
+    size_t n = copyChainToRing(*front.data.front());
+    if (n != 0) {
+      notifyPeer(kWantRead);
+      front.data.trimStart(n);
+      front.bytesWritten += n;
+      scheduleWriteTimeout();
+    }
+    if (front.data.empty()) {
+      auto callback = front.callback;
+      writes_.pop_front();
+      if (callback != nullptr) {
+        callback->writeSuccess();
+      }
+      continue;
+    }
+    if (waiting) {
+      break;
+    }
+    wantEvent(kWantWrite);
+    waiting = true;
+  }
+
+  if (writes_.empty()) {
+    writeTimeout_.cancelTimeout();
+    if (shutdownWritePending_) {
+      shutdownWriteImpl();
+    }
+    if (closeOnEmpty_) {
+      closeNow();
+    }
+  }
+  updateRegistration();
+}
+
+void AsyncShmTransport::failAllWrites(const AsyncSocketException& ex) {
+  DestructorGuard dg(this);
+  writeTimeout_.cancelTimeout();
+  while (!writes_.empty()) {
+    auto callback = writes_.front().callback;
+    auto bytesWritten = writes_.front().bytesWritten;
+    writes_.pop_front();
+    if (callback != nullptr) {
+      callback->writeErr(bytesWritten, ex);
+    }
+  }
+}
+
+void AsyncShmTransport::scheduleWriteTimeout() {
+  if (sendTimeout_ > 0 && eventBase_ != nullptr) {
+    writeTimeout_.scheduleTimeout(sendTimeout_);
+  }
+}
+
+void AsyncShmTransport::handleWriteTimeout() noexcept {
+  DestructorGuard dg(this);
+  error_ = true;
+  failAllWrites(AsyncSocketException(
+      AsyncSocketException::TIMED_OUT, "write timed out"));
+  closeNow();
+}
+
+void AsyncShmTransport::setSendTimeout(uint32_t milliseconds) {
+  sendTimeout_ = milliseconds;
+  if (writes_.empty()) {
+    return;
+  }
+  if (sendTimeout_ > 0) {
+    scheduleWriteTimeout();
+  } else {
+    writeTimeout_.cancelTimeout();
+  }
+}
+
+// Shutting down
+
+void AsyncShmTransport::close() {
+  if (writes_.empty()) {
+    closeNow();
+    return;
+  }
+  closeOnEmpty_ = true;
+  if (readCallback_ != nullptr) {
+    invokeReadEOF();
+  }
+}
+
+void AsyncShmTransport::closeNow() {
+  if (closed_) {
+    return;
+  }
+  VLOG(5) << "AsyncShmTransport::closeNow(this=" << this << ")";
+  DestructorGuard dg(this);
+  closed_ = true;
+  writeShutdown_ = true;
+  shutdownWritePending_ = false;
+  flags_->fetch_or(kShutdown | kClosed, std::memory_order_release);
+  notifyPeer(kWantRead | kWantWrite);
+  failAllWrites(AsyncSocketException(
+      AsyncSocketException::END_OF_FILE, "transport closed locally"));
+  if (readCallback_ != nullptr) {
+    invokeReadEOF();
+  }
+  updateRegistration();
+}
+
+void AsyncShmTransport::shutdownWrite() {
+  if (closed_ || writeShutdown_) {
+    return;
+  }
+  if (writes_.empty()) {
+    shutdownWriteImpl();
+  } else {
+    shutdownWritePending_ = true;
+  }
+}
+
+void AsyncShmTransport::shutdownWriteNow() {
+  if (closed_ || writeShutdown_) {
+    return;
+  }
+  failAllWrites(AsyncSocketException(
+      AsyncSocketException::END_OF_FILE, "writes shut down"));
+  shutdownWriteImpl();
+}
+
+void AsyncShmTransport::shutdownWriteImpl() {
+  shutdownWritePending_ = false;
+  writeShutdown_ = true;
+  flags_->fetch_or(kShutdown, std::memory_order_release);
+  notifyPeer(kWantRead);
+  if (readShutdown_) {
+    closeNow();
+  }
+}
+
+// State
+
+bool AsyncShmTransport::good() const {
+  return !closed_ && !error_ && (peerFlags() & kClosed) == 0;
+}
+
+bool AsyncShmTransport::readable() const {
+  return !readRing_->isEmpty();
+}
+
+void AsyncShmTransport::attachEventBase(EventBase* eventBase) {
+  DCHECK(eventBase_ == nullptr);
+  eventBase_ = eventBase;
+  handler_.attachEventBase(eventBase);
+  writeTimeout_.attachEventBase(eventBase);
+  updateRegistration();
+  if (handler_.isHandlerRegistered()) {
+    // The peer may have made progress without ringing
+    ring(endpoint_.doorbell.fd());
+  }
+}
+
+void AsyncShmTransport::detachEventBase() {
+  DCHECK(isDetachable());
+  handler_.unregisterHandler();
+  handler_.detachEventBase();
+  writeTimeout_.detachEventBase();
+  eventBase_ = nullptr;
+}
+
+bool AsyncShmTransport::isDetachable() const {
+  return !writeTimeout_.isScheduled();
+}
+
+void AsyncShmTransport::getLocalAddress(SocketAddress* address) const {
+  *address = SocketAddress();
+}
+
+void AsyncShmTransport::getPeerAddress(SocketAddress* address) const {
+  *address = SocketAddress();
+}
+
+} // namespace folly
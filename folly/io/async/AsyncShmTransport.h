@@ -0,0 +1,251 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include <folly/File.h>
+#include <folly/concurrency/SPSCRingBuffer.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/AsyncTransport.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace folly {
+
+/**
+ * An AsyncTransportWrapper between two EventBases on the same host, over
+ * a pair of SPSCRingBuffers in shared memory, one for each direction.
+ * Protocols written against AsyncTransportWrapper run over it unchanged,
+ * but instead of going through the kernel, written bytes are copied into
+ * the ring and read straight out of it into the ReadCallback's buffer.
+ *
+ * Each end has an eventfd it waits on, which the peer writes to when it
+ * made data or space available.  The peer only does so when the end said
+ * it is waiting (its ring was empty, or full), through flags in a shared
+ * control block, so two ends that keep up with each other make no system
+ * calls at all.
+ *
+ *   auto ends = AsyncShmTransport::makeEndpoints(1 << 20);
+ *   // Optionally fork() here; each process keeps one end
+ *   auto a = AsyncShmTransport::newTransport(evbA, std::move(ends.first));
+ *   auto b = AsyncShmTransport::newTransport(evbB, std::move(ends.second));
+ *
+ * Writes complete as soon as they are copied into the ring, so, as with
+ * AsyncSocket, writeSuccess() may be called before write() returns.
+ * WriteFlags are ignored.  There are no addresses: getLocalAddress() and
+ * getPeerAddress() return an uninitialized SocketAddress.  A peer that
+ * goes away without closing (a crashed process) isn't detected, which
+ * the protocol's own timeouts have to handle.
+ */
+class AsyncShmTransport : public AsyncTransportWrapper {
+ public:
+  typedef std::unique_ptr<AsyncShmTransport, Destructor> UniquePtr;
+
+  class Channel;
+
+  /**
+   * What one end of the transport needs: the rings and control block,
+   * shared with the other end, and both ends' eventfds.
+   */
+  struct Endpoint {
+    std::shared_ptr<Channel> channel;
+    int side{0};            ///< 0 or 1; which ring this end writes
+    File doorbell;          ///< this end's eventfd
+    File peerDoorbell;      ///< the other end's eventfd
+  };
+
+  /**
+   * Creates the two ends of a transport whose rings hold capacity bytes
+   * (rounded up to a power of two) in each direction.  The memory is a
+   * shared anonymous mapping and the eventfds are inherited, so the ends
+   * can be used in two processes that fork() after this.
+   */
+  static std::pair<Endpoint, Endpoint> makeEndpoints(size_t capacity);
+
+  static UniquePtr newTransport(EventBase* evb, Endpoint endpoint) {
+    return UniquePtr(new AsyncShmTransport(evb, std::move(endpoint)));
+  }
+
+  AsyncShmTransport(EventBase* evb, Endpoint endpoint);
+
+  /**
+   * Most ReadCallback invocations per wakeup, before the rest is left for
+   * the next loop iteration.
+   */
+  void setMaxReadsPerEvent(uint16_t maxReads) {
+    maxReadsPerEvent_ = maxReads;
+  }
+
+  // AsyncTransportWrapper
+
+  void setReadCB(ReadCallback* callback) override;
+  ReadCallback* getReadCallback() const override {
+    return readCallback_;
+  }
+
+  void write(
+      WriteCallback* callback,
+      const void* buf,
+      size_t bytes,
+      WriteFlags flags = WriteFlags::NONE) override;
+  void writev(
+      WriteCallback* callback,
+      const iovec* vec,
+      size_t count,
+      WriteFlags flags = WriteFlags::NONE) override;
+  void writeChain(
+      WriteCallback* callback,
+      std::unique_ptr<IOBuf>&& buf,
+      WriteFlags flags = WriteFlags::NONE) override;
+
+  // AsyncTransport
+
+  void close() override;
+  void closeNow() override;
+  void shutdownWrite() override;
+  void shutdownWriteNow() override;
+
+  bool good() const override;
+  bool readable() const override;
+  bool connecting() const override {
+    return false;
+  }
+  bool error() const override {
+    return error_;
+  }
+
+  void attachEventBase(EventBase* eventBase) override;
+  void detachEventBase() override;
+  bool isDetachable() const override;
+  EventBase* getEventBase() const override {
+    return eventBase_;
+  }
+
+  void setSendTimeout(uint32_t milliseconds) override;
+  uint32_t getSendTimeout() const override {
+    return sendTimeout_;
+  }
+
+  void getLocalAddress(SocketAddress* address) const override;
+  void getPeerAddress(SocketAddress* address) const override;
+  void getAddress(SocketAddress* address) const override {
+    getLocalAddress(address);
+  }
+
+  bool isEorTrackingEnabled() const override {
+    return false;
+  }
+  void setEorTracking(bool /* track */) override {}
+
+  size_t getAppBytesWritten() const override {
+    return bytesWritten_;
+  }
+  size_t getRawBytesWritten() const override {
+    return bytesWritten_;
+  }
+  size_t getAppBytesReceived() const override {
+    return bytesReceived_;
+  }
+  size_t getRawBytesReceived() const override {
+    return bytesReceived_;
+  }
+
+  void destroy() override;
+
+ protected:
+  ~AsyncShmTransport() override;
+
+ private:
+  class DoorbellHandler : public EventHandler {
+   public:
+    DoorbellHandler(AsyncShmTransport* transport, EventBase* evb, int fd)
+        : EventHandler(evb, fd), transport_(transport) {}
+    void handlerReady(uint16_t events) noexcept override;
+
+   private:
+    AsyncShmTransport* transport_;
+  };
+
+  class WriteTimeout : public AsyncTimeout {
+   public:
+    WriteTimeout(AsyncShmTransport* transport, EventBase* evb)
+        : AsyncTimeout(evb), transport_(transport) {}
+    void timeoutExpired() noexcept override;
+
+   private:
+    AsyncShmTransport* transport_;
+  };
+
+  struct PendingWrite {
+    IOBufQueue data{IOBufQueue::cacheChainLength()};
+    WriteCallback* callback{nullptr};
+    size_t bytesWritten{0};
+  };
+
+  void handleDoorbell() noexcept;
+  void handleRead() noexcept;
+  void handleWrite() noexcept;
+  void handleWriteTimeout() noexcept;
+
+  size_t copyToRing(const void* data, size_t len);
+  size_t copyChainToRing(const IOBuf& buf);
+  void queueWrite(
+      WriteCallback* callback,
+      std::unique_ptr<IOBuf> rest,
+      size_t bytesWritten);
+  bool writeFailed(WriteCallback* callback);
+  void failAllWrites(const AsyncSocketException& ex);
+  void shutdownWriteImpl();
+  void invokeReadEOF();
+  void failRead(const AsyncSocketException& ex);
+  void updateRegistration();
+  void scheduleWriteTimeout();
+
+  void wantEvent(uint32_t event);
+  void notifyPeer(uint32_t events);
+  void ring(int fd);
+  uint32_t peerFlags() const;
+
+  EventBase* eventBase_;
+  Endpoint endpoint_;
+  SPSCRingBuffer<char>* readRing_;
+  SPSCRingBuffer<char>* writeRing_;
+  std::atomic<uint32_t>* flags_;
+  std::atomic<uint32_t>* peerFlags_;
+  DoorbellHandler handler_;
+  WriteTimeout writeTimeout_;
+
+  ReadCallback* readCallback_{nullptr};
+  std::deque<PendingWrite> writes_;
+  uint32_t sendTimeout_{0};
+  uint16_t maxReadsPerEvent_{16};
+  bool shutdownWritePending_{false};
+  bool closeOnEmpty_{false};
+  bool writeShutdown_{false};
+  bool readShutdown_{false};
+  bool closed_{false};
+  bool error_{false};
+  size_t bytesWritten_{0};
+  size_t bytesReceived_{0};
+};
+
+} // namespace folly
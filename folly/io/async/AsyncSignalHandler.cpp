@@ -16,8 +16,19 @@
 #include <folly/io/async/AsyncSignalHandler.h>
 
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
 
 #include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/portability/Unistd.h>
+
+#if __linux__ && !__ANDROID__
+#define FOLLY_HAVE_SIGNALFD
+#include <pthread.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#endif
 
 using std::make_pair;
 using std::pair;
@@ -25,8 +36,153 @@ using std::string;
 
 namespace folly {
 
-AsyncSignalHandler::AsyncSignalHandler(EventBase* eventBase)
-  : eventBase_(eventBase) {
+#ifdef FOLLY_HAVE_SIGNALFD
+
+/**
+ * One signalfd for all of a handler's signals, read in batches.
+ */
+class AsyncSignalHandler::SignalFd : public EventHandler {
+ public:
+  explicit SignalFd(AsyncSignalHandler* handler) : handler_(handler) {
+    sigemptyset(&mask_);
+    fd_ = signalfd(-1, &mask_, SFD_NONBLOCK | SFD_CLOEXEC);
+    checkUnixError(fd_, "signalfd() failed");
+    initHandler(handler->eventBase_, fd_);
+    if (!registerHandler(READ | PERSIST)) {
+      closeNoInt(fd_);
+      throw std::runtime_error("error adding event handler for signalfd");
+    }
+  }
+
+  ~SignalFd() override {
+    if (destroyed_) {
+      *destroyed_ = true;
+    }
+    unregisterHandler();
+    closeNoInt(fd_);
+    for (const auto& signal : signals_) {
+      if (signal.second) {
+        setBlocked(signal.first, false);
+      }
+    }
+  }
+
+  bool empty() const {
+    return signals_.empty();
+  }
+
+  void add(int signum) {
+    if (signals_.count(signum)) {
+      throw std::runtime_error(folly::to<string>(
+          "handler already registered for signal ", signum));
+    }
+    // Block the signal first, so that none is delivered the usual way
+    // between the two calls.
+    sigset_t current;
+    checkPosixError(pthread_sigmask(SIG_BLOCK, nullptr, &current));
+    const bool wasBlocked = sigismember(&current, signum) == 1;
+    if (!wasBlocked) {
+      setBlocked(signum, true);
+    }
+    sigaddset(&mask_, signum);
+    if (signalfd(fd_, &mask_, 0) == -1) {
+      int err = errno;
+      sigdelset(&mask_, signum);
+      if (!wasBlocked) {
+        setBlocked(signum, false);
+      }
+      throwSystemErrorExplicit(
+          err, "error updating signalfd for signal ", signum);
+    }
+    signals_.emplace(signum, !wasBlocked);
+  }
+
+  void remove(int signum) {
+    auto it = signals_.find(signum);
+    if (it == signals_.end()) {
+      throw std::runtime_error(folly::to<string>(
+          "unable to unregister handler for signal ",
+          signum,
+          ": signal not registered"));
+    }
+    sigdelset(&mask_, signum);
+    checkUnixError(signalfd(fd_, &mask_, 0), "error updating signalfd");
+    if (it->second) {
+      setBlocked(signum, false);
+    }
+    signals_.erase(it);
+  }
+
+  void handlerReady(uint16_t /* events */) noexcept override {
+    // signalInfoReceived() may unregister signals or destroy the handler
+    bool destroyed = false;
+    destroyed_ = &destroyed;
+
+    constexpr size_t kBatch = 32;
+    signalfd_siginfo infos[kBatch];
+    for (;;) {
+      auto bytes = readNoInt(fd_, infos, sizeof(infos));
+      if (bytes <= 0) {
+        break; // EAGAIN: all read
+      }
+      auto count = size_t(bytes) / sizeof(signalfd_siginfo);
+      for (size_t i = 0; i < count; ++i) {
+        SignalInfo info;
+        info.signo = int(infos[i].ssi_signo);
+        info.code = infos[i].ssi_code;
+        info.pid = pid_t(infos[i].ssi_pid);
+        info.uid = uid_t(infos[i].ssi_uid);
+        info.status = infos[i].ssi_status;
+        handler_->signalInfoReceived(info);
+        if (destroyed) {
+          return;
+        }
+      }
+      if (count < kBatch) {
+        break;
+      }
+    }
+    destroyed_ = nullptr;
+  }
+
+ private:
+  static void setBlocked(int signum, bool blocked) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signum);
+    checkPosixError(
+        pthread_sigmask(blocked ? SIG_BLOCK : SIG_UNBLOCK, &set, nullptr));
+  }
+
+  AsyncSignalHandler* handler_;
+  int fd_{-1};
+  sigset_t mask_;
+  // Registered signals, and whether we blocked them
+  std::map<int, bool> signals_;
+  bool* destroyed_{nullptr};
+};
+
+#else
+
+class AsyncSignalHandler::SignalFd {
+ public:
+  explicit SignalFd(AsyncSignalHandler*) {}
+  bool empty() const {
+    return true;
+  }
+  void add(int) {}
+  void remove(int) {}
+};
+
+#endif
+
+AsyncSignalHandler::AsyncSignalHandler(EventBase* eventBase, Backend backend)
+    : eventBase_(eventBase), backend_(backend) {
+#ifndef FOLLY_HAVE_SIGNALFD
+  if (backend_ == Backend::SIGNALFD) {
+    throw std::runtime_error("signalfd is not supported on this platform");
+  }
+#endif
 }
 
 AsyncSignalHandler::~AsyncSignalHandler() {
@@ -34,23 +190,38 @@ AsyncSignalHandler::~AsyncSignalHandler() {
   for (SignalEventMap::iterator it = signalEvents_.begin();
        it != signalEvents_.end();
        ++it) {
-    event_del(&it->second);
+    eventBase_->getBackend()->delEvent(&it->second);
   }
 }
 
 void AsyncSignalHandler::attachEventBase(EventBase* eventBase) {
   assert(eventBase_ == nullptr);
-  assert(signalEvents_.empty());
+  assert(signalEvents_.empty() && !signalFd_);
   eventBase_ = eventBase;
 }
 
 void AsyncSignalHandler::detachEventBase() {
   assert(eventBase_ != nullptr);
-  assert(signalEvents_.empty());
+  assert(signalEvents_.empty() && !signalFd_);
   eventBase_ = nullptr;
 }
 
 void AsyncSignalHandler::registerSignalHandler(int signum) {
+  if (backend_ == Backend::SIGNALFD) {
+    if (!signalFd_) {
+      signalFd_ = std::make_unique<SignalFd>(this);
+    }
+    try {
+      signalFd_->add(signum);
+    } catch (...) {
+      if (signalFd_->empty()) {
+        signalFd_.reset();
+      }
+      throw;
+    }
+    return;
+  }
+
   pair<SignalEventMap::iterator, bool> ret =
     signalEvents_.insert(make_pair(signum, event()));
   if (!ret.second) {
@@ -69,7 +240,7 @@ void AsyncSignalHandler::registerSignalHandler(int signum) {
                                  signum));
     }
 
-    if (event_add(ev, nullptr) != 0) {
+    if (eventBase_->getBackend()->addEvent(ev, nullptr) != 0) {
       throw std::runtime_error(folly::to<string>(
                                  "error adding event handler for signal ",
                                  signum));
@@ -81,6 +252,20 @@ void AsyncSignalHandler::registerSignalHandler(int signum) {
 }
 
 void AsyncSignalHandler::unregisterSignalHandler(int signum) {
+  if (backend_ == Backend::SIGNALFD) {
+    if (!signalFd_) {
+      throw std::runtime_error(folly::to<string>(
+          "unable to unregister handler for signal ",
+          signum,
+          ": signal not registered"));
+    }
+    signalFd_->remove(signum);
+    if (signalFd_->empty()) {
+      signalFd_.reset();
+    }
+    return;
+  }
+
   SignalEventMap::iterator it = signalEvents_.find(signum);
   if (it == signalEvents_.end()) {
     throw std::runtime_error(folly::to<string>(
@@ -88,7 +273,7 @@ void AsyncSignalHandler::unregisterSignalHandler(int signum) {
                                signum, ": signal not registered"));
   }
 
-  event_del(&it->second);
+  eventBase_->getBackend()->delEvent(&it->second);
   signalEvents_.erase(it);
 }
 
@@ -96,7 +281,9 @@ void AsyncSignalHandler::libeventCallback(libevent_fd_t signum,
                                           short /* events */,
                                           void* arg) {
   AsyncSignalHandler* handler = static_cast<AsyncSignalHandler*>(arg);
-  handler->signalReceived(int(signum));
+  SignalInfo info;
+  info.signo = int(signum);
+  handler->signalInfoReceived(info);
 }
 
 } // namespace folly
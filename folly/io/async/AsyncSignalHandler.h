@@ -18,6 +18,8 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/portability/Event.h>
 #include <map>
+#include <memory>
+#include <sys/types.h>
 
 namespace folly {
 
@@ -39,13 +41,46 @@ namespace folly {
  * process signals received by the thread where the AsyncSignalHandler is
  * registered.  It is the user's responsibility to ensure that signals are
  * delivered to the desired thread in multi-threaded programs.
+ *
+ * With Backend::SIGNALFD (Linux only), the registered signals are blocked in
+ * the registering thread and read from a signalfd instead: many pending
+ * signals are read with one syscall, and each comes with its siginfo (see
+ * signalInfoReceived()).  Process-directed signals go to whichever thread
+ * has them unblocked, so in multi-threaded programs, block them in every
+ * thread, e.g. before starting any.  The signalfd is an ordinary fd, so this
+ * works with every EventBaseBackend.  Several handlers on different
+ * EventBases may each use a signalfd for different signals.
  */
 class AsyncSignalHandler {
  public:
+  enum class Backend {
+    LIBEVENT,
+    SIGNALFD,
+  };
+
+  /**
+   * What is known about a received signal.  With Backend::LIBEVENT only
+   * signo is set.
+   */
+  struct SignalInfo {
+    int signo{0};
+    // si_code, e.g. CLD_EXITED for SIGCHLD
+    int code{0};
+    // Sending process, or for SIGCHLD, the child
+    pid_t pid{0};
+    uid_t uid{0};
+    // Exit status or signal, for SIGCHLD
+    int status{0};
+  };
+
   /**
    * Create a new AsyncSignalHandler.
+   *
+   * Throws if backend isn't supported on this platform.
    */
-  explicit AsyncSignalHandler(EventBase* eventBase);
+  explicit AsyncSignalHandler(
+      EventBase* eventBase,
+      Backend backend = Backend::LIBEVENT);
   virtual ~AsyncSignalHandler();
 
   /**
@@ -72,6 +107,10 @@ class AsyncSignalHandler {
     return eventBase_;
   }
 
+  Backend getBackend() const {
+    return backend_;
+  }
+
   /**
    * Register to receive callbacks about the specified signal.
    *
@@ -101,7 +140,17 @@ class AsyncSignalHandler {
    */
   virtual void signalReceived(int signum) noexcept = 0;
 
+  /**
+   * Called for every received signal.  The default implementation calls
+   * signalReceived(); override it to see the siginfo that Backend::SIGNALFD
+   * provides.
+   */
+  virtual void signalInfoReceived(const SignalInfo& info) noexcept {
+    signalReceived(info.signo);
+  }
+
  private:
+  class SignalFd;
   typedef std::map<int, struct event> SignalEventMap;
 
   // Forbidden copy constructor and assignment operator
@@ -111,7 +160,10 @@ class AsyncSignalHandler {
   static void libeventCallback(libevent_fd_t signum, short events, void* arg);
 
   EventBase* eventBase_{nullptr};
+  const Backend backend_;
   SignalEventMap signalEvents_;
+  // With Backend::SIGNALFD, while any signal is registered
+  std::unique_ptr<SignalFd> signalFd_;
 };
 
 } // namespace folly
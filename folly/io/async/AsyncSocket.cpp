@@ -17,8 +17,10 @@
 #include <folly/io/async/AsyncSocket.h>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/Portability.h>
+#include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
@@ -31,9 +33,20 @@
 #include <boost/preprocessor/control/if.hpp>
 #include <errno.h>
 #include <limits.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <thread>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#endif
+
 using std::string;
 using std::unique_ptr;
 
@@ -48,6 +61,13 @@ static constexpr bool msgErrQueueSupported =
     false;
 #endif // FOLLY_HAVE_MSG_ERRQUEUE
 
+static constexpr bool sendFileSupported =
+#ifdef __linux__
+    true;
+#else
+    false;
+#endif
+
 // static members initializers
 const AsyncSocket::OptionMap AsyncSocket::emptyOptionMap;
 
@@ -56,6 +76,36 @@ const AsyncSocketException socketClosedLocallyEx(
 const AsyncSocketException socketShutdownForWritesEx(
     AsyncSocketException::END_OF_FILE, "socket shutdown for writes");
 
+namespace {
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+// Error queue messages read with each recvmmsg()
+constexpr size_t kErrMessageBatch = 16;
+
+constexpr uint32_t kRxTimestampFlags =
+    SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE;
+
+std::chrono::nanoseconds toNanoseconds(const timespec& ts) {
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+AsyncSocket::TimestampObserver::Timestamp makeTimestamp(
+    AsyncSocket::TimestampObserver::Event event,
+    uint64_t byteOffset,
+    const scm_timestamping& tss) {
+  AsyncSocket::TimestampObserver::Timestamp timestamp;
+  timestamp.event = event;
+  timestamp.byteOffset = byteOffset;
+  timestamp.software = toNanoseconds(tss.ts[0]);
+  timestamp.hardware = toNanoseconds(tss.ts[2]);
+  return timestamp;
+}
+#else
+constexpr uint32_t kRxTimestampFlags = 0;
+#endif // FOLLY_HAVE_MSG_ERRQUEUE
+
+} // namespace
+
 // TODO: It might help performance to provide a version of BytesWriteRequest that
 // users could derive from, so we can avoid the extra allocation for each call
 // to write()/writev().  We could templatize TFramedAsyncChannel just like the
@@ -101,6 +151,12 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
   }
 
   WriteResult performWrite() override {
+    if (written_) {
+      // Already written, along with other requests
+      written_ = false;
+      return WriteResult(bytesWritten_);
+    }
+
     WriteFlags writeFlags = flags_;
     if (getNext() != nullptr) {
       writeFlags |= WriteFlags::CORK;
@@ -161,6 +217,33 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
     totalBytesWritten_ += uint32_t(bytesWritten_);
   }
 
+  const struct iovec* getOps() const {
+    assert(opCount_ > opIndex_);
+    return writeOps_ + opIndex_;
+  }
+
+  uint32_t getOpCount() const {
+    assert(opCount_ > opIndex_);
+    return opCount_ - opIndex_;
+  }
+
+  WriteFlags getFlags() const {
+    return flags_;
+  }
+
+  // Records that the first opsWritten ops, and partialBytes of the next
+  // one, were written by someone else (see flushCoalescedWrites()); the
+  // next performWrite() returns that instead of writing.
+  void setWritten(uint32_t opsWritten, uint32_t partialBytes) {
+    opsWritten_ = opsWritten;
+    partialBytes_ = partialBytes;
+    bytesWritten_ = partialBytes;
+    for (uint32_t i = 0; i < opsWritten; ++i) {
+      bytesWritten_ += getOps()[i].iov_len;
+    }
+    written_ = true;
+  }
+
  private:
   BytesWriteRequest(AsyncSocket* socket,
                     WriteCallback* callback,
@@ -184,16 +267,6 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
   // private destructor, to ensure callers use destroy()
   ~BytesWriteRequest() override = default;
 
-  const struct iovec* getOps() const {
-    assert(opCount_ > opIndex_);
-    return writeOps_ + opIndex_;
-  }
-
-  uint32_t getOpCount() const {
-    assert(opCount_ > opIndex_);
-    return opCount_ - opIndex_;
-  }
-
   uint32_t opCount_;            ///< number of entries in writeOps_
   uint32_t opIndex_;            ///< current index into writeOps_
   WriteFlags flags_;            ///< set for WriteFlags
@@ -203,10 +276,146 @@ class AsyncSocket::BytesWriteRequest : public AsyncSocket::WriteRequest {
   uint32_t opsWritten_;         ///< complete ops written
   uint32_t partialBytes_;       ///< partial bytes of incomplete op written
   ssize_t bytesWritten_;        ///< bytes written altogether
+  bool written_{false};         ///< see setWritten()
 
   struct iovec writeOps_[];     ///< write operation(s) list
 };
 
+/* The WriteRequest for sendFile()
+ *
+ * Sends the file with performSendFile() when the socket supports it, and
+ * otherwise reads it kChunkSize bytes at a time into chunk_ and writes that
+ * with performWrite().
+ */
+class AsyncSocket::FileWriteRequest : public AsyncSocket::WriteRequest {
+ public:
+  FileWriteRequest(AsyncSocket* socket,
+                   WriteCallback* callback,
+                   int fd,
+                   off_t offset,
+                   size_t len,
+                   WriteFlags flags)
+    : AsyncSocket::WriteRequest(socket, callback)
+    , fd_(fd)
+    , offset_(offset)
+    , readRemaining_(len)
+    , remaining_(len)
+    , flags_(flags) {
+    struct stat st;
+    isPipe_ = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+  }
+
+  void destroy() override {
+    delete this;
+  }
+
+  WriteResult performWrite() override {
+    bytesWritten_ = 0;
+    while (bytesWritten_ < remaining_) {
+      size_t len = 0;
+      WriteResult writeResult(0);
+      if ((chunk_ && !chunk_->empty()) || !useSendFile()) {
+        writeResult = performChunkWrite(&len);
+      } else {
+        len = readRemaining_;
+        writeResult = socket_->performSendFile(
+            fd_, offset_ < 0 ? nullptr : &offset_, len, isPipe_);
+        if (writeResult.writeReturn > 0) {
+          readRemaining_ -= size_t(writeResult.writeReturn);
+        }
+      }
+      if (writeResult.writeReturn < 0) {
+        return writeResult;
+      }
+      bytesWritten_ += size_t(writeResult.writeReturn);
+      if (size_t(writeResult.writeReturn) < len) {
+        // Wait for the socket to become writable again
+        break;
+      }
+    }
+    return WriteResult(ssize_t(bytesWritten_));
+  }
+
+  bool isComplete() override {
+    return bytesWritten_ == remaining_;
+  }
+
+  void consume() override {
+    remaining_ -= bytesWritten_;
+    totalBytesWritten_ += uint32_t(bytesWritten_);
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  ~FileWriteRequest() override = default;
+
+  bool useSendFile() const {
+    return socket_->state_ == StateEnum::ESTABLISHED &&
+        socket_->supportsSendFile();
+  }
+
+  // Write what is left of chunk_, after reading the next kChunkSize bytes of
+  // the file into it if it is empty; *len is set to how much was left.
+  WriteResult performChunkWrite(size_t* len) {
+    if (!chunk_) {
+      chunk_ = IOBuf::create(kChunkSize);
+    }
+    if (chunk_->empty()) {
+      chunk_->clear();
+      size_t toRead = std::min(size_t(chunk_->capacity()), readRemaining_);
+      ssize_t bytes = offset_ < 0
+          ? readNoInt(fd_, chunk_->writableData(), toRead)
+          : preadNoInt(fd_, chunk_->writableData(), toRead, offset_);
+      if (bytes < 0) {
+        return WriteResult(
+            WRITE_ERROR,
+            std::make_unique<AsyncSocketException>(
+                AsyncSocketException::INTERNAL_ERROR,
+                "sendFile() failed to read its input",
+                errno));
+      } else if (bytes == 0) {
+        return WriteResult(
+            WRITE_ERROR,
+            std::make_unique<AsyncSocketException>(
+                AsyncSocketException::END_OF_FILE,
+                "sendFile() input ended early"));
+      }
+      chunk_->append(size_t(bytes));
+      readRemaining_ -= size_t(bytes);
+      if (offset_ >= 0) {
+        offset_ += bytes;
+      }
+    }
+
+    iovec vec;
+    vec.iov_base = chunk_->writableData();
+    vec.iov_len = chunk_->length();
+    *len = vec.iov_len;
+    WriteFlags writeFlags = flags_;
+    if (getNext() != nullptr || readRemaining_ > 0) {
+      writeFlags |= WriteFlags::CORK;
+    }
+    uint32_t countWritten = 0;
+    uint32_t partialWritten = 0;
+    auto writeResult = socket_->performWrite(
+        &vec, 1, writeFlags, &countWritten, &partialWritten);
+    if (writeResult.writeReturn > 0) {
+      chunk_->trimStart(size_t(writeResult.writeReturn));
+    }
+    return writeResult;
+  }
+
+  int fd_;
+  bool isPipe_{false};
+  off_t offset_;                ///< next offset to read, or -1
+  size_t readRemaining_;        ///< bytes still to be read from fd_
+  size_t remaining_;            ///< bytes still to be written
+  size_t bytesWritten_{0};      ///< bytes written by the last performWrite()
+  WriteFlags flags_;            ///< set for WriteFlags
+  unique_ptr<IOBuf> chunk_;     ///< bytes read but not written yet, if any
+};
+
 int AsyncSocket::SendMsgParamsCallback::getDefaultFlags(
     folly::WriteFlags flags,
     bool zeroCopyEnabled) noexcept {
@@ -243,7 +452,8 @@ AsyncSocket::AsyncSocket()
     : eventBase_(nullptr),
       writeTimeout_(this, nullptr),
       ioHandler_(this, nullptr),
-      immediateReadHandler_(this) {
+      immediateReadHandler_(this),
+      writeFlusher_(this) {
   VLOG(5) << "new AsyncSocket()";
   init();
 }
@@ -252,7 +462,8 @@ AsyncSocket::AsyncSocket(EventBase* evb)
     : eventBase_(evb),
       writeTimeout_(this, evb),
       ioHandler_(this, evb),
-      immediateReadHandler_(this) {
+      immediateReadHandler_(this),
+      writeFlusher_(this) {
   VLOG(5) << "new AsyncSocket(" << this << ", evb=" << evb << ")";
   init();
 }
@@ -277,7 +488,8 @@ AsyncSocket::AsyncSocket(EventBase* evb, int fd, uint32_t zeroCopyBufId)
       eventBase_(evb),
       writeTimeout_(this, evb),
       ioHandler_(this, evb, fd),
-      immediateReadHandler_(this) {
+      immediateReadHandler_(this),
+      writeFlusher_(this) {
   VLOG(5) << "new AsyncSocket(" << this << ", evb=" << evb << ", fd=" << fd
           << ", zeroCopyBufId=" << zeroCopyBufId << ")";
   init();
@@ -733,6 +945,7 @@ void AsyncSocket::setReadCB(ReadCallback *callback) {
   if (callback == readCallback_) {
     return;
   }
+  readvSize_ = 0;
 
   /* We are removing a read callback */
   if (callback == nullptr &&
@@ -1007,9 +1220,22 @@ void AsyncSocket::writeImpl(WriteCallback* callback, const iovec* vec,
   uint32_t partialWritten = 0;
   ssize_t bytesWritten = 0;
   bool mustRegister = false;
+  bool holdBack = false;
   if ((state_ == StateEnum::ESTABLISHED || state_ == StateEnum::FAST_OPEN) &&
       !connecting()) {
-    if (writeReqHead_ == nullptr) {
+    bool coalesce = writeCoalescing_ && state_ == StateEnum::ESTABLISHED &&
+        !isSet(flags, WriteFlags::EOR) && !isZeroCopyRequest(flags);
+    if (coalescedWrites_ > 0 && !coalesce) {
+      // Send the writes held back first, to keep the order
+      flushCoalescedWrites();
+    }
+
+    if (coalesce &&
+        (coalescedWrites_ > 0 || (wroteInLoop_ && writeReqHead_ == nullptr))) {
+      // Hold the write back until the end of the loop iteration, see
+      // setWriteCoalescing()
+      holdBack = true;
+    } else if (writeReqHead_ == nullptr) {
       // If we are established and there are no other writes pending,
       // we can attempt to perform the write immediately.
       assert(writeReqTail_ == nullptr);
@@ -1018,6 +1244,10 @@ void AsyncSocket::writeImpl(WriteCallback* callback, const iovec* vec,
       auto writeResult = performWrite(
           vec, uint32_t(count), flags, &countWritten, &partialWritten);
       bytesWritten = writeResult.writeReturn;
+      if (writeCoalescing_ && !wroteInLoop_) {
+        wroteInLoop_ = true;
+        eventBase_->runInLoop(&writeFlusher_, true);
+      }
       if (bytesWritten < 0) {
         auto errnoCopy = errno;
         if (writeResult.exception) {
@@ -1080,6 +1310,152 @@ void AsyncSocket::writeImpl(WriteCallback* callback, const iovec* vec,
     return failWrite(__func__, callback, size_t(bytesWritten), tex);
   }
   req->consume();
+  queueWriteRequest(req, mustRegister);
+  if (holdBack) {
+    ++coalescedWrites_;
+  }
+}
+
+void AsyncSocket::flushCoalescedWrites() noexcept {
+  uint32_t count = coalescedWrites_;
+  coalescedWrites_ = 0;
+  // The writes may have been sent or failed since they were held back
+  if (count == 0 || writeReqHead_ == nullptr ||
+      state_ != StateEnum::ESTABLISHED ||
+      (eventFlags_ & EventHandler::WRITE)) {
+    return;
+  }
+  DestructorGuard dg(this);
+
+  // The queue only holds the writes held back: send as many as fit in a
+  // single writev()
+  iovec vec[kIovMax];
+  uint32_t opCount = 0;
+  uint32_t merged = 0;
+  WriteFlags flags = WriteFlags::NONE;
+  for (auto req = writeReqHead_; req != nullptr && merged < count;
+       req = req->getNext()) {
+    auto bytesReq = static_cast<BytesWriteRequest*>(req);
+    uint32_t ops = bytesReq->getOpCount();
+    if (opCount + ops > kIovMax) {
+      flags |= WriteFlags::CORK;
+      break;
+    }
+    memcpy(vec + opCount, bytesReq->getOps(), ops * sizeof(iovec));
+    opCount += ops;
+    flags = bytesReq->getFlags();
+    ++merged;
+  }
+
+  if (merged > 1) {
+    uint32_t countWritten = 0;
+    uint32_t partialWritten = 0;
+    auto writeResult =
+        performWrite(vec, opCount, flags, &countWritten, &partialWritten);
+    if (writeResult.writeReturn < 0) {
+      if (writeResult.exception) {
+        return failWrite(__func__, *writeResult.exception);
+      }
+      auto errnoCopy = errno;
+      AsyncSocketException ex(
+          AsyncSocketException::INTERNAL_ERROR,
+          withAddr("writev() failed"),
+          errnoCopy);
+      return failWrite(__func__, ex);
+    }
+
+    // Tell the requests what was written of them, up to the first one that
+    // wasn't written completely
+    auto req = writeReqHead_;
+    for (uint32_t i = 0; i < merged; ++i, req = req->getNext()) {
+      auto bytesReq = static_cast<BytesWriteRequest*>(req);
+      uint32_t ops = bytesReq->getOpCount();
+      if (countWritten < ops) {
+        bytesReq->setWritten(countWritten, partialWritten);
+        break;
+      }
+      bytesReq->setWritten(ops, 0);
+      countWritten -= ops;
+    }
+  }
+
+  // Complete them, write whatever didn't fit, and wait for the socket to be
+  // writable if needed
+  handleWrite();
+}
+
+void AsyncSocket::sendFile(WriteCallback* callback, int fd, off_t offset,
+                           size_t len, WriteFlags flags) {
+  VLOG(6) << "AsyncSocket::sendFile() this=" << this << ", fd=" << fd_
+          << ", callback=" << callback << ", file fd=" << fd
+          << ", offset=" << offset << ", len=" << len
+          << ", state=" << state_;
+  DestructorGuard dg(this);
+  eventBase_->dcheckIsInEventBaseThread();
+
+  if (shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING)) {
+    // As in writeImpl(), fail everything after a write following shutdown
+    return invalidState(callback);
+  }
+
+  // Keep the order of the writes, see setWriteCoalescing()
+  flushCoalescedWrites();
+
+  FileWriteRequest* req;
+  try {
+    req = new FileWriteRequest(this, callback, fd, offset, len, flags);
+  } catch (const std::exception& ex) {
+    AsyncSocketException tex(AsyncSocketException::INTERNAL_ERROR,
+        withAddr(string("failed to append new WriteRequest: ") + ex.what()));
+    return failWrite(__func__, callback, 0, tex);
+  }
+
+  bool mustRegister = false;
+  if ((state_ == StateEnum::ESTABLISHED || state_ == StateEnum::FAST_OPEN) &&
+      !connecting()) {
+    if (writeReqHead_ == nullptr) {
+      // Nothing else is queued, so try to send the file right away
+      assert(writeReqTail_ == nullptr);
+      assert((eventFlags_ & EventHandler::WRITE) == 0);
+
+      auto writeResult = req->performWrite();
+      if (writeResult.writeReturn < 0) {
+        auto errnoCopy = errno;
+        req->destroy();
+        if (writeResult.exception) {
+          return failWrite(__func__, callback, 0, *writeResult.exception);
+        }
+        AsyncSocketException ex(
+            AsyncSocketException::INTERNAL_ERROR,
+            withAddr("sendFile failed"),
+            errnoCopy);
+        return failWrite(__func__, callback, 0, ex);
+      } else if (req->isComplete()) {
+        req->destroy();
+        if (callback) {
+          callback->writeSuccess();
+        }
+        return;
+      }
+      if (bufferCallback_) {
+        bufferCallback_->onEgressBuffered();
+      }
+      if (!connecting()) {
+        // See writeImpl()
+        mustRegister = true;
+      }
+    }
+  } else if (!connecting()) {
+    // Invalid state for writing
+    req->destroy();
+    return invalidState(callback);
+  }
+
+  req->consume();
+  queueWriteRequest(req, mustRegister);
+}
+
+void AsyncSocket::queueWriteRequest(WriteRequest* req, bool mustRegister) {
   if (writeReqTail_ == nullptr) {
     assert(writeReqHead_ == nullptr);
     writeReqHead_ = writeReqTail_ = req;
@@ -1109,6 +1485,9 @@ void AsyncSocket::writeImpl(WriteCallback* callback, const iovec* vec,
 }
 
 void AsyncSocket::writeRequest(WriteRequest* req) {
+  // Keep the order of the writes, see setWriteCoalescing()
+  flushCoalescedWrites();
+
   if (writeReqTail_ == nullptr) {
     assert(writeReqHead_ == nullptr);
     writeReqHead_ = writeReqTail_ = req;
@@ -1447,6 +1826,12 @@ void AsyncSocket::detachEventBase() {
   assert(eventBase_ != nullptr);
   eventBase_->dcheckIsInEventBaseThread();
 
+  if (writeFlusher_.isLoopCallbackScheduled()) {
+    writeFlusher_.cancelLoopCallback();
+    wroteInLoop_ = false;
+    flushCoalescedWrites();
+  }
+
   eventBase_ = nullptr;
   ioHandler_.detachEventBase();
   writeTimeout_.detachEventBase();
@@ -1581,6 +1966,109 @@ int AsyncSocket::setQuickAck(bool quickack) {
 #endif
 }
 
+int AsyncSocket::setBusyPoll(std::chrono::microseconds timeout) {
+  (void)timeout;
+  if (fd_ < 0) {
+    VLOG(4) << "AsyncSocket::setBusyPoll() called on non-open socket "
+               << this << "(state=" << state_ << ")";
+    return EINVAL;
+  }
+
+#ifdef SO_BUSY_POLL // Linux-only
+  int value = int(timeout.count());
+  if (setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) != 0) {
+    int errnoCopy = errno;
+    VLOG(2) << "failed to update SO_BUSY_POLL option on AsyncSocket"
+            << this << "(fd=" << fd_ << ", state=" << state_ << "): "
+            << strerror(errnoCopy);
+    return errnoCopy;
+  }
+
+  return 0;
+#else
+  return ENOSYS;
+#endif
+}
+
+int AsyncSocket::setTimestamping(
+    TimestampObserver* observer,
+    const TimestampOptions& options) {
+  if (fd_ < 0) {
+    VLOG(4) << "AsyncSocket::setTimestamping() called on non-open socket "
+            << this << "(state=" << state_ << ")";
+    return EINVAL;
+  }
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  uint32_t flags = 0;
+  if (observer) {
+    if (options.sched) {
+      flags |= SOF_TIMESTAMPING_TX_SCHED;
+    }
+    if (options.tx) {
+      flags |= SOF_TIMESTAMPING_TX_SOFTWARE;
+      if (options.hardware) {
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE;
+      }
+    }
+    if (options.ack) {
+      flags |= SOF_TIMESTAMPING_TX_ACK;
+    }
+    if (flags) {
+      // Number the writes, and don't loop their bytes back
+      flags |= SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    }
+    if (options.rx) {
+      flags |= SOF_TIMESTAMPING_RX_SOFTWARE;
+      if (options.hardware) {
+        flags |= SOF_TIMESTAMPING_RX_HARDWARE;
+      }
+    }
+    flags |= SOF_TIMESTAMPING_SOFTWARE;
+    if (options.hardware) {
+      flags |= SOF_TIMESTAMPING_RAW_HARDWARE;
+    }
+  }
+
+  // The kernel numbers the bytes from the first one not acknowledged when
+  // SOF_TIMESTAMPING_OPT_ID is turned on
+  size_t base = timestampBase_;
+  if ((flags & SOF_TIMESTAMPING_OPT_ID) &&
+      !(timestampFlags_ & SOF_TIMESTAMPING_OPT_ID)) {
+    int unacked = 0;
+    if (ioctl(fd_, SIOCOUTQ, &unacked) != 0) {
+      int errnoCopy = errno;
+      VLOG(2) << "failed to get the send queue size of AsyncSocket " << this
+              << "(fd=" << fd_ << ", state=" << state_
+              << "): " << strerror(errnoCopy);
+      return errnoCopy;
+    }
+    base = getRawBytesWritten() - size_t(unacked);
+  }
+
+  if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) !=
+      0) {
+    int errnoCopy = errno;
+    VLOG(2) << "failed to update SO_TIMESTAMPING option on AsyncSocket "
+            << this << "(fd=" << fd_ << ", state=" << state_
+            << "): " << strerror(errnoCopy);
+    return errnoCopy;
+  }
+
+  timestampObserver_ = observer;
+  timestampBase_ = base;
+  timestampFlags_ = flags;
+  if (!observer) {
+    timestamps_.clear();
+  }
+  return 0;
+#else
+  (void)observer;
+  (void)options;
+  return ENOSYS;
+#endif
+}
+
 int AsyncSocket::setSendBufSize(size_t bufsize) {
   if (fd_ < 0) {
     VLOG(4) << "AsyncSocket::setSendBufSize() called on non-open socket "
@@ -1644,6 +2132,14 @@ void AsyncSocket::ioReady(uint16_t events) noexcept {
 
   uint16_t relevantEvents = uint16_t(events & EventHandler::READ_WRITE);
   EventBase* originalEventBase = eventBase_;
+  // Pass on the timestamps of what was sent and read, unless a callback
+  // moved us to another thread
+  SCOPE_EXIT {
+    if (!timestamps_.empty() && eventBase_ == originalEventBase) {
+      deliverTimestamps();
+    }
+  };
+
   // If we got there it means that either EventHandler::READ or
   // EventHandler::WRITE is set. Any of these flags can
   // indicate that there are messages available in the socket
@@ -1702,7 +2198,15 @@ AsyncSocket::performRead(void** buf, size_t* buflen, size_t* /* offset */) {
     return ReadResult(len);
   }
 
-  ssize_t bytes = recv(fd_, *buf, *buflen, MSG_DONTWAIT);
+  ssize_t bytes;
+  if (UNLIKELY(timestampFlags_ & kRxTimestampFlags)) {
+    iovec vec;
+    vec.iov_base = *buf;
+    vec.iov_len = *buflen;
+    bytes = recvWithTimestamps(&vec, 1);
+  } else {
+    bytes = recv(fd_, *buf, *buflen, MSG_DONTWAIT);
+  }
   if (bytes < 0) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
       // No more data to read right now.
@@ -1716,6 +2220,103 @@ AsyncSocket::performRead(void** buf, size_t* buflen, size_t* /* offset */) {
   }
 }
 
+AsyncSocket::ReadResult AsyncSocket::performReadv(
+    IOBufQueue& queue,
+    size_t* buflen,
+    size_t bufferSize) {
+  size_t const len = *buflen;
+  constexpr size_t kMaxReadvBuffers = 16;
+  iovec vec[kMaxReadvBuffers + 1];
+
+  // Start with whatever is left at the end of the queue
+  auto tail = queue.preallocate(1, bufferSize, len);
+  vec[0].iov_base = tail.first;
+  vec[0].iov_len = size_t(tail.second);
+  size_t count = 1;
+  size_t total = vec[0].iov_len;
+  while (total < len && count <= kMaxReadvBuffers) {
+    if (readvBufs_.size() < count) {
+      readvBufs_.push_back(IOBuf::create(bufferSize));
+    }
+    auto& buf = readvBufs_[count - 1];
+    vec[count].iov_base = buf->writableTail();
+    vec[count].iov_len = std::min(size_t(buf->tailroom()), len - total);
+    total += vec[count].iov_len;
+    ++count;
+  }
+  VLOG(5) << "AsyncSocket::performReadv() this=" << this << ", len=" << total
+          << ", iovecs=" << count;
+  *buflen = total;
+
+  ssize_t bytes = recvWithTimestamps(vec, count);
+  if (bytes < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // No more data to read right now.
+      return ReadResult(READ_BLOCKING);
+    } else {
+      return ReadResult(READ_ERROR);
+    }
+  }
+
+  size_t remaining = size_t(bytes);
+  size_t n = std::min(remaining, vec[0].iov_len);
+  queue.postallocate(n);
+  remaining -= n;
+  size_t used = 0;
+  while (remaining > 0) {
+    auto& buf = readvBufs_[used++];
+    n = std::min(remaining, vec[used].iov_len);
+    buf->append(n);
+    remaining -= n;
+    queue.append(std::move(buf));
+  }
+  readvBufs_.erase(readvBufs_.begin(), readvBufs_.begin() + used);
+
+  appBytesReceived_ += size_t(bytes);
+  return ReadResult(bytes);
+}
+
+ssize_t AsyncSocket::recvWithTimestamps(iovec* vec, size_t count) {
+  struct msghdr msg;
+  msg.msg_name = nullptr;
+  msg.msg_namelen = 0;
+  msg.msg_iov = vec;
+  msg.msg_iovlen = count;
+  msg.msg_control = nullptr;
+  msg.msg_controllen = 0;
+  msg.msg_flags = 0;
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  union {
+    cmsghdr align;
+    uint8_t buf[CMSG_SPACE(sizeof(scm_timestamping))];
+  } ctrl;
+  bool rxTimestamping = timestampFlags_ & kRxTimestampFlags;
+  if (rxTimestamping) {
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+  }
+#endif
+
+  ssize_t bytes = recvmsg(fd_, &msg, MSG_DONTWAIT);
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (bytes > 0 && rxTimestamping) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        timestamps_.push_back(makeTimestamp(
+            TimestampObserver::Event::RX,
+            appBytesReceived_,
+            *reinterpret_cast<const scm_timestamping*>(CMSG_DATA(cmsg))));
+      }
+    }
+  }
+#endif
+  return bytes;
+}
+
 void AsyncSocket::prepareReadBuffer(void** buf, size_t* buflen) {
   // no matter what, buffer should be preapared for non-ssl socket
   CHECK(readCallback_);
@@ -1727,62 +2328,143 @@ void AsyncSocket::handleErrMessages() noexcept {
   // supporting per-socket error queues.
   VLOG(5) << "AsyncSocket::handleErrMessages() this=" << this << ", fd=" << fd_
           << ", state=" << state_;
-  if (errMessageCallback_ == nullptr && idZeroCopyBufPtrMap_.empty()) {
+  if (errMessageCallback_ == nullptr && idZeroCopyBufPtrMap_.empty() &&
+      timestampObserver_ == nullptr) {
     VLOG(7) << "AsyncSocket::handleErrMessages(): "
             << "no callback installed - exiting.";
     return;
   }
 
 #ifdef FOLLY_HAVE_MSG_ERRQUEUE
-  uint8_t ctrl[1024];
-  unsigned char data;
-  struct msghdr msg;
-  iovec entry;
-
-  entry.iov_base = &data;
-  entry.iov_len = sizeof(data);
-  msg.msg_iov = &entry;
-  msg.msg_iovlen = 1;
-  msg.msg_name = nullptr;
-  msg.msg_namelen = 0;
-  msg.msg_control = ctrl;
-  msg.msg_controllen = sizeof(ctrl);
-  msg.msg_flags = 0;
+  uint8_t ctrl[kErrMessageBatch][1024];
+  unsigned char data[kErrMessageBatch];
+  iovec entries[kErrMessageBatch];
+  struct mmsghdr msgs[kErrMessageBatch];
 
   int ret;
   while (true) {
-    ret = recvmsg(fd_, &msg, MSG_ERRQUEUE);
-    VLOG(5) << "AsyncSocket::handleErrMessages(): recvmsg returned " << ret;
+    for (size_t i = 0; i < kErrMessageBatch; ++i) {
+      entries[i].iov_base = &data[i];
+      entries[i].iov_len = sizeof(data[i]);
+      struct msghdr& msg = msgs[i].msg_hdr;
+      msg.msg_iov = &entries[i];
+      msg.msg_iovlen = 1;
+      msg.msg_name = nullptr;
+      msg.msg_namelen = 0;
+      msg.msg_control = ctrl[i];
+      msg.msg_controllen = sizeof(ctrl[i]);
+      msg.msg_flags = 0;
+    }
+
+    ret = recvmmsg(fd_, msgs, kErrMessageBatch, MSG_ERRQUEUE, nullptr);
+    VLOG(5) << "AsyncSocket::handleErrMessages(): recvmmsg returned " << ret;
 
     if (ret < 0) {
       if (errno != EAGAIN) {
         auto errnoCopy = errno;
-        LOG(ERROR) << "::recvmsg exited with code " << ret
+        LOG(ERROR) << "::recvmmsg exited with code " << ret
                    << ", errno: " << errnoCopy;
         AsyncSocketException ex(
           AsyncSocketException::INTERNAL_ERROR,
-          withAddr("recvmsg() failed"),
+          withAddr("recvmmsg() failed"),
           errnoCopy);
         failErrMessageRead(__func__, ex);
       }
       return;
     }
 
-    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
-         cmsg != nullptr && cmsg->cmsg_len != 0;
-         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-      if (isZeroCopyMsg(*cmsg)) {
-        processZeroCopyMsg(*cmsg);
-      } else {
-        if (errMessageCallback_) {
-          errMessageCallback_->errMessage(*cmsg);
+    for (int i = 0; i < ret; ++i) {
+      handleErrMessage(msgs[i].msg_hdr);
+    }
+    if (size_t(ret) < kErrMessageBatch) {
+      // The queue is empty
+      return;
+    }
+  }
+#endif // FOLLY_HAVE_MSG_ERRQUEUE
+}
+
+void AsyncSocket::handleErrMessage(msghdr& msg) noexcept {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  // A TX timestamp comes as an SCM_TIMESTAMPING message, followed by the
+  // error that says which write it is for
+  const scm_timestamping* tss = nullptr;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+       cmsg != nullptr && cmsg->cmsg_len != 0;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (isZeroCopyMsg(*cmsg)) {
+      processZeroCopyMsg(*cmsg);
+      continue;
+    }
+
+    if (timestampObserver_) {
+      if (cmsg->cmsg_level == SOL_SOCKET &&
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        tss = reinterpret_cast<const scm_timestamping*>(CMSG_DATA(cmsg));
+        continue;
+      }
+      if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+          (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        const struct sock_extended_err* serr =
+            reinterpret_cast<const struct sock_extended_err*>(
+                CMSG_DATA(cmsg));
+        if (serr->ee_errno == ENOMSG &&
+            serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+          TimestampObserver::Event event;
+          switch (serr->ee_info) {
+            case SCM_TSTAMP_SCHED:
+              event = TimestampObserver::Event::SCHED;
+              break;
+            case SCM_TSTAMP_SND:
+              event = TimestampObserver::Event::TX;
+              break;
+            case SCM_TSTAMP_ACK:
+              event = TimestampObserver::Event::ACK;
+              break;
+            default:
+              tss = nullptr;
+              continue;
+          }
+          if (tss) {
+            // ee_data is the number, modulo 2^32, of the last byte of the
+            // write, and it is less than 2^32 bytes behind what we wrote
+            uint64_t written = getRawBytesWritten() - timestampBase_;
+            uint64_t end =
+                written - uint32_t(uint32_t(written) - (serr->ee_data + 1));
+            timestamps_.push_back(
+                makeTimestamp(event, timestampBase_ + end, *tss));
+            tss = nullptr;
+          }
+          continue;
         }
       }
     }
+
+    if (errMessageCallback_) {
+      errMessageCallback_->errMessage(*cmsg);
+    }
   }
+#else
+  (void)msg;
 #endif // FOLLY_HAVE_MSG_ERRQUEUE
 }
 
+void AsyncSocket::deliverTimestamps() noexcept {
+  if (!timestampObserver_) {
+    timestamps_.clear();
+    return;
+  }
+  // The observer may turn timestamping off
+  auto timestamps = std::move(timestamps_);
+  timestamps_.clear();
+  timestampObserver_->timestampsReceived(this, timestamps);
+  if (timestamps_.empty()) {
+    // Keep the capacity
+    timestamps.clear();
+    timestamps_.swap(timestamps);
+  }
+}
+
 void AsyncSocket::handleRead() noexcept {
   VLOG(5) << "AsyncSocket::handleRead() this=" << this << ", fd=" << fd_
           << ", state=" << state_;
@@ -1812,40 +2494,72 @@ void AsyncSocket::handleRead() noexcept {
   uint16_t numReads = 0;
   EventBase* originalEventBase = eventBase_;
   while (readCallback_ && eventBase_ == originalEventBase) {
+    // QueueReadCallbacks are read into with readv() where possible, and
+    // don't need getReadBuffer().  Pre-received data still goes through
+    // performRead() though.
+    auto queueCallback = readCallback_->asQueueReadCallback();
+    if (queueCallback &&
+        (isBufferMovable_ || !supportsVectoredReads() ||
+         (preReceivedData_ && !preReceivedData_->empty()))) {
+      queueCallback = nullptr;
+    }
+
     // Get the buffer to read into.
     void* buf = nullptr;
     size_t buflen = 0, offset = 0;
-    try {
-      prepareReadBuffer(&buf, &buflen);
-      VLOG(5) << "prepareReadBuffer() buf=" << buf << ", buflen=" << buflen;
-    } catch (const AsyncSocketException& ex) {
-      return failRead(__func__, ex);
-    } catch (const std::exception& ex) {
-      AsyncSocketException tex(AsyncSocketException::BAD_ARGS,
-                              string("ReadCallback::getReadBuffer() "
-                                     "threw exception: ") +
-                              ex.what());
-      return failRead(__func__, tex);
-    } catch (...) {
-      AsyncSocketException ex(AsyncSocketException::BAD_ARGS,
-                             "ReadCallback::getReadBuffer() threw "
-                             "non-exception type");
-      return failRead(__func__, ex);
-    }
-    if (!isBufferMovable_ && (buf == nullptr || buflen == 0)) {
-      AsyncSocketException ex(AsyncSocketException::BAD_ARGS,
-                             "ReadCallback::getReadBuffer() returned "
-                             "empty buffer");
-      return failRead(__func__, ex);
+    size_t bufferSize = 0;
+    if (queueCallback) {
+      bufferSize = queueCallback->readBufferSize();
+      if (readvSize_ == 0) {
+        readvSize_ = bufferSize;
+      }
+      buflen = readvSize_;
+    } else {
+      try {
+        prepareReadBuffer(&buf, &buflen);
+        VLOG(5) << "prepareReadBuffer() buf=" << buf << ", buflen=" << buflen;
+      } catch (const AsyncSocketException& ex) {
+        return failRead(__func__, ex);
+      } catch (const std::exception& ex) {
+        AsyncSocketException tex(AsyncSocketException::BAD_ARGS,
+                                string("ReadCallback::getReadBuffer() "
+                                       "threw exception: ") +
+                                ex.what());
+        return failRead(__func__, tex);
+      } catch (...) {
+        AsyncSocketException ex(AsyncSocketException::BAD_ARGS,
+                               "ReadCallback::getReadBuffer() threw "
+                               "non-exception type");
+        return failRead(__func__, ex);
+      }
+      if (!isBufferMovable_ && (buf == nullptr || buflen == 0)) {
+        AsyncSocketException ex(AsyncSocketException::BAD_ARGS,
+                               "ReadCallback::getReadBuffer() returned "
+                               "empty buffer");
+        return failRead(__func__, ex);
+      }
     }
 
     // Perform the read
-    auto readResult = performRead(&buf, &buflen, &offset);
+    auto readResult = queueCallback
+        ? performReadv(queueCallback->readQueue(), &buflen, bufferSize)
+        : performRead(&buf, &buflen, &offset);
     auto bytesRead = readResult.readReturn;
     VLOG(4) << "this=" << this << ", AsyncSocket::handleRead() got "
             << bytesRead << " bytes";
     if (bytesRead > 0) {
-      if (!isBufferMovable_) {
+      if (queueCallback) {
+        // Read more at once while reads fill all we ask for, and back off
+        // when they get little of it.
+        if (size_t(bytesRead) == buflen) {
+          readvSize_ = std::min(
+              std::max(readvSize_ * 2, bufferSize),
+              queueCallback->maxReadSize());
+        } else if (size_t(bytesRead) < readvSize_ / 4) {
+          readvSize_ = std::max(readvSize_ / 2, bufferSize);
+        }
+        queueCallback->readQueueAvailable(size_t(bytesRead));
+      } else if (!isBufferMovable_) {
         readCallback_->readDataAvailable(size_t(bytesRead));
       } else {
         CHECK(kOpenSslModeMoveBufferOwnership);
@@ -2287,6 +3001,51 @@ AsyncSocket::sendSocketMessage(int fd, struct msghdr* msg, int msg_flags) {
   return WriteResult(totalWritten);
 }
 
+bool AsyncSocket::supportsSendFile() const {
+  return sendFileSupported;
+}
+
+AsyncSocket::WriteResult
+AsyncSocket::performSendFile(int fd, off_t* offset, size_t len, bool isPipe) {
+#ifdef __linux__
+  ssize_t bytes = isPipe
+      ? splice(fd, nullptr, fd_, nullptr, len,
+               SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+      : sendfile(fd_, fd, offset, len);
+  VLOG(5) << "AsyncSocket::performSendFile() this=" << this << ", len=" << len
+          << ", sent " << bytes;
+  if (bytes < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return WriteResult(0);
+    }
+    return WriteResult(
+        WRITE_ERROR,
+        std::make_unique<AsyncSocketException>(
+            AsyncSocketException::INTERNAL_ERROR,
+            withAddr(isPipe ? "splice() failed" : "sendfile() failed"),
+            errno));
+  } else if (bytes == 0 && len > 0) {
+    return WriteResult(
+        WRITE_ERROR,
+        std::make_unique<AsyncSocketException>(
+            AsyncSocketException::END_OF_FILE,
+            withAddr("sendFile() input ended early")));
+  }
+  appBytesWritten_ += size_t(bytes);
+  return WriteResult(bytes);
+#else
+  (void)fd;
+  (void)offset;
+  (void)len;
+  (void)isPipe;
+  return WriteResult(
+      WRITE_ERROR,
+      std::make_unique<AsyncSocketException>(
+          AsyncSocketException::NOT_SUPPORTED,
+          withAddr("sendfile() not supported")));
+#endif
+}
+
 AsyncSocket::WriteResult AsyncSocket::performWrite(
     const iovec* vec,
     uint32_t count,
@@ -2560,6 +3319,7 @@ void AsyncSocket::failAllWrites(const AsyncSocketException& ex) {
   // Invoke writeError() on all write callbacks.
   // This is used when writes are forcibly shutdown with write requests
   // pending, or when an error occurs with writes pending.
+  coalescedWrites_ = 0;
   while (writeReqHead_ != nullptr) {
     WriteRequest* req = writeReqHead_;
     writeReqHead_ = req->getNext();
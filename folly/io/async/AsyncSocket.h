@@ -33,6 +33,7 @@
 #include <chrono>
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace folly {
 
@@ -143,6 +144,55 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
     virtual void errMessageError(const AsyncSocketException& ex) noexcept = 0;
   };
 
+  /**
+   * Receives the kernel timestamps of the bytes sent and received, see
+   * setTimestamping().
+   */
+  class TimestampObserver {
+   public:
+    enum class Event : uint8_t {
+      SCHED, // the write entered the packet scheduler
+      TX, // the write was handed to the NIC (software) or sent (hardware)
+      ACK, // the peer acknowledged the last byte of the write
+      RX, // the read was received
+    };
+
+    struct Timestamp {
+      Event event;
+      /**
+       * Offset in the byte stream, counting from the first byte ever sent
+       * (resp. received) on the socket.  For TX events, the offset right
+       * after the last byte of the write, i.e. the total number of bytes
+       * passed to write*() up to and including that write; for RX, the
+       * offset of the first byte of the read.
+       */
+      uint64_t byteOffset;
+      // Zero if not reported
+      std::chrono::nanoseconds software; // CLOCK_REALTIME
+      std::chrono::nanoseconds hardware; // the NIC clock
+    };
+
+    virtual ~TimestampObserver() = default;
+
+    /**
+     * Invoked with the timestamps received since the last call, once the
+     * socket is done handling its current I/O event.
+     */
+    virtual void timestampsReceived(
+        AsyncSocket* socket,
+        const std::vector<Timestamp>& timestamps) noexcept = 0;
+  };
+
+  struct TimestampOptions {
+    bool sched{false};
+    bool tx{false};
+    bool ack{true};
+    bool rx{true};
+    // Also ask for NIC timestamps, if it was configured for them
+    // (SIOCSHWTSTAMP)
+    bool hardware{false};
+  };
+
   class SendMsgParamsCallback {
    public:
     virtual ~SendMsgParamsCallback() = default;
@@ -514,6 +564,24 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
     return zeroCopyBufId_;
   }
 
+  /**
+   * Coalesce the writes of a loop iteration (off by default).
+   *
+   * The first write of an iteration is sent right away, as usual.  Writes
+   * that follow it in the same iteration are queued, and sent together at
+   * the end of the iteration with one writev() (as long as IOV_MAX allows),
+   * instead of one each: small responses written back to back then go out
+   * in full packets, with fewer system calls.  EOR and zero copy writes
+   * are not held back.
+   */
+  void setWriteCoalescing(bool enabled) {
+    writeCoalescing_ = enabled;
+  }
+
+  bool getWriteCoalescing() const {
+    return writeCoalescing_;
+  }
+
   void write(WriteCallback* callback, const void* buf, size_t bytes,
              WriteFlags flags = WriteFlags::NONE) override;
   void writev(WriteCallback* callback, const iovec* vec, size_t count,
@@ -522,6 +590,24 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
                   std::unique_ptr<folly::IOBuf>&& buf,
                   WriteFlags flags = WriteFlags::NONE) override;
 
+  /**
+   * Write len bytes of the file fd, starting at offset, without copying them
+   * through user space: with sendfile() for files, and splice() for pipes.
+   * An offset of -1 reads from (and advances) the current position of fd,
+   * and is the only one pipes accept.  Only send as much of a pipe as is
+   * already in it (as AsyncPipeReader::spliceTo() does), since the socket
+   * only waits to be writable.  fd must stay open until the callback is
+   * invoked.
+   *
+   * The write is queued behind earlier ones, fails with them, and invokes
+   * the callback just like writeChain().  When the file can't be handed to
+   * the kernel (on other platforms, while a TCP Fast Open is in progress,
+   * or when the transport has to transform the bytes, like AsyncSSLSocket)
+   * it is read 64KB at a time and written with performWrite() instead.
+   */
+  void sendFile(WriteCallback* callback, int fd, off_t offset, size_t len,
+                WriteFlags flags = WriteFlags::NONE);
+
   class WriteRequest;
   virtual void writeRequest(WriteRequest* req);
   void writeRequestReady() {
@@ -666,6 +752,44 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
    */
   int setQuickAck(bool quickack);
 
+  /*
+   * Lets the kernel busy poll the device queue for up to timeout when a
+   * read finds no data (SO_BUSY_POLL), see EventBase::setBusyPoll().
+   * Raising it above net.core.busy_read may require CAP_NET_ADMIN.
+   *
+   * @return Returns 0 if the SO_BUSY_POLL option was successfully updated,
+   *         or a non-zero errno value on error.
+   */
+  int setBusyPoll(std::chrono::microseconds timeout);
+
+  /*
+   * Asks the kernel to timestamp the writes and reads of this socket
+   * (SO_TIMESTAMPING), and reports the timestamps to observer; nullptr
+   * turns timestamping off.  The socket must be connected.
+   *
+   * TX timestamps identify writes by the offset right after their last
+   * byte, so they can be matched with the writeChain() calls that made
+   * them; a write that the kernel splits between sendmsg() calls gets a
+   * timestamp for each part.  Like ErrMessageCallback messages, they are
+   * read from the error queue (in batches) only while the socket waits for
+   * reads or writes, and the ErrMessageCallback doesn't see them anymore.
+   * RX timestamps only cover the reads made by AsyncSocket itself, not by
+   * AsyncSSLSocket.
+   *
+   * @return Returns 0 if timestamping was successfully updated, or a
+   *         non-zero errno value on error.
+   */
+  int setTimestamping(
+      TimestampObserver* observer,
+      const TimestampOptions& options);
+  int setTimestamping(TimestampObserver* observer) {
+    return setTimestamping(observer, TimestampOptions());
+  }
+
+  TimestampObserver* getTimestampObserver() const {
+    return timestampObserver_;
+  }
+
   /**
    * Set the send bufsize
    */
@@ -943,6 +1067,7 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
   };
 
   class BytesWriteRequest;
+  class FileWriteRequest;
 
   class WriteTimeout : public AsyncTimeout {
    public:
@@ -988,6 +1113,23 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
     AsyncSocket* socket_;
   };
 
+  class WriteFlusher : public folly::EventBase::LoopCallback {
+   public:
+    explicit WriteFlusher(AsyncSocket* socket) : socket_(socket) {}
+    void runLoopCallback() noexcept override {
+      DestructorGuard dg(socket_);
+      socket_->wroteInLoop_ = false;
+      socket_->flushCoalescedWrites();
+    }
+   private:
+    AsyncSocket* socket_;
+  };
+
+  /**
+   * Sends the writes held back by write coalescing.
+   */
+  void flushCoalescedWrites() noexcept;
+
   /**
    * Schedule checkForImmediateRead to be executed in the next loop
    * iteration.
@@ -1018,6 +1160,8 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
   virtual void handleInitialReadWrite() noexcept;
   virtual void prepareReadBuffer(void** buf, size_t* buflen);
   virtual void handleErrMessages() noexcept;
+  void handleErrMessage(msghdr& msg) noexcept;
+  void deliverTimestamps() noexcept;
   virtual void handleRead() noexcept;
   virtual void handleWrite() noexcept;
   virtual void handleConnect() noexcept;
@@ -1033,6 +1177,31 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
    */
   virtual ReadResult performRead(void** buf, size_t* buflen, size_t* offset);
 
+  /**
+   * Attempt to read up to *buflen bytes from the socket with one syscall,
+   * into the tailroom of queue and then as many buffers of bufferSize bytes
+   * as needed, and append them to queue.  *buflen is updated to how much
+   * could be asked for, with a limited number of buffers.
+   *
+   * @return Returns a read result. See read result for details.
+   */
+  virtual ReadResult
+  performReadv(IOBufQueue& queue, size_t* buflen, size_t bufferSize);
+
+  // recvmsg() into vec, collecting the RX timestamp if timestamping is on
+  ssize_t recvWithTimestamps(iovec* vec, size_t count);
+
+  /**
+   * Whether handleRead() may read straight from the socket into the queue
+   * of a QueueReadCallback with performReadv().  Transports that transform
+   * the bytes read from the socket (like AsyncSSLSocket) return false, and
+   * QueueReadCallbacks are then handed one buffer at a time through
+   * getReadBuffer().
+   */
+  virtual bool supportsVectoredReads() const {
+    return true;
+  }
+
   /**
    * Populate an iovec array from an IOBuf and attempt to write it.
    *
@@ -1067,6 +1236,12 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
                  std::unique_ptr<folly::IOBuf>&& buf,
                  WriteFlags flags = WriteFlags::NONE);
 
+  /**
+   * Append req to the write queue, and register for write events (and
+   * schedule the send timeout) if mustRegister.
+   */
+  void queueWriteRequest(WriteRequest* req, bool mustRegister);
+
   /**
    * Attempt to write to the socket.
    *
@@ -1089,6 +1264,24 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
       uint32_t* countWritten,
       uint32_t* partialWritten);
 
+  /**
+   * Attempt to send up to len bytes of fd with sendfile(), or with splice()
+   * if isPipe.  *offset is advanced by what was sent; if offset is null, the
+   * file position of fd is.
+   *
+   * @return Returns a WriteResult, with a writeReturn of 0 if the socket
+   *         would block. See WriteResult for more details.
+   */
+  virtual WriteResult
+  performSendFile(int fd, off_t* offset, size_t len, bool isPipe);
+
+  /**
+   * Whether sendFile() may use performSendFile().  Transports that transform
+   * the bytes they write return false, and sendFile() then goes through
+   * performWrite().
+   */
+  virtual bool supportsSendFile() const;
+
   /**
    * Sends the message over the socket using sendmsg
    *
@@ -1190,12 +1383,19 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
 
   bool isBufferMovable_{false};
 
+  // How much the next performReadv() call for a QueueReadCallback reads,
+  // adapted to how much the previous ones got; 0 until the first one.
+  size_t readvSize_{0};
+  // Buffers that performReadv() allocated but didn't get to fill
+  std::vector<std::unique_ptr<IOBuf>> readvBufs_;
+
   int8_t readErr_{READ_NO_ERROR}; ///< The read error encountered, if any
 
   EventBase* eventBase_;                 ///< The EventBase
   WriteTimeout writeTimeout_;            ///< A timeout for connect and write
   IoHandler ioHandler_;                  ///< A EventHandler to monitor the fd
   ImmediateReadCB immediateReadHandler_; ///< LoopCallback for checking read
+  WriteFlusher writeFlusher_;            ///< LoopCallback for coalesced writes
 
   ConnectCallback* connectCallback_;     ///< ConnectCallback
   ErrMessageCallback* errMessageCallback_; ///< TimestampCallback
@@ -1229,6 +1429,19 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
   bool trackEor_{false};
   bool zeroCopyEnabled_{false};
   bool zeroCopyVal_{false};
+
+  bool writeCoalescing_{false};
+  // Whether a write was sent in this loop iteration, with write coalescing
+  bool wroteInLoop_{false};
+  // Number of writes held back, at the head of the write queue
+  uint32_t coalescedWrites_{0};
+
+  TimestampObserver* timestampObserver_{nullptr};
+  // Not yet passed to timestampObserver_
+  std::vector<TimestampObserver::Timestamp> timestamps_;
+  // Bytes acknowledged when the kernel started numbering TX timestamps
+  size_t timestampBase_{0};
+  uint32_t timestampFlags_{0};
 };
 #ifdef _MSC_VER
 #pragma vtordisp(pop)
@@ -87,6 +87,13 @@ bool AsyncTimeout::scheduleTimeout(uint32_t milliseconds) {
   return scheduleTimeout(TimeoutManager::timeout_type(milliseconds));
 }
 
+bool AsyncTimeout::scheduleTimeoutHighRes(
+    TimeoutManager::timeout_type_high_res timeout) {
+  assert(timeoutManager_ != nullptr);
+  context_ = RequestContext::saveContext();
+  return timeoutManager_->scheduleTimeoutHighRes(this, timeout);
+}
+
 void AsyncTimeout::cancelTimeout() {
   if (isScheduled()) {
     timeoutManager_->cancelTimeout(this);
@@ -148,7 +155,11 @@ void AsyncTimeout::libeventCallback(libevent_fd_t fd, short events, void* arg) {
 
   RequestContextScopeGuard rctx(timeout->context_);
 
-  timeout->timeoutExpired();
+  EventBaseLoopProfiler::profile(
+      timeout->timeoutManager_->getLoopProfiler(),
+      EventBaseLoopProfiler::Phase::TIMER,
+      &typeid(*timeout),
+      [&] { timeout->timeoutExpired(); });
 }
 
 } // namespace folly
@@ -98,6 +98,12 @@ class AsyncTimeout : private boost::noncopyable {
   bool scheduleTimeout(uint32_t milliseconds);
   bool scheduleTimeout(TimeoutManager::timeout_type timeout);
 
+  /**
+   * Like scheduleTimeout(), with microsecond resolution if the
+   * TimeoutManager supports it (EventBase does).
+   */
+  bool scheduleTimeoutHighRes(TimeoutManager::timeout_type_high_res timeout);
+
   /**
    * Cancel the timeout, if it is running.
    */
@@ -19,6 +19,7 @@
 #include <memory>
 
 #include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncSocketBase.h>
 #include <folly/io/async/DelayedDestruction.h>
 #include <folly/io/async/EventBase.h>
@@ -447,6 +448,8 @@ class AsyncTransport : public DelayedDestruction, public AsyncSocketBase {
 
 class AsyncReader {
  public:
+  class QueueReadCallback;
+
   class ReadCallback {
    public:
     virtual ~ReadCallback() = default;
@@ -570,6 +573,80 @@ class AsyncReader {
      * @param ex        An exception describing the error that occurred.
      */
     virtual void readErr(const AsyncSocketException& ex) noexcept = 0;
+
+    /**
+     * Returns this callback if it is a QueueReadCallback, so that transports
+     * that can read into several buffers at once know to do so.
+     */
+    virtual QueueReadCallback* asQueueReadCallback() noexcept {
+      return nullptr;
+    }
+  };
+
+  /**
+   * A ReadCallback that owns an IOBufQueue, which the transport appends the
+   * data it reads to.
+   *
+   * Transports that support it (AsyncSocket does) fill several buffers with
+   * each read syscall, using readv(), and append them all to readQueue()
+   * without copying.  How much they read at once adapts between
+   * readBufferSize() and maxReadSize(): it grows while reads fill all of it,
+   * and shrinks back when they don't.  Other transports go through
+   * getReadBuffer() and readDataAvailable(), which this class implements
+   * with readQueue().preallocate() and postallocate(), so a
+   * QueueReadCallback works with any transport.
+   *
+   * In both cases readQueueAvailable() is then invoked, with the number of
+   * bytes just appended.  It has the same timing and aftereffects as
+   * readDataAvailable(), and is expected to consume data from readQueue().
+   */
+  class QueueReadCallback : public ReadCallback {
+   public:
+    QueueReadCallback() : readQueue_(IOBufQueue::cacheChainLength()) {}
+
+    IOBufQueue& readQueue() {
+      return readQueue_;
+    }
+
+    /**
+     * readQueueAvailable() will be invoked when len bytes have been
+     * appended to readQueue().
+     */
+    virtual void readQueueAvailable(size_t len) noexcept = 0;
+
+    /**
+     * Size of the buffers that are allocated to read into, and the least
+     * that is read at once.
+     */
+    virtual size_t readBufferSize() const {
+      return 16 * 1024; // 16K
+    }
+
+    /**
+     * The most that is read with one readv() call, when reads keep filling
+     * all the buffers they are given.
+     */
+    virtual size_t maxReadSize() const {
+      return 256 * 1024; // 256K
+    }
+
+    void getReadBuffer(void** bufReturn, size_t* lenReturn) final {
+      auto data = readQueue_.preallocate(readBufferSize(), readBufferSize());
+      *bufReturn = data.first;
+      *lenReturn = size_t(data.second);
+    }
+
+    void readDataAvailable(size_t len) noexcept final {
+      readQueue_.postallocate(len);
+      readQueueAvailable(len);
+    }
+
+    QueueReadCallback* asQueueReadCallback() noexcept final {
+      return this;
+    }
+
+   private:
+    IOBufQueue readQueue_;
   };
 
   // Read methods that aren't part of AsyncTransport.
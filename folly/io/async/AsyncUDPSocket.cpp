@@ -24,6 +24,9 @@
 
 #include <errno.h>
 
+#include <algorithm>
+#include <vector>
+
 // Due to the way kernel headers are included, this may or may not be defined.
 // Number pulled from 3.10 kernel headers.
 #ifndef SO_REUSEPORT
@@ -34,6 +37,118 @@ namespace fsp = folly::portability::sockets;
 
 namespace folly {
 
+namespace {
+
+// Datagrams per ::sendmmsg() call, and the iovecs they share.  Both are
+// kept on the stack.
+constexpr size_t kMaxSendBatch = 64;
+constexpr size_t kMaxSendIovecs = 512;
+
+#ifdef __linux__
+// Big enough for a UDP_SEGMENT or UDP_GRO control message
+union ControlBuffer {
+  char buf[CMSG_SPACE(sizeof(int))];
+  struct cmsghdr align;
+};
+
+void setGSOControl(struct msghdr* msg, ControlBuffer* control, int gsoSize) {
+  msg->msg_control = control->buf;
+  msg->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+  struct cmsghdr* cm = CMSG_FIRSTHDR(msg);
+  cm->cmsg_level = SOL_UDP;
+  cm->cmsg_type = UDP_SEGMENT;
+  cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  auto value = uint16_t(gsoSize);
+  memcpy(CMSG_DATA(cm), &value, sizeof(value));
+}
+
+// The segment size of a coalesced read, or 0 if it wasn't coalesced
+size_t getGROSize(struct msghdr* msg) {
+  for (struct cmsghdr* cm = CMSG_FIRSTHDR(msg); cm != nullptr;
+       cm = CMSG_NXTHDR(msg, cm)) {
+    if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+      int value;
+      memcpy(&value, CMSG_DATA(cm), sizeof(value));
+      return value > 0 ? size_t(value) : 0;
+    }
+  }
+  return 0;
+}
+#else
+struct ControlBuffer {};
+#endif
+
+} // namespace
+
+struct AsyncUDPSocket::ReadBatch {
+  ReadBatch(size_t numReads, size_t bufferSize)
+      : data(new uint8_t[numReads * bufferSize]),
+        bufferSize(bufferSize),
+        msgs(numReads),
+        iovs(numReads),
+        addrs(numReads),
+        control(numReads) {
+    for (size_t i = 0; i < numReads; ++i) {
+      iovs[i].iov_base = data.get() + i * bufferSize;
+      iovs[i].iov_len = bufferSize;
+      auto& hdr = msgs[i].msg_hdr;
+      hdr.msg_name = &addrs[i];
+      hdr.msg_iov = &iovs[i];
+      hdr.msg_iovlen = 1;
+    }
+  }
+
+  // Reset the fields the kernel overwrites
+  void reset() {
+    for (size_t i = 0; i < msgs.size(); ++i) {
+      auto& hdr = msgs[i].msg_hdr;
+      hdr.msg_namelen = sizeof(addrs[i]);
+#ifdef __linux__
+      hdr.msg_control = control[i].buf;
+      hdr.msg_controllen = sizeof(control[i].buf);
+#else
+      hdr.msg_control = nullptr;
+      hdr.msg_controllen = 0;
+#endif
+      hdr.msg_flags = 0;
+      msgs[i].msg_len = 0;
+    }
+  }
+
+  std::unique_ptr<uint8_t[]> data;
+  size_t bufferSize;
+  std::vector<struct mmsghdr> msgs;
+  std::vector<struct iovec> iovs;
+  std::vector<struct sockaddr_storage> addrs;
+  std::vector<ControlBuffer> control;
+};
+
+void AsyncUDPSocket::ReadCallback::onDatagramAvailable(
+    const folly::SocketAddress& client,
+    folly::ByteRange data,
+    bool truncated) noexcept {
+  void* buf{nullptr};
+  size_t len{0};
+
+  getReadBuffer(&buf, &len);
+  if (buf == nullptr || len == 0) {
+    // Unlike with unbatched reads the callback stays installed, only this
+    // datagram is dropped
+    AsyncSocketException ex(
+        AsyncSocketException::BAD_ARGS,
+        "AsyncUDPSocket::getReadBuffer() returned empty buffer");
+    onReadError(ex);
+    return;
+  }
+
+  if (data.size() > len) {
+    truncated = true;
+    data = data.subpiece(0, len);
+  }
+  memcpy(buf, data.data(), data.size());
+  onDataAvailable(client, data.size(), truncated);
+}
+
 AsyncUDPSocket::AsyncUDPSocket(EventBase* evb)
     : EventHandler(CHECK_NOTNULL(evb)),
       readCallback_(nullptr),
@@ -160,8 +275,30 @@ ssize_t AsyncUDPSocket::write(const folly::SocketAddress& address,
   return writev(address, vec, iovec_len);
 }
 
+ssize_t AsyncUDPSocket::writeGSO(const folly::SocketAddress& address,
+                                 const std::unique_ptr<folly::IOBuf>& buf,
+                                 int gsoSize) {
+  iovec vec[16];
+  size_t iovec_len = buf->fillIov(vec, sizeof(vec)/sizeof(vec[0]));
+  if (UNLIKELY(iovec_len == 0)) {
+    buf->coalesce();
+    vec[0].iov_base = const_cast<uint8_t*>(buf->data());
+    vec[0].iov_len = buf->length();
+    iovec_len = 1;
+  }
+
+  return writevImpl(address, vec, iovec_len, gsoSize);
+}
+
 ssize_t AsyncUDPSocket::writev(const folly::SocketAddress& address,
                                const struct iovec* vec, size_t iovec_len) {
+  return writevImpl(address, vec, iovec_len, 0);
+}
+
+ssize_t AsyncUDPSocket::writevImpl(const folly::SocketAddress& address,
+                                   const struct iovec* vec,
+                                   size_t iovec_len,
+                                   int gsoSize) {
   CHECK_NE(-1, fd_) << "Socket not yet bound";
 
   sockaddr_storage addrStorage;
@@ -176,9 +313,178 @@ ssize_t AsyncUDPSocket::writev(const folly::SocketAddress& address,
   msg.msg_controllen = 0;
   msg.msg_flags = 0;
 
+#ifdef __linux__
+  ControlBuffer control;
+  if (gsoSize > 0) {
+    setGSOControl(&msg, &control, gsoSize);
+  }
+#else
+  if (gsoSize > 0) {
+    errno = ENOTSUP;
+    return -1;
+  }
+#endif
+
   return sendmsg(fd_, &msg, 0);
 }
 
+int AsyncUDPSocket::writem(folly::Range<folly::SocketAddress const*> addrs,
+                           const std::unique_ptr<folly::IOBuf>* bufs,
+                           size_t count) {
+  return writemGSO(addrs, bufs, count, nullptr);
+}
+
+int AsyncUDPSocket::writemGSO(folly::Range<folly::SocketAddress const*> addrs,
+                              const std::unique_ptr<folly::IOBuf>* bufs,
+                              size_t count,
+                              const int* gso) {
+  CHECK_NE(-1, fd_) << "Socket not yet bound";
+  CHECK(addrs.size() == 1 || addrs.size() == count)
+      << "Need one address, or one per buffer";
+
+#ifndef __linux__
+  if (gso && std::any_of(gso, gso + count, [](int g) { return g > 0; })) {
+    errno = ENOTSUP;
+    return -1;
+  }
+#endif
+
+  struct mmsghdr msgs[kMaxSendBatch];
+  struct sockaddr_storage addrStorage[kMaxSendBatch];
+  struct iovec vec[kMaxSendIovecs];
+  ControlBuffer control[kMaxSendBatch];
+
+  size_t sent = 0;
+  while (sent < count) {
+    // Fill in as many messages as fit in one batch
+    size_t num = 0;
+    size_t iovecsUsed = 0;
+    while (sent + num < count && num < kMaxSendBatch) {
+      auto& buf = bufs[sent + num];
+      struct iovec* iov = vec + iovecsUsed;
+      size_t iovec_len = buf->fillIov(iov, kMaxSendIovecs - iovecsUsed);
+      if (UNLIKELY(iovec_len == 0)) {
+        if (num > 0) {
+          // send what we have first, it may fit in the next batch
+          break;
+        }
+        buf->coalesce();
+        iov->iov_base = const_cast<uint8_t*>(buf->data());
+        iov->iov_len = buf->length();
+        iovec_len = 1;
+      }
+      iovecsUsed += iovec_len;
+
+      auto& address = addrs.size() == 1 ? addrs[0] : addrs[sent + num];
+      address.getAddress(&addrStorage[num]);
+
+      struct msghdr& msg = msgs[num].msg_hdr;
+      msg.msg_name = reinterpret_cast<void*>(&addrStorage[num]);
+      msg.msg_namelen = address.getActualSize();
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iovec_len;
+      msg.msg_control = nullptr;
+      msg.msg_controllen = 0;
+      msg.msg_flags = 0;
+#ifdef __linux__
+      if (gso && gso[sent + num] > 0) {
+        setGSOControl(&msg, &control[num], gso[sent + num]);
+      }
+#endif
+      msgs[num].msg_len = 0;
+      ++num;
+    }
+
+    int ret = sendmmsg(fd_, msgs, (unsigned int)num, 0);
+    if (ret < 0) {
+      return sent > 0 ? int(sent) : -1;
+    }
+    sent += size_t(ret);
+    if (size_t(ret) < num) {
+      // the socket buffer is full
+      break;
+    }
+  }
+
+  return int(sent);
+}
+
+bool AsyncUDPSocket::setGSO(int gsoSize) {
+  CHECK_NE(-1, fd_) << "Socket not yet bound";
+#ifdef __linux__
+  if (setsockopt(fd_, SOL_UDP, UDP_SEGMENT, &gsoSize, sizeof(gsoSize)) != 0) {
+    return false;
+  }
+  gso_ = gsoSize;
+  return true;
+#else
+  (void)gsoSize;
+  return false;
+#endif
+}
+
+bool AsyncUDPSocket::setGRO(bool enable) {
+  CHECK_NE(-1, fd_) << "Socket not yet bound";
+#ifdef __linux__
+  int value = enable ? 1 : 0;
+  if (setsockopt(fd_, SOL_UDP, UDP_GRO, &value, sizeof(value)) != 0) {
+    return false;
+  }
+  gro_ = enable;
+  return true;
+#else
+  (void)enable;
+  return false;
+#endif
+}
+
+void AsyncUDPSocket::setNumReadsPerEvent(size_t numReads,
+                                         size_t readBufferSize) {
+  CHECK_GT(numReads, 0);
+  CHECK_GT(readBufferSize, 0);
+  if (numReads != numReadsPerEvent_ || readBufferSize != readBufferSize_) {
+    numReadsPerEvent_ = numReads;
+    readBufferSize_ = readBufferSize;
+    readBatch_.reset();
+  }
+}
+
+int AsyncUDPSocket::sendmmsg(int socket,
+                             struct mmsghdr* msgvec,
+                             unsigned int vlen,
+                             int flags) {
+#if defined(__linux__) || defined(__FreeBSD__)
+  return ::sendmmsg(socket, msgvec, vlen, flags);
+#else
+  for (unsigned int i = 0; i < vlen; ++i) {
+    ssize_t ret = sendmsg(socket, &msgvec[i].msg_hdr, flags);
+    if (ret < 0) {
+      return i > 0 ? int(i) : -1;
+    }
+    msgvec[i].msg_len = (unsigned int)ret;
+  }
+  return int(vlen);
+#endif
+}
+
+int AsyncUDPSocket::recvmmsg(int socket,
+                             struct mmsghdr* msgvec,
+                             unsigned int vlen,
+                             int flags) {
+#if defined(__linux__) || defined(__FreeBSD__)
+  return ::recvmmsg(socket, msgvec, vlen, flags, nullptr);
+#else
+  for (unsigned int i = 0; i < vlen; ++i) {
+    ssize_t ret = ::recvmsg(socket, &msgvec[i].msg_hdr, flags);
+    if (ret < 0) {
+      return i > 0 ? int(i) : -1;
+    }
+    msgvec[i].msg_len = (unsigned int)ret;
+  }
+  return int(vlen);
+#endif
+}
+
 void AsyncUDPSocket::resumeRead(ReadCallback* cob) {
   CHECK(!readCallback_) << "Another read callback already installed";
   CHECK_NE(-1, fd_) << "UDP server socket not yet bind to an address";
@@ -223,7 +529,11 @@ void AsyncUDPSocket::close() {
 void AsyncUDPSocket::handlerReady(uint16_t events) noexcept {
   if (events & EventHandler::READ) {
     DCHECK(readCallback_);
-    handleRead();
+    if (numReadsPerEvent_ > 1 || gro_) {
+      handleReadBatch();
+    } else {
+      handleRead();
+    }
   }
 }
 
@@ -256,16 +566,14 @@ void AsyncUDPSocket::handleRead() noexcept {
   if (bytesRead >= 0) {
     clientAddress_.setFromSockaddr(rawAddr, addrLen);
 
-    if (bytesRead > 0) {
-      bool truncated = false;
-      if ((size_t)bytesRead > len) {
-        truncated = true;
-        bytesRead = ssize_t(len);
-      }
-
-      readCallback_->onDataAvailable(
-          clientAddress_, size_t(bytesRead), truncated);
+    bool truncated = false;
+    if ((size_t)bytesRead > len) {
+      truncated = true;
+      bytesRead = ssize_t(len);
     }
+
+    readCallback_->onDataAvailable(
+        clientAddress_, size_t(bytesRead), truncated);
   } else {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
       // No data could be read without blocking the socket
@@ -275,18 +583,94 @@ void AsyncUDPSocket::handleRead() noexcept {
     AsyncSocketException ex(AsyncSocketException::INTERNAL_ERROR,
                            "::recvfrom() failed",
                            errno);
+    notifyReadError(ex);
+  }
+}
+
+void AsyncUDPSocket::handleReadBatch() noexcept {
+  // Own the batch while delivering it, in case the callback calls
+  // setNumReadsPerEvent()
+  auto batch = std::move(readBatch_);
+  if (!batch) {
+    batch = std::make_unique<ReadBatch>(numReadsPerEvent_, readBufferSize_);
+  }
+  SCOPE_EXIT {
+    if (!readBatch_ && batch->msgs.size() == numReadsPerEvent_ &&
+        batch->bufferSize == readBufferSize_) {
+      readBatch_ = std::move(batch);
+    }
+  };
+
+  batch->reset();
+  int ret = recvmmsg(
+      fd_, batch->msgs.data(), (unsigned int)batch->msgs.size(), MSG_TRUNC);
+  if (ret < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // No data could be read without blocking the socket
+      return;
+    }
+
+    AsyncSocketException ex(AsyncSocketException::INTERNAL_ERROR,
+                           "::recvmmsg() failed",
+                           errno);
+    notifyReadError(ex);
+    return;
+  }
 
-    // In case of UDP we can continue reading from the socket
-    // even if the current request fails. We notify the user
-    // so that he can do some logging/stats collection if he wants.
-    auto cob = readCallback_;
-    readCallback_ = nullptr;
+  for (int i = 0; i < ret && readCallback_; ++i) {
+    struct msghdr& hdr = batch->msgs[size_t(i)].msg_hdr;
+    clientAddress_.setFromSockaddr(
+        reinterpret_cast<sockaddr*>(hdr.msg_name), hdr.msg_namelen);
+
+    // With MSG_TRUNC msg_len is the real length of the datagram
+    size_t len = batch->msgs[size_t(i)].msg_len;
+    bool truncated = (hdr.msg_flags & MSG_TRUNC) != 0;
+    if (len > batch->bufferSize) {
+      truncated = true;
+      len = batch->bufferSize;
+    }
+    if (len == 0) {
+      // An empty datagram is still a datagram
+      readCallback_->onDatagramAvailable(
+          clientAddress_,
+          folly::ByteRange(
+              static_cast<const uint8_t*>(hdr.msg_iov->iov_base), size_t(0)),
+          false);
+      continue;
+    }
 
-    cob->onReadError(ex);
-    updateRegistration();
+    size_t segmentSize = len;
+#ifdef __linux__
+    if (gro_) {
+      if (size_t groSize = getGROSize(&hdr)) {
+        segmentSize = groSize;
+      }
+    }
+#endif
+
+    auto data = static_cast<const uint8_t*>(hdr.msg_iov->iov_base);
+    for (size_t offset = 0; offset < len && readCallback_;
+         offset += segmentSize) {
+      size_t segmentLen = std::min(segmentSize, len - offset);
+      readCallback_->onDatagramAvailable(
+          clientAddress_,
+          folly::ByteRange(data + offset, segmentLen),
+          truncated && offset + segmentLen == len);
+    }
   }
 }
 
+void AsyncUDPSocket::notifyReadError(const AsyncSocketException& ex) noexcept {
+  // In case of UDP we can continue reading from the socket
+  // even if the current request fails. We notify the user
+  // so that he can do some logging/stats collection if he wants.
+  auto cob = readCallback_;
+  readCallback_ = nullptr;
+
+  cob->onReadError(ex);
+  updateRegistration();
+}
+
 bool AsyncUDPSocket::updateRegistration() noexcept {
   uint16_t flags = NONE;
 
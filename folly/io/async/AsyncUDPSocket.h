@@ -18,6 +18,7 @@
 
 #include <memory>
 
+#include <folly/Range.h>
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBuf.h>
@@ -59,6 +60,20 @@ class AsyncUDPSocket : public EventHandler {
                                  size_t len,
                                  bool truncated) noexcept = 0;
 
+    /**
+     * Invoked instead of getReadBuffer() / onDataAvailable() for each
+     * datagram when the socket reads in batches (see setNumReadsPerEvent()
+     * and setGRO()).  `data` points into the socket's own receive buffers
+     * and is only valid for the duration of the call.
+     *
+     * The default implementation copies the datagram into the buffer
+     * returned by getReadBuffer() and calls onDataAvailable(), so existing
+     * callbacks keep working; override it to avoid the copy.
+     */
+    virtual void onDatagramAvailable(const folly::SocketAddress& client,
+                                     folly::ByteRange data,
+                                     bool truncated) noexcept;
+
     /**
      * Invoked when there is an error reading from the socket.
      *
@@ -121,6 +136,85 @@ class AsyncUDPSocket : public EventHandler {
   virtual ssize_t writev(const folly::SocketAddress& address,
                          const struct iovec* vec, size_t veclen);
 
+  /**
+   * Send the data in buffer to destination as a single UDP_SEGMENT (GSO)
+   * send: the kernel (or the NIC) splits it into datagrams of `gsoSize`
+   * bytes, the last one possibly shorter.  A `gsoSize` of 0 uses the
+   * socket's default (see setGSO()).  Returns the return code from ::sendmsg.
+   */
+  virtual ssize_t writeGSO(const folly::SocketAddress& address,
+                           const std::unique_ptr<folly::IOBuf>& buf,
+                           int gsoSize);
+
+  /**
+   * Send `count` datagrams with as few ::sendmmsg calls as possible.
+   * `addrs` either holds one address per buffer, or a single address that
+   * all of them are sent to.
+   *
+   * Returns the number of datagrams sent, which may be less than `count`
+   * if the socket buffer fills up, or -1 (with errno set) if the first one
+   * failed.
+   */
+  virtual int writem(folly::Range<folly::SocketAddress const*> addrs,
+                     const std::unique_ptr<folly::IOBuf>* bufs,
+                     size_t count);
+
+  /**
+   * Like writem(), but buffer i is sent as a GSO send with segment size
+   * gso[i] (see writeGSO()).  `gso` may be null.
+   */
+  virtual int writemGSO(folly::Range<folly::SocketAddress const*> addrs,
+                        const std::unique_ptr<folly::IOBuf>* bufs,
+                        size_t count,
+                        const int* gso);
+
+  /**
+   * Set the default GSO segment size for every send on this socket
+   * (UDP_SEGMENT, Linux 4.18+); 0 disables it.  Returns false if the kernel
+   * doesn't support it.  Must be bound first.
+   */
+  virtual bool setGSO(int gsoSize);
+
+  /**
+   * Default GSO segment size, or 0 if not set.
+   */
+  int getGSO() const {
+    return gso_;
+  }
+
+  /**
+   * Enable UDP receive offload (UDP_GRO, Linux 5.0+): the kernel may
+   * coalesce several datagrams from the same flow into one read, which is
+   * split up again before the read callback sees it.  Enabling it switches
+   * the socket to batched reads (see onDatagramAvailable()).  Returns false
+   * if the kernel doesn't support it.  Must be bound first.
+   */
+  virtual bool setGRO(bool enable);
+
+  bool getGRO() const {
+    return gro_;
+  }
+
+  /**
+   * Read up to `numReads` datagrams with a single ::recvmmsg each time the
+   * socket becomes readable, into `numReads` preallocated buffers of
+   * `readBufferSize` bytes owned by the socket.  Datagrams longer than
+   * that are truncated.  With GRO enabled a buffer holds a whole batch of
+   * coalesced datagrams, so it should be at least 64KB.
+   *
+   * A value of 1 (the default) reads one datagram per wakeup into the
+   * read callback's own buffer, unless GRO is on.
+   *
+   * In batched mode the read callback must not destroy the socket; closing
+   * it or pausing reads stops the delivery of the rest of the batch.
+   */
+  virtual void setNumReadsPerEvent(size_t numReads,
+                                   size_t readBufferSize = 2048);
+
+  size_t getNumReadsPerEvent() const {
+    return numReadsPerEvent_;
+  }
+
   /**
    * Start reading datagrams
    */
@@ -167,6 +261,16 @@ class AsyncUDPSocket : public EventHandler {
     return ::sendmsg(socket, message, flags);
   }
 
+  virtual int sendmmsg(int socket,
+                       struct mmsghdr* msgvec,
+                       unsigned int vlen,
+                       int flags);
+
+  virtual int recvmmsg(int socket,
+                       struct mmsghdr* msgvec,
+                       unsigned int vlen,
+                       int flags);
+
   // Non-null only when we are reading
   ReadCallback* readCallback_;
 
@@ -177,9 +281,16 @@ class AsyncUDPSocket : public EventHandler {
   // EventHandler
   void handlerReady(uint16_t events) noexcept override;
 
+  struct ReadBatch;
+
   void handleRead() noexcept;
+  void handleReadBatch() noexcept;
+  void notifyReadError(const AsyncSocketException& ex) noexcept;
   bool updateRegistration() noexcept;
 
+  ssize_t writevImpl(const folly::SocketAddress& address,
+                     const struct iovec* vec, size_t veclen, int gsoSize);
+
   EventBase* eventBase_;
   folly::SocketAddress localAddress_;
 
@@ -191,6 +302,15 @@ class AsyncUDPSocket : public EventHandler {
 
   bool reuseAddr_{true};
   bool reusePort_{false};
+
+  int gso_{0};
+  bool gro_{false};
+
+  size_t numReadsPerEvent_{1};
+  size_t readBufferSize_{2048};
+  // Receive buffers and message headers for batched reads, allocated on
+  // the first one and reused after that.
+  std::unique_ptr<ReadBatch> readBatch_;
 };
 
 } // namespace folly
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AtomicNotificationQueue.h>
+
+#include <glog/logging.h>
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+
+#if __linux__ && !__ANDROID__
+#define FOLLY_HAVE_EVENTFD
+#include <folly/io/async/EventFDWrapper.h>
+#endif
+
+namespace folly {
+
+AtomicNotificationQueue::AtomicNotificationQueue() {
+#ifdef FOLLY_HAVE_EVENTFD
+  eventfd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (eventfd_ == -1 && errno != ENOSYS && errno != EINVAL) {
+    folly::throwSystemError(
+        "Failed to create eventfd for AtomicNotificationQueue", errno);
+  }
+#endif
+  if (eventfd_ == -1) {
+    if (pipe(pipeFds_)) {
+      folly::throwSystemError(
+          "Failed to create pipe for AtomicNotificationQueue", errno);
+    }
+    if (fcntl(pipeFds_[0], F_SETFL, O_RDONLY | O_NONBLOCK) != 0 ||
+        fcntl(pipeFds_[1], F_SETFL, O_WRONLY | O_NONBLOCK) != 0) {
+      int err = errno;
+      ::close(pipeFds_[0]);
+      ::close(pipeFds_[1]);
+      folly::throwSystemError(
+          "Failed to put AtomicNotificationQueue pipe into non-blocking mode",
+          err);
+    }
+  }
+}
+
+AtomicNotificationQueue::~AtomicNotificationQueue() {
+  // Functions that were never run are destroyed with the queue
+  auto head = head_.exchange(nullptr, std::memory_order_acquire);
+  if (head != armed()) {
+    deleteList(head);
+  }
+  deleteList(pendingHead_);
+  if (eventfd_ >= 0) {
+    ::close(eventfd_);
+  }
+  if (pipeFds_[0] >= 0) {
+    ::close(pipeFds_[0]);
+    ::close(pipeFds_[1]);
+  }
+}
+
+void AtomicNotificationQueue::deleteList(Node* head) {
+  while (head) {
+    auto next = head->next;
+    delete head;
+    head = next;
+  }
+}
+
+void AtomicNotificationQueue::init(EventBase* evb) {
+  evb->dcheckIsInEventBaseThread();
+  DCHECK(!isHandlerRegistered());
+  initHandler(evb, eventfd_ >= 0 ? eventfd_ : pipeFds_[0]);
+}
+
+void AtomicNotificationQueue::startConsuming(EventBase* evb) {
+  init(evb);
+  registerHandler(READ | PERSIST);
+}
+
+void AtomicNotificationQueue::startConsumingInternal(EventBase* evb) {
+  init(evb);
+  registerInternalHandler(READ | PERSIST);
+}
+
+void AtomicNotificationQueue::stopConsuming() {
+  if (!isHandlerRegistered()) {
+    return;
+  }
+  unregisterHandler();
+  detachEventBase();
+}
+
+bool AtomicNotificationQueue::arm() {
+  if (pendingHead_) {
+    return false;
+  }
+  Node* expected = nullptr;
+  if (head_.compare_exchange_strong(
+          expected,
+          armed(),
+          std::memory_order_relaxed,
+          std::memory_order_relaxed)) {
+    return true;
+  }
+  return expected == armed();
+}
+
+bool AtomicNotificationQueue::pull() {
+  auto head = head_.exchange(nullptr, std::memory_order_acquire);
+  if (head == nullptr || head == armed()) {
+    return false;
+  }
+  // Reverse into insertion order
+  Node* tail = head;
+  Node* reversed = nullptr;
+  while (head) {
+    auto next = head->next;
+    head->next = reversed;
+    reversed = head;
+    head = next;
+  }
+  if (pendingTail_) {
+    pendingTail_->next = reversed;
+  } else {
+    pendingHead_ = reversed;
+  }
+  pendingTail_ = tail;
+  return true;
+}
+
+bool AtomicNotificationQueue::runOne() noexcept {
+  if (!pendingHead_ && !pull()) {
+    return false;
+  }
+  std::unique_ptr<Node> node(pendingHead_);
+  pendingHead_ = node->next;
+  if (!pendingHead_) {
+    pendingTail_ = nullptr;
+  }
+  size_.fetch_sub(1, std::memory_order_relaxed);
+
+  RequestContextScopeGuard rctx(std::move(node->context));
+  auto task = std::move(node->task);
+  node.reset();
+  // Empty functions only wake the loop up (see terminateLoopSoon())
+  if (task) {
+    task();
+  }
+  return true;
+}
+
+bool AtomicNotificationQueue::consume() noexcept {
+  uint32_t numRun = 0;
+  while ((maxReadAtOnce_ == 0 || numRun < maxReadAtOnce_) && runOne()) {
+    ++numRun;
+  }
+  return numRun != 0;
+}
+
+bool AtomicNotificationQueue::consumeUntilDrained(
+    size_t* numConsumed) noexcept {
+  if (draining_.exchange(true, std::memory_order_relaxed)) {
+    return false;
+  }
+  size_t numRun = 0;
+  while (runOne()) {
+    ++numRun;
+  }
+  draining_.store(false, std::memory_order_relaxed);
+  if (numConsumed) {
+    *numConsumed = numRun;
+  }
+  return true;
+}
+
+void AtomicNotificationQueue::signal() {
+  ssize_t written;
+  if (eventfd_ >= 0) {
+    // eventfd(2) dictates that we must write a 64-bit integer
+    uint64_t one = 1;
+    written = writeNoInt(eventfd_, &one, sizeof(one));
+  } else {
+    uint8_t one = 1;
+    written = writeNoInt(pipeFds_[1], &one, sizeof(one));
+  }
+  // A full pipe is already readable
+  if (written == -1 && errno != EAGAIN) {
+    folly::throwSystemError(
+        "Failed to signal AtomicNotificationQueue after write", errno);
+  }
+}
+
+void AtomicNotificationQueue::drainSignal() {
+  if (eventfd_ >= 0) {
+    uint64_t message;
+    auto bytes = readNoInt(eventfd_, &message, sizeof(message));
+    CHECK(bytes != -1 || errno == EAGAIN);
+  } else {
+    uint8_t message[32];
+    while (readNoInt(pipeFds_[0], &message, sizeof(message)) > 0) {
+    }
+  }
+}
+
+void AtomicNotificationQueue::handlerReady(uint16_t /* events */) noexcept {
+  drainSignal();
+  // With only internal events active, libevent's EVLOOP_ONCE goes back to
+  // epoll_wait() without returning to the EventBase loop: run functions
+  // here, and make sure that we are woken up again if more are queued.
+  consume();
+  if (!arm()) {
+    signal();
+  }
+}
+
+} // namespace folly
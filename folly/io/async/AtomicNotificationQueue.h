@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include <sys/types.h>
+
+#include <folly/Executor.h>
+#include <folly/Likely.h>
+#include <folly/ScopeGuard.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/io/async/EventHandler.h>
+#include <folly/io/async/Request.h>
+
+namespace folly {
+
+class EventBase;
+
+/**
+ * The queue behind EventBase::runInEventBaseThread(): any thread can add
+ * functions, and the EventBase thread runs them in the order they were
+ * added.
+ *
+ * Producers push onto an intrusive lock-free stack with a single CAS;
+ * the consumer takes the whole stack with one exchange and reverses it.
+ *
+ * The eventfd (or pipe) is only written when the consumer is asleep.
+ * Before blocking, the EventBase loop calls arm(), which replaces an
+ * empty stack with a marker; the producer that replaces the marker
+ * signals the eventfd, and no other producer touches it.  arm() fails if
+ * functions are queued, and the loop then polls without blocking.  A busy
+ * EventBase thus doesn't pay for eventfd writes and reads, however many
+ * threads post to it, and producers never wait for each other.
+ *
+ * Unlike NotificationQueue, there is exactly one consumer, and it runs
+ * the functions itself (see consume()) once the backend returns.  The
+ * backend doesn't return for internal events alone, so the event handler
+ * runs functions too, and re-arms before going back to sleep.
+ */
+class AtomicNotificationQueue : private EventHandler {
+ public:
+  enum : uint32_t { kDefaultMaxReadAtOnce = 10 };
+
+  AtomicNotificationQueue();
+  ~AtomicNotificationQueue() override;
+
+  AtomicNotificationQueue(const AtomicNotificationQueue&) = delete;
+  AtomicNotificationQueue& operator=(const AtomicNotificationQueue&) = delete;
+
+  // Any thread
+
+  /**
+   * Adds a function, which may be empty to just wake up the consumer.
+   * Throws std::runtime_error if the queue is draining, and std::bad_alloc.
+   */
+  void putMessage(Func task) {
+    auto node = new Node(std::move(task));
+    push(node, node, 1);
+  }
+
+  /**
+   * Adds the functions in [first, last), with a single CAS.
+   */
+  template <typename InputIteratorT>
+  void putMessages(InputIteratorT first, InputIteratorT last) {
+    Node* head = nullptr;
+    Node* tail = nullptr;
+    size_t n = 0;
+    auto guard = makeGuard([&] { deleteList(head); });
+    for (; first != last; ++first) {
+      // The stack holds the newest function first
+      auto node = new Node(std::move(*first));
+      node->next = head;
+      head = node;
+      if (!tail) {
+        tail = node;
+      }
+      ++n;
+    }
+    guard.dismiss();
+    if (head) {
+      push(head, tail, n);
+    }
+  }
+
+  /**
+   * Number of functions that haven't started running yet.
+   */
+  size_t size() const {
+    auto size = size_.load(std::memory_order_relaxed);
+    return size > 0 ? size_t(size) : 0;
+  }
+
+  // The consumer, in the EventBase thread
+
+  /**
+   * Starts listening to the eventfd in evb; an internal handler doesn't
+   * keep the loop alive.
+   */
+  void startConsuming(EventBase* evb);
+  void startConsumingInternal(EventBase* evb);
+  void stopConsuming();
+
+  /**
+   * Asks producers to signal the eventfd, before blocking.  Returns false,
+   * and doesn't arm, if functions are already queued.
+   */
+  bool arm();
+
+  /**
+   * True if consume() has functions to run.
+   */
+  bool hasPending() const {
+    if (pendingHead_) {
+      return true;
+    }
+    auto head = head_.load(std::memory_order_relaxed);
+    return head != nullptr && head != armed();
+  }
+
+  /**
+   * Runs up to maxReadAtOnce functions (0: all that are queued), each with
+   * the RequestContext it was added with.  Returns true if it ran any.
+   * The functions must not throw.
+   */
+  bool consume() noexcept;
+
+  /**
+   * Runs functions until the queue is empty; putMessage() throws in the
+   * meantime, so this terminates.  Returns false if the queue was already
+   * draining.
+   */
+  bool consumeUntilDrained(size_t* numConsumed = nullptr) noexcept;
+
+  void setMaxReadAtOnce(uint32_t maxAtOnce) {
+    maxReadAtOnce_ = maxAtOnce;
+  }
+
+  uint32_t getMaxReadAtOnce() const {
+    return maxReadAtOnce_;
+  }
+
+ private:
+  struct Node {
+    explicit Node(Func t)
+        : task(std::move(t)), context(RequestContext::saveContext()) {}
+
+    Func task;
+    std::shared_ptr<RequestContext> context;
+    Node* next{nullptr};
+  };
+
+  // The head of an empty stack whose consumer wants a signal
+  static Node* armed() {
+    return reinterpret_cast<Node*>(uintptr_t(1));
+  }
+
+  // Pushes the list [head..tail] of n nodes
+  void push(Node* head, Node* tail, size_t n) {
+    if (UNLIKELY(draining_.load(std::memory_order_relaxed))) {
+      deleteList(head);
+      throw std::runtime_error("queue is draining, cannot add message");
+    }
+    size_.fetch_add(ssize_t(n), std::memory_order_relaxed);
+    auto oldHead = head_.load(std::memory_order_relaxed);
+    do {
+      tail->next = oldHead == armed() ? nullptr : oldHead;
+    } while (!head_.compare_exchange_weak(
+        oldHead, head, std::memory_order_release, std::memory_order_relaxed));
+    if (oldHead == armed()) {
+      signal();
+    }
+  }
+
+  static void deleteList(Node* head);
+
+  // Moves the stack to pendingHead_, oldest first, and disarms
+  bool pull();
+  bool runOne() noexcept;
+
+  void signal();
+  void drainSignal();
+  void handlerReady(uint16_t events) noexcept override;
+  void init(EventBase* evb);
+
+  std::atomic<Node*> head_{nullptr};
+  std::atomic<ssize_t> size_{0};
+  std::atomic<bool> draining_{false};
+
+  int eventfd_{-1};
+  int pipeFds_[2]{-1, -1}; // to fall back to without eventfd
+
+  // Owned by the consumer
+  FOLLY_ALIGN_TO_AVOID_FALSE_SHARING Node* pendingHead_{nullptr};
+  Node* pendingTail_{nullptr};
+  uint32_t maxReadAtOnce_{kDefaultMaxReadAtOnce};
+};
+
+} // namespace folly
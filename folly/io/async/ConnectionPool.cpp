@@ -0,0 +1,370 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ConnectionPool.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <folly/ExceptionString.h>
+
+namespace folly {
+
+class ConnectionPool::Connection : public DelayedDestruction,
+                                   private AsyncSocket::ConnectCallback,
+                                   private AsyncSocket::ReadCallback,
+                                   private HHWheelTimer::Callback {
+ public:
+  Connection(ConnectionPool* pool, const SocketAddress& address)
+      : pool_(pool), address_(address) {}
+
+  const SocketAddress& getAddress() const {
+    return address_;
+  }
+
+  size_t getNumInFlight() const {
+    return inFlight_.size();
+  }
+
+  bool isConnected() const {
+    return connected_;
+  }
+
+  bool isClosed() const {
+    return closed_;
+  }
+
+  // Connects first if this is the first request
+  void send(Request request) {
+    DestructorGuard dg(this);
+    if (!socket_) {
+      connect();
+    }
+    if (closed_) {
+      request.callback->requestError(AsyncSocketException(
+          AsyncSocketException::NOT_OPEN,
+          "connection to " + address_.describe() + " failed"));
+      return;
+    }
+    cancelTimeout();
+    inFlight_.push_back(request.callback);
+    // Errors come back through readErr()
+    socket_->writeChain(nullptr, std::move(request.buf));
+  }
+
+  // Fails the requests in flight, without telling the pool
+  void close(const AsyncSocketException& ex) {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    cancelTimeout();
+    if (socket_) {
+      socket_->setReadCB(nullptr);
+      socket_->closeNow();
+    }
+    auto inFlight = std::move(inFlight_);
+    inFlight_.clear();
+    for (auto callback : inFlight) {
+      callback->requestError(ex);
+    }
+  }
+
+ private:
+  ~Connection() override = default;
+
+  void connect() {
+    auto& options = pool_->options_;
+    socket_.reset(new AsyncSocket(pool_->evb_));
+    if (options.fastOpen) {
+      // Sends the first request with the SYN
+      socket_->enableTFO();
+    }
+    socket_->connect(
+        this,
+        address_,
+        int(options.connectTimeout.count()),
+        options.socketOptions);
+    if (!closed_) {
+      socket_->setReadCB(this);
+    }
+  }
+
+  // Closes and leaves the pool
+  void fail(const AsyncSocketException& ex) {
+    if (closed_) {
+      return;
+    }
+    DestructorGuard dg(this);
+    pool_->removeConnection(this, ex);
+  }
+
+  void processResponses() {
+    DestructorGuard dg(this);
+    while (!closed_) {
+      std::unique_ptr<IOBuf> response;
+      try {
+        response = pool_->framer_(readBuf_);
+      } catch (const std::exception& e) {
+        fail(AsyncSocketException(
+            AsyncSocketException::CORRUPTED_DATA,
+            "bad response from " + address_.describe() + ": " +
+                exceptionStr(e).toStdString()));
+        return;
+      }
+      if (!response) {
+        break;
+      }
+      if (inFlight_.empty()) {
+        fail(AsyncSocketException(
+            AsyncSocketException::CORRUPTED_DATA,
+            "unexpected response from " + address_.describe()));
+        return;
+      }
+      auto callback = inFlight_.front();
+      inFlight_.pop_front();
+      callback->responseReceived(std::move(response));
+    }
+    if (closed_) {
+      return;
+    }
+    pool_->dispatchWaiting(address_);
+    if (!closed_ && inFlight_.empty() && !isScheduled()) {
+      pool_->evb_->timer().scheduleTimeout(this, pool_->options_.idleTimeout);
+    }
+  }
+
+  // AsyncSocket::ConnectCallback
+  void connectSuccess() noexcept override {
+    connected_ = true;
+  }
+
+  void connectErr(const AsyncSocketException& ex) noexcept override {
+    fail(ex);
+  }
+
+  // AsyncSocket::ReadCallback
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    auto buf = readBuf_.preallocate(kMinReadSize, kMaxReadSize);
+    *bufReturn = buf.first;
+    *lenReturn = buf.second;
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    readBuf_.postallocate(len);
+    processResponses();
+  }
+
+  bool isBufferMovable() noexcept override {
+    return true;
+  }
+
+  void readBufferAvailable(std::unique_ptr<IOBuf> buf) noexcept override {
+    readBuf_.append(std::move(buf));
+    processResponses();
+  }
+
+  void readEOF() noexcept override {
+    fail(AsyncSocketException(
+        AsyncSocketException::END_OF_FILE,
+        "connection to " + address_.describe() + " closed by peer"));
+  }
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    fail(ex);
+  }
+
+  // HHWheelTimer::Callback
+  void timeoutExpired() noexcept override {
+    if (inFlight_.empty()) {
+      fail(AsyncSocketException(
+          AsyncSocketException::TIMED_OUT, "idle connection closed"));
+    }
+  }
+
+  static constexpr size_t kMinReadSize = 1460;
+  static constexpr size_t kMaxReadSize = 64 * 1024;
+
+  ConnectionPool* const pool_;
+  const SocketAddress address_;
+  AsyncSocket::UniquePtr socket_;
+  IOBufQueue readBuf_{IOBufQueue::cacheChainLength()};
+  // The callbacks of the requests written, in order
+  std::deque<ConnectionPool::Callback*> inFlight_;
+  bool connected_{false};
+  bool closed_{false};
+};
+
+constexpr size_t ConnectionPool::Connection::kMinReadSize;
+constexpr size_t ConnectionPool::Connection::kMaxReadSize;
+
+ConnectionPool::ConnectionPool(EventBase* evb, Framer framer)
+    : ConnectionPool(evb, std::move(framer), Options()) {}
+
+ConnectionPool::ConnectionPool(EventBase* evb, Framer framer, Options options)
+    : evb_(evb), framer_(std::move(framer)), options_(std::move(options)) {
+  CHECK_GT(options_.maxConnections, 0);
+  CHECK_GT(options_.maxPipelineDepth, 0);
+}
+
+ConnectionPool::~ConnectionPool() {
+  AsyncSocketException ex(
+      AsyncSocketException::NOT_OPEN, "connection pool destroyed");
+  auto destinations = std::move(destinations_);
+  destinations_.clear();
+  for (auto& entry : destinations) {
+    for (auto& conn : entry.second.connections) {
+      conn->close(ex);
+    }
+    for (auto& request : entry.second.waiting) {
+      request.callback->requestError(ex);
+    }
+  }
+}
+
+void ConnectionPool::send(
+    const SocketAddress& address,
+    std::unique_ptr<IOBuf> request,
+    Callback* callback) {
+  evb_->dcheckIsInEventBaseThread();
+  auto& dest = destinations_[address];
+  // Don't overtake the requests already waiting
+  if (dest.waiting.empty()) {
+    if (auto conn = pickConnection(address, dest)) {
+      conn->send(Request{std::move(request), callback});
+      return;
+    }
+  }
+  dest.waiting.push_back(Request{std::move(request), callback});
+}
+
+ConnectionPool::Connection* ConnectionPool::pickConnection(
+    const SocketAddress& address,
+    Destination& dest) {
+  Connection* best = nullptr;
+  for (auto& conn : dest.connections) {
+    if (!best || conn->getNumInFlight() < best->getNumInFlight()) {
+      best = conn.get();
+    }
+  }
+  if (best && best->getNumInFlight() < options_.maxPipelineDepth) {
+    return best;
+  }
+  if (dest.connections.size() < options_.maxConnections) {
+    dest.connections.emplace_back(new Connection(this, address));
+    return dest.connections.back().get();
+  }
+  return nullptr;
+}
+
+void ConnectionPool::dispatchWaiting(const SocketAddress& address) {
+  auto it = destinations_.find(address);
+  while (it != destinations_.end() && !it->second.waiting.empty()) {
+    auto conn = pickConnection(address, it->second);
+    if (!conn) {
+      return;
+    }
+    auto request = std::move(it->second.waiting.front());
+    it->second.waiting.pop_front();
+    // May call back into the pool
+    conn->send(std::move(request));
+    it = destinations_.find(address);
+  }
+}
+
+void ConnectionPool::removeConnection(
+    Connection* conn,
+    const AsyncSocketException& ex) {
+  // The address outlives conn
+  auto address = conn->getAddress();
+  auto it = destinations_.find(address);
+  DCHECK(it != destinations_.end());
+  auto& connections = it->second.connections;
+  auto pos = std::find_if(
+      connections.begin(), connections.end(), [&](const ConnectionPtr& c) {
+        return c.get() == conn;
+      });
+  DCHECK(pos != connections.end());
+  auto ptr = std::move(*pos);
+  connections.erase(pos);
+
+  ptr->close(ex);
+  it = destinations_.find(address);
+  if (it == destinations_.end()) {
+    return;
+  }
+  if (ptr->isConnected()) {
+    dispatchWaiting(address);
+  } else {
+    // The address can't be reached, don't keep requests waiting for it
+    auto waiting = std::move(it->second.waiting);
+    it->second.waiting.clear();
+    for (auto& request : waiting) {
+      request.callback->requestError(ex);
+    }
+  }
+  it = destinations_.find(address);
+  if (it != destinations_.end() && it->second.connections.empty() &&
+      it->second.waiting.empty()) {
+    destinations_.erase(it);
+  }
+}
+
+void ConnectionPool::closeIdleConnections() {
+  AsyncSocketException ex(
+      AsyncSocketException::NOT_OPEN, "idle connection closed");
+  std::vector<Connection*> idle;
+  for (auto& entry : destinations_) {
+    for (auto& conn : entry.second.connections) {
+      if (conn->getNumInFlight() == 0) {
+        idle.push_back(conn.get());
+      }
+    }
+  }
+  for (auto conn : idle) {
+    removeConnection(conn, ex);
+  }
+}
+
+size_t ConnectionPool::getNumConnections() const {
+  size_t n = 0;
+  for (auto& entry : destinations_) {
+    n += entry.second.connections.size();
+  }
+  return n;
+}
+
+size_t ConnectionPool::getNumIdleConnections() const {
+  size_t n = 0;
+  for (auto& entry : destinations_) {
+    for (auto& conn : entry.second.connections) {
+      n += conn->getNumInFlight() == 0 ? 1 : 0;
+    }
+  }
+  return n;
+}
+
+size_t ConnectionPool::getNumWaitingRequests() const {
+  size_t n = 0;
+  for (auto& entry : destinations_) {
+    n += entry.second.waiting.size();
+  }
+  return n;
+}
+
+} // namespace folly
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+namespace folly {
+
+/**
+ * A pool of client connections, per server address, for request/response
+ * protocols.  Requests to an address are pipelined over the connections
+ * to it: a request is written as soon as it is sent, without waiting for
+ * the responses to the requests before it, and the responses, which the
+ * server must send in order, are matched to the requests in order.
+ *
+ * The pool doesn't know the protocol; a Framer cuts the responses out of
+ * the bytes read.  A request goes to the connection with the fewest
+ * requests in flight.  New connections are opened, optionally with TCP
+ * Fast Open, while all the others have maxPipelineDepth requests in
+ * flight; past maxConnections, requests wait in the pool.  Connections
+ * idle for idleTimeout are closed, with the EventBase's HHWheelTimer.
+ *
+ * A ConnectionPool belongs to an EventBase and must only be used in its
+ * thread, so it needs no locks.  To share one per thread, with EventBases
+ * pinned to cpus or NUMA nodes, keep it in an EventBaseLocal:
+ *
+ *   EventBaseLocal<ConnectionPool> pools;
+ *   auto& pool = pools.getOrCreateFn(
+ *       evb, [&] { return new ConnectionPool(&evb, framer); });
+ *   pool.send(address, std::move(request), &callback);
+ */
+class ConnectionPool {
+ public:
+  /**
+   * Removes the next complete response from the front of the bytes read
+   * on a connection, and returns it, or nullptr if there is none yet.  An
+   * exception fails the connection.
+   */
+  using Framer = Function<std::unique_ptr<IOBuf>(IOBufQueue& readBuf)>;
+
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+
+    virtual void responseReceived(std::unique_ptr<IOBuf> response) noexcept = 0;
+
+    /**
+     * The connection failed or closed before the response, or the pool was
+     * destroyed.
+     */
+    virtual void requestError(const AsyncSocketException& ex) noexcept = 0;
+  };
+
+  struct Options {
+    // Per address
+    size_t maxConnections{8};
+    // Requests in flight on a connection before another one is opened
+    size_t maxPipelineDepth{16};
+    std::chrono::milliseconds connectTimeout{1000};
+    std::chrono::milliseconds idleTimeout{60000};
+    bool fastOpen{false};
+    AsyncSocket::OptionMap socketOptions;
+  };
+
+  ConnectionPool(EventBase* evb, Framer framer);
+  ConnectionPool(EventBase* evb, Framer framer, Options options);
+
+  /**
+   * Closes the connections; callbacks still waiting get requestError().
+   * Not from the pool's callbacks.
+   */
+  ~ConnectionPool();
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  EventBase* getEventBase() const {
+    return evb_;
+  }
+
+  /**
+   * Sends a request to address.  callback gets the response or the error,
+   * and must stay valid until then.
+   */
+  void send(
+      const SocketAddress& address,
+      std::unique_ptr<IOBuf> request,
+      Callback* callback);
+
+  /**
+   * Closes the connections without requests in flight.
+   */
+  void closeIdleConnections();
+
+  size_t getNumConnections() const;
+  size_t getNumIdleConnections() const;
+  // Requests waiting for a connection
+  size_t getNumWaitingRequests() const;
+
+ private:
+  class Connection;
+  using ConnectionPtr =
+      std::unique_ptr<Connection, DelayedDestruction::Destructor>;
+
+  struct Request {
+    std::unique_ptr<IOBuf> buf;
+    Callback* callback;
+  };
+
+  struct Destination {
+    std::vector<ConnectionPtr> connections;
+    std::deque<Request> waiting;
+  };
+
+  Connection* pickConnection(const SocketAddress& address, Destination& dest);
+  // Sends waiting requests, after a connection freed a slot or closed
+  void dispatchWaiting(const SocketAddress& address);
+  void removeConnection(Connection* conn, const AsyncSocketException& ex);
+
+  EventBase* const evb_;
+  Framer framer_;
+  const Options options_;
+  std::unordered_map<SocketAddress, Destination> destinations_;
+};
+
+} // namespace folly
@@ -22,43 +22,26 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <mutex>
 #include <thread>
 
 #include <folly/Baton.h>
+#include <folly/Exception.h>
+#include <folly/Likely.h>
 #include <folly/Memory.h>
-#include <folly/io/async/NotificationQueue.h>
+#include <folly/io/async/AtomicNotificationQueue.h>
 #include <folly/io/async/VirtualEventBase.h>
+#include <folly/portability/Asm.h>
 #include <folly/portability/Unistd.h>
 #include <folly/system/ThreadName.h>
+#include <folly/tracing/StaticTracepoint.h>
 
-namespace folly {
+FOLLY_SDT_DEFINE_SEMAPHORE(folly, event_base_loop_iteration);
 
-/*
- * EventBase::FunctionRunner
- */
-
-class EventBase::FunctionRunner
-    : public NotificationQueue<EventBase::Func>::Consumer {
- public:
-  void messageAvailable(Func&& msg) noexcept override {
-    // In libevent2, internal events do not break the loop.
-    // Most users would expect loop(), followed by runInEventBaseThread(),
-    // to break the loop and check if it should exit or not.
-    // To have similar bejaviour to libevent1.4, tell the loop to break here.
-    // Note that loop() may still continue to loop, but it will also check the
-    // stop_ flag as well as runInLoop callbacks, etc.
-    event_base_loopbreak(getEventBase()->evb_);
-
-    if (!msg) {
-      // terminateLoopSoon() sends a null message just to
-      // wake up the loop.  We can ignore these messages.
-      return;
-    }
-    msg();
-  }
-};
+namespace folly {
 
 // The interface used to libevent is not thread-safe.  Calls to
 // event_init() and event_base_free() directly modify an internal
@@ -69,26 +52,44 @@ class EventBase::FunctionRunner
 // event_init() has already been called by simply inspecting current_base.
 static std::mutex libevent_mutex_;
 
-/*
- * EventBase methods
- */
+namespace {
 
-EventBase::EventBase(bool enableTimeMeasurement)
-  : runOnceCallbacks_(nullptr)
-  , stop_(false)
-  , loopThread_()
-  , queue_(nullptr)
-  , fnRunner_(nullptr)
-  , maxLatency_(0)
-  , avgLoopTime_(std::chrono::seconds(2))
-  , maxLatencyLoopTime_(avgLoopTime_)
-  , enableTimeMeasurement_(enableTimeMeasurement)
-  , nextLoopCnt_(uint64_t(-40)) // Early wrap-around so bugs will manifest soon
-  , latestLoopCnt_(nextLoopCnt_)
-  , startWork_()
-  , observer_(nullptr)
-  , observerSampleCount_(0)
-  , executionObserver_(nullptr) {
+// The default backend: libevent does all the work.
+class LibeventBackend : public EventBaseBackend {
+ public:
+  explicit LibeventBackend(event_base* evb) : evb_(evb) {}
+
+  ~LibeventBackend() override {
+    std::lock_guard<std::mutex> lock(libevent_mutex_);
+    event_base_free(evb_);
+  }
+
+  event_base* getEventBase() override {
+    return evb_;
+  }
+
+  int loop(int flags) override {
+    return event_base_loop(evb_, flags);
+  }
+
+  int loopBreak() override {
+    return event_base_loopbreak(evb_);
+  }
+
+  int addEvent(struct event* ev, const struct timeval* timeout) override {
+    return event_add(ev, timeout);
+  }
+
+  int delEvent(struct event* ev) override {
+    return event_del(ev);
+  }
+
+ private:
+  event_base* evb_;
+};
+
+event_base* newLibeventBase() {
+  event_base* evb = nullptr;
   struct event ev;
   {
     std::lock_guard<std::mutex> lock(libevent_mutex_);
@@ -100,30 +101,54 @@ EventBase::EventBase(bool enableTimeMeasurement)
     // call event_base_new().
     event_set(&ev, 0, 0, nullptr, nullptr);
     if (!ev.ev_base) {
-      evb_ = event_init();
+      evb = event_init();
     }
   }
 
   if (ev.ev_base) {
-    evb_ = event_base_new();
+    evb = event_base_new();
   }
 
-  if (UNLIKELY(evb_ == nullptr)) {
+  if (UNLIKELY(evb == nullptr)) {
     LOG(ERROR) << "EventBase(): Failed to init event base.";
     folly::throwSystemError("error in EventBase::EventBase()");
   }
-  VLOG(5) << "EventBase(): Created.";
-  initNotificationQueue();
+  return evb;
 }
 
+// The busy polling counters only have one writer, the EventBase thread
+template <typename T>
+void addRelaxed(std::atomic<T>& counter, T n) {
+  counter.store(
+      counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+} // namespace
+
+/*
+ * EventBase methods
+ */
+
+EventBase::EventBase(bool enableTimeMeasurement)
+    : EventBase(
+          std::make_unique<LibeventBackend>(newLibeventBase()),
+          enableTimeMeasurement) {}
+
 // takes ownership of the event_base
 EventBase::EventBase(event_base* evb, bool enableTimeMeasurement)
+    : EventBase(
+          evb ? std::make_unique<LibeventBackend>(evb) : nullptr,
+          enableTimeMeasurement) {}
+
+EventBase::EventBase(
+    std::unique_ptr<EventBaseBackend> backend,
+    bool enableTimeMeasurement)
   : runOnceCallbacks_(nullptr)
   , stop_(false)
   , loopThread_()
-  , evb_(evb)
+  , backend_(std::move(backend))
+  , evb_(backend_ ? backend_->getEventBase() : nullptr)
   , queue_(nullptr)
-  , fnRunner_(nullptr)
   , maxLatency_(0)
   , avgLoopTime_(std::chrono::seconds(2))
   , maxLatencyLoopTime_(avgLoopTime_)
@@ -138,6 +163,7 @@ EventBase::EventBase(event_base* evb, bool enableTimeMeasurement)
     LOG(ERROR) << "EventBase(): Pass nullptr as event base.";
     throw std::invalid_argument("EventBase(): event base cannot be nullptr");
   }
+  VLOG(5) << "EventBase(): Created.";
   initNotificationQueue();
 }
 
@@ -172,16 +198,13 @@ EventBase::~EventBase() {
 
   (void)runLoopCallbacks();
 
-  if (!fnRunner_->consumeUntilDrained()) {
+  if (!queue_->consumeUntilDrained()) {
     LOG(ERROR) << "~EventBase(): Unable to drain notification queue";
   }
 
-  // Stop consumer before deleting NotificationQueue
-  fnRunner_->stopConsuming();
-  {
-    std::lock_guard<std::mutex> lock(libevent_mutex_);
-    event_base_free(evb_);
-  }
+  // Stop consuming before the backend goes away
+  queue_->stopConsuming();
+  backend_.reset();
 
   for (auto storage : localStorageToDtor_) {
     storage->onEventBaseDestruction(*this);
@@ -195,7 +218,98 @@ size_t EventBase::getNotificationQueueSize() const {
 }
 
 void EventBase::setMaxReadAtOnce(uint32_t maxAtOnce) {
-  fnRunner_->setMaxReadAtOnce(maxAtOnce);
+  queue_->setMaxReadAtOnce(maxAtOnce);
+}
+
+void EventBase::setBusyPoll(std::chrono::microseconds maxSpin) {
+  dcheckIsInEventBaseThread();
+  busyPollMaxSpin_ = std::max(maxSpin, std::chrono::microseconds::zero());
+  // Start by spinning for all of maxSpin
+  busyPollIdle_ = busyPollMaxSpin_ / 2;
+  busyPollBudget_ = busyPollMaxSpin_;
+  busyPollSpins_.store(0, std::memory_order_relaxed);
+  busyPollSpinHits_.store(0, std::memory_order_relaxed);
+  busyPollParks_.store(0, std::memory_order_relaxed);
+  busyPollSpinNsec_.store(0, std::memory_order_relaxed);
+  busyPollParkNsec_.store(0, std::memory_order_relaxed);
+  busyPollBudgetNsec_.store(
+      busyPollBudget_.count(), std::memory_order_relaxed);
+}
+
+EventBase::BusyPollStats EventBase::getBusyPollStats() const {
+  BusyPollStats stats;
+  stats.spins = busyPollSpins_.load(std::memory_order_relaxed);
+  stats.spinHits = busyPollSpinHits_.load(std::memory_order_relaxed);
+  stats.parks = busyPollParks_.load(std::memory_order_relaxed);
+  stats.spinTime = std::chrono::nanoseconds(
+      busyPollSpinNsec_.load(std::memory_order_relaxed));
+  stats.parkTime = std::chrono::nanoseconds(
+      busyPollParkNsec_.load(std::memory_order_relaxed));
+  stats.spinBudget = std::chrono::nanoseconds(
+      busyPollBudgetNsec_.load(std::memory_order_relaxed));
+  return stats;
+}
+
+bool EventBase::busyPoll(int& res) {
+  if (busyPollMaxSpin_.count() == 0 || queue_->hasPending()) {
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  busyPollIdleStart_ = start;
+  if (busyPollBudget_.count() == 0) {
+    return false;
+  }
+
+  // The notification queue isn't armed: runInEventBaseThread() just
+  // queues functions, and we find them with hasPending().
+  auto deadline = start + busyPollBudget_;
+  auto handled = eventsHandled_;
+  auto now = start;
+  bool found = false;
+  do {
+    res = backend_->loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
+    now = std::chrono::steady_clock::now();
+    if (res != 0 || eventsHandled_ != handled || !loopCallbacks_.empty() ||
+        queue_->hasPending() || stop_.load(std::memory_order_relaxed)) {
+      found = true;
+      break;
+    }
+    asm_volatile_pause();
+  } while (now < deadline);
+
+  addRelaxed(busyPollSpins_, uint64_t(1));
+  addRelaxed(busyPollSpinNsec_, int64_t((now - start).count()));
+  if (found) {
+    addRelaxed(busyPollSpinHits_, uint64_t(1));
+    updateBusyPollIdle(now - start);
+  }
+  return found;
+}
+
+int EventBase::park() {
+  if (busyPollMaxSpin_.count() == 0) {
+    return backend_->loop(EVLOOP_ONCE);
+  }
+  auto start = std::chrono::steady_clock::now();
+  int res = backend_->loop(EVLOOP_ONCE);
+  auto now = std::chrono::steady_clock::now();
+  addRelaxed(busyPollParks_, uint64_t(1));
+  addRelaxed(busyPollParkNsec_, int64_t((now - start).count()));
+  // busyPoll() started the idle period, spinning or not
+  updateBusyPollIdle(now - busyPollIdleStart_);
+  return res;
+}
+
+void EventBase::updateBusyPollIdle(std::chrono::nanoseconds idle) {
+  busyPollIdle_ = (busyPollIdle_ * 7 + idle) / 8;
+  if (busyPollIdle_ > busyPollMaxSpin_) {
+    busyPollBudget_ = std::chrono::nanoseconds::zero();
+  } else {
+    busyPollBudget_ = std::min<std::chrono::nanoseconds>(
+        busyPollIdle_ * 2, busyPollMaxSpin_);
+  }
+  busyPollBudgetNsec_.store(
+      busyPollBudget_.count(), std::memory_order_relaxed);
 }
 
 void EventBase::checkIsInEventBaseThread() const {
@@ -223,6 +337,7 @@ void EventBase::setLoadAvgMsec(std::chrono::milliseconds ms) {
   if (ms > std::chrono::milliseconds::zero()) {
     maxLatencyLoopTime_.setTimeInterval(us);
     avgLoopTime_.setTimeInterval(us);
+    busyRatioInterval_ = us;
   } else {
     LOG(ERROR) << "non-positive arg to setLoadAvgMsec()";
   }
@@ -273,6 +388,7 @@ bool EventBase::loopBody(int flags) {
   };
 
   int res = 0;
+  bool ranFunctions;
   bool ranLoopCallbacks;
   bool blocking = !(flags & EVLOOP_NONBLOCK);
   bool once = (flags & EVLOOP_ONCE);
@@ -280,8 +396,8 @@ bool EventBase::loopBody(int flags) {
   // time-measurement variables.
   std::chrono::steady_clock::time_point prev;
   std::chrono::steady_clock::time_point idleStart = {};
-  std::chrono::microseconds busy;
-  std::chrono::microseconds idle;
+  std::chrono::microseconds busy{0};
+  std::chrono::microseconds idle{0};
 
   loopThread_.store(std::this_thread::get_id(), std::memory_order_release);
 
@@ -298,6 +414,10 @@ bool EventBase::loopBody(int flags) {
     applyLoopKeepAlive();
     ++nextLoopCnt_;
 
+    if (loopProfiler_) {
+      loopProfiler_->iterationStarting();
+    }
+
     // Run the before loop callbacks
     LoopCallbackList callbacks;
     callbacks.swap(runBeforeLoopCallbacks_);
@@ -305,19 +425,53 @@ bool EventBase::loopBody(int flags) {
     while(!callbacks.empty()) {
       auto* item = &callbacks.front();
       callbacks.pop_front();
-      item->runLoopCallback();
+      EventBaseLoopProfiler::profile(
+          loopProfiler_,
+          EventBaseLoopProfiler::Phase::LOOP_CALLBACK,
+          &typeid(*item),
+          [&] { item->runLoopCallback(); });
     }
 
     // nobody can add loop callbacks from within this thread if
-    // we don't have to handle anything to start with...
-    if (blocking && loopCallbacks_.empty()) {
-      res = event_base_loop(evb_, EVLOOP_ONCE);
+    // we don't have to handle anything to start with...  Arming the
+    // notification queue makes runInEventBaseThread() wake us up, and fails
+    // if functions are already queued.
+    if (blocking && loopCallbacks_.empty() && busyPoll(res)) {
+      // Something happened while spinning, no need to block
+    } else if (blocking && loopCallbacks_.empty() && queue_->arm()) {
+      res = park();
     } else {
-      res = event_base_loop(evb_, EVLOOP_ONCE | EVLOOP_NONBLOCK);
+      res = backend_->loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
+    }
+
+    ranFunctions = false;
+    if (queue_->hasPending()) {
+      bumpHandlingTime();
+      EventBaseLoopProfiler::profile(
+          loopProfiler_,
+          EventBaseLoopProfiler::Phase::FUNCTION,
+          nullptr,
+          [&] { ranFunctions = queue_->consume(); });
     }
 
     ranLoopCallbacks = runLoopCallbacks();
 
+    if (loopProfiler_) {
+      loopProfiler_->iterationDone();
+    }
+
+    if (FOLLY_SDT_IS_ENABLED(folly, event_base_loop_iteration)) {
+      // busy and idle are 0 unless time measurement is enabled
+      FOLLY_SDT_WITH_SEMAPHORE(
+          folly,
+          event_base_loop_iteration,
+          this,
+          getNotificationQueueSize(),
+          ranFunctions || ranLoopCallbacks,
+          int64_t(busy.count()),
+          int64_t(idle.count()));
+    }
+
     if (enableTimeMeasurement_) {
       busy = std::chrono::duration_cast<std::chrono::microseconds>(
           std::chrono::steady_clock::now() - startWork_);
@@ -328,6 +482,7 @@ bool EventBase::loopBody(int flags) {
         std::chrono::microseconds(busy));
       maxLatencyLoopTime_.addSample(std::chrono::microseconds(idle),
         std::chrono::microseconds(busy));
+      updateBusyRatio(busy, idle);
 
       if (observer_) {
         if (observerSampleCount_++ == observer_->getSampleRate()) {
@@ -362,17 +517,12 @@ bool EventBase::loopBody(int flags) {
     }
 
     // If the event loop indicate that there were no more events, and
-    // we also didn't have any loop callbacks to run, there is nothing left to
-    // do.
-    if (res != 0 && !ranLoopCallbacks) {
-      // Since Notification Queue is marked 'internal' some events may not have
-      // run.  Run them manually if so, and continue looping.
-      //
-      if (getNotificationQueueSize() > 0) {
-        fnRunner_->handlerReady(0);
-      } else {
-        break;
-      }
+    // we also didn't have any functions or loop callbacks to run, there is
+    // nothing left to do.  (The notification queue is an internal event, so
+    // the backend doesn't wait for it: keep looping while it has functions.)
+    if (res != 0 && !ranLoopCallbacks && !ranFunctions &&
+        !queue_->hasPending()) {
+      break;
     }
 
     if (enableTimeMeasurement_) {
@@ -422,15 +572,15 @@ void EventBase::applyLoopKeepAlive() {
 
   if (loopKeepAliveActive_ && keepAliveCount == 0) {
     // Restore the notification queue internal flag
-    fnRunner_->stopConsuming();
-    fnRunner_->startConsumingInternal(this, queue_.get());
+    queue_->stopConsuming();
+    queue_->startConsumingInternal(this);
     loopKeepAliveActive_ = false;
   } else if (!loopKeepAliveActive_ && keepAliveCount > 0) {
     // Update the notification queue event to treat it as a normal
     // (non-internal) event.  The notification queue event always remains
     // installed, and the main loop won't exit with it installed.
-    fnRunner_->stopConsuming();
-    fnRunner_->startConsuming(this, queue_.get());
+    queue_->stopConsuming();
+    queue_->startConsuming(this);
     loopKeepAliveActive_ = true;
   }
 }
@@ -457,6 +607,7 @@ void EventBase::loopForever() {
 }
 
 void EventBase::bumpHandlingTime() {
+  ++eventsHandled_;
   if (!enableTimeMeasurement_) {
     return;
   }
@@ -473,6 +624,23 @@ void EventBase::bumpHandlingTime() {
   }
 }
 
+void EventBase::updateBusyRatio(
+    std::chrono::microseconds busy,
+    std::chrono::microseconds idle) {
+  auto const total = busy + idle;
+  if (total <= std::chrono::microseconds::zero()) {
+    return;
+  }
+  // Same decay as SmoothLoopTime: a sample covering t microseconds of an
+  // interval i gets weight 1 - exp(-t/i)
+  auto const weight =
+      1.0 - std::exp(-double(total.count()) / busyRatioInterval_.count());
+  auto const sample = double(busy.count()) / total.count();
+  auto const ratio = busyRatio_.load(std::memory_order_relaxed);
+  busyRatio_.store(
+      ratio + weight * (sample - ratio), std::memory_order_relaxed);
+}
+
 void EventBase::terminateLoopSoon() {
   VLOG(5) << "EventBase(): Received terminateLoopSoon() command.";
 
@@ -483,17 +651,14 @@ void EventBase::terminateLoopSoon() {
 
   // Call event_base_loopbreak() so that libevent will exit the next time
   // around the loop.
-  event_base_loopbreak(evb_);
+  backend_->loopBreak();
 
   // If terminateLoopSoon() is called from another thread,
   // the EventBase thread might be stuck waiting for events.
   // In this case, it won't wake up and notice that stop_ is set until it
-  // receives another event.  Send an empty frame to the notification queue
-  // so that the event loop will wake up even if there are no other events.
-  //
-  // We don't care about the return value of trySendFrame().  If it fails
-  // this likely means the EventBase already has lots of events waiting
-  // anyway.
+  // receives another event.  Send an empty function to the notification
+  // queue so that the event loop will wake up even if there are no other
+  // events.
   try {
     queue_->putMessage(nullptr);
   } catch (...) {
@@ -538,7 +703,7 @@ void EventBase::runBeforeLoop(LoopCallback* callback) {
 
 bool EventBase::runInEventBaseThread(Func fn) {
   // Send the message.
-  // It will be received by the FunctionRunner in the EventBase's thread.
+  // It will be run by the EventBase loop, in its thread.
 
   // We try not to schedule nullptr callbacks
   if (!fn) {
@@ -547,6 +712,10 @@ bool EventBase::runInEventBaseThread(Func fn) {
     return false;
   }
 
+  if (UNLIKELY(hasTaskStatsCallbacks_.load(std::memory_order_relaxed))) {
+    fn = measureTask(std::move(fn));
+  }
+
   // Short-circuit if we are already in our event base
   if (inRunningEventBaseThread()) {
     runInLoop(std::move(fn));
@@ -564,6 +733,81 @@ bool EventBase::runInEventBaseThread(Func fn) {
   return true;
 }
 
+bool EventBase::runInEventBaseThread(std::vector<Func> fns) {
+  // As for a single function, nullptr callbacks are not scheduled
+  auto isEmpty = [](const Func& fn) { return !fn; };
+  auto end = std::remove_if(fns.begin(), fns.end(), isEmpty);
+  if (end != fns.end()) {
+    LOG(ERROR) << "EventBase " << this
+               << ": Scheduling nullptr callbacks is not allowed";
+    fns.erase(end, fns.end());
+  }
+
+  if (UNLIKELY(hasTaskStatsCallbacks_.load(std::memory_order_relaxed))) {
+    for (auto& fn : fns) {
+      fn = measureTask(std::move(fn));
+    }
+  }
+
+  if (inRunningEventBaseThread()) {
+    for (auto& fn : fns) {
+      runInLoop(std::move(fn));
+    }
+    return true;
+  }
+
+  try {
+    queue_->putMessages(fns.begin(), fns.end());
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "EventBase " << this << ": failed to schedule functions "
+               << "for EventBase thread: " << ex.what();
+    return false;
+  }
+
+  return true;
+}
+
+void EventBase::subscribeToTaskStats(ExecutorTaskStatsCallback cb) {
+  if (inRunningEventBaseThread() && inTaskStatsCallback_) {
+    throw std::runtime_error("cannot subscribe in task stats callback");
+  }
+  std::lock_guard<std::mutex> lg(taskStatsCallbacksMutex_);
+  taskStatsCallbacks_.push_back(std::move(cb));
+  hasTaskStatsCallbacks_.store(true, std::memory_order_relaxed);
+}
+
+Func EventBase::measureTask(Func fn) {
+  ExecutorTaskStats stats;
+  stats.queueDepth = queue_ ? queue_->size() : 0;
+  auto enqueueTime = std::chrono::steady_clock::now();
+  return [this, stats, enqueueTime, fn = std::move(fn)]() mutable {
+    auto startTime = std::chrono::steady_clock::now();
+    stats.waitTime = startTime - enqueueTime;
+    fn();
+    stats.runTime = std::chrono::steady_clock::now() - startTime;
+    runTaskStatsCallbacks(stats);
+  };
+}
+
+void EventBase::runTaskStatsCallbacks(const ExecutorTaskStats& stats) {
+  std::lock_guard<std::mutex> lg(taskStatsCallbacksMutex_);
+  inTaskStatsCallback_ = true;
+  SCOPE_EXIT {
+    inTaskStatsCallback_ = false;
+  };
+  try {
+    for (auto& callback : taskStatsCallbacks_) {
+      callback(stats);
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "EventBase " << this << ": task stats callback threw "
+               << typeid(e).name() << " exception: " << e.what();
+  } catch (...) {
+    LOG(ERROR) << "EventBase " << this << ": task stats callback threw "
+               << "non-exception object";
+  }
+}
+
 bool EventBase::runInEventBaseThreadAndWait(Func fn) {
   if (inRunningEventBaseThread()) {
     LOG(ERROR) << "EventBase " << this << ": Waiting in the event loop is not "
@@ -613,7 +857,11 @@ bool EventBase::runLoopCallbacks() {
       LoopCallback* callback = &currentCallbacks.front();
       currentCallbacks.pop_front();
       folly::RequestContextScopeGuard rctx(callback->context_);
-      callback->runLoopCallback();
+      EventBaseLoopProfiler::profile(
+          loopProfiler_,
+          EventBaseLoopProfiler::Phase::LOOP_CALLBACK,
+          &typeid(*callback),
+          [&] { callback->runLoopCallback(); });
     }
 
     runOnceCallbacks_ = nullptr;
@@ -624,12 +872,7 @@ bool EventBase::runLoopCallbacks() {
 
 void EventBase::initNotificationQueue() {
   // Infinite size queue
-  queue_ = std::make_unique<NotificationQueue<Func>>();
-
-  // We allocate fnRunner_ separately, rather than declaring it directly
-  // as a member of EventBase solely so that we don't need to include
-  // NotificationQueue.h from EventBase.h
-  fnRunner_ = std::make_unique<FunctionRunner>();
+  queue_ = std::make_unique<AtomicNotificationQueue>();
 
   // Mark this as an internal event, so event_base_loop() will return if
   // there are no other events besides this one installed.
@@ -640,7 +883,7 @@ void EventBase::initNotificationQueue() {
   // Users can use loopForever() if they do care about the notification queue.
   // (This is useful for EventBase threads that do nothing but process
   // runInEventBaseThread() notifications.)
-  fnRunner_->startConsumingInternal(this, queue_.get());
+  queue_->startConsumingInternal(this);
 }
 
 void EventBase::SmoothLoopTime::setTimeInterval(
@@ -707,14 +950,20 @@ void EventBase::detachTimeoutManager(AsyncTimeout* obj) {
 
 bool EventBase::scheduleTimeout(AsyncTimeout* obj,
                                  TimeoutManager::timeout_type timeout) {
+  return scheduleTimeoutHighRes(obj, timeout);
+}
+
+bool EventBase::scheduleTimeoutHighRes(
+    AsyncTimeout* obj,
+    TimeoutManager::timeout_type_high_res timeout) {
   dcheckIsInEventBaseThread();
   // Set up the timeval and add the event
   struct timeval tv;
-  tv.tv_sec = long(timeout.count() / 1000LL);
-  tv.tv_usec = long((timeout.count() % 1000LL) * 1000LL);
+  tv.tv_sec = long(timeout.count() / 1000000LL);
+  tv.tv_usec = long(timeout.count() % 1000000LL);
 
   struct event* ev = obj->getEvent();
-  if (event_add(ev, &tv) < 0) {
+  if (backend_->addEvent(ev, &tv) < 0) {
     LOG(ERROR) << "EventBase: failed to schedule timeout: " << strerror(errno);
     return false;
   }
@@ -726,7 +975,7 @@ void EventBase::cancelTimeout(AsyncTimeout* obj) {
   dcheckIsInEventBaseThread();
   struct event* ev = obj->getEvent();
   if (EventUtil::isEventRegistered(ev)) {
-    event_del(ev);
+    backend_->delEvent(ev);
   }
 }
 
@@ -27,9 +27,11 @@
 #include <queue>
 #include <set>
 #include <stack>
+#include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 #include <boost/utility.hpp>
@@ -37,11 +39,14 @@
 
 #include <folly/Executor.h>
 #include <folly/Function.h>
+#include <folly/Likely.h>
 #include <folly/Portability.h>
 #include <folly/ScopeGuard.h>
 #include <folly/executors/DrivableExecutor.h>
+#include <folly/executors/ExecutorTaskStats.h>
 #include <folly/experimental/ExecutionObserver.h>
 #include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBaseBackend.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <folly/io/async/Request.h>
 #include <folly/io/async/TimeoutManager.h>
@@ -51,8 +56,7 @@
 namespace folly {
 
 using Cob = Func; // defined in folly/Executor.h
-template <typename MessageT>
-class NotificationQueue;
+class AtomicNotificationQueue;
 
 namespace detail {
 class EventBaseLocalBase;
@@ -62,6 +66,13 @@ class EventBaseLocalBaseBase {
   virtual void onEventBaseDestruction(EventBase& evb) = 0;
   virtual ~EventBaseLocalBaseBase() = default;
 };
+
+// Value of an EventBaseLocal in an EventBase. Slots are reused once their
+// EventBaseLocal is destroyed, so each slot records which one owns it.
+struct EventBaseLocalSlot {
+  uint64_t key{0};
+  std::shared_ptr<void> value;
+};
 } // namespace detail
 template <typename T>
 class EventBaseLocal;
@@ -76,6 +87,56 @@ class EventBaseObserver {
     int64_t busyTime, int64_t idleTime) = 0;
 };
 
+/**
+ * Told what each iteration of an EventBase loop spends its time on, see
+ * EventBase::setLoopProfiler().  Invoked in the EventBase thread.
+ */
+class EventBaseLoopProfiler {
+ public:
+  enum class Phase : uint8_t {
+    POLL, // the rest of the iteration, mostly waiting for events
+    IO, // EventHandler::handlerReady()
+    TIMER, // AsyncTimeout::timeoutExpired(), HHWheelTimer callbacks included
+    LOOP_CALLBACK, // runInLoop() and runBeforeLoop() callbacks
+    FUNCTION, // runInEventBaseThread() functions, a batch at a time
+  };
+  static constexpr size_t kNumPhases = size_t(Phase::FUNCTION) + 1;
+
+  virtual ~EventBaseLoopProfiler() = default;
+
+  virtual void iterationStarting() noexcept = 0;
+  virtual void iterationDone() noexcept = 0;
+
+  /**
+   * A callback of the given phase (not POLL) starts running; type is the
+   * dynamic type of the callback object, nullptr for functions.
+   */
+  virtual void callbackStarting(
+      Phase phase,
+      const std::type_info* type) noexcept = 0;
+  virtual void callbackStopped() noexcept = 0;
+
+  /**
+   * Runs func as a callback of the given phase.
+   */
+  template <typename F>
+  static void profile(
+      EventBaseLoopProfiler* profiler,
+      Phase phase,
+      const std::type_info* type,
+      F&& func) {
+    if (LIKELY(!profiler)) {
+      func();
+      return;
+    }
+    profiler->callbackStarting(phase, type);
+    SCOPE_EXIT {
+      profiler->callbackStopped();
+    };
+    func();
+  }
+};
+
 // Helper class that sets and retrieves the EventBase associated with a given
 // request via RequestContext. See Request.h for that mechanism.
 class RequestEventBase : public RequestData {
@@ -223,6 +284,16 @@ class EventBase : private boost::noncopyable,
    *                              observer, max latency and avg loop time.
    */
   explicit EventBase(event_base* evb, bool enableTimeMeasurement = true);
+
+  /**
+   * Create a new EventBase object that will use the specified backend to
+   * drive the event loop, e.g. an IoUringBackend.
+   *
+   * @param enableTimeMeasurement See above.
+   */
+  explicit EventBase(
+      std::unique_ptr<EventBaseBackend> backend,
+      bool enableTimeMeasurement = true);
   ~EventBase() override;
 
   /**
@@ -381,6 +452,9 @@ class EventBase : private boost::noncopyable,
    * Ordering between functions scheduled from separate threads is not
    * guaranteed.
    *
+   * Scheduling is lock-free, and only wakes the loop up (an eventfd write)
+   * if it is blocked waiting for events.
+   *
    * @param fn  The function to run.  The function must not throw any
    *     exceptions.
    * @param arg An argument to pass to the function.
@@ -408,6 +482,13 @@ class EventBase : private boost::noncopyable,
    */
   bool runInEventBaseThread(Func fn);
 
+  /**
+   * Like runInEventBaseThread() for each function in order, but all of them
+   * are queued at once, which is cheaper.  Empty functions are skipped,
+   * with the same error logged as for runInEventBaseThread(nullptr).
+   */
+  bool runInEventBaseThread(std::vector<Func> fns);
+
   /*
    * Like runInEventBaseThread, but the caller waits for the callback to be
    * executed.
@@ -464,6 +545,16 @@ class EventBase : private boost::noncopyable,
     return avgLoopTime_.get();
   }
 
+  /**
+   * Get the fraction of time, between 0 and 1, the loop spends busy
+   * (exponentially smoothed like getAvgLoopTime()). Unlike the latter it
+   * may be called from any thread. Only updated when the loop wakes up, so
+   * a loop that went to sleep busy keeps reporting a high value.
+   */
+  double getBusyRatio() const {
+    return busyRatio_.load(std::memory_order_relaxed);
+  }
+
   /**
     * check if the event base loop is running.
    */
@@ -480,6 +571,49 @@ class EventBase : private boost::noncopyable,
 
   void setMaxReadAtOnce(uint32_t maxAtOnce);
 
+  /**
+   * Busy polling, for latency-sensitive loops that can spare a core.
+   *
+   * When it runs out of work, the loop normally blocks in the backend, and
+   * the next event pays for a wakeup through the scheduler.  With busy
+   * polling it first polls the backend without blocking, for up to the
+   * spin budget, and only blocks if nothing happened in the meantime.
+   * runInEventBaseThread() doesn't write the eventfd while the loop spins.
+   *
+   * The spin budget adapts to how long the loop usually stays idle: it is
+   * twice the smoothed idle time, capped at maxSpin, and 0 once the loop
+   * usually stays idle for longer than maxSpin (spinning would then mostly
+   * burn CPU for nothing).  Idle times are still measured while it doesn't
+   * spin, so spinning resumes when events come in faster again.
+   *
+   * To also skip the interrupt on the receive path, busy poll the sockets
+   * too, see AsyncSocket::setBusyPoll().
+   *
+   * A maxSpin of 0 (the default) disables busy polling.  Resets the
+   * counters returned by getBusyPollStats().
+   */
+  void setBusyPoll(std::chrono::microseconds maxSpin);
+
+  struct BusyPollStats {
+    // Idle periods that the loop spun through, and how many of them ended
+    // with work before the spin budget ran out
+    uint64_t spins{0};
+    uint64_t spinHits{0};
+    // Idle periods that the loop blocked through
+    uint64_t parks{0};
+    std::chrono::nanoseconds spinTime{0};
+    std::chrono::nanoseconds parkTime{0};
+    // The current spin budget
+    std::chrono::nanoseconds spinBudget{0};
+  };
+
+  /**
+   * Busy polling counters since the last setBusyPoll().  spinHits / spins
+   * is how often spinning paid off, and spinTime / parkTime how much of
+   * its idle time the loop burns.  May be called from any thread.
+   */
+  BusyPollStats getBusyPollStats() const;
+
   /**
    * Verify that current thread is the EventBase thread, if the EventBase is
    * running.
@@ -518,6 +652,9 @@ class EventBase : private boost::noncopyable,
   // guaranteed to always be present if we ever provide alternative EventBase
   // implementations that do not use libevent internally.
   event_base* getLibeventBase() const { return evb_; }
+  EventBaseBackend* getBackend() const {
+    return backend_.get();
+  }
   static const char* getLibeventVersion();
   static const char* getLibeventMethod();
 
@@ -587,6 +724,30 @@ class EventBase : private boost::noncopyable,
     return executionObserver_;
   }
 
+  /**
+   * Tells profiler about each loop iteration, and each callback it runs.
+   * Must be called from the EventBase thread, or before the loop starts.
+   */
+  void setLoopProfiler(EventBaseLoopProfiler* profiler) {
+    dcheckIsInEventBaseThread();
+    loopProfiler_ = profiler;
+  }
+
+  EventBaseLoopProfiler* getLoopProfiler() const override {
+    return loopProfiler_;
+  }
+
+  /**
+   * Reports how long each function run with runInEventBaseThread() (or
+   * add()) waited and ran, and how many functions were pending in the
+   * notification queue when it was added.  The callback runs in the
+   * EventBase thread, after each function.
+   *
+   * Functions are only measured while a callback is subscribed, from any
+   * thread, but not from a task stats callback.
+   */
+  void subscribeToTaskStats(ExecutorTaskStatsCallback cb);
+
   /**
    * Set the name of the thread that runs this event base.
    */
@@ -631,6 +792,10 @@ class EventBase : private boost::noncopyable,
   bool scheduleTimeout(AsyncTimeout* obj, TimeoutManager::timeout_type timeout)
       final;
 
+  bool scheduleTimeoutHighRes(
+      AsyncTimeout* obj,
+      TimeoutManager::timeout_type_high_res timeout) final;
+
   void cancelTimeout(AsyncTimeout* obj) final;
 
   bool isInTimeoutManagerThread() final {
@@ -673,8 +838,11 @@ class EventBase : private boost::noncopyable,
    */
   bool nothingHandledYet() const noexcept;
 
+  void updateBusyRatio(
+      std::chrono::microseconds busy,
+      std::chrono::microseconds idle);
+
   typedef LoopCallback::List LoopCallbackList;
-  class FunctionRunner;
 
   bool loopBody(int flags = 0);
 
@@ -683,6 +851,18 @@ class EventBase : private boost::noncopyable,
 
   void initNotificationQueue();
 
+  // Polls the backend until something happens or the spin budget runs
+  // out, then returns true if something happened (with the result of the
+  // last poll in res)
+  bool busyPoll(int& res);
+  // Blocks in the backend until something happens
+  int park();
+  void updateBusyPollIdle(std::chrono::nanoseconds idle);
+
+  // Wraps fn to report its task stats
+  Func measureTask(Func fn);
+  void runTaskStatsCallbacks(const ExecutorTaskStats& stats);
+
   // should only be accessed through public getter
   HHWheelTimer::UniquePtr wheelTimer_;
 
@@ -704,13 +884,13 @@ class EventBase : private boost::noncopyable,
   // std::thread::id{} if loop is not running.
   std::atomic<std::thread::id> loopThread_;
 
-  // pointer to underlying event_base class doing the heavy lifting
+  // the backend doing the heavy lifting, and its event_base
+  std::unique_ptr<EventBaseBackend> backend_;
   event_base* evb_;
 
   // A notification queue for runInEventBaseThread() to use
   // to send function requests to the EventBase thread.
-  std::unique_ptr<NotificationQueue<Func>> queue_;
-  std::unique_ptr<FunctionRunner> fnRunner_;
+  std::unique_ptr<AtomicNotificationQueue> queue_;
   ssize_t loopKeepAliveCount_{0};
   std::atomic<ssize_t> loopKeepAliveCountAtomic_{0};
   bool loopKeepAliveActive_{false};
@@ -726,6 +906,10 @@ class EventBase : private boost::noncopyable,
   // to reduce spamminess
   SmoothLoopTime maxLatencyLoopTime_;
 
+  // see getBusyRatio(); decays over the interval given to setLoadAvgMsec()
+  std::atomic<double> busyRatio_{0.0};
+  std::chrono::microseconds busyRatioInterval_{std::chrono::seconds(2)};
+
   // callback called when latency limit is exceeded
   Func maxLatencyCob_;
 
@@ -738,6 +922,22 @@ class EventBase : private boost::noncopyable,
   uint64_t nextLoopCnt_;
   uint64_t latestLoopCnt_;
   std::chrono::steady_clock::time_point startWork_;
+  // Events and timeouts handled so far, see busyPoll()
+  uint64_t eventsHandled_{0};
+
+  // Busy polling, see setBusyPoll(); 0 disables it
+  std::chrono::microseconds busyPollMaxSpin_{0};
+  // Smoothed idle time, and the spin budget derived from it
+  std::chrono::nanoseconds busyPollIdle_{0};
+  std::chrono::nanoseconds busyPollBudget_{0};
+  std::chrono::steady_clock::time_point busyPollIdleStart_;
+  // Written by the EventBase thread only, read by getBusyPollStats()
+  std::atomic<uint64_t> busyPollSpins_{0};
+  std::atomic<uint64_t> busyPollSpinHits_{0};
+  std::atomic<uint64_t> busyPollParks_{0};
+  std::atomic<int64_t> busyPollSpinNsec_{0};
+  std::atomic<int64_t> busyPollParkNsec_{0};
+  std::atomic<int64_t> busyPollBudgetNsec_{0};
   // Prevent undefined behavior from invoking event_base_loop() reentrantly.
   // This is needed since many projects use libevent-1.4, which lacks commit
   // b557b175c00dc462c1fce25f6e7dd67121d2c001 from
@@ -751,16 +951,26 @@ class EventBase : private boost::noncopyable,
   // EventHandler's execution observer.
   ExecutionObserver* executionObserver_;
 
+  EventBaseLoopProfiler* loopProfiler_{nullptr};
+
   // Name of the thread running this EventBase
   std::string name_;
 
   // allow runOnDestruction() to be called from any threads
   std::mutex onDestructionCallbacksMutex_;
 
+  // Set once the first task stats callback is subscribed
+  std::atomic<bool> hasTaskStatsCallbacks_{false};
+  std::mutex taskStatsCallbacksMutex_;
+  std::vector<ExecutorTaskStatsCallback> taskStatsCallbacks_;
+  // EventBase thread only
+  bool inTaskStatsCallback_{false};
+
   // see EventBaseLocal
   friend class detail::EventBaseLocalBase;
   template <typename T> friend class EventBaseLocal;
-  std::unordered_map<uint64_t, std::shared_ptr<void>> localStorage_;
+  // Indexed by EventBaseLocalBase::slot_
+  std::vector<detail::EventBaseLocalSlot> localStorage_;
   std::unordered_set<detail::EventBaseLocalBaseBase*> localStorageToDtor_;
 
   folly::once_flag virtualEventBaseInitFlag_;
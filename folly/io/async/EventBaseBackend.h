@@ -0,0 +1,66 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/portability/Event.h>
+
+namespace folly {
+
+/**
+ * The event demultiplexer underneath an EventBase.
+ *
+ * EventHandler, AsyncTimeout and AsyncSignalHandler keep describing their
+ * events with a libevent struct event (fd, EV_* flags, callback and
+ * argument), but they install and remove them through the EventBase's
+ * backend rather than calling event_add() / event_del() directly.  The
+ * default backend simply forwards to libevent; IoUringBackend drives the
+ * same events from an io_uring instance.
+ *
+ * The methods mirror the libevent calls they replace, including their
+ * return conventions.
+ */
+class EventBaseBackend {
+ public:
+  virtual ~EventBaseBackend() = default;
+
+  /**
+   * The libevent event_base that events are attached to with
+   * event_base_set().  Backends that don't use libevent to dispatch events
+   * still provide one, it's used as a marker by code that checks whether an
+   * event is attached.
+   */
+  virtual event_base* getEventBase() = 0;
+
+  /**
+   * Like event_base_loop(): returns 0 on success, 1 if there were no
+   * (non-internal) events registered, and -1 on error.
+   */
+  virtual int loop(int flags) = 0;
+
+  /**
+   * Like event_base_loopbreak(), may be called from any thread.
+   */
+  virtual int loopBreak() = 0;
+
+  /**
+   * Like event_add() / event_del(): return 0 on success and -1 on error.
+   */
+  virtual int addEvent(struct event* ev, const struct timeval* timeout) = 0;
+  virtual int delEvent(struct event* ev) = 0;
+};
+
+} // namespace folly
@@ -15,31 +15,69 @@
  */
 
 #include <folly/io/async/EventBaseLocal.h>
-#include <folly/MapUtil.h>
+#include <folly/Indestructible.h>
 #include <atomic>
 #include <thread>
+#include <vector>
 
 namespace folly { namespace detail {
 
+namespace {
+
+struct SlotRegistry {
+  uint32_t next{0};
+  std::vector<uint32_t> released;
+};
+
+Synchronized<SlotRegistry>& slotRegistry() {
+  static Indestructible<Synchronized<SlotRegistry>> registry;
+  return *registry;
+}
+
+uint32_t allocateSlot() {
+  auto registry = slotRegistry().wlock();
+  if (registry->released.empty()) {
+    return registry->next++;
+  }
+  auto slot = registry->released.back();
+  registry->released.pop_back();
+  return slot;
+}
+
+void releaseSlot(uint32_t slot) {
+  slotRegistry().wlock()->released.push_back(slot);
+}
+
+// Clears the slot if it still belongs to key
+void clearSlot(
+    std::vector<EventBaseLocalSlot>& storage,
+    uint32_t slot,
+    uint64_t key) {
+  if (slot < storage.size() && storage[slot].key == key) {
+    storage[slot] = EventBaseLocalSlot();
+  }
+}
+
+} // namespace
+
+EventBaseLocalBase::EventBaseLocalBase() : slot_(allocateSlot()) {}
+
 EventBaseLocalBase::~EventBaseLocalBase() {
   for (auto* evb : *eventBases_.rlock()) {
-    evb->runInEventBaseThread([ this, evb, key = key_ ] {
-      evb->localStorage_.erase(key);
+    evb->runInEventBaseThread([ this, evb, slot = slot_, key = key_ ] {
+      clearSlot(evb->localStorage_, slot, key);
       evb->localStorageToDtor_.erase(this);
     });
   }
-}
-
-void* EventBaseLocalBase::getVoid(EventBase& evb) {
-  evb.dcheckIsInEventBaseThread();
-
-  return folly::get_default(evb.localStorage_, key_, {}).get();
+  // The slot may be reused before the callbacks above run; they only clear
+  // it if it is still ours.
+  releaseSlot(slot_);
 }
 
 void EventBaseLocalBase::erase(EventBase& evb) {
   evb.dcheckIsInEventBaseThread();
 
-  evb.localStorage_.erase(key_);
+  clearSlot(evb.localStorage_, slot_, key_);
   evb.localStorageToDtor_.erase(this);
 
   SYNCHRONIZED(eventBases_) {
@@ -58,12 +96,17 @@ void EventBaseLocalBase::onEventBaseDestruction(EventBase& evb) {
 void EventBaseLocalBase::setVoid(EventBase& evb, std::shared_ptr<void>&& ptr) {
   evb.dcheckIsInEventBaseThread();
 
-  auto alreadyExists =
-    evb.localStorage_.find(key_) != evb.localStorage_.end();
-
-  evb.localStorage_.emplace(key_, std::move(ptr));
+  auto& storage = evb.localStorage_;
+  if (slot_ >= storage.size()) {
+    storage.resize(slot_ + 1);
+  }
+  auto& entry = storage[slot_];
+  auto alreadyExists = entry.key == key_;
 
+  // Doesn't replace an existing value
   if (!alreadyExists) {
+    entry.key = key_;
+    entry.value = std::move(ptr);
     eventBases_.wlock()->insert(&evb);
     evb.localStorageToDtor_.insert(this);
   }
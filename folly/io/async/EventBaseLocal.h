@@ -30,18 +30,31 @@ namespace detail {
 
 class EventBaseLocalBase : public EventBaseLocalBaseBase, boost::noncopyable {
  public:
-  EventBaseLocalBase() {}
+  EventBaseLocalBase();
   ~EventBaseLocalBase() override;
   void erase(EventBase& evb);
   void onEventBaseDestruction(EventBase& evb) override;
 
  protected:
   void setVoid(EventBase& evb, std::shared_ptr<void>&& ptr);
-  void* getVoid(EventBase& evb);
+
+  void* getVoid(EventBase& evb) {
+    evb.dcheckIsInEventBaseThread();
+
+    const auto& storage = evb.localStorage_;
+    if (slot_ < storage.size() && storage[slot_].key == key_) {
+      return storage[slot_].value.get();
+    }
+    return nullptr;
+  }
 
   folly::Synchronized<std::unordered_set<EventBase*>> eventBases_;
   static std::atomic<uint64_t> keyCounter_;
-  uint64_t key_{keyCounter_++};
+  // Never 0, which marks an unused EventBaseLocalSlot
+  const uint64_t key_{++keyCounter_};
+  // Index of this local's slot in every EventBase. Slots are allocated
+  // densely from a global registry, and reused once released.
+  const uint32_t slot_;
 };
 
 } // namespace detail
@@ -64,7 +77,8 @@ class EventBaseLocalBase : public EventBaseLocalBaseBase, boost::noncopyable {
  *
  * The objects will be deleted when the EventBaseLocal or the EventBase is
  * destructed (whichever comes first). All methods must be called from the
- * EventBase thread.
+ * EventBase thread. Each EventBaseLocal owns a small integer slot, so get() is
+ * an index into an array of the EventBase, without locks or hashing.
  *
  * The user is responsible for throwing away invalid references/ptrs returned
  * by the get() method after set/erase is called.  If shared ownership is
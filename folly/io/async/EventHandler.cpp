@@ -51,7 +51,7 @@ bool EventHandler::registerImpl(uint16_t events, bool internal) {
       return true;
     }
 
-    event_del(&event_);
+    eventBase_->getBackend()->delEvent(&event_);
   }
 
   // Update the event flags
@@ -88,11 +88,11 @@ bool EventHandler::registerImpl(uint16_t events, bool internal) {
   // if the I/O event flags haven't changed.  Using a separate event struct is
   // therefore slightly more efficient in this case (although it does take up
   // more space).
-  if (event_add(&event_, nullptr) < 0) {
+  if (eventBase_->getBackend()->addEvent(&event_, nullptr) < 0) {
     LOG(ERROR) << "EventBase: failed to register event handler for fd "
                << event_.ev_fd << ": " << strerror(errno);
     // Call event_del() to make sure the event is completely uninstalled
-    event_del(&event_);
+    eventBase_->getBackend()->delEvent(&event_);
     return false;
   }
 
@@ -101,7 +101,7 @@ bool EventHandler::registerImpl(uint16_t events, bool internal) {
 
 void EventHandler::unregisterHandler() {
   if (isHandlerRegistered()) {
-    event_del(&event_);
+    eventBase_->getBackend()->delEvent(&event_);
   }
 }
 
@@ -157,7 +157,11 @@ void EventHandler::libeventCallback(libevent_fd_t fd, short events, void* arg) {
   // this can't possibly fire if handler->eventBase_ is nullptr
   handler->eventBase_->bumpHandlingTime();
 
-  handler->handlerReady(uint16_t(events));
+  EventBaseLoopProfiler::profile(
+      handler->eventBase_->getLoopProfiler(),
+      EventBaseLoopProfiler::Phase::IO,
+      &typeid(*handler),
+      [&] { handler->handlerReady(uint16_t(events)); });
 
   if (observer) {
     observer->stopped(reinterpret_cast<uintptr_t>(handler));
@@ -15,19 +15,20 @@
  */
 
 #include <folly/io/async/HHWheelTimer.h>
+#include <folly/io/async/EventBase.h>
 #include <folly/io/async/Request.h>
 
 #include <folly/BitIterator.h>
+#include <folly/Likely.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/ScopeGuard.h>
 
 #include <folly/Bits.h>
 
+#include <algorithm>
 #include <cassert>
 
-using std::chrono::milliseconds;
-
 namespace folly {
 
 /**
@@ -42,16 +43,95 @@ namespace folly {
  * start showing up in cpu perf.  Also, it might not be possible to set
  * tick interval less than 10ms on older kernels.
  */
+template <>
 int HHWheelTimer::DEFAULT_TICK_INTERVAL = 10;
 
-HHWheelTimer::Callback::~Callback() {
+/**
+ * HHWheelTimerHighRes is for loops that need finer timeouts, and pay for
+ * the extra wakeups; 200us still covers about 10 days.
+ */
+template <>
+int HHWheelTimerHighRes::DEFAULT_TICK_INTERVAL = 200;
+
+namespace {
+
+bool scheduleAsyncTimeout(AsyncTimeout& t, std::chrono::milliseconds timeout) {
+  return t.scheduleTimeout(timeout);
+}
+
+bool scheduleAsyncTimeout(AsyncTimeout& t, std::chrono::microseconds timeout) {
+  return t.scheduleTimeoutHighRes(timeout);
+}
+
+} // namespace
+
+/**
+ * Owned by a Callback while it is scheduled with a cancellation token, and
+ * destroyed on the timer's thread as soon as it is no longer scheduled.
+ *
+ * requestCancellation() may run on any thread, so the cancellation itself is
+ * posted to the EventBase, and finds the Callback through target_, which is
+ * cleared when the handle goes away.
+ */
+template <class Duration>
+class HHWheelTimerBase<Duration>::Callback::CancellationHandle {
+ public:
+  CancellationHandle(
+      Callback* callback,
+      EventBase* evb,
+      const CancellationToken& token)
+      : target_(std::make_shared<Callback*>(callback)),
+        cancellationCallback_(token, [this, target = target_, evb] {
+          if (!evb->isInEventBaseThread()) {
+            evb->runInEventBaseThread([target] { cancel(*target); });
+          } else if (registered_) {
+            cancel(*target);
+          } else {
+            // Already cancelled when registering; scheduleTimeout() handles
+            // that once the handle is fully constructed.
+            cancelledWhileRegistering_ = true;
+          }
+        }) {
+    registered_ = true;
+  }
+
+  ~CancellationHandle() {
+    *target_ = nullptr;
+  }
+
+  bool cancelledWhileRegistering() const {
+    return cancelledWhileRegistering_;
+  }
+
+  static void cancel(Callback* callback) {
+    if (callback) {
+      callback->cancelTimeout();
+      callback->callbackCanceled();
+    }
+  }
+
+ private:
+  std::shared_ptr<Callback*> target_;
+  // Only accessed on the EventBase thread.
+  bool registered_{false};
+  bool cancelledWhileRegistering_{false};
+  CancellationCallback cancellationCallback_;
+};
+
+template <class Duration>
+HHWheelTimerBase<Duration>::Callback::Callback() = default;
+
+template <class Duration>
+HHWheelTimerBase<Duration>::Callback::~Callback() {
   if (isScheduled()) {
     cancelTimeout();
   }
 }
 
-void HHWheelTimer::Callback::setScheduled(HHWheelTimer* wheel,
-                                          std::chrono::milliseconds timeout) {
+template <class Duration>
+void HHWheelTimerBase<Duration>::Callback::setScheduled(
+    HHWheelTimerBase* wheel,
+    Duration timeout) {
   assert(wheel_ == nullptr);
   assert(expiration_ == decltype(expiration_){});
 
@@ -60,38 +140,45 @@ void HHWheelTimer::Callback::setScheduled(HHWheelTimer* wheel,
   expiration_ = getCurTime() + timeout;
 }
 
-void HHWheelTimer::Callback::cancelTimeoutImpl() {
+template <class Duration>
+void HHWheelTimerBase<Duration>::Callback::cancelTimeoutImpl() {
   if (--wheel_->count_ <= 0) {
     assert(wheel_->count_ == 0);
     wheel_->AsyncTimeout::cancelTimeout();
   }
   unlink();
-  if ((-1 != bucket_) && (wheel_->buckets_[0][bucket_].empty())) {
-    auto bi = makeBitIterator(wheel_->bitmap_.begin());
-    *(bi + bucket_) = false;
+  if (bucket_ >= int(TICKS_SIZE)) {
+    --wheel_->bucket1Count_[bucket_ - TICKS_SIZE];
+  } else if (bucket_ != -1 && wheel_->ticks_[bucket_].empty()) {
+    wheel_->setTickBit(bucket_, false);
   }
 
   wheel_ = nullptr;
   expiration_ = {};
+  bucket_ = -1;
+  cancellation_.reset();
 }
 
-HHWheelTimer::HHWheelTimer(
+template <class Duration>
+HHWheelTimerBase<Duration>::HHWheelTimerBase(
     folly::TimeoutManager* timeoutMananger,
-    std::chrono::milliseconds intervalMS,
+    Duration intervalMS,
     AsyncTimeout::InternalEnum internal,
-    std::chrono::milliseconds defaultTimeoutMS)
+    Duration defaultTimeoutMS)
     : AsyncTimeout(timeoutMananger, internal),
       interval_(intervalMS),
       defaultTimeout_(defaultTimeoutMS),
+      bucket1Count_(),
       lastTick_(1),
       expireTick_(1),
       count_(0),
       startTime_(getCurTime()),
       processingCallbacksGuard_(nullptr) {
-  bitmap_.resize((WHEEL_SIZE / sizeof(uint64_t)) / 8, 0);
+  bitmap_.resize(TICKS_SIZE / 64, 0);
 }
 
-HHWheelTimer::~HHWheelTimer() {
+template <class Duration>
+HHWheelTimerBase<Duration>::~HHWheelTimerBase() {
   // Ensure this gets done, but right before destruction finishes.
   auto destructionPublisherGuard = folly::makeGuard([&] {
     // Inform the subscriber that this instance is doomed.
@@ -108,40 +195,60 @@ HHWheelTimer::~HHWheelTimer() {
   cancelAll();
 }
 
-void HHWheelTimer::scheduleTimeoutImpl(Callback* callback,
-                                       std::chrono::milliseconds timeout) {
-  auto nextTick = calcNextTick();
-  int64_t due = timeToWheelTicks(timeout) + nextTick;
-  int64_t diff = due - nextTick;
-  CallbackList* list;
-
+template <class Duration>
+void HHWheelTimerBase<Duration>::setTickBit(unsigned int slot, bool value) {
   auto bi = makeBitIterator(bitmap_.begin());
+  *(bi + slot) = value;
+}
+
+template <class Duration>
+void HHWheelTimerBase<Duration>::place(Callback* callback, int64_t now) {
+  int64_t due = std::max(callback->expireTick_, now);
+  int64_t diff = due - now;
+
+  // Bucket 0 takes everything due by the end of the next WHEEL_SIZE ticks
+  if ((due >> WHEEL_BITS) <= (now >> WHEEL_BITS) + 1) {
+    unsigned int slot = due & TICKS_MASK;
+    ticks_[slot].push_back(*callback);
+    setTickBit(slot, true);
+    callback->bucket_ = int(slot);
+    return;
+  }
 
-  if (diff < 0) {
-    list = &buckets_[0][nextTick & WHEEL_MASK];
-    *(bi + (nextTick & WHEEL_MASK)) = true;
-    callback->bucket_ = nextTick & WHEEL_MASK;
-  } else if (diff < WHEEL_SIZE) {
-    list = &buckets_[0][due & WHEEL_MASK];
-    *(bi + (due & WHEEL_MASK)) = true;
-    callback->bucket_ = due & WHEEL_MASK;
-  } else if (diff < 1 << (2 * WHEEL_BITS)) {
-    list = &buckets_[1][(due >> WHEEL_BITS) & WHEEL_MASK];
+  CallbackList* list;
+  if (diff < 1 << (2 * WHEEL_BITS)) {
+    unsigned int slot = (due >> WHEEL_BITS) & WHEEL_MASK;
+    list = &buckets_[0][slot];
+    ++bucket1Count_[slot];
+    callback->bucket_ = int(TICKS_SIZE + slot);
   } else if (diff < 1 << (3 * WHEEL_BITS)) {
-    list = &buckets_[2][(due >> 2 * WHEEL_BITS) & WHEEL_MASK];
+    list = &buckets_[1][(due >> 2 * WHEEL_BITS) & WHEEL_MASK];
+    callback->bucket_ = -1;
   } else {
     /* in largest slot */
     if (diff > LARGEST_SLOT) {
       diff = LARGEST_SLOT;
-      due = diff + nextTick;
+      due = diff + now;
     }
-    list = &buckets_[3][(due >> 3 * WHEEL_BITS) & WHEEL_MASK];
+    list = &buckets_[2][(due >> 3 * WHEEL_BITS) & WHEEL_MASK];
+    callback->bucket_ = -1;
   }
   list->push_back(*callback);
 }
 
-void HHWheelTimer::scheduleTimeout(Callback* callback,
-                                   std::chrono::milliseconds timeout) {
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleTimeoutImpl(
+    Callback* callback,
+    Duration timeout) {
+  auto nextTick = calcNextTick();
+  callback->expireTick_ = timeToWheelTicks(timeout) + nextTick;
+  place(callback, nextTick);
+}
+
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleTimeout(
+    Callback* callback,
+    Duration timeout) {
   // Cancel the callback if it happens to be scheduled already.
   callback->cancelTimeout();
 
@@ -160,26 +267,58 @@ void HHWheelTimer::scheduleTimeout(Callback* callback,
   }
 }
 
-void HHWheelTimer::scheduleTimeout(Callback* callback) {
-  CHECK(std::chrono::milliseconds(-1) != defaultTimeout_)
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleTimeout(Callback* callback) {
+  CHECK(Duration(-1) != defaultTimeout_)
       << "Default timeout was not initialized";
   scheduleTimeout(callback, defaultTimeout_);
 }
 
-bool HHWheelTimer::cascadeTimers(int bucket, int tick) {
-  CallbackList cbs;
-  cbs.swap(buckets_[bucket][tick]);
-  while (!cbs.empty()) {
-    auto* cb = &cbs.front();
-    cbs.pop_front();
-    scheduleTimeoutImpl(cb, cb->getTimeRemaining(getCurTime()));
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleTimeout(
+    Callback* callback,
+    Duration timeout,
+    CancellationToken token) {
+  if (token.isCancellationRequested()) {
+    Callback::CancellationHandle::cancel(callback);
+    return;
+  }
+  scheduleTimeout(callback, timeout);
+  if (!token.canBeCancelled()) {
+    return;
   }
 
-  // If tick is zero, timeoutExpired will cascade the next bucket.
-  return tick == 0;
+  // getTimeoutManager() only hands out a const pointer.
+  auto evb = const_cast<EventBase*>(
+      dynamic_cast<const EventBase*>(getTimeoutManager()));
+  CHECK(evb) << "Cancellable timeouts need an EventBase-driven HHWheelTimer";
+  callback->cancellation_ =
+      std::make_unique<typename Callback::CancellationHandle>(
+          callback, evb, token);
+  if (callback->cancellation_->cancelledWhileRegistering()) {
+    Callback::CancellationHandle::cancel(callback);
+  }
 }
 
-void HHWheelTimer::timeoutExpired() noexcept {
+template <class Duration>
+void HHWheelTimerBase<Duration>::cascadeTimers(
+    int bucket,
+    int tick,
+    int64_t now,
+    uint64_t max) {
+  auto& list = buckets_[bucket - 1][tick];
+  for (; max != 0 && !list.empty(); --max) {
+    auto* cb = &list.front();
+    list.pop_front();
+    if (bucket == 1) {
+      --bucket1Count_[tick];
+    }
+    place(cb, now);
+  }
+}
+
+template <class Duration>
+void HHWheelTimerBase<Duration>::timeoutExpired() noexcept {
   auto nextTick = calcNextTick();
 
   // If the last smart pointer for "this" is reset inside the callback's
@@ -202,26 +341,48 @@ void HHWheelTimer::timeoutExpired() noexcept {
   //
   lastTick_ = expireTick_;
   while (lastTick_ < nextTick) {
-    int idx = lastTick_ & WHEEL_MASK;
+    int64_t tick = lastTick_;
+    int idx = tick & WHEEL_MASK;
 
-    auto bi = makeBitIterator(bitmap_.begin());
-    *(bi + idx) = false;
+    if (idx == 0) {
+      // Cascade timers: buckets 2 and 3 wrapped around, and bucket 1 only
+      // has what it didn't cascade ahead of time (if the wheel lagged)
+      auto window = tick >> WHEEL_BITS;
+      if ((window & WHEEL_MASK) == 0) {
+        if (((window >> WHEEL_BITS) & WHEEL_MASK) == 0) {
+          cascadeTimers(3, (tick >> (3 * WHEEL_BITS)) & WHEEL_MASK, tick);
+        }
+        cascadeTimers(2, (tick >> (2 * WHEEL_BITS)) & WHEEL_MASK, tick);
+      }
+      cascadeTimers(1, window & WHEEL_MASK, tick);
+    }
 
-    lastTick_++;
-    CallbackList* cbs = &buckets_[0][idx];
+    unsigned int slot = tick & TICKS_MASK;
+    setTickBit(slot, false);
+    CallbackList* cbs = &ticks_[slot];
     while (!cbs->empty()) {
       auto* cb = &cbs->front();
       cbs->pop_front();
+      if (UNLIKELY(cb->expireTick_ > tick)) {
+        // Scheduled more than WHEEL_SIZE ticks ahead while the wheel lagged
+        place(cb, tick);
+        continue;
+      }
+      cb->bucket_ = -1;
       timeouts.push_back(*cb);
     }
 
-    if (idx == 0) {
-      // Cascade timers
-      if (cascadeTimers(1, (lastTick_ >> WHEEL_BITS) & WHEEL_MASK) &&
-          cascadeTimers(2, (lastTick_ >> (2 * WHEEL_BITS)) & WHEEL_MASK)) {
-        cascadeTimers(3, (lastTick_ >> (3 * WHEEL_BITS)) & WHEEL_MASK);
+    // Move a slice of the next bucket 1 list into bucket 0, so that it is
+    // empty by the time bucket 0 wraps around
+    if (idx % CASCADE_STRIDE == 0) {
+      int next = ((tick >> WHEEL_BITS) + 1) & WHEEL_MASK;
+      if (auto count = bucket1Count_[next]) {
+        uint64_t steps = (WHEEL_SIZE - idx) / CASCADE_STRIDE;
+        cascadeTimers(1, next, tick, (count + steps - 1) / steps);
       }
     }
+
+    lastTick_++;
   }
 
   while (!timeouts.empty()) {
@@ -230,7 +391,8 @@ void HHWheelTimer::timeoutExpired() noexcept {
     count_--;
     cb->wheel_ = nullptr;
     cb->expiration_ = {};
-    RequestContextScopeGuard rctx(cb->context_);
+    cb->cancellation_.reset();
+    RequestContextScopeGuard rctx(std::move(cb->context_));
     cb->timeoutExpired();
     if (isDestroyed) {
       // The HHWheelTimer itself has been destroyed. The other callbacks
@@ -242,24 +404,29 @@ void HHWheelTimer::timeoutExpired() noexcept {
   scheduleNextTimeout();
 }
 
-size_t HHWheelTimer::cancelAll() {
+template <class Duration>
+size_t HHWheelTimerBase<Duration>::cancelAll() {
   size_t count = 0;
 
   if (count_ != 0) {
-    const uint64_t numElements = WHEEL_BUCKETS * WHEEL_SIZE;
+    const uint64_t numElements =
+        TICKS_SIZE + (WHEEL_BUCKETS - 1) * WHEEL_SIZE;
     auto maxBuckets = std::min(numElements, count_);
     auto buckets = std::make_unique<CallbackList[]>(maxBuckets);
     size_t countBuckets = 0;
+    auto take = [&](CallbackList& bucket) {
+      if (count >= count_ || bucket.empty()) {
+        return;
+      }
+      count += bucket.size();
+      std::swap(bucket, buckets[countBuckets++]);
+    };
+    for (auto& bucket : ticks_) {
+      take(bucket);
+    }
     for (auto& tick : buckets_) {
       for (auto& bucket : tick) {
-        if (bucket.empty()) {
-          continue;
-        }
-        count += bucket.size();
-        std::swap(bucket, buckets[countBuckets++]);
-        if (count >= count_) {
-          break;
-        }
+        take(bucket);
       }
     }
 
@@ -276,25 +443,34 @@ size_t HHWheelTimer::cancelAll() {
   return count;
 }
 
-void HHWheelTimer::scheduleNextTimeout() {
+template <class Duration>
+void HHWheelTimerBase<Duration>::scheduleNextTimeout() {
   auto nextTick = calcNextTick();
   int64_t tick = 1;
 
   if (nextTick & WHEEL_MASK) {
+    // Look for a timer due before bucket 0 wraps around
+    unsigned int slot = nextTick & TICKS_MASK;
     auto bi = makeBitIterator(bitmap_.begin());
-    auto bi_end = makeBitIterator(bitmap_.end());
-    auto it = folly::findFirstSet(bi + (nextTick & WHEEL_MASK), bi_end);
+    auto bi_end = bi + ((slot | WHEEL_MASK) + 1);
+    auto it = folly::findFirstSet(bi + slot, bi_end);
     if (it == bi_end) {
       tick = WHEEL_SIZE - ((nextTick - 1) & WHEEL_MASK);
     } else {
-      tick = std::distance(bi + (nextTick & WHEEL_MASK), it) + 1;
+      tick = std::distance(bi + slot, it) + 1;
+    }
+
+    // Wake up for the next slice of bucket 1 to cascade
+    if (bucket1Count_[((nextTick >> WHEEL_BITS) + 1) & WHEEL_MASK]) {
+      int64_t stride = -nextTick & (CASCADE_STRIDE - 1);
+      tick = std::min(tick, stride + 1);
     }
   }
 
   if (count_ > 0) {
     if (!this->AsyncTimeout::isScheduled() ||
         (expireTick_ > tick + nextTick - 1)) {
-      this->AsyncTimeout::scheduleTimeout(interval_ * tick);
+      scheduleAsyncTimeout(*this, interval_ * tick);
       expireTick_ = tick + nextTick - 1;
     }
   } else {
@@ -302,8 +478,15 @@ void HHWheelTimer::scheduleNextTimeout() {
   }
 }
 
-int64_t HHWheelTimer::calcNextTick() {
-  auto intervals = (getCurTime() - startTime_) / interval_;
+template <class Duration>
+int64_t HHWheelTimerBase<Duration>::calcNextTick() {
+  return calcNextTick(getCurTime());
+}
+
+template <class Duration>
+int64_t HHWheelTimerBase<Duration>::calcNextTick(
+    std::chrono::steady_clock::time_point now) {
+  auto intervals = (now - startTime_) / interval_;
   // Slow eventbases will have skew between the actual time and the
   // callback time.  To avoid racing the next scheduleNextTimeout()
   // call, always schedule new timeouts against the actual
@@ -315,4 +498,7 @@ int64_t HHWheelTimer::calcNextTick() {
   }
 }
 
+template class HHWheelTimerBase<std::chrono::milliseconds>;
+template class HHWheelTimerBase<std::chrono::microseconds>;
+
 } // namespace folly
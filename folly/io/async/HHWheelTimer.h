@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <folly/CancellationToken.h>
 #include <folly/Optional.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/DelayedDestruction.h>
+#include <folly/io/async/Request.h>
 
 #include <boost/intrusive/list.hpp>
 #include <glog/logging.h>
@@ -50,16 +52,31 @@ namespace folly {
  * Unlike the original timer wheel paper, this implementation does
  * *not* tick constantly, and instead calculates the exact next wakeup
  * time.
+ *
+ * Bucket 0 has twice 256 lists, for the current and the next 256 ticks,
+ * so that bucket 1 can be cascaded ahead of time: while the wheel goes
+ * through the current 256 ticks, it moves the timers of the next bucket 1
+ * list into bucket 0 a slice every 16 ticks, rather than all at once when
+ * bucket 0 wraps around.  With millions of timers (e.g. connection idle
+ * timeouts) in bucket 1, this spreads the cascading work instead of
+ * stalling the loop every 256 ticks.  Buckets 2 and 3 still cascade at
+ * once, they are only reached every 65536 ticks.  Timers are cascaded by
+ * the tick they are due, without reading the clock.
+ *
+ * HHWheelTimer counts time in milliseconds; HHWheelTimerHighRes counts it
+ * in microseconds, for tick intervals below a millisecond (it schedules
+ * its AsyncTimeout with scheduleTimeoutHighRes()).
  */
-class HHWheelTimer : private folly::AsyncTimeout,
-                     public folly::DelayedDestruction {
+template <class Duration>
+class HHWheelTimerBase : private folly::AsyncTimeout,
+                         public folly::DelayedDestruction {
  public:
-  using UniquePtr = std::unique_ptr<HHWheelTimer, Destructor>;
-  using SharedPtr = std::shared_ptr<HHWheelTimer>;
+  using UniquePtr = std::unique_ptr<HHWheelTimerBase, Destructor>;
+  using SharedPtr = std::shared_ptr<HHWheelTimerBase>;
 
   template <typename... Args>
   static UniquePtr newTimer(Args&&... args) {
-    return UniquePtr(new HHWheelTimer(std::forward<Args>(args)...));
+    return UniquePtr(new HHWheelTimerBase(std::forward<Args>(args)...));
   }
 
   /**
@@ -69,7 +86,7 @@ class HHWheelTimer : private folly::AsyncTimeout,
       : public boost::intrusive::list_base_hook<
             boost::intrusive::link_mode<boost::intrusive::auto_unlink>> {
    public:
-    Callback() = default;
+    Callback();
     virtual ~Callback();
 
     /**
@@ -109,7 +126,7 @@ class HHWheelTimer : private folly::AsyncTimeout,
      * timeout is not scheduled or expired. Otherwise, return expiration time
      * minus getCurTime().
      */
-    std::chrono::milliseconds getTimeRemaining() {
+    Duration getTimeRemaining() {
       return getTimeRemaining(getCurTime());
     }
 
@@ -124,21 +141,25 @@ class HHWheelTimer : private folly::AsyncTimeout,
 
    private:
     // Get the time remaining until this timeout expires
-    std::chrono::milliseconds getTimeRemaining(
-        std::chrono::steady_clock::time_point now) const {
+    Duration getTimeRemaining(std::chrono::steady_clock::time_point now) const {
       if (now >= expiration_) {
-        return std::chrono::milliseconds(0);
+        return Duration(0);
       }
-      return std::chrono::duration_cast<std::chrono::milliseconds>(
-          expiration_ - now);
+      return std::chrono::duration_cast<Duration>(expiration_ - now);
     }
 
-    void setScheduled(HHWheelTimer* wheel,
-                      std::chrono::milliseconds);
+    void setScheduled(HHWheelTimerBase* wheel, Duration);
     void cancelTimeoutImpl();
 
-    HHWheelTimer* wheel_{nullptr};
+    // Ties a scheduled callback to a CancellationToken; see
+    // HHWheelTimerBase::scheduleTimeout(callback, timeout, token).
+    class CancellationHandle;
+
+    HHWheelTimerBase* wheel_{nullptr};
     std::chrono::steady_clock::time_point expiration_{};
+    // The wheel tick this is due, and the bucket 0 or 1 list holding it
+    // (see HHWheelTimerBase::place()), -1 otherwise
+    int64_t expireTick_{0};
     int bucket_{-1};
 
     typedef boost::intrusive::list<
@@ -146,10 +167,11 @@ class HHWheelTimer : private folly::AsyncTimeout,
       boost::intrusive::constant_time_size<false> > List;
 
     std::shared_ptr<RequestContext> context_;
+    std::unique_ptr<CancellationHandle> cancellation_;
 
-    // Give HHWheelTimer direct access to our members so it can take care
+    // Give HHWheelTimerBase direct access to our members so it can take care
     // of scheduling/cancelling.
-    friend class HHWheelTimer;
+    friend class HHWheelTimerBase;
   };
 
   /**
@@ -162,13 +184,11 @@ class HHWheelTimer : private folly::AsyncTimeout,
    * interval timeouts using scheduleTimeout(callback) method.
    */
   static int DEFAULT_TICK_INTERVAL;
-  explicit HHWheelTimer(
+  explicit HHWheelTimerBase(
       folly::TimeoutManager* timeoutManager,
-      std::chrono::milliseconds intervalMS =
-          std::chrono::milliseconds(DEFAULT_TICK_INTERVAL),
+      Duration intervalMS = Duration(DEFAULT_TICK_INTERVAL),
       AsyncTimeout::InternalEnum internal = AsyncTimeout::InternalEnum::NORMAL,
-      std::chrono::milliseconds defaultTimeoutMS =
-          std::chrono::milliseconds(-1));
+      Duration defaultTimeoutMS = Duration(-1));
 
   /**
    * Cancel all outstanding timeouts
@@ -180,18 +200,20 @@ class HHWheelTimer : private folly::AsyncTimeout,
   /**
    * Get the tick interval for this HHWheelTimer.
    *
-   * Returns the tick interval in milliseconds.
+   * Returns the tick interval in milliseconds (microseconds for
+   * HHWheelTimerHighRes).
    */
-  std::chrono::milliseconds getTickInterval() const {
+  Duration getTickInterval() const {
     return interval_;
   }
 
   /**
    * Get the default timeout interval for this HHWheelTimer.
    *
-   * Returns the timeout interval in milliseconds.
+   * Returns the timeout interval in milliseconds (microseconds for
+   * HHWheelTimerHighRes).
    */
-  std::chrono::milliseconds getDefaultTimeout() const {
+  Duration getDefaultTimeout() const {
     return defaultTimeout_;
   }
 
@@ -202,10 +224,8 @@ class HHWheelTimer : private folly::AsyncTimeout,
    * If the callback is already scheduled, this cancels the existing timeout
    * before scheduling the new timeout.
    */
-  void scheduleTimeout(Callback* callback,
-                       std::chrono::milliseconds timeout);
-  void scheduleTimeoutImpl(Callback* callback,
-                       std::chrono::milliseconds timeout);
+  void scheduleTimeout(Callback* callback, Duration timeout);
+  void scheduleTimeoutImpl(Callback* callback, Duration timeout);
 
   /**
    * Schedule the specified Callback to be invoked after the
@@ -219,8 +239,35 @@ class HHWheelTimer : private folly::AsyncTimeout,
    */
   void scheduleTimeout(Callback* callback);
 
+  /**
+   * Schedule the specified Callback to be invoked after the specified timeout
+   * interval, unless cancellation is requested on the token first.
+   *
+   * On cancellation the timeout is cancelled and callbackCanceled() is
+   * invoked, as with cancelAll(). This happens inline if cancellation has
+   * already been requested, and otherwise on the timer's EventBase thread
+   * (requestCancellation() may be called from any thread). The token stops
+   * applying once the timeout fires, is cancelled, or is rescheduled.
+   *
+   * Requires the timer to be driven by an EventBase.
+   */
+  void scheduleTimeout(
+      Callback* callback,
+      Duration timeout,
+      CancellationToken token);
+
+  /**
+   * Schedules every Callback* in [first, last) with the same timeout, like
+   * calling scheduleTimeout() for each of them (e.g. to refresh the idle
+   * timeouts of the connections that a loop iteration served), but reads
+   * the clock and the RequestContext once, and updates the wheel's own
+   * timeout once.  Callbacks don't get to override getCurTime() here.
+   */
+  template <class Iterator>
+  void scheduleTimeouts(Iterator first, Iterator last, Duration timeout);
+
   template <class F>
-  void scheduleTimeoutFn(F fn, std::chrono::milliseconds timeout) {
+  void scheduleTimeoutFn(F fn, Duration timeout) {
     struct Wrapper : Callback {
       Wrapper(F f) : fn_(std::move(f)) {}
       void timeoutExpired() noexcept override {
@@ -262,40 +309,56 @@ class HHWheelTimer : private folly::AsyncTimeout,
    * Use destroy() instead.  See the comments in DelayedDestruction for more
    * details.
    */
-  ~HHWheelTimer() override;
+  ~HHWheelTimerBase() override;
 
  private:
   // Forbidden copy constructor and assignment operator
-  HHWheelTimer(HHWheelTimer const &) = delete;
-  HHWheelTimer& operator=(HHWheelTimer const &) = delete;
+  HHWheelTimerBase(HHWheelTimerBase const &) = delete;
+  HHWheelTimerBase& operator=(HHWheelTimerBase const &) = delete;
 
   // Methods inherited from AsyncTimeout
   void timeoutExpired() noexcept override;
 
-  std::chrono::milliseconds interval_;
-  std::chrono::milliseconds defaultTimeout_;
+  Duration interval_;
+  Duration defaultTimeout_;
 
   static constexpr int WHEEL_BUCKETS = 4;
   static constexpr int WHEEL_BITS = 8;
   static constexpr unsigned int WHEEL_SIZE = (1 << WHEEL_BITS);
   static constexpr unsigned int WHEEL_MASK = (WHEEL_SIZE - 1);
   static constexpr uint32_t LARGEST_SLOT = 0xffffffffUL;
-
-  typedef Callback::List CallbackList;
-  CallbackList buckets_[WHEEL_BUCKETS][WHEEL_SIZE];
+  // Bucket 0 covers the current and the next WHEEL_SIZE ticks
+  static constexpr unsigned int TICKS_SIZE = 2 * WHEEL_SIZE;
+  static constexpr unsigned int TICKS_MASK = (TICKS_SIZE - 1);
+  // Bucket 1 is cascaded ahead of time every CASCADE_STRIDE ticks
+  static constexpr unsigned int CASCADE_STRIDE = 16;
+
+  typedef typename Callback::List CallbackList;
+  // Bucket 0, indexed by tick
+  CallbackList ticks_[TICKS_SIZE];
   std::vector<uint64_t> bitmap_;
+  // Buckets 1 to 3
+  CallbackList buckets_[WHEEL_BUCKETS - 1][WHEEL_SIZE];
+  // Number of timers in each bucket 1 list
+  uint64_t bucket1Count_[WHEEL_SIZE];
 
-  int64_t timeToWheelTicks(std::chrono::milliseconds t) {
+  int64_t timeToWheelTicks(Duration t) {
     return t.count() / interval_.count();
   }
 
-  bool cascadeTimers(int bucket, int tick);
+  // Puts the callback in the list for its expireTick_, as of tick now
+  void place(Callback* callback, int64_t now);
+  void setTickBit(unsigned int slot, bool value);
+  // Moves (up to max) timers from a list of bucket 1 to 3 into lower ones
+  void cascadeTimers(int bucket, int tick, int64_t now,
+                     uint64_t max = ~uint64_t(0));
   int64_t lastTick_;
   int64_t expireTick_;
   uint64_t count_;
   std::chrono::steady_clock::time_point startTime_;
 
   int64_t calcNextTick();
+  int64_t calcNextTick(std::chrono::steady_clock::time_point now);
 
   void scheduleNextTimeout();
 
@@ -307,4 +370,41 @@ class HHWheelTimer : private folly::AsyncTimeout,
   }
 };
 
+template <class Duration>
+template <class Iterator>
+void HHWheelTimerBase<Duration>::scheduleTimeouts(
+    Iterator first,
+    Iterator last,
+    Duration timeout) {
+  auto context = RequestContext::saveContext();
+  auto now = getCurTime();
+  auto nextTick = calcNextTick(now);
+  int64_t due = timeToWheelTicks(timeout) + nextTick;
+  for (; first != last; ++first) {
+    Callback* callback = *first;
+    callback->cancelTimeout();
+    callback->context_ = context;
+    count_++;
+    callback->wheel_ = this;
+    callback->expiration_ = now + timeout;
+    callback->expireTick_ = due;
+    place(callback, nextTick);
+  }
+
+  if (!processingCallbacksGuard_) {
+    scheduleNextTimeout();
+  }
+}
+
+using HHWheelTimer = HHWheelTimerBase<std::chrono::milliseconds>;
+using HHWheelTimerHighRes = HHWheelTimerBase<std::chrono::microseconds>;
+
+template <>
+int HHWheelTimer::DEFAULT_TICK_INTERVAL;
+template <>
+int HHWheelTimerHighRes::DEFAULT_TICK_INTERVAL;
+
+extern template class HHWheelTimerBase<std::chrono::milliseconds>;
+extern template class HHWheelTimerBase<std::chrono::microseconds>;
+
 } // namespace folly
@@ -0,0 +1,437 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/IoUringBackend.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <glog/logging.h>
+
+#include <folly/Exception.h>
+#include <folly/String.h>
+#include <folly/detail/IoUring.h>
+#include <folly/io/async/EventUtil.h>
+#include <folly/portability/Unistd.h>
+
+#if FOLLY_HAVE_IO_URING
+#include <poll.h>
+#include <sys/timerfd.h>
+#endif
+
+namespace folly {
+
+#if FOLLY_HAVE_IO_URING
+
+namespace {
+
+// user_data of completions that aren't PollEntries
+constexpr uint64_t kIgnoreTag = 0; // poll removals
+constexpr uint64_t kTimerFdTag = 1;
+
+void runCallback(struct event* ev, short what) {
+  auto cb = event_get_callback(ev);
+  auto arg = event_get_callback_arg(ev);
+  cb(ev->ev_fd, what, arg);
+}
+
+} // namespace
+
+/**
+ * The kernel-shared rings, and the SQEs queued but not yet submitted.
+ */
+struct IoUringBackend::Ring : detail::IoUringRings {
+  explicit Ring(size_t capacity)
+      : IoUringRings(static_cast<unsigned>(capacity)),
+        sqTailLocal(*sqTail) {}
+
+  // Returns a zeroed SQE, flushing the ring to the kernel if it's full.
+  io_uring_sqe* getSqe() {
+    if (toSubmit == sqEntries) {
+      while (toSubmit > 0) {
+        int rc = detail::ioUringEnter(fd, toSubmit, 0, 0);
+        if (rc < 0) {
+          CHECK(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+              << "IoUringBackend: io_uring_enter failed: " << errnoStr(errno);
+          continue;
+        }
+        toSubmit -= static_cast<unsigned>(rc);
+      }
+    }
+    unsigned index = sqTailLocal & sqMask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++sqTailLocal;
+    ++toSubmit;
+    __atomic_store_n(sqTail, sqTailLocal, __ATOMIC_RELEASE);
+    return sqe;
+  }
+
+  bool cqEmpty() const {
+    return *cqHead == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+  }
+
+  unsigned toSubmit{0};
+  unsigned sqTailLocal{0};
+};
+
+IoUringBackend::IoUringBackend(const Options& options)
+    : ring_(std::make_unique<Ring>(options.capacity)) {
+  timerFd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  checkUnixError(timerFd_, "IoUringBackend: timerfd_create failed");
+  armTimerFdPoll();
+
+  // Only used as a marker for attached events, never looped.
+  evb_ = event_base_new();
+  if (evb_ == nullptr) {
+    ::close(timerFd_);
+    throw std::runtime_error("IoUringBackend: event_base_new failed");
+  }
+}
+
+IoUringBackend::~IoUringBackend() {
+  while (!events_.empty()) {
+    unregister(events_.begin()->first);
+  }
+  // The canceled PollEntries are freed when their completions are reaped.
+  loopBreak_ = false;
+  while (numCanceled_ > 0 && submit(true) >= 0) {
+    processCompletions();
+  }
+  ring_.reset();
+  ::close(timerFd_);
+  event_base_free(evb_);
+}
+
+bool IoUringBackend::isAvailable() {
+  return detail::ioUringSupported();
+}
+
+int IoUringBackend::loop(int flags) {
+  // as event_base_loop() does, only a break during this call counts
+  loopBreak_.store(false, std::memory_order_relaxed);
+  while (true) {
+    // The internal events (the EventBase's NotificationQueue) don't keep
+    // the loop alive.
+    if (numNonInternal_ == 0) {
+      return 1;
+    }
+
+    bool wait = !(flags & EVLOOP_NONBLOCK) && ring_->cqEmpty() &&
+        (timers_.empty() || timers_.begin()->first > Clock::now());
+    if (submit(wait) < 0) {
+      return -1;
+    }
+    processCompletions();
+    processTimers();
+
+    if ((flags & (EVLOOP_ONCE | EVLOOP_NONBLOCK)) ||
+        loopBreak_.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+  }
+}
+
+int IoUringBackend::loopBreak() {
+  // The loop will notice once the current callback returns; a loop blocked
+  // in the kernel is woken by the NotificationQueue message that
+  // terminateLoopSoon() sends.
+  loopBreak_.store(true, std::memory_order_relaxed);
+  return 0;
+}
+
+int IoUringBackend::submit(bool wait) {
+  auto& ring = *ring_;
+  if (ring.toSubmit == 0 && !wait) {
+    return 0;
+  }
+  int rc = detail::ioUringEnter(
+      ring.fd, ring.toSubmit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+  if (rc < 0) {
+    // EBUSY / EAGAIN: the completion ring is full, reap first
+    if (errno == EINTR || errno == EBUSY || errno == EAGAIN) {
+      return 0;
+    }
+    LOG(ERROR) << "IoUringBackend: io_uring_enter failed: " << errnoStr(errno);
+    return -1;
+  }
+  ring.toSubmit -= static_cast<unsigned>(rc);
+  return 0;
+}
+
+int IoUringBackend::addEvent(struct event* ev, const struct timeval* timeout) {
+  if (ev->ev_events & EV_SIGNAL) {
+    errno = ENOTSUP;
+    return -1;
+  }
+
+  auto rv = events_.emplace(ev, EventInfo());
+  auto& info = rv.first->second;
+  if (rv.second) {
+    info.internal = event_ref_flags(ev) & EVLIST_INTERNAL;
+    if (!info.internal) {
+      ++numNonInternal_;
+    }
+    if (ev->ev_fd >= 0 && (ev->ev_events & (EV_READ | EV_WRITE))) {
+      armPoll(ev, info);
+      event_ref_flags(ev) |= EVLIST_INSERTED;
+    }
+  }
+
+  if (timeout) {
+    // re-adding a pending event only updates its timeout
+    removeTimer(info);
+    info.timeout = std::chrono::seconds(timeout->tv_sec) +
+        std::chrono::microseconds(timeout->tv_usec);
+    addTimer(ev, info);
+    armTimerFd();
+  } else if (!info.poll && !info.hasTimer) {
+    // nothing to wait for
+    unregister(ev);
+  }
+  return 0;
+}
+
+int IoUringBackend::delEvent(struct event* ev) {
+  // like event_del(), deleting an event that isn't pending is fine
+  if (events_.find(ev) != events_.end()) {
+    unregister(ev);
+  }
+  return 0;
+}
+
+void IoUringBackend::unregister(struct event* ev) {
+  auto iter = events_.find(ev);
+  DCHECK(iter != events_.end());
+  auto& info = iter->second;
+  cancelPoll(info);
+  // The timerfd may stay armed for a removed timer, the spurious wakeup is
+  // cheaper than rearming it.
+  removeTimer(info);
+  if (!info.internal) {
+    --numNonInternal_;
+  }
+  event_ref_flags(ev) &= ~(EVLIST_INSERTED | EVLIST_TIMEOUT);
+  events_.erase(iter);
+}
+
+void IoUringBackend::armPoll(struct event* ev, EventInfo& info) {
+  DCHECK(!info.poll);
+  auto entry = new PollEntry{ev, false};
+  auto sqe = ring_->getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = ev->ev_fd;
+  sqe->poll_events = ((ev->ev_events & EV_READ) ? POLLIN : 0) |
+      ((ev->ev_events & EV_WRITE) ? POLLOUT : 0);
+  sqe->user_data = reinterpret_cast<uintptr_t>(entry);
+  info.poll = entry;
+}
+
+void IoUringBackend::cancelPoll(EventInfo& info) {
+  if (!info.poll) {
+    return;
+  }
+  info.poll->canceled = true;
+  ++numCanceled_;
+  auto sqe = ring_->getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->addr = reinterpret_cast<uintptr_t>(info.poll);
+  sqe->user_data = kIgnoreTag;
+  info.poll = nullptr;
+}
+
+void IoUringBackend::armTimerFdPoll() {
+  auto sqe = ring_->getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = timerFd_;
+  sqe->poll_events = POLLIN;
+  sqe->user_data = kTimerFdTag;
+}
+
+void IoUringBackend::addTimer(struct event* ev, EventInfo& info) {
+  DCHECK(!info.hasTimer);
+  info.timer = timers_.emplace(Clock::now() + info.timeout, ev);
+  info.hasTimer = true;
+  event_ref_flags(ev) |= EVLIST_TIMEOUT;
+}
+
+void IoUringBackend::removeTimer(EventInfo& info) {
+  if (info.hasTimer) {
+    timers_.erase(info.timer);
+    info.hasTimer = false;
+  }
+}
+
+void IoUringBackend::armTimerFd() {
+  auto deadline =
+      timers_.empty() ? Clock::time_point::max() : timers_.begin()->first;
+  // Only an earlier deadline needs the timerfd reprogrammed, a later one
+  // just costs a spurious wakeup.
+  if (deadline >= timerFdDeadline_) {
+    return;
+  }
+  timerFdDeadline_ = deadline;
+
+  // steady_clock is CLOCK_MONOTONIC
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline.time_since_epoch())
+                .count();
+  itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = time_t(ns / 1000000000);
+  spec.it_value.tv_nsec = long(ns % 1000000000);
+  if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+    spec.it_value.tv_nsec = 1; // zero disarms
+  }
+  int rc = ::timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+  PCHECK(rc == 0) << "IoUringBackend: timerfd_settime failed";
+}
+
+void IoUringBackend::processCompletions() {
+  auto& ring = *ring_;
+  unsigned head = *ring.cqHead;
+  while (!loopBreak_.load(std::memory_order_relaxed)) {
+    if (head == __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+    uint64_t userData = cqe.user_data;
+    int res = cqe.res;
+    // release the slot before running callbacks, they queue more SQEs
+    ++head;
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+
+    if (userData == kIgnoreTag) {
+      continue;
+    } else if (userData == kTimerFdTag) {
+      uint64_t expirations;
+      ssize_t n;
+      do {
+        n = ::read(timerFd_, &expirations, sizeof(expirations));
+      } while (n == -1 && errno == EINTR);
+      timerFdDeadline_ = Clock::time_point::max();
+      armTimerFdPoll();
+      // processTimers() does the work, and rearms the timerfd
+    } else {
+      processPoll(reinterpret_cast<PollEntry*>(userData), res);
+    }
+  }
+}
+
+void IoUringBackend::processPoll(PollEntry* entry, int res) {
+  if (entry->canceled) {
+    delete entry;
+    --numCanceled_;
+    return;
+  }
+  struct event* ev = entry->ev;
+  auto iter = events_.find(ev);
+  DCHECK(iter != events_.end());
+  auto& info = iter->second;
+  DCHECK_EQ(info.poll, entry);
+  info.poll = nullptr;
+  delete entry;
+
+  short what = 0;
+  if (res < 0 || (res & (POLLERR | POLLHUP))) {
+    // errors are reported to whoever is waiting, as by epoll
+    what = EV_READ | EV_WRITE;
+  } else {
+    what = ((res & POLLIN) ? EV_READ : 0) | ((res & POLLOUT) ? EV_WRITE : 0);
+  }
+  what &= ev->ev_events;
+
+  if (ev->ev_events & EV_PERSIST) {
+    armPoll(ev, info);
+    if (info.hasTimer) {
+      // as in libevent, activity resets the timeout of persistent events
+      removeTimer(info);
+      addTimer(ev, info);
+    }
+    if (what == 0) {
+      return;
+    }
+  } else {
+    unregister(ev);
+  }
+  // May delete ev.
+  runCallback(ev, what);
+}
+
+void IoUringBackend::processTimers() {
+  auto now = Clock::now();
+  while (!timers_.empty() && timers_.begin()->first <= now &&
+         !loopBreak_.load(std::memory_order_relaxed)) {
+    struct event* ev = timers_.begin()->second;
+    auto& info = events_.find(ev)->second;
+    removeTimer(info);
+    if (ev->ev_events & EV_PERSIST) {
+      // not earlier than the next pass over the timers, even for a
+      // zero timeout
+      info.timer = timers_.emplace(
+          now + std::max(info.timeout, std::chrono::microseconds(1)), ev);
+      info.hasTimer = true;
+    } else {
+      unregister(ev);
+    }
+    // May delete ev.
+    runCallback(ev, EV_TIMEOUT);
+  }
+  armTimerFd();
+}
+
+#else
+
+namespace {
+[[noreturn]] void throwUnsupported() {
+  throw std::runtime_error("IoUringBackend: io_uring is not supported");
+}
+} // namespace
+
+struct IoUringBackend::Ring {};
+
+IoUringBackend::IoUringBackend(const Options&) {
+  throwUnsupported();
+}
+
+IoUringBackend::~IoUringBackend() {}
+
+bool IoUringBackend::isAvailable() {
+  return false;
+}
+
+int IoUringBackend::loop(int) {
+  throwUnsupported();
+}
+
+int IoUringBackend::loopBreak() {
+  throwUnsupported();
+}
+
+int IoUringBackend::addEvent(struct event*, const struct timeval*) {
+  throwUnsupported();
+}
+
+int IoUringBackend::delEvent(struct event*) {
+  throwUnsupported();
+}
+
+#endif
+
+} // namespace folly
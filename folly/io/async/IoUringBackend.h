@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+
+#include <folly/container/F14Map.h>
+#include <folly/io/async/EventBaseBackend.h>
+
+namespace folly {
+
+/**
+ * An EventBaseBackend that drives EventHandler, AsyncTimeout and
+ * NotificationQueue events from an io_uring (Linux 5.1+) instead of
+ * libevent / epoll.
+ *
+ *   EventBase evb(std::make_unique<IoUringBackend>());
+ *
+ * Each registered fd is an IORING_OP_POLL_ADD in the ring (re-armed after
+ * every wakeup for EV_PERSIST handlers), and timeouts are kept in a sorted
+ * map behind a single timerfd.  Poll arms and removals queued while
+ * callbacks run are submitted together with the wait for the next batch of
+ * completions, in one io_uring_enter() call, so registering interest costs
+ * no extra syscalls (unlike epoll_ctl()), and completions that are already
+ * in the ring are reaped without a syscall at all.
+ *
+ * Only polls go through the ring: accepts, reads and writes are still
+ * issued by AsyncServerSocket and AsyncSocket themselves, once the poll
+ * completion says the fd is ready.  Submitting them as IORING_OP_ACCEPT /
+ * READ / WRITE instead would hand buffer ownership to the kernel until
+ * completion, which the EventHandler readiness interface (and every
+ * transport built on it) can't express.  What this saves is the epoll_ctl()
+ * per interest change and the separate epoll_wait().
+ *
+ * Existing AsyncSocket, AsyncServerSocket and HHWheelTimer code works
+ * unchanged, since the readiness callbacks are the same.  Signal events
+ * (AsyncSignalHandler) are not supported, registering one fails.
+ *
+ * Check isAvailable() before use: the constructor throws if the kernel
+ * doesn't support io_uring.
+ */
+class IoUringBackend : public EventBaseBackend {
+ public:
+  struct Options {
+    // Number of submission queue entries, rounded up to a power of two by
+    // the kernel.  Each poll arm or removal takes one, but the ring is
+    // flushed whenever it fills up, so this only bounds the batch size.
+    size_t capacity{256};
+  };
+
+  IoUringBackend() : IoUringBackend(Options()) {}
+  explicit IoUringBackend(const Options& options);
+  ~IoUringBackend() override;
+
+  /**
+   * Return true if the running kernel supports io_uring.
+   */
+  static bool isAvailable();
+
+  event_base* getEventBase() override {
+    return evb_;
+  }
+
+  int loop(int flags) override;
+  int loopBreak() override;
+  int addEvent(struct event* ev, const struct timeval* timeout) override;
+  int delEvent(struct event* ev) override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using TimerMap = std::multimap<Clock::time_point, struct event*>;
+
+  struct Ring;
+
+  // An IORING_OP_POLL_ADD in flight, its address is the user_data.  It's
+  // only freed when its completion is reaped.
+  struct PollEntry {
+    struct event* ev;
+    bool canceled;
+  };
+
+  struct EventInfo {
+    bool internal{false};
+    PollEntry* poll{nullptr};
+    bool hasTimer{false};
+    TimerMap::iterator timer;
+    std::chrono::microseconds timeout{0};
+  };
+
+  int submit(bool wait);
+  void armTimerFdPoll();
+  void armPoll(struct event* ev, EventInfo& info);
+  void cancelPoll(EventInfo& info);
+  void addTimer(struct event* ev, EventInfo& info);
+  void removeTimer(EventInfo& info);
+  void armTimerFd();
+  void unregister(struct event* ev);
+
+  void processCompletions();
+  void processPoll(PollEntry* entry, int res);
+  void processTimers();
+
+  std::unique_ptr<Ring> ring_;
+  event_base* evb_{nullptr};
+  std::atomic<bool> loopBreak_{false};
+
+  F14ValueMap<struct event*, EventInfo> events_;
+  size_t numNonInternal_{0};
+  size_t numCanceled_{0}; // canceled PollEntries awaiting their completion
+
+  TimerMap timers_;
+  int timerFd_{-1};
+  Clock::time_point timerFdDeadline_{Clock::time_point::max()};
+};
+
+} // namespace folly
@@ -19,107 +19,212 @@
 
 #include <glog/logging.h>
 
-#include <folly/MapUtil.h>
+#include <atomic>
+#include <stdexcept>
+
+#include <folly/Indestructible.h>
 #include <folly/SingletonThreadLocal.h>
 
 namespace folly {
 
+RequestToken::RequestToken(const std::string& str) {
+  auto& cache = getCache();
+  {
+    auto c = cache.rlock();
+    auto res = c->find(str);
+    if (res != c->end()) {
+      token_ = res->second;
+      return;
+    }
+  }
+  auto c = cache.wlock();
+  auto res = c->find(str);
+  if (res != c->end()) {
+    token_ = res->second;
+    return;
+  }
+  // Token 0 is reserved for default-constructed tokens.
+  token_ = static_cast<uint32_t>(c->size()) + 1;
+  (*c)[str] = token_;
+}
+
+std::string RequestToken::getDebugString() const {
+  auto& cache = getCache();
+  auto c = cache.rlock();
+  for (const auto& kv : *c) {
+    if (kv.second == token_) {
+      return kv.first;
+    }
+  }
+  throw std::logic_error("Could not find debug string in RequestToken");
+}
+
+Synchronized<std::unordered_map<std::string, uint32_t>>&
+RequestToken::getCache() {
+  static Indestructible<Synchronized<std::unordered_map<std::string, uint32_t>>>
+      cache;
+  return *cache;
+}
+
+std::shared_ptr<RequestContext> RequestContext::copyAsChild(
+    const RequestContext& parent) {
+  auto child = std::make_shared<RequestContext>();
+  *child->state_.wlock() = *parent.state_.rlock();
+  return child;
+}
+
+std::shared_ptr<RequestContext::State> RequestContext::unshare(
+    std::shared_ptr<State>& state) {
+  if (state.use_count() == 1) {
+    // Pairs with the release in the other owner's shared_ptr destructor, so
+    // that its last reads of the state happen before we modify it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return nullptr;
+  }
+  auto copy = std::make_shared<State>(*state);
+  std::swap(copy, state);
+  return copy;
+}
+
 bool RequestContext::doSetContextData(
-    const std::string& val,
+    const RequestToken& val,
     std::unique_ptr<RequestData>& data,
     bool strict) {
+  // Declared before the lock, so that the replaced state and data are
+  // released after giving up the wlock, in case one of the RequestData
+  // destructors tries to grab the lock again.
+  std::shared_ptr<State> prevState;
+  std::shared_ptr<RequestData> prevData;
+
   auto ulock = state_.ulock();
 
   bool conflict = false;
-  auto it = ulock->requestData_.find(val);
-  if (it != ulock->requestData_.end()) {
+  if ((*ulock)->requestData_.count(val)) {
     if (strict) {
       return false;
     } else {
       LOG_FIRST_N(WARNING, 1) << "Calling RequestContext::setContextData for "
-                              << val << " but it is already set";
+                              << val.getDebugString() << " but it is already "
+                              << "set";
       conflict = true;
     }
   }
 
   auto wlock = ulock.moveFromUpgradeToWrite();
+  prevState = unshare(*wlock);
+  auto& state = **wlock;
   if (conflict) {
+    auto it = state.requestData_.find(val);
     if (it->second) {
       if (it->second->hasCallback()) {
-        wlock->callbackData_.erase(it->second.get());
+        state.callbackData_.erase(it->second.get());
       }
-      it->second.reset(nullptr);
+      prevData = std::move(it->second);
     }
     return true;
   }
 
   if (data && data->hasCallback()) {
-    wlock->callbackData_.insert(data.get());
+    state.callbackData_.insert(data.get());
   }
-  wlock->requestData_[val] = std::move(data);
+  state.requestData_[val] = std::move(data);
 
   return true;
 }
 
 void RequestContext::setContextData(
-    const std::string& val,
+    const RequestToken& val,
     std::unique_ptr<RequestData> data) {
   doSetContextData(val, data, false /* strict */);
 }
 
 bool RequestContext::setContextDataIfAbsent(
-    const std::string& val,
+    const RequestToken& val,
     std::unique_ptr<RequestData> data) {
   return doSetContextData(val, data, true /* strict */);
 }
 
-bool RequestContext::hasContextData(const std::string& val) const {
-  return state_.rlock()->requestData_.count(val);
-}
-
-RequestData* RequestContext::getContextData(const std::string& val) {
-  const std::unique_ptr<RequestData> dflt{nullptr};
-  return get_ref_default(state_.rlock()->requestData_, val, dflt).get();
-}
-
-const RequestData* RequestContext::getContextData(
-    const std::string& val) const {
-  const std::unique_ptr<RequestData> dflt{nullptr};
-  return get_ref_default(state_.rlock()->requestData_, val, dflt).get();
+bool RequestContext::hasContextData(const RequestToken& val) const {
+  return (*state_.rlock())->requestData_.count(val);
 }
 
-void RequestContext::onSet() {
+RequestData* RequestContext::getContextData(const RequestToken& val) {
   auto rlock = state_.rlock();
-  for (const auto& data : rlock->callbackData_) {
-    data->onSet();
-  }
+  auto it = (*rlock)->requestData_.find(val);
+  return it == (*rlock)->requestData_.end() ? nullptr : it->second.get();
 }
 
-void RequestContext::onUnset() {
+const RequestData* RequestContext::getContextData(
+    const RequestToken& val) const {
   auto rlock = state_.rlock();
-  for (const auto& data : rlock->callbackData_) {
-    data->onUnset();
-  }
+  auto it = (*rlock)->requestData_.find(val);
+  return it == (*rlock)->requestData_.end() ? nullptr : it->second.get();
 }
 
-void RequestContext::clearContextData(const std::string& val) {
-  std::unique_ptr<RequestData> requestData;
+void RequestContext::clearContextData(const RequestToken& val) {
+  std::shared_ptr<State> prevState;
+  std::shared_ptr<RequestData> requestData;
   // Delete the RequestData after giving up the wlock just in case one of the
   // RequestData destructors will try to grab the lock again.
   {
     auto ulock = state_.ulock();
-    auto it = ulock->requestData_.find(val);
-    if (it == ulock->requestData_.end()) {
+    if (!(*ulock)->requestData_.count(val)) {
       return;
     }
 
     auto wlock = ulock.moveFromUpgradeToWrite();
+    prevState = unshare(*wlock);
+    auto& state = **wlock;
+    auto it = state.requestData_.find(val);
     if (it->second && it->second->hasCallback()) {
-      wlock->callbackData_.erase(it->second.get());
+      state.callbackData_.erase(it->second.get());
     }
 
     requestData = std::move(it->second);
-    wlock->requestData_.erase(it);
+    state.requestData_.erase(it);
+  }
+}
+
+void RequestContext::setContextData(
+    const std::string& val,
+    std::unique_ptr<RequestData> data) {
+  setContextData(RequestToken(val), std::move(data));
+}
+
+bool RequestContext::setContextDataIfAbsent(
+    const std::string& val,
+    std::unique_ptr<RequestData> data) {
+  return setContextDataIfAbsent(RequestToken(val), std::move(data));
+}
+
+bool RequestContext::hasContextData(const std::string& val) const {
+  return hasContextData(RequestToken(val));
+}
+
+RequestData* RequestContext::getContextData(const std::string& val) {
+  return getContextData(RequestToken(val));
+}
+
+const RequestData* RequestContext::getContextData(
+    const std::string& val) const {
+  return getContextData(RequestToken(val));
+}
+
+void RequestContext::clearContextData(const std::string& val) {
+  clearContextData(RequestToken(val));
+}
+
+void RequestContext::onSet() {
+  auto rlock = state_.rlock();
+  for (const auto& data : (*rlock)->callbackData_) {
+    data->onSet();
+  }
+}
+
+void RequestContext::onUnset() {
+  auto rlock = state_.rlock();
+  for (const auto& data : (*rlock)->callbackData_) {
+    data->onUnset();
   }
 }
 
@@ -16,14 +16,57 @@
 
 #pragma once
 
-#include <map>
+#include <cstdint>
 #include <memory>
 #include <set>
+#include <string>
+#include <unordered_map>
 
 #include <folly/Synchronized.h>
 
 namespace folly {
 
+// Pre-registered key for RequestData lookups. Constructing a token interns
+// its name in a process-wide registry (taking a lock), so construct it once,
+// e.g. as a static, and reuse it; lookups by token then hash and compare a
+// single integer instead of a string. Tokens constructed from equal names
+// compare equal.
+class RequestToken {
+ public:
+  RequestToken() = default;
+  explicit RequestToken(const std::string& str);
+
+  bool operator==(const RequestToken& other) const {
+    return token_ == other.token_;
+  }
+  bool operator!=(const RequestToken& other) const {
+    return token_ != other.token_;
+  }
+
+  // Slow, use only for debug log messages.
+  std::string getDebugString() const;
+
+  friend struct std::hash<folly::RequestToken>;
+
+ private:
+  static Synchronized<std::unordered_map<std::string, uint32_t>>& getCache();
+
+  uint32_t token_{0};
+};
+
+} // namespace folly
+
+namespace std {
+template <>
+struct hash<folly::RequestToken> {
+  size_t operator()(const folly::RequestToken& token) const {
+    return hash<uint32_t>()(token.token_);
+  }
+};
+} // namespace std
+
+namespace folly {
+
 // Some request context that follows an async request through a process
 // Everything in the context must be thread safe
 
@@ -59,9 +102,23 @@ class RequestContext {
     setContext(std::make_shared<RequestContext>());
   }
 
+  // Create a context that starts out sharing all of "parent"'s RequestData.
+  // The data map is copy-on-write: the copy is only made when either context
+  // is first modified, and modifications to one are never visible in the
+  // other. Use this to add per-subrequest data without paying for a deep copy
+  // on every fan-out.
+  static std::shared_ptr<RequestContext> copyAsChild(
+      const RequestContext& parent);
+
   // Get the current context.
   static RequestContext* get();
 
+  // Get the current context, or nullptr if none was set (get() then returns
+  // a default context, which lives as long as the process).
+  static RequestContext* try_get() {
+    return getStaticContext().get();
+  }
+
   // The following APIs are used to add, remove and access RequestData instance
   // in the RequestContext instance, normally used for per-RequestContext
   // tracking or callback on set and unset. These APIs are Thread-safe.
@@ -95,6 +152,19 @@ class RequestContext {
   RequestData* getContextData(const std::string& val);
   const RequestData* getContextData(const std::string& val) const;
 
+  // Same as above, keyed by a pre-registered RequestToken. Prefer these on
+  // hot paths: the string overloads intern "val" on every call.
+  void setContextData(
+      const RequestToken& val,
+      std::unique_ptr<RequestData> data);
+  bool setContextDataIfAbsent(
+      const RequestToken& val,
+      std::unique_ptr<RequestData> data);
+  void clearContextData(const RequestToken& val);
+  bool hasContextData(const RequestToken& val) const;
+  RequestData* getContextData(const RequestToken& val);
+  const RequestData* getContextData(const RequestToken& val) const;
+
   void onSet();
   void onUnset();
 
@@ -108,6 +178,12 @@ class RequestContext {
   //
   // A shared_ptr is used, because many request may fan out across
   // multiple threads, or do post-send processing, etc.
+  //
+  // Passing ctx by rvalue and keeping the returned pointer, as in
+  //   saved = RequestContext::setContext(std::move(saved));
+  // switches contexts without touching the reference counts at all. Holders
+  // that run a context exactly once (timer and future callbacks) should move
+  // it into RequestContextScopeGuard rather than copy it.
   static std::shared_ptr<RequestContext> setContext(
       std::shared_ptr<RequestContext> ctx);
 
@@ -119,15 +195,26 @@ class RequestContext {
   static std::shared_ptr<RequestContext>& getStaticContext();
 
   bool doSetContextData(
-      const std::string& val,
+      const RequestToken& val,
       std::unique_ptr<RequestData>& data,
       bool strict);
 
+  // RequestData is shared between contexts created with copyAsChild(), and
+  // destroyed with the last context referencing it.
   struct State {
-    std::map<std::string, std::unique_ptr<RequestData>> requestData_;
+    std::unordered_map<RequestToken, std::shared_ptr<RequestData>>
+        requestData_;
     std::set<RequestData*> callbackData_;
   };
-  folly::Synchronized<State> state_;
+
+  // Make *state exclusively owned by this context, copying it if it is shared
+  // with another one. Returns the state that was replaced, if any, so that the
+  // caller can release it outside the lock.
+  static std::shared_ptr<State> unshare(std::shared_ptr<State>& state);
+
+  // Never null. Shared between contexts until one of them writes to it.
+  folly::Synchronized<std::shared_ptr<State>> state_{
+      std::make_shared<State>()};
 };
 
 class RequestContextScopeGuard {
@@ -155,4 +242,30 @@ class RequestContextScopeGuard {
     RequestContext::setContext(std::move(prev_));
   }
 };
+
+// Set a child of the current context (see RequestContext::copyAsChild()) for
+// the lifetime of this guard. Data added or cleared within the scope is
+// invisible to the parent, while the parent's data remains accessible.
+class ShallowCopyRequestContextScopeGuard {
+ public:
+  ShallowCopyRequestContextScopeGuard()
+      : prev_(RequestContext::setContext(
+            RequestContext::copyAsChild(*RequestContext::get()))) {}
+
+  ShallowCopyRequestContextScopeGuard(
+      const ShallowCopyRequestContextScopeGuard&) = delete;
+  ShallowCopyRequestContextScopeGuard& operator=(
+      const ShallowCopyRequestContextScopeGuard&) = delete;
+  ShallowCopyRequestContextScopeGuard(ShallowCopyRequestContextScopeGuard&&) =
+      delete;
+  ShallowCopyRequestContextScopeGuard& operator=(
+      ShallowCopyRequestContextScopeGuard&&) = delete;
+
+  ~ShallowCopyRequestContextScopeGuard() {
+    RequestContext::setContext(std::move(prev_));
+  }
+
+ private:
+  std::shared_ptr<RequestContext> prev_;
+};
 } // namespace folly
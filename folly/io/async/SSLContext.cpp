@@ -21,6 +21,8 @@
 #include <folly/Random.h>
 #include <folly/SharedMutex.h>
 #include <folly/SpinLock.h>
+#include <folly/io/async/ssl/SSLSessionCache.h>
+#include <folly/io/async/ssl/TicketKeyRotator.h>
 #include <folly/ssl/Init.h>
 #include <folly/system/ThreadId.h>
 
@@ -576,6 +578,18 @@ void SSLContext::setSessionCacheContext(const std::string& context) {
           static_cast<unsigned int>(context.length()), SSL_MAX_SID_CTX_LENGTH));
 }
 
+void SSLContext::setSessionCache(
+    std::shared_ptr<ssl::SSLSessionCache> cache) {
+  cache->attach(ctx_);
+  sessionCache_ = std::move(cache);
+}
+
+void SSLContext::setTicketKeyRotator(
+    std::shared_ptr<ssl::TicketKeyRotator> rotator) {
+  rotator->attach(ctx_);
+  ticketKeyRotator_ = std::move(rotator);
+}
+
 /**
  * Match a name with a pattern. The pattern may include wildcard. A single
  * wildcard "*" can match up to one component in the domain name.
@@ -40,6 +40,11 @@
 
 namespace folly {
 
+namespace ssl {
+class SSLSessionCache;
+class TicketKeyRotator;
+} // namespace ssl
+
 /**
  * Override the default password collector.
  */
@@ -383,6 +388,17 @@ class SSLContext {
    */
   void setSessionCacheContext(const std::string& context);
 
+  /**
+   * Keeps the server sessions of this context in cache, which may be
+   * shared with other contexts and processes, instead of OpenSSL's cache.
+   */
+  void setSessionCache(std::shared_ptr<ssl::SSLSessionCache> cache);
+
+  /**
+   * Encrypts the session tickets of this context with rotator's keys.
+   */
+  void setTicketKeyRotator(std::shared_ptr<ssl::TicketKeyRotator> rotator);
+
   /**
    * Set the options on the SSL_CTX object.
    */
@@ -506,6 +522,9 @@ class SSLContext {
 
   ClientProtocolFilterCallback clientProtoFilter_{nullptr};
 
+  std::shared_ptr<ssl::SSLSessionCache> sessionCache_;
+  std::shared_ptr<ssl::TicketKeyRotator> ticketKeyRotator_;
+
   static bool initialized_;
 
 #ifdef OPENSSL_NPN_NEGOTIATED
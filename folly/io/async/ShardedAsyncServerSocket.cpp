@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ShardedAsyncServerSocket.h>
+
+#include <exception>
+#include <utility>
+
+namespace folly {
+
+ShardedAsyncServerSocket::ShardedAsyncServerSocket(
+    std::vector<Shard> shards,
+    Steering steering)
+    : shards_(std::move(shards)), steering_(steering) {
+  listeners_.resize(shards_.size());
+  try {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      auto& shard = shards_[i];
+      std::exception_ptr ex;
+      shard.eventBase->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+        try {
+          listeners_[i].reset(new AsyncServerSocket(shard.eventBase));
+          listeners_[i]->setReusePortEnabled(true);
+          if (steering_ == Steering::INCOMING_CPU && !shard.cpus.empty()) {
+            listeners_[i]->setIncomingCpu(int(shard.cpus.front()));
+          }
+        } catch (...) {
+          ex = std::current_exception();
+        }
+      });
+      if (ex) {
+        std::rethrow_exception(ex);
+      }
+    }
+  } catch (...) {
+    destroyListeners();
+    throw;
+  }
+}
+
+ShardedAsyncServerSocket::~ShardedAsyncServerSocket() {
+  destroyListeners();
+}
+
+void ShardedAsyncServerSocket::destroyListeners() {
+  for (size_t i = 0; i < listeners_.size(); ++i) {
+    if (listeners_[i]) {
+      shards_[i].eventBase->runImmediatelyOrRunInEventBaseThreadAndWait(
+          [&] { listeners_[i].reset(); });
+    }
+  }
+}
+
+template <typename F>
+void ShardedAsyncServerSocket::runInShard(size_t shard, F&& fn) const {
+  std::exception_ptr ex;
+  shards_[shard].eventBase->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+    try {
+      fn(*listeners_[shard]);
+    } catch (...) {
+      ex = std::current_exception();
+    }
+  });
+  if (ex) {
+    std::rethrow_exception(ex);
+  }
+}
+
+void ShardedAsyncServerSocket::bind(const SocketAddress& address) {
+  SocketAddress addr = address;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    runInShard(i, [&](AsyncServerSocket& listener) {
+      listener.bind(addr);
+      if (i == 0 && addr.isFamilyInet() && addr.getPort() == 0) {
+        SocketAddress bound;
+        listener.getAddress(&bound);
+        addr.setPort(bound.getPort());
+      }
+    });
+  }
+  steer();
+}
+
+void ShardedAsyncServerSocket::bind(uint16_t port) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    runInShard(i, [&](AsyncServerSocket& listener) {
+      listener.bind(port);
+      if (i == 0 && port == 0) {
+        port = listener.getAddresses().front().getPort();
+      }
+    });
+  }
+  steer();
+}
+
+void ShardedAsyncServerSocket::steer() {
+  if (steering_ != Steering::CBPF || shards_.empty()) {
+    return;
+  }
+
+  // Listeners joined their SO_REUSEPORT groups in shard order
+  std::vector<int> indexOfCpu;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    for (auto cpu : shards_[i].cpus) {
+      if (cpu >= indexOfCpu.size()) {
+        indexOfCpu.resize(cpu + 1, -1);
+      }
+      indexOfCpu[cpu] = int(i);
+    }
+  }
+  runInShard(0, [&](AsyncServerSocket& listener) {
+    listener.setReusePortCpuSteering(indexOfCpu);
+  });
+}
+
+void ShardedAsyncServerSocket::listen(int backlog) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    runInShard(
+        i, [&](AsyncServerSocket& listener) { listener.listen(backlog); });
+  }
+}
+
+std::vector<SocketAddress> ShardedAsyncServerSocket::getAddresses() const {
+  std::vector<SocketAddress> addresses;
+  runInShard(0, [&](AsyncServerSocket& listener) {
+    addresses = listener.getAddresses();
+  });
+  return addresses;
+}
+
+void ShardedAsyncServerSocket::addAcceptCallback(
+    size_t shard,
+    AsyncServerSocket::AcceptCallback* callback) {
+  // No EventBase: the callback runs where the listener accepts
+  runInShard(shard, [&](AsyncServerSocket& listener) {
+    listener.addAcceptCallback(callback, nullptr);
+  });
+}
+
+void ShardedAsyncServerSocket::startAccepting() {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    runInShard(i, [](AsyncServerSocket& listener) {
+      listener.startAccepting();
+    });
+  }
+}
+
+void ShardedAsyncServerSocket::pauseAccepting() {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    runInShard(i, [](AsyncServerSocket& listener) {
+      listener.pauseAccepting();
+    });
+  }
+}
+
+} // namespace folly
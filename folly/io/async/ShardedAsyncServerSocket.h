@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/EventBase.h>
+
+namespace folly {
+
+/**
+ * A server socket made of one SO_REUSEPORT listener per EventBase, each
+ * accepting its own connections.
+ *
+ * An AsyncServerSocket accepts in its primary EventBase thread, and hands
+ * connections to the other threads through notification queues, so every
+ * connection changes threads before its first read.  Here every shard has
+ * its own AsyncServerSocket bound to the same address, the kernel spreads
+ * connections over them, and each shard's accept callbacks are called in
+ * its EventBase thread right after accept().
+ *
+ * By default the kernel picks the listener of a connection with a hash.
+ * When the shards' EventBase threads are pinned (see AffinityThreadFactory),
+ * passing the cpus they run on lets connections go to the shard running on
+ * the cpu that received them, which is where their packets are processed:
+ *
+ *   - INCOMING_CPU sets SO_INCOMING_CPU on each listener to the first cpu
+ *     of its shard.  Kernels before 6.1 ignore it for SO_REUSEPORT sockets.
+ *   - CBPF attaches a program to the SO_REUSEPORT group mapping every cpu
+ *     of every shard to its listener.
+ *
+ * Connections received on other cpus are spread with the hash.
+ *
+ * The methods can be called from any thread but the shards' EventBase
+ * threads; they run in each shard's thread in turn, and wait for it.  The
+ * EventBases must outlive the ShardedAsyncServerSocket.
+ */
+class ShardedAsyncServerSocket {
+ public:
+  enum class Steering {
+    NONE,
+    INCOMING_CPU,
+    CBPF,
+  };
+
+  struct Shard {
+    EventBase* eventBase;
+    // The cpus that the EventBase thread runs on, for steering
+    std::vector<size_t> cpus;
+  };
+
+  explicit ShardedAsyncServerSocket(
+      std::vector<Shard> shards,
+      Steering steering = Steering::NONE);
+
+  /**
+   * Destroys the listeners; accept callbacks still installed get
+   * acceptStopped().
+   */
+  ~ShardedAsyncServerSocket();
+
+  ShardedAsyncServerSocket(const ShardedAsyncServerSocket&) = delete;
+  ShardedAsyncServerSocket& operator=(const ShardedAsyncServerSocket&) =
+      delete;
+
+  size_t numShards() const {
+    return shards_.size();
+  }
+
+  EventBase* getEventBase(size_t shard) const {
+    return shards_[shard].eventBase;
+  }
+
+  /**
+   * The listener of a shard, for other options.  It must only be used in
+   * the shard's EventBase thread.
+   */
+  AsyncServerSocket* getListener(size_t shard) const {
+    return listeners_[shard].get();
+  }
+
+  /**
+   * Binds every listener, in shard order.  With port 0, the first listener
+   * picks a port and the others bind to it.
+   */
+  void bind(const SocketAddress& address);
+  void bind(uint16_t port);
+
+  void listen(int backlog);
+
+  std::vector<SocketAddress> getAddresses() const;
+
+  /**
+   * Adds a callback to a shard, called in its EventBase thread.
+   */
+  void addAcceptCallback(
+      size_t shard,
+      AsyncServerSocket::AcceptCallback* callback);
+
+  void startAccepting();
+  void pauseAccepting();
+
+ private:
+  // Runs fn(listener) in the shard's thread, and rethrows what it throws
+  template <typename F>
+  void runInShard(size_t shard, F&& fn) const;
+
+  void steer();
+  void destroyListeners();
+
+  const std::vector<Shard> shards_;
+  const Steering steering_;
+  std::vector<AsyncServerSocket::UniquePtr> listeners_;
+};
+
+} // namespace folly
@@ -70,6 +70,16 @@ struct TimeoutManager::CobTimeouts {
 TimeoutManager::TimeoutManager()
     : cobTimeouts_(std::make_unique<CobTimeouts>()) {}
 
+bool TimeoutManager::scheduleTimeoutHighRes(
+    AsyncTimeout* obj,
+    timeout_type_high_res timeout) {
+  auto ms = std::chrono::duration_cast<timeout_type>(timeout);
+  if (ms < timeout) {
+    ++ms;
+  }
+  return scheduleTimeout(obj, ms);
+}
+
 void TimeoutManager::runAfterDelay(
     Func cob,
     uint32_t milliseconds,
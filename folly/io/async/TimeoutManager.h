@@ -24,6 +24,7 @@
 namespace folly {
 
 class AsyncTimeout;
+class EventBaseLoopProfiler;
 
 /**
  * Base interface to be implemented by all classes expecting to manage
@@ -33,6 +34,7 @@ class AsyncTimeout;
 class TimeoutManager {
  public:
   typedef std::chrono::milliseconds timeout_type;
+  typedef std::chrono::microseconds timeout_type_high_res;
   using Func = folly::Function<void()>;
 
   enum class InternalEnum {
@@ -57,6 +59,14 @@ class TimeoutManager {
   virtual bool scheduleTimeout(AsyncTimeout* obj,
                                timeout_type timeout) = 0;
 
+  /**
+   * Like scheduleTimeout(), with microsecond resolution.  The default
+   * implementation rounds the timeout up to milliseconds.
+   */
+  virtual bool scheduleTimeoutHighRes(
+      AsyncTimeout* obj,
+      timeout_type_high_res timeout);
+
   /**
    * Cancels the AsyncTimeout, if scheduled
    */
@@ -68,6 +78,14 @@ class TimeoutManager {
    */
   virtual void bumpHandlingTime() = 0;
 
+  /**
+   * The profiler of the loop running the timeouts, if any (see
+   * EventBase::setLoopProfiler()).
+   */
+  virtual EventBaseLoopProfiler* getLoopProfiler() const {
+    return nullptr;
+  }
+
   /**
    * Helper method to know whether we are running in the timeout manager
    * thread
@@ -15,6 +15,8 @@
  */
 #include <folly/io/async/VirtualEventBase.h>
 
+#include <chrono>
+
 namespace folly {
 
 VirtualEventBase::VirtualEventBase(EventBase& evb) : evb_(evb) {
@@ -22,7 +24,11 @@ VirtualEventBase::VirtualEventBase(EventBase& evb) : evb_(evb) {
 }
 
 std::future<void> VirtualEventBase::destroy() {
-  CHECK(evb_.runInEventBaseThread([this] { loopKeepAlive_.reset(); }));
+  if (evb_.inRunningEventBaseThread()) {
+    loopKeepAlive_.reset();
+  } else {
+    CHECK(evb_.runInEventBaseThread([this] { loopKeepAlive_.reset(); }));
+  }
 
   return std::move(destroyFuture_);
 }
@@ -51,8 +57,15 @@ VirtualEventBase::~VirtualEventBase() {
   if (!destroyFuture_.valid()) {
     return;
   }
-  CHECK(!evb_.inRunningEventBaseThread());
-  destroy().get();
+  auto future = destroy();
+  // In the EventBase thread, waiting for the tokens held by others would
+  // deadlock
+  CHECK(
+      !evb_.inRunningEventBaseThread() ||
+      future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+      << "VirtualEventBase destroyed in the thread of its EventBase with "
+      << "KeepAlive tokens outstanding";
+  future.get();
 }
 
 void VirtualEventBase::runOnDestruction(EventBase::LoopCallback* callback) {
@@ -43,6 +43,15 @@ class VirtualEventBase : public folly::Executor, public folly::TimeoutManager {
   VirtualEventBase(const VirtualEventBase&) = delete;
   VirtualEventBase& operator=(const VirtualEventBase&) = delete;
 
+  /**
+   * Blocks until all the KeepAlive tokens are released, and the callbacks
+   * of runOnDestruction() have run.
+   *
+   * May be called from the thread of the EventBase while its loop is
+   * running, if no other KeepAlive tokens are held (e.g. once all the tasks
+   * scheduled through runInEventBaseThread() have run): the teardown then
+   * completes inline, without going through the EventBase's queue.
+   */
   ~VirtualEventBase() override;
 
   EventBase& getEventBase() {
@@ -97,6 +106,12 @@ class VirtualEventBase : public folly::Executor, public folly::TimeoutManager {
     return evb_.scheduleTimeout(obj, timeout);
   }
 
+  bool scheduleTimeoutHighRes(
+      AsyncTimeout* obj,
+      TimeoutManager::timeout_type_high_res timeout) override {
+    return evb_.scheduleTimeoutHighRes(obj, timeout);
+  }
+
   void cancelTimeout(AsyncTimeout* obj) override {
     evb_.cancelTimeout(obj);
   }
@@ -105,6 +120,10 @@ class VirtualEventBase : public folly::Executor, public folly::TimeoutManager {
     evb_.bumpHandlingTime();
   }
 
+  EventBaseLoopProfiler* getLoopProfiler() const override {
+    return evb_.getLoopProfiler();
+  }
+
   bool isInTimeoutManagerThread() override {
     return evb_.isInTimeoutManagerThread();
   }
@@ -143,12 +162,15 @@ class VirtualEventBase : public folly::Executor, public folly::TimeoutManager {
     if (!evb_.inRunningEventBaseThread()) {
       return evb_.add([=] { keepAliveRelease(); });
     }
-    if (loopKeepAliveCountAtomic_.load()) {
+    // Tokens acquired from other threads only need to be counted in when
+    // this one may be the last, so that acquiring and releasing tokens in
+    // the EventBase thread doesn't touch the atomic count.
+    if (--loopKeepAliveCount_ <= 0) {
       loopKeepAliveCount_ += loopKeepAliveCountAtomic_.exchange(0);
-    }
-    DCHECK(loopKeepAliveCount_ > 0);
-    if (--loopKeepAliveCount_ == 0) {
-      destroyImpl();
+      DCHECK(loopKeepAliveCount_ >= 0);
+      if (loopKeepAliveCount_ == 0) {
+        destroyImpl();
+      }
     }
   }
 
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/ssl/PrivateKeyOffload.h>
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/ssl/OpenSSLPtrTypes.h>
+
+#if FOLLY_OPENSSL_IS_110 && !defined(OPENSSL_IS_BORINGSSL) && \
+    !defined(OPENSSL_NO_ASYNC) && !defined(_WIN32)
+#define FOLLY_SSL_HAVE_KEY_OFFLOAD 1
+#include <fcntl.h>
+#include <openssl/async.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#define FOLLY_SSL_HAVE_KEY_OFFLOAD 0
+#endif
+
+namespace folly {
+namespace ssl {
+
+#if FOLLY_SSL_HAVE_KEY_OFFLOAD
+namespace {
+
+/**
+ * One private key operation, shared by the paused handshake job and the
+ * executor running it.  The worker signals completion on a pipe, which the
+ * job publishes through its ASYNC_WAIT_CTX for the socket to watch.  The
+ * worker only touches this object, so a connection going away while the
+ * operation runs is harmless.
+ */
+class Operation {
+ public:
+  Operation() {
+    if (pipe(fds_) != 0) {
+      fds_[0] = fds_[1] = -1;
+      return;
+    }
+    for (int fd : fds_) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+
+  ~Operation() {
+    for (int fd : fds_) {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+  }
+
+  bool valid() const {
+    return fds_[0] != -1;
+  }
+
+  int waitFd() const {
+    return fds_[0];
+  }
+
+  void finish(int result) {
+    result_ = result;
+    done_.store(true, std::memory_order_release);
+    char c = 0;
+    while (write(fds_[1], &c, 1) == -1 && errno == EINTR) {
+    }
+  }
+
+  bool done() const {
+    return done_.load(std::memory_order_acquire);
+  }
+
+  void waitBlocking() const {
+    pollfd pfd{fds_[0], POLLIN, 0};
+    while (!done()) {
+      poll(&pfd, 1, -1);
+    }
+  }
+
+  int result() const {
+    return result_;
+  }
+
+  std::vector<unsigned char> out;
+
+ private:
+  int fds_[2];
+  int result_{-1};
+  std::atomic<bool> done_{false};
+};
+
+// Key of our fd in the job's ASYNC_WAIT_CTX
+const char kWaitCtxKey = 0;
+
+void releaseOperation(ASYNC_WAIT_CTX*, const void*, OSSL_ASYNC_FD, void* op) {
+  delete static_cast<std::shared_ptr<Operation>*>(op);
+}
+
+/**
+ * Runs compute(out) on the executor and pauses the current async job until
+ * it finishes, then copies the bytes it produced to `to`.  Outside of an
+ * async job the operation runs inline.
+ */
+template <class Compute>
+int runOffloaded(
+    Executor* executor,
+    size_t outSize,
+    unsigned char* to,
+    unsigned int* outLen,
+    Compute compute) {
+  auto copyOut = [&](const std::vector<unsigned char>& out) {
+    memcpy(to, out.data(), out.size());
+    if (outLen) {
+      *outLen = static_cast<unsigned int>(out.size());
+    }
+  };
+  ASYNC_JOB* job = ASYNC_get_current_job();
+  ASYNC_WAIT_CTX* waitCtx = job ? ASYNC_get_wait_ctx(job) : nullptr;
+  auto op = std::make_shared<Operation>();
+  op->out.resize(outSize);
+  auto ref = new std::shared_ptr<Operation>(op);
+  if (!waitCtx || !op->valid() ||
+      !ASYNC_WAIT_CTX_set_wait_fd(
+          waitCtx, &kWaitCtxKey, op->waitFd(), ref, releaseOperation)) {
+    delete ref;
+    int ret = compute(op->out);
+    copyOut(op->out);
+    return ret;
+  }
+  executor->add([op, compute]() mutable { op->finish(compute(op->out)); });
+
+  // The socket resumes us once the pipe is readable; a resume before that
+  // is spurious.
+  while (!op->done()) {
+    if (!ASYNC_pause_job()) {
+      op->waitBlocking();
+    }
+  }
+  // Clearing the fd doesn't run the cleanup, which leaves ref to us
+  ASYNC_WAIT_CTX_clear_fd(waitCtx, &kWaitCtxKey);
+  delete ref;
+
+  copyOut(op->out);
+  return op->result();
+}
+
+int executorExDataIndex(bool ec) {
+  static int rsaIndex =
+      RSA_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  static int ecIndex =
+      EC_KEY_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return ec ? ecIndex : rsaIndex;
+}
+
+using RsaOp =
+    int (*)(int, const unsigned char*, unsigned char*, RSA*, int padding);
+
+template <RsaOp (*getOp)(const RSA_METHOD*)>
+int offloadRsa(
+    int flen,
+    const unsigned char* from,
+    unsigned char* to,
+    RSA* rsa,
+    int padding) {
+  auto executor =
+      static_cast<Executor*>(RSA_get_ex_data(rsa, executorExDataIndex(false)));
+  RsaOp op = getOp(RSA_PKCS1_OpenSSL());
+  RSA_up_ref(rsa);
+  std::shared_ptr<RSA> key(rsa, RsaDeleter());
+  std::vector<unsigned char> in(from, from + flen);
+  return runOffloaded(
+      executor,
+      size_t(RSA_size(rsa)),
+      to,
+      nullptr,
+      [op, key, in, padding](std::vector<unsigned char>& out) {
+        int ret = op(int(in.size()), in.data(), out.data(), key.get(), padding);
+        out.resize(ret > 0 ? size_t(ret) : 0);
+        return ret;
+      });
+}
+
+RsaOp getRsaPrivEnc(const RSA_METHOD* method) {
+  return RSA_meth_get_priv_enc(method);
+}
+
+RsaOp getRsaPrivDec(const RSA_METHOD* method) {
+  return RSA_meth_get_priv_dec(method);
+}
+
+using EcSign = int (*)(
+    int,
+    const unsigned char*,
+    int,
+    unsigned char*,
+    unsigned int*,
+    const BIGNUM*,
+    const BIGNUM*,
+    EC_KEY*);
+
+EcSign getEcSign() {
+  EcSign sign = nullptr;
+  EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), &sign, nullptr, nullptr);
+  return sign;
+}
+
+int offloadEcSign(
+    int type,
+    const unsigned char* dgst,
+    int dlen,
+    unsigned char* sig,
+    unsigned int* siglen,
+    const BIGNUM* kinv,
+    const BIGNUM* r,
+    EC_KEY* eckey) {
+  EcSign sign = getEcSign();
+  if (kinv || r) {
+    // Precomputed nonces would have to be copied; TLS never uses them
+    return sign(type, dgst, dlen, sig, siglen, kinv, r, eckey);
+  }
+  auto executor = static_cast<Executor*>(
+      EC_KEY_get_ex_data(eckey, executorExDataIndex(true)));
+  EC_KEY_up_ref(eckey);
+  std::shared_ptr<EC_KEY> key(eckey, EcKeyDeleter());
+  std::vector<unsigned char> in(dgst, dgst + dlen);
+  return runOffloaded(
+      executor,
+      size_t(ECDSA_size(eckey)),
+      sig,
+      siglen,
+      [sign, key, in, type](std::vector<unsigned char>& out) {
+        unsigned int len = 0;
+        int ret = sign(
+            type,
+            in.data(),
+            int(in.size()),
+            out.data(),
+            &len,
+            nullptr,
+            nullptr,
+            key.get());
+        out.resize(ret == 1 ? len : 0);
+        return ret;
+      });
+}
+
+// Leaked, like the BIO_METHOD in AsyncSSLSocket: keys using them may be
+// freed at any time up to exit.
+const RSA_METHOD* offloadRsaMethod() {
+  static RSA_METHOD* method = [] {
+    RSA_METHOD* m = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+    RSA_meth_set1_name(m, "folly private key offload");
+    RSA_meth_set_priv_enc(m, offloadRsa<getRsaPrivEnc>);
+    RSA_meth_set_priv_dec(m, offloadRsa<getRsaPrivDec>);
+    return m;
+  }();
+  return method;
+}
+
+const EC_KEY_METHOD* offloadEcMethod() {
+  static EC_KEY_METHOD* method = [] {
+    EC_KEY_METHOD* m = EC_KEY_METHOD_new(EC_KEY_OpenSSL());
+    int (*signSetup)(EC_KEY*, BN_CTX*, BIGNUM**, BIGNUM**) = nullptr;
+    ECDSA_SIG* (*signSig)(
+        const unsigned char*, int, const BIGNUM*, const BIGNUM*, EC_KEY*) =
+        nullptr;
+    EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), nullptr, &signSetup, &signSig);
+    EC_KEY_METHOD_set_sign(m, offloadEcSign, signSetup, signSig);
+    return m;
+  }();
+  return method;
+}
+
+// OpenSSL 3 decrypts RSA key exchanges with a padding mode only its own
+// provider implements, which a key with a method of its own can't serve.
+// Leave those suites out rather than failing such handshakes.
+bool removeRsaKeyExchange(SSL_CTX* ctx) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  std::string ciphers;
+  auto stack = SSL_CTX_get_ciphers(ctx);
+  for (int i = 0; i < sk_SSL_CIPHER_num(stack); ++i) {
+    const SSL_CIPHER* cipher = sk_SSL_CIPHER_value(stack, i);
+    int kx = SSL_CIPHER_get_kx_nid(cipher);
+    // TLS 1.3 suites (NID_kx_any) are configured separately
+    if (kx == NID_kx_rsa || kx == NID_kx_rsa_psk || kx == NID_kx_any) {
+      continue;
+    }
+    if (!ciphers.empty()) {
+      ciphers += ':';
+    }
+    ciphers += SSL_CIPHER_get_name(cipher);
+  }
+  if (SSL_CTX_set_cipher_list(ctx, ciphers.c_str()) != 1) {
+    ERR_clear_error();
+    return false;
+  }
+#else
+  (void)ctx;
+#endif
+  return true;
+}
+
+} // namespace
+
+bool offloadPrivateKeyOperations(SSL_CTX* ctx, Executor* executor) {
+  CHECK(executor);
+  EVP_PKEY* pkey = SSL_CTX_get0_privatekey(ctx);
+  if (!pkey) {
+    return false;
+  }
+
+  EvpPkeyUniquePtr offloaded(EVP_PKEY_new());
+  switch (EVP_PKEY_base_id(pkey)) {
+    case EVP_PKEY_RSA: {
+      // With a method of its own the key is "foreign", and OpenSSL 3 goes
+      // through the method instead of its default provider
+      RsaUniquePtr rsa(EVP_PKEY_get1_RSA(pkey));
+      if (!rsa || !RSA_set_method(rsa.get(), offloadRsaMethod()) ||
+          !RSA_set_ex_data(rsa.get(), executorExDataIndex(false), executor) ||
+          !EVP_PKEY_assign_RSA(offloaded.get(), rsa.get())) {
+        return false;
+      }
+      rsa.release();
+      if (!removeRsaKeyExchange(ctx)) {
+        return false;
+      }
+      break;
+    }
+    case EVP_PKEY_EC: {
+      EcKeyUniquePtr ec(EVP_PKEY_get1_EC_KEY(pkey));
+      if (!ec || !EC_KEY_set_method(ec.get(), offloadEcMethod()) ||
+          !EC_KEY_set_ex_data(ec.get(), executorExDataIndex(true), executor) ||
+          !EVP_PKEY_assign_EC_KEY(offloaded.get(), ec.get())) {
+        return false;
+      }
+      ec.release();
+      break;
+    }
+    default:
+      return false;
+  }
+
+  if (SSL_CTX_use_PrivateKey(ctx, offloaded.get()) != 1) {
+    ERR_clear_error();
+    return false;
+  }
+  SSL_CTX_set_mode(ctx, SSL_MODE_ASYNC);
+  return true;
+}
+#else
+bool offloadPrivateKeyOperations(SSL_CTX*, Executor*) {
+  return false;
+}
+#endif // FOLLY_SSL_HAVE_KEY_OFFLOAD
+
+} // namespace ssl
+} // namespace folly
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <folly/portability/OpenSSL.h>
+
+namespace folly {
+
+class Executor;
+
+namespace ssl {
+
+/**
+ * Runs the private key operations of TLS handshakes on an executor instead
+ * of the thread driving the handshake.  These are RSA decryption and
+ * signing and ECDSA signing, the bulk of a full handshake's CPU time.
+ *
+ * This replaces the private key installed in ctx (load it first) with one
+ * whose operations are queued to the executor, and turns on SSL_MODE_ASYNC.
+ * An AsyncSSLSocket accepting on ctx pauses its handshake while the
+ * operation runs and resumes it on its EventBase when the result is ready,
+ * so the loop keeps serving established connections in the meantime.
+ * Handshakes driven without SSL_MODE_ASYNC run the operations inline.
+ *
+ * The executor must outlive ctx and every connection made from it.
+ *
+ * With OpenSSL 3.0 and later, this also removes the suites using RSA key
+ * exchange from ctx's cipher list (call it after setting the ciphers):
+ * libssl decrypts those with a padding mode only its default provider
+ * implements, so they cannot use the offloaded key.
+ *
+ * Returns false, leaving ctx unchanged, if there is no private key, it is
+ * neither RSA nor EC, or OpenSSL has no async job support (before 1.1.0,
+ * BoringSSL, or built with no-async).
+ */
+bool offloadPrivateKeyOperations(SSL_CTX* ctx, Executor* executor);
+
+} // namespace ssl
+} // namespace folly
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ssl/SSLSessionCache.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include <glog/logging.h>
+
+#include <folly/Exception.h>
+#include <folly/ScopeGuard.h>
+#include <folly/hash/SpookyHashV2.h>
+
+namespace folly {
+namespace ssl {
+
+namespace {
+
+int64_t nowSeconds() {
+  return int64_t(time(nullptr));
+}
+
+int64_t sessionExpires(const SSL_SESSION* session) {
+  return int64_t(SSL_SESSION_get_time(session)) +
+      int64_t(SSL_SESSION_get_timeout(session));
+}
+
+ByteRange sessionId(const SSL_SESSION* session) {
+  unsigned int len = 0;
+  auto id = SSL_SESSION_get_id(session, &len);
+  return ByteRange(id, len);
+}
+
+uint64_t hashId(ByteRange id) {
+  return hash::SpookyHashV2::Hash64(id.data(), id.size(), 0);
+}
+
+int ctxIndex() {
+  static int index =
+      SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+} // namespace
+
+class SSLSessionCache::SharedTier {
+ public:
+  static constexpr size_t kSlotSize = 2048;
+  static constexpr size_t kWays = 4;
+
+  struct Slot {
+    // Odd while written
+    std::atomic<uint32_t> seq;
+    uint16_t idLen;
+    uint16_t dataLen;
+    int64_t expires;
+    unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+    unsigned char data[kSlotSize - 48];
+  };
+  static_assert(sizeof(Slot) == kSlotSize, "");
+  static constexpr size_t kMaxData = sizeof(Slot::data);
+
+  SharedTier(const std::string& path, size_t numSlots) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    checkUnixError(fd, "open ", path);
+    SCOPE_EXIT {
+      ::close(fd);
+    };
+    struct stat st;
+    checkUnixError(::fstat(fd, &st), "fstat ", path);
+    if (st.st_size == 0) {
+      numSlots = std::max(numSlots, kWays);
+      checkUnixError(
+          ::ftruncate(fd, off_t(numSlots * kSlotSize)), "ftruncate ", path);
+    } else {
+      numSlots = size_t(st.st_size) / kSlotSize;
+    }
+    numSets_ = numSlots / kWays;
+    if (numSets_ == 0) {
+      throwSystemErrorExplicit(EINVAL, "session cache too small: ", path);
+    }
+    size_ = numSets_ * kWays * kSlotSize;
+    auto p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      throwSystemError("mmap ", path);
+    }
+    slots_ = static_cast<Slot*>(p);
+  }
+
+  ~SharedTier() {
+    ::munmap(slots_, size_);
+  }
+
+  void add(ByteRange id, ByteRange data, int64_t expires) {
+    if (data.size() > kMaxData || id.size() > sizeof(Slot::id)) {
+      return;
+    }
+    auto set = getSet(id);
+    // The slot of this id, or the one expiring first
+    Slot* victim = &set[0];
+    for (size_t i = 0; i < kWays; ++i) {
+      if (matches(set[i], id)) {
+        victim = &set[i];
+        break;
+      }
+      if (set[i].expires < victim->expires) {
+        victim = &set[i];
+      }
+    }
+    uint32_t seq;
+    if (!lock(*victim, seq)) {
+      return;
+    }
+    victim->idLen = uint16_t(id.size());
+    memcpy(victim->id, id.data(), id.size());
+    victim->dataLen = uint16_t(data.size());
+    memcpy(victim->data, data.data(), data.size());
+    victim->expires = expires;
+    unlock(*victim, seq);
+  }
+
+  // Copies the session to buf (kMaxData bytes), returns its size or 0
+  size_t get(ByteRange id, int64_t now, unsigned char* buf) {
+    auto set = getSet(id);
+    for (size_t i = 0; i < kWays; ++i) {
+      auto& slot = set[i];
+      auto seq = slot.seq.load(std::memory_order_acquire);
+      if ((seq & 1) || !matches(slot, id)) {
+        continue;
+      }
+      size_t len = std::min<size_t>(slot.dataLen, kMaxData);
+      auto expires = slot.expires;
+      memcpy(buf, slot.data, len);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) != seq) {
+        // Overwritten while we read it
+        continue;
+      }
+      return expires > now ? len : 0;
+    }
+    return 0;
+  }
+
+  void remove(ByteRange id) {
+    auto set = getSet(id);
+    for (size_t i = 0; i < kWays; ++i) {
+      uint32_t seq;
+      if (!matches(set[i], id) || !lock(set[i], seq)) {
+        continue;
+      }
+      if (matches(set[i], id)) {
+        set[i].idLen = 0;
+        set[i].expires = 0;
+      }
+      unlock(set[i], seq);
+    }
+  }
+
+ private:
+  Slot* getSet(ByteRange id) {
+    return slots_ + (hashId(id) % numSets_) * kWays;
+  }
+
+  static bool matches(const Slot& slot, ByteRange id) {
+    return slot.idLen == id.size() && id.size() <= sizeof(slot.id) &&
+        memcmp(slot.id, id.data(), id.size()) == 0;
+  }
+
+  static bool lock(Slot& slot, uint32_t& seq) {
+    seq = slot.seq.load(std::memory_order_relaxed);
+    return !(seq & 1) &&
+        slot.seq.compare_exchange_strong(
+            seq, seq + 1, std::memory_order_acquire);
+  }
+
+  static void unlock(Slot& slot, uint32_t seq) {
+    slot.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  Slot* slots_;
+  size_t numSets_;
+  size_t size_;
+};
+
+constexpr size_t SSLSessionCache::SharedTier::kSlotSize;
+constexpr size_t SSLSessionCache::SharedTier::kWays;
+constexpr size_t SSLSessionCache::SharedTier::kMaxData;
+
+SSLSessionCache::SSLSessionCache() : SSLSessionCache(Options()) {}
+
+SSLSessionCache::SSLSessionCache(Options options) {
+  auto numShards = std::max<size_t>(options.numShards, 1);
+  auto shardCapacity = std::max<size_t>(options.capacity / numShards, 1);
+  for (size_t i = 0; i < numShards; ++i) {
+    shards_.emplace_back(new Shard(shardCapacity));
+  }
+  if (!options.sharedMemoryPath.empty()) {
+    shared_.reset(
+        new SharedTier(options.sharedMemoryPath, options.sharedMemorySlots));
+  }
+}
+
+SSLSessionCache::~SSLSessionCache() = default;
+
+void SSLSessionCache::attach(SSL_CTX* ctx) {
+  SSL_CTX_set_ex_data(ctx, ctxIndex(), this);
+  SSL_CTX_set_session_cache_mode(
+      ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+  SSL_CTX_sess_set_new_cb(ctx, &SSLSessionCache::newSessionCallback);
+  SSL_CTX_sess_set_get_cb(ctx, &SSLSessionCache::getSessionCallback);
+  SSL_CTX_sess_set_remove_cb(ctx, &SSLSessionCache::removeSessionCallback);
+}
+
+SSLSessionCache::Shard& SSLSessionCache::getShard(ByteRange id) {
+  // The shared tier uses the low bits
+  return *shards_[(hashId(id) >> 32) % shards_.size()];
+}
+
+void SSLSessionCache::addLocal(
+    std::string id,
+    SSLSessionUniquePtr session,
+    int64_t expires) {
+  auto& shard = getShard(StringPiece(id));
+  Entry entry{std::move(session), expires};
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.sessions.set(id, std::move(entry));
+}
+
+void SSLSessionCache::add(SSL_SESSION* session) {
+  auto id = sessionId(session);
+  if (id.empty()) {
+    return;
+  }
+  auto expires = sessionExpires(session);
+  if (shared_) {
+    unsigned char buf[SharedTier::kMaxData];
+    int len = i2d_SSL_SESSION(session, nullptr);
+    if (len > 0 && size_t(len) <= sizeof(buf)) {
+      auto p = buf;
+      i2d_SSL_SESSION(session, &p);
+      shared_->add(id, ByteRange(buf, size_t(len)), expires);
+    }
+  }
+  SSL_SESSION_up_ref(session);
+  addLocal(
+      std::string(reinterpret_cast<const char*>(id.data()), id.size()),
+      SSLSessionUniquePtr(session),
+      expires);
+  added_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SSLSessionUniquePtr SSLSessionCache::get(ByteRange id) {
+  auto now = nowSeconds();
+  std::string key(reinterpret_cast<const char*>(id.data()), id.size());
+  {
+    auto& shard = getShard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(key);
+    if (it != shard.sessions.end()) {
+      if (it->second.expires > now) {
+        auto session = it->second.session.get();
+        SSL_SESSION_up_ref(session);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return SSLSessionUniquePtr(session);
+      }
+      shard.sessions.erase(key);
+    }
+  }
+
+  if (shared_) {
+    unsigned char buf[SharedTier::kMaxData];
+    auto len = shared_->get(id, now, buf);
+    const unsigned char* p = buf;
+    SSLSessionUniquePtr session(
+        len > 0 ? d2i_SSL_SESSION(nullptr, &p, long(len)) : nullptr);
+    if (session) {
+      SSL_SESSION_up_ref(session.get());
+      addLocal(
+          std::move(key),
+          SSLSessionUniquePtr(session.get()),
+          sessionExpires(session.get()));
+      sharedHits_.fetch_add(1, std::memory_order_relaxed);
+      return session;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void SSLSessionCache::remove(ByteRange id) {
+  {
+    auto& shard = getShard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.sessions.erase(
+        std::string(reinterpret_cast<const char*>(id.data()), id.size()));
+  }
+  if (shared_) {
+    shared_->remove(id);
+  }
+}
+
+SSLSessionCache::Stats SSLSessionCache::getStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.sharedHits = sharedHits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.added = added_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+SSLSessionCache* SSLSessionCache::fromCtx(SSL_CTX* ctx) {
+  return static_cast<SSLSessionCache*>(SSL_CTX_get_ex_data(ctx, ctxIndex()));
+}
+
+int SSLSessionCache::newSessionCallback(SSL* ssl, SSL_SESSION* session) {
+  if (auto cache = fromCtx(SSL_get_SSL_CTX(ssl))) {
+    cache->add(session);
+  }
+  // add() took its own reference
+  return 0;
+}
+
+#if FOLLY_OPENSSL_IS_110
+SSL_SESSION* SSLSessionCache::getSessionCallback(
+    SSL* ssl,
+    const unsigned char* id,
+    int len,
+    int* copy) {
+#else
+SSL_SESSION* SSLSessionCache::getSessionCallback(
+    SSL* ssl,
+    unsigned char* id,
+    int len,
+    int* copy) {
+#endif
+  // OpenSSL takes the reference we return
+  *copy = 0;
+  auto cache = fromCtx(SSL_get_SSL_CTX(ssl));
+  if (!cache || len <= 0) {
+    return nullptr;
+  }
+  return cache->get(ByteRange(id, size_t(len))).release();
+}
+
+void SSLSessionCache::removeSessionCallback(
+    SSL_CTX* ctx,
+    SSL_SESSION* session) {
+  if (auto cache = fromCtx(ctx)) {
+    cache->remove(sessionId(session));
+  }
+}
+
+} // namespace ssl
+} // namespace folly
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/portability/OpenSSL.h>
+#include <folly/ssl/OpenSSLPtrTypes.h>
+
+namespace folly {
+namespace ssl {
+
+/**
+ * A server side TLS session cache, to use instead of OpenSSL's internal
+ * cache, which has a single lock per SSL_CTX and is private to the process.
+ *
+ * Sessions are kept in numShards LRU maps, each with its own lock, so
+ * handshakes in different threads rarely contend.  A cache can be
+ * attached to several SSL_CTXs (sessions are still only resumed with the
+ * context they were created with, see SSLContext::setSessionCacheContext).
+ *
+ * With sharedMemoryPath, sessions are also stored in a file mapped by
+ * every process using the same path (under /dev/shm, for instance), so a
+ * client can resume its session with a sibling process behind the same
+ * listening port.  The file holds a fixed number of slots; a session
+ * evicts the oldest of the four slots its id hashes to.  Slots are
+ * guarded by sequence numbers and never block: a reader ignores a slot
+ * being written, and a writer gives up on a slot another one is writing.
+ * Sessions larger than a slot (with long client certificate chains, for
+ * instance) are only cached in the process.  Processes sharing a file
+ * must use the same sharedMemorySlots; an existing file keeps its size.
+ *
+ * This caches the sessions of session ids.  Session tickets are resumed
+ * without a cache, see TicketKeyRotator.
+ */
+class SSLSessionCache {
+ public:
+  struct Options {
+    // Sessions kept in the process, over all shards
+    size_t capacity{20480};
+    size_t numShards{16};
+    // Empty for no shared memory
+    std::string sharedMemoryPath;
+    size_t sharedMemorySlots{16384};
+  };
+
+  struct Stats {
+    uint64_t hits;
+    // Found in shared memory only
+    uint64_t sharedHits;
+    uint64_t misses;
+    uint64_t added;
+  };
+
+  SSLSessionCache();
+  // Throws std::system_error if the shared memory can't be mapped
+  explicit SSLSessionCache(Options options);
+  ~SSLSessionCache();
+
+  SSLSessionCache(const SSLSessionCache&) = delete;
+  SSLSessionCache& operator=(const SSLSessionCache&) = delete;
+
+  /**
+   * Makes ctx store its server sessions here and not in OpenSSL's cache.
+   * The cache must outlive ctx.
+   */
+  void attach(SSL_CTX* ctx);
+
+  // Any thread
+
+  void add(SSL_SESSION* session);
+  // nullptr if not found or expired
+  SSLSessionUniquePtr get(ByteRange id);
+  void remove(ByteRange id);
+
+  Stats getStats() const;
+
+ private:
+  struct Entry {
+    SSLSessionUniquePtr session;
+    // Seconds since the epoch
+    int64_t expires;
+  };
+
+  struct Shard {
+    explicit Shard(size_t capacity) : sessions(capacity) {}
+
+    std::mutex mutex;
+    EvictingCacheMap<std::string, Entry> sessions;
+  };
+
+  class SharedTier;
+
+  Shard& getShard(ByteRange id);
+  void addLocal(std::string id, SSLSessionUniquePtr session, int64_t expires);
+
+  static SSLSessionCache* fromCtx(SSL_CTX* ctx);
+  static int newSessionCallback(SSL* ssl, SSL_SESSION* session);
+#if FOLLY_OPENSSL_IS_110
+  static SSL_SESSION*
+  getSessionCallback(SSL* ssl, const unsigned char* id, int len, int* copy);
+#else
+  static SSL_SESSION*
+  getSessionCallback(SSL* ssl, unsigned char* id, int len, int* copy);
+#endif
+  static void removeSessionCallback(SSL_CTX* ctx, SSL_SESSION* session);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::unique_ptr<SharedTier> shared_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> sharedHits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> added_{0};
+};
+
+} // namespace ssl
+} // namespace folly
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ssl/TicketKeyRotator.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/Range.h>
+#include <folly/ssl/OpenSSLHash.h>
+
+namespace folly {
+namespace ssl {
+
+namespace {
+
+int ctxIndex() {
+  static int index =
+      SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+} // namespace
+
+constexpr size_t TicketKeyRotator::kNameSize;
+
+TicketKeyRotator::TicketKeyRotator(
+    std::string seed,
+    std::chrono::seconds rotationInterval)
+    : rotationInterval_(rotationInterval), seed_(std::move(seed)) {
+  CHECK_GT(rotationInterval_.count(), 0);
+  CHECK(!seed_.empty());
+}
+
+void TicketKeyRotator::setSeed(std::string seed) {
+  CHECK(!seed.empty());
+  std::lock_guard<std::mutex> lock(mutex_);
+  seed_ = std::move(seed);
+  keys_.reset();
+}
+
+void TicketKeyRotator::attach(SSL_CTX* ctx) {
+  SSL_CTX_set_ex_data(ctx, ctxIndex(), this);
+  SSL_CTX_set_tlsext_ticket_key_cb(ctx, &TicketKeyRotator::ticketKeyCallback);
+}
+
+TicketKeyRotator::Key TicketKeyRotator::deriveKey(int64_t interval) const {
+  // HMAC(seed, label || interval), one label per part of the key
+  auto derive = [&](StringPiece label, unsigned char* out, size_t len) {
+    unsigned char data[16] = {};
+    memcpy(data, label.data(), std::min<size_t>(label.size(), 8));
+    auto be = Endian::big(uint64_t(interval));
+    memcpy(data + 8, &be, sizeof(be));
+    unsigned char digest[32];
+    OpenSSLHash::hmac_sha256(
+        range(digest), StringPiece(seed_), ByteRange(data, sizeof(data)));
+    memcpy(out, digest, len);
+  };
+  Key key;
+  derive("name", key.name, sizeof(key.name));
+  derive("aes", key.aesKey, sizeof(key.aesKey));
+  derive("hmac", key.hmacKey, sizeof(key.hmacKey));
+  return key;
+}
+
+std::shared_ptr<const TicketKeyRotator::Keys> TicketKeyRotator::getKeys() {
+  auto interval = int64_t(time(nullptr)) / rotationInterval_.count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!keys_ || keys_->interval != interval) {
+    auto keys = std::make_shared<Keys>();
+    keys->interval = interval;
+    for (int64_t i = 0; i < 3; ++i) {
+      keys->keys[size_t(i)] = deriveKey(interval + i - 1);
+    }
+    keys_ = std::move(keys);
+  }
+  return keys_;
+}
+
+int TicketKeyRotator::ticketKeyCallback(
+    SSL* ssl,
+    unsigned char* keyName,
+    unsigned char* iv,
+    EVP_CIPHER_CTX* cipherCtx,
+    HMAC_CTX* hmacCtx,
+    int encrypt) {
+  auto rotator = static_cast<TicketKeyRotator*>(
+      SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ctxIndex()));
+  if (!rotator) {
+    return -1;
+  }
+  auto keys = rotator->getKeys();
+
+  if (encrypt) {
+    auto& key = keys->keys[1];
+    if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1) {
+      return -1;
+    }
+    memcpy(keyName, key.name, kNameSize);
+    if (EVP_EncryptInit_ex(
+            cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1 ||
+        HMAC_Init_ex(
+            hmacCtx, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(),
+            nullptr) != 1) {
+      return -1;
+    }
+    return 1;
+  }
+
+  for (size_t i = 0; i < keys->keys.size(); ++i) {
+    auto& key = keys->keys[i];
+    if (memcmp(keyName, key.name, kNameSize) != 0) {
+      continue;
+    }
+    if (HMAC_Init_ex(
+            hmacCtx, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(),
+            nullptr) != 1 ||
+        EVP_DecryptInit_ex(
+            cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1) {
+      return -1;
+    }
+    // Renew the tickets of other intervals
+    return i == 1 ? 1 : 2;
+  }
+  // Unknown key: full handshake
+  return 0;
+}
+
+} // namespace ssl
+} // namespace folly
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <folly/portability/OpenSSL.h>
+
+namespace folly {
+namespace ssl {
+
+/**
+ * Encrypts TLS session tickets with keys that change every
+ * rotationInterval, so a stolen key only decrypts the tickets of a few
+ * intervals, and resumption needs no session cache.
+ *
+ * The key of each interval is derived from the seed and the interval's
+ * number since the epoch, so every process, on every host, given the same
+ * seed and interval encrypts with the same key without talking to each
+ * other.  Tickets of the previous and next intervals are still accepted
+ * (the next one for clocks running late), and are renewed.  A ticket is
+ * thus valid for at least one interval; keep the session timeout at or
+ * under it.
+ *
+ * Thread safe; keys are derived once per interval.
+ */
+class TicketKeyRotator {
+ public:
+  explicit TicketKeyRotator(
+      std::string seed,
+      std::chrono::seconds rotationInterval = std::chrono::hours(12));
+
+  TicketKeyRotator(const TicketKeyRotator&) = delete;
+  TicketKeyRotator& operator=(const TicketKeyRotator&) = delete;
+
+  /**
+   * Tickets of the old seed are rejected from now on.
+   */
+  void setSeed(std::string seed);
+
+  /**
+   * Makes ctx encrypt its tickets with our keys.  The rotator must outlive
+   * ctx.
+   */
+  void attach(SSL_CTX* ctx);
+
+  static constexpr size_t kNameSize = 16;
+
+ private:
+  struct Key {
+    unsigned char name[kNameSize];
+    unsigned char aesKey[32];
+    unsigned char hmacKey[32];
+  };
+
+  // The keys of interval - 1, interval and interval + 1
+  struct Keys {
+    int64_t interval;
+    std::array<Key, 3> keys;
+  };
+
+  std::shared_ptr<const Keys> getKeys();
+  Key deriveKey(int64_t interval) const;
+
+  static int ticketKeyCallback(
+      SSL* ssl,
+      unsigned char* keyName,
+      unsigned char* iv,
+      EVP_CIPHER_CTX* cipherCtx,
+      HMAC_CTX* hmacCtx,
+      int encrypt);
+
+  const std::chrono::seconds rotationInterval_;
+
+  std::mutex mutex_;
+  std::string seed_;
+  std::shared_ptr<const Keys> keys_;
+};
+
+} // namespace ssl
+} // namespace folly
@@ -16,7 +16,9 @@
 
 #include <folly/Memory.h>
 #include <folly/io/async/AsyncPipe.h>
+#include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/test/SocketPair.h>
 #include <folly/portability/GTest.h>
 
 #include <fcntl.h>
@@ -89,6 +91,29 @@ class TestWriteCallback : public folly::AsyncWriter::WriteCallback {
   bool error_{false};
 };
 
+class TestSpliceCallback : public folly::AsyncPipeReader::SpliceCallback {
+ public:
+  void splicedData(size_t len) noexcept override {
+    spliced_ += len;
+  }
+
+  void spliceEOF() noexcept override {
+    eof_ = true;
+    if (eofCallback_) {
+      eofCallback_();
+    }
+  }
+
+  void spliceErr(const folly::AsyncSocketException&) noexcept override {
+    error_ = true;
+  }
+
+  size_t spliced_{0};
+  bool eof_{false};
+  bool error_{false};
+  std::function<void()> eofCallback_;
+};
+
 class AsyncPipeTest: public Test {
  public:
   void reset(bool movable) {
@@ -179,3 +204,32 @@ TEST_F(AsyncPipeTest, writeOnClose) {
     EXPECT_TRUE(writeCallback_.error_);
   }
 }
+
+TEST_F(AsyncPipeTest, spliceToSocket) {
+  reset(false);
+  folly::SocketPair sockets;
+  auto socket =
+      folly::AsyncSocket::newSocket(&eventBase_, sockets.extractFD0());
+  auto peer = folly::AsyncSocket::newSocket(&eventBase_, sockets.extractFD1());
+  peer->setReadCB(&readCallback_);
+
+  TestSpliceCallback spliceCallback;
+  spliceCallback.eofCallback_ = [&] { socket->close(); };
+  reader_->spliceTo(socket.get(), &spliceCallback);
+
+  // More than fits in the pipe at once
+  std::string expected;
+  for (int i = 0; i < 1000; ++i) {
+    std::string chunk(1000, char('a' + i % 26));
+    writer_->write(getBuf(chunk), &writeCallback_);
+    expected += chunk;
+  }
+  writer_->closeOnEmpty();
+  eventBase_.loop();
+
+  EXPECT_TRUE(spliceCallback.eof_);
+  EXPECT_FALSE(spliceCallback.error_);
+  EXPECT_EQ(expected.size(), spliceCallback.spliced_);
+  EXPECT_EQ(1000, writeCallback_.writes_);
+  EXPECT_EQ(expected, readCallback_.getData());
+}
@@ -16,9 +16,11 @@
 #include <folly/io/async/test/AsyncSSLSocketTest.h>
 
 #include <folly/SocketAddress.h>
+#include <folly/executors/ManualExecutor.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/ssl/PrivateKeyOffload.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/portability/OpenSSL.h>
@@ -1849,6 +1851,199 @@ TEST(AsyncSSLSocketTest, TestSSLCipherCodeToNameMap) {
   EXPECT_EQ(OpenSSLUtils::getCipherName(0x00ff), "");
 }
 
+#if FOLLY_OPENSSL_IS_110
+namespace {
+// kTLS only works on TCP connections
+void getTcpFds(int fds[2]) {
+  folly::SocketAddress addr("127.0.0.1", 0);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(-1, listener);
+  sockaddr_storage ss;
+  socklen_t len = addr.getAddress(&ss);
+  ASSERT_EQ(0, bind(listener, reinterpret_cast<sockaddr*>(&ss), len));
+  ASSERT_EQ(0, listen(listener, 1));
+  addr.setFromLocalAddress(listener);
+  len = addr.getAddress(&ss);
+  fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(0, connect(fds[0], reinterpret_cast<sockaddr*>(&ss), len));
+  fds[1] = accept(listener, nullptr, nullptr);
+  ASSERT_NE(-1, fds[1]);
+  close(listener);
+  for (int idx = 0; idx < 2; ++idx) {
+    int flags = fcntl(fds[idx], F_GETFL, 0);
+    ASSERT_EQ(0, fcntl(fds[idx], F_SETFL, flags | O_NONBLOCK));
+  }
+}
+
+class KtlsReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  KtlsReadCallback(AsyncSocket* socket, size_t expected)
+      : socket_(socket), expected_(expected) {}
+
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf_.data();
+    *lenReturn = buf_.size();
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    data.append(buf_.data(), len);
+    if (data.size() >= expected_) {
+      socket_->setReadCB(nullptr);
+    }
+  }
+
+  void readEOF() noexcept override {
+    eof = true;
+  }
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  std::string data;
+  bool eof{false};
+
+ private:
+  AsyncSocket* socket_;
+  size_t expected_;
+  std::array<char, 4096> buf_;
+};
+} // namespace
+
+/**
+ * Exchange data, including a sendFile(), with kernel TLS offload requested
+ * on one or both ends.  Where the kernel lacks TLS support both ends stay on
+ * OpenSSL; either way each end has to understand the other.
+ */
+TEST(AsyncSSLSocketTest, KtlsWriteRead) {
+  std::string contents(1024 * 1024 + 17, '\0');
+  for (size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = char(i * 31);
+  }
+  folly::test::TemporaryFile file;
+  ASSERT_EQ(
+      contents.size(), writeFull(file.fd(), contents.data(), contents.size()));
+
+  for (auto ktls : std::vector<std::pair<bool, bool>>{
+           {true, false}, {false, true}, {true, true}}) {
+    EventBase base;
+    auto clientCtx = std::make_shared<SSLContext>();
+    auto serverCtx = std::make_shared<SSLContext>();
+    getctx(clientCtx, serverCtx);
+    // Only TLS 1.2 with AES-GCM can be offloaded
+    clientCtx->ciphers("ECDHE-RSA-AES128-GCM-SHA256");
+    SSL_CTX_set_max_proto_version(clientCtx->getSSLCtx(), TLS1_2_VERSION);
+
+    int fds[2];
+    getTcpFds(fds);
+    AsyncSSLSocket::UniquePtr clientSockPtr(
+        new AsyncSSLSocket(clientCtx, &base, fds[0], false));
+    AsyncSSLSocket::UniquePtr serverSockPtr(
+        new AsyncSSLSocket(serverCtx, &base, fds[1], true));
+    auto clientSock = clientSockPtr.get();
+    auto serverSock = serverSockPtr.get();
+    clientSock->setKtlsEnabled(ktls.first);
+    serverSock->setKtlsEnabled(ktls.second);
+    SSLHandshakeClient client(std::move(clientSockPtr), true, true);
+    SSLHandshakeServer server(std::move(serverSockPtr), true, true);
+    while (!client.handshakeSuccess_ && !client.handshakeError_) {
+      base.loopOnce();
+    }
+    ASSERT_TRUE(client.handshakeSuccess_);
+    ASSERT_TRUE(server.handshakeSuccess_);
+    LOG(INFO) << "client kTLS tx=" << clientSock->isKtlsTxEnabled()
+              << " rx=" << clientSock->isKtlsRxEnabled()
+              << ", server kTLS tx=" << serverSock->isKtlsTxEnabled()
+              << " rx=" << serverSock->isKtlsRxEnabled();
+    if (!ktls.first) {
+      EXPECT_FALSE(clientSock->isKtlsTxEnabled());
+      EXPECT_FALSE(clientSock->isKtlsRxEnabled());
+    }
+
+    // Both ends write at once, so the socket buffers fill up
+    size_t expected = 5 + contents.size() - 7;
+    KtlsReadCallback clientRead(clientSock, expected);
+    KtlsReadCallback serverRead(serverSock, expected);
+    clientSock->setReadCB(&clientRead);
+    serverSock->setReadCB(&serverRead);
+    for (auto sock : {clientSock, serverSock}) {
+      sock->write(nullptr, "hello", 5);
+      sock->sendFile(nullptr, file.fd(), 7, contents.size() - 7);
+    }
+    EventBaseAborter eba(&base, 10000);
+    base.loop();
+
+    for (auto read : {&clientRead, &serverRead}) {
+      ASSERT_EQ(expected, read->data.size());
+      EXPECT_EQ("hello", read->data.substr(0, 5));
+      EXPECT_TRUE(read->data.substr(5) == contents.substr(7));
+      EXPECT_FALSE(read->eof);
+    }
+
+    // The close_notify has to reach the other end
+    serverSock->setReadCB(&serverRead);
+    clientSock->closeNow();
+    base.loop();
+    EXPECT_TRUE(serverRead.eof);
+  }
+}
+
+/**
+ * The server's private key operations run on an executor while its handshake
+ * waits in STATE_ASYNC_PENDING, for RSA signatures (ECDHE and TLS 1.3) and
+ * RSA key exchange.
+ */
+TEST(AsyncSSLSocketTest, PrivateKeyOffload) {
+  struct Config {
+    int maxVersion;
+    const char* ciphers;
+  };
+  std::vector<Config> configs = {
+      {TLS1_2_VERSION, "ECDHE-RSA-AES128-GCM-SHA256"},
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+      {TLS1_2_VERSION, "AES128-GCM-SHA256"},
+#endif
+  };
+#ifdef TLS1_3_VERSION
+  configs.push_back({TLS1_3_VERSION, "ALL"});
+#endif
+  for (const auto& config : configs) {
+    EventBase base;
+    ManualExecutor executor;
+    auto clientCtx = std::make_shared<SSLContext>();
+    auto serverCtx = std::make_shared<SSLContext>();
+    getctx(clientCtx, serverCtx);
+    clientCtx->ciphers(config.ciphers);
+    SSL_CTX_set_max_proto_version(clientCtx->getSSLCtx(), config.maxVersion);
+    ASSERT_TRUE(
+        ssl::offloadPrivateKeyOperations(serverCtx->getSSLCtx(), &executor));
+
+    int fds[2];
+    getfds(fds);
+    AsyncSSLSocket::UniquePtr clientSockPtr(
+        new AsyncSSLSocket(clientCtx, &base, fds[0], false));
+    AsyncSSLSocket::UniquePtr serverSockPtr(
+        new AsyncSSLSocket(serverCtx, &base, fds[1], true));
+    auto serverSock = serverSockPtr.get();
+    SSLHandshakeClient client(std::move(clientSockPtr), true, true);
+    SSLHandshakeServer server(std::move(serverSockPtr), true, true);
+
+    size_t offloaded = 0;
+    while ((!client.handshakeSuccess_ && !client.handshakeError_) ||
+           (!server.handshakeSuccess_ && !server.handshakeError_)) {
+      base.loopOnce(EVLOOP_NONBLOCK);
+      if (serverSock->getSSLState() == AsyncSSLSocket::STATE_ASYNC_PENDING) {
+        offloaded += executor.run();
+      }
+    }
+    EXPECT_TRUE(client.handshakeSuccess_);
+    EXPECT_TRUE(server.handshakeSuccess_);
+    EXPECT_EQ(1, offloaded) << config.ciphers;
+    EXPECT_EQ(AsyncSSLSocket::STATE_ESTABLISHED, serverSock->getSSLState());
+  }
+}
+#endif // FOLLY_OPENSSL_IS_110
+
 #if FOLLY_ALLOW_TFO
 
 class MockAsyncTFOSSLSocket : public AsyncSSLSocket {
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/AsyncShmTransport.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <folly/io/async/AsyncSocketException.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+class TestReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  bool isBufferMovable() noexcept override {
+    return movable_;
+  }
+  void setMovable(bool movable) {
+    movable_ = movable;
+  }
+
+  void readBufferAvailable(std::unique_ptr<IOBuf> readBuf) noexcept override {
+    ++reads_;
+    readBuffer_.append(std::move(readBuf));
+    maybeDone();
+  }
+
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) noexcept override {
+    auto res = readBuffer_.preallocate(4000, 65000);
+    *bufReturn = res.first;
+    *lenReturn = res.second;
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    ++reads_;
+    readBuffer_.postallocate(len);
+    maybeDone();
+  }
+
+  void readEOF() noexcept override {
+    eof_ = true;
+  }
+
+  void readErr(const AsyncSocketException&) noexcept override {
+    error_ = true;
+  }
+
+  std::string getData() {
+    auto buf = readBuffer_.move();
+    if (!buf) {
+      return std::string();
+    }
+    buf->coalesce();
+    return buf->moveToFbString().toStdString();
+  }
+
+  // Calls done() once this many bytes were read
+  void expect(size_t bytes, std::function<void()> done) {
+    expected_ = bytes;
+    done_ = std::move(done);
+  }
+
+  IOBufQueue readBuffer_{IOBufQueue::cacheChainLength()};
+  size_t reads_{0};
+  bool eof_{false};
+  bool error_{false};
+
+ private:
+  void maybeDone() {
+    if (done_ && readBuffer_.chainLength() >= expected_) {
+      done_();
+    }
+  }
+
+  bool movable_{false};
+  size_t expected_{0};
+  std::function<void()> done_;
+};
+
+class TestWriteCallback : public AsyncTransportWrapper::WriteCallback {
+ public:
+  void writeSuccess() noexcept override {
+    ++successes_;
+  }
+
+  void writeErr(size_t bytesWritten, const AsyncSocketException& ex) noexcept
+      override {
+    ++errors_;
+    bytesWritten_ = bytesWritten;
+    type_ = ex.getType();
+  }
+
+  int successes_{0};
+  int errors_{0};
+  size_t bytesWritten_{0};
+  AsyncSocketException::AsyncSocketExceptionType type_{
+      AsyncSocketException::UNKNOWN};
+};
+
+std::string makeData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = char('a' + i % 26);
+  }
+  return data;
+}
+
+struct TransportPair {
+  TransportPair(EventBase* evbA, EventBase* evbB, size_t capacity) {
+    auto ends = AsyncShmTransport::makeEndpoints(capacity);
+    a = AsyncShmTransport::newTransport(evbA, std::move(ends.first));
+    b = AsyncShmTransport::newTransport(evbB, std::move(ends.second));
+  }
+
+  AsyncShmTransport::UniquePtr a;
+  AsyncShmTransport::UniquePtr b;
+};
+
+} // namespace
+
+TEST(AsyncShmTransport, WriteRead) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestReadCallback rcb;
+  TestWriteCallback wcb;
+
+  pair.b->setReadCB(&rcb);
+  pair.a->write(&wcb, "hello ", 6);
+  pair.a->writeChain(&wcb, IOBuf::copyBuffer("world"));
+  // Complete as soon as they are in the ring
+  EXPECT_EQ(2, wcb.successes_);
+
+  pair.a->close();
+  evb.loop();
+  EXPECT_EQ("hello world", rcb.getData());
+  EXPECT_TRUE(rcb.eof_);
+  EXPECT_FALSE(rcb.error_);
+  EXPECT_EQ(11, pair.a->getAppBytesWritten());
+  EXPECT_EQ(11, pair.b->getAppBytesReceived());
+}
+
+TEST(AsyncShmTransport, DataBeforeReadCallback) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestReadCallback rcb;
+  rcb.setMovable(true);
+
+  pair.a->write(nullptr, "early", 5);
+  pair.a->shutdownWrite();
+  evb.loop();
+
+  pair.b->setReadCB(&rcb);
+  evb.loop();
+  EXPECT_EQ("early", rcb.getData());
+  EXPECT_TRUE(rcb.eof_);
+}
+
+TEST(AsyncShmTransport, WriteLargerThanRing) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestReadCallback rcb;
+  TestWriteCallback wcb;
+  auto data = makeData(1000 * 1000);
+
+  pair.b->setReadCB(&rcb);
+  iovec vec[2];
+  vec[0].iov_base = const_cast<char*>(data.data());
+  vec[0].iov_len = 1000;
+  vec[1].iov_base = const_cast<char*>(data.data() + 1000);
+  vec[1].iov_len = data.size() - 1000;
+  pair.a->writev(&wcb, vec, 2);
+  EXPECT_EQ(0, wcb.successes_);
+  pair.a->close();
+
+  evb.loop();
+  EXPECT_EQ(1, wcb.successes_);
+  EXPECT_EQ(0, wcb.errors_);
+  EXPECT_EQ(data, rcb.getData());
+  EXPECT_TRUE(rcb.eof_);
+}
+
+TEST(AsyncShmTransport, WriteAfterPeerClose) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestWriteCallback wcb;
+
+  pair.b->closeNow();
+  EXPECT_FALSE(pair.a->good());
+  pair.a->write(&wcb, "x", 1);
+  EXPECT_EQ(1, wcb.errors_);
+  EXPECT_EQ(AsyncSocketException::END_OF_FILE, wcb.type_);
+}
+
+TEST(AsyncShmTransport, PendingWriteFailsOnPeerClose) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestWriteCallback wcb;
+  auto data = makeData(10000);
+
+  pair.a->write(&wcb, data.data(), data.size());
+  EXPECT_EQ(0, wcb.successes_);
+  pair.b->closeNow();
+  evb.loop();
+  EXPECT_EQ(1, wcb.errors_);
+  EXPECT_EQ(4096, wcb.bytesWritten_);
+}
+
+TEST(AsyncShmTransport, SendTimeout) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 4096);
+  TestWriteCallback wcb;
+  auto data = makeData(10000);
+
+  pair.a->setSendTimeout(10);
+  pair.a->write(&wcb, data.data(), data.size());
+  evb.loop();
+  EXPECT_EQ(1, wcb.errors_);
+  EXPECT_EQ(AsyncSocketException::TIMED_OUT, wcb.type_);
+  EXPECT_TRUE(pair.a->error());
+}
+
+TEST(AsyncShmTransport, MaxReadsPerEvent) {
+  EventBase evb;
+  TransportPair pair(&evb, &evb, 1 << 20);
+  TestReadCallback rcb;
+  auto data = makeData(100 * 1000);
+
+  // getReadBuffer() returns less than all of it, and the rest waits for
+  // the next loop iteration
+  pair.b->setMaxReadsPerEvent(1);
+  pair.b->setReadCB(&rcb);
+  pair.a->write(nullptr, data.data(), data.size());
+  pair.a->close();
+  evb.loopOnce();
+  EXPECT_EQ(1, rcb.reads_);
+  evb.loop();
+  EXPECT_LT(1, rcb.reads_);
+  EXPECT_TRUE(rcb.eof_);
+  EXPECT_EQ(data, rcb.getData());
+}
+
+TEST(AsyncShmTransport, AcrossThreads) {
+  EventBase evbA;
+  EventBase evbB;
+  TransportPair pair(&evbA, &evbB, 4096);
+  const size_t kSize = 10 * 1000 * 1000;
+  auto data = makeData(kSize);
+
+  std::thread reader([&] {
+    TestReadCallback rcb;
+    rcb.setMovable(true);
+    rcb.expect(kSize, [&] { pair.b->setReadCB(nullptr); });
+    pair.b->setReadCB(&rcb);
+    evbB.loop();
+    EXPECT_EQ(data, rcb.getData());
+  });
+
+  TestWriteCallback wcb;
+  for (size_t i = 0; i < kSize; i += 1000) {
+    pair.a->write(&wcb, data.data() + i, 1000);
+  }
+  evbA.loop();
+  EXPECT_EQ(int(kSize / 1000), wcb.successes_);
+  reader.join();
+}
@@ -16,6 +16,12 @@
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/io/async/EventBase.h>
 
+#include <algorithm>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Subprocess.h>
+#include <folly/io/async/AsyncChildExitHandler.h>
 #include <folly/portability/GTest.h>
 
 using namespace folly;
@@ -63,3 +69,79 @@ TEST(AsyncSignalHandler, attachEventBase) {
   handler.detachEventBase();
   EXPECT_FALSE(handler.getEventBase());
 }
+
+#ifdef __linux__
+namespace {
+class TestSignalInfoHandler : public AsyncSignalHandler {
+ public:
+  explicit TestSignalInfoHandler(EventBase* evb)
+      : AsyncSignalHandler(evb, Backend::SIGNALFD) {}
+
+  void signalReceived(int signum) noexcept override {
+    signals.push_back(signum);
+  }
+
+  void signalInfoReceived(const SignalInfo& info) noexcept override {
+    infos.push_back(info);
+    AsyncSignalHandler::signalInfoReceived(info);
+  }
+
+  std::vector<int> signals;
+  std::vector<SignalInfo> infos;
+};
+} // namespace
+
+TEST(AsyncSignalHandler, signalfd) {
+  EventBase evb;
+  TestSignalInfoHandler handler{&evb};
+  EXPECT_EQ(AsyncSignalHandler::Backend::SIGNALFD, handler.getBackend());
+
+  handler.registerSignalHandler(SIGUSR1);
+  handler.registerSignalHandler(SIGUSR2);
+  EXPECT_THROW(handler.registerSignalHandler(SIGUSR1), std::runtime_error);
+
+  // Both are read in one go
+  kill(getpid(), SIGUSR1);
+  kill(getpid(), SIGUSR2);
+  EXPECT_TRUE(handler.signals.empty());
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(2, handler.signals.size());
+  EXPECT_EQ(SIGUSR1, handler.signals[0]);
+  EXPECT_EQ(SIGUSR2, handler.signals[1]);
+  EXPECT_EQ(getpid(), handler.infos[0].pid);
+  EXPECT_EQ(SI_USER, handler.infos[0].code);
+
+  handler.unregisterSignalHandler(SIGUSR2);
+  EXPECT_THROW(handler.unregisterSignalHandler(SIGUSR2), std::runtime_error);
+  handler.unregisterSignalHandler(SIGUSR1);
+  handler.detachEventBase();
+}
+
+TEST(AsyncChildExitHandler, reap) {
+  EventBase evb;
+  AsyncChildExitHandler handler{&evb};
+
+  std::vector<std::unique_ptr<Subprocess>> procs;
+  std::vector<pid_t> exited;
+  for (int i = 0; i < 10; ++i) {
+    procs.push_back(std::make_unique<Subprocess>(std::vector<std::string>{
+        "/bin/sh", "-c", folly::to<std::string>("exit ", i)}));
+    handler.add(*procs.back(), [&](Subprocess& proc) {
+      exited.push_back(proc.returnCode().exitStatus());
+    });
+  }
+  // Not ours, and not reaped until the end
+  Subprocess other(std::vector<std::string>{"/bin/true"});
+
+  while (handler.size() > 0) {
+    evb.loopOnce();
+  }
+  std::sort(exited.begin(), exited.end());
+  ASSERT_EQ(10, exited.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, exited[i]);
+    EXPECT_TRUE(procs[i]->returnCode().exited());
+  }
+  other.waitChecked();
+}
+#endif
@@ -183,6 +183,39 @@ class ReadCallback : public folly::AsyncTransportWrapper::ReadCallback {
   const size_t maxBufferSz;
 };
 
+class QueueReadCallback
+    : public folly::AsyncTransportWrapper::QueueReadCallback {
+ public:
+  QueueReadCallback()
+      : state(STATE_WAITING),
+        exception(folly::AsyncSocketException::UNKNOWN, "none") {}
+
+  void readQueueAvailable(size_t len) noexcept override {
+    ++numReads;
+    maxRead = std::max(maxRead, len);
+    data.append(readQueue().move());
+    if (dataAvailableCallback) {
+      dataAvailableCallback();
+    }
+  }
+
+  void readEOF() noexcept override {
+    state = STATE_SUCCEEDED;
+  }
+
+  void readErr(const folly::AsyncSocketException& ex) noexcept override {
+    state = STATE_FAILED;
+    exception = ex;
+  }
+
+  StateEnum state;
+  folly::AsyncSocketException exception;
+  folly::IOBufQueue data{folly::IOBufQueue::cacheChainLength()};
+  size_t numReads{0};
+  size_t maxRead{0};
+  VoidCallback dataAvailableCallback;
+};
+
 class BufferCallback : public folly::AsyncTransport::BufferCallback {
  public:
   BufferCallback() : buffered_(false), bufferCleared_(false) {}
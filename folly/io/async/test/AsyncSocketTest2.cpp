@@ -17,6 +17,7 @@
 #include <folly/io/async/test/AsyncSocketTest2.h>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/FileUtil.h>
 #include <folly/Random.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -458,6 +459,120 @@ TEST_P(AsyncSocketConnectTest, ConnectAndRead) {
   ASSERT_FALSE(socket->isClosedByPeer());
 }
 
+/**
+ * Test reading into the queue of a QueueReadCallback, several buffers at a
+ * time.
+ */
+TEST(AsyncSocketTest, ConnectAndReadIntoQueue) {
+  TestServer server;
+
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb);
+  ConnCallback ccb;
+  socket->connect(&ccb, server.getAddress(), 30);
+
+  QueueReadCallback rcb;
+  socket->setReadCB(&rcb);
+
+  std::shared_ptr<BlockingSocket> acceptedSocket = server.accept();
+  std::vector<uint8_t> buf(4 * 1024 * 1024);
+  for (size_t i = 0; i < buf.size(); ++i) {
+    buf[i] = uint8_t(i * 7);
+  }
+  std::thread writer([&] {
+    acceptedSocket->write(buf.data(), buf.size());
+    acceptedSocket->flush();
+    acceptedSocket->close();
+  });
+  evb.loop();
+  writer.join();
+
+  ASSERT_EQ(ccb.state, STATE_SUCCEEDED);
+  ASSERT_EQ(rcb.state, STATE_SUCCEEDED);
+  ASSERT_EQ(rcb.data.chainLength(), buf.size());
+  auto data = rcb.data.move();
+  data->coalesce();
+  ASSERT_EQ(memcmp(data->data(), buf.data(), buf.size()), 0);
+  // Reads grew past the size of one buffer
+  EXPECT_GT(rcb.maxRead, rcb.readBufferSize());
+  EXPECT_LE(rcb.maxRead, rcb.maxReadSize());
+  EXPECT_LT(rcb.numReads, buf.size() / rcb.readBufferSize());
+}
+
+namespace {
+// An AsyncSocket whose sendFile() goes through performWrite(), as it does
+// for AsyncSSLSocket
+class NoSendFileSocket : public AsyncSocket {
+ public:
+  using AsyncSocket::AsyncSocket;
+
+ protected:
+  bool supportsSendFile() const override {
+    return false;
+  }
+};
+
+void testSendFile(const std::shared_ptr<AsyncSocket>& socket) {
+  TestServer server;
+  ConnCallback ccb;
+  socket->connect(&ccb, server.getAddress(), 30);
+  std::shared_ptr<BlockingSocket> acceptedSocket = server.accept();
+  socket->getEventBase()->loopOnce();
+  ASSERT_EQ(ccb.state, STATE_SUCCEEDED);
+
+  // More than fits in the socket buffers, so that the rest is queued
+  std::string contents(4 * 1024 * 1024 + 123, '\0');
+  for (size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = char(i * 31);
+  }
+  folly::test::TemporaryFile file;
+  ASSERT_EQ(
+      contents.size(),
+      writeFull(file.fd(), contents.data(), contents.size()));
+
+  std::string received(contents.size() + 3, '\0');
+  std::thread reader([&] {
+    acceptedSocket->readAll(
+        reinterpret_cast<uint8_t*>(&received[0]), received.size());
+  });
+
+  // Ordered with writes before and after it, from the given offset
+  WriteCallback wcb1;
+  WriteCallback wcb2;
+  WriteCallback wcb3;
+  socket->write(&wcb1, "abc", 3);
+  socket->sendFile(&wcb2, file.fd(), 10, contents.size() - 10);
+  socket->write(&wcb3, "0123456789", 10);
+  socket->getEventBase()->loop();
+  reader.join();
+
+  ASSERT_EQ(STATE_SUCCEEDED, wcb1.state);
+  ASSERT_EQ(STATE_SUCCEEDED, wcb2.state);
+  ASSERT_EQ(STATE_SUCCEEDED, wcb3.state);
+  EXPECT_EQ("abc", received.substr(0, 3));
+  EXPECT_TRUE(received.substr(3, contents.size() - 10) == contents.substr(10));
+  EXPECT_EQ("0123456789", received.substr(contents.size() - 7));
+
+  // Failing when the file is shorter than asked for
+  WriteCallback wcb4;
+  socket->sendFile(&wcb4, file.fd(), contents.size() - 5, 6);
+  socket->getEventBase()->loop();
+  EXPECT_EQ(STATE_FAILED, wcb4.state);
+  EXPECT_EQ(AsyncSocketException::END_OF_FILE, wcb4.exception.getType());
+}
+} // namespace
+
+TEST(AsyncSocketTest, SendFile) {
+  EventBase evb;
+  testSendFile(AsyncSocket::newSocket(&evb));
+}
+
+TEST(AsyncSocketTest, SendFileWithoutKernelSupport) {
+  EventBase evb;
+  testSendFile(std::shared_ptr<AsyncSocket>(
+      new NoSendFileSocket(&evb), AsyncSocket::Destructor()));
+}
+
 /**
  * Test installing a read callback and then closing immediately before the
  * connect attempt finishes.
@@ -1345,6 +1460,60 @@ TEST(AsyncSocketTest, WriteIOBufCorked) {
   ASSERT_FALSE(socket->isClosedByPeer());
 }
 
+TEST(AsyncSocketTest, WriteCoalescing) {
+  TestServer server;
+
+  // connect()
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb);
+  ConnCallback ccb;
+  socket->connect(&ccb, server.getAddress(), 30);
+
+  // Accept the connection
+  std::shared_ptr<AsyncSocket> acceptedSocket = server.acceptAsync(&evb);
+  ReadCallback rcb;
+  acceptedSocket->setReadCB(&rcb);
+  while (ccb.state == STATE_WAITING) {
+    evb.loopOnce();
+  }
+  ASSERT_EQ(ccb.state, STATE_SUCCEEDED);
+
+  EXPECT_FALSE(socket->getWriteCoalescing());
+  socket->setWriteCoalescing(true);
+  EXPECT_TRUE(socket->getWriteCoalescing());
+
+  // The first write goes out immediately, the next ones (but the EOR one)
+  // are held back until the end of the loop iteration
+  constexpr size_t kNumWrites = 6;
+  std::string expected;
+  WriteCallback wcb[kNumWrites];
+  for (size_t i = 0; i < kNumWrites; ++i) {
+    std::string data(i + 3, char('a' + i));
+    expected += data;
+    auto flags = i == 3 ? WriteFlags::EOR : WriteFlags::NONE;
+    socket->writeChain(&wcb[i], IOBuf::copyBuffer(data), flags);
+  }
+  socket->shutdownWrite();
+
+  // Let the reads and writes run to completion
+  evb.loop();
+
+  for (size_t i = 0; i < kNumWrites; ++i) {
+    ASSERT_EQ(wcb[i].state, STATE_SUCCEEDED);
+  }
+
+  // Make sure the reader got the right data in the right order
+  ASSERT_EQ(rcb.state, STATE_SUCCEEDED);
+  std::string received;
+  for (const auto& buffer : rcb.buffers) {
+    received.append(buffer.buffer, buffer.length);
+  }
+  ASSERT_EQ(received, expected);
+
+  acceptedSocket->close();
+  socket->close();
+}
+
 /**
  * Test performing a zero-length write
  */
@@ -1908,6 +2077,88 @@ TEST(AsyncSocketTest, OtherThreadAcceptCallback) {
 
 }
 
+namespace {
+class BatchAcceptCallback : public AsyncServerSocket::AcceptCallback {
+ public:
+  void connectionAccepted(
+      int /* fd */,
+      const folly::SocketAddress& /* addr */) noexcept override {
+    ADD_FAILURE() << "connection accepted without a batch";
+  }
+
+  void connectionsAccepted(std::vector<AsyncServerSocket::AcceptedConnection>&
+                               connections) noexcept override {
+    batches.push_back(connections.size());
+    for (auto& connection : connections) {
+      closeNoInt(connection.fd);
+    }
+    if (fn) {
+      fn();
+    }
+  }
+
+  void acceptError(const std::exception& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  std::vector<size_t> batches;
+  std::function<void()> fn;
+};
+} // namespace
+
+/**
+ * Test AsyncServerSocket::setAcceptBatchSize(), with callbacks in the
+ * primary EventBase and behind a notification queue
+ */
+TEST(AsyncSocketTest, AcceptBatch) {
+  for (bool remote : {false, true}) {
+    EventBase eventBase;
+    std::shared_ptr<AsyncServerSocket> serverSocket(
+        AsyncServerSocket::newSocket(&eventBase));
+    serverSocket->setAcceptBatchSize(4);
+    serverSocket->bind(0);
+    serverSocket->listen(16);
+    folly::SocketAddress serverAddress;
+    serverSocket->getAddress(&serverAddress);
+
+    // Connect before the server accepts, so that it gets them all at once
+    std::vector<int> clients;
+    for (int i = 0; i < 10; ++i) {
+      int fd = fsp::socket(serverAddress.getFamily(), SOCK_STREAM, 0);
+      ASSERT_GE(fd, 0);
+      sockaddr_storage addrStorage;
+      serverAddress.getAddress(&addrStorage);
+      ASSERT_EQ(
+          0,
+          fsp::connect(
+              fd,
+              reinterpret_cast<sockaddr*>(&addrStorage),
+              serverAddress.getActualSize()));
+      clients.push_back(fd);
+    }
+
+    auto callbackBase = remote ? &eventBase : nullptr;
+    BatchAcceptCallback callback;
+    callback.fn = [&] {
+      size_t accepted = 0;
+      for (auto size : callback.batches) {
+        accepted += size;
+      }
+      if (accepted == clients.size()) {
+        serverSocket->removeAcceptCallback(&callback, callbackBase);
+      }
+    };
+    serverSocket->addAcceptCallback(&callback, callbackBase);
+    serverSocket->startAccepting();
+    eventBase.loop();
+
+    EXPECT_EQ((std::vector<size_t>{4, 4, 2}), callback.batches) << remote;
+    for (auto fd : clients) {
+      closeNoInt(fd);
+    }
+  }
+}
+
 void serverSocketSanityTest(AsyncServerSocket* serverSocket) {
   EventBase* eventBase = serverSocket->getEventBase();
   CHECK(eventBase);
@@ -2980,6 +3231,118 @@ TEST(AsyncSocketTest, ErrMessageCallback) {
   ASSERT_EQ(
       errMsgCB.gotByteSeq_ + errMsgCB.gotTimestamp_, errMsgCB.resetAfter_);
 }
+
+class TestTimestampObserver : public AsyncSocket::TimestampObserver {
+ public:
+  void timestampsReceived(
+      AsyncSocket* /* socket */,
+      const std::vector<Timestamp>& timestamps) noexcept override {
+    ++batches;
+    received.insert(received.end(), timestamps.begin(), timestamps.end());
+  }
+
+  bool has(Event event, uint64_t byteOffset) const {
+    for (const auto& timestamp : received) {
+      if (timestamp.event == event && timestamp.byteOffset == byteOffset) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t batches{0};
+  std::vector<Timestamp> received;
+};
+
+TEST(AsyncSocketTest, Timestamping) {
+  TestServer server;
+
+  // connect()
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb);
+  ConnCallback ccb;
+  socket->connect(&ccb, server.getAddress(), 30);
+
+  // Accept the connection
+  std::shared_ptr<AsyncSocket> acceptedSocket = server.acceptAsync(&evb);
+  ReadCallback rcb;
+  acceptedSocket->setReadCB(&rcb);
+  while (ccb.state == STATE_WAITING) {
+    evb.loopOnce();
+  }
+  ASSERT_EQ(ccb.state, STATE_SUCCEEDED);
+
+  // Keep the socket subscribed to events, for the error queue
+  ReadCallback clientRcb;
+  socket->setReadCB(&clientRcb);
+
+  // Bytes written before timestamping is on still count in the offsets
+  WriteCallback wcb1;
+  socket->write(&wcb1, "hello", 5);
+
+  TestTimestampObserver txObserver;
+  AsyncSocket::TimestampOptions txOptions;
+  txOptions.tx = true;
+  txOptions.rx = false;
+  ASSERT_EQ(0, socket->setTimestamping(&txObserver, txOptions));
+  EXPECT_EQ(&txObserver, socket->getTimestampObserver());
+
+  TestTimestampObserver rxObserver;
+  AsyncSocket::TimestampOptions rxOptions;
+  rxOptions.ack = false;
+  ASSERT_EQ(0, acceptedSocket->setTimestamping(&rxObserver, rxOptions));
+
+  WriteCallback wcb2;
+  socket->write(&wcb2, " big", 4);
+  WriteCallback wcb3;
+  socket->write(&wcb3, " world", 6);
+
+  for (int i = 0; i < 1000 &&
+       (rcb.dataRead() < 15 ||
+        !txObserver.has(AsyncSocket::TimestampObserver::Event::ACK, 15));
+       ++i) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  ASSERT_EQ(wcb1.state, STATE_SUCCEEDED);
+  ASSERT_EQ(wcb2.state, STATE_SUCCEEDED);
+  ASSERT_EQ(wcb3.state, STATE_SUCCEEDED);
+
+  EXPECT_TRUE(txObserver.has(AsyncSocket::TimestampObserver::Event::TX, 9));
+  EXPECT_TRUE(txObserver.has(AsyncSocket::TimestampObserver::Event::TX, 15));
+  EXPECT_TRUE(txObserver.has(AsyncSocket::TimestampObserver::Event::ACK, 15));
+  for (const auto& timestamp : txObserver.received) {
+    EXPECT_NE(timestamp.event, AsyncSocket::TimestampObserver::Event::SCHED);
+    EXPECT_NE(timestamp.event, AsyncSocket::TimestampObserver::Event::RX);
+    EXPECT_GT(timestamp.software.count(), 0);
+  }
+
+  // The kernel may take a moment to start timestamping incoming packets
+  size_t written = 15;
+  for (int i = 0; i < 100 && rxObserver.received.empty(); ++i) {
+    socket->write(nullptr, "!", 1);
+    ++written;
+    for (int j = 0; j < 10 && rcb.dataRead() < written; ++j) {
+      evb.loopOnce(EVLOOP_NONBLOCK);
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  ASSERT_FALSE(rxObserver.received.empty());
+  for (const auto& timestamp : rxObserver.received) {
+    EXPECT_EQ(timestamp.event, AsyncSocket::TimestampObserver::Event::RX);
+    EXPECT_LT(timestamp.byteOffset, written);
+    EXPECT_GT(timestamp.software.count(), 0);
+  }
+
+  ASSERT_EQ(0, socket->setTimestamping(nullptr));
+  EXPECT_EQ(nullptr, socket->getTimestampObserver());
+
+  acceptedSocket->close();
+  socket->close();
+}
 #endif // FOLLY_HAVE_MSG_ERRQUEUE
 
 TEST(AsyncSocket, PreReceivedData) {
@@ -3015,6 +3378,32 @@ TEST(AsyncSocket, PreReceivedData) {
   evb.loop();
 }
 
+TEST(AsyncSocket, PreReceivedDataIntoQueue) {
+  TestServer server;
+
+  EventBase evb;
+  std::shared_ptr<AsyncSocket> socket = AsyncSocket::newSocket(&evb);
+  socket->connect(nullptr, server.getAddress(), 30);
+  evb.loop();
+
+  socket->writeChain(nullptr, IOBuf::copyBuffer("world"));
+
+  auto acceptedSocket = server.acceptAsync(&evb);
+  acceptedSocket->setPreReceivedData(IOBuf::copyBuffer("hello "));
+
+  QueueReadCallback readCallback;
+  readCallback.dataAvailableCallback = [&]() {
+    if (readCallback.data.chainLength() == 11) {
+      acceptedSocket->setReadCB(nullptr);
+    }
+  };
+  acceptedSocket->setReadCB(&readCallback);
+
+  evb.loop();
+  EXPECT_EQ(
+      "hello world", StringPiece(readCallback.data.move()->coalesce()).str());
+}
+
 TEST(AsyncSocket, PreReceivedDataOnly) {
   TestServer server;
 
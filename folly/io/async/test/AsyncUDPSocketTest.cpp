@@ -14,7 +14,11 @@
  * limitations under the License.
  */
 
+#include <chrono>
+#include <functional>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <folly/Conv.h>
 #include <folly/SocketAddress.h>
@@ -297,4 +301,225 @@ class TestAsyncUDPSocket : public AsyncUDPSocket {
   explicit TestAsyncUDPSocket(EventBase* evb) : AsyncUDPSocket(evb) {}
 
   MOCK_METHOD3(sendmsg, ssize_t(int, const struct msghdr*, int));
+  MOCK_METHOD4(sendmmsg, int(int, struct mmsghdr*, unsigned int, int));
 };
+
+namespace {
+
+class BatchReadCallback : public AsyncUDPSocket::ReadCallback {
+ public:
+  explicit BatchReadCallback(size_t bufSize = sizeof(buf_))
+      : bufSize_(bufSize) {}
+
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    *buf = buf_;
+    *len = bufSize_;
+  }
+
+  void onDataAvailable(const folly::SocketAddress& /* client */,
+                       size_t len,
+                       bool truncated) noexcept override {
+    datagrams.emplace_back(buf_, len);
+    truncatedCount += truncated ? 1 : 0;
+  }
+
+  void onReadError(const folly::AsyncSocketException& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  void onReadClosed() noexcept override {}
+
+  std::vector<std::string> datagrams;
+  size_t truncatedCount{0};
+
+ private:
+  size_t bufSize_;
+  char buf_[4096];
+};
+
+std::unique_ptr<AsyncUDPSocket> bindLoopback(EventBase* evb) {
+  auto socket = std::make_unique<AsyncUDPSocket>(evb);
+  socket->bind(folly::SocketAddress("127.0.0.1", 0));
+  return socket;
+}
+
+void loopUntil(EventBase& evb, const std::function<bool()>& done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!done() && std::chrono::steady_clock::now() < deadline) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+  }
+}
+
+} // namespace
+
+TEST(AsyncUDPSocketTest, WritemAndBatchedRead) {
+  EventBase evb;
+  auto server = bindLoopback(&evb);
+  auto client = bindLoopback(&evb);
+
+  BatchReadCallback cb;
+  server->setNumReadsPerEvent(8);
+  server->resumeRead(&cb);
+
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (int i = 0; i < 20; ++i) {
+    auto buf = IOBuf::copyBuffer("datagram ");
+    // chains are sent as a single datagram
+    buf->prependChain(IOBuf::copyBuffer(folly::to<std::string>(i)));
+    bufs.push_back(std::move(buf));
+  }
+  auto addr = server->address();
+  EXPECT_EQ(
+      20, client->writem(folly::range(&addr, &addr + 1), bufs.data(), 20));
+
+  loopUntil(evb, [&] { return cb.datagrams.size() == 20; });
+  ASSERT_EQ(20, cb.datagrams.size());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ("datagram " + folly::to<std::string>(i), cb.datagrams[i]);
+  }
+  server->pauseRead();
+}
+
+TEST(AsyncUDPSocketTest, BatchedReadTruncation) {
+  EventBase evb;
+  auto server = bindLoopback(&evb);
+  auto client = bindLoopback(&evb);
+
+  // datagrams are truncated both to the batch buffer size and to the
+  // callback's buffer
+  BatchReadCallback cb(8);
+  server->setNumReadsPerEvent(4, 16);
+  server->resumeRead(&cb);
+
+  auto addr = server->address();
+  std::unique_ptr<IOBuf> bufs[] = {
+      IOBuf::copyBuffer("short"),
+      IOBuf::copyBuffer("twelve bytes"),
+      IOBuf::copyBuffer("more than sixteen bytes"),
+  };
+  EXPECT_EQ(3, client->writem(folly::range(&addr, &addr + 1), bufs, 3));
+
+  loopUntil(evb, [&] { return cb.datagrams.size() == 3; });
+  EXPECT_EQ(
+      (std::vector<std::string>{"short", "twelve b", "more tha"}),
+      cb.datagrams);
+  EXPECT_EQ(2, cb.truncatedCount);
+  server->pauseRead();
+}
+
+TEST(AsyncUDPSocketTest, EmptyDatagram) {
+  // Batched and single reads both deliver empty datagrams
+  for (size_t numReads : {1, 4}) {
+    EventBase evb;
+    auto server = bindLoopback(&evb);
+    auto client = bindLoopback(&evb);
+
+    BatchReadCallback cb;
+    server->setNumReadsPerEvent(numReads);
+    server->resumeRead(&cb);
+
+    auto addr = server->address();
+    std::unique_ptr<IOBuf> bufs[] = {
+        IOBuf::copyBuffer("before"),
+        IOBuf::create(0),
+        IOBuf::copyBuffer("after"),
+    };
+    EXPECT_EQ(3, client->writem(folly::range(&addr, &addr + 1), bufs, 3));
+
+    loopUntil(evb, [&] { return cb.datagrams.size() == 3; });
+    EXPECT_EQ(
+        (std::vector<std::string>{"before", "", "after"}), cb.datagrams)
+        << numReads << " reads per event";
+    server->pauseRead();
+  }
+}
+
+TEST(AsyncUDPSocketTest, WritemSplitsBatches) {
+  EventBase evb;
+  TestAsyncUDPSocket socket(&evb);
+  socket.bind(folly::SocketAddress("127.0.0.1", 0));
+
+  std::vector<std::unique_ptr<IOBuf>> bufs;
+  for (int i = 0; i < 100; ++i) {
+    bufs.push_back(IOBuf::copyBuffer("x"));
+  }
+  std::vector<folly::SocketAddress> addrs(100, socket.address());
+
+  InSequence s;
+  EXPECT_CALL(socket, sendmmsg(_, _, 64, _)).WillOnce(Return(64));
+  // partial send stops the batch
+  EXPECT_CALL(socket, sendmmsg(_, _, 36, _)).WillOnce(Return(10));
+  EXPECT_EQ(74, socket.writem(folly::range(addrs), bufs.data(), 100));
+
+  EXPECT_CALL(socket, sendmmsg(_, _, 64, _)).WillOnce(Return(-1));
+  EXPECT_EQ(-1, socket.writem(folly::range(addrs), bufs.data(), 100));
+}
+
+TEST(AsyncUDPSocketTest, GSO) {
+  EventBase evb;
+  auto server = bindLoopback(&evb);
+  auto client = bindLoopback(&evb);
+  if (!client->setGSO(0)) {
+    // not supported by the kernel
+    return;
+  }
+
+  BatchReadCallback cb;
+  server->resumeRead(&cb);
+
+  auto addr = server->address();
+  auto buf = IOBuf::create(2500);
+  memset(buf->writableData(), 'a', 1000);
+  memset(buf->writableData() + 1000, 'b', 1000);
+  memset(buf->writableData() + 2000, 'c', 500);
+  buf->append(2500);
+  EXPECT_EQ(2500, client->writeGSO(addr, buf, 1000));
+
+  std::unique_ptr<IOBuf> bufs[] = {IOBuf::copyBuffer("abcdef")};
+  int gso[] = {2};
+  EXPECT_EQ(
+      1, client->writemGSO(folly::range(&addr, &addr + 1), bufs, 1, gso));
+
+  loopUntil(evb, [&] { return cb.datagrams.size() == 6; });
+  EXPECT_EQ(
+      (std::vector<std::string>{std::string(1000, 'a'),
+                                std::string(1000, 'b'),
+                                std::string(500, 'c'),
+                                "ab",
+                                "cd",
+                                "ef"}),
+      cb.datagrams);
+  server->pauseRead();
+}
+
+TEST(AsyncUDPSocketTest, GRO) {
+  EventBase evb;
+  auto server = bindLoopback(&evb);
+  auto client = bindLoopback(&evb);
+  if (!client->setGSO(0) || !server->setGRO(true)) {
+    // not supported by the kernel
+    return;
+  }
+  EXPECT_TRUE(server->getGRO());
+
+  BatchReadCallback cb;
+  server->setNumReadsPerEvent(4, 65536);
+  server->resumeRead(&cb);
+
+  auto addr = server->address();
+  auto buf = IOBuf::create(3000);
+  for (int i = 0; i < 3; ++i) {
+    memset(buf->writableData() + i * 1000, 'x' + i, 1000);
+  }
+  buf->append(3000);
+  EXPECT_EQ(3000, client->writeGSO(addr, buf, 1000));
+
+  // whether or not the kernel coalesced them, they're delivered one by one
+  loopUntil(evb, [&] { return cb.datagrams.size() == 3; });
+  EXPECT_EQ(
+      (std::vector<std::string>{std::string(1000, 'x'),
+                                std::string(1000, 'y'),
+                                std::string(1000, 'z')}),
+      cb.datagrams);
+  server->pauseRead();
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/AtomicNotificationQueue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(AtomicNotificationQueue, Fifo) {
+  AtomicNotificationQueue queue;
+  queue.setMaxReadAtOnce(0);
+  std::vector<int> ran;
+  for (int i = 0; i < 5; ++i) {
+    queue.putMessage([&, i] { ran.push_back(i); });
+  }
+  std::vector<Func> batch;
+  for (int i = 5; i < 10; ++i) {
+    batch.emplace_back([&, i] { ran.push_back(i); });
+  }
+  queue.putMessages(batch.begin(), batch.end());
+  EXPECT_EQ(10, queue.size());
+  EXPECT_TRUE(queue.hasPending());
+  EXPECT_FALSE(queue.arm());
+
+  EXPECT_TRUE(queue.consume());
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), ran);
+  EXPECT_EQ(0, queue.size());
+  EXPECT_FALSE(queue.consume());
+}
+
+TEST(AtomicNotificationQueue, MaxReadAtOnce) {
+  AtomicNotificationQueue queue;
+  queue.setMaxReadAtOnce(3);
+  int ran = 0;
+  for (int i = 0; i < 5; ++i) {
+    queue.putMessage([&] { ++ran; });
+  }
+  EXPECT_TRUE(queue.consume());
+  EXPECT_EQ(3, ran);
+  // The rest is pending, so the loop must not block
+  EXPECT_FALSE(queue.arm());
+  EXPECT_TRUE(queue.consume());
+  EXPECT_EQ(5, ran);
+  EXPECT_TRUE(queue.arm());
+}
+
+TEST(AtomicNotificationQueue, RequestContext) {
+  AtomicNotificationQueue queue;
+  std::shared_ptr<RequestContext> seen;
+  auto ctx = std::make_shared<RequestContext>();
+  {
+    RequestContextScopeGuard g(ctx);
+    queue.putMessage([&] { seen = RequestContext::saveContext(); });
+  }
+  queue.consume();
+  EXPECT_EQ(ctx, seen);
+}
+
+TEST(AtomicNotificationQueue, Draining) {
+  AtomicNotificationQueue queue;
+  bool threw = false;
+  queue.putMessage([&] {
+    try {
+      queue.putMessage([] {});
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+  });
+  size_t numConsumed = 0;
+  EXPECT_TRUE(queue.consumeUntilDrained(&numConsumed));
+  EXPECT_EQ(1, numConsumed);
+  EXPECT_TRUE(threw);
+}
+
+TEST(AtomicNotificationQueue, DestroyedUnrun) {
+  auto counter = std::make_shared<int>();
+  {
+    AtomicNotificationQueue queue;
+    queue.putMessage([counter] {});
+    EXPECT_EQ(2, counter.use_count());
+  }
+  EXPECT_EQ(1, counter.use_count());
+}
+
+TEST(AtomicNotificationQueue, WakesSleepingLoop) {
+  ScopedEventBaseThread thread;
+  auto evb = thread.getEventBase();
+  evb->waitUntilRunning();
+  for (int i = 0; i < 100; ++i) {
+    Baton<> done;
+    // Give the loop time to go to sleep every so often
+    if (i % 10 == 0) {
+      /* sleep override */ std::this_thread::sleep_for(
+          std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(evb->runInEventBaseThread([&] { done.post(); }));
+    done.wait();
+  }
+}
+
+TEST(AtomicNotificationQueue, ManyProducers) {
+  const int kThreads = 4;
+  const int kPerThread = 10000;
+  ScopedEventBaseThread thread;
+  auto evb = thread.getEventBase();
+  std::vector<int> last(kThreads, -1);
+  std::atomic<int> ran{0};
+  bool ordered = true;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; ++t) {
+    producers.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        auto fn = [&, t, i] {
+          // Functions from one thread run in order
+          ordered = ordered && last[t] == i - 1;
+          last[t] = i;
+          ++ran;
+        };
+        if (i % 2) {
+          evb->runInEventBaseThread(std::move(fn));
+        } else {
+          std::vector<Func> fns;
+          fns.emplace_back(std::move(fn));
+          evb->runInEventBaseThread(std::move(fns));
+        }
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  evb->runInEventBaseThreadAndWait([] {});
+  EXPECT_EQ(kThreads * kPerThread, ran.load());
+  EXPECT_TRUE(ordered);
+}
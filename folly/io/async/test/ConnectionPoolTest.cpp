@@ -0,0 +1,287 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ConnectionPool.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/io/Cursor.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+// Writes back what it reads, in the EventBase of the clients
+class EchoServer : public AsyncServerSocket::AcceptCallback {
+ public:
+  explicit EchoServer(EventBase* evb)
+      : socket_(AsyncServerSocket::newSocket(evb)) {
+    socket_->bind(0);
+    socket_->listen(16);
+    socket_->addAcceptCallback(this, evb);
+    socket_->startAccepting();
+  }
+
+  ~EchoServer() override {
+    socket_->stopAccepting();
+  }
+
+  SocketAddress getAddress() const {
+    SocketAddress address;
+    socket_->getAddress(&address);
+    return SocketAddress("127.0.0.1", address.getPort());
+  }
+
+  void connectionAccepted(
+      int fd,
+      const SocketAddress& /* clientAddr */) noexcept override {
+    ++accepted;
+    connections_.emplace_back(new Connection(socket_->getEventBase(), fd));
+  }
+
+  void acceptError(const std::exception& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  // Closes the connections accepted
+  void closeConnections() {
+    connections_.clear();
+  }
+
+  size_t accepted{0};
+
+ private:
+  class Connection : public AsyncSocket::ReadCallback {
+   public:
+    Connection(EventBase* evb, int fd) : socket_(new AsyncSocket(evb, fd)) {
+      socket_->setReadCB(this);
+    }
+
+    ~Connection() override {
+      socket_->setReadCB(nullptr);
+    }
+
+    void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+      *bufReturn = buf_;
+      *lenReturn = sizeof(buf_);
+    }
+
+    void readDataAvailable(size_t len) noexcept override {
+      socket_->write(nullptr, buf_, len);
+    }
+
+    void readEOF() noexcept override {}
+
+    void readErr(const AsyncSocketException&) noexcept override {}
+
+   private:
+    AsyncSocket::UniquePtr socket_;
+    char buf_[4096];
+  };
+
+  std::shared_ptr<AsyncServerSocket> socket_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+};
+
+// Responses end with a newline
+std::unique_ptr<IOBuf> lineFramer(IOBufQueue& readBuf) {
+  if (readBuf.empty()) {
+    return nullptr;
+  }
+  io::Cursor cursor(readBuf.front());
+  size_t len = 0;
+  while (!cursor.isAtEnd()) {
+    ++len;
+    if (cursor.read<char>() == '\n') {
+      return readBuf.split(len);
+    }
+  }
+  return nullptr;
+}
+
+class Collector : public ConnectionPool::Callback {
+ public:
+  void responseReceived(std::unique_ptr<IOBuf> response) noexcept override {
+    responses.push_back(response->moveToFbString().toStdString());
+  }
+
+  void requestError(const AsyncSocketException& ex) noexcept override {
+    errors.push_back(ex.getType());
+  }
+
+  std::vector<std::string> responses;
+  std::vector<AsyncSocketException::AsyncSocketExceptionType> errors;
+};
+
+class ConnectionPoolTest : public ::testing::Test {
+ protected:
+  void send(ConnectionPool& pool, const SocketAddress& address, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      pool.send(
+          address, IOBuf::copyBuffer(to<std::string>(i, "\n")), &collector_);
+    }
+  }
+
+  void expectResponses(size_t n) {
+    ASSERT_EQ(n, collector_.responses.size());
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(to<std::string>(i, "\n"), collector_.responses[i]);
+    }
+    EXPECT_TRUE(collector_.errors.empty());
+  }
+
+  EventBase evb_;
+  EchoServer server_{&evb_};
+  Collector collector_;
+};
+
+} // namespace
+
+TEST_F(ConnectionPoolTest, Pipelining) {
+  ConnectionPool::Options options;
+  options.maxConnections = 1;
+  options.maxPipelineDepth = 100;
+  ConnectionPool pool(&evb_, lineFramer, options);
+
+  send(pool, server_.getAddress(), 50);
+  EXPECT_EQ(1, pool.getNumConnections());
+  EXPECT_EQ(0, pool.getNumIdleConnections());
+  evb_.loopOnce();
+  while (collector_.responses.size() < 50) {
+    evb_.loopOnce();
+  }
+  expectResponses(50);
+  EXPECT_EQ(1, server_.accepted);
+  EXPECT_EQ(1, pool.getNumIdleConnections());
+
+  // Reused
+  send(pool, server_.getAddress(), 1);
+  while (collector_.responses.size() < 51) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(1, server_.accepted);
+}
+
+TEST_F(ConnectionPoolTest, WaitForConnections) {
+  ConnectionPool::Options options;
+  options.maxConnections = 2;
+  options.maxPipelineDepth = 3;
+  ConnectionPool pool(&evb_, lineFramer, options);
+
+  // In order, since the first connection gets the first three requests
+  send(pool, server_.getAddress(), 6);
+  EXPECT_EQ(2, pool.getNumConnections());
+  EXPECT_EQ(0, pool.getNumWaitingRequests());
+
+  pool.send(server_.getAddress(), IOBuf::copyBuffer("6\n"), &collector_);
+  EXPECT_EQ(1, pool.getNumWaitingRequests());
+  while (collector_.responses.size() < 7) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(0, pool.getNumWaitingRequests());
+  EXPECT_EQ(2, server_.accepted);
+  EXPECT_EQ(7, collector_.responses.size());
+  EXPECT_TRUE(collector_.errors.empty());
+}
+
+TEST_F(ConnectionPoolTest, IdleTimeout) {
+  ConnectionPool::Options options;
+  options.idleTimeout = std::chrono::milliseconds(10);
+  ConnectionPool pool(&evb_, lineFramer, options);
+
+  send(pool, server_.getAddress(), 1);
+  while (collector_.responses.size() < 1) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(1, pool.getNumConnections());
+  evb_.runAfterDelay([] {}, 50);
+  evb_.loopOnce();
+  while (pool.getNumConnections() > 0) {
+    evb_.loopOnce();
+  }
+  expectResponses(1);
+}
+
+TEST_F(ConnectionPoolTest, ConnectError) {
+  ConnectionPool::Options options;
+  options.maxConnections = 1;
+  options.maxPipelineDepth = 1;
+  ConnectionPool pool(&evb_, lineFramer, options);
+
+  // Nothing listens there once the server is gone
+  auto address = [] {
+    EventBase evb;
+    EchoServer server(&evb);
+    return server.getAddress();
+  }();
+  send(pool, address, 3);
+  EXPECT_EQ(2, pool.getNumWaitingRequests());
+  while (collector_.errors.size() < 3) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(0, pool.getNumConnections());
+  EXPECT_EQ(0, pool.getNumWaitingRequests());
+  EXPECT_TRUE(collector_.responses.empty());
+}
+
+TEST_F(ConnectionPoolTest, ServerClose) {
+  ConnectionPool pool(&evb_, lineFramer);
+
+  send(pool, server_.getAddress(), 1);
+  while (collector_.responses.size() < 1) {
+    evb_.loopOnce();
+  }
+  server_.closeConnections();
+  while (pool.getNumConnections() > 0) {
+    evb_.loopOnce();
+  }
+  expectResponses(1);
+
+  send(pool, server_.getAddress(), 1);
+  while (collector_.responses.size() < 2) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(2, server_.accepted);
+}
+
+TEST_F(ConnectionPoolTest, DestroyPool) {
+  {
+    ConnectionPool pool(&evb_, lineFramer);
+    send(pool, server_.getAddress(), 3);
+  }
+  ASSERT_EQ(3, collector_.errors.size());
+  for (auto type : collector_.errors) {
+    EXPECT_EQ(AsyncSocketException::NOT_OPEN, type);
+  }
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+}
+
+TEST_F(ConnectionPoolTest, BadResponse) {
+  ConnectionPool pool(&evb_, [](IOBufQueue&) -> std::unique_ptr<IOBuf> {
+    throw std::runtime_error("bad");
+  });
+  send(pool, server_.getAddress(), 2);
+  while (collector_.errors.size() < 2) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(AsyncSocketException::CORRUPTED_DATA, collector_.errors[0]);
+  EXPECT_EQ(0, pool.getNumConnections());
+}
@@ -91,3 +91,36 @@ TEST(EventBaseLocalTest, emplaceNoncopyable) {
   ints.emplace(evb, std::make_unique<int>(42));
   EXPECT_EQ(42, **ints.get(evb));
 }
+
+TEST(EventBaseLocalTest, slotReuse) {
+  folly::EventBase evb;
+  int dtorCnt = 0;
+
+  auto first = std::make_unique<folly::EventBaseLocal<Foo>>();
+  first->emplace(evb, 1, [&] { ++dtorCnt; });
+  // Schedules clearing first's value, and releases its slot
+  first.reset();
+
+  // May get the same slot, but must not see first's value, nor lose its own
+  // when first's cleanup runs.
+  folly::EventBaseLocal<Foo> second;
+  EXPECT_EQ(nullptr, second.get(evb));
+  second.emplace(evb, 2, [&] { ++dtorCnt; });
+  EXPECT_EQ(2, second.get(evb)->n);
+
+  evb.loopOnce();
+  EXPECT_EQ(2, second.get(evb)->n);
+  EXPECT_EQ(1, dtorCnt);
+}
+
+TEST(EventBaseLocalTest, manyLocals) {
+  folly::EventBase evb;
+  std::vector<std::unique_ptr<folly::EventBaseLocal<int>>> locals;
+  for (int i = 0; i < 100; ++i) {
+    locals.push_back(std::make_unique<folly::EventBaseLocal<int>>());
+    locals.back()->emplace(evb, i);
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, *locals[i]->get(evb));
+  }
+}
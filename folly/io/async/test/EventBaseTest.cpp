@@ -20,6 +20,8 @@
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventHandler.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/io/async/VirtualEventBase.h>
 #include <folly/io/async/test/SocketPair.h>
 #include <folly/io/async/test/Util.h>
 #include <folly/portability/Unistd.h>
@@ -1217,6 +1219,89 @@ TEST(EventBaseTest, RunInEventBaseThreadAndWait) {
   EXPECT_EQ(c, sum);
 }
 
+TEST(EventBaseTest, TaskStats) {
+  EventBase eb;
+  int unmeasured = 0;
+  // Added before anything is subscribed, so not measured
+  eb.runInEventBaseThread([&] { ++unmeasured; });
+  vector<ExecutorTaskStats> stats;
+  eb.subscribeToTaskStats(
+      [&](ExecutorTaskStats taskStats) { stats.push_back(taskStats); });
+  for (int i = 0; i < 3; ++i) {
+    eb.runInEventBaseThread(
+        [] { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+  }
+  eb.loop();
+
+  EXPECT_EQ(1, unmeasured);
+  ASSERT_EQ(3, stats.size());
+  for (size_t i = 0; i < stats.size(); ++i) {
+    // Behind the unmeasured function and those before it
+    EXPECT_EQ(i + 1, stats[i].queueDepth);
+    EXPECT_LE(std::chrono::milliseconds(2), stats[i].runTime);
+    EXPECT_FALSE(stats[i].expired);
+  }
+  EXPECT_LE(std::chrono::milliseconds(4), stats[2].waitTime);
+
+  // Subscribing from a task stats callback would deadlock
+  bool threw = false;
+  eb.subscribeToTaskStats([&](ExecutorTaskStats) {
+    try {
+      eb.subscribeToTaskStats([](ExecutorTaskStats) {});
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+  });
+  eb.runInEventBaseThread([] {});
+  eb.loop();
+  EXPECT_TRUE(threw);
+  EXPECT_EQ(4, stats.size());
+}
+
+TEST(EventBaseTest, BusyPoll) {
+  EventBase eb;
+  eb.setBusyPoll(std::chrono::milliseconds(10));
+  EXPECT_EQ(std::chrono::milliseconds(10), eb.getBusyPollStats().spinBudget);
+
+  // Functions that come in faster than the spin budget are found spinning
+  int ran = 0;
+  std::thread producer([&] {
+    for (int i = 0; i < 100; ++i) {
+      eb.runInEventBaseThread([&] { ++ran; });
+      usleep(100);
+    }
+    eb.terminateLoopSoon();
+  });
+  eb.loopForever();
+  producer.join();
+
+  EXPECT_EQ(100, ran);
+  auto stats = eb.getBusyPollStats();
+  EXPECT_LT(0, stats.spinHits);
+  EXPECT_LE(stats.spinHits, stats.spins);
+  EXPECT_LT(std::chrono::nanoseconds::zero(), stats.spinTime);
+  EXPECT_LT(std::chrono::nanoseconds::zero(), stats.spinBudget);
+
+  // When the loop usually stays idle longer than maxSpin, it stops spinning
+  eb.setBusyPoll(std::chrono::microseconds(50));
+  ran = 0;
+  producer = std::thread([&] {
+    for (int i = 0; i < 5; ++i) {
+      usleep(5000);
+      eb.runInEventBaseThread([&] { ++ran; });
+    }
+    eb.terminateLoopSoon();
+  });
+  eb.loopForever();
+  producer.join();
+
+  EXPECT_EQ(5, ran);
+  stats = eb.getBusyPollStats();
+  EXPECT_LE(5, stats.parks);
+  EXPECT_LE(std::chrono::milliseconds(20), stats.parkTime);
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), stats.spinBudget);
+}
+
 TEST(EventBaseTest, RunImmediatelyOrRunInEventBaseThreadAndWaitCross) {
   EventBase eb;
   thread th(&EventBase::loopForever, &eb);
@@ -1353,7 +1438,7 @@ TEST(EventBaseTest, messageAvailableException) {
   auto deadManWalking = [] {
     EventBase eventBase;
     std::thread t([&] {
-      // Call this from another thread to force use of NotificationQueue in
+      // Call this from another thread to force use of the notification queue in
       // runInEventBaseThread
       eventBase.runInEventBaseThread(
           []() { throw std::runtime_error("boom"); });
@@ -1630,6 +1715,31 @@ TEST(EventBaseTest, IdleTime) {
   ASSERT_EQ(21, tos->getTimeouts());
 }
 
+TEST(EventBaseTest, BusyRatio) {
+  EventBase eventBase;
+  eventBase.setLoadAvgMsec(milliseconds(10));
+  EXPECT_EQ(0.0, eventBase.getBusyRatio());
+
+  // 50 iterations that each spin for a millisecond
+  int remaining = 50;
+  std::function<void()> spin = [&] {
+    auto const until = std::chrono::steady_clock::now() + milliseconds(1);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+    if (--remaining > 0) {
+      eventBase.runInEventBaseThread(spin);
+    }
+  };
+  eventBase.runInEventBaseThread(spin);
+  eventBase.loop();
+  EXPECT_LT(0.5, eventBase.getBusyRatio());
+
+  // One iteration that sleeps for 50ms and then does nothing
+  eventBase.tryRunAfterDelay([] {}, 50);
+  eventBase.loop();
+  EXPECT_GT(0.5, eventBase.getBusyRatio());
+}
+
 /**
  * Test that thisLoop functionality works with terminateLoopSoon
  */
@@ -1882,6 +1992,65 @@ TEST(EventBaseTest, LoopKeepAliveAtomic) {
   }
 }
 
+namespace {
+class DestructionCallback : public EventBase::LoopCallback {
+ public:
+  explicit DestructionCallback(bool& destroyed) : destroyed_(destroyed) {}
+
+  void runLoopCallback() noexcept override {
+    destroyed_ = true;
+  }
+
+ private:
+  bool& destroyed_;
+};
+} // namespace
+
+TEST(EventBaseTest, VirtualEventBaseInlineDestruction) {
+  EventBase evb;
+  std::unique_ptr<VirtualEventBase> vevb;
+  bool destroyed = false;
+  DestructionCallback callback(destroyed);
+  bool ran = false;
+  evb.runInEventBaseThread([&] {
+    vevb = std::make_unique<VirtualEventBase>(evb);
+    {
+      auto keepAlive1 = vevb->getKeepAliveToken();
+      auto keepAlive2 = vevb->getKeepAliveToken();
+    }
+    vevb->runOnDestruction(&callback);
+    vevb->runInEventBaseThread([&] { ran = true; });
+    evb.runInEventBaseThread([&] {
+      // The task above has run and released its token: destroyed right away
+      EXPECT_TRUE(ran);
+      vevb.reset();
+      EXPECT_TRUE(destroyed);
+    });
+  });
+  evb.loop();
+  EXPECT_TRUE(destroyed);
+}
+
+TEST(EventBaseTest, VirtualEventBaseRemoteKeepAlive) {
+  ScopedEventBaseThread thread;
+  auto& evb = *thread.getEventBase();
+  std::unique_ptr<VirtualEventBase> vevb;
+  evb.runInEventBaseThreadAndWait(
+      [&] { vevb = std::make_unique<VirtualEventBase>(evb); });
+
+  // Acquired outside of the EventBase thread, released in it
+  auto keepAlive = vevb->getKeepAliveToken();
+  bool released = false;
+  evb.runInEventBaseThreadAndWait([&] {
+    // A token of the EventBase thread, released before the remote one
+    vevb->getKeepAliveToken().reset();
+    keepAlive.reset();
+    released = true;
+  });
+  EXPECT_TRUE(released);
+  vevb.reset();
+}
+
 TEST(EventBaseTest, DrivableExecutorTest) {
   folly::Promise<bool> p;
   auto f = p.getFuture();
@@ -1896,7 +2065,6 @@ TEST(EventBaseTest, DrivableExecutorTest) {
   });
 
   // Ensure drive does not busy wait
-  base.drive(); // TODO: fix notification queue init() extra wakeup
   base.drive();
   EXPECT_TRUE(finished);
 
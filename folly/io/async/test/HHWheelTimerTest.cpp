@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <thread>
+
+#include <folly/Random.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <folly/io/async/test/UndelayedDestruction.h>
@@ -454,3 +457,150 @@ TEST_F(HHWheelTimerTest, GetTimeRemaining) {
   ASSERT_EQ(t.count(), 0);
   T_CHECK_TIMEOUT(start, end, milliseconds(10));
 }
+
+TEST_F(HHWheelTimerTest, CancellationToken) {
+  StackWheelTimer t(&eventBase, milliseconds(1));
+  CancellationSource source;
+  TestTimeout t1;
+  TestTimeout t2;
+  t.scheduleTimeout(&t1, std::chrono::minutes(1), source.getToken());
+  t.scheduleTimeout(&t2, milliseconds(1), source.getToken());
+  ASSERT_EQ(t.count(), 2);
+
+  // t2 fires first; the token no longer applies to it afterwards.
+  t2.fn = [&] { source.requestCancellation(); };
+  eventBase.loop();
+
+  ASSERT_EQ(t.count(), 0);
+  ASSERT_EQ(t1.timestamps.size(), 0);
+  ASSERT_EQ(t1.canceledTimestamps.size(), 1);
+  ASSERT_EQ(t2.timestamps.size(), 1);
+  ASSERT_EQ(t2.canceledTimestamps.size(), 0);
+}
+
+TEST_F(HHWheelTimerTest, CancellationTokenAlreadyCancelled) {
+  StackWheelTimer t(&eventBase, milliseconds(1));
+  CancellationSource source;
+  source.requestCancellation();
+  TestTimeout t1;
+  t.scheduleTimeout(&t1, milliseconds(1), source.getToken());
+  ASSERT_FALSE(t1.isScheduled());
+  ASSERT_EQ(t1.canceledTimestamps.size(), 1);
+  ASSERT_EQ(t.count(), 0);
+}
+
+TEST_F(HHWheelTimerTest, CancellationTokenFromOtherThread) {
+  StackWheelTimer t(&eventBase, milliseconds(1));
+  CancellationSource source;
+  TestTimeout t1;
+  t.scheduleTimeout(&t1, std::chrono::minutes(1), source.getToken());
+
+  std::thread canceller([&] { source.requestCancellation(); });
+  eventBase.loop();
+  canceller.join();
+
+  ASSERT_EQ(t1.timestamps.size(), 0);
+  ASSERT_EQ(t1.canceledTimestamps.size(), 1);
+  ASSERT_EQ(t.count(), 0);
+}
+
+TEST_F(HHWheelTimerTest, CancellationTokenAfterReschedule) {
+  StackWheelTimer t(&eventBase, milliseconds(1));
+  CancellationSource source;
+  TestTimeout t1;
+  t.scheduleTimeout(&t1, std::chrono::minutes(1), source.getToken());
+  t.scheduleTimeout(&t1, milliseconds(1));
+  source.requestCancellation();
+  eventBase.loop();
+
+  ASSERT_EQ(t1.timestamps.size(), 1);
+  ASSERT_EQ(t1.canceledTimestamps.size(), 0);
+}
+
+TEST_F(HHWheelTimerTest, ScheduleTimeouts) {
+  StackWheelTimer t(&eventBase, milliseconds(1));
+  std::vector<TestTimeout> timeouts(100);
+  std::vector<HHWheelTimer::Callback*> callbacks;
+  for (auto& timeout : timeouts) {
+    callbacks.push_back(&timeout);
+  }
+  // Already scheduled callbacks are rescheduled
+  t.scheduleTimeout(&timeouts[0], milliseconds(1000));
+
+  TimePoint start;
+  t.scheduleTimeouts(callbacks.begin(), callbacks.end(), milliseconds(5));
+  ASSERT_EQ(t.count(), 100);
+  eventBase.loop();
+  TimePoint end;
+
+  ASSERT_EQ(t.count(), 0);
+  for (auto& timeout : timeouts) {
+    ASSERT_EQ(timeout.timestamps.size(), 1);
+    ASSERT_LE(
+        milliseconds(5), timeout.timestamps[0].getTime() - start.getTime());
+  }
+  T_CHECK_TIMEOUT(start, end, milliseconds(5));
+}
+
+namespace {
+class HighResTimeout : public HHWheelTimerHighRes::Callback {
+ public:
+  void timeoutExpired() noexcept override {
+    fired = std::chrono::steady_clock::now();
+  }
+
+  std::chrono::steady_clock::time_point fired;
+};
+} // namespace
+
+TEST_F(HHWheelTimerTest, HighRes) {
+  using std::chrono::microseconds;
+  auto t = HHWheelTimerHighRes::newTimer(&eventBase, microseconds(100));
+  ASSERT_EQ(microseconds(100), t->getTickInterval());
+
+  HighResTimeout t1;
+  HighResTimeout t2;
+  auto start = std::chrono::steady_clock::now();
+  t->scheduleTimeout(&t1, microseconds(500));
+  t->scheduleTimeout(&t2, microseconds(1500));
+  ASSERT_LE(t1.getTimeRemaining(), microseconds(500));
+  eventBase.loop();
+
+  ASSERT_EQ(t->count(), 0);
+  EXPECT_LE(microseconds(500), t1.fired - start);
+  EXPECT_LE(microseconds(1500), t2.fired - start);
+  EXPECT_LT(t1.fired, t2.fired);
+}
+
+/*
+ * Timers in bucket 1 are moved to bucket 0 ahead of time, a slice at a
+ * time: none may fire early, or get lost, including cancelled neighbours.
+ */
+TEST_F(HHWheelTimerTest, CascadeAhead) {
+  using std::chrono::microseconds;
+  // 256 ticks are 25.6ms
+  auto t = HHWheelTimerHighRes::newTimer(&eventBase, microseconds(100));
+
+  constexpr size_t kNumTimeouts = 3000;
+  std::vector<HighResTimeout> timeouts(kNumTimeouts);
+  std::vector<microseconds> delays;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kNumTimeouts; ++i) {
+    delays.emplace_back(Random::rand32(30000, 200000));
+    t->scheduleTimeout(&timeouts[i], delays.back());
+  }
+  for (size_t i = 0; i < kNumTimeouts; i += 3) {
+    timeouts[i].cancelTimeout();
+  }
+  ASSERT_EQ(t->count(), kNumTimeouts - kNumTimeouts / 3);
+  eventBase.loop();
+
+  ASSERT_EQ(t->count(), 0);
+  for (size_t i = 0; i < kNumTimeouts; ++i) {
+    if (i % 3 == 0) {
+      EXPECT_EQ(std::chrono::steady_clock::time_point(), timeouts[i].fired);
+    } else {
+      EXPECT_LE(delays[i], timeouts[i].fired - start) << i;
+    }
+  }
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/async/IoUringBackend.h>
+
+#include <sys/eventfd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncSignalHandler.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Unistd.h>
+
+using namespace folly;
+
+namespace {
+
+std::unique_ptr<EventBase> makeEventBase() {
+  return std::make_unique<EventBase>(std::make_unique<IoUringBackend>());
+}
+
+class EventFdHandler : public EventHandler {
+ public:
+  EventFdHandler(EventBase* evb, int fd, size_t stopAfter)
+      : EventHandler(evb, fd), fd_(fd), stopAfter_(stopAfter) {}
+
+  void handlerReady(uint16_t events) noexcept override {
+    EXPECT_TRUE(events & EventHandler::READ);
+    uint64_t val;
+    EXPECT_EQ(sizeof(val), ::read(fd_, &val, sizeof(val)));
+    total += val;
+    if (++count == stopAfter_) {
+      unregisterHandler();
+    }
+  }
+
+  size_t count{0};
+  uint64_t total{0};
+
+ private:
+  int fd_;
+  size_t stopAfter_;
+};
+
+void writeEventFd(int fd, uint64_t val) {
+  EXPECT_EQ(sizeof(val), ::write(fd, &val, sizeof(val)));
+}
+
+} // namespace
+
+TEST(IoUringBackend, persistentHandler) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  int fd = ::eventfd(0, EFD_NONBLOCK);
+  ASSERT_NE(-1, fd);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+
+  EventFdHandler handler(evb.get(), fd, 3);
+  handler.registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  EXPECT_TRUE(handler.isHandlerRegistered());
+  for (uint64_t i = 1; i <= 3; ++i) {
+    evb->tryRunAfterDelay([fd, i] { writeEventFd(fd, i); }, i * 10);
+  }
+  evb->loop();
+  EXPECT_EQ(3, handler.count);
+  EXPECT_EQ(6, handler.total);
+  EXPECT_FALSE(handler.isHandlerRegistered());
+}
+
+TEST(IoUringBackend, oneShotHandler) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  int fd = ::eventfd(0, EFD_NONBLOCK);
+  ASSERT_NE(-1, fd);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+
+  EventFdHandler handler(evb.get(), fd, 100);
+  handler.registerHandler(EventHandler::READ);
+  writeEventFd(fd, 5);
+  evb->loop();
+  EXPECT_EQ(1, handler.count);
+  EXPECT_EQ(5, handler.total);
+  EXPECT_FALSE(handler.isHandlerRegistered());
+}
+
+TEST(IoUringBackend, unregisterBeforeReady) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  int fd = ::eventfd(0, EFD_NONBLOCK);
+  ASSERT_NE(-1, fd);
+  SCOPE_EXIT {
+    ::close(fd);
+  };
+
+  EventFdHandler handler(evb.get(), fd, 100);
+  handler.registerHandler(EventHandler::READ | EventHandler::PERSIST);
+  evb->loopOnce(EVLOOP_NONBLOCK);
+  handler.unregisterHandler();
+  writeEventFd(fd, 1);
+  // nothing left to wait for
+  evb->loop();
+  EXPECT_EQ(0, handler.count);
+}
+
+TEST(IoUringBackend, timeouts) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  std::vector<int> fired;
+  evb->tryRunAfterDelay([&] { fired.push_back(30); }, 30);
+  evb->tryRunAfterDelay([&] { fired.push_back(10); }, 10);
+  evb->tryRunAfterDelay([&] { fired.push_back(20); }, 20);
+  auto canceled = AsyncTimeout::make(*evb, [&]() noexcept {
+    fired.push_back(-1);
+  });
+  canceled->scheduleTimeout(15);
+  EXPECT_TRUE(canceled->isScheduled());
+  evb->tryRunAfterDelay([&] { canceled->cancelTimeout(); }, 5);
+
+  auto start = std::chrono::steady_clock::now();
+  evb->loop();
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(30));
+  EXPECT_EQ((std::vector<int>{10, 20, 30}), fired);
+  EXPECT_FALSE(canceled->isScheduled());
+}
+
+TEST(IoUringBackend, wheelTimer) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  int fired = 0;
+  for (int i = 0; i < 10; ++i) {
+    evb->timer().scheduleTimeoutFn(
+        [&] { ++fired; }, std::chrono::milliseconds(i * 5));
+  }
+  evb->loop();
+  EXPECT_EQ(10, fired);
+}
+
+TEST(IoUringBackend, runInEventBaseThread) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  std::thread loopThread([&] { evb->loopForever(); });
+  evb->waitUntilRunning();
+
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 100; ++i) {
+    evb->runInEventBaseThread([&] { ++ran; });
+  }
+  evb->runInEventBaseThreadAndWait([] {});
+  EXPECT_EQ(100, ran.load());
+  evb->terminateLoopSoon();
+  loopThread.join();
+}
+
+namespace {
+
+class ReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf_;
+    *lenReturn = sizeof(buf_);
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    data.append(buf_, len);
+  }
+
+  void readEOF() noexcept override {
+    eof = true;
+  }
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  std::string data;
+  bool eof{false};
+
+ private:
+  char buf_[64];
+};
+
+class AcceptCallback : public AsyncServerSocket::AcceptCallback {
+ public:
+  explicit AcceptCallback(EventBase* evb) : evb_(evb) {}
+
+  void connectionAccepted(
+      int fd,
+      const SocketAddress& /* clientAddr */) noexcept override {
+    socket = AsyncSocket::newSocket(evb_, fd);
+    socket->setReadCB(&readCallback);
+  }
+
+  void acceptError(const std::exception& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  std::shared_ptr<AsyncSocket> socket;
+  ReadCallback readCallback;
+
+ private:
+  EventBase* evb_;
+};
+
+} // namespace
+
+TEST(IoUringBackend, sockets) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  auto evb = makeEventBase();
+  auto server = AsyncServerSocket::newSocket(evb.get());
+  server->bind(0);
+  server->listen(16);
+  AcceptCallback acceptCallback(evb.get());
+  server->addAcceptCallback(&acceptCallback, evb.get());
+  server->startAccepting();
+
+  SocketAddress addr;
+  server->getAddress(&addr);
+  auto client =
+      AsyncSocket::newSocket(evb.get(), "127.0.0.1", addr.getPort());
+  const std::string message = "hello over io_uring";
+  client->write(nullptr, message.data(), message.size());
+  client->close();
+
+  evb->loopOnce();
+  while (!acceptCallback.readCallback.eof) {
+    evb->loopOnce();
+  }
+  EXPECT_EQ(message, acceptCallback.readCallback.data);
+  server->stopAccepting();
+}
+
+TEST(IoUringBackend, signalsUnsupported) {
+  if (!IoUringBackend::isAvailable()) {
+    return;
+  }
+  class Handler : public AsyncSignalHandler {
+   public:
+    using AsyncSignalHandler::AsyncSignalHandler;
+    void signalReceived(int) noexcept override {}
+  };
+
+  auto evb = makeEventBase();
+  Handler handler(evb.get());
+  EXPECT_THROW(handler.registerSignalHandler(SIGUSR1), std::runtime_error);
+}
@@ -33,6 +33,18 @@ struct MockAsyncUDPSocket : public AsyncUDPSocket {
   MOCK_METHOD3(
    writev,
    ssize_t(const SocketAddress&, const struct iovec*, size_t));
+  MOCK_METHOD3(
+   writeGSO,
+   ssize_t(const SocketAddress&, const std::unique_ptr<IOBuf>&, int));
+  MOCK_METHOD3(
+   writem,
+   int(Range<SocketAddress const*>, const std::unique_ptr<IOBuf>*, size_t));
+  MOCK_METHOD4(
+   writemGSO,
+   int(Range<SocketAddress const*>,
+       const std::unique_ptr<IOBuf>*,
+       size_t,
+       const int*));
   MOCK_METHOD1(resumeRead, void(ReadCallback*));
   MOCK_METHOD0(pauseRead, void());
   MOCK_METHOD0(close, void());
@@ -0,0 +1,743 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * End-to-end benchmark of AsyncSocket, AsyncSSLSocket and AsyncUDPSocket
+ * over loopback, with the clients and the server in this process, each on
+ * their own IO threads.
+ *
+ * Scenarios (--scenario):
+ *  - echo: each connection writes --message_size bytes and waits for the
+ *    server to echo them back, with --pipeline messages in flight.
+ *  - rpc: requests of --message_size bytes behind a 4-byte length, which
+ *    the server parses before answering with --response_size bytes.
+ *  - bulk: the clients stream --message_size writes as fast as the server
+ *    reads them (TCP and SSL only).
+ *
+ * Reports requests/s, Gbps (of requests and responses together), latency
+ * percentiles and CPU time (of the whole process: clients and server) per
+ * request, or per MB for bulk.  For example:
+ *
+ *   network_benchmark --scenario=rpc --transport=ssl --connections=64 \
+ *       --server_threads=4 --client_threads=4 --message_size=1024
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Format.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/io/async/SSLContext.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_string(scenario, "echo", "echo, rpc or bulk");
+DEFINE_string(transport, "tcp", "tcp, ssl or udp");
+DEFINE_int32(connections, 16, "number of client connections (or sockets)");
+DEFINE_int32(server_threads, 2, "IO threads of the server");
+DEFINE_int32(client_threads, 2, "IO threads of the clients");
+DEFINE_int32(message_size, 64, "size of a request, or of a bulk write");
+DEFINE_int32(response_size, 64, "size of an rpc response");
+DEFINE_int32(pipeline, 1, "requests in flight per connection");
+DEFINE_int32(warmup_ms, 500, "time to run before measuring");
+DEFINE_int32(duration_ms, 5000, "time to measure");
+DEFINE_string(
+    cert,
+    "folly/io/async/test/certs/tests-cert.pem",
+    "certificate of the SSL server");
+DEFINE_string(
+    key,
+    "folly/io/async/test/certs/tests-key.pem",
+    "private key of the SSL server");
+
+using namespace folly;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Scenario { ECHO, RPC, BULK };
+enum class Transport { TCP, SSL, UDP };
+
+Scenario gScenario;
+Transport gTransport;
+
+// Set by the main thread; clients count what completes while measuring,
+// and stop sending once no longer running
+std::atomic<bool> gMeasuring{false};
+std::atomic<bool> gRunning{true};
+// Bytes read by the server while measuring, for bulk
+std::atomic<uint64_t> gServerBytes{0};
+
+constexpr size_t kRpcHeaderSize = sizeof(uint32_t);
+// UDP datagrams carry their send time, as they can be lost or reordered
+constexpr size_t kUdpTimestampSize = sizeof(int64_t);
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// What a client thread measured; only touched from its thread until the
+// run is over
+struct Stats {
+  std::vector<int64_t> latenciesNs;
+  uint64_t requests{0};
+  uint64_t bytes{0};
+  uint64_t lost{0};
+};
+
+size_t requestSize() {
+  return gScenario == Scenario::RPC ? kRpcHeaderSize + FLAGS_message_size
+                                    : size_t(FLAGS_message_size);
+}
+
+size_t responseSize() {
+  if (gScenario == Scenario::RPC) {
+    return (gTransport == Transport::UDP ? 0 : kRpcHeaderSize) +
+        FLAGS_response_size;
+  }
+  return size_t(FLAGS_message_size);
+}
+
+std::unique_ptr<IOBuf> makeBuffer(size_t size, uint32_t header) {
+  auto buf = IOBuf::create(size);
+  buf->append(size);
+  std::memset(buf->writableData(), 'x', size);
+  if (header != 0 && size >= kRpcHeaderSize) {
+    std::memcpy(buf->writableData(), &header, sizeof(header));
+  }
+  return buf;
+}
+
+// Server
+
+class ServerConnection : public AsyncSocket::ReadCallback,
+                         public AsyncSSLSocket::HandshakeCB {
+ public:
+  explicit ServerConnection(std::shared_ptr<AsyncSocket> sock)
+      : sock_(std::move(sock)),
+        response_(makeBuffer(
+            kRpcHeaderSize + FLAGS_response_size,
+            uint32_t(FLAGS_response_size))) {}
+
+  void start() {
+    sock_->setNoDelay(true);
+    if (gTransport == Transport::SSL) {
+      dynamic_cast<AsyncSSLSocket*>(sock_.get())->sslAccept(this);
+    } else {
+      sock_->setReadCB(this);
+    }
+  }
+
+  void handshakeSuc(AsyncSSLSocket*) noexcept override {
+    sock_->setReadCB(this);
+  }
+
+  void handshakeErr(AsyncSSLSocket*, const AsyncSocketException& ex) noexcept
+      override {
+    LOG(ERROR) << "Server handshake error: " << ex.what();
+    delete this;
+  }
+
+  void getReadBuffer(void** buf, size_t* len) override {
+    auto p = queue_.preallocate(4096, 65536);
+    *buf = p.first;
+    *len = p.second;
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    queue_.postallocate(len);
+    switch (gScenario) {
+      case Scenario::ECHO:
+        sock_->writeChain(nullptr, queue_.move());
+        break;
+      case Scenario::RPC:
+        respond();
+        break;
+      case Scenario::BULK:
+        if (gMeasuring.load(std::memory_order_relaxed)) {
+          gServerBytes.fetch_add(len, std::memory_order_relaxed);
+        }
+        queue_.clear();
+        break;
+    }
+  }
+
+  void readEOF() noexcept override {
+    delete this;
+  }
+
+  void readErr(const AsyncSocketException&) noexcept override {
+    delete this;
+  }
+
+ private:
+  // Answers every complete request in the queue
+  void respond() {
+    std::unique_ptr<IOBuf> out;
+    while (queue_.chainLength() >= kRpcHeaderSize) {
+      io::Cursor cursor(queue_.front());
+      auto size = kRpcHeaderSize + cursor.read<uint32_t>();
+      if (queue_.chainLength() < size) {
+        break;
+      }
+      queue_.trimStart(size);
+      if (out) {
+        out->prependChain(response_->clone());
+      } else {
+        out = response_->clone();
+      }
+    }
+    if (out) {
+      sock_->writeChain(nullptr, std::move(out));
+    }
+  }
+
+  std::shared_ptr<AsyncSocket> sock_;
+  IOBufQueue queue_{IOBufQueue::cacheChainLength()};
+  std::unique_ptr<IOBuf> response_;
+};
+
+class StreamServer : public AsyncServerSocket::AcceptCallback {
+ public:
+  StreamServer(
+      EventBase* evb,
+      const std::vector<EventBase*>& ioEvbs,
+      std::shared_ptr<SSLContext> ctx)
+      : ctx_(std::move(ctx)), socket_(new AsyncServerSocket(evb)) {
+    evb->runInEventBaseThreadAndWait([&] {
+      socket_->bind(SocketAddress("127.0.0.1", 0));
+      socket_->listen(1024);
+      // Accepted connections are spread over the IO threads
+      for (auto ioEvb : ioEvbs) {
+        socket_->addAcceptCallback(this, ioEvb);
+      }
+      socket_->startAccepting();
+    });
+  }
+
+  void stop() {
+    socket_->getEventBase()->runInEventBaseThreadAndWait(
+        [&] { socket_.reset(); });
+  }
+
+  SocketAddress address() const {
+    return socket_->getAddress();
+  }
+
+  void connectionAccepted(int fd, const SocketAddress&) noexcept override {
+    auto evb = EventBaseManager::get()->getExistingEventBase();
+    std::shared_ptr<AsyncSocket> sock;
+    if (gTransport == Transport::SSL) {
+      sock = AsyncSSLSocket::newSocket(ctx_, evb, fd);
+    } else {
+      sock = AsyncSocket::newSocket(evb, fd);
+    }
+    (new ServerConnection(std::move(sock)))->start();
+  }
+
+  void acceptError(const std::exception& ex) noexcept override {
+    LOG(ERROR) << "Accept error: " << ex.what();
+  }
+
+ private:
+  std::shared_ptr<SSLContext> ctx_;
+  AsyncServerSocket::UniquePtr socket_;
+};
+
+class UdpServer : public AsyncUDPSocket::ReadCallback {
+ public:
+  explicit UdpServer(EventBase* evb)
+      : evb_(evb),
+        response_(makeBuffer(
+            std::max<size_t>(FLAGS_response_size, kUdpTimestampSize),
+            0)),
+        buffer_(65536) {
+    evb_->runInEventBaseThreadAndWait([&] {
+      socket_ = std::make_unique<AsyncUDPSocket>(evb_);
+      socket_->bind(SocketAddress("127.0.0.1", 0));
+      socket_->resumeRead(this);
+    });
+  }
+
+  void stop() {
+    evb_->runInEventBaseThreadAndWait([&] { socket_.reset(); });
+  }
+
+  SocketAddress address() const {
+    return socket_->address();
+  }
+
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    *buf = buffer_.data();
+    *len = buffer_.size();
+  }
+
+  void onDataAvailable(const SocketAddress& client, size_t len, bool) noexcept
+      override {
+    if (gScenario == Scenario::RPC) {
+      // The response carries the timestamp of the request
+      std::memcpy(
+          response_->writableData(),
+          buffer_.data(),
+          std::min(len, kUdpTimestampSize));
+      socket_->write(client, response_);
+    } else {
+      socket_->write(client, IOBuf::wrapBuffer(buffer_.data(), len));
+    }
+  }
+
+  void onReadError(const AsyncSocketException& ex) noexcept override {
+    LOG(ERROR) << "UDP server read error: " << ex.what();
+  }
+
+  void onReadClosed() noexcept override {}
+
+ private:
+  EventBase* evb_;
+  std::unique_ptr<AsyncUDPSocket> socket_;
+  std::unique_ptr<IOBuf> response_;
+  std::vector<char> buffer_;
+};
+
+// Clients
+
+class StreamClient : public AsyncSocket::ConnectCallback,
+                     public AsyncSocket::ReadCallback,
+                     public AsyncSocket::WriteCallback,
+                     public EventBase::LoopCallback {
+ public:
+  StreamClient(
+      EventBase* evb,
+      std::shared_ptr<SSLContext> ctx,
+      const SocketAddress& server,
+      Stats* stats)
+      : stats_(stats),
+        request_(makeBuffer(requestSize(), uint32_t(FLAGS_message_size))),
+        responseSize_(responseSize()) {
+    if (gTransport == Transport::SSL) {
+      sock_ = AsyncSSLSocket::newSocket(ctx, evb);
+    } else {
+      sock_ = AsyncSocket::newSocket(evb);
+    }
+    sock_->connect(this, server);
+  }
+
+  void close() {
+    sock_->closeNow();
+  }
+
+  void connectSuccess() noexcept override {
+    sock_->setNoDelay(true);
+    sock_->setReadCB(this);
+    if (gScenario == Scenario::BULK) {
+      write();
+    } else {
+      for (int i = 0; i < FLAGS_pipeline; ++i) {
+        send();
+      }
+    }
+  }
+
+  void connectErr(const AsyncSocketException& ex) noexcept override {
+    LOG(ERROR) << "Connect error: " << ex.what();
+  }
+
+  void getReadBuffer(void** buf, size_t* len) override {
+    *buf = readBuffer_;
+    *len = sizeof(readBuffer_);
+  }
+
+  // Responses have a known size, so only their bytes are counted
+  void readDataAvailable(size_t len) noexcept override {
+    pendingBytes_ += len;
+    while (pendingBytes_ >= responseSize_ && !sendTimes_.empty()) {
+      pendingBytes_ -= responseSize_;
+      auto sent = sendTimes_.front();
+      sendTimes_.pop_front();
+      if (gMeasuring.load(std::memory_order_relaxed)) {
+        stats_->latenciesNs.push_back(nowNs() - sent);
+        ++stats_->requests;
+        stats_->bytes += requestSize() + responseSize_;
+      }
+      send();
+    }
+  }
+
+  void readEOF() noexcept override {}
+
+  void readErr(const AsyncSocketException&) noexcept override {}
+
+  void writeSuccess() noexcept override {
+    --writesInFlight_;
+    write();
+  }
+
+  void writeErr(size_t, const AsyncSocketException&) noexcept override {}
+
+  void runLoopCallback() noexcept override {
+    write();
+  }
+
+ private:
+  void send() {
+    if (!gRunning.load(std::memory_order_relaxed)) {
+      return;
+    }
+    sendTimes_.push_back(nowNs());
+    sock_->writeChain(nullptr, request_->clone());
+  }
+
+  // Keeps two writes in flight, so that the socket buffer stays full.
+  // writeSuccess() is called inline when a write completes right away, in
+  // which case the loop of the outer call goes on; for a while only, as the
+  // server may keep up and the other connections of the thread must run.
+  void write() {
+    if (writing_) {
+      return;
+    }
+    writing_ = true;
+    for (int i = 0; gRunning.load(std::memory_order_relaxed) &&
+         sock_->good() && writesInFlight_ < 2;
+         ++i) {
+      if (i == kMaxInlineWrites) {
+        sock_->getEventBase()->runInLoop(this);
+        break;
+      }
+      ++writesInFlight_;
+      sock_->writeChain(this, request_->clone());
+    }
+    writing_ = false;
+  }
+
+  static constexpr int kMaxInlineWrites = 64;
+
+
+  Stats* stats_;
+  std::shared_ptr<AsyncSocket> sock_;
+  std::unique_ptr<IOBuf> request_;
+  size_t responseSize_;
+  size_t pendingBytes_{0};
+  std::deque<int64_t> sendTimes_;
+  int writesInFlight_{0};
+  bool writing_{false};
+  char readBuffer_[65536];
+};
+
+class UdpClient : public AsyncUDPSocket::ReadCallback, public AsyncTimeout {
+ public:
+  static constexpr auto kLossTimeout = std::chrono::milliseconds(200);
+
+  UdpClient(EventBase* evb, const SocketAddress& server, Stats* stats)
+      : AsyncTimeout(evb),
+        server_(server),
+        stats_(stats),
+        socket_(new AsyncUDPSocket(evb)),
+        request_(makeBuffer(
+            std::max<size_t>(FLAGS_message_size, kUdpTimestampSize),
+            0)),
+        buffer_(65536) {
+    socket_->bind(SocketAddress("127.0.0.1", 0));
+    socket_->resumeRead(this);
+    refill();
+    scheduleTimeout(kLossTimeout);
+  }
+
+  void close() {
+    cancelTimeout();
+    socket_.reset();
+  }
+
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    *buf = buffer_.data();
+    *len = buffer_.size();
+  }
+
+  void onDataAvailable(const SocketAddress&, size_t len, bool) noexcept
+      override {
+    int64_t sent;
+    if (len < sizeof(sent)) {
+      return;
+    }
+    std::memcpy(&sent, buffer_.data(), sizeof(sent));
+    received_ = true;
+    --inFlight_;
+    if (gMeasuring.load(std::memory_order_relaxed)) {
+      stats_->latenciesNs.push_back(nowNs() - sent);
+      ++stats_->requests;
+      stats_->bytes += request_->length() + len;
+    }
+    refill();
+  }
+
+  void onReadError(const AsyncSocketException&) noexcept override {}
+
+  void onReadClosed() noexcept override {}
+
+  // Datagrams that got no answer in a while are counted as lost, and
+  // replaced
+  void timeoutExpired() noexcept override {
+    if (!received_ && inFlight_ > 0) {
+      if (gMeasuring.load(std::memory_order_relaxed)) {
+        stats_->lost += size_t(inFlight_);
+      }
+      inFlight_ = 0;
+      refill();
+    }
+    received_ = false;
+    scheduleTimeout(kLossTimeout);
+  }
+
+ private:
+  void refill() {
+    while (gRunning.load(std::memory_order_relaxed) &&
+           inFlight_ < FLAGS_pipeline) {
+      auto sent = nowNs();
+      std::memcpy(request_->writableData(), &sent, sizeof(sent));
+      socket_->write(server_, request_);
+      ++inFlight_;
+    }
+  }
+
+  SocketAddress server_;
+  Stats* stats_;
+  std::unique_ptr<AsyncUDPSocket> socket_;
+  std::unique_ptr<IOBuf> request_;
+  std::vector<char> buffer_;
+  int inFlight_{0};
+  bool received_{false};
+};
+
+constexpr std::chrono::milliseconds UdpClient::kLossTimeout;
+
+double cpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  auto seconds = [](const timeval& tv) {
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1e6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+double percentileUs(const std::vector<int64_t>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto i = std::min(sorted.size() - 1, size_t(p * double(sorted.size())));
+  return double(sorted[i]) / 1000;
+}
+
+template <class T>
+void runOn(const std::vector<EventBase*>& evbs, size_t i, T&& func) {
+  evbs[i % evbs.size()]->runInEventBaseThreadAndWait(std::forward<T>(func));
+}
+
+int run() {
+  std::vector<std::unique_ptr<ScopedEventBaseThread>> serverThreads;
+  std::vector<std::unique_ptr<ScopedEventBaseThread>> clientThreads;
+  std::vector<EventBase*> serverEvbs;
+  std::vector<EventBase*> clientEvbs;
+  for (int i = 0; i < std::max(1, FLAGS_server_threads); ++i) {
+    serverThreads.push_back(std::make_unique<ScopedEventBaseThread>());
+    serverEvbs.push_back(serverThreads.back()->getEventBase());
+  }
+  for (int i = 0; i < std::max(1, FLAGS_client_threads); ++i) {
+    clientThreads.push_back(std::make_unique<ScopedEventBaseThread>());
+    clientEvbs.push_back(clientThreads.back()->getEventBase());
+  }
+  std::vector<Stats> stats(clientEvbs.size());
+
+  std::shared_ptr<SSLContext> serverCtx;
+  std::shared_ptr<SSLContext> clientCtx;
+  if (gTransport == Transport::SSL) {
+    serverCtx = std::make_shared<SSLContext>();
+    serverCtx->loadCertificate(FLAGS_cert.c_str());
+    serverCtx->loadPrivateKey(FLAGS_key.c_str());
+    clientCtx = std::make_shared<SSLContext>();
+  }
+
+  // The server and the clients
+  std::unique_ptr<StreamServer> streamServer;
+  std::vector<std::unique_ptr<UdpServer>> udpServers;
+  std::vector<SocketAddress> serverAddresses;
+  if (gTransport == Transport::UDP) {
+    for (auto evb : serverEvbs) {
+      udpServers.push_back(std::make_unique<UdpServer>(evb));
+      serverAddresses.push_back(udpServers.back()->address());
+    }
+  } else {
+    streamServer =
+        std::make_unique<StreamServer>(serverEvbs[0], serverEvbs, serverCtx);
+    serverAddresses.push_back(streamServer->address());
+  }
+
+  std::vector<std::unique_ptr<StreamClient>> streamClients;
+  std::vector<std::unique_ptr<UdpClient>> udpClients;
+  for (int i = 0; i < FLAGS_connections; ++i) {
+    auto evb = clientEvbs[i % clientEvbs.size()];
+    auto s = &stats[i % clientEvbs.size()];
+    auto& server = serverAddresses[i % serverAddresses.size()];
+    runOn(clientEvbs, i, [&] {
+      if (gTransport == Transport::UDP) {
+        udpClients.push_back(std::make_unique<UdpClient>(evb, server, s));
+      } else {
+        streamClients.push_back(
+            std::make_unique<StreamClient>(evb, clientCtx, server, s));
+      }
+    });
+  }
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_warmup_ms));
+  auto cpuStart = cpuSeconds();
+  auto start = Clock::now();
+  gMeasuring = true;
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_duration_ms));
+  gMeasuring = false;
+  auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  auto cpu = cpuSeconds() - cpuStart;
+  gRunning = false;
+
+  // Tear down on the IO threads, which own the sockets
+  for (size_t i = 0; i < streamClients.size(); ++i) {
+    runOn(clientEvbs, i, [&] { streamClients[i]->close(); });
+  }
+  for (size_t i = 0; i < udpClients.size(); ++i) {
+    runOn(clientEvbs, i, [&] { udpClients[i]->close(); });
+  }
+  for (size_t i = 0; i < clientEvbs.size(); ++i) {
+    runOn(clientEvbs, i, [&] {
+      for (size_t j = i; j < streamClients.size(); j += clientEvbs.size()) {
+        streamClients[j].reset();
+      }
+      for (size_t j = i; j < udpClients.size(); j += clientEvbs.size()) {
+        udpClients[j].reset();
+      }
+    });
+  }
+  if (streamServer) {
+    streamServer->stop();
+  }
+  for (auto& server : udpServers) {
+    server->stop();
+  }
+  clientThreads.clear();
+  serverThreads.clear();
+
+  // Report
+  Stats total;
+  for (auto& s : stats) {
+    total.latenciesNs.insert(
+        total.latenciesNs.end(), s.latenciesNs.begin(), s.latenciesNs.end());
+    total.requests += s.requests;
+    total.bytes += s.bytes;
+    total.lost += s.lost;
+  }
+  std::sort(total.latenciesNs.begin(), total.latenciesNs.end());
+
+  LOG(INFO) << sformat(
+      "scenario={} transport={} connections={} server_threads={} "
+      "client_threads={} message_size={} response_size={} pipeline={}",
+      FLAGS_scenario,
+      FLAGS_transport,
+      FLAGS_connections,
+      serverEvbs.size(),
+      clientEvbs.size(),
+      FLAGS_message_size,
+      FLAGS_response_size,
+      FLAGS_pipeline);
+  if (gScenario == Scenario::BULK) {
+    auto bytes = double(gServerBytes.load());
+    LOG(INFO) << sformat(
+        "{:.3f} Gbps, cpu {:.1f} us/MB",
+        bytes * 8 / elapsed / 1e9,
+        bytes > 0 ? cpu * 1e6 / (bytes / 1e6) : 0.0);
+    return 0;
+  }
+  LOG(INFO) << sformat(
+      "{:.0f} requests/s, {:.3f} Gbps, latency us p50 {:.1f} p99 {:.1f} "
+      "p999 {:.1f}, cpu {:.2f} us/request{}",
+      double(total.requests) / elapsed,
+      double(total.bytes) * 8 / elapsed / 1e9,
+      percentileUs(total.latenciesNs, 0.5),
+      percentileUs(total.latenciesNs, 0.99),
+      percentileUs(total.latenciesNs, 0.999),
+      total.requests > 0 ? cpu * 1e6 / double(total.requests) : 0.0,
+      total.lost > 0 ? sformat(", {} lost", total.lost) : std::string());
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+
+  if (FLAGS_scenario == "echo") {
+    gScenario = Scenario::ECHO;
+  } else if (FLAGS_scenario == "rpc") {
+    gScenario = Scenario::RPC;
+  } else if (FLAGS_scenario == "bulk") {
+    gScenario = Scenario::BULK;
+  } else {
+    LOG(ERROR) << "Unknown scenario: " << FLAGS_scenario;
+    return 1;
+  }
+  if (FLAGS_transport == "tcp") {
+    gTransport = Transport::TCP;
+  } else if (FLAGS_transport == "ssl") {
+    gTransport = Transport::SSL;
+  } else if (FLAGS_transport == "udp") {
+    gTransport = Transport::UDP;
+  } else {
+    LOG(ERROR) << "Unknown transport: " << FLAGS_transport;
+    return 1;
+  }
+  if (gTransport == Transport::UDP && gScenario == Scenario::BULK) {
+    LOG(ERROR) << "bulk needs a stream transport";
+    return 1;
+  }
+  if (FLAGS_message_size <= 0 || FLAGS_response_size <= 0 ||
+      FLAGS_pipeline <= 0 || FLAGS_connections <= 0) {
+    LOG(ERROR) << "sizes, pipeline and connections must be > 0";
+    return 1;
+  }
+  return run();
+}
@@ -154,3 +154,74 @@ TEST(RequestContext, deadlockTest) {
       "test", std::make_unique<DeadlockTestData>("test2"));
   RequestContext::get()->clearContextData("test");
 }
+
+TEST(RequestContext, tokenTest) {
+  RequestContextScopeGuard g;
+  static const RequestToken token("tokenTest");
+  EXPECT_EQ(token, RequestToken("tokenTest"));
+  EXPECT_NE(token, RequestToken("tokenTest2"));
+  EXPECT_EQ("tokenTest", token.getDebugString());
+
+  EXPECT_FALSE(RequestContext::get()->hasContextData(token));
+  RequestContext::get()->setContextData(token, std::make_unique<TestData>(10));
+  EXPECT_TRUE(RequestContext::get()->hasContextData(token));
+  // String and token keys are interchangeable.
+  EXPECT_EQ(
+      10,
+      dynamic_cast<TestData*>(
+          RequestContext::get()->getContextData("tokenTest"))->data_);
+  EXPECT_FALSE(RequestContext::get()->setContextDataIfAbsent(
+      token, std::make_unique<TestData>(20)));
+
+  RequestContext::get()->clearContextData(token);
+  EXPECT_FALSE(RequestContext::get()->hasContextData("tokenTest"));
+}
+
+TEST(RequestContext, copyAsChildTest) {
+  RequestContextScopeGuard g;
+  auto parent = RequestContext::saveContext();
+  parent->setContextData("shared", std::make_unique<TestData>(1));
+  parent->setContextData("cleared", std::make_unique<TestData>(2));
+  auto sharedData = parent->getContextData("shared");
+
+  {
+    ShallowCopyRequestContextScopeGuard child;
+    auto ctx = RequestContext::get();
+    EXPECT_NE(parent.get(), ctx);
+    // The child sees, and shares, the parent's data.
+    EXPECT_EQ(sharedData, ctx->getContextData("shared"));
+    EXPECT_EQ(1, dynamic_cast<TestData*>(sharedData)->set_);
+
+    ctx->setContextData("child", std::make_unique<TestData>(3));
+    ctx->clearContextData("cleared");
+    EXPECT_TRUE(ctx->hasContextData("child"));
+    EXPECT_FALSE(ctx->hasContextData("cleared"));
+    EXPECT_FALSE(parent->hasContextData("child"));
+    EXPECT_TRUE(parent->hasContextData("cleared"));
+
+    // Writes to the parent after the copy are not visible in the child.
+    parent->setContextData("late", std::make_unique<TestData>(4));
+    EXPECT_FALSE(ctx->hasContextData("late"));
+  }
+
+  EXPECT_EQ(parent, RequestContext::saveContext());
+  EXPECT_EQ(sharedData, parent->getContextData("shared"));
+  EXPECT_EQ(2, dynamic_cast<TestData*>(sharedData)->set_);
+  EXPECT_EQ(2, dynamic_cast<TestData*>(sharedData)->unset_);
+}
+
+TEST(RequestContext, moveSetContextTest) {
+  RequestContextScopeGuard g;
+  auto ctx = RequestContext::saveContext();
+  std::shared_ptr<RequestContext> saved = std::make_shared<RequestContext>();
+  auto other = saved.get();
+  EXPECT_EQ(1, saved.use_count());
+
+  saved = RequestContext::setContext(std::move(saved));
+  EXPECT_EQ(other, RequestContext::get());
+  EXPECT_EQ(ctx, saved);
+  saved = RequestContext::setContext(std::move(saved));
+  EXPECT_EQ(ctx.get(), RequestContext::get());
+  EXPECT_EQ(other, saved.get());
+  EXPECT_EQ(1, saved.use_count());
+}
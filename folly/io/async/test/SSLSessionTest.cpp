@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <folly/experimental/TestUtil.h>
+#include <folly/io/async/ssl/SSLSessionCache.h>
+#include <folly/io/async/ssl/TicketKeyRotator.h>
 #include <folly/io/async/test/AsyncSSLSocketTest.h>
 #include <folly/portability/GTest.h>
 #include <folly/portability/Sockets.h>
@@ -75,6 +78,49 @@ class SSLSessionTest : public testing::Test {
   std::string serverName;
 };
 
+namespace {
+
+std::shared_ptr<SSLContext> makeServerCtx() {
+  auto ctx = std::make_shared<SSLContext>();
+  ctx->ciphers("ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+  ctx->loadCertificate(kTestCert);
+  ctx->loadPrivateKey(kTestKey);
+#if FOLLY_OPENSSL_IS_110
+  // TLS 1.3 sends tickets after the handshake
+  SSL_CTX_set_max_proto_version(ctx->getSSLCtx(), TLS1_2_VERSION);
+#endif
+  return ctx;
+}
+
+// Handshakes with serverCtx, resuming session if given; returns the new
+// session and whether it was resumed
+std::pair<std::unique_ptr<SSLSession>, bool> handshake(
+    EventBase& eventBase,
+    std::shared_ptr<SSLContext> clientCtx,
+    std::shared_ptr<SSLContext> serverCtx,
+    SSLSession* session = nullptr) {
+  int fds[2];
+  getfds(fds);
+  AsyncSSLSocket::UniquePtr clientSock(
+      new AsyncSSLSocket(clientCtx, &eventBase, fds[0], false));
+  auto clientPtr = clientSock.get();
+  if (session) {
+    clientSock->setSSLSession(session->getRawSSLSessionDangerous(), true);
+  }
+  AsyncSSLSocket::UniquePtr serverSock(
+      new AsyncSSLSocket(serverCtx, &eventBase, fds[1], true));
+  SSLHandshakeClient client(std::move(clientSock), false, false);
+  SSLHandshakeServer server(std::move(serverSock), false, false);
+
+  eventBase.loop();
+  EXPECT_TRUE(client.handshakeSuccess_);
+  return std::make_pair(
+      std::make_unique<SSLSession>(clientPtr->getSSLSession()),
+      clientPtr->getSSLSessionReused());
+}
+
+} // namespace
+
 /**
  * 1. Client sends TLSEXT_HOSTNAME in client hello.
  * 2. Server found a match SSL_CTX and use this SSL_CTX to
@@ -188,4 +234,78 @@ TEST_F(SSLSessionTest, GetSessionID) {
   auto sessID = sess->getSessionID();
   ASSERT_GE(sessID.length(), 0);
 }
+
+TEST_F(SSLSessionTest, SessionCache) {
+  auto cache = std::make_shared<ssl::SSLSessionCache>();
+  auto serverCtx = makeServerCtx();
+  // Resume with the session id, not a ticket
+  serverCtx->setOptions(SSL_OP_NO_TICKET);
+  serverCtx->setSessionCache(cache);
+
+  auto first = handshake(eventBase, clientCtx, serverCtx);
+  EXPECT_FALSE(first.second);
+  EXPECT_EQ(1, cache->getStats().added);
+
+  auto second =
+      handshake(eventBase, clientCtx, serverCtx, first.first.get());
+  EXPECT_TRUE(second.second);
+  EXPECT_EQ(1, cache->getStats().hits);
+
+  // Not in OpenSSL's cache
+  EXPECT_EQ(0, SSL_CTX_sess_number(serverCtx->getSSLCtx()));
+}
+
+TEST_F(SSLSessionTest, SharedSessionCache) {
+  test::TemporaryFile file;
+  ssl::SSLSessionCache::Options options;
+  options.sharedMemoryPath = file.path().string();
+  options.sharedMemorySlots = 64;
+
+  // Two processes behind the same port
+  auto cache1 = std::make_shared<ssl::SSLSessionCache>(options);
+  auto cache2 = std::make_shared<ssl::SSLSessionCache>(options);
+  auto serverCtx1 = makeServerCtx();
+  auto serverCtx2 = makeServerCtx();
+  for (auto ctx : {serverCtx1, serverCtx2}) {
+    ctx->setOptions(SSL_OP_NO_TICKET);
+    ctx->setSessionCacheContext("test");
+  }
+  serverCtx1->setSessionCache(cache1);
+  serverCtx2->setSessionCache(cache2);
+
+  auto first = handshake(eventBase, clientCtx, serverCtx1);
+  auto second =
+      handshake(eventBase, clientCtx, serverCtx2, first.first.get());
+  EXPECT_TRUE(second.second);
+  EXPECT_EQ(1, cache2->getStats().sharedHits);
+
+  // Now in the process cache too
+  auto id = first.first->getSessionID();
+  EXPECT_NE(nullptr, cache2->get(StringPiece(id)));
+  EXPECT_EQ(1, cache2->getStats().hits);
+
+  cache1->remove(StringPiece(id));
+  ssl::SSLSessionCache cache3(options);
+  EXPECT_EQ(nullptr, cache3.get(StringPiece(id)));
+}
+
+TEST_F(SSLSessionTest, TicketKeyRotator) {
+  auto rotator1 = std::make_shared<ssl::TicketKeyRotator>("seed");
+  auto rotator2 = std::make_shared<ssl::TicketKeyRotator>("seed");
+  auto serverCtx1 = makeServerCtx();
+  auto serverCtx2 = makeServerCtx();
+  serverCtx1->setTicketKeyRotator(rotator1);
+  serverCtx2->setTicketKeyRotator(rotator2);
+
+  auto first = handshake(eventBase, clientCtx, serverCtx1);
+  ASSERT_TRUE(SSL_SESSION_has_ticket(first.first->getRawSSLSession()));
+  auto second =
+      handshake(eventBase, clientCtx, serverCtx2, first.first.get());
+  EXPECT_TRUE(second.second);
+
+  rotator2->setSeed("other seed");
+  auto third =
+      handshake(eventBase, clientCtx, serverCtx2, first.first.get());
+  EXPECT_FALSE(third.second);
+}
 } // namespace folly
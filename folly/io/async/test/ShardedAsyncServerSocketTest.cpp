@@ -0,0 +1,180 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/io/async/ShardedAsyncServerSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/FileUtil.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Sockets.h>
+
+using namespace folly;
+
+namespace {
+
+class CountingCallback : public AsyncServerSocket::AcceptCallback {
+ public:
+  explicit CountingCallback(EventBase* eventBase) : eventBase_(eventBase) {}
+
+  void connectionAccepted(
+      int fd,
+      const SocketAddress& /* clientAddr */) noexcept override {
+    EXPECT_TRUE(eventBase_->isInEventBaseThread());
+    closeNoInt(fd);
+    ++accepted;
+  }
+
+  void acceptError(const std::exception& ex) noexcept override {
+    ADD_FAILURE() << ex.what();
+  }
+
+  std::atomic<size_t> accepted{0};
+
+ private:
+  EventBase* eventBase_;
+};
+
+class ShardedAsyncServerSocketTest : public ::testing::Test {
+ protected:
+  // cpus[i] are the cpus of shard i
+  void start(
+      size_t numShards,
+      ShardedAsyncServerSocket::Steering steering,
+      std::vector<std::vector<size_t>> cpus = {}) {
+    cpus.resize(numShards);
+    std::vector<ShardedAsyncServerSocket::Shard> shards;
+    for (size_t i = 0; i < numShards; ++i) {
+      threads_.emplace_back(new ScopedEventBaseThread());
+      auto eventBase = threads_.back()->getEventBase();
+      callbacks_.emplace_back(new CountingCallback(eventBase));
+      shards.push_back({eventBase, cpus[i]});
+    }
+    socket_.reset(new ShardedAsyncServerSocket(std::move(shards), steering));
+    socket_->bind(SocketAddress("127.0.0.1", 0));
+    socket_->listen(128);
+    for (size_t i = 0; i < numShards; ++i) {
+      socket_->addAcceptCallback(i, callbacks_[i].get());
+    }
+    socket_->startAccepting();
+  }
+
+  // Opens and closes n connections, and waits until they were accepted
+  void connect(size_t n) {
+    auto address = socket_->getAddresses().front();
+    sockaddr_storage addrStorage;
+    address.getAddress(&addrStorage);
+    for (size_t i = 0; i < n; ++i) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      ASSERT_GE(fd, 0);
+      ASSERT_EQ(
+          0,
+          ::connect(
+              fd,
+              reinterpret_cast<sockaddr*>(&addrStorage),
+              address.getActualSize()));
+      closeNoInt(fd);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (accepted() < n && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(n, accepted());
+  }
+
+  size_t accepted() const {
+    size_t total = 0;
+    for (auto& callback : callbacks_) {
+      total += callback->accepted;
+    }
+    return total;
+  }
+
+  void TearDown() override {
+    socket_.reset();
+  }
+
+  // Destroyed last
+  std::vector<std::unique_ptr<ScopedEventBaseThread>> threads_;
+  std::vector<std::unique_ptr<CountingCallback>> callbacks_;
+  std::unique_ptr<ShardedAsyncServerSocket> socket_;
+};
+
+} // namespace
+
+TEST_F(ShardedAsyncServerSocketTest, AcceptInShards) {
+  start(4, ShardedAsyncServerSocket::Steering::NONE);
+
+  // Every listener got the port that the first one picked
+  auto address = socket_->getAddresses().front();
+  EXPECT_NE(0, address.getPort());
+  for (size_t i = 0; i < socket_->numShards(); ++i) {
+    socket_->getEventBase(i)->runInEventBaseThreadAndWait([&] {
+      SocketAddress bound;
+      socket_->getListener(i)->getAddress(&bound);
+      EXPECT_EQ(address, bound);
+    });
+  }
+
+  connect(200);
+  size_t busyShards = 0;
+  for (auto& callback : callbacks_) {
+    busyShards += callback->accepted > 0;
+  }
+  EXPECT_LT(1, busyShards);
+}
+
+#ifdef __linux__
+TEST_F(ShardedAsyncServerSocketTest, CbpfSteering) {
+  // All the cpus belong to the last shard
+  std::vector<size_t> allCpus;
+  for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    allCpus.push_back(cpu);
+  }
+  start(3, ShardedAsyncServerSocket::Steering::CBPF, {{}, {}, allCpus});
+
+  connect(50);
+  EXPECT_EQ(0, callbacks_[0]->accepted);
+  EXPECT_EQ(0, callbacks_[1]->accepted);
+  EXPECT_EQ(50, callbacks_[2]->accepted);
+}
+
+TEST_F(ShardedAsyncServerSocketTest, IncomingCpu) {
+  start(2, ShardedAsyncServerSocket::Steering::INCOMING_CPU, {{0}, {1, 2}});
+
+  for (size_t i = 0; i < socket_->numShards(); ++i) {
+    socket_->getEventBase(i)->runInEventBaseThreadAndWait([&] {
+      auto listener = socket_->getListener(i);
+      EXPECT_EQ(int(i), listener->getIncomingCpu());
+      int cpu = -1;
+      socklen_t len = sizeof(cpu);
+      ASSERT_EQ(
+          0,
+          getsockopt(
+              listener->getSocket(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len));
+      EXPECT_EQ(int(i), cpu);
+    });
+  }
+
+  connect(20);
+}
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/CompressedRecordIO.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+namespace folly {
+namespace test {
+
+namespace {
+
+std::vector<std::string> makeRecords(size_t count) {
+  std::vector<std::string> records;
+  for (size_t i = 0; i < count; ++i) {
+    // Some empty
+    auto size = i % 7 == 0 ? 0 : i % 500;
+    records.push_back(std::string(size, char('a' + i % 26)));
+  }
+  // Larger than a block
+  records.push_back(std::string(10000, 'z'));
+  return records;
+}
+
+void writeRecords(
+    int fd,
+    const std::vector<std::string>& records,
+    CompressedRecordIOWriter::Options options) {
+  CompressedRecordIOWriter writer(File(fd), options);
+  for (auto& record : records) {
+    writer.write(StringPiece(record));
+  }
+}
+
+std::vector<std::string> readRecords(const CompressedRecordIOReader& reader) {
+  std::vector<std::string> records;
+  reader.forEach([&](off_t, ByteRange record) {
+    records.push_back(StringPiece(record).str());
+  });
+  return records;
+}
+
+// Sorted by block, and in order within blocks
+std::vector<std::string> parallelReadRecords(
+    const CompressedRecordIOReader& reader,
+    size_t parallelism) {
+  CPUThreadPoolExecutor executor(4);
+  std::mutex mutex;
+  std::vector<std::pair<off_t, std::vector<std::string>>> blocks;
+  reader.parallelForEach(
+      &executor,
+      [&](off_t pos, ByteRange record) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find_if(blocks.begin(), blocks.end(), [&](auto& b) {
+          return b.first == pos;
+        });
+        if (it == blocks.end()) {
+          blocks.emplace_back(pos, std::vector<std::string>());
+          it = blocks.end() - 1;
+        }
+        it->second.push_back(StringPiece(record).str());
+      },
+      parallelism);
+  std::sort(blocks.begin(), blocks.end(), [](auto& a, auto& b) {
+    return a.first < b.first;
+  });
+  std::vector<std::string> records;
+  for (auto& block : blocks) {
+    records.insert(records.end(), block.second.begin(), block.second.end());
+  }
+  return records;
+}
+
+std::vector<io::CodecType> availableCodecTypes() {
+  std::vector<io::CodecType> types;
+  for (auto type : {io::CodecType::NO_COMPRESSION,
+                    io::CodecType::ZLIB,
+                    io::CodecType::ZSTD,
+                    io::CodecType::LZ4}) {
+    if (io::hasCodec(type)) {
+      types.push_back(type);
+    }
+  }
+  return types;
+}
+
+CompressedRecordIOWriter::Options defaultOptions() {
+  return CompressedRecordIOWriter::Options().setCodecType(
+      availableCodecTypes().back());
+}
+
+} // namespace
+
+TEST(CompressedRecordIOTest, Simple) {
+  auto records = makeRecords(1000);
+  for (auto type : availableCodecTypes()) {
+    TemporaryFile file;
+    writeRecords(
+        file.fd(),
+        records,
+        CompressedRecordIOWriter::Options().setCodecType(type).setBlockSize(
+            4096));
+
+    CompressedRecordIOReader reader(File(file.fd()));
+    ASSERT_TRUE(reader.hasIndex());
+    EXPECT_GT(reader.index().size(), 10);
+    size_t count = 0;
+    for (auto& block : reader.index()) {
+      count += block.recordCount;
+      size_t n = 0;
+      EXPECT_TRUE(reader.readBlock(block.pos, [&](off_t pos, ByteRange) {
+        EXPECT_EQ(block.pos, pos);
+        ++n;
+      }));
+      EXPECT_EQ(block.recordCount, n);
+    }
+    EXPECT_EQ(records.size(), count);
+    EXPECT_FALSE(reader.readBlock(1, [](off_t, ByteRange) {}));
+
+    EXPECT_EQ(records, readRecords(reader));
+    EXPECT_EQ(records, parallelReadRecords(reader, 0));
+    EXPECT_EQ(records, parallelReadRecords(reader, 3));
+  }
+}
+
+TEST(CompressedRecordIOTest, Empty) {
+  TemporaryFile file;
+  writeRecords(file.fd(), {}, defaultOptions());
+  CompressedRecordIOReader reader(File(file.fd()));
+  EXPECT_TRUE(reader.hasIndex());
+  EXPECT_TRUE(reader.index().empty());
+  EXPECT_TRUE(readRecords(reader).empty());
+  EXPECT_TRUE(parallelReadRecords(reader, 0).empty());
+}
+
+TEST(CompressedRecordIOTest, Append) {
+  // Only a writer that starts with an empty file writes an index
+  auto records = makeRecords(100);
+  TemporaryFile file;
+  auto options = CompressedRecordIOWriter::Options()
+                     .setCodecType(io::CodecType::NO_COMPRESSION)
+                     .setBlockSize(1000);
+  writeRecords(file.fd(), records, options);
+  writeRecords(file.fd(), records, options);
+
+  CompressedRecordIOReader reader(File(file.fd()));
+  EXPECT_FALSE(reader.hasIndex());
+  auto expected = records;
+  expected.insert(expected.end(), records.begin(), records.end());
+  EXPECT_EQ(expected, readRecords(reader));
+  EXPECT_EQ(expected, parallelReadRecords(reader, 4));
+}
+
+TEST(CompressedRecordIOTest, Corrupted) {
+  auto records = makeRecords(100);
+  TemporaryFile file;
+  writeRecords(
+      file.fd(),
+      records,
+      CompressedRecordIOWriter::Options()
+          .setCodecType(io::CodecType::NO_COMPRESSION)
+          .setBlockSize(1000));
+
+  off_t second;
+  uint32_t lost;
+  {
+    CompressedRecordIOReader reader(File(file.fd()));
+    ASSERT_GT(reader.index().size(), 2);
+    second = reader.index()[1].pos;
+    lost = reader.index()[1].recordCount;
+  }
+  // Corrupt the second block, and the footer
+  struct stat st;
+  ASSERT_EQ(0, fstat(file.fd(), &st));
+  char c = 'X';
+  ASSERT_EQ(1, pwriteFull(file.fd(), &c, 1, second + 100));
+  ASSERT_EQ(1, pwriteFull(file.fd(), &c, 1, st.st_size - 1));
+
+  CompressedRecordIOReader reader(File(file.fd()));
+  EXPECT_FALSE(reader.hasIndex());
+  auto found = readRecords(reader);
+  EXPECT_EQ(records.size() - lost, found.size());
+  EXPECT_EQ(records.front(), found.front());
+  EXPECT_EQ(records.back(), found.back());
+  EXPECT_EQ(found, parallelReadRecords(reader, 4));
+}
+
+TEST(CompressedRecordIOTest, Closed) {
+  TemporaryFile file;
+  CompressedRecordIOWriter writer(File(file.fd()), defaultOptions());
+  writer.write(StringPiece("hello"));
+  writer.close();
+  EXPECT_THROW(writer.write(StringPiece("world")), std::logic_error);
+  EXPECT_THROW(
+      CompressedRecordIOWriter(
+          File(file.fd()), defaultOptions().setBlockSize(0)),
+      std::invalid_argument);
+}
+
+} // namespace test
+} // namespace folly
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/ContentChunker.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+
+namespace folly {
+namespace test {
+
+namespace {
+
+std::string randomBytes(size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::string s(n, '\0');
+  for (auto& c : s) {
+    c = char(rng());
+  }
+  return s;
+}
+
+// The string, in a chain of IOBufs of the given size
+std::unique_ptr<IOBuf> chain(StringPiece s, size_t pieceSize) {
+  IOBufQueue queue;
+  while (!s.empty()) {
+    size_t n = std::min(pieceSize, s.size());
+    queue.append(IOBuf::copyBuffer(s.data(), n));
+    s.advance(n);
+  }
+  return queue.move();
+}
+
+} // namespace
+
+TEST(ContentChunker, Sizes) {
+  ContentChunkerOptions options;
+  auto data = randomBytes(4 << 20, 1);
+  auto boundaries = contentChunkBoundaries(*chain(data, data.size()));
+
+  ASSERT_FALSE(boundaries.empty());
+  EXPECT_EQ(data.size(), boundaries.back());
+  size_t prev = 0;
+  for (size_t i = 0; i < boundaries.size(); ++i) {
+    size_t size = boundaries[i] - prev;
+    EXPECT_LE(size, options.maxSize);
+    if (i + 1 < boundaries.size()) {
+      EXPECT_GE(size, options.minSize);
+    }
+    prev = boundaries[i];
+  }
+  // Normalized chunking keeps the average close to avgSize
+  size_t avg = data.size() / boundaries.size();
+  EXPECT_GT(avg, options.avgSize / 2);
+  EXPECT_LT(avg, options.avgSize * 2);
+}
+
+TEST(ContentChunker, Chains) {
+  // The same boundaries however the stream is split
+  auto data = randomBytes(1 << 20, 2);
+  auto expected = contentChunkBoundaries(*chain(data, data.size()));
+  for (size_t pieceSize : {1, 7, 64, 1000, 4096, 100000}) {
+    EXPECT_EQ(expected, contentChunkBoundaries(*chain(data, pieceSize)))
+        << pieceSize;
+  }
+}
+
+TEST(ContentChunker, Insertion) {
+  // Inserting bytes only moves the boundaries near the insertion
+  auto data = randomBytes(1 << 20, 3);
+  auto before = contentChunkBoundaries(*chain(data, data.size()));
+  std::string inserted = "inserted";
+  data.insert(data.size() / 2, inserted);
+  auto after = contentChunkBoundaries(*chain(data, data.size()));
+
+  size_t same = 0;
+  for (auto b : before) {
+    size_t moved = b < data.size() / 2 ? b : b + inserted.size();
+    if (std::find(after.begin(), after.end(), moved) != after.end()) {
+      ++same;
+    }
+  }
+  EXPECT_GE(same + 2, before.size());
+}
+
+TEST(ContentChunker, MaxSize) {
+  // No boundaries in constant data, but cuts at maxSize
+  ContentChunkerOptions options;
+  options.minSize = 256;
+  options.avgSize = 1024;
+  options.maxSize = 4096;
+  std::string data(10000, 'a');
+  std::vector<size_t> expected = {4096, 8192, 10000};
+  EXPECT_EQ(expected, contentChunkBoundaries(*chain(data, 100), options));
+  EXPECT_TRUE(contentChunkBoundaries(IOBuf(), options).empty());
+}
+
+TEST(ContentChunker, Stream) {
+  auto data = randomBytes(100000, 4);
+  auto expected = contentChunkBoundaries(*chain(data, data.size()));
+
+  ContentChunker chunker;
+  std::vector<size_t> boundaries;
+  ByteRange range(StringPiece{data});
+  while (auto len = chunker.next(range)) {
+    range.advance(*len);
+    boundaries.push_back(data.size() - range.size());
+  }
+  EXPECT_EQ(range.size(), chunker.pending());
+  boundaries.push_back(data.size());
+  EXPECT_EQ(expected, boundaries);
+
+  chunker.reset();
+  EXPECT_EQ(0, chunker.pending());
+}
+
+TEST(ContentChunker, InvalidOptions) {
+  ContentChunkerOptions options;
+  options.avgSize = 5000;
+  EXPECT_THROW(ContentChunker{options}, std::invalid_argument);
+  options.avgSize = 128;
+  options.minSize = 64;
+  EXPECT_THROW(ContentChunker{options}, std::invalid_argument);
+  options = ContentChunkerOptions();
+  options.minSize = options.avgSize * 2;
+  EXPECT_THROW(ContentChunker{options}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace folly
@@ -21,6 +21,8 @@
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 
+#include <vector>
+
 DECLARE_bool(benchmark);
 
 using folly::ByteRange;
@@ -147,6 +149,29 @@ BENCHMARK_RELATIVE(prefix, iters) {
   }
 }
 
+BENCHMARK(readBE, iters) {
+  IOBuf buf{IOBuf::CREATE, benchmark_size * sizeof(uint32_t)};
+  buf.append(benchmark_size * sizeof(uint32_t));
+  while (iters--) {
+    Cursor c(&buf);
+    for (int i = 0; i < benchmark_size; ++i) {
+      const auto val = c.readBE<uint32_t>();
+      folly::doNotOptimizeAway(val);
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(readArrayBE, iters) {
+  IOBuf buf{IOBuf::CREATE, benchmark_size * sizeof(uint32_t)};
+  buf.append(benchmark_size * sizeof(uint32_t));
+  std::vector<uint32_t> out(benchmark_size);
+  while (iters--) {
+    Cursor c(&buf);
+    c.readArrayBE(out.data(), out.size());
+    folly::doNotOptimizeAway(out.data());
+  }
+}
+
 /**
  * ============================================================================
  * folly/io/test/IOBufCursorBenchmark.cpp          relative  time/iter  iters/s
@@ -18,6 +18,7 @@
 
 #include <folly/Format.h>
 #include <folly/Range.h>
+#include <folly/Varint.h>
 #include <folly/io/Cursor.h>
 #include <folly/portability/GTest.h>
 #include <numeric>
@@ -1132,3 +1133,80 @@ TEST(IOBuf, pushEmptyByteRange) {
   app.push(emptyBytes);
   EXPECT_EQ(0, buf.computeChainDataLength());
 }
+
+namespace {
+// Split data into a chain of IOBufs of at most chunk bytes each
+std::unique_ptr<IOBuf> chainOf(ByteRange data, size_t chunk) {
+  std::unique_ptr<IOBuf> head;
+  while (!data.empty()) {
+    size_t n = std::min(chunk, data.size());
+    auto buf = IOBuf::copyBuffer(data.data(), n);
+    data.advance(n);
+    if (head) {
+      head->prependChain(std::move(buf));
+    } else {
+      head = std::move(buf);
+    }
+  }
+  return head;
+}
+} // namespace
+
+TEST(IOBuf, readArray) {
+  std::vector<uint32_t> values(100);
+  std::iota(values.begin(), values.end(), 0x01020300);
+  std::vector<uint8_t> bytes(values.size() * sizeof(uint32_t));
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto be = folly::Endian::big(values[i]);
+    memcpy(&bytes[i * sizeof(be)], &be, sizeof(be));
+  }
+
+  for (size_t chunk : {1, 3, 7, 400}) {
+    auto buf = chainOf(ByteRange(bytes.data(), bytes.size()), chunk);
+    Cursor cursor(buf.get());
+    std::vector<uint32_t> out(values.size() - 1);
+    cursor.readArrayBE(out.data(), out.size());
+    EXPECT_TRUE(std::equal(out.begin(), out.end(), values.begin()));
+    EXPECT_EQ(sizeof(uint32_t), cursor.totalLength());
+    EXPECT_EQ(values.back(), cursor.readBE<uint32_t>());
+
+    Cursor other(buf.get());
+    EXPECT_THROW(
+        other.readArray(out.data(), values.size() + 1), std::out_of_range);
+  }
+}
+
+TEST(IOBuf, readVarints) {
+  std::vector<uint64_t> values;
+  for (int shift = 0; shift < 64; ++shift) {
+    values.push_back(uint64_t(1) << shift);
+    values.push_back((uint64_t(1) << shift) - 1);
+  }
+  values.push_back(std::numeric_limits<uint64_t>::max());
+  std::vector<uint8_t> bytes(values.size() * folly::kMaxVarintLength64);
+  size_t size = 0;
+  for (auto v : values) {
+    size += folly::encodeVarint(v, bytes.data() + size);
+  }
+
+  for (size_t chunk : {1, 5, 11, 2000}) {
+    auto buf = chainOf(ByteRange(bytes.data(), size), chunk);
+    Cursor cursor(buf.get());
+    std::vector<uint64_t> out(values.size());
+    cursor.readVarints(out.data(), out.size());
+    EXPECT_EQ(values, out);
+    EXPECT_TRUE(cursor.isAtEnd());
+
+    Cursor other(buf.get());
+    EXPECT_THROW(
+        other.readVarints(out.data(), values.size() + 1), std::out_of_range);
+  }
+
+  // 11 continuation bytes is too long for a 64-bit varint
+  std::vector<uint8_t> tooLong(11, 0x80);
+  tooLong.push_back(0);
+  auto buf = chainOf(ByteRange(tooLong.data(), tooLong.size()), 3);
+  Cursor cursor(buf.get());
+  uint64_t v;
+  EXPECT_THROW(cursor.readVarints(&v, 1), std::invalid_argument);
+}
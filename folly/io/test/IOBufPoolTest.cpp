@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/IOBufPool.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(IOBufPool, SizeClasses) {
+  EXPECT_EQ(0, IOBufPool::sizeClass(0));
+  EXPECT_EQ(0, IOBufPool::sizeClass(64));
+  EXPECT_EQ(1, IOBufPool::sizeClass(65));
+  EXPECT_EQ(1, IOBufPool::sizeClass(128));
+  EXPECT_EQ(5, IOBufPool::sizeClass(2000));
+  EXPECT_EQ(IOBufPool::kNumClasses - 1,
+            IOBufPool::sizeClass(IOBufPool::kMaxSize));
+  for (size_t c = 0; c < IOBufPool::kNumClasses; ++c) {
+    EXPECT_EQ(c, IOBufPool::sizeClass(IOBufPool::classSize(c)));
+  }
+}
+
+TEST(IOBufPool, Reuse) {
+  IOBufPool pool;
+  size_t usable = 0;
+  void* p = pool.allocate(100, &usable);
+  ASSERT_NE(nullptr, p);
+  EXPECT_EQ(128, usable);
+  memset(p, 0xab, usable);
+  pool.deallocate(p);
+  EXPECT_EQ(p, pool.allocate(128, &usable));
+  pool.deallocate(p);
+
+  EXPECT_EQ(nullptr, pool.allocate(IOBufPool::kMaxSize + 1, &usable));
+  auto stats = pool.getStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(1, stats.oversized);
+  EXPECT_EQ(1, stats.slabs);
+
+  // Distinct, aligned blocks
+  std::set<void*> blocks;
+  for (int i = 0; i < 1000; ++i) {
+    void* block = pool.allocate(64, &usable);
+    EXPECT_EQ(0, uintptr_t(block) % 64);
+    EXPECT_TRUE(blocks.insert(block).second);
+  }
+  for (auto block : blocks) {
+    pool.deallocate(block);
+  }
+}
+
+TEST(IOBufPool, CrossThread) {
+  IOBufPool pool;
+  constexpr size_t kSize = 4096;
+  constexpr size_t kBlocks = 1000;
+  std::vector<void*> blocks;
+  size_t usable;
+  for (size_t i = 0; i < kBlocks; ++i) {
+    blocks.push_back(pool.allocate(kSize, &usable));
+  }
+  auto slabs = pool.getStats().slabs;
+
+  // Freed by another thread, whose freelist fills up, and whose blocks go
+  // to the shared freelist, at the latest when it exits
+  std::thread([&] {
+    for (auto block : blocks) {
+      pool.deallocate(block);
+    }
+  }).join();
+  EXPECT_EQ(kBlocks, pool.getStats().returned);
+
+  // So this thread allocates them again, without new slabs
+  for (size_t i = 0; i < kBlocks; ++i) {
+    blocks[i] = pool.allocate(kSize, &usable);
+  }
+  EXPECT_EQ(slabs, pool.getStats().slabs);
+  for (auto block : blocks) {
+    pool.deallocate(block);
+  }
+  EXPECT_EQ(2 * kBlocks, pool.getStats().hits + pool.getStats().misses);
+}
+
+TEST(IOBufPool, IOBuf) {
+  static auto& pool = *new IOBufPool();
+  IOBufAllocator::set(&pool);
+  EXPECT_EQ(&pool, IOBufAllocator::get());
+  auto before = pool.getStats();
+
+  // Combined
+  auto buf = IOBuf::create(100);
+  EXPECT_LE(100, buf->capacity());
+  memset(buf->writableData(), 'a', 100);
+  buf->append(100);
+  // Separate, and its IOBuf
+  auto separate = IOBuf::createSeparate(8000);
+  EXPECT_LE(8000, separate->capacity());
+  memset(separate->writableData(), 'b', 8000);
+  separate->append(8000);
+  // Larger than the pool's blocks
+  auto large = IOBuf::create(IOBufPool::kMaxSize * 2);
+  EXPECT_LE(IOBufPool::kMaxSize * 2, large->capacity());
+  large->append(IOBufPool::kMaxSize * 2);
+
+  // Grown out of the combined buffer into a pooled external one
+  buf->reserve(0, 4000);
+  EXPECT_LE(4000, buf->tailroom());
+  EXPECT_EQ(std::string(100, 'a'), buf->moveToFbString().toStdString());
+
+  buf = IOBuf::copyBuffer("hello");
+  buf->prependChain(std::move(separate));
+  buf->prependChain(std::move(large));
+  buf->coalesce();
+  EXPECT_EQ(5 + 8000 + IOBufPool::kMaxSize * 2, buf->length());
+  EXPECT_EQ('b', buf->data()[5 + 7999]);
+
+  IOBufQueue queue;
+  for (int i = 0; i < 10; ++i) {
+    auto space = queue.preallocate(2000, 4000);
+    memset(space.first, 'c', 2000);
+    queue.postallocate(2000);
+  }
+  EXPECT_EQ(20000, queue.front()->computeChainDataLength());
+  queue.move();
+  buf.reset();
+
+  auto after = pool.getStats();
+  EXPECT_LT(before.hits + before.misses + 10, after.hits + after.misses);
+  EXPECT_LT(before.oversized, after.oversized);
+}
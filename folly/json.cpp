@@ -31,6 +31,12 @@
 #include <folly/Unicode.h>
 #include <folly/portability/Constexpr.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#endif
+
 namespace folly {
 
 //////////////////////////////////////////////////////////////////////
@@ -188,19 +194,15 @@ struct Printer {
 //////////////////////////////////////////////////////////////////////
 
 struct ParseError : std::runtime_error {
-  explicit ParseError(
-      unsigned int line,
-      std::string const& context,
-      std::string const& expected)
-      : std::runtime_error(to<std::string>(
-            "json parse error on line ",
-            line,
-            !context.empty() ? to<std::string>(" near `", context, '\'') : "",
-            ": ",
-            expected)) {}
+  explicit ParseError(parse_error const& error)
+      : std::runtime_error(error.what()) {}
 };
 
 // Wraps our input buffer with some helper functions.
+//
+// The parser doesn't throw: error() records the first error and empties
+// the input, so that the parse unwinds by itself, every loop seeing EOF.
+// Code that would step past the end after an error checks failed().
 struct Input {
   explicit Input(StringPiece range, json::serialization_opts const* opts)
       : range_(range)
@@ -254,8 +256,8 @@ struct Input {
 
   void expect(char c) {
     if (**this != c) {
-      throw ParseError(lineNum_, context(),
-        to<std::string>("expected '", c, '\''));
+      error(to<std::string>("expected '", c, '\'').c_str());
+      return;
     }
     ++*this;
   }
@@ -273,15 +275,6 @@ struct Input {
     storeCurrent();
   }
 
-  template <class T>
-  T extract() {
-    try {
-      return to<T>(&range_);
-    } catch (std::exception const& e) {
-      error(e.what());
-    }
-  }
-
   bool consume(StringPiece str) {
     if (boost::starts_with(range_, str)) {
       range_.advance(str.size());
@@ -295,8 +288,21 @@ struct Input {
     return range_.subpiece(0, 16 /* arbitrary */).toString();
   }
 
-  dynamic error(char const* what) const {
-    throw ParseError(lineNum_, context(), what);
+  dynamic error(char const* what) {
+    return error(parse_error{lineNum_, context(), what});
+  }
+
+  // A number that to<>() can't convert
+  dynamic error(ConversionCode code, StringPiece number) {
+    return error(parse_error{lineNum_, context(), number.str(), code});
+  }
+
+  bool failed() const {
+    return error_.hasValue();
+  }
+
+  parse_error& getError() {
+    return *error_;
   }
 
   json::serialization_opts const& getOpts() {
@@ -319,12 +325,22 @@ struct Input {
     current_ = range_.empty() ? EOF : range_.front();
   }
 
+  dynamic error(parse_error&& error) {
+    if (!error_) {
+      error_ = std::move(error);
+    }
+    range_.advance(range_.size());
+    storeCurrent();
+    return nullptr;
+  }
+
  private:
   StringPiece range_;
   json::serialization_opts const& opts_;
   unsigned lineNum_;
   int current_;
   unsigned int currentRecursionLevel_{0};
+  Optional<parse_error> error_;
 };
 
 class RecursionGuard {
@@ -430,7 +446,7 @@ dynamic parseNumber(Input& in) {
 
   auto integral = in.skipMinusAndDigits();
   if (negative && integral.size() < 2) {
-    in.error("expected digits after `-'");
+    return in.error("expected digits after `-'");
   }
 
   auto const wasE = *in == 'e' || *in == 'E';
@@ -448,13 +464,19 @@ dynamic parseNumber(Input& in) {
     if (LIKELY(!in.getOpts().double_fallback || integral.size() < maxIntLen) ||
         (!negative && integral.size() == maxIntLen && integral <= maxInt) ||
         (negative && integral.size() == minIntLen && integral <= minInt)) {
-      auto val = to<int64_t>(integral);
+      auto val = tryTo<int64_t>(integral);
+      if (!val) {
+        return in.error(val.error(), integral);
+      }
       in.skipWhitespace();
-      return val;
+      return *val;
     } else {
-      auto val = to<double>(integral);
+      auto val = tryTo<double>(integral);
+      if (!val) {
+        return in.error(val.error(), integral);
+      }
       in.skipWhitespace();
-      return val;
+      return *val;
     }
   }
 
@@ -471,32 +493,37 @@ dynamic parseNumber(Input& in) {
   if (in.getOpts().parse_numbers_as_strings) {
     return fullNum;
   }
-  auto val = to<double>(fullNum);
-  return val;
+  auto val = tryTo<double>(fullNum);
+  if (!val) {
+    return in.error(val.error(), fullNum);
+  }
+  return *val;
 }
 
 std::string decodeUnicodeEscape(Input& in) {
-  auto hexVal = [&] (int c) -> uint16_t {
-    return uint16_t(
-           c >= '0' && c <= '9' ? c - '0' :
+  auto hexVal = [&] (int c) -> int {
+    return c >= '0' && c <= '9' ? c - '0' :
            c >= 'a' && c <= 'f' ? c - 'a' + 10 :
            c >= 'A' && c <= 'F' ? c - 'A' + 10 :
-           (in.error("invalid hex digit"), 0));
+           -1;
   };
 
   auto readHex = [&]() -> uint16_t {
     if (in.size() < 4) {
       in.error("expected 4 hex digits");
+      return 0;
     }
 
-    uint16_t ret = uint16_t(hexVal(*in) * 4096);
-    ++in;
-    ret += hexVal(*in) * 256;
-    ++in;
-    ret += hexVal(*in) * 16;
-    ++in;
-    ret += hexVal(*in);
-    ++in;
+    uint16_t ret = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto digit = hexVal(*in);
+      if (digit < 0) {
+        in.error("invalid hex digit");
+        return 0;
+      }
+      ret = uint16_t(ret * 16 + digit);
+      ++in;
+    }
     return ret;
   };
 
@@ -509,6 +536,7 @@ std::string decodeUnicodeEscape(Input& in) {
     if (!in.consume("\\u")) {
       in.error("expected another unicode escape for second half of "
         "surrogate pair");
+      return std::string();
     }
     uint16_t second = readHex();
     if (second >= 0xdc00 && second <= 0xdfff) {
@@ -516,9 +544,14 @@ std::string decodeUnicodeEscape(Input& in) {
                   (second & 0x3ff);
     } else {
       in.error("second character in surrogate pair is invalid");
+      return std::string();
     }
   } else if (codePoint >= 0xdc00 && codePoint <= 0xdfff) {
     in.error("invalid unicode code point (in range [0xdc00,0xdfff])");
+    return std::string();
+  }
+  if (in.failed()) {
+    return std::string();
   }
 
   return codePointToUtf8(codePoint);
@@ -553,11 +586,13 @@ std::string parseString(Input& in) {
       case 'u':     ++in; ret += decodeUnicodeEscape(in); break;
       default:
         in.error(to<std::string>("unknown escape ", *in, " in string").c_str());
+        return ret;
       }
       continue;
     }
     if (*in == EOF) {
       in.error("unterminated string");
+      return ret;
     }
     if (!*in) {
       /*
@@ -568,6 +603,7 @@ std::string parseString(Input& in) {
        * check this way.)
        */
       in.error("null byte in string");
+      return ret;
     }
 
     ret.push_back(char(*in));
@@ -613,7 +649,7 @@ std::string serialize(dynamic const& dyn, serialization_opts const& opts) {
 // unescaped in a string of sizeof(T) bytes packed in an integer of
 // type T.
 template <class T>
-size_t firstEscapableInWord(T s) {
+size_t firstEscapableInWord(T s, bool nonAscii) {
   static_assert(std::is_unsigned<T>::value, "Unsigned integer required");
   static constexpr T kOnes = ~T() / 255; // 0x...0101
   static constexpr T kMsbs = kOnes * 0x80; // 0x...8080
@@ -632,7 +668,7 @@ size_t firstEscapableInWord(T s) {
 
   // The following masks have the MSB set for each byte of the word
   // that satisfies the corresponding condition.
-  auto isHigh = s & kMsbs; // >= 128
+  auto isHigh = nonAscii ? s & kMsbs : T(0); // >= 128
   auto isLow = isLess(s, 0x20); // <= 0x1f
   auto needsEscape = isHigh | isLow | isChar('\\') | isChar('"');
 
@@ -647,6 +683,85 @@ size_t firstEscapableInWord(T s) {
   }
 }
 
+namespace detail {
+
+size_t firstEscapable(StringPiece s, bool nonAscii) {
+  auto* b = reinterpret_cast<const unsigned char*>(s.begin());
+  auto* p = b;
+  auto* e = reinterpret_cast<const unsigned char*>(s.end());
+
+  // Control characters are < 0x20, and so are bytes >= 0x80 when compared
+  // as signed chars.
+#ifdef __AVX2__
+  {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    while (e - p >= 32) {
+      auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      auto low = nonAscii
+          ? _mm256_cmpgt_epi8(space, v)
+          : _mm256_cmpeq_epi8(
+                _mm256_subs_epu8(v, control), _mm256_setzero_si256());
+      auto needsEscape = _mm256_or_si256(
+          low,
+          _mm256_or_si256(
+              _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)));
+      auto mask = uint32_t(_mm256_movemask_epi8(needsEscape));
+      if (mask) {
+        return size_t(p - b) + size_t(folly::findFirstSet(mask) - 1);
+      }
+      p += 32;
+    }
+  }
+#endif
+
+#if FOLLY_SSE_PREREQ(2, 0)
+  {
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i control = _mm_set1_epi8(0x1f);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (e - p >= 16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      auto low = nonAscii
+          ? _mm_cmplt_epi8(v, space)
+          : _mm_cmpeq_epi8(_mm_subs_epu8(v, control), _mm_setzero_si128());
+      auto needsEscape = _mm_or_si128(
+          low,
+          _mm_or_si128(
+              _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+      auto mask = uint32_t(_mm_movemask_epi8(needsEscape));
+      if (mask) {
+        return size_t(p - b) + size_t(folly::findFirstSet(mask) - 1);
+      }
+      p += 16;
+    }
+  }
+#endif
+
+  while (p < e) {
+    DCHECK_GT(e - p, 0);
+    auto avail = size_t(e - p);
+    uint64_t word = 0;
+    if (avail >= 8) {
+      word = folly::loadUnaligned<uint64_t>(p);
+    } else {
+      memcpy(static_cast<void*>(&word), p, avail);
+    }
+    auto prefix = firstEscapableInWord(word, nonAscii);
+    DCHECK_LE(prefix, avail);
+    p += prefix;
+    if (prefix < 8) {
+      break;
+    }
+  }
+  return size_t(p - b);
+}
+
+} // namespace detail
+
 // Escape a string so that it is legal to print it in JSON text.
 void escapeString(
     StringPiece input,
@@ -662,25 +777,22 @@ void escapeString(
   auto* q = reinterpret_cast<const unsigned char*>(input.begin());
   auto* e = reinterpret_cast<const unsigned char*>(input.end());
 
+  // Since non-ascii encoding inherently does utf8 validation
+  // we explicitly validate utf8 only if non-ascii encoding is disabled.
+  bool checkUtf8 = (opts.validate_utf8 || opts.skip_invalid_utf8) &&
+      !opts.encode_non_ascii;
+  bool checkedRest = false;
+
   while (p < e) {
     // Find the longest prefix that does not need escaping, and copy
-    // it literally into the output string.
-    auto firstEsc = p;
-    while (firstEsc < e) {
-      auto avail = e - firstEsc;
-      uint64_t word = 0;
-      if (avail >= 8) {
-        word = folly::loadUnaligned<uint64_t>(firstEsc);
-      } else {
-        memcpy(static_cast<void*>(&word), firstEsc, avail);
-      }
-      auto prefix = firstEscapableInWord(word);
-      DCHECK_LE(prefix, avail);
-      firstEsc += prefix;
-      if (prefix < 8) {
-        break;
-      }
-    }
+    // it literally into the output string.  Without validation or
+    // encoding, that includes non-ascii bytes.
+    auto firstEsc = p +
+        detail::firstEscapable(
+            StringPiece(
+                reinterpret_cast<const char*>(p),
+                reinterpret_cast<const char*>(e)),
+            checkUtf8 || opts.encode_non_ascii);
     if (firstEsc > p) {
       out.append(reinterpret_cast<const char*>(p), firstEsc - p);
       p = firstEsc;
@@ -693,10 +805,21 @@ void escapeString(
 
     // Handle the next byte that may need escaping.
 
-    // Since non-ascii encoding inherently does utf8 validation
-    // we explicitly validate utf8 only if non-ascii encoding is disabled.
-    if ((opts.validate_utf8 || opts.skip_invalid_utf8)
-        && !opts.encode_non_ascii) {
+    if (checkUtf8 && !checkedRest && (*p & 0x80)) {
+      // Everything before p is ascii.  If the rest is valid (up to
+      // U+FFFF, like utf8ToCodePoint()), there is nothing left to check
+      // or replace, and it can be copied in bulk.
+      checkedRest = true;
+      if (utf8Valid(
+              StringPiece(
+                  reinterpret_cast<const char*>(p),
+                  reinterpret_cast<const char*>(e)),
+              true)) {
+        checkUtf8 = false;
+        continue;
+      }
+    }
+    if (checkUtf8) {
       // To achieve better spatial and temporal coherence
       // we do utf8 validation progressively along with the
       // string-escaping instead of two separate passes.
@@ -754,6 +877,16 @@ void escapeString(
   out.push_back('\"');
 }
 
+std::string parse_error::what() const {
+  return to<std::string>(
+      "json parse error on line ",
+      line,
+      !context.empty() ? to<std::string>(" near `", context, '\'') : "",
+      ": ",
+      conversionCode != ConversionCode::SUCCESS ? "invalid number " : "",
+      message);
+}
+
 std::string stripComments(StringPiece jsonC) {
   std::string result;
   enum class State {
@@ -824,7 +957,25 @@ dynamic parseJson(StringPiece range) {
 dynamic parseJson(
     StringPiece range,
     json::serialization_opts const& opts) {
+  auto ret = tryParseJson(range, opts);
+  if (!ret) {
+    auto& error = ret.error();
+    if (error.conversionCode != ConversionCode::SUCCESS) {
+      // As to<>() would have thrown it
+      throw makeConversionError(error.conversionCode, error.message);
+    }
+    throw json::ParseError(error);
+  }
+  return std::move(ret.value());
+}
+
+Expected<dynamic, json::parse_error> tryParseJson(StringPiece range) {
+  return tryParseJson(range, json::serialization_opts());
+}
 
+Expected<dynamic, json::parse_error> tryParseJson(
+    StringPiece range,
+    json::serialization_opts const& opts) {
   json::Input in(range, &opts);
 
   auto ret = parseValue(in);
@@ -832,6 +983,9 @@ dynamic parseJson(
   if (in.size() && *in != '\0') {
     in.error("parsing didn't consume all input");
   }
+  if (in.failed()) {
+    return makeUnexpected(std::move(in.getError()));
+  }
   return ret;
 }
 
@@ -43,6 +43,8 @@
 #include <iosfwd>
 #include <string>
 
+#include <folly/Conv.h>
+#include <folly/Expected.h>
 #include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/dynamic.h>
@@ -144,10 +146,34 @@ void escapeString(
     std::string& out,
     const serialization_opts& opts);
 
+namespace detail {
+/*
+ * Length of the longest prefix of s that escapeString() copies unchanged:
+ * up to the first control character, quote, backslash or, with nonAscii,
+ * non-ASCII byte.  Scans 16 bytes at a time with SSE2, 32 with AVX2.
+ */
+size_t firstEscapable(StringPiece s, bool nonAscii = true);
+} // namespace detail
+
 /*
  * Strip all C99-like comments (i.e. // and / * ... * /)
  */
 std::string stripComments(StringPiece jsonC);
+
+/*
+ * Why tryParseJson() failed: what it expected, on which line (from 0), and
+ * the input that follows.  For a number out of range, conversionCode says
+ * why, and message is the number.
+ */
+struct parse_error {
+  unsigned line;
+  std::string context;
+  std::string message;
+  ConversionCode conversionCode{ConversionCode::SUCCESS};
+
+  // The message parseJson() throws with
+  std::string what() const;
+};
 } // namespace json
 
 //////////////////////////////////////////////////////////////////////
@@ -159,6 +185,16 @@ std::string stripComments(StringPiece jsonC);
 dynamic parseJson(StringPiece, json::serialization_opts const&);
 dynamic parseJson(StringPiece);
 
+/*
+ * As parseJson(), but returns the error rather than throwing it.  No
+ * exception is thrown on invalid input, so this is much cheaper when
+ * rejecting input is common.
+ */
+Expected<dynamic, json::parse_error> tryParseJson(
+    StringPiece,
+    json::serialization_opts const&);
+Expected<dynamic, json::parse_error> tryParseJson(StringPiece);
+
 /*
  * Serialize a dynamic into a json string.
  */
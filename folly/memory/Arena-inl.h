@@ -31,7 +31,9 @@ Arena<Alloc>::Block::allocate(Alloc& alloc, size_t size, bool allowSlack) {
   }
 
   void* mem = alloc.allocate(allocSize);
-  return std::make_pair(new (mem) Block(), allocSize - sizeof(Block));
+  auto block = new (mem) Block();
+  block->size = allocSize - sizeof(Block);
+  return std::make_pair(block, block->size);
 }
 
 template <class Alloc>
@@ -45,6 +47,21 @@ void* Arena<Alloc>::allocateSlow(size_t size) {
   std::pair<Block*, size_t> p;
   char* start;
 
+  if (size <= minBlockSize() && !spareBlocks_.empty()) {
+    // Reuse a block kept by reset(); merge() only keeps spare blocks that
+    // are at least minBlockSize()
+    Block& block = spareBlocks_.front();
+    assert(block.size >= size);
+    spareBlocks_.pop_front();
+    spareSize_ -= block.size;
+    blocks_.push_front(block);
+    blocksSize_ += block.size;
+    start = block.start();
+    ptr_ = start + size;
+    end_ = start + block.size;
+    return start;
+  }
+
   size_t allocSize = std::max(size, minBlockSize()) + sizeof(Block);
   if (sizeLimit_ != kNoSizeLimit &&
       allocSize > sizeLimit_ - totalAllocatedSize_) {
@@ -52,18 +69,18 @@ void* Arena<Alloc>::allocateSlow(size_t size) {
   }
 
   if (size > minBlockSize()) {
-    // Allocate a large block for this chunk only, put it at the back of the
-    // list so it doesn't get used for small allocations; don't change ptr_
-    // and end_, let them point into a normal block (or none, if they're
-    // null)
+    // Allocate a large block for this chunk only, keep it apart so it
+    // doesn't get used for small allocations; don't change ptr_ and end_,
+    // let them point into a normal block (or none, if they're null)
     p = Block::allocate(alloc(), size, false);
     start = p.first->start();
-    blocks_.push_back(*p.first);
+    largeBlocks_.push_front(*p.first);
   } else {
     // Allocate a normal sized block and carve out size bytes from it
     p = Block::allocate(alloc(), minBlockSize(), true);
     start = p.first->start();
     blocks_.push_front(*p.first);
+    blocksSize_ += p.second;
     ptr_ = start + size;
     end_ = start + p.second;
   }
@@ -77,17 +94,52 @@ template <class Alloc>
 void Arena<Alloc>::merge(Arena<Alloc>&& other) {
   blocks_.splice_after(blocks_.before_begin(), other.blocks_);
   other.blocks_.clear();
+  largeBlocks_.splice_after(largeBlocks_.before_begin(), other.largeBlocks_);
+  other.largeBlocks_.clear();
+  // Spare blocks of an arena with a smaller minBlockSize() couldn't hold
+  // the allocations allocateSlow() reuses spare blocks for
+  other.spareBlocks_.remove_and_dispose_if(
+      [this](const Block& b) { return b.size < minBlockSize(); },
+      [this, &other](Block* b) {
+        other.spareSize_ -= b->size;
+        other.totalAllocatedSize_ -= b->size + sizeof(Block);
+        b->deallocate(this->alloc());
+      });
+  spareBlocks_.splice_after(spareBlocks_.before_begin(), other.spareBlocks_);
+  other.spareBlocks_.clear();
   other.ptr_ = other.end_ = nullptr;
   totalAllocatedSize_ += other.totalAllocatedSize_;
   other.totalAllocatedSize_ = 0;
+  blocksSize_ += other.blocksSize_;
+  other.blocksSize_ = 0;
+  spareSize_ += other.spareSize_;
+  other.spareSize_ = 0;
+}
+
+template <class Alloc>
+void Arena<Alloc>::reset(size_t maxSpareSize) {
+  auto disposer = [this] (Block* b) {
+    totalAllocatedSize_ -= b->size + sizeof(Block);
+    b->deallocate(this->alloc());
+  };
+  largeBlocks_.clear_and_dispose(disposer);
+  spareBlocks_.splice_after(spareBlocks_.before_begin(), blocks_);
+  spareSize_ += blocksSize_;
+  blocksSize_ = 0;
+  while (spareSize_ > maxSpareSize) {
+    spareSize_ -= spareBlocks_.front().size;
+    spareBlocks_.pop_front_and_dispose(disposer);
+  }
+  ptr_ = end_ = nullptr;
+  bytesUsed_ = 0;
 }
 
 template <class Alloc>
 Arena<Alloc>::~Arena() {
   auto disposer = [this] (Block* b) { b->deallocate(this->alloc()); };
-  while (!blocks_.empty()) {
-    blocks_.pop_front_and_dispose(disposer);
-  }
+  blocks_.clear_and_dispose(disposer);
+  largeBlocks_.clear_and_dispose(disposer);
+  spareBlocks_.clear_and_dispose(disposer);
 }
 
 } // namespace folly
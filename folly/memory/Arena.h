@@ -107,6 +107,12 @@ class Arena {
   // Transfer ownership of all memory allocated from "other" to "this".
   void merge(Arena&& other);
 
+  // Frees everything allocated so far at once, e.g. at the end of a
+  // request. The blocks of minBlockSize are kept, up to maxSpareSize bytes
+  // of them, and reused by the following allocations before new blocks are
+  // allocated; larger blocks are freed. Only the blocks freed take time.
+  void reset(size_t maxSpareSize = std::numeric_limits<size_t>::max());
+
   // Gets the total memory used by the arena
   size_t totalSize() const {
     return totalAllocatedSize_ + sizeof(Arena);
@@ -120,6 +126,13 @@ class Arena {
     return bytesUsed_;
   }
 
+  // The rest of the current block, which allocate() hasn't handed out yet.
+  // Nothing reads it before allocate() does, so its pages may be given back
+  // to the system while the arena sits idle.
+  std::pair<void*, size_t> unusedSpace() const {
+    return std::make_pair(static_cast<void*>(ptr_), size_t(end_ - ptr_));
+  }
+
   // not copyable
   Arena(const Arena&) = delete;
   Arena& operator=(const Arena&) = delete;
@@ -135,6 +148,8 @@ class Arena {
 
   struct FOLLY_ALIGNED_MAX Block {
     BlockLink link;
+    // Usable bytes, after the header
+    size_t size;
 
     // Allocate a block with at least size bytes of storage.
     // If allowSlack is true, allocate more than size bytes if convenient
@@ -199,7 +214,14 @@ class Arena {
   const Alloc& alloc() const { return allocAndSize_; }
 
   AllocAndSize allocAndSize_;
+  // Blocks of minBlockSize, the current one at the front
   BlockList blocks_;
+  // Blocks allocated for a single large allocation
+  BlockList largeBlocks_;
+  // Blocks of minBlockSize kept by reset(), not handed out yet
+  BlockList spareBlocks_;
+  size_t blocksSize_{0};
+  size_t spareSize_{0};
   char* ptr_;
   char* end_;
   size_t totalAllocatedSize_;
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/HugePageArena.h>
+
+#include <cerrno>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/SysSyscall.h>
+#include <folly/portability/Unistd.h>
+
+#include <glog/logging.h>
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace folly {
+
+constexpr size_t HugePageAlloc::k2MB;
+constexpr size_t HugePageAlloc::k1GB;
+constexpr int HugePageAlloc::kAnyNode;
+constexpr size_t HugePageAlloc::kHeaderSize;
+
+namespace {
+
+// Size of the node mask passed to mbind(); the kernel rejects bits past
+// its own MAX_NUMNODES, so this only needs to be large enough.
+constexpr int kMaxNumaNodes = 1024;
+constexpr size_t kMaskBits = 8 * sizeof(unsigned long);
+
+} // namespace
+
+HugePageAlloc::HugePageAlloc(const Options& options)
+    : options_(options), basePageSize_(size_t(sysconf(_SC_PAGESIZE))) {
+  if (!isPowTwo(options_.pageSize) || options_.pageSize < basePageSize_) {
+    throw std::invalid_argument(
+        to<std::string>("Invalid huge page size: ", options_.pageSize));
+  }
+  if (options_.numaNode < kAnyNode || options_.numaNode >= kMaxNumaNodes) {
+    throw std::invalid_argument(
+        to<std::string>("Invalid NUMA node: ", options_.numaNode));
+  }
+}
+
+size_t HugePageAlloc::goodSize(size_t size) const {
+  auto mask = options_.pageSize - 1;
+  return ((size + kHeaderSize + mask) & ~mask) - kHeaderSize;
+}
+
+void* HugePageAlloc::allocate(size_t size) {
+  if (size > std::numeric_limits<size_t>::max() - 2 * options_.pageSize) {
+    throw std::bad_alloc();
+  }
+  size_t length = goodSize(size) + kHeaderSize;
+  void* p = map(length);
+  *static_cast<size_t*>(p) = length;
+  return static_cast<char*>(p) + kHeaderSize;
+}
+
+void HugePageAlloc::deallocate(void* p) {
+  char* start = static_cast<char*>(p) - kHeaderSize;
+  PCHECK(munmap(start, *reinterpret_cast<size_t*>(start)) == 0);
+}
+
+void* HugePageAlloc::map(size_t length) {
+  constexpr int kProt = PROT_READ | PROT_WRITE;
+  constexpr int kFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+  const size_t pageSize = options_.pageSize;
+
+  void* p = MAP_FAILED;
+  if (options_.explicitPages) {
+#ifdef MAP_HUGETLB
+    int sizeFlag = (findLastSet(pageSize) - 1) << MAP_HUGE_SHIFT;
+    p = mmap(nullptr, length, kProt, kFlags | MAP_HUGETLB | sizeFlag, -1, 0);
+#endif
+    if (p == MAP_FAILED && !options_.fallback) {
+      throw std::bad_alloc();
+    }
+  }
+
+  const bool transparent = p == MAP_FAILED;
+  if (transparent) {
+    // Transparent huge pages are only used for aligned ranges, which mmap
+    // doesn't give us: map enough to contain one, then trim both ends.
+    size_t reserve = length + pageSize - basePageSize_;
+    void* r = mmap(nullptr, reserve, kProt, kFlags, -1, 0);
+    if (r == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    auto begin = reinterpret_cast<uintptr_t>(r);
+    auto start = (begin + pageSize - 1) & ~uintptr_t(pageSize - 1);
+    size_t head = start - begin;
+    size_t tail = reserve - head - length;
+    if (head != 0) {
+      PCHECK(munmap(r, head) == 0);
+    }
+    if (tail != 0) {
+      PCHECK(munmap(reinterpret_cast<void*>(start + length), tail) == 0);
+    }
+    p = reinterpret_cast<void*>(start);
+#ifdef MADV_HUGEPAGE
+    // Fails only if THP is compiled out, in which case we get small pages.
+    madvise(p, length, MADV_HUGEPAGE);
+#endif
+  }
+
+  if (options_.numaNode != kAnyNode) {
+    try {
+      bind(p, length);
+    } catch (...) {
+      munmap(p, length);
+      throw;
+    }
+  }
+
+  if (options_.populate) {
+    size_t stride = transparent ? basePageSize_ : pageSize;
+    auto base = static_cast<volatile char*>(p);
+    for (size_t off = 0; off < length; off += stride) {
+      base[off] = 0;
+    }
+  }
+  return p;
+}
+
+void HugePageAlloc::bind(void* addr, size_t length) const {
+  const int node = options_.numaNode;
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr int kMpolBind = 2;
+  unsigned long mask[kMaxNumaNodes / kMaskBits] = {};
+  mask[node / kMaskBits] = 1UL << (node % kMaskBits);
+  // maxnode counts one past the last bit, as in libnuma.
+  long ret = syscall(
+      SYS_mbind, addr, length, kMpolBind, mask, kMaxNumaNodes + 1, 0);
+  if (ret != 0) {
+    if (errno == ENOSYS && node == 0) {
+      return;
+    }
+    throwSystemError("mbind to NUMA node ", node, " failed");
+  }
+#else
+  (void)addr;
+  (void)length;
+  if (node != 0) {
+    throwSystemErrorExplicit(ENOSYS, "mbind to NUMA node ", node, " failed");
+  }
+#endif
+}
+
+} // namespace folly
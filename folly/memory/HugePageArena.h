@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <folly/Memory.h>
+#include <folly/Portability.h>
+#include <folly/memory/Arena.h>
+
+namespace folly {
+
+/**
+ * Block allocator that maps memory directly from the kernel, backed by
+ * huge pages and optionally bound to one NUMA node.  Meant for large,
+ * long-lived data (hash indices, lookup tables) that is read at random
+ * and would otherwise spend much of its time in dTLB misses.
+ *
+ * Each allocation is its own mapping, rounded up to a whole number of
+ * huge pages, so this is only useful as the block allocator of an Arena;
+ * see HugePageArena below.
+ *
+ * Two kinds of huge pages are supported:
+ *   - transparent (the default): the mapping is aligned to the huge page
+ *     size and madvise(MADV_HUGEPAGE)d.  Works without any system setup
+ *     as long as transparent huge pages are set to "madvise" or "always",
+ *     but the kernel may fall back to 4KB pages when memory is fragmented.
+ *   - explicit: mmap(MAP_HUGETLB) from the pool reserved in
+ *     /sys/kernel/mm/hugepages (or vm.nr_hugepages).  Guaranteed huge
+ *     pages, and the only way to get 1GB ones.  If the pool is exhausted,
+ *     allocation falls back to transparent huge pages, unless fallback is
+ *     disabled, in which case it throws std::bad_alloc.
+ *
+ * With a NUMA node set, pages are bound to that node (mbind(MPOL_BIND))
+ * before they are first touched.  On kernels without NUMA support node 0
+ * is accepted and ignored.  Explicit huge pages are reserved from the
+ * global pool at mmap time but taken from the node's pool on first touch,
+ * so size the per-node pools (and consider setPopulate()) accordingly.
+ */
+class HugePageAlloc {
+ public:
+  static constexpr size_t k2MB = size_t(2) << 20;
+  static constexpr size_t k1GB = size_t(1) << 30;
+  static constexpr int kAnyNode = -1;
+
+  struct Options {
+    Options() {}
+
+    // Power of two, at least the base page size; 2MB or 1GB on x86-64.
+    Options& setPageSize(size_t size) {
+      pageSize = size;
+      return *this;
+    }
+    Options& setExplicit(bool value) {
+      explicitPages = value;
+      return *this;
+    }
+    Options& setFallback(bool value) {
+      fallback = value;
+      return *this;
+    }
+    Options& setNumaNode(int node) {
+      numaNode = node;
+      return *this;
+    }
+    // Fault in all pages at allocation time rather than on first use.
+    Options& setPopulate(bool value) {
+      populate = value;
+      return *this;
+    }
+
+    size_t pageSize = k2MB;
+    bool explicitPages = false;
+    bool fallback = true;
+    int numaNode = kAnyNode;
+    bool populate = false;
+  };
+
+  // Throws std::invalid_argument if the options are inconsistent.
+  explicit HugePageAlloc(const Options& options = Options());
+
+  // The first kHeaderSize bytes of each mapping remember its length, so
+  // sizes of goodSize() fill whole pages.
+  static constexpr size_t kHeaderSize = max_align_v;
+
+  void* allocate(size_t size);
+  void deallocate(void* p);
+
+  size_t goodSize(size_t size) const;
+
+  const Options& options() const {
+    return options_;
+  }
+
+ private:
+  void* map(size_t length);
+  void bind(void* addr, size_t length) const;
+
+  Options options_;
+  size_t basePageSize_;
+};
+
+template <>
+struct ArenaAllocatorTraits<HugePageAlloc> {
+  static size_t goodSize(const HugePageAlloc& alloc, size_t size) {
+    return alloc.goodSize(size);
+  }
+};
+
+/**
+ * Arena whose blocks are huge pages, by default one huge page per block.
+ * Use it with StlAllocator (see HugePageArenaAllocator) to put containers
+ * on huge pages:
+ *
+ *   HugePageArena arena(HugePageAlloc::Options().setNumaNode(0));
+ *   std::vector<Entry, HugePageArenaAllocator<Entry>> index(
+ *       HugePageArenaAllocator<Entry>(&arena));
+ *
+ * Like all Arenas, memory is only returned when the arena is destroyed,
+ * so this is for data that lives about as long as the arena.
+ */
+class HugePageArena : public Arena<HugePageAlloc> {
+ public:
+  // minBlockSize 0 means one huge page, less the block overhead.
+  explicit HugePageArena(
+      const HugePageAlloc::Options& options = HugePageAlloc::Options(),
+      size_t minBlockSize = 0,
+      size_t sizeLimit = kNoSizeLimit,
+      size_t maxAlign = kDefaultMaxAlign)
+      : Arena<HugePageAlloc>(
+            HugePageAlloc(options),
+            minBlockSize != 0 ? minBlockSize
+                              : options.pageSize -
+                    HugePageAlloc::kHeaderSize - kBlockOverhead,
+            sizeLimit,
+            maxAlign) {}
+};
+
+template <>
+struct IsArenaAllocator<HugePageArena> : std::true_type {};
+
+template <class T>
+using HugePageArenaAllocator = StlAllocator<HugePageArena, T>;
+
+} // namespace folly
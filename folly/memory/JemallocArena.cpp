@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/JemallocArena.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+
+namespace folly {
+
+JemallocArena& JemallocArena::forSubsystem(StringPiece name) {
+  struct Registry {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<JemallocArena>> arenas;
+  };
+  // Leaked, as the arenas can't be destroyed anyway
+  static auto registry = new Registry;
+
+  std::lock_guard<std::mutex> g(registry->mutex);
+  auto& arena = registry->arenas[name.str()];
+  if (!arena) {
+    arena = std::make_unique<JemallocArena>();
+    LOG_IF(INFO, arena->enabled())
+        << "Created jemalloc arena " << arena->index() << " for " << name;
+  }
+  return *arena;
+}
+
+JemallocArena::JemallocArena() {
+  if (!usingJEMalloc()) {
+    return;
+  }
+  size_t len = sizeof(index_);
+  int ret = mallctl("arenas.create", &index_, &len, nullptr, 0);
+  if (ret == ENOENT) {
+    // Before jemalloc 5
+    len = sizeof(index_);
+    ret = mallctl("arenas.extend", &index_, &len, nullptr, 0);
+  }
+  if (ret != 0) {
+    LOG(ERROR) << "Unable to create a jemalloc arena: " << errnoStr(ret);
+    index_ = 0;
+    return;
+  }
+  flags_ = MALLOCX_ARENA(index_) | MALLOCX_TCACHE_NONE;
+  enabled_ = true;
+}
+
+// jemalloc's *allocx() don't accept a size of 0, or a null pointer
+void* JemallocArena::allocate(size_t size) {
+  return enabled_ ? mallocx(std::max(size, size_t(1)), flags_) : malloc(size);
+}
+
+void* JemallocArena::reallocate(void* p, size_t size) {
+  if (!enabled_) {
+    return realloc(p, size);
+  }
+  if (p == nullptr) {
+    return allocate(size);
+  }
+  return rallocx(p, std::max(size, size_t(1)), flags_);
+}
+
+void JemallocArena::deallocate(void* p) {
+  if (!enabled_) {
+    free(p);
+  } else if (p != nullptr) {
+    dallocx(p, flags_);
+  }
+}
+
+void JemallocArena::deallocate(void* p, size_t size) {
+  if (!enabled_) {
+    free(p);
+  } else if (p != nullptr) {
+    sdallocx(p, std::max(size, size_t(1)), flags_);
+  }
+}
+
+unsigned JemallocArena::bindCurrentThread() const {
+  unsigned previous = 0;
+  if (enabled_) {
+    mallctlReadWrite("thread.arena", &previous, index_);
+  }
+  return previous;
+}
+
+void JemallocArena::purge() {
+  if (enabled_) {
+    mallctlCall(to<std::string>("arena.", index_, ".purge").c_str());
+  }
+}
+
+JemallocArenaBinding::JemallocArenaBinding(const JemallocArena& arena) {
+  if (arena.enabled()) {
+    previous_ = arena.bindCurrentThread();
+    bound_ = true;
+  }
+}
+
+JemallocArenaBinding::~JemallocArenaBinding() {
+  if (bound_) {
+    // Can't fail, the thread was using that arena a moment ago
+    mallctl("thread.arena", nullptr, nullptr, &previous_, sizeof(previous_));
+  }
+}
+
+void flushThreadMallocCache() {
+  if (usingJEMalloc()) {
+    // Not using mallctlCall as this will fail if tcache is disabled.
+    mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0);
+  }
+}
+
+bool setThreadMallocCacheEnabled(bool enabled) {
+  if (!usingJEMalloc()) {
+    return false;
+  }
+  bool previous = false;
+  size_t len = sizeof(previous);
+  if (mallctl(
+          "thread.tcache.enabled",
+          &previous,
+          &len,
+          &enabled,
+          sizeof(enabled))) {
+    // Built without tcache support
+    return false;
+  }
+  return previous;
+}
+
+} // namespace folly
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Dedicated jemalloc arenas, and control of the calling thread's arena and
+// tcache.
+// http://www.canonware.com/download/jemalloc/jemalloc-latest/doc/jemalloc.html
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+/**
+ * A jemalloc arena of its own, so that a subsystem's allocations (IOBuf
+ * data, cache values...) don't share pages, and the locks guarding them,
+ * with everyone else's: memory freed by one subsystem then can't leave the
+ * pages of another fragmented, and the subsystems don't contend with each
+ * other for arena locks.
+ *
+ * Allocations bypass the thread's tcache (MALLOCX_TCACHE_NONE), whose
+ * cached objects may come from any arena.  Threads that only work for one
+ * subsystem can instead bindCurrentThread() to its arena, after which plain
+ * malloc() and new allocate from it, tcache included.
+ *
+ * jemalloc can't give arenas back, so they live as long as the process:
+ * create a few, for long-lived subsystems, and get them with forSubsystem()
+ * rather than creating one per object.
+ *
+ * If the process isn't using jemalloc, allocate() and deallocate() fall back
+ * to malloc() and free(), and enabled() is false.
+ */
+class JemallocArena {
+ public:
+  /**
+   * The arena for the named subsystem, created on first use.
+   */
+  static JemallocArena& forSubsystem(StringPiece name);
+
+  /**
+   * Creates a new arena.
+   */
+  JemallocArena();
+
+  JemallocArena(const JemallocArena&) = delete;
+  JemallocArena& operator=(const JemallocArena&) = delete;
+
+  bool enabled() const {
+    return enabled_;
+  }
+  unsigned index() const {
+    return index_;
+  }
+  // The flags to pass to mallocx() and friends to use this arena
+  int flags() const {
+    return flags_;
+  }
+
+  void* allocate(size_t size);
+  void* reallocate(void* p, size_t size);
+  void deallocate(void* p);
+  // size must be what was passed to allocate()
+  void deallocate(void* p, size_t size);
+
+  /**
+   * Makes malloc() on the calling thread allocate from this arena, and
+   * returns the arena it used before.  Throws std::runtime_error if
+   * jemalloc refuses.
+   */
+  unsigned bindCurrentThread() const;
+
+  /**
+   * Returns this arena's unused dirty pages to the system.
+   */
+  void purge();
+
+ private:
+  unsigned index_{0};
+  int flags_{0};
+  bool enabled_{false};
+};
+
+/**
+ * Binds the calling thread to an arena while in scope, and back to the one
+ * it used before on destruction.
+ */
+class JemallocArenaBinding {
+ public:
+  explicit JemallocArenaBinding(const JemallocArena& arena);
+  ~JemallocArenaBinding();
+
+  JemallocArenaBinding(const JemallocArenaBinding&) = delete;
+  JemallocArenaBinding& operator=(const JemallocArenaBinding&) = delete;
+
+ private:
+  unsigned previous_{0};
+  bool bound_{false};
+};
+
+/**
+ * A standard allocator allocating from a JemallocArena, e.g.
+ *
+ *   JemallocArenaAllocator<int> alloc(JemallocArena::forSubsystem("cache"));
+ *   std::vector<int, JemallocArenaAllocator<int>> v(alloc);
+ */
+template <class T>
+class JemallocArenaAllocator {
+  static_assert(
+      alignof(T) <= alignof(std::max_align_t),
+      "JemallocArenaAllocator doesn't support over-aligned types");
+
+ public:
+  using value_type = T;
+
+  explicit JemallocArenaAllocator(JemallocArena& arena) : arena_(&arena) {}
+
+  template <class U>
+  /* implicit */ JemallocArenaAllocator(
+      const JemallocArenaAllocator<U>& other)
+      : arena_(&other.arena()) {}
+
+  T* allocate(size_t n) {
+    void* p = arena_->allocate(n * sizeof(T));
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t n) {
+    arena_->deallocate(p, n * sizeof(T));
+  }
+
+  JemallocArena& arena() const {
+    return *arena_;
+  }
+
+  template <class U>
+  bool operator==(const JemallocArenaAllocator<U>& other) const {
+    return arena_ == &other.arena();
+  }
+  template <class U>
+  bool operator!=(const JemallocArenaAllocator<U>& other) const {
+    return arena_ != &other.arena();
+  }
+
+ private:
+  JemallocArena* arena_;
+};
+
+/**
+ * Returns the objects cached in the calling thread's tcache to their
+ * arenas.  Does nothing if not using jemalloc, or if the tcache is
+ * disabled.
+ */
+void flushThreadMallocCache();
+
+/**
+ * Enables or disables the calling thread's tcache, and returns whether it
+ * was enabled.  Disabling it flushes it and frees the cache itself, which an
+ * idle thread doesn't need; see MemoryIdler::disableMallocCacheWhileIdle.
+ * Returns false, and does nothing, if not using jemalloc.
+ */
+bool setThreadMallocCacheEnabled(bool enabled);
+
+} // namespace folly
@@ -36,6 +36,12 @@
 # ifndef MALLOCX_ZERO
 #  define MALLOCX_ZERO (static_cast<int>(0x40))
 # endif
+# ifndef MALLOCX_TCACHE_NONE
+#  define MALLOCX_TCACHE_NONE (static_cast<int>(0x100))
+# endif
+# ifndef MALLOCX_ARENA
+#  define MALLOCX_ARENA(a) (static_cast<int>(((unsigned)(a) + 1) << 20))
+# endif
 #endif
 
 // If using fbstring from libstdc++ (see comment in FBString.h), then
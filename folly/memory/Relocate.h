@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Relocation: moving objects to other memory and ending their lifetime in
+ * the old one, as containers do when they grow, or when they shift their
+ * elements to insert or erase some.
+ *
+ * For the types for which IsRelocatable (see Traits.h) holds, that's a
+ * memcpy() or memmove(), with no constructor or destructor calls.  For
+ * other types, it's a move construction and a destruction per object.
+ * Containers that allocate with a custom allocator must check
+ * IsRelocatableWith, as relocating skips the allocator's construct() and
+ * destroy().
+ */
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Traits.h>
+
+namespace folly {
+
+/**
+ * Whether a container that uses Alloc may relocate objects of type T with
+ * memcpy(): T is relocatable, and Alloc is std::allocator, whose
+ * construct() and destroy() do nothing else than calling the constructor
+ * and the destructor.
+ */
+template <class T, class Alloc>
+struct IsRelocatableWith
+    : std::integral_constant<
+          bool,
+          IsRelocatable<T>::value &&
+              std::is_same<Alloc, std::allocator<T>>::value> {};
+
+namespace detail {
+
+template <class T>
+T* uninitialized_relocate_impl(T* first, T* last, T* out, std::true_type) {
+  if (first != last) {
+    std::memcpy(
+        static_cast<void*>(out),
+        static_cast<const void*>(first),
+        (last - first) * sizeof(T));
+  }
+  return out + (last - first);
+}
+
+template <class T>
+T* uninitialized_relocate_impl(T* first, T* last, T* out, std::false_type) {
+  T* dest = out;
+  try {
+    for (T* it = first; it != last; ++it, ++dest) {
+      new (dest) T(std::move_if_noexcept(*it));
+    }
+  } catch (...) {
+    for (T* it = out; it != dest; ++it) {
+      it->~T();
+    }
+    throw;
+  }
+  for (T* it = first; it != last; ++it) {
+    it->~T();
+  }
+  return dest;
+}
+
+} // namespace detail
+
+/**
+ * Relocate the objects of [first, last) to the uninitialized memory
+ * starting at out, which must not overlap [first, last).  Afterwards,
+ * [first, last) is uninitialized memory.  Returns the end of the objects
+ * at out.
+ *
+ * Relocatable objects are copied with memcpy().  Others are moved if that
+ * can't throw and copied otherwise (as with std::move_if_noexcept), and
+ * then destroyed; if a copy throws, the objects constructed at out are
+ * destroyed and [first, last) is left as it was.
+ */
+template <class T>
+T* uninitialized_relocate(T* first, T* last, T* out) {
+  return detail::uninitialized_relocate_impl(
+      first, last, out, IsRelocatable<T>());
+}
+
+/**
+ * Relocate the objects of [first, last) to dest, within the same block of
+ * memory: the ranges may overlap, and the part of the destination that
+ * [first, last) doesn't cover must be uninitialized.  Never throws.
+ *
+ * Only valid if IsRelocatable<T>; other types need moves or assignments
+ * that depend on the direction, which the containers do themselves.  Not
+ * checked at compile time, so that containers can call it on a branch
+ * that only relocatable types take.
+ */
+template <class T>
+void relocate_overlapping(T* first, T* last, T* dest) noexcept {
+  if (first != last) {
+    std::memmove(
+        static_cast<void*>(dest),
+        static_cast<const void*>(first),
+        (last - first) * sizeof(T));
+  }
+}
+
+} // namespace folly
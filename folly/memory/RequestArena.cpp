@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/RequestArena.h>
+
+#include <memory>
+#include <mutex>
+
+#include <folly/ThreadLocal.h>
+
+namespace folly {
+
+namespace {
+
+// Blocks of the RequestArenas the thread destroyed, for the next ones it
+// creates
+struct BlockCache : public SysArena {
+  BlockCache() : SysArena(RequestArena::kMinBlockSize) {}
+};
+
+struct BlockCacheTag {};
+
+ThreadLocal<BlockCache, BlockCacheTag> blockCache;
+
+} // namespace
+
+RequestArena* RequestArena::get() {
+  static const RequestToken token("folly::RequestArena");
+  auto context = RequestContext::try_get();
+  if (!context) {
+    return nullptr;
+  }
+  if (auto data = context->getContextData(token)) {
+    return static_cast<RequestArena*>(data);
+  }
+  auto arena = std::make_unique<RequestArena>();
+  auto result = arena.get();
+  if (context->setContextDataIfAbsent(token, std::move(arena))) {
+    return result;
+  }
+  // Another thread created it first
+  return static_cast<RequestArena*>(context->getContextData(token));
+}
+
+RequestArena::RequestArena()
+    : owner_(std::this_thread::get_id()),
+      arena_(kMinBlockSize),
+      sharedArena_(kMinBlockSize) {
+  arena_.merge(std::move(*blockCache));
+}
+
+RequestArena::~RequestArena() {
+  auto& cache = *blockCache;
+  cache.merge(std::move(arena_));
+  cache.merge(std::move(sharedArena_));
+  cache.reset(kMaxCachedSize);
+}
+
+void* RequestArena::allocateShared(size_t size) {
+  std::lock_guard<MicroSpinLock> guard(sharedLock_);
+  return sharedArena_.allocate(size);
+}
+
+} // namespace folly
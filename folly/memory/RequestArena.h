@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <thread>
+#include <type_traits>
+
+#include <folly/Likely.h>
+#include <folly/Memory.h>
+#include <folly/MicroSpinLock.h>
+#include <folly/io/async/Request.h>
+#include <folly/memory/Arena.h>
+
+namespace folly {
+
+/**
+ * Request-scoped arena: memory allocated for a request is freed all at
+ * once, when its RequestContext is destroyed.
+ *
+ *   RequestContextScopeGuard guard;
+ *   ...
+ *   auto arena = RequestArena::get();
+ *   std::vector<int, RequestArenaAllocator<int>> v(
+ *       RequestArenaAllocator<int>(arena));
+ *
+ * The arena of a request belongs to the thread that first asked for it,
+ * which allocates from it by bumping a pointer, without synchronization;
+ * other threads working on the request share a second arena, under a spin
+ * lock.
+ *
+ * When a RequestArena is destroyed, the blocks of both arenas (up to
+ * kMaxCachedSize bytes) are kept by the thread destroying it, and handed
+ * to the next RequestArena that thread creates: a thread serving requests
+ * one after the other keeps reusing the same warm memory, instead of
+ * allocating it from malloc() for every request.
+ */
+class RequestArena : public RequestData {
+ public:
+  static constexpr size_t kMinBlockSize = (16 << 10) - SysArena::kBlockOverhead;
+  static constexpr size_t kMaxCachedSize = 1 << 20;
+
+  /**
+   * The arena of the current request, created on first use. Returns
+   * nullptr if no RequestContext was set: memory allocated for the default
+   * context would never be freed.
+   */
+  static RequestArena* get();
+
+  RequestArena();
+  ~RequestArena() override;
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  void* allocate(size_t size) {
+    if (LIKELY(std::this_thread::get_id() == owner_)) {
+      return arena_.allocate(size);
+    }
+    return allocateShared(size);
+  }
+
+  void deallocate(void* /* p */) {
+    // Deallocate? With the request.
+  }
+
+  bool hasCallback() override {
+    return false;
+  }
+
+ private:
+  void* allocateShared(size_t size);
+
+  const std::thread::id owner_;
+  SysArena arena_;
+  MicroSpinLock sharedLock_{0};
+  SysArena sharedArena_;
+};
+
+template <>
+struct IsArenaAllocator<RequestArena> : std::true_type {};
+
+template <class T>
+using RequestArenaAllocator = StlAllocator<RequestArena, T>;
+
+} // namespace folly
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/SlabPool.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/portability/Memory.h>
+
+namespace folly {
+
+namespace {
+
+static_assert(sizeof(uintptr_t) == 8, "SlabPool needs 64-bit pointers");
+
+constexpr unsigned kTagShift = 48;
+constexpr uintptr_t kPointerMask = (uintptr_t(1) << kTagShift) - 1;
+
+template <class T>
+T* untag(uintptr_t v) {
+  return reinterpret_cast<T*>(v & kPointerMask);
+}
+
+uintptr_t retag(const void* p, uintptr_t old) {
+  return reinterpret_cast<uintptr_t>(p) |
+      ((old & ~kPointerMask) + (uintptr_t(1) << kTagShift));
+}
+
+} // namespace
+
+SlabPool::SlabPool(size_t objectSize, size_t alignment, const Options& options)
+    : alignment_(std::max(alignment, alignof(FreeObject))),
+      objectSize_(
+          (std::max(objectSize, sizeof(FreeObject)) + alignment_ - 1) &
+          ~(alignment_ - 1)),
+      magazineSize_(options.magazineSize),
+      slabSize_(std::max(options.slabSize, objectSize_ * magazineSize_)) {
+  if (!isPowTwo(alignment)) {
+    throw std::invalid_argument(
+        to<std::string>("Invalid SlabPool alignment: ", alignment));
+  }
+  if (magazineSize_ == 0) {
+    throw std::invalid_argument("SlabPool magazine size must be positive");
+  }
+}
+
+SlabPool::~SlabPool() {
+  for (void* slab : slabs_) {
+    detail::aligned_free(slab);
+  }
+}
+
+void* SlabPool::allocateSlow() {
+  Cache* c = cache_.get();
+  if (!c) {
+    c = createCache();
+  }
+  if (!c->loaded) {
+    if (c->spare) {
+      std::swap(c->loaded, c->spare);
+      std::swap(c->loadedCount, c->spareCount);
+    } else {
+      size_t count;
+      FreeObject* magazine = popMagazine(count);
+      if (!magazine) {
+        magazine = allocateSlab(count);
+      }
+      c->loaded = magazine;
+      c->loadedCount = count;
+    }
+  }
+  FreeObject* p = c->loaded;
+  c->loaded = p->next;
+  --c->loadedCount;
+  return p;
+}
+
+void SlabPool::deallocateSlow(void* p) {
+  Cache* c = cache_.get();
+  if (!c) {
+    c = createCache();
+  }
+  if (c->loadedCount == magazineSize_) {
+    if (c->spare) {
+      pushMagazine(c->spare, c->spareCount);
+    }
+    c->spare = c->loaded;
+    c->spareCount = c->loadedCount;
+    c->loaded = nullptr;
+    c->loadedCount = 0;
+  }
+  auto obj = static_cast<FreeObject*>(p);
+  obj->next = c->loaded;
+  c->loaded = obj;
+  ++c->loadedCount;
+}
+
+SlabPool::Cache* SlabPool::createCache() {
+  auto cache = new Cache();
+  auto disposer = [this](Cache* c, TLPDestructionMode mode) {
+    std::unique_ptr<Cache> cp(c); // ensure it gets deleted
+    if (mode == TLPDestructionMode::THIS_THREAD) {
+      flushCache(*c);
+    }
+  };
+  cache_.reset(cache, disposer);
+  return cache;
+}
+
+void SlabPool::flushCache(Cache& cache) {
+  if (cache.loaded) {
+    pushMagazine(cache.loaded, cache.loadedCount);
+  }
+  if (cache.spare) {
+    pushMagazine(cache.spare, cache.spareCount);
+  }
+}
+
+void SlabPool::pushMagazine(FreeObject* head, size_t count) {
+  head->count = count;
+  uintptr_t old = depot_.load(std::memory_order_relaxed);
+  do {
+    head->nextMagazine = untag<FreeObject>(old);
+  } while (!depot_.compare_exchange_weak(
+      old,
+      retag(head, old),
+      std::memory_order_release,
+      std::memory_order_relaxed));
+}
+
+SlabPool::FreeObject* SlabPool::popMagazine(size_t& count) {
+  uintptr_t old = depot_.load(std::memory_order_acquire);
+  while (true) {
+    FreeObject* head = untag<FreeObject>(old);
+    if (!head) {
+      return nullptr;
+    }
+    // head may be popped and reused by another thread meanwhile; slabs are
+    // never unmapped, so this read is safe, and the tag fails the exchange.
+    FreeObject* next = head->nextMagazine;
+    if (depot_.compare_exchange_weak(
+            old,
+            retag(next, old),
+            std::memory_order_acquire,
+            std::memory_order_acquire)) {
+      count = head->count;
+      return head;
+    }
+  }
+}
+
+SlabPool::FreeObject* SlabPool::allocateSlab(size_t& count) {
+  auto slab =
+      static_cast<char*>(detail::aligned_malloc(slabSize_, alignment_));
+  if (!slab) {
+    throw std::bad_alloc();
+  }
+  CHECK_EQ(0, (reinterpret_cast<uintptr_t>(slab) + slabSize_) & ~kPointerMask)
+      << "SlabPool needs 48-bit addresses";
+  {
+    std::lock_guard<std::mutex> g(slabsMutex_);
+    try {
+      slabs_.push_back(slab);
+    } catch (...) {
+      detail::aligned_free(slab);
+      throw;
+    }
+  }
+
+  size_t n = slabSize_ / objectSize_;
+  capacity_.fetch_add(n, std::memory_order_relaxed);
+
+  // Link the objects into magazines; keep the first, publish the rest.
+  FreeObject* first = nullptr;
+  for (size_t start = 0; start < n; start += magazineSize_) {
+    size_t end = std::min(n, start + magazineSize_);
+    FreeObject* head = nullptr;
+    for (size_t i = end; i-- > start;) {
+      auto obj = reinterpret_cast<FreeObject*>(slab + i * objectSize_);
+      obj->next = head;
+      head = obj;
+    }
+    if (start == 0) {
+      first = head;
+      count = end;
+    } else {
+      pushMagazine(head, end - start);
+    }
+  }
+  return first;
+}
+
+} // namespace folly
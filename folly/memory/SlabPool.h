@@ -0,0 +1,260 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/ThreadLocal.h>
+#include <folly/experimental/hazptr/memory_resource.h>
+
+namespace folly {
+
+/**
+ * Thread-safe pool of fixed-size objects, for types that are allocated
+ * and freed at a high rate from many threads (connections, requests).
+ *
+ * Free objects are kept in magazines: lists of up to magazineSize objects.
+ * Each thread caches two magazines, so allocate() and deallocate() are a
+ * pointer pop or push on thread-local state in the common case.  Threads
+ * exchange whole magazines with a global depot, a lock-free stack, so a
+ * thread that frees objects allocated by another returns them in batches
+ * of magazineSize rather than one at a time.  A thread that exits hands
+ * its magazines back to the depot.
+ *
+ * When the depot is empty the pool carves a new slab, allocated with
+ * aligned_malloc(), into magazines.  Slabs are only freed when the pool is
+ * destroyed, at which point all objects must have been deallocated (or be
+ * abandoned).  The pool must outlive the threads that use it, or those
+ * threads must not use it after it is destroyed.
+ *
+ * Objects are at least 3 pointers in size, since free objects link
+ * magazines through their storage.  The depot uses a 16-bit tag in the top
+ * bits of a pointer against ABA, which assumes 48-bit user addresses.
+ */
+class SlabPool {
+ public:
+  struct Options {
+    Options() {}
+
+    Options& setMagazineSize(size_t n) {
+      magazineSize = n;
+      return *this;
+    }
+    Options& setSlabSize(size_t n) {
+      slabSize = n;
+      return *this;
+    }
+
+    // Objects moved between a thread and the depot at a time
+    size_t magazineSize = 64;
+    // Bytes of each slab; at least one magazine's worth is always used.
+    size_t slabSize = size_t(256) << 10;
+  };
+
+  // Throws std::invalid_argument if alignment is not a power of two or
+  // magazineSize is 0.
+  explicit SlabPool(
+      size_t objectSize,
+      size_t alignment = max_align_v,
+      const Options& options = Options());
+  ~SlabPool();
+
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+
+  // Throws std::bad_alloc if a new slab is needed and can't be allocated.
+  void* allocate() {
+    Cache* c = cache_.get();
+    if (LIKELY(c != nullptr && c->loaded != nullptr)) {
+      FreeObject* p = c->loaded;
+      c->loaded = p->next;
+      --c->loadedCount;
+      return p;
+    }
+    return allocateSlow();
+  }
+
+  void deallocate(void* p) {
+    Cache* c = cache_.get();
+    if (LIKELY(c != nullptr && c->loadedCount < magazineSize_)) {
+      auto obj = static_cast<FreeObject*>(p);
+      obj->next = c->loaded;
+      c->loaded = obj;
+      ++c->loadedCount;
+      return;
+    }
+    deallocateSlow(p);
+  }
+
+  // Size and alignment of the objects handed out; at least what was asked.
+  size_t objectSize() const {
+    return objectSize_;
+  }
+  size_t alignment() const {
+    return alignment_;
+  }
+
+  // Number of objects in all slabs, allocated or not
+  size_t capacity() const {
+    return capacity_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct FreeObject {
+    FreeObject* next;
+    // Only in the first object of a magazine in the depot
+    FreeObject* nextMagazine;
+    size_t count;
+  };
+
+  // A thread's magazines.  spare is always empty or full.
+  struct Cache {
+    FreeObject* loaded = nullptr;
+    size_t loadedCount = 0;
+    FreeObject* spare = nullptr;
+    size_t spareCount = 0;
+  };
+
+  struct CacheTag {};
+
+  void* allocateSlow();
+  void deallocateSlow(void* p);
+  Cache* createCache();
+  void flushCache(Cache& cache);
+
+  void pushMagazine(FreeObject* head, size_t count);
+  FreeObject* popMagazine(size_t& count);
+  FreeObject* allocateSlab(size_t& count);
+
+  const size_t alignment_;
+  const size_t objectSize_;
+  const size_t magazineSize_;
+  const size_t slabSize_;
+
+  // Tagged pointer to the first magazine in the depot
+  std::atomic<uintptr_t> depot_{0};
+  std::atomic<size_t> capacity_{0};
+
+  std::mutex slabsMutex_;
+  std::vector<void*> slabs_;
+
+  ThreadLocalPtr<Cache, CacheTag> cache_;
+};
+
+/**
+ * std::allocator-compatible allocator drawing single objects of up to
+ * pool->objectSize() bytes from a SlabPool; arrays and larger types
+ * (after rebinding) go to operator new.  This makes it usable with node
+ * based containers and std::allocate_shared.
+ */
+template <class T>
+class SlabPoolAllocator {
+ public:
+  using value_type = T;
+
+  explicit SlabPoolAllocator(SlabPool* pool) : pool_(pool) {}
+
+  template <class U>
+  /* implicit */ SlabPoolAllocator(const SlabPoolAllocator<U>& other)
+      : pool_(other.pool()) {}
+
+  T* allocate(size_t n) {
+    if (usePool(n)) {
+      return static_cast<T*>(pool_->allocate());
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (usePool(n)) {
+      pool_->deallocate(p);
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  SlabPool* pool() const {
+    return pool_;
+  }
+
+  template <class U>
+  bool operator==(const SlabPoolAllocator<U>& other) const {
+    return pool_ == other.pool();
+  }
+  template <class U>
+  bool operator!=(const SlabPoolAllocator<U>& other) const {
+    return pool_ != other.pool();
+  }
+
+ private:
+  bool usePool(size_t n) const {
+    return n == 1 && sizeof(T) <= pool_->objectSize() &&
+        alignof(T) <= pool_->alignment();
+  }
+
+  SlabPool* pool_;
+};
+
+/**
+ * hazptr::memory_resource drawing allocations that fit from a SlabPool,
+ * and the rest from upstream.  Install it with
+ * hazptr::set_default_resource() to pool hazptr's own allocations.
+ */
+class SlabPoolResource : public hazptr::memory_resource {
+ public:
+  explicit SlabPoolResource(
+      SlabPool* pool,
+      hazptr::memory_resource* upstream = hazptr::new_delete_resource())
+      : pool_(pool), upstream_(upstream) {}
+
+  void* allocate(const size_t bytes, const size_t alignment = max_align_v)
+      override {
+    if (fits(bytes, alignment)) {
+      return pool_->allocate();
+    }
+    return upstream_->allocate(bytes, alignment);
+  }
+
+  void deallocate(
+      void* p,
+      const size_t bytes,
+      const size_t alignment = max_align_v) override {
+    if (fits(bytes, alignment)) {
+      pool_->deallocate(p);
+    } else {
+      upstream_->deallocate(p, bytes, alignment);
+    }
+  }
+
+ private:
+  bool fits(size_t bytes, size_t alignment) const {
+    return bytes <= pool_->objectSize() && alignment <= pool_->alignment();
+  }
+
+  SlabPool* pool_;
+  hazptr::memory_resource* upstream_;
+};
+
+} // namespace folly
@@ -18,21 +18,42 @@
 
 #include <memory>
 
+#include <folly/detail/MemoryIdler.h>
+
 namespace folly {
 
 ThreadCachedArena::ThreadCachedArena(size_t minBlockSize, size_t maxAlign)
   : minBlockSize_(minBlockSize), maxAlign_(maxAlign) {
 }
 
+namespace {
+
+// A thread's arena, and the callback giving the unused rest of its current
+// block back to the system when the thread goes idle.
+struct ThreadArena : public SysArena {
+  using SysArena::SysArena;
+
+  detail::MemoryIdler::IdleCallback idleCallback;
+};
+
+} // namespace
+
 SysArena* ThreadCachedArena::allocateThreadLocalArena() {
-  SysArena* arena =
-    new SysArena(minBlockSize_, SysArena::kNoSizeLimit, maxAlign_);
+  auto arena =
+    new ThreadArena(minBlockSize_, SysArena::kNoSizeLimit, maxAlign_);
   auto disposer = [this] (SysArena* t, TLPDestructionMode mode) {
-    std::unique_ptr<SysArena> tp(t);  // ensure it gets deleted
+    // ensure it gets deleted
+    std::unique_ptr<ThreadArena> tp(static_cast<ThreadArena*>(t));
+    // Waits for the callback if the thread is running it right now
+    tp->idleCallback.reset();
     if (mode == TLPDestructionMode::THIS_THREAD) {
       zombify(std::move(*t));
     }
   };
+  arena->idleCallback = detail::MemoryIdler::addIdleCallback([arena] {
+    auto unused = arena->unusedSpace();
+    return detail::MemoryIdler::releasePages(unused.first, unused.second);
+  });
   arena_.reset(arena, disposer);
   return arena;
 }
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <limits>
 #include <type_traits>
 
 #include <folly/Likely.h>
@@ -35,6 +36,9 @@ namespace folly {
  * For speed, each thread gets its own Arena (see Arena.h); when threads
  * exit, the Arena gets merged into a "zombie" Arena, which will be deallocated
  * when the ThreadCachedArena object is destroyed.
+ *
+ * When a thread goes idle (see MemoryIdler::releaseIdleMemory()), the pages
+ * its Arena hasn't handed out yet are given back to the system.
  */
 class ThreadCachedArena {
  public:
@@ -55,6 +59,19 @@ class ThreadCachedArena {
     // Deallocate? Never!
   }
 
+  /**
+   * Frees everything the calling thread allocated from the arena, e.g. at
+   * the end of a request handled by this thread, keeping up to
+   * maxSpareSize bytes of its blocks for its next allocations (see
+   * Arena::reset()). Memory of other threads isn't affected.
+   */
+  void resetThreadArena(
+      size_t maxSpareSize = std::numeric_limits<size_t>::max()) {
+    if (SysArena* arena = arena_.get()) {
+      arena->reset(maxSpareSize);
+    }
+  }
+
   // Gets the total memory used by the arena
   size_t totalSize() const;
 
@@ -18,6 +18,7 @@
 #include <folly/Memory.h>
 #include <folly/portability/GTest.h>
 
+#include <cstring>
 #include <set>
 #include <vector>
 
@@ -146,6 +147,20 @@ TEST(Arena, Vector) {
   }
 }
 
+TEST(Arena, UnusedSpace) {
+  static const size_t requestedBlockSize = 64 << 10;
+  SysArena arena(requestedBlockSize);
+  EXPECT_EQ(0, arena.unusedSpace().second);
+
+  auto p = static_cast<char*>(arena.allocate(100));
+  auto unused = arena.unusedSpace();
+  EXPECT_LE(p + 100, unused.first);
+  EXPECT_LE(requestedBlockSize - 200, unused.second);
+  // It's what allocate() hands out next
+  EXPECT_EQ(unused.first, arena.allocate(1));
+  EXPECT_GT(unused.second, arena.unusedSpace().second);
+}
+
 TEST(Arena, SizeLimit) {
   static const size_t requestedBlockSize = sizeof(size_t);
   static const size_t maxSize = 10 * requestedBlockSize;
@@ -168,6 +183,70 @@ TEST(Arena, MoveArena) {
   EXPECT_EQ(bytesUsed, moved.bytesUsed());
 }
 
+TEST(Arena, Reset) {
+  static const size_t requestedBlockSize = 1024;
+  SysArena arena(requestedBlockSize);
+  std::set<void*> blocks;
+  for (int i = 0; i < 4; ++i) {
+    blocks.insert(arena.allocate(requestedBlockSize));
+  }
+  arena.allocate(10 * requestedBlockSize);
+  auto warmSize = arena.totalSize();
+
+  // The large block is freed, and the others reused in turn
+  arena.reset();
+  EXPECT_EQ(0, arena.bytesUsed());
+  EXPECT_EQ(0, arena.unusedSpace().second);
+  EXPECT_GT(warmSize - 10 * requestedBlockSize, arena.totalSize());
+  auto resetSize = arena.totalSize();
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(1, blocks.count(arena.allocate(requestedBlockSize)));
+  }
+  EXPECT_EQ(resetSize, arena.totalSize());
+  EXPECT_EQ(4 * requestedBlockSize, arena.bytesUsed());
+  arena.allocate(requestedBlockSize);
+  EXPECT_LT(resetSize, arena.totalSize());
+
+  // Keeping at most one block
+  arena.reset(requestedBlockSize + SysArena::kBlockOverhead);
+  EXPECT_GE(
+      sizeof(SysArena) + goodMallocSize(
+                             requestedBlockSize + SysArena::kBlockOverhead),
+      arena.totalSize());
+  arena.reset(0);
+  EXPECT_EQ(sizeof(SysArena), arena.totalSize());
+  EXPECT_NE(nullptr, arena.allocate(1));
+}
+
+TEST(Arena, MergeReset) {
+  static const size_t requestedBlockSize = 1024;
+  SysArena arena(requestedBlockSize);
+  SysArena other(requestedBlockSize);
+  auto p = other.allocate(requestedBlockSize);
+  other.allocate(2 * requestedBlockSize);
+  other.reset();
+  auto otherSize = other.totalSize();
+  arena.merge(std::move(other));
+  EXPECT_EQ(sizeof(SysArena), other.totalSize());
+  EXPECT_EQ(otherSize, arena.totalSize());
+  // The spare block comes along
+  EXPECT_EQ(p, arena.allocate(1));
+}
+
+TEST(Arena, MergeResetSmallerBlocks) {
+  SysArena arena(64 * 1024);
+  SysArena other(1024);
+  other.allocate(16);
+  other.reset();
+  arena.merge(std::move(other));
+  // The spare block of other is too small to be reused for this
+  auto p = arena.allocate(32 * 1024);
+  memset(p, 0, 32 * 1024);
+  // ... and was freed by merge()
+  EXPECT_GE(arena.totalSize(), sizeof(SysArena) + 64 * 1024);
+  EXPECT_LT(arena.totalSize(), sizeof(SysArena) + 66 * 1024);
+}
+
 int main(int argc, char *argv[]) {
   testing::InitGoogleTest(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
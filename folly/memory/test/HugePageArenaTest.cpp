@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/HugePageArena.h>
+
+#include <cstring>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+static_assert(IsArenaAllocator<HugePageArena>::value, "");
+
+namespace {
+
+bool isAligned(const void* p, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+} // namespace
+
+TEST(HugePageAlloc, InvalidOptions) {
+  EXPECT_THROW(
+      HugePageAlloc(HugePageAlloc::Options().setPageSize(3 << 20)),
+      std::invalid_argument);
+  EXPECT_THROW(
+      HugePageAlloc(HugePageAlloc::Options().setPageSize(512)),
+      std::invalid_argument);
+  EXPECT_THROW(
+      HugePageAlloc(HugePageAlloc::Options().setNumaNode(-2)),
+      std::invalid_argument);
+}
+
+TEST(HugePageAlloc, GoodSize) {
+  HugePageAlloc alloc;
+  auto page = HugePageAlloc::k2MB;
+  auto header = HugePageAlloc::kHeaderSize;
+  EXPECT_EQ(page - header, alloc.goodSize(1));
+  EXPECT_EQ(page - header, alloc.goodSize(page - header));
+  EXPECT_EQ(2 * page - header, alloc.goodSize(page - header + 1));
+}
+
+TEST(HugePageAlloc, Transparent) {
+  HugePageAlloc alloc;
+  auto size = alloc.goodSize(3 << 20);
+  void* p = alloc.allocate(size);
+  // The mapping, not the returned pointer, is huge page aligned.
+  EXPECT_TRUE(isAligned(
+      static_cast<char*>(p) - HugePageAlloc::kHeaderSize,
+      HugePageAlloc::k2MB));
+  memset(p, 0xab, size);
+  alloc.deallocate(p);
+}
+
+TEST(HugePageAlloc, ExplicitFallsBack) {
+  // Works whether or not the system has huge pages reserved.
+  HugePageAlloc alloc(
+      HugePageAlloc::Options().setExplicit(true).setPopulate(true));
+  void* p = alloc.allocate(100);
+  memset(p, 0xab, 100);
+  alloc.deallocate(p);
+}
+
+TEST(HugePageAlloc, NumaNode) {
+  HugePageAlloc alloc(
+      HugePageAlloc::Options().setNumaNode(0).setPopulate(true));
+  void* p = alloc.allocate(100);
+  memset(p, 0xab, 100);
+  alloc.deallocate(p);
+
+  // No machine has this many nodes.
+  HugePageAlloc bad(HugePageAlloc::Options().setNumaNode(1000));
+  EXPECT_THROW(bad.allocate(100), std::system_error);
+}
+
+TEST(HugePageArena, Allocate) {
+  HugePageArena arena;
+  std::vector<char*> ptrs;
+  for (size_t i = 0; i < 1000; ++i) {
+    auto p = static_cast<char*>(arena.allocate(10000));
+    EXPECT_TRUE(isAligned(p, HugePageArena::kDefaultMaxAlign));
+    memset(p, int(i), 10000);
+    ptrs.push_back(p);
+  }
+  for (size_t i = 0; i < ptrs.size(); ++i) {
+    EXPECT_EQ(char(i), ptrs[i][0]);
+    EXPECT_EQ(char(i), ptrs[i][9999]);
+  }
+  // Blocks are whole huge pages: 10MB of data fits in 5 or 6 of them.
+  EXPECT_EQ(10000000, arena.bytesUsed());
+  EXPECT_LE(5 * HugePageAlloc::k2MB, arena.totalSize());
+  EXPECT_GE(6 * HugePageAlloc::k2MB + sizeof(arena), arena.totalSize());
+
+  // Larger than a block
+  auto big = static_cast<char*>(arena.allocate(5 << 20));
+  memset(big, 1, 5 << 20);
+}
+
+TEST(HugePageArena, StlAllocator) {
+  HugePageArena arena;
+  using Alloc = HugePageArenaAllocator<std::pair<const int, int>>;
+  std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc> m(
+      0, std::hash<int>(), std::equal_to<int>(), Alloc(&arena));
+  for (int i = 0; i < 100000; ++i) {
+    m[i] = 2 * i;
+  }
+  for (int i = 0; i < 100000; ++i) {
+    EXPECT_EQ(2 * i, m[i]);
+  }
+  EXPECT_LT(0, arena.bytesUsed());
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/JemallocArena.h>
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+unsigned currentArena() {
+  unsigned arena = 0;
+  mallctlRead("thread.arena", &arena);
+  return arena;
+}
+
+} // namespace
+
+TEST(JemallocArena, ForSubsystem) {
+  auto& a = JemallocArena::forSubsystem("a");
+  auto& b = JemallocArena::forSubsystem("b");
+  EXPECT_EQ(&a, &JemallocArena::forSubsystem("a"));
+  EXPECT_NE(&a, &b);
+  EXPECT_EQ(usingJEMalloc(), a.enabled());
+  if (a.enabled()) {
+    EXPECT_NE(a.index(), b.index());
+    EXPECT_NE(0, a.index());
+  }
+}
+
+TEST(JemallocArena, Allocate) {
+  JemallocArena arena;
+  for (size_t size : {0, 1, 100, 5000, 1 << 20}) {
+    auto p = static_cast<char*>(arena.allocate(size));
+    ASSERT_NE(nullptr, p);
+    memset(p, 'x', size);
+    if (arena.enabled()) {
+      unsigned owner = 0;
+      // jemalloc 5 looks up the arena a pointer belongs to
+      size_t len = sizeof(owner);
+      void* q = p;
+      if (mallctl("arenas.lookup", &owner, &len, &q, sizeof(q)) == 0) {
+        EXPECT_EQ(arena.index(), owner);
+      }
+    }
+    p = static_cast<char*>(arena.reallocate(p, size + 100));
+    ASSERT_NE(nullptr, p);
+    for (size_t i = 0; i < size; ++i) {
+      ASSERT_EQ('x', p[i]);
+    }
+    arena.deallocate(p, size + 100);
+  }
+  arena.deallocate(arena.allocate(10));
+  arena.deallocate(arena.reallocate(nullptr, 10));
+  arena.deallocate(nullptr);
+  arena.purge();
+}
+
+TEST(JemallocArena, Allocator) {
+  JemallocArenaAllocator<int> alloc(JemallocArena::forSubsystem("test"));
+  std::vector<int, JemallocArenaAllocator<int>> v(alloc);
+  for (int i = 0; i < 10000; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(9999, v.back());
+  EXPECT_EQ(alloc, v.get_allocator());
+
+  using Alloc = JemallocArenaAllocator<std::pair<const int, int>>;
+  std::map<int, int, std::less<int>, Alloc> m{Alloc(alloc)};
+  for (int i = 0; i < 1000; ++i) {
+    m[i] = i;
+  }
+  EXPECT_EQ(1000, m.size());
+  EXPECT_EQ(alloc, m.get_allocator());
+
+  JemallocArena other;
+  EXPECT_NE(alloc, JemallocArenaAllocator<int>(other));
+}
+
+TEST(JemallocArena, Binding) {
+  JemallocArena arena;
+  if (!arena.enabled()) {
+    JemallocArenaBinding binding(arena);
+    EXPECT_EQ(0, arena.bindCurrentThread());
+    return;
+  }
+  unsigned before = currentArena();
+  {
+    JemallocArenaBinding binding(arena);
+    EXPECT_EQ(arena.index(), currentArena());
+    free(malloc(100));
+  }
+  EXPECT_EQ(before, currentArena());
+  EXPECT_EQ(before, arena.bindCurrentThread());
+  EXPECT_EQ(arena.index(), currentArena());
+  mallctlWrite("thread.arena", before);
+}
+
+TEST(JemallocArena, ThreadCache) {
+  flushThreadMallocCache();
+  if (!usingJEMalloc()) {
+    EXPECT_FALSE(setThreadMallocCacheEnabled(false));
+    return;
+  }
+  bool enabled = setThreadMallocCacheEnabled(false);
+  EXPECT_FALSE(setThreadMallocCacheEnabled(true));
+  free(malloc(100));
+  flushThreadMallocCache();
+  EXPECT_TRUE(setThreadMallocCacheEnabled(enabled));
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/Relocate.h>
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/FBString.h>
+#include <folly/FBVector.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/SmallFlatTypes.h>
+#include <folly/portability/GTest.h>
+#include <folly/small_vector.h>
+
+using namespace folly;
+
+namespace {
+
+int constructions = 0;
+int destructions = 0;
+
+// Counts its constructions and destructions; relocatable or not.
+// (fbstring is relocatable, unlike std::string, which may point into
+// itself.)
+template <bool Relocatable>
+struct Counted {
+  typedef std::integral_constant<bool, Relocatable> IsRelocatable;
+
+  /* implicit */ Counted(int v = 0) : value(std::to_string(v)) {
+    ++constructions;
+  }
+  Counted(const Counted& o) : value(o.value) {
+    if (o.value == "throw") {
+      throw std::runtime_error("copy");
+    }
+    ++constructions;
+  }
+  // Throws, so that relocation copies rather than moves
+  Counted(Counted&& o) : value(std::move(o.value)) {
+    ++constructions;
+  }
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&&) = default;
+  ~Counted() {
+    ++destructions;
+  }
+
+  bool operator==(const Counted& o) const {
+    return value == o.value;
+  }
+
+  fbstring value;
+};
+
+using Relocatable = Counted<true>;
+using NotRelocatable = Counted<false>;
+
+struct CountedHash {
+  template <bool R>
+  size_t operator()(const Counted<R>& c) const {
+    return std::hash<fbstring>()(c.value);
+  }
+};
+
+void resetCounts() {
+  constructions = 0;
+  destructions = 0;
+}
+
+int live() {
+  return constructions - destructions;
+}
+
+template <class T>
+T* allocate(size_t n) {
+  return static_cast<T*>(::operator new(n * sizeof(T)));
+}
+
+} // namespace
+
+static_assert(IsRelocatableWith<Relocatable, std::allocator<Relocatable>>(), "");
+static_assert(
+    !IsRelocatableWith<NotRelocatable, std::allocator<NotRelocatable>>(),
+    "");
+
+TEST(Relocate, UninitializedRelocate) {
+  std::vector<Relocatable> r = {1, 2, 3};
+  resetCounts();
+  auto out = allocate<Relocatable>(3);
+  EXPECT_EQ(out + 3, uninitialized_relocate(r.data(), r.data() + 3, out));
+  EXPECT_EQ(0, constructions);
+  EXPECT_EQ(0, destructions);
+  EXPECT_EQ("3", out[2].value);
+  // Put them back, for the vector to destroy
+  uninitialized_relocate(out, out + 3, r.data());
+  ::operator delete(out);
+
+  std::vector<NotRelocatable> n = {1, 2, 3};
+  resetCounts();
+  auto nout = allocate<NotRelocatable>(3);
+  uninitialized_relocate(n.data(), n.data() + 3, nout);
+  EXPECT_EQ(3, constructions);
+  EXPECT_EQ(3, destructions);
+  EXPECT_EQ("2", nout[1].value);
+  uninitialized_relocate(nout, nout + 3, n.data());
+  ::operator delete(nout);
+
+  // The move constructor may throw, so relocation copies, and a failed
+  // copy leaves the source as it was
+  n[2].value = "throw";
+  resetCounts();
+  nout = allocate<NotRelocatable>(3);
+  EXPECT_THROW(
+      uninitialized_relocate(n.data(), n.data() + 3, nout), std::runtime_error);
+  EXPECT_EQ(0, live());
+  EXPECT_EQ("1", n[0].value);
+  ::operator delete(nout);
+}
+
+TEST(Relocate, RelocateOverlapping) {
+  std::vector<Relocatable> r = {1, 2, 3, 4};
+  resetCounts();
+  r[0].~Relocatable();
+  relocate_overlapping(r.data() + 1, r.data() + 4, r.data());
+  new (&r[3]) Relocatable(5);
+  EXPECT_EQ(std::vector<Relocatable>({2, 3, 4, 5}), r);
+}
+
+TEST(Relocate, SmallVector) {
+  resetCounts();
+  {
+    small_vector<Relocatable, 2> v;
+    for (int i = 0; i < 100; ++i) {
+      v.push_back(i);
+    }
+    // Only the temporaries: growth relocates
+    EXPECT_EQ(200, constructions);
+    EXPECT_EQ(100, live());
+
+    std::vector<Relocatable> more = {-3, -4};
+    resetCounts();
+    v.insert(v.begin() + 10, 3, Relocatable(-1));
+    v.insert(v.begin(), Relocatable(-2));
+    v.insert(v.begin() + 1, more.begin(), more.end());
+    // The temporaries, and the 6 elements
+    EXPECT_EQ(2 + 6, constructions);
+    EXPECT_EQ(106, v.size());
+    EXPECT_EQ("-2", v[0].value);
+    EXPECT_EQ("-3", v[1].value);
+    EXPECT_EQ("-4", v[2].value);
+    EXPECT_EQ("0", v[3].value);
+    EXPECT_EQ("9", v[12].value);
+    EXPECT_EQ("-1", v[13].value);
+    EXPECT_EQ("-1", v[15].value);
+    EXPECT_EQ("10", v[16].value);
+
+    resetCounts();
+    v.erase(v.begin() + 13, v.begin() + 16);
+    v.erase(v.begin());
+    EXPECT_EQ(0, constructions);
+    EXPECT_EQ(4, destructions);
+    EXPECT_EQ("-3", v[0].value);
+    EXPECT_EQ("9", v[11].value);
+    EXPECT_EQ("10", v[12].value);
+    EXPECT_EQ("99", v.back().value);
+
+    // A failed insert leaves the vector as it was
+    Relocatable bad(0);
+    bad.value = "throw";
+    EXPECT_THROW(v.insert(v.begin() + 5, 2, bad), std::runtime_error);
+    EXPECT_EQ(102, v.size());
+    EXPECT_EQ("3", v[5].value);
+    EXPECT_EQ("99", v.back().value);
+
+    // Swapping inline and heap storage
+    small_vector<Relocatable, 2> w = {7};
+    resetCounts();
+    swap(v, w);
+    EXPECT_EQ(0, constructions);
+    EXPECT_EQ(1, v.size());
+    EXPECT_EQ(102, w.size());
+  }
+}
+
+TEST(Relocate, FBVector) {
+  resetCounts();
+  fbvector<Relocatable> v;
+  for (int i = 0; i < 100; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(200, constructions);
+  EXPECT_EQ(100, live());
+}
+
+TEST(Relocate, SmallFlatSet) {
+  resetCounts();
+  {
+    small_flat_set<Relocatable, 4, CountedHash> s;
+    for (int i = 0; i < 100; ++i) {
+      s.insert(i);
+    }
+    EXPECT_EQ(200, constructions);
+    EXPECT_EQ(100, live());
+  }
+  EXPECT_EQ(0, live());
+}
+
+TEST(Relocate, F14) {
+  resetCounts();
+  {
+    F14ValueMap<int, Relocatable> m;
+    for (int i = 0; i < 100; ++i) {
+      m.emplace(i, i);
+    }
+    EXPECT_EQ(100, constructions);
+    EXPECT_EQ(100, live());
+    EXPECT_EQ("42", m.at(42).value);
+  }
+  EXPECT_EQ(0, live());
+
+  // Others are moved, or copied, and destroyed
+  resetCounts();
+  {
+    F14ValueMap<int, NotRelocatable> m;
+    for (int i = 0; i < 100; ++i) {
+      m.emplace(i, i);
+    }
+    EXPECT_LT(100, constructions);
+    EXPECT_EQ(100, live());
+  }
+  EXPECT_EQ(0, live());
+}
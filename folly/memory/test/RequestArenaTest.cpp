@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/RequestArena.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(RequestArena, NoContext) {
+  EXPECT_EQ(nullptr, RequestContext::try_get());
+  EXPECT_EQ(nullptr, RequestArena::get());
+}
+
+TEST(RequestArena, PerRequest) {
+  RequestContextScopeGuard guard;
+  auto arena = RequestArena::get();
+  ASSERT_NE(nullptr, arena);
+  EXPECT_EQ(arena, RequestArena::get());
+
+  std::vector<int, RequestArenaAllocator<int>> v{
+      RequestArenaAllocator<int>(arena)};
+  for (int i = 0; i < 10000; ++i) {
+    v.push_back(i);
+  }
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(i, v[i]);
+  }
+
+  {
+    RequestContextScopeGuard other;
+    EXPECT_NE(arena, RequestArena::get());
+  }
+  EXPECT_EQ(arena, RequestArena::get());
+}
+
+TEST(RequestArena, ReusesBlocks) {
+  void* first;
+  {
+    RequestContextScopeGuard guard;
+    first = RequestArena::get()->allocate(100);
+  }
+  // The next request of the thread gets the same memory
+  RequestContextScopeGuard guard;
+  EXPECT_EQ(first, RequestArena::get()->allocate(100));
+}
+
+TEST(RequestArena, OtherThreads) {
+  RequestContextScopeGuard guard;
+  auto arena = RequestArena::get();
+  auto context = RequestContext::saveContext();
+  std::vector<std::thread> threads;
+  std::vector<char*> chunks(8);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    threads.emplace_back([&, i] {
+      RequestContextScopeGuard threadGuard(context);
+      EXPECT_EQ(arena, RequestArena::get());
+      for (int j = 0; j < 1000; ++j) {
+        auto p = static_cast<char*>(RequestArena::get()->allocate(64));
+        memset(p, int(i), 64);
+        if (j == 0) {
+          chunks[i] = p;
+        }
+      }
+    });
+  }
+  auto mine = static_cast<char*>(arena->allocate(64));
+  memset(mine, 0xff, 64);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    for (int j = 0; j < 64; ++j) {
+      EXPECT_EQ(char(i), chunks[i][j]);
+    }
+  }
+  EXPECT_EQ(char(0xff), mine[63]);
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/memory/SlabPool.h>
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/MPMCQueue.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+struct Request {
+  char data[200];
+};
+
+} // namespace
+
+TEST(SlabPool, Sizes) {
+  SlabPool tiny(1);
+  EXPECT_LE(3 * sizeof(void*), tiny.objectSize());
+  EXPECT_EQ(max_align_v, tiny.alignment());
+  EXPECT_EQ(0, tiny.objectSize() % tiny.alignment());
+
+  SlabPool aligned(100, 64);
+  EXPECT_EQ(128, aligned.objectSize());
+  EXPECT_EQ(64, aligned.alignment());
+
+  EXPECT_THROW(SlabPool(16, 24), std::invalid_argument);
+  EXPECT_THROW(
+      SlabPool(16, 16, SlabPool::Options().setMagazineSize(0)),
+      std::invalid_argument);
+}
+
+TEST(SlabPool, Reuse) {
+  SlabPool pool(
+      sizeof(Request),
+      alignof(Request),
+      SlabPool::Options().setMagazineSize(8).setSlabSize(4096));
+  std::set<void*> seen;
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < 1000; ++i) {
+    void* p = pool.allocate();
+    EXPECT_TRUE(seen.insert(p).second);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % pool.alignment());
+    memset(p, int(i), sizeof(Request));
+    ptrs.push_back(p);
+  }
+  auto capacity = pool.capacity();
+  EXPECT_LE(1000, capacity);
+
+  for (void* p : ptrs) {
+    pool.deallocate(p);
+  }
+  // Everything freed is handed out again before the pool grows.
+  for (size_t i = 0; i < capacity; ++i) {
+    seen.erase(pool.allocate());
+  }
+  EXPECT_TRUE(seen.empty());
+  EXPECT_EQ(capacity, pool.capacity());
+}
+
+TEST(SlabPool, ThreadExit) {
+  SlabPool pool(64, 16, SlabPool::Options().setMagazineSize(16));
+  std::vector<void*> ptrs;
+  std::thread([&] {
+    for (size_t i = 0; i < 100; ++i) {
+      ptrs.push_back(pool.allocate());
+    }
+    for (void* p : ptrs) {
+      pool.deallocate(p);
+    }
+  }).join();
+  auto capacity = pool.capacity();
+  // The exited thread's magazines, partial ones included, are reused.
+  std::set<void*> freed(ptrs.begin(), ptrs.end());
+  for (size_t i = 0; i < capacity; ++i) {
+    freed.erase(pool.allocate());
+  }
+  EXPECT_TRUE(freed.empty());
+  EXPECT_EQ(capacity, pool.capacity());
+}
+
+TEST(SlabPool, CrossThread) {
+  // Producers allocate, consumers free; memory flows back to the producers
+  // through the depot.
+  constexpr size_t kThreads = 4;
+  constexpr size_t kPerThread = 100000;
+  SlabPool pool(sizeof(Request), alignof(Request));
+  MPMCQueue<Request*> queue(1000);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < kPerThread; ++i) {
+        auto r = static_cast<Request*>(pool.allocate());
+        memset(r->data, int(t), sizeof(r->data));
+        queue.blockingWrite(r);
+      }
+    });
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < kPerThread; ++i) {
+        Request* r;
+        queue.blockingRead(r);
+        EXPECT_EQ(r->data[0], r->data[sizeof(r->data) - 1]);
+        pool.deallocate(r);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // Bounded by what can be in flight, not by the number of allocations.
+  EXPECT_GT(kThreads * kPerThread / 10, pool.capacity());
+}
+
+TEST(SlabPool, StlAllocator) {
+  SlabPool pool(64);
+  using Alloc = SlabPoolAllocator<std::pair<const int, int>>;
+  std::map<int, int, std::less<int>, Alloc> m{Alloc(&pool)};
+  for (int i = 0; i < 1000; ++i) {
+    m[i] = i;
+  }
+  EXPECT_LE(1000, pool.capacity());
+  std::list<int, SlabPoolAllocator<int>> l{SlabPoolAllocator<int>(&pool)};
+  l.assign(100, 7);
+  EXPECT_EQ(100, l.size());
+
+  // Too large for the pool: falls back to operator new.
+  std::vector<int, SlabPoolAllocator<int>> v{SlabPoolAllocator<int>(&pool)};
+  v.resize(1000);
+
+  auto p = std::allocate_shared<int>(SlabPoolAllocator<int>(&pool), 42);
+  EXPECT_EQ(42, *p);
+}
+
+TEST(SlabPool, MemoryResource) {
+  SlabPool pool(64);
+  SlabPoolResource resource(&pool);
+  void* small = resource.allocate(48);
+  void* large = resource.allocate(4096);
+  // Over-aligned requests go upstream.
+  void* aligned = resource.allocate(32, 128);
+  EXPECT_LT(0, pool.capacity());
+  resource.deallocate(small, 48);
+  resource.deallocate(large, 4096);
+  resource.deallocate(aligned, 32, 128);
+}
+
+namespace {
+
+template <class Alloc, class Free>
+void churn(size_t iters, size_t threads, Alloc alloc, Free free) {
+  std::vector<std::thread> ts;
+  for (size_t t = 0; t < threads; ++t) {
+    ts.emplace_back([&] {
+      std::vector<void*> live(64);
+      for (size_t i = 0; i < iters; ++i) {
+        auto& slot = live[i % live.size()];
+        if (slot) {
+          free(slot);
+        }
+        slot = alloc();
+      }
+      for (void* p : live) {
+        if (p) {
+          free(p);
+        }
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+}
+
+void bmMalloc(size_t iters, size_t threads) {
+  churn(
+      iters,
+      threads,
+      [] { return malloc(sizeof(Request)); },
+      [](void* p) { free(p); });
+}
+
+void bmSlabPool(size_t iters, size_t threads) {
+  static SlabPool pool(sizeof(Request));
+  churn(
+      iters,
+      threads,
+      [&] { return pool.allocate(); },
+      [&](void* p) { pool.deallocate(p); });
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(bmMalloc, 1thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(bmSlabPool, 1thread, 1)
+BENCHMARK_NAMED_PARAM(bmMalloc, 8threads, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(bmSlabPool, 8threads, 8)
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  auto ret = RUN_ALL_TESTS();
+  if (!ret && FLAGS_benchmark) {
+    folly::runBenchmarks();
+  }
+  return ret;
+}
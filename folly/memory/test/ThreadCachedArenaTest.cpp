@@ -29,6 +29,7 @@
 #include <folly/Benchmark.h>
 #include <folly/Memory.h>
 #include <folly/Range.h>
+#include <folly/detail/MemoryIdler.h>
 #include <folly/portability/GTest.h>
 
 using namespace folly;
@@ -153,6 +154,46 @@ TEST(ThreadCachedArena, MultiThreaded) {
   mainTester.verify();
 }
 
+TEST(ThreadCachedArena, ReleaseWhenIdle) {
+  static const size_t requestedBlockSize = 1 << 20;
+  ThreadCachedArena arena(requestedBlockSize);
+  std::thread([&arena] {
+    auto p = static_cast<char*>(arena.allocate(100));
+    std::fill(p, p + 100, 'x');
+    folly::detail::MemoryIdler::releaseIdleMemory();
+
+    // What was allocated stays, and the rest of the block is still usable
+    EXPECT_TRUE(std::all_of(p, p + 100, [](char c) { return c == 'x'; }));
+    auto size = requestedBlockSize / 2;
+    auto q = static_cast<char*>(arena.allocate(size));
+    EXPECT_LT(p, q);
+    EXPECT_GT(p + requestedBlockSize, q);
+    std::fill(q, q + size, 'y');
+    folly::detail::MemoryIdler::releaseIdleMemory();
+    EXPECT_TRUE(std::all_of(q, q + size, [](char c) { return c == 'y'; }));
+  }).join();
+  EXPECT_LT(requestedBlockSize, arena.totalSize());
+}
+
+TEST(ThreadCachedArena, ResetThreadArena) {
+  static const size_t requestedBlockSize = 1 << 10;
+  ThreadCachedArena arena(requestedBlockSize);
+  void* other;
+  std::thread([&] { other = arena.allocate(100); }).join();
+  auto p = arena.allocate(100);
+  arena.allocate(4 * requestedBlockSize);
+  auto size = arena.totalSize();
+
+  // The block of this thread is reused, the large allocation is freed
+  arena.resetThreadArena();
+  EXPECT_GT(size, arena.totalSize());
+  EXPECT_EQ(p, arena.allocate(100));
+  EXPECT_NE(other, p);
+
+  arena.resetThreadArena(0);
+  EXPECT_NE(nullptr, arena.allocate(100));
+}
+
 TEST(ThreadCachedArena, StlAllocator) {
   typedef std::unordered_map<
     int, int, std::hash<int>, std::equal_to<int>,
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <folly/Poly.h>
+
+#if !defined(__cpp_template_auto)
+#define FOLLY_AUTO class
+#else
+#define FOLLY_AUTO auto
+#endif
+
+namespace folly {
+
+template <class I, class... Ts>
+struct PolySealed;
+
+/// \cond
+namespace detail {
+
+// The K-th member binding of a PolyMembers list
+template <std::size_t K, class Members>
+struct SealedMember;
+
+template <std::size_t K, FOLLY_AUTO M, FOLLY_AUTO... Ms>
+struct SealedMember<K, PolyMembers<M, Ms...>>
+    : SealedMember<K - 1, PolyMembers<Ms...>> {};
+
+template <FOLLY_AUTO M, FOLLY_AUTO... Ms>
+struct SealedMember<0, PolyMembers<M, Ms...>> {
+  static constexpr MemberType<M> value() noexcept {
+    return memberValue<M>();
+  }
+  template <class I>
+  using Signature = SignatureOf<M, I>;
+};
+
+template <class Sig>
+struct SealedResult_;
+
+template <class R, class D, class... As>
+struct SealedResult_<R (*)(D, As...)> {
+  using type = R;
+};
+
+// What the K-th member of interface I returns, as in Poly<I>'s vtable
+template <std::size_t K, class I>
+using SealedResult =
+    _t<SealedResult_<typename SealedMember<K, MembersOf<I, Archetype<I>>>::
+                         template Signature<I>>>;
+
+template <class T, class... Ts>
+constexpr std::size_t sealedIndex() noexcept {
+  constexpr bool same[] = {std::is_same<T, Ts>::value...};
+  for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+    if (same[i]) {
+      return i;
+    }
+  }
+  return sizeof...(Ts);
+}
+
+template <class I, class... Ts>
+struct SealedRoot {
+  static_assert(
+      sizeof...(Ts) > 0 && sizeof...(Ts) < 255,
+      "PolySealed needs between 1 and 254 types");
+  static_assert(
+      Conjunction<std::is_nothrow_move_constructible<Ts>...>::value,
+      "PolySealed stores its objects in situ, and is nothrow movable, so "
+      "the types must be nothrow movable");
+
+  template <class Node, class Tfx>
+  using _polySelf_ = AddCvrefOf<PolySealed<I, Ts...>, Node>;
+  using _polyInterface_ = I;
+
+ protected:
+  template <std::size_t K>
+  using TypeAt = std::tuple_element_t<K, std::tuple<Ts...>>;
+  using Empty = std::integral_constant<std::size_t, sizeof...(Ts)>;
+
+  // Call f with the object, as a Ts& (or Ts const&), with a branch on the
+  // index per type rather than an indirect call.
+  template <class R, class Self, class F>
+  static R visit(Self& self, F&& f) {
+    return visitFrom<R>(self, f, std::integral_constant<std::size_t, 0>{});
+  }
+
+  std::aligned_union_t<1, Ts...> storage_;
+  std::uint8_t index_ = Empty::value;
+
+ private:
+  template <class R, class Self, class F, std::size_t K>
+  static R
+  visitFrom(Self& self, F& f, std::integral_constant<std::size_t, K>) {
+    if (self.index_ == K) {
+      using T = If<std::is_const<Self>::value, TypeAt<K> const, TypeAt<K>>;
+      return f(*static_cast<T*>(static_cast<
+                                If<std::is_const<Self>::value,
+                                   void const*,
+                                   void*>>(&self.storage_)));
+    }
+    return visitFrom<R>(self, f, std::integral_constant<std::size_t, K + 1>{});
+  }
+
+  template <class R, class Self, class F>
+  [[noreturn]] static R visitFrom(Self&, F&, Empty) {
+    throwBadPolyAccess();
+  }
+};
+
+template <class I, class Tail>
+struct SealedNode : Tail {
+ private:
+  friend PolyAccess;
+
+  template <std::size_t K, class... As>
+  SealedResult<K, I> _polyCall_(As&&... as) {
+    return this->template visit<SealedResult<K, I>>(
+        *this, [&](auto& obj) -> SealedResult<K, I> {
+          using T = std::decay_t<decltype(obj)>;
+          return folly::invoke(
+              SealedMember<K, MembersOf<I, T>>::value(),
+              obj,
+              static_cast<As&&>(as)...);
+        });
+  }
+  template <std::size_t K, class... As>
+  SealedResult<K, I> _polyCall_(As&&... as) const {
+    return this->template visit<SealedResult<K, I>>(
+        *this, [&](auto const& obj) -> SealedResult<K, I> {
+          using T = std::decay_t<decltype(obj)>;
+          return folly::invoke(
+              SealedMember<K, MembersOf<I, T>>::value(),
+              obj,
+              static_cast<As&&>(as)...);
+        });
+  }
+};
+
+struct MakeSealedNode {
+  template <class I, class State>
+  using apply = InterfaceOf<I, SealedNode<I, State>>;
+};
+
+template <class I, class... Ts>
+using SealedImpl = TypeFold<
+    InclusiveSubsumptionsOf<I>,
+    SealedRoot<I, Ts...>,
+    MakeSealedNode>;
+} // namespace detail
+/// \endcond
+
+/**
+ * `PolySealed<I, Ts...>` is a `Poly<I>` that can only hold objects of the
+ * types `Ts...`, for interfaces whose set of implementations is closed, like
+ * the handlers of a server.
+ *
+ * Knowing every type lets it store the largest of them in situ, so it never
+ * allocates, and dispatch member calls by branching on the index of the
+ * stored type rather than calling through a vtable: the members of each type
+ * can be inlined, and a call is cheaper than a virtual call or a `Poly`
+ * call when the set is small or a few of the types dominate.
+ *
+ *     using Handler = folly::PolySealed<IHandler, GetHandler, PutHandler>;
+ *     Handler h = GetHandler{};
+ *     h.handle(request);
+ *
+ * The members of `I` are bound as for `Poly`, and `poly_empty`, `poly_type`
+ * and `poly_cast` work the same. Calling a member of an empty `PolySealed`
+ * throws `BadPolyAccess`. The types must be nothrow movable; a `PolySealed`
+ * is copyable if they all are. Interfaces whose members take or return the
+ * erased type itself (through `PolySelf`) are not supported.
+ */
+template <class I, class... Ts>
+struct PolySealed final : detail::SealedImpl<I, Ts...> {
+ private:
+  using Root = detail::SealedRoot<I, Ts...>;
+  using Empty = typename Root::Empty;
+
+  template <class T>
+  using IndexOf =
+      std::integral_constant<std::size_t, detail::sealedIndex<T, Ts...>()>;
+
+  template <class T, class J, class... Us>
+  friend T& poly_cast(PolySealed<J, Us...>&);
+  template <class J, class... Us>
+  friend bool poly_empty(PolySealed<J, Us...> const&) noexcept;
+  template <class J, class... Us>
+  friend std::type_info const& poly_type(PolySealed<J, Us...> const&) noexcept;
+
+  void* addr() noexcept {
+    return static_cast<void*>(&this->storage_);
+  }
+
+  void moveFrom(PolySealed& that) noexcept {
+    if (that.index_ != Empty::value) {
+      this->template visit<void>(that, [&](auto& obj) {
+        using T = std::decay_t<decltype(obj)>;
+        ::new (addr()) T(std::move(obj));
+      });
+      this->index_ = that.index_;
+      that.reset();
+    }
+  }
+
+  void reset() noexcept {
+    if (this->index_ != Empty::value) {
+      this->template visit<void>(*this, [](auto& obj) {
+        using T = std::decay_t<decltype(obj)>;
+        obj.~T();
+      });
+      this->index_ = Empty::value;
+    }
+  }
+
+ public:
+  /**
+   * Constructs an empty `PolySealed`.
+   */
+  PolySealed() = default;
+
+  PolySealed(PolySealed const& that) {
+    if (that.index_ != Empty::value) {
+      this->template visit<void>(that, [&](auto const& obj) {
+        using T = std::decay_t<decltype(obj)>;
+        ::new (addr()) T(obj);
+      });
+      this->index_ = that.index_;
+    }
+  }
+
+  /**
+   * \post `poly_empty(that) == true`
+   */
+  PolySealed(PolySealed&& that) noexcept {
+    moveFrom(that);
+  }
+
+  /**
+   * Constructs a `PolySealed` holding a copy of `t`, whose type must be one
+   * of `Ts...`.
+   */
+  template <
+      class T,
+      class U = std::decay_t<T>,
+      std::enable_if_t<(IndexOf<U>::value < sizeof...(Ts)), int> = 0>
+  /* implicit */ PolySealed(T&& t) noexcept(
+      std::is_nothrow_constructible<U, T&&>::value) {
+    ::new (addr()) U(static_cast<T&&>(t));
+    this->index_ = IndexOf<U>::value;
+  }
+
+  ~PolySealed() {
+    reset();
+  }
+
+  PolySealed& operator=(PolySealed const& that) {
+    if (this != &that) {
+      *this = PolySealed(that);
+    }
+    return *this;
+  }
+
+  PolySealed& operator=(PolySealed&& that) noexcept {
+    if (this != &that) {
+      reset();
+      moveFrom(that);
+    }
+    return *this;
+  }
+
+  template <
+      class T,
+      class U = std::decay_t<T>,
+      std::enable_if_t<(IndexOf<U>::value < sizeof...(Ts)), int> = 0>
+  PolySealed& operator=(T&& t) {
+    return *this = PolySealed(static_cast<T&&>(t));
+  }
+
+  void swap(PolySealed& that) noexcept {
+    PolySealed tmp(std::move(that));
+    that = std::move(*this);
+    *this = std::move(tmp);
+  }
+};
+
+template <class I, class... Ts>
+void swap(PolySealed<I, Ts...>& left, PolySealed<I, Ts...>& right) noexcept {
+  left.swap(right);
+}
+
+/**
+ * The object held by `that`, which must be of type `T`; throws `BadPolyCast`
+ * otherwise.
+ */
+template <class T, class I, class... Ts>
+T& poly_cast(PolySealed<I, Ts...>& that) {
+  using Sealed = PolySealed<I, Ts...>;
+  if (that.index_ != Sealed::template IndexOf<T>::value) {
+    detail::throwBadPolyCast();
+  }
+  return *static_cast<T*>(static_cast<void*>(&that.storage_));
+}
+
+/// \overload
+template <class T, class I, class... Ts>
+T const& poly_cast(PolySealed<I, Ts...> const& that) {
+  return poly_cast<T>(const_cast<PolySealed<I, Ts...>&>(that));
+}
+
+template <class I, class... Ts>
+bool poly_empty(PolySealed<I, Ts...> const& that) noexcept {
+  return that.index_ == sizeof...(Ts);
+}
+
+/**
+ * The type of the object held by `that`; `typeid(void)` if it's empty.
+ */
+template <class I, class... Ts>
+std::type_info const& poly_type(PolySealed<I, Ts...> const& that) noexcept {
+  if (poly_empty(that)) {
+    return typeid(void);
+  }
+  return PolySealed<I, Ts...>::template visit<std::type_info const&>(
+      that, [](auto const& obj) -> std::type_info const& {
+        return typeid(std::decay_t<decltype(obj)>);
+      });
+}
+
+} // namespace folly
+
+#undef FOLLY_AUTO
@@ -48,6 +48,26 @@
 #define MSG_ZEROCOPY 0x4000000
 #endif
 
+// UDP segmentation / receive offload, Linux 4.18 / 5.0
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifdef __APPLE__
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+#endif
+
 #else
 #include <folly/portability/IOVec.h>
 #include <folly/portability/SysTypes.h>
@@ -77,6 +97,11 @@ struct msghdr {
   int msg_flags;
 };
 
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+
 struct sockaddr_un {
   sa_family_t sun_family;
   char sun_path[108];
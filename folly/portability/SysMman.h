@@ -51,6 +51,7 @@
 #define MADV_NORMAL 0
 #define MADV_DONTNEED 0
 #define MADV_SEQUENTIAL 0
+#define MADV_WILLNEED 0
 
 extern "C" {
 int madvise(const void* addr, size_t len, int advise);
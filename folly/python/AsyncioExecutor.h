@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/FileUtil.h>
+#include <folly/Function.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/DrivableExecutor.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+
+#if __linux__ && !__ANDROID__
+#include <folly/io/async/EventFDWrapper.h>
+#endif
+
+namespace folly {
+namespace python {
+
+/**
+ * The executor that futures bridged to asyncio complete on.  Its fd is
+ * registered with the asyncio loop (loop.add_reader), and drive() runs,
+ * with the GIL held, every function queued since the last wakeup.
+ *
+ * Unlike NotificationQueueExecutor, add() doesn't take a lock, and only
+ * the first add() after a drive() writes to the eventfd: a burst of
+ * completions from C++ threads costs one wakeup of the loop and one
+ * reader callback, rather than one of each per result.
+ */
+class AsyncioExecutor : public DrivableExecutor {
+ public:
+  using Func = folly::Func;
+
+  AsyncioExecutor() {
+#if __linux__ && !__ANDROID__
+    eventfd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    if (eventfd_ == -1) {
+      if (pipe(pipeFds_)) {
+        folly::throwSystemError("Failed to create pipe for AsyncioExecutor");
+      }
+      fcntl(pipeFds_[0], F_SETFL, O_RDONLY | O_NONBLOCK);
+      fcntl(pipeFds_[1], F_SETFL, O_WRONLY | O_NONBLOCK);
+    }
+  }
+
+  ~AsyncioExecutor() override {
+    if (eventfd_ >= 0) {
+      ::close(eventfd_);
+    } else {
+      ::close(pipeFds_[0]);
+      ::close(pipeFds_[1]);
+    }
+  }
+
+  AsyncioExecutor(const AsyncioExecutor&) = delete;
+  AsyncioExecutor& operator=(const AsyncioExecutor&) = delete;
+
+  void add(Func func) override {
+    queue_.enqueue(std::move(func));
+    // If signaled_ was already set, the drive() that clears it will see
+    // this function
+    if (!signaled_.exchange(true, std::memory_order_acq_rel)) {
+      signal();
+    }
+  }
+
+  int fileno() const {
+    return eventfd_ >= 0 ? eventfd_ : pipeFds_[0];
+  }
+
+  /**
+   * Runs every queued function, including those they add.  Returns early
+   * only if nothing is queued (a spurious wakeup).
+   */
+  void drive() noexcept override {
+    drainSignal();
+    signaled_.exchange(false, std::memory_order_acq_rel);
+    Func func;
+    while (queue_.try_dequeue(func)) {
+      try {
+        func();
+      } catch (const std::exception& ex) {
+        LOG(ERROR) << "Exception thrown by AsyncioExecutor task."
+                   << "Exception message: " << folly::exceptionStr(ex);
+      } catch (...) {
+        LOG(ERROR) << "Unknown Exception thrown by AsyncioExecutor task.";
+      }
+      func = nullptr;
+    }
+  }
+
+ private:
+  void signal() {
+    uint64_t one = 1;
+    int fd = eventfd_ >= 0 ? eventfd_ : pipeFds_[1];
+    size_t size = eventfd_ >= 0 ? sizeof(one) : 1;
+    // A full pipe already wakes the loop
+    folly::writeNoInt(fd, &one, size);
+  }
+
+  void drainSignal() {
+    uint64_t buf[8];
+    if (eventfd_ >= 0) {
+      folly::readNoInt(eventfd_, buf, sizeof(uint64_t));
+    } else {
+      while (folly::readNoInt(pipeFds_[0], buf, sizeof(buf)) > 0) {
+      }
+    }
+  }
+
+  folly::UMPSCQueue<Func, false> queue_;
+  std::atomic<bool> signaled_{false};
+  int eventfd_{-1};
+  int pipeFds_[2]{-1, -1};
+};
+
+} // namespace python
+} // namespace folly
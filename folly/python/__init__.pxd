@@ -16,6 +16,9 @@ cdef extern from "folly/futures/Future.h" namespace "folly" nogil:
         pass
         #TODO add via and then
 
+    cdef cppclass cFollySemiFuture "folly::SemiFuture"[T]:
+        pass
+
 cdef extern from "folly/Unit.h" namespace "folly":
     struct cFollyUnit "folly::Unit":
         pass
@@ -6,7 +6,15 @@ cdef extern from "folly/executors/NotificationQueueExecutor.h" namespace "folly"
         int fileno()
         void drive()
 
+cdef extern from "folly/python/AsyncioExecutor.h" namespace "folly::python":
+    cdef cppclass cAsyncioExecutor "folly::python::AsyncioExecutor"(cFollyExecutor):
+        int fileno()
+        void drive()
+
 cdef class NotificationQueueExecutor:
     cdef unique_ptr[cNotificationQueueExecutor] cQ
 
+cdef class AsyncioExecutor:
+    cdef unique_ptr[cAsyncioExecutor] cQ
+
 cdef api cFollyExecutor* get_executor()
@@ -1,10 +1,10 @@
 import asyncio
 from folly cimport cFollyExecutor
-from folly.executor cimport cNotificationQueueExecutor
+from folly.executor cimport cAsyncioExecutor, cNotificationQueueExecutor
 from libcpp.memory cimport make_unique, unique_ptr
 from cython.operator cimport dereference as deref
 
-#asynico Loops to NotificationQueueExecutor
+#asyncio Loops to AsyncioExecutor
 loop_to_q = {}
 
 
@@ -23,12 +23,31 @@ cdef class NotificationQueueExecutor:
        deref(self.cQ).drive()
 
 
+cdef class AsyncioExecutor:
+   """
+   Runs completions of bridged futures on the asyncio loop, all those
+   that are ready per wakeup of the loop.
+   """
+   def __cinit__(self):
+       self.cQ = make_unique[cAsyncioExecutor]();
+
+   def fileno(AsyncioExecutor self):
+       return deref(self.cQ).fileno()
+
+   def drive(AsyncioExecutor self):
+       deref(self.cQ).drive()
+
+   def __dealloc__(AsyncioExecutor self):
+       # We drive it one last time
+       deref(self.cQ).drive()
+
+
 cdef cFollyExecutor* get_executor():
    loop = asyncio.get_event_loop()
    try:
-       Q = <NotificationQueueExecutor>(loop_to_q[loop])
+       Q = <AsyncioExecutor>(loop_to_q[loop])
    except KeyError:
-       Q = NotificationQueueExecutor()
+       Q = AsyncioExecutor()
        loop.add_reader(Q.fileno(), Q.drive)
        loop_to_q[loop] = Q
    return Q.cQ.get()
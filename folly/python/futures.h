@@ -41,7 +41,10 @@ class PyGILStateGuard {
 
 inline folly::Executor* getExecutor() {
   PyGILStateGuard gstate;
-  import_folly__executor();
+  // Importing the module is a dict lookup and a capsule fetch per API
+  // function, which adds up when bridging thousands of futures a second
+  static const int imported = import_folly__executor();
+  (void)imported;
   return get_executor();
 }
 
@@ -57,7 +60,9 @@ void bridgeFuture(
   auto guard = folly::makeGuard([=] { Py_DECREF(userData); });
   // Handle the lambdas for cython
   // run callback from our Q
-  futureFrom.via(executor).then(
+  // setCallback_ rather than then(): then() would allocate another core
+  // and promise, only for them to be dropped
+  std::move(futureFrom).via(executor).setCallback_(
       [ callback = std::move(callback), userData, guard = std::move(guard) ](
           folly::Try<T> && res) mutable {
         // This will run from inside the gil, called by the asyncio add_reader
@@ -75,5 +80,32 @@ void bridgeFuture(
       getExecutor(), std::move(futureFrom), std::move(callback), userData);
 }
 
+/**
+ * Like bridgeFuture, for a SemiFuture: it is put on the asyncio executor
+ * directly, and callback gets the result as a Try, without a Future or a
+ * Python object in between.
+ */
+template <typename T>
+void bridgeSemiFuture(
+    folly::Executor* executor,
+    folly::SemiFuture<T>&& semiFuture,
+    folly::Function<void(folly::Try<T>&&, PyObject*)> callback,
+    PyObject* userData) {
+  bridgeFuture(
+      executor,
+      std::move(semiFuture).via(executor),
+      std::move(callback),
+      userData);
+}
+
+template <typename T>
+void bridgeSemiFuture(
+    folly::SemiFuture<T>&& semiFuture,
+    folly::Function<void(folly::Try<T>&&, PyObject*)> callback,
+    PyObject* userData) {
+  bridgeSemiFuture(
+      getExecutor(), std::move(semiFuture), std::move(callback), userData);
+}
+
 } // namespace python
 } // namespace folly
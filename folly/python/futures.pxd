@@ -1,5 +1,5 @@
 from cpython.ref cimport PyObject
-from folly cimport cFollyTry, cFollyFuture, cFollyExecutor
+from folly cimport cFollyTry, cFollyFuture, cFollySemiFuture, cFollyExecutor
 
 cdef extern from "folly/python/futures.h" namespace "folly::python":
     void bridgeFuture[T](
@@ -14,3 +14,14 @@ cdef extern from "folly/python/futures.h" namespace "folly::python":
         void(*)(cFollyTry[T]&&, PyObject*),
         PyObject* pyFuture
     )
+    void bridgeSemiFuture[T](
+        cFollySemiFuture[T]&& fut,
+        void(*)(cFollyTry[T]&&, PyObject*),
+        PyObject* pyFuture
+    )
+    void bridgeSemiFutureWith "folly::python::bridgeSemiFuture"[T](
+        cFollyExecutor* executor,
+        cFollySemiFuture[T]&& fut,
+        void(*)(cFollyTry[T]&&, PyObject*),
+        PyObject* pyFuture
+    )
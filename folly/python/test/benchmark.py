@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+"""
+Measures how fast results of C++ futures reach asyncio, for futures that
+complete inline and for futures completed on a C++ thread pool, where
+many results are delivered per wakeup of the loop.
+
+    python3 -m folly.python.test.benchmark [count] [rounds]
+"""
+import asyncio
+import sys
+import time
+
+from . import simplebridge
+
+
+def bench_inline(count, rounds=10):
+    """Returns bridged futures per second, completed inline"""
+    loop = asyncio.get_event_loop()
+
+    async def run():
+        for i in range(count):
+            await simplebridge.get_value_x5_semifuture(i + 1)
+
+    start = time.perf_counter()
+    for _ in range(rounds):
+        loop.run_until_complete(run())
+    return count * rounds / (time.perf_counter() - start)
+
+
+def bench_async(count, rounds=10):
+    """Returns bridged futures per second, completed on other threads"""
+    loop = asyncio.get_event_loop()
+    start = time.perf_counter()
+    for _ in range(rounds):
+        loop.run_until_complete(
+            asyncio.gather(*simplebridge.get_values_x5_async(count)))
+    return count * rounds / (time.perf_counter() - start)
+
+
+def main(argv):
+    count = int(argv[1]) if len(argv) > 1 else 10000
+    rounds = int(argv[2]) if len(argv) > 2 else 10
+    print("inline: {:.0f} futures/s".format(bench_inline(count, rounds)))
+    print("async:  {:.0f} futures/s".format(bench_async(count, rounds)))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -16,3 +16,22 @@ class Futures(unittest.TestCase):
         loop = asyncio.get_event_loop()
         with self.assertRaises(ValueError, msg="0 is not allowed"):
             loop.run_until_complete(simplebridge.get_value_x5(0))
+
+    def test_bridge_semifuture(self):
+        val = 1337
+        loop = asyncio.get_event_loop()
+        res = loop.run_until_complete(
+            simplebridge.get_value_x5_semifuture(val))
+        self.assertEqual(val * 5, res)
+
+    def test_bridge_semifuture_exception(self):
+        loop = asyncio.get_event_loop()
+        with self.assertRaises(ValueError, msg="0 is not allowed"):
+            loop.run_until_complete(simplebridge.get_value_x5_semifuture(0))
+
+    def test_bridge_many(self):
+        count = 1000
+        loop = asyncio.get_event_loop()
+        res = loop.run_until_complete(
+            asyncio.gather(*simplebridge.get_values_x5_async(count)))
+        self.assertEqual([i * 5 for i in range(count)], res)
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #pragma once
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
 #include <cstdint>
@@ -33,6 +34,20 @@ folly::Future<uint64_t> future_getValueX5(uint64_t val) {
   });
   return f;
 }
+
+folly::SemiFuture<uint64_t> semiFuture_getValueX5(uint64_t val) {
+  if (val == 0) {
+    return folly::makeSemiFuture<uint64_t>(
+        std::invalid_argument("0 is not allowed"));
+  }
+  return folly::makeSemiFuture(val * 5);
+}
+
+// Completed on another thread, like the results of an RPC
+folly::SemiFuture<uint64_t> semiFuture_getValueX5Async(uint64_t val) {
+  static folly::CPUThreadPoolExecutor executor(2);
+  return folly::via(&executor, [val] { return val * 5; });
+}
 }
 }
 }
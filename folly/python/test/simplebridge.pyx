@@ -1,12 +1,14 @@
 import asyncio
-from folly.futures cimport bridgeFuture
-from folly cimport cFollyFuture, cFollyTry
+from folly.futures cimport bridgeFuture, bridgeSemiFuture
+from folly cimport cFollyFuture, cFollySemiFuture, cFollyTry
 from libc.stdint cimport uint64_t
 from cpython.ref cimport PyObject
 from cython.operator cimport dereference as deref
 
 cdef extern from "folly/python/test/simple.h" namespace "folly::python::test":
     cdef cFollyFuture[uint64_t] future_getValueX5(uint64_t val)
+    cdef cFollySemiFuture[uint64_t] semiFuture_getValueX5(uint64_t val)
+    cdef cFollySemiFuture[uint64_t] semiFuture_getValueX5Async(uint64_t val)
 
 
 def get_value_x5(int val):
@@ -20,6 +22,36 @@ def get_value_x5(int val):
     return fut
 
 
+def get_value_x5_semifuture(int val):
+    loop = asyncio.get_event_loop()
+    fut = loop.create_future()
+    bridgeSemiFuture[uint64_t](
+        semiFuture_getValueX5(val),
+        handle_uint64_t,
+        <PyObject *>fut
+    )
+    return fut
+
+
+def get_values_x5_async(int count):
+    """
+    Starts count calls that complete on a C++ thread pool, and returns
+    their asyncio futures
+    """
+    loop = asyncio.get_event_loop()
+    futs = []
+    cdef int i
+    for i in range(count):
+        fut = loop.create_future()
+        bridgeSemiFuture[uint64_t](
+            semiFuture_getValueX5Async(i),
+            handle_uint64_t,
+            <PyObject *>fut
+        )
+        futs.append(fut)
+    return futs
+
+
 cdef void handle_uint64_t(cFollyTry[uint64_t]&& res, PyObject* userData):
     future = <object> userData
     if res.hasException():
@@ -52,6 +52,7 @@
 #include <folly/Traits.h>
 #include <folly/lang/Assume.h>
 #include <folly/memory/Malloc.h>
+#include <folly/memory/Relocate.h>
 #include <folly/portability/BitsFunctexcept.h>
 #include <folly/portability/Malloc.h>
 #include <folly/portability/TypeTraits.h>
@@ -211,10 +212,11 @@ struct IntegralSizePolicy<SizeType, true>
  public:
   /*
    * Move a range to a range of uninitialized memory.  Assumes the
-   * ranges don't overlap.
+   * ranges don't overlap.  Relocatable objects are relocated instead, so
+   * the caller must only destroy the originals of the others.
    */
   template <class T>
-  typename std::enable_if<!FOLLY_IS_TRIVIALLY_COPYABLE(T)>::type
+  typename std::enable_if<!IsRelocatable<T>::value>::type
   moveToUninitialized(T* first, T* last, T* out) {
     std::size_t idx = 0;
     try {
@@ -234,11 +236,11 @@ struct IntegralSizePolicy<SizeType, true>
     }
   }
 
-  // Specialization for trivially copyable types.
+  // Specialization for relocatable (including trivially copyable) types.
   template <class T>
-  typename std::enable_if<FOLLY_IS_TRIVIALLY_COPYABLE(T)>::type
+  typename std::enable_if<IsRelocatable<T>::value>::type
   moveToUninitialized(T* first, T* last, T* out) {
-    std::memmove(out, first, (last - first) * sizeof *first);
+    uninitialized_relocate(first, last, out);
   }
 
   /*
@@ -595,6 +597,11 @@ class small_vector : public detail::small_vector_base<
 
       size_type i = oldSmall.size();
       const size_type ci = i;
+      if (kRelocatable) {
+        uninitialized_relocate(
+            oldLarge.begin() + i, oldLarge.end(), oldSmall.begin() + i);
+        i = oldLarge.size();
+      }
       try {
         for (; i < oldLarge.size(); ++i) {
           auto addr = oldSmall.begin() + i;
@@ -623,6 +630,10 @@ class small_vector : public detail::small_vector_base<
 
     auto buff = oldExtern.u.buffer();
     size_type i = 0;
+    if (kRelocatable) {
+      uninitialized_relocate(oldIntern.begin(), oldIntern.end(), buff);
+      i = oldIntern.size();
+    }
     try {
       for (; i < oldIntern.size(); ++i) {
         new (&buff[i]) value_type(std::move(oldIntern[i]));
@@ -768,6 +779,9 @@ class small_vector : public detail::small_vector_base<
           [&t](void* ptr) { new (ptr) value_type(std::move(t)); },
           offset);
       this->setSize(this->size() + 1);
+    } else if (kRelocatable) {
+      insertRelocating(
+          offset, 1, [&t](void* ptr) { new (ptr) value_type(std::move(t)); });
     } else {
       detail::moveObjectsRight(
           data() + offset, data() + size(), data() + size() + 1);
@@ -786,6 +800,11 @@ class small_vector : public detail::small_vector_base<
   iterator insert(const_iterator pos, size_type n, value_type const& val) {
     auto offset = pos - begin();
     makeSize(size() + n);
+    if (kRelocatable) {
+      insertRelocating(
+          offset, n, [&val](void* ptr) { new (ptr) value_type(val); });
+      return begin() + offset;
+    }
     detail::moveObjectsRight(
         data() + offset, data() + size(), data() + size() + n);
     this->setSize(size() + n);
@@ -806,6 +825,12 @@ class small_vector : public detail::small_vector_base<
   }
 
   iterator erase(const_iterator q) {
+    if (kRelocatable) {
+      unconst(q)->~value_type();
+      relocate_overlapping(unconst(q) + 1, end(), unconst(q));
+      this->setSize(size() - 1);
+      return unconst(q);
+    }
     std::move(unconst(q) + 1, end(), unconst(q));
     (data() + size() - 1)->~value_type();
     this->setSize(size() - 1);
@@ -816,6 +841,14 @@ class small_vector : public detail::small_vector_base<
     if (q1 == q2) {
       return unconst(q1);
     }
+    if (kRelocatable) {
+      for (auto it = unconst(q1); it != q2; ++it) {
+        it->~value_type();
+      }
+      relocate_overlapping(unconst(q2), end(), unconst(q1));
+      this->setSize(size() - (q2 - q1));
+      return unconst(q1);
+    }
     std::move(unconst(q2), end(), unconst(q1));
     for (auto it = (end() - std::distance(q1, q2)); it != end(); ++it) {
       it->~value_type();
@@ -885,10 +918,36 @@ class small_vector : public detail::small_vector_base<
   }
 
  private:
+  // Relocatable elements are moved around with memcpy and memmove, with no
+  // constructor or destructor calls
+  static constexpr bool kRelocatable = IsRelocatable<value_type>::value;
+
   static iterator unconst(const_iterator it) {
     return const_cast<iterator>(it);
   }
 
+  /*
+   * For relocatable types: inserts n elements at offset, constructing
+   * them in order with construct(ptr).  Capacity must suffice.  If a
+   * construction throws, the vector is left as it was.
+   */
+  template <class Construct>
+  void insertRelocating(
+      size_type offset,
+      size_type n,
+      Construct const& construct) {
+    auto pos = data() + offset;
+    auto tail = data() + size();
+    relocate_overlapping(pos, tail, pos + n);
+    try {
+      detail::populateMemForward(pos, n, construct);
+    } catch (...) {
+      relocate_overlapping(pos + n, tail + n, pos);
+      throw;
+    }
+    this->setSize(size() + n);
+  }
+
   // The std::false_type argument is part of disambiguating the
   // iterator insert functions from integral types (see insert().)
   template <class It>
@@ -906,6 +965,13 @@ class small_vector : public detail::small_vector_base<
     auto distance = std::distance(first, last);
     auto offset = pos - begin();
     makeSize(size() + distance);
+    if (kRelocatable) {
+      insertRelocating(offset, distance, [&first](void* ptr) {
+        new (ptr) value_type(*first);
+        ++first;
+      });
+      return begin() + offset;
+    }
     detail::moveObjectsRight(
         data() + offset, data() + size(), data() + size() + distance);
     this->setSize(size() + distance);
@@ -1053,8 +1119,10 @@ class small_vector : public detail::small_vector_base<
       free(newh);
       throw;
     }
-    for (auto& val : *this) {
-      val.~value_type();
+    if (!kRelocatable) {
+      for (auto& val : *this) {
+        val.~value_type();
+      }
     }
 
     if (this->isExtern()) {
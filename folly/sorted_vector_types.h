@@ -48,6 +48,11 @@
  *                              OneAtATimePolicy>
  *            OneAtATimeIntSet;
  *
+ * The Container does the moving around of elements on insert() and
+ * erase().  With fbvector or small_vector, relocatable elements (see
+ * IsRelocatable in Traits.h) are moved with memmove() rather than with
+ * their move constructors and assignments.
+ *
  * Important differences from std::set and std::map:
  *   - insert() and erase() invalidate iterators and references
  *   - insert() and erase() are O(N)
@@ -193,6 +198,33 @@ void bulk_insert(
         cont.end());
   }
 }
+
+// Galloping from the previous result, each search takes O(log d) for a
+// distance d from it, and mostly touches memory that the previous one did.
+template <class Iterator, class InputIterator, class OutputIterator, class Less>
+OutputIterator bulk_lower_bound(
+    Iterator begin,
+    Iterator end,
+    InputIterator first,
+    InputIterator last,
+    OutputIterator out,
+    Less less) {
+  auto it = begin;
+  for (; first != last; ++first) {
+    auto const& key = *first;
+    // Everything before it is less than key; find an element that isn't
+    typename std::iterator_traits<Iterator>::difference_type step = 1;
+    auto hi = it;
+    while (hi != end && less(*hi, key)) {
+      it = hi + 1;
+      hi = end - it > step ? it + step : end;
+      step *= 2;
+    }
+    it = std::lower_bound(it, hi, key, less);
+    *out++ = it;
+  }
+  return out;
+}
 } // namespace detail
 
 //////////////////////////////////////////////////////////////////////
@@ -403,6 +435,21 @@ class sorted_vector_set
     return std::lower_bound(begin(), end(), key, key_comp());
   }
 
+  /**
+   * Write lower_bound(key) for each key of the sorted range [first, last),
+   * in order, to out.  Each search starts from the previous result, so
+   * this is faster than separate searches, and linear in the size of the
+   * set at worst.
+   */
+  template <class InputIterator, class OutputIterator>
+  OutputIterator bulk_lower_bound(
+      InputIterator first,
+      InputIterator last,
+      OutputIterator out) const {
+    return detail::bulk_lower_bound(
+        begin(), end(), first, last, out, key_comp());
+  }
+
   iterator upper_bound(const key_type& key) {
     return std::upper_bound(begin(), end(), key, key_comp());
   }
@@ -730,6 +777,23 @@ class sorted_vector_map
     return lower_bound(*this, key);
   }
 
+  /**
+   * Write lower_bound(key) for each key of the sorted range [first, last),
+   * in order, to out.  Each search starts from the previous result, so
+   * this is faster than separate searches, and linear in the size of the
+   * map at worst.
+   */
+  template <class InputIterator, class OutputIterator>
+  OutputIterator bulk_lower_bound(
+      InputIterator first,
+      InputIterator last,
+      OutputIterator out) const {
+    auto f = [c = key_comp()](value_type const& a, auto const& b) {
+      return c(a.first, b);
+    };
+    return detail::bulk_lower_bound(begin(), end(), first, last, out, f);
+  }
+
   iterator upper_bound(const key_type& key) {
     return upper_bound(*this, key);
   }
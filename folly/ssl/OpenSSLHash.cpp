@@ -21,6 +21,55 @@
 namespace folly {
 namespace ssl {
 
+// Plain thread_locals rather than SingletonThreadLocal, so that hashing
+// doesn't depend on the singleton vault being set up
+OpenSSLHash::Digest& OpenSSLHash::threadLocalDigest() {
+  static thread_local Digest digest;
+  return digest;
+}
+
+OpenSSLHash::Hmac& OpenSSLHash::threadLocalHmac() {
+  static thread_local Hmac hmac;
+  return hmac;
+}
+
+void OpenSSLHash::hash_many(
+    MutableByteRange out,
+    const EVP_MD* md,
+    Range<const ByteRange*> data) {
+  const auto size = size_t(EVP_MD_size(md));
+  check_out_size(size * data.size(), out);
+  auto& hash = threadLocalDigest();
+  for (auto& d : data) {
+    hash.hash_init(md);
+    hash.hash_update(d);
+    hash.hash_final(MutableByteRange(out.data(), size));
+    out.advance(size);
+  }
+}
+
+void OpenSSLHash::hmac_many(
+    MutableByteRange out,
+    const EVP_MD* md,
+    ByteRange key,
+    Range<const ByteRange*> data) {
+  const auto size = size_t(EVP_MD_size(md));
+  check_out_size(size * data.size(), out);
+  if (data.empty()) {
+    return;
+  }
+  auto& hmac = threadLocalHmac();
+  hmac.hash_init(md, key);
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i > 0) {
+      hmac.hash_reinit();
+    }
+    hmac.hash_update(data[i]);
+    hmac.hash_final(MutableByteRange(out.data(), size));
+    out.advance(size);
+  }
+}
+
 [[noreturn]] void OpenSSLHash::check_out_size_throw(
     size_t size,
     MutableByteRange out) {
@@ -26,6 +26,12 @@ namespace ssl {
 
 /// Warning:
 /// These functions are not thread-safe unless you initialize OpenSSL.
+///
+/// The static functions reuse a context per thread.  Digest and Hmac
+/// objects can be reused too, and that is worth doing for small messages:
+/// hash_init with the same md skips looking the digest up again, and
+/// Hmac::hash_reinit skips hashing the key again.  The *_many functions
+/// do both for many independent messages.
 class OpenSSLHash {
  public:
   class Digest {
@@ -47,16 +53,25 @@ class OpenSSLHash {
     }
 
     void hash_init(const EVP_MD* md) {
+      // A null md restarts with the context's current digest, without
+      // fetching it again
+      check_libssl_result(
+          1,
+          EVP_DigestInit_ex(
+              ctx_.get(), md == initMd_ ? nullptr : md, nullptr));
       md_ = md;
-      check_libssl_result(1, EVP_DigestInit_ex(ctx_.get(), md, nullptr));
+      initMd_ = md;
     }
     void hash_update(ByteRange data) {
       check_libssl_result(
           1, EVP_DigestUpdate(ctx_.get(), data.data(), data.size()));
     }
+    /// Hashes the buffers of the chain in place, without coalescing.
     void hash_update(const IOBuf& data) {
       for (auto r : data) {
-        hash_update(r);
+        if (!r.empty()) {
+          hash_update(r);
+        }
       }
     }
     void hash_final(MutableByteRange out) {
@@ -70,21 +85,29 @@ class OpenSSLHash {
 
    private:
     const EVP_MD* md_ = nullptr;
+    // The digest ctx_ was last initialized with
+    const EVP_MD* initMd_ = nullptr;
     EvpMdCtxUniquePtr ctx_{nullptr};
   };
 
   static void hash(MutableByteRange out, const EVP_MD* md, ByteRange data) {
-    Digest hash;
+    auto& hash = threadLocalDigest();
     hash.hash_init(md);
     hash.hash_update(data);
     hash.hash_final(out);
   }
   static void hash(MutableByteRange out, const EVP_MD* md, const IOBuf& data) {
-    Digest hash;
+    auto& hash = threadLocalDigest();
     hash.hash_init(md);
     hash.hash_update(data);
     hash.hash_final(out);
   }
+  /// Hashes each of data separately, writing the digests one after the
+  /// other to out, which must hold data.size() digests.
+  static void hash_many(
+      MutableByteRange out,
+      const EVP_MD* md,
+      Range<const ByteRange*> data);
   static void sha1(MutableByteRange out, ByteRange data) {
     hash(out, EVP_sha1(), data);
   }
@@ -97,6 +120,9 @@ class OpenSSLHash {
   static void sha256(MutableByteRange out, const IOBuf& data) {
     hash(out, EVP_sha256(), data);
   }
+  static void sha256_many(MutableByteRange out, Range<const ByteRange*> data) {
+    hash_many(out, EVP_sha256(), data);
+  }
 
   class Hmac {
    public:
@@ -104,16 +130,27 @@ class OpenSSLHash {
 
     void hash_init(const EVP_MD* md, ByteRange key) {
       md_ = md;
+      keyMd_ = md;
       check_libssl_result(
           1,
           HMAC_Init_ex(ctx_.get(), key.data(), int(key.size()), md_, nullptr));
     }
+    /// Starts another message with the md and key of the last hash_init,
+    /// which were already hashed into the context.
+    void hash_reinit() {
+      md_ = keyMd_;
+      check_libssl_result(
+          1, HMAC_Init_ex(ctx_.get(), nullptr, 0, nullptr, nullptr));
+    }
     void hash_update(ByteRange data) {
       check_libssl_result(1, HMAC_Update(ctx_.get(), data.data(), data.size()));
     }
+    /// Hashes the buffers of the chain in place, without coalescing.
     void hash_update(const IOBuf& data) {
       for (auto r : data) {
-        hash_update(r);
+        if (!r.empty()) {
+          hash_update(r);
+        }
       }
     }
     void hash_final(MutableByteRange out) {
@@ -127,12 +164,13 @@ class OpenSSLHash {
 
    private:
     const EVP_MD* md_ = nullptr;
+    const EVP_MD* keyMd_ = nullptr;
     HmacCtxUniquePtr ctx_{nullptr};
   };
 
   static void
   hmac(MutableByteRange out, const EVP_MD* md, ByteRange key, ByteRange data) {
-    Hmac hmac;
+    auto& hmac = threadLocalHmac();
     hmac.hash_init(md, key);
     hmac.hash_update(data);
     hmac.hash_final(out);
@@ -142,11 +180,18 @@ class OpenSSLHash {
       const EVP_MD* md,
       ByteRange key,
       const IOBuf& data) {
-    Hmac hmac;
+    auto& hmac = threadLocalHmac();
     hmac.hash_init(md, key);
     hmac.hash_update(data);
     hmac.hash_final(out);
   }
+  /// Like hash_many, with the same key for every message, which is only
+  /// hashed once.
+  static void hmac_many(
+      MutableByteRange out,
+      const EVP_MD* md,
+      ByteRange key,
+      Range<const ByteRange*> data);
   static void hmac_sha1(MutableByteRange out, ByteRange key, ByteRange data) {
     hmac(out, EVP_sha1(), key, data);
   }
@@ -161,8 +206,17 @@ class OpenSSLHash {
   hmac_sha256(MutableByteRange out, ByteRange key, const IOBuf& data) {
     hmac(out, EVP_sha256(), key, data);
   }
+  static void hmac_sha256_many(
+      MutableByteRange out,
+      ByteRange key,
+      Range<const ByteRange*> data) {
+    hmac_many(out, EVP_sha256(), key, data);
+  }
 
  private:
+  static Digest& threadLocalDigest();
+  static Hmac& threadLocalHmac();
+
   static inline void check_out_size(size_t size, MutableByteRange out) {
     if (LIKELY(size == out.size())) {
       return;
@@ -101,3 +101,76 @@ TEST_F(OpenSSLHashTest, hmac_sha256) {
   OpenSSLHash::hmac_sha256(range(out), key, buf);
   EXPECT_EQ(expected, out);
 }
+
+TEST_F(OpenSSLHashTest, digest_reuse) {
+  std::array<uint8_t, 32> expected, actual;
+  std::array<uint8_t, 20> expected1, actual1;
+  SHA256(reinterpret_cast<const uint8_t*>("bar"), 3, expected.data());
+  SHA1(reinterpret_cast<const uint8_t*>("bar"), 3, expected1.data());
+
+  OpenSSLHash::Digest digest;
+  digest.hash_init(EVP_sha256());
+  digest.hash_update(ByteRange(StringPiece("foo")));
+  digest.hash_final(range(actual));
+  digest.hash_init(EVP_sha256());
+  digest.hash_update(ByteRange(StringPiece("bar")));
+  digest.hash_final(range(actual));
+  EXPECT_EQ(expected, actual);
+
+  digest.hash_init(EVP_sha1());
+  digest.hash_update(ByteRange(StringPiece("bar")));
+  digest.hash_final(range(actual1));
+  EXPECT_EQ(expected1, actual1);
+}
+
+TEST_F(OpenSSLHashTest, sha256_many) {
+  vector<ByteRange> data = {ByteRange(StringPiece("foo")),
+                            ByteRange(),
+                            ByteRange(StringPiece("foobar"))};
+  auto expected = vector<uint8_t>(32 * data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    SHA256(data[i].data(), data[i].size(), expected.data() + 32 * i);
+  }
+
+  auto out = vector<uint8_t>(32 * data.size());
+  OpenSSLHash::sha256_many(range(out), range(data));
+  EXPECT_EQ(expected, out);
+
+  auto small = vector<uint8_t>(32);
+  EXPECT_THROW(
+      OpenSSLHash::sha256_many(range(small), range(data)),
+      std::invalid_argument);
+}
+
+TEST_F(OpenSSLHashTest, hmac_sha256_many) {
+  auto key = ByteRange(StringPiece("qwerty"));
+  vector<ByteRange> data = {ByteRange(StringPiece("foo")),
+                            ByteRange(StringPiece("bar")),
+                            ByteRange(StringPiece("foobar"))};
+  auto expected = vector<uint8_t>(32 * data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    HMAC(
+        EVP_sha256(),
+        key.data(),
+        int(key.size()),
+        data[i].data(),
+        data[i].size(),
+        expected.data() + 32 * i,
+        nullptr);
+  }
+
+  auto out = vector<uint8_t>(32 * data.size());
+  OpenSSLHash::hmac_sha256_many(range(out), key, range(data));
+  EXPECT_EQ(expected, out);
+
+  // hash_reinit keeps the key
+  OpenSSLHash::Hmac hmac;
+  hmac.hash_init(EVP_sha256(), key);
+  hmac.hash_update(data[0]);
+  hmac.hash_final(range(out).subpiece(0, 32));
+  hmac.hash_reinit();
+  hmac.hash_update(data[2]);
+  hmac.hash_final(range(out).subpiece(0, 32));
+  EXPECT_TRUE(std::equal(
+      expected.begin() + 64, expected.end(), out.begin()));
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/stats/BucketedTimeSeries.h>
+
+namespace folly {
+
+/*
+ * BucketedSketch keeps a mergeable sketch (HyperLogLog, CountMinSketch,
+ * SpaceSaving...) of what was added over a sliding window of time, the way
+ * BucketedTimeSeries keeps a sum and a count:
+ *
+ *   // Distinct callers in the last minute
+ *   BucketedSketch<HyperLogLog> callers(60, seconds(60), HyperLogLog(12));
+ *   callers.add(now, callerId);
+ *   ...
+ *   callers.update(now);
+ *   uint64_t distinct = callers.get().estimate();
+ *
+ * The duration is divided into numBuckets buckets, each with its own
+ * sketch; as time advances, a bucket at a time is cleared and reused.  The
+ * sketch of the window is the merge of the sketches of the buckets.  A
+ * duration of 0 tracks all time, in a single bucket.  As in
+ * BucketedTimeSeries, the duration is rounded down to a multiple of the
+ * number of buckets, times older than the window are ignored, and update()
+ * should be called before querying.
+ *
+ * The Sketch type must be copyable, and have merge(const Sketch&) and
+ * clear() methods; add(now, args...) calls its add(args...).
+ *
+ * This class is not thread-safe -- use your own synchronization!
+ */
+template <class Sketch, class CT = LegacyStatsClock<std::chrono::seconds>>
+class BucketedSketch {
+ public:
+  using SketchType = Sketch;
+  using Clock = CT;
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+
+  /*
+   * Create a new BucketedSketch.  Every bucket starts as a copy of the
+   * given empty sketch, which determines their size and precision.
+   */
+  BucketedSketch(size_t numBuckets, Duration duration, const Sketch& empty)
+      : duration_(duration),
+        empty_(empty),
+        latestId_(std::numeric_limits<int64_t>::min()) {
+    CHECK_GT(numBuckets, 0u);
+    if (duration_ == Duration(0)) {
+      numBuckets = 1;
+      bucketWidth_ = Duration(0);
+    } else {
+      // Same as BucketedTimeSeries: no more buckets than duration units
+      if (uint64_t(duration_.count()) < numBuckets) {
+        numBuckets = size_t(duration_.count());
+      }
+      bucketWidth_ = duration_ / numBuckets;
+    }
+    buckets_.assign(numBuckets, empty_);
+    bucketIds_.assign(numBuckets, std::numeric_limits<int64_t>::min());
+  }
+
+  /*
+   * Adds to the sketch of the bucket of 'now', moving the window forward
+   * if 'now' is more recent than any time seen before.  Returns false,
+   * without doing anything, if 'now' is older than the window.
+   */
+  template <class... Args>
+  bool add(TimePoint now, Args&&... args) {
+    Sketch* bucket = getBucket(now);
+    if (!bucket) {
+      return false;
+    }
+    bucket->add(std::forward<Args>(args)...);
+    return true;
+  }
+
+  /* Merges a sketch into the bucket of 'now', same as add(). */
+  bool addSketch(TimePoint now, const Sketch& sketch) {
+    Sketch* bucket = getBucket(now);
+    if (!bucket) {
+      return false;
+    }
+    bucket->merge(sketch);
+    return true;
+  }
+
+  /* Moves the window forward to 'now'. */
+  void update(TimePoint now) {
+    latestId_ = std::max(latestId_, bucketId(now));
+  }
+
+  /* Returns the merged sketch of the window.  Call update(now) first. */
+  Sketch get() const {
+    Sketch result(empty_);
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      if (isLive(bucketIds_[i])) {
+        result.merge(buckets_[i]);
+      }
+    }
+    return result;
+  }
+
+  void clear() {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    std::fill(
+        bucketIds_.begin(),
+        bucketIds_.end(),
+        std::numeric_limits<int64_t>::min());
+    latestId_ = std::numeric_limits<int64_t>::min();
+  }
+
+  Duration duration() const {
+    return duration_;
+  }
+
+  size_t numBuckets() const {
+    return buckets_.size();
+  }
+
+  bool isAllTime() const {
+    return duration_ == Duration(0);
+  }
+
+ private:
+  // Which bucketWidth_ the time is in, counting from the epoch
+  int64_t bucketId(TimePoint time) const {
+    if (isAllTime()) {
+      return 0;
+    }
+    auto sinceEpoch = time.time_since_epoch();
+    int64_t id = sinceEpoch / bucketWidth_;
+    if (sinceEpoch < Duration(0) && sinceEpoch % bucketWidth_ != Duration(0)) {
+      --id;
+    }
+    return id;
+  }
+
+  bool isLive(int64_t id) const {
+    return latestId_ != std::numeric_limits<int64_t>::min() &&
+        id > latestId_ - int64_t(buckets_.size()) && id <= latestId_;
+  }
+
+  Sketch* getBucket(TimePoint now) {
+    int64_t id = bucketId(now);
+    latestId_ = std::max(latestId_, id);
+    if (!isLive(id)) {
+      return nullptr;
+    }
+    int64_t numBuckets = int64_t(buckets_.size());
+    size_t slot = size_t(((id % numBuckets) + numBuckets) % numBuckets);
+    if (bucketIds_[slot] != id) {
+      buckets_[slot].clear();
+      bucketIds_[slot] = id;
+    }
+    return &buckets_[slot];
+  }
+
+  Duration duration_;
+  Duration bucketWidth_;
+  Sketch empty_;
+  std::vector<Sketch> buckets_;
+  std::vector<int64_t> bucketIds_;
+  int64_t latestId_;
+};
+
+} // namespace folly
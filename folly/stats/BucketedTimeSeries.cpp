@@ -19,4 +19,5 @@
 
 namespace folly {
 template class BucketedTimeSeries<int64_t>;
+template class BucketedTimeSeries<int64_t, std::chrono::steady_clock>;
 } // namespace folly
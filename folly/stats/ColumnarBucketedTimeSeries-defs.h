@@ -0,0 +1,475 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <folly/Likely.h>
+#include <folly/stats/ColumnarBucketedTimeSeries.h>
+#include <folly/stats/detail/SumColumn.h>
+
+namespace folly {
+
+template <typename VT, typename CT>
+ColumnarBucketedTimeSeries<VT, CT>::ColumnarBucketedTimeSeries(
+    size_t nBuckets,
+    Duration maxDuration)
+    : firstTime_(Duration(1)),
+      latestTime_(),
+      duration_(maxDuration),
+      totalSum_(),
+      totalCount_(0) {
+  // For tracking all-time data we only use the totals
+  if (!isAllTime()) {
+    // Same as BucketedTimeSeries: no more buckets than duration units
+    if (nBuckets > size_t(duration_.count())) {
+      nBuckets = size_t(duration_.count());
+    }
+    sums_.resize(nBuckets, ValueType());
+    counts_.resize(nBuckets, 0);
+  }
+}
+
+template <typename VT, typename CT>
+bool ColumnarBucketedTimeSeries<VT, CT>::addValueAggregated(
+    TimePoint now,
+    const ValueType& total,
+    uint64_t nsamples) {
+  if (isAllTime()) {
+    if (UNLIKELY(empty())) {
+      firstTime_ = now;
+      latestTime_ = now;
+    } else if (now > latestTime_) {
+      latestTime_ = now;
+    } else if (now < firstTime_) {
+      firstTime_ = now;
+    }
+    totalSum_ += total;
+    totalCount_ += nsamples;
+    return true;
+  }
+
+  size_t bucketIdx;
+  if (UNLIKELY(empty())) {
+    firstTime_ = now;
+    latestTime_ = now;
+    bucketIdx = getBucketIdx(now);
+  } else if (now > latestTime_) {
+    bucketIdx = updateBuckets(now);
+  } else if (LIKELY(now == latestTime_)) {
+    bucketIdx = getBucketIdx(now);
+  } else {
+    if (now < getEarliestTimeNonEmpty()) {
+      return false;
+    }
+    bucketIdx = getBucketIdx(now);
+  }
+
+  totalSum_ += total;
+  totalCount_ += nsamples;
+  sums_[bucketIdx] += total;
+  counts_[bucketIdx] += nsamples;
+  return true;
+}
+
+template <typename VT, typename CT>
+size_t ColumnarBucketedTimeSeries<VT, CT>::update(TimePoint now) {
+  if (empty()) {
+    firstTime_ = now;
+  }
+
+  if (isAllTime()) {
+    latestTime_ = std::max(latestTime_, now);
+    return 0;
+  }
+
+  if (now <= latestTime_) {
+    return getBucketIdx(latestTime_);
+  }
+
+  return updateBuckets(now);
+}
+
+template <typename VT, typename CT>
+size_t ColumnarBucketedTimeSeries<VT, CT>::updateBuckets(TimePoint now) {
+  size_t currentBucket;
+  TimePoint currentBucketStart;
+  TimePoint nextBucketStart;
+  getBucketInfo(
+      latestTime_, &currentBucket, &currentBucketStart, &nextBucketStart);
+
+  latestTime_ = now;
+
+  if (now < nextBucketStart) {
+    return currentBucket;
+  } else if (now >= currentBucketStart + duration_) {
+    // All of the buckets expired
+    std::fill(sums_.begin(), sums_.end(), ValueType());
+    std::fill(counts_.begin(), counts_.end(), 0);
+    totalSum_ = ValueType();
+    totalCount_ = 0;
+    return getBucketIdx(latestTime_);
+  } else {
+    // Clear the buckets in (currentBucket, newBucket], circularly
+    size_t newBucket = getBucketIdx(now);
+    size_t idx = currentBucket;
+    while (idx != newBucket) {
+      ++idx;
+      if (idx >= sums_.size()) {
+        idx = 0;
+      }
+      totalSum_ -= sums_[idx];
+      totalCount_ -= counts_[idx];
+      sums_[idx] = ValueType();
+      counts_[idx] = 0;
+    }
+    return newBucket;
+  }
+}
+
+template <typename VT, typename CT>
+void ColumnarBucketedTimeSeries<VT, CT>::clear() {
+  std::fill(sums_.begin(), sums_.end(), ValueType());
+  std::fill(counts_.begin(), counts_.end(), 0);
+  totalSum_ = ValueType();
+  totalCount_ = 0;
+  // Set firstTime_ larger than latestTime_,
+  // to indicate that the timeseries is empty
+  firstTime_ = TimePoint(Duration(1));
+  latestTime_ = TimePoint();
+}
+
+template <typename VT, typename CT>
+typename CT::time_point ColumnarBucketedTimeSeries<VT, CT>::getEarliestTime()
+    const {
+  if (empty()) {
+    return TimePoint();
+  }
+  if (isAllTime()) {
+    return firstTime_;
+  }
+  return std::max(getEarliestTimeNonEmpty(), firstTime_);
+}
+
+template <typename VT, typename CT>
+typename CT::time_point
+ColumnarBucketedTimeSeries<VT, CT>::getEarliestTimeNonEmpty() const {
+  size_t currentBucket;
+  TimePoint currentBucketStart;
+  TimePoint nextBucketStart;
+  getBucketInfo(
+      latestTime_, &currentBucket, &currentBucketStart, &nextBucketStart);
+  return nextBucketStart - duration_;
+}
+
+template <typename VT, typename CT>
+typename CT::duration ColumnarBucketedTimeSeries<VT, CT>::elapsed() const {
+  if (empty()) {
+    return Duration(0);
+  }
+  // Add 1 since [latestTime_, earliestTime] is an inclusive interval.
+  return latestTime_ - getEarliestTime() + Duration(1);
+}
+
+template <typename VT, typename CT>
+typename CT::duration ColumnarBucketedTimeSeries<VT, CT>::elapsed(
+    TimePoint start,
+    TimePoint end) const {
+  if (empty()) {
+    return Duration(0);
+  }
+  start = std::max(start, getEarliestTime());
+  end = std::min(end, latestTime_ + Duration(1));
+  end = std::max(start, end);
+  return end - start;
+}
+
+template <typename VT, typename CT>
+size_t ColumnarBucketedTimeSeries<VT, CT>::getBucketIdx(TimePoint time) const {
+  DCHECK(!isAllTime());
+  auto timeIntoCurrentCycle = (time.time_since_epoch() % duration_);
+  return timeIntoCurrentCycle.count() * sums_.size() / duration_.count();
+}
+
+/*
+ * Same as BucketedTimeSeries::getBucketInfo(), see the note there about
+ * the bucket index calculations.
+ */
+template <typename VT, typename CT>
+void ColumnarBucketedTimeSeries<VT, CT>::getBucketInfo(
+    TimePoint time,
+    size_t* bucketIdx,
+    TimePoint* bucketStart,
+    TimePoint* nextBucketStart) const {
+  typedef typename Duration::rep TimeInt;
+  DCHECK(!isAllTime());
+
+  Duration timeMod = time.time_since_epoch() % duration_;
+  TimeInt numFullDurations = time.time_since_epoch() / duration_;
+
+  TimeInt scaledTime = timeMod.count() * TimeInt(sums_.size());
+
+  *bucketIdx = size_t(scaledTime / duration_.count());
+  TimeInt scaledOffsetInBucket = scaledTime % duration_.count();
+
+  TimeInt scaledBucketStart = scaledTime - scaledOffsetInBucket;
+  TimeInt scaledNextBucketStart = scaledBucketStart + duration_.count();
+
+  Duration bucketStartMod(
+      (scaledBucketStart + sums_.size() - 1) / sums_.size());
+  Duration nextBucketStartMod(
+      (scaledNextBucketStart + sums_.size() - 1) / sums_.size());
+
+  TimePoint durationStart(numFullDurations * duration_);
+  *bucketStart = bucketStartMod + durationStart;
+  *nextBucketStart = nextBucketStartMod + durationStart;
+}
+
+template <typename VT, typename CT>
+size_t ColumnarBucketedTimeSeries<VT, CT>::oldestIdx() const {
+  size_t idx = getBucketIdx(latestTime_) + 1;
+  return idx == sums_.size() ? 0 : idx;
+}
+
+template <typename VT, typename CT>
+bool ColumnarBucketedTimeSeries<VT, CT>::locate(
+    TimePoint start,
+    TimePoint end,
+    Span* span) const {
+  // Only the data in [earliest bucket start, latestTime_] can be queried
+  start = std::max(start, getEarliestTimeNonEmpty());
+  end = std::min(end, latestTime_ + Duration(1));
+  if (start >= end) {
+    return false;
+  }
+
+  getBucketInfo(start, &span->firstIdx, &span->firstStart, &span->firstNext);
+  getBucketInfo(
+      end - Duration(1), &span->lastIdx, &span->lastStart, &span->lastNext);
+  size_t n = sums_.size();
+  size_t oldest = oldestIdx();
+  span->first = (span->firstIdx + n - oldest) % n;
+  span->last = (span->lastIdx + n - oldest) % n;
+  return true;
+}
+
+template <typename VT, typename CT>
+template <typename T>
+T ColumnarBucketedTimeSeries<VT, CT>::sumPositions(
+    const std::vector<T>& column,
+    size_t first,
+    size_t last) const {
+  if (first >= last) {
+    return T();
+  }
+  // The positions are contiguous, except where they wrap around
+  size_t n = column.size();
+  size_t idx = (oldestIdx() + first) % n;
+  size_t size = last - first;
+  size_t head = std::min(size, n - idx);
+  T total = detail::sumColumn(column.data() + idx, head);
+  if (head < size) {
+    total += detail::sumColumn(column.data(), size - head);
+  }
+  return total;
+}
+
+template <typename VT, typename CT>
+void ColumnarBucketedTimeSeries<VT, CT>::computePrefix(Prefix* prefix) const {
+  if (isAllTime()) {
+    // All time queries only use the totals
+    return;
+  }
+  size_t n = sums_.size();
+  prefix->sums.resize(n + 1);
+  prefix->counts.resize(n + 1);
+  prefix->sums[0] = ValueType();
+  prefix->counts[0] = 0;
+  size_t idx = oldestIdx();
+  for (size_t p = 0; p < n; ++p) {
+    prefix->sums[p + 1] = prefix->sums[p] + sums_[idx];
+    prefix->counts[p + 1] = prefix->counts[p] + counts_[idx];
+    if (++idx == n) {
+      idx = 0;
+    }
+  }
+}
+
+template <typename VT, typename CT>
+template <typename Inner>
+std::pair<VT, uint64_t> ColumnarBucketedTimeSeries<VT, CT>::query(
+    TimePoint start,
+    TimePoint end,
+    Inner&& inner) const {
+  if (empty()) {
+    return std::make_pair(ValueType(), uint64_t(0));
+  }
+
+  if (isAllTime()) {
+    if (start >= latestTime_ + Duration(1) || end <= firstTime_) {
+      return std::make_pair(ValueType(), uint64_t(0));
+    }
+    TimePoint next = latestTime_ + Duration(1);
+    return std::make_pair(
+        rangeAdjust(firstTime_, next, start, end, totalSum_),
+        uint64_t(
+            rangeAdjust(firstTime_, next, start, end, ValueType(totalCount_))));
+  }
+
+  Span span;
+  if (!locate(start, end, &span)) {
+    return std::make_pair(ValueType(), uint64_t(0));
+  }
+
+  ValueType sum = rangeAdjust(
+      span.firstStart, span.firstNext, start, end, sums_[span.firstIdx]);
+  uint64_t count = rangeAdjust(
+      span.firstStart,
+      span.firstNext,
+      start,
+      end,
+      ValueType(counts_[span.firstIdx]));
+  if (span.first != span.last) {
+    auto within = inner(span.first + 1, span.last);
+    sum += within.first;
+    count += within.second;
+    sum += rangeAdjust(
+        span.lastStart, span.lastNext, start, end, sums_[span.lastIdx]);
+    count += rangeAdjust(
+        span.lastStart,
+        span.lastNext,
+        start,
+        end,
+        ValueType(counts_[span.lastIdx]));
+  }
+  return std::make_pair(sum, count);
+}
+
+template <typename VT, typename CT>
+VT ColumnarBucketedTimeSeries<VT, CT>::sum(TimePoint start, TimePoint end)
+    const {
+  return query(start, end, [this](size_t first, size_t last) {
+           return std::make_pair(
+               sumPositions(sums_, first, last), uint64_t(0));
+         })
+      .first;
+}
+
+template <typename VT, typename CT>
+uint64_t ColumnarBucketedTimeSeries<VT, CT>::count(
+    TimePoint start,
+    TimePoint end) const {
+  return query(start, end, [this](size_t first, size_t last) {
+           return std::make_pair(
+               ValueType(), sumPositions(counts_, first, last));
+         })
+      .second;
+}
+
+template <typename VT, typename CT>
+template <typename ReturnType>
+ReturnType ColumnarBucketedTimeSeries<VT, CT>::avg(
+    TimePoint start,
+    TimePoint end) const {
+  auto result = query(start, end, [this](size_t first, size_t last) {
+    return std::make_pair(
+        sumPositions(sums_, first, last), sumPositions(counts_, first, last));
+  });
+  if (result.second == 0) {
+    return ReturnType(0);
+  }
+  return detail::avgHelper<ReturnType>(result.first, result.second);
+}
+
+template <typename VT, typename CT>
+void ColumnarBucketedTimeSeries<VT, CT>::sum(
+    Range<const TimeRange*> ranges,
+    ValueType* out) const {
+  Prefix prefix;
+  computePrefix(&prefix);
+  for (const auto& range : ranges) {
+    *out++ = query(range.first, range.second, [&](size_t first, size_t last) {
+               return std::make_pair(
+                   prefix.sums[last] - prefix.sums[first], uint64_t(0));
+             })
+                 .first;
+  }
+}
+
+template <typename VT, typename CT>
+void ColumnarBucketedTimeSeries<VT, CT>::count(
+    Range<const TimeRange*> ranges,
+    uint64_t* out) const {
+  Prefix prefix;
+  computePrefix(&prefix);
+  for (const auto& range : ranges) {
+    *out++ = query(range.first, range.second, [&](size_t first, size_t last) {
+               return std::make_pair(
+                   ValueType(), prefix.counts[last] - prefix.counts[first]);
+             })
+                 .second;
+  }
+}
+
+template <typename VT, typename CT>
+template <typename ReturnType>
+void ColumnarBucketedTimeSeries<VT, CT>::avg(
+    Range<const TimeRange*> ranges,
+    ReturnType* out) const {
+  Prefix prefix;
+  computePrefix(&prefix);
+  for (const auto& range : ranges) {
+    auto result =
+        query(range.first, range.second, [&](size_t first, size_t last) {
+          return std::make_pair(
+              prefix.sums[last] - prefix.sums[first],
+              prefix.counts[last] - prefix.counts[first]);
+        });
+    *out++ = result.second == 0
+        ? ReturnType(0)
+        : detail::avgHelper<ReturnType>(result.first, result.second);
+  }
+}
+
+/*
+ * Same as BucketedTimeSeries::rangeAdjust(): the part of the input of a
+ * bucket that falls within [start, end).
+ */
+template <typename VT, typename CT>
+VT ColumnarBucketedTimeSeries<VT, CT>::rangeAdjust(
+    TimePoint bucketStart,
+    TimePoint nextBucketStart,
+    TimePoint start,
+    TimePoint end,
+    ValueType input) const {
+  if (bucketStart <= latestTime_ && nextBucketStart > latestTime_) {
+    nextBucketStart = latestTime_ + Duration(1);
+  }
+
+  if (start <= bucketStart && end >= nextBucketStart) {
+    return input;
+  }
+
+  TimePoint intervalStart = std::max(start, bucketStart);
+  TimePoint intervalEnd = std::min(end, nextBucketStart);
+  return input * (intervalEnd - intervalStart) /
+      (nextBucketStart - bucketStart);
+}
+
+} // namespace folly
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/stats/BucketedTimeSeries.h>
+
+namespace folly {
+
+/*
+ * ColumnarBucketedTimeSeries is a BucketedTimeSeries that stores the sums
+ * and the counts of its buckets in two separate arrays, rather than an
+ * array of Buckets, for faster range queries.
+ *
+ * It keeps the same buckets, and its methods have the same semantics as
+ * their BucketedTimeSeries counterparts.  The difference is in how range
+ * queries (sum(start, end) and friends) are answered: BucketedTimeSeries
+ * visits every bucket in the window, computing its bounds; here only the
+ * first and the last bucket of the range are looked at individually, and
+ * the buckets wholly within the range are summed as contiguous arrays,
+ * with SIMD for 64-bit integers.
+ *
+ * Many ranges can also be queried at once: the batch sum(), count() and
+ * avg() methods compute running totals of the buckets in one pass, and
+ * then answer each range in constant time.  For floating point values,
+ * the results may differ from those of single queries by rounding errors.
+ *
+ * This class is not thread-safe -- use your own synchronization!
+ */
+template <typename VT, typename CT = LegacyStatsClock<std::chrono::seconds>>
+class ColumnarBucketedTimeSeries {
+ public:
+  using ValueType = VT;
+  using Clock = CT;
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+  // [start, end)
+  using TimeRange = std::pair<TimePoint, TimePoint>;
+
+  /*
+   * Same as the BucketedTimeSeries constructor.  If the duration is 0, all
+   * time is tracked, and numBuckets is ignored.
+   */
+  ColumnarBucketedTimeSeries(size_t numBuckets, Duration duration);
+
+  bool addValue(TimePoint now, const ValueType& val) {
+    return addValueAggregated(now, val, 1);
+  }
+
+  bool addValue(TimePoint now, const ValueType& val, uint64_t times) {
+    return addValueAggregated(now, val * ValueType(times), times);
+  }
+
+  bool
+  addValueAggregated(TimePoint now, const ValueType& total, uint64_t nsamples);
+
+  size_t update(TimePoint now);
+
+  void clear();
+
+  TimePoint getLatestTime() const {
+    return latestTime_;
+  }
+
+  TimePoint getEarliestTime() const;
+
+  size_t numBuckets() const {
+    return sums_.size();
+  }
+
+  Duration duration() const {
+    return duration_;
+  }
+
+  bool isAllTime() const {
+    return (duration_ == Duration(0));
+  }
+
+  bool empty() const {
+    return firstTime_ > latestTime_;
+  }
+
+  /* The sums and the counts of the buckets, by bucket index. */
+  const std::vector<ValueType>& sums() const {
+    return sums_;
+  }
+
+  const std::vector<uint64_t>& counts() const {
+    return counts_;
+  }
+
+  Duration elapsed() const;
+
+  Duration elapsed(TimePoint start, TimePoint end) const;
+
+  const ValueType& sum() const {
+    return totalSum_;
+  }
+
+  uint64_t count() const {
+    return totalCount_;
+  }
+
+  template <typename ReturnType = double>
+  ReturnType avg() const {
+    return detail::avgHelper<ReturnType>(totalSum_, totalCount_);
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType rate() const {
+    return rateHelper<ReturnType, Interval>(ReturnType(totalSum_), elapsed());
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType countRate() const {
+    return rateHelper<ReturnType, Interval>(
+        ReturnType(totalCount_), elapsed());
+  }
+
+  ValueType sum(TimePoint start, TimePoint end) const;
+
+  uint64_t count(TimePoint start, TimePoint end) const;
+
+  template <typename ReturnType = double>
+  ReturnType avg(TimePoint start, TimePoint end) const;
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType rate(TimePoint start, TimePoint end) const {
+    ValueType intervalSum = sum(start, end);
+    Duration interval = elapsed(start, end);
+    return rateHelper<ReturnType, Interval>(intervalSum, interval);
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType countRate(TimePoint start, TimePoint end) const {
+    uint64_t intervalCount = count(start, end);
+    Duration interval = elapsed(start, end);
+    return rateHelper<ReturnType, Interval>(
+        ReturnType(intervalCount), interval);
+  }
+
+  /*
+   * Batch queries: out[i] is the result for ranges[i].  out must have room
+   * for ranges.size() results.
+   */
+  void sum(Range<const TimeRange*> ranges, ValueType* out) const;
+
+  void count(Range<const TimeRange*> ranges, uint64_t* out) const;
+
+  template <typename ReturnType = double>
+  void avg(Range<const TimeRange*> ranges, ReturnType* out) const;
+
+  size_t getBucketIdx(TimePoint time) const;
+
+  void getBucketInfo(
+      TimePoint time,
+      size_t* bucketIdx,
+      TimePoint* bucketStart,
+      TimePoint* nextBucketStart) const;
+
+ private:
+  // The buckets overlapping a range, by position from the oldest bucket
+  struct Span {
+    size_t first;
+    size_t last;
+    size_t firstIdx;
+    size_t lastIdx;
+    TimePoint firstStart;
+    TimePoint firstNext;
+    TimePoint lastStart;
+    TimePoint lastNext;
+  };
+
+  // Running totals from the oldest bucket: sums[p] and counts[p] are the
+  // totals of the buckets before position p
+  struct Prefix {
+    std::vector<ValueType> sums;
+    std::vector<uint64_t> counts;
+  };
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType rateHelper(ReturnType numerator, Duration elapsedTime) const {
+    return detail::rateHelper<ReturnType, Duration, Interval>(
+        numerator, elapsedTime);
+  }
+
+  TimePoint getEarliestTimeNonEmpty() const;
+  size_t updateBuckets(TimePoint now);
+
+  size_t oldestIdx() const;
+
+  // Returns false if no bucket overlaps [start, end)
+  bool locate(TimePoint start, TimePoint end, Span* span) const;
+
+  // Sums the columns over positions [first, last)
+  template <typename T>
+  T sumPositions(const std::vector<T>& column, size_t first, size_t last)
+      const;
+
+  void computePrefix(Prefix* prefix) const;
+
+  /*
+   * The sum and count of a range.  The first and last buckets of the range
+   * are range adjusted, and inner(first, last) returns the sum and count of
+   * the buckets at the positions in between.
+   */
+  template <typename Inner>
+  std::pair<ValueType, uint64_t>
+  query(TimePoint start, TimePoint end, Inner&& inner) const;
+
+  ValueType rangeAdjust(
+      TimePoint bucketStart,
+      TimePoint nextBucketStart,
+      TimePoint start,
+      TimePoint end,
+      ValueType input) const;
+
+  TimePoint firstTime_; // time of first update() since clear()/constructor
+  TimePoint latestTime_; // time of last update()
+  Duration duration_; // total duration ("window length") of the time series
+
+  ValueType totalSum_;
+  uint64_t totalCount_;
+  std::vector<ValueType> sums_;
+  std::vector<uint64_t> counts_;
+};
+
+} // namespace folly
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/Likely.h>
+#include <folly/stats/ConcurrentTimeseriesHistogram.h>
+#include <folly/stats/TimeseriesHistogram-defs.h>
+
+namespace folly {
+
+template <typename T, typename CT, typename C>
+ConcurrentTimeseriesHistogram<T, CT, C>::ConcurrentTimeseriesHistogram(
+    ValueType bucketSize,
+    ValueType min,
+    ValueType max,
+    const ContainerType& defaultContainer)
+    : hist_(bucketSize, min, max, defaultContainer) {}
+
+template <typename T, typename CT, typename C>
+ConcurrentTimeseriesHistogram<T, CT, C>::LocalBuffer::LocalBuffer(
+    ConcurrentTimeseriesHistogram& parent_,
+    size_t numBuckets)
+    : parent(parent_),
+      slots(new Slot[numBuckets]),
+      merged(new Merged[numBuckets]),
+      latest(TimePoint::min().time_since_epoch().count()) {}
+
+template <typename T, typename CT, typename C>
+ConcurrentTimeseriesHistogram<T, CT, C>::LocalBuffer::~LocalBuffer() {
+  // The thread is exiting, or the histogram is being destroyed
+  std::lock_guard<std::mutex> g(parent.mutex_);
+  parent.merge(*this);
+}
+
+template <typename T, typename CT, typename C>
+typename ConcurrentTimeseriesHistogram<T, CT, C>::LocalBuffer*
+ConcurrentTimeseriesHistogram<T, CT, C>::makeLocalBuffer() {
+  auto buffer = new LocalBuffer(*this, hist_.getNumBuckets());
+  buffers_.reset(buffer);
+  return buffer;
+}
+
+template <typename T, typename CT, typename C>
+void ConcurrentTimeseriesHistogram<T, CT, C>::addValue(
+    TimePoint now,
+    const ValueType& value,
+    uint64_t times) {
+  auto buffer = buffers_.get();
+  if (UNLIKELY(buffer == nullptr)) {
+    buffer = makeLocalBuffer();
+  }
+
+  auto rep = now.time_since_epoch().count();
+  if (rep > buffer->latest.load(std::memory_order_relaxed)) {
+    buffer->latest.store(rep, std::memory_order_relaxed);
+  }
+
+  // Only this thread writes to the slot, so there is no need for atomic
+  // read-modify-writes.  The sum is stored first so that a query that sees
+  // the count also sees the sum.
+  auto& slot = buffer->slots[hist_.buckets_.getBucketIdx(value)];
+  slot.sum.store(
+      slot.sum.load(std::memory_order_relaxed) + value * ValueType(times),
+      std::memory_order_relaxed);
+  slot.count.store(
+      slot.count.load(std::memory_order_relaxed) + times,
+      std::memory_order_release);
+
+  auto uniqueness = buffer->uniqueness.load(std::memory_order_relaxed);
+  if (uniqueness == Uniqueness::NoValue) {
+    buffer->firstValue.store(value, std::memory_order_relaxed);
+    buffer->uniqueness.store(
+        Uniqueness::SingleValue, std::memory_order_release);
+  } else if (
+      uniqueness == Uniqueness::SingleValue &&
+      value != buffer->firstValue.load(std::memory_order_relaxed)) {
+    buffer->uniqueness.store(Uniqueness::ManyValues, std::memory_order_relaxed);
+  }
+}
+
+template <typename T, typename CT, typename C>
+void ConcurrentTimeseriesHistogram<T, CT, C>::merge(LocalBuffer& buffer) const {
+  auto now = TimePoint(Duration(buffer.latest.load(std::memory_order_relaxed)));
+  for (size_t b = 0; b < hist_.getNumBuckets(); ++b) {
+    auto& slot = buffer.slots[b];
+    auto& merged = buffer.merged[b];
+    auto count = slot.count.load(std::memory_order_acquire);
+    if (count == merged.count) {
+      continue;
+    }
+    auto sum = slot.sum.load(std::memory_order_relaxed);
+    hist_.buckets_.getByIndex(b).addValueAggregated(
+        now, sum - merged.sum, count - merged.count);
+    merged.count = count;
+    merged.sum = sum;
+  }
+
+  // Same as calling maybeHandleSingleUniqueValue() for every value
+  switch (buffer.uniqueness.load(std::memory_order_acquire)) {
+    case Uniqueness::NoValue:
+      break;
+    case Uniqueness::SingleValue:
+      hist_.maybeHandleSingleUniqueValue(
+          buffer.firstValue.load(std::memory_order_relaxed));
+      break;
+    case Uniqueness::ManyValues:
+      hist_.haveNotSeenValue_ = false;
+      hist_.singleUniqueValue_ = false;
+      break;
+  }
+}
+
+template <typename T, typename CT, typename C>
+void ConcurrentTimeseriesHistogram<T, CT, C>::mergeAll() const {
+  for (auto& buffer : buffers_.accessAllThreads()) {
+    merge(buffer);
+  }
+}
+
+template <typename T, typename CT, typename C>
+void ConcurrentTimeseriesHistogram<T, CT, C>::update(TimePoint now) {
+  std::lock_guard<std::mutex> g(mutex_);
+  mergeAll();
+  hist_.update(now);
+}
+
+template <typename T, typename CT, typename C>
+void ConcurrentTimeseriesHistogram<T, CT, C>::clear() {
+  std::lock_guard<std::mutex> g(mutex_);
+  // Merging first means that only values added from now on get merged
+  mergeAll();
+  hist_.clear();
+}
+
+} // namespace folly
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <folly/ThreadLocal.h>
+#include <folly/stats/TimeseriesHistogram.h>
+
+namespace folly {
+
+/*
+ * ConcurrentTimeseriesHistogram is a TimeseriesHistogram that any number of
+ * threads can add values to concurrently, without locking.
+ *
+ * Each thread adds into its own per-bucket counters; adding is wait-free
+ * (except for the first value a thread adds, which allocates its counters)
+ * and doesn't write to any memory shared with other threads.  The counters
+ * are merged into an internal TimeseriesHistogram when that is queried,
+ * under a mutex that only queries take.
+ *
+ * The buckets, levels and query semantics are those of TimeseriesHistogram,
+ * with two differences:
+ *
+ * - The values a thread added since the last query are merged with the
+ *   timestamp of the latest of them, rather than their own.  Queries made
+ *   often enough (e.g. once per second for minute levels) hide this.
+ * - A query concurrent with addValue() may miss the count of a value it
+ *   includes in the sum, or vice versa; the next query is exact.
+ *
+ * The values added by threads that exit are merged right away, so nothing
+ * is lost.  As with TimeseriesHistogram, call update(now) before querying.
+ */
+template <
+    class T,
+    class CT = LegacyStatsClock<std::chrono::seconds>,
+    class C = folly::MultiLevelTimeSeries<T, CT>>
+class ConcurrentTimeseriesHistogram {
+ public:
+  using ValueType = T;
+  using ContainerType = C;
+  using Clock = CT;
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+  using HistogramType = TimeseriesHistogram<T, CT, C>;
+
+  /*
+   * Same as the TimeseriesHistogram constructor: [min, max) is divided into
+   * buckets of bucketSize, plus the "under" and "over" buckets.
+   */
+  ConcurrentTimeseriesHistogram(
+      ValueType bucketSize,
+      ValueType min,
+      ValueType max,
+      const ContainerType& defaultContainer);
+
+  ConcurrentTimeseriesHistogram(const ConcurrentTimeseriesHistogram&) = delete;
+  ConcurrentTimeseriesHistogram& operator=(
+      const ConcurrentTimeseriesHistogram&) = delete;
+
+  ValueType getBucketSize() const {
+    return hist_.getBucketSize();
+  }
+
+  ValueType getMin() const {
+    return hist_.getMin();
+  }
+
+  ValueType getMax() const {
+    return hist_.getMax();
+  }
+
+  size_t getNumLevels() const {
+    return hist_.getNumLevels();
+  }
+
+  size_t getNumBuckets() const {
+    return hist_.getNumBuckets();
+  }
+
+  ValueType getBucketMin(size_t bucketIdx) const {
+    return hist_.getBucketMin(bucketIdx);
+  }
+
+  /* Add a value into the histogram with timestamp 'now'.  Wait-free. */
+  void addValue(TimePoint now, const ValueType& value) {
+    addValue(now, value, 1);
+  }
+
+  /* Add a value the given number of times with timestamp 'now'.  Wait-free. */
+  void addValue(TimePoint now, const ValueType& value, uint64_t times);
+
+  /*
+   * The methods below merge the values added by all of the threads, and
+   * then behave like their TimeseriesHistogram counterparts.
+   */
+
+  void update(TimePoint now);
+
+  void clear();
+
+  uint64_t count(size_t level) const {
+    return read([&](const HistogramType& h) { return h.count(level); });
+  }
+
+  uint64_t count(TimePoint start, TimePoint end) const {
+    return read([&](const HistogramType& h) { return h.count(start, end); });
+  }
+
+  ValueType sum(size_t level) const {
+    return read([&](const HistogramType& h) { return h.sum(level); });
+  }
+
+  ValueType sum(TimePoint start, TimePoint end) const {
+    return read([&](const HistogramType& h) { return h.sum(start, end); });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType avg(size_t level) const {
+    return read([&](const HistogramType& h) {
+      return h.template avg<ReturnType>(level);
+    });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType avg(TimePoint start, TimePoint end) const {
+    return read([&](const HistogramType& h) {
+      return h.template avg<ReturnType>(start, end);
+    });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType rate(size_t level) const {
+    return read([&](const HistogramType& h) {
+      return h.template rate<ReturnType>(level);
+    });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType rate(TimePoint start, TimePoint end) const {
+    return read([&](const HistogramType& h) {
+      return h.template rate<ReturnType>(start, end);
+    });
+  }
+
+  ValueType getPercentileEstimate(double pct, size_t level) const {
+    return read([&](const HistogramType& h) {
+      return h.getPercentileEstimate(pct, level);
+    });
+  }
+
+  ValueType getPercentileEstimate(double pct, TimePoint start, TimePoint end)
+      const {
+    return read([&](const HistogramType& h) {
+      return h.getPercentileEstimate(pct, start, end);
+    });
+  }
+
+  size_t getPercentileBucketIdx(double pct, size_t level) const {
+    return read([&](const HistogramType& h) {
+      return h.getPercentileBucketIdx(pct, level);
+    });
+  }
+
+  size_t getPercentileBucketIdx(double pct, TimePoint start, TimePoint end)
+      const {
+    return read([&](const HistogramType& h) {
+      return h.getPercentileBucketIdx(pct, start, end);
+    });
+  }
+
+  ValueType getPercentileBucketMin(double pct, size_t level) const {
+    return getBucketMin(getPercentileBucketIdx(pct, level));
+  }
+
+  ValueType getPercentileBucketMin(double pct, TimePoint start, TimePoint end)
+      const {
+    return getBucketMin(getPercentileBucketIdx(pct, start, end));
+  }
+
+  std::string getString(size_t level) const {
+    return read([&](const HistogramType& h) { return h.getString(level); });
+  }
+
+  std::string getString(TimePoint start, TimePoint end) const {
+    return read(
+        [&](const HistogramType& h) { return h.getString(start, end); });
+  }
+
+  /* A copy of the merged histogram, for queries not provided above. */
+  HistogramType snapshot() const {
+    return read([](const HistogramType& h) { return h; });
+  }
+
+ private:
+  struct LocalBuffer;
+  struct LocalBufferTag {};
+
+  // Written by the owning thread only
+  struct Slot {
+    std::atomic<uint64_t> count{0};
+    std::atomic<ValueType> sum{ValueType()};
+  };
+
+  // What was merged from a Slot so far, known to queries only
+  struct Merged {
+    uint64_t count{0};
+    ValueType sum{ValueType()};
+  };
+
+  enum class Uniqueness : uint8_t {
+    NoValue,
+    SingleValue,
+    ManyValues,
+  };
+
+  struct LocalBuffer {
+    LocalBuffer(ConcurrentTimeseriesHistogram& parent, size_t numBuckets);
+    ~LocalBuffer();
+
+    ConcurrentTimeseriesHistogram& parent;
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<Merged[]> merged;
+    std::atomic<typename Duration::rep> latest;
+    std::atomic<Uniqueness> uniqueness{Uniqueness::NoValue};
+    std::atomic<ValueType> firstValue{ValueType()};
+  };
+
+  LocalBuffer* makeLocalBuffer();
+
+  // The caller must hold mutex_
+  void mergeAll() const;
+  void merge(LocalBuffer& buffer) const;
+
+  template <class F>
+  auto read(F&& f) const -> decltype(f(std::declval<const HistogramType&>())) {
+    std::lock_guard<std::mutex> g(mutex_);
+    mergeAll();
+    return f(const_cast<const HistogramType&>(hist_));
+  }
+
+  mutable std::mutex mutex_;
+  mutable HistogramType hist_;
+  // Last, so that exiting LocalBuffers still have the histogram to merge to
+  ThreadLocalPtr<LocalBuffer, LocalBufferTag> buffers_;
+};
+
+} // namespace folly
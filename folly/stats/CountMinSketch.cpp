@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/CountMinSketch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace folly {
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width_(width), depth_(depth), counters_(width * depth, 0) {
+  CHECK_GT(width, 0u);
+  CHECK_GT(depth, 0u);
+}
+
+CountMinSketch CountMinSketch::withError(double epsilon, double delta) {
+  CHECK_GT(epsilon, 0.0);
+  CHECK_GT(delta, 0.0);
+  CHECK_LT(delta, 1.0);
+  return CountMinSketch(
+      size_t(std::ceil(std::exp(1.0) / epsilon)),
+      size_t(std::ceil(std::log(1 / delta))));
+}
+
+void CountMinSketch::addHash(uint64_t hash, uint64_t count) {
+  for (size_t row = 0; row < depth_; ++row) {
+    counters_[index(hash, row)] += count;
+  }
+  totalCount_ += count;
+}
+
+uint64_t CountMinSketch::estimateHash(uint64_t hash) const {
+  uint64_t estimate = std::numeric_limits<uint64_t>::max();
+  for (size_t row = 0; row < depth_; ++row) {
+    estimate = std::min(estimate, counters_[index(hash, row)]);
+  }
+  return estimate;
+}
+
+void CountMinSketch::merge(const CountMinSketch& other) {
+  CHECK_EQ(width_, other.width_);
+  CHECK_EQ(depth_, other.depth_);
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    counters_[i] += other.counters_[i];
+  }
+  totalCount_ += other.totalCount_;
+}
+
+void CountMinSketch::clear() {
+  std::fill(counters_.begin(), counters_.end(), 0);
+  totalCount_ = 0;
+}
+
+} // namespace folly
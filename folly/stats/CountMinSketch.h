@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <folly/hash/Hash.h>
+#include <folly/stats/detail/SketchHash.h>
+
+namespace folly {
+
+/*
+ * CountMinSketch estimates how many times each key was added, in a fixed
+ * width x depth table of counters.  Estimates never undercount; with a
+ * sketch made by withError(epsilon, delta), they overcount by more than
+ * epsilon times the total count with probability at most delta.
+ *
+ * Sketches of the same dimensions merge into a sketch of the sum of their
+ * counts.  To find the keys with the largest counts, see SpaceSaving.
+ *
+ * Keys are hashed with folly::hasher by default.  This class is not
+ * thread-safe.
+ */
+class CountMinSketch {
+ public:
+  CountMinSketch(size_t width, size_t depth);
+
+  /* A sketch sized for the given error bounds, see above. */
+  static CountMinSketch withError(double epsilon, double delta);
+
+  template <class T, class Hasher = folly::hasher<T>>
+  void add(const T& key, uint64_t count = 1) {
+    addHash(detail::sketchHash<Hasher>(key), count);
+  }
+
+  template <class T, class Hasher = folly::hasher<T>>
+  uint64_t estimate(const T& key) const {
+    return estimateHash(detail::sketchHash<Hasher>(key));
+  }
+
+  /* Same as add() and estimate(), by a well mixed 64-bit hash of a key. */
+  void addHash(uint64_t hash, uint64_t count = 1);
+  uint64_t estimateHash(uint64_t hash) const;
+
+  /* Adds the counts of other into this sketch, of the same dimensions. */
+  void merge(const CountMinSketch& other);
+
+  void clear();
+
+  size_t width() const {
+    return width_;
+  }
+
+  size_t depth() const {
+    return depth_;
+  }
+
+  /* The sum of all of the counts added. */
+  uint64_t totalCount() const {
+    return totalCount_;
+  }
+
+ private:
+  // The counter of the key in a row, by double hashing
+  size_t index(uint64_t hash, size_t row) const {
+    uint32_t h1 = uint32_t(hash);
+    uint32_t h2 = uint32_t(hash >> 32) | 1;
+    return row * width_ + (h1 + uint64_t(row) * h2) % width_;
+  }
+
+  size_t width_;
+  size_t depth_;
+  uint64_t totalCount_{0};
+  std::vector<uint64_t> counters_;
+};
+
+} // namespace folly
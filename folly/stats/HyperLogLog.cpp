@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/HyperLogLog.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/Portability.h>
+
+#if FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace folly {
+
+constexpr uint8_t HyperLogLog::kMinPrecision;
+constexpr uint8_t HyperLogLog::kMaxPrecision;
+
+namespace {
+
+uint32_t sparseIndex(uint32_t entry) {
+  return entry >> 8;
+}
+
+uint8_t sparseValue(uint32_t entry) {
+  return uint8_t(entry);
+}
+
+// dst[i] = max(dst[i], src[i])
+void maxRegisters(uint8_t* dst, const uint8_t* src, size_t size) {
+  size_t i = 0;
+#if FOLLY_SSE_PREREQ(2, 0)
+  for (; i + 16 <= size; i += 16) {
+    auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_max_epu8(a, b));
+  }
+#elif FOLLY_AARCH64 && defined(__ARM_NEON)
+  for (; i + 16 <= size; i += 16) {
+    vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+  }
+#endif
+  for (; i < size; ++i) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
+
+} // namespace
+
+HyperLogLog::HyperLogLog(uint8_t precision) : precision_(precision) {
+  CHECK_GE(precision, kMinPrecision);
+  CHECK_LE(precision, kMaxPrecision);
+}
+
+void HyperLogLog::addHash(uint64_t hash) {
+  // The register is the top bits of the hash, and its value the position
+  // of the first set bit of the rest, counting from 1
+  uint32_t index = uint32_t(hash >> (64 - precision_));
+  uint64_t rest = (hash << precision_) | (uint64_t(1) << (precision_ - 1));
+  uint8_t value = uint8_t(64 - findLastSet(rest) + 1);
+
+  if (!isSparse()) {
+    registers_[index] = std::max(registers_[index], value);
+    return;
+  }
+
+  uint32_t entry = (index << 8) | value;
+  auto it = std::lower_bound(sparse_.begin(), sparse_.end(), index << 8);
+  if (it != sparse_.end() && sparseIndex(*it) == index) {
+    *it = std::max(*it, entry);
+    return;
+  }
+  sparse_.insert(it, entry);
+  if (sparse_.size() > numRegisters() / 8) {
+    toDense();
+  }
+}
+
+uint64_t HyperLogLog::estimate() const {
+  const size_t m = numRegisters();
+  double sum = 0;
+  size_t zeros = 0;
+  if (isSparse()) {
+    zeros = m - sparse_.size();
+    sum = zeros;
+    for (auto entry : sparse_) {
+      sum += 1.0 / double(uint64_t(1) << sparseValue(entry));
+    }
+  } else {
+    for (auto value : registers_) {
+      zeros += value == 0;
+      sum += 1.0 / double(uint64_t(1) << value);
+    }
+  }
+
+  double alpha;
+  switch (m) {
+    case 16:
+      alpha = 0.673;
+      break;
+    case 32:
+      alpha = 0.697;
+      break;
+    case 64:
+      alpha = 0.709;
+      break;
+    default:
+      alpha = 0.7213 / (1 + 1.079 / m);
+      break;
+  }
+  double estimate = alpha * m * m / sum;
+
+  // Linear counting is more precise for small cardinalities.  With 64-bit
+  // hashes, there is no large range correction.
+  if (estimate <= 2.5 * m && zeros > 0) {
+    estimate = m * std::log(double(m) / zeros);
+  }
+  return uint64_t(std::llround(estimate));
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+  CHECK_EQ(precision_, other.precision_);
+
+  if (!other.isSparse()) {
+    toDense();
+    maxRegisters(registers_.data(), other.registers_.data(), numRegisters());
+    return;
+  }
+
+  if (!isSparse()) {
+    for (auto entry : other.sparse_) {
+      auto& reg = registers_[sparseIndex(entry)];
+      reg = std::max(reg, sparseValue(entry));
+    }
+    return;
+  }
+
+  std::vector<uint32_t> merged;
+  merged.reserve(sparse_.size() + other.sparse_.size());
+  auto a = sparse_.begin();
+  auto b = other.sparse_.begin();
+  while (a != sparse_.end() && b != other.sparse_.end()) {
+    if (sparseIndex(*a) == sparseIndex(*b)) {
+      merged.push_back(std::max(*a++, *b++));
+    } else if (*a < *b) {
+      merged.push_back(*a++);
+    } else {
+      merged.push_back(*b++);
+    }
+  }
+  merged.insert(merged.end(), a, sparse_.end());
+  merged.insert(merged.end(), b, other.sparse_.end());
+  sparse_.swap(merged);
+  if (sparse_.size() > numRegisters() / 8) {
+    toDense();
+  }
+}
+
+void HyperLogLog::clear() {
+  registers_.clear();
+  registers_.shrink_to_fit();
+  sparse_.clear();
+}
+
+void HyperLogLog::toDense() {
+  if (!isSparse()) {
+    return;
+  }
+  registers_.assign(numRegisters(), 0);
+  for (auto entry : sparse_) {
+    registers_[sparseIndex(entry)] = sparseValue(entry);
+  }
+  sparse_.clear();
+  sparse_.shrink_to_fit();
+}
+
+} // namespace folly
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <folly/hash/Hash.h>
+#include <folly/stats/detail/SketchHash.h>
+
+namespace folly {
+
+/*
+ * HyperLogLog estimates the number of distinct keys added to it, within a
+ * standard error of about 1.04 / sqrt(2^precision) (0.8% for the default
+ * precision of 14), using at most 2^precision bytes: 16KB rather than the
+ * size of a set of all of the keys.
+ *
+ * Until a few registers are used, they are stored sparsely, as a sorted
+ * vector of (register, value) pairs, so a sketch of few keys is small.
+ * Past 2^precision / 8 registers, they are stored densely, one byte each.
+ *
+ * Sketches of the same precision merge into a sketch of the union of their
+ * keys; merging two dense sketches is a SIMD max of their registers.
+ *
+ *   HyperLogLog callers;
+ *   for (const auto& request : requests) {
+ *     callers.add(request.callerId);
+ *   }
+ *   uint64_t distinctCallers = callers.estimate();
+ *
+ * Keys are hashed with folly::hasher by default.  This class is not
+ * thread-safe.
+ */
+class HyperLogLog {
+ public:
+  static constexpr uint8_t kMinPrecision = 4;
+  static constexpr uint8_t kMaxPrecision = 18;
+
+  explicit HyperLogLog(uint8_t precision = 14);
+
+  template <class T, class Hasher = folly::hasher<T>>
+  void add(const T& key) {
+    addHash(detail::sketchHash<Hasher>(key));
+  }
+
+  /* Adds a key by its 64-bit hash, which must be well mixed. */
+  void addHash(uint64_t hash);
+
+  /* Estimates the number of distinct keys added. */
+  uint64_t estimate() const;
+
+  /*
+   * Adds the keys of other into this sketch.  The precisions must be the
+   * same.
+   */
+  void merge(const HyperLogLog& other);
+
+  /* Forgets all keys, going back to the sparse representation. */
+  void clear();
+
+  uint8_t precision() const {
+    return precision_;
+  }
+
+  bool isSparse() const {
+    return registers_.empty();
+  }
+
+  /* The bytes allocated for the registers. */
+  size_t memoryUsage() const {
+    return isSparse() ? sparse_.capacity() * sizeof(uint32_t)
+                      : registers_.size();
+  }
+
+ private:
+  size_t numRegisters() const {
+    return size_t(1) << precision_;
+  }
+
+  void toDense();
+
+  uint8_t precision_;
+  // Sorted by register index: index << 8 | value
+  std::vector<uint32_t> sparse_;
+  // Empty while sparse
+  std::vector<uint8_t> registers_;
+};
+
+} // namespace folly
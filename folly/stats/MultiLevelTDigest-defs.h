@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/stats/MultiLevelTDigest.h>
+#include <glog/logging.h>
+
+namespace folly {
+
+template <typename CT>
+MultiLevelTDigest<CT>::Level::Level(
+    Duration levelDuration,
+    size_t numBuckets,
+    size_t digestSize)
+    : duration(levelDuration),
+      latestId(std::numeric_limits<int64_t>::min()) {
+  if (duration == Duration(0)) {
+    numBuckets = 1;
+    bucketWidth = Duration(0);
+  } else {
+    // Same as BucketedTimeSeries: no more buckets than duration units
+    if (uint64_t(duration.count()) < numBuckets) {
+      numBuckets = size_t(duration.count());
+    }
+    bucketWidth = duration / numBuckets;
+  }
+  buckets.assign(numBuckets, TDigest(digestSize));
+  bucketIds.assign(numBuckets, std::numeric_limits<int64_t>::min());
+}
+
+template <typename CT>
+int64_t MultiLevelTDigest<CT>::Level::bucketId(TimePoint time) const {
+  if (bucketWidth == Duration(0)) {
+    return 0;
+  }
+  auto sinceEpoch = time.time_since_epoch();
+  int64_t id = sinceEpoch / bucketWidth;
+  // Round towards negative infinity, for times before the epoch
+  if (sinceEpoch < Duration(0) && sinceEpoch % bucketWidth != Duration(0)) {
+    --id;
+  }
+  return id;
+}
+
+template <typename CT>
+MultiLevelTDigest<CT>::MultiLevelTDigest(
+    size_t nBuckets,
+    size_t nLevels,
+    const Duration levelDurations[],
+    size_t digestSize,
+    size_t bufferSize)
+    : numBuckets_(nBuckets),
+      digestSize_(digestSize),
+      bufferSize_(bufferSize),
+      cachedTime_() {
+  CHECK_GT(nBuckets, 0u);
+  CHECK_GT(nLevels, 0u);
+  CHECK(levelDurations);
+
+  levels_.reserve(nLevels);
+  for (size_t i = 0; i < nLevels; ++i) {
+    if (levelDurations[i] == Duration(0)) {
+      CHECK_EQ(i, nLevels - 1);
+    } else if (i > 0) {
+      CHECK(levelDurations[i - 1] < levelDurations[i]);
+    }
+    levels_.emplace_back(levelDurations[i], nBuckets, digestSize);
+  }
+  cachedValues_.reserve(bufferSize_);
+}
+
+template <typename CT>
+MultiLevelTDigest<CT>::MultiLevelTDigest(
+    size_t nBuckets,
+    std::initializer_list<Duration> durations,
+    size_t digestSize,
+    size_t bufferSize)
+    : MultiLevelTDigest(
+          nBuckets,
+          durations.size(),
+          durations.begin(),
+          digestSize,
+          bufferSize) {}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::addValue(TimePoint now, double value) {
+  if (cachedTime_ != now || cachedValues_.size() >= bufferSize_) {
+    flush();
+    cachedTime_ = now;
+  }
+  cachedValues_.push_back(value);
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::addDigest(TimePoint now, const TDigest& digest) {
+  flush();
+  if (!digest.empty()) {
+    addToLevels(now, digest);
+  }
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::update(TimePoint now) {
+  flush();
+  for (auto& level : levels_) {
+    advance(level, now);
+  }
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::flush() {
+  if (cachedValues_.empty()) {
+    return;
+  }
+  std::sort(cachedValues_.begin(), cachedValues_.end());
+  auto batch = TDigest(digestSize_).mergeSorted(range(cachedValues_));
+  cachedValues_.clear();
+  addToLevels(cachedTime_, batch);
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::clear() {
+  cachedValues_.clear();
+  cachedTime_ = TimePoint();
+  for (auto& level : levels_) {
+    std::fill(
+        level.buckets.begin(), level.buckets.end(), TDigest(digestSize_));
+    std::fill(
+        level.bucketIds.begin(),
+        level.bucketIds.end(),
+        std::numeric_limits<int64_t>::min());
+    level.latestId = std::numeric_limits<int64_t>::min();
+  }
+}
+
+template <typename CT>
+TDigest MultiLevelTDigest<CT>::getDigest(size_t level) const {
+  CHECK_LT(level, levels_.size());
+  const auto& l = levels_[level];
+  if (l.latestId == std::numeric_limits<int64_t>::min()) {
+    return TDigest(digestSize_);
+  }
+  int64_t numBuckets = int64_t(l.buckets.size());
+
+  std::vector<TDigest> digests;
+  digests.reserve(l.buckets.size());
+  for (size_t i = 0; i < l.buckets.size(); ++i) {
+    if (l.bucketIds[i] > l.latestId - numBuckets &&
+        l.bucketIds[i] <= l.latestId) {
+      digests.push_back(l.buckets[i]);
+    }
+  }
+  if (digests.empty()) {
+    return TDigest(digestSize_);
+  }
+  return TDigest::merge(range(digests));
+}
+
+template <typename CT>
+size_t MultiLevelTDigest<CT>::getLevelIndex(Duration duration) const {
+  for (size_t i = 0; i < levels_.size(); ++i) {
+    if (levels_[i].duration == duration) {
+      return i;
+    }
+  }
+  LOG(FATAL) << "No level of duration " << duration.count();
+  return 0;
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::advance(Level& level, TimePoint now) {
+  level.latestId = std::max(level.latestId, level.bucketId(now));
+}
+
+template <typename CT>
+void MultiLevelTDigest<CT>::addToLevels(
+    TimePoint now,
+    const TDigest& digest) {
+  for (auto& level : levels_) {
+    advance(level, now);
+    int64_t id = level.bucketId(now);
+    int64_t numBuckets = int64_t(level.buckets.size());
+    if (id <= level.latestId - numBuckets) {
+      continue; // Too old for this level
+    }
+
+    // Ids count up from the epoch, so reuse slots round robin
+    size_t slot = size_t(((id % numBuckets) + numBuckets) % numBuckets);
+    auto& bucket = level.buckets[slot];
+    if (level.bucketIds[slot] != id) {
+      bucket = TDigest(digestSize_);
+      level.bucketIds[slot] = id;
+    }
+    const TDigest digests[] = {std::move(bucket), digest};
+    bucket = TDigest::merge(range(digests));
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/stats/BucketedTimeSeries.h>
+#include <folly/stats/TDigest.h>
+
+namespace folly {
+
+/*
+ * MultiLevelTDigest keeps TDigests of the values added over several sliding
+ * windows of time, the way MultiLevelTimeSeries keeps their sums and counts:
+ * e.g. digests of the last minute, the last hour and all time, to estimate
+ * the quantiles of each.
+ *
+ * Each level divides its duration into numBuckets buckets, each with its own
+ * digest; as time advances, a bucket at a time is discarded and reused.  A
+ * level's digest is the merge of the digests of its buckets.  A level with
+ * a duration of 0 tracks all time, and must be the last one.  As in
+ * BucketedTimeSeries, a level's duration is rounded down to a multiple of
+ * the number of buckets.
+ *
+ * Values added with the same timestamp are buffered, and merged into the
+ * levels when the time changes, the buffer is full, or by update() and
+ * flush().  As with MultiLevelTimeSeries, call update(now) before querying.
+ *
+ * Digests built elsewhere (other threads, other hosts) can be added too,
+ * which is how an aggregation tier keeps windowed digests of a fleet.
+ *
+ * This class is not thread-safe -- use your own synchronization!
+ */
+template <typename CT = LegacyStatsClock<std::chrono::seconds>>
+class MultiLevelTDigest {
+ public:
+  using Clock = CT;
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+
+  /*
+   * Create a new MultiLevelTDigest with the given level durations, in
+   * increasing order, each divided into numBuckets buckets.  The digests
+   * have at most digestSize centroids, and up to bufferSize values added
+   * at the same time are buffered before being merged into the digests.
+   */
+  MultiLevelTDigest(
+      size_t numBuckets,
+      size_t numLevels,
+      const Duration levelDurations[],
+      size_t digestSize = 100,
+      size_t bufferSize = 1000);
+
+  MultiLevelTDigest(
+      size_t numBuckets,
+      std::initializer_list<Duration> durations,
+      size_t digestSize = 100,
+      size_t bufferSize = 1000);
+
+  size_t numBuckets() const {
+    return numBuckets_;
+  }
+
+  size_t numLevels() const {
+    return levels_.size();
+  }
+
+  Duration getLevelDuration(size_t level) const {
+    CHECK_LT(level, levels_.size());
+    return levels_[level].duration;
+  }
+
+  /*
+   * Adds a value with timestamp 'now'.  Values older than the duration of
+   * a level are ignored by that level.
+   */
+  void addValue(TimePoint now, double value);
+
+  /* Adds all of the values of a digest, with timestamp 'now'. */
+  void addDigest(TimePoint now, const TDigest& digest);
+
+  /*
+   * Merges the buffered values, and moves the windows of all levels
+   * forward to 'now', discarding the values that fell out of them.
+   */
+  void update(TimePoint now);
+
+  /* Merges the buffered values into the levels. */
+  void flush();
+
+  /* Forgets all values. */
+  void clear();
+
+  /*
+   * Returns the digest of the values within the window of a level.  Call
+   * update(now) first.
+   */
+  TDigest getDigest(size_t level) const;
+
+  /* Returns the digest of the level of the given duration. */
+  TDigest getDigest(Duration duration) const {
+    return getDigest(getLevelIndex(duration));
+  }
+
+  double estimateQuantile(double q, size_t level) const {
+    return getDigest(level).estimateQuantile(q);
+  }
+
+  double estimateQuantile(double q, Duration duration) const {
+    return getDigest(duration).estimateQuantile(q);
+  }
+
+  /*
+   * Legacy APIs that accept a Duration parameters rather than TimePoint.
+   *
+   * These treat the Duration as relative to the clock epoch.
+   * Prefer using the correct TimePoint-based APIs instead.  These APIs will
+   * eventually be deprecated and removed.
+   */
+  void addValue(Duration now, double value) {
+    addValue(TimePoint(now), value);
+  }
+  void update(Duration now) {
+    update(TimePoint(now));
+  }
+
+ private:
+  struct Level {
+    Level(Duration duration, size_t numBuckets, size_t digestSize);
+
+    // The id of the bucket of the given time: which bucketWidth it is in
+    int64_t bucketId(TimePoint time) const;
+
+    Duration duration;
+    Duration bucketWidth;
+    // The all-time level has 1 bucket, which never expires
+    std::vector<TDigest> buckets;
+    std::vector<int64_t> bucketIds;
+    int64_t latestId;
+  };
+
+  size_t getLevelIndex(Duration duration) const;
+
+  // Moves the window of a level forward to the bucket of 'now'
+  void advance(Level& level, TimePoint now);
+
+  void addToLevels(TimePoint now, const TDigest& digest);
+
+  size_t numBuckets_;
+  size_t digestSize_;
+  size_t bufferSize_;
+  std::vector<Level> levels_;
+
+  // Values added for cachedTime_, not merged into the levels yet
+  TimePoint cachedTime_;
+  std::vector<double> cachedValues_;
+};
+
+} // namespace folly
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/SharedStatsExport.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/ScopeGuard.h>
+#include <folly/portability/Asm.h>
+#include <folly/portability/Stdlib.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+
+namespace folly {
+
+using detail::SharedStatsEntry;
+using detail::SharedStatsHeader;
+
+namespace {
+
+constexpr size_t kBlockAlignment = 64;
+
+size_t alignUp(size_t n) {
+  return (n + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+size_t dataOffset(size_t maxEntries) {
+  return alignUp(sizeof(SharedStatsHeader) +
+                 maxEntries * sizeof(SharedStatsEntry));
+}
+
+size_t dataWords(size_t numLevels, size_t numBuckets) {
+  return 1 +
+      numLevels *
+      (detail::kSharedStatsLevelWords +
+       numBuckets * detail::kSharedStatsBucketWords);
+}
+
+// Builds the region in a new file next to path, and renames it over path
+// once the header is in place: a reader still mapping the file of an
+// earlier exporter keeps it, rather than seeing it truncated under it
+MemoryMapping createRegion(
+    const std::string& path,
+    size_t maxEntries,
+    size_t dataBytes) {
+  if (maxEntries > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(
+        to<std::string>("too many stats entries: ", maxEntries));
+  }
+  std::string tmpPath = path + ".XXXXXX";
+  int fd = mkstemp(&tmpPath[0]);
+  checkUnixError(fd, "failed to create a stats region next to ", path);
+  auto removeTmp = makeGuard([&] { unlink(tmpPath.c_str()); });
+  File file(fd, /* ownsFd */ true);
+  checkUnixError(fchmod(fd, 0644), "fchmod failed: ", tmpPath);
+
+  MemoryMapping mapping(
+      std::move(file),
+      0,
+      off_t(dataOffset(maxEntries) + alignUp(dataBytes)),
+      MemoryMapping::writable());
+  auto h = reinterpret_cast<SharedStatsHeader*>(
+      mapping.writableRange().data());
+  h->version = SharedStatsHeader::kVersion;
+  h->maxEntries = uint32_t(maxEntries);
+  h->size = mapping.range().size();
+  h->dataOffset = dataOffset(maxEntries);
+  h->numEntries.store(0, std::memory_order_relaxed);
+  h->magic.store(SharedStatsHeader::kMagic, std::memory_order_release);
+
+  checkUnixError(
+      rename(tmpPath.c_str(), path.c_str()), "rename failed: ", path);
+  removeTmp.dismiss();
+  return mapping;
+}
+
+} // namespace
+
+SharedStatsExporter::SharedStatsExporter(
+    const std::string& path,
+    size_t maxEntries,
+    size_t dataBytes)
+    : mapping_(createRegion(path, maxEntries, dataBytes)) {}
+
+SharedStatsHeader* SharedStatsExporter::header() const {
+  return reinterpret_cast<SharedStatsHeader*>(mapping_.writableRange().data());
+}
+
+SharedStatsEntry* SharedStatsExporter::entries() const {
+  return reinterpret_cast<SharedStatsEntry*>(header() + 1);
+}
+
+size_t SharedStatsExporter::numEntries() const {
+  return header()->numEntries.load(std::memory_order_relaxed);
+}
+
+SharedStatsExporter::Handle SharedStatsExporter::addEntry(
+    StringPiece name,
+    SharedStatsSnapshot::Kind kind,
+    size_t numLevels,
+    size_t numBuckets,
+    double bucketSize,
+    double min,
+    double max) {
+  if (name.size() > SharedStatsEntry::kMaxNameLength) {
+    throw std::invalid_argument(
+        to<std::string>("stats entry name too long: ", name));
+  }
+  auto bytes = alignUp(dataWords(numLevels, numBuckets) * sizeof(uint64_t));
+
+  std::lock_guard<std::mutex> g(mutex_);
+  auto h = header();
+  auto n = h->numEntries.load(std::memory_order_relaxed);
+  if (n == h->maxEntries || h->dataOffset + dataUsed_ + bytes > h->size) {
+    throw std::length_error(
+        to<std::string>("no room left for stats entry ", name));
+  }
+
+  auto& entry = entries()[n];
+  std::memcpy(entry.name, name.data(), name.size());
+  entry.name[name.size()] = '\0';
+  entry.kind = uint32_t(kind);
+  entry.numLevels = uint32_t(numLevels);
+  entry.numBuckets = uint32_t(numBuckets);
+  entry.bucketSize = bucketSize;
+  entry.min = min;
+  entry.max = max;
+  entry.dataOffset = h->dataOffset + dataUsed_;
+  dataUsed_ += bytes;
+  // The data block is all zeros already, as the file is new
+  h->numEntries.store(n + 1, std::memory_order_release);
+
+  return Handle(
+      reinterpret_cast<std::atomic<uint64_t>*>(
+          mapping_.writableRange().data() + entry.dataOffset),
+      entry.numLevels,
+      entry.numBuckets);
+}
+
+void SharedStatsExporter::beginWrite(const Handle& handle) {
+  auto seq = handle.data_[0].load(std::memory_order_relaxed);
+  handle.data_[0].store(seq + 1, std::memory_order_relaxed);
+  // Readers that see any of the data below see the odd sequence number
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SharedStatsExporter::endWrite(const Handle& handle) {
+  auto seq = handle.data_[0].load(std::memory_order_relaxed);
+  handle.data_[0].store(seq + 1, std::memory_order_release);
+}
+
+SharedStatsReader::SharedStatsReader(const std::string& path)
+    : mapping_(path.c_str()) {
+  auto size = mapping_.range().size();
+  if (size < sizeof(SharedStatsHeader) ||
+      header()->magic.load(std::memory_order_acquire) !=
+          SharedStatsHeader::kMagic) {
+    throw std::runtime_error(to<std::string>("not a stats region: ", path));
+  }
+  auto h = header();
+  if (h->version != SharedStatsHeader::kVersion) {
+    throw std::runtime_error(to<std::string>(
+        "unsupported stats region version ", h->version, ": ", path));
+  }
+  if (h->size > size || h->dataOffset > h->size ||
+      sizeof(SharedStatsHeader) + h->maxEntries * sizeof(SharedStatsEntry) >
+          h->dataOffset) {
+    throw std::runtime_error(to<std::string>("bad stats region: ", path));
+  }
+}
+
+const SharedStatsHeader* SharedStatsReader::header() const {
+  return reinterpret_cast<const SharedStatsHeader*>(mapping_.range().data());
+}
+
+const SharedStatsEntry* SharedStatsReader::entries() const {
+  return reinterpret_cast<const SharedStatsEntry*>(header() + 1);
+}
+
+size_t SharedStatsReader::numEntries() const {
+  return std::min(
+      header()->numEntries.load(std::memory_order_acquire),
+      header()->maxEntries);
+}
+
+ssize_t SharedStatsReader::find(StringPiece name) const {
+  auto n = numEntries();
+  for (size_t i = 0; i < n; ++i) {
+    const auto& entry = entries()[i];
+    if (name ==
+        StringPiece(
+            entry.name,
+            strnlen(entry.name, SharedStatsEntry::kMaxNameLength))) {
+      return ssize_t(i);
+    }
+  }
+  return -1;
+}
+
+Optional<SharedStatsSnapshot> SharedStatsReader::read(
+    size_t index,
+    size_t maxAttempts) const {
+  if (index >= numEntries()) {
+    throw std::out_of_range(to<std::string>("no stats entry ", index));
+  }
+  const auto& entry = entries()[index];
+  auto words = dataWords(entry.numLevels, entry.numBuckets);
+  if (entry.dataOffset > header()->size ||
+      words > (header()->size - entry.dataOffset) / sizeof(uint64_t)) {
+    throw std::runtime_error(to<std::string>("bad stats entry ", index));
+  }
+  auto data = reinterpret_cast<const std::atomic<uint64_t>*>(
+      mapping_.range().data() + entry.dataOffset);
+
+  std::vector<uint64_t> copy(words - 1);
+  uint64_t seq = 0;
+  bool consistent = false;
+  for (size_t attempt = 0; attempt < maxAttempts && !consistent; ++attempt) {
+    seq = data[0].load(std::memory_order_acquire);
+    if (seq & 1) {
+      asm_volatile_pause();
+      continue;
+    }
+    for (size_t i = 0; i < copy.size(); ++i) {
+      copy[i] = data[i + 1].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    consistent = data[0].load(std::memory_order_relaxed) == seq;
+  }
+  if (!consistent) {
+    return none;
+  }
+
+  SharedStatsSnapshot snapshot;
+  snapshot.name.assign(
+      entry.name, strnlen(entry.name, SharedStatsEntry::kMaxNameLength));
+  snapshot.kind = SharedStatsSnapshot::Kind(entry.kind);
+  snapshot.bucketSize = entry.bucketSize;
+  snapshot.min = entry.min;
+  snapshot.max = entry.max;
+  snapshot.generation = seq / 2;
+  snapshot.levels.resize(entry.numLevels);
+  auto in = copy.data();
+  for (auto& level : snapshot.levels) {
+    level.duration = std::chrono::nanoseconds(int64_t(in[0]));
+    level.elapsed = std::chrono::nanoseconds(int64_t(in[1]));
+    level.sum = detail::fromSharedStatsWord(in[2]);
+    level.count = in[3];
+    in += detail::kSharedStatsLevelWords;
+    level.buckets.resize(entry.numBuckets);
+    for (auto& bucket : level.buckets) {
+      bucket.sum = detail::fromSharedStatsWord(in[0]);
+      bucket.count = in[1];
+      in += detail::kSharedStatsBucketWords;
+    }
+  }
+  return snapshot;
+}
+
+} // namespace folly
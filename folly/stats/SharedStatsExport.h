@@ -0,0 +1,391 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/portability/SysTypes.h>
+#include <folly/stats/MultiLevelTimeSeries.h>
+#include <folly/stats/TimeseriesHistogram.h>
+#include <folly/system/MemoryMapping.h>
+
+namespace folly {
+
+/*
+ * Exports MultiLevelTimeSeries and TimeseriesHistogram data through a file
+ * mapped in shared memory (typically under /dev/shm), so that a monitoring
+ * agent in another process can read it whenever it likes, without a request
+ * to the serving process, and without the serving process serializing
+ * anything or taking any lock of its stats for the agent.
+ *
+ * The serving process registers each stat once with SharedStatsExporter,
+ * and then publishes its data when convenient (e.g. right after update(),
+ * while it holds whatever lock guards the stat anyway).  Publishing copies
+ * the sum, count and elapsed time of each level (and of each bucket, for
+ * histograms) into the entry of the stat, under a sequence lock: no
+ * allocation, no formatting, no system call.
+ *
+ * SharedStatsReader maps the same file read-only, and takes consistent
+ * snapshots of the entries, retrying while an entry is being published.
+ * The layout (see detail::SharedStatsHeader) is versioned, so that agents
+ * can reject regions they don't understand; anything that reads it the same
+ * way can stand in for SharedStatsReader.
+ *
+ * Sums are exported as doubles, whatever the ValueType of the stat.
+ */
+
+/*
+ * What a reader sees of one level of a stat (or of one of its buckets)
+ */
+struct SharedStatsLevel {
+  // 0 for an all-time level
+  std::chrono::nanoseconds duration{0};
+  std::chrono::nanoseconds elapsed{0};
+  double sum{0};
+  uint64_t count{0};
+
+  struct Bucket {
+    double sum{0};
+    uint64_t count{0};
+  };
+  // Histograms only: the "under" bucket, those of [min, max), and "over"
+  std::vector<Bucket> buckets;
+
+  double avg() const {
+    return count == 0 ? 0 : sum / count;
+  }
+
+  // Per second
+  double rate() const {
+    return elapsed.count() <= 0
+        ? 0
+        : sum / std::chrono::duration<double>(elapsed).count();
+  }
+};
+
+struct SharedStatsSnapshot {
+  enum class Kind : uint32_t { TIMESERIES = 1, HISTOGRAM = 2 };
+
+  std::string name;
+  Kind kind{Kind::TIMESERIES};
+  // Histograms only
+  double bucketSize{0};
+  double min{0};
+  double max{0};
+  std::vector<SharedStatsLevel> levels;
+  // Times the entry was published
+  uint64_t generation{0};
+};
+
+namespace detail {
+
+/*
+ * The region starts with a SharedStatsHeader, followed by maxEntries
+ * SharedStatsEntry descriptors, and then by the data blocks of the
+ * entries.  All the fields are in the byte order of the host.
+ *
+ * A data block is a sequence of 64 bit words: the sequence number, which
+ * is odd while the block is being written, and then for each level its
+ * duration and elapsed time in nanoseconds, its sum (the bits of a double)
+ * and its count, followed (for histograms) by the sum and count of each
+ * bucket.
+ *
+ * Readers must load magic, and then numEntries, with acquire semantics;
+ * the descriptors of the first numEntries entries never change after
+ * that.  A data block is consistent if the sequence number loaded (with
+ * acquire semantics) before reading it is even and is loaded again after
+ * an acquire fence.
+ */
+struct SharedStatsHeader {
+  static constexpr uint64_t kMagic = 0x53544154534c4f46; // "FOLSTATS"
+  static constexpr uint32_t kVersion = 1;
+
+  // Stored last when creating the region
+  std::atomic<uint64_t> magic;
+  uint32_t version;
+  uint32_t maxEntries;
+  uint64_t size;
+  uint64_t dataOffset;
+  std::atomic<uint32_t> numEntries;
+  uint32_t reserved;
+};
+
+struct SharedStatsEntry {
+  static constexpr size_t kMaxNameLength = 95;
+
+  // NUL-terminated
+  char name[kMaxNameLength + 1];
+  uint32_t kind;
+  uint32_t numLevels;
+  // Histograms: including the "under" and "over" buckets; 0 otherwise
+  uint32_t numBuckets;
+  uint32_t reserved;
+  double bucketSize;
+  double min;
+  double max;
+  // From the start of the region
+  uint64_t dataOffset;
+};
+
+static_assert(sizeof(SharedStatsHeader) % 8 == 0, "bad layout");
+static_assert(sizeof(SharedStatsEntry) % 8 == 0, "bad layout");
+
+constexpr size_t kSharedStatsLevelWords = 4;
+constexpr size_t kSharedStatsBucketWords = 2;
+
+inline uint64_t toSharedStatsWord(double value) {
+  uint64_t word;
+  std::memcpy(&word, &value, sizeof(word));
+  return word;
+}
+
+inline double fromSharedStatsWord(uint64_t word) {
+  double value;
+  std::memcpy(&value, &word, sizeof(value));
+  return value;
+}
+
+} // namespace detail
+
+class SharedStatsExporter {
+ public:
+  /*
+   * The entry of a registered stat, to publish it with.  Publishing an
+   * entry from several threads at once is not supported; the lock that
+   * guards a stat should guard publishing it too.
+   */
+  class Handle {
+   public:
+    Handle() = default;
+
+    bool valid() const {
+      return data_ != nullptr;
+    }
+
+   private:
+    friend class SharedStatsExporter;
+    Handle(std::atomic<uint64_t>* data, uint32_t numLevels, uint32_t numBuckets)
+        : data_(data), numLevels_(numLevels), numBuckets_(numBuckets) {}
+
+    std::atomic<uint64_t>* data_{nullptr};
+    uint32_t numLevels_{0};
+    uint32_t numBuckets_{0};
+  };
+
+  /*
+   * Creates the file at path (replacing any file there with rename(), so
+   * readers of an earlier region keep it), sized for up to maxEntries
+   * stats and dataBytes of their data.  The data of each stat takes 8
+   * bytes, plus 32 per level, plus 16 per bucket and level for histograms,
+   * rounded up to 64 bytes so that stats don't share cache lines.  Throws
+   * on error.
+   */
+  SharedStatsExporter(
+      const std::string& path,
+      size_t maxEntries,
+      size_t dataBytes);
+
+  SharedStatsExporter(const SharedStatsExporter&) = delete;
+  SharedStatsExporter& operator=(const SharedStatsExporter&) = delete;
+
+  /*
+   * Register a stat under a name of up to SharedStatsEntry::kMaxNameLength
+   * characters (std::invalid_argument otherwise), taking its levels and
+   * buckets from ts or hist; std::length_error if the region is full.
+   * Names are not checked for uniqueness.
+   */
+  template <typename VT, typename CT>
+  Handle addTimeSeries(
+      StringPiece name,
+      const MultiLevelTimeSeries<VT, CT>& ts);
+
+  template <typename T, typename CT, typename C>
+  Handle addHistogram(
+      StringPiece name,
+      const TimeseriesHistogram<T, CT, C>& hist);
+
+  /*
+   * Copy the current data of the stat into its entry.  Like querying the
+   * stat, this should follow a call to its update(now).
+   */
+  template <typename VT, typename CT>
+  void publish(const Handle& handle, const MultiLevelTimeSeries<VT, CT>& ts);
+
+  template <typename T, typename CT, typename C>
+  void publish(
+      const Handle& handle,
+      const TimeseriesHistogram<T, CT, C>& hist);
+
+  size_t numEntries() const;
+
+ private:
+  Handle addEntry(
+      StringPiece name,
+      SharedStatsSnapshot::Kind kind,
+      size_t numLevels,
+      size_t numBuckets,
+      double bucketSize,
+      double min,
+      double max);
+
+  static void beginWrite(const Handle& handle);
+  static void endWrite(const Handle& handle);
+
+  template <typename Duration>
+  static std::atomic<uint64_t>* writeTimes(
+      std::atomic<uint64_t>* out,
+      Duration duration,
+      Duration elapsed);
+
+  static std::atomic<uint64_t>*
+  writeWords(std::atomic<uint64_t>* out, double sum, uint64_t count) {
+    out[0].store(detail::toSharedStatsWord(sum), std::memory_order_relaxed);
+    out[1].store(count, std::memory_order_relaxed);
+    return out + detail::kSharedStatsBucketWords;
+  }
+
+  detail::SharedStatsHeader* header() const;
+  detail::SharedStatsEntry* entries() const;
+
+  MemoryMapping mapping_;
+  // Serializes registration
+  std::mutex mutex_;
+  uint64_t dataUsed_{0};
+};
+
+class SharedStatsReader {
+ public:
+  /*
+   * Maps the file created by a SharedStatsExporter, read-only.  Throws
+   * std::runtime_error if it doesn't hold a region of a known version.
+   */
+  explicit SharedStatsReader(const std::string& path);
+
+  // Entries registered so far; grows as the exporter registers more
+  size_t numEntries() const;
+
+  /*
+   * A consistent snapshot of entry index, or none if none could be taken
+   * in maxAttempts reads (because the entry is being written often, or the
+   * exporter died while writing it).
+   */
+  Optional<SharedStatsSnapshot> read(size_t index, size_t maxAttempts = 1000)
+      const;
+
+  // The first entry of that name, or -1
+  ssize_t find(StringPiece name) const;
+
+ private:
+  const detail::SharedStatsHeader* header() const;
+  const detail::SharedStatsEntry* entries() const;
+
+  MemoryMapping mapping_;
+};
+
+template <typename VT, typename CT>
+SharedStatsExporter::Handle SharedStatsExporter::addTimeSeries(
+    StringPiece name,
+    const MultiLevelTimeSeries<VT, CT>& ts) {
+  return addEntry(
+      name, SharedStatsSnapshot::Kind::TIMESERIES, ts.numLevels(), 0, 0, 0, 0);
+}
+
+template <typename T, typename CT, typename C>
+SharedStatsExporter::Handle SharedStatsExporter::addHistogram(
+    StringPiece name,
+    const TimeseriesHistogram<T, CT, C>& hist) {
+  return addEntry(
+      name,
+      SharedStatsSnapshot::Kind::HISTOGRAM,
+      hist.getNumLevels(),
+      hist.getNumBuckets(),
+      double(hist.getBucketSize()),
+      double(hist.getMin()),
+      double(hist.getMax()));
+}
+
+template <typename Duration>
+std::atomic<uint64_t>* SharedStatsExporter::writeTimes(
+    std::atomic<uint64_t>* out,
+    Duration duration,
+    Duration elapsed) {
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  out[0].store(
+      uint64_t(duration_cast<nanoseconds>(duration).count()),
+      std::memory_order_relaxed);
+  out[1].store(
+      uint64_t(duration_cast<nanoseconds>(elapsed).count()),
+      std::memory_order_relaxed);
+  return out + 2;
+}
+
+template <typename VT, typename CT>
+void SharedStatsExporter::publish(
+    const Handle& handle,
+    const MultiLevelTimeSeries<VT, CT>& ts) {
+  DCHECK(handle.valid());
+  DCHECK_EQ(handle.numLevels_, ts.numLevels());
+  DCHECK_EQ(handle.numBuckets_, 0);
+  beginWrite(handle);
+  auto out = handle.data_ + 1;
+  for (size_t i = 0; i < handle.numLevels_; ++i) {
+    const auto& level = ts.getLevel(i);
+    out = writeTimes(out, level.duration(), level.elapsed());
+    out = writeWords(out, double(level.sum()), level.count());
+  }
+  endWrite(handle);
+}
+
+template <typename T, typename CT, typename C>
+void SharedStatsExporter::publish(
+    const Handle& handle,
+    const TimeseriesHistogram<T, CT, C>& hist) {
+  DCHECK(handle.valid());
+  DCHECK_EQ(handle.numLevels_, hist.getNumLevels());
+  DCHECK_EQ(handle.numBuckets_, hist.getNumBuckets());
+  beginWrite(handle);
+  auto out = handle.data_ + 1;
+  for (size_t i = 0; i < handle.numLevels_; ++i) {
+    // As in TimeseriesHistogram::rate(), the elapsed time is the longest
+    // of those of the buckets (which only count from their first value)
+    auto elapsed = hist.getBucket(0).getLevel(i).elapsed();
+    for (size_t b = 1; b < handle.numBuckets_; ++b) {
+      elapsed = std::max(elapsed, hist.getBucket(b).getLevel(i).elapsed());
+    }
+    out = writeTimes(out, hist.getBucket(0).getLevel(i).duration(), elapsed);
+    out = writeWords(out, double(hist.sum(i)), hist.count(i));
+    for (size_t b = 0; b < handle.numBuckets_; ++b) {
+      const auto& level = hist.getBucket(b).getLevel(i);
+      out = writeWords(out, double(level.sum()), level.count());
+    }
+  }
+  endWrite(handle);
+}
+
+} // namespace folly
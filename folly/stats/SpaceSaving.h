@@ -0,0 +1,237 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/hash/Hash.h>
+
+namespace folly {
+
+/*
+ * SpaceSaving finds the heavy hitters of a stream, the keys added the most
+ * times, while keeping track of at most capacity keys (see "Efficient
+ * Computation of Frequent and Top-k Elements in Data Streams", Metwally,
+ * Agrawal & El Abbadi).
+ *
+ * When a key that isn't tracked is added and the summary is full, it
+ * replaces the tracked key of the lowest count, and inherits that count as
+ * its error.  So counts never undercount, and overcount by at most their
+ * error, which is at most totalCount() / capacity: any key added more than
+ * that many times is tracked.
+ *
+ *   SpaceSaving<std::string> callers(1000);
+ *   for (const auto& request : requests) {
+ *     callers.add(request.caller);
+ *   }
+ *   for (const auto& entry : callers.topK(10)) {
+ *     LOG(INFO) << entry.key << ": " << entry.count;
+ *   }
+ *
+ * Summaries merge into a summary of the union of their streams, with the
+ * same guarantees (see "Mergeable Summaries", Agarwal et al.).
+ *
+ * add() is O(log capacity).  This class is not thread-safe.
+ */
+template <
+    class Key,
+    class Hasher = folly::hasher<Key>,
+    class KeyEqual = std::equal_to<Key>>
+class SpaceSaving {
+ public:
+  struct Entry {
+    Key key;
+    // An upper bound on the count of the key; the lower bound is
+    // count - error
+    uint64_t count;
+    uint64_t error;
+  };
+
+  explicit SpaceSaving(size_t capacity) : capacity_(capacity) {
+    CHECK_GT(capacity, 0u);
+    entries_.reserve(capacity_);
+    positions_.reserve(capacity_);
+  }
+
+  void add(const Key& key, uint64_t count = 1) {
+    totalCount_ += count;
+    auto it = positions_.find(key);
+    if (it != positions_.end()) {
+      entries_[it->second].count += count;
+      siftDown(it->second);
+    } else if (entries_.size() < capacity_) {
+      positions_.emplace(key, entries_.size());
+      entries_.push_back(Entry{key, count, 0});
+      siftUp(entries_.size() - 1);
+    } else {
+      // Replace the key of the lowest count
+      auto& min = entries_.front();
+      positions_.erase(min.key);
+      positions_.emplace(key, 0);
+      min.key = key;
+      min.error = min.count;
+      min.count += count;
+      siftDown(0);
+    }
+  }
+
+  /*
+   * An upper bound on the count of a key: its count if it's tracked, or
+   * the lowest count (0 if the summary isn't full).
+   */
+  uint64_t estimate(const Key& key) const {
+    auto it = positions_.find(key);
+    if (it != positions_.end()) {
+      return entries_[it->second].count;
+    }
+    return untrackedCount();
+  }
+
+  /* The (up to) k entries of the largest counts, largest first. */
+  std::vector<Entry> topK(size_t k) const {
+    std::vector<Entry> result(entries_);
+    k = std::min(k, result.size());
+    auto byCount = [](const Entry& a, const Entry& b) {
+      return a.count > b.count;
+    };
+    std::partial_sort(
+        result.begin(), result.begin() + k, result.end(), byCount);
+    result.resize(k);
+    return result;
+  }
+
+  /* Adds the stream of other into this summary. */
+  void merge(const SpaceSaving& other) {
+    // A key that one summary doesn't track may have been added to it as
+    // many times as its lowest count
+    uint64_t untracked = untrackedCount();
+    uint64_t otherUntracked = other.untrackedCount();
+
+    std::vector<Entry> merged(entries_);
+    for (auto& entry : merged) {
+      auto it = other.positions_.find(entry.key);
+      if (it != other.positions_.end()) {
+        entry.count += other.entries_[it->second].count;
+        entry.error += other.entries_[it->second].error;
+      } else {
+        entry.count += otherUntracked;
+        entry.error += otherUntracked;
+      }
+    }
+    for (const auto& entry : other.entries_) {
+      if (positions_.count(entry.key) == 0) {
+        merged.push_back(Entry{
+            entry.key, entry.count + untracked, entry.error + untracked});
+      }
+    }
+
+    // Keep the largest counts; an array sorted by count is a min-heap
+    std::sort(merged.begin(), merged.end(), [](const Entry& a, const Entry& b) {
+      return a.count > b.count;
+    });
+    if (merged.size() > capacity_) {
+      merged.resize(capacity_);
+    }
+    std::reverse(merged.begin(), merged.end());
+
+    entries_ = std::move(merged);
+    positions_.clear();
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      positions_.emplace(entries_[i].key, i);
+    }
+    totalCount_ += other.totalCount_;
+  }
+
+  void clear() {
+    entries_.clear();
+    positions_.clear();
+    totalCount_ = 0;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /* The number of keys tracked. */
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /* The sum of all of the counts added. */
+  uint64_t totalCount() const {
+    return totalCount_;
+  }
+
+ private:
+  uint64_t untrackedCount() const {
+    return entries_.size() < capacity_ ? 0 : entries_.front().count;
+  }
+
+  void swapEntries(size_t i, size_t j) {
+    std::swap(entries_[i], entries_[j]);
+    positions_[entries_[i].key] = i;
+    positions_[entries_[j].key] = j;
+  }
+
+  void siftUp(size_t i) {
+    while (i > 0) {
+      size_t parent = (i - 1) / 2;
+      if (entries_[parent].count <= entries_[i].count) {
+        break;
+      }
+      swapEntries(i, parent);
+      i = parent;
+    }
+  }
+
+  void siftDown(size_t i) {
+    while (true) {
+      size_t smallest = i;
+      size_t left = 2 * i + 1;
+      size_t right = left + 1;
+      if (left < entries_.size() &&
+          entries_[left].count < entries_[smallest].count) {
+        smallest = left;
+      }
+      if (right < entries_.size() &&
+          entries_[right].count < entries_[smallest].count) {
+        smallest = right;
+      }
+      if (smallest == i) {
+        break;
+      }
+      swapEntries(i, smallest);
+      i = smallest;
+    }
+  }
+
+  size_t capacity_;
+  uint64_t totalCount_{0};
+  // A min-heap by count
+  std::vector<Entry> entries_;
+  std::unordered_map<Key, size_t, Hasher, KeyEqual> positions_;
+};
+
+} // namespace folly
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/TDigest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/Varint.h>
+
+namespace folly {
+
+namespace {
+
+constexpr uint8_t kSerializationVersion = 1;
+
+/*
+ * The scale function, mapping k in [0, d] to a quantile.  The centroid
+ * between k and k + 1 may hold the values between these quantiles, which
+ * is fewer values at the tails than in the middle.
+ */
+double kToQ(double k, double d) {
+  double kDivD = k / d;
+  if (kDivD >= 1.0) {
+    return 1.0;
+  } else if (kDivD >= 0.5) {
+    double base = 1 - kDivD;
+    return 1 - 2 * base * base;
+  } else {
+    return 2 * kDivD * kDivD;
+  }
+}
+
+void appendDouble(std::string& out, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits = Endian::little(bits);
+  out.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+}
+
+void appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[kMaxVarintLength64];
+  size_t size = encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), size);
+}
+
+[[noreturn]] void throwInvalid(const char* what) {
+  throw std::invalid_argument(
+      std::string("TDigest::deserialize: ") + what);
+}
+
+double readDouble(ByteRange& data) {
+  uint64_t bits;
+  if (data.size() < sizeof(bits)) {
+    throwInvalid("truncated");
+  }
+  std::memcpy(&bits, data.data(), sizeof(bits));
+  data.advance(sizeof(bits));
+  bits = Endian::little(bits);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint64_t readVarint(ByteRange& data) {
+  auto value = tryDecodeVarint(data);
+  if (!value) {
+    throwInvalid("truncated or invalid varint");
+  }
+  return *value;
+}
+
+} // namespace
+
+double TDigest::Centroid::add(double sum, double weight) {
+  sum += mean_ * weight_;
+  weight_ += weight;
+  mean_ = sum / weight_;
+  return sum;
+}
+
+void TDigest::compress(const std::vector<Centroid>& sorted, double count) {
+  centroids_.clear();
+  centroids_.reserve(std::min(sorted.size(), maxSize_ + 1));
+  count_ = count;
+  sum_ = 0.0;
+
+  // Each compressed centroid takes the next centroids as long as the
+  // weight so far is within the quantile of its k.
+  double k = 1;
+  double qLimitTimesCount = kToQ(k++, maxSize_) * count;
+
+  auto it = sorted.begin();
+  Centroid cur = *it++;
+  double weightSoFar = cur.weight();
+  double sumsToMerge = 0;
+  double weightsToMerge = 0;
+  for (; it != sorted.end(); ++it) {
+    weightSoFar += it->weight();
+    if (weightSoFar <= qLimitTimesCount) {
+      sumsToMerge += it->mean() * it->weight();
+      weightsToMerge += it->weight();
+    } else {
+      sum_ += cur.add(sumsToMerge, weightsToMerge);
+      sumsToMerge = 0;
+      weightsToMerge = 0;
+      centroids_.push_back(cur);
+      qLimitTimesCount = kToQ(k++, maxSize_) * count;
+      cur = *it;
+    }
+  }
+  sum_ += cur.add(sumsToMerge, weightsToMerge);
+  centroids_.push_back(cur);
+
+  // Rounding may reorder centroids of almost equal means
+  std::sort(centroids_.begin(), centroids_.end());
+}
+
+TDigest TDigest::mergeSorted(Range<const double*> sortedValues) const {
+  if (sortedValues.empty()) {
+    return *this;
+  }
+
+  TDigest result(maxSize_);
+  double valuesMin = sortedValues.front();
+  double valuesMax = sortedValues.back();
+  if (centroids_.empty()) {
+    result.min_ = valuesMin;
+    result.max_ = valuesMax;
+  } else {
+    result.min_ = std::min(min_, valuesMin);
+    result.max_ = std::max(max_, valuesMax);
+  }
+
+  std::vector<Centroid> sorted;
+  sorted.reserve(centroids_.size() + sortedValues.size());
+  auto it = centroids_.begin();
+  for (double value : sortedValues) {
+    while (it != centroids_.end() && it->mean() < value) {
+      sorted.push_back(*it++);
+    }
+    sorted.emplace_back(value, 1.0);
+  }
+  sorted.insert(sorted.end(), it, centroids_.end());
+
+  result.compress(sorted, count_ + sortedValues.size());
+  return result;
+}
+
+TDigest TDigest::merge(Range<const double*> unsortedValues) const {
+  std::vector<double> sortedValues(
+      unsortedValues.begin(), unsortedValues.end());
+  std::sort(sortedValues.begin(), sortedValues.end());
+  return mergeSorted(range(sortedValues));
+}
+
+TDigest TDigest::merge(Range<const TDigest*> digests) {
+  if (digests.empty()) {
+    return TDigest();
+  }
+
+  TDigest result(digests.front().maxSize_);
+  size_t numCentroids = 0;
+  for (const auto& digest : digests) {
+    numCentroids += digest.centroids_.size();
+  }
+  if (numCentroids == 0) {
+    return result;
+  }
+
+  // Concatenate the sorted runs of the digests, then merge them pairwise,
+  // back and forth between two buffers
+  std::vector<Centroid> sorted;
+  sorted.reserve(numCentroids);
+  std::vector<size_t> runEnds;
+  runEnds.reserve(digests.size());
+  double count = 0;
+  bool first = true;
+  for (const auto& digest : digests) {
+    if (digest.centroids_.empty()) {
+      continue;
+    }
+    sorted.insert(
+        sorted.end(), digest.centroids_.begin(), digest.centroids_.end());
+    runEnds.push_back(sorted.size());
+    count += digest.count_;
+    if (first) {
+      result.min_ = digest.min_;
+      result.max_ = digest.max_;
+      first = false;
+    } else {
+      result.min_ = std::min(result.min_, digest.min_);
+      result.max_ = std::max(result.max_, digest.max_);
+    }
+  }
+
+  std::vector<Centroid> buffer(sorted.size());
+  while (runEnds.size() > 1) {
+    size_t out = 0;
+    size_t begin = 0;
+    size_t i = 0;
+    for (; i + 1 < runEnds.size(); i += 2) {
+      std::merge(
+          sorted.begin() + begin,
+          sorted.begin() + runEnds[i],
+          sorted.begin() + runEnds[i],
+          sorted.begin() + runEnds[i + 1],
+          buffer.begin() + begin);
+      begin = runEnds[i + 1];
+      runEnds[out++] = begin;
+    }
+    if (i < runEnds.size()) {
+      std::copy(
+          sorted.begin() + begin,
+          sorted.begin() + runEnds[i],
+          buffer.begin() + begin);
+      runEnds[out++] = runEnds[i];
+    }
+    runEnds.resize(out);
+    sorted.swap(buffer);
+  }
+
+  result.compress(sorted, count);
+  return result;
+}
+
+double TDigest::estimateQuantile(double q) const {
+  if (centroids_.empty()) {
+    return 0.0;
+  }
+  double rank = q * count_;
+
+  // Find the centroid holding the rank, and the weight before it
+  size_t pos;
+  double t;
+  if (q > 0.5) {
+    if (q >= 1.0) {
+      return max_;
+    }
+    pos = 0;
+    t = count_;
+    for (size_t i = centroids_.size(); i-- > 0;) {
+      t -= centroids_[i].weight();
+      if (rank >= t) {
+        pos = i;
+        break;
+      }
+    }
+  } else {
+    if (q <= 0.0) {
+      return min_;
+    }
+    pos = centroids_.size() - 1;
+    t = 0;
+    for (size_t i = 0; i < centroids_.size(); ++i) {
+      if (rank < t + centroids_[i].weight()) {
+        pos = i;
+        break;
+      }
+      t += centroids_[i].weight();
+    }
+  }
+
+  // Interpolate within the centroid, towards its neighbours
+  double delta = 0;
+  double min = min_;
+  double max = max_;
+  if (centroids_.size() > 1) {
+    if (pos == 0) {
+      delta = centroids_[pos + 1].mean() - centroids_[pos].mean();
+      max = centroids_[pos + 1].mean();
+    } else if (pos == centroids_.size() - 1) {
+      delta = centroids_[pos].mean() - centroids_[pos - 1].mean();
+      min = centroids_[pos - 1].mean();
+    } else {
+      delta = (centroids_[pos + 1].mean() - centroids_[pos - 1].mean()) / 2;
+      min = centroids_[pos - 1].mean();
+      max = centroids_[pos + 1].mean();
+    }
+  }
+  double value = centroids_[pos].mean() +
+      ((rank - t) / centroids_[pos].weight() - 0.5) * delta;
+  return std::max(min, std::min(value, max));
+}
+
+void TDigest::serialize(std::string& out) const {
+  out.push_back(char(kSerializationVersion));
+  appendVarint(out, maxSize_);
+  appendVarint(out, centroids_.size());
+  if (centroids_.empty()) {
+    return;
+  }
+  appendDouble(out, sum_);
+  appendDouble(out, min_);
+  appendDouble(out, max_);
+  for (const auto& centroid : centroids_) {
+    // Weights are sums of counts of values, so they are integers
+    appendDouble(out, centroid.mean());
+    appendVarint(out, uint64_t(centroid.weight()));
+  }
+}
+
+TDigest TDigest::deserialize(ByteRange data) {
+  if (data.empty()) {
+    throwInvalid("truncated");
+  }
+  if (data.front() != kSerializationVersion) {
+    throwInvalid("unknown version");
+  }
+  data.advance(1);
+
+  uint64_t maxSize = readVarint(data);
+  if (maxSize == 0) {
+    throwInvalid("invalid maxSize");
+  }
+  TDigest result(maxSize);
+  uint64_t numCentroids = readVarint(data);
+  if (numCentroids == 0) {
+    return result;
+  }
+  // Each centroid takes at least 9 bytes, so this bounds the allocation
+  if (numCentroids > data.size() / 9 || numCentroids > maxSize + 1) {
+    throwInvalid("invalid number of centroids");
+  }
+
+  result.sum_ = readDouble(data);
+  result.min_ = readDouble(data);
+  result.max_ = readDouble(data);
+  result.centroids_.reserve(numCentroids);
+  for (uint64_t i = 0; i < numCentroids; ++i) {
+    double mean = readDouble(data);
+    uint64_t weight = readVarint(data);
+    if (weight == 0 ||
+        (!result.centroids_.empty() &&
+         mean < result.centroids_.back().mean())) {
+      throwInvalid("invalid centroid");
+    }
+    result.centroids_.emplace_back(mean, double(weight));
+    result.count_ += weight;
+  }
+  if (!data.empty()) {
+    throwInvalid("trailing data");
+  }
+  return result;
+}
+
+void TDigestBuilder::add(const TDigest& digest) {
+  flush();
+  const TDigest digests[] = {digest_, digest};
+  digest_ = TDigest::merge(range(digests));
+}
+
+void TDigestBuilder::flush() {
+  if (buffer_.empty()) {
+    return;
+  }
+  std::sort(buffer_.begin(), buffer_.end());
+  digest_ = digest_.mergeSorted(range(buffer_));
+  buffer_.clear();
+}
+
+} // namespace folly
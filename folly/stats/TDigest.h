@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+/*
+ * TDigest is a sketch of a distribution of doubles, answering quantile
+ * queries with an error that is smallest at the tails (see "Computing
+ * Extremely Accurate Quantiles Using t-Digests", Dunning & Ertl).  Unlike
+ * Histogram, it needs no bucket bounds up front, so it keeps its precision
+ * for values spanning many orders of magnitude.
+ *
+ * The distribution is summarized by at most maxSize centroids (a mean and
+ * a weight each), so a digest is small and digests of any number of
+ * values, from any number of threads or hosts, merge into a digest that is
+ * as accurate as one built from all of the values at once.
+ *
+ * A TDigest is an immutable value: merge() returns a new digest.  Merging
+ * values one at a time is expensive, so buffer them; see TDigestBuilder.
+ *
+ *   TDigestBuilder builder;
+ *   for (double latency : latencies) {
+ *     builder.add(latency);
+ *   }
+ *   TDigest digest = builder.build();
+ *   double p99 = digest.estimateQuantile(0.99);
+ *
+ *   // Elsewhere: fan in the digests of many hosts
+ *   std::vector<TDigest> digests = receive();
+ *   double p99 = TDigest::merge(range(digests)).estimateQuantile(0.99);
+ *
+ * This class is not thread-safe, but a const TDigest can be read from any
+ * number of threads.
+ */
+class TDigest {
+ public:
+  class Centroid {
+   public:
+    explicit Centroid(double mean = 0.0, double weight = 1.0)
+        : mean_(mean), weight_(weight) {}
+
+    double mean() const {
+      return mean_;
+    }
+
+    double weight() const {
+      return weight_;
+    }
+
+    /*
+     * Adds the sum and weight of other centroids into this one.  Returns
+     * the sum of this centroid afterwards.
+     */
+    double add(double sum, double weight);
+
+    bool operator<(const Centroid& other) const {
+      return mean_ < other.mean_;
+    }
+
+   private:
+    double mean_;
+    double weight_;
+  };
+
+  explicit TDigest(size_t maxSize = 100) : maxSize_(maxSize) {}
+
+  /*
+   * Returns a new digest of the values of this digest and sortedValues,
+   * which must be sorted in increasing order.
+   */
+  TDigest mergeSorted(Range<const double*> sortedValues) const;
+
+  /*
+   * Same as mergeSorted(), for unsorted values.  This sorts a copy of the
+   * values first.
+   */
+  TDigest merge(Range<const double*> unsortedValues) const;
+
+  /*
+   * Returns a digest of the values of all of the digests, with the maxSize
+   * of the first one.  Merging k digests of n centroids in total is
+   * O(n log k), so fanning in many digests at once is much cheaper than
+   * merging them one at a time.
+   */
+  static TDigest merge(Range<const TDigest*> digests);
+
+  /*
+   * Estimates the value at quantile q, in [0, 1].  Returns 0 for an empty
+   * digest, and the exact min() and max() for q at or beyond 0 and 1.
+   */
+  double estimateQuantile(double q) const;
+
+  double mean() const {
+    return count_ > 0 ? sum_ / count_ : 0.0;
+  }
+
+  double sum() const {
+    return sum_;
+  }
+
+  double count() const {
+    return count_;
+  }
+
+  double min() const {
+    return min_;
+  }
+
+  double max() const {
+    return max_;
+  }
+
+  bool empty() const {
+    return centroids_.empty();
+  }
+
+  size_t maxSize() const {
+    return maxSize_;
+  }
+
+  const std::vector<Centroid>& getCentroids() const {
+    return centroids_;
+  }
+
+  /*
+   * Appends the digest to out, in a compact binary form: a format version,
+   * varints for the maxSize and the centroid weights, and little-endian
+   * doubles for everything else.  A digest of maxSize 100 takes at most
+   * about 1KB.
+   */
+  void serialize(std::string& out) const;
+
+  std::string serialize() const {
+    std::string out;
+    serialize(out);
+    return out;
+  }
+
+  /*
+   * Parses a digest written by serialize().  Throws std::invalid_argument
+   * if the data is truncated, corrupt or of an unknown version.
+   */
+  static TDigest deserialize(ByteRange data);
+
+ private:
+  // Merges centroids, sorted by mean, into a digest of count values total
+  void compress(const std::vector<Centroid>& sorted, double count);
+
+  std::vector<Centroid> centroids_;
+  size_t maxSize_;
+  double sum_{0.0};
+  double count_{0.0};
+  double max_{0.0};
+  double min_{0.0};
+};
+
+/*
+ * Buffers values, and adds them to a TDigest in batches.  add() costs an
+ * append; every bufferSize values, the buffer is sorted and merged into
+ * the digest.
+ */
+class TDigestBuilder {
+ public:
+  explicit TDigestBuilder(size_t bufferSize = 1000, size_t digestSize = 100)
+      : bufferSize_(bufferSize), digest_(digestSize) {
+    buffer_.reserve(bufferSize_);
+  }
+
+  void add(double value) {
+    buffer_.push_back(value);
+    if (buffer_.size() >= bufferSize_) {
+      flush();
+    }
+  }
+
+  /* Merges a digest, e.g. one built elsewhere, into the result */
+  void add(const TDigest& digest);
+
+  /* Returns a digest of everything added so far */
+  const TDigest& build() {
+    flush();
+    return digest_;
+  }
+
+  /* Forgets everything added so far */
+  void clear() {
+    buffer_.clear();
+    digest_ = TDigest(digest_.maxSize());
+  }
+
+ private:
+  void flush();
+
+  size_t bufferSize_;
+  std::vector<double> buffer_;
+  TDigest digest_;
+};
+
+} // namespace folly
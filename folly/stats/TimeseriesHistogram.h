@@ -22,6 +22,9 @@
 
 namespace folly {
 
+template <class T, class CT, class C>
+class ConcurrentTimeseriesHistogram;
+
 /*
  * TimeseriesHistogram tracks data distributions as they change over time.
  *
@@ -320,6 +323,9 @@ class TimeseriesHistogram {
   }
 
  private:
+  template <class, class, class>
+  friend class ConcurrentTimeseriesHistogram;
+
   typedef ContainerType Bucket;
   struct CountFromLevel {
     explicit CountFromLevel(size_t level) : level_(level) {}
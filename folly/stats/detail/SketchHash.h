@@ -0,0 +1,37 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <folly/hash/Hash.h>
+
+namespace folly {
+namespace detail {
+
+/*
+ * Hashes a key for a sketch.  The hashers of 32-bit integers return 32-bit
+ * hashes, so the result is mixed again to spread over all 64 bits; this is
+ * a bijection, so it doesn't add collisions.
+ */
+template <class Hasher, class T>
+uint64_t sketchHash(const T& key) {
+  return hash::twang_mix64(static_cast<uint64_t>(Hasher()(key)));
+}
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <folly/Portability.h>
+
+#if FOLLY_SSE_PREREQ(2, 0)
+#include <emmintrin.h>
+#endif
+
+namespace folly {
+namespace detail {
+
+/*
+ * Sums a contiguous array.  Four independent accumulators let the compiler
+ * keep several additions in flight, and vectorize them for integers.
+ */
+template <typename T>
+T sumColumn(const T* data, size_t size) {
+  T s0 = T();
+  T s1 = T();
+  T s2 = T();
+  T s3 = T();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    s0 += data[i];
+    s1 += data[i + 1];
+    s2 += data[i + 2];
+    s3 += data[i + 3];
+  }
+  for (; i < size; ++i) {
+    s0 += data[i];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+#if FOLLY_SSE_PREREQ(2, 0)
+// 64-bit integers, two per SSE2 register; addition wraps the same way
+template <typename T>
+typename std::enable_if<
+    std::is_integral<T>::value && sizeof(T) == 8,
+    T>::type
+sumColumnSse2(const T* data, size_t size) {
+  __m128i s0 = _mm_setzero_si128();
+  __m128i s1 = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    s0 = _mm_add_epi64(
+        s0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    s1 = _mm_add_epi64(
+        s1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2)));
+  }
+  s0 = _mm_add_epi64(s0, s1);
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), s0);
+  uint64_t total = lanes[0] + lanes[1];
+  for (; i < size; ++i) {
+    total += uint64_t(data[i]);
+  }
+  return T(total);
+}
+
+template <>
+inline int64_t sumColumn<int64_t>(const int64_t* data, size_t size) {
+  return sumColumnSse2(data, size);
+}
+
+template <>
+inline uint64_t sumColumn<uint64_t>(const uint64_t* data, size_t size) {
+  return sumColumnSse2(data, size);
+}
+#endif
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/BucketedSketch.h>
+
+#include <chrono>
+#include <string>
+
+#include <folly/portability/GTest.h>
+#include <folly/stats/CountMinSketch.h>
+#include <folly/stats/HyperLogLog.h>
+#include <folly/stats/SpaceSaving.h>
+
+using namespace folly;
+using std::chrono::seconds;
+
+namespace {
+
+using StatsClock = LegacyStatsClock<seconds>;
+
+StatsClock::time_point mkTimePoint(int value) {
+  return StatsClock::time_point(StatsClock::duration(value));
+}
+
+} // namespace
+
+TEST(BucketedSketch, DistinctInLastMinute) {
+  BucketedSketch<HyperLogLog> distinct(60, seconds(60), HyperLogLog(12));
+  EXPECT_EQ(60, distinct.numBuckets());
+  EXPECT_EQ(0, distinct.get().estimate());
+
+  // 10 new keys every second
+  for (int now = 0; now < 300; ++now) {
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(distinct.add(mkTimePoint(now), now * 10 + i));
+    }
+  }
+  distinct.update(mkTimePoint(299));
+  EXPECT_NEAR(600, distinct.get().estimate(), 20);
+
+  // Too old for the window
+  EXPECT_FALSE(distinct.add(mkTimePoint(200), -1));
+
+  distinct.update(mkTimePoint(329));
+  EXPECT_NEAR(300, distinct.get().estimate(), 10);
+  distinct.update(mkTimePoint(1000));
+  EXPECT_EQ(0, distinct.get().estimate());
+
+  distinct.add(mkTimePoint(1000), 1);
+  distinct.clear();
+  distinct.update(mkTimePoint(1000));
+  EXPECT_EQ(0, distinct.get().estimate());
+}
+
+TEST(BucketedSketch, AllTime) {
+  BucketedSketch<CountMinSketch> counts(60, seconds(0), CountMinSketch(100, 3));
+  EXPECT_TRUE(counts.isAllTime());
+  EXPECT_EQ(1, counts.numBuckets());
+  counts.add(mkTimePoint(0), 7, 2);
+  counts.add(mkTimePoint(100000), 7, 3);
+  counts.update(mkTimePoint(100000));
+  EXPECT_EQ(5, counts.get().estimate(7));
+}
+
+TEST(BucketedSketch, HeavyHitters) {
+  using TopK = SpaceSaving<std::string>;
+  BucketedSketch<TopK> top(6, seconds(60), TopK(10));
+  top.add(mkTimePoint(0), std::string("old"), 100);
+  for (int now = 50; now < 100; ++now) {
+    top.add(mkTimePoint(now), std::string("a"));
+    top.add(mkTimePoint(now), std::string("b"), 2);
+  }
+  TopK other(10);
+  other.add("c", 1000);
+  EXPECT_TRUE(top.addSketch(mkTimePoint(99), other));
+
+  top.update(mkTimePoint(99));
+  auto window = top.get();
+  auto entries = window.topK(3);
+  ASSERT_EQ(3, entries.size());
+  EXPECT_EQ("c", entries[0].key);
+  EXPECT_EQ("b", entries[1].key);
+  EXPECT_EQ(100, entries[1].count);
+  EXPECT_EQ("a", entries[2].key);
+  EXPECT_EQ(0, window.estimate("old"));
+}
@@ -16,14 +16,19 @@
 
 #include <folly/stats/BucketedTimeSeries.h>
 
+#include <vector>
+
 #include <glog/logging.h>
 
 #include <folly/Benchmark.h>
 #include <folly/stats/BucketedTimeSeries-defs.h>
+#include <folly/stats/ColumnarBucketedTimeSeries-defs.h>
+#include <folly/stats/ColumnarBucketedTimeSeries.h>
 
 using std::chrono::seconds;
 using folly::BenchmarkSuspender;
 using folly::BucketedTimeSeries;
+using folly::ColumnarBucketedTimeSeries;
 
 void addValue(
     unsigned int iters,
@@ -73,6 +78,69 @@ BENCHMARK_NAMED_PARAM(addValue, 100x10_100perSec, seconds(100), 10, 100);
 BENCHMARK_NAMED_PARAM(addValue, 71x5_100perSec, seconds(71), 5, 100);
 BENCHMARK_NAMED_PARAM(addValue, 1x1_100perSec, seconds(1), 1, 100);
 
+BENCHMARK_DRAW_LINE()
+
+template <class TimeSeries>
+TimeSeries makeFullTimeSeries(seconds duration, size_t numBuckets) {
+  TimeSeries ts(numBuckets, duration);
+  typename TimeSeries::TimePoint currentTime(seconds(1342000000));
+  for (int64_t n = 0; n < duration.count(); ++n, currentTime += seconds(1)) {
+    ts.addValue(currentTime, n);
+  }
+  return ts;
+}
+
+// Queries the sums of the ranges [now - length, now) for every length, over
+// a full window
+template <class TimeSeries>
+void rangeSum(unsigned int iters, seconds duration, size_t numBuckets) {
+  BenchmarkSuspender suspend;
+  auto ts = makeFullTimeSeries<TimeSeries>(duration, numBuckets);
+  auto now = ts.getLatestTime() + seconds(1);
+  suspend.dismiss();
+
+  int64_t total = 0;
+  for (unsigned int n = 0; n < iters; ++n) {
+    for (int64_t length = 1; length <= duration.count(); ++length) {
+      total += ts.sum(now - seconds(length), now);
+    }
+  }
+  folly::doNotOptimizeAway(total);
+}
+
+void rangeSumBatch(unsigned int iters, seconds duration, size_t numBuckets) {
+  using TimeSeries = ColumnarBucketedTimeSeries<int64_t>;
+  BenchmarkSuspender suspend;
+  auto ts = makeFullTimeSeries<TimeSeries>(duration, numBuckets);
+  auto now = ts.getLatestTime() + seconds(1);
+  std::vector<TimeSeries::TimeRange> ranges;
+  for (int64_t length = 1; length <= duration.count(); ++length) {
+    ranges.emplace_back(now - seconds(length), now);
+  }
+  std::vector<int64_t> sums(ranges.size());
+  suspend.dismiss();
+
+  for (unsigned int n = 0; n < iters; ++n) {
+    ts.sum(folly::range(ranges), sums.data());
+    folly::doNotOptimizeAway(sums.front());
+  }
+}
+
+void rangeSumBucketed(unsigned int iters, seconds duration, size_t buckets) {
+  rangeSum<BucketedTimeSeries<int64_t>>(iters, duration, buckets);
+}
+
+void rangeSumColumnar(unsigned int iters, seconds duration, size_t buckets) {
+  rangeSum<ColumnarBucketedTimeSeries<int64_t>>(iters, duration, buckets);
+}
+
+BENCHMARK_NAMED_PARAM(rangeSumBucketed, 600x60, seconds(600), 60);
+BENCHMARK_RELATIVE_NAMED_PARAM(rangeSumColumnar, 600x60, seconds(600), 60);
+BENCHMARK_RELATIVE_NAMED_PARAM(rangeSumBatch, 600x60, seconds(600), 60);
+BENCHMARK_NAMED_PARAM(rangeSumBucketed, 3600x600, seconds(3600), 600);
+BENCHMARK_RELATIVE_NAMED_PARAM(rangeSumColumnar, 3600x600, seconds(3600), 600);
+BENCHMARK_RELATIVE_NAMED_PARAM(rangeSumBatch, 3600x600, seconds(3600), 600);
+
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
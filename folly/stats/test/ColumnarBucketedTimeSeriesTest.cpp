@@ -0,0 +1,217 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ColumnarBucketedTimeSeries-defs.h>
+#include <folly/stats/ColumnarBucketedTimeSeries.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <folly/stats/BucketedTimeSeries-defs.h>
+#include <folly/stats/detail/SumColumn.h>
+
+using namespace folly;
+using std::chrono::seconds;
+
+namespace {
+
+using StatsClock = LegacyStatsClock<seconds>;
+using TimePoint = StatsClock::time_point;
+using Columnar = ColumnarBucketedTimeSeries<int64_t>;
+
+TimePoint mkTimePoint(int value) {
+  return TimePoint(StatsClock::duration(value));
+}
+
+// Checks every range query of ts against those of the reference
+void checkRanges(
+    const BucketedTimeSeries<int64_t>& expected,
+    const Columnar& ts,
+    int from,
+    int to) {
+  std::vector<Columnar::TimeRange> ranges;
+  for (int start = from; start <= to; start += 3) {
+    for (int end = start; end <= to; end += 7) {
+      ranges.emplace_back(mkTimePoint(start), mkTimePoint(end));
+    }
+  }
+  std::vector<int64_t> sums(ranges.size());
+  std::vector<uint64_t> counts(ranges.size());
+  std::vector<double> avgs(ranges.size());
+  ts.sum(range(ranges), sums.data());
+  ts.count(range(ranges), counts.data());
+  ts.avg(range(ranges), avgs.data());
+
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto start = ranges[i].first;
+    auto end = ranges[i].second;
+    SCOPED_TRACE(start.time_since_epoch().count());
+    SCOPED_TRACE(end.time_since_epoch().count());
+    if (start <= ts.getLatestTime() + seconds(1)) {
+      EXPECT_EQ(expected.sum(start, end), ts.sum(start, end));
+      EXPECT_EQ(expected.count(start, end), ts.count(start, end));
+      EXPECT_EQ(expected.avg(start, end), ts.avg(start, end));
+      EXPECT_EQ(expected.rate(start, end), ts.rate(start, end));
+      EXPECT_EQ(expected.countRate(start, end), ts.countRate(start, end));
+    } else {
+      // BucketedTimeSeries range adjusts the latest bucket by a negative
+      // amount for ranges after the latest time
+      EXPECT_EQ(0, ts.sum(start, end));
+      EXPECT_EQ(0, ts.count(start, end));
+    }
+    EXPECT_EQ(expected.elapsed(start, end), ts.elapsed(start, end));
+    EXPECT_EQ(ts.sum(start, end), sums[i]);
+    EXPECT_EQ(ts.count(start, end), counts[i]);
+    EXPECT_EQ(ts.avg(start, end), avgs[i]);
+  }
+}
+
+void checkSame(
+    const BucketedTimeSeries<int64_t>& expected,
+    const Columnar& ts) {
+  EXPECT_EQ(expected.empty(), ts.empty());
+  EXPECT_EQ(expected.getLatestTime(), ts.getLatestTime());
+  EXPECT_EQ(expected.getEarliestTime(), ts.getEarliestTime());
+  EXPECT_EQ(expected.elapsed(), ts.elapsed());
+  EXPECT_EQ(expected.sum(), ts.sum());
+  EXPECT_EQ(expected.count(), ts.count());
+  EXPECT_EQ(expected.avg(), ts.avg());
+  EXPECT_EQ(expected.rate(), ts.rate());
+  EXPECT_EQ(expected.countRate(), ts.countRate());
+  ASSERT_EQ(expected.numBuckets(), ts.numBuckets());
+  for (size_t i = 0; i < ts.numBuckets(); ++i) {
+    EXPECT_EQ(expected.getBucketByIndex(i).sum, ts.sums()[i]);
+    EXPECT_EQ(expected.getBucketByIndex(i).count, ts.counts()[i]);
+  }
+}
+
+void checkRandom(size_t numBuckets, int duration) {
+  SCOPED_TRACE(numBuckets);
+  SCOPED_TRACE(duration);
+  BucketedTimeSeries<int64_t> expected(numBuckets, seconds(duration));
+  Columnar ts(numBuckets, seconds(duration));
+  checkSame(expected, ts);
+  checkRanges(expected, ts, 0, 10);
+
+  std::mt19937 rng(duration * 1000 + numBuckets);
+  int now = 1000;
+  for (int step = 0; step < 200; ++step) {
+    now += std::uniform_int_distribution<int>(0, duration / 4 + 2)(rng);
+    int at = now - std::uniform_int_distribution<int>(0, duration + 5)(rng);
+    int64_t value = std::uniform_int_distribution<int64_t>(-100, 1000)(rng);
+    uint64_t times = std::uniform_int_distribution<uint64_t>(1, 3)(rng);
+    EXPECT_EQ(
+        expected.addValue(mkTimePoint(now), value),
+        ts.addValue(mkTimePoint(now), value));
+    EXPECT_EQ(
+        expected.addValue(mkTimePoint(at), value, times),
+        ts.addValue(mkTimePoint(at), value, times));
+    if (step % 20 == 0) {
+      now += std::uniform_int_distribution<int>(0, 2 * duration + 2)(rng);
+      EXPECT_EQ(
+          expected.update(mkTimePoint(now)), ts.update(mkTimePoint(now)));
+      checkSame(expected, ts);
+      checkRanges(expected, ts, now - duration - 5, now + 5);
+    }
+  }
+  checkSame(expected, ts);
+  checkRanges(expected, ts, now - duration - 5, now + 5);
+
+  expected.clear();
+  ts.clear();
+  checkSame(expected, ts);
+  checkRanges(expected, ts, now - duration - 5, now + 5);
+}
+
+} // namespace
+
+TEST(ColumnarBucketedTimeSeries, MatchesBucketedTimeSeries) {
+  checkRandom(60, 60);
+  checkRandom(60, 600);
+  checkRandom(10, 100);
+  checkRandom(5, 71);
+  checkRandom(7, 3);
+  checkRandom(1, 1);
+  checkRandom(1, 10);
+}
+
+TEST(ColumnarBucketedTimeSeries, AllTime) {
+  checkRandom(60, 0);
+
+  Columnar ts(60, seconds(0));
+  EXPECT_TRUE(ts.isAllTime());
+  EXPECT_EQ(0, ts.numBuckets());
+  ts.addValue(mkTimePoint(10), 5);
+  ts.addValue(mkTimePoint(19), 15);
+  EXPECT_EQ(20, ts.sum());
+  EXPECT_EQ(20, ts.sum(mkTimePoint(0), mkTimePoint(100)));
+  EXPECT_EQ(10, ts.sum(mkTimePoint(10), mkTimePoint(15)));
+  EXPECT_EQ(0, ts.sum(mkTimePoint(20), mkTimePoint(100)));
+
+  std::vector<Columnar::TimeRange> ranges{
+      {mkTimePoint(0), mkTimePoint(100)}, {mkTimePoint(10), mkTimePoint(15)}};
+  int64_t sums[2];
+  ts.sum(range(ranges), sums);
+  EXPECT_EQ(20, sums[0]);
+  EXPECT_EQ(10, sums[1]);
+}
+
+TEST(ColumnarBucketedTimeSeries, RangeQueries) {
+  Columnar ts(10, seconds(100));
+  for (int now = 0; now < 250; ++now) {
+    ts.addValue(mkTimePoint(now), now, 2);
+  }
+  // The window is [150, 250): the buckets of [150, 160) ... [240, 250)
+  EXPECT_EQ(2 * 100, ts.count());
+  EXPECT_EQ(0, ts.count(mkTimePoint(0), mkTimePoint(150)));
+  EXPECT_EQ(2 * 20, ts.count(mkTimePoint(200), mkTimePoint(220)));
+  EXPECT_EQ(
+      2 * (200 + 219) * 20 / 2, ts.sum(mkTimePoint(200), mkTimePoint(220)));
+  EXPECT_EQ(209.5, ts.avg(mkTimePoint(200), mkTimePoint(220)));
+  EXPECT_EQ(0, ts.avg(mkTimePoint(0), mkTimePoint(100)));
+  // Partial buckets are adjusted by the part of them within the range
+  EXPECT_EQ(2 * 10, ts.count(mkTimePoint(205), mkTimePoint(215)));
+  EXPECT_EQ(
+      ts.sum(mkTimePoint(200), mkTimePoint(220)) / 2,
+      ts.sum(mkTimePoint(205), mkTimePoint(215)));
+
+  std::vector<Columnar::TimeRange> ranges;
+  for (int start = 150; start < 250; start += 10) {
+    ranges.emplace_back(mkTimePoint(start), mkTimePoint(start + 10));
+  }
+  std::vector<uint64_t> counts(ranges.size());
+  ts.count(range(ranges), counts.data());
+  for (auto count : counts) {
+    EXPECT_EQ(2 * 10, count);
+  }
+}
+
+TEST(ColumnarBucketedTimeSeries, SumColumn) {
+  std::vector<int64_t> ints;
+  std::vector<double> doubles;
+  int64_t expected = 0;
+  for (int i = 0; i < 37; ++i) {
+    EXPECT_EQ(expected, detail::sumColumn(ints.data(), ints.size()));
+    EXPECT_EQ(double(expected), detail::sumColumn(doubles.data(), i));
+    ints.push_back(i * 7 - 100);
+    doubles.push_back(i * 7 - 100);
+    expected += i * 7 - 100;
+  }
+  std::vector<uint64_t> wrapping{~uint64_t(0), 2, ~uint64_t(0), 2, 1};
+  EXPECT_EQ(3, detail::sumColumn(wrapping.data(), wrapping.size()));
+}
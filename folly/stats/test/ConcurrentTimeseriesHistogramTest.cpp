@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ConcurrentTimeseriesHistogram.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <folly/stats/ConcurrentTimeseriesHistogram-defs.h>
+
+using namespace folly;
+using std::chrono::seconds;
+
+namespace {
+
+enum Levels {
+  MINUTE,
+  HOUR,
+  ALLTIME,
+  NUM_LEVELS,
+};
+
+const seconds kDurations[] = {
+    seconds(60),
+    seconds(3600),
+    seconds(0),
+};
+
+using StatsClock = LegacyStatsClock<seconds>;
+
+StatsClock::time_point mkTimePoint(int value) {
+  return StatsClock::time_point(StatsClock::duration(value));
+}
+
+MultiLevelTimeSeries<int64_t> makeLevels() {
+  return MultiLevelTimeSeries<int64_t>(60, NUM_LEVELS, kDurations);
+}
+
+} // namespace
+
+TEST(ConcurrentTimeseriesHistogram, SameAsTimeseriesHistogram) {
+  ConcurrentTimeseriesHistogram<int64_t> concurrent(10, 0, 100, makeLevels());
+  TimeseriesHistogram<int64_t> plain(10, 0, 100, makeLevels());
+  EXPECT_EQ(12, concurrent.getNumBuckets());
+  EXPECT_EQ(NUM_LEVELS, concurrent.getNumLevels());
+  EXPECT_EQ(10, concurrent.getBucketSize());
+  EXPECT_EQ(20, concurrent.getBucketMin(3));
+
+  std::mt19937 random(5);
+  for (int now = 0; now < 120; ++now) {
+    for (int i = 0; i < 100; ++i) {
+      int64_t value = int64_t(random() % 120) - 10;
+      concurrent.addValue(mkTimePoint(now), value);
+      plain.addValue(mkTimePoint(now), value);
+    }
+    // Merge once per second, like a stats exporter would
+    concurrent.update(mkTimePoint(now));
+    plain.update(mkTimePoint(now));
+  }
+
+  for (size_t level = 0; level < NUM_LEVELS; ++level) {
+    EXPECT_EQ(plain.count(level), concurrent.count(level));
+    EXPECT_EQ(plain.sum(level), concurrent.sum(level));
+    EXPECT_EQ(plain.avg(level), concurrent.avg(level));
+    EXPECT_EQ(plain.rate(level), concurrent.rate(level));
+    EXPECT_EQ(plain.getString(level), concurrent.getString(level));
+    for (double pct : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9}) {
+      EXPECT_EQ(
+          plain.getPercentileEstimate(pct, level),
+          concurrent.getPercentileEstimate(pct, level));
+      EXPECT_EQ(
+          plain.getPercentileBucketMin(pct, level),
+          concurrent.getPercentileBucketMin(pct, level));
+    }
+  }
+  EXPECT_EQ(
+      plain.count(mkTimePoint(60), mkTimePoint(90)),
+      concurrent.count(mkTimePoint(60), mkTimePoint(90)));
+  EXPECT_EQ(
+      plain.getPercentileEstimate(50, mkTimePoint(60), mkTimePoint(90)),
+      concurrent.getPercentileEstimate(50, mkTimePoint(60), mkTimePoint(90)));
+}
+
+TEST(ConcurrentTimeseriesHistogram, ManyThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kValuesPerThread = 10000;
+  ConcurrentTimeseriesHistogram<int64_t> h(10, 0, 100, makeLevels());
+
+  std::atomic<bool> done{false};
+  std::thread reader([&] {
+    uint64_t last = 0;
+    while (!done.load()) {
+      // Counts only go up, and percentiles stay within the range
+      auto count = h.count(ALLTIME);
+      EXPECT_LE(last, count);
+      last = count;
+      auto p50 = h.getPercentileEstimate(50, ALLTIME);
+      EXPECT_LE(0, p50);
+      EXPECT_GE(100, p50);
+      std::this_thread::yield();
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&, t] {
+      for (int i = 0; i < kValuesPerThread; ++i) {
+        h.addValue(mkTimePoint(1), (i + t) % 100);
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+  done = true;
+  reader.join();
+
+  // The writers exited, so all of their values are merged
+  h.update(mkTimePoint(1));
+  EXPECT_EQ(kThreads * kValuesPerThread, h.count(ALLTIME));
+  EXPECT_EQ(kThreads * kValuesPerThread, h.count(MINUTE));
+  int64_t expectedSum = 0;
+  for (int t = 0; t < kThreads; ++t) {
+    for (int i = 0; i < kValuesPerThread; ++i) {
+      expectedSum += (i + t) % 100;
+    }
+  }
+  EXPECT_EQ(expectedSum, h.sum(ALLTIME));
+  EXPECT_NEAR(50, h.getPercentileEstimate(50, ALLTIME), 1);
+}
+
+TEST(ConcurrentTimeseriesHistogram, LiveThreads) {
+  ConcurrentTimeseriesHistogram<int64_t> h(10, 0, 100, makeLevels());
+  std::atomic<int> stage{0};
+  std::thread writer([&] {
+    h.addValue(mkTimePoint(0), 5, 10);
+    stage = 1;
+    while (stage.load() != 2) {
+      std::this_thread::yield();
+    }
+    h.addValue(mkTimePoint(1), 95);
+    stage = 3;
+  });
+
+  while (stage.load() != 1) {
+    std::this_thread::yield();
+  }
+  h.update(mkTimePoint(0));
+  EXPECT_EQ(10, h.count(ALLTIME));
+  EXPECT_EQ(50, h.sum(ALLTIME));
+  stage = 2;
+  while (stage.load() != 3) {
+    std::this_thread::yield();
+  }
+  h.update(mkTimePoint(1));
+  // Only what was added since the last query is merged again
+  EXPECT_EQ(11, h.count(ALLTIME));
+  EXPECT_EQ(145, h.sum(ALLTIME));
+  writer.join();
+  EXPECT_EQ(11, h.count(ALLTIME));
+}
+
+TEST(ConcurrentTimeseriesHistogram, SingleUniqueValue) {
+  ConcurrentTimeseriesHistogram<int64_t> h(10, 0, 100, makeLevels());
+  EXPECT_EQ(0, h.getPercentileEstimate(50, ALLTIME));
+
+  std::thread([&] { h.addValue(mkTimePoint(0), 42, 3); }).join();
+  h.addValue(mkTimePoint(0), 42);
+  h.update(mkTimePoint(0));
+  // Exact, rather than interpolated within [40, 50)
+  EXPECT_EQ(42, h.getPercentileEstimate(10, ALLTIME));
+  EXPECT_EQ(42, h.getPercentileEstimate(90, ALLTIME));
+
+  h.addValue(mkTimePoint(0), 43);
+  h.update(mkTimePoint(0));
+  EXPECT_NE(42, h.getPercentileEstimate(99, ALLTIME));
+}
+
+TEST(ConcurrentTimeseriesHistogram, Clear) {
+  ConcurrentTimeseriesHistogram<int64_t> h(10, 0, 100, makeLevels());
+  for (int i = 0; i < 100; ++i) {
+    h.addValue(mkTimePoint(0), i);
+  }
+  h.update(mkTimePoint(0));
+  EXPECT_EQ(100, h.count(ALLTIME));
+  h.addValue(mkTimePoint(0), 7);
+  h.clear();
+  EXPECT_EQ(0, h.count(ALLTIME));
+  EXPECT_EQ(0, h.sum(ALLTIME));
+
+  h.addValue(mkTimePoint(1), 7);
+  h.update(mkTimePoint(1));
+  EXPECT_EQ(1, h.count(ALLTIME));
+  EXPECT_EQ(7, h.sum(ALLTIME));
+  EXPECT_EQ(1, h.snapshot().count(ALLTIME));
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/CountMinSketch.h>
+
+#include <string>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(CountMinSketch, Dimensions) {
+  auto cms = CountMinSketch::withError(0.001, 0.01);
+  EXPECT_EQ(2719, cms.width());
+  EXPECT_EQ(5, cms.depth());
+}
+
+TEST(CountMinSketch, Estimates) {
+  auto cms = CountMinSketch::withError(0.001, 0.01);
+  // Key i is added i times
+  for (int i = 0; i < 1000; ++i) {
+    cms.add(to<std::string>("key", i), i);
+  }
+  EXPECT_EQ(999 * 1000 / 2, cms.totalCount());
+  size_t exact = 0;
+  size_t withinError = 0;
+  for (int i = 0; i < 1000; ++i) {
+    auto estimate = cms.estimate(to<std::string>("key", i));
+    EXPECT_GE(estimate, i);
+    exact += estimate == uint64_t(i);
+    withinError += estimate <= i + 0.001 * cms.totalCount();
+  }
+  EXPECT_GT(exact, 900);
+  // Each estimate is within the error with probability 1 - delta
+  EXPECT_GE(withinError, 970);
+  EXPECT_EQ(0, cms.estimate(std::string("missing")));
+}
+
+TEST(CountMinSketch, Merge) {
+  CountMinSketch a(1000, 4);
+  CountMinSketch b(1000, 4);
+  a.add(1, 10);
+  b.add(1, 5);
+  b.add(2, 7);
+  a.merge(b);
+  EXPECT_EQ(15, a.estimate(1));
+  EXPECT_EQ(7, a.estimate(2));
+  EXPECT_EQ(22, a.totalCount());
+  a.clear();
+  EXPECT_EQ(0, a.estimate(1));
+  EXPECT_EQ(0, a.totalCount());
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/HyperLogLog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(HyperLogLog, Empty) {
+  HyperLogLog hll;
+  EXPECT_EQ(14, hll.precision());
+  EXPECT_TRUE(hll.isSparse());
+  EXPECT_EQ(0, hll.estimate());
+}
+
+TEST(HyperLogLog, SmallCardinalities) {
+  HyperLogLog hll;
+  for (int i = 0; i < 1000; ++i) {
+    hll.add(i % 100);
+  }
+  // Still sparse, and linear counting is nearly exact
+  EXPECT_TRUE(hll.isSparse());
+  EXPECT_NEAR(100, hll.estimate(), 2);
+  EXPECT_LT(hll.memoryUsage(), 1024);
+}
+
+TEST(HyperLogLog, LargeCardinalities) {
+  for (uint8_t precision : {10, 14}) {
+    HyperLogLog hll(precision);
+    double error = 3 * 1.04 / std::sqrt(double(1 << precision));
+    uint64_t n = 0;
+    for (uint64_t target : {1000, 10000, 100000, 1000000}) {
+      for (; n < target; ++n) {
+        hll.add(to<std::string>("key", n));
+      }
+      EXPECT_NEAR(target, hll.estimate(), error * target)
+          << int(precision) << " " << target;
+    }
+    EXPECT_FALSE(hll.isSparse());
+    EXPECT_EQ(size_t(1) << precision, hll.memoryUsage());
+  }
+}
+
+TEST(HyperLogLog, Merge) {
+  // sparse + sparse, sparse + dense, dense + sparse, dense + dense
+  for (int sizeA : {100, 10000}) {
+    for (int sizeB : {100, 10000}) {
+      HyperLogLog a;
+      HyperLogLog b;
+      HyperLogLog all;
+      // Some of the keys of b are also in a
+      int overlap = std::min(sizeA, sizeB) / 2;
+      for (int i = 0; i < sizeA; ++i) {
+        a.add(i);
+        all.add(i);
+      }
+      for (int i = sizeA - overlap; i < sizeA - overlap + sizeB; ++i) {
+        b.add(i);
+        all.add(i);
+      }
+      a.merge(b);
+      // Merging is exact: the registers are the same as if all keys had
+      // been added to a
+      EXPECT_EQ(all.estimate(), a.estimate()) << sizeA << " " << sizeB;
+      int distinct = sizeA + sizeB - overlap;
+      EXPECT_NEAR(distinct, a.estimate(), 0.03 * distinct);
+    }
+  }
+}
+
+TEST(HyperLogLog, Clear) {
+  HyperLogLog hll(10);
+  for (int i = 0; i < 10000; ++i) {
+    hll.addHash(hash::twang_mix64(i));
+  }
+  EXPECT_FALSE(hll.isSparse());
+  hll.clear();
+  EXPECT_TRUE(hll.isSparse());
+  EXPECT_EQ(0, hll.estimate());
+  hll.add(std::string("a"));
+  EXPECT_EQ(1, hll.estimate());
+}
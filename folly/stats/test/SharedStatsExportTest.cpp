@@ -0,0 +1,234 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/SharedStatsExport.h>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <thread>
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/stats/MultiLevelTimeSeries-defs.h>
+#include <folly/stats/TimeseriesHistogram-defs.h>
+
+using namespace folly;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+namespace {
+
+using StatsClock = LegacyStatsClock<seconds>;
+using TimeSeries = MultiLevelTimeSeries<int64_t>;
+
+StatsClock::time_point mkTimePoint(int value) {
+  return StatsClock::time_point(StatsClock::duration(value));
+}
+
+std::string regionPath(const test::TemporaryDirectory& dir) {
+  return (dir.path() / "stats").string();
+}
+
+} // namespace
+
+TEST(SharedStatsExport, TimeSeries) {
+  test::TemporaryDirectory dir;
+  SharedStatsExporter exporter(regionPath(dir), 4, 4096);
+  TimeSeries ts(60, {seconds(60), seconds(3600), seconds(0)});
+  auto handle = exporter.addTimeSeries("requests", ts);
+  ASSERT_TRUE(handle.valid());
+
+  SharedStatsReader reader(regionPath(dir));
+  ASSERT_EQ(1, reader.numEntries());
+  // Nothing published yet
+  auto empty = reader.read(0);
+  ASSERT_TRUE(empty.hasValue());
+  EXPECT_EQ(0, empty->generation);
+  EXPECT_EQ(0, empty->levels[0].count);
+
+  for (int i = 0; i < 100; ++i) {
+    ts.addValue(mkTimePoint(i), 10);
+  }
+  ts.update(mkTimePoint(99));
+  exporter.publish(handle, ts);
+
+  auto snapshot = reader.read(0);
+  ASSERT_TRUE(snapshot.hasValue());
+  EXPECT_EQ("requests", snapshot->name);
+  EXPECT_EQ(SharedStatsSnapshot::Kind::TIMESERIES, snapshot->kind);
+  EXPECT_EQ(1, snapshot->generation);
+  ASSERT_EQ(3, snapshot->levels.size());
+  for (size_t i = 0; i < ts.numLevels(); ++i) {
+    const auto& level = snapshot->levels[i];
+    EXPECT_EQ(ts.getLevel(i).duration(), level.duration);
+    EXPECT_EQ(ts.getLevel(i).elapsed(), level.elapsed);
+    EXPECT_EQ(ts.sum(i), level.sum);
+    EXPECT_EQ(ts.count(i), level.count);
+    EXPECT_DOUBLE_EQ(ts.rate<double>(i), level.rate());
+    EXPECT_DOUBLE_EQ(ts.avg<double>(i), level.avg());
+    EXPECT_TRUE(level.buckets.empty());
+  }
+  EXPECT_EQ(60 * 10, snapshot->levels[0].sum);
+  EXPECT_EQ(nanoseconds(0), snapshot->levels[2].duration);
+}
+
+TEST(SharedStatsExport, Histogram) {
+  test::TemporaryDirectory dir;
+  SharedStatsExporter exporter(regionPath(dir), 4, 4096);
+  TimeseriesHistogram<int64_t> hist(
+      10, 0, 100, TimeSeries(60, {seconds(60), seconds(0)}));
+  auto handle = exporter.addHistogram("latency", hist);
+
+  for (int i = 0; i < 120; ++i) {
+    hist.addValue(mkTimePoint(i), i);
+  }
+  hist.update(mkTimePoint(119));
+  exporter.publish(handle, hist);
+
+  SharedStatsReader reader(regionPath(dir));
+  auto snapshot = reader.read(0);
+  ASSERT_TRUE(snapshot.hasValue());
+  EXPECT_EQ(SharedStatsSnapshot::Kind::HISTOGRAM, snapshot->kind);
+  EXPECT_EQ(10, snapshot->bucketSize);
+  EXPECT_EQ(0, snapshot->min);
+  EXPECT_EQ(100, snapshot->max);
+  ASSERT_EQ(2, snapshot->levels.size());
+  for (size_t i = 0; i < hist.getNumLevels(); ++i) {
+    const auto& level = snapshot->levels[i];
+    EXPECT_EQ(hist.sum(i), level.sum);
+    EXPECT_EQ(hist.count(i), level.count);
+    EXPECT_DOUBLE_EQ(hist.rate<double>(i), level.rate());
+    ASSERT_EQ(hist.getNumBuckets(), level.buckets.size());
+    for (size_t b = 0; b < hist.getNumBuckets(); ++b) {
+      EXPECT_EQ(hist.getBucket(b).count(i), level.buckets[b].count);
+      EXPECT_EQ(hist.getBucket(b).sum(i), level.buckets[b].sum);
+    }
+  }
+  // All-time: 10 values in each of the 10 buckets, 20 over
+  EXPECT_EQ(120, snapshot->levels[1].count);
+  EXPECT_EQ(0, snapshot->levels[1].buckets.front().count);
+  EXPECT_EQ(20, snapshot->levels[1].buckets.back().count);
+}
+
+TEST(SharedStatsExport, Registration) {
+  test::TemporaryDirectory dir;
+  SharedStatsExporter exporter(regionPath(dir), 2, 256);
+  TimeSeries ts(60, {seconds(60)});
+  EXPECT_THROW(
+      exporter.addTimeSeries(
+          std::string(detail::SharedStatsEntry::kMaxNameLength + 1, 'x'), ts),
+      std::invalid_argument);
+  exporter.addTimeSeries(
+      std::string(detail::SharedStatsEntry::kMaxNameLength, 'x'), ts);
+  exporter.addTimeSeries("b", ts);
+  // Out of entries
+  EXPECT_THROW(exporter.addTimeSeries("c", ts), std::length_error);
+  EXPECT_EQ(2, exporter.numEntries());
+
+  // Out of data: 40 bytes per series, rounded up to 64
+  SharedStatsExporter small(regionPath(dir) + "2", 8, 256);
+  for (int i = 0; i < 4; ++i) {
+    small.addTimeSeries(to<std::string>("s", i), ts);
+  }
+  EXPECT_THROW(small.addTimeSeries("s4", ts), std::length_error);
+
+  SharedStatsReader reader(regionPath(dir));
+  EXPECT_EQ(2, reader.numEntries());
+  EXPECT_EQ(1, reader.find("b"));
+  EXPECT_EQ(-1, reader.find("c"));
+  EXPECT_EQ(
+      std::string(detail::SharedStatsEntry::kMaxNameLength, 'x'),
+      reader.read(0)->name);
+  EXPECT_THROW(reader.read(2), std::out_of_range);
+}
+
+TEST(SharedStatsExport, NotARegion) {
+  test::TemporaryDirectory dir;
+  auto path = regionPath(dir);
+  writeFile(std::string(4096, 'x'), path.c_str());
+  EXPECT_THROW(SharedStatsReader{path}, std::runtime_error);
+}
+
+TEST(SharedStatsExport, Restart) {
+  test::TemporaryDirectory dir;
+  TimeSeries ts(60, {seconds(60)});
+  ts.addValue(mkTimePoint(0), 5);
+  ts.update(mkTimePoint(0));
+  auto exporter = std::make_unique<SharedStatsExporter>(regionPath(dir), 1, 64);
+  exporter->publish(exporter->addTimeSeries("old", ts), ts);
+  SharedStatsReader oldReader(regionPath(dir));
+
+  // Too many entries: the region in place is left alone
+  EXPECT_THROW(
+      SharedStatsExporter(
+          regionPath(dir), size_t(std::numeric_limits<uint32_t>::max()) + 1, 0),
+      std::invalid_argument);
+  EXPECT_EQ("old", SharedStatsReader(regionPath(dir)).read(0)->name);
+
+  // A new exporter replaces the file; readers of the old one keep it
+  exporter.reset();
+  SharedStatsExporter newExporter(regionPath(dir), 1, 64);
+  newExporter.addTimeSeries("new", ts);
+  auto snapshot = oldReader.read(0);
+  ASSERT_TRUE(snapshot.hasValue());
+  EXPECT_EQ("old", snapshot->name);
+  EXPECT_EQ(5, snapshot->levels[0].sum);
+  EXPECT_EQ("new", SharedStatsReader(regionPath(dir)).read(0)->name);
+  // No temporary files are left behind
+  EXPECT_EQ(
+      1,
+      std::distance(
+          boost::filesystem::directory_iterator(dir.path()),
+          boost::filesystem::directory_iterator()));
+}
+
+TEST(SharedStatsExport, ConcurrentPublish) {
+  test::TemporaryDirectory dir;
+  SharedStatsExporter exporter(regionPath(dir), 1, 4096);
+  TimeSeries ts(60, {seconds(60), seconds(0)});
+  auto handle = exporter.addTimeSeries("concurrent", ts);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i < 20000; ++i) {
+      ts.addValue(mkTimePoint(i / 100), 7);
+      ts.update(mkTimePoint(i / 100));
+      exporter.publish(handle, ts);
+    }
+    done = true;
+  });
+
+  // Every snapshot is that of one publish: each value added is 7
+  SharedStatsReader reader(regionPath(dir));
+  size_t consistent = 0;
+  uint64_t generation = 0;
+  while (!done) {
+    auto snapshot = reader.read(0, 1000000);
+    ASSERT_TRUE(snapshot.hasValue());
+    EXPECT_GE(snapshot->generation, generation);
+    generation = snapshot->generation;
+    for (const auto& level : snapshot->levels) {
+      EXPECT_EQ(7 * level.count, level.sum);
+    }
+    EXPECT_EQ(snapshot->generation, snapshot->levels[1].count);
+    ++consistent;
+  }
+  writer.join();
+  EXPECT_GT(consistent, 0);
+  EXPECT_EQ(20000, reader.read(0)->generation);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/SpaceSaving.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(SpaceSaving, Exact) {
+  SpaceSaving<std::string> ss(10);
+  ss.add("a", 5);
+  ss.add("b");
+  ss.add("a");
+  ss.add("c", 3);
+  EXPECT_EQ(3, ss.size());
+  EXPECT_EQ(10, ss.totalCount());
+  EXPECT_EQ(6, ss.estimate("a"));
+  EXPECT_EQ(0, ss.estimate("d"));
+
+  auto top = ss.topK(2);
+  ASSERT_EQ(2, top.size());
+  EXPECT_EQ("a", top[0].key);
+  EXPECT_EQ(6, top[0].count);
+  EXPECT_EQ(0, top[0].error);
+  EXPECT_EQ("c", top[1].key);
+  EXPECT_EQ(3, ss.topK(100).size());
+}
+
+TEST(SpaceSaving, HeavyHitters) {
+  // Zipf-like: key k is added about 1 / (k + 1) as often as key 0
+  std::mt19937 random(3);
+  std::uniform_real_distribution<double> dist(0, 1);
+  SpaceSaving<int> ss(100);
+  std::unordered_map<int, uint64_t> exact;
+  for (int i = 0; i < 100000; ++i) {
+    int key = int(std::exp(dist(random) * std::log(10000.0))) - 1;
+    ss.add(key);
+    ++exact[key];
+  }
+  EXPECT_EQ(100, ss.size());
+
+  auto top = ss.topK(10);
+  ASSERT_EQ(10, top.size());
+  for (size_t i = 0; i < top.size(); ++i) {
+    const auto& entry = top[i];
+    // The heaviest keys are found, with bounded counts
+    EXPECT_EQ(int(i), entry.key);
+    EXPECT_GE(entry.count, exact[entry.key]);
+    EXPECT_LE(entry.count - entry.error, exact[entry.key]);
+    EXPECT_LE(entry.error, ss.totalCount() / ss.capacity());
+  }
+}
+
+TEST(SpaceSaving, Merge) {
+  SpaceSaving<int> a(3);
+  SpaceSaving<int> b(3);
+  for (int i = 0; i < 10; ++i) {
+    a.add(1);
+    b.add(1);
+    b.add(2);
+  }
+  a.add(3, 4);
+  b.add(4, 2);
+  a.merge(b);
+  EXPECT_EQ(36, a.totalCount());
+  auto top = a.topK(3);
+  ASSERT_EQ(3, top.size());
+  EXPECT_EQ(1, top[0].key);
+  EXPECT_EQ(20, top[0].count);
+  EXPECT_EQ(2, top[1].key);
+  EXPECT_EQ(10, top[1].count);
+  // b is full, so 3 may have been added to it as many times as its lowest
+  // count
+  EXPECT_EQ(3, top[2].key);
+  EXPECT_EQ(6, top[2].count);
+  EXPECT_EQ(2, top[2].error);
+
+  SpaceSaving<int> c(3);
+  SpaceSaving<int> d(3);
+  c.add(1, 10);
+  c.add(2, 5);
+  c.add(5, 9);
+  d.add(1, 10);
+  d.add(3, 8);
+  d.add(6, 7);
+  c.merge(d);
+  EXPECT_EQ(3, c.size());
+  top = c.topK(3);
+  EXPECT_EQ(1, top[0].key);
+  EXPECT_EQ(20, top[0].count);
+  EXPECT_EQ(0, top[0].error);
+  EXPECT_EQ(5, top[1].key);
+  EXPECT_EQ(16, top[1].count);
+  EXPECT_EQ(7, top[1].error);
+  EXPECT_EQ(3, top[2].key);
+  EXPECT_EQ(13, top[2].count);
+  EXPECT_EQ(5, top[2].error);
+
+  c.clear();
+  EXPECT_EQ(0, c.size());
+  EXPECT_EQ(0, c.totalCount());
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/stats/TDigest.h>
+
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+using folly::TDigest;
+using folly::TDigestBuilder;
+
+void addValue(unsigned int n, size_t bufferSize) {
+  TDigestBuilder builder(bufferSize, 100);
+  std::mt19937 random(1);
+  std::lognormal_distribution<double> dist(3.0, 2.5);
+  for (unsigned int i = 0; i < n; ++i) {
+    builder.add(dist(random));
+  }
+  folly::doNotOptimizeAway(builder.build().count());
+}
+
+BENCHMARK_NAMED_PARAM(addValue, buffer_100, 100);
+BENCHMARK_NAMED_PARAM(addValue, buffer_1000, 1000);
+BENCHMARK_NAMED_PARAM(addValue, buffer_10000, 10000);
+
+BENCHMARK_DRAW_LINE();
+
+// Fans in numDigests digests of 1000 values each, n times
+void mergeDigests(unsigned int n, size_t numDigests) {
+  std::vector<TDigest> digests;
+  BENCHMARK_SUSPEND {
+    std::mt19937 random(1);
+    std::lognormal_distribution<double> dist(3.0, 2.5);
+    for (size_t d = 0; d < numDigests; ++d) {
+      std::vector<double> values;
+      for (int i = 0; i < 1000; ++i) {
+        values.push_back(dist(random));
+      }
+      digests.push_back(TDigest(100).merge(folly::range(values)));
+    }
+  }
+  for (unsigned int i = 0; i < n; ++i) {
+    folly::doNotOptimizeAway(
+        TDigest::merge(folly::range(digests)).estimateQuantile(0.99));
+  }
+}
+
+BENCHMARK_NAMED_PARAM(mergeDigests, 10, 10);
+BENCHMARK_NAMED_PARAM(mergeDigests, 100, 100);
+BENCHMARK_NAMED_PARAM(mergeDigests, 1000, 1000);
+BENCHMARK_NAMED_PARAM(mergeDigests, 10000, 10000);
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/TDigest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <folly/stats/MultiLevelTDigest-defs.h>
+#include <folly/stats/MultiLevelTDigest.h>
+
+using namespace folly;
+using std::chrono::seconds;
+
+namespace {
+
+std::vector<double> iota(int begin, int end) {
+  std::vector<double> values;
+  for (int i = begin; i < end; ++i) {
+    values.push_back(i);
+  }
+  return values;
+}
+
+double exactQuantile(std::vector<double> values, double q) {
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, size_t(q * values.size()))];
+}
+
+} // namespace
+
+TEST(TDigest, Basic) {
+  TDigest digest(100);
+  EXPECT_TRUE(digest.empty());
+  EXPECT_EQ(0, digest.estimateQuantile(0.5));
+
+  auto values = iota(1, 101);
+  digest = digest.mergeSorted(range(values));
+  EXPECT_FALSE(digest.empty());
+  EXPECT_EQ(100, digest.count());
+  EXPECT_EQ(5050, digest.sum());
+  EXPECT_EQ(50.5, digest.mean());
+  EXPECT_EQ(1, digest.min());
+  EXPECT_EQ(100, digest.max());
+  EXPECT_LE(digest.getCentroids().size(), 101);
+
+  EXPECT_EQ(1, digest.estimateQuantile(0.0));
+  EXPECT_NEAR(1.5, digest.estimateQuantile(0.01), 0.5);
+  EXPECT_NEAR(50.5, digest.estimateQuantile(0.5), 0.5);
+  EXPECT_NEAR(99.5, digest.estimateQuantile(0.99), 0.5);
+  EXPECT_EQ(100, digest.estimateQuantile(1.0));
+}
+
+TEST(TDigest, Unsorted) {
+  std::vector<double> values = {5, 3, 9, 1, 7};
+  auto digest = TDigest().merge(range(values));
+  EXPECT_EQ(5, digest.count());
+  EXPECT_EQ(1, digest.min());
+  EXPECT_EQ(9, digest.max());
+  EXPECT_EQ(5, digest.estimateQuantile(0.5));
+}
+
+TEST(TDigest, TailAccuracy) {
+  // Latencies spanning 5 orders of magnitude
+  std::mt19937 random(7);
+  std::lognormal_distribution<double> dist(3.0, 2.5);
+  std::vector<double> values;
+  TDigestBuilder builder;
+  for (int i = 0; i < 100000; ++i) {
+    double value = dist(random);
+    values.push_back(value);
+    builder.add(value);
+  }
+  const auto& digest = builder.build();
+  EXPECT_EQ(100000, digest.count());
+  EXPECT_LE(digest.getCentroids().size(), 101);
+  std::sort(values.begin(), values.end());
+  for (double q : {0.001, 0.01, 0.5, 0.9, 0.99, 0.999}) {
+    // The error in rank, which is smaller towards the tails
+    double estimate = digest.estimateQuantile(q);
+    double rank =
+        double(std::lower_bound(values.begin(), values.end(), estimate) -
+               values.begin()) /
+        values.size();
+    EXPECT_NEAR(q, rank, std::max(0.0005, 0.1 * std::min(q, 1 - q))) << q;
+  }
+}
+
+TEST(TDigest, MergeDigests) {
+  std::mt19937 random(11);
+  std::uniform_real_distribution<double> dist(0, 1000);
+  std::vector<double> all;
+  std::vector<TDigest> digests;
+  for (int d = 0; d < 100; ++d) {
+    std::vector<double> values;
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back(dist(random));
+    }
+    all.insert(all.end(), values.begin(), values.end());
+    digests.push_back(TDigest(100).merge(range(values)));
+  }
+  digests.emplace_back(100); // Empty digests are skipped
+
+  auto merged = TDigest::merge(range(digests));
+  EXPECT_EQ(100000, merged.count());
+  EXPECT_EQ(*std::min_element(all.begin(), all.end()), merged.min());
+  EXPECT_EQ(*std::max_element(all.begin(), all.end()), merged.max());
+  EXPECT_LE(merged.getCentroids().size(), 101);
+  double sum = 0;
+  for (double value : all) {
+    sum += value;
+  }
+  EXPECT_NEAR(sum, merged.sum(), 1e-6 * sum);
+  for (double q : {0.01, 0.1, 0.5, 0.9, 0.99}) {
+    EXPECT_NEAR(exactQuantile(all, q), merged.estimateQuantile(q), 5) << q;
+  }
+
+  // Merging a digest with values is the same as merging two digests
+  auto values = iota(0, 1000);
+  auto left = digests[0].mergeSorted(range(values));
+  const TDigest pair[] = {digests[0], TDigest(100).mergeSorted(range(values))};
+  auto right = TDigest::merge(range(pair));
+  EXPECT_EQ(left.count(), right.count());
+  EXPECT_NEAR(left.estimateQuantile(0.5), right.estimateQuantile(0.5), 5);
+
+  EXPECT_TRUE(TDigest::merge(Range<const TDigest*>()).empty());
+}
+
+TEST(TDigest, Serialize) {
+  auto values = iota(0, 10000);
+  auto digest = TDigest(100).mergeSorted(range(values));
+  auto data = digest.serialize();
+  EXPECT_LT(data.size(), 1100);
+
+  auto copy = TDigest::deserialize(ByteRange(StringPiece(data)));
+  EXPECT_EQ(digest.maxSize(), copy.maxSize());
+  EXPECT_EQ(digest.count(), copy.count());
+  EXPECT_EQ(digest.sum(), copy.sum());
+  EXPECT_EQ(digest.min(), copy.min());
+  EXPECT_EQ(digest.max(), copy.max());
+  ASSERT_EQ(digest.getCentroids().size(), copy.getCentroids().size());
+  for (double q : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+    EXPECT_EQ(digest.estimateQuantile(q), copy.estimateQuantile(q));
+  }
+
+  auto empty = TDigest(50).serialize();
+  EXPECT_EQ(3, empty.size());
+  EXPECT_TRUE(TDigest::deserialize(ByteRange(StringPiece(empty))).empty());
+  EXPECT_EQ(
+      50, TDigest::deserialize(ByteRange(StringPiece(empty))).maxSize());
+
+  // Truncated, trailing data, unknown version
+  for (size_t size = 0; size < data.size(); size += 7) {
+    EXPECT_THROW(
+        TDigest::deserialize(ByteRange(StringPiece(data.data(), size))),
+        std::invalid_argument);
+  }
+  EXPECT_THROW(
+      TDigest::deserialize(ByteRange(StringPiece(data + "x"))),
+      std::invalid_argument);
+  data[0] = 2;
+  EXPECT_THROW(
+      TDigest::deserialize(ByteRange(StringPiece(data))),
+      std::invalid_argument);
+}
+
+TEST(TDigestBuilder, AddDigest) {
+  TDigestBuilder builder(10, 100);
+  for (int i = 0; i < 25; ++i) {
+    builder.add(i);
+  }
+  auto values = iota(25, 50);
+  builder.add(TDigest(100).mergeSorted(range(values)));
+  EXPECT_EQ(50, builder.build().count());
+  EXPECT_EQ(0, builder.build().min());
+  EXPECT_EQ(49, builder.build().max());
+  builder.clear();
+  EXPECT_TRUE(builder.build().empty());
+}
+
+namespace {
+
+using StatsClock = LegacyStatsClock<seconds>;
+
+StatsClock::time_point mkTimePoint(int value) {
+  return StatsClock::time_point(StatsClock::duration(value));
+}
+
+} // namespace
+
+TEST(MultiLevelTDigest, Windows) {
+  MultiLevelTDigest<> mld(60, {seconds(60), seconds(3600), seconds(0)});
+  EXPECT_EQ(60, mld.numBuckets());
+  EXPECT_EQ(3, mld.numLevels());
+  EXPECT_EQ(seconds(3600), mld.getLevelDuration(1));
+  EXPECT_TRUE(mld.getDigest(0).empty());
+
+  // One value per second, equal to the second
+  for (int now = 0; now < 7200; ++now) {
+    mld.addValue(mkTimePoint(now), now);
+  }
+  mld.update(mkTimePoint(7199));
+  EXPECT_EQ(60, mld.getDigest(0).count());
+  EXPECT_EQ(7140, mld.getDigest(0).min());
+  EXPECT_EQ(3600, mld.getDigest(seconds(3600)).count());
+  EXPECT_EQ(3600, mld.getDigest(1).min());
+  EXPECT_EQ(7200, mld.getDigest(2).count());
+  EXPECT_NEAR(7169.5, mld.estimateQuantile(0.5, 0), 1);
+  EXPECT_NEAR(3600, mld.estimateQuantile(0.5, seconds(0)), 10);
+
+  // Old values only go into the levels that still cover them
+  mld.addValue(mkTimePoint(7000), -1);
+  mld.update(mkTimePoint(7199));
+  EXPECT_EQ(60, mld.getDigest(0).count());
+  EXPECT_EQ(3601, mld.getDigest(1).count());
+  EXPECT_EQ(-1, mld.getDigest(2).min());
+
+  // Time passing expires the values
+  mld.update(mkTimePoint(7229));
+  EXPECT_EQ(30, mld.getDigest(0).count());
+  mld.update(mkTimePoint(20000));
+  EXPECT_TRUE(mld.getDigest(0).empty());
+  EXPECT_TRUE(mld.getDigest(1).empty());
+  EXPECT_EQ(7201, mld.getDigest(2).count());
+
+  mld.clear();
+  mld.update(mkTimePoint(20000));
+  EXPECT_TRUE(mld.getDigest(2).empty());
+}
+
+TEST(MultiLevelTDigest, AddDigest) {
+  const seconds durations[] = {seconds(10), seconds(0)};
+  MultiLevelTDigest<> mld(10, 2, durations, 100, 16);
+  auto values = iota(0, 1000);
+  auto digest = TDigest(100).mergeSorted(range(values));
+  mld.addDigest(mkTimePoint(0), digest);
+  for (int i = 0; i < 100; ++i) {
+    // More than the buffer size at the same time
+    mld.addValue(mkTimePoint(5), 1000 + i);
+  }
+  mld.update(mkTimePoint(5));
+  EXPECT_EQ(1100, mld.getDigest(0).count());
+  EXPECT_EQ(1099, mld.getDigest(0).max());
+  mld.update(mkTimePoint(12));
+  EXPECT_EQ(100, mld.getDigest(0).count());
+  EXPECT_EQ(1100, mld.getDigest(1).count());
+}
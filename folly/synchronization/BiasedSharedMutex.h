@@ -0,0 +1,307 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <folly/CachelinePadded.h>
+#include <folly/SharedMutex.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/portability/Asm.h>
+#include <folly/synchronization/AsymmetricMemoryBarrier.h>
+
+namespace folly {
+
+/// BiasedSharedMutex wraps a reader-writer lock (SharedMutex by default)
+/// for read-mostly data on machines with many cores, where every reader
+/// still writes to the lock word or to one of a few shared deferred
+/// reader slots, and those cache lines bounce between sockets.
+///
+/// While the lock is read-biased, a reader with a Token only increments
+/// a counter in a cache line that belongs to this instance and its CPU,
+/// and never touches the underlying mutex.  That's a relaxed increment
+/// and a compiler-only fence; the other half of the fence is paid by
+/// writers (asymmetricHeavyBarrier), which is the right trade when writes
+/// are rare.
+///
+/// A writer takes the underlying mutex, revokes the bias, and then waits
+/// for the per-CPU counters to drain.  Revoking is expensive (the heavy
+/// barrier is an IPI to every CPU), so after one the lock stays unbiased,
+/// with readers going through the underlying mutex, for kInhibitMultiplier
+/// times as long as the revocation took.  The first reader after that
+/// re-enables the bias.  A lock that is written often therefore settles
+/// into behaving like the underlying mutex, plus a load of the bias flag.
+///
+/// Each instance allocates one cache line per CPU, so this is for a few
+/// hot locks, not for every object:
+///
+///   folly::BiasedSharedMutex mutex;
+///
+///   folly::BiasedSharedMutex::Token token;
+///   mutex.lock_shared(token);
+///   auto v = map.find(k);
+///   mutex.unlock_shared(token);
+///
+///   folly::BiasedSharedMutex::WriteHolder guard(mutex);
+///   map[k] = v;
+///
+/// The tokenless lock_shared()/unlock_shared() (and so std::shared_lock)
+/// always go through the underlying mutex.
+template <
+    typename Mutex = SharedMutex,
+    template <typename> class Atom = std::atomic>
+class BiasedSharedMutex {
+ public:
+  /// The revocation backoff, as a multiple of the revocation time.
+  static constexpr uint64_t kInhibitMultiplier = 9;
+
+  /// Records how a shared lock was taken, for the matching unlock_shared.
+  class Token {
+   public:
+    Token() = default;
+
+    bool isFast() const {
+      return slot_ != kSlow;
+    }
+
+   private:
+    friend class BiasedSharedMutex;
+
+    static constexpr uint32_t kSlow = ~uint32_t(0);
+    uint32_t slot_{kSlow};
+  };
+
+  explicit BiasedSharedMutex(bool biased = true)
+      : numSlots_(CacheLocality::system<Atom>().numCpus),
+        slots_(new CachelinePadded<Atom<int64_t>>[numSlots_]) {
+    for (size_t i = 0; i < numSlots_; ++i) {
+      slots_[i]->store(0, std::memory_order_relaxed);
+    }
+    rbias_.store(biased, std::memory_order_relaxed);
+  }
+
+  BiasedSharedMutex(const BiasedSharedMutex&) = delete;
+  BiasedSharedMutex& operator=(const BiasedSharedMutex&) = delete;
+
+  void lock() {
+    mutex_.lock();
+    revokeBias();
+  }
+
+  bool try_lock() {
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+    if (!rbias_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    rbias_.store(false, std::memory_order_relaxed);
+    asymmetricHeavyBarrier();
+    if (fastReaders() == 0) {
+      return true;
+    }
+    // Readers are still in, so try_lock fails; leave the bias off (there's
+    // a writer around) without starting the backoff, which the next
+    // reader will restore.
+    mutex_.unlock();
+    return false;
+  }
+
+  void unlock() {
+    mutex_.unlock();
+  }
+
+  void lock_shared(Token& token) {
+    if (tryFastLockShared(token)) {
+      return;
+    }
+    mutex_.lock_shared();
+    maybeRestoreBias();
+  }
+
+  bool try_lock_shared(Token& token) {
+    if (tryFastLockShared(token)) {
+      return true;
+    }
+    if (!mutex_.try_lock_shared()) {
+      return false;
+    }
+    maybeRestoreBias();
+    return true;
+  }
+
+  void unlock_shared(Token& token) {
+    if (token.isFast()) {
+      slots_[token.slot_]->fetch_sub(1, std::memory_order_release);
+      token.slot_ = Token::kSlow;
+    } else {
+      mutex_.unlock_shared();
+    }
+  }
+
+  void lock_shared() {
+    mutex_.lock_shared();
+    maybeRestoreBias();
+  }
+
+  bool try_lock_shared() {
+    if (!mutex_.try_lock_shared()) {
+      return false;
+    }
+    maybeRestoreBias();
+    return true;
+  }
+
+  void unlock_shared() {
+    mutex_.unlock_shared();
+  }
+
+  /// True if readers with a Token currently bypass the underlying mutex.
+  bool isBiased() const {
+    return rbias_.load(std::memory_order_acquire);
+  }
+
+  class ReadHolder {
+   public:
+    explicit ReadHolder(BiasedSharedMutex& lock) : lock_(&lock) {
+      lock_->lock_shared(token_);
+    }
+
+    ReadHolder(ReadHolder&& rhs) noexcept
+        : lock_(rhs.lock_), token_(rhs.token_) {
+      rhs.lock_ = nullptr;
+    }
+
+    ReadHolder(const ReadHolder&) = delete;
+    ReadHolder& operator=(const ReadHolder&) = delete;
+    ReadHolder& operator=(ReadHolder&&) = delete;
+
+    ~ReadHolder() {
+      if (lock_) {
+        lock_->unlock_shared(token_);
+      }
+    }
+
+   private:
+    BiasedSharedMutex* lock_;
+    Token token_;
+  };
+
+  class WriteHolder {
+   public:
+    explicit WriteHolder(BiasedSharedMutex& lock) : lock_(&lock) {
+      lock_->lock();
+    }
+
+    WriteHolder(WriteHolder&& rhs) noexcept : lock_(rhs.lock_) {
+      rhs.lock_ = nullptr;
+    }
+
+    WriteHolder(const WriteHolder&) = delete;
+    WriteHolder& operator=(const WriteHolder&) = delete;
+    WriteHolder& operator=(WriteHolder&&) = delete;
+
+    ~WriteHolder() {
+      if (lock_) {
+        lock_->unlock();
+      }
+    }
+
+   private:
+    BiasedSharedMutex* lock_;
+  };
+
+ private:
+  static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  bool tryFastLockShared(Token& token) {
+    if (!rbias_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    auto slot = AccessSpreader<Atom>::current(numSlots_);
+    slots_[slot]->fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the heavy barrier in revokeBias: either the writer sees
+    // our increment, or we see that the bias has been revoked.
+    asymmetricLightBarrier();
+    if (rbias_.load(std::memory_order_relaxed)) {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      token.slot_ = static_cast<uint32_t>(slot);
+      return true;
+    }
+    slots_[slot]->fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Called with the underlying mutex held shared, so no writer can be
+  // revoking concurrently; a writer that comes next revokes this again.
+  void maybeRestoreBias() {
+    if (!rbias_.load(std::memory_order_relaxed) &&
+        nowNs() >= inhibitUntil_.load(std::memory_order_relaxed)) {
+      rbias_.store(true, std::memory_order_release);
+    }
+  }
+
+  int64_t fastReaders() const {
+    int64_t n = 0;
+    for (size_t i = 0; i < numSlots_; ++i) {
+      n += slots_[i]->load(std::memory_order_acquire);
+    }
+    return n;
+  }
+
+  // Called with the underlying mutex held exclusive.
+  void revokeBias() {
+    if (!rbias_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto start = nowNs();
+    rbias_.store(false, std::memory_order_relaxed);
+    asymmetricHeavyBarrier();
+    for (int spins = 0; fastReaders() != 0; ++spins) {
+      if (spins < 1000) {
+        asm_volatile_pause();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    auto end = nowNs();
+    inhibitUntil_.store(
+        end + (end - start) * kInhibitMultiplier, std::memory_order_relaxed);
+  }
+
+  Atom<bool> rbias_{false};
+  Atom<uint64_t> inhibitUntil_{0};
+  const size_t numSlots_;
+  std::unique_ptr<CachelinePadded<Atom<int64_t>>[]> slots_;
+  Mutex mutex_;
+};
+
+template <typename Mutex, template <typename> class Atom>
+constexpr uint64_t BiasedSharedMutex<Mutex, Atom>::kInhibitMultiplier;
+
+template <typename Mutex, template <typename> class Atom>
+constexpr uint32_t BiasedSharedMutex<Mutex, Atom>::Token::kSlow;
+
+} // namespace folly
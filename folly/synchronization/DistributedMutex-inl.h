@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <thread>
+#include <utility>
+
+#include <folly/Try.h>
+#include <folly/portability/Asm.h>
+
+namespace folly {
+
+template <template <typename> class Atom>
+constexpr std::uintptr_t DistributedMutexImpl<Atom>::kUnlocked;
+template <template <typename> class Atom>
+constexpr std::uintptr_t DistributedMutexImpl<Atom>::kLocked;
+template <template <typename> class Atom>
+constexpr int DistributedMutexImpl<Atom>::kMaxCombined;
+template <template <typename> class Atom>
+constexpr int DistributedMutexImpl<Atom>::kMaxSpins;
+
+// A thread waiting for the lock, on that thread's stack.  Waiters form a
+// stack themselves: state_ points to the newest, next to the one before.
+template <template <typename> class Atom>
+struct DistributedMutexImpl<Atom>::Waiter {
+  Waiter(void (*t)(void*), void* c) : futex(kWaiting), task(t), context(c) {}
+
+  detail::Futex<Atom> futex;
+  // The value of state_ that this waiter replaced: kLocked, or the
+  // previous waiter
+  std::uintptr_t next{kLocked};
+  // The critical section of lock_combine(), if any
+  void (*task)(void*);
+  void* context;
+};
+
+template <template <typename> class Atom>
+typename DistributedMutexImpl<Atom>::Proxy DistributedMutexImpl<Atom>::lock() {
+  auto state = kUnlocked;
+  if (state_.compare_exchange_strong(
+          state, kLocked, std::memory_order_acquire,
+          std::memory_order_relaxed)) {
+    return Proxy(nullptr, true);
+  }
+  Waiter waiter(nullptr, nullptr);
+  return lockSlow(waiter);
+}
+
+template <template <typename> class Atom>
+typename DistributedMutexImpl<Atom>::Proxy
+DistributedMutexImpl<Atom>::try_lock() {
+  auto state = kUnlocked;
+  return Proxy(
+      nullptr,
+      state_.compare_exchange_strong(
+          state, kLocked, std::memory_order_acquire,
+          std::memory_order_relaxed));
+}
+
+template <template <typename> class Atom>
+typename DistributedMutexImpl<Atom>::Proxy
+DistributedMutexImpl<Atom>::lockSlow(Waiter& waiter) {
+  auto state = state_.load(std::memory_order_relaxed);
+  while (true) {
+    if (state == kUnlocked) {
+      if (state_.compare_exchange_weak(
+              state, kLocked, std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return Proxy(nullptr, true);
+      }
+      continue;
+    }
+    waiter.next = state;
+    if (state_.compare_exchange_weak(
+            state, reinterpret_cast<std::uintptr_t>(&waiter),
+            std::memory_order_release, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  if (wait(waiter) == kCombined) {
+    return Proxy(nullptr, false);
+  }
+  // We're serving the rest of our batch
+  return Proxy(
+      waiter.next == kLocked ? nullptr
+                             : reinterpret_cast<Waiter*>(waiter.next),
+      true);
+}
+
+template <template <typename> class Atom>
+uint32_t DistributedMutexImpl<Atom>::wait(Waiter& waiter) {
+  // Critical sections are meant to be short, so spin first; only this
+  // thread reads the cache line it spins on, until the holder writes it.
+  // With a single CPU spinning only delays the holder.
+  static const int maxSpins =
+      std::thread::hardware_concurrency() > 1 ? kMaxSpins : 0;
+  for (int i = 0; i < maxSpins; ++i) {
+    auto state = waiter.futex.load(std::memory_order_acquire);
+    if (state != kWaiting) {
+      return state;
+    }
+    asm_volatile_pause();
+  }
+
+  uint32_t state = kWaiting;
+  if (waiter.futex.compare_exchange_strong(
+          state, kSleeping, std::memory_order_acquire,
+          std::memory_order_acquire)) {
+    do {
+      waiter.futex.futexWait(kSleeping);
+    } while ((state = waiter.futex.load(std::memory_order_acquire)) ==
+             kSleeping);
+  }
+  return state;
+}
+
+template <template <typename> class Atom>
+void DistributedMutexImpl<Atom>::wake(Waiter& waiter, uint32_t state) {
+  // The waiter returns, and its node goes out of scope, as soon as it sees
+  // the new state.  As with Baton::post(), waking it only uses the
+  // address of the futex, not its contents.
+  auto& futex = waiter.futex;
+  if (futex.exchange(state, std::memory_order_release) == kSleeping) {
+    futex.futexWake(1);
+  }
+}
+
+template <template <typename> class Atom>
+typename DistributedMutexImpl<Atom>::Waiter*
+DistributedMutexImpl<Atom>::nextWaiter(Waiter* next) {
+  if (next) {
+    return next;
+  }
+  auto state = kLocked;
+  if (state_.compare_exchange_strong(
+          state, kUnlocked, std::memory_order_release,
+          std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  // Take all the waiters that queued up since the last batch.  Resetting
+  // state_ to kLocked rather than comparing it with the newest waiter
+  // later avoids ABA when that waiter's thread queues up again with a node
+  // at the same address.
+  return reinterpret_cast<Waiter*>(
+      state_.exchange(kLocked, std::memory_order_acq_rel));
+}
+
+template <template <typename> class Atom>
+void DistributedMutexImpl<Atom>::unlock(Proxy proxy) {
+  assert(proxy);
+  proxy.locked_ = false;
+  auto next = proxy.next_;
+  for (int combined = 0;; ++combined) {
+    next = nextWaiter(next);
+    if (!next) {
+      return;
+    }
+    if (!next->task || combined == kMaxCombined) {
+      wake(*next, kWake);
+      return;
+    }
+    // Run the waiter's critical section here, where the data it touches
+    // is likely cached already, and move on to the one before it.
+    auto before = next->next;
+    next->task(next->context);
+    wake(*next, kCombined);
+    next = before == kLocked ? nullptr : reinterpret_cast<Waiter*>(before);
+  }
+}
+
+template <template <typename> class Atom>
+template <typename Task>
+auto DistributedMutexImpl<Atom>::lock_combine(Task task) -> decltype(task()) {
+  struct Context {
+    static void run(void* context) {
+      auto self = static_cast<Context*>(context);
+      self->result = makeTryWith(self->task);
+    }
+
+    Task& task;
+    Try<decltype(task())> result;
+  };
+
+  Context context{task, {}};
+  Proxy proxy = try_lock();
+  if (proxy) {
+    Context::run(&context);
+    unlock(std::move(proxy));
+  } else {
+    Waiter waiter(&Context::run, &context);
+    Proxy slow = lockSlow(waiter);
+    if (slow) {
+      Context::run(&context);
+      unlock(std::move(slow));
+    }
+  }
+  return std::move(context.result).value();
+}
+
+} // namespace folly
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <folly/detail/Futex.h>
+
+namespace folly {
+
+template <template <typename> class Atom = std::atomic>
+class DistributedMutexImpl;
+
+/// DistributedMutex is a mutex for heavily contended locks with short
+/// critical sections, where std::mutex and spin locks have every waiter
+/// polling or sleeping on the one cache line that holds the lock word.
+///
+/// -- Waiters don't touch shared state after enqueueing.  A contended
+/// lock() pushes a node from its own stack onto the lock word (with a
+/// single CAS) and spins, then sleeps on a futex, in that node.
+///
+/// -- unlock() hands the lock directly to a waiter, by writing to the
+/// waiter's node.  The lock word is only touched again once every waiter
+/// that was queued when the holder took over has had the lock.  Those
+/// waiters get it in LIFO order, so the warmest (most recently spinning)
+/// ones go first; batches are served in arrival order, so nobody starves.
+///
+/// -- lock_combine(task) publishes task in the node, so that the holder
+/// can run the critical section on the waiter's behalf rather than wake
+/// it up.  The data the lock protects then stays in the holder's cache,
+/// which for small critical sections is where most of the time goes.
+/// The waiter still gets task's return value, or exception.
+///
+/// An uncontended lock()/unlock() is a CAS each, like a spin lock, and
+/// the mutex takes 8 bytes.
+///
+/// Because the holder needs to know who it hands the lock to, lock()
+/// returns a proxy that must be passed to unlock(), so DistributedMutex
+/// isn't a Lockable and doesn't work with std::lock_guard:
+///
+///   folly::DistributedMutex mutex;
+///
+///   auto proxy = mutex.lock();
+///   ++counter;
+///   mutex.unlock(std::move(proxy));
+///
+///   auto value = mutex.lock_combine([&] { return ++counter; });
+///
+/// DistributedMutex isn't recursive.  It's not fair either: a thread can
+/// take the lock on the fast path while a batch of waiters is being
+/// served.
+typedef DistributedMutexImpl<> DistributedMutex;
+
+template <template <typename> class Atom>
+class DistributedMutexImpl {
+  struct Waiter;
+
+ public:
+  /// Returned by lock() and a successful try_lock(), to be passed to
+  /// unlock().  Converts to true iff it holds the lock.
+  class Proxy {
+   public:
+    Proxy(Proxy&& other) noexcept
+        : next_(other.next_), locked_(other.locked_) {
+      other.locked_ = false;
+    }
+    Proxy& operator=(Proxy&&) = delete;
+    Proxy(const Proxy&) = delete;
+    Proxy& operator=(const Proxy&) = delete;
+
+    explicit operator bool() const {
+      return locked_;
+    }
+
+   private:
+    friend class DistributedMutexImpl;
+
+    Proxy(Waiter* next, bool locked) : next_(next), locked_(locked) {}
+
+    // The next waiter of the batch being served, if any
+    Waiter* next_;
+    bool locked_;
+  };
+
+  constexpr DistributedMutexImpl() noexcept : state_(kUnlocked) {}
+
+  DistributedMutexImpl(const DistributedMutexImpl&) = delete;
+  DistributedMutexImpl& operator=(const DistributedMutexImpl&) = delete;
+
+  /// Blocks until the lock is acquired.
+  Proxy lock();
+
+  /// Acquires the lock iff that doesn't block; check the result.
+  Proxy try_lock();
+
+  /// Releases the lock, handing it to a waiter if there is one.
+  void unlock(Proxy proxy);
+
+  /// Runs task() with the lock held, maybe on the thread that holds the
+  /// lock, and returns its result.  task should be short and must not
+  /// rely on running on the calling thread (thread locals, for instance).
+  template <typename Task>
+  auto lock_combine(Task task) -> decltype(task());
+
+ private:
+  // state_ is one of these, or the address of the newest waiter
+  static constexpr std::uintptr_t kUnlocked = 0;
+  static constexpr std::uintptr_t kLocked = 1;
+
+  // Waiter::futex states
+  enum : uint32_t {
+    kWaiting,
+    kSleeping,
+    kWake,
+    kCombined,
+  };
+
+  // Combine at most this many critical sections per unlock() before
+  // handing the lock over, so that the holder gets to move on
+  static constexpr int kMaxCombined = 32;
+
+  // Pauses before a waiter goes to sleep
+  static constexpr int kMaxSpins = 128;
+
+  Proxy lockSlow(Waiter& waiter);
+  Waiter* nextWaiter(Waiter* next);
+  static uint32_t wait(Waiter& waiter);
+  static void wake(Waiter& waiter, uint32_t state);
+
+  Atom<std::uintptr_t> state_;
+};
+
+} // namespace folly
+
+#include <folly/synchronization/DistributedMutex-inl.h>
@@ -46,7 +46,9 @@ struct LifoSemImpl;
 /// false sharing.
 ///
 /// LifoSem allows multi-post and multi-tryWait, and provides a shutdown
-/// state that awakens all waiters.  LifoSem is faster than sem_t because
+/// state that awakens all waiters.  post(n) pops up to n waiters at once,
+/// with a single update of the shared head, so bursts of work that wake
+/// many idle threads don't contend on it once per waiter.  LifoSem is faster than sem_t because
 /// it performs exact wakeups, so it often requires fewer system calls.
 /// It provides all of the functionality of sem_t except for timed waiting.
 /// It is called LifoSem because its wakeup policy is approximately LIFO,
@@ -86,6 +88,12 @@ struct LifoSemImpl;
 ///
 /// All LifoSem operations operations except valueGuess() are guaranteed
 /// to be linearizable.
+///
+/// Waiters spin for a while before blocking, in case a post() follows
+/// shortly.  The spin budget adapts to the latency of the handoffs seen
+/// by the semaphore: it shrinks while waiters end up blocking anyway
+/// (e.g. idle pool threads), and follows the typical handoff time while
+/// spinning pays off.
 typedef LifoSemImpl<> LifoSem;
 
 
@@ -151,7 +159,9 @@ struct LifoSemRawNode {
 /// single post() -> wait() communication.  It must have a post() method.
 /// If it has a wait() method then LifoSemBase's wait() implementation
 /// will work out of the box, otherwise you will need to specialize
-/// LifoSemBase::wait accordingly.
+/// LifoSemBase::wait accordingly.  If it has a Baton-like
+/// waitWithSpins(maxSpins) method, LifoSemBase uses it to adapt spinning
+/// to the observed handoff latency.
 template <typename Handoff, template <typename> class Atom>
 struct LifoSemNode : public LifoSemRawNode<Atom> {
 
@@ -322,14 +332,15 @@ struct LifoSemBase {
 
   /// Constructor
   constexpr explicit LifoSemBase(uint32_t initialValue = 0)
-      : head_(LifoSemHead::fresh(initialValue)) {}
+      : head_(LifoSemHead::fresh(initialValue)), spins_(kInitialSpins) {}
 
   LifoSemBase(LifoSemBase const&) = delete;
   LifoSemBase& operator=(LifoSemBase const&) = delete;
 
   /// Silently saturates if value is already 2^32-1
   void post() {
-    auto idx = incrOrPop(1);
+    uint32_t popped;
+    auto idx = incrOrPop(1, popped);
     if (idx != 0) {
       idxToNode(idx).handoff().post();
     }
@@ -345,11 +356,20 @@ struct LifoSemBase {
   /// linearizability near the zero value, but without as much of
   /// a benefit).
   void post(uint32_t n) {
-    uint32_t idx;
-    while (n > 0 && (idx = incrOrPop(n)) != 0) {
-      // pop accounts for only 1
-      idxToNode(idx).handoff().post();
-      --n;
+    while (n > 0) {
+      uint32_t popped;
+      auto idx = incrOrPop(n, popped);
+      if (idx == 0) {
+        break;
+      }
+      // each popped waiter accounts for 1
+      n -= popped;
+      while (popped-- > 0) {
+        auto& node = idxToNode(idx);
+        // The popped chain is ours, but a woken waiter recycles its node
+        idx = node.next;
+        node.handoff().post();
+      }
     }
   }
 
@@ -441,7 +461,7 @@ struct LifoSemBase {
     }
 
     if (rv == WaitResult::PUSH) {
-      node->handoff().wait();
+      waitForHandoff(node->handoff(), 0);
       if (UNLIKELY(node->isShutdownNotice())) {
         // this wait() didn't consume a value, it was triggered by shutdown
         assert(isShutdown());
@@ -511,8 +531,46 @@ struct LifoSemBase {
   }
 
  private:
+  // Bounds of the spin budget of waiters, in Baton spins (a pause
+  // instruction each).  The initial budget is what Baton uses by default.
+  enum : uint32_t {
+    kInitialSpins = 300,
+    kMinSpins = 16,
+    kMaxSpins = 4000,
+  };
+
   CachelinePadded<folly::AtomicStruct<LifoSemHead, Atom>> head_;
 
+  // Moving average of the spins after which posts arrived, decayed when
+  // waiters block.  Updated racily, it is only a heuristic.
+  Atom<uint32_t> spins_;
+
+  template <typename H>
+  auto waitForHandoff(H& handoff, int)
+      -> decltype(handoff.waitWithSpins(0), void()) {
+    auto budget = spins_.load(std::memory_order_relaxed);
+    // Allow for handoffs somewhat slower than usual
+    auto limit = std::min<uint32_t>(2 * budget, kMaxSpins);
+    auto spins = handoff.waitWithSpins(limit);
+    uint32_t next;
+    if (spins < limit) {
+      // spinning paid off, move towards the observed latency
+      next = budget - budget / 8 + spins / 8;
+    } else {
+      // blocked, so the spins were wasted
+      next = budget - budget / 8;
+    }
+    next = std::max<uint32_t>(kMinSpins, std::min<uint32_t>(next, kMaxSpins));
+    if (next != budget) {
+      spins_.store(next, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename H>
+  void waitForHandoff(H& handoff, long) {
+    handoff.wait();
+  }
+
   static LifoSemNode<Handoff, Atom>& idxToNode(uint32_t idx) {
     auto raw = &LifoSemRawNode<Atom>::pool()[idx];
     return *static_cast<LifoSemNode<Handoff, Atom>*>(raw);
@@ -522,24 +580,37 @@ struct LifoSemBase {
     return LifoSemRawNode<Atom>::pool().locateElem(&node);
   }
 
-  /// Either increments by n and returns 0, or pops a node and returns it.
-  /// If n + the stripe's value overflows, then the stripe's value
-  /// saturates silently at 2^32-1
-  uint32_t incrOrPop(uint32_t n) {
+  /// Either increments by n and returns 0, or pops a chain of up to n
+  /// nodes (linked through next), and returns the first one and sets
+  /// popped to their number.  If n + the stripe's value overflows, then
+  /// the stripe's value saturates silently at 2^32-1
+  uint32_t incrOrPop(uint32_t n, uint32_t& popped) {
     while (true) {
       assert(n > 0);
 
       auto head = head_->load(std::memory_order_acquire);
       if (head.isNodeIdx()) {
-        auto& node = idxToNode(head.idx());
-        if (head_->compare_exchange_strong(head, head.withPop(node.next))) {
+        // Nodes below the head can only be removed by popping, which
+        // changes the head's sequence number, so if the CAS succeeds the
+        // chain we walked is still linked.  Meanwhile, next may be stale
+        // (or a shutdown notice) and we must not follow it too far.
+        uint32_t count = 1;
+        uint32_t next = idxToNode(head.idx()).next;
+        while (count < n && next != 0 && next != uint32_t(-1)) {
+          next = idxToNode(next).next;
+          ++count;
+        }
+        if (next != uint32_t(-1) &&
+            head_->compare_exchange_strong(head, head.withPop(next))) {
           // successful pop
+          popped = count;
           return head.idx();
         }
       } else {
         auto after = head.withValueIncr(n);
         if (head_->compare_exchange_strong(head, after)) {
           // successful incr
+          popped = 0;
           return 0;
         }
       }
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include <folly/Indestructible.h>
+#include <folly/executors/QueuedImmediateExecutor.h>
+
+namespace folly {
+
+template <typename Tag>
+rcu_domain<Tag>* rcu_default_domain() {
+  // Never destroyed, there may be readers and retirements during static
+  // destruction
+  static Indestructible<rcu_domain<Tag>> domain;
+  return domain.get();
+}
+
+template <typename Tag>
+rcu_domain<Tag>::rcu_domain(Executor* executor) noexcept
+    : executor_(executor) {
+  if (!executor_) {
+    static Indestructible<QueuedImmediateExecutor> defaultExecutor;
+    executor_ = defaultExecutor.get();
+  }
+}
+
+template <typename Tag>
+rcu_domain<Tag>::~rcu_domain() {
+  barrier();
+}
+
+template <typename Tag>
+FOLLY_ALWAYS_INLINE rcu_token rcu_domain<Tag>::lock_shared() {
+  auto epoch = version_.load(std::memory_order_acquire);
+  // If a writer moves the epoch forward before the increment, the reader
+  // counts for an epoch it doesn't wait for anymore.  That's fine, the
+  // reader started after the writer's changes were visible.
+  counters_.increment(epoch);
+  return rcu_token(epoch);
+}
+
+template <typename Tag>
+FOLLY_ALWAYS_INLINE void rcu_domain<Tag>::unlock_shared(rcu_token&& token) {
+  counters_.decrement(token.epoch_);
+}
+
+template <typename Tag>
+template <typename F>
+void rcu_domain<Tag>::call(F&& cb) {
+  retire(new detail::RcuNode(Func(std::forward<F>(cb))));
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::retire(detail::RcuNode* node) noexcept {
+  auto head = retired_.load(std::memory_order_relaxed);
+  do {
+    node->next = head;
+  } while (!retired_.compare_exchange_weak(
+      head, node, std::memory_order_release, std::memory_order_relaxed));
+
+  // We may hold a reader here, so we can't wait for readers; move the
+  // epoch forward only if nobody is reading the previous one
+  uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+                     .count();
+  auto syncTime = syncTime_.load(std::memory_order_relaxed);
+  if (now >= syncTime + kSyncTimePeriodMs &&
+      syncTime_.compare_exchange_strong(
+          syncTime, now, std::memory_order_relaxed)) {
+    detail::RcuList finished;
+    {
+      // A synchronize() holding the mutex may be waiting for our reader
+      std::unique_lock<std::mutex> g(syncMutex_, std::try_to_lock);
+      if (g.owns_lock()) {
+        halfSync(false, finished);
+      }
+    }
+    runCallbacks(std::move(finished));
+  }
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::synchronize() noexcept {
+  // Two epochs from now, every reader that could have started before this
+  // call has finished
+  auto target = version_.load(std::memory_order_acquire) + 2;
+  detail::RcuList finished;
+  {
+    std::lock_guard<std::mutex> g(syncMutex_);
+    // Concurrent calls wait for the mutex, and may find the work done
+    while (version_.load(std::memory_order_acquire) < target) {
+      halfSync(true, finished);
+    }
+  }
+  runCallbacks(std::move(finished));
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::barrier() noexcept {
+  detail::RcuList finished;
+  {
+    std::lock_guard<std::mutex> g(syncMutex_);
+    // Everything retired so far is collected by the first, and through two
+    // epochs after the second
+    halfSync(true, finished);
+    halfSync(true, finished);
+  }
+  finished.clear(true);
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::halfSync(bool blocking, detail::RcuList& finished) {
+  auto next = version_.load(std::memory_order_acquire) + 1;
+
+  // One epoch isn't enough: a reader that loaded the version just before
+  // the last advance may count itself in the previous epoch
+  collect();
+
+  // Readers of next & 1 are those of the previous epoch
+  if (blocking) {
+    counters_.waitForZero(next);
+  } else if (counters_.readFull(next) != 0) {
+    return;
+  }
+
+  finished.splice(queues_[1]);
+  queues_[1].splice(queues_[0]);
+  version_.store(next, std::memory_order_release);
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::collect() {
+  auto node = retired_.exchange(nullptr, std::memory_order_acquire);
+  // The stack is newest first
+  detail::RcuList list;
+  detail::RcuNode* prev = nullptr;
+  while (node) {
+    auto next = node->next;
+    node->next = prev;
+    prev = node;
+    node = next;
+  }
+  while (prev) {
+    auto next = prev->next;
+    list.push_back(prev);
+    prev = next;
+  }
+  queues_[0].splice(list);
+}
+
+template <typename Tag>
+void rcu_domain<Tag>::runCallbacks(detail::RcuList&& finished) {
+  if (finished.empty()) {
+    return;
+  }
+  executor_->add([list = std::move(finished)]() mutable { list.clear(true); });
+}
+
+} // namespace folly
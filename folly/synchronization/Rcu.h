@@ -0,0 +1,332 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <folly/Executor.h>
+#include <folly/Portability.h>
+#include <folly/synchronization/detail/ThreadCachedReaders.h>
+
+/**
+ * Read-copy-update.
+ *
+ * Readers of a structure enter a read-side critical section with an
+ * rcu_reader, which costs about as much as a thread-local increment and
+ * never writes shared memory.  Writers replace what they want to change
+ * (e.g. publish a new copy through an atomic pointer), then either wait for
+ * all the readers that might still see the old version with
+ * synchronize_rcu(), or hand it to rcu_retire() / rcu_domain::call(), which
+ * free it later, in batches, once it is safe, without blocking.
+ *
+ *   std::atomic<Config*> config;
+ *
+ *   // readers
+ *   {
+ *     rcu_reader guard;
+ *     auto c = config.load(std::memory_order_acquire);
+ *     use(*c);
+ *   } // c can't be used after the guard is gone
+ *
+ *   // writer
+ *   auto old = config.exchange(new Config(...), std::memory_order_acq_rel);
+ *   rcu_retire(old);        // or: synchronize_rcu(); delete old;
+ *
+ * RcuSynchronized (RcuSynchronized.h) wraps this pattern for objects that
+ * are read much more often than they are written.
+ *
+ * Rules:
+ * - An rcu_reader must be destroyed (or unlocked) on the thread that
+ *   acquired it, and no thread may exit while holding one.
+ * - Readers may nest, and may call rcu_retire() and call().
+ * - Never call synchronize_rcu() or rcu_barrier() while holding a reader of
+ *   the same domain, that deadlocks.
+ *
+ * Deferred callbacks are collected by the thread that next moves the
+ * domain's epoch forward, at most every few milliseconds from retire()
+ * calls, or in synchronize().  Each batch of callbacks whose grace period
+ * is over is passed to the domain's executor as a single task.  The
+ * default executor runs them on that thread, after the current task.
+ * rcu_barrier() runs all the callbacks retired before it on the calling
+ * thread.
+ *
+ * Domains are independent: readers of one don't delay synchronize() of
+ * another.  Most users want the default domain, rcu_default_domain().
+ *
+ * The implementation keeps an epoch number, and per-thread reader counts
+ * for the epoch's parity (see detail/ThreadCachedReaders.h).  A writer
+ * advances the epoch after waiting for the readers of the previous parity
+ * to finish; two advances make a grace period.
+ */
+
+namespace folly {
+
+struct RcuTag;
+
+template <typename Tag>
+class rcu_domain;
+
+/** What an rcu_domain reader holds, to release the right epoch. */
+class rcu_token {
+ public:
+  rcu_token() = default;
+
+ private:
+  explicit rcu_token(uint64_t epoch) : epoch_(epoch) {}
+
+  template <typename Tag>
+  friend class rcu_domain;
+
+  uint64_t epoch_{0};
+};
+
+namespace detail {
+
+struct RcuNode {
+  explicit RcuNode(Func&& f) : cb(std::move(f)) {}
+
+  Func cb;
+  RcuNode* next{nullptr};
+};
+
+// A FIFO list of callbacks, that owns its nodes
+class RcuList {
+ public:
+  RcuList() = default;
+  RcuList(RcuList&& other) noexcept : head_(other.head_), tail_(other.tail_) {
+    other.head_ = other.tail_ = nullptr;
+  }
+  RcuList& operator=(RcuList&&) = delete;
+
+  ~RcuList() {
+    clear(false);
+  }
+
+  bool empty() const noexcept {
+    return head_ == nullptr;
+  }
+
+  void push_back(RcuNode* node) noexcept {
+    node->next = nullptr;
+    if (tail_) {
+      tail_->next = node;
+    } else {
+      head_ = node;
+    }
+    tail_ = node;
+  }
+
+  void splice(RcuList& other) noexcept {
+    if (other.empty()) {
+      return;
+    }
+    if (tail_) {
+      tail_->next = other.head_;
+    } else {
+      head_ = other.head_;
+    }
+    tail_ = other.tail_;
+    other.head_ = other.tail_ = nullptr;
+  }
+
+  /** Run (if run) and free all the callbacks */
+  void clear(bool run) {
+    while (head_) {
+      auto node = head_;
+      head_ = node->next;
+      if (run) {
+        node->cb();
+      }
+      delete node;
+    }
+    tail_ = nullptr;
+  }
+
+ private:
+  RcuNode* head_{nullptr};
+  RcuNode* tail_{nullptr};
+};
+
+} // namespace detail
+
+/**
+ * An independent set of readers and the callbacks waiting for them.  The
+ * Tag only selects the thread-local storage of the reader counts.
+ */
+template <typename Tag = RcuTag>
+class rcu_domain {
+ public:
+  /**
+   * Deferred callbacks are run on executor, by default a
+   * QueuedImmediateExecutor on the thread that collects them.
+   */
+  explicit rcu_domain(Executor* executor = nullptr) noexcept;
+
+  rcu_domain(const rcu_domain&) = delete;
+  rcu_domain& operator=(const rcu_domain&) = delete;
+
+  /** Runs the callbacks that are still waiting */
+  ~rcu_domain();
+
+  // Reader side, prefer rcu_reader_domain to calling these directly
+  FOLLY_ALWAYS_INLINE rcu_token lock_shared();
+  FOLLY_ALWAYS_INLINE void unlock_shared(rcu_token&& token);
+
+  /** Run cb on the executor once all current readers are done */
+  template <typename F>
+  void call(F&& cb);
+
+  /** Wait until all current readers are done */
+  void synchronize() noexcept;
+
+  /**
+   * Wait for all current readers, and run all the callbacks retired so far
+   * on this thread.  Callbacks already handed to the executor may still be
+   * running.
+   */
+  void barrier() noexcept;
+
+ private:
+  // Through call() and retire(), a node isn't collected for at least
+  // this long after the last collection
+  static constexpr uint64_t kSyncTimePeriodMs = 10;
+
+  void retire(detail::RcuNode* node) noexcept;
+  // Move the epoch forward once if there are no readers of the previous
+  // one (waiting for them if blocking), and move the callbacks that have
+  // been through two epochs to finished.  syncMutex_ must be held.
+  void halfSync(bool blocking, detail::RcuList& finished);
+  // Move the callbacks retired since the last collection to queues_[0]
+  void collect();
+  void runCallbacks(detail::RcuList&& finished);
+
+  detail::ThreadCachedReaders<Tag> counters_;
+  std::atomic<uint64_t> version_{0};
+  // Stack of nodes not collected yet, pushed to by call() and retire()
+  std::atomic<detail::RcuNode*> retired_{nullptr};
+  std::atomic<uint64_t> syncTime_{0};
+
+  std::mutex syncMutex_;
+  // Protected by syncMutex_: callbacks through zero and one epochs
+  detail::RcuList queues_[2];
+
+  Executor* executor_;
+};
+
+/** The default domain of a Tag, alive until the process exits */
+template <typename Tag = RcuTag>
+rcu_domain<Tag>* rcu_default_domain();
+
+/**
+ * RAII read-side critical section.  Can be moved, but must be destroyed on
+ * the thread that created it.
+ */
+template <typename Tag = RcuTag>
+class rcu_reader_domain {
+ public:
+  FOLLY_ALWAYS_INLINE explicit rcu_reader_domain(
+      rcu_domain<Tag>* domain = rcu_default_domain<Tag>()) noexcept
+      : domain_(domain), token_(domain->lock_shared()), locked_(true) {}
+
+  explicit rcu_reader_domain(
+      std::defer_lock_t,
+      rcu_domain<Tag>* domain = rcu_default_domain<Tag>()) noexcept
+      : domain_(domain) {}
+
+  rcu_reader_domain(rcu_reader_domain&& other) noexcept
+      : domain_(other.domain_), token_(other.token_), locked_(other.locked_) {
+    other.locked_ = false;
+  }
+
+  rcu_reader_domain& operator=(rcu_reader_domain&& other) noexcept {
+    if (this != &other) {
+      if (locked_) {
+        unlock();
+      }
+      domain_ = other.domain_;
+      token_ = other.token_;
+      locked_ = other.locked_;
+      other.locked_ = false;
+    }
+    return *this;
+  }
+
+  rcu_reader_domain(const rcu_reader_domain&) = delete;
+  rcu_reader_domain& operator=(const rcu_reader_domain&) = delete;
+
+  FOLLY_ALWAYS_INLINE ~rcu_reader_domain() {
+    if (locked_) {
+      unlock();
+    }
+  }
+
+  void lock() noexcept {
+    DCHECK(!locked_);
+    token_ = domain_->lock_shared();
+    locked_ = true;
+  }
+
+  void unlock() noexcept {
+    DCHECK(locked_);
+    domain_->unlock_shared(std::move(token_));
+    locked_ = false;
+  }
+
+  bool owns_lock() const noexcept {
+    return locked_;
+  }
+
+ private:
+  rcu_domain<Tag>* domain_;
+  rcu_token token_;
+  bool locked_{false};
+};
+
+using rcu_reader = rcu_reader_domain<RcuTag>;
+
+/** Wait until all current readers of domain are done */
+template <typename Tag = RcuTag>
+inline void synchronize_rcu(
+    rcu_domain<Tag>* domain = rcu_default_domain<Tag>()) noexcept {
+  domain->synchronize();
+}
+
+/** Run all the callbacks retired so far, see rcu_domain::barrier() */
+template <typename Tag = RcuTag>
+inline void rcu_barrier(
+    rcu_domain<Tag>* domain = rcu_default_domain<Tag>()) noexcept {
+  domain->barrier();
+}
+
+/** Free p with d once all current readers of domain are done */
+template <
+    typename T,
+    typename D = std::default_delete<T>,
+    typename Tag = RcuTag>
+void rcu_retire(
+    T* p,
+    D d = {},
+    rcu_domain<Tag>* domain = rcu_default_domain<Tag>()) {
+  domain->call([p, d = std::move(d)]() mutable { d(p); });
+}
+
+} // namespace folly
+
+#include <folly/synchronization/Rcu-inl.h>
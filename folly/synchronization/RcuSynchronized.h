@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <folly/synchronization/Rcu.h>
+
+namespace folly {
+
+/**
+ * A read-mostly object protected by RCU, with a Synchronized-like interface.
+ *
+ * Readers get a const view of the current version, through rlock() or
+ * withRLock(), without ever writing shared memory, so reads scale with the
+ * number of cores, unlike Synchronized<T, SharedMutex>.  Writers copy the
+ * current version, modify the copy and publish it; readers that started
+ * before see the old version until they're done, and the old version is
+ * freed through rcu_retire().  Writers are serialized by a mutex.
+ *
+ *   RcuSynchronized<RoutingTable> table;
+ *
+ *   // readers
+ *   auto dest = table.withRLock([&](const RoutingTable& t) {
+ *     return t.lookup(addr);
+ *   });
+ *
+ *   // writers
+ *   table.update([&](RoutingTable& t) { t.add(prefix, dest); });
+ *
+ * A ConstLockedPtr is an rcu reader: the rules of rcu_reader (Rcu.h) apply,
+ * in particular it must be released on the thread that got it, and no
+ * writer method may be called while holding one.
+ */
+template <typename T, typename Tag = RcuTag>
+class RcuSynchronized {
+ public:
+  class ConstLockedPtr {
+   public:
+    const T* operator->() const noexcept {
+      return ptr_;
+    }
+
+    const T& operator*() const noexcept {
+      return *ptr_;
+    }
+
+    const T* get() const noexcept {
+      return ptr_;
+    }
+
+   private:
+    friend class RcuSynchronized;
+
+    ConstLockedPtr(rcu_domain<Tag>* domain, const std::atomic<T*>& src)
+        : reader_(domain), ptr_(src.load(std::memory_order_acquire)) {}
+
+    rcu_reader_domain<Tag> reader_;
+    const T* ptr_;
+  };
+
+  RcuSynchronized() : RcuSynchronized(T()) {}
+
+  explicit RcuSynchronized(
+      T value,
+      rcu_domain<Tag>* domain = rcu_default_domain<Tag>())
+      : domain_(domain), ptr_(new T(std::move(value))) {}
+
+  RcuSynchronized(const RcuSynchronized&) = delete;
+  RcuSynchronized& operator=(const RcuSynchronized&) = delete;
+
+  /** Readers may still be using the last version, so it is retired too */
+  ~RcuSynchronized() {
+    rcu_retire(ptr_.load(std::memory_order_relaxed), {}, domain_);
+  }
+
+  ConstLockedPtr rlock() const {
+    return ConstLockedPtr(domain_, ptr_);
+  }
+
+  template <typename Function>
+  auto withRLock(Function&& function) const
+      -> decltype(function(std::declval<const T&>())) {
+    auto p = rlock();
+    return function(*p);
+  }
+
+  /** A copy of the current version */
+  T copy() const {
+    return *rlock();
+  }
+
+  /** Publish a copy of the current version, as modified by function */
+  template <typename Function>
+  void update(Function&& function) {
+    std::lock_guard<std::mutex> g(writeMutex_);
+    auto next = std::make_unique<T>(*ptr_.load(std::memory_order_relaxed));
+    function(*next);
+    publish(std::move(next));
+  }
+
+  /** Publish value as the new version */
+  void assign(T value) {
+    auto next = std::make_unique<T>(std::move(value));
+    std::lock_guard<std::mutex> g(writeMutex_);
+    publish(std::move(next));
+  }
+
+  RcuSynchronized& operator=(T value) {
+    assign(std::move(value));
+    return *this;
+  }
+
+ private:
+  // writeMutex_ must be held
+  void publish(std::unique_ptr<T> next) {
+    auto old = ptr_.exchange(next.release(), std::memory_order_acq_rel);
+    rcu_retire(old, {}, domain_);
+  }
+
+  rcu_domain<Tag>* domain_;
+  std::atomic<T*> ptr_;
+  std::mutex writeMutex_;
+};
+
+} // namespace folly
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <folly/Likely.h>
+#include <folly/ThreadLocal.h>
+#include <folly/synchronization/AsymmetricMemoryBarrier.h>
+
+namespace folly {
+namespace detail {
+
+/**
+ * Reader counts of an rcu_domain, one per epoch parity, kept per thread so
+ * that readers only ever write their own cache line.  Only the writer side
+ * (readFull) walks all the threads.
+ *
+ * Each thread only modifies its own counts, so a reader has to decrement
+ * on the thread that incremented.  Readers pay for a compiler barrier,
+ * the writer for asymmetricHeavyBarrier()s.
+ */
+template <typename Tag>
+class ThreadCachedReaders {
+ public:
+  FOLLY_ALWAYS_INLINE void increment(uint64_t epoch) {
+    auto& c = counts()->epochs[epoch & 1];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // Matches the first heavy barrier in readFull(): either the writer sees
+    // this reader, or the reader sees everything the writer did before
+    asymmetricLightBarrier();
+  }
+
+  FOLLY_ALWAYS_INLINE void decrement(uint64_t epoch) {
+    // Matches the second heavy barrier in readFull(): the reader's reads
+    // happen before whatever the writer does after seeing the decrement
+    asymmetricLightBarrier();
+    auto& c = counts()->epochs[epoch & 1];
+    c.store(c.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  }
+
+  /** The number of readers of the given epoch parity, in all threads */
+  int64_t readFull(uint64_t epoch) {
+    asymmetricHeavyBarrier();
+    int64_t full = 0;
+    for (auto& c : counts_.accessAllThreads()) {
+      full += c.epochs[epoch & 1].load(std::memory_order_relaxed);
+    }
+    asymmetricHeavyBarrier();
+    return full;
+  }
+
+  void waitForZero(uint64_t epoch) {
+    while (readFull(epoch) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  struct Counts {
+    ~Counts() {
+      DCHECK_EQ(0, epochs[0].load(std::memory_order_relaxed))
+          << "thread exited holding an rcu reader";
+      DCHECK_EQ(0, epochs[1].load(std::memory_order_relaxed))
+          << "thread exited holding an rcu reader";
+    }
+
+    std::atomic<int64_t> epochs[2] = {{0}, {0}};
+  };
+
+  FOLLY_ALWAYS_INLINE Counts* counts() {
+    auto c = counts_.get();
+    if (UNLIKELY(c == nullptr)) {
+      c = new Counts();
+      counts_.reset(c);
+    }
+    return c;
+  }
+
+  ThreadLocalPtr<Counts, Tag, AccessModeStrict> counts_;
+};
+
+} // namespace detail
+} // namespace folly
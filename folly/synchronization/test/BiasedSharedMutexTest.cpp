@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/BiasedSharedMutex.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::BiasedSharedMutex;
+
+TEST(BiasedSharedMutex, fastReaders) {
+  BiasedSharedMutex<> mutex;
+  EXPECT_TRUE(mutex.isBiased());
+
+  BiasedSharedMutex<>::Token t1, t2;
+  mutex.lock_shared(t1);
+  EXPECT_TRUE(t1.isFast());
+  EXPECT_TRUE(mutex.try_lock_shared(t2));
+  EXPECT_TRUE(t2.isFast());
+
+  // Fast readers hold the lock against writers
+  EXPECT_FALSE(mutex.try_lock());
+  EXPECT_FALSE(mutex.isBiased());
+
+  mutex.unlock_shared(t2);
+  mutex.unlock_shared(t1);
+  EXPECT_FALSE(t1.isFast());
+  EXPECT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(BiasedSharedMutex, writerRevokesBias) {
+  BiasedSharedMutex<> mutex;
+  {
+    BiasedSharedMutex<>::WriteHolder guard(mutex);
+    EXPECT_FALSE(mutex.isBiased());
+
+    BiasedSharedMutex<>::Token token;
+    EXPECT_FALSE(mutex.try_lock_shared(token));
+    EXPECT_FALSE(mutex.try_lock_shared());
+  }
+
+  // Readers go through the underlying mutex until the backoff expires,
+  // and the first one after that restores the bias.
+  BiasedSharedMutex<>::Token token;
+  while (true) {
+    mutex.lock_shared(token);
+    bool fast = token.isFast();
+    mutex.unlock_shared(token);
+    if (fast) {
+      break;
+    }
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(mutex.isBiased());
+}
+
+TEST(BiasedSharedMutex, unbiased) {
+  BiasedSharedMutex<> mutex(false);
+  EXPECT_FALSE(mutex.isBiased());
+
+  // Nothing has been revoked, so the first slow reader restores the bias
+  BiasedSharedMutex<>::Token token;
+  mutex.lock_shared(token);
+  EXPECT_FALSE(token.isFast());
+  EXPECT_TRUE(mutex.isBiased());
+  mutex.unlock_shared(token);
+}
+
+TEST(BiasedSharedMutex, tokenless) {
+  BiasedSharedMutex<> mutex;
+  {
+    std::unique_lock<BiasedSharedMutex<>> guard(mutex);
+    EXPECT_FALSE(mutex.try_lock_shared());
+  }
+  mutex.lock_shared();
+  EXPECT_FALSE(mutex.try_lock());
+  mutex.unlock_shared();
+  EXPECT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(BiasedSharedMutex, stress) {
+  BiasedSharedMutex<> mutex;
+  // Written under the write lock and checked under the read lock; a
+  // reader that overlaps a writer sees them differ.
+  int64_t a = 0;
+  int64_t b = 0;
+  std::atomic<bool> done{false};
+  std::atomic<int64_t> torn{0};
+  std::atomic<int64_t> fast{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        BiasedSharedMutex<>::Token token;
+        mutex.lock_shared(token);
+        if (token.isFast()) {
+          ++fast;
+        }
+        auto x = a;
+        std::this_thread::yield();
+        if (b != x) {
+          ++torn;
+        }
+        mutex.unlock_shared(token);
+      }
+    });
+  }
+  for (int i = 0; i < 1000; ++i) {
+    BiasedSharedMutex<>::WriteHolder guard(mutex);
+    ++a;
+    ++b;
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, torn.load());
+  EXPECT_EQ(1000, a);
+}
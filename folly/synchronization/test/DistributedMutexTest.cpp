@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/DistributedMutex.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::DistributedMutex;
+
+TEST(DistributedMutex, basic) {
+  DistributedMutex mutex;
+  auto proxy = mutex.lock();
+  EXPECT_TRUE(bool(proxy));
+  EXPECT_FALSE(bool(mutex.try_lock()));
+  mutex.unlock(std::move(proxy));
+
+  auto other = mutex.try_lock();
+  EXPECT_TRUE(bool(other));
+  auto moved = std::move(other);
+  EXPECT_FALSE(bool(other));
+  EXPECT_TRUE(bool(moved));
+  mutex.unlock(std::move(moved));
+  EXPECT_TRUE(bool(mutex.try_lock()));
+}
+
+TEST(DistributedMutex, combine) {
+  DistributedMutex mutex;
+  int value = 0;
+  EXPECT_EQ(1, mutex.lock_combine([&] { return ++value; }));
+  mutex.lock_combine([&] { ++value; });
+  EXPECT_EQ(2, value);
+  EXPECT_THROW(
+      mutex.lock_combine([]() -> int { throw std::runtime_error("x"); }),
+      std::runtime_error);
+  // The lock was released
+  EXPECT_TRUE(bool(mutex.try_lock()));
+}
+
+TEST(DistributedMutex, combineOnHolder) {
+  DistributedMutex mutex;
+  auto holder = std::this_thread::get_id();
+  const int numThreads = 4;
+  std::atomic<int> onHolder{0};
+  std::atomic<int> started{0};
+  std::vector<std::thread> threads;
+
+  auto proxy = mutex.lock();
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&] {
+      ++started;
+      auto id = mutex.lock_combine([&] { return std::this_thread::get_id(); });
+      if (id == holder) {
+        ++onHolder;
+      }
+    });
+  }
+  while (started < numThreads) {
+    std::this_thread::yield();
+  }
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // Everybody is waiting; we run their critical sections
+  mutex.unlock(std::move(proxy));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(numThreads, onHolder);
+}
+
+TEST(DistributedMutex, stress) {
+  DistributedMutex mutex;
+  const int numThreads = 16;
+  const int numIters = 20000;
+  // Not atomic: only ever accessed with the lock held
+  long counter = 0;
+  bool inside = false;
+  std::atomic<bool> overlapped{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      auto critical = [&] {
+        if (inside) {
+          overlapped = true;
+        }
+        inside = true;
+        ++counter;
+        inside = false;
+        return counter;
+      };
+      for (int i = 0; i < numIters; ++i) {
+        switch ((t + i) % 3) {
+          case 0: {
+            auto proxy = mutex.lock();
+            critical();
+            mutex.unlock(std::move(proxy));
+            break;
+          }
+          case 1: {
+            auto proxy = mutex.try_lock();
+            if (proxy) {
+              critical();
+              mutex.unlock(std::move(proxy));
+            } else {
+              mutex.lock_combine(critical);
+            }
+            break;
+          }
+          default:
+            EXPECT_GT(mutex.lock_combine(critical), 0);
+        }
+        if (i % 1000 == 0) {
+          // Let the others queue up and go to sleep
+          /* sleep override */
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(overlapped);
+  EXPECT_EQ(long(numThreads) * numIters, counter);
+}
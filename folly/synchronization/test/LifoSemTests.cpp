@@ -241,6 +241,55 @@ TEST(LifoSem, shutdown_multi) {
   }
 }
 
+TEST(LifoSem, multi_post_wakes_batch) {
+  for (int pass = 0; pass < 10; ++pass) {
+    DSched sched(DSched::uniform(pass));
+
+    const int waiters = 6;
+    DLifoSem sem;
+    DeterministicAtomic<int> woken(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < waiters; ++i) {
+      threads.push_back(DSched::thread([&] {
+        sem.wait();
+        ++woken;
+      }));
+    }
+    // Some waiters may be blocked, some not there yet; each post wakes or
+    // pays for exactly one of them
+    sem.post(4);
+    sem.post(waiters - 4 + 3);
+    for (auto& thr : threads) {
+      DSched::join(thr);
+    }
+    EXPECT_EQ(waiters, woken.load());
+    EXPECT_EQ(3, sem.valueGuess());
+  }
+}
+
+TEST(LifoSem, multi_post_wakes_blocked) {
+  const int waiters = 16;
+  LifoSem sem;
+  std::atomic<int> woken(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < waiters; ++i) {
+    threads.emplace_back([&] {
+      sem.wait();
+      ++woken;
+    });
+  }
+  /* sleep override */ std::this_thread::sleep_for(
+      std::chrono::milliseconds(100));
+  EXPECT_EQ(0, woken.load());
+  sem.post(waiters / 2);
+  sem.post(waiters / 2 + 1);
+  for (auto& thr : threads) {
+    thr.join();
+  }
+  EXPECT_EQ(waiters, woken.load());
+  EXPECT_EQ(1, sem.valueGuess());
+}
+
 TEST(LifoSem, multi_try_wait_simple) {
   LifoSem sem;
   sem.post(5);
@@ -400,6 +449,50 @@ static void contendedUse(uint32_t n, int posters, int waiters) {
   }
 }
 
+// One poster wakes all the idle waiters at once, as an executor does after
+// a burst of work, either with post(n) or with n post()s
+static void burstWake(uint32_t rounds, int waiters, bool batch) {
+  LifoSemImpl<std::atomic> sem;
+  LifoSemImpl<std::atomic> done;
+
+  std::vector<std::thread> threads;
+  BENCHMARK_SUSPEND {
+    for (int t = 0; t < waiters; ++t) {
+      threads.emplace_back([&] {
+        for (uint32_t i = 0; i < rounds; ++i) {
+          sem.wait();
+          done.post();
+        }
+      });
+    }
+  }
+
+  for (uint32_t i = 0; i < rounds; ++i) {
+    if (batch) {
+      sem.post(waiters);
+    } else {
+      for (int t = 0; t < waiters; ++t) {
+        sem.post();
+      }
+    }
+    for (int t = 0; t < waiters; ++t) {
+      done.wait();
+    }
+  }
+
+  BENCHMARK_SUSPEND {
+    for (auto& thr : threads) {
+      thr.join();
+    }
+  }
+}
+
+BENCHMARK_DRAW_LINE()
+BENCHMARK_NAMED_PARAM(burstWake, 8_posts, 8, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(burstWake, 8_batch, 8, true)
+BENCHMARK_NAMED_PARAM(burstWake, 32_posts, 32, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(burstWake, 32_batch, 32, true)
+
 BENCHMARK_DRAW_LINE()
 BENCHMARK_NAMED_PARAM(contendedUse, 1_to_1, 1, 1)
 BENCHMARK_NAMED_PARAM(contendedUse, 1_to_4, 1, 4)
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/RcuSynchronized.h>
+
+#include <deque>
+#include <map>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+
+#include <glog/logging.h>
+
+DEFINE_int32(threads, 16, "benchmark concurrency");
+
+using namespace folly;
+
+namespace {
+
+using Table = std::map<int, int>;
+
+Table makeTable() {
+  Table t;
+  for (int i = 0; i < 64; ++i) {
+    t[i] = i;
+  }
+  return t;
+}
+
+template <typename ReadFunc>
+void bm_impl(ReadFunc&& fn, int64_t iters) {
+  std::deque<std::thread> threads;
+  for (int i = 0; i < FLAGS_threads; ++i) {
+    threads.emplace_back([&fn, iters] {
+      int64_t sum = 0;
+      for (int64_t j = 0; j < iters; ++j) {
+        sum += fn(int(j & 63));
+      }
+      doNotOptimizeAway(sum);
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+}
+
+} // namespace
+
+BENCHMARK(RcuReaderLockUnlock, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    rcu_reader guard;
+  }
+}
+
+BENCHMARK(SharedMutexLockUnlockShared, iters) {
+  SharedMutex m;
+  for (size_t i = 0; i < iters; ++i) {
+    m.lock_shared();
+    m.unlock_shared();
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(SynchronizedSharedMutexRead, iters) {
+  Synchronized<Table, SharedMutex> table;
+  BENCHMARK_SUSPEND {
+    table = makeTable();
+  }
+  bm_impl(
+      [&](int k) {
+        return table.withRLock([&](const Table& t) { return t.at(k); });
+      },
+      iters);
+}
+
+BENCHMARK_RELATIVE(RcuSynchronizedRead, iters) {
+  RcuSynchronized<Table> table;
+  BENCHMARK_SUSPEND {
+    table = makeTable();
+  }
+  bm_impl(
+      [&](int k) {
+        return table.withRLock([&](const Table& t) { return t.at(k); });
+      },
+      iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(SynchronizeRcu, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    synchronize_rcu();
+  }
+}
+
+BENCHMARK(RcuRetire, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    rcu_retire(new int(0));
+  }
+  BENCHMARK_SUSPEND {
+    rcu_barrier();
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/RcuSynchronized.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(RcuSynchronized, Basic) {
+  RcuSynchronized<std::map<std::string, int>> m;
+  EXPECT_TRUE(m.rlock()->empty());
+
+  m.update([](std::map<std::string, int>& v) { v["a"] = 1; });
+  {
+    auto p = m.rlock();
+    EXPECT_EQ(1, p->at("a"));
+    // A reader keeps seeing the version it started with
+    m.assign({{"b", 2}});
+    EXPECT_EQ(1, p->count("a"));
+    EXPECT_EQ(0, p->count("b"));
+  }
+  EXPECT_EQ(2, m.withRLock([](const std::map<std::string, int>& v) {
+    return v.at("b");
+  }));
+
+  m = std::map<std::string, int>{{"c", 3}};
+  auto copy = m.copy();
+  EXPECT_EQ(1, copy.size());
+  EXPECT_EQ(3, copy.at("c"));
+}
+
+TEST(RcuSynchronized, OldVersionsAreFreed) {
+  struct Counted {
+    explicit Counted(std::shared_ptr<int> p) : ptr(std::move(p)) {}
+    std::shared_ptr<int> ptr;
+  };
+  rcu_domain<> domain;
+  auto p = std::make_shared<int>(0);
+  {
+    RcuSynchronized<Counted> s(Counted(p), &domain);
+    for (int i = 0; i < 10; ++i) {
+      s.update([](Counted&) {});
+    }
+    domain.barrier();
+    EXPECT_EQ(2, p.use_count());
+  }
+  domain.barrier();
+  EXPECT_EQ(1, p.use_count());
+}
+
+TEST(RcuSynchronized, ConcurrentReadersAndWriters) {
+  // The two halves are always updated together
+  struct Pair {
+    int a{0};
+    int b{0};
+  };
+  RcuSynchronized<Pair> s;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> torn{false};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        auto p = s.rlock();
+        if (p->a != p->b) {
+          torn = true;
+        }
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 2; ++i) {
+    writers.emplace_back([&] {
+      for (int j = 0; j < 1000; ++j) {
+        s.update([](Pair& p) {
+          ++p.a;
+          ++p.b;
+        });
+      }
+    });
+  }
+  for (auto& t : writers) {
+    t.join();
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_FALSE(torn);
+  EXPECT_EQ(2000, s.rlock()->a);
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/Rcu.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+struct DeleteCounter {
+  explicit DeleteCounter(std::atomic<int>& c) : count(c) {}
+  ~DeleteCounter() {
+    ++count;
+  }
+  std::atomic<int>& count;
+};
+
+} // namespace
+
+TEST(RcuTest, Basic) {
+  std::atomic<int> deleted{0};
+  auto p = new DeleteCounter(deleted);
+  {
+    // Retiring while reading is fine
+    rcu_reader guard;
+    rcu_retire(p);
+  }
+  synchronize_rcu();
+  rcu_barrier();
+  EXPECT_EQ(1, deleted);
+}
+
+TEST(RcuTest, SynchronizeWaitsForReaders) {
+  rcu_domain<> domain;
+  std::atomic<bool> readerDone{false};
+  Baton<> locked;
+  std::thread reader([&] {
+    rcu_reader_domain<> guard(&domain);
+    locked.post();
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    readerDone = true;
+  });
+  locked.wait();
+  domain.synchronize();
+  EXPECT_TRUE(readerDone);
+  reader.join();
+}
+
+TEST(RcuTest, SynchronizeIgnoresLaterReaders) {
+  rcu_domain<> domain;
+  rcu_reader_domain<> guard(std::defer_lock, &domain);
+  guard.lock();
+  guard.unlock();
+  EXPECT_FALSE(guard.owns_lock());
+  domain.synchronize();
+  domain.synchronize();
+}
+
+TEST(RcuTest, RetireWaitsForReaders) {
+  rcu_domain<> domain;
+  std::atomic<int> deleted{0};
+  auto p = new DeleteCounter(deleted);
+
+  Baton<> locked, retired;
+  std::thread reader([&] {
+    rcu_reader_domain<> guard(&domain);
+    locked.post();
+    retired.wait();
+    // Several epochs worth of retirements can't free p
+    for (int i = 0; i < 5; ++i) {
+      auto q = new DeleteCounter(deleted);
+      rcu_retire(q, {}, &domain);
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    }
+    EXPECT_EQ(0, deleted);
+  });
+  locked.wait();
+  rcu_retire(p, {}, &domain);
+  retired.post();
+  reader.join();
+
+  domain.synchronize();
+  domain.barrier();
+  EXPECT_EQ(6, deleted);
+}
+
+TEST(RcuTest, CallbacksRunOnExecutor) {
+  ManualExecutor executor;
+  int ran = 0;
+  {
+    rcu_domain<> domain(&executor);
+    domain.call([&] { ++ran; });
+    domain.synchronize();
+    domain.synchronize();
+    EXPECT_EQ(0, ran);
+    EXPECT_GT(executor.run(), 0);
+    EXPECT_EQ(1, ran);
+
+    // Retired callbacks are batched into few executor tasks
+    for (int i = 0; i < 100; ++i) {
+      domain.call([&] { ++ran; });
+    }
+    domain.synchronize();
+    domain.synchronize();
+    EXPECT_LE(executor.run(), 2);
+    EXPECT_EQ(101, ran);
+
+    domain.call([&] { ++ran; });
+  }
+  // The domain's destructor ran the last one itself
+  EXPECT_EQ(102, ran);
+}
+
+TEST(RcuTest, MovedReader) {
+  rcu_domain<> domain;
+  rcu_reader_domain<> a(&domain);
+  rcu_reader_domain<> b(std::move(a));
+  EXPECT_FALSE(a.owns_lock());
+  EXPECT_TRUE(b.owns_lock());
+  b = rcu_reader_domain<>(std::defer_lock, &domain);
+  EXPECT_FALSE(b.owns_lock());
+  domain.synchronize();
+}
+
+TEST(RcuTest, Stress) {
+  struct Value {
+    explicit Value(int v) : value(v) {}
+    ~Value() {
+      value = -1;
+    }
+    std::atomic<int> value;
+  };
+
+  rcu_domain<> domain;
+  std::atomic<Value*> current{new Value(0)};
+  std::atomic<bool> stop{false};
+  std::atomic<bool> sawFreed{false};
+  std::atomic<int> started{0};
+
+  const int numReaders = 4;
+  std::vector<std::thread> readers;
+  for (int i = 0; i < numReaders; ++i) {
+    readers.emplace_back([&] {
+      ++started;
+      while (!stop) {
+        rcu_reader_domain<> guard(&domain);
+        auto v = current.load(std::memory_order_acquire);
+        for (int j = 0; j < 10; ++j) {
+          if (v->value.load() < 0) {
+            sawFreed = true;
+          }
+        }
+      }
+    });
+  }
+
+  while (started < numReaders) {
+    std::this_thread::yield();
+  }
+  for (int i = 1; i <= 2000; ++i) {
+    auto old = current.exchange(new Value(i), std::memory_order_acq_rel);
+    if (i % 2 == 0) {
+      rcu_retire(old, {}, &domain);
+    } else {
+      domain.synchronize();
+      delete old;
+    }
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_FALSE(sawFreed);
+  delete current.load();
+}
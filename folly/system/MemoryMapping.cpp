@@ -17,12 +17,17 @@
 #include <folly/system/MemoryMapping.h>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <folly/Format.h>
+#include <folly/futures/Future.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/SysMman.h>
+#include <folly/portability/SysSyscall.h>
 
 #ifdef __linux__
 #include <folly/experimental/io/HugePages.h>
@@ -53,6 +58,9 @@ DEFINE_int64(mlock_chunk_size, kDefaultMlockChunkSize,
 #define MAP_POPULATE 0
 #endif
 
+// Pages are faulted in by tasks of this many bytes
+static constexpr size_t kPrefaultChunkSize = 4 << 20;
+
 namespace folly {
 
 MemoryMapping::MemoryMapping(MemoryMapping&& other) noexcept {
@@ -97,6 +105,29 @@ void getDeviceOptions(dev_t device, off_t& pageSize, bool& autoExtend) {
 inline void getDeviceOptions(dev_t, off_t&, bool&) {}
 #endif
 
+void bindToNumaNode(void* start, size_t length, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr int kMpolBind = 2; // MPOL_BIND, from <numaif.h>
+  constexpr size_t kBitsPerWord = 8 * sizeof(unsigned long);
+  unsigned long nodeMask[1024 / kBitsPerWord] = {};
+  CHECK(node >= 0 && size_t(node) < 1024) << "invalid NUMA node " << node;
+  nodeMask[size_t(node) / kBitsPerWord] = 1UL << (size_t(node) % kBitsPerWord);
+  PLOG_IF(
+      WARNING,
+      syscall(
+          SYS_mbind,
+          start,
+          length,
+          kMpolBind,
+          nodeMask,
+          sizeof(nodeMask) * 8,
+          0) != 0)
+      << "mbind to NUMA node " << node;
+#else
+  (void)start, (void)length, (void)node;
+#endif
+}
+
 } // namespace
 
 void MemoryMapping::init(off_t offset, off_t length) {
@@ -180,7 +211,11 @@ void MemoryMapping::init(off_t offset, off_t length) {
     if (anon) {
       flags |= MAP_ANONYMOUS;
     }
-    if (options_.prefault) {
+    // Populating the page tables in mmap() would come before the memory
+    // policy and huge pages apply
+    const bool populateLater = options_.prefaultExecutor ||
+        options_.hugePages || options_.numaNode >= 0;
+    if (options_.prefault && !populateLater) {
       flags |= MAP_POPULATE;
     }
 
@@ -198,6 +233,18 @@ void MemoryMapping::init(off_t offset, off_t length) {
       << " length=" << mapLength_;
     mapStart_ = start;
     data_.reset(start + skipStart, size_t(length));
+
+    if (options_.numaNode >= 0) {
+      bindToNumaNode(mapStart_, size_t(mapLength_), options_.numaNode);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options_.hugePages) {
+      advise(MADV_HUGEPAGE);
+    }
+#endif
+    if (options_.prefault && populateLater) {
+      prefault(options_.prefaultExecutor);
+    }
   }
 }
 
@@ -351,6 +398,76 @@ void MemoryMapping::advise(int advice, size_t offset, size_t length) const {
   PLOG_IF(WARNING, ::madvise(mapStart, length, advice)) << "madvise";
 }
 
+void MemoryMapping::adviseAsync(
+    Executor* executor,
+    int advice,
+    size_t offset,
+    size_t length) const {
+  executor->add([this, advice, offset, length] {
+    advise(advice, offset, length);
+  });
+}
+
+void MemoryMapping::prefault(Executor* executor, size_t parallelism) const {
+  if (mapLength_ == 0) {
+    return;
+  }
+  CHECK(options_.readable || options_.writable)
+      << "can't prefault an inaccessible mapping";
+  auto const pageSize = size_t(options_.pageSize);
+  auto const length = size_t(mapLength_);
+  auto const chunkSize =
+      std::max(kPrefaultChunkSize / pageSize, size_t(1)) * pageSize;
+  auto const count = (length + chunkSize - 1) / chunkSize;
+  if (parallelism == 0) {
+    parallelism = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  if (!executor) {
+    parallelism = 1;
+  }
+  parallelism = std::min(parallelism, count);
+
+  auto const start = static_cast<unsigned char*>(mapStart_);
+  const bool file = bool(file_);
+  // Write faults on a file would dirty every page, or copy every page of a
+  // private mapping; read faults bring in the data, which is the slow part
+  const bool writeFault = !file && options_.writable;
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    size_t i;
+    while ((i = next.fetch_add(1)) < count) {
+      auto const begin = i * chunkSize;
+      auto const end = std::min(length, begin + chunkSize);
+      if (file) {
+        // Have the kernel read the whole chunk at once, rather than page by
+        // page as they're touched
+        ::madvise(start + begin, end - begin, MADV_WILLNEED);
+      }
+      for (auto pos = begin; pos < end; pos += pageSize) {
+        if (writeFault) {
+          // Without changing the data under concurrent writers
+          reinterpret_cast<std::atomic<unsigned char>*>(start + pos)
+              ->fetch_or(0, std::memory_order_relaxed);
+        } else {
+          (void)*static_cast<volatile unsigned char*>(start + pos);
+        }
+      }
+    }
+  };
+
+  if (parallelism <= 1) {
+    work();
+    return;
+  }
+  std::vector<Future<Unit>> futures;
+  futures.reserve(parallelism);
+  for (size_t i = 0; i < parallelism; ++i) {
+    futures.push_back(via(executor, work));
+  }
+  // Waits for all of them, as they use this frame
+  collectAll(futures).wait();
+}
+
 MemoryMapping& MemoryMapping::operator=(MemoryMapping other) {
   swap(other);
   return *this;
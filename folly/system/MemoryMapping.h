@@ -19,6 +19,7 @@
 #include <boost/noncopyable.hpp>
 #include <glog/logging.h>
 
+#include <folly/Executor.h>
 #include <folly/File.h>
 #include <folly/Range.h>
 
@@ -61,6 +62,12 @@ class MemoryMapping : boost::noncopyable {
     Options& setReadable(bool v) { readable = v; return *this; }
     Options& setWritable(bool v) { writable = v; return *this; }
     Options& setGrow(bool v) { grow = v; return *this; }
+    Options& setPrefaultExecutor(Executor* v) {
+      prefaultExecutor = v;
+      return *this;
+    }
+    Options& setHugePages(bool v) { hugePages = v; return *this; }
+    Options& setNumaNode(int v) { numaNode = v; return *this; }
 
     // Page size. 0 = use appropriate page size.
     // (On Linux, we use a huge page size if the file is on a hugetlbfs
@@ -78,6 +85,21 @@ class MemoryMapping : boost::noncopyable {
     // by page faults. This is a hint, as it may not be supported.
     bool prefault = false;
 
+    // With prefault, fault the pages in from tasks on this executor, as
+    // prefault() does, rather than serially in mmap() (MAP_POPULATE).  The
+    // constructor waits for them.
+    Executor* prefaultExecutor = nullptr;
+
+    // Ask for transparent huge pages (madvise(MADV_HUGEPAGE)), on Linux.
+    // A hint: mappings of most files don't get them.
+    bool hugePages = false;
+
+    // Bind the mapping's memory to this NUMA node (mbind(MPOL_BIND)), on
+    // Linux; -1 for the default policy.  Applies to anonymous and private
+    // mappings; the page cache pages of shared file mappings follow the
+    // policy of the thread that reads them in.  Failure is logged.
+    int numaNode = -1;
+
     // Map the pages readable. Note that mapping pages without read permissions
     // is not universally supported (not supported on hugetlbfs on Linux, for
     // example)
@@ -158,6 +180,29 @@ class MemoryMapping : boost::noncopyable {
   void advise(int advice) const;
   void advise(int advice, size_t offset, size_t length) const;
 
+  /**
+   * advise() from a task on the executor, returning right away: on files,
+   * madvise(MADV_WILLNEED) submits the reads before returning, which takes
+   * a while for large ranges.  The mapping must outlive the task.
+   */
+  void adviseAsync(
+      Executor* executor,
+      int advice,
+      size_t offset,
+      size_t length) const;
+
+  /**
+   * Fault in all the pages, from up to parallelism tasks on the executor
+   * (the number of CPUs by default), or from this thread, so that later
+   * accesses don't block on page faults.  For a file on disk, this keeps
+   * several reads in flight rather than one.  Writable anonymous mappings
+   * are faulted in for writing, without changing their contents.
+   *
+   * Blocks until done, so it mustn't be called from the threads of the
+   * executor.
+   */
+  void prefault(Executor* executor = nullptr, size_t parallelism = 0) const;
+
   /**
    * A bitwise cast of the mapped bytes as range of values. Only intended for
    * use with POD or in-place usable types.
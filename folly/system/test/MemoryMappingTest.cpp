@@ -15,9 +15,12 @@
  */
 
 #include <cstdlib>
+#include <vector>
 
 #include <folly/FileUtil.h>
 #include <folly/Random.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/ManualExecutor.h>
 #include <folly/portability/GTest.h>
 #include <folly/portability/SysMman.h>
 #include <folly/system/MemoryMapping.h>
@@ -174,6 +177,74 @@ TEST(MemoryMapping, Advise) {
   m.advise(MADV_NORMAL, off, size - off);
 
   EXPECT_DEATH(m.advise(MADV_NORMAL, off, size - off + 1), "");
+
+  ManualExecutor executor;
+  m.adviseAsync(&executor, MADV_WILLNEED, 1, size - 1);
+  EXPECT_EQ(1, executor.run());
+}
+
+namespace {
+
+size_t residentPages(const MemoryMapping& m) {
+  auto const pageSize = size_t(sysconf(_SC_PAGESIZE));
+  auto const range = m.range();
+  std::vector<unsigned char> pages((range.size() + pageSize - 1) / pageSize);
+  PCHECK(
+      mincore(
+          const_cast<unsigned char*>(range.data()),
+          range.size(),
+          pages.data()) == 0);
+  size_t resident = 0;
+  for (auto page : pages) {
+    resident += page & 1;
+  }
+  return resident;
+}
+
+} // namespace
+
+TEST(MemoryMapping, Prefault) {
+  auto const pageSize = size_t(sysconf(_SC_PAGESIZE));
+  size_t size = (10 << 20) + 10;
+  CPUThreadPoolExecutor executor(4);
+
+  MemoryMapping anon(
+      MemoryMapping::kAnonymous,
+      off_t(size),
+      MemoryMapping::Options()
+          .setWritable(true)
+          .setPrefault(true)
+          .setPrefaultExecutor(&executor));
+  EXPECT_EQ((size + pageSize - 1) / pageSize, residentPages(anon));
+  EXPECT_EQ(0, anon.range()[size - 1]);
+
+  File f = File::temporary();
+  std::string data(size, 'x');
+  data[size - 1] = 'y';
+  ASSERT_EQ(ssize_t(size), writeFull(f.fd(), data.data(), size));
+  MemoryMapping m(File(f.fd()));
+  m.prefault(&executor, 3);
+  EXPECT_EQ((size + pageSize - 1) / pageSize, residentPages(m));
+  EXPECT_EQ(data, m.data());
+  m.prefault();
+}
+
+TEST(MemoryMapping, HugePagesAndNumaNode) {
+  // Hints, which may not be honored
+  size_t size = 4 << 20;
+  MemoryMapping m(
+      MemoryMapping::kAnonymous,
+      off_t(size),
+      MemoryMapping::Options()
+          .setWritable(true)
+          .setHugePages(true)
+          .setNumaNode(0)
+          .setPrefault(true));
+  auto range = m.writableRange();
+  range[0] = 1;
+  range[size - 1] = 2;
+  EXPECT_EQ(1, m.range()[0]);
+  EXPECT_EQ(2, m.range()[size - 1]);
 }
 
 } // namespace folly
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/AdaptivePipeline.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+AdaptivePipelineOptions noTuning() {
+  AdaptivePipelineOptions options;
+  options.tuneInterval = std::chrono::milliseconds(0);
+  return options;
+}
+
+AdaptivePipelineStageOptions workers(size_t n) {
+  AdaptivePipelineStageOptions options;
+  options.initialWorkers = n;
+  return options;
+}
+
+} // namespace
+
+TEST(AdaptivePipeline, NoStages) {
+  auto pipeline = AdaptivePipelineBuilder<int>().build(noTuning());
+  EXPECT_EQ(0, pipeline->numStages());
+  pipeline->blockingWrite({1, 2});
+  pipeline->blockingWrite({3});
+  EXPECT_EQ(2, pipeline->sizeGuess());
+  EXPECT_EQ(std::vector<int>({1, 2}), pipeline->blockingRead());
+  std::vector<int> items;
+  EXPECT_TRUE(pipeline->read(items));
+  EXPECT_EQ(std::vector<int>({3}), items);
+  EXPECT_FALSE(pipeline->read(items));
+  EXPECT_EQ(0, pipeline->sizeGuess());
+}
+
+TEST(AdaptivePipeline, KeepsOrder) {
+  auto pipeline =
+      AdaptivePipelineBuilder<int>()
+          .addStage<std::string>(
+              [](int&& i) { return to<std::string>(i); }, workers(4))
+          .addStage<std::string>(
+              [](std::string&& s) {
+                // Later batches overtake earlier ones
+                std::this_thread::sleep_for(
+                    std::chrono::microseconds(s.size() * 37 % 100));
+                return s + "!";
+              },
+              workers(4))
+          .addStage<size_t>(
+              [](std::string&& s) { return s.size(); }, workers(2))
+          .build(noTuning());
+  EXPECT_EQ(3, pipeline->numStages());
+  EXPECT_EQ("stage1", pipeline->stageName(1));
+  EXPECT_EQ(4, pipeline->numWorkers(1));
+
+  constexpr int kBatches = 500;
+  std::thread writer([&] {
+    for (int i = 0; i < kBatches; ++i) {
+      pipeline->blockingWrite({i, i * 1000});
+    }
+  });
+  for (int i = 0; i < kBatches; ++i) {
+    auto batch = pipeline->blockingRead();
+    ASSERT_EQ(2, batch.size());
+    EXPECT_EQ(to<std::string>(i).size() + 1, batch[0]);
+    EXPECT_EQ(to<std::string>(i * 1000).size() + 1, batch[1]);
+  }
+  writer.join();
+}
+
+TEST(AdaptivePipeline, BatchStage) {
+  auto pipeline =
+      AdaptivePipelineBuilder<int>()
+          .addBatchStage<int>([](std::vector<int>&& items) {
+            // Drops odd items, and doubles the others
+            std::vector<int> result;
+            for (int i : items) {
+              if (i % 2 == 0) {
+                result.push_back(i);
+                result.push_back(i);
+              }
+            }
+            return result;
+          })
+          .build(noTuning());
+  pipeline->blockingWrite({1, 2, 3, 4});
+  pipeline->blockingWrite({5});
+  EXPECT_EQ(std::vector<int>({2, 2, 4, 4}), pipeline->blockingRead());
+  EXPECT_TRUE(pipeline->blockingRead().empty());
+}
+
+TEST(AdaptivePipeline, Exception) {
+  auto pipeline =
+      AdaptivePipelineBuilder<int>()
+          .addStage<int>([](int&& i) {
+            if (i == 2) {
+              throw std::runtime_error("two");
+            }
+            return i;
+          })
+          .addStage<int>([](int&& i) { return i + 1; })
+          .build(noTuning());
+  pipeline->blockingWrite({1});
+  pipeline->blockingWrite({2});
+  pipeline->blockingWrite({3});
+  EXPECT_EQ(std::vector<int>({2}), pipeline->blockingRead());
+  EXPECT_THROW(pipeline->blockingRead(), std::runtime_error);
+  EXPECT_EQ(std::vector<int>({4}), pipeline->blockingRead());
+}
+
+TEST(AdaptivePipeline, Tune) {
+  AdaptivePipelineStageOptions slow;
+  slow.name = "slow";
+  slow.maxWorkers = 3;
+  AdaptivePipelineOptions options = noTuning();
+  options.maxTotalWorkers = 4;
+  auto pipeline =
+      AdaptivePipelineBuilder<int>()
+          .addStage<int>([](int&& i) { return i; })
+          .addStage<int>(
+              [](int&& i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                return i;
+              },
+              slow)
+          .addStage<int>([](int&& i) { return i; })
+          .build(options);
+  EXPECT_EQ("slow", pipeline->stageName(1));
+
+  // Nothing waiting: nothing to do
+  EXPECT_FALSE(pipeline->tune());
+
+  for (int i = 0; i < 100; ++i) {
+    pipeline->blockingWrite({i});
+  }
+  while (pipeline->queueSize(1) < 50) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(pipeline->tune());
+  EXPECT_EQ(2, pipeline->numWorkers(1));
+  // maxTotalWorkers reached, and the other stages have their minimum
+  EXPECT_FALSE(pipeline->tune());
+  EXPECT_EQ(2, pipeline->numWorkers(1));
+
+  // Taken from a stage with room to shrink
+  pipeline->setNumWorkers(2, 2);
+  pipeline->setNumWorkers(1, 1);
+  EXPECT_TRUE(pipeline->tune());
+  EXPECT_EQ(2, pipeline->numWorkers(1));
+  EXPECT_EQ(1, pipeline->numWorkers(2));
+
+  // Clamped to maxWorkers
+  pipeline->setNumWorkers(1, 10);
+  EXPECT_EQ(3, pipeline->numWorkers(1));
+
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(std::vector<int>({i}), pipeline->blockingRead());
+  }
+}
+
+TEST(AdaptivePipeline, TuneInBackground) {
+  AdaptivePipelineOptions options;
+  options.tuneInterval = std::chrono::milliseconds(1);
+  options.maxTotalWorkers = 6;
+  auto pipeline =
+      AdaptivePipelineBuilder<int>()
+          .addStage<int>([](int&& i) { return i; })
+          .addStage<int>([](int&& i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return i;
+          })
+          .build(options);
+  for (int i = 0; i < 200; ++i) {
+    pipeline->blockingWrite({i});
+  }
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(std::vector<int>({i}), pipeline->blockingRead());
+  }
+  EXPECT_GT(pipeline->numWorkers(1), 1);
+}
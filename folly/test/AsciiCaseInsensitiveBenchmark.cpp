@@ -111,6 +111,44 @@ BENCHMARK(CurrentCaseInsensitiveCheck, iters) {
   test_operator_on_search<AsciiCaseInsensitive>(iters);
 }
 
+BENCHMARK(IfindCaseInsensitiveCheck, iters) {
+  int dummy = 0;
+  for (unsigned i = 0; i < iters; ++i) {
+    dummy += ifind(lorem_ipsum, needle);
+  }
+  doNotOptimizeAway(dummy);
+}
+
+BENCHMARK(NeedleCaseInsensitiveCheck, iters) {
+  CaseInsensitiveNeedle n(needle);
+  int dummy = 0;
+  for (unsigned i = 0; i < iters; ++i) {
+    dummy += n.find(lorem_ipsum);
+  }
+  doNotOptimizeAway(dummy);
+}
+
+BENCHMARK_DRAW_LINE();
+
+const string header = "Access-Control-Allow-Credentials";
+const string headerUpper = "ACCESS-CONTROL-ALLOW-CREDENTIALS";
+
+BENCHMARK(EqualsCaseInsensitive, iters) {
+  int dummy = 0;
+  for (unsigned i = 0; i < iters; ++i) {
+    dummy += StringPiece(header).equals(headerUpper, AsciiCaseInsensitive());
+    doNotOptimizeAway(dummy);
+  }
+}
+
+BENCHMARK(CaseInsensitiveEqual, iters) {
+  int dummy = 0;
+  for (unsigned i = 0; i < iters; ++i) {
+    dummy += caseInsensitiveEqual(header, headerUpper);
+    doNotOptimizeAway(dummy);
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
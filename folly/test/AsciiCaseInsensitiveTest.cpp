@@ -19,6 +19,8 @@
 #include <folly/portability/GFlags.h>
 #include <folly/portability/GTest.h>
 #include <algorithm>
+#include <random>
+#include <string>
 
 using namespace std;
 using namespace folly;
@@ -31,6 +33,100 @@ TEST(CaseInsensitiveMatch, CompareWithLegacy) {
   }
 }
 
+namespace {
+
+size_t referenceFind(StringPiece haystack, StringPiece needle) {
+  auto it = std::search(haystack.begin(), haystack.end(),
+                        needle.begin(), needle.end(), AsciiCaseInsensitive());
+  return it == haystack.end() && !needle.empty()
+      ? std::string::npos
+      : size_t(it - haystack.begin());
+}
+
+} // namespace
+
+TEST(CaseInsensitiveMatch, AllBytes) {
+  AsciiCaseInsensitive cmp;
+  // Every pair of bytes, at every position of strings long enough to take
+  // each code path
+  for (size_t len : {1, 7, 8, 15, 16, 17, 33}) {
+    for (size_t pos : {size_t(0), len / 2, len - 1}) {
+      std::string a(len, 'x');
+      std::string b(len, 'X');
+      for (int i = 0; i < 256; ++i) {
+        for (int j = 0; j < 256; ++j) {
+          a[pos] = char(i);
+          b[pos] = char(j);
+          ASSERT_EQ(cmp(char(i), char(j)), caseInsensitiveEqual(a, b))
+              << len << " " << pos << " " << i << " " << j;
+        }
+      }
+    }
+  }
+}
+
+TEST(CaseInsensitiveMatch, Equal) {
+  EXPECT_TRUE(caseInsensitiveEqual("", ""));
+  EXPECT_TRUE(caseInsensitiveEqual("Content-Length", "content-length"));
+  EXPECT_FALSE(caseInsensitiveEqual("Content-Length", "content-lengths"));
+  EXPECT_FALSE(caseInsensitiveEqual("Content-Length", "content_length"));
+  EXPECT_TRUE(caseInsensitiveEqual("@[`{", "@[`{"));
+  EXPECT_FALSE(caseInsensitiveEqual("@", "`"));
+  EXPECT_FALSE(caseInsensitiveEqual("[", "{"));
+
+  EXPECT_TRUE(caseInsensitiveStartsWith("Content-Length", "CONTENT-"));
+  EXPECT_TRUE(caseInsensitiveStartsWith("Content-Length", ""));
+  EXPECT_FALSE(caseInsensitiveStartsWith("Content", "Content-Length"));
+  EXPECT_TRUE(caseInsensitiveEndsWith("Content-Length", "-LENGTH"));
+  EXPECT_FALSE(caseInsensitiveEndsWith("Content-Length", "-LENGTHS"));
+}
+
+TEST(CaseInsensitiveMatch, Find) {
+  EXPECT_EQ(0, ifind("", ""));
+  EXPECT_EQ(0, ifind("abc", ""));
+  EXPECT_EQ(std::string::npos, ifind("", "a"));
+  EXPECT_EQ(std::string::npos, ifind("ab", "abc"));
+  EXPECT_EQ(2, ifind("xxHOST: a", "host"));
+  EXPECT_EQ(2, qfind(StringPiece("xxHOST: a"), StringPiece("host"),
+                     AsciiCaseInsensitive()));
+
+  std::mt19937 rng(1234);
+  // A small alphabet so that partial matches are frequent
+  const char alphabet[] = "aAbB-";
+  std::uniform_int_distribution<size_t> letter(0, sizeof(alphabet) - 2);
+  for (int iter = 0; iter < 2000; ++iter) {
+    std::string haystack(std::uniform_int_distribution<size_t>(0, 200)(rng),
+                         'a');
+    for (auto& c : haystack) {
+      c = alphabet[letter(rng)];
+    }
+    std::string needle(std::uniform_int_distribution<size_t>(0, 8)(rng), 'a');
+    for (auto& c : needle) {
+      c = alphabet[letter(rng)];
+    }
+    auto expected = referenceFind(haystack, needle);
+    ASSERT_EQ(expected, ifind(haystack, needle)) << haystack << " " << needle;
+    ASSERT_EQ(expected, CaseInsensitiveNeedle(needle).find(haystack))
+        << haystack << " " << needle;
+  }
+}
+
+TEST(CaseInsensitiveMatch, Needle) {
+  CaseInsensitiveNeedle host("Host");
+  EXPECT_EQ("host", host.str());
+  EXPECT_EQ(4, host.size());
+  EXPECT_TRUE(host.matches("HOST"));
+  EXPECT_TRUE(host.matches("host"));
+  EXPECT_FALSE(host.matches("hostname"));
+  EXPECT_TRUE(host.isPrefixOf("hostname"));
+  EXPECT_FALSE(host.isPrefixOf("hos"));
+
+  std::string buffer(1000, '.');
+  buffer.replace(700, 6, "\r\nhOsT");
+  EXPECT_EQ(702, host.find(buffer));
+  EXPECT_EQ(std::string::npos, host.find(StringPiece(buffer).subpiece(0, 705)));
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
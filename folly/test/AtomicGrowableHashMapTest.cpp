@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/AtomicGrowableHashMap.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using folly::AtomicGrowableHashMap;
+
+TEST(AtomicGrowableHashMap, Basic) {
+  AtomicGrowableHashMap<int64_t, std::string> map(16);
+  EXPECT_TRUE(map.begin() == map.end());
+  EXPECT_TRUE(map.empty());
+
+  for (int64_t i = 0; i < 10; ++i) {
+    auto ret = map.insert(i, folly::to<std::string>(i));
+    EXPECT_TRUE(ret.second);
+    EXPECT_EQ(i, ret.first->first);
+  }
+  auto ret = map.insert(3, "x");
+  EXPECT_FALSE(ret.second);
+  EXPECT_EQ("3", ret.first->second);
+
+  EXPECT_EQ(10, map.size());
+  EXPECT_EQ("7", map.find(7)->second);
+  EXPECT_TRUE(map.find(10) == map.end());
+  EXPECT_EQ(1, map.count(2));
+
+  EXPECT_EQ(1, map.erase(2));
+  EXPECT_EQ(0, map.erase(2));
+  EXPECT_EQ(0, map.count(2));
+  EXPECT_EQ(9, map.size());
+
+  const auto& cmap = map;
+  EXPECT_EQ("5", cmap.find(5)->second);
+  AtomicGrowableHashMap<int64_t, std::string>::const_iterator it =
+      map.find(5);
+  EXPECT_TRUE(it == cmap.find(5));
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(AtomicGrowableHashMap, Grow) {
+  AtomicGrowableHashMap<int32_t, int32_t> map(100);
+  size_t initialCapacity = map.capacity();
+  constexpr int32_t kNum = 100000;
+  for (int32_t i = 0; i < kNum; ++i) {
+    EXPECT_TRUE(map.insert(i, i * 2).second);
+  }
+  EXPECT_EQ(kNum, map.size());
+  EXPECT_GT(map.numMigrations(), 5);
+  EXPECT_GT(map.capacity(), initialCapacity * 500);
+  for (int32_t i = 0; i < kNum; ++i) {
+    auto it = map.find(i);
+    ASSERT_TRUE(it != map.end());
+    EXPECT_EQ(i * 2, it->second);
+  }
+  EXPECT_TRUE(map.find(kNum) == map.end());
+
+  int64_t sum = 0;
+  size_t count = 0;
+  for (auto& entry : map) {
+    EXPECT_EQ(entry.first * 2, entry.second);
+    sum += entry.first;
+    ++count;
+  }
+  EXPECT_EQ(kNum, count);
+  EXPECT_EQ(int64_t(kNum) * (kNum - 1) / 2, sum);
+}
+
+TEST(AtomicGrowableHashMap, ReferencesSurviveGrowth) {
+  AtomicGrowableHashMap<int64_t, std::string> map(10);
+  auto it = map.insert(1, "one").first;
+  const std::string& one = it->second;
+  for (int64_t i = 2; i < 1000; ++i) {
+    map.insert(i, "other");
+  }
+  EXPECT_GT(map.numMigrations(), 0);
+  EXPECT_EQ("one", one);
+  EXPECT_EQ("one", map.find(1)->second);
+
+  map.reclaimRetired();
+  EXPECT_EQ("one", map.find(1)->second);
+  EXPECT_EQ(999, map.size());
+}
+
+TEST(AtomicGrowableHashMap, ReusesTombstones) {
+  AtomicGrowableHashMap<int64_t, int64_t> map(1000);
+  size_t capacity = map.capacity();
+  // An AtomicHashMap would have run out of sub-maps long before
+  for (int64_t i = 0; i < 1000000; ++i) {
+    ASSERT_TRUE(map.insert(i, i).second);
+    if (i >= 100) {
+      ASSERT_EQ(1, map.erase(i - 100));
+    }
+  }
+  EXPECT_EQ(100, map.size());
+  EXPECT_EQ(capacity, map.capacity());
+  EXPECT_GT(map.numMigrations(), 1000);
+  for (int64_t i = 1000000 - 100; i < 1000000; ++i) {
+    EXPECT_EQ(i, map.find(i)->second);
+  }
+}
+
+TEST(AtomicGrowableHashMap, ConcurrentInsertFind) {
+  AtomicGrowableHashMap<int64_t, int64_t> map(64);
+  constexpr int kThreads = 8;
+  constexpr int64_t kPerThread = 20000;
+  std::atomic<bool> done{false};
+  std::atomic<size_t> misreads{0};
+
+  // Readers check that whatever they find has the right value, and that
+  // an entry inserted before any growth is always found
+  constexpr int64_t kFirst = kThreads * kPerThread;
+  map.insert(kFirst, -2);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        auto it = map.find(kFirst);
+        if (it == map.end() || it->second != -2) {
+          ++misreads;
+        }
+        for (int64_t i = 0; i < 1000; ++i) {
+          auto found = map.find(i * 7);
+          if (found != map.end() && found->second != i * 14) {
+            ++misreads;
+          }
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&, t] {
+      for (int64_t i = t; i < kThreads * kPerThread; i += kThreads) {
+        map.insert(i, i * 2);
+        if (i % 3 == 0) {
+          map.erase(i);
+        }
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+  done = true;
+  for (auto& r : readers) {
+    r.join();
+  }
+
+  EXPECT_EQ(0, misreads.load());
+  EXPECT_GT(map.numMigrations(), 5);
+  size_t expected = 1;
+  for (int64_t i = 0; i < kThreads * kPerThread; ++i) {
+    auto it = map.find(i);
+    if (i % 3 == 0) {
+      EXPECT_TRUE(it == map.end());
+    } else {
+      ASSERT_TRUE(it != map.end());
+      EXPECT_EQ(i * 2, it->second);
+      ++expected;
+    }
+  }
+  EXPECT_EQ(expected, map.size());
+}
+
+TEST(AtomicGrowableHashMap, ConcurrentInsertSameKeys) {
+  AtomicGrowableHashMap<int64_t, int64_t> map(16);
+  constexpr int kThreads = 4;
+  constexpr int64_t kNum = 100000;
+  std::atomic<int64_t> inserted{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int64_t i = 0; i < kNum; ++i) {
+        auto ret = map.insert(i, t);
+        if (ret.second) {
+          ++inserted;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // Each key was inserted once, whichever thread won
+  EXPECT_EQ(kNum, inserted.load());
+  EXPECT_EQ(kNum, map.size());
+}
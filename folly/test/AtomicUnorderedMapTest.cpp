@@ -20,10 +20,14 @@
 #include <thread>
 #include <unordered_map>
 
+#include <sys/wait.h>
+
 #include <folly/Benchmark.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/GTest.h>
 #include <folly/portability/Semaphore.h>
+#include <folly/system/MemoryMapping.h>
 #include <folly/test/DeterministicSchedule.h>
 
 using namespace folly;
@@ -184,6 +188,86 @@ TEST(UnorderedInsertMap, value_mutation) {
   EXPECT_EQ(m.find(1)->second.data, 2);
 }
 
+namespace {
+using SharedMap = AtomicUnorderedInsertMap<int64_t, int64_t>;
+
+MemoryMapping mapShared(const TemporaryFile& file, size_t maxSize) {
+  return MemoryMapping(
+      file.fd(),
+      0,
+      off_t(SharedMap::sharedMemorySize(maxSize)),
+      MemoryMapping::writable().setShared(true));
+}
+} // namespace
+
+TEST(AtomicUnorderedInsertMap, shared_memory_survives_restart) {
+  TemporaryFile file;
+  {
+    auto mapping = mapShared(file, 1000);
+    SharedMap m(mapping.writableRange(), 1000);
+    for (int64_t i = 0; i < 500; ++i) {
+      EXPECT_TRUE(m.emplace(i, i * 10).second);
+    }
+  }
+  {
+    auto mapping = mapShared(file, 1000);
+    SharedMap m(mapping.writableRange(), 1000);
+    for (int64_t i = 0; i < 500; ++i) {
+      EXPECT_EQ(i * 10, m.find(i)->second);
+    }
+    EXPECT_TRUE(m.find(500) == m.cend());
+    EXPECT_FALSE(m.emplace(7, 0).second);
+    EXPECT_TRUE(m.emplace(500, 5000).second);
+    size_t count = 0;
+    for (auto it = m.cbegin(); it != m.cend(); ++it) {
+      ++count;
+    }
+    EXPECT_EQ(501, count);
+  }
+}
+
+TEST(AtomicUnorderedInsertMap, shared_memory_between_processes) {
+  TemporaryFile file;
+  auto mapping = mapShared(file, 10000);
+  SharedMap m(mapping.writableRange(), 10000);
+  m.emplace(-1, -10);
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    // A separate mapping, at another address
+    auto childMapping = mapShared(file, 10000);
+    SharedMap child(childMapping.writableRange(), 10000);
+    bool ok = child.find(-1)->second == -10;
+    for (int64_t i = 0; i < 5000; ++i) {
+      ok = child.emplace(i, i * 10).second && ok;
+    }
+    _exit(ok ? 0 : 1);
+  }
+  for (int64_t i = 5000; i < 8000; ++i) {
+    m.emplace(i, i * 10);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  for (int64_t i = 0; i < 8000; ++i) {
+    EXPECT_EQ(i * 10, m.find(i)->second);
+  }
+}
+
+TEST(AtomicUnorderedInsertMap, shared_memory_mismatch) {
+  TemporaryFile file;
+  auto mapping = mapShared(file, 2000);
+  { SharedMap m(mapping.writableRange(), 1000); }
+  EXPECT_THROW(
+      SharedMap(mapping.writableRange(), 2000), std::invalid_argument);
+  EXPECT_THROW(
+      SharedMap(mapping.writableRange().subpiece(0, 100), 1000),
+      std::invalid_argument);
+  SharedMap m(mapping.writableRange(), 1000);
+}
+
 // This test is too expensive to run automatically.  On my dev server it
 // takes about 10 minutes for dbg build, 2 for opt.
 TEST(AtomicUnorderedInsertMap, DISABLED_mega_map) {
@@ -67,6 +67,41 @@ BENCHMARK(baton_pingpong_emulated_futex_multi_poster_nonblocking, iters) {
 
 BENCHMARK_DRAW_LINE()
 
+// Ping-pong with a spin budget smaller than the handoff latency, so every
+// wait blocks, and with the default budget
+template <uint32_t Spins>
+static void spinBudgetPingpong(size_t iters) {
+  Baton<> a;
+  Baton<> b;
+  auto thr = std::thread([&] {
+    for (size_t i = 0; i < iters; ++i) {
+      a.waitWithSpins(Spins);
+      a.reset();
+      b.post();
+    }
+  });
+  for (size_t i = 0; i < iters; ++i) {
+    a.post();
+    b.waitWithSpins(Spins);
+    b.reset();
+  }
+  thr.join();
+}
+
+BENCHMARK(baton_pingpong_spin_0, iters) {
+  spinBudgetPingpong<0>(iters);
+}
+
+BENCHMARK(baton_pingpong_spin_300, iters) {
+  spinBudgetPingpong<300>(iters);
+}
+
+BENCHMARK(baton_pingpong_spin_3000, iters) {
+  spinBudgetPingpong<3000>(iters);
+}
+
+BENCHMARK_DRAW_LINE()
+
 BENCHMARK(posix_sem_pingpong, iters) {
   sem_t sems[3];
   sem_t* a = sems + 0;
@@ -283,3 +283,30 @@ TEST(Baton, multi_producer_multi_poster_nonblocking) {
   run_try_wait_tests<EmulatedFutexAtomic, false, false>();
   run_try_wait_tests<DeterministicAtomic, false, false>();
 }
+
+/// Spin budget tests
+
+TEST(Baton, wait_with_spins) {
+  Baton<> early;
+  early.post();
+  EXPECT_EQ(0, early.waitWithSpins(10));
+
+  // Nothing to spin for, so it blocks until the post
+  Baton<> late;
+  auto thr = std::thread([&] {
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds(10));
+    late.post();
+  });
+  EXPECT_EQ(0, late.waitWithSpins(0));
+  thr.join();
+
+  Baton<> late2;
+  thr = std::thread([&] {
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds(10));
+    late2.post();
+  });
+  EXPECT_EQ(5, late2.waitWithSpins(5));
+  thr.join();
+}
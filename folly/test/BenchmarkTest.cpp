@@ -18,6 +18,7 @@
 #include <folly/String.h>
 #include <folly/container/Foreach.h>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <numeric>
 #include <random>
@@ -360,6 +361,15 @@ BENCHMARK(BenchmarkSuspender_dismissing_value, iter) {
   }
 }
 
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_THREADS(threadsSharedCounter, 4, iter) {
+  static std::atomic<size_t> counter{0};
+  while (iter--) {
+    counter.fetch_add(1);
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   runBenchmarks();
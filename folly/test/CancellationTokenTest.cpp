@@ -0,0 +1,188 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/CancellationToken.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(CancellationToken, defaultTokenIsNeverCancelled) {
+  CancellationToken token;
+  EXPECT_FALSE(token.isCancellationRequested());
+  EXPECT_FALSE(token.canBeCancelled());
+
+  bool called = false;
+  CancellationCallback cb(token, [&] { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST(CancellationToken, requestCancellation) {
+  CancellationSource source;
+  auto token = source.getToken();
+  EXPECT_TRUE(token.canBeCancelled());
+  EXPECT_FALSE(token.isCancellationRequested());
+  EXPECT_EQ(token, source.getToken());
+  EXPECT_NE(token, CancellationToken());
+
+  EXPECT_FALSE(source.requestCancellation());
+  EXPECT_TRUE(token.isCancellationRequested());
+  EXPECT_TRUE(source.isCancellationRequested());
+  EXPECT_TRUE(source.requestCancellation());
+}
+
+TEST(CancellationToken, sourceDestroyedWithoutCancelling) {
+  CancellationToken token;
+  {
+    CancellationSource source;
+    token = source.getToken();
+    auto copy = source;
+    EXPECT_TRUE(token.canBeCancelled());
+  }
+  EXPECT_FALSE(token.canBeCancelled());
+  EXPECT_FALSE(token.isCancellationRequested());
+
+  CancellationToken cancelled;
+  {
+    CancellationSource source;
+    cancelled = source.getToken();
+    source.requestCancellation();
+  }
+  EXPECT_TRUE(cancelled.canBeCancelled());
+  EXPECT_TRUE(cancelled.isCancellationRequested());
+}
+
+TEST(CancellationToken, invalidSource) {
+  auto source = CancellationSource::invalid();
+  EXPECT_FALSE(source.canBeCancelled());
+  EXPECT_FALSE(source.requestCancellation());
+  EXPECT_EQ(CancellationToken(), source.getToken());
+}
+
+TEST(CancellationToken, callbacksRunInReverseOrder) {
+  CancellationSource source;
+  std::vector<int> order;
+  CancellationCallback cb1(source.getToken(), [&] { order.push_back(1); });
+  CancellationCallback cb2(source.getToken(), [&] { order.push_back(2); });
+  EXPECT_TRUE(order.empty());
+
+  source.requestCancellation();
+  EXPECT_EQ((std::vector<int>{2, 1}), order);
+
+  source.requestCancellation();
+  EXPECT_EQ(2, order.size());
+}
+
+TEST(CancellationToken, callbackAfterCancellationRunsInline) {
+  CancellationSource source;
+  source.requestCancellation();
+
+  bool called = false;
+  CancellationCallback cb(source.getToken(), [&] { called = true; });
+  EXPECT_TRUE(called);
+}
+
+TEST(CancellationToken, destroyedCallbackDoesNotRun) {
+  CancellationSource source;
+  bool called = false;
+  {
+    CancellationCallback cb(source.getToken(), [&] { called = true; });
+  }
+  source.requestCancellation();
+  EXPECT_FALSE(called);
+}
+
+TEST(CancellationToken, callbackDestroysItself) {
+  CancellationSource source;
+  std::unique_ptr<CancellationCallback> cb;
+  int calls = 0;
+  cb = std::make_unique<CancellationCallback>(source.getToken(), [&] {
+    ++calls;
+    cb.reset();
+  });
+  CancellationCallback other(source.getToken(), [&] { ++calls; });
+  source.requestCancellation();
+  EXPECT_EQ(2, calls);
+  EXPECT_EQ(nullptr, cb);
+}
+
+TEST(CancellationToken, callbackDestroysAnotherCallback) {
+  CancellationSource source;
+  auto first = std::make_unique<bool>(false);
+  std::unique_ptr<CancellationCallback> cb1 =
+      std::make_unique<CancellationCallback>(
+          source.getToken(), [&] { *first = true; });
+  CancellationCallback cb2(source.getToken(), [&] { cb1.reset(); });
+  source.requestCancellation();
+  EXPECT_FALSE(*first);
+}
+
+TEST(CancellationToken, destructorWaitsForRunningCallback) {
+  CancellationSource source;
+  std::atomic<bool> started{false};
+  std::atomic<bool> finished{false};
+  auto cb = std::make_unique<CancellationCallback>(source.getToken(), [&] {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    finished = true;
+  });
+
+  std::thread t([&] { source.requestCancellation(); });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  cb.reset();
+  EXPECT_TRUE(finished);
+  t.join();
+}
+
+TEST(CancellationToken, concurrentRegistration) {
+  constexpr int kThreads = 8;
+  constexpr int kIters = 1000;
+  for (int round = 0; round < 10; ++round) {
+    CancellationSource source;
+    std::atomic<int> calls{0};
+    std::atomic<int> notCalled{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < kIters; ++j) {
+          bool called = false;
+          {
+            CancellationCallback cb(source.getToken(), [&] {
+              called = true;
+              ++calls;
+            });
+          }
+          if (!called) {
+            ++notCalled;
+          }
+        }
+      });
+    }
+    source.requestCancellation();
+    for (auto& t : threads) {
+      t.join();
+    }
+    EXPECT_EQ(kThreads * kIters, calls + notCalled);
+  }
+}
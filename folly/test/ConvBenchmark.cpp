@@ -20,6 +20,7 @@
 
 #include <folly/Benchmark.h>
 #include <folly/CppAttributes.h>
+#include <folly/String.h>
 #include <folly/container/Foreach.h>
 
 #include <array>
@@ -1124,6 +1125,146 @@ FLOAT_TO_ARITH_BENCHMARK(int, Int, double2IntGood, double2IntBad)
 #undef INT_TO_ARITH_BENCHMARK
 #undef FLOAT_TO_ARITH_BENCHMARK
 
+using double_conversion::DoubleToStringConverter;
+
+namespace folly {
+namespace conv_bench_detail {
+
+// Short and full precision values, as found in JSON and logs
+std::array<double, 8> doubles = {{0.1,
+                                   1.5,
+                                   -273.15,
+                                   345345345.435,
+                                   6.02214076e23,
+                                   1.0 / 3,
+                                   2.718281828459045,
+                                   -4.9406564584124654e-324}};
+
+// The conversions as they were done before folly/detail/Dtoa.h
+std::string doubleConversion(
+    double d,
+    DoubleToStringConverter::DtoaMode mode,
+    int digits) {
+  using double_conversion::StringBuilder;
+  DoubleToStringConverter conv(
+      DoubleToStringConverter::NO_FLAGS, "Infinity", "NaN", 'E', -6, 21, 6, 1);
+  char buf[128];
+  StringBuilder builder(buf, sizeof(buf));
+  switch (mode) {
+    case DoubleToStringConverter::SHORTEST:
+      conv.ToShortest(d, &builder);
+      break;
+    case DoubleToStringConverter::SHORTEST_SINGLE:
+      conv.ToShortestSingle(float(d), &builder);
+      break;
+    default:
+      conv.ToFixed(d, digits, &builder);
+      break;
+  }
+  return std::string(buf, size_t(builder.position()));
+}
+
+std::string dtoa(
+    double d,
+    DoubleToStringConverter::DtoaMode mode,
+    int digits) {
+  std::string s;
+  if (mode == DoubleToStringConverter::SHORTEST_SINGLE) {
+    toAppend(float(d), &s, mode, unsigned(digits));
+  } else {
+    toAppend(d, &s, mode, unsigned(digits));
+  }
+  return s;
+}
+
+template <class F>
+void doubleToStringBM(
+    unsigned int n,
+    F f,
+    DoubleToStringConverter::DtoaMode mode,
+    int digits) {
+  FOR_EACH_RANGE (i, 0, n) {
+    doNotOptimizeAway(f(doubles[i % doubles.size()], mode, digits).size());
+  }
+}
+
+} // namespace conv_bench_detail
+} // namespace folly
+
+BENCHMARK(doubleToStringShortestDoubleConversion, n) {
+  doubleToStringBM(
+      n, doubleConversion, DoubleToStringConverter::SHORTEST, 0);
+}
+
+BENCHMARK_RELATIVE(doubleToStringShortest, n) {
+  doubleToStringBM(n, dtoa, DoubleToStringConverter::SHORTEST, 0);
+}
+
+BENCHMARK(floatToStringShortestDoubleConversion, n) {
+  doubleToStringBM(
+      n, doubleConversion, DoubleToStringConverter::SHORTEST_SINGLE, 0);
+}
+
+BENCHMARK_RELATIVE(floatToStringShortest, n) {
+  doubleToStringBM(
+      n, dtoa, DoubleToStringConverter::SHORTEST_SINGLE, 0);
+}
+
+BENCHMARK(doubleToStringFixedDoubleConversion, n) {
+  doubleToStringBM(
+      n, doubleConversion, DoubleToStringConverter::FIXED, 6);
+}
+
+BENCHMARK_RELATIVE(doubleToStringFixed, n) {
+  doubleToStringBM(n, dtoa, DoubleToStringConverter::FIXED, 6);
+}
+BENCHMARK_DRAW_LINE();
+
+namespace folly {
+namespace conv_bench_detail {
+
+// 1000 comma separated integers of all lengths
+std::string integerCsv = [] {
+  std::string csv;
+  uint64_t x = 1;
+  for (int i = 0; i < 1000; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    toAppend(i ? "," : "", x >> (x % 64), &csv);
+  }
+  return csv;
+}();
+
+} // namespace conv_bench_detail
+} // namespace folly
+
+BENCHMARK(integersSplitAndTo, n) {
+  std::vector<StringPiece> fields;
+  FOR_EACH_RANGE (i, 0, n) {
+    fields.clear();
+    split(',', integerCsv, fields);
+    uint64_t sum = 0;
+    for (auto field : fields) {
+      sum += to<uint64_t>(field);
+    }
+    doNotOptimizeAway(sum);
+  }
+}
+
+BENCHMARK_RELATIVE(integersToIntegers, n) {
+  FOR_EACH_RANGE (i, 0, n) {
+    doNotOptimizeAway(toIntegers<uint64_t>(integerCsv, ',').size());
+  }
+}
+
+BENCHMARK_RELATIVE(integersTryToIntegers, n) {
+  uint64_t values[1000];
+  FOR_EACH_RANGE (i, 0, n) {
+    StringPiece src = integerCsv;
+    doNotOptimizeAway(tryToIntegers(&src, ',', values, 1000).value());
+  }
+}
+BENCHMARK_DRAW_LINE();
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -26,7 +26,11 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <limits>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <tuple>
@@ -564,6 +568,129 @@ TEST(Conv, DoubleToString) {
   testDoubleToString<fbstring>();
 }
 
+TEST(Conv, DoubleToStringShortest) {
+  EXPECT_EQ("0.1", to<string>(0.1));
+  EXPECT_EQ("-0", to<string>(-0.0));
+  EXPECT_EQ("123456", to<string>(123456.0));
+  EXPECT_EQ("100000000000000000000", to<string>(1e20));
+  EXPECT_EQ("1E21", to<string>(1e21));
+  EXPECT_EQ("0.000001", to<string>(1e-6));
+  EXPECT_EQ("1.5E-7", to<string>(1.5e-7));
+  EXPECT_EQ("5E-324", to<string>(4.9406564584124654e-324));
+  EXPECT_EQ(
+      "1.7976931348623157E308", to<string>(numeric_limits<double>::max()));
+  EXPECT_EQ("2.2250738585072014E-308", to<string>(2.2250738585072014e-308));
+  EXPECT_EQ("Infinity", to<string>(numeric_limits<double>::infinity()));
+  EXPECT_EQ("-Infinity", to<string>(-numeric_limits<double>::infinity()));
+  EXPECT_EQ("NaN", to<string>(numeric_limits<double>::quiet_NaN()));
+
+  std::mt19937_64 rng(1234);
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t bits = rng();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (std::isnan(d) || std::isinf(d)) {
+      continue;
+    }
+    // The output parses back to the same value
+    auto s = to<string>(d);
+    double back = to<double>(s);
+    EXPECT_EQ(0, memcmp(&d, &back, sizeof(d))) << s;
+    // With as few digits as printf needs
+    int digits = 1;
+    char buf[32];
+    for (;; ++digits) {
+      snprintf(buf, sizeof(buf), "%.*e", digits - 1, d);
+      if (strtod(buf, nullptr) == d) {
+        break;
+      }
+    }
+    auto decimal = detail::shortestDecimal(std::fabs(d));
+    EXPECT_EQ(digits, to<string>(decimal.mantissa).size()) << s;
+  }
+}
+
+TEST(Conv, FloatToStringShortest) {
+  auto shortest = [](float f) {
+    string s;
+    toAppend(
+        f, &s, double_conversion::DoubleToStringConverter::SHORTEST_SINGLE, 0);
+    return s;
+  };
+  EXPECT_EQ("0.1", shortest(0.1f));
+  EXPECT_EQ("16777216", shortest(16777216.0f));
+  EXPECT_EQ("3.4028235E38", shortest(numeric_limits<float>::max()));
+  EXPECT_EQ("1E-45", shortest(numeric_limits<float>::denorm_min()));
+  EXPECT_EQ("-Infinity", shortest(-numeric_limits<float>::infinity()));
+
+  std::mt19937 rng(1234);
+  for (int i = 0; i < 100000; ++i) {
+    uint32_t bits = rng();
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    if (std::isnan(f) || std::isinf(f)) {
+      continue;
+    }
+    auto s = shortest(f);
+    float back = to<float>(s);
+    EXPECT_EQ(0, memcmp(&f, &back, sizeof(f))) << s;
+  }
+}
+
+TEST(Conv, DoubleToStringFixed) {
+  auto fixed = [](double d, unsigned int digits) {
+    string s;
+    toAppend(
+        d, &s, double_conversion::DoubleToStringConverter::FIXED, digits);
+    return s;
+  };
+  EXPECT_EQ("0.100", fixed(0.1, 3));
+  EXPECT_EQ("3", fixed(2.5, 0));
+  EXPECT_EQ("-3", fixed(-2.5, 0));
+  EXPECT_EQ("0.13", fixed(0.125, 2));
+  EXPECT_EQ("1.00", fixed(0.999, 2));
+  EXPECT_EQ("-0.00", fixed(-0.001, 2));
+  EXPECT_EQ("12345678901234567168", fixed(12345678901234567890.0, 0));
+  EXPECT_EQ("Infinity", fixed(numeric_limits<double>::infinity(), 2));
+
+  // Against the exact value, rounded half up
+  std::mt19937_64 rng(1234);
+  std::uniform_real_distribution<double> exponents(-25, 25);
+  for (int i = 0; i < 100000; ++i) {
+    double d = std::pow(10.0, exponents(rng)) * (rng() % 2 ? 1 : -1);
+    unsigned int digits = rng() % 21;
+    // Enough digits to be exact
+    char buf[1200];
+    snprintf(buf, sizeof(buf), "%.1100f", d);
+    string exact = buf;
+    auto point = exact.find('.');
+    auto end = point + 1 + digits;
+    string expected = exact.substr(0, digits ? end : point);
+    if (exact[end] >= '5') {
+      // Round up by hand
+      size_t k = expected.size();
+      while (k-- > 0) {
+        if (expected[k] == '.') {
+          continue;
+        }
+        if (!isdigit(expected[k])) {
+          expected.insert(k + 1, 1, '1');
+          break;
+        }
+        if (expected[k] != '9') {
+          ++expected[k];
+          break;
+        }
+        expected[k] = '0';
+        if (k == 0) {
+          expected.insert(0, 1, '1');
+        }
+      }
+    }
+    EXPECT_EQ(expected, fixed(d, digits)) << buf;
+  }
+}
+
 TEST(Conv, FBStringToString) {
   fbstring foo("foo");
   string ret = to<string>(foo);
@@ -1193,6 +1320,108 @@ TEST(Conv, NewUint64ToString) {
   THE_GREAT_EXPECTATIONS(18446744073709551615UL, 20);
 
 #undef THE_GREAT_EXPECTATIONS
+
+  // Every length, and zeros in every position
+  std::mt19937_64 rng(1234);
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t v = rng() >> (rng() % 64);
+    if (rng() % 2) {
+      v -= v % 100000000;
+    }
+    char expected[21];
+    snprintf(expected, sizeof(expected), "%" PRIu64, v);
+    auto len = uint64ToBufferUnsafe(v, buf);
+    EXPECT_EQ(string(expected), string(buf, len));
+  }
+}
+
+TEST(Conv, LongDigitStrings) {
+  // Long enough to go through the 8 and 16 digit paths, with a bad
+  // character in each position
+  string digits = "0000000000000000000000000000012345678901234567890";
+  for (size_t size = 1; size <= digits.size(); ++size) {
+    auto s = digits.substr(digits.size() - size);
+    auto value = tryTo<uint64_t>(s.data(), s.data() + s.size());
+    ASSERT_TRUE(value.hasValue()) << s;
+    EXPECT_EQ(strtoull(s.c_str(), nullptr, 10), value.value()) << s;
+    for (size_t i = 0; i < size; ++i) {
+      for (char c : {'/', ':', 'a', ' ', '\x80'}) {
+        auto bad = s;
+        bad[i] = c;
+        auto result = tryTo<uint64_t>(bad.data(), bad.data() + bad.size());
+        ASSERT_FALSE(result.hasValue()) << bad;
+        // Longer ones may look like they overflow
+        if (size < 20) {
+          EXPECT_EQ(ConversionCode::NON_DIGIT_CHAR, result.error()) << bad;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(
+      std::numeric_limits<int64_t>::min(),
+      to<int64_t>("-00000000009223372036854775808"));
+  EXPECT_EQ(
+      ConversionCode::POSITIVE_OVERFLOW,
+      tryTo<uint64_t>(StringPiece("18446744073709551616")).error());
+#if FOLLY_HAVE_INT128_T
+  EXPECT_EQ(
+      "123456789012345678901234567890123456",
+      to<string>(to<unsigned __int128>(
+          StringPiece("123456789012345678901234567890123456").begin(),
+          StringPiece("123456789012345678901234567890123456").end())));
+#endif
+}
+
+TEST(Conv, Integers) {
+  StringPiece src = "1,-2, 3 ,40000000000,5";
+  int64_t values[3];
+  auto count = tryToIntegers(&src, ',', values, 3);
+  ASSERT_TRUE(count.hasValue());
+  EXPECT_EQ(3, count.value());
+  EXPECT_EQ(1, values[0]);
+  EXPECT_EQ(-2, values[1]);
+  EXPECT_EQ(3, values[2]);
+  EXPECT_EQ("40000000000,5", src);
+  count = tryToIntegers(&src, ',', values, 3);
+  ASSERT_TRUE(count.hasValue());
+  EXPECT_EQ(2, count.value());
+  EXPECT_EQ(40000000000, values[0]);
+  EXPECT_EQ(5, values[1]);
+  EXPECT_TRUE(src.empty());
+
+  // Errors leave src at the integer that couldn't be parsed
+  src = "1\t2\tx\t4";
+  count = tryToIntegers(&src, '\t', values, 3);
+  EXPECT_EQ(ConversionCode::INVALID_LEADING_CHAR, count.error());
+  EXPECT_EQ("x\t4", src);
+  EXPECT_EQ(1, values[0]);
+  EXPECT_EQ(2, values[1]);
+  src = "1 2";
+  EXPECT_EQ(
+      ConversionCode::NON_WHITESPACE_AFTER_END,
+      tryToIntegers(&src, ',', values, 3).error());
+  uint8_t small[1];
+  src = "256";
+  EXPECT_EQ(
+      ConversionCode::POSITIVE_OVERFLOW,
+      tryToIntegers(&src, ',', small, 1).error());
+
+  EXPECT_EQ(vector<int>({}), toIntegers<int>("", ','));
+  EXPECT_EQ(vector<int>({7}), toIntegers<int>("7,", ','));
+  vector<unsigned> expected;
+  string csv;
+  for (unsigned i = 0; i < 1000; ++i) {
+    expected.push_back(i * 2654435761u);
+    csv += to<string>(i ? "," : "", expected.back());
+  }
+  EXPECT_EQ(expected, toIntegers<unsigned>(csv, ','));
+  try {
+    toIntegers<int>("1,2,3x,4", ',');
+    ADD_FAILURE();
+  } catch (const ConversionError& e) {
+    EXPECT_EQ(ConversionCode::NON_WHITESPACE_AFTER_END, e.errorCode());
+    EXPECT_NE(string::npos, string(e.what()).find("3x")) << e.what();
+  }
 }
 
 TEST(Conv, allocate_size) {
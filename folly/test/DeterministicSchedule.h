@@ -230,7 +230,7 @@ struct DeterministicAtomic {
       T v1,
       std::memory_order mo = std::memory_order_seq_cst) noexcept {
     return compare_exchange_strong(
-        v0, v1, mo, detail::default_failure_memory_order(mo));
+        v0, v1, mo, folly::detail::default_failure_memory_order(mo));
   }
   bool compare_exchange_strong(
       T& v0,
@@ -252,7 +252,7 @@ struct DeterministicAtomic {
       T v1,
       std::memory_order mo = std::memory_order_seq_cst) noexcept {
     return compare_exchange_weak(
-        v0, v1, mo, detail::default_failure_memory_order(mo));
+        v0, v1, mo, folly::detail::default_failure_memory_order(mo));
   }
   bool compare_exchange_weak(
       T& v0,
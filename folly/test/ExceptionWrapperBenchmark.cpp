@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <folly/Benchmark.h>
+#include <folly/futures/Future.h>
 #include <folly/portability/GFlags.h>
 
 DEFINE_int32(num_threads, 32, "Number of threads to run concurrency "
@@ -207,6 +208,79 @@ BENCHMARK_RELATIVE(exception_wrapper_create_and_cast_concurrent, iters) {
   }
 }
 
+BENCHMARK_DRAW_LINE()
+
+/*
+ * Use case 3: Errors reach the library as exception_ptrs (from
+ * Promise::setException, or std::current_exception), or a handler wants a
+ * type the exception has as a non-std::exception base. None of these needs
+ * a throw when the exception derives from std::exception.
+ */
+namespace {
+struct ErrorCode {
+  int code = 7;
+};
+struct CodedError : std::runtime_error, ErrorCode {
+  CodedError() : std::runtime_error("payload") {}
+};
+} // namespace
+
+BENCHMARK(exception_ptr_rethrow_to_classify, iters) {
+  auto ep = std::make_exception_ptr(std::runtime_error("payload"));
+  for (size_t i = 0; i < iters; ++i) {
+    try {
+      std::rethrow_exception(ep);
+    } catch (std::exception& e) {
+      folly::exception_wrapper ew(std::current_exception(), e);
+      folly::doNotOptimizeAway(ew);
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(exception_wrapper_from_exception_ptr, iters) {
+  auto ep = std::make_exception_ptr(std::runtime_error("payload"));
+  for (size_t i = 0; i < iters; ++i) {
+    auto ew = folly::exception_wrapper::from_exception_ptr(ep);
+    folly::doNotOptimizeAway(ew);
+  }
+}
+
+BENCHMARK_RELATIVE(exception_wrapper_to_exception_ptr, iters) {
+  std::runtime_error e("payload");
+  for (size_t i = 0; i < iters; ++i) {
+    auto ew = folly::make_exception_wrapper<std::runtime_error>(e);
+    folly::doNotOptimizeAway(ew.to_exception_ptr());
+  }
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(exception_wrapper_throw_to_non_std_base, iters) {
+  auto ew = folly::make_exception_wrapper<CodedError>();
+  for (size_t i = 0; i < iters; ++i) {
+    try {
+      ew.throw_exception();
+    } catch (ErrorCode& e) {
+      folly::doNotOptimizeAway(e.code);
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(exception_wrapper_with_non_std_base, iters) {
+  auto ew = folly::make_exception_wrapper<CodedError>();
+  for (size_t i = 0; i < iters; ++i) {
+    ew.with_exception([](ErrorCode& e) { folly::doNotOptimizeAway(e.code); });
+  }
+}
+
+BENCHMARK_RELATIVE(future_on_error_non_std_base, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    auto f = folly::makeFuture<int>(CodedError())
+                 .onError([](ErrorCode& e) { return e.code; });
+    folly::doNotOptimizeAway(f.value());
+  }
+}
+
 int main(int argc, char *argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -231,5 +305,13 @@ exception_wrapper_create_and_cast               5321.54%    79.61ns   12.56M
 exception_ptr_create_and_throw_concurrent                  330.88us    3.02K
 exception_wrapper_create_and_throw_concurrent    143.66%   230.32us    4.34K
 exception_wrapper_create_and_cast_concurrent    194828.54%   169.83ns    5.89M
+----------------------------------------------------------------------------
+exception_ptr_rethrow_to_classify                          981.18ns    1.02M
+exception_wrapper_from_exception_ptr            2388.85%    41.07ns   24.35M
+exception_wrapper_to_exception_ptr              1052.52%    93.22ns   10.73M
+----------------------------------------------------------------------------
+exception_wrapper_throw_to_non_std_base                      1.61us  621.64K
+exception_wrapper_with_non_std_base             5409.38%    29.74ns   33.63M
+future_on_error_non_std_base                     747.79%   215.12ns    4.65M
 ============================================================================
 */
@@ -768,3 +768,66 @@ TEST(ExceptionWrapper, self_swap_test) {
   auto& ew2 = ew;
   ew = std::move(ew2); // should not crash
 }
+
+namespace {
+struct ErrorTag {
+  int code = 7;
+};
+// std::exception isn't the first base, so it isn't at the object's address
+class TaggedError : public ErrorTag, public std::runtime_error {
+ public:
+  TaggedError() : std::runtime_error("tagged") {}
+};
+} // namespace
+
+TEST(ExceptionWrapper, from_exception_ptr_adjusts_base) {
+  auto ep = std::make_exception_ptr(TaggedError{});
+  auto ew = exception_wrapper::from_exception_ptr(ep);
+  EXPECT_TRUE(ew.has_exception_ptr());
+  EXPECT_EQ(&from_eptr<std::exception>(ep), ew.get_exception());
+  EXPECT_EQ(typeid(TaggedError), ew.type());
+  EXPECT_STREQ("tagged", ew.get_exception()->what());
+
+  auto ew2 = exception_wrapper::from_exception_ptr(std::make_exception_ptr(3));
+  EXPECT_EQ(nullptr, ew2.get_exception());
+  EXPECT_TRUE(ew2.is_compatible_with<int>());
+}
+
+TEST(ExceptionWrapper, to_exception_ptr_keeps_type) {
+  exception_wrapper small{std::runtime_error("small")};
+  exception_wrapper big{TaggedError{}};
+  exception_wrapper non_std{folly::in_place, 42};
+  EXPECT_THROW(
+      std::rethrow_exception(small.to_exception_ptr()), std::runtime_error);
+  EXPECT_TRUE(small.has_exception_ptr());
+  EXPECT_STREQ("small", small.get_exception()->what());
+  auto ep = big.to_exception_ptr();
+  EXPECT_EQ(&from_eptr<TaggedError>(ep), big.get_exception<TaggedError>());
+  EXPECT_EQ(&from_eptr<ErrorTag>(ep), big.get_exception<ErrorTag>());
+  EXPECT_THROW(std::rethrow_exception(non_std.to_exception_ptr()), int);
+  EXPECT_EQ(42, *non_std.get_exception<int>());
+}
+
+TEST(ExceptionWrapper, handle_non_std_base_of_std_exception) {
+  auto ep = std::make_exception_ptr(TaggedError{});
+  exception_wrapper const ew_eptr(ep, from_eptr<TaggedError>(ep));
+  exception_wrapper const ew_big{TaggedError{}};
+  for (auto& ew : {ew_eptr, ew_big}) {
+    int code = 0;
+    EXPECT_TRUE(ew.with_exception([&](ErrorTag const& e) { code = e.code; }));
+    EXPECT_EQ(7, code);
+    EXPECT_FALSE(ew.is_compatible_with<IntException>());
+    EXPECT_NE(nullptr, ew.get_exception<ErrorTag>());
+
+    bool handled = false;
+    ew.handle(
+        [](int const&) { ADD_FAILURE(); },
+        [&](ErrorTag const&) { handled = true; });
+    EXPECT_TRUE(handled);
+  }
+
+  // Not handled: the original type is rethrown
+  EXPECT_THROW(
+      ew_big.handle([](std::logic_error const&) { ADD_FAILURE(); }),
+      TaggedError);
+}
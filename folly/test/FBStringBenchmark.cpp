@@ -29,6 +29,7 @@
 #include <folly/Benchmark.h>
 #include <folly/Random.h>
 #include <folly/container/Foreach.h>
+#include <folly/memory/Arena.h>
 #include <folly/portability/GFlags.h>
 
 using namespace std;
@@ -89,6 +90,93 @@ std::list<char> RandomList(unsigned int maxSize) {
 #include <folly/test/FBStringTestBenchmarks.cpp.h> // nolint
 #undef STRING
 
+template <class Policy>
+using policy_fbstring = basic_fbstring<
+    char,
+    std::char_traits<char>,
+    std::allocator<char>,
+    fbstring_core<char, Policy>>;
+
+typedef policy_fbstring<fbstring_nonatomic_policy> fbstring_nonatomic;
+typedef policy_fbstring<fbstring_nocow_policy> fbstring_nocow;
+
+// Medium and large strings come from arena, which outlives them all
+static SysArena arena;
+
+struct ArenaAllocator {
+  static void* allocate(size_t size) {
+    return arena.allocate(size);
+  }
+  static void*
+  reallocate(void* p, size_t currentSize, size_t, size_t newCapacity) {
+    auto const result = arena.allocate(newCapacity);
+    memcpy(result, p, currentSize);
+    return result;
+  }
+  static void deallocate(void*) {}
+};
+
+typedef policy_fbstring<fbstring_policy<true, true, ArenaAllocator>>
+    fbstring_arena;
+
+// Copies of a large string: std::string copies eagerly, fbstring bumps
+// an atomic or plain reference count (or copies eagerly without COW)
+template <class String>
+void copyLarge(size_t iters, size_t arg) {
+  String s;
+  BENCHMARK_SUSPEND {
+    randomString(&s, arg);
+  }
+  FOR_EACH_RANGE (i, 0, iters) {
+    String s1 = s;
+    doNotOptimizeAway(s1.data());
+  }
+}
+
+// Builds medium strings, which with ArenaAllocator never reach malloc
+template <class String>
+void buildMedium(size_t iters, size_t arg) {
+  FOR_EACH_RANGE (i, 0, iters) {
+    String s;
+    FOR_EACH_RANGE (j, 0, arg) {
+      s.push_back('a');
+    }
+    doNotOptimizeAway(s.data());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(copyLarge_string, iters) {
+  copyLarge<string>(iters, 4096);
+}
+
+BENCHMARK_RELATIVE(copyLarge_fbstring, iters) {
+  copyLarge<fbstring>(iters, 4096);
+}
+
+BENCHMARK_RELATIVE(copyLarge_fbstring_nonatomic, iters) {
+  copyLarge<fbstring_nonatomic>(iters, 4096);
+}
+
+BENCHMARK_RELATIVE(copyLarge_fbstring_nocow, iters) {
+  copyLarge<fbstring_nocow>(iters, 4096);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(buildMedium_string, iters) {
+  buildMedium<string>(iters, 200);
+}
+
+BENCHMARK_RELATIVE(buildMedium_fbstring, iters) {
+  buildMedium<fbstring>(iters, 200);
+}
+
+BENCHMARK_RELATIVE(buildMedium_fbstring_arena, iters) {
+  buildMedium<fbstring_arena>(iters, 200);
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -32,6 +32,7 @@
 #include <folly/Portability.h>
 #include <folly/Random.h>
 #include <folly/container/Foreach.h>
+#include <folly/memory/Arena.h>
 #include <folly/portability/GTest.h>
 
 using namespace std;
@@ -1415,6 +1416,113 @@ TEST(FBString, moveTerminator) {
   EXPECT_EQ('\0', *s.c_str());
 }
 
+namespace {
+template <class Policy>
+using policy_fbstring = basic_fbstring<
+    char,
+    std::char_traits<char>,
+    std::allocator<char>,
+    fbstring_core<char, Policy>>;
+
+SysArena* testArena = nullptr;
+size_t testArenaAllocs = 0;
+
+struct TestArenaAllocator {
+  static void* allocate(size_t size) {
+    ++testArenaAllocs;
+    return testArena->allocate(size);
+  }
+  static void*
+  reallocate(void* p, size_t currentSize, size_t, size_t newCapacity) {
+    auto const result = allocate(newCapacity);
+    memcpy(result, p, currentSize);
+    return result;
+  }
+  static void deallocate(void*) {}
+};
+
+template <class String>
+void checkPolicyString() {
+  for (size_t size : {0, 10, 23, 24, 100, 254, 255, 1000, 100000}) {
+    std::string expected(size, 'a');
+    for (size_t i = 0; i < size; ++i) {
+      expected[i] = char('a' + i % 26);
+    }
+    String s(expected.data(), expected.size());
+    EXPECT_EQ(expected, s.toStdString());
+
+    String copy = s;
+    EXPECT_EQ(expected, copy.toStdString());
+    copy.append("tail");
+    EXPECT_EQ(expected, s.toStdString());
+    EXPECT_EQ(expected + "tail", copy.toStdString());
+
+    String moved = std::move(copy);
+    EXPECT_EQ(expected + "tail", moved.toStdString());
+    moved.resize(size / 2);
+    EXPECT_EQ(expected.substr(0, size / 2), moved.toStdString());
+    moved.reserve(2 * size + 1);
+    moved += s;
+    EXPECT_EQ(expected.substr(0, size / 2) + expected, moved.toStdString());
+  }
+}
+} // namespace
+
+TEST(FBString, nonAtomicRefCount) {
+  checkPolicyString<policy_fbstring<fbstring_nonatomic_policy>>();
+
+  policy_fbstring<fbstring_nonatomic_policy> s(1000, 'x');
+  auto copy = s;
+  EXPECT_EQ(s.data(), copy.data());
+  copy[0] = 'y';
+  EXPECT_NE(s.data(), copy.data());
+  EXPECT_EQ('x', s[0]);
+}
+
+TEST(FBString, noCopyOnWrite) {
+  checkPolicyString<policy_fbstring<fbstring_nocow_policy>>();
+
+  policy_fbstring<fbstring_nocow_policy> s(100000, 'x');
+  auto copy = s;
+  EXPECT_NE(s.data(), copy.data());
+
+  // A malloc'ed block is adopted as is
+  auto const p = static_cast<char*>(malloc(1001));
+  memset(p, 'z', 1000);
+  p[1000] = '\0';
+  policy_fbstring<fbstring_nocow_policy> adopted(
+      p, 1000, 1001, AcquireMallocatedString());
+  EXPECT_EQ(p, adopted.data());
+  EXPECT_EQ(std::string(1000, 'z'), adopted.toStdString());
+}
+
+TEST(FBString, arenaAllocator) {
+  typedef fbstring_policy<true, true, TestArenaAllocator> ArenaPolicy;
+  SysArena arena;
+  testArena = &arena;
+  testArenaAllocs = 0;
+
+  checkPolicyString<policy_fbstring<ArenaPolicy>>();
+  EXPECT_LT(0, testArenaAllocs);
+
+  // Small strings don't touch the arena
+  auto allocs = testArenaAllocs;
+  policy_fbstring<ArenaPolicy> small("small");
+  EXPECT_EQ(allocs + (kIsSanitizeAddress ? 1 : 0), testArenaAllocs);
+
+  // A malloc'ed block is copied into the arena
+  allocs = testArenaAllocs;
+  auto const p = static_cast<char*>(malloc(1001));
+  memset(p, 'z', 1000);
+  p[1000] = '\0';
+  policy_fbstring<ArenaPolicy> adopted(
+      p, 1000, 1001, AcquireMallocatedString());
+  EXPECT_EQ(allocs + 1, testArenaAllocs);
+  EXPECT_EQ(std::string(1000, 'z'), adopted.toStdString());
+
+  testArena = nullptr;
+}
+
 namespace {
 /*
  * t8968589: Clang 3.7 refused to compile w/ certain constructors (specifically
@@ -25,6 +25,7 @@
 
 #include <glog/logging.h>
 
+#include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/File.h>
 #include <folly/Range.h>
@@ -301,6 +302,29 @@ TEST(String, readFile) {
   }
 }
 
+TEST(FileUtilTest2, pcopyFull) {
+  TemporaryFile in("file-util-test"), out("file-util-test");
+  std::string data;
+  for (int i = 0; i < 100000; ++i) {
+    data += folly::to<std::string>(i, ' ');
+  }
+  ASSERT_TRUE(writeFile(data, in.path().string().c_str()));
+
+  EXPECT_EQ(1000, pcopyFull(in.fd(), 17, out.fd(), 0, 1000));
+  EXPECT_EQ(data.size() - 17, pcopyFull(in.fd(), 17, out.fd(), 1000, 1 << 30));
+  // File offsets are unchanged
+  EXPECT_EQ(0, lseek(in.fd(), 0, SEEK_CUR));
+  EXPECT_EQ(0, lseek(out.fd(), 0, SEEK_CUR));
+  std::string copied;
+  ASSERT_TRUE(readFile(out.path().string().c_str(), copied));
+  EXPECT_EQ(data.substr(17, 1000) + data.substr(17), copied);
+
+  // Nothing past the end
+  EXPECT_EQ(0, pcopyFull(in.fd(), off_t(data.size()), out.fd(), 0, 10));
+  EXPECT_EQ(-1, pcopyFull(-1, 0, out.fd(), 0, 10));
+  EXPECT_EQ(EBADF, errno);
+}
+
 class ReadFileFd : public ::testing::Test {
  protected:
   void SetUp() override {
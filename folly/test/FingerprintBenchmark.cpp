@@ -20,6 +20,7 @@
 #include <folly/Fingerprint.h>
 #include <folly/Format.h>
 #include <folly/detail/SlowFingerprint.h>
+#include <folly/io/ContentChunker.h>
 
 using namespace std;
 using namespace folly;
@@ -28,12 +29,15 @@ using folly::detail::SlowFingerprint;
 namespace {
 constexpr int kMaxIds = 64 << 10;  // 64Ki
 constexpr int kMaxTerms = 64 << 10;
+constexpr int kMaxBytes = 1 << 20;  // 1Mi
 
 // Globals are generally bad, but this is a benchmark, so there.
 uint64_t ids[kMaxIds];
 
 std::string terms[kMaxTerms];
 
+std::string bytes;
+
 void initialize() {
   std::mt19937 rng;
   for (int i = 0; i < kMaxIds; i++) {
@@ -53,6 +57,10 @@ void initialize() {
       term.append(1, (char)term_char(rng));
     }
   }
+  bytes.reserve(kMaxBytes);
+  for (int i = 0; i < kMaxBytes; i++) {
+    bytes.push_back((char)rng());
+  }
 }
 
 template <class FP>
@@ -85,6 +93,17 @@ void fingerprintTerms(int num_iterations, int num_terms) {
   }
 }
 
+template <class FP>
+void fingerprintBytes(int num_iterations, int num_bytes) {
+  for (int iter = 0; iter < num_iterations; iter++) {
+    FP fp;
+    fp.update(StringPiece(bytes.data(), num_bytes));
+    uint64_t out[2];
+    fp.write(out);
+    VLOG(1) << out[0];
+  }
+}
+
 void fastFingerprintIds64(int num_iterations, int num_ids) {
   fingerprintIds<Fingerprint<64> >(num_iterations, num_ids);
 }
@@ -117,6 +136,36 @@ void fastFingerprintTerms128(int num_iterations, int num_ids) {
   fingerprintTerms<Fingerprint<128> >(num_iterations, num_ids);
 }
 
+void fastFingerprintBytes64(int num_iterations, int num_bytes) {
+  fingerprintBytes<Fingerprint<64> >(num_iterations, num_bytes);
+}
+
+// Fingerprint<64> one byte at a time, as update() did before it folded
+// blocks with carry-less multiplication
+void bytewiseFingerprintBytes64(int num_iterations, int num_bytes) {
+  for (int iter = 0; iter < num_iterations; iter++) {
+    Fingerprint<64> fp;
+    for (int i = 0; i < num_bytes; i++) {
+      fp.update8(uint8_t(bytes[i]));
+    }
+    uint64_t out;
+    fp.write(&out);
+    VLOG(1) << out;
+  }
+}
+
+void fastFingerprintBytes128(int num_iterations, int num_bytes) {
+  fingerprintBytes<Fingerprint<128> >(num_iterations, num_bytes);
+}
+
+void contentChunkBytes(int num_iterations, int num_bytes) {
+  auto buf = IOBuf::wrapBufferAsValue(bytes.data(), num_bytes);
+  for (int iter = 0; iter < num_iterations; iter++) {
+    auto boundaries = contentChunkBoundaries(buf);
+    doNotOptimizeAway(boundaries);
+  }
+}
+
 } // namespace
 
 // Only benchmark one size of slowFingerprint; it's significantly slower
@@ -140,6 +189,10 @@ int main(int argc, char** argv) {
   BM(slowFingerprintTerms64, 1, kMaxTerms)
   BM(fastFingerprintTerms96, 1, kMaxTerms)
   BM(fastFingerprintTerms128, 1, kMaxTerms)
+  BM(fastFingerprintBytes64, 16, kMaxBytes)
+  BM(bytewiseFingerprintBytes64, 16, kMaxBytes)
+  BM(fastFingerprintBytes128, 16, kMaxBytes)
+  BM(contentChunkBytes, 64 << 10, kMaxBytes)
   # undef BM
 
   initialize();
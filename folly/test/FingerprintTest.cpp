@@ -16,6 +16,8 @@
 
 #include <folly/Fingerprint.h>
 
+#include <string>
+
 #include <glog/logging.h>
 
 #include <folly/Benchmark.h>
@@ -163,6 +165,45 @@ TEST(Fingerprint, Alignment) {
   }
 }
 
+TEST(Fingerprint, LongStrings) {
+  // Test that update() of long strings, which folds blocks of 16 bytes at a
+  // time for Fingerprint<64>, matches update8() for every length around the
+  // block sizes, and any alignment
+  std::string str;
+  for (int i = 0; i < 600; i++) {
+    str.push_back(char((i * 131 + 7) & 0xff));
+  }
+  for (size_t offset = 0; offset < 3; offset++) {
+    for (size_t len = 0; len + offset <= str.size(); len++) {
+      StringPiece sp(str.data() + offset, len);
+      uint64_t u8[2];
+      uint64_t usp[2];
+
+      Fingerprint<64> fp64;
+      Fingerprint<128> fp128;
+      for (auto c : sp) {
+        fp64.update8(uint8_t(c));
+        fp128.update8(uint8_t(c));
+      }
+      fp64.write(u8);
+      Fingerprint<64>().update(sp).write(usp);
+      EXPECT_EQ(u8[0], usp[0]) << offset << " " << len;
+
+      fp128.write(u8);
+      Fingerprint<128>().update(sp).write(usp);
+      EXPECT_EQ(u8[0], usp[0]) << offset << " " << len;
+      EXPECT_EQ(u8[1], usp[1]) << offset << " " << len;
+    }
+  }
+
+  uint64_t slow;
+  uint64_t fast;
+  StringPiece sp(str);
+  SlowFingerprint<64>().update8(1).update(sp).write(&slow);
+  Fingerprint<64>().update8(1).update(sp).write(&fast);
+  EXPECT_EQ(slow, fast);
+}
+
 int main(int argc, char *argv[]) {
   testing::InitGoogleTest(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -19,6 +19,7 @@
 #include <glog/logging.h>
 
 #include <folly/Benchmark.h>
+#include <folly/CompiledFormat.h>
 #include <folly/FBVector.h>
 #include <folly/dynamic.h>
 #include <folly/init/Init.h>
@@ -148,6 +149,35 @@ BENCHMARK_RELATIVE(bigFormat_format, iters) {
   }
 }
 
+template <size_t... Indexes>
+decltype(auto) compiledFormat20Numbers(int i, std::index_sequence<Indexes...>) {
+  static_assert(20 == sizeof...(Indexes), "Must have exactly 20 indexes");
+  return format(
+      FOLLY_FORMAT_STRING("{} {} {} {} {}"
+                          "{} {} {} {} {}"
+                          "{} {} {} {} {}"
+                          "{} {} {} {} {}"),
+      (i + static_cast<int>(Indexes))...);
+}
+
+BENCHMARK_RELATIVE(bigFormat_compiledFormat, iters) {
+  BenchmarkSuspender suspender;
+  char* p;
+  auto writeToBuf = [&p](StringPiece sp) mutable {
+    memcpy(p, sp.data(), sp.size());
+    p += sp.size();
+  };
+
+  while (iters--) {
+    for (int i = -100; i < 100; i++) {
+      p = bigBuf.data();
+      suspender.dismissing([&] {
+        compiledFormat20Numbers(i, std::make_index_sequence<20>())(writeToBuf);
+      });
+    }
+  }
+}
+
 BENCHMARK_DRAW_LINE()
 
 BENCHMARK(format_nested_strings, iters) {
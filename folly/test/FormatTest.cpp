@@ -15,10 +15,16 @@
  */
 
 #include <folly/Format.h>
+
+#include <folly/CompiledFormat.h>
 #include <folly/Utility.h>
 #include <folly/portability/GTest.h>
 
+#include <limits>
+#include <map>
+#include <sstream>
 #include <string>
+#include <vector>
 
 using namespace folly;
 
@@ -223,11 +229,19 @@ TEST(Format, Float) {
   EXPECT_EQ("100000", sformat("{}", 100000.0));
   EXPECT_EQ("1e+6", sformat("{}", 1000000.0));
   EXPECT_EQ("1e+7", sformat("{}", 10000000.0));
+  EXPECT_EQ("1.2345e+3", sformat("{:.3}", 1234.5));
+  EXPECT_EQ("123.45", sformat("{:.3}", 123.45));
+  EXPECT_EQ("5e-324", sformat("{}", 4.9406564584124654e-324));
 
   EXPECT_EQ("1.00", sformat("{:.2f}", 1.0));
   EXPECT_EQ("0.10", sformat("{:.2f}", 0.1));
   EXPECT_EQ("0.01", sformat("{:.2f}", 0.01));
   EXPECT_EQ("0.00", sformat("{:.2f}", 0.001));
+  EXPECT_EQ("0.13", sformat("{:.2f}", 0.125));
+  EXPECT_EQ("-0.00", sformat("{:.2f}", -0.001));
+  EXPECT_EQ("+1.50", sformat("{:+.2f}", 1.5));
+  EXPECT_EQ("INF", sformat("{:.2F}", std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("1000000000000000019884624838656", sformat("{:.0f}", 1e30));
 
   EXPECT_EQ("100000. !== 100000", sformat("{:.} !== {:.}", 100000.0, 100000));
   EXPECT_EQ("100000.", sformat("{:.}", 100000.0));
@@ -566,3 +580,81 @@ TEST(Format, NoncopyableArg) {
     EXPECT_EQ(fmt.str(), "1");
   }
 }
+
+// Compiled and runtime format strings agree
+#define EXPECT_COMPILED_FORMAT(expected, fmt, ...)                \
+  do {                                                            \
+    EXPECT_EQ(expected, sformat(fmt, __VA_ARGS__));               \
+    EXPECT_EQ(expected, sformat(FOLLY_FORMAT_STRING(fmt), __VA_ARGS__)); \
+  } while (false)
+
+TEST(Format, Compiled) {
+  EXPECT_EQ("hello", sformat(FOLLY_FORMAT_STRING("hello")));
+  EXPECT_EQ("", sformat(FOLLY_FORMAT_STRING("")));
+  EXPECT_COMPILED_FORMAT("42 23", "{} {}", 42, 23);
+  EXPECT_COMPILED_FORMAT("23 42 23", "{1} {0} {1}", 42, 23);
+  EXPECT_COMPILED_FORMAT("{42}", "{{{}}}", 42);
+  EXPECT_COMPILED_FORMAT("}}{{", "}}}}{{{{", 0);
+  EXPECT_COMPILED_FORMAT("  42|42   | 42 |+0042", "{:4}|{:<5}|{:^4}|{:+05}",
+                         42, 42, 42, 42);
+  EXPECT_COMPILED_FORMAT("0x2a 0X2A 052 0b101010", "{:#x} {:#X} {:#o} {:#b}",
+                         42, 42, 42, 42);
+  EXPECT_COMPILED_FORMAT("1,234,567 *-7*", "{:,d} {:*^4}", 1234567, -7);
+  EXPECT_COMPILED_FORMAT("a", "{:c}", 'a');
+  EXPECT_COMPILED_FORMAT("true 1", "{} {:d}", true, true);
+  EXPECT_COMPILED_FORMAT("3.14 -2.50e+00 1. 50.0", "{:.2f} {:.2e} {:.0.f} {:.1%}",
+                         3.14159, -2.5, 1.0, 0.5);
+  EXPECT_COMPILED_FORMAT("hello|hel  |(null)", "{:s}|{:5.3}|{}", "hello",
+                         std::string("hello"), nullptr);
+  EXPECT_COMPILED_FORMAT("hi    |hi  ", "{1:*0}|{1:*2}", 6, "hi", 4);
+  EXPECT_COMPILED_FORMAT("<key=hello, value=42>", "{}", KeyValue{"hello", 42});
+
+  // Keys after the argument index
+  std::vector<int> v{10, 20, 30};
+  std::map<std::string, int> m{{"a", 1}, {"b", 2}};
+  EXPECT_COMPILED_FORMAT("30 2 20", "{0[2]} {1[b]} {0.1}", v, m);
+  EXPECT_COMPILED_FORMAT("e", "{0[1]}", "hello");
+  EXPECT_THROW(
+      sformat(FOLLY_FORMAT_STRING("{0[c]}"), m), FormatKeyNotFoundException);
+
+  // Appending, and streaming
+  std::string out = "x=";
+  format(&out, FOLLY_FORMAT_STRING("{}"), 1);
+  format(FOLLY_FORMAT_STRING(", y={}"), 2).appendTo(out);
+  EXPECT_EQ("x=1, y=2", out);
+  std::ostringstream os;
+  os << format(FOLLY_FORMAT_STRING("{:>3}"), 7);
+  EXPECT_EQ("  7", os.str());
+
+  // Lvalues are held by reference
+  NoncopyableInt n(5);
+  auto f = format(FOLLY_FORMAT_STRING("<{}>"), n);
+  EXPECT_EQ("<5>", f.str());
+  n.value = 6;
+  EXPECT_EQ("<6>", f.fbstr().toStdString());
+
+  // Errors that depend on argument values are still thrown
+  EXPECT_THROW(sformat(FOLLY_FORMAT_STRING("{:*}"), -3, 1), BadFormatArg);
+}
+
+TEST(Format, CompiledParse) {
+  // The steps the format string compiles to
+  constexpr auto fmt = makeFixedString("a}}b{0:x>+#8,.3.X}{{");
+  constexpr auto program = detail::compileFormat(fmt);
+  static_assert(program.size == 4, "");
+  static_assert(program.steps[0].end - program.steps[0].begin == 2, "");
+  static_assert(!program.steps[1].isArg && program.steps[1].begin == 3, "");
+  constexpr auto arg = program.steps[2];
+  static_assert(arg.isArg && arg.argIndex == 0, "");
+  static_assert(arg.fill == 'x' && arg.align == FormatArg::Align::RIGHT, "");
+  static_assert(arg.sign == FormatArg::Sign::PLUS_OR_MINUS, "");
+  static_assert(arg.basePrefix && arg.thousandsSeparator, "");
+  static_assert(arg.width == 8 && arg.precision == 3 && arg.trailingDot, "");
+  static_assert(arg.presentation == 'X', "");
+  static_assert(program.steps[3].end - program.steps[3].begin == 1, "");
+
+  constexpr auto dynamic = detail::compileFormat(makeFixedString("{:*} {}"));
+  static_assert(dynamic.steps[0].widthArgIndex == 0, "");
+  static_assert(dynamic.steps[0].argIndex == 1, "");
+  static_assert(dynamic.steps[2].argIndex == 2, "");
+}
@@ -1099,3 +1099,133 @@ TEST(Function, CtorWithCopy) {
 TEST(Function, Bug_T23346238) {
   const Function<void()> nullfun;
 }
+
+TEST(Function, InlineSize) {
+  Functor<int, 16> foo; // 64 bytes
+  foo(3, 123);
+
+  Function<int(size_t) const> small = foo;
+  EXPECT_TRUE(small.hasAllocatedMemory());
+  Function<int(size_t) const, 64> big = foo;
+  EXPECT_FALSE(big.hasAllocatedMemory());
+  EXPECT_EQ(123, big(3));
+  static_assert(
+      sizeof(Function<void(), 64>) >= 64 + 2 * sizeof(void*),
+      "InlineSize is the size of the buffer");
+}
+
+TEST(Function, InlineAlignment) {
+  struct alignas(alignof(std::max_align_t)) Aligned {
+    int operator()() const {
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(this) % alignof(Aligned));
+      return 42;
+    }
+  };
+
+  Function<int()> aligned = Aligned{};
+  EXPECT_FALSE(aligned.hasAllocatedMemory());
+  EXPECT_EQ(42, aligned());
+  Function<int(), 16> alignedSmall = std::move(aligned);
+  EXPECT_FALSE(alignedSmall.hasAllocatedMemory());
+  EXPECT_EQ(42, alignedSmall());
+
+  struct alignas(2 * alignof(std::max_align_t)) OverAligned {};
+  static_assert(
+      !folly::detail::function::IsSmall<OverAligned, 64>::value,
+      "over-aligned callables go on the heap");
+}
+
+TEST(Function, MoveBetweenSizes) {
+  Functor<int, 16> foo;
+  foo(3, 123);
+
+  // Inline in the source, fits the destination
+  Function<int(size_t) const, 128> f1 = foo;
+  Function<int(size_t), 64> f2 = std::move(f1);
+  EXPECT_FALSE(f1);
+  EXPECT_FALSE(f2.hasAllocatedMemory());
+  EXPECT_EQ(123, f2(3));
+
+  Function<int(size_t) const, 64> f3 = constCastFunction(std::move(f2));
+  EXPECT_FALSE(f3.hasAllocatedMemory());
+  EXPECT_EQ(123, f3(3));
+  Function<int(size_t), 96> f4 = std::move(f3);
+  EXPECT_FALSE(f4.hasAllocatedMemory());
+  EXPECT_EQ(123, f4(3));
+
+  // Inline in the source, doesn't fit: the source goes to the heap
+  Function<int(size_t)> f5 = std::move(f4);
+  EXPECT_TRUE(f5.hasAllocatedMemory());
+  EXPECT_EQ(123, f5(3));
+
+  // On the heap: the destination takes the pointer over
+  Function<int(size_t), 128> f6 = std::move(f5);
+  EXPECT_TRUE(f6.hasAllocatedMemory());
+  EXPECT_FALSE(f5.hasAllocatedMemory());
+  EXPECT_EQ(123, f6(3));
+
+  f4 = std::move(f6);
+  EXPECT_EQ(123, f4(3));
+  f4 = Function<int(size_t), 128>();
+  EXPECT_FALSE(f4);
+
+  // constCastFunction of a callable that doesn't fit
+  Function<int(size_t), 64> f7 = foo;
+  Function<int(size_t) const> f8 = constCastFunction(std::move(f7));
+  EXPECT_EQ(123, f8(3));
+}
+
+namespace {
+struct AllocationCounts {
+  size_t allocations = 0;
+  size_t deallocations = 0;
+};
+
+template <class T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationCounts* c) : counts(c) {}
+  template <class U>
+  /* implicit */ CountingAllocator(const CountingAllocator<U>& other)
+      : counts(other.counts) {}
+
+  T* allocate(size_t n) {
+    ++counts->allocations;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, size_t n) {
+    ++counts->deallocations;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  AllocationCounts* counts;
+};
+} // namespace
+
+TEST(Function, Allocator) {
+  AllocationCounts counts;
+  CountingAllocator<char> alloc(&counts);
+  Functor<int, 100> foo;
+  foo(3, 123);
+
+  {
+    Function<int(size_t) const> f{std::allocator_arg, alloc, foo};
+    EXPECT_TRUE(f.hasAllocatedMemory());
+    EXPECT_EQ(1, counts.allocations);
+    EXPECT_EQ(123, f(3));
+
+    Function<int(size_t) const> f2 = std::move(f);
+    Function<int(size_t), 16> f3 = std::move(f2);
+    EXPECT_EQ(1, counts.allocations);
+    EXPECT_EQ(0, counts.deallocations);
+    EXPECT_EQ(123, f3(3));
+  }
+  EXPECT_EQ(1, counts.deallocations);
+
+  // Small callables don't need the allocator
+  Function<int(int)> small{std::allocator_arg, alloc, [](int x) { return x; }};
+  EXPECT_FALSE(small.hasAllocatedMemory());
+  EXPECT_EQ(1, counts.allocations);
+  EXPECT_EQ(42, small(42));
+}
@@ -22,6 +22,7 @@
 // On platforms where it's not supported, GroupVarint will be compiled out.
 #if HAVE_GROUP_VARINT
 
+#include <folly/io/Cursor.h>
 #include <folly/portability/GTest.h>
 
 using namespace folly;
@@ -265,4 +266,49 @@ TEST(GroupVarint, GroupVarintDecoder) {
   }
 }
 
+namespace {
+template <class T>
+void testReadGroupVarints() {
+  typedef GroupVarint<T> Base;
+  size_t const groups = 50;
+  std::vector<T> values(groups * Base::kGroupSize);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = T(1) << ((i * 7) % (sizeof(T) * 8));
+  }
+  std::string s(Base::maxSize(values.size()), '\0');
+  char* p = &s[0];
+  for (size_t i = 0; i < groups; ++i) {
+    p = Base::encode(p, values.data() + i * Base::kGroupSize);
+  }
+  s.resize(p - s.data());
+
+  for (size_t chunk : {1, 3, 16, 10000}) {
+    std::unique_ptr<IOBuf> head;
+    for (size_t pos = 0; pos < s.size(); pos += chunk) {
+      auto buf = IOBuf::copyBuffer(s.data() + pos,
+                                   std::min(chunk, s.size() - pos));
+      if (head) {
+        head->prependChain(std::move(buf));
+      } else {
+        head = std::move(buf);
+      }
+    }
+    io::Cursor cursor(head.get());
+    std::vector<T> out(values.size());
+    readGroupVarints(cursor, out.data(), groups);
+    EXPECT_EQ(values, out);
+    EXPECT_TRUE(cursor.isAtEnd());
+
+    io::Cursor other(head.get());
+    EXPECT_THROW(readGroupVarints(other, out.data(), groups + 1),
+                 std::out_of_range);
+  }
+}
+} // namespace
+
+TEST(GroupVarint, ReadGroupVarintsFromCursor) {
+  testReadGroupVarints<uint32_t>();
+  testReadGroupVarints<uint64_t>();
+}
+
 #endif
@@ -92,6 +92,15 @@ BENCHMARK_RELATIVE(ipv6_to_fully_qualified, iters) {
   }
 }
 
+BENCHMARK_RELATIVE(ipv6_str, iters) {
+  IPAddressV6 ip("F1E0:0ACE:FB94:7ADF:22E8:6DE6:9672:3725");
+  while (iters--) {
+    string outputString = ip.str();
+    folly::doNotOptimizeAway(outputString);
+    folly::doNotOptimizeAway(outputString.data());
+  }
+}
+
 BENCHMARK_DRAW_LINE()
 
 BENCHMARK(ipv6_to_fully_qualified_port, iters) {
@@ -118,6 +127,24 @@ BENCHMARK_RELATIVE(ipv6_append_to_fully_qualified_port, iters) {
 
 BENCHMARK_DRAW_LINE()
 
+BENCHMARK(ipv4_from_string_inet_pton, iters) {
+  while (iters--) {
+    in_addr addr;
+    CHECK_EQ(1, inet_pton(AF_INET, "192.168.100.200", &addr));
+    doNotOptimizeAway(addr.s_addr);
+  }
+}
+
+BENCHMARK_RELATIVE(ipv4_try_from_string, iters) {
+  while (iters--) {
+    auto maybeIp = IPAddressV4::tryFromString("192.168.100.200");
+    CHECK(maybeIp.hasValue());
+    doNotOptimizeAway(maybeIp->toLong());
+  }
+}
+
+BENCHMARK_DRAW_LINE()
+
 BENCHMARK(ipv6_ctor_valid, iters) {
   while (iters--) {
     try {
@@ -162,27 +189,31 @@ BENCHMARK_RELATIVE(ipv6_try_from_string_invalid, iters) {
   }
 }
 
-// Benchmark results on Intel Xeon CPU E5-2660 @ 2.20GHz
+// Benchmark results on Intel Xeon (AVX-512), 1 core
 // ============================================================================
 // folly/test/IPAddressBenchmark.cpp               relative  time/iter  iters/s
 // ============================================================================
-// ipv4_to_string_inet_ntop                                   227.13ns    4.40M
-// ipv4_to_fully_qualified                         1418.95%    16.01ns   62.47M
+// ipv4_to_string_inet_ntop                                    94.22ns   10.61M
+// ipv4_to_fully_qualified                          854.27%    11.03ns   90.66M
+// ----------------------------------------------------------------------------
+// ipv4_to_fully_qualified_port                                94.61ns   10.57M
+// ipv4_append_to_fully_qualified_port              235.76%    40.13ns   24.92M
 // ----------------------------------------------------------------------------
-// ipv4_to_fully_qualified_port                                77.51ns   12.90M
-// ipv4_append_to_fully_qualified_port              133.72%    57.96ns   17.25M
+// ipv6_to_string_inet_ntop                                   338.85ns    2.95M
+// ipv6_to_fully_qualified                         1804.24%    18.78ns   53.25M
+// ipv6_str                                         625.71%    54.15ns   18.47M
 // ----------------------------------------------------------------------------
-// ipv6_to_string_inet_ntop                                   750.53ns    1.33M
-// ipv6_to_fully_qualified                          608.68%   123.30ns    8.11M
+// ipv6_to_fully_qualified_port                               116.35ns    8.59M
+// ipv6_append_to_fully_qualified_port              349.80%    33.26ns   30.06M
 // ----------------------------------------------------------------------------
-// ipv6_to_fully_qualified_port                               150.76ns    6.63M
-// ipv6_append_to_fully_qualified_port              178.73%    84.35ns   11.86M
+// ipv4_from_string_inet_pton                                  24.72ns   40.45M
+// ipv4_try_from_string                             123.35%    20.04ns   49.89M
 // ----------------------------------------------------------------------------
-// ipv6_ctor_valid                                            379.97ns    2.63M
-// ipv6_ctor_invalid                                 10.38%     3.66us  273.22K
+// ipv6_ctor_valid                                             49.78ns   20.09M
+// ipv6_ctor_invalid                                  3.82%     1.30us  767.65K
 // ----------------------------------------------------------------------------
-// ipv6_try_from_string_valid                                 375.34ns    2.66M
-// ipv6_try_from_string_invalid                     111.93%   335.34ns    2.98M
+// ipv6_try_from_string_valid                                  47.48ns   21.06M
+// ipv6_try_from_string_invalid                      95.39%    49.78ns   20.09M
 // ============================================================================
 
 int main(int argc, char* argv[]) {
@@ -342,6 +342,49 @@ TEST(IPAddress, CreateNetwork) {
       IPAddress::createNetwork("192.168.0.1", 33), IPAddressFormatException);
 }
 
+TEST(IPAddress, TryCreateNetwork) {
+  auto net = IPAddress::tryCreateNetwork("192.168.0.1/24");
+  ASSERT_TRUE(net.hasValue());
+  EXPECT_EQ("192.168.0.0", net->first.str());
+  EXPECT_EQ(24, net->second);
+  net = IPAddress::tryCreateNetwork("1999::1", -1, false);
+  ASSERT_TRUE(net.hasValue());
+  EXPECT_EQ("1999::1", net->first.str());
+  EXPECT_EQ(128, net->second);
+
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_DEFAULT_CIDR,
+      IPAddress::tryCreateNetwork("192.168.0.1", 256).error());
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_IP_SLASH_CIDR,
+      IPAddress::tryCreateNetwork("192.168.0.1/24/36").error());
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_IP,
+      IPAddress::tryCreateNetwork("").error());
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_IP,
+      IPAddress::tryCreateNetwork("192.168.0.300/24").error());
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_CIDR,
+      IPAddress::tryCreateNetwork("192.168.0.1/").error());
+  EXPECT_EQ(
+      CIDRNetworkError::INVALID_CIDR,
+      IPAddress::tryCreateNetwork("192.168.0.1/x").error());
+  EXPECT_EQ(
+      CIDRNetworkError::CIDR_MISMATCH,
+      IPAddress::tryCreateNetwork("192.168.0.1/33").error());
+  EXPECT_EQ(
+      CIDRNetworkError::CIDR_MISMATCH,
+      IPAddress::tryCreateNetwork("192.168.0.1", 33).error());
+
+  // createNetwork() throws what it always has
+  EXPECT_THROW(IPAddress::createNetwork("192.168.0.1", 256), std::range_error);
+  EXPECT_THROW(
+      IPAddress::createNetwork("192.168.0.1/x"), IPAddressFormatException);
+  EXPECT_THROW(
+      IPAddress::createNetwork("192.168.0.1/33"), IPAddressFormatException);
+}
+
 // test assignment operators
 TEST(IPAddress, Assignment) {
   static const string kIPv4Addr = "69.63.189.16";
@@ -1208,6 +1251,120 @@ TEST(IPAddress, StringFormat) {
   EXPECT_EQ("1.2.3.4", detail::fastIpv4ToString(a4));
 }
 
+TEST(IPAddress, ParseLikeInetPton) {
+  // The parsers accept exactly what inet_pton() does
+  std::vector<std::string> v4 = {
+      "1.2.3.4",     "0.0.0.0",      "255.255.255.255", "256.1.1.1",
+      "1.2.3",       "1.2.3.4.",     "1.2.3.4.5",       ".1.2.3.4",
+      "01.2.3.4",    "1.2.3.04",     "1..2.3",          "1.2.3.4 ",
+      "1.2.3.0x4",   "1.2.3.1000",   "",                "1.2.3.-4",
+      "10.0.0.255",  "100.200.25.9", "1.2.3.299",       "a.b.c.d",
+  };
+  for (auto& str : v4) {
+    in_addr expected;
+    bool valid = inet_pton(AF_INET, str.c_str(), &expected) == 1;
+    auto actual = IPAddressV4::tryFromString(str);
+    ASSERT_EQ(valid, actual.hasValue()) << str;
+    if (valid) {
+      EXPECT_EQ(expected.s_addr, actual->toAddr().s_addr) << str;
+    }
+  }
+
+  std::vector<std::string> v6 = {
+      "::",
+      "::1",
+      "1::",
+      "1:2:3:4:5:6:7:8",
+      "1:2:3:4:5:6:7::",
+      "::2:3:4:5:6:7:8",
+      "1:2:3:4:5:6:7:8:9",
+      "1:2:3:4:5:6:7",
+      "1:2:3:4:5:6:7::8",
+      "1::2::3",
+      ":::",
+      ":1::",
+      "1::2:",
+      "1:2:3:4:5:6:7:8:",
+      "12345::",
+      "abcd:EF01::",
+      "g::",
+      "::ffff:1.2.3.4",
+      "::1.2.3.4",
+      "1:2:3:4:5:6:1.2.3.4",
+      "1:2:3:4:5:6:7:1.2.3.4",
+      "::1.2.3",
+      "::1.2.3.04",
+      "1.2.3.4",
+      "fe80::1:2",
+      "2001:db8:0:0:1:0:0:1",
+      "",
+      ":",
+      "::ffff:1.2.3.4:5",
+  };
+  for (auto& str : v6) {
+    in6_addr expected;
+    bool valid = inet_pton(AF_INET6, str.c_str(), &expected) == 1;
+    ByteArray16 actual;
+    ASSERT_EQ(valid, detail::parseIPv6(str, actual.data())) << str;
+    if (valid) {
+      EXPECT_EQ(0, memcmp(expected.s6_addr, actual.data(), 16)) << str;
+    }
+  }
+  EXPECT_EQ("::1", IPAddressV6("[::1]").str());
+  EXPECT_FALSE(IPAddressV6::tryFromString("[").hasValue());
+}
+
+TEST(IPAddress, FormatLikeInetNtop) {
+  // Addresses with runs of 0s of all lengths in all places, and mapped and
+  // compatible IPv4 addresses
+  std::vector<ByteArray16> addrs;
+  for (uint32_t mask = 0; mask < 256; ++mask) {
+    ByteArray16 bytes{};
+    for (size_t i = 0; i < 8; ++i) {
+      if (mask & (1 << i)) {
+        bytes[2 * i] = uint8_t(i * 0x11);
+        bytes[2 * i + 1] = uint8_t(0x80 >> i);
+      }
+    }
+    addrs.push_back(bytes);
+    bytes[10] = bytes[11] = 0xff;
+    addrs.push_back(bytes);
+  }
+  for (auto& bytes : addrs) {
+    char expected[INET6_ADDRSTRLEN];
+    ASSERT_NE(
+        nullptr,
+        inet_ntop(AF_INET6, bytes.data(), expected, sizeof(expected)));
+    IPAddressV6 addr(bytes);
+    EXPECT_EQ(expected, addr.str());
+    EXPECT_EQ(addr, IPAddressV6(addr.str()));
+    EXPECT_EQ(addr, IPAddressV6(addr.toFullyQualified()));
+  }
+}
+
+TEST(IPAddress, TryFromStringBatch) {
+  std::vector<StringPiece> strs = {"1.2.3.4", "::1", "bogus", "10.0.0.1"};
+  std::vector<Expected<IPAddress, IPAddressFormatError>> results(strs.size());
+  IPAddress::tryFromString(range(strs), range(results));
+  EXPECT_EQ(IPAddress("1.2.3.4"), results[0].value());
+  EXPECT_EQ(IPAddress("::1"), results[1].value());
+  EXPECT_TRUE(results[2].hasError());
+  EXPECT_EQ(IPAddress("10.0.0.1"), results[3].value());
+
+  std::vector<Expected<IPAddressV4, IPAddressFormatError>> v4(strs.size());
+  IPAddressV4::tryFromString(range(strs), range(v4));
+  EXPECT_EQ(IPAddressV4("1.2.3.4"), v4[0].value());
+  EXPECT_TRUE(v4[1].hasError());
+  EXPECT_TRUE(v4[2].hasError());
+  EXPECT_EQ(IPAddressV4("10.0.0.1"), v4[3].value());
+
+  std::vector<Expected<IPAddressV6, IPAddressFormatError>> v6(strs.size());
+  IPAddressV6::tryFromString(range(strs), range(v6));
+  EXPECT_TRUE(v6[0].hasError());
+  EXPECT_EQ(IPAddressV6("::1"), v6[1].value());
+  EXPECT_TRUE(v6[2].hasError());
+}
+
 TEST(IPAddress, getMacAddressFromLinkLocal) {
   IPAddressV6 ip6("fe80::f652:14ff:fec5:74d8");
   EXPECT_TRUE(ip6.getMacAddressFromLinkLocal().hasValue());
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/IPPrefixTable.h>
+
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+namespace {
+
+constexpr size_t kPrefixes = 1000000;
+constexpr size_t kLookups = 4096;
+
+// Lengths distributed roughly as in a full IPv4 routing table: mostly /24,
+// then /22 and /23, and a few shorter ones
+std::vector<std::pair<CIDRNetwork, uint32_t>> makeNetworks() {
+  std::mt19937 rng(1);
+  std::vector<std::pair<CIDRNetwork, uint32_t>> networks;
+  networks.reserve(kPrefixes);
+  for (uint32_t i = 0; i < kPrefixes; ++i) {
+    uint32_t r = rng() % 100;
+    uint8_t length = r < 60 ? 24 : r < 75 ? 23 : r < 90 ? 22 : 8 + r % 14;
+    IPAddress addr(IPAddressV4::fromLongHBO(uint32_t(rng())));
+    networks.push_back({{addr, length}, i});
+  }
+  return networks;
+}
+
+const std::vector<std::pair<CIDRNetwork, uint32_t>>& networks() {
+  static auto result = makeNetworks();
+  return result;
+}
+
+const IPPrefixTable<uint32_t>& table() {
+  static IPPrefixTable<uint32_t> result(networks());
+  return result;
+}
+
+const std::vector<IPAddressV4>& addrs() {
+  static auto result = [] {
+    std::mt19937 rng(2);
+    std::vector<IPAddressV4> v;
+    for (size_t i = 0; i < kLookups; ++i) {
+      v.push_back(IPAddressV4::fromLongHBO(uint32_t(rng())));
+    }
+    return v;
+  }();
+  return result;
+}
+
+} // namespace
+
+BENCHMARK(build_1M_v4, iters) {
+  BenchmarkSuspender braces;
+  auto n = networks();
+  braces.dismiss();
+  while (iters--) {
+    IPPrefixTable<uint32_t> t(n);
+    doNotOptimizeAway(t.memoryUsage());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(lookup_v4_single, iters) {
+  BenchmarkSuspender braces;
+  auto& t = table();
+  auto& a = addrs();
+  braces.dismiss();
+  size_t found = 0;
+  while (iters--) {
+    for (auto& addr : a) {
+      found += t.lookup(addr) != nullptr;
+    }
+  }
+  doNotOptimizeAway(found);
+}
+
+BENCHMARK_RELATIVE(lookup_v4_batch, iters) {
+  BenchmarkSuspender braces;
+  auto& t = table();
+  auto& a = addrs();
+  std::vector<const uint32_t*> results(a.size());
+  braces.dismiss();
+  while (iters--) {
+    t.lookup(range(a), range(results));
+    doNotOptimizeAway(results.data());
+  }
+}
+
+// Benchmark results on Intel Xeon (AVX-512), 1 core
+// ============================================================================
+// folly/test/IPPrefixTableBenchmark.cpp           relative  time/iter  iters/s
+// ============================================================================
+// build_1M_v4                                                278.26ms     3.59
+// ----------------------------------------------------------------------------
+// lookup_v4_single                                            65.65us   15.23K
+// lookup_v4_batch                                  126.75%    51.79us   19.31K
+// ============================================================================
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  table();
+  addrs();
+  runBenchmarks();
+  return 0;
+}
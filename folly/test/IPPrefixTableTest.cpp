@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/IPPrefixTable.h>
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+using Networks = std::vector<std::pair<CIDRNetwork, int>>;
+
+// The value of the longest network containing addr, the last one if there
+// are duplicates
+const int* bruteForce(const Networks& networks, const IPAddress& addr) {
+  const int* best = nullptr;
+  int bestLength = -1;
+  for (auto& n : networks) {
+    if (n.first.first.family() == addr.family() &&
+        addr.inSubnet(n.first.first, n.first.second) &&
+        n.first.second >= bestLength) {
+      best = &n.second;
+      bestLength = n.first.second;
+    }
+  }
+  return best;
+}
+
+IPAddressV6 randomV6(std::mt19937_64& rng) {
+  std::array<uint8_t, 16> bytes;
+  uint64_t hi = rng();
+  uint64_t lo = rng();
+  for (size_t i = 0; i < 8; ++i) {
+    bytes[i] = uint8_t(hi >> (8 * i));
+    bytes[i + 8] = uint8_t(lo >> (8 * i));
+  }
+  return IPAddressV6::fromBinary(ByteRange(bytes.data(), bytes.size()));
+}
+
+// Random networks nested under a few random roots, so that prefixes often
+// contain each other, and addresses from them or near them
+void randomTest(bool v4, size_t count, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  unsigned bits = v4 ? 32 : 128;
+  std::vector<IPAddress> roots;
+  for (int i = 0; i < 8; ++i) {
+    roots.push_back(
+        v4 ? IPAddress(IPAddressV4::fromLongHBO(uint32_t(rng())))
+           : IPAddress(randomV6(rng)));
+  }
+  auto near = [&](const IPAddress& root) {
+    // root, with random bits after a random length
+    unsigned keep = rng() % (bits + 1);
+    IPAddress other = v4
+        ? IPAddress(IPAddressV4::fromLongHBO(uint32_t(rng())))
+        : IPAddress(randomV6(rng));
+    auto bytes = root.bytes();
+    std::vector<uint8_t> out(bytes, bytes + root.byteCount());
+    for (unsigned b = keep; b < bits; ++b) {
+      uint8_t mask = uint8_t(0x80 >> (b % 8));
+      out[b / 8] =
+          uint8_t((out[b / 8] & ~mask) | (other.bytes()[b / 8] & mask));
+    }
+    return IPAddress::fromBinary(ByteRange(out.data(), out.size()));
+  };
+
+  Networks networks;
+  for (size_t i = 0; i < count; ++i) {
+    auto addr = near(roots[rng() % roots.size()]);
+    uint8_t length = uint8_t(rng() % (bits + 1));
+    networks.push_back({{addr, length}, int(i)});
+  }
+  IPPrefixTable<int> table(networks);
+  EXPECT_EQ(count, table.size());
+
+  std::vector<IPAddress> addrs;
+  for (int i = 0; i < 2000; ++i) {
+    addrs.push_back(near(roots[rng() % roots.size()]));
+  }
+  for (auto& addr : addrs) {
+    auto expected = bruteForce(networks, addr);
+    auto actual = table.lookup(addr);
+    if (expected == nullptr) {
+      EXPECT_EQ(nullptr, actual) << addr;
+    } else {
+      ASSERT_NE(nullptr, actual) << addr;
+      EXPECT_EQ(*expected, *actual) << addr;
+    }
+  }
+
+  std::vector<const int*> results(addrs.size());
+  table.lookup(range(addrs), range(results));
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    EXPECT_EQ(table.lookup(addrs[i]), results[i]) << addrs[i];
+  }
+}
+
+} // namespace
+
+TEST(IPPrefixTable, Basic) {
+  IPPrefixTable<std::string> table({
+      {IPAddress::createNetwork("10.0.0.0/8"), "ten"},
+      {IPAddress::createNetwork("10.1.0.0/16"), "lab"},
+      {IPAddress::createNetwork("10.1.2.128/25"), "rack"},
+      {IPAddress::createNetwork("10.1.2.129/32"), "host"},
+      {IPAddress::createNetwork("2001:db8::/32"), "doc"},
+      {IPAddress::createNetwork("2001:db8:1::/48"), "site"},
+  });
+  auto lookup = [&](const char* addr) {
+    auto value = table.lookup(IPAddress(addr));
+    return value ? *value : std::string("none");
+  };
+  EXPECT_EQ("ten", lookup("10.200.0.1"));
+  EXPECT_EQ("lab", lookup("10.1.0.1"));
+  EXPECT_EQ("lab", lookup("10.1.2.127"));
+  EXPECT_EQ("rack", lookup("10.1.2.128"));
+  EXPECT_EQ("host", lookup("10.1.2.129"));
+  EXPECT_EQ("rack", lookup("10.1.2.255"));
+  EXPECT_EQ("none", lookup("11.0.0.1"));
+  EXPECT_EQ("doc", lookup("2001:db8::1"));
+  EXPECT_EQ("site", lookup("2001:db8:1:ffff::1"));
+  EXPECT_EQ("none", lookup("2001:db9::1"));
+  // IPv4 addresses don't match IPv6 networks, even mapped ones
+  EXPECT_EQ("none", lookup("::ffff:10.1.2.3"));
+  EXPECT_EQ("lab", *table.lookup(IPAddressV4("10.1.2.3")));
+  EXPECT_EQ(nullptr, table.lookup(IPAddressV6("::1")));
+  EXPECT_EQ(6, table.size());
+}
+
+TEST(IPPrefixTable, Defaults) {
+  IPPrefixTable<int> empty;
+  EXPECT_EQ(nullptr, empty.lookup(IPAddress("1.2.3.4")));
+  EXPECT_EQ(nullptr, empty.lookup(IPAddress("::1")));
+
+  IPPrefixTable<int> table({
+      {IPAddress::createNetwork("0.0.0.0/0"), 4},
+      {IPAddress::createNetwork("::/0"), 6},
+      {IPAddress::createNetwork("1.2.3.4/32"), 5},
+  });
+  EXPECT_EQ(4, *table.lookup(IPAddress("255.255.255.255")));
+  EXPECT_EQ(4, *table.lookup(IPAddress("1.2.3.5")));
+  EXPECT_EQ(5, *table.lookup(IPAddress("1.2.3.4")));
+  EXPECT_EQ(6, *table.lookup(IPAddress("ffff::1")));
+}
+
+TEST(IPPrefixTable, Duplicates) {
+  // The last one wins, and host bits don't matter
+  IPPrefixTable<int> table({
+      {{IPAddress("192.168.1.0"), 24}, 1},
+      {{IPAddress("192.168.1.77"), 24}, 2},
+      {{IPAddress("192.168.0.0"), 16}, 3},
+  });
+  EXPECT_EQ(2, *table.lookup(IPAddress("192.168.1.1")));
+  EXPECT_EQ(3, *table.lookup(IPAddress("192.168.2.1")));
+}
+
+TEST(IPPrefixTable, InvalidLength) {
+  using Table = IPPrefixTable<int>;
+  EXPECT_THROW(
+      Table({{{IPAddress("1.2.3.4"), 33}, 1}}), IPAddressFormatException);
+  EXPECT_THROW(
+      Table({{{IPAddress("::1"), 129}, 1}}), IPAddressFormatException);
+}
+
+TEST(IPPrefixTable, RandomV4) {
+  randomTest(true, 3000, 1);
+}
+
+TEST(IPPrefixTable, RandomV6) {
+  randomTest(false, 3000, 2);
+}
+
+TEST(IPPrefixTable, Batch) {
+  IPPrefixTable<int> table({
+      {IPAddress::createNetwork("10.0.0.0/8"), 1},
+      {IPAddress::createNetwork("10.1.2.0/24"), 2},
+      {IPAddress::createNetwork("fc00::/7"), 3},
+      {IPAddress::createNetwork("fd00:1:2:3:4::/80"), 4},
+  });
+  std::vector<IPAddressV4> v4;
+  std::vector<IPAddressV6> v6;
+  std::vector<IPAddress> mixed;
+  for (uint32_t i = 0; i < 300; ++i) {
+    v4.push_back(IPAddressV4::fromLongHBO(0x0a000000 + i * 0x10101));
+    v6.push_back(IPAddressV6(to<std::string>("fd00:1:2:3:", i % 7, "::1")));
+    mixed.push_back(i % 3 ? IPAddress(v4.back()) : IPAddress(v6.back()));
+  }
+  std::vector<const int*> results(300);
+  table.lookup(range(v4), range(results));
+  for (size_t i = 0; i < v4.size(); ++i) {
+    EXPECT_EQ(table.lookup(v4[i]), results[i]);
+  }
+  table.lookup(range(v6), range(results));
+  for (size_t i = 0; i < v6.size(); ++i) {
+    EXPECT_EQ(table.lookup(v6[i]), results[i]);
+  }
+  table.lookup(range(mixed), range(results));
+  for (size_t i = 0; i < mixed.size(); ++i) {
+    EXPECT_EQ(table.lookup(mixed[i]), results[i]);
+  }
+  EXPECT_EQ(3, *results[0]);
+  EXPECT_EQ(1, *results[1]);
+}
@@ -360,6 +360,18 @@ TEST(Json, UTF8Validation) {
   EXPECT_ANY_THROW(folly::json::serialize("a\xe0\xa0\x80z\xc0\x80", opts));
   EXPECT_ANY_THROW(folly::json::serialize("a\xe0\xa0\x80z\xe0\x80\x80", opts));
 
+  // longer strings, validated in blocks
+  std::string longValid;
+  for (int i = 0; i < 20; ++i) {
+    longValid += "\"a\xc2\x80\xe0\xa0\x80";
+  }
+  EXPECT_EQ(
+      folly::json::serialize(longValid, opts),
+      folly::json::serialize(longValid, folly::json::serialization_opts()));
+  EXPECT_ANY_THROW(folly::json::serialize(longValid + "\xc0\x80", opts));
+  EXPECT_ANY_THROW(
+      folly::json::serialize(longValid + "\xf0\x90\x80\x80", opts));
+
   opts.skip_invalid_utf8 = true;
   EXPECT_EQ(
       folly::json::serialize("a\xe0\xa0\x80z\xc0\x80", opts),
@@ -602,3 +614,55 @@ TEST(Json, RecursionLimit) {
   opts_high_recursion_limit.recursion_limit = 10000;
   parseJson(in, opts_high_recursion_limit);
 }
+
+TEST(Json, TryParse) {
+  using folly::tryParseJson;
+  auto ok = tryParseJson("{\"a\": [1, 2.5, \"x\\u00e9\", null]}");
+  ASSERT_TRUE(ok.hasValue());
+  EXPECT_EQ(parseJson("{\"a\": [1, 2.5, \"x\\u00e9\", null]}"), *ok);
+
+  auto bad = tryParseJson("[1, 2 3]");
+  ASSERT_TRUE(bad.hasError());
+  EXPECT_EQ(0, bad.error().line);
+  EXPECT_EQ("3]", bad.error().context);
+  EXPECT_EQ("expected ']'", bad.error().message);
+  EXPECT_EQ(
+      "json parse error on line 0 near `3]': expected ']'",
+      bad.error().what());
+
+  auto overflow = tryParseJson("[9223372036854775808]");
+  ASSERT_TRUE(overflow.hasError());
+  EXPECT_EQ(
+      folly::ConversionCode::POSITIVE_OVERFLOW,
+      overflow.error().conversionCode);
+  EXPECT_EQ("9223372036854775808", overflow.error().message);
+
+  folly::json::serialization_opts opts;
+  opts.recursion_limit = 10;
+  EXPECT_TRUE(tryParseJson(std::string(20, '[') + std::string(20, ']'), opts)
+                  .hasError());
+}
+
+TEST(Json, TryParseEveryPrefix) {
+  // Every way the input can end early fails cleanly, and parseJson() throws
+  // what tryParseJson() returns
+  std::string json =
+      "{\"key\": [1, -2, 3.5e2, true, false, null, \"s\\n\\u00e9\\ud834"
+      "\\udd1e\"], \"o\": {\"x\": {}}, \"e\": []}";
+  ASSERT_TRUE(folly::tryParseJson(json).hasValue());
+  for (size_t n = 0; n < json.size(); ++n) {
+    auto prefix = json.substr(0, n);
+    auto result = folly::tryParseJson(prefix);
+    bool parsed = true;
+    try {
+      parseJson(prefix);
+    } catch (std::runtime_error const& e) {
+      parsed = false;
+      ASSERT_TRUE(result.hasError()) << prefix;
+      if (result.error().conversionCode == folly::ConversionCode::SUCCESS) {
+        EXPECT_EQ(result.error().what(), e.what());
+      }
+    }
+    EXPECT_EQ(parsed, result.hasValue()) << prefix;
+  }
+}
@@ -17,9 +17,13 @@
 #include <folly/detail/MemoryIdler.h>
 
 #include <folly/Baton.h>
+#include <folly/ScopeGuard.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/Unistd.h>
 
+#include <cstring>
 #include <memory>
 #include <thread>
 
@@ -49,6 +53,57 @@ TEST(MemoryIdler, releaseMallocTLS) {
   delete[] p;
 }
 
+TEST(MemoryIdler, releasePages) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  auto p = static_cast<char*>(mmap(
+      nullptr,
+      8 * pageSize,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0));
+  ASSERT_NE(MAP_FAILED, p);
+  SCOPE_EXIT {
+    munmap(p, 8 * pageSize);
+  };
+  // Touch pages 1 to 3
+  memset(p + pageSize, 1, 3 * pageSize);
+  // Only whole pages are released, so page 1 isn't
+  auto released = MemoryIdler::releasePages(p + pageSize + 1, 3 * pageSize);
+#ifdef __linux__
+  EXPECT_EQ(2 * pageSize, released);
+  EXPECT_EQ(1, p[pageSize]);
+  EXPECT_EQ(0, p[2 * pageSize]);
+  EXPECT_EQ(0, p[4 * pageSize - 1]);
+#else
+  EXPECT_EQ(0, released);
+#endif
+  EXPECT_EQ(0, MemoryIdler::releasePages(p, 0));
+}
+
+TEST(MemoryIdler, idleCallbacks) {
+  size_t calls = 0;
+  auto callback = MemoryIdler::addIdleCallback([&] {
+    ++calls;
+    return size_t(100000);
+  });
+  auto before = MemoryIdler::bytesReleased();
+  EXPECT_LE(100000, MemoryIdler::releaseIdleMemory());
+  EXPECT_EQ(1, calls);
+  EXPECT_LE(before + 100000, MemoryIdler::bytesReleased());
+
+  // Only the registering thread runs it
+  std::thread([] { MemoryIdler::releaseIdleMemory(); }).join();
+  EXPECT_EQ(1, calls);
+
+  // Moved, then unregistered from another thread
+  auto moved = std::move(callback);
+  MemoryIdler::releaseIdleMemory();
+  EXPECT_EQ(2, calls);
+  std::thread([&] { moved.reset(); }).join();
+  MemoryIdler::releaseIdleMemory();
+  EXPECT_EQ(2, calls);
+}
 
 /// MockedAtom gives us a way to select a mocked Futex implementation
 /// inside Baton, even though the atom itself isn't exercised by the
@@ -181,3 +236,26 @@ TEST(MemoryIdler, futexWaitNeverFlush) {
   EXPECT_TRUE((MemoryIdler::futexWait<MockAtom, MockClock>(
       fut, 1, -1, MockClock::duration::max())));
 }
+
+TEST(MemoryIdler, futexWaitDisablesMallocCache) {
+  StrictMock<Futex<MockAtom>> fut;
+  auto clock = MockClock::setup();
+  MemoryIdler::setLocalMallocCacheEnabled(true);
+  // False if there's no cache to disable
+  bool hasCache = MemoryIdler::setLocalMallocCacheEnabled(true);
+  MemoryIdler::disableMallocCacheWhileIdle = true;
+  SCOPE_EXIT {
+    MemoryIdler::disableMallocCacheWhileIdle = false;
+  };
+
+  EXPECT_CALL(fut, futexWait(2, 0xff))
+      .WillOnce(Invoke([](uint32_t, uint32_t) {
+        // Disabled while waiting
+        EXPECT_FALSE(MemoryIdler::setLocalMallocCacheEnabled(false));
+        return true;
+      }));
+  EXPECT_TRUE((MemoryIdler::futexWait<MockAtom, MockClock>(
+      fut, 2, 0xff, std::chrono::seconds(0))));
+  // And enabled again after
+  EXPECT_EQ(hasCache, MemoryIdler::setLocalMallocCacheEnabled(true));
+}
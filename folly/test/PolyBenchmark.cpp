@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Poly.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/poly/Sealed.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+// Calls through a virtual function, a std::function, a Poly and a
+// PolySealed, on a mix of three types; and constructions of objects too big
+// for the default inline buffer of Poly and std::function.
+
+namespace {
+constexpr std::size_t kObjects = 1024;
+
+struct IApply {
+  template <class Base>
+  struct Interface : Base {
+    int apply(int i) const {
+      return folly::poly_call<0>(*this, i);
+    }
+  };
+  template <class T>
+  using Members = FOLLY_POLY_MEMBERS(&T::apply);
+};
+
+struct IApplyInline : PolyExtends<IApply> {
+  static constexpr std::size_t InlineSize = 64;
+};
+
+struct Add {
+  int apply(int i) const {
+    return i + n;
+  }
+  int n;
+};
+
+struct Mul {
+  int apply(int i) const {
+    return i * n;
+  }
+  int n;
+};
+
+struct Xor {
+  int apply(int i) const {
+    return i ^ n;
+  }
+  int n;
+};
+
+// Too big for the inline buffer of Poly (and of std::function), but not of
+// IApplyInline
+struct Wide {
+  int apply(int i) const {
+    return i + pad[0];
+  }
+  std::array<int, 12> pad{};
+};
+
+struct VirtualBase {
+  virtual ~VirtualBase() = default;
+  virtual int apply(int i) const = 0;
+};
+
+template <class T>
+struct Virtual : VirtualBase {
+  explicit Virtual(T t) : t_(t) {}
+  int apply(int i) const override {
+    return t_.apply(i);
+  }
+  T t_;
+};
+
+template <class F>
+void forEachObject(F f) {
+  for (std::size_t i = 0; i < kObjects; ++i) {
+    int n = int(i % 7) + 1;
+    switch (i % 3) {
+      case 0:
+        f(Add{n});
+        break;
+      case 1:
+        f(Mul{n});
+        break;
+      default:
+        f(Xor{n});
+        break;
+    }
+  }
+}
+
+template <class Objects, class Call>
+void callAll(std::size_t iters, Objects const& objects, Call call) {
+  int acc = 0;
+  for (std::size_t i = 0; i < iters; ++i) {
+    acc = call(objects[i % kObjects], acc);
+  }
+  doNotOptimizeAway(acc);
+}
+} // namespace
+
+BENCHMARK(call_virtual, iters) {
+  std::vector<std::unique_ptr<VirtualBase>> objects;
+  BENCHMARK_SUSPEND {
+    forEachObject([&](auto t) {
+      objects.push_back(std::make_unique<Virtual<decltype(t)>>(t));
+    });
+  }
+  callAll(iters, objects, [](auto& o, int acc) { return o->apply(acc); });
+}
+
+BENCHMARK_RELATIVE(call_std_function, iters) {
+  std::vector<std::function<int(int)>> objects;
+  BENCHMARK_SUSPEND {
+    forEachObject([&](auto t) {
+      objects.push_back([t](int i) { return t.apply(i); });
+    });
+  }
+  callAll(iters, objects, [](auto& o, int acc) { return o(acc); });
+}
+
+BENCHMARK_RELATIVE(call_poly, iters) {
+  std::vector<Poly<IApply>> objects;
+  BENCHMARK_SUSPEND {
+    forEachObject([&](auto t) { objects.push_back(t); });
+  }
+  callAll(iters, objects, [](auto& o, int acc) { return o.apply(acc); });
+}
+
+BENCHMARK_RELATIVE(call_poly_sealed, iters) {
+  std::vector<PolySealed<IApply, Add, Mul, Xor>> objects;
+  BENCHMARK_SUSPEND {
+    forEachObject([&](auto t) { objects.push_back(t); });
+  }
+  callAll(iters, objects, [](auto& o, int acc) { return o.apply(acc); });
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(construct_virtual, iters) {
+  for (std::size_t i = 0; i < iters; ++i) {
+    std::unique_ptr<VirtualBase> p = std::make_unique<Virtual<Wide>>(Wide{});
+    doNotOptimizeAway(p);
+  }
+}
+
+BENCHMARK_RELATIVE(construct_std_function, iters) {
+  for (std::size_t i = 0; i < iters; ++i) {
+    std::function<int(int)> f = [w = Wide{}](int i) { return w.apply(i); };
+    doNotOptimizeAway(f);
+  }
+}
+
+BENCHMARK_RELATIVE(construct_poly, iters) {
+  for (std::size_t i = 0; i < iters; ++i) {
+    Poly<IApply> p = Wide{};
+    doNotOptimizeAway(p);
+  }
+}
+
+BENCHMARK_RELATIVE(construct_poly_inline_size, iters) {
+  for (std::size_t i = 0; i < iters; ++i) {
+    Poly<IApplyInline> p = Wide{};
+    doNotOptimizeAway(p);
+  }
+}
+
+BENCHMARK_RELATIVE(construct_poly_sealed, iters) {
+  for (std::size_t i = 0; i < iters; ++i) {
+    PolySealed<IApply, Add, Wide> p = Wide{};
+    doNotOptimizeAway(p);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+  return 0;
+}
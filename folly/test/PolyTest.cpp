@@ -22,6 +22,7 @@
 #include <folly/Conv.h>
 #include <folly/poly/Nullable.h>
 #include <folly/poly/Regular.h>
+#include <folly/poly/Sealed.h>
 #include <folly/portability/GTest.h>
 
 #include <array>
@@ -563,4 +564,127 @@ TEST(Poly, Addable) {
   cc = aref + bref;
   EXPECT_EQ(6, poly_cast<int>(cc));
 }
+namespace {
+struct IFooBig : PolyExtends<Foo> {
+  static constexpr std::size_t InlineSize = 64;
+};
+
+struct IFooBarBig : PolyExtends<IFooBig, FooBar> {};
+
+struct big_foo_bar : foo_bar {
+  using foo_bar::foo_bar;
+  std::array<char, 40> pad_{};
+};
+
+struct huge_foo_bar : foo_bar {
+  std::array<char, 100> pad_{};
+};
+} // namespace
+
+TEST(Poly, InlineSize) {
+  static_assert(sizeof(big_foo_bar) > sizeof(Poly<Foo>), "");
+  static_assert(sizeof(Poly<IFooBig>) >= 64, "");
+  static_assert(sizeof(Poly<IFooBarBig>) == sizeof(Poly<IFooBig>), "");
+
+  Poly<IFooBig> p = big_foo_bar{42};
+  int i = 1;
+  p.foo(i);
+  EXPECT_EQ(43, i);
+  // Held in situ, within the Poly itself
+  auto addr = static_cast<void const*>(&poly_cast<big_foo_bar>(p));
+  EXPECT_GE(addr, static_cast<void const*>(&p));
+  EXPECT_LT(addr, static_cast<void const*>(&p + 1));
+
+  Poly<IFooBig> q = std::move(p);
+  q.foo(i);
+  EXPECT_EQ(85, i);
+  Poly<IFooBig> r = q;
+  r.foo(i);
+  EXPECT_EQ(127, i);
+
+  Poly<IFooBarBig> s = big_foo_bar{1};
+  EXPECT_EQ("2", s.bar(1));
+  r = s; // OK, the base interface's buffer is as large
+  r.foo(i);
+  EXPECT_EQ(128, i);
+  EXPECT_EQ(typeid(big_foo_bar), poly_type(r));
+
+  // Types that don't fit are still held on the heap
+  Poly<IFooBig> t = huge_foo_bar{};
+  EXPECT_EQ(typeid(huge_foo_bar), poly_type(t));
+  auto hugeAddr = static_cast<void const*>(&poly_cast<huge_foo_bar>(t));
+  EXPECT_TRUE(
+      hugeAddr < static_cast<void const*>(&t) ||
+      hugeAddr >= static_cast<void const*>(&t + 1));
+}
+
+namespace {
+struct foo_bar_2 {
+  void foo(int& i) {
+    i *= 2;
+  }
+  std::string bar(int i) const {
+    return folly::to<std::string>(i * 2);
+  }
+};
+
+using SealedFooBar = PolySealed<FooBar, foo_bar, foo_bar_2, big_foo_bar>;
+} // namespace
+
+TEST(PolySealed, Basic) {
+  static_assert(sizeof(SealedFooBar) > sizeof(big_foo_bar), "");
+
+  SealedFooBar p = foo_bar{42};
+  int i = 1;
+  p.foo(i);
+  EXPECT_EQ(43, i);
+  EXPECT_EQ("43", p.bar(1));
+  EXPECT_EQ(typeid(foo_bar), poly_type(p));
+  EXPECT_FALSE(poly_empty(p));
+
+  p = foo_bar_2{};
+  p.foo(i);
+  EXPECT_EQ(86, i);
+  EXPECT_EQ("2", p.bar(1));
+  EXPECT_EQ(typeid(foo_bar_2), poly_type(p));
+  EXPECT_NO_THROW(poly_cast<foo_bar_2>(p));
+  EXPECT_THROW(poly_cast<foo_bar>(p), BadPolyCast);
+
+  SealedFooBar const q = big_foo_bar{1};
+  EXPECT_EQ("2", q.bar(1));
+  EXPECT_EQ(typeid(big_foo_bar), poly_type(q));
+  EXPECT_EQ(
+      static_cast<void const*>(&q),
+      static_cast<void const*>(&poly_cast<big_foo_bar>(q)));
+}
+
+TEST(PolySealed, Empty) {
+  SealedFooBar p;
+  EXPECT_TRUE(poly_empty(p));
+  EXPECT_EQ(typeid(void), poly_type(p));
+  int i = 1;
+  EXPECT_THROW(p.foo(i), BadPolyAccess);
+  EXPECT_THROW(p.bar(i), BadPolyAccess);
+}
+
+TEST(PolySealed, CopyMove) {
+  SealedFooBar p = big_foo_bar{42};
+  SealedFooBar q = p;
+  EXPECT_EQ("43", q.bar(1));
+  EXPECT_EQ("43", p.bar(1));
+
+  SealedFooBar r = std::move(p);
+  EXPECT_TRUE(poly_empty(p));
+  EXPECT_EQ("43", r.bar(1));
+
+  p = foo_bar_2{};
+  swap(p, r);
+  EXPECT_EQ("43", p.bar(1));
+  EXPECT_EQ("2", r.bar(1));
+
+  r = q;
+  EXPECT_EQ(typeid(big_foo_bar), poly_type(r));
+  q = SealedFooBar();
+  EXPECT_TRUE(poly_empty(q));
+}
 #endif
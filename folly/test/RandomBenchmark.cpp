@@ -18,6 +18,7 @@
 
 #include <random>
 #include <thread>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -62,6 +63,15 @@ BENCHMARK(sfmt19937, n) {
 }
 #endif
 
+BENCHMARK(xoshiro, n) {
+  BenchmarkSuspender braces;
+  auto rng = Random::create<XoshiroPRNG>();
+
+  braces.dismiss();
+
+  FOR_EACH_RANGE(i, 0, n) { doNotOptimizeAway(rng()); }
+}
+
 BENCHMARK(threadprng, n) {
   BenchmarkSuspender braces;
   ThreadLocalPRNG tprng;
@@ -79,6 +89,78 @@ BENCHMARK(Random64) { doNotOptimizeAway(Random::rand64()); }
 BENCHMARK(Random64Num) { doNotOptimizeAway(Random::rand64(100ull << 32)); }
 BENCHMARK(Random64OneIn) { doNotOptimizeAway(Random::oneIn(100)); }
 
+
+BENCHMARK_DRAW_LINE();
+
+// 1024 random values per iteration, one at a time or with fill()
+
+BENCHMARK(Random32Loop1024, n) {
+  std::vector<uint32_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    for (auto& v : vals) {
+      v = Random::rand32();
+    }
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK_RELATIVE(Random32Fill1024, n) {
+  std::vector<uint32_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    Random::fill(range(vals));
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK(Random64Loop1024, n) {
+  std::vector<uint64_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    for (auto& v : vals) {
+      v = Random::rand64();
+    }
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK_RELATIVE(XoshiroLoop1024, n) {
+  BenchmarkSuspender braces;
+  auto rng = Random::create<XoshiroPRNG>();
+  std::vector<uint64_t> vals(1024);
+  braces.dismiss();
+  FOR_EACH_RANGE(i, 0, n) {
+    for (auto& v : vals) {
+      v = rng();
+    }
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK_RELATIVE(Random64Fill1024, n) {
+  std::vector<uint64_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    Random::fill(range(vals));
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK(Random32NumLoop1024, n) {
+  std::vector<uint32_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    for (auto& v : vals) {
+      v = Random::rand32(100);
+    }
+    doNotOptimizeAway(vals);
+  }
+}
+
+BENCHMARK_RELATIVE(Random32NumFill1024, n) {
+  std::vector<uint32_t> vals(1024);
+  FOR_EACH_RANGE(i, 0, n) {
+    Random::fill(range(vals), 100);
+    doNotOptimizeAway(vals);
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -138,3 +138,145 @@ TEST(Random, sanity) {
         std::unordered_set<uint64_t>(vals.begin(), vals.end()).size());
   }
 }
+
+namespace {
+
+// The reference xoshiro256++, seeded as XoshiroPRNG::seed(uint64_t) seeds
+// its first stream
+struct ReferenceXoshiro {
+  explicit ReferenceXoshiro(uint64_t seed) {
+    for (auto& word : s) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t operator()() {
+    uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  void jump() {
+    static const uint64_t kJump[] = {0x180ec6d33cfd0abaULL,
+                                     0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL,
+                                     0x39abdc4529b1661cULL};
+    uint64_t j[4] = {0, 0, 0, 0};
+    for (auto jump : kJump) {
+      for (int b = 0; b < 64; b++) {
+        if (jump & (uint64_t(1) << b)) {
+          for (int i = 0; i < 4; i++) {
+            j[i] ^= s[i];
+          }
+        }
+        (*this)();
+      }
+    }
+    std::copy(j, j + 4, s);
+  }
+
+  uint64_t s[4];
+};
+
+} // namespace
+
+TEST(Random, Xoshiro) {
+  EXPECT_EQ(8, detail::StateSizeT<XoshiroPRNG>::value);
+
+  XoshiroPRNG rng(42);
+  ReferenceXoshiro ref(42);
+  std::vector<uint64_t> vals;
+  for (size_t i = 0; i < 100 * XoshiroPRNG::kStreams; ++i) {
+    vals.push_back(rng());
+  }
+  // Stream k is the reference generator, jumped k times
+  for (size_t k = 0; k < XoshiroPRNG::kStreams; ++k) {
+    ReferenceXoshiro stream = ref;
+    for (size_t i = k; i < vals.size(); i += XoshiroPRNG::kStreams) {
+      EXPECT_EQ(stream(), vals[i]) << k << " " << i;
+    }
+    ref.jump();
+  }
+  EXPECT_EQ(
+      vals.size(),
+      std::unordered_set<uint64_t>(vals.begin(), vals.end()).size());
+
+  auto a = Random::create<XoshiroPRNG>();
+  auto b = a;
+  EXPECT_EQ(b(), Random::rand64(a));
+  EXPECT_EQ(uint32_t(b()), Random::rand32(a));
+  EXPECT_NE(Random::create<XoshiroPRNG>()(), a());
+}
+
+TEST(Random, XoshiroFill) {
+  // fill() returns the same values as operator(), from any stream
+  for (size_t skip = 0; skip < XoshiroPRNG::kStreams; ++skip) {
+    for (size_t n : {0, 1, 7, 8, 9, 63, 100, 1000}) {
+      XoshiroPRNG a(skip);
+      XoshiroPRNG b(skip);
+      for (size_t i = 0; i < skip; ++i) {
+        a();
+        b();
+      }
+      std::vector<uint64_t> vals(n);
+      a.fill(range(vals));
+      for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(b(), vals[i]) << skip << " " << n << " " << i;
+      }
+      EXPECT_EQ(b(), a());
+
+      std::vector<uint32_t> vals32(n);
+      a.fill(range(vals32));
+      for (size_t i = 0; i < n; i += 2) {
+        uint64_t v = b();
+        EXPECT_EQ(uint32_t(v), vals32[i]);
+        if (i + 1 < n) {
+          EXPECT_EQ(uint32_t(v >> 32), vals32[i + 1]);
+        }
+      }
+      EXPECT_EQ(b(), a());
+    }
+  }
+}
+
+TEST(Random, FillBounded) {
+  std::vector<uint32_t> vals(100000);
+  for (uint32_t max : {0u, 1u, 3u, 100u, 1000u, 0x80000001u, 0xffffffffu}) {
+    Random::fill(range(vals), max);
+    for (auto v : vals) {
+      EXPECT_LT(v, std::max(max, 1u));
+    }
+  }
+
+  // Roughly uniform
+  std::mt19937 rng(1);
+  std::vector<size_t> counts(10);
+  Random::fill(range(vals), 10, rng);
+  for (auto v : vals) {
+    ++counts[v];
+  }
+  for (auto count : counts) {
+    EXPECT_NEAR(vals.size() / 10, count, vals.size() / 100);
+  }
+
+  std::vector<uint64_t> vals64(1000);
+  Random::fill(range(vals64));
+  EXPECT_EQ(
+      vals64.size(),
+      std::unordered_set<uint64_t>(vals64.begin(), vals64.end()).size());
+  Random::fill(range(vals));
+  Random::fill(range(vals64), rng);
+}
@@ -96,6 +96,7 @@ using SingletonBenchmark = Singleton <T, Tag, BenchmarkTag>;
 struct GetTag{};
 struct TryGetTag{};
 struct TryGetFastTag{};
+struct ApplyTag{};
 
 SingletonBenchmark<BenchmarkSingleton, GetTag> benchmark_singleton_get;
 SingletonBenchmark<BenchmarkSingleton, TryGetTag> benchmark_singleton_try_get;
@@ -150,6 +151,25 @@ BENCHMARK(FollySingletonTryGetFast4Threads, n) {
     });
 }
 
+SingletonBenchmark<BenchmarkSingleton, ApplyTag> benchmark_singleton_apply;
+
+void follySingletonApply(size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    SingletonBenchmark<BenchmarkSingleton, ApplyTag>::apply(
+        [](BenchmarkSingleton* s) { doNotOptimizeAway(s); });
+  }
+}
+
+BENCHMARK(FollySingletonApply, n) {
+  follySingletonApply(n);
+}
+
+BENCHMARK(FollySingletonApply4Threads, n) {
+  run4Threads([=]() {
+      follySingletonApply(n);
+    });
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   gflags::SetCommandLineOptionWithMode(
@@ -573,6 +573,83 @@ TEST(Singleton, SingletonEagerInitParallel) {
   }
 }
 
+struct ApplyTag {};
+template <typename T, typename Tag = detail::DefaultTag>
+using SingletonApply = Singleton<T, Tag, ApplyTag>;
+TEST(Singleton, Apply) {
+  using namespace std::chrono;
+  auto& vault = *SingletonVault::singleton<ApplyTag>();
+  std::atomic<bool> tornDown{false};
+  SingletonApply<int> sing(
+      [] { return new int(42); },
+      [&](int* p) {
+        tornDown = true;
+        delete p;
+      });
+  vault.registrationComplete();
+
+  EXPECT_EQ(42, SingletonApply<int>::apply([](int* p) { return *p; }));
+  EXPECT_EQ(
+      SingletonApply<int>::try_get().get(),
+      SingletonApply<int>::apply([](int* p) { return p; }));
+
+  // destroyInstances() waits for apply() calls in progress
+  Baton<> applying;
+  std::thread thread([&] {
+    SingletonApply<int>::apply([&](int* p) {
+      applying.post();
+      /* sleep override */ std::this_thread::sleep_for(milliseconds(100));
+      EXPECT_FALSE(tornDown);
+      EXPECT_EQ(42, *p);
+    });
+  });
+  applying.wait();
+  vault.destroyInstances();
+  EXPECT_TRUE(tornDown);
+  thread.join();
+
+  EXPECT_EQ(nullptr, SingletonApply<int>::apply([](int* p) { return p; }));
+  vault.reenableInstances();
+  EXPECT_EQ(42, SingletonApply<int>::apply([](int* p) { return *p; }));
+  vault.destroyInstances();
+}
+
+struct CreationTimesTag {};
+template <typename T, typename Tag = detail::DefaultTag>
+using SingletonCreationTimes = Singleton<T, Tag, CreationTimesTag>;
+struct CreationTimesInner {};
+struct CreationTimesOuter {};
+TEST(Singleton, CreationTimes) {
+  using namespace std::chrono;
+  auto& vault = *SingletonVault::singleton<CreationTimesTag>();
+  SingletonCreationTimes<int, CreationTimesInner> inner([] {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(30));
+    return new int(1);
+  });
+  SingletonCreationTimes<int, CreationTimesOuter> outer([] {
+    /* sleep override */ std::this_thread::sleep_for(milliseconds(20));
+    return new int(*SingletonCreationTimes<int, CreationTimesInner>::try_get());
+  });
+  vault.registrationComplete();
+  EXPECT_TRUE(vault.creationTimes().empty());
+
+  auto value = SingletonCreationTimes<int, CreationTimesOuter>::try_get();
+  EXPECT_EQ(1, *value);
+  value.reset();
+  auto times = vault.creationTimes();
+  ASSERT_EQ(2, times.size());
+  // The inner one is done first
+  EXPECT_GE(times[0].self, milliseconds(30));
+  EXPECT_EQ(times[0].self, times[0].total);
+  EXPECT_GE(times[1].total, milliseconds(50));
+  EXPECT_GE(times[1].self, milliseconds(20));
+  EXPECT_EQ(times[1].total - times[0].total, times[1].self);
+
+  vault.destroyInstances();
+  EXPECT_TRUE(vault.creationTimes().empty());
+  vault.reenableInstances();
+}
+
 struct MockTag {};
 template <typename T, typename Tag = detail::DefaultTag>
 using SingletonMock = Singleton <T, Tag, MockTag>;
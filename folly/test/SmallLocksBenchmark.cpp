@@ -22,7 +22,9 @@
 #include <vector>
 
 #include <folly/Benchmark.h>
+#include <folly/Optional.h>
 #include <folly/SmallLocks.h>
+#include <folly/synchronization/DistributedMutex.h>
 
 /* "Work cycle" is just an additional nop loop iteration.
  * A smaller number of work cyles will result in more contention,
@@ -81,6 +83,39 @@ class InitLock {
   }
 };
 
+// lock() and unlock() for DistributedMutex, which needs the proxy back
+class DistributedMutexLock {
+ public:
+  void lock() {
+    proxy_.emplace(mutex_.lock());
+  }
+  void unlock() {
+    mutex_.unlock(std::move(*proxy_));
+    proxy_.clear();
+  }
+
+ private:
+  folly::DistributedMutex mutex_;
+  folly::Optional<folly::DistributedMutex::Proxy> proxy_;
+};
+
+// Runs critical sections with lock_combine()
+struct CombiningDistributedMutex {
+  folly::DistributedMutex mutex;
+};
+
+template <typename Lock, typename Function>
+static void lockAndRun(Lock& lock, Function function) {
+  lock.lock();
+  function();
+  lock.unlock();
+}
+
+template <typename Function>
+static void lockAndRun(CombiningDistributedMutex& lock, Function function) {
+  lock.mutex.lock_combine(function);
+}
+
 template <typename Lock>
 static void runContended(size_t numOps, size_t numThreads) {
   folly::BenchmarkSuspender braces;
@@ -110,10 +145,10 @@ static void runContended(size_t numOps, size_t numThreads) {
       lockstruct* lock = &locks[t % threadgroups];
       runbarrier.wait();
       for (size_t op = 0; op < numOps; op += 1) {
-        lock->lock.lock();
-        burn(FLAGS_work);
-        lock->value++;
-        lock->lock.unlock();
+        lockAndRun(lock->lock, [&] {
+          burn(FLAGS_work);
+          lock->value++;
+        });
         burn(FLAGS_unlocked_work);
       }
     });
@@ -266,6 +301,21 @@ BENCHMARK(MicroLockUncontendedBenchmark, iters) {
   }
 }
 
+BENCHMARK(DistributedMutexUncontendedBenchmark, iters) {
+  folly::DistributedMutex lock;
+  while (iters--) {
+    auto proxy = lock.lock();
+    lock.unlock(std::move(proxy));
+  }
+}
+
+BENCHMARK(DistributedMutexCombineUncontendedBenchmark, iters) {
+  folly::DistributedMutex lock;
+  while (iters--) {
+    lock.lock_combine([] {});
+  }
+}
+
 struct VirtualBase {
   virtual void foo() = 0;
   virtual ~VirtualBase() {}
@@ -308,42 +358,64 @@ static void folly_picospin(size_t numOps, size_t numThreads) {
 static void folly_microlock(size_t numOps, size_t numThreads) {
   runContended<folly::MicroLock>(numOps, numThreads);
 }
+static void folly_distributed_mutex(size_t numOps, size_t numThreads) {
+  runContended<DistributedMutexLock>(numOps, numThreads);
+}
+static void folly_distributed_mutex_combine(
+    size_t numOps,
+    size_t numThreads) {
+  runContended<CombiningDistributedMutex>(numOps, numThreads);
+}
 
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 1thread, 1)
 BENCH_REL(folly_microspin, 1thread, 1)
 BENCH_REL(folly_picospin, 1thread, 1)
 BENCH_REL(folly_microlock, 1thread, 1)
+BENCH_REL(folly_distributed_mutex, 1thread, 1)
+BENCH_REL(folly_distributed_mutex_combine, 1thread, 1)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 2thread, 2)
 BENCH_REL(folly_microspin, 2thread, 2)
 BENCH_REL(folly_picospin, 2thread, 2)
 BENCH_REL(folly_microlock, 2thread, 2)
+BENCH_REL(folly_distributed_mutex, 2thread, 2)
+BENCH_REL(folly_distributed_mutex_combine, 2thread, 2)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 4thread, 4)
 BENCH_REL(folly_microspin, 4thread, 4)
 BENCH_REL(folly_picospin, 4thread, 4)
 BENCH_REL(folly_microlock, 4thread, 4)
+BENCH_REL(folly_distributed_mutex, 4thread, 4)
+BENCH_REL(folly_distributed_mutex_combine, 4thread, 4)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 8thread, 8)
 BENCH_REL(folly_microspin, 8thread, 8)
 BENCH_REL(folly_picospin, 8thread, 8)
 BENCH_REL(folly_microlock, 8thread, 8)
+BENCH_REL(folly_distributed_mutex, 8thread, 8)
+BENCH_REL(folly_distributed_mutex_combine, 8thread, 8)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 16thread, 16)
 BENCH_REL(folly_microspin, 16thread, 16)
 BENCH_REL(folly_picospin, 16thread, 16)
 BENCH_REL(folly_microlock, 16thread, 16)
+BENCH_REL(folly_distributed_mutex, 16thread, 16)
+BENCH_REL(folly_distributed_mutex_combine, 16thread, 16)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 32thread, 32)
 BENCH_REL(folly_microspin, 32thread, 32)
 BENCH_REL(folly_picospin, 32thread, 32)
 BENCH_REL(folly_microlock, 32thread, 32)
+BENCH_REL(folly_distributed_mutex, 32thread, 32)
+BENCH_REL(folly_distributed_mutex_combine, 32thread, 32)
 BENCHMARK_DRAW_LINE()
 BENCH_BASE(std_mutex, 64thread, 64)
 BENCH_REL(folly_microspin, 64thread, 64)
 BENCH_REL(folly_picospin, 64thread, 64)
 BENCH_REL(folly_microlock, 64thread, 64)
+BENCH_REL(folly_distributed_mutex, 64thread, 64)
+BENCH_REL(folly_distributed_mutex_combine, 64thread, 64)
 
 #define FairnessTest(type) \
   {                        \
@@ -358,6 +430,7 @@ int main(int argc, char** argv) {
   FairnessTest(InitLock<folly::MicroSpinLock>);
   FairnessTest(InitLock<folly::PicoSpinLock<uint16_t>>);
   FairnessTest(folly::MicroLock);
+  FairnessTest(DistributedMutexLock);
 
   folly::runBenchmarks();
 
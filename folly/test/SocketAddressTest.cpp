@@ -32,6 +32,7 @@ using std::string;
 using std::cerr;
 using std::endl;
 using folly::SocketAddress;
+using folly::SocketAddressFormatError;
 using folly::SocketAddressTestHelper;
 using folly::test::TemporaryDirectory;
 
@@ -61,6 +62,20 @@ TEST(SocketAddress, StringConversion) {
   char buf[30];
   addr.getAddressStr(buf, 2);
   EXPECT_STREQ(buf, "1");
+  addr.getAddressStr(buf, sizeof(buf));
+  EXPECT_STREQ(buf, "1.2.3.4");
+
+  auto v6 = SocketAddress("fe80::1", 80).getIPAddress().asV6();
+  v6.setScopeId(1);
+  SocketAddress scoped(folly::IPAddress(v6), 80);
+  char buf6[folly::IPAddress::kMaxStrSize + 1];
+  scoped.getAddressStr(buf6, sizeof(buf6));
+  EXPECT_EQ(scoped.getAddressStr(), buf6);
+  EXPECT_EQ(v6.str(), buf6);
+
+  SocketAddress unix1;
+  unix1.setFromPath("/foo");
+  EXPECT_THROW(unix1.getAddressStr(buf, sizeof(buf)), std::invalid_argument);
 }
 
 TEST(SocketAddress, IPv4ToStringConversion) {
@@ -196,6 +211,39 @@ TEST(SocketAddress, SetFromStrings) {
   EXPECT_THROW(addr.setFromIpPort("[::]"), std::system_error);
 }
 
+TEST(SocketAddress, TryFromIpPort) {
+  auto addr = SocketAddress::tryFromIpPort("1.2.3.4:9999");
+  ASSERT_TRUE(addr.hasValue());
+  EXPECT_EQ(SocketAddress("1.2.3.4", 9999), addr.value());
+  addr = SocketAddress::tryFromIpPort("2620:0:1cfe:face:b00c::3:65535");
+  ASSERT_TRUE(addr.hasValue());
+  EXPECT_EQ(SocketAddress("2620:0:1cfe:face:b00c::3", 65535), addr.value());
+  addr = SocketAddress::tryFromIpPort("[9:8::2]:1234");
+  ASSERT_TRUE(addr.hasValue());
+  EXPECT_EQ(AF_INET6, addr->getFamily());
+  EXPECT_EQ("9:8::2", addr->getAddressStr());
+  EXPECT_EQ(1234, addr->getPort());
+  addr = SocketAddress::tryFromIpPort("[::1]", 80);
+  ASSERT_TRUE(addr.hasValue());
+  EXPECT_EQ(SocketAddress("::1", 80), addr.value());
+
+  EXPECT_EQ(
+      SocketAddressFormatError::MISSING_PORT,
+      SocketAddress::tryFromIpPort("4321").error());
+  EXPECT_EQ(
+      SocketAddressFormatError::INVALID_PORT,
+      SocketAddress::tryFromIpPort("1.2.3.4:65536").error());
+  EXPECT_EQ(
+      SocketAddressFormatError::INVALID_PORT,
+      SocketAddress::tryFromIpPort("1.2.3.4:").error());
+  EXPECT_EQ(
+      SocketAddressFormatError::INVALID_IP,
+      SocketAddress::tryFromIpPort("localhost:80").error());
+  EXPECT_EQ(
+      SocketAddressFormatError::INVALID_IP,
+      SocketAddress::tryFromIpPort("1.2.3:80").error());
+}
+
 TEST(SocketAddress, EqualityAndHash) {
   // IPv4
   SocketAddress local1("127.0.0.1", 1234);
@@ -299,6 +347,43 @@ TEST(SocketAddress, EqualityAndHash) {
   EXPECT_NE(unix3.hash(), unixAnon2.hash());
 }
 
+TEST(SocketAddress, Packed) {
+  SocketAddress v4("10.0.0.3", 99);
+  SocketAddress v6("2620:0:1c00:face:b00c::abcd", 1234);
+  SocketAddress v6Mapped("::ffff:10.0.0.3", 99);
+  SocketAddress scoped("fe80::1", 443);
+  auto scopedV6 = scoped.getIPAddress().asV6();
+  scopedV6.setScopeId(2);
+  scoped = SocketAddress(folly::IPAddress(scopedV6), 443);
+
+  for (const auto& addr : {v4, v6, v6Mapped, scoped}) {
+    auto packed = addr.pack();
+    EXPECT_EQ(addr.getFamily(), packed.family());
+    EXPECT_EQ(addr.getPort(), packed.port());
+    EXPECT_EQ(addr.hash(), packed.hash());
+    EXPECT_EQ(addr.hash(), std::hash<folly::PackedSocketAddress>()(packed));
+    SocketAddress unpacked(packed);
+    EXPECT_EQ(addr, unpacked);
+    EXPECT_EQ(addr.describe(), unpacked.describe());
+  }
+  EXPECT_EQ(2, scoped.pack().scopeId());
+
+  EXPECT_EQ(v4.pack(), SocketAddress("10.0.0.3", 99).pack());
+  EXPECT_NE(v4.pack(), SocketAddress("10.0.0.3", 98).pack());
+  EXPECT_NE(v4.pack(), SocketAddress("10.0.0.4", 99).pack());
+  // Like SocketAddress, IPv4-mapped and IPv4 addresses are different
+  EXPECT_NE(v4.pack(), v6Mapped.pack());
+  EXPECT_NE(v4.pack().hash(), v6Mapped.pack().hash());
+  EXPECT_NE(SocketAddress("fe80::1", 443).pack(), scoped.pack());
+
+  SocketAddress unix1;
+  unix1.setFromPath("/foo");
+  EXPECT_THROW(unix1.pack(), std::invalid_argument);
+  EXPECT_THROW(SocketAddress().pack(), std::invalid_argument);
+  folly::PackedSocketAddress unspec{};
+  EXPECT_THROW(SocketAddress{unspec}, std::invalid_argument);
+}
+
 TEST(SocketAddress, IsPrivate) {
   // IPv4
   SocketAddress addr("9.255.255.255", 0);
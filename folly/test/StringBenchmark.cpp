@@ -240,6 +240,48 @@ BENCHMARK(splitStrFixed, iters) {
   }
 }
 
+namespace {
+
+// A line of a TSV log: 40 short fields
+std::string makeTsvLine() {
+  std::string line;
+  for (int i = 0; i < 40; ++i) {
+    line += (i ? "\t" : "") + folly::to<std::string>(i * 7919 % 100000);
+  }
+  return line;
+}
+
+} // namespace
+
+BENCHMARK(splitTsvLine, iters) {
+  static const std::string line = makeTsvLine();
+  std::vector<StringPiece> pieces;
+  for (size_t i = 0; i < iters; ++i) {
+    pieces.clear();
+    folly::split('\t', line, pieces);
+    folly::doNotOptimizeAway(pieces.size());
+  }
+}
+
+BENCHMARK_RELATIVE(splitIntoTsvLine, iters) {
+  static const std::string line = makeTsvLine();
+  StringPiece pieces[64];
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(folly::splitInto('\t', line, pieces, 64));
+  }
+}
+
+BENCHMARK_RELATIVE(splitLazyTsvLine, iters) {
+  static const std::string line = makeTsvLine();
+  for (size_t i = 0; i < iters; ++i) {
+    size_t size = 0;
+    for (auto piece : folly::splitLazy('\t', line)) {
+      size += piece.size();
+    }
+    folly::doNotOptimizeAway(size);
+  }
+}
+
 BENCHMARK(boost_splitOnSingleChar, iters) {
   static const std::string line = "one:two:three:four";
   bool (*pred)(char) = [](char c) -> bool { return c == ':'; };
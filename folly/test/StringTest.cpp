@@ -21,6 +21,7 @@
 #include <folly/String.h>
 
 #include <cinttypes>
+#include <random>
 
 #include <boost/regex.hpp>
 
@@ -961,6 +962,131 @@ TEST(Split, fixed_convert_custom) {
   EXPECT_THROW(folly::split(',', "B,G", c1, c2), my::ColorError);
 }
 
+namespace {
+
+// One character at a time, as split() used to
+std::vector<StringPiece>
+referenceSplit(StringPiece delim, StringPiece sp, bool ignoreEmpty) {
+  std::vector<StringPiece> out;
+  if (delim.empty()) {
+    if (!ignoreEmpty || !sp.empty()) {
+      out.push_back(sp);
+    }
+    return out;
+  }
+  const char* start = sp.begin();
+  for (const char* p = sp.begin(); p + delim.size() <= sp.end();) {
+    if (StringPiece(p, delim.size()) == delim) {
+      if (!ignoreEmpty || p != start) {
+        out.emplace_back(start, p);
+      }
+      p += delim.size();
+      start = p;
+    } else {
+      ++p;
+    }
+  }
+  if (!ignoreEmpty || start != sp.end()) {
+    out.emplace_back(start, sp.end());
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(Split, random) {
+  // Long enough to be searched 64 bytes at a time, with delimiters at
+  // block boundaries and across them
+  std::mt19937 rng(1234);
+  for (StringPiece delim : {",", "ab", "aba", "-*-", ""}) {
+    for (int i = 0; i < 2000; ++i) {
+      std::string s(rng() % 300, 'x');
+      for (auto& c : s) {
+        c = "abx,-*"[rng() % (rng() % 4 == 0 ? 6 : 3)];
+      }
+      for (bool ignoreEmpty : {false, true}) {
+        auto expected = referenceSplit(delim, s, ignoreEmpty);
+        std::vector<StringPiece> pieces;
+        folly::split(delim, s, pieces, ignoreEmpty);
+        EXPECT_EQ(expected, pieces) << delim << " " << s;
+        if (delim.size() == 1) {
+          pieces.clear();
+          folly::split(delim.front(), s, pieces, ignoreEmpty);
+          EXPECT_EQ(expected, pieces) << s;
+        }
+
+        std::vector<StringPiece> lazy;
+        for (auto piece : folly::splitLazy(delim, s, ignoreEmpty)) {
+          lazy.push_back(piece);
+        }
+        EXPECT_EQ(expected, lazy) << delim << " " << s;
+      }
+    }
+  }
+}
+
+TEST(Split, splitInto) {
+  StringPiece fields[4];
+  EXPECT_EQ(3, folly::splitInto('\t', "a\t\tc", fields, 4));
+  EXPECT_EQ("a", fields[0]);
+  EXPECT_EQ("", fields[1]);
+  EXPECT_EQ("c", fields[2]);
+
+  // The rest of the input goes to the last field
+  EXPECT_EQ(4, folly::splitInto('\t', "a\tb\tc\td\te\tf", fields, 4));
+  EXPECT_EQ("c", fields[2]);
+  EXPECT_EQ("d\te\tf", fields[3]);
+  EXPECT_EQ(2, folly::splitInto("::", "a::b:c", fields, 4));
+  EXPECT_EQ("b:c", fields[1]);
+  EXPECT_EQ(1, folly::splitInto(",", "", fields, 4));
+  EXPECT_EQ("", fields[0]);
+  EXPECT_EQ(0, folly::splitInto(",", "a,b", fields, 0));
+
+  // Same as split<false>() for any number of fields
+  std::string line;
+  for (int i = 0; i < 100; ++i) {
+    line += to<std::string>(i) + "\t";
+  }
+  StringPiece many[100];
+  for (size_t n = 1; n <= 100; ++n) {
+    ASSERT_EQ(n, folly::splitInto('\t', line, many, n));
+    std::vector<StringPiece> expected;
+    folly::split('\t', line, expected);
+    for (size_t j = 0; j + 1 < n; ++j) {
+      EXPECT_EQ(expected[j], many[j]);
+    }
+    EXPECT_EQ(line.data() + line.size(), many[n - 1].end());
+  }
+}
+
+TEST(Split, lazy) {
+  std::vector<std::string> pieces;
+  for (auto piece : folly::splitLazy(',', "a,,b")) {
+    pieces.push_back(piece.str());
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "", "b"}), pieces);
+
+  auto split = folly::splitLazy("--", "--x----y--", true);
+  auto it = split.begin();
+  ASSERT_NE(split.end(), it);
+  EXPECT_EQ("x", *it);
+  EXPECT_EQ(1, it->size());
+  ASSERT_NE(split.end(), ++it);
+  EXPECT_EQ("y", *it);
+  EXPECT_EQ(split.end(), ++it);
+
+  // Nothing but empty pieces, over several batches
+  std::string commas(1000, ',');
+  auto empty = folly::splitLazy(',', commas, true);
+  EXPECT_EQ(empty.end(), empty.begin());
+  size_t count = 0;
+  for (auto piece : folly::splitLazy(',', commas)) {
+    EXPECT_TRUE(piece.empty());
+    ++count;
+  }
+  EXPECT_EQ(1001, count);
+}
+
 TEST(String, join) {
   string output;
 
@@ -24,12 +24,14 @@
 #include <folly/Exception.h>
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/experimental/io/FsUtil.h>
 #include <folly/gen/Base.h>
 #include <folly/gen/File.h>
 #include <folly/gen/String.h>
+#include <folly/portability/Fcntl.h>
 #include <folly/portability/GTest.h>
 #include <folly/portability/Unistd.h>
 
@@ -197,6 +199,38 @@ void checkFdLeak(const Runnable& r) {
 }
 } // namespace
 
+TEST(SimpleSubprocessTest, CloseOtherFds) {
+  // dup2() doesn't set close-on-exec, so the child inherits these
+  int fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  PCHECK(fd != -1);
+  PCHECK(::dup2(fd, 200) == 200);
+  PCHECK(::dup2(fd, 201) == 201);
+  SCOPE_EXIT {
+    ::close(fd);
+    ::close(200);
+    ::close(201);
+  };
+  auto childFds = [](Subprocess::Options options) {
+    Subprocess proc(
+        std::vector<std::string>{"/bin/ls", "/proc/self/fd"},
+        options.pipeStdout());
+    auto out = proc.communicate().first;
+    proc.waitChecked();
+    std::vector<std::string> fds;
+    split('\n', out, fds, true);
+    return boost::container::flat_set<std::string>(fds.begin(), fds.end());
+  };
+  auto inherited = childFds(Subprocess::Options());
+  EXPECT_EQ(1, inherited.count("200"));
+  EXPECT_EQ(1, inherited.count("201"));
+
+  auto closed = childFds(Subprocess::Options().closeOtherFds().fd(300, 201));
+  EXPECT_EQ(0, closed.count("200"));
+  EXPECT_EQ(0, closed.count("201"));
+  EXPECT_EQ(1, closed.count("300"));
+  EXPECT_EQ(1, closed.count("1"));
+}
+
 // Make sure Subprocess doesn't leak any file descriptors
 TEST(SimpleSubprocessTest, FdLeakTest) {
   // Normal execution
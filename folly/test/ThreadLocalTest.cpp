@@ -330,6 +330,84 @@ TEST(ThreadLocalPtr, AccessAllThreadsCounter) {
   }
 }
 
+TEST(ThreadLocalPtr, AccessAllThreadsDoesntBlockCreation) {
+  struct Tag {};
+  ThreadLocal<int, Tag> tl;
+  *tl = 1;
+  std::thread t;
+  {
+    auto accessor = tl.accessAllThreads();
+    Baton<> created;
+    // The new thread's object is created while the accessor is alive, but
+    // it only gets destroyed once the accessor is released.
+    t = std::thread([&] {
+      *tl = 2;
+      created.post();
+    });
+    created.wait();
+    int sum = 0;
+    for (int i : accessor) {
+      sum += i;
+    }
+    EXPECT_EQ(1, sum);
+  }
+  t.join();
+}
+
+TEST(ThreadLocalPtr, AccessAllThreadsDelaysThreadExit) {
+  struct Tag {};
+  struct Flagged {
+    std::atomic<bool>* destroyed;
+    ~Flagged() {
+      destroyed->store(true);
+    }
+  };
+  std::atomic<bool> destroyed(false);
+  ThreadLocalPtr<Flagged, Tag> tl;
+  Baton<> created;
+  Baton<> accessed;
+  std::thread t([&] {
+    tl.reset(new Flagged{&destroyed});
+    created.post();
+    accessed.wait();
+  });
+  created.wait();
+  {
+    auto accessor = tl.accessAllThreads();
+    accessed.post();
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds(50));
+    EXPECT_FALSE(destroyed.load());
+    EXPECT_EQ(1, std::distance(accessor.begin(), accessor.end()));
+  }
+  t.join();
+  EXPECT_TRUE(destroyed.load());
+}
+
+namespace {
+struct AccessAllThreadsAtExitTag {};
+struct CountsOthersAtExit {
+  std::atomic<int>* others;
+  ~CountsOthersAtExit();
+};
+ThreadLocalPtr<CountsOthersAtExit, AccessAllThreadsAtExitTag> countsOthers;
+CountsOthersAtExit::~CountsOthersAtExit() {
+  auto accessor = countsOthers.accessAllThreads();
+  others->store(int(std::distance(accessor.begin(), accessor.end())));
+}
+} // namespace
+
+TEST(ThreadLocalPtr, AccessAllThreadsFromThreadExit) {
+  // In non-strict mode, destructors run on thread exit may walk the objects
+  // of the other threads with the same Tag
+  std::atomic<int> others(-1);
+  countsOthers.reset(new CountsOthersAtExit{&others});
+  std::thread([&] { countsOthers.reset(new CountsOthersAtExit{&others}); })
+      .join();
+  EXPECT_EQ(1, others.load());
+  countsOthers.reset();
+}
+
 TEST(ThreadLocal, resetNull) {
   ThreadLocal<int> tl;
   tl.reset(new int(4));
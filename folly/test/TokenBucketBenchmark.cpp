@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/TokenBucket.h>
+
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+namespace {
+
+// Large enough for consume() to always succeed, so that this measures the
+// cost of updating the bucket
+constexpr double kRate = 1e12;
+constexpr double kBurst = 1e9;
+constexpr double kLease = 1000;
+
+template <class Bucket>
+void consume(Bucket& bucket, size_t iters, size_t numThreads) {
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&] {
+      size_t count = 0;
+      for (size_t j = 0; j < iters; ++j) {
+        count += bucket.consume(1);
+      }
+      doNotOptimizeAway(count);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void tokenBucket(size_t iters, size_t numThreads) {
+  TokenBucket bucket(kRate, kBurst);
+  consume(bucket, iters, numThreads);
+}
+
+void shardedTokenBucket(size_t iters, size_t numThreads) {
+  ShardedTokenBucket bucket(kRate, kBurst, kLease);
+  consume(bucket, iters, numThreads);
+}
+
+} // namespace
+
+BENCHMARK_PARAM(tokenBucket, 1)
+BENCHMARK_RELATIVE_PARAM(shardedTokenBucket, 1)
+BENCHMARK_PARAM(tokenBucket, 4)
+BENCHMARK_RELATIVE_PARAM(shardedTokenBucket, 4)
+BENCHMARK_PARAM(tokenBucket, 16)
+BENCHMARK_RELATIVE_PARAM(shardedTokenBucket, 16)
+
+// Benchmark results on Intel Xeon (AVX-512), 1 core, so threads don't
+// contend for cache lines: with several cores, TokenBucket's single atomic
+// bounces between them, which the shards avoid.  The time per iteration
+// includes starting the threads.
+// ============================================================================
+// folly/test/TokenBucketBenchmark.cpp             relative  time/iter  iters/s
+// ============================================================================
+// tokenBucket(1)                                              52.91ns   18.90M
+// shardedTokenBucket(1)                            114.98%    46.02ns   21.73M
+// tokenBucket(4)                                             259.67ns    3.85M
+// shardedTokenBucket(4)                            108.32%   239.72ns    4.17M
+// tokenBucket(16)                                            220.98us    4.53K
+// shardedTokenBucket(16)                            98.24%   224.94us    4.45K
+// ============================================================================
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+  return 0;
+}
@@ -16,6 +16,10 @@
 
 #include <folly/test/TokenBucketTest.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <folly/portability/GTest.h>
 
 using namespace folly;
@@ -133,3 +137,93 @@ TEST(TokenBucket, drainOnFail) {
   EXPECT_DOUBLE_EQ(1.0, tokenBucket.consumeOrDrain(5, 10, 10, 1));
   EXPECT_DOUBLE_EQ(0.0, tokenBucket.consumeOrDrain(1, 10, 10, 1));
 }
+
+TEST(ShardedTokenBucket, Basic) {
+  ShardedTokenBucket tokenBucket(10, 10, 5);
+  EXPECT_DOUBLE_EQ(10, tokenBucket.available(1));
+  EXPECT_EQ(5 * CacheLocality::system().numCpus, tokenBucket.maxLeased());
+
+  // Empty the bucket, leasing some tokens along the way
+  size_t count = 0;
+  while (tokenBucket.consume(1, 1)) {
+    count += 1;
+  }
+  EXPECT_EQ(10, count);
+  EXPECT_DOUBLE_EQ(0, tokenBucket.available(1));
+  EXPECT_FALSE(tokenBucket.consume(11, 100));
+
+  // Tokens come back at the rate of the bucket, and are never lost
+  EXPECT_DOUBLE_EQ(5, tokenBucket.available(1.5));
+  EXPECT_TRUE(tokenBucket.consume(3, 1.5));
+  EXPECT_DOUBLE_EQ(2, tokenBucket.available(1.5));
+  EXPECT_FALSE(tokenBucket.consume(3, 1.5));
+  EXPECT_TRUE(tokenBucket.consume(2, 1.5));
+  EXPECT_FALSE(tokenBucket.consume(1, 1.5));
+  EXPECT_DOUBLE_EQ(10, tokenBucket.available(100));
+}
+
+TEST(ShardedTokenBucket, Sanity) {
+  for (double consumeSize : {1, 5}) {
+    const double rate = 10000;
+    ShardedTokenBucket tokenBucket(rate, 100, 20, nullptr, 0);
+    double tokenCounter = 0;
+    for (double currentTime = 0; currentTime <= 10.0; currentTime += 0.001) {
+      while (tokenBucket.consume(consumeSize, currentTime)) {
+        tokenCounter += consumeSize;
+      }
+      // Every token leased is consumed before another lease
+      EXPECT_LE(rate * currentTime * 0.9 - 1, tokenCounter);
+      EXPECT_GE(rate * currentTime + 100 + 1e-6, tokenCounter);
+    }
+  }
+}
+
+TEST(ShardedTokenBucket, Threads) {
+  const double rate = 100000;
+  const double burst = 1000;
+  const double start = ShardedTokenBucket::defaultClockNow();
+  ShardedTokenBucket tokenBucket(rate, burst, 50, nullptr, start);
+  std::atomic<size_t> consumed{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&] {
+      size_t count = 0;
+      for (int j = 0; j < 100000; ++j) {
+        count += tokenBucket.consume(1);
+      }
+      consumed += count;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double elapsed = ShardedTokenBucket::defaultClockNow() - start;
+  // Leased tokens are taken from the bucket, so the bound is the same as
+  // for a TokenBucket over the whole run
+  EXPECT_LE(consumed.load(), rate * elapsed + 1);
+  EXPECT_LT(0, consumed.load());
+}
+
+TEST(ShardedTokenBucket, Parent) {
+  ShardedTokenBucket parent(8, 8, 2);
+  ShardedTokenBucket child1(64, 6, 2, &parent);
+  ShardedTokenBucket child2(64, 6, 2, &parent);
+
+  // The children together can't consume more than the parent allows, even
+  // though each could on its own
+  size_t count = 0;
+  while (child1.consume(1, 1)) {
+    count += 1;
+  }
+  EXPECT_EQ(6, count);
+  while (child2.consume(1, 1)) {
+    count += 1;
+  }
+  EXPECT_EQ(8, count);
+  EXPECT_FALSE(parent.consume(1, 1));
+
+  // A child's failed lease doesn't take tokens from the parent
+  EXPECT_TRUE(parent.consume(1, 1.125));
+  EXPECT_FALSE(child1.consume(1, 1.125));
+  EXPECT_TRUE(child1.consume(1, 1.25));
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Unicode.h>
+
+#include <random>
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+
+using namespace folly;
+
+namespace {
+
+// 64KB of text, where one code point in asciiOneIn is ASCII and the rest
+// are spread over 2, 3 and 4 byte sequences
+std::string makeText(size_t asciiOneIn) {
+  const char32_t nonAscii[] = {0xe9, 0x3b1, 0x4e2d, 0xac00, 0x1f600};
+  std::mt19937 rng(1234);
+  std::string s;
+  while (s.size() < 64 * 1024) {
+    if (rng() % asciiOneIn == 0) {
+      s += char('a' + rng() % 26);
+    } else {
+      s += codePointToUtf8(nonAscii[rng() % 5]);
+    }
+  }
+  return s;
+}
+
+const std::string ascii = makeText(1);
+const std::string mostlyAscii = makeText(2);
+const std::string nonAscii = makeText(1000 * 1000);
+
+const std::u16string asciiUtf16 = utf8ToUtf16(ascii);
+const std::u16string nonAsciiUtf16 = utf8ToUtf16(nonAscii);
+const std::u32string asciiUtf32 = utf8ToUtf32(ascii);
+const std::u32string nonAsciiUtf32 = utf8ToUtf32(nonAscii);
+
+Range<const char16_t*> range(const std::u16string& s) {
+  return Range<const char16_t*>(s.data(), s.size());
+}
+
+Range<const char32_t*> range(const std::u32string& s) {
+  return Range<const char32_t*>(s.data(), s.size());
+}
+
+} // namespace
+
+BENCHMARK(isAscii_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(isAscii(ascii));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(utf8Valid_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8Valid(ascii));
+  }
+}
+
+BENCHMARK(utf8Valid_mostlyAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8Valid(mostlyAscii));
+  }
+}
+
+BENCHMARK(utf8Valid_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8Valid(nonAscii));
+  }
+}
+
+BENCHMARK(utf8ToCodePoint_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    auto p = reinterpret_cast<const unsigned char*>(nonAscii.data());
+    auto e = p + nonAscii.size();
+    while (p < e) {
+      doNotOptimizeAway(utf8ToCodePoint(p, e, true));
+    }
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(utf8ToUtf16_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8ToUtf16(ascii));
+  }
+}
+
+BENCHMARK(utf8ToUtf16_mostlyAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8ToUtf16(mostlyAscii));
+  }
+}
+
+BENCHMARK(utf8ToUtf16_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8ToUtf16(nonAscii));
+  }
+}
+
+BENCHMARK(utf8ToUtf32_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8ToUtf32(ascii));
+  }
+}
+
+BENCHMARK(utf8ToUtf32_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf8ToUtf32(nonAscii));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(utf16ToUtf8_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf16ToUtf8(range(asciiUtf16)));
+  }
+}
+
+BENCHMARK(utf16ToUtf8_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf16ToUtf8(range(nonAsciiUtf16)));
+  }
+}
+
+BENCHMARK(utf32ToUtf8_ascii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf32ToUtf8(range(asciiUtf32)));
+  }
+}
+
+BENCHMARK(utf32ToUtf8_nonAscii, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(utf32ToUtf8(range(nonAsciiUtf32)));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(toLowerAscii_ascii, iters) {
+  std::string s;
+  BENCHMARK_SUSPEND {
+    s = ascii;
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    toLowerAscii(s);
+    doNotOptimizeAway(s.data());
+  }
+}
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
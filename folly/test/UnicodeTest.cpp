@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Unicode.h>
+
+#include <random>
+
+#include <folly/String.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+// One code point at a time
+bool referenceValid(StringPiece s, bool bmpOnly) {
+  auto p = reinterpret_cast<const unsigned char*>(s.begin());
+  auto e = reinterpret_cast<const unsigned char*>(s.end());
+  while (p < e) {
+    if (*p >= 0xf0 && !bmpOnly) {
+      // utf8ToCodePoint() doesn't decode 4 byte sequences
+      if (e - p < 4 || *p > 0xf4) {
+        return false;
+      }
+      char32_t cp = *p & 0x07;
+      for (int i = 1; i < 4; ++i) {
+        if ((p[i] & 0xc0) != 0x80) {
+          return false;
+        }
+        cp = (cp << 6) | (p[i] & 0x3f);
+      }
+      if (cp < 0x10000 || cp > 0x10ffff) {
+        return false;
+      }
+      p += 4;
+      continue;
+    }
+    try {
+      utf8ToCodePoint(p, e, false);
+    } catch (const std::runtime_error&) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+TEST(Unicode, Utf8Valid) {
+  EXPECT_TRUE(utf8Valid(""));
+  EXPECT_TRUE(utf8Valid("plain ascii, longer than sixteen bytes"));
+  EXPECT_TRUE(utf8Valid("\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf"));
+  EXPECT_TRUE(utf8Valid("\xed\x9f\xbf\xee\x80\x80"));
+  EXPECT_TRUE(utf8Valid("\xf0\x90\x80\x80\xf4\x8f\xbf\xbf"));
+  EXPECT_FALSE(utf8Valid("\xf0\x90\x80\x80", true));
+
+  for (auto invalid : {
+           "\x80", // lone continuation
+           "\xc2", // truncated
+           "\xe0\xa0",
+           "\xf0\x90\x80",
+           "\xc2\x41", // lead followed by ascii
+           "\xc0\x80", // overlong
+           "\xc1\xbf",
+           "\xe0\x9f\xbf",
+           "\xf0\x8f\xbf\xbf",
+           "\xed\xa0\x80", // surrogates
+           "\xed\xbf\xbf",
+           "\xf4\x90\x80\x80", // > U+10FFFF
+           "\xf5\x80\x80\x80",
+           "\xfe",
+           "\xff",
+           "\xc2\x80\x80", // too many continuations
+       }) {
+    EXPECT_FALSE(utf8Valid(invalid)) << invalid;
+    // At the end of a block, and across blocks
+    for (size_t pad : {15, 16, 30, 31, 32}) {
+      EXPECT_FALSE(utf8Valid(std::string(pad, 'x') + invalid)) << pad;
+      EXPECT_FALSE(utf8Valid(std::string(pad, 'x') + invalid + "xyz")) << pad;
+    }
+  }
+}
+
+TEST(Unicode, Utf8ValidRandom) {
+  // Valid text mutated a little, so that most strings are almost valid
+  const char32_t codePoints[] = {
+      U'a', 0x7f, 0x80, 0x7ff, 0x800, 0xd7ff, 0xe000, 0xffff, 0x10000,
+      0x10ffff};
+  std::mt19937 rng(1234);
+  for (int i = 0; i < 20000; ++i) {
+    std::string s;
+    size_t n = rng() % 40;
+    for (size_t j = 0; j < n; ++j) {
+      s += codePointToUtf8(codePoints[rng() % (sizeof(codePoints) / 4)]);
+    }
+    for (int j = rng() % 3; j > 0 && !s.empty(); --j) {
+      auto& c = s[rng() % s.size()];
+      c = rng() % 2 ? char(rng()) : char(c ^ (1 << (rng() % 8)));
+    }
+    if (!s.empty() && rng() % 4 == 0) {
+      s.resize(rng() % s.size());
+    }
+    for (bool bmpOnly : {false, true}) {
+      EXPECT_EQ(referenceValid(s, bmpOnly), utf8Valid(s, bmpOnly))
+          << bmpOnly << " " << hexlify(s);
+    }
+  }
+}
+
+TEST(Unicode, IsAscii) {
+  EXPECT_TRUE(isAscii(""));
+  for (size_t size : {1, 7, 8, 15, 16, 17, 63, 64, 65, 100}) {
+    std::string s(size, 'a');
+    EXPECT_TRUE(isAscii(s));
+    for (size_t i = 0; i < size; ++i) {
+      s[i] = '\x80';
+      EXPECT_FALSE(isAscii(s)) << size << " " << i;
+      s[i] = '\x7f';
+    }
+  }
+}
+
+namespace {
+
+std::u16string referenceUtf16(const std::u32string& s) {
+  std::u16string result;
+  for (char32_t cp : s) {
+    if (cp < 0x10000) {
+      result += char16_t(cp);
+    } else {
+      result += char16_t(0xd800 + ((cp - 0x10000) >> 10));
+      result += char16_t(0xdc00 + ((cp - 0x10000) & 0x3ff));
+    }
+  }
+  return result;
+}
+
+Range<const char16_t*> range(const std::u16string& s) {
+  return Range<const char16_t*>(s.data(), s.size());
+}
+
+Range<const char32_t*> range(const std::u32string& s) {
+  return Range<const char32_t*>(s.data(), s.size());
+}
+
+} // namespace
+
+TEST(Unicode, Transcode) {
+  const char32_t codePoints[] = {
+      U'a', U'Z', 0x7f, 0x80, 0x7ff, 0x800, 0xd7ff, 0xe000, 0xffff, 0x10000,
+      0x10ffff};
+  std::mt19937 rng(1234);
+  for (int i = 0; i < 5000; ++i) {
+    // Mostly ASCII, in runs of varying length
+    std::u32string utf32;
+    std::string utf8;
+    size_t n = rng() % 80;
+    for (size_t j = 0; j < n; ++j) {
+      char32_t cp = rng() % 8 ? char32_t(U'a' + rng() % 26)
+                              : codePoints[rng() % (sizeof(codePoints) / 4)];
+      utf32 += cp;
+      utf8 += codePointToUtf8(cp);
+    }
+    auto utf16 = referenceUtf16(utf32);
+
+    EXPECT_EQ(utf16, utf8ToUtf16(utf8)) << hexlify(utf8);
+    EXPECT_EQ(utf32, utf8ToUtf32(utf8)) << hexlify(utf8);
+    EXPECT_EQ(utf8, utf16ToUtf8(range(utf16))) << hexlify(utf8);
+    EXPECT_EQ(utf8, utf32ToUtf8(range(utf32))) << hexlify(utf8);
+  }
+}
+
+TEST(Unicode, TranscodeInvalid) {
+  std::string padding(20, 'x');
+  std::u16string padding16(20, u'x');
+  std::u32string padding32(20, U'x');
+  std::string replacement = "\xef\xbf\xbd"; // U+FFFD
+
+  EXPECT_THROW(utf8ToUtf16(padding + "\xc0\x80"), std::runtime_error);
+  EXPECT_THROW(utf8ToUtf32("\xed\xa0\x80" + padding), std::runtime_error);
+  EXPECT_EQ(
+      padding16 + u"\ufffd\ufffdy", utf8ToUtf16(padding + "\xc0\x80y", true));
+  EXPECT_EQ(U"\ufffdy" + padding32, utf8ToUtf32("\xf4y" + padding, true));
+
+  // Unpaired surrogates, each replaced on its own
+  for (auto invalid : {std::u16string{char16_t(0xd800)},
+                       std::u16string{char16_t(0xdc00)},
+                       std::u16string{char16_t(0xdc00), char16_t(0xd800)}}) {
+    auto s = padding16 + invalid;
+    EXPECT_THROW(utf16ToUtf8(range(s)), std::runtime_error);
+    auto expected = padding;
+    for (size_t i = 0; i < invalid.size(); ++i) {
+      expected += replacement;
+    }
+    EXPECT_EQ(expected, utf16ToUtf8(range(s), true));
+  }
+
+  for (char32_t invalid : {char32_t(0xd800), char32_t(0x110000)}) {
+    auto s = padding32 + invalid;
+    EXPECT_THROW(utf32ToUtf8(range(s)), std::runtime_error);
+    EXPECT_EQ(padding + replacement, utf32ToUtf8(range(s), true));
+  }
+}
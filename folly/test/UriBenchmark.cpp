@@ -15,6 +15,7 @@
  */
 
 #include <folly/Uri.h>
+#include <folly/UriView.h>
 
 #include <folly/Benchmark.h>
 #include <folly/init/Init.h>
@@ -26,10 +27,16 @@ using namespace folly;
  * ============================================================================
  * folly/test/UriTest.cpp                          relative  time/iter  iters/s
  * ============================================================================
- * init_uri_simple                                              4.88us  204.80K
- * init_uri_simple_with_query_parsing                          22.46us   44.52K
- * init_uri_complex                                             5.92us  168.85K
- * init_uri_complex_with_query_parsing                         48.70us   20.53K
+ * init_uri_simple                                            100.20ns    9.98M
+ * init_uri_simple_with_query_parsing                         288.99ns    3.46M
+ * init_uri_complex                                           141.83ns    7.05M
+ * init_uri_complex_with_query_parsing                        882.74ns    1.13M
+ * ----------------------------------------------------------------------------
+ * init_uri_view_simple                                        34.58ns   28.92M
+ * init_uri_view_simple_with_query_parsing                     81.87ns   12.21M
+ * init_uri_view_complex_with_query_parsing                   209.16ns    4.78M
+ * ----------------------------------------------------------------------------
+ * uri_unescape_path                                          398.53ns    2.51M
  * ============================================================================
  */
 BENCHMARK(init_uri_simple, iters) {
@@ -82,6 +89,63 @@ BENCHMARK(init_uri_complex_with_query_parsing, iters) {
   }
 }
 
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(init_uri_view_simple, iters) {
+  const fbstring s("http://localhost?&key1=foo&key2=&key3&=bar&=bar=&");
+  for (size_t i = 0; i < iters; ++i) {
+    UriView u(s);
+    doNotOptimizeAway(u.path().data());
+  }
+}
+
+BENCHMARK(init_uri_view_simple_with_query_parsing, iters) {
+  const fbstring s("http://localhost?&key1=foo&key2=&key3&=bar&=bar=&");
+  for (size_t i = 0; i < iters; ++i) {
+    UriView u(s);
+    for (auto& param : u.queryParams()) {
+      doNotOptimizeAway(param.second.data());
+    }
+  }
+}
+
+BENCHMARK(init_uri_view_complex_with_query_parsing, iters) {
+  const fbstring s(
+      "https://mock.example.com/farm/track.php?TmOxQUDF=uSmTS_VwhjKnh_JME&DI"
+      "h=fbbN&GRsoIm=bGshjaUqavZxQai&UMT=36k18N4dn21&3U=CD8o4A4497W152j6m0V%14"
+      "%57&Hy=t%05mpr.80JUZ7ne_%23zS8DcA%0qc_%291ymamz096%11Zfb3r%09ZqPD%311ZX"
+      "tqJd600ot&5U96U-Rh-VZ=-D_6-9xKYj%1gW6b43s1B9-j21P0oUW5-t46G4kgt&ezgj=mcW"
+      "TTQ.c&Oh=%2PblUfuC%7C997048884827569%03xnyJ%2L1pi7irBioQ6D4r7nNHNdo6v7Y%"
+      "84aurnSJ%2wCFePHMlGZmIHGfCe7392_lImWsSvN&sBeNN=Nf%80yOE%6X10M64F4gG197aX"
+      "R2B4g2533x235A0i4e%57%58uWB%04Erw.60&VMS4=Ek_%02GC0Pkx%6Ov_%207WICUz007%"
+      "04nYX8N%46zzpv%999h&KGmBt988y=q4P57C-Dh-Nz-x_7-5oPxz%1gz3N03t6c7-R67N4DT"
+      "Y6-f98W1&Lts&%02dOty%8eEYEnLz4yexQQLnL4MGU2JFn3OcmXcatBcabZgBdDdy67hdgW"
+      "tYn4");
+  for (size_t i = 0; i < iters; ++i) {
+    UriView u(s);
+    for (auto& param : u.queryParams()) {
+      doNotOptimizeAway(param.second.data());
+    }
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(uri_unescape_path, iters) {
+  BenchmarkSuspender braces;
+  std::string path;
+  for (int i = 0; i < 20; ++i) {
+    path += "/some/long/path/segment%20with%20spaces";
+  }
+  std::string out;
+  braces.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    out.clear();
+    uriUnescape(path, out, UriEscapeMode::PATH);
+    doNotOptimizeAway(out.data());
+  }
+}
+
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
   folly::runBenchmarks();
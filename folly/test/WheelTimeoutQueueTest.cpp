@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017-present Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/WheelTimeoutQueue.h>
+
+#include <map>
+#include <random>
+
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+TEST(WheelTimeoutQueue, Simple) {
+  typedef std::vector<WheelTimeoutQueue::Id> EventVec;
+  EventVec events;
+
+  WheelTimeoutQueue q;
+  WheelTimeoutQueue::Callback cb = [&events](
+      WheelTimeoutQueue::Id id, int64_t /* now */) { events.push_back(id); };
+
+  auto id1 = q.add(0, 10, cb);
+  auto id2 = q.add(0, 11, cb);
+  auto id3 = q.addRepeating(0, 9, cb);
+  EXPECT_LT(id1, id2);
+  EXPECT_LT(id2, id3);
+  EXPECT_EQ(3, q.size());
+  EXPECT_EQ(9, q.nextExpiration());
+
+  EXPECT_TRUE(events.empty());
+  EXPECT_EQ(21, q.runOnce(12));  // now+9
+
+  EXPECT_EQ((EventVec{id3, id1, id2}), events);
+
+  events.clear();
+  EXPECT_EQ(49, q.runOnce(40));
+  EXPECT_EQ((EventVec{id3}), events);
+  EXPECT_EQ(1, q.size());
+}
+
+TEST(WheelTimeoutQueue, Erase) {
+  typedef std::vector<WheelTimeoutQueue::Id> EventVec;
+  EventVec events;
+
+  WheelTimeoutQueue q;
+  WheelTimeoutQueue::Id id1 = 0;
+  WheelTimeoutQueue::Id id2 = 0;
+  WheelTimeoutQueue::Callback cb =
+      [&](WheelTimeoutQueue::Id id, int64_t /* now */) {
+        events.push_back(id);
+        if (id == id2) {
+          q.erase(id1);
+        }
+      };
+
+  id1 = q.addRepeating(0, 10, cb);
+  id2 = q.add(0, 35, cb);
+
+  int64_t now = 0;
+  while (now < std::numeric_limits<int64_t>::max()) {
+    now = q.runOnce(now);
+  }
+
+  EXPECT_EQ((EventVec{id1, id1, id1, id2}), events);
+  EXPECT_FALSE(q.erase(id1));
+  EXPECT_FALSE(q.erase(id2));
+  EXPECT_EQ(0, q.size());
+}
+
+TEST(WheelTimeoutQueue, RunOnceRepeating) {
+  int count = 0;
+  WheelTimeoutQueue q;
+  WheelTimeoutQueue::Callback cb =
+      [&count, &q](WheelTimeoutQueue::Id id, int64_t /* now */) {
+        if (++count == 100) {
+          EXPECT_TRUE(q.erase(id));
+        }
+      };
+
+  q.addRepeating(0, 0, cb);
+
+  EXPECT_EQ(0, q.runOnce(0));
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(0, q.runOnce(0));
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), q.runLoop(0));
+  EXPECT_EQ(100, count);
+}
+
+TEST(WheelTimeoutQueue, RunOnceReschedule) {
+  int count = 0;
+  WheelTimeoutQueue q;
+  WheelTimeoutQueue::Callback cb;
+  cb = [&count, &q, &cb](WheelTimeoutQueue::Id id, int64_t now) {
+      if (++count < 100) {
+        EXPECT_LT(id, q.add(now, 0, cb));
+      }
+    };
+
+  q.add(0, 0, cb);
+
+  EXPECT_EQ(0, q.runOnce(0));
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(0, q.runOnce(0));
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), q.runLoop(0));
+  EXPECT_EQ(100, count);
+}
+
+TEST(WheelTimeoutQueue, BeyondWheel) {
+  // 64 slots of 10 units: events further out than 640 wrap around
+  WheelTimeoutQueue q(10, 64);
+  std::vector<int64_t> fired;
+  WheelTimeoutQueue::Callback cb = [&](WheelTimeoutQueue::Id, int64_t now) {
+    fired.push_back(now);
+  };
+  q.add(0, 5000, cb);
+  q.add(0, 645, cb);
+  q.add(0, 5, cb);
+  EXPECT_EQ(5, q.nextExpiration());
+
+  EXPECT_EQ(645, q.runOnce(100));
+  EXPECT_EQ(645, q.runOnce(644));
+  EXPECT_EQ(5000, q.runOnce(645));
+  EXPECT_EQ(5000, q.runOnce(4999));
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), q.runOnce(1000000));
+  EXPECT_EQ((std::vector<int64_t>{100, 645, 1000000}), fired);
+}
+
+TEST(WheelTimeoutQueue, NegativeTimes) {
+  WheelTimeoutQueue q(7, 64);
+  int count = 0;
+  WheelTimeoutQueue::Callback cb = [&](WheelTimeoutQueue::Id, int64_t) {
+    ++count;
+  };
+  q.add(-100, 10, cb);
+  q.add(-100, 95, cb);
+  EXPECT_EQ(-90, q.nextExpiration());
+  EXPECT_EQ(-5, q.runOnce(-90));
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(-5, q.runOnce(-6));
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), q.runOnce(-5));
+  EXPECT_EQ(2, count);
+}
+
+TEST(WheelTimeoutQueue, MatchesTimeoutQueueOrder) {
+  // Random adds and erases, checked against an ordered reference
+  std::mt19937 rng(1234);
+  WheelTimeoutQueue q(4, 64);
+  std::multimap<int64_t, WheelTimeoutQueue::Id> expected;
+  std::vector<WheelTimeoutQueue::Id> fired;
+  WheelTimeoutQueue::Callback cb = [&](WheelTimeoutQueue::Id id, int64_t) {
+    fired.push_back(id);
+  };
+
+  int64_t now = 0;
+  for (int round = 0; round < 200; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      auto delay = int64_t(rng() % 1000);
+      auto id = q.add(now, delay, cb);
+      expected.emplace(now + delay, id);
+    }
+    for (int i = 0; i < 5 && !expected.empty(); ++i) {
+      auto it = expected.begin();
+      std::advance(it, rng() % expected.size());
+      EXPECT_TRUE(q.erase(it->second));
+      expected.erase(it);
+    }
+    EXPECT_EQ(expected.size(), q.size());
+    EXPECT_EQ(expected.begin()->first, q.nextExpiration());
+
+    now += int64_t(rng() % 50);
+    fired.clear();
+    q.runOnce(now);
+    std::vector<WheelTimeoutQueue::Id> due;
+    auto end = expected.upper_bound(now);
+    for (auto it = expected.begin(); it != end; ++it) {
+      due.push_back(it->second);
+    }
+    expected.erase(expected.begin(), end);
+    EXPECT_EQ(due, fired);
+  }
+}
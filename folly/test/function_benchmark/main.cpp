@@ -17,10 +17,18 @@
 #include <folly/test/function_benchmark/benchmark_impl.h>
 #include <folly/test/function_benchmark/test_functions.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
 #include <glog/logging.h>
 
 #include <folly/Benchmark.h>
 #include <folly/ScopeGuard.h>
+#include <folly/memory/SlabPool.h>
 #include <folly/portability/GFlags.h>
 
 using folly::ScopeGuard;
@@ -29,6 +37,26 @@ using folly::makeGuard;
 // Declare the bm_max_iters flag from folly/Benchmark.cpp
 DECLARE_int32(bm_max_iters);
 
+// Count the heap allocations, to report how many each way of creating a
+// function makes
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
 // Directly invoking a function
 BENCHMARK(fn_invoke, iters) {
   for (size_t n = 0; n < iters; ++n) {
@@ -324,9 +352,102 @@ BENCHMARK(Function_create_move_invoke_ref, iters) {
   }
 }
 
+BENCHMARK_DRAW_LINE()
+
+// Tasks like the ones handed to executors, capturing a little more than
+// fits in a default folly::Function
+namespace {
+auto makeTask(int64_t& sum) {
+  std::array<int64_t, 7> payload{{1, 2, 3, 4, 5, 6, 7}};
+  return [&sum, payload] { sum += payload[0]; };
+}
+
+folly::SlabPool& taskPool() {
+  static folly::SlabPool pool(128);
+  return pool;
+}
+
+void createInvokeTask(size_t iters) {
+  int64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::Function<void()> f = makeTask(sum);
+    folly::doNotOptimizeAway(f);
+    f();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+void createInvokeTaskInline(size_t iters) {
+  int64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::Function<void(), 64> f = makeTask(sum);
+    folly::doNotOptimizeAway(f);
+    f();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+void createInvokeTaskPool(size_t iters) {
+  int64_t sum = 0;
+  folly::SlabPoolAllocator<char> alloc(&taskPool());
+  for (size_t i = 0; i < iters; ++i) {
+    folly::Function<void()> f{std::allocator_arg, alloc, makeTask(sum)};
+    folly::doNotOptimizeAway(f);
+    f();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+void createMoveInvokeTaskInline(size_t iters) {
+  int64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::Function<void(), 64> f = makeTask(sum);
+    folly::Function<void(), 128> g = std::move(f);
+    folly::doNotOptimizeAway(g);
+    g();
+  }
+  folly::doNotOptimizeAway(sum);
+}
+} // namespace
+
+BENCHMARK(Function_create_invoke_task, iters) {
+  createInvokeTask(iters);
+}
+
+BENCHMARK_RELATIVE(Function_64_create_invoke_task, iters) {
+  createInvokeTaskInline(iters);
+}
+
+BENCHMARK_RELATIVE(Function_pool_create_invoke_task, iters) {
+  createInvokeTaskPool(iters);
+}
+
+BENCHMARK_RELATIVE(Function_64_to_128_create_move_invoke_task, iters) {
+  createMoveInvokeTaskInline(iters);
+}
+
+namespace {
+void printAllocations(const char* name, void (*fn)(size_t)) {
+  constexpr size_t kIters = 1000;
+  fn(kIters); // warm up, e.g. the pool
+  auto before = allocations.load();
+  fn(kIters);
+  auto count = allocations.load() - before;
+  printf("%-46s %8.2f\n", name, double(count) / kIters);
+}
+} // namespace
+
 // main()
 
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
+
+  printf("\nHeap allocations per iteration:\n");
+  printAllocations("Function_create_invoke_task", createInvokeTask);
+  printAllocations("Function_64_create_invoke_task", createInvokeTaskInline);
+  printAllocations("Function_pool_create_invoke_task", createInvokeTaskPool);
+  printAllocations(
+      "Function_64_to_128_create_move_invoke_task",
+      createMoveInvokeTaskInline);
 }
@@ -741,3 +741,33 @@ TEST(SortedVectorTypes, TestMapCreationFromVector) {
   });
   EXPECT_EQ(contents, expected_contents);
 }
+
+TEST(SortedVectorTypes, TestBulkLowerBound) {
+  sorted_vector_set<int> s;
+  sorted_vector_map<int, int> m;
+  for (int i = 0; i < 1000; i += 3) {
+    s.insert(i);
+    m[i] = -i;
+  }
+  std::vector<int> queries = {-5, 0, 0, 1, 3, 4, 500, 501, 998, 999, 2000};
+  std::vector<sorted_vector_set<int>::const_iterator> setResults;
+  s.bulk_lower_bound(
+      queries.begin(), queries.end(), std::back_inserter(setResults));
+  std::vector<sorted_vector_map<int, int>::const_iterator> mapResults;
+  m.bulk_lower_bound(
+      queries.begin(), queries.end(), std::back_inserter(mapResults));
+  ASSERT_EQ(queries.size(), setResults.size());
+  ASSERT_EQ(queries.size(), mapResults.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    EXPECT_EQ(s.lower_bound(queries[i]), setResults[i]);
+    EXPECT_EQ(m.lower_bound(queries[i]), mapResults[i]);
+  }
+
+  sorted_vector_set<int> empty;
+  setResults.clear();
+  empty.bulk_lower_bound(
+      queries.begin(), queries.end(), std::back_inserter(setResults));
+  EXPECT_EQ(std::vector<decltype(empty)::const_iterator>(
+                queries.size(), empty.end()),
+            setResults);
+}
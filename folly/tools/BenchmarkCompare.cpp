@@ -31,8 +31,10 @@ vector<detail::BenchmarkResult> resultsFromFile(const std::string& filename) {
   return ret;
 }
 
-void compareBenchmarkResults(const std::string& base, const std::string& test) {
-  printResultComparison(resultsFromFile(base), resultsFromFile(test));
+size_t compareBenchmarkResults(
+    const std::string& base,
+    const std::string& test) {
+  return printResultComparison(resultsFromFile(base), resultsFromFile(test));
 }
 
 } // namespace folly
@@ -40,6 +42,6 @@ void compareBenchmarkResults(const std::string& base, const std::string& test) {
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
   CHECK_GT(argc, 2);
-  folly::compareBenchmarkResults(argv[1], argv[2]);
-  return 0;
+  // Fails on significant regressions, for scripts to catch them
+  return folly::compareBenchmarkResults(argv[1], argv[2]) > 0 ? 1 : 0;
 }
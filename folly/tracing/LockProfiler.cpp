@@ -0,0 +1,395 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/LockProfiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include <folly/Demangle.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+
+namespace folly {
+
+namespace detail {
+std::atomic<bool> lockProfilingEnabled{false};
+} // namespace detail
+
+namespace {
+
+// The most sampled locks a thread can hold at once; the hold times of any
+// more aren't measured
+constexpr size_t kMaxHeld = 16;
+
+struct LockEntry {
+  LockProfileCounters kinds[3];
+  const void* callsite{nullptr};
+
+  void merge(const LockEntry& other) {
+    for (size_t k = 0; k < 3; ++k) {
+      kinds[k].merge(other.kinds[k]);
+    }
+    if (callsite == nullptr) {
+      callsite = other.callsite;
+    }
+  }
+};
+
+using LockEntries = std::unordered_map<const void*, LockEntry>;
+
+struct Held {
+  const void* lock;
+  LockProfileKind kind;
+  uint64_t acquiredTicks;
+  uint64_t generation;
+};
+
+struct ThreadLocks {
+  // Only the owning thread changes locks, with mutex held, so that snapshots
+  // can read it under the mutex
+  std::mutex mutex;
+  LockEntries locks;
+
+  // Owning thread only
+  std::vector<Held> held;
+};
+
+struct Registry {
+  std::atomic<uint32_t> period{0};
+  // Changes with the sampling rate, to leave out the holds that were
+  // sampled before
+  std::atomic<uint64_t> generation{0};
+
+  std::mutex mutex;
+  // What the threads that exited sampled
+  LockEntries retired;
+  std::unordered_map<const void*, std::string> names;
+  std::unordered_set<ThreadLocks*> threads;
+};
+
+// Leaked, for locks to sample into until the very end
+Registry& registry() {
+  static auto& instance = *new Registry();
+  return instance;
+}
+
+// Set while this thread is in the profiler, whose own locking (and that of
+// folly::ThreadLocal, which uses SharedMutex) mustn't be sampled, and once
+// the thread is exiting
+thread_local bool tls_busy = false;
+// The acquisitions until the next sample, and the size of the held locks of
+// ThreadLocks: trivial, so the unsampled paths don't have to construct it
+thread_local uint32_t tls_countdown = 0;
+thread_local uint32_t tls_numHeld = 0;
+
+struct ThreadLocksHolder {
+  ~ThreadLocksHolder() {
+    tls_busy = true;
+    if (locks == nullptr) {
+      return;
+    }
+    auto& r = registry();
+    {
+      std::lock_guard<std::mutex> g(r.mutex);
+      for (auto& lock : locks->locks) {
+        r.retired[lock.first].merge(lock.second);
+      }
+      r.threads.erase(locks);
+    }
+    delete locks;
+  }
+
+  ThreadLocks* locks{nullptr};
+};
+
+thread_local ThreadLocksHolder tls_locks;
+
+// Keeps the profiler from sampling itself
+class BusyGuard {
+ public:
+  BusyGuard() : wasBusy_(tls_busy) {
+    tls_busy = true;
+  }
+
+  ~BusyGuard() {
+    tls_busy = wasBusy_;
+  }
+
+  bool wasBusy() const {
+    return wasBusy_;
+  }
+
+ private:
+  bool wasBusy_;
+};
+
+ThreadLocks& threadLocks() {
+  auto locks = tls_locks.locks;
+  if (UNLIKELY(locks == nullptr)) {
+    locks = new ThreadLocks();
+    auto& r = registry();
+    std::lock_guard<std::mutex> g(r.mutex);
+    r.threads.insert(locks);
+    tls_locks.locks = locks;
+  }
+  return *locks;
+}
+
+std::string callsiteName(const void* callsite) {
+#ifndef _WIN32
+  Dl_info info;
+  if (callsite != nullptr && dladdr(callsite, &info) != 0 &&
+      info.dli_sname != nullptr) {
+    return stringPrintf(
+        "%s+0x%zx",
+        demangle(info.dli_sname).c_str(),
+        size_t(uintptr_t(callsite) - uintptr_t(info.dli_saddr)));
+  }
+#endif
+  return stringPrintf("%p", callsite);
+}
+
+} // namespace
+
+void LockProfileCounters::merge(const LockProfileCounters& other) {
+  acquisitions += other.acquisitions;
+  waitTicks += other.waitTicks;
+  maxWaitTicks = std::max(maxWaitTicks, other.maxWaitTicks);
+  holds += other.holds;
+  holdTicks += other.holdTicks;
+  maxHoldTicks = std::max(maxHoldTicks, other.maxHoldTicks);
+}
+
+const LockProfileCounters& LockProfile::counters(LockProfileKind kind) const {
+  switch (kind) {
+    case LockProfileKind::SHARED:
+      return shared;
+    case LockProfileKind::UPGRADE:
+      return upgrade;
+    default:
+      return exclusive;
+  }
+}
+
+uint64_t detail::lockProfileSampleSlow() {
+  if (tls_countdown > 1) {
+    --tls_countdown;
+    return 0;
+  }
+  BusyGuard busy;
+  if (busy.wasBusy()) {
+    return 0;
+  }
+  auto period = registry().period.load(std::memory_order_relaxed);
+  if (period == 0) {
+    return 0;
+  }
+  // Randomized around the period, so threads locking in lockstep don't
+  // always sample the same acquisitions
+  tls_countdown = period == 1 ? 1 : 1 + Random::rand32(2 * period - 1);
+  // 0 means not sampled
+  return std::max<uint64_t>(detail::scopedTimerTicks(), 1);
+}
+
+void detail::lockProfileAcquiredSlow(
+    const void* lock,
+    LockProfileKind kind,
+    uint64_t startTicks) {
+  auto now = detail::scopedTimerTicks();
+#if defined(__GNUC__)
+  const void* callsite = __builtin_return_address(0);
+#else
+  const void* callsite = nullptr;
+#endif
+  auto wait = now - startTicks;
+  BusyGuard busy;
+  if (busy.wasBusy()) {
+    return;
+  }
+  auto& locks = threadLocks();
+  {
+    std::lock_guard<std::mutex> g(locks.mutex);
+    auto& entry = locks.locks[lock];
+    auto& counters = entry.kinds[size_t(kind)];
+    ++counters.acquisitions;
+    counters.waitTicks += wait;
+    counters.maxWaitTicks = std::max(counters.maxWaitTicks, wait);
+    if (entry.callsite == nullptr) {
+      entry.callsite = callsite;
+    }
+  }
+  if (locks.held.size() < kMaxHeld) {
+    locks.held.push_back(
+        {lock,
+         kind,
+         now,
+         registry().generation.load(std::memory_order_relaxed)});
+    tls_numHeld = uint32_t(locks.held.size());
+  }
+}
+
+void detail::lockProfileReleasedSlow(const void* lock) {
+  if (tls_numHeld == 0 || tls_busy) {
+    return;
+  }
+  BusyGuard busy;
+  auto locks = tls_locks.locks;
+  // Usually the most recently acquired
+  auto it = std::find_if(
+      locks->held.rbegin(), locks->held.rend(), [&](const Held& held) {
+        return held.lock == lock;
+      });
+  if (it == locks->held.rend()) {
+    return;
+  }
+  auto held = *it;
+  locks->held.erase(std::next(it).base());
+  tls_numHeld = uint32_t(locks->held.size());
+  if (held.generation != registry().generation.load()) {
+    return;
+  }
+  auto hold = detail::scopedTimerTicks() - held.acquiredTicks;
+  std::lock_guard<std::mutex> g(locks->mutex);
+  auto& counters = locks->locks[lock].kinds[size_t(held.kind)];
+  ++counters.holds;
+  counters.holdTicks += hold;
+  counters.maxHoldTicks = std::max(counters.maxHoldTicks, hold);
+}
+
+void LockProfiler::setSamplingRate(double rate) {
+  auto& r = registry();
+  uint32_t period = 0;
+  if (rate > 0) {
+    period = uint32_t(std::min(std::round(1 / std::min(rate, 1.0)), 1e9));
+  }
+  r.generation.fetch_add(1);
+  r.period.store(period, std::memory_order_relaxed);
+  detail::lockProfilingEnabled.store(period != 0, std::memory_order_relaxed);
+}
+
+double LockProfiler::samplingRate() {
+  auto period = registry().period.load(std::memory_order_relaxed);
+  return period == 0 ? 0.0 : 1.0 / period;
+}
+
+void LockProfiler::setName(const void* lock, std::string name) {
+  BusyGuard busy;
+  auto& r = registry();
+  std::lock_guard<std::mutex> g(r.mutex);
+  if (name.empty()) {
+    r.names.erase(lock);
+  } else {
+    r.names[lock] = std::move(name);
+  }
+}
+
+std::vector<LockProfile> LockProfiler::snapshot() {
+  BusyGuard busy;
+  double tickNanos = ScopedTimerRegistry::nanosPerTick();
+  auto& r = registry();
+  LockEntries entries;
+  std::unordered_map<const void*, std::string> names;
+  {
+    std::lock_guard<std::mutex> g(r.mutex);
+    entries = r.retired;
+    for (auto locks : r.threads) {
+      std::lock_guard<std::mutex> lg(locks->mutex);
+      for (auto& lock : locks->locks) {
+        entries[lock.first].merge(lock.second);
+      }
+    }
+    names = r.names;
+  }
+
+  std::vector<LockProfile> result;
+  result.reserve(entries.size());
+  for (auto& entry : entries) {
+    LockProfile profile;
+    profile.lock = entry.first;
+    auto name = names.find(entry.first);
+    profile.name = name != names.end() ? name->second
+                                       : callsiteName(entry.second.callsite);
+    profile.nanosPerTick = tickNanos;
+    profile.exclusive = entry.second.kinds[size_t(LockProfileKind::EXCLUSIVE)];
+    profile.shared = entry.second.kinds[size_t(LockProfileKind::SHARED)];
+    profile.upgrade = entry.second.kinds[size_t(LockProfileKind::UPGRADE)];
+    result.push_back(std::move(profile));
+  }
+  std::sort(
+      result.begin(),
+      result.end(),
+      [](const LockProfile& a, const LockProfile& b) {
+        return a.totalWaitTicks() > b.totalWaitTicks();
+      });
+  return result;
+}
+
+std::string LockProfiler::report(size_t maxLocks) {
+  static const char* const kKindNames[] = {"exclusive", "shared", "upgrade"};
+  auto profiles = snapshot();
+  std::string out = stringPrintf(
+      "%-40s %-9s %10s %10s %10s %10s %10s\n",
+      "lock",
+      "mode",
+      "samples",
+      "wait(ns)",
+      "avg wait",
+      "max wait",
+      "avg hold");
+  for (size_t i = 0; i < profiles.size() && i < maxLocks; ++i) {
+    auto& profile = profiles[i];
+    for (size_t k = 0; k < 3; ++k) {
+      auto& counters = profile.counters(LockProfileKind(k));
+      if (counters.acquisitions == 0) {
+        continue;
+      }
+      double tickNanos = profile.nanosPerTick;
+      stringAppendf(
+          &out,
+          "%-40s %-9s %10llu %10.0f %10.0f %10.0f %10.0f\n",
+          profile.name.substr(0, 40).c_str(),
+          kKindNames[k],
+          static_cast<unsigned long long>(counters.acquisitions),
+          counters.waitNanos(tickNanos),
+          counters.waitNanos(tickNanos) / counters.acquisitions,
+          counters.maxWaitTicks * tickNanos,
+          counters.holds == 0 ? 0.0
+                              : counters.holdNanos(tickNanos) / counters.holds);
+    }
+  }
+  return out;
+}
+
+void LockProfiler::reset() {
+  BusyGuard busy;
+  auto& r = registry();
+  std::lock_guard<std::mutex> g(r.mutex);
+  r.retired.clear();
+  for (auto locks : r.threads) {
+    std::lock_guard<std::mutex> lg(locks->mutex);
+    locks->locks.clear();
+  }
+}
+
+} // namespace folly
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A sampling profiler of lock contention, built into SharedMutex,
+ * MicroLock and the lock policies of Synchronized (for any other mutex).
+ *
+ *   folly::LockProfiler::setName(&requestsMutex, "requests");
+ *   folly::LockProfiler::setSamplingRate(0.01);
+ *   ...
+ *   for (const auto& lock : folly::LockProfiler::snapshot()) {
+ *     LOG(INFO) << lock.name << " waited "
+ *               << lock.exclusive.waitNanos(lock.nanosPerTick) << "ns";
+ *   }
+ *
+ * Profiling is off by default, when it costs a load and a predictable
+ * branch per lock and unlock.  When it is on, 1 in 1 / rate acquisitions
+ * of each thread is sampled: the time it waited for the lock and the time
+ * it held it are measured with the cycle counter, and added to counters of
+ * that lock in the calling thread.  snapshot() merges the counters of every
+ * thread.
+ *
+ * Locks are told apart by address, so the counters of a lock are merged
+ * with those of any lock later allocated at the same address.  A lock is
+ * named by its label, if it was given one with setName(), or otherwise by
+ * the code that first acquired it in a sample (when the lock functions are
+ * inlined, as they are in optimized builds, that is the function calling
+ * lock()).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Likely.h>
+#include <folly/tracing/ScopedTimer.h>
+
+namespace folly {
+
+enum class LockProfileKind : uint8_t {
+  EXCLUSIVE = 0,
+  SHARED = 1,
+  UPGRADE = 2,
+};
+
+namespace detail {
+
+extern std::atomic<bool> lockProfilingEnabled;
+
+// Returns the current ticks if this acquisition is sampled, 0 otherwise
+uint64_t lockProfileSampleSlow();
+// Not inlined, so that its return address is the code acquiring the lock
+FOLLY_NOINLINE void lockProfileAcquiredSlow(
+    const void* lock,
+    LockProfileKind kind,
+    uint64_t startTicks);
+void lockProfileReleasedSlow(const void* lock);
+
+/*
+ * Measures the wait for a lock, from its construction, if this acquisition
+ * is sampled:
+ *
+ *   detail::LockProfileWait profile;
+ *   ... acquire the lock ...
+ *   profile.acquired(this, LockProfileKind::EXCLUSIVE);
+ */
+class LockProfileWait {
+ public:
+  LockProfileWait()
+      : startTicks_(
+            UNLIKELY(lockProfilingEnabled.load(std::memory_order_relaxed))
+                ? lockProfileSampleSlow()
+                : 0) {}
+
+  LockProfileWait(const LockProfileWait&) = delete;
+  LockProfileWait& operator=(const LockProfileWait&) = delete;
+
+  FOLLY_ALWAYS_INLINE void acquired(const void* lock, LockProfileKind kind) {
+    if (UNLIKELY(startTicks_ != 0)) {
+      lockProfileAcquiredSlow(lock, kind, startTicks_);
+    }
+  }
+
+ private:
+  uint64_t startTicks_;
+};
+
+/* Ends the hold time of the lock, if its acquisition was sampled. */
+inline void lockProfileReleased(const void* lock) {
+  if (UNLIKELY(lockProfilingEnabled.load(std::memory_order_relaxed))) {
+    lockProfileReleasedSlow(lock);
+  }
+}
+
+/*
+ * Whether a mutex type profiles its own lock functions, so the lock
+ * policies of Synchronized don't profile them again.
+ */
+template <class Mutex>
+struct LockProfiledByMutex : std::false_type {};
+
+} // namespace detail
+
+/* The sampled acquisitions of a lock in one mode. */
+struct LockProfileCounters {
+  uint64_t acquisitions{0};
+  uint64_t waitTicks{0};
+  uint64_t maxWaitTicks{0};
+  // The acquisitions whose release was seen by the thread that acquired
+  // the lock, and the time they held the lock for
+  uint64_t holds{0};
+  uint64_t holdTicks{0};
+  uint64_t maxHoldTicks{0};
+
+  double waitNanos(double nanosPerTick) const {
+    return waitTicks * nanosPerTick;
+  }
+
+  double holdNanos(double nanosPerTick) const {
+    return holdTicks * nanosPerTick;
+  }
+
+  void merge(const LockProfileCounters& other);
+};
+
+struct LockProfile {
+  const void* lock;
+  std::string name;
+  double nanosPerTick;
+  LockProfileCounters exclusive;
+  LockProfileCounters shared;
+  LockProfileCounters upgrade;
+
+  const LockProfileCounters& counters(LockProfileKind kind) const;
+
+  uint64_t totalWaitTicks() const {
+    return exclusive.waitTicks + shared.waitTicks + upgrade.waitTicks;
+  }
+};
+
+class LockProfiler {
+ public:
+  /*
+   * Samples about rate (0 < rate <= 1) of the acquisitions of each thread,
+   * or none with 0, the default.
+   */
+  static void setSamplingRate(double rate);
+
+  static double samplingRate();
+
+  /* Names a lock in the snapshots, or forgets its name if name is empty. */
+  static void setName(const void* lock, std::string name);
+
+  /*
+   * The counters of every lock that was acquired in a sample since the last
+   * reset(), merged across threads (including those that exited), by
+   * decreasing total wait time.  Counters sampled concurrently may be
+   * missing from the snapshot.
+   */
+  static std::vector<LockProfile> snapshot();
+
+  /* A table of the snapshot, for logging. */
+  static std::string report(size_t maxLocks = 20);
+
+  /* Forgets every sample so far. */
+  static void reset();
+};
+
+} // namespace folly
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/ScopedTimer.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include <folly/Bits.h>
+#include <folly/ThreadLocal.h>
+#include <folly/tracing/StaticTracepoint.h>
+
+namespace folly {
+
+namespace detail {
+std::atomic<bool> scopedTimersEnabled{true};
+} // namespace detail
+
+namespace {
+
+constexpr size_t kNumBuckets = ScopedTimerSnapshot::kNumBuckets;
+
+struct Totals {
+  uint64_t count{0};
+  uint64_t totalTicks{0};
+  std::vector<uint64_t> buckets = std::vector<uint64_t>(kNumBuckets, 0);
+};
+
+// Written by the owning thread only
+struct LocalHistogram {
+  LocalHistogram() {
+    for (auto& bucket : buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Only this thread writes, so there is no need for atomic
+  // read-modify-writes
+  static void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+  }
+
+  void add(uint64_t ticks) {
+    increment(buckets[ScopedTimerSnapshot::bucketIdx(ticks)], 1);
+    increment(totalTicks, ticks);
+    increment(count, 1);
+  }
+
+  void addTo(Totals& totals) const {
+    totals.count += count.load(std::memory_order_relaxed);
+    totals.totalTicks += totalTicks.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      totals.buckets[b] += buckets[b].load(std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> totalTicks{0};
+  std::atomic<uint64_t> buckets[kNumBuckets];
+};
+
+struct ThreadTimers {
+  ~ThreadTimers();
+
+  // By site id.  Only the owning thread changes it, with the registry mutex
+  // held, so that snapshots can read it under the mutex.
+  std::vector<std::unique_ptr<LocalHistogram>> histograms;
+};
+
+struct ThreadTimersTag {};
+
+struct Registry {
+  Registry()
+      : startTicks(detail::scopedTimerTicks()),
+        startTime(std::chrono::steady_clock::now()) {}
+
+  // The caller must hold mutex
+  Totals totals(size_t id) const {
+    Totals result = retired[id];
+    for (auto timers : threads) {
+      if (id < timers->histograms.size() && timers->histograms[id]) {
+        timers->histograms[id]->addTo(result);
+      }
+    }
+    return result;
+  }
+
+  const uint64_t startTicks;
+  const std::chrono::steady_clock::time_point startTime;
+
+  std::mutex mutex;
+  // By site id
+  std::vector<ScopedTimerSite*> sites;
+  // What the threads that exited recorded
+  std::vector<Totals> retired;
+  // The totals as of the last reset()
+  std::vector<Totals> baseline;
+  std::unordered_set<ThreadTimers*> threads;
+
+  ThreadLocalPtr<ThreadTimers, ThreadTimersTag> local;
+};
+
+// Leaked, for sites to record into until the very end
+Registry& registry() {
+  static auto& instance = *new Registry();
+  return instance;
+}
+
+ThreadTimers::~ThreadTimers() {
+  // The thread is exiting
+  auto& r = registry();
+  std::lock_guard<std::mutex> g(r.mutex);
+  for (size_t id = 0; id < histograms.size(); ++id) {
+    if (histograms[id]) {
+      histograms[id]->addTo(r.retired[id]);
+    }
+  }
+  r.threads.erase(this);
+}
+
+} // namespace
+
+constexpr size_t ScopedTimerSnapshot::kNumBuckets;
+constexpr uint32_t ScopedTimerSite::kUnregistered;
+
+size_t ScopedTimerSnapshot::bucketIdx(uint64_t ticks) {
+  if (ticks < 4) {
+    return size_t(ticks);
+  }
+  // 4 buckets per power of 2, by the 2 bits after the highest set bit
+  size_t msb = findLastSet(ticks) - 1;
+  return (msb - 1) * 4 + size_t((ticks >> (msb - 2)) & 3);
+}
+
+uint64_t ScopedTimerSnapshot::bucketMin(size_t idx) {
+  if (idx < 4) {
+    return idx;
+  }
+  size_t msb = idx / 4 + 1;
+  return uint64_t(4 + idx % 4) << (msb - 2);
+}
+
+double ScopedTimerSnapshot::percentileNanos(double pct) const {
+  uint64_t total = 0;
+  for (auto bucket : buckets) {
+    total += bucket;
+  }
+  if (total == 0) {
+    return 0.0;
+  }
+
+  double rank = std::min(std::max(pct, 0.0), 1.0) * total;
+  uint64_t seen = 0;
+  for (size_t idx = 0; idx < buckets.size(); ++idx) {
+    if (buckets[idx] == 0) {
+      continue;
+    }
+    if (seen + buckets[idx] >= rank) {
+      double low = bucketMin(idx);
+      double high = idx + 1 < kNumBuckets
+          ? double(bucketMin(idx + 1))
+          : double(std::numeric_limits<uint64_t>::max());
+      double fraction = (rank - seen) / buckets[idx];
+      return (low + fraction * (high - low)) * nanosPerTick;
+    }
+    seen += buckets[idx];
+  }
+  return bucketMin(kNumBuckets - 1) * nanosPerTick;
+}
+
+void ScopedTimerSite::record(uint64_t ticks) {
+  FOLLY_SDT(folly, scoped_timer, name_, ticks);
+  auto id = id_.load(std::memory_order_acquire);
+  auto timers = registry().local.get();
+  // Unregistered sites have an id past any thread's histograms
+  if (LIKELY(timers != nullptr && id < timers->histograms.size())) {
+    auto histogram = timers->histograms[id].get();
+    if (LIKELY(histogram != nullptr)) {
+      histogram->add(ticks);
+      return;
+    }
+  }
+  ScopedTimerRegistry::recordSlow(*this, ticks);
+}
+
+void ScopedTimerRegistry::recordSlow(ScopedTimerSite& site, uint64_t ticks) {
+  auto& r = registry();
+  LocalHistogram* histogram;
+  {
+    std::lock_guard<std::mutex> g(r.mutex);
+    auto id = site.id_.load(std::memory_order_relaxed);
+    if (id == ScopedTimerSite::kUnregistered) {
+      id = uint32_t(r.sites.size());
+      r.sites.push_back(&site);
+      r.retired.emplace_back();
+      r.baseline.emplace_back();
+      site.id_.store(id, std::memory_order_release);
+    }
+
+    auto timers = r.local.get();
+    if (timers == nullptr) {
+      timers = new ThreadTimers();
+      r.local.reset(timers);
+      r.threads.insert(timers);
+    }
+    if (id >= timers->histograms.size()) {
+      timers->histograms.resize(id + 1);
+    }
+    if (!timers->histograms[id]) {
+      timers->histograms[id] = std::make_unique<LocalHistogram>();
+    }
+    histogram = timers->histograms[id].get();
+  }
+  histogram->add(ticks);
+}
+
+std::vector<ScopedTimerSnapshot> ScopedTimerRegistry::snapshot() {
+  double tickNanos = nanosPerTick();
+  auto& r = registry();
+  std::lock_guard<std::mutex> g(r.mutex);
+  std::vector<ScopedTimerSnapshot> result;
+  result.reserve(r.sites.size());
+  for (size_t id = 0; id < r.sites.size(); ++id) {
+    auto totals = r.totals(id);
+    const auto& baseline = r.baseline[id];
+    ScopedTimerSnapshot snapshot;
+    snapshot.name = r.sites[id]->name();
+    snapshot.file = r.sites[id]->file();
+    snapshot.line = r.sites[id]->line();
+    snapshot.count = totals.count - baseline.count;
+    snapshot.totalTicks = totals.totalTicks - baseline.totalTicks;
+    snapshot.nanosPerTick = tickNanos;
+    snapshot.buckets.resize(kNumBuckets);
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      snapshot.buckets[b] = totals.buckets[b] - baseline.buckets[b];
+    }
+    result.push_back(std::move(snapshot));
+  }
+  return result;
+}
+
+void ScopedTimerRegistry::reset() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> g(r.mutex);
+  for (size_t id = 0; id < r.sites.size(); ++id) {
+    r.baseline[id] = r.totals(id);
+  }
+}
+
+double ScopedTimerRegistry::nanosPerTick() {
+#if FOLLY_X64
+  // Measured against the steady clock since the registry was created
+  auto& r = registry();
+  constexpr std::chrono::milliseconds kMinCalibration{10};
+  auto elapsed = std::chrono::steady_clock::now() - r.startTime;
+  if (elapsed < kMinCalibration) {
+    std::this_thread::sleep_for(kMinCalibration - elapsed);
+  }
+  uint64_t ticks = detail::scopedTimerTicks();
+  auto now = std::chrono::steady_clock::now();
+  auto nanos =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - r.startTime);
+  return double(nanos.count()) / double(ticks - r.startTicks);
+#elif FOLLY_AARCH64
+  uint64_t frequency;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+  return 1e9 / double(frequency);
+#else
+  // The ticks are steady clock nanoseconds
+  return 1.0;
+#endif
+}
+
+} // namespace folly
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * FOLLY_SCOPED_TIMER(name) times the rest of the enclosing scope, and adds
+ * the duration to a histogram of that call site:
+ *
+ *   void handleRequest(const Request& request) {
+ *     FOLLY_SCOPED_TIMER("handleRequest");
+ *     ...
+ *   }
+ *
+ *   for (const auto& timer : folly::ScopedTimerRegistry::snapshot()) {
+ *     LOG(INFO) << timer.name << " p99: " << timer.percentileNanos(0.99);
+ *   }
+ *
+ * The name must be a string literal (or outlive the program).  Durations
+ * are measured with the cycle counter (the TSC on x86-64) and added to a
+ * histogram of the calling thread, so timing a scope takes about 20ns and
+ * doesn't write to memory shared with other threads.  When timing is
+ * disabled with ScopedTimerRegistry::setEnabled(false), a scoped timer
+ * costs a load and a predictable branch.
+ *
+ * As each duration is recorded, FOLLY_SDT(folly, scoped_timer, name, ticks)
+ * fires too, for tracing tools to pick individual durations up.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/Preprocessor.h>
+
+#if defined(_MSC_VER) && FOLLY_X64
+#include <intrin.h>
+#endif
+
+#define FOLLY_SCOPED_TIMER(name) \
+  FOLLY_SCOPED_TIMER_IMPL(name, FB_ANONYMOUS_VARIABLE(follyScopedTimerSite))
+
+#define FOLLY_SCOPED_TIMER_IMPL(name, site)                        \
+  static ::folly::ScopedTimerSite site(name, __FILE__, __LINE__); \
+  ::folly::ScopedTimer FB_ANONYMOUS_VARIABLE(follyScopedTimer)(site)
+
+namespace folly {
+
+namespace detail {
+
+extern std::atomic<bool> scopedTimersEnabled;
+
+/*
+ * The cycle counter; ScopedTimerRegistry::nanosPerTick() converts its ticks
+ * to nanoseconds.  On x86-64, this assumes an invariant TSC, which every
+ * recent processor has.
+ */
+inline uint64_t scopedTimerTicks() {
+#if defined(_MSC_VER) && FOLLY_X64
+  return __rdtsc();
+#elif FOLLY_X64
+  return __builtin_ia32_rdtsc();
+#elif FOLLY_AARCH64
+  uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+} // namespace detail
+
+/*
+ * The durations recorded at a call site, by all threads.
+ *
+ * The histogram buckets are log-linear: each power of 2 of ticks is split
+ * into 4 buckets, so a duration is known to within 25%.
+ */
+struct ScopedTimerSnapshot {
+  static constexpr size_t kNumBuckets = 252;
+
+  /* The bucket of a duration, and the smallest duration in a bucket. */
+  static size_t bucketIdx(uint64_t ticks);
+  static uint64_t bucketMin(size_t idx);
+
+  const char* name;
+  const char* file;
+  int line;
+
+  uint64_t count;
+  uint64_t totalTicks;
+  double nanosPerTick;
+  // The number of durations in each bucket
+  std::vector<uint64_t> buckets;
+
+  double totalNanos() const {
+    return totalTicks * nanosPerTick;
+  }
+
+  double avgNanos() const {
+    return count == 0 ? 0.0 : totalNanos() / count;
+  }
+
+  /*
+   * An estimate of the pct percentile (0 <= pct <= 1) of the durations,
+   * interpolated within its bucket.  0 if nothing was recorded.
+   */
+  double percentileNanos(double pct) const;
+};
+
+/*
+ * A call site of FOLLY_SCOPED_TIMER.  Sites are constructed at compile
+ * time, and register with ScopedTimerRegistry when they first record.
+ */
+class ScopedTimerSite {
+ public:
+  constexpr ScopedTimerSite(const char* name, const char* file, int line)
+      : name_(name), file_(file), line_(line), id_(kUnregistered) {}
+
+  ScopedTimerSite(const ScopedTimerSite&) = delete;
+  ScopedTimerSite& operator=(const ScopedTimerSite&) = delete;
+
+  void record(uint64_t ticks);
+
+  const char* name() const {
+    return name_;
+  }
+
+  const char* file() const {
+    return file_;
+  }
+
+  int line() const {
+    return line_;
+  }
+
+ private:
+  friend class ScopedTimerRegistry;
+
+  static constexpr uint32_t kUnregistered = ~uint32_t(0);
+
+  const char* name_;
+  const char* file_;
+  int line_;
+  std::atomic<uint32_t> id_;
+};
+
+/* Records the time from its construction to its destruction at a site. */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(ScopedTimerSite& site) {
+    if (LIKELY(detail::scopedTimersEnabled.load(std::memory_order_relaxed))) {
+      site_ = &site;
+      start_ = detail::scopedTimerTicks();
+    } else {
+      site_ = nullptr;
+    }
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  ~ScopedTimer() {
+    if (site_) {
+      site_->record(detail::scopedTimerTicks() - start_);
+    }
+  }
+
+ private:
+  ScopedTimerSite* site_;
+  uint64_t start_;
+};
+
+class ScopedTimerRegistry {
+ public:
+  /* Timing is enabled by default. */
+  static void setEnabled(bool enabled) {
+    detail::scopedTimersEnabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  static bool isEnabled() {
+    return detail::scopedTimersEnabled.load(std::memory_order_relaxed);
+  }
+
+  /*
+   * The durations recorded at every site since the last reset(), merged
+   * across threads (including those that exited).  Durations recorded
+   * concurrently may be missing from the snapshot, or only in some of its
+   * fields.
+   */
+  static std::vector<ScopedTimerSnapshot> snapshot();
+
+  /* Makes the next snapshots only include durations recorded from now. */
+  static void reset();
+
+  /* The length of a tick.  May sleep for up to 10ms to calibrate it. */
+  static double nanosPerTick();
+
+ private:
+  friend class ScopedTimerSite;
+
+  // Registers the site and allocates this thread's histogram for it
+  static void recordSlow(ScopedTimerSite& site, uint64_t ticks);
+};
+
+} // namespace folly
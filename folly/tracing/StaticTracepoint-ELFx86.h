@@ -86,17 +86,25 @@
 #define FOLLY_SDT_ARG_TEMPLATE_7    FOLLY_SDT_ARG_TEMPLATE_6 FOLLY_SDT_ARGFMT(7)
 #define FOLLY_SDT_ARG_TEMPLATE_8    FOLLY_SDT_ARG_TEMPLATE_7 FOLLY_SDT_ARGFMT(8)
 
-// Structure of note section for the probe.
-#define FOLLY_SDT_NOTE_CONTENT(provider, name, arg_template)                   \
+// Semaphore of the probe, if any, in the note section.
+#define FOLLY_SDT_SEMAPHORE_NOTE_0(provider, name)                             \
+  FOLLY_SDT_ASM_1(     FOLLY_SDT_ASM_ADDR 0) /*No Semaphore*/
+#define FOLLY_SDT_SEMAPHORE_NOTE_1(provider, name)                             \
+  FOLLY_SDT_ASM_1(     FOLLY_SDT_ASM_ADDR FOLLY_SDT_SEMAPHORE(provider, name))
+
+// Structure of note section for the probe.  The "?" flag puts the note in
+// the section group of the code, if any, so that the note of a probe in an
+// inline function or template is discarded along with the duplicate code.
+#define FOLLY_SDT_NOTE_CONTENT(provider, name, has_semaphore, arg_template)    \
   FOLLY_SDT_ASM_1(990: FOLLY_SDT_NOP)                                          \
-  FOLLY_SDT_ASM_3(     .pushsection .note.stapsdt,"","note")                   \
+  FOLLY_SDT_ASM_3(     .pushsection .note.stapsdt,"?","note")                  \
   FOLLY_SDT_ASM_1(     .balign 4)                                              \
   FOLLY_SDT_ASM_3(     .4byte 992f-991f, 994f-993f, FOLLY_SDT_NOTE_TYPE)       \
   FOLLY_SDT_ASM_1(991: .asciz FOLLY_SDT_NOTE_NAME)                             \
   FOLLY_SDT_ASM_1(992: .balign 4)                                              \
   FOLLY_SDT_ASM_1(993: FOLLY_SDT_ASM_ADDR 990b)                                \
-  FOLLY_SDT_ASM_1(     FOLLY_SDT_ASM_ADDR 0) /*Reserved for Semaphore address*/\
-  FOLLY_SDT_ASM_1(     FOLLY_SDT_ASM_ADDR 0) /*Reserved for Semaphore name*/   \
+  FOLLY_SDT_ASM_1(     FOLLY_SDT_ASM_ADDR 0) /*Reserved for Base Address*/    \
+  FOLLY_SDT_SEMAPHORE_NOTE_##has_semaphore(provider, name)                     \
   FOLLY_SDT_ASM_STRING(provider)                                               \
   FOLLY_SDT_ASM_STRING(name)                                                   \
   FOLLY_SDT_ASM_STRING(arg_template)                                           \
@@ -104,9 +112,10 @@
   FOLLY_SDT_ASM_1(     .popsection)
 
 // Main probe Macro.
-#define FOLLY_SDT_PROBE(provider, name, n, arglist)                            \
+#define FOLLY_SDT_PROBE(provider, name, has_semaphore, n, arglist)             \
     __asm__ __volatile__ (                                                     \
-      FOLLY_SDT_NOTE_CONTENT(provider, name, FOLLY_SDT_ARG_TEMPLATE_##n)       \
+      FOLLY_SDT_NOTE_CONTENT(                                                  \
+        provider, name, has_semaphore, FOLLY_SDT_ARG_TEMPLATE_##n)             \
       :: FOLLY_SDT_OPERANDS_##n arglist                                        \
     )                                                                          \
 
@@ -114,5 +123,19 @@
 #define FOLLY_SDT_NARG_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
 #define FOLLY_SDT_NARG(...)                                                    \
   FOLLY_SDT_NARG_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
-#define FOLLY_SDT_PROBE_N(provider, name, N, ...)                              \
-  FOLLY_SDT_PROBE(provider, name, N, (__VA_ARGS__))
+#define FOLLY_SDT_PROBE_N(provider, name, has_semaphore, N, ...)               \
+  FOLLY_SDT_PROBE(provider, name, has_semaphore, N, (__VA_ARGS__))
+
+// Semaphores: a counter per probe, in the .probes section, that tracers
+// increment while they are attached to it.
+#define FOLLY_SDT_SEMAPHORE(provider, name)                                    \
+  folly_sdt_semaphore_##provider##_##name
+#define FOLLY_SDT_DEFINE_SEMAPHORE(provider, name)                             \
+  extern "C" {                                                                 \
+    volatile unsigned short FOLLY_SDT_SEMAPHORE(provider, name)                \
+    __attribute__((section(".probes"), used)) = 0;                             \
+  }
+#define FOLLY_SDT_DECLARE_SEMAPHORE(provider, name)                            \
+  extern "C" volatile unsigned short FOLLY_SDT_SEMAPHORE(provider, name)
+#define FOLLY_SDT_IS_ENABLED(provider, name)                                   \
+  (FOLLY_SDT_SEMAPHORE(provider, name) > 0)
@@ -16,14 +16,45 @@
 
 #pragma once
 
+/**
+ * FOLLY_SDT(provider, name, args...) is a USDT probe: a nop, and a note in
+ * the binary that tracers (perf, bpftrace, systemtap...) use to attach to
+ * it and read args.  The args are still evaluated when nothing is
+ * attached, so they should be cheap.
+ *
+ * For expensive args, use a probe with a semaphore, which tracers
+ * increment while they are attached, and only compute them if it's set:
+ *
+ *   FOLLY_SDT_DEFINE_SEMAPHORE(provider, name); // once, in a .cpp file
+ *   FOLLY_SDT_DECLARE_SEMAPHORE(provider, name); // in headers, if needed
+ *
+ *   if (FOLLY_SDT_IS_ENABLED(provider, name)) {
+ *     FOLLY_SDT_WITH_SEMAPHORE(provider, name, computeStats());
+ *   }
+ *
+ * FOLLY_SDT_IS_ENABLED is a load and a compare, and is always false where
+ * probes aren't supported.
+ */
+
 #if defined(__ELF__) && (defined(__x86_64__) || defined(__i386__))
 #include <folly/tracing/StaticTracepoint-ELFx86.h>
 
 #define FOLLY_SDT(provider, name, ...) \
   FOLLY_SDT_PROBE_N(                   \
-      provider, name, FOLLY_SDT_NARG(0, ##__VA_ARGS__), ##__VA_ARGS__)
+      provider, name, 0, FOLLY_SDT_NARG(0, ##__VA_ARGS__), ##__VA_ARGS__)
+#define FOLLY_SDT_WITH_SEMAPHORE(provider, name, ...) \
+  FOLLY_SDT_PROBE_N(                                  \
+      provider, name, 1, FOLLY_SDT_NARG(0, ##__VA_ARGS__), ##__VA_ARGS__)
 #else
 #define FOLLY_SDT(provider, name, ...) \
   do {                                 \
   } while (0)
+#define FOLLY_SDT_WITH_SEMAPHORE(provider, name, ...) \
+  do {                                                \
+  } while (0)
+#define FOLLY_SDT_SEMAPHORE(provider, name) \
+  folly_sdt_semaphore_##provider##_##name
+#define FOLLY_SDT_DEFINE_SEMAPHORE(provider, name)
+#define FOLLY_SDT_DECLARE_SEMAPHORE(provider, name)
+#define FOLLY_SDT_IS_ENABLED(provider, name) (false)
 #endif
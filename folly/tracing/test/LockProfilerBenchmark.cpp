@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/LockProfiler.h>
+
+#include <mutex>
+
+#include <folly/Benchmark.h>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/portability/GFlags.h>
+
+template <class Lock>
+void lockUnlock(size_t iters, double samplingRate) {
+  folly::LockProfiler::setSamplingRate(samplingRate);
+  Lock lock;
+  for (size_t i = 0; i < iters; ++i) {
+    lock.lock();
+    folly::doNotOptimizeAway(i);
+    lock.unlock();
+  }
+  folly::LockProfiler::setSamplingRate(0);
+}
+
+BENCHMARK(sharedMutexOff, iters) {
+  lockUnlock<folly::SharedMutex>(iters, 0);
+}
+
+BENCHMARK_RELATIVE(sharedMutex1Percent, iters) {
+  lockUnlock<folly::SharedMutex>(iters, 0.01);
+}
+
+BENCHMARK_RELATIVE(sharedMutexAll, iters) {
+  lockUnlock<folly::SharedMutex>(iters, 1);
+}
+
+BENCHMARK_DRAW_LINE();
+
+void synchronizedIncrement(size_t iters, double samplingRate) {
+  folly::LockProfiler::setSamplingRate(samplingRate);
+  folly::Synchronized<size_t, std::mutex> counter(0);
+  for (size_t i = 0; i < iters; ++i) {
+    ++*counter.lock();
+  }
+  folly::LockProfiler::setSamplingRate(0);
+}
+
+BENCHMARK(synchronizedMutexOff, iters) {
+  synchronizedIncrement(iters, 0);
+}
+
+BENCHMARK_RELATIVE(synchronizedMutex1Percent, iters) {
+  synchronizedIncrement(iters, 0.01);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/LockProfiler.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <folly/Baton.h>
+#include <folly/MicroLock.h>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+LockProfile findProfile(const void* lock) {
+  for (auto& profile : LockProfiler::snapshot()) {
+    if (profile.lock == lock) {
+      return profile;
+    }
+  }
+  LockProfile empty{};
+  empty.lock = lock;
+  return empty;
+}
+
+class LockProfilerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    LockProfiler::setSamplingRate(1.0);
+    LockProfiler::reset();
+  }
+
+  void TearDown() override {
+    LockProfiler::setSamplingRate(0.0);
+  }
+};
+
+} // namespace
+
+TEST_F(LockProfilerTest, Disabled) {
+  LockProfiler::setSamplingRate(0.0);
+  EXPECT_EQ(0.0, LockProfiler::samplingRate());
+  SharedMutex mutex;
+  for (int i = 0; i < 100; ++i) {
+    mutex.lock();
+    mutex.unlock();
+  }
+  EXPECT_EQ(0, findProfile(&mutex).exclusive.acquisitions);
+}
+
+TEST_F(LockProfilerTest, SharedMutex) {
+  SharedMutex mutex;
+  LockProfiler::setName(&mutex, "LockProfilerTest.mutex");
+  for (int i = 0; i < 10; ++i) {
+    SharedMutex::WriteHolder holder(mutex);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  for (int i = 0; i < 20; ++i) {
+    SharedMutex::ReadHolder holder(mutex);
+  }
+  {
+    SharedMutex::UpgradeHolder holder(mutex);
+  }
+  ASSERT_TRUE(mutex.try_lock_shared_for(std::chrono::seconds(0)));
+  mutex.unlock_shared();
+
+  auto profile = findProfile(&mutex);
+  EXPECT_EQ("LockProfilerTest.mutex", profile.name);
+  EXPECT_EQ(10, profile.exclusive.acquisitions);
+  EXPECT_EQ(10, profile.exclusive.holds);
+  EXPECT_GT(profile.exclusive.holdNanos(profile.nanosPerTick), 10 * 95e3);
+  EXPECT_GE(profile.exclusive.holdTicks, profile.exclusive.maxHoldTicks);
+  // The try_lock_shared_for() succeeded too
+  EXPECT_EQ(21, profile.shared.acquisitions);
+  EXPECT_EQ(21, profile.shared.holds);
+  EXPECT_EQ(1, profile.upgrade.acquisitions);
+  EXPECT_NE(std::string::npos, LockProfiler::report().find("mutex"));
+
+  LockProfiler::setName(&mutex, "");
+  EXPECT_NE("LockProfilerTest.mutex", findProfile(&mutex).name);
+  LockProfiler::reset();
+  EXPECT_EQ(0, findProfile(&mutex).exclusive.acquisitions);
+}
+
+TEST_F(LockProfilerTest, Wait) {
+  SharedMutex mutex;
+  Baton<> locked;
+  std::thread holder([&] {
+    mutex.lock();
+    locked.post();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    mutex.unlock();
+  });
+  locked.wait();
+  mutex.lock_shared();
+  mutex.unlock_shared();
+  holder.join();
+
+  auto profile = findProfile(&mutex);
+  EXPECT_EQ(1, profile.exclusive.acquisitions);
+  EXPECT_EQ(1, profile.shared.acquisitions);
+  EXPECT_GT(profile.shared.waitNanos(profile.nanosPerTick), 10e6);
+  EXPECT_EQ(profile.shared.waitTicks, profile.shared.maxWaitTicks);
+  EXPECT_GT(profile.exclusive.holdNanos(profile.nanosPerTick), 15e6);
+  // Kept after the thread exited, and first by wait time
+  EXPECT_EQ(&mutex, LockProfiler::snapshot().front().lock);
+}
+
+TEST_F(LockProfilerTest, Synchronized) {
+  // Profiled by the lock policies
+  Synchronized<int, std::mutex> locked(0);
+  // Profiled by SharedMutex, and not again by the lock policies
+  Synchronized<int, SharedMutex> shared(0);
+  auto lockedMutex = locked.lock().getUniqueLock().mutex();
+  LockProfiler::reset();
+  for (int i = 0; i < 10; ++i) {
+    ++*locked.lock();
+    ++*shared.wlock();
+    EXPECT_EQ(i + 1, *shared.rlock());
+  }
+  {
+    auto ptr = locked.lock();
+    ptr.unlock();
+  }
+
+  auto profile = findProfile(lockedMutex);
+  EXPECT_EQ(11, profile.exclusive.acquisitions);
+  EXPECT_EQ(11, profile.exclusive.holds);
+
+  // The only other lock
+  auto profiles = LockProfiler::snapshot();
+  ASSERT_EQ(2, profiles.size());
+  auto& sharedProfile = profiles[profiles[0].lock == lockedMutex ? 1 : 0];
+  EXPECT_EQ(10, sharedProfile.exclusive.acquisitions);
+  EXPECT_EQ(10, sharedProfile.shared.acquisitions);
+}
+
+TEST_F(LockProfilerTest, MicroLock) {
+  MicroLock lock;
+  lock.init();
+  for (int i = 0; i < 10; ++i) {
+    lock.lock();
+    lock.unlock();
+  }
+  EXPECT_TRUE(lock.try_lock());
+  EXPECT_FALSE(lock.try_lock());
+  lock.unlock();
+  auto profile = findProfile(&lock);
+  EXPECT_EQ(11, profile.exclusive.acquisitions);
+  EXPECT_EQ(11, profile.exclusive.holds);
+}
+
+TEST_F(LockProfilerTest, Sampling) {
+  LockProfiler::setSamplingRate(0.01);
+  EXPECT_EQ(0.01, LockProfiler::samplingRate());
+  SharedMutex mutex;
+  constexpr int kAcquisitions = 100000;
+  for (int i = 0; i < kAcquisitions; ++i) {
+    mutex.lock();
+    mutex.unlock();
+  }
+  auto profile = findProfile(&mutex);
+  EXPECT_GT(profile.exclusive.acquisitions, kAcquisitions / 100 / 2);
+  EXPECT_LT(profile.exclusive.acquisitions, kAcquisitions / 100 * 2);
+  EXPECT_EQ(profile.exclusive.acquisitions, profile.exclusive.holds);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/ScopedTimer.h>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+FOLLY_NOINLINE void timed() {
+  FOLLY_SCOPED_TIMER("ScopedTimerBenchmark.timed");
+  folly::doNotOptimizeAway(0);
+}
+
+FOLLY_NOINLINE void untimed() {
+  folly::doNotOptimizeAway(0);
+}
+
+BENCHMARK(baseline, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    untimed();
+  }
+}
+
+BENCHMARK_RELATIVE(enabled, iters) {
+  folly::ScopedTimerRegistry::setEnabled(true);
+  for (size_t i = 0; i < iters; ++i) {
+    timed();
+  }
+}
+
+BENCHMARK_RELATIVE(disabled, iters) {
+  folly::ScopedTimerRegistry::setEnabled(false);
+  for (size_t i = 0; i < iters; ++i) {
+    timed();
+  }
+  folly::ScopedTimerRegistry::setEnabled(true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/ScopedTimer.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <folly/Baton.h>
+#include <folly/portability/GTest.h>
+
+using namespace folly;
+
+namespace {
+
+ScopedTimerSnapshot findSnapshot(const char* name) {
+  for (auto& snapshot : ScopedTimerRegistry::snapshot()) {
+    if (strcmp(snapshot.name, name) == 0) {
+      return snapshot;
+    }
+  }
+  ScopedTimerSnapshot empty{};
+  empty.name = name;
+  return empty;
+}
+
+void sleepFor(std::chrono::microseconds duration) {
+  FOLLY_SCOPED_TIMER("ScopedTimerTest.sleep");
+  std::this_thread::sleep_for(duration);
+}
+
+void spin() {
+  FOLLY_SCOPED_TIMER("ScopedTimerTest.spin");
+}
+
+} // namespace
+
+TEST(ScopedTimer, Buckets) {
+  EXPECT_EQ(0, ScopedTimerSnapshot::bucketMin(0));
+  std::vector<uint64_t> durations{
+      0, 1, 3, 4, 5, 7, 8, 9, 1000, uint64_t(1) << 40, ~uint64_t(0)};
+  for (auto ticks : durations) {
+    size_t idx = ScopedTimerSnapshot::bucketIdx(ticks);
+    ASSERT_LT(idx, ScopedTimerSnapshot::kNumBuckets);
+    EXPECT_LE(ScopedTimerSnapshot::bucketMin(idx), ticks);
+    if (idx + 1 < ScopedTimerSnapshot::kNumBuckets) {
+      EXPECT_GT(ScopedTimerSnapshot::bucketMin(idx + 1), ticks);
+    }
+  }
+  for (size_t idx = 0; idx < ScopedTimerSnapshot::kNumBuckets; ++idx) {
+    auto min = ScopedTimerSnapshot::bucketMin(idx);
+    EXPECT_EQ(idx, ScopedTimerSnapshot::bucketIdx(min));
+  }
+  EXPECT_EQ(
+      ScopedTimerSnapshot::kNumBuckets - 1,
+      ScopedTimerSnapshot::bucketIdx(~uint64_t(0)));
+}
+
+TEST(ScopedTimer, Percentiles) {
+  ScopedTimerSnapshot snapshot{};
+  snapshot.nanosPerTick = 2.0;
+  snapshot.buckets.resize(ScopedTimerSnapshot::kNumBuckets);
+  EXPECT_EQ(0.0, snapshot.percentileNanos(0.5));
+
+  // 100 durations in [1024, 1280) ticks, 100 in [4096, 5120)
+  snapshot.buckets[ScopedTimerSnapshot::bucketIdx(1024)] = 100;
+  snapshot.buckets[ScopedTimerSnapshot::bucketIdx(4096)] = 100;
+  snapshot.count = 200;
+  EXPECT_EQ(2 * 1024.0, snapshot.percentileNanos(0.0));
+  EXPECT_EQ(2 * 1152.0, snapshot.percentileNanos(0.25));
+  EXPECT_EQ(2 * 1280.0, snapshot.percentileNanos(0.5));
+  EXPECT_EQ(2 * 4608.0, snapshot.percentileNanos(0.75));
+  EXPECT_EQ(2 * 5120.0, snapshot.percentileNanos(1.0));
+}
+
+TEST(ScopedTimer, Records) {
+  ScopedTimerRegistry::reset();
+  for (int i = 0; i < 10; ++i) {
+    sleepFor(std::chrono::microseconds(1000));
+  }
+  auto snapshot = findSnapshot("ScopedTimerTest.sleep");
+  EXPECT_EQ(10, snapshot.count);
+  EXPECT_NE(nullptr, strstr(snapshot.file, "ScopedTimerTest.cpp"));
+  EXPECT_GT(snapshot.line, 0);
+  // Sleeps take at least as long as requested, and the TSC is calibrated
+  // to within a few percent
+  EXPECT_GT(snapshot.avgNanos(), 0.95e6);
+  EXPECT_LT(snapshot.avgNanos(), 100e6);
+  EXPECT_GT(snapshot.percentileNanos(0.5), 0.7e6);
+  EXPECT_LE(snapshot.percentileNanos(0.0), snapshot.percentileNanos(1.0));
+
+  ScopedTimerRegistry::reset();
+  EXPECT_EQ(0, findSnapshot("ScopedTimerTest.sleep").count);
+  sleepFor(std::chrono::microseconds(1));
+  EXPECT_EQ(1, findSnapshot("ScopedTimerTest.sleep").count);
+}
+
+TEST(ScopedTimer, Disabled) {
+  ScopedTimerRegistry::reset();
+  spin();
+  EXPECT_TRUE(ScopedTimerRegistry::isEnabled());
+  ScopedTimerRegistry::setEnabled(false);
+  for (int i = 0; i < 10; ++i) {
+    spin();
+  }
+  ScopedTimerRegistry::setEnabled(true);
+  spin();
+  EXPECT_EQ(2, findSnapshot("ScopedTimerTest.spin").count);
+}
+
+TEST(ScopedTimer, Threads) {
+  ScopedTimerRegistry::reset();
+  constexpr int kThreads = 4;
+  constexpr int kIters = 1000;
+
+  // The durations of exited threads are kept
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIters; ++i) {
+        spin();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kThreads * kIters, findSnapshot("ScopedTimerTest.spin").count);
+
+  // And merged with those of running threads
+  Baton<> recorded;
+  Baton<> done;
+  std::thread running([&] {
+    for (int i = 0; i < kIters; ++i) {
+      spin();
+    }
+    recorded.post();
+    done.wait();
+  });
+  recorded.wait();
+  for (int i = 0; i < kIters; ++i) {
+    spin();
+  }
+  auto snapshot = findSnapshot("ScopedTimerTest.spin");
+  EXPECT_EQ((kThreads + 2) * kIters, snapshot.count);
+  uint64_t total = 0;
+  for (auto bucket : snapshot.buckets) {
+    total += bucket;
+  }
+  EXPECT_EQ(snapshot.count, total);
+  done.post();
+  running.join();
+  snapshot = findSnapshot("ScopedTimerTest.spin");
+  EXPECT_EQ((kThreads + 2) * kIters, snapshot.count);
+}
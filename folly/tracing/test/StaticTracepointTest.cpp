@@ -169,7 +169,8 @@ static void checkTracepointArguments(
 static bool getTracepointArguments(
     const std::string& expectedProvider,
     const std::string& expectedProbe,
-    std::string& arguments) {
+    std::string& arguments,
+    intptr_t* semaphore = nullptr) {
   // Read the note and check if it's non-empty.
   std::string exe = getExe();
   auto note = readNote(exe);
@@ -203,12 +204,11 @@ static bool getTracepointArguments(
     CHECK_GT(probeAddr, 0);
     remaining -= kAddrWidth;
 
-    intptr_t semaphoreAddr = getAddr(note, pos);
-    CHECK_EQ(0, semaphoreAddr);
+    intptr_t baseAddr = getAddr(note, pos);
+    CHECK_EQ(0, baseAddr);
     remaining -= kAddrWidth;
 
-    intptr_t semaphoreBase = getAddr(note, pos);
-    CHECK_EQ(0, semaphoreBase);
+    intptr_t semaphoreAddr = getAddr(note, pos);
     remaining -= kAddrWidth;
 
     // Read tracepoint provider, probe and argument layout description.
@@ -228,6 +228,9 @@ static bool getTracepointArguments(
     align4Bytes(pos);
 
     if (provider == expectedProvider && probe == expectedProbe) {
+      if (semaphore) {
+        *semaphore = semaphoreAddr;
+      }
       return true;
     }
   }
@@ -394,3 +397,41 @@ TEST(StaticTracepoint, TestStruct) {
   std::array<int, 2> expected{{sizeof(testStruct), sizeof(testStruct)}};
   checkTracepointArguments(arguments, expected);
 }
+
+FOLLY_SDT_DEFINE_SEMAPHORE(folly, test_semaphore);
+
+static int semaphoreArgCount = 0;
+
+static int semaphoreArg() {
+  return ++semaphoreArgCount;
+}
+
+static void testSemaphoreFunc() {
+  if (FOLLY_SDT_IS_ENABLED(folly, test_semaphore)) {
+    FOLLY_SDT_WITH_SEMAPHORE(folly, test_semaphore, semaphoreArg());
+  }
+}
+
+TEST(StaticTracepoint, TestSemaphore) {
+  testSemaphoreFunc();
+  EXPECT_EQ(0, semaphoreArgCount);
+
+  // What a tracer does when it attaches
+  ++FOLLY_SDT_SEMAPHORE(folly, test_semaphore);
+  testSemaphoreFunc();
+  EXPECT_EQ(1, semaphoreArgCount);
+  --FOLLY_SDT_SEMAPHORE(folly, test_semaphore);
+
+  std::string arguments;
+  intptr_t semaphore = 0;
+  EXPECT_TRUE(getTracepointArguments(
+      "folly", "test_semaphore", arguments, &semaphore));
+  std::array<int, 1> expected{{sizeof(int)}};
+  checkTracepointArguments(arguments, expected);
+  EXPECT_NE(0, semaphore);
+
+  // Probes without a semaphore leave it out
+  EXPECT_TRUE(getTracepointArguments(
+      "folly", "test_static_tracepoint_empty", arguments, &semaphore));
+  EXPECT_EQ(0, semaphore);
+}